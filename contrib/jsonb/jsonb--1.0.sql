@@ -0,0 +1,192 @@
+/* contrib/jsonb/jsonb--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION jsonb" to load this file. \quit
+
+CREATE TYPE jsonb;
+
+CREATE FUNCTION jsonb_in(cstring)
+RETURNS jsonb
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE FUNCTION jsonb_out(jsonb)
+RETURNS cstring
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE FUNCTION jsonb_recv(internal)
+RETURNS jsonb
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE FUNCTION jsonb_send(jsonb)
+RETURNS bytea
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE TYPE jsonb (
+        INTERNALLENGTH = -1,
+        INPUT = jsonb_in,
+        OUTPUT = jsonb_out,
+        RECEIVE = jsonb_recv,
+        SEND = jsonb_send,
+        ALIGNMENT = int4,
+        STORAGE = extended
+);
+
+CREATE FUNCTION jsonb_object_field(jsonb, text)
+RETURNS jsonb
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR -> (
+	LEFTARG = jsonb,
+	RIGHTARG = text,
+	PROCEDURE = jsonb_object_field
+);
+
+CREATE FUNCTION jsonb_array_element(jsonb, int4)
+RETURNS jsonb
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR -> (
+	LEFTARG = jsonb,
+	RIGHTARG = int4,
+	PROCEDURE = jsonb_array_element
+);
+
+CREATE FUNCTION jsonb_object_field_text(jsonb, text)
+RETURNS text
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR ->> (
+	LEFTARG = jsonb,
+	RIGHTARG = text,
+	PROCEDURE = jsonb_object_field_text
+);
+
+CREATE FUNCTION jsonb_array_element_text(jsonb, int4)
+RETURNS text
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR ->> (
+	LEFTARG = jsonb,
+	RIGHTARG = int4,
+	PROCEDURE = jsonb_array_element_text
+);
+
+CREATE FUNCTION jsonb_exists(jsonb, text)
+RETURNS bool
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR ? (
+	LEFTARG = jsonb,
+	RIGHTARG = text,
+	PROCEDURE = jsonb_exists,
+	RESTRICT = contsel,
+	JOIN = contjoinsel
+);
+
+CREATE FUNCTION jsonb_exists_any(jsonb, text[])
+RETURNS bool
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR ?| (
+	LEFTARG = jsonb,
+	RIGHTARG = text[],
+	PROCEDURE = jsonb_exists_any,
+	RESTRICT = contsel,
+	JOIN = contjoinsel
+);
+
+CREATE FUNCTION jsonb_exists_all(jsonb, text[])
+RETURNS bool
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR ?& (
+	LEFTARG = jsonb,
+	RIGHTARG = text[],
+	PROCEDURE = jsonb_exists_all,
+	RESTRICT = contsel,
+	JOIN = contjoinsel
+);
+
+CREATE FUNCTION jsonb_contains(jsonb, jsonb)
+RETURNS bool
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE FUNCTION jsonb_contained(jsonb, jsonb)
+RETURNS bool
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE OPERATOR @> (
+	LEFTARG = jsonb,
+	RIGHTARG = jsonb,
+	PROCEDURE = jsonb_contains,
+	COMMUTATOR = '<@',
+	RESTRICT = contsel,
+	JOIN = contjoinsel
+);
+
+CREATE OPERATOR <@ (
+	LEFTARG = jsonb,
+	RIGHTARG = jsonb,
+	PROCEDURE = jsonb_contained,
+	COMMUTATOR = '@>',
+	RESTRICT = contsel,
+	JOIN = contjoinsel
+);
+
+CREATE FUNCTION jsonb_typeof(jsonb)
+RETURNS text
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE FUNCTION jsonb_array_length(jsonb)
+RETURNS int4
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+CREATE FUNCTION jsonb_object_keys(jsonb)
+RETURNS setof text
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT IMMUTABLE;
+
+-- GIN support
+
+CREATE FUNCTION gin_extract_jsonb(internal, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT;
+
+CREATE FUNCTION gin_extract_jsonb_query(internal, internal, int2, internal, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT;
+
+CREATE FUNCTION gin_consistent_jsonb(internal, int2, internal, int4, internal, internal)
+RETURNS bool
+AS 'MODULE_PATHNAME'
+LANGUAGE C IMMUTABLE STRICT;
+
+CREATE OPERATOR CLASS gin_jsonb_ops
+DEFAULT FOR TYPE jsonb USING gin
+AS
+	OPERATOR        7       @>,
+	OPERATOR        9       ?(jsonb,text),
+	OPERATOR        10      ?|(jsonb,text[]),
+	OPERATOR        11      ?&(jsonb,text[]),
+	FUNCTION        1       bttextcmp(text,text),
+	FUNCTION        2       gin_extract_jsonb(internal, internal),
+	FUNCTION        3       gin_extract_jsonb_query(internal, internal, int2, internal, internal),
+	FUNCTION        4       gin_consistent_jsonb(internal, int2, internal, int4, internal, internal),
+	STORAGE         text;
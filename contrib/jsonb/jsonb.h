@@ -0,0 +1,176 @@
+/*
+ * contrib/jsonb/jsonb.h
+ *
+ * Definitions for the jsonb type, a pre-parsed binary representation of
+ * JSON documents.
+ */
+#ifndef __JSONB_H__
+#define __JSONB_H__
+
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "utils/numeric.h"
+
+
+/*
+ * On-disk format
+ *
+ * A jsonb value is a varlena whose payload is one container.  A container
+ * is a uint32 header, holding the number of children and the container's
+ * kind, followed by one JEntry per child and then the children's data.
+ * An object with n pairs has 2n children, key0, value0, key1, value1, ...,
+ * with the pairs sorted by key (shorter keys first, then bytewise), and no
+ * duplicate keys; so a key can be found by binary search.  A scalar at the
+ * top level is stored as a one-element array flagged JB_FSCALAR.
+ *
+ * Each JEntry holds the child's type and the offset just past its data,
+ * relative to the start of the container's data area; a child's data
+ * starts where its predecessor's ends.  Numerics and nested containers are
+ * stored int-aligned, the padding counting as part of the child; readers
+ * realign the start pointer for those types.  Strings are stored without
+ * a terminator, and booleans and nulls take no data at all.
+ *
+ * Containers are position independent as long as they start on an int
+ * boundary, so a nested container can be copied out as a jsonb value of
+ * its own.
+ */
+typedef uint32 JEntry;
+
+#define JENTRY_POSMASK			0x0FFFFFFF
+#define JENTRY_TYPEMASK			0x70000000
+
+#define JENTRY_ISSTRING			0x00000000
+#define JENTRY_ISNUMERIC		0x10000000
+#define JENTRY_ISBOOL_FALSE		0x20000000
+#define JENTRY_ISBOOL_TRUE		0x30000000
+#define JENTRY_ISNULL			0x40000000
+#define JENTRY_ISCONTAINER		0x50000000
+
+#define JBE_ENDPOS(je_)			((je_) & JENTRY_POSMASK)
+#define JBE_TYPE(je_)			((je_) & JENTRY_TYPEMASK)
+
+typedef struct JsonbContainer
+{
+	uint32		header;			/* number of children, and flags below */
+	JEntry		children[1];	/* VARIABLE LENGTH ARRAY */
+	/* the children's data follows */
+} JsonbContainer;
+
+#define JB_CMASK				0x0FFFFFFF
+#define JB_FSCALAR				0x10000000
+#define JB_FOBJECT				0x20000000
+#define JB_FARRAY				0x40000000
+
+#define JsonContainerSize(jc)		((jc)->header & JB_CMASK)
+#define JsonContainerIsScalar(jc)	(((jc)->header & JB_FSCALAR) != 0)
+#define JsonContainerIsObject(jc)	(((jc)->header & JB_FOBJECT) != 0)
+#define JsonContainerIsArray(jc)	(((jc)->header & JB_FARRAY) != 0)
+/* number of JEntries: two per pair for objects */
+#define JsonContainerNEntries(jc) \
+	(JsonContainerIsObject(jc) ? 2 * JsonContainerSize(jc) : JsonContainerSize(jc))
+#define JsonContainerData(jc) \
+	((char *) &(jc)->children[JsonContainerNEntries(jc)])
+
+typedef struct
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	JsonbContainer root;
+} Jsonb;
+
+#define JB_ROOT_COUNT(jb)		JsonContainerSize(&(jb)->root)
+#define JB_ROOT_IS_SCALAR(jb)	JsonContainerIsScalar(&(jb)->root)
+#define JB_ROOT_IS_OBJECT(jb)	JsonContainerIsObject(&(jb)->root)
+#define JB_ROOT_IS_ARRAY(jb)	JsonContainerIsArray(&(jb)->root)
+
+/*
+ * jsonb is always detoasted into an aligned, 4-byte-header copy, since the
+ * container format relies on int alignment.
+ */
+#define DatumGetJsonb(d)		((Jsonb *) PG_DETOAST_DATUM(d))
+#define PG_GETARG_JSONB(x)		DatumGetJsonb(PG_GETARG_DATUM(x))
+#define PG_RETURN_JSONB(x)		PG_RETURN_POINTER(x)
+
+
+/*
+ * In-memory representation, used while parsing and building values and to
+ * hand out individual values found in a container.
+ */
+typedef enum
+{
+	jbvNull,
+	jbvString,
+	jbvNumeric,
+	jbvBool,
+	jbvArray,
+	jbvObject,
+	jbvBinary					/* a container inside some jsonb value */
+} JsonbValueType;
+
+typedef struct JsonbPair JsonbPair;
+
+typedef struct JsonbValue
+{
+	JsonbValueType type;
+	union
+	{
+		Numeric		numeric;
+		bool		boolean;
+		struct
+		{
+			int			len;
+			char	   *val;	/* not null-terminated */
+		}			string;
+		struct
+		{
+			int			nElems;
+			struct JsonbValue *elems;
+			bool		rawScalar;	/* top-level scalar wrapper? */
+		}			array;
+		struct
+		{
+			int			nPairs;
+			JsonbPair  *pairs;
+		}			object;
+		struct
+		{
+			int			len;
+			JsonbContainer *data;
+		}			binary;
+	}			val;
+} JsonbValue;
+
+struct JsonbPair
+{
+	JsonbValue	key;			/* always a jbvString */
+	JsonbValue	value;
+	int			order;			/* position in input, to resolve duplicates */
+};
+
+#define IsAJsonbScalar(jbv) \
+	((jbv)->type >= jbvNull && (jbv)->type <= jbvBool)
+
+/* GIN support: strategy numbers, as for hstore */
+#define JsonbContainsStrategyNumber		7
+#define JsonbExistsStrategyNumber		9
+#define JsonbExistsAnyStrategyNumber	10
+#define JsonbExistsAllStrategyNumber	11
+
+
+/* jsonb_io.c */
+extern Jsonb *JsonbValueToJsonb(JsonbValue *val);
+extern char *JsonbToCString(StringInfo out, JsonbContainer *jc, int estimated_len);
+extern void escape_jsonb_string(StringInfo buf, const char *str, int len);
+
+/* jsonb_util.c */
+extern void getJsonbChild(JsonbContainer *jc, int index, JsonbValue *result);
+extern bool findJsonbKey(JsonbContainer *jc, const char *key, int keylen,
+			 JsonbValue *result);
+extern bool getJsonbArrayElement(JsonbContainer *jc, int index,
+					 JsonbValue *result);
+extern bool JsonbArrayHasString(JsonbContainer *jc, const char *str, int len);
+extern bool JsonbDeepContains(JsonbContainer *val, JsonbContainer *query);
+extern bool JsonbScalarEquals(JsonbValue *a, JsonbValue *b);
+extern int	compareJsonbKeys(const char *a, int alen, const char *b, int blen);
+extern char *JsonbNumericToNormalizedCString(Numeric num);
+
+#endif   /* __JSONB_H__ */
@@ -0,0 +1,259 @@
+/*
+ * contrib/jsonb/jsonb_gin.c
+ */
+#include "postgres.h"
+
+#include "access/gin.h"
+#include "access/skey.h"
+#include "catalog/pg_type.h"
+#include "miscadmin.h"
+#include "utils/array.h"
+
+#include "jsonb.h"
+
+
+/*
+ * As for hstore, index entries are text values with a flag byte prepended.
+ * Object keys at any nesting level are indexed as K items, and so are the
+ * string elements of arrays, since the existence operators treat those as
+ * keys too.  Other scalars are indexed as V items (numbers in a normalized
+ * text form), and nulls as a bare N.  The index doesn't know where in the
+ * document an item came from, so every operator needs a recheck.
+ */
+#define KEYFLAG		'K'
+#define VALFLAG		'V'
+#define NULLFLAG	'N'
+
+typedef struct
+{
+	Datum	   *entries;
+	int			count;
+	int			size;
+} GinEntries;
+
+/* Build an indexable text value */
+static text *
+makeitem(const char *str, int len, char flag)
+{
+	text	   *item;
+
+	item = (text *) palloc(VARHDRSZ + len + 1);
+	SET_VARSIZE(item, VARHDRSZ + len + 1);
+
+	*VARDATA(item) = flag;
+
+	if (str && len > 0)
+		memcpy(VARDATA(item) + 1, str, len);
+
+	return item;
+}
+
+static void
+add_entry(GinEntries *e, text *item)
+{
+	if (e->count >= e->size)
+	{
+		e->size = (e->size > 0) ? e->size * 2 : 16;
+		if (e->entries)
+			e->entries = repalloc(e->entries, sizeof(Datum) * e->size);
+		else
+			e->entries = palloc(sizeof(Datum) * e->size);
+	}
+	e->entries[e->count++] = PointerGetDatum(item);
+}
+
+static void
+add_scalar(GinEntries *e, JsonbValue *v, bool inArray)
+{
+	char	   *str;
+
+	switch (v->type)
+	{
+		case jbvNull:
+			add_entry(e, makeitem(NULL, 0, NULLFLAG));
+			break;
+		case jbvString:
+			add_entry(e, makeitem(v->val.string.val, v->val.string.len,
+								  inArray ? KEYFLAG : VALFLAG));
+			break;
+		case jbvNumeric:
+			str = JsonbNumericToNormalizedCString(v->val.numeric);
+			add_entry(e, makeitem(str, strlen(str), VALFLAG));
+			break;
+		case jbvBool:
+			str = v->val.boolean ? "true" : "false";
+			add_entry(e, makeitem(str, strlen(str), VALFLAG));
+			break;
+		default:
+			elog(ERROR, "unexpected jsonb scalar type: %d", (int) v->type);
+	}
+}
+
+static void
+extract_container(GinEntries *e, JsonbContainer *jc)
+{
+	int			count = JsonContainerSize(jc);
+	int			i;
+
+	check_stack_depth();
+
+	for (i = 0; i < count; i++)
+	{
+		JsonbValue	v;
+
+		if (JsonContainerIsObject(jc))
+		{
+			getJsonbChild(jc, 2 * i, &v);
+			add_entry(e, makeitem(v.val.string.val, v.val.string.len,
+								  KEYFLAG));
+			getJsonbChild(jc, 2 * i + 1, &v);
+		}
+		else
+			getJsonbChild(jc, i, &v);
+
+		if (v.type == jbvBinary)
+			extract_container(e, v.val.binary.data);
+		else
+			add_scalar(e, &v, JsonContainerIsArray(jc));
+	}
+}
+
+PG_FUNCTION_INFO_V1(gin_extract_jsonb);
+Datum		gin_extract_jsonb(PG_FUNCTION_ARGS);
+
+Datum
+gin_extract_jsonb(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	int32	   *nentries = (int32 *) PG_GETARG_POINTER(1);
+	GinEntries	e;
+
+	e.entries = NULL;
+	e.count = 0;
+	e.size = 0;
+
+	extract_container(&e, &jb->root);
+
+	*nentries = e.count;
+	PG_RETURN_POINTER(e.entries);
+}
+
+PG_FUNCTION_INFO_V1(gin_extract_jsonb_query);
+Datum		gin_extract_jsonb_query(PG_FUNCTION_ARGS);
+
+Datum
+gin_extract_jsonb_query(PG_FUNCTION_ARGS)
+{
+	int32	   *nentries = (int32 *) PG_GETARG_POINTER(1);
+	StrategyNumber strategy = PG_GETARG_UINT16(2);
+	int32	   *searchMode = (int32 *) PG_GETARG_POINTER(6);
+	Datum	   *entries;
+
+	if (strategy == JsonbContainsStrategyNumber)
+	{
+		/* Query is a jsonb, so just apply gin_extract_jsonb... */
+		entries = (Datum *)
+			DatumGetPointer(DirectFunctionCall2(gin_extract_jsonb,
+												PG_GETARG_DATUM(0),
+												PointerGetDatum(nentries)));
+		/* ... except that "contains {}" or "[]" requires a full index scan */
+		if (entries == NULL)
+			*searchMode = GIN_SEARCH_MODE_ALL;
+	}
+	else if (strategy == JsonbExistsStrategyNumber)
+	{
+		text	   *query = PG_GETARG_TEXT_PP(0);
+		text	   *item;
+
+		*nentries = 1;
+		entries = (Datum *) palloc(sizeof(Datum));
+		item = makeitem(VARDATA_ANY(query), VARSIZE_ANY_EXHDR(query), KEYFLAG);
+		entries[0] = PointerGetDatum(item);
+	}
+	else if (strategy == JsonbExistsAnyStrategyNumber ||
+			 strategy == JsonbExistsAllStrategyNumber)
+	{
+		ArrayType  *query = PG_GETARG_ARRAYTYPE_P(0);
+		Datum	   *key_datums;
+		bool	   *key_nulls;
+		int			key_count;
+		int			i,
+					j;
+		text	   *item;
+
+		deconstruct_array(query,
+						  TEXTOID, -1, false, 'i',
+						  &key_datums, &key_nulls, &key_count);
+
+		entries = (Datum *) palloc(sizeof(Datum) * key_count);
+
+		for (i = 0, j = 0; i < key_count; ++i)
+		{
+			/* Nulls in the array are ignored, as by the operators */
+			if (key_nulls[i])
+				continue;
+			item = makeitem(VARDATA(key_datums[i]), VARSIZE(key_datums[i]) - VARHDRSZ, KEYFLAG);
+			entries[j++] = PointerGetDatum(item);
+		}
+
+		*nentries = j;
+		/* ExistsAll with no keys should match everything */
+		if (j == 0 && strategy == JsonbExistsAllStrategyNumber)
+			*searchMode = GIN_SEARCH_MODE_ALL;
+	}
+	else
+	{
+		elog(ERROR, "unrecognized strategy number: %d", strategy);
+		entries = NULL;			/* keep compiler quiet */
+	}
+
+	PG_RETURN_POINTER(entries);
+}
+
+PG_FUNCTION_INFO_V1(gin_consistent_jsonb);
+Datum		gin_consistent_jsonb(PG_FUNCTION_ARGS);
+
+Datum
+gin_consistent_jsonb(PG_FUNCTION_ARGS)
+{
+	bool	   *check = (bool *) PG_GETARG_POINTER(0);
+	StrategyNumber strategy = PG_GETARG_UINT16(1);
+
+	/* Jsonb	   *query = PG_GETARG_JSONB(2); */
+	int32		nkeys = PG_GETARG_INT32(3);
+
+	/* Pointer	   *extra_data = (Pointer *) PG_GETARG_POINTER(4); */
+	bool	   *recheck = (bool *) PG_GETARG_POINTER(5);
+	bool		res = true;
+	int32		i;
+
+	/*
+	 * The index doesn't record the nesting level an item was found at, nor
+	 * which key a value belongs to, so all of these need a recheck.
+	 */
+	*recheck = true;
+
+	if (strategy == JsonbContainsStrategyNumber ||
+		strategy == JsonbExistsAllStrategyNumber)
+	{
+		/* If not all the items are present, we can fail at once */
+		for (i = 0; i < nkeys; i++)
+		{
+			if (!check[i])
+			{
+				res = false;
+				break;
+			}
+		}
+	}
+	else if (strategy == JsonbExistsStrategyNumber ||
+			 strategy == JsonbExistsAnyStrategyNumber)
+	{
+		/* Some matching item is guaranteed in default search mode */
+		res = true;
+	}
+	else
+		elog(ERROR, "unrecognized strategy number: %d", strategy);
+
+	PG_RETURN_BOOL(res);
+}
@@ -0,0 +1,837 @@
+/*
+ * contrib/jsonb/jsonb_io.c
+ *
+ * Input, output and binary conversion of jsonb values.
+ */
+#include "postgres.h"
+
+#include <ctype.h>
+
+#include "libpq/pqformat.h"
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
+#include "utils/builtins.h"
+
+#include "jsonb.h"
+
+PG_MODULE_MAGIC;
+
+
+typedef struct
+{
+	char	   *input;			/* the whole input string */
+	char	   *ptr;			/* current parse position */
+} JsonbParseState;
+
+static void parse_value(JsonbParseState *state, JsonbValue *result);
+static void convertContainer(StringInfo buf, JsonbValue *val);
+static void containerToCString(StringInfo out, JsonbContainer *jc);
+
+
+static void
+jsonb_syntax_error(JsonbParseState *state, const char *detail)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+			 errmsg("invalid input syntax for type jsonb"),
+			 errdetail("%s", detail)));
+}
+
+static void
+skip_whitespace(JsonbParseState *state)
+{
+	while (*state->ptr == ' ' || *state->ptr == '\t' ||
+		   *state->ptr == '\n' || *state->ptr == '\r')
+		state->ptr++;
+}
+
+/*
+ * Parse a string literal; state->ptr points at the opening quote.  The
+ * de-escaped string is returned in *len bytes of palloc'd memory.
+ */
+static char *
+parse_string(JsonbParseState *state, int *len)
+{
+	StringInfoData buf;
+	char	   *p = state->ptr + 1;
+
+	initStringInfo(&buf);
+
+	for (;;)
+	{
+		if (*p == '\0')
+			jsonb_syntax_error(state, "Input ended inside a string.");
+		if (*p == '"')
+			break;
+		if ((unsigned char) *p < 0x20)
+			jsonb_syntax_error(state,
+						"Control characters must be escaped in strings.");
+
+		if (*p != '\\')
+		{
+			appendStringInfoChar(&buf, *p++);
+			continue;
+		}
+
+		p++;
+		switch (*p)
+		{
+			case '"':
+			case '\\':
+			case '/':
+				appendStringInfoChar(&buf, *p);
+				break;
+			case 'b':
+				appendStringInfoChar(&buf, '\b');
+				break;
+			case 'f':
+				appendStringInfoChar(&buf, '\f');
+				break;
+			case 'n':
+				appendStringInfoChar(&buf, '\n');
+				break;
+			case 'r':
+				appendStringInfoChar(&buf, '\r');
+				break;
+			case 't':
+				appendStringInfoChar(&buf, '\t');
+				break;
+			case 'u':
+				{
+					pg_wchar	ch = 0;
+					int			i;
+
+					for (i = 1; i <= 4; i++)
+					{
+						char		c = p[i];
+
+						if (c >= '0' && c <= '9')
+							ch = (ch << 4) | (c - '0');
+						else if (c >= 'a' && c <= 'f')
+							ch = (ch << 4) | (c - 'a' + 10);
+						else if (c >= 'A' && c <= 'F')
+							ch = (ch << 4) | (c - 'A' + 10);
+						else
+							jsonb_syntax_error(state,
+							 "\"\\u\" must be followed by four hexadecimal digits.");
+					}
+					p += 4;
+
+					/* a high surrogate must be followed by a low one */
+					if (ch >= 0xD800 && ch <= 0xDBFF)
+					{
+						pg_wchar	lo = 0;
+
+						if (p[1] != '\\' || p[2] != 'u')
+							jsonb_syntax_error(state,
+							"Unicode high surrogate must be followed by a low surrogate.");
+						for (i = 3; i <= 6; i++)
+						{
+							char		c = p[i];
+
+							if (c >= '0' && c <= '9')
+								lo = (lo << 4) | (c - '0');
+							else if (c >= 'a' && c <= 'f')
+								lo = (lo << 4) | (c - 'a' + 10);
+							else if (c >= 'A' && c <= 'F')
+								lo = (lo << 4) | (c - 'A' + 10);
+							else
+								jsonb_syntax_error(state,
+								 "\"\\u\" must be followed by four hexadecimal digits.");
+						}
+						if (lo < 0xDC00 || lo > 0xDFFF)
+							jsonb_syntax_error(state,
+							"Unicode high surrogate must be followed by a low surrogate.");
+						ch = 0x10000 + ((ch - 0xD800) << 10) + (lo - 0xDC00);
+						p += 6;
+					}
+					else if (ch >= 0xDC00 && ch <= 0xDFFF)
+						jsonb_syntax_error(state,
+						"Unicode low surrogate must follow a high surrogate.");
+
+					if (ch == 0)
+						ereport(ERROR,
+								(errcode(ERRCODE_UNTRANSLATABLE_CHARACTER),
+								 errmsg("invalid input syntax for type jsonb"),
+								 errdetail("\\u0000 cannot be converted to text.")));
+
+					if (GetDatabaseEncoding() == PG_UTF8)
+					{
+						unsigned char utf8str[5];
+						int			utf8len;
+
+						unicode_to_utf8(ch, utf8str);
+						utf8len = pg_utf_mblen(utf8str);
+						appendBinaryStringInfo(&buf, (char *) utf8str, utf8len);
+					}
+					else if (ch <= 0x007F)
+						appendStringInfoChar(&buf, (char) ch);
+					else
+						ereport(ERROR,
+								(errcode(ERRCODE_UNTRANSLATABLE_CHARACTER),
+								 errmsg("invalid input syntax for type jsonb"),
+								 errdetail("Unicode escape values cannot be used for code point values above 007F when the server encoding is not UTF8.")));
+				}
+				break;
+			case '\0':
+				jsonb_syntax_error(state, "Input ended inside a string.");
+				break;
+			default:
+				jsonb_syntax_error(state, "Invalid escape sequence in string.");
+				break;
+		}
+		p++;
+	}
+
+	state->ptr = p + 1;
+	*len = buf.len;
+	return buf.data;
+}
+
+/*
+ * Parse a number, following the JSON grammar, which is stricter than what
+ * numeric_in accepts.
+ */
+static Numeric
+parse_number(JsonbParseState *state)
+{
+	char	   *start = state->ptr;
+	char	   *p = start;
+	char	   *str;
+	Datum		result;
+
+	if (*p == '-')
+		p++;
+	if (*p == '0')
+		p++;
+	else if (*p >= '1' && *p <= '9')
+	{
+		while (isdigit((unsigned char) *p))
+			p++;
+	}
+	else
+		jsonb_syntax_error(state, "Invalid number.");
+
+	if (*p == '.')
+	{
+		p++;
+		if (!isdigit((unsigned char) *p))
+			jsonb_syntax_error(state, "Invalid number.");
+		while (isdigit((unsigned char) *p))
+			p++;
+	}
+
+	if (*p == 'e' || *p == 'E')
+	{
+		p++;
+		if (*p == '+' || *p == '-')
+			p++;
+		if (!isdigit((unsigned char) *p))
+			jsonb_syntax_error(state, "Invalid number.");
+		while (isdigit((unsigned char) *p))
+			p++;
+	}
+
+	state->ptr = p;
+
+	str = pnstrdup(start, p - start);
+	result = DirectFunctionCall3(numeric_in,
+								 CStringGetDatum(str),
+								 ObjectIdGetDatum(InvalidOid),
+								 Int32GetDatum(-1));
+	pfree(str);
+
+	return DatumGetNumeric(result);
+}
+
+/*
+ * Check for one of the keywords true, false and null.
+ */
+static bool
+parse_keyword(JsonbParseState *state, const char *word)
+{
+	int			len = strlen(word);
+
+	if (strncmp(state->ptr, word, len) != 0 ||
+		isalnum((unsigned char) state->ptr[len]))
+		return false;
+	state->ptr += len;
+	return true;
+}
+
+static int
+compareJsonbPairs(const void *a, const void *b)
+{
+	const JsonbPair *pa = (const JsonbPair *) a;
+	const JsonbPair *pb = (const JsonbPair *) b;
+	int			res;
+
+	res = compareJsonbKeys(pa->key.val.string.val, pa->key.val.string.len,
+						   pb->key.val.string.val, pb->key.val.string.len);
+	if (res == 0)
+		res = (pa->order > pb->order) ? 1 : -1;
+	return res;
+}
+
+/*
+ * Sort the pairs of an object by key, and remove duplicate keys, keeping
+ * the value that appeared last in the input.
+ */
+static void
+uniqueify_object(JsonbValue *object)
+{
+	JsonbPair  *pairs = object->val.object.pairs;
+	int			n = object->val.object.nPairs;
+	int			i,
+				j;
+
+	if (n < 2)
+		return;
+
+	qsort(pairs, n, sizeof(JsonbPair), compareJsonbPairs);
+
+	for (i = 1, j = 0; i < n; i++)
+	{
+		if (compareJsonbKeys(pairs[i].key.val.string.val,
+							 pairs[i].key.val.string.len,
+							 pairs[j].key.val.string.val,
+							 pairs[j].key.val.string.len) != 0)
+			j++;
+		/* later duplicates sort after earlier ones and replace them */
+		pairs[j] = pairs[i];
+	}
+	object->val.object.nPairs = j + 1;
+}
+
+static void
+parse_object(JsonbParseState *state, JsonbValue *result)
+{
+	int			size = 4;
+	int			n = 0;
+	JsonbPair  *pairs = palloc(sizeof(JsonbPair) * size);
+
+	state->ptr++;				/* skip '{' */
+	skip_whitespace(state);
+
+	if (*state->ptr != '}')
+	{
+		for (;;)
+		{
+			skip_whitespace(state);
+			if (*state->ptr != '"')
+				jsonb_syntax_error(state, "Expected string as object key.");
+
+			if (n >= size)
+			{
+				size *= 2;
+				pairs = repalloc(pairs, sizeof(JsonbPair) * size);
+			}
+
+			pairs[n].key.type = jbvString;
+			pairs[n].key.val.string.val =
+				parse_string(state, &pairs[n].key.val.string.len);
+			pairs[n].order = n;
+
+			skip_whitespace(state);
+			if (*state->ptr != ':')
+				jsonb_syntax_error(state, "Expected \":\" after object key.");
+			state->ptr++;
+
+			parse_value(state, &pairs[n].value);
+			n++;
+
+			skip_whitespace(state);
+			if (*state->ptr == ',')
+				state->ptr++;
+			else if (*state->ptr == '}')
+				break;
+			else
+				jsonb_syntax_error(state, "Expected \",\" or \"}\" in object.");
+		}
+	}
+	state->ptr++;				/* skip '}' */
+
+	result->type = jbvObject;
+	result->val.object.nPairs = n;
+	result->val.object.pairs = pairs;
+	uniqueify_object(result);
+}
+
+static void
+parse_array(JsonbParseState *state, JsonbValue *result)
+{
+	int			size = 4;
+	int			n = 0;
+	JsonbValue *elems = palloc(sizeof(JsonbValue) * size);
+
+	state->ptr++;				/* skip '[' */
+	skip_whitespace(state);
+
+	if (*state->ptr != ']')
+	{
+		for (;;)
+		{
+			if (n >= size)
+			{
+				size *= 2;
+				elems = repalloc(elems, sizeof(JsonbValue) * size);
+			}
+
+			parse_value(state, &elems[n++]);
+
+			skip_whitespace(state);
+			if (*state->ptr == ',')
+				state->ptr++;
+			else if (*state->ptr == ']')
+				break;
+			else
+				jsonb_syntax_error(state, "Expected \",\" or \"]\" in array.");
+		}
+	}
+	state->ptr++;				/* skip ']' */
+
+	result->type = jbvArray;
+	result->val.array.nElems = n;
+	result->val.array.elems = elems;
+	result->val.array.rawScalar = false;
+}
+
+static void
+parse_value(JsonbParseState *state, JsonbValue *result)
+{
+	/* nesting depth is under the user's control */
+	check_stack_depth();
+
+	skip_whitespace(state);
+
+	switch (*state->ptr)
+	{
+		case '{':
+			parse_object(state, result);
+			break;
+		case '[':
+			parse_array(state, result);
+			break;
+		case '"':
+			result->type = jbvString;
+			result->val.string.val = parse_string(state,
+												  &result->val.string.len);
+			break;
+		case '-':
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+			result->type = jbvNumeric;
+			result->val.numeric = parse_number(state);
+			break;
+		case '\0':
+			jsonb_syntax_error(state, "The input string ended unexpectedly.");
+			break;
+		default:
+			if (parse_keyword(state, "true"))
+			{
+				result->type = jbvBool;
+				result->val.boolean = true;
+			}
+			else if (parse_keyword(state, "false"))
+			{
+				result->type = jbvBool;
+				result->val.boolean = false;
+			}
+			else if (parse_keyword(state, "null"))
+				result->type = jbvNull;
+			else
+				jsonb_syntax_error(state, "Expected JSON value.");
+			break;
+	}
+}
+
+static Jsonb *
+jsonb_from_cstring(char *str)
+{
+	JsonbParseState state;
+	JsonbValue	value;
+
+	state.input = str;
+	state.ptr = str;
+
+	parse_value(&state, &value);
+	skip_whitespace(&state);
+	if (*state.ptr != '\0')
+		jsonb_syntax_error(&state, "Unexpected characters after the end of the value.");
+
+	return JsonbValueToJsonb(&value);
+}
+
+
+/*
+ * Serialization to the on-disk format
+ */
+
+/* append "len" zero bytes to buf */
+static void
+pad_buffer(StringInfo buf, int len)
+{
+	enlargeStringInfo(buf, len);
+	memset(buf->data + buf->len, 0, len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+}
+
+static void
+check_offset(int offset)
+{
+	if (offset > JENTRY_POSMASK)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("jsonb value exceeds the maximum size of %d bytes",
+						JENTRY_POSMASK)));
+}
+
+/*
+ * Append one container child's data to buf, and return its JEntry type.
+ * Offsets within buf are relative to the start of the varlena, which is
+ * what makes the alignment padding meaningful.
+ */
+static JEntry
+convertChild(StringInfo buf, JsonbValue *val)
+{
+	switch (val->type)
+	{
+		case jbvNull:
+			return JENTRY_ISNULL;
+		case jbvBool:
+			return val->val.boolean ? JENTRY_ISBOOL_TRUE : JENTRY_ISBOOL_FALSE;
+		case jbvString:
+			appendBinaryStringInfo(buf, val->val.string.val,
+								   val->val.string.len);
+			return JENTRY_ISSTRING;
+		case jbvNumeric:
+			pad_buffer(buf, INTALIGN(buf->len) - buf->len);
+			appendBinaryStringInfo(buf, (char *) val->val.numeric,
+								   VARSIZE_ANY(val->val.numeric));
+			return JENTRY_ISNUMERIC;
+		case jbvBinary:
+			pad_buffer(buf, INTALIGN(buf->len) - buf->len);
+			appendBinaryStringInfo(buf, (char *) val->val.binary.data,
+								   val->val.binary.len);
+			return JENTRY_ISCONTAINER;
+		case jbvArray:
+		case jbvObject:
+			pad_buffer(buf, INTALIGN(buf->len) - buf->len);
+			convertContainer(buf, val);
+			return JENTRY_ISCONTAINER;
+	}
+	elog(ERROR, "unrecognized jsonb value type: %d", (int) val->type);
+	return 0;					/* keep compiler quiet */
+}
+
+/*
+ * Append an array or object to buf, which must be int-aligned at its end.
+ */
+static void
+convertContainer(StringInfo buf, JsonbValue *val)
+{
+	int			start = buf->len;
+	int			nentries;
+	int			dataStart;
+	uint32		header;
+	int			i;
+
+	Assert(start == INTALIGN(start));
+	check_stack_depth();
+
+	if (val->type == jbvArray)
+	{
+		nentries = val->val.array.nElems;
+		header = nentries | JB_FARRAY;
+		if (val->val.array.rawScalar)
+		{
+			Assert(nentries == 1);
+			header |= JB_FSCALAR;
+		}
+	}
+	else
+	{
+		Assert(val->type == jbvObject);
+		nentries = val->val.object.nPairs * 2;
+		header = val->val.object.nPairs | JB_FOBJECT;
+	}
+
+	/* reserve the header and JEntry array; they are filled in as we go */
+	pad_buffer(buf, sizeof(uint32) + nentries * sizeof(JEntry));
+	memcpy(buf->data + start, &header, sizeof(uint32));
+	dataStart = buf->len;
+
+	for (i = 0; i < nentries; i++)
+	{
+		JsonbValue *child;
+		JEntry		entry;
+
+		if (val->type == jbvArray)
+			child = &val->val.array.elems[i];
+		else if (i % 2 == 0)
+			child = &val->val.object.pairs[i / 2].key;
+		else
+			child = &val->val.object.pairs[i / 2].value;
+
+		entry = convertChild(buf, child);
+		check_offset(buf->len - dataStart);
+		entry |= (buf->len - dataStart);
+
+		/* buf->data may have moved, so recompute the slot address */
+		memcpy(buf->data + start + sizeof(uint32) + i * sizeof(JEntry),
+			   &entry, sizeof(JEntry));
+	}
+
+	/* keep the container's end aligned for whatever follows */
+	pad_buffer(buf, INTALIGN(buf->len) - buf->len);
+}
+
+/*
+ * Build a jsonb datum out of an in-memory value.  Scalars are wrapped into
+ * a one-element array flagged as such, and a jbvBinary is copied as is.
+ */
+Jsonb *
+JsonbValueToJsonb(JsonbValue *val)
+{
+	StringInfoData buf;
+	Jsonb	   *result;
+
+	if (val->type == jbvBinary)
+	{
+		result = (Jsonb *) palloc(VARHDRSZ + val->val.binary.len);
+		SET_VARSIZE(result, VARHDRSZ + val->val.binary.len);
+		memcpy(&result->root, val->val.binary.data, val->val.binary.len);
+		return result;
+	}
+
+	initStringInfo(&buf);
+	/* the varlena header, set below */
+	pad_buffer(&buf, VARHDRSZ);
+
+	if (IsAJsonbScalar(val))
+	{
+		JsonbValue	wrapper;
+
+		wrapper.type = jbvArray;
+		wrapper.val.array.nElems = 1;
+		wrapper.val.array.elems = val;
+		wrapper.val.array.rawScalar = true;
+		convertContainer(&buf, &wrapper);
+	}
+	else
+		convertContainer(&buf, val);
+
+	result = (Jsonb *) buf.data;
+	SET_VARSIZE(result, buf.len);
+	return result;
+}
+
+
+/*
+ * Conversion to text
+ */
+
+void
+escape_jsonb_string(StringInfo buf, const char *str, int len)
+{
+	const char *p;
+
+	appendStringInfoCharMacro(buf, '"');
+	for (p = str; p < str + len; p++)
+	{
+		switch (*p)
+		{
+			case '\b':
+				appendStringInfoString(buf, "\\b");
+				break;
+			case '\f':
+				appendStringInfoString(buf, "\\f");
+				break;
+			case '\n':
+				appendStringInfoString(buf, "\\n");
+				break;
+			case '\r':
+				appendStringInfoString(buf, "\\r");
+				break;
+			case '\t':
+				appendStringInfoString(buf, "\\t");
+				break;
+			case '"':
+				appendStringInfoString(buf, "\\\"");
+				break;
+			case '\\':
+				appendStringInfoString(buf, "\\\\");
+				break;
+			default:
+				if ((unsigned char) *p < ' ')
+					appendStringInfo(buf, "\\u%04x", (int) *p);
+				else
+					appendStringInfoCharMacro(buf, *p);
+				break;
+		}
+	}
+	appendStringInfoCharMacro(buf, '"');
+}
+
+static void
+valueToCString(StringInfo out, JsonbValue *val)
+{
+	switch (val->type)
+	{
+		case jbvNull:
+			appendBinaryStringInfo(out, "null", 4);
+			break;
+		case jbvString:
+			escape_jsonb_string(out, val->val.string.val, val->val.string.len);
+			break;
+		case jbvNumeric:
+			appendStringInfoString(out,
+						  DatumGetCString(DirectFunctionCall1(numeric_out,
+									   NumericGetDatum(val->val.numeric))));
+			break;
+		case jbvBool:
+			if (val->val.boolean)
+				appendBinaryStringInfo(out, "true", 4);
+			else
+				appendBinaryStringInfo(out, "false", 5);
+			break;
+		case jbvBinary:
+			containerToCString(out, val->val.binary.data);
+			break;
+		default:
+			elog(ERROR, "unexpected jsonb value type: %d", (int) val->type);
+	}
+}
+
+static void
+containerToCString(StringInfo out, JsonbContainer *jc)
+{
+	int			count = JsonContainerSize(jc);
+	JsonbValue	v;
+	int			i;
+
+	check_stack_depth();
+
+	if (JsonContainerIsScalar(jc))
+	{
+		getJsonbChild(jc, 0, &v);
+		valueToCString(out, &v);
+	}
+	else if (JsonContainerIsObject(jc))
+	{
+		appendStringInfoCharMacro(out, '{');
+		for (i = 0; i < count; i++)
+		{
+			if (i > 0)
+				appendBinaryStringInfo(out, ", ", 2);
+			getJsonbChild(jc, 2 * i, &v);
+			valueToCString(out, &v);
+			appendBinaryStringInfo(out, ": ", 2);
+			getJsonbChild(jc, 2 * i + 1, &v);
+			valueToCString(out, &v);
+		}
+		appendStringInfoCharMacro(out, '}');
+	}
+	else
+	{
+		appendStringInfoCharMacro(out, '[');
+		for (i = 0; i < count; i++)
+		{
+			if (i > 0)
+				appendBinaryStringInfo(out, ", ", 2);
+			getJsonbChild(jc, i, &v);
+			valueToCString(out, &v);
+		}
+		appendStringInfoCharMacro(out, ']');
+	}
+}
+
+/*
+ * Convert a container to its text form, appending to "out" if given, or a
+ * fresh buffer otherwise.  estimated_len is a hint for the initial size.
+ */
+char *
+JsonbToCString(StringInfo out, JsonbContainer *jc, int estimated_len)
+{
+	if (out == NULL)
+		out = makeStringInfo();
+	enlargeStringInfo(out, (estimated_len > 0) ? estimated_len : 64);
+
+	containerToCString(out, jc);
+
+	return out->data;
+}
+
+
+PG_FUNCTION_INFO_V1(jsonb_in);
+Datum		jsonb_in(PG_FUNCTION_ARGS);
+Datum
+jsonb_in(PG_FUNCTION_ARGS)
+{
+	char	   *str = PG_GETARG_CSTRING(0);
+
+	PG_RETURN_JSONB(jsonb_from_cstring(str));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_out);
+Datum		jsonb_out(PG_FUNCTION_ARGS);
+Datum
+jsonb_out(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+
+	PG_RETURN_CSTRING(JsonbToCString(NULL, &jb->root, VARSIZE(jb)));
+}
+
+/*
+ * The binary format is a version byte followed by the text form; this
+ * leaves room to send the on-disk format directly in a later version.
+ */
+PG_FUNCTION_INFO_V1(jsonb_recv);
+Datum		jsonb_recv(PG_FUNCTION_ARGS);
+Datum
+jsonb_recv(PG_FUNCTION_ARGS)
+{
+	StringInfo	buf = (StringInfo) PG_GETARG_POINTER(0);
+	int			version = pq_getmsgint(buf, 1);
+	char	   *str;
+	int			nbytes;
+
+	if (version != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("unsupported jsonb version number %d", version)));
+
+	str = pq_getmsgtext(buf, buf->len - buf->cursor, &nbytes);
+
+	PG_RETURN_JSONB(jsonb_from_cstring(str));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_send);
+Datum		jsonb_send(PG_FUNCTION_ARGS);
+Datum
+jsonb_send(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	StringInfoData buf;
+	StringInfoData text;
+
+	initStringInfo(&text);
+	JsonbToCString(&text, &jb->root, VARSIZE(jb));
+
+	pq_begintypsend(&buf);
+	pq_sendint(&buf, 1, 1);
+	pq_sendtext(&buf, text.data, text.len);
+	pfree(text.data);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
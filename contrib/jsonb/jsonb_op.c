@@ -0,0 +1,318 @@
+/*
+ * contrib/jsonb/jsonb_op.c
+ *
+ * Operators and functions for the jsonb type.
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+
+#include "jsonb.h"
+
+
+/*
+ * Convert a value found inside a jsonb to text, as the ->> operators
+ * return it: strings lose their quoting, and a JSON null becomes NULL.
+ */
+static text *
+JsonbValueAsText(JsonbValue *v)
+{
+	switch (v->type)
+	{
+		case jbvNull:
+			return NULL;
+		case jbvString:
+			return cstring_to_text_with_len(v->val.string.val,
+											v->val.string.len);
+		case jbvNumeric:
+			return cstring_to_text(DatumGetCString(DirectFunctionCall1(numeric_out,
+										  NumericGetDatum(v->val.numeric))));
+		case jbvBool:
+			return cstring_to_text(v->val.boolean ? "true" : "false");
+		case jbvBinary:
+			return cstring_to_text(JsonbToCString(NULL, v->val.binary.data,
+												  v->val.binary.len));
+		default:
+			elog(ERROR, "unexpected jsonb value type: %d", (int) v->type);
+	}
+	return NULL;				/* keep compiler quiet */
+}
+
+
+PG_FUNCTION_INFO_V1(jsonb_object_field);
+Datum		jsonb_object_field(PG_FUNCTION_ARGS);
+Datum
+jsonb_object_field(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	text	   *key = PG_GETARG_TEXT_PP(1);
+	JsonbValue	v;
+
+	if (!findJsonbKey(&jb->root, VARDATA_ANY(key), VARSIZE_ANY_EXHDR(key),
+					  &v))
+		PG_RETURN_NULL();
+
+	PG_RETURN_JSONB(JsonbValueToJsonb(&v));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_object_field_text);
+Datum		jsonb_object_field_text(PG_FUNCTION_ARGS);
+Datum
+jsonb_object_field_text(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	text	   *key = PG_GETARG_TEXT_PP(1);
+	JsonbValue	v;
+	text	   *result;
+
+	if (!findJsonbKey(&jb->root, VARDATA_ANY(key), VARSIZE_ANY_EXHDR(key),
+					  &v))
+		PG_RETURN_NULL();
+
+	result = JsonbValueAsText(&v);
+	if (result == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_TEXT_P(result);
+}
+
+PG_FUNCTION_INFO_V1(jsonb_array_element);
+Datum		jsonb_array_element(PG_FUNCTION_ARGS);
+Datum
+jsonb_array_element(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	int32		index = PG_GETARG_INT32(1);
+	JsonbValue	v;
+
+	if (!getJsonbArrayElement(&jb->root, index, &v))
+		PG_RETURN_NULL();
+
+	PG_RETURN_JSONB(JsonbValueToJsonb(&v));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_array_element_text);
+Datum		jsonb_array_element_text(PG_FUNCTION_ARGS);
+Datum
+jsonb_array_element_text(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	int32		index = PG_GETARG_INT32(1);
+	JsonbValue	v;
+	text	   *result;
+
+	if (!getJsonbArrayElement(&jb->root, index, &v))
+		PG_RETURN_NULL();
+
+	result = JsonbValueAsText(&v);
+	if (result == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_TEXT_P(result);
+}
+
+
+/*
+ * The existence operators look at top-level object keys, or at top-level
+ * string elements of an array.
+ */
+static bool
+jsonb_key_exists(Jsonb *jb, const char *key, int keylen)
+{
+	if (JB_ROOT_IS_OBJECT(jb))
+		return findJsonbKey(&jb->root, key, keylen, NULL);
+	return JsonbArrayHasString(&jb->root, key, keylen);
+}
+
+PG_FUNCTION_INFO_V1(jsonb_exists);
+Datum		jsonb_exists(PG_FUNCTION_ARGS);
+Datum
+jsonb_exists(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	text	   *key = PG_GETARG_TEXT_PP(1);
+
+	PG_RETURN_BOOL(jsonb_key_exists(jb, VARDATA_ANY(key),
+									VARSIZE_ANY_EXHDR(key)));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_exists_any);
+Datum		jsonb_exists_any(PG_FUNCTION_ARGS);
+Datum
+jsonb_exists_any(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	ArrayType  *keys = PG_GETARG_ARRAYTYPE_P(1);
+	Datum	   *key_datums;
+	bool	   *key_nulls;
+	int			key_count;
+	int			i;
+
+	deconstruct_array(keys, TEXTOID, -1, false, 'i',
+					  &key_datums, &key_nulls, &key_count);
+
+	for (i = 0; i < key_count; i++)
+	{
+		/* nulls in the array are ignored, as in hstore */
+		if (key_nulls[i])
+			continue;
+		if (jsonb_key_exists(jb, VARDATA(key_datums[i]),
+							 VARSIZE(key_datums[i]) - VARHDRSZ))
+			PG_RETURN_BOOL(true);
+	}
+
+	PG_RETURN_BOOL(false);
+}
+
+PG_FUNCTION_INFO_V1(jsonb_exists_all);
+Datum		jsonb_exists_all(PG_FUNCTION_ARGS);
+Datum
+jsonb_exists_all(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	ArrayType  *keys = PG_GETARG_ARRAYTYPE_P(1);
+	Datum	   *key_datums;
+	bool	   *key_nulls;
+	int			key_count;
+	int			i;
+
+	deconstruct_array(keys, TEXTOID, -1, false, 'i',
+					  &key_datums, &key_nulls, &key_count);
+
+	for (i = 0; i < key_count; i++)
+	{
+		if (key_nulls[i])
+			continue;
+		if (!jsonb_key_exists(jb, VARDATA(key_datums[i]),
+							  VARSIZE(key_datums[i]) - VARHDRSZ))
+			PG_RETURN_BOOL(false);
+	}
+
+	PG_RETURN_BOOL(true);
+}
+
+
+PG_FUNCTION_INFO_V1(jsonb_contains);
+Datum		jsonb_contains(PG_FUNCTION_ARGS);
+Datum
+jsonb_contains(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *val = PG_GETARG_JSONB(0);
+	Jsonb	   *query = PG_GETARG_JSONB(1);
+
+	PG_RETURN_BOOL(JsonbDeepContains(&val->root, &query->root));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_contained);
+Datum		jsonb_contained(PG_FUNCTION_ARGS);
+Datum
+jsonb_contained(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *query = PG_GETARG_JSONB(0);
+	Jsonb	   *val = PG_GETARG_JSONB(1);
+
+	PG_RETURN_BOOL(JsonbDeepContains(&val->root, &query->root));
+}
+
+
+PG_FUNCTION_INFO_V1(jsonb_typeof);
+Datum		jsonb_typeof(PG_FUNCTION_ARGS);
+Datum
+jsonb_typeof(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+	const char *result = NULL;
+
+	if (JB_ROOT_IS_OBJECT(jb))
+		result = "object";
+	else if (!JB_ROOT_IS_SCALAR(jb))
+		result = "array";
+	else
+	{
+		JsonbValue	v;
+
+		getJsonbChild(&jb->root, 0, &v);
+		switch (v.type)
+		{
+			case jbvNull:
+				result = "null";
+				break;
+			case jbvString:
+				result = "string";
+				break;
+			case jbvNumeric:
+				result = "number";
+				break;
+			case jbvBool:
+				result = "boolean";
+				break;
+			default:
+				elog(ERROR, "unexpected jsonb scalar type: %d", (int) v.type);
+		}
+	}
+
+	PG_RETURN_TEXT_P(cstring_to_text(result));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_array_length);
+Datum		jsonb_array_length(PG_FUNCTION_ARGS);
+Datum
+jsonb_array_length(PG_FUNCTION_ARGS)
+{
+	Jsonb	   *jb = PG_GETARG_JSONB(0);
+
+	if (!JB_ROOT_IS_ARRAY(jb) || JB_ROOT_IS_SCALAR(jb))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("cannot get array length of a jsonb value that is not an array")));
+
+	PG_RETURN_INT32(JB_ROOT_COUNT(jb));
+}
+
+PG_FUNCTION_INFO_V1(jsonb_object_keys);
+Datum		jsonb_object_keys(PG_FUNCTION_ARGS);
+Datum
+jsonb_object_keys(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	Jsonb	   *jb;
+	int			i;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		Jsonb	   *st;
+
+		jb = PG_GETARG_JSONB(0);
+		if (!JB_ROOT_IS_OBJECT(jb))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("cannot get keys of a jsonb value that is not an object")));
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		st = (Jsonb *) palloc(VARSIZE(jb));
+		memcpy(st, jb, VARSIZE(jb));
+		funcctx->user_fctx = (void *) st;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	jb = (Jsonb *) funcctx->user_fctx;
+	i = funcctx->call_cntr;
+
+	if (i < JB_ROOT_COUNT(jb))
+	{
+		JsonbValue	key;
+
+		getJsonbChild(&jb->root, 2 * i, &key);
+		SRF_RETURN_NEXT(funcctx,
+						PointerGetDatum(cstring_to_text_with_len(key.val.string.val,
+													key.val.string.len)));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
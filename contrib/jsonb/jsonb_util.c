@@ -0,0 +1,292 @@
+/*
+ * contrib/jsonb/jsonb_util.c
+ *
+ * Access to the children of jsonb containers, and containment tests.
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "utils/builtins.h"
+
+#include "jsonb.h"
+
+
+/*
+ * Compare two object keys in the order they are stored in: shorter keys
+ * first, and bytewise among keys of equal length.  This isn't a useful
+ * order for anything but lookups, but it's cheap.
+ */
+int
+compareJsonbKeys(const char *a, int alen, const char *b, int blen)
+{
+	if (alen != blen)
+		return (alen > blen) ? 1 : -1;
+	return memcmp(a, b, alen);
+}
+
+/*
+ * Fill *result with the index'th JEntry's value in a container.  Nested
+ * containers are returned as jbvBinary pointing into the parent.
+ */
+void
+getJsonbChild(JsonbContainer *jc, int index, JsonbValue *result)
+{
+	JEntry		entry = jc->children[index];
+	char	   *base = JsonContainerData(jc);
+	int			start = (index == 0) ? 0 : JBE_ENDPOS(jc->children[index - 1]);
+	int			end = JBE_ENDPOS(entry);
+
+	switch (JBE_TYPE(entry))
+	{
+		case JENTRY_ISSTRING:
+			result->type = jbvString;
+			result->val.string.val = base + start;
+			result->val.string.len = end - start;
+			break;
+		case JENTRY_ISNUMERIC:
+			result->type = jbvNumeric;
+			result->val.numeric = (Numeric) (base + INTALIGN(start));
+			break;
+		case JENTRY_ISBOOL_FALSE:
+			result->type = jbvBool;
+			result->val.boolean = false;
+			break;
+		case JENTRY_ISBOOL_TRUE:
+			result->type = jbvBool;
+			result->val.boolean = true;
+			break;
+		case JENTRY_ISNULL:
+			result->type = jbvNull;
+			break;
+		case JENTRY_ISCONTAINER:
+			result->type = jbvBinary;
+			result->val.binary.data = (JsonbContainer *) (base + INTALIGN(start));
+			result->val.binary.len = end - INTALIGN(start);
+			break;
+		default:
+			elog(ERROR, "unrecognized jsonb entry type: %u", JBE_TYPE(entry));
+	}
+}
+
+/*
+ * Look up a key in an object by binary search.  Returns false if the key
+ * isn't there, or jc isn't an object.
+ */
+bool
+findJsonbKey(JsonbContainer *jc, const char *key, int keylen,
+			 JsonbValue *result)
+{
+	int			stopLow = 0;
+	int			stopHigh;
+
+	if (!JsonContainerIsObject(jc))
+		return false;
+
+	stopHigh = JsonContainerSize(jc);
+	while (stopLow < stopHigh)
+	{
+		int			stopMiddle = stopLow + (stopHigh - stopLow) / 2;
+		JsonbValue	candidate;
+		int			difference;
+
+		getJsonbChild(jc, 2 * stopMiddle, &candidate);
+		difference = compareJsonbKeys(candidate.val.string.val,
+									  candidate.val.string.len,
+									  key, keylen);
+		if (difference == 0)
+		{
+			if (result)
+				getJsonbChild(jc, 2 * stopMiddle + 1, result);
+			return true;
+		}
+		else if (difference < 0)
+			stopLow = stopMiddle + 1;
+		else
+			stopHigh = stopMiddle;
+	}
+
+	return false;
+}
+
+/*
+ * Fetch the index'th element of an array.  Returns false if out of range,
+ * or if jc isn't a (non-scalar) array.
+ */
+bool
+getJsonbArrayElement(JsonbContainer *jc, int index, JsonbValue *result)
+{
+	if (!JsonContainerIsArray(jc) || JsonContainerIsScalar(jc))
+		return false;
+	if (index < 0 || index >= JsonContainerSize(jc))
+		return false;
+
+	getJsonbChild(jc, index, result);
+	return true;
+}
+
+/*
+ * Does array jc (possibly a scalar wrapper) have a string element equal to
+ * the given one?
+ */
+bool
+JsonbArrayHasString(JsonbContainer *jc, const char *str, int len)
+{
+	int			count = JsonContainerSize(jc);
+	int			i;
+
+	if (!JsonContainerIsArray(jc))
+		return false;
+
+	for (i = 0; i < count; i++)
+	{
+		JsonbValue	elem;
+
+		getJsonbChild(jc, i, &elem);
+		if (elem.type == jbvString && elem.val.string.len == len &&
+			memcmp(elem.val.string.val, str, len) == 0)
+			return true;
+	}
+	return false;
+}
+
+bool
+JsonbScalarEquals(JsonbValue *a, JsonbValue *b)
+{
+	if (a->type != b->type)
+		return false;
+
+	switch (a->type)
+	{
+		case jbvNull:
+			return true;
+		case jbvString:
+			return a->val.string.len == b->val.string.len &&
+				memcmp(a->val.string.val, b->val.string.val,
+					   a->val.string.len) == 0;
+		case jbvNumeric:
+			return DatumGetBool(DirectFunctionCall2(numeric_eq,
+										   NumericGetDatum(a->val.numeric),
+										 NumericGetDatum(b->val.numeric)));
+		case jbvBool:
+			return a->val.boolean == b->val.boolean;
+		default:
+			elog(ERROR, "invalid jsonb scalar type: %d", (int) a->type);
+	}
+	return false;				/* keep compiler quiet */
+}
+
+/*
+ * Does value "val" contain "query", both taken from within containers?
+ * Scalars must be equal; containers must be of the same kind and contain
+ * one another recursively.
+ */
+static bool
+valueContains(JsonbValue *val, JsonbValue *query)
+{
+	if (query->type == jbvBinary)
+	{
+		if (val->type != jbvBinary)
+			return false;
+		if (JsonContainerIsObject(val->val.binary.data) !=
+			JsonContainerIsObject(query->val.binary.data))
+			return false;
+		return JsonbDeepContains(val->val.binary.data,
+								 query->val.binary.data);
+	}
+	if (val->type == jbvBinary)
+		return false;
+	return JsonbScalarEquals(val, query);
+}
+
+/*
+ * Test whether container "val" contains container "query".
+ *
+ * An object contains another if every key of the query is present and its
+ * value contains the query's value.  An array contains another if every
+ * element of the query is contained in some element of the array, without
+ * regard to order or duplicates.  As a special case, a top-level scalar is
+ * contained in an array having it as an element, as well as in an equal
+ * scalar.
+ */
+bool
+JsonbDeepContains(JsonbContainer *val, JsonbContainer *query)
+{
+	int			qcount = JsonContainerSize(query);
+	int			vcount = JsonContainerSize(val);
+	int			i,
+				j;
+
+	check_stack_depth();
+
+	if (JsonContainerIsObject(query))
+	{
+		if (!JsonContainerIsObject(val))
+			return false;
+
+		for (i = 0; i < qcount; i++)
+		{
+			JsonbValue	qkey;
+			JsonbValue	qvalue;
+			JsonbValue	vvalue;
+
+			getJsonbChild(query, 2 * i, &qkey);
+			if (!findJsonbKey(val, qkey.val.string.val, qkey.val.string.len,
+							  &vvalue))
+				return false;
+			getJsonbChild(query, 2 * i + 1, &qvalue);
+			if (!valueContains(&vvalue, &qvalue))
+				return false;
+		}
+		return true;
+	}
+
+	/* query is an array, or a wrapped scalar */
+	if (!JsonContainerIsArray(val))
+		return false;
+	/* a scalar contains nothing but an equal scalar */
+	if (JsonContainerIsScalar(val) && !JsonContainerIsScalar(query))
+		return false;
+
+	for (i = 0; i < qcount; i++)
+	{
+		JsonbValue	qelem;
+		bool		found = false;
+
+		getJsonbChild(query, i, &qelem);
+		for (j = 0; j < vcount && !found; j++)
+		{
+			JsonbValue	velem;
+
+			getJsonbChild(val, j, &velem);
+			found = valueContains(&velem, &qelem);
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Produce a canonical text form of a number, so that numbers that compare
+ * equal produce the same GIN entry: trailing fractional zeroes are removed.
+ */
+char *
+JsonbNumericToNormalizedCString(Numeric num)
+{
+	char	   *str = DatumGetCString(DirectFunctionCall1(numeric_out,
+													 NumericGetDatum(num)));
+
+	if (strchr(str, '.') != NULL)
+	{
+		int			len = strlen(str);
+
+		while (str[len - 1] == '0')
+			str[--len] = '\0';
+		if (str[len - 1] == '.')
+			str[--len] = '\0';
+	}
+	if (strcmp(str, "-0") == 0)
+		strcpy(str, "0");
+
+	return str;
+}
@@ -0,0 +1,67 @@
+CREATE EXTENSION jsonb;
+-- input and output
+SELECT '{"b": 1, "a": [1, 2.50, {"c": null}], "aa": true, "a": "dup"}'::jsonb;
+SELECT '  [ 1 , "two" , false, [] ]  '::jsonb;
+SELECT '{"a":{"b":{"c":[1.50,null]}}}'::jsonb;
+SELECT '"\u0041\"b\n\/"'::jsonb;
+SELECT 'null'::jsonb, '-1.5e2'::jsonb, '{}'::jsonb, '[]'::jsonb;
+SELECT '01'::jsonb;
+SELECT '[1,]'::jsonb;
+SELECT '{"a" 1}'::jsonb;
+SELECT '{"a": 1'::jsonb;
+SELECT '{1: 2}'::jsonb;
+SELECT 'nul'::jsonb;
+SELECT '"\u0000"'::jsonb;
+-- field and element access
+SELECT '{"a": {"b": [1, 2]}, "c": "x"}'::jsonb -> 'a';
+SELECT '{"a": {"b": [1, 2]}, "c": "x"}'::jsonb -> 'c',
+       '{"a": {"b": [1, 2]}, "c": "x"}'::jsonb ->> 'c',
+       '{"a": {"b": [1, 2]}, "c": "x"}'::jsonb -> 'zz';
+SELECT '{"a": {"b": [1, 2]}}'::jsonb -> 'a' -> 'b' ->> 1;
+SELECT '[1, "two", null]'::jsonb -> 1, '[1, "two", null]'::jsonb ->> 1,
+       '[1, "two", null]'::jsonb -> 2, '[1, "two", null]'::jsonb ->> 2,
+       '[1, "two", null]'::jsonb -> 3, '{"a": 1}'::jsonb -> 0;
+-- existence
+SELECT '{"a": 1, "b": {"c": 2}}'::jsonb ? 'a', '{"a": 1, "b": {"c": 2}}'::jsonb ? 'c';
+SELECT '["x", "y", 1]'::jsonb ? 'x', '["x", "y", 1]'::jsonb ? '1', '"x"'::jsonb ? 'x';
+SELECT '{"a": 1, "b": 2}'::jsonb ?| ARRAY['q', 'b'], '{"a": 1, "b": 2}'::jsonb ?| ARRAY['q'];
+SELECT '{"a": 1, "b": 2}'::jsonb ?& ARRAY['a', 'b'], '{"a": 1, "b": 2}'::jsonb ?& ARRAY['a', 'q'];
+-- containment
+SELECT '{"a": 1, "b": {"c": [1, 2, 3]}}'::jsonb @> '{"b": {"c": [3, 1]}}';
+SELECT '{"a": 1, "b": {"c": [1, 2, 3]}}'::jsonb @> '{"b": {"c": [4]}}';
+SELECT '{"a": [1, 2]}'::jsonb @> '{"a": 1}', '[1, 2, "x"]'::jsonb @> '"x"';
+SELECT '[1.0, 2]'::jsonb @> '[1]', '[[1, 2]]'::jsonb @> '[[2]]', '[{"a": 1}]'::jsonb @> '[[]]';
+SELECT '{"a": 1}'::jsonb <@ '{"a": 1, "b": 2}', '{"a": 1, "c": null}'::jsonb <@ '{"a": 1, "b": 2}';
+-- functions
+SELECT jsonb_typeof('{}'), jsonb_typeof('[]'), jsonb_typeof('"s"'),
+       jsonb_typeof('1'), jsonb_typeof('true'), jsonb_typeof('null');
+SELECT jsonb_array_length('[1, [2, 3], 4]');
+SELECT jsonb_array_length('{"a": 1}');
+SELECT jsonb_object_keys('{"bb": 1, "a": 2, "c": 3}');
+SELECT jsonb_object_keys('[1]');
+-- indexing
+CREATE TABLE testjsonb (j jsonb);
+INSERT INTO testjsonb
+SELECT ('{"id": ' || i || ', "tag": "t' || (i % 10) || '", "arr": [' || (i % 7) ||
+        '], "sub": {"k": ' || (i % 3) || '}}')::jsonb
+FROM generate_series(1, 1000) i;
+SELECT count(*) FROM testjsonb WHERE j @> '{"tag": "t3"}';
+SELECT count(*) FROM testjsonb WHERE j @> '{"sub": {"k": 1}}';
+SELECT count(*) FROM testjsonb WHERE j @> '{"arr": [5]}';
+SELECT count(*) FROM testjsonb WHERE j @> '{"tag": "t3", "sub": {"k": 0}}';
+SELECT count(*) FROM testjsonb WHERE j ? 'sub';
+SELECT count(*) FROM testjsonb WHERE j ? 'k';
+SELECT count(*) FROM testjsonb WHERE j ?| ARRAY['k', 'tag'];
+SELECT count(*) FROM testjsonb WHERE j ?& ARRAY['id', 'nope'];
+CREATE INDEX jidx ON testjsonb USING gin (j);
+SET enable_seqscan = off;
+SELECT count(*) FROM testjsonb WHERE j @> '{"tag": "t3"}';
+SELECT count(*) FROM testjsonb WHERE j @> '{"sub": {"k": 1}}';
+SELECT count(*) FROM testjsonb WHERE j @> '{"arr": [5]}';
+SELECT count(*) FROM testjsonb WHERE j @> '{"tag": "t3", "sub": {"k": 0}}';
+SELECT count(*) FROM testjsonb WHERE j ? 'sub';
+SELECT count(*) FROM testjsonb WHERE j ? 'k';
+SELECT count(*) FROM testjsonb WHERE j ?| ARRAY['k', 'tag'];
+SELECT count(*) FROM testjsonb WHERE j ?& ARRAY['id', 'nope'];
+RESET enable_seqscan;
+DROP TABLE testjsonb;
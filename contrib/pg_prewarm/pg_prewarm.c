@@ -0,0 +1,398 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_prewarm.c
+ *	  save the list of blocks in the shared buffer cache, and read them
+ *	  back in after a restart
+ *
+ * The list is a file of buffer tags, sorted so that reading the blocks back
+ * goes through each relation in physical order.  It is written by
+ * pg_prewarm_dump(), and, if the module is loaded via
+ * shared_preload_libraries, by the postmaster at a clean shutdown.
+ * pg_prewarm_load() reads the blocks of the list into shared buffers,
+ * prefetching a number of blocks ahead so that the kernel can keep several
+ * reads in flight.
+ *
+ * Blocks are read without going through the relation cache, so one call
+ * reloads the blocks of all databases.
+ *
+ *	  contrib/pg_prewarm/pg_prewarm.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+
+#include "miscadmin.h"
+#include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/ipc.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+
+
+PG_MODULE_MAGIC;
+
+/* Location of the block list, and a temporary file used while writing it */
+#define PREWARM_DUMP_FILE		"global/pg_prewarm.blocks"
+#define PREWARM_DUMP_TMP_FILE	PREWARM_DUMP_FILE ".tmp"
+
+/* Magic number identifying the block list file format */
+static const uint32 PREWARM_FILE_HEADER = 0x50575231;
+
+/*
+ * One entry of the block list.  This is written to the file as is, so the
+ * file is only good for the same server build, like everything else in the
+ * data directory.
+ */
+typedef struct PrewarmBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forkNum;
+	BlockNumber blockNum;
+} PrewarmBlock;
+
+/* GUC variables */
+static int	prewarm_prefetch_pages = 32;
+static bool prewarm_dump_at_shutdown = true;
+
+/* Saved hook values in case of unload */
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+void		_PG_init(void);
+void		_PG_fini(void);
+
+Datum		pg_prewarm_dump(PG_FUNCTION_ARGS);
+Datum		pg_prewarm_load(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(pg_prewarm_dump);
+PG_FUNCTION_INFO_V1(pg_prewarm_load);
+
+static void prewarm_shmem_startup(void);
+static void prewarm_shmem_shutdown(int code, Datum arg);
+static int64 dump_block_list(int elevel);
+static int	prewarm_block_cmp(const void *a, const void *b);
+
+
+/*
+ * Module load callback
+ */
+void
+_PG_init(void)
+{
+	DefineCustomIntVariable("pg_prewarm.prefetch_pages",
+							"Sets the number of blocks pg_prewarm_load() prefetches ahead of those it reads.",
+							"Zero disables prefetching.",
+							&prewarm_prefetch_pages,
+							32,
+							0,
+							1000,
+							PGC_SUSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pg_prewarm.dump_at_shutdown",
+				"Save the list of cached blocks when the server shuts down.",
+							 NULL,
+							 &prewarm_dump_at_shutdown,
+							 true,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	EmitWarningsOnPlaceholders("pg_prewarm");
+
+	/*
+	 * The dump at shutdown is done by the postmaster, so it only happens if
+	 * we're loaded via shared_preload_libraries.
+	 */
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	/*
+	 * Install hooks.
+	 */
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = prewarm_shmem_startup;
+}
+
+/*
+ * Module unload callback
+ */
+void
+_PG_fini(void)
+{
+	/* Uninstall hooks. */
+	shmem_startup_hook = prev_shmem_startup_hook;
+}
+
+/*
+ * shmem_startup hook: arrange for the postmaster to dump the block list
+ * at shutdown.
+ */
+static void
+prewarm_shmem_startup(void)
+{
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
+
+	/*
+	 * Register the shutdown hook only in the postmaster.  Doing it here,
+	 * after shared memory has been set up, makes it run before shared memory
+	 * is detached.
+	 */
+	if (!IsUnderPostmaster)
+		on_shmem_exit(prewarm_shmem_shutdown, (Datum) 0);
+}
+
+/*
+ * shmem_shutdown hook: dump the block list into the file.
+ */
+static void
+prewarm_shmem_shutdown(int code, Datum arg)
+{
+	/* Don't try to dump during a crash. */
+	if (code)
+		return;
+
+	/* Don't dump if told not to. */
+	if (!prewarm_dump_at_shutdown)
+		return;
+
+	(void) dump_block_list(LOG);
+}
+
+/*
+ * pg_prewarm_dump
+ *		Write the list of blocks now in shared buffers to the file, and
+ *		return the number of blocks listed.
+ */
+Datum
+pg_prewarm_dump(PG_FUNCTION_ARGS)
+{
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 (errmsg("must be superuser to use pg_prewarm functions"))));
+
+	PG_RETURN_INT64(dump_block_list(ERROR));
+}
+
+/*
+ * pg_prewarm_load
+ *		Read the blocks listed in the file into shared buffers, and return
+ *		the number of blocks read.
+ *
+ * Blocks of relations that have been dropped or truncated since the list
+ * was written are skipped.  At most shared_buffers blocks are read, since
+ * any more would just push out blocks we read earlier.
+ */
+Datum
+pg_prewarm_load(PG_FUNCTION_ARGS)
+{
+	FILE	   *file;
+	uint32		header;
+	int32		num;
+	PrewarmBlock *blocks;
+	int			nblocks;
+	int			i;
+	int			next_prefetch;
+	SMgrRelation smgr = NULL;
+	BlockNumber relsize = 0;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 (errmsg("must be superuser to use pg_prewarm functions"))));
+
+	file = AllocateFile(PREWARM_DUMP_FILE, PG_BINARY_R);
+	if (file == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m",
+						PREWARM_DUMP_FILE)));
+
+	if (fread(&header, sizeof(uint32), 1, file) != 1 ||
+		header != PREWARM_FILE_HEADER ||
+		fread(&num, sizeof(int32), 1, file) != 1 ||
+		num < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid block list file \"%s\"",
+						PREWARM_DUMP_FILE)));
+
+	num = Min(num, NBuffers);
+	blocks = (PrewarmBlock *) palloc(Max(num, 1) * sizeof(PrewarmBlock));
+	if (fread(blocks, sizeof(PrewarmBlock), num, file) != num)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid block list file \"%s\"",
+						PREWARM_DUMP_FILE)));
+
+	FreeFile(file);
+
+	/*
+	 * Weed out the blocks that no longer exist.  The list is sorted, so we
+	 * need to look up the size of each fork only once.
+	 */
+	nblocks = 0;
+	for (i = 0; i < num; i++)
+	{
+		PrewarmBlock *blk = &blocks[i];
+
+		if (i == 0 ||
+			!RelFileNodeEquals(blk->rnode, blocks[i - 1].rnode) ||
+			blk->forkNum != blocks[i - 1].forkNum)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			smgr = smgropen(blk->rnode, InvalidBackendId);
+			if (blk->forkNum >= 0 && blk->forkNum <= MAX_FORKNUM &&
+				smgrexists(smgr, blk->forkNum))
+				relsize = smgrnblocks(smgr, blk->forkNum);
+			else
+				relsize = 0;
+		}
+
+		if (blk->blockNum < relsize)
+			blocks[nblocks++] = *blk;
+	}
+
+	/*
+	 * Now read them.  Before reading each block, we ask the kernel to start
+	 * reading the ones up to pg_prewarm.prefetch_pages further on.
+	 */
+	next_prefetch = 0;
+	for (i = 0; i < nblocks; i++)
+	{
+		Buffer		buf;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (next_prefetch <= i)
+			next_prefetch = i + 1;
+		while (next_prefetch < nblocks &&
+			   next_prefetch <= i + prewarm_prefetch_pages)
+		{
+			PrewarmBlock *blk = &blocks[next_prefetch++];
+
+			smgrprefetch(smgropen(blk->rnode, InvalidBackendId),
+						 blk->forkNum, blk->blockNum);
+		}
+
+		buf = ReadBufferWithoutRelcache(blocks[i].rnode, blocks[i].forkNum,
+										blocks[i].blockNum, RBM_NORMAL, NULL);
+		ReleaseBuffer(buf);
+	}
+
+	pfree(blocks);
+
+	/* Don't hang on to file descriptors of other databases' relations */
+	smgrcloseall();
+
+	PG_RETURN_INT64((int64) nblocks);
+}
+
+/*
+ * Write the tags of the valid shared buffers to the block list file,
+ * replacing the old one, and return the number of blocks listed.
+ *
+ * This is also called by the postmaster at shutdown, so errors other than
+ * running out of memory are reported at elevel rather than thrown.
+ */
+static int64
+dump_block_list(int elevel)
+{
+	PrewarmBlock *blocks;
+	int			num = 0;
+	int			i;
+	FILE	   *file;
+
+	blocks = (PrewarmBlock *) palloc(NBuffers * sizeof(PrewarmBlock));
+
+	for (i = 0; i < NBuffers; i++)
+	{
+		volatile BufferDesc *bufHdr = &BufferDescriptors[i];
+
+		/* Lock each buffer header before inspecting it */
+		LockBufHdr(bufHdr);
+		if (bufHdr->flags & BM_VALID)
+		{
+			blocks[num].rnode = bufHdr->tag.rnode;
+			blocks[num].forkNum = bufHdr->tag.forkNum;
+			blocks[num].blockNum = bufHdr->tag.blockNum;
+			num++;
+		}
+		UnlockBufHdr(bufHdr);
+	}
+
+	/* Sort the list, so that loading it reads each relation in order */
+	qsort(blocks, num, sizeof(PrewarmBlock), prewarm_block_cmp);
+
+	file = AllocateFile(PREWARM_DUMP_TMP_FILE, PG_BINARY_W);
+	if (file == NULL)
+		goto error;
+
+	if (fwrite(&PREWARM_FILE_HEADER, sizeof(uint32), 1, file) != 1 ||
+		fwrite(&num, sizeof(int32), 1, file) != 1 ||
+		fwrite(blocks, sizeof(PrewarmBlock), num, file) != num)
+		goto error;
+
+	if (FreeFile(file))
+	{
+		file = NULL;
+		goto error;
+	}
+
+	if (rename(PREWARM_DUMP_TMP_FILE, PREWARM_DUMP_FILE) != 0)
+	{
+		file = NULL;
+		goto error;
+	}
+
+	pfree(blocks);
+
+	return (int64) num;
+
+error:
+	ereport(elevel,
+			(errcode_for_file_access(),
+			 errmsg("could not write block list file \"%s\": %m",
+					PREWARM_DUMP_FILE)));
+	if (file)
+		FreeFile(file);
+	unlink(PREWARM_DUMP_TMP_FILE);
+	pfree(blocks);
+
+	return 0;
+}
+
+/*
+ * qsort comparator for PrewarmBlocks: by tablespace, database, relation,
+ * fork and block number.
+ */
+static int
+prewarm_block_cmp(const void *a, const void *b)
+{
+	const PrewarmBlock *ba = (const PrewarmBlock *) a;
+	const PrewarmBlock *bb = (const PrewarmBlock *) b;
+
+	if (ba->rnode.spcNode != bb->rnode.spcNode)
+		return (ba->rnode.spcNode < bb->rnode.spcNode) ? -1 : 1;
+	if (ba->rnode.dbNode != bb->rnode.dbNode)
+		return (ba->rnode.dbNode < bb->rnode.dbNode) ? -1 : 1;
+	if (ba->rnode.relNode != bb->rnode.relNode)
+		return (ba->rnode.relNode < bb->rnode.relNode) ? -1 : 1;
+	if (ba->forkNum != bb->forkNum)
+		return (ba->forkNum < bb->forkNum) ? -1 : 1;
+	if (ba->blockNum != bb->blockNum)
+		return (ba->blockNum < bb->blockNum) ? -1 : 1;
+	return 0;
+}
@@ -1,4 +1,4 @@
-/* contrib/pg_stat_statements/pg_stat_statements--1.0.sql */
+/* contrib/pg_stat_statements/pg_stat_statements--1.1.sql */
 
 -- complain if script is sourced in psql, rather than via CREATE EXTENSION
 \echo Use "CREATE EXTENSION pg_stat_statements" to load this file. \quit
@@ -15,6 +15,12 @@ CREATE FUNCTION pg_stat_statements(
     OUT query text,
     OUT calls int8,
     OUT total_time float8,
+    OUT min_time float8,
+    OUT max_time float8,
+    OUT mean_time float8,
+    OUT stddev_time float8,
+    OUT plans int8,
+    OUT total_plan_time float8,
     OUT rows int8,
     OUT shared_blks_hit int8,
     OUT shared_blks_read int8,
@@ -23,7 +29,10 @@ CREATE FUNCTION pg_stat_statements(
     OUT local_blks_read int8,
     OUT local_blks_written int8,
     OUT temp_blks_read int8,
-    OUT temp_blks_written int8
+    OUT temp_blks_written int8,
+    OUT blk_read_time float8,
+    OUT blk_write_time float8,
+    OUT temp_files int8
 )
 RETURNS SETOF record
 AS 'MODULE_PATHNAME'
@@ -28,6 +28,8 @@
 #define DistanceStrategyNumber		2
 #define LikeStrategyNumber			3
 #define ILikeStrategyNumber			4
+#define RegExpStrategyNumber		5
+#define RegExpICaseStrategyNumber	6
 
 
 typedef char trgm[3];
@@ -51,6 +53,12 @@ uint32		trgm2int(trgm *ptr);
 #endif
 #define ISPRINTABLETRGM(t)	( ISPRINTABLECHAR( ((char*)(t)) ) && ISPRINTABLECHAR( ((char*)(t))+1 ) && ISPRINTABLECHAR( ((char*)(t))+2 ) )
 
+#ifdef KEEPONLYALNUM
+#define iswordchr(c)	(t_isalpha(c) || t_isdigit(c))
+#else
+#define iswordchr(c)	(!t_isspace(c))
+#endif
+
 #define ISESCAPECHAR(x) (*(x) == '\\')	/* Wildcard escape character */
 #define ISWILDCARDCHAR(x) (*(x) == '_' || *(x) == '%')	/* Wildcard
 														 * meta-character */
@@ -99,11 +107,18 @@ typedef char *BITVECP;
 #define GETARR(x)		( (trgm*)( (char*)x+TRGMHDRSIZE ) )
 #define ARRNELEM(x) ( ( VARSIZE(x) - TRGMHDRSIZE )/sizeof(trgm) )
 
+typedef struct TrgmPackedGraph TrgmPackedGraph;
+
 extern float4 trgm_limit;
 
+void		cnt_trigram(trgm *tptr, char *str, int bytelen);
 TRGM	   *generate_trgm(char *str, int slen);
 TRGM	   *generate_wildcard_trgm(const char *str, int slen);
 float4		cnt_sml(TRGM *trg1, TRGM *trg2);
 bool		trgm_contained_by(TRGM *trg1, TRGM *trg2);
+bool	   *trgm_presence_map(TRGM *query, TRGM *key);
+TRGM	   *createTrgmNFA(text *text_re, Oid collation,
+			  TrgmPackedGraph **graph, MemoryContext rcontext);
+bool		trigramsMatchGraph(TrgmPackedGraph *graph, bool *check);
 
 #endif   /* __TRGM_H__ */
@@ -0,0 +1,1208 @@
+/*-------------------------------------------------------------------------
+ *
+ * trgm_regexp.c
+ *	  Regular expression matching using trigrams.
+ *
+ * The general idea of trigram index support for a regular expression (regex)
+ * search is to transform the regex into a logical expression on trigrams.
+ * For example:
+ *
+ *	 (ab|cd)efg  =>  ((abe & bef) | (cde & def)) & efg
+ *
+ * If a string matches the regex, then it must match the logical expression
+ * on trigrams.  The opposite is not necessarily true, however: a string that
+ * matches the logical expression might not match the original regex.  Such
+ * false positives are removed via recheck, by running the regular regex
+ * match operator on the retrieved heap tuple.
+ *
+ * Rather than an explicit logical expression, we represent the condition as
+ * a graph whose arcs may be labeled with trigrams: a string can match the
+ * regex only if the graph's final state is reachable from its initial state
+ * along arcs whose trigrams all occur in the string.  The graph is built as
+ * follows:
+ *
+ * 1) Compile the regex to an NFA using the PostgreSQL regex library, and
+ *	  fetch its states, arcs and colors through regex/regexport.h.  A color
+ *	  is a set of characters that the regex treats alike.  We enumerate the
+ *	  characters of small colors; the characters of large colors, and of the
+ *	  "everything else" color, are treated as unknown.
+ *
+ * 2) Transform the NFA into an expanded graph.  Its states are pairs of an
+ *	  NFA state and a "prefix" made of the last two characters read, each
+ *	  represented by its color, or as "blank" if it was a non-word character
+ *	  (or the start of the string), or as "unknown".  Reading a word
+ *	  character when both prefix characters are known yields a trigram of
+ *	  colors ("color trigram") that labels the arc; so does reading a
+ *	  non-word character right after a word whose last two characters are
+ *	  known, since pg_trgm pads each word with a trailing blank.  Other
+ *	  transitions are unlabeled.  A state whose prefix is less specific
+ *	  than that of another state for the same NFA state can stand in for it,
+ *	  which keeps loops such as the implicit leading .* of the search NFA
+ *	  from multiplying states.
+ *
+ * 3) Count how many simple trigrams each color trigram stands for, and
+ *	  forget the most expensive color trigrams (treating their arcs as
+ *	  unlabeled) until the total is acceptable.
+ *
+ * 4) Expand the remaining color trigrams into the array of trigrams used
+ *	  for the index search, and pack the graph into a compact form that the
+ *	  consistent functions evaluate with a simple graph search.
+ *
+ * Every shortcut taken above only ever drops requirements, so the resulting
+ * condition may be weaker than the regex but never rejects a string that
+ * matches it.  If the expanded graph exceeds fixed limits, or if the final
+ * state can be reached without reading any trigram, we give up and tell the
+ * caller that the whole index has to be scanned.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  contrib/pg_trgm/trgm_regexp.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "trgm.h"
+
+#include "regex/regexport.h"
+#include "tsearch/ts_locale.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+
+/*
+ * Limits on the work we are willing to do for one regex.  If the expanded
+ * graph would need more than MAX_EXPANDED_STATES states or
+ * MAX_EXPANDED_ARCS arcs, we give up.  Color trigrams are dropped until no
+ * more than MAX_TRGM_COUNT simple trigrams remain.  Colors with more than
+ * MAX_COLOR_CHARS characters are treated as unknown characters.
+ */
+#define MAX_EXPANDED_STATES 128
+#define MAX_EXPANDED_ARCS	1024
+#define MAX_TRGM_COUNT		256
+#define MAX_COLOR_CHARS		256
+
+/* Special color numbers used in prefixes and color trigrams */
+#define COLOR_UNKNOWN	(-1)
+#define COLOR_BLANK		(-2)
+
+/* A character as it appears in trigrams, in the database encoding */
+typedef struct
+{
+	char		bytes[MAX_MULTIBYTE_CHAR_LEN];
+} trgm_mb_char;
+
+/* Information about one color of the regex */
+typedef struct
+{
+	bool		expandable;		/* did we enumerate its characters? */
+	bool		containsNonWord;	/* does it contain non-word characters? */
+	int			wordCharsCount; /* number of distinct word characters */
+	trgm_mb_char *wordChars;	/* the word characters, as in trigrams */
+} TrgmColorInfo;
+
+/* Key of an expanded graph state */
+typedef struct
+{
+	int			nstate;			/* NFA state number */
+	int			prefix[2];		/* last two colors read, or COLOR_XXX */
+} TrgmStateKey;
+
+/* Trigram of colors; colors[0] == COLOR_UNKNOWN means "no trigram" */
+typedef struct
+{
+	int			colors[3];
+} ColorTrgm;
+
+/* State of the expanded graph */
+typedef struct TrgmState
+{
+	TrgmStateKey key;			/* hashtable key: must be first */
+	bool		isFinal;		/* does it stand for the NFA final state? */
+	bool		visited;		/* workspace for graph searches */
+	int			snumber;		/* state number in the packed graph */
+	List	   *arcs;			/* list of TrgmArc */
+} TrgmState;
+
+/* Arc of the expanded graph */
+typedef struct
+{
+	ColorTrgm	ctrgm;			/* label, if any */
+	TrgmState  *target;
+} TrgmArc;
+
+/* Information about one distinct color trigram */
+typedef struct
+{
+	ColorTrgm	ctrgm;
+	int			count;			/* number of simple trigrams it stands for */
+	bool		expanded;		/* false if we chose to ignore it */
+	int			cnumber;		/* number among the expanded ones */
+} ColorTrgmInfo;
+
+/* Working state for the processing of one regex */
+typedef struct
+{
+	regex_t    *regex;
+	int			finalNState;	/* final state of the NFA */
+	int			ncolors;
+	TrgmColorInfo *colorInfo;	/* indexed by color number */
+
+	/* the expanded graph */
+	HTAB	   *states;
+	TrgmState  *initState;
+	List	   *queue;			/* states whose arcs remain to be added */
+	int			nstates;
+	int			narcs;
+	bool		overflowed;
+
+	/* the distinct color trigrams, sorted */
+	ColorTrgmInfo *colorTrgms;
+	int			colorTrgmsCount;
+	int			totalTrgmCount; /* simple trigrams of expanded ones */
+} TrgmNFA;
+
+/*
+ * Final, packed representation of the graph, produced by createTrgmNFA and
+ * evaluated by trigramsMatchGraph.
+ */
+typedef struct
+{
+	int			colorTrgm;		/* color trigram number, or -1 if none */
+	int			targetState;	/* packed state number */
+} TrgmPackedArc;
+
+typedef struct
+{
+	int			arcsCount;
+	TrgmPackedArc *arcs;
+	bool		isFinal;
+} TrgmPackedState;
+
+struct TrgmPackedGraph
+{
+	/*
+	 * colorTrigramGroups[i] is the number of simple trigrams that color
+	 * trigram i stands for; they are consecutive in the trigram array.
+	 */
+	int			colorTrigramsCount;
+	int		   *colorTrigramGroups;
+
+	/* the states; state 0 is the initial one */
+	int			statesCount;
+	TrgmPackedState *states;
+
+	/* workspace for trigramsMatchGraph() */
+	bool	   *colorTrigramsActive;
+	bool	   *statesActive;
+	int		   *statesQueue;
+};
+
+
+static TRGM *createTrgmNFAInternal(regex_t *regex, TrgmPackedGraph **graph,
+					  MemoryContext rcontext);
+static void RE_compile(regex_t *regex, text *text_re,
+		   int cflags, Oid collation);
+static void getColorInfo(regex_t *regex, TrgmNFA *trgmNFA);
+static bool convertPgWchar(pg_wchar c, trgm_mb_char *result, bool *isWord);
+static void transformGraph(TrgmNFA *trgmNFA);
+static void processState(TrgmNFA *trgmNFA, TrgmState *state);
+static void addBlankArc(TrgmNFA *trgmNFA, TrgmState *state, int nstate);
+static void addArc(TrgmNFA *trgmNFA, TrgmState *state, ColorTrgm *ctrgm,
+	   TrgmStateKey *destKey);
+static TrgmState *getState(TrgmNFA *trgmNFA, TrgmStateKey *key);
+static void selectColorTrigrams(TrgmNFA *trgmNFA);
+static ColorTrgmInfo *findColorTrgm(TrgmNFA *trgmNFA, ColorTrgm *ctrgm);
+static bool needsTrigrams(TrgmNFA *trgmNFA);
+static TRGM *expandColorTrigrams(TrgmNFA *trgmNFA, MemoryContext rcontext);
+static void fillTrgm(trgm *ptrgm, trgm_mb_char s[3]);
+static TrgmPackedGraph *packGraph(TrgmNFA *trgmNFA, MemoryContext rcontext);
+static int	colorTrgmCmp(const void *p1, const void *p2);
+
+
+/*
+ * Main entry point to process a regular expression.
+ *
+ * Returns an array of trigrams required by the regular expression, or NULL
+ * if the regular expression was too complex to analyze (or not selective at
+ * all), in which case the caller must scan the whole index.  Otherwise, a
+ * packed graph representation of the regex is returned into *graph.  The
+ * results are allocated in rcontext (which might or might not be the current
+ * context).
+ */
+TRGM *
+createTrgmNFA(text *text_re, Oid collation,
+			  TrgmPackedGraph **graph, MemoryContext rcontext)
+{
+	TRGM	   *trg;
+	regex_t		regex;
+	MemoryContext tmpcontext;
+	MemoryContext oldcontext;
+
+	/*
+	 * This processing generates a great deal of cruft, which we'd like to
+	 * clean up before returning (since this function may be called in a
+	 * query-lifespan memory context).  Make a temp context we can work in so
+	 * that cleanup is easy.
+	 */
+	tmpcontext = AllocSetContextCreate(CurrentMemoryContext,
+									   "createTrgmNFA temporary context",
+									   ALLOCSET_DEFAULT_MINSIZE,
+									   ALLOCSET_DEFAULT_INITSIZE,
+									   ALLOCSET_DEFAULT_MAXSIZE);
+	oldcontext = MemoryContextSwitchTo(tmpcontext);
+
+	/*
+	 * Compile the regex into an NFA.  With case-insensitive trigrams we may
+	 * as well compile it case-insensitively, which serves both ~ and ~*:
+	 * any string matching the case-sensitive regex matches this one too.
+	 */
+#ifdef IGNORECASE
+	RE_compile(&regex, text_re, REG_ADVANCED | REG_ICASE, collation);
+#else
+	RE_compile(&regex, text_re, REG_ADVANCED, collation);
+#endif
+
+	/*
+	 * Since the regexp library allocates its internal data structures with
+	 * malloc, we need to use a PG_TRY block to ensure that pg_regfree() gets
+	 * done even if there's an error.
+	 */
+	PG_TRY();
+	{
+		trg = createTrgmNFAInternal(&regex, graph, rcontext);
+	}
+	PG_CATCH();
+	{
+		pg_regfree(&regex);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	pg_regfree(&regex);
+
+	/* Clean up all the cruft we created */
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextDelete(tmpcontext);
+
+	return trg;
+}
+
+/*
+ * Body of createTrgmNFA, exclusive of regex compilation/freeing.
+ */
+static TRGM *
+createTrgmNFAInternal(regex_t *regex, TrgmPackedGraph **graph,
+					  MemoryContext rcontext)
+{
+	TrgmNFA		trgmNFA;
+
+	MemSet(&trgmNFA, 0, sizeof(trgmNFA));
+	trgmNFA.regex = regex;
+	trgmNFA.finalNState = pg_reg_getfinalstate(regex);
+
+	/* Stage 1: collect information about the regex's colors */
+	getColorInfo(regex, &trgmNFA);
+
+	/* Stage 2: build the expanded graph; give up if it's too big */
+	transformGraph(&trgmNFA);
+	if (trgmNFA.overflowed)
+		return NULL;
+
+	/*
+	 * Stage 3: choose the color trigrams to use.  If the final state can be
+	 * reached without reading any of them, the index can't help.
+	 */
+	selectColorTrigrams(&trgmNFA);
+	if (!needsTrigrams(&trgmNFA))
+		return NULL;
+
+	/* Stage 4: produce the trigram array and the packed graph */
+	*graph = packGraph(&trgmNFA, rcontext);
+	return expandColorTrigrams(&trgmNFA, rcontext);
+}
+
+/*
+ * Main entry point for evaluating a graph during index scanning.
+ *
+ * The check[] array is indexed by trigram number (in the array of simple
+ * trigrams returned by createTrgmNFA), and holds TRUE for those trigrams
+ * that are present in the index entry being checked.  A TRUE entry must be
+ * given for any trigram that might be present; since the graph search is
+ * monotone in check[], false positives there only cost precision.
+ */
+bool
+trigramsMatchGraph(TrgmPackedGraph *graph, bool *check)
+{
+	int			i,
+				j,
+				k,
+				queueIn,
+				queueOut;
+
+	/*
+	 * Reset temporary working areas.
+	 */
+	memset(graph->colorTrigramsActive, 0,
+		   sizeof(bool) * graph->colorTrigramsCount);
+	memset(graph->statesActive, 0, sizeof(bool) * graph->statesCount);
+
+	/*
+	 * Check which color trigrams were matched.  A match for any simple
+	 * trigram associated with a color trigram counts as a match of the color
+	 * trigram.
+	 */
+	j = 0;
+	for (i = 0; i < graph->colorTrigramsCount; i++)
+	{
+		int			cnt = graph->colorTrigramGroups[i];
+
+		for (k = j; k < j + cnt; k++)
+		{
+			if (check[k])
+			{
+				graph->colorTrigramsActive[i] = true;
+				break;
+			}
+		}
+		j += cnt;
+	}
+
+	/*
+	 * Search the graph, starting from the initial state and following only
+	 * unlabeled arcs and arcs whose color trigram was matched.  The queue
+	 * has room for statesCount entries, which is enough since no state is
+	 * queued twice; statesActive marks the queued states.
+	 */
+	graph->statesActive[0] = true;
+	graph->statesQueue[0] = 0;
+	queueIn = 0;
+	queueOut = 1;
+
+	while (queueIn < queueOut)
+	{
+		TrgmPackedState *state = &graph->states[graph->statesQueue[queueIn++]];
+
+		if (state->isFinal)
+			return true;
+
+		for (i = 0; i < state->arcsCount; i++)
+		{
+			TrgmPackedArc *arc = &state->arcs[i];
+
+			if (arc->colorTrgm >= 0 &&
+				!graph->colorTrigramsActive[arc->colorTrgm])
+				continue;
+			if (!graph->statesActive[arc->targetState])
+			{
+				graph->statesActive[arc->targetState] = true;
+				graph->statesQueue[queueOut++] = arc->targetState;
+			}
+		}
+	}
+
+	/* Final state is unreachable: the string can't match */
+	return false;
+}
+
+/*
+ * Compile regex string into struct at *regex.
+ * NB: pg_regfree must be applied to regex if this completes successfully.
+ */
+static void
+RE_compile(regex_t *regex, text *text_re, int cflags, Oid collation)
+{
+	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
+	char	   *text_re_val = VARDATA_ANY(text_re);
+	pg_wchar   *pattern;
+	int			pattern_len;
+	int			regcomp_result;
+	char		errMsg[100];
+
+	/* Convert pattern string to wide characters */
+	pattern = (pg_wchar *) palloc((text_re_len + 1) * sizeof(pg_wchar));
+	pattern_len = pg_mb2wchar_with_len(text_re_val,
+									   pattern,
+									   text_re_len);
+
+	/* Compile regex */
+	regcomp_result = pg_regcomp(regex,
+								pattern,
+								pattern_len,
+								cflags,
+								collation);
+
+	pfree(pattern);
+
+	if (regcomp_result != REG_OKAY)
+	{
+		/* re didn't compile (no need for pg_regfree, if so) */
+		pg_regerror(regcomp_result, regex, errMsg, sizeof(errMsg));
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_REGULAR_EXPRESSION),
+				 errmsg("invalid regular expression: %s", errMsg)));
+	}
+}
+
+
+/*---------------------
+ * Subroutines for pre-processing the color map (stage 1).
+ *---------------------
+ */
+
+/*
+ * Fill trgmNFA->colorInfo[] with info about the colors of the regex.
+ *
+ * Colors that we can't or won't enumerate are left non-expandable, meaning
+ * that we know nothing about the characters they stand for.
+ */
+static void
+getColorInfo(regex_t *regex, TrgmNFA *trgmNFA)
+{
+	int			colorsCount = pg_reg_getnumcolors(regex);
+	int			i;
+
+	trgmNFA->ncolors = colorsCount;
+	trgmNFA->colorInfo = (TrgmColorInfo *)
+		palloc0(colorsCount * sizeof(TrgmColorInfo));
+
+	for (i = 0; i < colorsCount; i++)
+	{
+		TrgmColorInfo *colorInfo = &trgmNFA->colorInfo[i];
+		int			charsCount = pg_reg_getnumcharacters(regex, i);
+		pg_wchar   *chars;
+		int			j;
+
+		/* Skip WHITE, pseudocolors, and colors too large to bother with */
+		if (charsCount <= 0 || charsCount > MAX_COLOR_CHARS)
+			continue;
+
+		chars = (pg_wchar *) palloc0(sizeof(pg_wchar) * charsCount);
+		pg_reg_getcharacters(regex, i, chars, charsCount);
+
+		colorInfo->wordChars = (trgm_mb_char *)
+			palloc(sizeof(trgm_mb_char) * charsCount);
+		colorInfo->expandable = true;
+
+		for (j = 0; j < charsCount; j++)
+		{
+			trgm_mb_char c;
+			bool		isWord;
+			int			k;
+
+			/* NUL can't appear in a text string, so it doesn't matter */
+			if (chars[j] == 0)
+				continue;
+
+			if (!convertPgWchar(chars[j], &c, &isWord))
+			{
+				/* can't tell how this character appears in trigrams */
+				colorInfo->expandable = false;
+				break;
+			}
+
+			if (!isWord)
+			{
+				colorInfo->containsNonWord = true;
+				continue;
+			}
+
+			/* Case folding can map several characters to the same one */
+			for (k = 0; k < colorInfo->wordCharsCount; k++)
+			{
+				if (memcmp(&colorInfo->wordChars[k], &c,
+						   sizeof(trgm_mb_char)) == 0)
+					break;
+			}
+			if (k == colorInfo->wordCharsCount)
+				colorInfo->wordChars[colorInfo->wordCharsCount++] = c;
+		}
+
+		pfree(chars);
+	}
+}
+
+/*
+ * Convert a character from the regex's pg_wchar representation to the form
+ * it takes in trigrams: the database encoding, lowercased if trigrams are
+ * case-insensitive.  *isWord is set to whether it is a word character; only
+ * word characters are part of trigrams, and *result is only filled for
+ * them.
+ *
+ * Returns false if the character can't be converted.
+ */
+static bool
+convertPgWchar(pg_wchar c, trgm_mb_char *result, bool *isWord)
+{
+	/* "s" has enough space for a multibyte character and a trailing NUL */
+	char		s[MAX_MULTIBYTE_CHAR_LEN + 1];
+	int			len;
+
+	MemSet(s, 0, sizeof(s));
+	len = pg_wchar2mb_with_len(&c, s, 1);
+	if (len <= 0 || len > MAX_MULTIBYTE_CHAR_LEN || pg_mblen(s) != len)
+		return false;
+
+#ifndef USE_WIDE_UPPER_LOWER
+	/* without wide-character support, trigrams are made of bytes */
+	if (len > 1)
+		return false;
+#endif
+
+	*isWord = iswordchr(s);
+	if (!*isWord)
+		return true;
+
+#ifdef IGNORECASE
+	{
+		char	   *lowerCased = lowerstr(s);
+		int			lowerLen = strlen(lowerCased);
+
+		/* Lower-casing must give exactly one character */
+		if (lowerLen <= 0 || lowerLen > MAX_MULTIBYTE_CHAR_LEN ||
+			pg_mblen(lowerCased) != lowerLen)
+		{
+			pfree(lowerCased);
+			return false;
+		}
+		MemSet(s, 0, sizeof(s));
+		memcpy(s, lowerCased, lowerLen);
+		pfree(lowerCased);
+	}
+#endif
+
+	memcpy(result->bytes, s, MAX_MULTIBYTE_CHAR_LEN);
+	return true;
+}
+
+
+/*---------------------
+ * Subroutines for expanding the original NFA graph into a trigram graph
+ * (stage 2).
+ *---------------------
+ */
+
+/*
+ * Build the expanded graph, starting from the initial NFA state with
+ * nothing known about the preceding characters.
+ */
+static void
+transformGraph(TrgmNFA *trgmNFA)
+{
+	HASHCTL		hashCtl;
+	TrgmStateKey initkey;
+
+	MemSet(&hashCtl, 0, sizeof(hashCtl));
+	hashCtl.keysize = sizeof(TrgmStateKey);
+	hashCtl.entrysize = sizeof(TrgmState);
+	hashCtl.hcxt = CurrentMemoryContext;
+	hashCtl.hash = tag_hash;
+	trgmNFA->states = hash_create("Trigram NFA",
+								  MAX_EXPANDED_STATES,
+								  &hashCtl,
+								  HASH_ELEM | HASH_CONTEXT | HASH_FUNCTION);
+
+	MemSet(&initkey, 0, sizeof(initkey));
+	initkey.nstate = pg_reg_getinitialstate(trgmNFA->regex);
+	initkey.prefix[0] = COLOR_UNKNOWN;
+	initkey.prefix[1] = COLOR_UNKNOWN;
+	trgmNFA->initState = getState(trgmNFA, &initkey);
+
+	/* Add the out-arcs of queued states, until done or too big */
+	while (trgmNFA->queue != NIL && !trgmNFA->overflowed)
+	{
+		TrgmState  *state = (TrgmState *) linitial(trgmNFA->queue);
+
+		trgmNFA->queue = list_delete_first(trgmNFA->queue);
+		processState(trgmNFA, state);
+	}
+}
+
+/*
+ * Add the out-arcs of an expanded graph state, following the out-arcs of
+ * its NFA state.
+ */
+static void
+processState(TrgmNFA *trgmNFA, TrgmState *state)
+{
+	int			p0 = state->key.prefix[0];
+	int			p1 = state->key.prefix[1];
+	regex_arc_t *arcs;
+	int			arcsCount;
+	int			i;
+
+	arcsCount = pg_reg_getnumoutarcs(trgmNFA->regex, state->key.nstate);
+	if (arcsCount <= 0)
+		return;
+	arcs = (regex_arc_t *) palloc(sizeof(regex_arc_t) * arcsCount);
+	pg_reg_getoutarcs(trgmNFA->regex, state->key.nstate, arcs, arcsCount);
+
+	for (i = 0; i < arcsCount && !trgmNFA->overflowed; i++)
+	{
+		regex_arc_t *arc = &arcs[i];
+		TrgmStateKey destKey;
+
+		MemSet(&destKey, 0, sizeof(destKey));
+		destKey.nstate = arc->to;
+
+		if (arc->co >= trgmNFA->ncolors)
+		{
+			/* Lookahead constraint: reads nothing, so nothing changes */
+			destKey.prefix[0] = p0;
+			destKey.prefix[1] = p1;
+			addArc(trgmNFA, state, NULL, &destKey);
+		}
+		else if (pg_reg_colorisbegin(trgmNFA->regex, arc->co))
+		{
+			/*
+			 * Start of string, or of line (after a newline, which is a
+			 * non-word character): a new word starts with padding blanks.
+			 */
+			destKey.prefix[0] = COLOR_BLANK;
+			destKey.prefix[1] = COLOR_BLANK;
+			addArc(trgmNFA, state, NULL, &destKey);
+		}
+		else if (pg_reg_colorisend(trgmNFA->regex, arc->co))
+		{
+			/* End of string or line: ends the word like a non-word char */
+			addBlankArc(trgmNFA, state, arc->to);
+		}
+		else if (!trgmNFA->colorInfo[arc->co].expandable)
+		{
+			/* Could be any character: forget what we knew */
+			destKey.prefix[0] = COLOR_UNKNOWN;
+			destKey.prefix[1] = COLOR_UNKNOWN;
+			addArc(trgmNFA, state, NULL, &destKey);
+		}
+		else
+		{
+			TrgmColorInfo *colorInfo = &trgmNFA->colorInfo[arc->co];
+
+			/*
+			 * The color's word characters extend the current word, giving a
+			 * trigram if the two preceding characters are known.
+			 */
+			if (colorInfo->wordCharsCount > 0)
+			{
+				destKey.prefix[0] = p1;
+				destKey.prefix[1] = arc->co;
+				if (p0 != COLOR_UNKNOWN && p1 != COLOR_UNKNOWN)
+				{
+					ColorTrgm	ctrgm;
+
+					ctrgm.colors[0] = p0;
+					ctrgm.colors[1] = p1;
+					ctrgm.colors[2] = arc->co;
+					addArc(trgmNFA, state, &ctrgm, &destKey);
+				}
+				else
+					addArc(trgmNFA, state, NULL, &destKey);
+			}
+
+			/* Its non-word characters, if any, end the word */
+			if (colorInfo->containsNonWord)
+				addBlankArc(trgmNFA, state, arc->to);
+		}
+	}
+
+	pfree(arcs);
+}
+
+/*
+ * Add an arc from "state" to NFA state "nstate" for reading a non-word
+ * character (or reaching the end of the string or line).
+ *
+ * That ends the current word, if any.  Since words are padded with a blank
+ * at the end, that gives a trigram if the word's last two characters are
+ * known.  In any case the next word starts with padding blanks.
+ */
+static void
+addBlankArc(TrgmNFA *trgmNFA, TrgmState *state, int nstate)
+{
+	int			p0 = state->key.prefix[0];
+	int			p1 = state->key.prefix[1];
+	TrgmStateKey destKey;
+
+	MemSet(&destKey, 0, sizeof(destKey));
+	destKey.nstate = nstate;
+	destKey.prefix[0] = COLOR_BLANK;
+	destKey.prefix[1] = COLOR_BLANK;
+
+	/* p1 is a color only if the preceding character was a word character */
+	if (p0 != COLOR_UNKNOWN && p1 >= 0)
+	{
+		ColorTrgm	ctrgm;
+
+		ctrgm.colors[0] = p0;
+		ctrgm.colors[1] = p1;
+		ctrgm.colors[2] = COLOR_BLANK;
+		addArc(trgmNFA, state, &ctrgm, &destKey);
+	}
+	else
+		addArc(trgmNFA, state, NULL, &destKey);
+}
+
+/*
+ * Add an arc from "state" to the state for destKey, labeled with *ctrgm
+ * (NULL for an unlabeled arc).
+ */
+static void
+addArc(TrgmNFA *trgmNFA, TrgmState *state, ColorTrgm *ctrgm,
+	   TrgmStateKey *destKey)
+{
+	TrgmState  *target = getState(trgmNFA, destKey);
+	ColorTrgm	label;
+	TrgmArc    *arc;
+	ListCell   *cell;
+
+	/* An unlabeled arc to the same state is pointless */
+	if (target == state && ctrgm == NULL)
+		return;
+
+	if (ctrgm)
+		label = *ctrgm;
+	else
+	{
+		label.colors[0] = COLOR_UNKNOWN;
+		label.colors[1] = COLOR_UNKNOWN;
+		label.colors[2] = COLOR_UNKNOWN;
+	}
+
+	/* Don't add duplicate arcs */
+	foreach(cell, state->arcs)
+	{
+		arc = (TrgmArc *) lfirst(cell);
+		if (arc->target == target &&
+			memcmp(&arc->ctrgm, &label, sizeof(ColorTrgm)) == 0)
+			return;
+	}
+
+	arc = (TrgmArc *) palloc(sizeof(TrgmArc));
+	arc->ctrgm = label;
+	arc->target = target;
+	state->arcs = lappend(state->arcs, arc);
+
+	if (++trgmNFA->narcs > MAX_EXPANDED_ARCS)
+		trgmNFA->overflowed = true;
+}
+
+/*
+ * Get the expanded graph state for the given key, creating and queuing it
+ * if needed.
+ *
+ * If a state exists for the same NFA state with a less specific prefix, we
+ * return that one instead: whatever can be reached from the requested state
+ * can be reached from it too, without requiring more trigrams.
+ */
+static TrgmState *
+getState(TrgmNFA *trgmNFA, TrgmStateKey *key)
+{
+	TrgmState  *state;
+	TrgmStateKey generalKey;
+	bool		found;
+
+	state = (TrgmState *) hash_search(trgmNFA->states, key, HASH_FIND, NULL);
+	if (state)
+		return state;
+
+	MemSet(&generalKey, 0, sizeof(generalKey));
+	generalKey.nstate = key->nstate;
+	generalKey.prefix[0] = COLOR_UNKNOWN;
+	generalKey.prefix[1] = COLOR_UNKNOWN;
+	state = (TrgmState *) hash_search(trgmNFA->states, &generalKey,
+									  HASH_FIND, NULL);
+	if (state)
+		return state;
+
+	if (key->prefix[0] != COLOR_UNKNOWN && key->prefix[1] != COLOR_UNKNOWN)
+	{
+		generalKey.prefix[1] = key->prefix[1];
+		state = (TrgmState *) hash_search(trgmNFA->states, &generalKey,
+										  HASH_FIND, NULL);
+		if (state)
+			return state;
+	}
+
+	/* Need a new state */
+	state = (TrgmState *) hash_search(trgmNFA->states, key,
+									  HASH_ENTER, &found);
+	Assert(!found);
+	state->isFinal = (key->nstate == trgmNFA->finalNState);
+	state->visited = false;
+	state->snumber = -1;
+	state->arcs = NIL;
+
+	if (++trgmNFA->nstates > MAX_EXPANDED_STATES)
+		trgmNFA->overflowed = true;
+
+	/* The final state has no out-arcs worth following */
+	if (!state->isFinal)
+		trgmNFA->queue = lappend(trgmNFA->queue, state);
+
+	return state;
+}
+
+
+/*---------------------
+ * Subroutines for choosing the color trigrams to use (stage 3).
+ *---------------------
+ */
+
+/*
+ * Collect the distinct color trigrams labeling arcs of the expanded graph,
+ * and decide which ones to expand into simple trigrams.
+ *
+ * Color trigrams that stand for the most simple trigrams are dropped first,
+ * until the rest fit in MAX_TRGM_COUNT.  Arcs labeled with a dropped color
+ * trigram are then treated as unlabeled, which only weakens the condition.
+ */
+static void
+selectColorTrigrams(TrgmNFA *trgmNFA)
+{
+	HASH_SEQ_STATUS scan_status;
+	TrgmState  *state;
+	ColorTrgmInfo *colorTrgms;
+	int			count = 0;
+	int64		total = 0;
+	int			cnumber;
+	int			i,
+				j;
+
+	colorTrgms = (ColorTrgmInfo *)
+		palloc(sizeof(ColorTrgmInfo) * Max(trgmNFA->narcs, 1));
+
+	hash_seq_init(&scan_status, trgmNFA->states);
+	while ((state = (TrgmState *) hash_seq_search(&scan_status)) != NULL)
+	{
+		ListCell   *cell;
+
+		foreach(cell, state->arcs)
+		{
+			TrgmArc    *arc = (TrgmArc *) lfirst(cell);
+
+			if (arc->ctrgm.colors[0] != COLOR_UNKNOWN)
+				colorTrgms[count++].ctrgm = arc->ctrgm;
+		}
+	}
+
+	/* Sort and remove duplicates */
+	if (count > 1)
+	{
+		qsort(colorTrgms, count, sizeof(ColorTrgmInfo), colorTrgmCmp);
+		for (i = 1, j = 1; i < count; i++)
+		{
+			if (colorTrgmCmp(&colorTrgms[i], &colorTrgms[j - 1]) != 0)
+				colorTrgms[j++] = colorTrgms[i];
+		}
+		count = j;
+	}
+
+	/* Count the simple trigrams each one stands for */
+	for (i = 0; i < count; i++)
+	{
+		ColorTrgmInfo *colorTrgm = &colorTrgms[i];
+
+		colorTrgm->count = 1;
+		for (j = 0; j < 3; j++)
+		{
+			int			c = colorTrgm->ctrgm.colors[j];
+
+			if (c != COLOR_BLANK)
+				colorTrgm->count *= trgmNFA->colorInfo[c].wordCharsCount;
+		}
+		colorTrgm->expanded = true;
+		total += colorTrgm->count;
+	}
+
+	/* Drop the most expensive ones until the rest is small enough */
+	while (total > MAX_TRGM_COUNT)
+	{
+		ColorTrgmInfo *worst = NULL;
+
+		for (i = 0; i < count; i++)
+		{
+			if (colorTrgms[i].expanded &&
+				(worst == NULL || colorTrgms[i].count > worst->count))
+				worst = &colorTrgms[i];
+		}
+		Assert(worst != NULL);
+		worst->expanded = false;
+		total -= worst->count;
+	}
+
+	/* Number the survivors */
+	cnumber = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (colorTrgms[i].expanded)
+			colorTrgms[i].cnumber = cnumber++;
+		else
+			colorTrgms[i].cnumber = -1;
+	}
+
+	trgmNFA->colorTrgms = colorTrgms;
+	trgmNFA->colorTrgmsCount = count;
+	trgmNFA->totalTrgmCount = (int) total;
+}
+
+/*
+ * Find the info about a color trigram, which must exist.
+ */
+static ColorTrgmInfo *
+findColorTrgm(TrgmNFA *trgmNFA, ColorTrgm *ctrgm)
+{
+	ColorTrgmInfo key;
+	ColorTrgmInfo *result;
+
+	key.ctrgm = *ctrgm;
+	result = (ColorTrgmInfo *) bsearch(&key, trgmNFA->colorTrgms,
+									   trgmNFA->colorTrgmsCount,
+									   sizeof(ColorTrgmInfo),
+									   colorTrgmCmp);
+	Assert(result != NULL);
+	return result;
+}
+
+/*
+ * Does reaching the final state of the expanded graph require reading any
+ * of the expanded color trigrams?
+ */
+static bool
+needsTrigrams(TrgmNFA *trgmNFA)
+{
+	List	   *queue;
+
+	trgmNFA->initState->visited = true;
+	queue = list_make1(trgmNFA->initState);
+
+	while (queue != NIL)
+	{
+		TrgmState  *state = (TrgmState *) linitial(queue);
+		ListCell   *cell;
+
+		queue = list_delete_first(queue);
+		if (state->isFinal)
+			return false;
+
+		foreach(cell, state->arcs)
+		{
+			TrgmArc    *arc = (TrgmArc *) lfirst(cell);
+
+			if (arc->target->visited)
+				continue;
+			if (arc->ctrgm.colors[0] != COLOR_UNKNOWN &&
+				findColorTrgm(trgmNFA, &arc->ctrgm)->expanded)
+				continue;
+			arc->target->visited = true;
+			queue = lappend(queue, arc->target);
+		}
+	}
+
+	return true;
+}
+
+
+/*---------------------
+ * Subroutines for expanding color trigrams into regular trigrams and
+ * packing the graph (stage 4).
+ *---------------------
+ */
+
+/*
+ * Expand the selected color trigrams into an array of simple trigrams,
+ * ordered by color trigram number.
+ */
+static TRGM *
+expandColorTrigrams(TrgmNFA *trgmNFA, MemoryContext rcontext)
+{
+	TRGM	   *trg;
+	trgm	   *p;
+	trgm_mb_char blankChar;
+	int			i;
+
+	trg = (TRGM *) MemoryContextAllocZero(rcontext,
+										  TRGMHDRSIZE +
+										  trgmNFA->totalTrgmCount * sizeof(trgm));
+	trg->flag = ARRKEY;
+	SET_VARSIZE(trg, CALCGTSIZE(ARRKEY, trgmNFA->totalTrgmCount));
+	p = GETARR(trg);
+
+	MemSet(&blankChar, 0, sizeof(blankChar));
+	blankChar.bytes[0] = ' ';
+
+	for (i = 0; i < trgmNFA->colorTrgmsCount; i++)
+	{
+		ColorTrgmInfo *colorTrgm = &trgmNFA->colorTrgms[i];
+		trgm_mb_char *chars[3];
+		int			counts[3];
+		trgm_mb_char s[3];
+		int			i1,
+					i2,
+					i3,
+					j;
+
+		if (!colorTrgm->expanded)
+			continue;
+
+		for (j = 0; j < 3; j++)
+		{
+			int			c = colorTrgm->ctrgm.colors[j];
+
+			if (c == COLOR_BLANK)
+			{
+				chars[j] = &blankChar;
+				counts[j] = 1;
+			}
+			else
+			{
+				chars[j] = trgmNFA->colorInfo[c].wordChars;
+				counts[j] = trgmNFA->colorInfo[c].wordCharsCount;
+			}
+		}
+
+		/* Iterate over all combinations of the colors' characters */
+		for (i1 = 0; i1 < counts[0]; i1++)
+		{
+			s[0] = chars[0][i1];
+			for (i2 = 0; i2 < counts[1]; i2++)
+			{
+				s[1] = chars[1][i2];
+				for (i3 = 0; i3 < counts[2]; i3++)
+				{
+					s[2] = chars[2][i3];
+					fillTrgm(p, s);
+					p++;
+				}
+			}
+		}
+	}
+
+	Assert(p - GETARR(trg) == trgmNFA->totalTrgmCount);
+
+	return trg;
+}
+
+/*
+ * Convert trigram of characters into trgm datatype, the same way
+ * generate_trgm does.
+ */
+static void
+fillTrgm(trgm *ptrgm, trgm_mb_char s[3])
+{
+	char		str[3 * MAX_MULTIBYTE_CHAR_LEN],
+			   *p;
+	int			i,
+				j;
+
+	/* Write the characters contiguously */
+	p = str;
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < MAX_MULTIBYTE_CHAR_LEN && s[i].bytes[j]; j++)
+			*p++ = s[i].bytes[j];
+	}
+
+	cnt_trigram(ptrgm, str, p - str);
+}
+
+/*
+ * Pack the expanded graph into its final representation, allocated in
+ * rcontext.
+ */
+static TrgmPackedGraph *
+packGraph(TrgmNFA *trgmNFA, MemoryContext rcontext)
+{
+	TrgmPackedGraph *result;
+	HASH_SEQ_STATUS scan_status;
+	TrgmState  *state;
+	int			snumber;
+	int			i;
+
+	/* Number the states, the initial one first */
+	trgmNFA->initState->snumber = 0;
+	snumber = 1;
+	hash_seq_init(&scan_status, trgmNFA->states);
+	while ((state = (TrgmState *) hash_seq_search(&scan_status)) != NULL)
+	{
+		if (state != trgmNFA->initState)
+			state->snumber = snumber++;
+	}
+	Assert(snumber == trgmNFA->nstates);
+
+	result = (TrgmPackedGraph *)
+		MemoryContextAlloc(rcontext, sizeof(TrgmPackedGraph));
+
+	/* Color trigram groups, in color trigram number order */
+	result->colorTrigramsCount = 0;
+	result->colorTrigramGroups = (int *)
+		MemoryContextAlloc(rcontext,
+						   sizeof(int) * Max(trgmNFA->colorTrgmsCount, 1));
+	for (i = 0; i < trgmNFA->colorTrgmsCount; i++)
+	{
+		if (trgmNFA->colorTrgms[i].expanded)
+			result->colorTrigramGroups[result->colorTrigramsCount++] =
+				trgmNFA->colorTrgms[i].count;
+	}
+
+	/* The states and their arcs */
+	result->statesCount = trgmNFA->nstates;
+	result->states = (TrgmPackedState *)
+		MemoryContextAlloc(rcontext,
+						   sizeof(TrgmPackedState) * trgmNFA->nstates);
+	hash_seq_init(&scan_status, trgmNFA->states);
+	while ((state = (TrgmState *) hash_seq_search(&scan_status)) != NULL)
+	{
+		TrgmPackedState *pstate = &result->states[state->snumber];
+		ListCell   *cell;
+		int			narcs = 0;
+
+		pstate->isFinal = state->isFinal;
+		pstate->arcs = (TrgmPackedArc *)
+			MemoryContextAlloc(rcontext,
+						  sizeof(TrgmPackedArc) * Max(list_length(state->arcs), 1));
+
+		foreach(cell, state->arcs)
+		{
+			TrgmArc    *arc = (TrgmArc *) lfirst(cell);
+			TrgmPackedArc *parc = &pstate->arcs[narcs++];
+
+			parc->targetState = arc->target->snumber;
+			if (arc->ctrgm.colors[0] != COLOR_UNKNOWN)
+				parc->colorTrgm = findColorTrgm(trgmNFA, &arc->ctrgm)->cnumber;
+			else
+				parc->colorTrgm = -1;
+		}
+		pstate->arcsCount = narcs;
+	}
+
+	/* Workspace for trigramsMatchGraph() */
+	result->colorTrigramsActive = (bool *)
+		MemoryContextAlloc(rcontext,
+						   sizeof(bool) * Max(result->colorTrigramsCount, 1));
+	result->statesActive = (bool *)
+		MemoryContextAlloc(rcontext, sizeof(bool) * result->statesCount);
+	result->statesQueue = (int *)
+		MemoryContextAlloc(rcontext, sizeof(int) * result->statesCount);
+
+	return result;
+}
+
+/*
+ * Comparison function for sorting color trigrams.
+ */
+static int
+colorTrgmCmp(const void *p1, const void *p2)
+{
+	const ColorTrgmInfo *c1 = (const ColorTrgmInfo *) p1;
+	const ColorTrgmInfo *c2 = (const ColorTrgmInfo *) p2;
+	int			i;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (c1->ctrgm.colors[i] != c2->ctrgm.colors[i])
+			return (c1->ctrgm.colors[i] < c2->ctrgm.colors[i]) ? -1 : 1;
+	}
+	return 0;
+}
@@ -15,29 +15,59 @@
 void
 generate_old_dump(void)
 {
-	/* run new pg_dumpall binary */
+	int			dbnum;
+
+	/* run new pg_dumpall binary for globals and database creation */
 	prep_status("Creating catalog dump");
 
 	/*
 	 * --binary-upgrade records the width of dropped columns in pg_class, and
-	 * restores the frozenid's for databases and relations.
+	 * restores the frozenid's for databases and relations.  It also makes
+	 * --globals-only include the CREATE DATABASE commands.
 	 */
 	exec_prog(true,
 			  SYSTEMQUOTE "\"%s/pg_dumpall\" --port %d --username \"%s\" "
-			  "--schema-only --binary-upgrade > \"%s/" ALL_DUMP_FILE "\""
+			  "--schema-only --globals-only --binary-upgrade "
+			  "> \"%s/" ALL_DUMP_FILE "\""
 			  SYSTEMQUOTE, new_cluster.bindir, old_cluster.port, os_info.user, os_info.cwd);
 	check_ok();
+
+	/*
+	 * Dump the schema of each database separately, so that they can be
+	 * dumped, and later restored, several at a time.
+	 */
+	prep_status("Creating database schema dumps\n");
+
+	for (dbnum = 0; dbnum < old_cluster.dbarr.ndbs; dbnum++)
+	{
+		DbInfo	   *old_db = &old_cluster.dbarr.dbs[dbnum];
+
+		pg_log(PG_REPORT, OVERWRITE_MESSAGE, old_db->db_name);
+
+		parallel_exec_prog(SYSTEMQUOTE "\"%s/pg_dump\" --port %d --username \"%s\" "
+						   "--schema-only --binary-upgrade --format=custom "
+						   "--file=\"%s/" DB_DUMP_FILE_MASK "\" \"%s\""
+						   SYSTEMQUOTE, new_cluster.bindir, old_cluster.port,
+						   os_info.user, os_info.cwd, old_db->db_oid,
+						   old_db->db_name);
+	}
+
+	/* wait for all dumps to finish */
+	while (reap_child(true))
+		;
+
+	prep_status(" ");			/* in case nothing printed; pass a space so gcc
+								 * doesn't complain about empty format
+								 * string */
+	check_ok();
 }
 
 
 /*
  *	split_old_dump
  *
- *	This function splits pg_dumpall output into global values and
- *	database creation, and per-db schemas.	This allows us to create
- *	the support functions between restoring these two parts of the
- *	dump.  We split on the first "\connect " after a CREATE ROLE
- *	username match;  this is where the per-db restore starts.
+ *	This function copies the pg_dumpall output of global values and
+ *	database creation into the file we restore it from.
  *
  *	We suppress recreation of our own username so we don't generate
  *	an error during restore
@@ -46,15 +76,12 @@ void
 split_old_dump(void)
 {
 	FILE	   *all_dump,
-			   *globals_dump,
-			   *db_dump;
-	FILE	   *current_output;
+			   *globals_dump;
 	char		line[LINE_ALLOC];
 	bool		start_of_line = true;
 	char		create_role_str[MAX_STRING];
 	char		create_role_str_quote[MAX_STRING];
 	char		filename[MAXPGPATH];
-	bool		suppressed_username = false;
 
 	snprintf(filename, sizeof(filename), "%s/%s", os_info.cwd, ALL_DUMP_FILE);
 	if ((all_dump = fopen(filename, "r")) == NULL)
@@ -62,10 +89,6 @@ split_old_dump(void)
 	snprintf(filename, sizeof(filename), "%s/%s", os_info.cwd, GLOBALS_DUMP_FILE);
 	if ((globals_dump = fopen(filename, "w")) == NULL)
 		pg_log(PG_FATAL, "Could not write to dump file \"%s\": %s\n", filename, getErrorText(errno));
-	snprintf(filename, sizeof(filename), "%s/%s", os_info.cwd, DB_DUMP_FILE);
-	if ((db_dump = fopen(filename, "w")) == NULL)
-		pg_log(PG_FATAL, "Could not write to dump file \"%s\": %s\n", filename, getErrorText(errno));
-	current_output = globals_dump;
 
 	/* patterns used to prevent our own username from being recreated */
 	snprintf(create_role_str, sizeof(create_role_str),
@@ -75,19 +98,11 @@ split_old_dump(void)
 
 	while (fgets(line, sizeof(line), all_dump) != NULL)
 	{
-		/* switch to db_dump file output? */
-		if (current_output == globals_dump && start_of_line &&
-			suppressed_username &&
-			strncmp(line, "\\connect ", strlen("\\connect ")) == 0)
-			current_output = db_dump;
-
 		/* output unless we are recreating our own username */
-		if (current_output != globals_dump || !start_of_line ||
+		if (!start_of_line ||
 			(strncmp(line, create_role_str, strlen(create_role_str)) != 0 &&
 			 strncmp(line, create_role_str_quote, strlen(create_role_str_quote)) != 0))
-			fputs(line, current_output);
-		else
-			suppressed_username = true;
+			fputs(line, globals_dump);
 
 		if (strlen(line) > 0 && line[strlen(line) - 1] == '\n')
 			start_of_line = true;
@@ -97,5 +112,4 @@ split_old_dump(void)
 
 	fclose(all_dump);
 	fclose(globals_dump);
-	fclose(db_dump);
 }
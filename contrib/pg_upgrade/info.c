@@ -100,6 +100,8 @@ create_rel_filename_map(const char *old_data, const char *new_data,
 		 * relation belongs to the default tablespace, hence relfiles should
 		 * exist in the data directories.
 		 */
+		snprintf(map->old_tablespace, sizeof(map->old_tablespace), "%s",
+				 old_data);
 		snprintf(map->old_dir, sizeof(map->old_dir), "%s/base/%u", old_data,
 				 old_db->db_oid);
 		snprintf(map->new_dir, sizeof(map->new_dir), "%s/base/%u", new_data,
@@ -108,6 +110,8 @@ create_rel_filename_map(const char *old_data, const char *new_data,
 	else
 	{
 		/* relation belongs to a tablespace, so use the tablespace location */
+		snprintf(map->old_tablespace, sizeof(map->old_tablespace), "%s",
+				 old_rel->tablespace);
 		snprintf(map->old_dir, sizeof(map->old_dir), "%s%s/%u", old_rel->tablespace,
 				 old_cluster.tablespace_suffix, old_db->db_oid);
 		snprintf(map->new_dir, sizeof(map->new_dir), "%s%s/%u", new_rel->tablespace,
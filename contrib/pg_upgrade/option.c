@@ -48,6 +48,7 @@ parseCommandLine(int argc, char *argv[])
 		{"check", no_argument, NULL, 'c'},
 		{"debug", no_argument, NULL, 'g'},
 		{"debugfile", required_argument, NULL, 'G'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"link", no_argument, NULL, 'k'},
 		{"logfile", required_argument, NULL, 'l'},
 		{"verbose", no_argument, NULL, 'v'},
@@ -59,6 +60,7 @@ parseCommandLine(int argc, char *argv[])
 	char		*return_buf;
 
 	user_opts.transfer_mode = TRANSFER_MODE_COPY;
+	user_opts.jobs = 1;
 
 	os_info.progname = get_progname(argv[0]);
 
@@ -98,7 +100,7 @@ parseCommandLine(int argc, char *argv[])
 	if (return_buf == NULL)
 		pg_log(PG_FATAL, "Could not access current working directory: %s\n", getErrorText(errno));
 
-	while ((option = getopt_long(argc, argv, "d:D:b:B:cgG:kl:o:O:p:P:u:v",
+	while ((option = getopt_long(argc, argv, "d:D:b:B:cgG:j:kl:o:O:p:P:u:v",
 								 long_options, &optindex)) != -1)
 	{
 		switch (option)
@@ -138,6 +140,14 @@ parseCommandLine(int argc, char *argv[])
 				}
 				break;
 
+			case 'j':
+				if ((user_opts.jobs = atoi(optarg)) <= 0)
+				{
+					pg_log(PG_FATAL, "invalid number of jobs\n");
+					exit(1);
+				}
+				break;
+
 			case 'k':
 				user_opts.transfer_mode = TRANSFER_MODE_LINK;
 				break;
@@ -258,6 +268,7 @@ Options:\n\
   -D, --new-datadir=NEWDATADIR  new cluster data directory\n\
   -g, --debug                   enable debugging\n\
   -G, --debugfile=FILENAME      output debugging activity to file\n\
+  -j, --jobs=NUM                number of simultaneous processes to use\n\
   -k, --link                    link instead of copying files to new cluster\n\
   -l, --logfile=FILENAME        log session activity to file\n\
   -o, --old-options=OPTIONS     old cluster options to pass to the server\n\
@@ -0,0 +1,177 @@
+/*
+ *	parallel.c
+ *
+ *	multi-process support
+ *
+ *	Copyright (c) 2010-2012, PostgreSQL Global Development Group
+ *	contrib/pg_upgrade/parallel.c
+ */
+
+#include "postgres.h"
+
+#include "pg_upgrade.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#ifndef WIN32
+#include <sys/wait.h>
+#endif
+
+
+static int	parallel_jobs;
+
+#ifndef WIN32
+static void wait_for_free_slot(void);
+#endif
+
+
+/*
+ * parallel_exec_prog()
+ *
+ *	Like exec_prog(true, ...), but if --jobs allows it, the command is run
+ *	in a child process and this function returns at once.  The caller must
+ *	then wait for all children with reap_child() before using the results.
+ *	A failing command is reported by reap_child().
+ *
+ *	We don't fork() on Windows, so there the command is always run inline.
+ */
+void
+parallel_exec_prog(const char *fmt,...)
+{
+	va_list		args;
+	char		cmd[MAXPGPATH];
+#ifndef WIN32
+	pid_t		child;
+#endif
+
+	va_start(args, fmt);
+	vsnprintf(cmd, sizeof(cmd), fmt, args);
+	va_end(args);
+
+#ifndef WIN32
+	if (user_opts.jobs > 1)
+	{
+		wait_for_free_slot();
+
+		/* don't let the child write out our buffered output a second time */
+		fflush(NULL);
+
+		if ((child = fork()) == 0)
+		{
+			int			result = exec_prog(false, "%s", cmd);
+
+			fflush(NULL);
+			/* use _exit to skip atexit() functions, like stopping the server */
+			_exit(result);
+		}
+		else if (child < 0)
+			pg_log(PG_FATAL, "could not create worker process: %s\n",
+				   getErrorText(errno));
+
+		parallel_jobs++;
+		return;
+	}
+#endif
+
+	exec_prog(true, "%s", cmd);
+}
+
+
+/*
+ * parallel_transfer_all_new_dbs()
+ *
+ *	Transfer the files of all databases that live in one old tablespace,
+ *	in a child process if --jobs allows it; see parallel_exec_prog().
+ *	Each tablespace is typically a separate file system, so copying or
+ *	linking several of them at once keeps all of them busy.
+ */
+void
+parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
+							  char *old_pgdata, char *new_pgdata,
+							  char *old_tablespace)
+{
+#ifndef WIN32
+	pid_t		child;
+
+	if (user_opts.jobs > 1)
+	{
+		wait_for_free_slot();
+
+		fflush(NULL);
+
+		if ((child = fork()) == 0)
+		{
+			/* errors in here exit through pg_log(PG_FATAL) with status 1 */
+			transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
+								 new_pgdata, old_tablespace);
+			fflush(NULL);
+			_exit(0);
+		}
+		else if (child < 0)
+			pg_log(PG_FATAL, "could not create worker process: %s\n",
+				   getErrorText(errno));
+
+		parallel_jobs++;
+		return;
+	}
+#endif
+
+	transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata, new_pgdata,
+						 old_tablespace);
+}
+
+
+/*
+ * reap_child()
+ *
+ *	Collect one finished child process, waiting for one to finish if
+ *	wait_for_child is true.  Returns true if a child was collected, so
+ *	"while (reap_child(true))" waits for all outstanding children.  If the
+ *	child failed, we fail too.
+ */
+bool
+reap_child(bool wait_for_child)
+{
+#ifndef WIN32
+	int			work_status;
+	pid_t		child;
+
+	if (parallel_jobs == 0)
+		return false;
+
+	child = waitpid(-1, &work_status, wait_for_child ? 0 : WNOHANG);
+
+	if (child == (pid_t) -1)
+		pg_log(PG_FATAL, "waitpid() failed: %s\n", getErrorText(errno));
+	if (child == 0)
+		return false;			/* no child has finished yet */
+
+	if (!WIFEXITED(work_status) || WEXITSTATUS(work_status) != 0)
+		pg_log(PG_FATAL, "child worker exited abnormally, see the log for details\n");
+
+	parallel_jobs--;
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+#ifndef WIN32
+/*
+ * wait_for_free_slot()
+ *
+ *	Make sure fewer than --jobs children are running.
+ */
+static void
+wait_for_free_slot(void)
+{
+	/* collect any children that are already done */
+	while (reap_child(false))
+		;
+
+	if (parallel_jobs >= user_opts.jobs)
+		reap_child(true);
+}
+#endif
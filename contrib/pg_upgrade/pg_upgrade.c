@@ -109,8 +109,8 @@ main(int argc, char **argv)
 
 	stop_postmaster(false);
 
-	transfer_all_new_dbs(&old_cluster.dbarr, &new_cluster.dbarr,
-						 old_cluster.pgdata, new_cluster.pgdata);
+	transfer_all_new_tablespaces(&old_cluster.dbarr, &new_cluster.dbarr,
+								 old_cluster.pgdata, new_cluster.pgdata);
 
 	/*
 	 * Assuming OIDs are only used in system tables, there is no need to
@@ -274,13 +274,33 @@ create_new_objects(void)
 	}
 	check_ok();
 
-	prep_status("Restoring database schema to new cluster");
-	exec_prog(true,
-			  SYSTEMQUOTE "\"%s/psql\" --set ON_ERROR_STOP=on "
-			  "--no-psqlrc --port %d --username \"%s\" "
-			  "-f \"%s/%s\" --dbname template1 >> \"%s\"" SYSTEMQUOTE,
-			  new_cluster.bindir, new_cluster.port, os_info.user, os_info.cwd,
-			  DB_DUMP_FILE, log_opts.filename2);
+	prep_status("Restoring database schemas in the new cluster\n");
+
+	for (dbnum = 0; dbnum < old_cluster.dbarr.ndbs; dbnum++)
+	{
+		DbInfo	   *old_db = &old_cluster.dbarr.dbs[dbnum];
+
+		pg_log(PG_REPORT, OVERWRITE_MESSAGE, old_db->db_name);
+
+		/*
+		 * Each database's schema is restored by its own pg_restore, so with
+		 * --jobs several of them can be loaded at once.
+		 */
+		parallel_exec_prog(SYSTEMQUOTE "\"%s/pg_restore\" --port %d --username \"%s\" "
+						   "--exit-on-error --dbname \"%s\" "
+						   "\"%s/" DB_DUMP_FILE_MASK "\" >> \"%s\" 2>&1"
+						   SYSTEMQUOTE, new_cluster.bindir, new_cluster.port,
+						   os_info.user, old_db->db_name, os_info.cwd,
+						   old_db->db_oid, log_opts.filename2);
+	}
+
+	/* wait for all restores to finish */
+	while (reap_child(true))
+		;
+
+	prep_status(" ");			/* in case nothing printed; pass a space so gcc
+								 * doesn't complain about empty format
+								 * string */
 	check_ok();
 
 	/* regenerate now that we have objects in the databases */
@@ -422,6 +442,7 @@ static void
 cleanup(void)
 {
 	char		filename[MAXPGPATH];
+	int			dbnum;
 
 	if (log_opts.fd)
 		fclose(log_opts.fd);
@@ -433,6 +454,12 @@ cleanup(void)
 	unlink(filename);
 	snprintf(filename, sizeof(filename), "%s/%s", os_info.cwd, GLOBALS_DUMP_FILE);
 	unlink(filename);
-	snprintf(filename, sizeof(filename), "%s/%s", os_info.cwd, DB_DUMP_FILE);
-	unlink(filename);
+	for (dbnum = 0; dbnum < old_cluster.dbarr.ndbs; dbnum++)
+	{
+		/* a name too long for the buffer can't have been created either */
+		if (snprintf(filename, sizeof(filename), "%s/" DB_DUMP_FILE_MASK,
+					 os_info.cwd,
+					 old_cluster.dbarr.dbs[dbnum].db_oid) < sizeof(filename))
+			unlink(filename);
+	}
 }
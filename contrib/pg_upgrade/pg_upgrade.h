@@ -33,7 +33,8 @@
 #define ALL_DUMP_FILE		"pg_upgrade_dump_all.sql"
 /* contains both global db information and CREATE DATABASE commands */
 #define GLOBALS_DUMP_FILE	"pg_upgrade_dump_globals.sql"
-#define DB_DUMP_FILE		"pg_upgrade_dump_db.sql"
+/* per-database schema dumps, in pg_dump custom format; %u is the db oid */
+#define DB_DUMP_FILE_MASK	"pg_upgrade_dump_%u.custom"
 
 #ifndef WIN32
 #define pg_copy_file		copy_file
@@ -67,6 +68,8 @@
  *	8f9fe6edce358f7904e0db119416b4d1080a83aa; pick later catalog version.
  */
 #define VISIBILITY_MAP_CRASHSAFE_CAT_VER 201107031
+/* visibility map grew a second, all-frozen, bit per heap page */
+#define VISIBILITY_MAP_FROZEN_BIT_CAT_VER 201112245
 
 
 /*
@@ -92,6 +95,8 @@ typedef struct
  */
 typedef struct
 {
+	char		old_tablespace[MAXPGPATH];	/* old tablespace path, or old
+											 * $PGDATA for the default one */
 	char		old_dir[MAXPGPATH];
 	char		new_dir[MAXPGPATH];
 
@@ -234,6 +239,7 @@ typedef struct
 	bool		check;			/* TRUE -> ask user for permission to make
 								 * changes */
 	transferMode transfer_mode; /* copy files or link them? */
+	int			jobs;			/* number of processes to run at once */
 } UserOpts;
 
 
@@ -363,11 +369,23 @@ void print_maps(FileNameMap *maps, int n,
 void		parseCommandLine(int argc, char *argv[]);
 void		adjust_data_dir(ClusterInfo *cluster);
 
+/* parallel.c */
+
+void parallel_exec_prog(const char *fmt,...)
+	__attribute__((format(PG_PRINTF_ATTRIBUTE, 1, 2)));
+void parallel_transfer_all_new_dbs(DbInfoArr *old_db_arr,
+							  DbInfoArr *new_db_arr, char *old_pgdata,
+							  char *new_pgdata, char *old_tablespace);
+bool		reap_child(bool wait_for_child);
+
 /* relfilenode.c */
 
 void		get_pg_database_relfilenode(ClusterInfo *cluster);
+void transfer_all_new_tablespaces(DbInfoArr *old_db_arr,
+				   DbInfoArr *new_db_arr, char *old_pgdata, char *new_pgdata);
 const char *transfer_all_new_dbs(DbInfoArr *olddb_arr,
-				   DbInfoArr *newdb_arr, char *old_pgdata, char *new_pgdata);
+				   DbInfoArr *newdb_arr, char *old_pgdata, char *new_pgdata,
+				   char *old_tablespace);
 
 
 /* tablespace.c */
@@ -16,7 +16,7 @@
 
 
 static void transfer_single_new_db(pageCnvCtx *pageConverter,
-					   FileNameMap *maps, int size);
+					   FileNameMap *maps, int size, char *old_tablespace);
 static void transfer_relfile(pageCnvCtx *pageConverter,
 				 const char *fromfile, const char *tofile,
 				 const char *nspname, const char *relname);
@@ -24,21 +24,59 @@ static void transfer_relfile(pageCnvCtx *pageConverter,
 /* used by scandir(), must be global */
 char		scandir_file_pattern[MAXPGPATH];
 
+/*
+ * transfer_all_new_tablespaces()
+ *
+ * Responsible for upgrading all databases.  The files of each old
+ * tablespace, counting the old data directory as one, are transferred
+ * separately, so that with --jobs several tablespaces are handled at once.
+ */
+void
+transfer_all_new_tablespaces(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
+							 char *old_pgdata, char *new_pgdata)
+{
+	int			tblnum;
+
+	prep_status("Restoring user relation files\n");
+
+	if (user_opts.jobs <= 1)
+		/* no parallelism, so do it all in one pass */
+		transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata, new_pgdata,
+							 NULL);
+	else
+	{
+		parallel_transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
+									  new_pgdata, old_pgdata);
+		for (tblnum = 0; tblnum < os_info.num_tablespaces; tblnum++)
+			parallel_transfer_all_new_dbs(old_db_arr, new_db_arr, old_pgdata,
+										  new_pgdata,
+										  os_info.tablespaces[tblnum]);
+		/* wait for all transfers to finish */
+		while (reap_child(true))
+			;
+	}
+
+	prep_status(" ");			/* in case nothing printed; pass a space so gcc
+								 * doesn't complain about empty format
+								 * string */
+	check_ok();
+}
+
+
 /*
  * transfer_all_new_dbs()
  *
- * Responsible for upgrading all database. invokes routines to generate mappings and then
- * physically link the databases.
+ * Invokes routines to generate mappings and then physically link the
+ * databases.  If old_tablespace is not NULL, only relations stored in that
+ * old tablespace are transferred.
  */
 const char *
-transfer_all_new_dbs(DbInfoArr *old_db_arr,
-				   DbInfoArr *new_db_arr, char *old_pgdata, char *new_pgdata)
+transfer_all_new_dbs(DbInfoArr *old_db_arr, DbInfoArr *new_db_arr,
+					 char *old_pgdata, char *new_pgdata, char *old_tablespace)
 {
 	int			old_dbnum, new_dbnum;
 	const char *msg = NULL;
 
-	prep_status("Restoring user relation files\n");
-
 	/* Scan the old cluster databases and transfer their files */
 	for (old_dbnum = new_dbnum = 0;
 		 old_dbnum < old_db_arr->ndbs;
@@ -76,17 +114,13 @@ transfer_all_new_dbs(DbInfoArr *old_db_arr,
 #ifdef PAGE_CONVERSION
 			msg = setupPageConverter(&pageConverter);
 #endif
-			transfer_single_new_db(pageConverter, mappings, n_maps);
+			transfer_single_new_db(pageConverter, mappings, n_maps,
+								   old_tablespace);
 
 			pg_free(mappings);
 		}
 	}
 
-	prep_status(" ");			/* in case nothing printed; pass a space so gcc
-								 * doesn't complain about empty format
-								 * string */
-	check_ok();
-
 	return msg;
 }
 
@@ -128,27 +162,40 @@ get_pg_database_relfilenode(ClusterInfo *cluster)
  */
 static void
 transfer_single_new_db(pageCnvCtx *pageConverter,
-					   FileNameMap *maps, int size)
+					   FileNameMap *maps, int size, char *old_tablespace)
 {
 	char		old_dir[MAXPGPATH];
 	struct dirent **namelist = NULL;
 	int			numFiles = 0;
 	int			mapnum;
 	int			fileno;
-	bool		vm_crashsafe_change = false;
+	bool		vm_format_change = false;
 	
 	old_dir[0] = '\0';
 
 	/* Do not copy non-crashsafe vm files for binaries that assume crashsafety */
 	if (old_cluster.controldata.cat_ver < VISIBILITY_MAP_CRASHSAFE_CAT_VER &&
 		new_cluster.controldata.cat_ver >= VISIBILITY_MAP_CRASHSAFE_CAT_VER)
-		vm_crashsafe_change = true;
+		vm_format_change = true;
+
+	/*
+	 * Nor vm files with one bit per heap page for binaries that expect two;
+	 * the next vacuum of each table rebuilds them.
+	 */
+	if (old_cluster.controldata.cat_ver < VISIBILITY_MAP_FROZEN_BIT_CAT_VER &&
+		new_cluster.controldata.cat_ver >= VISIBILITY_MAP_FROZEN_BIT_CAT_VER)
+		vm_format_change = true;
 	
 	for (mapnum = 0; mapnum < size; mapnum++)
 	{
 		char		old_file[MAXPGPATH];
 		char		new_file[MAXPGPATH];
 
+		/* Only transfer files for the requested tablespace? */
+		if (old_tablespace != NULL &&
+			strcmp(maps[mapnum].old_tablespace, old_tablespace) != 0)
+			continue;
+
 		/* Changed tablespaces?  Need a new directory scan? */
 		if (strcmp(maps[mapnum].old_dir, old_dir) != 0)
 		{
@@ -198,7 +245,7 @@ transfer_single_new_db(pageCnvCtx *pageConverter,
 
 				if (strncmp(namelist[fileno]->d_name, scandir_file_pattern,
 							strlen(scandir_file_pattern)) == 0 &&
-					(!is_vm_file || !vm_crashsafe_change))
+					(!is_vm_file || !vm_format_change))
 				{
 					snprintf(old_file, sizeof(old_file), "%s/%s", maps[mapnum].old_dir,
 							 namelist[fileno]->d_name);
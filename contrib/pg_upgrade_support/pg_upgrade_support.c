@@ -11,12 +11,17 @@
 
 #include "postgres.h"
 
+#include "access/heapam.h"
+#include "catalog/heap.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_type.h"
 #include "commands/extension.h"
 #include "miscadmin.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
 
 /* THIS IS USED ONLY FOR PG >= 9.0 */
 
@@ -47,6 +52,7 @@ Datum		set_next_pg_enum_oid(PG_FUNCTION_ARGS);
 Datum		set_next_pg_authid_oid(PG_FUNCTION_ARGS);
 
 Datum		create_empty_extension(PG_FUNCTION_ARGS);
+Datum		set_missing_value(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(set_next_pg_type_oid);
 PG_FUNCTION_INFO_V1(set_next_array_pg_type_oid);
@@ -60,6 +66,7 @@ PG_FUNCTION_INFO_V1(set_next_pg_enum_oid);
 PG_FUNCTION_INFO_V1(set_next_pg_authid_oid);
 
 PG_FUNCTION_INFO_V1(create_empty_extension);
+PG_FUNCTION_INFO_V1(set_missing_value);
 
 
 Datum
@@ -194,3 +201,45 @@ create_empty_extension(PG_FUNCTION_ARGS)
 
 	PG_RETURN_VOID();
 }
+
+/*
+ * Restore the missing value of a column that was added with a default
+ * without rewriting the table; value is the text form of attmissingval.
+ */
+Datum
+set_missing_value(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	char	   *attname = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	char	   *value = text_to_cstring(PG_GETARG_TEXT_PP(2));
+	Relation	rel;
+	AttrNumber	attnum;
+	Form_pg_attribute attr;
+	Datum		missingval;
+	int			one = 1;
+	bool		isnull;
+
+	rel = relation_open(relid, AccessExclusiveLock);
+
+	attnum = get_attnum(relid, attname);
+	if (attnum <= 0)
+		elog(ERROR, "column \"%s\" of relation %u does not exist",
+			 attname, relid);
+	attr = rel->rd_att->attrs[attnum - 1];
+
+	missingval = OidFunctionCall3(F_ARRAY_IN,
+								  CStringGetDatum(value),
+								  ObjectIdGetDatum(attr->atttypid),
+								  Int32GetDatum(attr->atttypmod));
+	missingval = array_ref(DatumGetArrayTypeP(missingval), 1, &one,
+						   -1, attr->attlen, attr->attbyval, attr->attalign,
+						   &isnull);
+	if (isnull)
+		elog(ERROR, "missing value of column \"%s\" cannot be null", attname);
+
+	StoreAttrMissingVal(rel, attnum, missingval);
+
+	relation_close(rel, NoLock);
+
+	PG_RETURN_VOID();
+}
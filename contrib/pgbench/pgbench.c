@@ -39,6 +39,7 @@
 #include "portability/instr_time.h"
 
 #include <ctype.h>
+#include <math.h>
 
 #ifndef WIN32
 #include <sys/time.h>
@@ -57,6 +58,10 @@
 #define INT64_MAX	INT64CONST(0x7FFFFFFFFFFFFFFF)
 #endif
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 /*
  * Multi-platform pthread implementations
  */
@@ -73,6 +78,7 @@ static int	pthread_join(pthread_t th, void **thread_return);
 #include <pthread.h>
 #else
 /* Use emulation with fork. Rename pthread identifiers to avoid conflicts */
+#define PTHREAD_FORK_EMULATION
 
 #include <sys/wait.h>
 
@@ -107,6 +113,19 @@ extern int	optind;
 int			nxacts = 0;			/* number of transactions per client */
 int			duration = 0;		/* duration in seconds */
 
+/*
+ * Mean delay in microseconds between the scheduled starts of transactions
+ * in each thread, when the transaction rate is limited with --rate.  Zero
+ * means no limit.
+ */
+int64		throttle_delay = 0;
+
+/*
+ * Interval in seconds between progress reports, zero for none.
+ */
+int			progress = 0;
+int			progress_nthreads = 0;	/* number of threads, for progress reports */
+
 /*
  * scaling factor. for example, scale = 10 will make 1000000 tuples in
  * pgbench_accounts table.
@@ -124,6 +143,12 @@ int			fillfactor = 100;
  */
 int			unlogged_tables = 0;
 
+/*
+ * generate the initial data with generate_series() in the server, rather
+ * than sending it from pgbench?
+ */
+int			generate_on_server = 0;
+
 /*
  * tablespace selection
  */
@@ -161,6 +186,10 @@ typedef struct
 } Variable;
 
 #define MAX_FILES		128		/* max number of SQL script files allowed */
+
+/* limits on the parameters of the non-uniform \setrandom distributions */
+#define MIN_GAUSSIAN_THRESHOLD	2.0
+#define MAX_ZIPFIAN_PARAM		1000.0
 #define SHELL_COMMAND_SIZE	256 /* maximum size allowed for shell command */
 
 /*
@@ -177,7 +206,10 @@ typedef struct
 	int			listen;			/* 0 indicates that an async query has been
 								 * sent */
 	int			sleeping;		/* 1 indicates that the client is napping */
+	bool		throttling;		/* whether the nap is for throttling */
+	bool		is_throttled;	/* whether this transaction was throttled */
 	int64		until;			/* napping until (usec) */
+	bool		in_sync;		/* waiting for the results of a pipeline */
 	Variable   *variables;		/* array of variable definitions */
 	int			nvariables;
 	instr_time	txn_begin;		/* used for measuring transaction latencies */
@@ -186,6 +218,40 @@ typedef struct
 	bool		prepared[MAX_FILES];
 } CState;
 
+/*
+ * Latency histogram.  Latencies in microseconds below 2 * LATENCY_HIST_SUB
+ * get a bucket each; above that, every power of two is split into
+ * LATENCY_HIST_SUB buckets, so that a bucket is never wider than about 3%
+ * of the values it holds.  Latencies above roughly 19 hours all land in the
+ * last bucket.
+ */
+#define LATENCY_HIST_SUB		32
+#define LATENCY_HIST_MAX_SHIFT	30
+#define LATENCY_HIST_BUCKETS	((LATENCY_HIST_MAX_SHIFT + 2) * LATENCY_HIST_SUB)
+
+typedef struct
+{
+	int64		count;			/* number of latencies recorded */
+	int64		sum;			/* sum of latencies recorded (usec) */
+	int64		buckets[LATENCY_HIST_BUCKETS];
+} LatencyHist;
+
+/*
+ * Constants of the zipfian distribution with parameter s below 1 over n
+ * values, which take O(n) time to compute and so are cached per thread.
+ */
+#define ZIPF_CACHE_SIZE		8
+
+typedef struct
+{
+	int			n;				/* number of values */
+	double		s;				/* parameter */
+	double		harmonicn;		/* generalized harmonic number of n and s */
+	double		alpha;
+	double		beta;
+	double		eta;
+} ZipfCell;
+
 /*
  * Thread state and result
  */
@@ -196,9 +262,15 @@ typedef struct
 	CState	   *state;			/* array of CState */
 	int			nstate;			/* length of state[] */
 	instr_time	start_time;		/* thread start time */
-	instr_time *exec_elapsed;	/* time spent executing cmds (per Command) */
-	int		   *exec_count;		/* number of cmd executions (per Command) */
+	LatencyHist *exec_hist;		/* latencies of cmds (per Command) */
 	unsigned short random_state[3]; /* separate randomness for each thread */
+	ZipfCell	zipf_cache[ZIPF_CACHE_SIZE];	/* zipfian constants */
+	int			zipf_cached;	/* number of zipf_cache[] cells in use */
+	int			zipf_next;		/* cell to replace next when full */
+	int64		throttle_trigger;		/* scheduled start of next transaction */
+	int64		throttle_lag;	/* total schedule lag (usec) */
+	int64		throttle_lag_max;		/* max schedule lag (usec) */
+	LatencyHist txn_hist;		/* transaction latencies */
 } TState;
 
 #define INVALID_THREAD		((pthread_t) 0)
@@ -207,6 +279,9 @@ typedef struct
 {
 	instr_time	conn_time;
 	int			xacts;
+	int64		throttle_lag;
+	int64		throttle_lag_max;
+	LatencyHist txn_hist;
 } TResult;
 
 /*
@@ -237,6 +312,8 @@ typedef struct
 } Command;
 
 static Command **sql_files[MAX_FILES];	/* SQL script files */
+static int	sql_weights[MAX_FILES];		/* relative weight of each script */
+static int	total_weight = 0;	/* sum of sql_weights[] */
 static int	num_files;			/* number of script files */
 static int	num_commands = 0;	/* total number of Command structs */
 static int	debug = 0;			/* debug flag */
@@ -342,7 +419,10 @@ usage(const char *progname)
 		   "\nInitialization options:\n"
 		   "  -i           invokes initialization mode\n"
 		   "  -F NUM       fill factor\n"
+		   "  -j NUM       number of threads loading data in parallel (default: 1)\n"
 		   "  -s NUM       scaling factor\n"
+		   "  --generate-on-server\n"
+		   "               generate data in the server rather than in pgbench\n"
 		   "  --index-tablespace=TABLESPACE\n"
 		   "               create indexes in the specified tablespace\n"
 		   "  --tablespace=TABLESPACE\n"
@@ -354,14 +434,18 @@ usage(const char *progname)
 		   "  -C           establish new connection for each transaction\n"
 		   "  -D VARNAME=VALUE\n"
 		   "               define variable for use by custom script\n"
-		   "  -f FILENAME  read transaction script from FILENAME\n"
+		   "  -f FILENAME[@WEIGHT]\n"
+		   "               read transaction script from FILENAME, run with relative\n"
+		   "               frequency WEIGHT (default: 1)\n"
 		   "  -j NUM       number of threads (default: 1)\n"
 		   "  -l           write transaction times to log file\n"
 		   "  -M {simple|extended|prepared}\n"
 		   "               protocol for submitting queries to server (default: simple)\n"
 		   "  -n           do not run VACUUM before tests\n"
 		   "  -N           do not update tables \"pgbench_tellers\" and \"pgbench_branches\"\n"
-		   "  -r           report average latency per command\n"
+		   "  -P NUM       show progress report every NUM seconds\n"
+		   "  -r           report latency per command\n"
+		   "  -R NUM       target rate in transactions per second\n"
 		   "  -s NUM       report this scale factor in output\n"
 		   "  -S           perform SELECT-only transactions\n"
 	 "  -t NUM       number of transactions each client runs (default: 10)\n"
@@ -395,6 +479,231 @@ getrand(TState *thread, int min, int max)
 	return min + (int) ((max - min + 1) * pg_erand48(thread->random_state));
 }
 
+/*
+ * random number generator: exponential distribution from min to max
+ * inclusive, truncated where the density falls to exp(-threshold) of its
+ * peak at min
+ */
+static int
+getExponentialRand(TState *thread, int min, int max, double threshold)
+{
+	double		cut = exp(-threshold);
+	double		uniform = 1.0 - pg_erand48(thread->random_state);	/* (0, 1] */
+	double		rand = -log(cut + (1.0 - cut) * uniform) / threshold;	/* [0, 1) */
+
+	return min + (int) ((max - min + 1) * rand);
+}
+
+/*
+ * random number generator: gaussian distribution from min to max inclusive,
+ * centered on the middle of the range, which spans threshold standard
+ * deviations on either side
+ */
+static int
+getGaussianRand(TState *thread, int min, int max, double threshold)
+{
+	double		stdev;
+	double		rand;
+
+	/* Box-Muller, retrying until the value falls within the threshold */
+	do
+	{
+		double		rand1 = 1.0 - pg_erand48(thread->random_state);	/* (0, 1] */
+		double		rand2 = pg_erand48(thread->random_state);
+
+		stdev = sqrt(-2.0 * log(rand1)) * sin(2.0 * M_PI * rand2);
+	} while (stdev < -threshold || stdev >= threshold);
+
+	rand = (stdev + threshold) / (threshold * 2.0);		/* [0, 1) */
+
+	return min + (int) ((max - min + 1) * rand);
+}
+
+/*
+ * Zipfian value from 1 to n for s above 1, by rejection, as described in
+ * Luc Devroye, "Non-Uniform Random Variate Generation", Springer 1986,
+ * p. 550-551.
+ */
+static int
+computeIterativeZipfian(TState *thread, int n, double s)
+{
+	double		b = pow(2.0, s - 1.0);
+	double		x;
+
+	for (;;)
+	{
+		double		u = pg_erand48(thread->random_state);
+		double		v = pg_erand48(thread->random_state);
+		double		t;
+
+		x = floor(pow(1.0 - u, -1.0 / (s - 1.0)));
+		t = pow(1.0 + 1.0 / x, s - 1.0);
+		if (v * x * (t - 1.0) / (b - 1.0) <= t / b && x <= n)
+			break;
+	}
+	return (int) x;
+}
+
+static double
+generalizedHarmonicNumber(int n, double s)
+{
+	double		result = 0.0;
+	int			i;
+
+	/* add up the small terms first, for accuracy */
+	for (i = n; i > 0; i--)
+		result += pow(i, -s);
+	return result;
+}
+
+/*
+ * Zipfian value from 1 to n for s below 1, as described in Jim Gray et al.,
+ * "Quickly Generating Billion-Record Synthetic Databases", SIGMOD 1994.
+ */
+static int
+computeHarmonicZipfian(TState *thread, int n, double s)
+{
+	ZipfCell   *cell = NULL;
+	double		uniform;
+	double		uz;
+	int			i;
+
+	for (i = 0; i < thread->zipf_cached; i++)
+	{
+		if (thread->zipf_cache[i].n == n && thread->zipf_cache[i].s == s)
+		{
+			cell = &thread->zipf_cache[i];
+			break;
+		}
+	}
+	if (cell == NULL)
+	{
+		if (thread->zipf_cached < ZIPF_CACHE_SIZE)
+			cell = &thread->zipf_cache[thread->zipf_cached++];
+		else
+		{
+			cell = &thread->zipf_cache[thread->zipf_next];
+			thread->zipf_next = (thread->zipf_next + 1) % ZIPF_CACHE_SIZE;
+		}
+		cell->n = n;
+		cell->s = s;
+		cell->harmonicn = generalizedHarmonicNumber(n, s);
+		cell->alpha = 1.0 / (1.0 - s);
+		cell->beta = pow(0.5, s);
+		cell->eta = (1.0 - pow(2.0 / n, 1.0 - s)) /
+			(1.0 - generalizedHarmonicNumber(2, s) / cell->harmonicn);
+	}
+
+	uniform = pg_erand48(thread->random_state);
+	uz = uniform * cell->harmonicn;
+	if (uz < 1.0)
+		return 1;
+	if (uz < 1.0 + cell->beta)
+		return 2;
+	return 1 + (int) (n * pow(cell->eta * uniform - cell->eta + 1.0, cell->alpha));
+}
+
+/*
+ * random number generator: zipfian distribution from min to max inclusive,
+ * min being the most frequent value
+ */
+static int
+getZipfianRand(TState *thread, int min, int max, double s)
+{
+	int			n = max - min + 1;
+	int			x;
+
+	x = (s > 1.0) ? computeIterativeZipfian(thread, n, s) :
+		computeHarmonicZipfian(thread, n, s);
+
+	/* guard against rounding at the top of the range */
+	return min - 1 + Min(x, n);
+}
+
+/* pick the script the next transaction of a client runs, by weight */
+static int
+chooseScript(TState *thread)
+{
+	int			i = 0;
+	int			w;
+
+	if (num_files == 1)
+		return 0;
+
+	w = getrand(thread, 0, total_weight - 1);
+	while (w >= sql_weights[i])
+		w -= sql_weights[i++];
+
+	return i;
+}
+
+/* add a latency, in microseconds, to a histogram */
+static void
+histRecord(LatencyHist *hist, int64 usec)
+{
+	int64		v = usec > 0 ? usec : 0;
+	int			shift = 0;
+
+	while (v >= 2 * LATENCY_HIST_SUB && shift < LATENCY_HIST_MAX_SHIFT)
+	{
+		v >>= 1;
+		shift++;
+	}
+	if (v >= 2 * LATENCY_HIST_SUB)
+		v = 2 * LATENCY_HIST_SUB - 1;
+
+	hist->buckets[shift * LATENCY_HIST_SUB + v]++;
+	hist->count++;
+	hist->sum += usec;
+}
+
+static void
+histAdd(LatencyHist *dst, const LatencyHist *src)
+{
+	int			i;
+
+	for (i = 0; i < LATENCY_HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	dst->count += src->count;
+	dst->sum += src->sum;
+}
+
+/*
+ * Return the latency in milliseconds below which the given fraction of the
+ * recorded latencies fall, approximated by the middle of its bucket.
+ */
+static double
+histPercentile(const LatencyHist *hist, double fraction)
+{
+	int64		target;
+	int64		seen = 0;
+	int			i;
+
+	if (hist->count == 0)
+		return 0.0;
+
+	target = (int64) ceil(fraction * hist->count);
+	if (target < 1)
+		target = 1;
+
+	for (i = 0; i < LATENCY_HIST_BUCKETS - 1; i++)
+	{
+		seen += hist->buckets[i];
+		if (seen >= target)
+			break;
+	}
+
+	if (i < 2 * LATENCY_HIST_SUB)
+		return i / 1000.0;
+	else
+	{
+		int			shift = i / LATENCY_HIST_SUB - 1;
+		int64		low = (int64) (i - shift * LATENCY_HIST_SUB) << shift;
+
+		return (low + ((INT64CONST(1) << shift) - 1) / 2.0) / 1000.0;
+	}
+}
+
 /* call PQexec() and exit() on failure */
 static void
 executeStatement(PGconn *con, const char *sql)
@@ -777,6 +1086,30 @@ preparedStatementName(char *buffer, int file, int state)
 	sprintf(buffer, "P%d_%d", file, state);
 }
 
+/* prepare all the SQL commands of the client's current script */
+static void
+prepareScript(CState *st)
+{
+	Command   **commands = sql_files[st->use_file];
+	int			j;
+
+	for (j = 0; commands[j] != NULL; j++)
+	{
+		PGresult   *res;
+		char		name[MAX_PREPARE_NAME];
+
+		if (commands[j]->type != SQL_COMMAND)
+			continue;
+		preparedStatementName(name, st->use_file, j);
+		res = PQprepare(st->con, name,
+						commands[j]->argv[0], commands[j]->argc - 1, NULL);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			fprintf(stderr, "%s", PQerrorMessage(st->con));
+		PQclear(res);
+	}
+	st->prepared[st->use_file] = true;
+}
+
 static bool
 clientDone(CState *st, bool ok)
 {
@@ -803,17 +1136,81 @@ top:
 	if (st->sleeping)
 	{							/* are we sleeping? */
 		instr_time	now;
+		int64		now_usec;
+
+		/* don't start a throttled transaction once time is up */
+		if (st->throttling && timer_exceeded)
+		{
+			st->sleeping = 0;
+			st->throttling = false;
+			return clientDone(st, true);
+		}
 
 		INSTR_TIME_SET_CURRENT(now);
-		if (st->until <= INSTR_TIME_GET_MICROSEC(now))
+		now_usec = INSTR_TIME_GET_MICROSEC(now);
+		if (st->until <= now_usec)
+		{
 			st->sleeping = 0;	/* Done sleeping, go ahead with next command */
+			if (st->throttling)
+			{
+				/* measure how late the transaction starts against schedule */
+				int64		lag = now_usec - st->until;
+
+				thread->throttle_lag += lag;
+				if (lag > thread->throttle_lag_max)
+					thread->throttle_lag_max = lag;
+				st->throttling = false;
+			}
+		}
 		else
 			return true;		/* Still sleeping, nothing to do here */
 	}
 
 	if (st->listen)
 	{							/* are we receiver? */
-		if (commands[st->state]->type == SQL_COMMAND)
+		if (st->in_sync)
+		{
+			/*
+			 * \endpipeline: read the results of all the commands in the
+			 * pipeline, up to its sync point
+			 */
+			if (debug)
+				fprintf(stderr, "client %d receiving pipeline\n", st->id);
+			if (!PQconsumeInput(st->con))
+			{					/* there's something wrong */
+				fprintf(stderr, "Client %d aborted in state %d. Probably the backend died while processing.\n", st->id, st->state);
+				return clientDone(st, false);
+			}
+			for (;;)
+			{
+				if (PQisBusy(st->con))
+					return true;	/* don't have the whole result yet */
+				res = PQgetResult(st->con);
+				if (res == NULL)
+					continue;	/* end of the results of one command */
+				if (PQresultStatus(res) == PGRES_PIPELINE_SYNC)
+					break;
+				if (PQresultStatus(res) != PGRES_COMMAND_OK &&
+					PQresultStatus(res) != PGRES_TUPLES_OK)
+				{
+					fprintf(stderr, "Client %d aborted in state %d: %s",
+							st->id, st->state, PQerrorMessage(st->con));
+					PQclear(res);
+					return clientDone(st, false);
+				}
+				PQclear(res);
+			}
+			PQclear(res);
+			if (!PQexitPipelineMode(st->con))
+			{
+				fprintf(stderr, "Client %d aborted in state %d: %s",
+						st->id, st->state, PQerrorMessage(st->con));
+				return clientDone(st, false);
+			}
+			st->in_sync = false;
+		}
+		else if (commands[st->state]->type == SQL_COMMAND &&
+				 PQpipelineStatus(st->con) == PQ_PIPELINE_OFF)
 		{
 			if (debug)
 				fprintf(stderr, "client %d receiving\n", st->id);
@@ -827,8 +1224,8 @@ top:
 		}
 
 		/*
-		 * command finished: accumulate per-command execution times in
-		 * thread-local data structure, if per-command latencies are requested
+		 * command finished: accumulate per-command latencies in thread-local
+		 * data structure, if per-command latencies are requested
 		 */
 		if (is_latencies)
 		{
@@ -836,15 +1233,15 @@ top:
 			int			cnum = commands[st->state]->command_num;
 
 			INSTR_TIME_SET_CURRENT(now);
-			INSTR_TIME_ACCUM_DIFF(thread->exec_elapsed[cnum],
-								  now, st->stmt_begin);
-			thread->exec_count[cnum]++;
+			INSTR_TIME_SUBTRACT(now, st->stmt_begin);
+			histRecord(&thread->exec_hist[cnum], INSTR_TIME_GET_MICROSEC(now));
 		}
 
 		/*
-		 * if transaction finished, record the time it took in the log
+		 * if transaction finished, record the time it took, and write it to
+		 * the log if requested
 		 */
-		if (logfile && commands[st->state + 1] == NULL)
+		if (commands[st->state + 1] == NULL)
 		{
 			instr_time	now;
 			instr_time	diff;
@@ -854,20 +1251,26 @@ top:
 			diff = now;
 			INSTR_TIME_SUBTRACT(diff, st->txn_begin);
 			usec = (double) INSTR_TIME_GET_MICROSEC(diff);
+			histRecord(&thread->txn_hist, INSTR_TIME_GET_MICROSEC(diff));
 
+			if (logfile)
+			{
 #ifndef WIN32
-			/* This is more than we really ought to know about instr_time */
-			fprintf(logfile, "%d %d %.0f %d %ld %ld\n",
-					st->id, st->cnt, usec, st->use_file,
-					(long) now.tv_sec, (long) now.tv_usec);
+				/* This is more than we really ought to know about instr_time */
+				fprintf(logfile, "%d %d %.0f %d %ld %ld\n",
+						st->id, st->cnt, usec, st->use_file,
+						(long) now.tv_sec, (long) now.tv_usec);
 #else
-			/* On Windows, instr_time doesn't provide a timestamp anyway */
-			fprintf(logfile, "%d %d %.0f %d 0 0\n",
-					st->id, st->cnt, usec, st->use_file);
+				/* On Windows, instr_time doesn't provide a timestamp anyway */
+				fprintf(logfile, "%d %d %.0f %d 0 0\n",
+						st->id, st->cnt, usec, st->use_file);
 #endif
+			}
 		}
 
-		if (commands[st->state]->type == SQL_COMMAND)
+		/* in a pipeline, results are read at \endpipeline */
+		if (commands[st->state]->type == SQL_COMMAND &&
+			PQpipelineStatus(st->con) == PQ_PIPELINE_OFF)
 		{
 			/*
 			 * Read and discard the query result; note this is not included in
@@ -907,8 +1310,15 @@ top:
 		if (commands[st->state] == NULL)
 		{
 			st->state = 0;
-			st->use_file = getrand(thread, 0, num_files - 1);
+			st->use_file = chooseScript(thread);
 			commands = sql_files[st->use_file];
+			st->is_throttled = false;
+
+			/*
+			 * No transaction is underway, so there is nothing to listen to
+			 * until the next command is sent, possibly after a throttling nap.
+			 */
+			st->listen = 0;
 		}
 	}
 
@@ -927,8 +1337,26 @@ top:
 		INSTR_TIME_ACCUM_DIFF(*conn_time, end, start);
 	}
 
-	/* Record transaction start time if logging is enabled */
-	if (logfile && st->state == 0)
+	/*
+	 * If the transaction rate is limited, nap until the scheduled start of
+	 * the next transaction.  Each thread draws its schedule from a Poisson
+	 * process with the requested mean rate, and never waits on transactions
+	 * running late, so the lag behind the schedule shows how far the server
+	 * falls short of that rate.
+	 */
+	if (throttle_delay > 0 && st->state == 0 && !st->is_throttled)
+	{
+		thread->throttle_trigger += (int64)
+			(throttle_delay * -log(1.0 - pg_erand48(thread->random_state)));
+		st->until = thread->throttle_trigger;
+		st->sleeping = 1;
+		st->throttling = true;
+		st->is_throttled = true;
+		goto top;
+	}
+
+	/* Record transaction start time */
+	if (st->state == 0)
 		INSTR_TIME_SET_CURRENT(st->txn_begin);
 
 	/* Record statement start time if per-command latencies are requested */
@@ -970,25 +1398,7 @@ top:
 			const char *params[MAX_ARGS];
 
 			if (!st->prepared[st->use_file])
-			{
-				int			j;
-
-				for (j = 0; commands[j] != NULL; j++)
-				{
-					PGresult   *res;
-					char		name[MAX_PREPARE_NAME];
-
-					if (commands[j]->type != SQL_COMMAND)
-						continue;
-					preparedStatementName(name, st->use_file, j);
-					res = PQprepare(st->con, name,
-						  commands[j]->argv[0], commands[j]->argc - 1, NULL);
-					if (PQresultStatus(res) != PGRES_COMMAND_OK)
-						fprintf(stderr, "%s", PQerrorMessage(st->con));
-					PQclear(res);
-				}
-				st->prepared[st->use_file] = true;
-			}
+				prepareScript(st);
 
 			getQueryParams(st, command, params);
 			preparedStatementName(name, st->use_file, st->state);
@@ -1005,10 +1415,22 @@ top:
 		{
 			if (debug)
 				fprintf(stderr, "client %d cannot send %s\n", st->id, command->argv[0]);
+			if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+			{
+				fprintf(stderr, "Client %d aborted in state %d: %s",
+						st->id, st->state, PQerrorMessage(st->con));
+				return clientDone(st, false);
+			}
 			st->ecnt++;
 		}
 		else
+		{
 			st->listen = 1;		/* flags that should be listened */
+
+			/* in a pipeline, go on sending without waiting for the result */
+			if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+				goto top;
+		}
 	}
 	else if (commands[st->state]->type == META_COMMAND)
 	{
@@ -1090,7 +1512,59 @@ top:
 #ifdef DEBUG
 			printf("min: %d max: %d random: %d\n", min, max, getrand(thread, min, max));
 #endif
-			snprintf(res, sizeof(res), "%d", getrand(thread, min, max));
+			if (argc < 5 || pg_strcasecmp(argv[4], "uniform") == 0)
+				snprintf(res, sizeof(res), "%d", getrand(thread, min, max));
+			else
+			{
+				double		param;
+
+				if (*argv[5] == ':')
+				{
+					if ((var = getVariable(st, argv[5] + 1)) == NULL)
+					{
+						fprintf(stderr, "%s: undefined variable %s\n", argv[0], argv[5]);
+						st->ecnt++;
+						return true;
+					}
+					param = atof(var);
+				}
+				else
+					param = atof(argv[5]);
+
+				if (pg_strcasecmp(argv[4], "exponential") == 0)
+				{
+					if (param <= 0.0)
+					{
+						fprintf(stderr, "%s: exponential threshold must be greater than zero\n", argv[0]);
+						st->ecnt++;
+						return true;
+					}
+					snprintf(res, sizeof(res), "%d",
+							 getExponentialRand(thread, min, max, param));
+				}
+				else if (pg_strcasecmp(argv[4], "gaussian") == 0)
+				{
+					if (param < MIN_GAUSSIAN_THRESHOLD)
+					{
+						fprintf(stderr, "%s: gaussian threshold must be at least %g\n", argv[0], MIN_GAUSSIAN_THRESHOLD);
+						st->ecnt++;
+						return true;
+					}
+					snprintf(res, sizeof(res), "%d",
+							 getGaussianRand(thread, min, max, param));
+				}
+				else
+				{
+					if (param <= 0.0 || param == 1.0 || param > MAX_ZIPFIAN_PARAM)
+					{
+						fprintf(stderr, "%s: zipfian parameter must be greater than zero, not 1, and at most %g\n", argv[0], MAX_ZIPFIAN_PARAM);
+						st->ecnt++;
+						return true;
+					}
+					snprintf(res, sizeof(res), "%d",
+							 getZipfianRand(thread, min, max, param));
+				}
+			}
 
 			if (!putVariable(st, argv[0], argv[1], res))
 			{
@@ -1204,6 +1678,35 @@ top:
 
 			st->listen = 1;
 		}
+		else if (pg_strcasecmp(argv[0], "startpipeline") == 0)
+		{
+			/* statements can't be prepared synchronously in a pipeline */
+			if (querymode == QUERY_PREPARED && !st->prepared[st->use_file])
+				prepareScript(st);
+
+			if (!PQenterPipelineMode(st->con))
+			{
+				fprintf(stderr, "Client %d aborted in state %d: %s",
+						st->id, st->state, PQerrorMessage(st->con));
+				return clientDone(st, false);
+			}
+
+			st->listen = 1;
+		}
+		else if (pg_strcasecmp(argv[0], "endpipeline") == 0)
+		{
+			if (!PQpipelineSync(st->con))
+			{
+				fprintf(stderr, "Client %d aborted in state %d: %s",
+						st->id, st->state, PQerrorMessage(st->con));
+				return clientDone(st, false);
+			}
+
+			/* wait for the results like for an SQL command */
+			st->in_sync = true;
+			st->listen = 1;
+			return true;
+		}
 		else if (pg_strcasecmp(argv[0], "setshell") == 0)
 		{
 			bool		ret = runShellCommand(st, argv[1], argv + 2, argc - 2);
@@ -1254,9 +1757,153 @@ disconnect_all(CState *state, int length)
 	}
 }
 
+/*
+ * Run each of the given statements on a connection of its own, all at the
+ * same time, and wait for all of them to complete.
+ */
+static void
+executeStatementsConcurrently(char **sqls, int nsqls)
+{
+	PGconn	  **cons;
+	int			i;
+
+	cons = (PGconn **) xmalloc(sizeof(PGconn *) * nsqls);
+	for (i = 0; i < nsqls; i++)
+	{
+		if ((cons[i] = doConnect()) == NULL)
+			exit(1);
+		if (!PQsendQuery(cons[i], sqls[i]))
+		{
+			fprintf(stderr, "%s", PQerrorMessage(cons[i]));
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < nsqls; i++)
+	{
+		PGresult   *res;
+
+		while ((res = PQgetResult(cons[i])) != NULL)
+		{
+			if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			{
+				fprintf(stderr, "%s", PQerrorMessage(cons[i]));
+				exit(1);
+			}
+			PQclear(res);
+		}
+		PQfinish(cons[i]);
+	}
+	free(cons);
+}
+
+/* a range of pgbench_accounts rows for one loader to fill in */
+typedef struct
+{
+	int			loader;			/* loader number */
+	int			nloaders;		/* number of loaders */
+	PGconn	   *con;			/* connection to load through */
+	int			first_aid;		/* first row to load */
+	int			last_aid;		/* last row to load */
+	bool		truncate;		/* truncate the table in the same transaction */
+} AccountsLoad;
+
+/*
+ * Fill in a range of pgbench_accounts, either by COPY from here or by having
+ * the server generate the rows.  The number of rows loaded is returned in a
+ * TResult, so that this can run as a thread, or as a child process under the
+ * fork emulation of threads.  Errors end the whole program, except under
+ * that emulation where the parent notices the missing result instead.
+ */
+static void *
+loadAccounts(void *arg)
+{
+	AccountsLoad *load = (AccountsLoad *) arg;
+	PGconn	   *con = load->con;
+	TResult    *result;
+	PGresult   *res;
+	char		sql[256];
+	char		who[32];
+	int			aid;
+
+	if (load->nloaders > 1)
+		snprintf(who, sizeof(who), "loader %d: ", load->loader);
+	else
+		who[0] = '\0';
+
+	executeStatement(con, "begin");
+
+	/*
+	 * Truncating the table just created in the loading transaction lets the
+	 * server skip WAL-logging the data when archiving is off.
+	 */
+	if (load->truncate)
+		executeStatement(con, "truncate pgbench_accounts");
+
+	if (generate_on_server)
+	{
+		/* generate a branch's worth of accounts per statement */
+		for (aid = load->first_aid; aid <= load->last_aid; aid += naccounts)
+		{
+			int			last = aid - 1 + Min(naccounts, load->last_aid - aid + 1);
+
+			snprintf(sql, sizeof(sql),
+					 "insert into pgbench_accounts(aid,bid,abalance,filler) "
+					 "select aid, (aid - 1) / %d + 1, 0, '' "
+					 "from generate_series(%d, %d) as aid",
+					 naccounts, aid, last);
+			executeStatement(con, sql);
+			fprintf(stderr, "%s%d tuples done.\n", who, last - load->first_aid + 1);
+		}
+	}
+	else
+	{
+		res = PQexec(con, "copy pgbench_accounts from stdin");
+		if (PQresultStatus(res) != PGRES_COPY_IN)
+		{
+			fprintf(stderr, "%s", PQerrorMessage(con));
+			exit(1);
+		}
+		PQclear(res);
+
+		for (aid = load->first_aid; aid <= load->last_aid; aid++)
+		{
+			snprintf(sql, 256, "%d\t%d\t%d\t\n", aid, (aid - 1) / naccounts + 1, 0);
+			if (PQputline(con, sql))
+			{
+				fprintf(stderr, "PQputline failed\n");
+				exit(1);
+			}
+
+			if ((aid - load->first_aid + 1) % 10000 == 0)
+				fprintf(stderr, "%s%d tuples done.\n", who, aid - load->first_aid + 1);
+		}
+		if (PQputline(con, "\\.\n"))
+		{
+			fprintf(stderr, "very last PQputline failed\n");
+			exit(1);
+		}
+		if (PQendcopy(con))
+		{
+			fprintf(stderr, "PQendcopy failed\n");
+			exit(1);
+		}
+	}
+	executeStatement(con, "commit");
+
+	/* the main thread goes on using the first loader's connection */
+	if (load->loader > 0)
+		PQfinish(con);
+
+	result = xmalloc(sizeof(TResult));
+	memset(result, 0, sizeof(TResult));
+	result->xacts = load->last_aid - load->first_aid + 1;
+	return result;
+}
+
 /* create tables and setup data */
 static void
-init(void)
+init(int nthreads)
 {
 	/*
 	 * Note: TPC-B requires at least 100 bytes per row, and the "filler"
@@ -1299,10 +1946,18 @@ init(void)
 		"alter table pgbench_tellers add primary key (tid)",
 		"alter table pgbench_accounts add primary key (aid)"
 	};
+	static char *VACUUMs[] = {
+		"vacuum analyze pgbench_branches",
+		"vacuum analyze pgbench_tellers",
+		"vacuum analyze pgbench_accounts",
+		"vacuum analyze pgbench_history"
+	};
 
 	PGconn	   *con;
-	PGresult   *res;
 	char		sql[256];
+	char	   *indexDDLs[lengthof(DDLAFTERs)];
+	AccountsLoad *loads;
+	pthread_t  *workers;
 	int			i;
 
 	if ((con = doConnect()) == NULL)
@@ -1341,62 +1996,91 @@ init(void)
 
 	executeStatement(con, "begin");
 
-	for (i = 0; i < nbranches * scale; i++)
+	if (generate_on_server)
 	{
-		snprintf(sql, 256, "insert into pgbench_branches(bid,bbalance) values(%d,0)", i + 1);
+		snprintf(sql, 256, "insert into pgbench_branches(bid,bbalance) "
+				 "select bid, 0 from generate_series(1, %d) as bid",
+				 nbranches * scale);
+		executeStatement(con, sql);
+		snprintf(sql, 256, "insert into pgbench_tellers(tid,bid,tbalance) "
+				 "select tid, (tid - 1) / %d + 1, 0 from generate_series(1, %d) as tid",
+				 ntellers, ntellers * scale);
 		executeStatement(con, sql);
 	}
-
-	for (i = 0; i < ntellers * scale; i++)
+	else
 	{
-		snprintf(sql, 256, "insert into pgbench_tellers(tid,bid,tbalance) values (%d,%d,0)",
-				 i + 1, i / ntellers + 1);
-		executeStatement(con, sql);
+		for (i = 0; i < nbranches * scale; i++)
+		{
+			snprintf(sql, 256, "insert into pgbench_branches(bid,bbalance) values(%d,0)", i + 1);
+			executeStatement(con, sql);
+		}
+
+		for (i = 0; i < ntellers * scale; i++)
+		{
+			snprintf(sql, 256, "insert into pgbench_tellers(tid,bid,tbalance) values (%d,%d,0)",
+					 i + 1, i / ntellers + 1);
+			executeStatement(con, sql);
+		}
 	}
 
 	executeStatement(con, "commit");
 
 	/*
-	 * fill the pgbench_accounts table with some data
+	 * fill the pgbench_accounts table with some data, splitting it into
+	 * ranges loaded concurrently if several threads are requested
 	 */
 	fprintf(stderr, "creating tables...\n");
 
-	executeStatement(con, "begin");
-	executeStatement(con, "truncate pgbench_accounts");
-
-	res = PQexec(con, "copy pgbench_accounts from stdin");
-	if (PQresultStatus(res) != PGRES_COPY_IN)
+	loads = (AccountsLoad *) xmalloc(sizeof(AccountsLoad) * nthreads);
+	workers = (pthread_t *) xmalloc(sizeof(pthread_t) * nthreads);
+	for (i = 0; i < nthreads; i++)
 	{
-		fprintf(stderr, "%s", PQerrorMessage(con));
-		exit(1);
+		AccountsLoad *load = &loads[i];
+
+		load->loader = i;
+		load->nloaders = nthreads;
+		load->first_aid = (int) ((int64) naccounts * scale * i / nthreads) + 1;
+		load->last_aid = (int) ((int64) naccounts * scale * (i + 1) / nthreads);
+		load->truncate = (nthreads == 1);
+
+		/* connect up front, so that any password prompt is not concurrent */
+		if (i == 0)
+			load->con = con;
+		else if ((load->con = doConnect()) == NULL)
+			exit(1);
 	}
-	PQclear(res);
 
-	for (i = 0; i < naccounts * scale; i++)
+	/* the first range is loaded by the main thread, as for benchmarking */
+	for (i = 1; i < nthreads; i++)
 	{
-		int			j = i + 1;
+		int			err = pthread_create(&workers[i], NULL, loadAccounts, &loads[i]);
 
-		snprintf(sql, 256, "%d\t%d\t%d\t\n", j, i / naccounts + 1, 0);
-		if (PQputline(con, sql))
+		if (err != 0 || workers[i] == INVALID_THREAD)
 		{
-			fprintf(stderr, "PQputline failed\n");
+			fprintf(stderr, "cannot create thread: %s\n", strerror(err));
 			exit(1);
 		}
-
-		if (j % 10000 == 0)
-			fprintf(stderr, "%d tuples done.\n", j);
 	}
-	if (PQputline(con, "\\.\n"))
-	{
-		fprintf(stderr, "very last PQputline failed\n");
-		exit(1);
-	}
-	if (PQendcopy(con))
+
+	for (i = 0; i < nthreads; i++)
 	{
-		fprintf(stderr, "PQendcopy failed\n");
-		exit(1);
+		void	   *ret = NULL;
+
+		if (i == 0)
+			ret = loadAccounts(&loads[0]);
+		else
+			pthread_join(workers[i], &ret);
+
+		if (ret == NULL ||
+			((TResult *) ret)->xacts != loads[i].last_aid - loads[i].first_aid + 1)
+		{
+			fprintf(stderr, "loading of pgbench_accounts failed\n");
+			exit(1);
+		}
+		free(ret);
 	}
-	executeStatement(con, "commit");
+	free(loads);
+	free(workers);
 
 	/*
 	 * create indexes
@@ -1418,15 +2102,28 @@ init(void)
 			PQfreemem(escape_tablespace);
 		}
 
-		executeStatement(con, buffer);
+		/* with several threads, build the keys all at once further down */
+		if (nthreads > 1)
+			indexDDLs[i] = xstrdup(buffer);
+		else
+			executeStatement(con, buffer);
+	}
+	if (nthreads > 1)
+	{
+		executeStatementsConcurrently(indexDDLs, lengthof(DDLAFTERs));
+		for (i = 0; i < lengthof(DDLAFTERs); i++)
+			free(indexDDLs[i]);
 	}
 
 	/* vacuum */
 	fprintf(stderr, "vacuum...");
-	executeStatement(con, "vacuum analyze pgbench_branches");
-	executeStatement(con, "vacuum analyze pgbench_tellers");
-	executeStatement(con, "vacuum analyze pgbench_accounts");
-	executeStatement(con, "vacuum analyze pgbench_history");
+	if (nthreads > 1)
+		executeStatementsConcurrently(VACUUMs, lengthof(VACUUMs));
+	else
+	{
+		for (i = 0; i < lengthof(VACUUMs); i++)
+			executeStatement(con, VACUUMs[i]);
+	}
 
 	fprintf(stderr, "done.\n");
 	PQfinish(con);
@@ -1525,13 +2222,40 @@ process_commands(char *buf)
 
 		if (pg_strcasecmp(my_commands->argv[0], "setrandom") == 0)
 		{
+			int			nargs = 4;
+
 			if (my_commands->argc < 4)
 			{
 				fprintf(stderr, "%s: missing argument\n", my_commands->argv[0]);
 				exit(1);
 			}
 
-			for (j = 4; j < my_commands->argc; j++)
+			/* optional distribution, with its parameter except for uniform */
+			if (my_commands->argc > 4)
+			{
+				if (pg_strcasecmp(my_commands->argv[4], "uniform") == 0)
+					nargs = 5;
+				else if (pg_strcasecmp(my_commands->argv[4], "exponential") == 0 ||
+						 pg_strcasecmp(my_commands->argv[4], "gaussian") == 0 ||
+						 pg_strcasecmp(my_commands->argv[4], "zipfian") == 0)
+				{
+					if (my_commands->argc < 6)
+					{
+						fprintf(stderr, "%s: missing parameter for %s distribution\n",
+								my_commands->argv[0], my_commands->argv[4]);
+						exit(1);
+					}
+					nargs = 6;
+				}
+				else
+				{
+					fprintf(stderr, "%s: unknown distribution \"%s\"\n",
+							my_commands->argv[0], my_commands->argv[4]);
+					exit(1);
+				}
+			}
+
+			for (j = nargs; j < my_commands->argc; j++)
 				fprintf(stderr, "%s: extra argument \"%s\" ignored\n",
 						my_commands->argv[0], my_commands->argv[j]);
 		}
@@ -1591,6 +2315,20 @@ process_commands(char *buf)
 				fprintf(stderr, "%s: extra argument \"%s\" ignored\n",
 						my_commands->argv[0], my_commands->argv[j]);
 		}
+		else if (pg_strcasecmp(my_commands->argv[0], "startpipeline") == 0 ||
+				 pg_strcasecmp(my_commands->argv[0], "endpipeline") == 0)
+		{
+			if (querymode == QUERY_SIMPLE)
+			{
+				fprintf(stderr, "%s: pipelines require -M extended or prepared\n",
+						my_commands->argv[0]);
+				exit(1);
+			}
+
+			for (j = 1; j < my_commands->argc; j++)
+				fprintf(stderr, "%s: extra argument \"%s\" ignored\n",
+						my_commands->argv[0], my_commands->argv[j]);
+		}
 		else if (pg_strcasecmp(my_commands->argv[0], "setshell") == 0)
 		{
 			if (my_commands->argc < 3)
@@ -1646,6 +2384,8 @@ process_file(char *filename)
 	int			lineno;
 	char		buf[BUFSIZ];
 	int			alloc_num;
+	bool		pipeline;
+	int			i;
 
 	if (num_files >= MAX_FILES)
 	{
@@ -1687,6 +2427,39 @@ process_file(char *filename)
 
 	my_commands[lineno] = NULL;
 
+	/* pipelines must not nest, and must end within the script */
+	pipeline = false;
+	for (i = 0; i < lineno; i++)
+	{
+		Command    *command = my_commands[i];
+
+		if (command->type != META_COMMAND)
+			continue;
+		if (pg_strcasecmp(command->argv[0], "startpipeline") == 0)
+		{
+			if (pipeline)
+			{
+				fprintf(stderr, "%s: \\startpipeline within a pipeline\n", filename);
+				return false;
+			}
+			pipeline = true;
+		}
+		else if (pg_strcasecmp(command->argv[0], "endpipeline") == 0)
+		{
+			if (!pipeline)
+			{
+				fprintf(stderr, "%s: \\endpipeline without \\startpipeline\n", filename);
+				return false;
+			}
+			pipeline = false;
+		}
+	}
+	if (pipeline)
+	{
+		fprintf(stderr, "%s: pipeline not ended with \\endpipeline\n", filename);
+		return false;
+	}
+
 	sql_files[num_files++] = my_commands;
 
 	return true;
@@ -1747,7 +2520,8 @@ process_builtin(char *tb)
 static void
 printResults(int ttype, int normal_xacts, int nclients,
 			 TState *threads, int nthreads,
-			 instr_time total_time, instr_time conn_total_time)
+			 instr_time total_time, instr_time conn_total_time,
+			 LatencyHist *txn_hist, int64 throttle_lag, int64 throttle_lag_max)
 {
 	double		time_include,
 				tps_include,
@@ -1785,6 +2559,19 @@ printResults(int ttype, int normal_xacts, int nclients,
 		printf("number of transactions actually processed: %d\n",
 			   normal_xacts);
 	}
+	if (txn_hist->count > 0)
+	{
+		printf("latency average: %.3f ms\n",
+			   txn_hist->sum / 1000.0 / txn_hist->count);
+		printf("latency percentiles: 50%% %.3f ms, 99%% %.3f ms, 99.9%% %.3f ms\n",
+			   histPercentile(txn_hist, 0.5),
+			   histPercentile(txn_hist, 0.99),
+			   histPercentile(txn_hist, 0.999));
+	}
+	if (throttle_delay > 0 && txn_hist->count > 0)
+		printf("rate limit schedule lag: avg %.3f (max %.3f) ms\n",
+			   throttle_lag / 1000.0 / txn_hist->count,
+			   throttle_lag_max / 1000.0);
 	printf("tps = %f (including connections establishing)\n", tps_include);
 	printf("tps = %f (excluding connections establishing)\n", tps_exclude);
 
@@ -1798,37 +2585,29 @@ printResults(int ttype, int normal_xacts, int nclients,
 			Command   **commands;
 
 			if (num_files > 1)
-				printf("statement latencies in milliseconds, file %d:\n", i + 1);
+				printf("statement latencies in milliseconds (average, 50%%, 99%%, 99.9%%), file %d (weight %d):\n",
+					   i + 1, sql_weights[i]);
 			else
-				printf("statement latencies in milliseconds:\n");
+				printf("statement latencies in milliseconds (average, 50%%, 99%%, 99.9%%):\n");
 
 			for (commands = sql_files[i]; *commands != NULL; commands++)
 			{
 				Command    *command = *commands;
 				int			cnum = command->command_num;
-				double		total_time;
-				instr_time	total_exec_elapsed;
-				int			total_exec_count;
+				LatencyHist hist;
 				int			t;
 
 				/* Accumulate per-thread data for command */
-				INSTR_TIME_SET_ZERO(total_exec_elapsed);
-				total_exec_count = 0;
+				memset(&hist, 0, sizeof(hist));
 				for (t = 0; t < nthreads; t++)
-				{
-					TState	   *thread = &threads[t];
-
-					INSTR_TIME_ADD(total_exec_elapsed,
-								   thread->exec_elapsed[cnum]);
-					total_exec_count += thread->exec_count[cnum];
-				}
-
-				if (total_exec_count > 0)
-					total_time = INSTR_TIME_GET_MILLISEC(total_exec_elapsed) / (double) total_exec_count;
-				else
-					total_time = 0.0;
-
-				printf("\t%f\t%s\n", total_time, command->line);
+					histAdd(&hist, &threads[t].exec_hist[cnum]);
+
+				printf("\t%f\t%f\t%f\t%f\t%s\n",
+					   hist.count > 0 ? hist.sum / 1000.0 / hist.count : 0.0,
+					   histPercentile(&hist, 0.5),
+					   histPercentile(&hist, 0.99),
+					   histPercentile(&hist, 0.999),
+					   command->line);
 			}
 		}
 	}
@@ -1849,6 +2628,7 @@ main(int argc, char **argv)
 	int			optindex;
 	char	   *filename = NULL;
 	bool		scale_given = false;
+	double		throttle_rate = 0;	/* target transactions per second */
 
 	CState	   *state;			/* status of clients */
 	TState	   *threads;		/* array of thread */
@@ -1857,13 +2637,19 @@ main(int argc, char **argv)
 	instr_time	total_time;
 	instr_time	conn_total_time;
 	int			total_xacts;
+	LatencyHist txn_hist;		/* transaction latencies of all threads */
+	int64		throttle_lag;
+	int64		throttle_lag_max;
 
 	int			i;
 
 	static struct option long_options[] = {
 			{"index-tablespace", required_argument, NULL, 3},
+			{"progress", required_argument, NULL, 'P'},
+			{"rate", required_argument, NULL, 'R'},
 			{"tablespace", required_argument, NULL, 2},
 			{"unlogged-tables", no_argument, &unlogged_tables, 1},
+			{"generate-on-server", no_argument, &generate_on_server, 1},
 			{NULL, 0, NULL, 0}
 	};
 
@@ -1910,7 +2696,7 @@ main(int argc, char **argv)
 	state = (CState *) xmalloc(sizeof(CState));
 	memset(state, 0, sizeof(CState));
 
-	while ((c = getopt_long(argc, argv, "ih:nvp:dSNc:j:Crs:t:T:U:lf:D:F:M:", long_options, &optindex)) != -1)
+	while ((c = getopt_long(argc, argv, "ih:nvp:dSNc:j:Crs:t:T:U:lf:D:F:M:P:R:", long_options, &optindex)) != -1)
 	{
 		switch (c)
 		{
@@ -2019,10 +2805,30 @@ main(int argc, char **argv)
 				use_log = true;
 				break;
 			case 'f':
-				ttype = 3;
-				filename = optarg;
-				if (process_file(filename) == false || *sql_files[num_files - 1] == NULL)
-					exit(1);
+				{
+					char	   *p;
+					int			weight = 1;
+
+					/* a trailing @NUM gives the relative weight of the script */
+					if ((p = strrchr(optarg, '@')) != NULL && p[1] != '\0' &&
+						strspn(p + 1, "0123456789") == strlen(p + 1))
+					{
+						weight = atoi(p + 1);
+						if (weight <= 0 || weight > 1000000)
+						{
+							fprintf(stderr, "invalid script weight: %s\n", p + 1);
+							exit(1);
+						}
+						*p = '\0';
+					}
+
+					ttype = 3;
+					filename = optarg;
+					if (process_file(filename) == false || *sql_files[num_files - 1] == NULL)
+						exit(1);
+					sql_weights[num_files - 1] = weight;
+					total_weight += weight;
+				}
 				break;
 			case 'D':
 				{
@@ -2062,6 +2868,22 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 'P':
+				progress = atoi(optarg);
+				if (progress <= 0)
+				{
+					fprintf(stderr, "invalid progress interval: %s\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'R':
+				throttle_rate = atof(optarg);
+				if (throttle_rate <= 0)
+				{
+					fprintf(stderr, "invalid rate: %s\n", optarg);
+					exit(1);
+				}
+				break;
 			case 0:
 				/* This covers long options which take no argument. */
 				break;
@@ -2092,7 +2914,7 @@ main(int argc, char **argv)
 
 	if (is_init_mode)
 	{
-		init();
+		init(nthreads);
 		exit(0);
 	}
 
@@ -2106,6 +2928,11 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	/* each thread follows its own schedule at its share of the rate */
+	if (throttle_rate > 0)
+		throttle_delay = (int64) (1000000.0 * nthreads / throttle_rate);
+	progress_nthreads = nthreads;
+
 	/*
 	 * is_latencies only works with multiple threads in thread-based
 	 * implementations, not fork-based ones, because it supposes that the
@@ -2236,16 +3063,19 @@ main(int argc, char **argv)
 	{
 		case 0:
 			sql_files[0] = process_builtin(tpc_b);
+			sql_weights[0] = total_weight = 1;
 			num_files = 1;
 			break;
 
 		case 1:
 			sql_files[0] = process_builtin(select_only);
+			sql_weights[0] = total_weight = 1;
 			num_files = 1;
 			break;
 
 		case 2:
 			sql_files[0] = process_builtin(simple_update);
+			sql_weights[0] = total_weight = 1;
 			num_files = 1;
 			break;
 
@@ -2265,28 +3095,22 @@ main(int argc, char **argv)
 		thread->random_state[0] = random();
 		thread->random_state[1] = random();
 		thread->random_state[2] = random();
+		thread->zipf_cached = 0;
+		thread->zipf_next = 0;
+		thread->throttle_trigger = 0;
+		thread->throttle_lag = 0;
+		thread->throttle_lag_max = 0;
+		memset(&thread->txn_hist, 0, sizeof(LatencyHist));
 
 		if (is_latencies)
 		{
 			/* Reserve memory for the thread to store per-command latencies */
-			int			t;
-
-			thread->exec_elapsed = (instr_time *)
-				xmalloc(sizeof(instr_time) * num_commands);
-			thread->exec_count = (int *)
-				xmalloc(sizeof(int) * num_commands);
-
-			for (t = 0; t < num_commands; t++)
-			{
-				INSTR_TIME_SET_ZERO(thread->exec_elapsed[t]);
-				thread->exec_count[t] = 0;
-			}
+			thread->exec_hist = (LatencyHist *)
+				xmalloc(sizeof(LatencyHist) * num_commands);
+			memset(thread->exec_hist, 0, sizeof(LatencyHist) * num_commands);
 		}
 		else
-		{
-			thread->exec_elapsed = NULL;
-			thread->exec_count = NULL;
-		}
+			thread->exec_hist = NULL;
 	}
 
 	/* get start up time */
@@ -2323,6 +3147,9 @@ main(int argc, char **argv)
 	/* wait for threads and accumulate results */
 	total_xacts = 0;
 	INSTR_TIME_SET_ZERO(conn_total_time);
+	memset(&txn_hist, 0, sizeof(txn_hist));
+	throttle_lag = 0;
+	throttle_lag_max = 0;
 	for (i = 0; i < nthreads; i++)
 	{
 		void	   *ret = NULL;
@@ -2338,6 +3165,10 @@ main(int argc, char **argv)
 
 			total_xacts += r->xacts;
 			INSTR_TIME_ADD(conn_total_time, r->conn_time);
+			histAdd(&txn_hist, &r->txn_hist);
+			throttle_lag += r->throttle_lag;
+			if (r->throttle_lag_max > throttle_lag_max)
+				throttle_lag_max = r->throttle_lag_max;
 			free(ret);
 		}
 	}
@@ -2347,7 +3178,8 @@ main(int argc, char **argv)
 	INSTR_TIME_SET_CURRENT(total_time);
 	INSTR_TIME_SUBTRACT(total_time, start_time);
 	printResults(ttype, total_xacts, nclients, threads, nthreads,
-				 total_time, conn_total_time);
+				 total_time, conn_total_time,
+				 &txn_hist, throttle_lag, throttle_lag_max);
 
 	return 0;
 }
@@ -2363,6 +3195,12 @@ threadRun(void *arg)
 				end;
 	int			nstate = thread->nstate;
 	int			remains = nstate;		/* number of remaining clients */
+	int64		thread_start;
+	int64		last_report;
+	int64		next_report;
+	int64		last_count = 0;
+	int64		last_latency = 0;
+	int64		last_lag = 0;
 	int			i;
 
 	result = xmalloc(sizeof(TResult));
@@ -2398,8 +3236,14 @@ threadRun(void *arg)
 
 	/* time after thread and connections set up */
 	INSTR_TIME_SET_CURRENT(result->conn_time);
+	thread_start = INSTR_TIME_GET_MICROSEC(result->conn_time);
 	INSTR_TIME_SUBTRACT(result->conn_time, thread->start_time);
 
+	/* the transaction schedule and progress reports start now */
+	thread->throttle_trigger = thread_start;
+	last_report = thread_start;
+	next_report = thread_start + (int64) progress * 1000000;
+
 	/* send start up queries in async manner */
 	for (i = 0; i < nstate; i++)
 	{
@@ -2407,7 +3251,7 @@ threadRun(void *arg)
 		Command   **commands = sql_files[st->use_file];
 		int			prev_ecnt = st->ecnt;
 
-		st->use_file = getrand(thread, 0, num_files - 1);
+		st->use_file = chooseScript(thread);
 		if (!doCustom(thread, st, &result->conn_time, logfile))
 			remains--;			/* I've aborted */
 
@@ -2439,7 +3283,7 @@ threadRun(void *arg)
 
 			if (st->sleeping)
 			{
-				int			this_usec;
+				int64		this_usec;
 
 				if (min_usec == INT64_MAX)
 				{
@@ -2457,7 +3301,7 @@ threadRun(void *arg)
 			{
 				continue;
 			}
-			else if (commands[st->state]->type == META_COMMAND)
+			else if (commands[st->state]->type == META_COMMAND && !st->in_sync)
 			{
 				min_usec = 0;	/* the connection is ready to run */
 				break;
@@ -2476,6 +3320,69 @@ threadRun(void *arg)
 				maxsock = sock;
 		}
 
+		/*
+		 * Report progress when due, and make sure not to wait past the next
+		 * report.  With real threads, thread 0 reports on all of them, reading
+		 * their counters without locking, which at worst makes one report a
+		 * little off; with fork emulation each thread reports on itself.
+		 */
+#ifndef PTHREAD_FORK_EMULATION
+		if (progress > 0 && thread->tid == 0)
+#else
+		if (progress > 0)
+#endif
+		{
+			instr_time	now_time;
+			int64		now;
+
+			INSTR_TIME_SET_CURRENT(now_time);
+			now = INSTR_TIME_GET_MICROSEC(now_time);
+			if (now >= next_report)
+			{
+				int64		count = 0;
+				int64		latency = 0;
+				int64		lag = 0;
+				double		interval = (now - last_report) / 1000000.0;
+				int			nthreads;
+
+#ifndef PTHREAD_FORK_EMULATION
+				nthreads = progress_nthreads;	/* thread 0 heads the array */
+#else
+				nthreads = 1;
+#endif
+				for (i = 0; i < nthreads; i++)
+				{
+					count += thread[i].txn_hist.count;
+					latency += thread[i].txn_hist.sum;
+					lag += thread[i].throttle_lag;
+				}
+
+				fprintf(stderr, "progress: %.1f s, %.1f tps, lat %.3f ms",
+						(now - thread_start) / 1000000.0,
+						(count - last_count) / interval,
+						count > last_count ?
+						(latency - last_latency) / 1000.0 / (count - last_count) : 0.0);
+				if (throttle_delay > 0)
+					fprintf(stderr, ", lag %.3f ms",
+							count > last_count ?
+							(lag - last_lag) / 1000.0 / (count - last_count) : 0.0);
+#ifdef PTHREAD_FORK_EMULATION
+				fprintf(stderr, " (thread %d)", thread->tid);
+#endif
+				fprintf(stderr, "\n");
+
+				last_count = count;
+				last_latency = latency;
+				last_lag = lag;
+				last_report = now;
+				while (next_report <= now)
+					next_report += (int64) progress * 1000000;
+			}
+
+			if (min_usec > next_report - now)
+				min_usec = next_report - now;
+		}
+
 		if (min_usec > 0 && maxsock != -1)
 		{
 			int			nsocks; /* return from select(2) */
@@ -2508,7 +3415,8 @@ threadRun(void *arg)
 			int			prev_ecnt = st->ecnt;
 
 			if (st->con && (FD_ISSET(PQsocket(st->con), &input_mask)
-							|| commands[st->state]->type == META_COMMAND))
+							|| commands[st->state]->type == META_COMMAND
+							|| st->sleeping))
 			{
 				if (!doCustom(thread, st, &result->conn_time, logfile))
 					remains--;	/* I've aborted */
@@ -2530,6 +3438,9 @@ done:
 	result->xacts = 0;
 	for (i = 0; i < nstate; i++)
 		result->xacts += state[i].cnt;
+	result->throttle_lag = thread->throttle_lag;
+	result->throttle_lag_max = thread->throttle_lag_max;
+	memcpy(&result->txn_hist, &thread->txn_hist, sizeof(LatencyHist));
 	INSTR_TIME_SET_CURRENT(end);
 	INSTR_TIME_ACCUM_DIFF(result->conn_time, end, start);
 	if (logfile)
@@ -2617,21 +3528,38 @@ pthread_join(pthread_t th, void **thread_return)
 {
 	int			status;
 
-	while (waitpid(th->pid, &status, 0) != th->pid)
-	{
-		if (errno != EINTR)
-			return errno;
-	}
-
 	if (thread_return != NULL)
 	{
-		/* assume result is TResult */
-		*thread_return = xmalloc(sizeof(TResult));
-		if (read(th->pipes[0], *thread_return, sizeof(TResult)) != sizeof(TResult))
+		/*
+		 * assume result is TResult.  It may not fit in the pipe at once, so
+		 * read it before waiting for the child to exit.
+		 */
+		char	   *buf = xmalloc(sizeof(TResult));
+		size_t		nread = 0;
+
+		while (nread < sizeof(TResult))
+		{
+			ssize_t		rc = read(th->pipes[0], buf + nread,
+								  sizeof(TResult) - nread);
+
+			if (rc < 0 && errno == EINTR)
+				continue;
+			if (rc <= 0)
+				break;
+			nread += rc;
+		}
+		if (nread != sizeof(TResult))
 		{
-			free(*thread_return);
-			*thread_return = NULL;
+			free(buf);
+			buf = NULL;
 		}
+		*thread_return = buf;
+	}
+
+	while (waitpid(th->pid, &status, 0) != th->pid)
+	{
+		if (errno != EINTR)
+			return errno;
 	}
 	close(th->pipes[0]);
 
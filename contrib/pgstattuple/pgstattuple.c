@@ -388,7 +388,6 @@ pgstat_hash_page(pgstattuple_type *stat, Relation rel, BlockNumber blkno)
 	Buffer		buf;
 	Page		page;
 
-	_hash_getlock(rel, blkno, HASH_SHARE);
 	buf = _hash_getbuf(rel, blkno, HASH_READ, 0);
 	page = BufferGetPage(buf);
 
@@ -419,7 +418,6 @@ pgstat_hash_page(pgstattuple_type *stat, Relation rel, BlockNumber blkno)
 	}
 
 	_hash_relbuf(rel, buf);
-	_hash_droplock(rel, blkno, HASH_SHARE);
 }
 
 /*
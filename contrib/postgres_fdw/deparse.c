@@ -0,0 +1,710 @@
+/*-------------------------------------------------------------------------
+ *
+ * deparse.c
+ *		  Query deparser for postgres_fdw
+ *
+ * This file includes functions that examine query WHERE clauses, join
+ * clauses, grouping expressions and sort keys to see whether they're safe
+ * to send to the remote server for execution, as well as functions to
+ * construct the query text to be sent.  We only send expressions that are
+ * built of built-in, immutable functions and operators, on the theory that
+ * the remote server has the same ones and they behave the same way there.
+ * The remote session runs with search_path set to just pg_catalog, so the
+ * names of built-in objects need not be qualified.
+ *
+ * Copyright (c) 2012, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  contrib/postgres_fdw/deparse.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "postgres_fdw.h"
+
+#include "access/reloptions.h"
+#include "access/transam.h"
+#include "catalog/pg_collation.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "commands/defrem.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/planmain.h"
+#include "parser/parsetree.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/syscache.h"
+#include "utils/typcache.h"
+
+
+/*
+ * Context for foreign_expr_walker's search.
+ */
+typedef struct foreign_expr_cxt
+{
+	Relids		relids;			/* relids of the foreign relation */
+	bool		allow_aggs;		/* may aggregates appear here? */
+} foreign_expr_cxt;
+
+/*
+ * Is the object built in, that is, can we assume that the remote server
+ * has it too?
+ */
+#define is_builtin(oid)		((oid) < FirstBootstrapObjectId)
+
+/*
+ * Can a collation be relied upon to sort and compare the same way remotely?
+ * We assume the remote database's default collation matches ours.
+ */
+#define is_shippable_collation(collid) \
+	(!OidIsValid(collid) || (collid) == DEFAULT_COLLATION_OID)
+
+/*
+ * Functions to determine whether an expression can be evaluated safely on
+ * remote server.
+ */
+static bool foreign_expr_walker(Node *node, foreign_expr_cxt *context);
+static bool is_immutable_builtin_func(Oid funcid);
+
+/*
+ * Functions to construct string representation of a node tree.
+ */
+static void deparseVar(StringInfo buf, PlannerInfo *root, Var *node);
+static void deparseConst(StringInfo buf, Const *node);
+static void deparseStringLiteral(StringInfo buf, const char *val);
+static void deparseFuncExpr(StringInfo buf, PlannerInfo *root,
+				FuncExpr *node);
+static void deparseOpExpr(StringInfo buf, PlannerInfo *root, OpExpr *node);
+static void deparseDistinctExpr(StringInfo buf, PlannerInfo *root,
+					DistinctExpr *node);
+static void deparseScalarArrayOpExpr(StringInfo buf, PlannerInfo *root,
+						 ScalarArrayOpExpr *node);
+static void deparseRelabelType(StringInfo buf, PlannerInfo *root,
+				   RelabelType *node);
+static void deparseBoolExpr(StringInfo buf, PlannerInfo *root,
+				BoolExpr *node);
+static void deparseNullTest(StringInfo buf, PlannerInfo *root,
+				NullTest *node);
+static void deparseArrayExpr(StringInfo buf, PlannerInfo *root,
+				 ArrayExpr *node);
+static void deparseAggref(StringInfo buf, PlannerInfo *root, Aggref *node);
+static void deparseExprList(StringInfo buf, PlannerInfo *root, List *args);
+
+
+/*
+ * Returns true if given expr is safe to evaluate on the foreign server.
+ *
+ * The expression may only reference user columns of the relations making up
+ * 'foreignrel'.  Aggregates are accepted only if allow_aggs is true, as
+ * when checking the targetlist or HAVING qual of a grouped query.
+ */
+bool
+is_foreign_expr(PlannerInfo *root, RelOptInfo *foreignrel,
+				Expr *expr, bool allow_aggs)
+{
+	foreign_expr_cxt context;
+
+	context.relids = foreignrel->relids;
+	context.allow_aggs = allow_aggs;
+
+	return !foreign_expr_walker((Node *) expr, &context);
+}
+
+/*
+ * Check if expression is safe to execute remotely; returns true if NOT.
+ *
+ * We accept only the node types we know how to deparse, and check the
+ * functions, operators, types and collations they use.
+ */
+static bool
+foreign_expr_walker(Node *node, foreign_expr_cxt *context)
+{
+	if (node == NULL)
+		return false;
+
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			{
+				Var		   *var = (Var *) node;
+
+				/*
+				 * Only user columns of the foreign relation itself can be
+				 * sent; whole-row and system columns aren't, nor are outer
+				 * references.
+				 */
+				if (var->varlevelsup != 0 ||
+					!bms_is_member(var->varno, context->relids) ||
+					var->varattno <= 0)
+					return true;
+				if (!is_shippable_collation(var->varcollid))
+					return true;
+			}
+			break;
+		case T_Const:
+			{
+				Const	   *c = (Const *) node;
+
+				/* we write the constant's type name into the query */
+				if (!is_builtin(c->consttype) ||
+					!is_shippable_collation(c->constcollid))
+					return true;
+			}
+			break;
+		case T_FuncExpr:
+			{
+				FuncExpr   *fe = (FuncExpr *) node;
+
+				if (fe->funcretset ||
+					!is_immutable_builtin_func(fe->funcid) ||
+					!is_shippable_collation(fe->inputcollid))
+					return true;
+			}
+			break;
+		case T_OpExpr:
+		case T_DistinctExpr:	/* struct-equivalent to OpExpr */
+			{
+				OpExpr	   *oe = (OpExpr *) node;
+
+				set_opfuncid(oe);
+				if (oe->opretset ||
+					!is_builtin(oe->opno) ||
+					!is_immutable_builtin_func(oe->opfuncid) ||
+					!is_shippable_collation(oe->inputcollid))
+					return true;
+			}
+			break;
+		case T_ScalarArrayOpExpr:
+			{
+				ScalarArrayOpExpr *oe = (ScalarArrayOpExpr *) node;
+
+				set_sa_opfuncid(oe);
+				if (!is_builtin(oe->opno) ||
+					!is_immutable_builtin_func(oe->opfuncid) ||
+					!is_shippable_collation(oe->inputcollid))
+					return true;
+			}
+			break;
+		case T_RelabelType:
+			{
+				RelabelType *r = (RelabelType *) node;
+
+				if (!is_builtin(r->resulttype) ||
+					!is_shippable_collation(r->resultcollid))
+					return true;
+			}
+			break;
+		case T_BoolExpr:
+			break;
+		case T_NullTest:
+			/* row-valued tests would need more careful deparsing */
+			if (((NullTest *) node)->argisrow)
+				return true;
+			break;
+		case T_ArrayExpr:
+			{
+				ArrayExpr  *a = (ArrayExpr *) node;
+
+				if (!is_builtin(a->array_typeid) ||
+					!is_shippable_collation(a->array_collid))
+					return true;
+			}
+			break;
+		case T_Aggref:
+			{
+				Aggref	   *agg = (Aggref *) node;
+				bool		result;
+
+				if (!context->allow_aggs || agg->agglevelsup != 0)
+					return true;
+
+				/* ORDER BY and DISTINCT in aggregates aren't handled */
+				if (agg->aggorder != NIL || agg->aggdistinct != NIL)
+					return true;
+				if (!is_builtin(agg->aggfnoid) ||
+					!is_shippable_collation(agg->inputcollid))
+					return true;
+
+				/* aggregates don't nest */
+				context->allow_aggs = false;
+				result = expression_tree_walker((Node *) agg->args,
+												foreign_expr_walker,
+												(void *) context);
+				context->allow_aggs = true;
+				return result;
+			}
+		case T_TargetEntry:
+			/* appears only as an aggregate's argument */
+			break;
+		case T_List:
+			break;
+		default:
+
+			/*
+			 * If it's anything else, assume it's unsafe.  This list can be
+			 * expanded later, but don't forget to add deparse support below.
+			 */
+			return true;
+	}
+
+	return expression_tree_walker(node, foreign_expr_walker,
+								  (void *) context);
+}
+
+/*
+ * Is the function built in and immutable?
+ */
+static bool
+is_immutable_builtin_func(Oid funcid)
+{
+	return is_builtin(funcid) && func_volatile(funcid) == PROVOLATILE_IMMUTABLE;
+}
+
+/*
+ * Can sorting by the given operator be sent to the remote server as a
+ * plain ASC or DESC sort?  That's the case if it is the "<" or ">" of the
+ * default btree opclass of the type; *reverse is set to true for ">".
+ */
+bool
+is_foreign_sort(Oid exprtype, Oid exprcollation, Oid sortop, bool *reverse)
+{
+	TypeCacheEntry *typentry;
+
+	if (!is_builtin(exprtype) || !is_shippable_collation(exprcollation))
+		return false;
+
+	typentry = lookup_type_cache(exprtype,
+								 TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+	if (OidIsValid(sortop) && sortop == typentry->lt_opr)
+		*reverse = false;
+	else if (OidIsValid(sortop) && sortop == typentry->gt_opr)
+		*reverse = true;
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * Append the remote name of a foreign table, followed by its alias
+ * "r<rtindex>", to buf.  Use the schema_name and table_name options of the
+ * table if given, else the local names.
+ */
+void
+deparseRelation(StringInfo buf, Oid relid, Index rtindex)
+{
+	ForeignTable *table;
+	const char *nspname = NULL;
+	const char *relname = NULL;
+	ListCell   *lc;
+
+	table = GetForeignTable(relid);
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "schema_name") == 0)
+			nspname = defGetString(def);
+		else if (strcmp(def->defname, "table_name") == 0)
+			relname = defGetString(def);
+	}
+
+	if (nspname == NULL)
+		nspname = get_namespace_name(get_rel_namespace(relid));
+	if (relname == NULL)
+		relname = get_rel_name(relid);
+
+	appendStringInfo(buf, "%s r%u",
+					 quote_qualified_identifier(nspname, relname), rtindex);
+}
+
+/*
+ * Append a reference to a column of a foreign table, "r<varno>.<name>",
+ * to buf.  The column_name option of the column overrides its local name.
+ */
+void
+deparseColumnRef(StringInfo buf, PlannerInfo *root,
+				 Index varno, AttrNumber varattno)
+{
+	RangeTblEntry *rte = planner_rt_fetch(varno, root);
+	char	   *colname = NULL;
+	HeapTuple	tuple;
+	Datum		datum;
+	bool		isnull;
+
+	Assert(varattno > 0);
+
+	tuple = SearchSysCache2(ATTNUM,
+							ObjectIdGetDatum(rte->relid),
+							Int16GetDatum(varattno));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for attribute %d of relation %u",
+			 varattno, rte->relid);
+
+	datum = SysCacheGetAttr(ATTNUM, tuple,
+							Anum_pg_attribute_attfdwoptions,
+							&isnull);
+	if (!isnull)
+	{
+		List	   *options = untransformRelOptions(datum);
+		ListCell   *lc;
+
+		foreach(lc, options)
+		{
+			DefElem    *def = (DefElem *) lfirst(lc);
+
+			if (strcmp(def->defname, "column_name") == 0)
+				colname = defGetString(def);
+		}
+	}
+	if (colname == NULL)
+		colname = pstrdup(NameStr(((Form_pg_attribute) GETSTRUCT(tuple))->attname));
+
+	ReleaseSysCache(tuple);
+
+	appendStringInfo(buf, "r%u.%s", varno, quote_identifier(colname));
+}
+
+/*
+ * Append the given list of conditions to buf, ANDed together.  The list
+ * may contain bare clauses or RestrictInfos.
+ */
+void
+deparseConditions(StringInfo buf, PlannerInfo *root, List *exprs)
+{
+	ListCell   *lc;
+	bool		first = true;
+
+	foreach(lc, exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+
+		if (IsA(expr, RestrictInfo))
+			expr = ((RestrictInfo *) expr)->clause;
+
+		if (!first)
+			appendStringInfoString(buf, " AND ");
+		first = false;
+
+		appendStringInfoChar(buf, '(');
+		deparseExpr(buf, root, expr);
+		appendStringInfoChar(buf, ')');
+	}
+}
+
+/*
+ * Append the SQL text of an expression to buf.  The expression must have
+ * been found safe by is_foreign_expr.
+ */
+void
+deparseExpr(StringInfo buf, PlannerInfo *root, Expr *node)
+{
+	switch (nodeTag(node))
+	{
+		case T_Var:
+			deparseVar(buf, root, (Var *) node);
+			break;
+		case T_Const:
+			deparseConst(buf, (Const *) node);
+			break;
+		case T_FuncExpr:
+			deparseFuncExpr(buf, root, (FuncExpr *) node);
+			break;
+		case T_OpExpr:
+			deparseOpExpr(buf, root, (OpExpr *) node);
+			break;
+		case T_DistinctExpr:
+			deparseDistinctExpr(buf, root, (DistinctExpr *) node);
+			break;
+		case T_ScalarArrayOpExpr:
+			deparseScalarArrayOpExpr(buf, root, (ScalarArrayOpExpr *) node);
+			break;
+		case T_RelabelType:
+			deparseRelabelType(buf, root, (RelabelType *) node);
+			break;
+		case T_BoolExpr:
+			deparseBoolExpr(buf, root, (BoolExpr *) node);
+			break;
+		case T_NullTest:
+			deparseNullTest(buf, root, (NullTest *) node);
+			break;
+		case T_ArrayExpr:
+			deparseArrayExpr(buf, root, (ArrayExpr *) node);
+			break;
+		case T_Aggref:
+			deparseAggref(buf, root, (Aggref *) node);
+			break;
+		default:
+			elog(ERROR, "unsupported expression type for deparse: %d",
+				 (int) nodeTag(node));
+			break;
+	}
+}
+
+/*
+ * Deparse given Var node into buf.
+ */
+static void
+deparseVar(StringInfo buf, PlannerInfo *root, Var *node)
+{
+	deparseColumnRef(buf, root, node->varno, node->varattno);
+}
+
+/*
+ * Deparse given constant value into buf.
+ *
+ * The value is always written as a quoted literal with an explicit cast, so
+ * that the remote server resolves functions and operators applied to it
+ * the same way we did.
+ */
+static void
+deparseConst(StringInfo buf, Const *node)
+{
+	Oid			typoutput;
+	bool		typIsVarlena;
+	char	   *extval;
+
+	if (node->constisnull)
+		appendStringInfoString(buf, "NULL");
+	else
+	{
+		getTypeOutputInfo(node->consttype, &typoutput, &typIsVarlena);
+		extval = OidOutputFunctionCall(typoutput, node->constvalue);
+		deparseStringLiteral(buf, extval);
+		pfree(extval);
+	}
+
+	appendStringInfo(buf, "::%s",
+					 format_type_with_typemod(node->consttype,
+											  node->consttypmod));
+}
+
+/*
+ * Append a SQL string literal representing "val" to buf.
+ *
+ * We don't know the remote server's standard_conforming_strings setting,
+ * so use the E'' syntax if the value contains any backslashes.
+ */
+static void
+deparseStringLiteral(StringInfo buf, const char *val)
+{
+	const char *valptr;
+
+	if (strchr(val, '\\') != NULL)
+		appendStringInfoChar(buf, ESCAPE_STRING_SYNTAX);
+	appendStringInfoChar(buf, '\'');
+	for (valptr = val; *valptr; valptr++)
+	{
+		char		ch = *valptr;
+
+		if (SQL_STR_DOUBLE(ch, true))
+			appendStringInfoChar(buf, ch);
+		appendStringInfoChar(buf, ch);
+	}
+	appendStringInfoChar(buf, '\'');
+}
+
+/*
+ * Deparse a function call, including casts done by cast functions.
+ */
+static void
+deparseFuncExpr(StringInfo buf, PlannerInfo *root, FuncExpr *node)
+{
+	appendStringInfo(buf, "%s(",
+					 quote_identifier(get_func_name(node->funcid)));
+	deparseExprList(buf, root, node->args);
+	appendStringInfoChar(buf, ')');
+}
+
+/*
+ * Deparse an operator invocation, which may be prefix, postfix or infix.
+ */
+static void
+deparseOpExpr(StringInfo buf, PlannerInfo *root, OpExpr *node)
+{
+	char	   *opname = get_opname(node->opno);
+	Oid			lefttype;
+	Oid			righttype;
+
+	op_input_types(node->opno, &lefttype, &righttype);
+
+	appendStringInfoChar(buf, '(');
+	if (!OidIsValid(lefttype))
+	{
+		/* prefix operator */
+		appendStringInfo(buf, "%s ", opname);
+		deparseExpr(buf, root, linitial(node->args));
+	}
+	else if (!OidIsValid(righttype))
+	{
+		/* postfix operator */
+		deparseExpr(buf, root, linitial(node->args));
+		appendStringInfo(buf, " %s", opname);
+	}
+	else
+	{
+		deparseExpr(buf, root, linitial(node->args));
+		appendStringInfo(buf, " %s ", opname);
+		deparseExpr(buf, root, lsecond(node->args));
+	}
+	appendStringInfoChar(buf, ')');
+}
+
+/*
+ * Deparse IS DISTINCT FROM.
+ */
+static void
+deparseDistinctExpr(StringInfo buf, PlannerInfo *root, DistinctExpr *node)
+{
+	Assert(list_length(node->args) == 2);
+
+	appendStringInfoChar(buf, '(');
+	deparseExpr(buf, root, linitial(node->args));
+	appendStringInfoString(buf, " IS DISTINCT FROM ");
+	deparseExpr(buf, root, lsecond(node->args));
+	appendStringInfoChar(buf, ')');
+}
+
+/*
+ * Deparse "expr op ANY (array)" or "expr op ALL (array)".
+ */
+static void
+deparseScalarArrayOpExpr(StringInfo buf, PlannerInfo *root,
+						 ScalarArrayOpExpr *node)
+{
+	Assert(list_length(node->args) == 2);
+
+	appendStringInfoChar(buf, '(');
+	deparseExpr(buf, root, linitial(node->args));
+	appendStringInfo(buf, " %s %s (", get_opname(node->opno),
+					 node->useOr ? "ANY" : "ALL");
+	deparseExpr(buf, root, lsecond(node->args));
+	appendStringInfoString(buf, "))");
+}
+
+/*
+ * Deparse a binary-compatible relabeling.  Only explicit casts are written
+ * out; implicit ones are left for the remote parser to redo.
+ */
+static void
+deparseRelabelType(StringInfo buf, PlannerInfo *root, RelabelType *node)
+{
+	if (node->relabelformat == COERCE_EXPLICIT_CAST)
+	{
+		appendStringInfoChar(buf, '(');
+		deparseExpr(buf, root, node->arg);
+		appendStringInfo(buf, ")::%s",
+						 format_type_with_typemod(node->resulttype,
+												  node->resulttypmod));
+	}
+	else
+		deparseExpr(buf, root, node->arg);
+}
+
+/*
+ * Deparse AND, OR and NOT.
+ */
+static void
+deparseBoolExpr(StringInfo buf, PlannerInfo *root, BoolExpr *node)
+{
+	const char *op = NULL;
+	bool		first;
+	ListCell   *lc;
+
+	switch (node->boolop)
+	{
+		case AND_EXPR:
+			op = "AND";
+			break;
+		case OR_EXPR:
+			op = "OR";
+			break;
+		case NOT_EXPR:
+			appendStringInfoString(buf, "(NOT ");
+			deparseExpr(buf, root, linitial(node->args));
+			appendStringInfoChar(buf, ')');
+			return;
+	}
+
+	appendStringInfoChar(buf, '(');
+	first = true;
+	foreach(lc, node->args)
+	{
+		if (!first)
+			appendStringInfo(buf, " %s ", op);
+		deparseExpr(buf, root, (Expr *) lfirst(lc));
+		first = false;
+	}
+	appendStringInfoChar(buf, ')');
+}
+
+/*
+ * Deparse IS [NOT] NULL.
+ */
+static void
+deparseNullTest(StringInfo buf, PlannerInfo *root, NullTest *node)
+{
+	appendStringInfoChar(buf, '(');
+	deparseExpr(buf, root, node->arg);
+	if (node->nulltesttype == IS_NULL)
+		appendStringInfoString(buf, " IS NULL)");
+	else
+		appendStringInfoString(buf, " IS NOT NULL)");
+}
+
+/*
+ * Deparse ARRAY[...], with a cast so that empty arrays get the right type.
+ */
+static void
+deparseArrayExpr(StringInfo buf, PlannerInfo *root, ArrayExpr *node)
+{
+	appendStringInfoString(buf, "ARRAY[");
+	deparseExprList(buf, root, node->elements);
+	appendStringInfo(buf, "]::%s",
+					 format_type_with_typemod(node->array_typeid, -1));
+}
+
+/*
+ * Deparse an aggregate call.
+ */
+static void
+deparseAggref(StringInfo buf, PlannerInfo *root, Aggref *node)
+{
+	ListCell   *lc;
+	bool		first = true;
+
+	appendStringInfo(buf, "%s(",
+					 quote_identifier(get_func_name(node->aggfnoid)));
+	if (node->aggstar)
+		appendStringInfoChar(buf, '*');
+	foreach(lc, node->args)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		if (!first)
+			appendStringInfoString(buf, ", ");
+		deparseExpr(buf, root, tle->expr);
+		first = false;
+	}
+	appendStringInfoChar(buf, ')');
+}
+
+/*
+ * Deparse a comma-separated list of expressions.
+ */
+static void
+deparseExprList(StringInfo buf, PlannerInfo *root, List *args)
+{
+	ListCell   *lc;
+	bool		first = true;
+
+	foreach(lc, args)
+	{
+		if (!first)
+			appendStringInfoString(buf, ", ");
+		deparseExpr(buf, root, (Expr *) lfirst(lc));
+		first = false;
+	}
+}
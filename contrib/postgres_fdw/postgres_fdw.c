@@ -0,0 +1,1475 @@
+/*-------------------------------------------------------------------------
+ *
+ * postgres_fdw.c
+ *		  foreign-data wrapper for remote PostgreSQL servers
+ *
+ * Besides scanning a foreign table, this wrapper can have the remote server
+ * do more of the work of a query: it pushes down the restriction clauses
+ * it can, joins between foreign tables on the same server, the query's
+ * ORDER BY and LIMIT, and grouping and aggregation, so that only the rows
+ * the query really needs are sent over the network.
+ *
+ * Scans of servers or tables with the async_capable option can also be run
+ * asynchronously under an Append: each sends its FETCH without waiting for
+ * the result, so that several remote servers work at once.
+ *
+ * Copyright (c) 2012, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  contrib/postgres_fdw/postgres_fdw.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "postgres_fdw.h"
+
+#include "access/heapam.h"
+#include "access/sysattr.h"
+#include "catalog/pg_collation.h"
+#include "commands/defrem.h"
+#include "commands/explain.h"
+#include "foreign/fdwapi.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/cost.h"
+#include "optimizer/pathnode.h"
+#include "optimizer/tlist.h"
+#include "optimizer/var.h"
+#include "parser/parsetree.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/typcache.h"
+
+PG_MODULE_MAGIC;
+
+/* Default CPU cost to start up a foreign query. */
+#define DEFAULT_FDW_STARTUP_COST	100.0
+
+/* Default CPU cost to process 1 row (above and beyond cpu_tuple_cost). */
+#define DEFAULT_FDW_TUPLE_COST		0.01
+
+/* Number of rows fetched from the remote cursor at a time */
+#define FETCH_SIZE					100
+
+/*
+ * Indexes of FDW-private information stored in FdwPlan.fdw_private:
+ *
+ * 1) the text of the remote query, as a String node
+ * 2) an integer List of the attribute numbers, in the scan tuple, of the
+ *	  columns the query returns
+ */
+enum FdwScanPrivateIndex
+{
+	FdwScanPrivateSelectSql,
+	FdwScanPrivateRetrievedAttrs
+};
+
+/*
+ * Execution state of a foreign scan using postgres_fdw.
+ */
+typedef struct PgFdwScanState
+{
+	/* extracted fdw_private data */
+	char	   *query;			/* text of SELECT command */
+	List	   *retrieved_attrs;	/* list of retrieved attribute numbers */
+
+	/* for converting the rows we get into scan tuples */
+	TupleDesc	tupdesc;
+	AttInMetadata *attinmeta;
+
+	/* for remote query execution */
+	PGconn	   *conn;			/* connection for the scan */
+	PgFdwConnState *conn_state; /* execution state of the connection */
+	unsigned int cursor_number; /* quasi-unique ID for my cursor */
+	bool		cursor_exists;	/* have we created the cursor? */
+	bool		async_capable;	/* may we run asynchronously? */
+	bool		fetch_pending;	/* is a FETCH in progress on conn? */
+
+	/* for storing result tuples */
+	HeapTuple  *tuples;			/* array of currently-retrieved tuples */
+	int			num_tuples;		/* # of tuples in array */
+	int			next_tuple;		/* index of next one to return */
+	bool		eof_reached;	/* true if last fetch reached EOF */
+
+	/* working memory context */
+	MemoryContext batch_cxt;	/* context holding current batch of tuples */
+} PgFdwScanState;
+
+/*
+ * SQL functions
+ */
+extern Datum postgres_fdw_handler(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(postgres_fdw_handler);
+
+/*
+ * FDW callback routines
+ */
+static FdwPlan *postgresPlanForeignScan(Oid foreigntableid,
+						PlannerInfo *root,
+						RelOptInfo *baserel);
+static FdwPlan *postgresPlanForeignJoin(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						RelOptInfo *outerrel,
+						RelOptInfo *innerrel,
+						JoinType jointype,
+						SpecialJoinInfo *sjinfo,
+						List *restrictlist);
+static FdwPlan *postgresPlanForeignGrouping(PlannerInfo *root,
+							RelOptInfo *rel,
+							List *tlist,
+							double num_groups);
+static void postgresExplainForeignScan(ForeignScanState *node,
+						   ExplainState *es);
+static void postgresBeginForeignScan(ForeignScanState *node, int eflags);
+static TupleTableSlot *postgresIterateForeignScan(ForeignScanState *node);
+static void postgresReScanForeignScan(ForeignScanState *node);
+static void postgresEndForeignScan(ForeignScanState *node);
+static bool postgresStartAsyncForeignScan(ForeignScanState *node);
+static pgsocket postgresPollAsyncForeignScan(ForeignScanState *node);
+
+/*
+ * Helper functions
+ */
+static void apply_server_options(PgFdwRelationInfo *fpinfo);
+static void apply_table_options(PgFdwRelationInfo *fpinfo, List *options);
+static bool rel_is_whole_query(PlannerInfo *root, RelOptInfo *rel);
+static List *append_sort_and_limit(StringInfo sql, PlannerInfo *root,
+					  RelOptInfo *rel, double *rows);
+static FdwPlan *make_fdwplan(PgFdwRelationInfo *fpinfo, StringInfo sql,
+			 List *retrieved_attrs, double retrieved_rows,
+			 Cost remote_cost);
+static void get_remote_estimate(PgFdwRelationInfo *fpinfo, const char *sql,
+					double *rows, Cost *startup_cost, Cost *total_cost);
+static bool get_async_capable(ForeignServer *server, Oid relid);
+static void send_fetch_request(PgFdwScanState *festate);
+static void fetch_more_data(PgFdwScanState *festate);
+static void close_cursor(PgFdwScanState *festate);
+static HeapTuple make_tuple_from_result_row(PGresult *res, int row,
+						   TupleDesc tupdesc,
+						   AttInMetadata *attinmeta,
+						   List *retrieved_attrs);
+
+
+/*
+ * Foreign-data wrapper handler function: return a struct with pointers
+ * to my callback routines.
+ */
+Datum
+postgres_fdw_handler(PG_FUNCTION_ARGS)
+{
+	FdwRoutine *routine = makeNode(FdwRoutine);
+
+	routine->PlanForeignScan = postgresPlanForeignScan;
+	routine->ExplainForeignScan = postgresExplainForeignScan;
+	routine->BeginForeignScan = postgresBeginForeignScan;
+	routine->IterateForeignScan = postgresIterateForeignScan;
+	routine->ReScanForeignScan = postgresReScanForeignScan;
+	routine->EndForeignScan = postgresEndForeignScan;
+	routine->PlanForeignJoin = postgresPlanForeignJoin;
+	routine->PlanForeignGrouping = postgresPlanForeignGrouping;
+	routine->StartAsyncForeignScan = postgresStartAsyncForeignScan;
+	routine->PollAsyncForeignScan = postgresPollAsyncForeignScan;
+
+	PG_RETURN_POINTER(routine);
+}
+
+/*
+ * postgresPlanForeignScan
+ *		Create a FdwPlan for a scan on the foreign table
+ *
+ * We also set up the PgFdwRelationInfo of the relation here, which is what
+ * later decides whether joins and grouping involving it can be pushed down.
+ */
+static FdwPlan *
+postgresPlanForeignScan(Oid foreigntableid,
+						PlannerInfo *root,
+						RelOptInfo *baserel)
+{
+	PgFdwRelationInfo *fpinfo;
+	RangeTblEntry *rte = planner_rt_fetch(baserel->relid, root);
+	ForeignTable *table;
+	Relation	rel;
+	TupleDesc	tupdesc;
+	StringInfoData sql;
+	List	   *retrieved_attrs = NIL;
+	bool		have_wholerow;
+	bool		first;
+	double		retrieved_rows;
+	Cost		remote_cost;
+	QualCost	local_cost;
+	Selectivity local_selectivity;
+	List	   *pathkeys;
+	FdwPlan    *fdwplan;
+	ListCell   *lc;
+	int			i;
+
+	fpinfo = (PgFdwRelationInfo *) palloc0(sizeof(PgFdwRelationInfo));
+	baserel->fdw_private = (void *) fpinfo;
+
+	/*
+	 * Identify which user to do the remote access as.  This should match
+	 * what ExecCheckRTEPerms() does.
+	 */
+	fpinfo->userid = OidIsValid(rte->checkAsUser) ? rte->checkAsUser : GetUserId();
+
+	table = GetForeignTable(foreigntableid);
+	fpinfo->server = GetForeignServer(table->serverid);
+	fpinfo->user = GetUserMapping(fpinfo->userid, fpinfo->server->serverid);
+	apply_server_options(fpinfo);
+	apply_table_options(fpinfo, table->options);
+
+	/*
+	 * Identify which restriction clauses can be sent to the remote server
+	 * and which can't.  Pseudoconstant clauses are left to the planner.
+	 */
+	foreach(lc, baserel->baserestrictinfo)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		if (ri->pseudoconstant)
+			continue;
+		if (is_foreign_expr(root, baserel, ri->clause, false))
+		{
+			fpinfo->remote_conds = lappend(fpinfo->remote_conds, ri);
+			fpinfo->where_conds = lappend(fpinfo->where_conds, ri->clause);
+		}
+		else
+			fpinfo->local_conds = lappend(fpinfo->local_conds, ri);
+	}
+
+	/*
+	 * Identify which attributes will need to be retrieved from the remote
+	 * server: those needed by the query above the scan, and those needed by
+	 * the local conditions.
+	 */
+	pull_varattnos((Node *) baserel->reltargetlist, baserel->relid,
+				   &fpinfo->attrs_used);
+	foreach(lc, fpinfo->local_conds)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		pull_varattnos((Node *) ri->clause, baserel->relid,
+					   &fpinfo->attrs_used);
+	}
+
+	initStringInfo(&sql);
+	deparseRelation(&sql, rte->relid, baserel->relid);
+	fpinfo->relation_sql = sql.data;
+
+	/*
+	 * Construct the remote query.  If a whole-row value is needed, we fetch
+	 * all the columns.  System columns aren't fetched at all; they read as
+	 * null.
+	 */
+	initStringInfo(&sql);
+	appendStringInfoString(&sql, "SELECT ");
+	have_wholerow = bms_is_member(0 - FirstLowInvalidHeapAttributeNumber,
+								  fpinfo->attrs_used);
+	rel = heap_open(rte->relid, NoLock);
+	tupdesc = RelationGetDescr(rel);
+	first = true;
+	for (i = 1; i <= tupdesc->natts; i++)
+	{
+		/* Ignore dropped attributes. */
+		if (tupdesc->attrs[i - 1]->attisdropped)
+			continue;
+
+		if (have_wholerow ||
+			bms_is_member(i - FirstLowInvalidHeapAttributeNumber,
+						  fpinfo->attrs_used))
+		{
+			if (!first)
+				appendStringInfoString(&sql, ", ");
+			first = false;
+			deparseColumnRef(&sql, root, baserel->relid, i);
+			retrieved_attrs = lappend_int(retrieved_attrs, i);
+		}
+	}
+	heap_close(rel, NoLock);
+
+	/* Don't generate bad syntax if no undropped columns are needed */
+	if (first)
+		appendStringInfoString(&sql, "NULL");
+
+	appendStringInfo(&sql, " FROM %s", fpinfo->relation_sql);
+	if (fpinfo->where_conds != NIL)
+	{
+		appendStringInfoString(&sql, " WHERE ");
+		deparseConditions(&sql, root, fpinfo->where_conds);
+	}
+
+	/*
+	 * Estimate the number of rows the remote query returns, and what it
+	 * costs the remote server to produce them.  Without remote estimates, we
+	 * start from the default size the planner gave the table.
+	 */
+	local_selectivity = clauselist_selectivity(root, fpinfo->local_conds,
+											   baserel->relid, JOIN_INNER,
+											   NULL);
+	if (fpinfo->use_remote_estimate)
+	{
+		Cost		startup_cost;
+		Cost		total_cost;
+
+		get_remote_estimate(fpinfo, sql.data, &retrieved_rows,
+							&startup_cost, &total_cost);
+		remote_cost = total_cost;
+	}
+	else
+	{
+		retrieved_rows = baserel->rows *
+			clauselist_selectivity(root, fpinfo->remote_conds,
+								   baserel->relid, JOIN_INNER, NULL);
+		remote_cost = cpu_tuple_cost * baserel->rows;
+	}
+	retrieved_rows = clamp_row_est(retrieved_rows);
+	baserel->rows = clamp_row_est(retrieved_rows * local_selectivity);
+
+	/* Add the local conditions' cost as the scan node evaluates them */
+	cost_qual_eval(&local_cost, fpinfo->local_conds, root);
+	remote_cost += local_cost.startup +
+		local_cost.per_tuple * retrieved_rows;
+
+	/* Have the remote server sort and limit the rows, if we can */
+	pathkeys = append_sort_and_limit(&sql, root, baserel, &retrieved_rows);
+
+	fdwplan = make_fdwplan(fpinfo, &sql, retrieved_attrs,
+						   retrieved_rows, remote_cost);
+	fdwplan->remote_conds = fpinfo->where_conds;
+	fdwplan->pathkeys = pathkeys;
+
+	return fdwplan;
+}
+
+/*
+ * postgresPlanForeignJoin
+ *		Create a FdwPlan that performs a join between foreign tables on the
+ *		remote server, if that's possible
+ *
+ * The planner calls us for every pair of input relations it considers
+ * for the join relation; we only plan the join the first time we're
+ * asked, as the remote server will choose its own join order anyway.
+ */
+static FdwPlan *
+postgresPlanForeignJoin(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						RelOptInfo *outerrel,
+						RelOptInfo *innerrel,
+						JoinType jointype,
+						SpecialJoinInfo *sjinfo,
+						List *restrictlist)
+{
+	PgFdwRelationInfo *fpinfo;
+	PgFdwRelationInfo *fpinfo_o = (PgFdwRelationInfo *) outerrel->fdw_private;
+	PgFdwRelationInfo *fpinfo_i = (PgFdwRelationInfo *) innerrel->fdw_private;
+	List	   *joinclauses = NIL;
+	List	   *otherclauses = NIL;
+	List	   *on_conds;
+	List	   *remote_conds = NIL;
+	List	   *retrieved_attrs = NIL;
+	const char *join_sql;
+	StringInfoData sql;
+	double		retrieved_rows;
+	Cost		remote_cost;
+	List	   *pathkeys;
+	FdwPlan    *fdwplan;
+	ListCell   *lc;
+	int			i;
+
+	/* Already planned, from another pair of inputs? */
+	if (joinrel->fdw_private != NULL)
+		return NULL;
+
+	switch (jointype)
+	{
+		case JOIN_INNER:
+			join_sql = "INNER";
+			break;
+		case JOIN_LEFT:
+			join_sql = "LEFT";
+			break;
+		case JOIN_RIGHT:
+			join_sql = "RIGHT";
+			break;
+		case JOIN_FULL:
+			join_sql = "FULL";
+			break;
+		default:
+			/* semi- and anti-joins aren't supported */
+			return NULL;
+	}
+
+	/*
+	 * Both inputs must be relations we can scan entirely remotely, with the
+	 * same user mapping.
+	 */
+	if (fpinfo_o == NULL || fpinfo_i == NULL ||
+		fpinfo_o->local_conds != NIL || fpinfo_i->local_conds != NIL ||
+		fpinfo_o->userid != fpinfo_i->userid)
+		return NULL;
+
+	/* We can only return plain user columns, see retrieved_attrs below */
+	foreach(lc, joinrel->reltargetlist)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) || var->varattno <= 0)
+			return NULL;
+	}
+
+	/*
+	 * All the join's clauses must be evaluated remotely.  Those that aren't
+	 * pushed down belong to the join itself; the others filter its result.
+	 */
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *ri = (RestrictInfo *) lfirst(lc);
+
+		if (ri->pseudoconstant)
+			continue;
+		if (!is_foreign_expr(root, joinrel, ri->clause, false))
+			return NULL;
+
+		remote_conds = lappend(remote_conds, ri->clause);
+		if (jointype == JOIN_INNER || !ri->is_pushed_down)
+			joinclauses = lappend(joinclauses, ri->clause);
+		else
+			otherclauses = lappend(otherclauses, ri->clause);
+	}
+
+	fpinfo = (PgFdwRelationInfo *) palloc0(sizeof(PgFdwRelationInfo));
+	fpinfo->userid = fpinfo_o->userid;
+	fpinfo->server = fpinfo_o->server;
+	fpinfo->user = fpinfo_o->user;
+	fpinfo->use_remote_estimate = (fpinfo_o->use_remote_estimate ||
+								   fpinfo_i->use_remote_estimate);
+	fpinfo->fdw_startup_cost = fpinfo_o->fdw_startup_cost;
+	fpinfo->fdw_tuple_cost = fpinfo_o->fdw_tuple_cost;
+
+	/*
+	 * Place the conditions of the inputs.  Those of the nullable side of an
+	 * outer join have to filter its rows before the join, so they go in the
+	 * ON clause; those of the preserved side can equally well be applied to
+	 * the join's result.  A full join has no side to put them on.
+	 */
+	switch (jointype)
+	{
+		case JOIN_INNER:
+			on_conds = joinclauses;
+			fpinfo->where_conds = list_concat(list_copy(fpinfo_o->where_conds),
+											  fpinfo_i->where_conds);
+			break;
+		case JOIN_LEFT:
+			on_conds = list_concat(joinclauses,
+								   list_copy(fpinfo_i->where_conds));
+			fpinfo->where_conds = list_concat(list_copy(fpinfo_o->where_conds),
+											  otherclauses);
+			break;
+		case JOIN_RIGHT:
+			on_conds = list_concat(joinclauses,
+								   list_copy(fpinfo_o->where_conds));
+			fpinfo->where_conds = list_concat(list_copy(fpinfo_i->where_conds),
+											  otherclauses);
+			break;
+		default:
+			if (fpinfo_o->where_conds != NIL || fpinfo_i->where_conds != NIL)
+			{
+				pfree(fpinfo);
+				return NULL;
+			}
+			on_conds = joinclauses;
+			fpinfo->where_conds = otherclauses;
+			break;
+	}
+
+	initStringInfo(&sql);
+	appendStringInfo(&sql, "(%s %s JOIN %s ON ",
+					 fpinfo_o->relation_sql, join_sql,
+					 fpinfo_i->relation_sql);
+	if (on_conds != NIL)
+		deparseConditions(&sql, root, on_conds);
+	else
+		appendStringInfoString(&sql, "(TRUE)");
+	appendStringInfoChar(&sql, ')');
+	fpinfo->relation_sql = sql.data;
+
+	/*
+	 * The scan tuples of a remote join are made up of the join relation's
+	 * targetlist columns, in order.
+	 */
+	initStringInfo(&sql);
+	appendStringInfoString(&sql, "SELECT ");
+	i = 0;
+	foreach(lc, joinrel->reltargetlist)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (i > 0)
+			appendStringInfoString(&sql, ", ");
+		deparseColumnRef(&sql, root, var->varno, var->varattno);
+		retrieved_attrs = lappend_int(retrieved_attrs, ++i);
+	}
+	if (i == 0)
+		appendStringInfoString(&sql, "NULL");
+	appendStringInfo(&sql, " FROM %s", fpinfo->relation_sql);
+	if (fpinfo->where_conds != NIL)
+	{
+		appendStringInfoString(&sql, " WHERE ");
+		deparseConditions(&sql, root, fpinfo->where_conds);
+	}
+
+	/*
+	 * The planner has estimated the join size already.  We assume that the
+	 * remote server does about as much work to join the rows as to return
+	 * them.
+	 */
+	if (fpinfo->use_remote_estimate)
+	{
+		Cost		startup_cost;
+
+		get_remote_estimate(fpinfo, sql.data, &retrieved_rows,
+							&startup_cost, &remote_cost);
+	}
+	else
+	{
+		retrieved_rows = joinrel->rows;
+		remote_cost = cpu_tuple_cost *
+			(outerrel->rows + innerrel->rows + joinrel->rows);
+	}
+
+	joinrel->fdw_private = (void *) fpinfo;
+
+	pathkeys = append_sort_and_limit(&sql, root, joinrel, &retrieved_rows);
+
+	fdwplan = make_fdwplan(fpinfo, &sql, retrieved_attrs,
+						   retrieved_rows, remote_cost);
+	fdwplan->remote_conds = remote_conds;
+	fdwplan->pathkeys = pathkeys;
+
+	return fdwplan;
+}
+
+/*
+ * postgresPlanForeignGrouping
+ *		Create a FdwPlan that computes the grouped result of the query on
+ *		the remote server, if that's possible
+ *
+ * 'rel' is the scan/join relation of the whole query, and 'tlist' the
+ * final targetlist; the remote query returns exactly its columns.  We also
+ * push down the HAVING qual, and the ORDER BY and LIMIT when we can.
+ */
+static FdwPlan *
+postgresPlanForeignGrouping(PlannerInfo *root,
+							RelOptInfo *rel,
+							List *tlist,
+							double num_groups)
+{
+	Query	   *parse = root->parse;
+	PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) rel->fdw_private;
+	StringInfoData sql;
+	List	   *retrieved_attrs = NIL;
+	List	   *pathkeys = NIL;
+	bool		sorted;
+	Cost		remote_cost;
+	FdwPlan    *fdwplan;
+	ListCell   *lc;
+	int			i;
+
+	/* The relation itself must be computed remotely in full */
+	if (fpinfo == NULL || fpinfo->local_conds != NIL || tlist == NIL)
+		return NULL;
+
+	/* Every output column, and the HAVING qual, must be computable there */
+	foreach(lc, tlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		if (!is_foreign_expr(root, rel, tle->expr, true))
+			return NULL;
+	}
+	if (parse->havingQual &&
+		!is_foreign_expr(root, rel, (Expr *) parse->havingQual, true))
+		return NULL;
+
+	/* The grouping must use the types' default notion of equality */
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+		Node	   *expr = get_sortgroupclause_expr(sgc, tlist);
+		TypeCacheEntry *typentry;
+
+		typentry = lookup_type_cache(exprType(expr), TYPECACHE_EQ_OPR);
+		if (sgc->eqop != typentry->eq_opr ||
+			(OidIsValid(exprCollation(expr)) &&
+			 exprCollation(expr) != DEFAULT_COLLATION_OID))
+			return NULL;
+	}
+
+	/* Construct the query; the output columns are referenced by position */
+	initStringInfo(&sql);
+	appendStringInfoString(&sql, "SELECT ");
+	i = 0;
+	foreach(lc, tlist)
+	{
+		TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+		if (i > 0)
+			appendStringInfoString(&sql, ", ");
+		deparseExpr(&sql, root, tle->expr);
+		retrieved_attrs = lappend_int(retrieved_attrs, ++i);
+	}
+	appendStringInfo(&sql, " FROM %s", fpinfo->relation_sql);
+	if (fpinfo->where_conds != NIL)
+	{
+		appendStringInfoString(&sql, " WHERE ");
+		deparseConditions(&sql, root, fpinfo->where_conds);
+	}
+	if (parse->groupClause != NIL)
+	{
+		appendStringInfoString(&sql, " GROUP BY ");
+		i = 0;
+		foreach(lc, parse->groupClause)
+		{
+			SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+			TargetEntry *tle = get_sortgroupclause_tle(sgc, tlist);
+
+			appendStringInfo(&sql, "%s%d", (i++ > 0) ? ", " : "",
+							 tle->resno);
+		}
+	}
+	if (parse->havingQual)
+	{
+		appendStringInfoString(&sql, " HAVING ");
+		deparseConditions(&sql, root, (List *) parse->havingQual);
+	}
+
+	/*
+	 * ORDER BY can be sent if each sort column uses its type's default sort
+	 * order.  Not if there's DISTINCT, which is done locally on top.
+	 */
+	sorted = (parse->sortClause == NIL);
+	if (parse->sortClause != NIL && parse->distinctClause == NIL)
+	{
+		StringInfoData orderby;
+
+		initStringInfo(&orderby);
+		sorted = true;
+		foreach(lc, parse->sortClause)
+		{
+			SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+			TargetEntry *tle = get_sortgroupclause_tle(sgc, tlist);
+			bool		reverse;
+
+			if (!is_foreign_sort(exprType((Node *) tle->expr),
+								 exprCollation((Node *) tle->expr),
+								 sgc->sortop, &reverse))
+			{
+				sorted = false;
+				break;
+			}
+			appendStringInfo(&orderby, "%s%d %s NULLS %s",
+							 (orderby.len > 0) ? ", " : "",
+							 tle->resno,
+							 reverse ? "DESC" : "ASC",
+							 sgc->nulls_first ? "FIRST" : "LAST");
+		}
+		if (sorted)
+		{
+			appendStringInfo(&sql, " ORDER BY %s", orderby.data);
+			pathkeys = root->sort_pathkeys;
+		}
+		pfree(orderby.data);
+	}
+
+	/*
+	 * LIMIT can be sent if the rows come out in the right order.  The remote
+	 * server has to return the skipped OFFSET rows too, since the Limit node
+	 * above us still applies the offset.
+	 */
+	if (sorted && parse->distinctClause == NIL &&
+		parse->limitCount && IsA(parse->limitCount, Const) &&
+		!((Const *) parse->limitCount)->constisnull &&
+		(parse->limitOffset == NULL ||
+		 (IsA(parse->limitOffset, Const) &&
+		  !((Const *) parse->limitOffset)->constisnull)))
+	{
+		int64		count;
+		int64		offset = 0;
+
+		count = DatumGetInt64(((Const *) parse->limitCount)->constvalue);
+		if (parse->limitOffset)
+			offset = DatumGetInt64(((Const *) parse->limitOffset)->constvalue);
+		if (count >= 0 && offset >= 0)
+		{
+			appendStringInfo(&sql, " LIMIT " INT64_FORMAT, count + offset);
+			num_groups = Min(num_groups, (double) (count + offset));
+		}
+	}
+
+	/*
+	 * The remote server reads the rows of the relation and aggregates them;
+	 * we only receive the groups.
+	 */
+	if (fpinfo->use_remote_estimate)
+	{
+		Cost		startup_cost;
+
+		get_remote_estimate(fpinfo, sql.data, &num_groups,
+							&startup_cost, &remote_cost);
+	}
+	else
+		remote_cost = (cpu_tuple_cost + cpu_operator_cost) * rel->rows;
+
+	fdwplan = make_fdwplan(fpinfo, &sql, retrieved_attrs,
+						   clamp_row_est(num_groups), remote_cost);
+	fdwplan->pathkeys = pathkeys;
+	return fdwplan;
+}
+
+/*
+ * postgresExplainForeignScan
+ *		Produce extra output for EXPLAIN
+ */
+static void
+postgresExplainForeignScan(ForeignScanState *node, ExplainState *es)
+{
+	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+	List	   *fdw_private = fsplan->fdwplan->fdw_private;
+
+	if (es->verbose)
+	{
+		char	   *sql;
+
+		sql = strVal(list_nth(fdw_private, FdwScanPrivateSelectSql));
+		ExplainPropertyText("Remote SQL", sql, es);
+	}
+}
+
+/*
+ * postgresBeginForeignScan
+ *		Initiate an executor scan of a foreign PostgreSQL table.
+ */
+static void
+postgresBeginForeignScan(ForeignScanState *node, int eflags)
+{
+	ForeignScan *fsplan = (ForeignScan *) node->ss.ps.plan;
+	EState	   *estate = node->ss.ps.state;
+	List	   *fdw_private = fsplan->fdwplan->fdw_private;
+	PgFdwScanState *festate;
+	RangeTblEntry *rte;
+	Index		rtindex;
+	Oid			userid;
+	ForeignServer *server;
+	UserMapping *user;
+
+	/*
+	 * Do nothing in EXPLAIN (no ANALYZE) case.  node->fdw_state stays NULL.
+	 */
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return;
+
+	/*
+	 * We'll save private state in node->fdw_state.
+	 */
+	festate = (PgFdwScanState *) palloc0(sizeof(PgFdwScanState));
+	node->fdw_state = (void *) festate;
+
+	/*
+	 * Identify which user to do the remote access as.  This should match
+	 * what ExecCheckRTEPerms() does.  For a join or grouping scan, all the
+	 * relations involved were checked to use the same user at plan time.
+	 */
+	if (fsplan->scan.scanrelid > 0)
+		rtindex = fsplan->scan.scanrelid;
+	else
+	{
+		Bitmapset  *tmprelids = bms_copy(fsplan->fs_relids);
+
+		rtindex = bms_first_member(tmprelids);
+		bms_free(tmprelids);
+	}
+	rte = rt_fetch(rtindex, estate->es_range_table);
+	userid = OidIsValid(rte->checkAsUser) ? rte->checkAsUser : GetUserId();
+
+	/* Get info about foreign server and user mapping. */
+	server = GetForeignServer(fsplan->fs_server);
+	user = GetUserMapping(userid, server->serverid);
+
+	/*
+	 * Get connection to the foreign server.  Connection manager will
+	 * establish new connection if necessary.
+	 */
+	festate->conn = GetConnection(server, user, &festate->conn_state);
+
+	/* Assign a unique ID for my cursor */
+	festate->cursor_number = GetCursorNumber(festate->conn);
+	festate->cursor_exists = false;
+	festate->fetch_pending = false;
+
+	festate->async_capable =
+		get_async_capable(server,
+						  fsplan->scan.scanrelid > 0 ? rte->relid : InvalidOid);
+
+	/* Get private info created by planner functions. */
+	festate->query = strVal(list_nth(fdw_private, FdwScanPrivateSelectSql));
+	festate->retrieved_attrs = (List *) list_nth(fdw_private,
+											  FdwScanPrivateRetrievedAttrs);
+
+	/* Create context for per-batch tuple storage */
+	festate->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
+											   "postgres_fdw tuple data",
+											   ALLOCSET_DEFAULT_MINSIZE,
+											   ALLOCSET_DEFAULT_INITSIZE,
+											   ALLOCSET_DEFAULT_MAXSIZE);
+
+	/*
+	 * The scan tuples are those of the foreign table, or, for a join or
+	 * grouping, described by the plan's fdw_scan_tlist.
+	 */
+	festate->tupdesc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+	festate->attinmeta = TupleDescGetAttInMetadata(festate->tupdesc);
+}
+
+/*
+ * postgresIterateForeignScan
+ *		Retrieve next row from the result set, or clear tuple slot to indicate
+ *		EOF.
+ */
+static TupleTableSlot *
+postgresIterateForeignScan(ForeignScanState *node)
+{
+	PgFdwScanState *festate = (PgFdwScanState *) node->fdw_state;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+
+	/*
+	 * Get some more tuples, if we've run out.  The first FETCH after Begin
+	 * or ReScan creates the cursor on the remote side, too.
+	 */
+	if (festate->next_tuple >= festate->num_tuples)
+	{
+		/* No point in another fetch if we already detected EOF, though. */
+		if (!festate->eof_reached)
+			fetch_more_data(festate);
+		/* If we didn't get any tuples, must be end of data. */
+		if (festate->next_tuple >= festate->num_tuples)
+			return ExecClearTuple(slot);
+	}
+
+	/*
+	 * Return the next tuple.
+	 */
+	ExecStoreTuple(festate->tuples[festate->next_tuple++],
+				   slot,
+				   InvalidBuffer,
+				   false);
+
+	return slot;
+}
+
+/*
+ * postgresReScanForeignScan
+ *		Restart the scan.
+ *
+ * No parameters are ever sent to the remote server, so a rescan returns
+ * the same rows; we simply run the query again.
+ */
+static void
+postgresReScanForeignScan(ForeignScanState *node)
+{
+	PgFdwScanState *festate = (PgFdwScanState *) node->fdw_state;
+
+	/* If we haven't sent the query yet, nothing to do. */
+	if (!festate->cursor_exists)
+		return;
+
+	close_cursor(festate);
+}
+
+/*
+ * postgresEndForeignScan
+ *		Finish scanning foreign table and dispose objects used for this scan
+ */
+static void
+postgresEndForeignScan(ForeignScanState *node)
+{
+	PgFdwScanState *festate = (PgFdwScanState *) node->fdw_state;
+
+	/* if festate is NULL, we are in EXPLAIN; nothing to do */
+	if (festate == NULL)
+		return;
+
+	/* Close the cursor if open, to prevent accumulation of cursors */
+	if (festate->cursor_exists)
+		close_cursor(festate);
+
+	/* Release remote connection */
+	ReleaseConnection(festate->conn);
+	festate->conn = NULL;
+
+	/* MemoryContexts will be deleted automatically. */
+}
+
+/*
+ * postgresStartAsyncForeignScan
+ *		Send the first FETCH of the scan, if it may run asynchronously.
+ *
+ * The connection must be free: if another scan already has a FETCH in
+ * progress on it, ours is run the usual way.
+ */
+static bool
+postgresStartAsyncForeignScan(ForeignScanState *node)
+{
+	PgFdwScanState *festate = (PgFdwScanState *) node->fdw_state;
+
+	if (festate == NULL || !festate->async_capable)
+		return false;
+	if (festate->conn_state->pending_scan != NULL &&
+		festate->conn_state->pending_scan != festate)
+		return false;
+
+	if (!festate->fetch_pending && !festate->eof_reached &&
+		festate->next_tuple >= festate->num_tuples)
+		send_fetch_request(festate);
+
+	return true;
+}
+
+/*
+ * postgresPollAsyncForeignScan
+ *		Check whether the next row can be returned without waiting.
+ *
+ * If it can't, return the socket to wait on for the remote server's
+ * answer.  Otherwise, return PGINVALID_SOCKET; the rows that arrived are
+ * converted when Iterate is next called.
+ */
+static pgsocket
+postgresPollAsyncForeignScan(ForeignScanState *node)
+{
+	PgFdwScanState *festate = (PgFdwScanState *) node->fdw_state;
+
+	/* Rows left from the last batch, or nothing more to come? */
+	if (festate->next_tuple < festate->num_tuples || festate->eof_reached)
+		return PGINVALID_SOCKET;
+
+	/*
+	 * Ask for the next batch, unless another scan is using the connection,
+	 * in which case Iterate will have to wait for both.
+	 */
+	if (!festate->fetch_pending)
+	{
+		if (festate->conn_state->pending_scan != NULL)
+			return PGINVALID_SOCKET;
+		send_fetch_request(festate);
+	}
+
+	if (!PQconsumeInput(festate->conn))
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not receive data from server: %s",
+						PQerrorMessage(festate->conn))));
+
+	if (PQisBusy(festate->conn))
+		return PQsocket(festate->conn);
+	return PGINVALID_SOCKET;
+}
+
+/*
+ * Set the options that come from the foreign server, with their defaults.
+ */
+static void
+apply_server_options(PgFdwRelationInfo *fpinfo)
+{
+	ListCell   *lc;
+
+	fpinfo->use_remote_estimate = false;
+	fpinfo->fdw_startup_cost = DEFAULT_FDW_STARTUP_COST;
+	fpinfo->fdw_tuple_cost = DEFAULT_FDW_TUPLE_COST;
+
+	foreach(lc, fpinfo->server->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "use_remote_estimate") == 0)
+			fpinfo->use_remote_estimate = defGetBoolean(def);
+		else if (strcmp(def->defname, "fdw_startup_cost") == 0)
+			fpinfo->fdw_startup_cost = strtod(defGetString(def), NULL);
+		else if (strcmp(def->defname, "fdw_tuple_cost") == 0)
+			fpinfo->fdw_tuple_cost = strtod(defGetString(def), NULL);
+	}
+}
+
+/*
+ * Apply the options of a foreign table that override the server's.
+ */
+static void
+apply_table_options(PgFdwRelationInfo *fpinfo, List *options)
+{
+	ListCell   *lc;
+
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "use_remote_estimate") == 0)
+			fpinfo->use_remote_estimate = defGetBoolean(def);
+	}
+}
+
+/*
+ * Get the async_capable option of a scan, from the foreign table if it's a
+ * scan of one (relid is valid) and has it, else from the server.
+ */
+static bool
+get_async_capable(ForeignServer *server, Oid relid)
+{
+	bool		async_capable = false;
+	ListCell   *lc;
+
+	foreach(lc, server->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "async_capable") == 0)
+			async_capable = defGetBoolean(def);
+	}
+
+	if (OidIsValid(relid))
+	{
+		ForeignTable *table = GetForeignTable(relid);
+
+		foreach(lc, table->options)
+		{
+			DefElem    *def = (DefElem *) lfirst(lc);
+
+			if (strcmp(def->defname, "async_capable") == 0)
+				async_capable = defGetBoolean(def);
+		}
+	}
+
+	return async_capable;
+}
+
+/*
+ * Does the relation make up the whole FROM clause of the query?  Only then
+ * do the query's ORDER BY and LIMIT apply directly to its rows.
+ */
+static bool
+rel_is_whole_query(PlannerInfo *root, RelOptInfo *rel)
+{
+	Relids		all_relids = NULL;
+	Index		rti;
+
+	for (rti = 1; rti < root->simple_rel_array_size; rti++)
+	{
+		RelOptInfo *brel = root->simple_rel_array[rti];
+
+		if (brel != NULL && brel->reloptkind == RELOPT_BASEREL)
+			all_relids = bms_add_member(all_relids, rti);
+	}
+
+	return bms_equal(all_relids, rel->relids);
+}
+
+/*
+ * Append ORDER BY and LIMIT clauses to the remote query of a scan or join,
+ * if the rows can be sorted and limited remotely.  Returns the pathkeys
+ * describing the order of the rows, and reduces *rows if we add a LIMIT.
+ *
+ * This is only done when the relation is the whole of the query, and
+ * only for the ordering the query wants (root->query_pathkeys), which
+ * the planner then need not do itself.
+ */
+static List *
+append_sort_and_limit(StringInfo sql, PlannerInfo *root, RelOptInfo *rel,
+					  double *rows)
+{
+	Query	   *parse = root->parse;
+	List	   *pathkeys = NIL;
+	StringInfoData orderby;
+	ListCell   *lc;
+
+	if (!rel_is_whole_query(root, rel))
+		return NIL;
+
+	initStringInfo(&orderby);
+	foreach(lc, root->query_pathkeys)
+	{
+		PathKey    *pathkey = (PathKey *) lfirst(lc);
+		EquivalenceClass *ec = pathkey->pk_eclass;
+		EquivalenceMember *em_found = NULL;
+		ListCell   *lc2;
+		Oid			sortop;
+		bool		reverse;
+
+		if (ec->ec_has_volatile)
+			break;
+
+		/* Find an expression of the class we can compute remotely */
+		foreach(lc2, ec->ec_members)
+		{
+			EquivalenceMember *em = (EquivalenceMember *) lfirst(lc2);
+
+			if (!em->em_is_const && !em->em_is_child &&
+				bms_is_subset(em->em_relids, rel->relids) &&
+				is_foreign_expr(root, rel, em->em_expr, false))
+			{
+				em_found = em;
+				break;
+			}
+		}
+		if (em_found == NULL)
+			break;
+
+		sortop = get_opfamily_member(pathkey->pk_opfamily,
+									 em_found->em_datatype,
+									 em_found->em_datatype,
+									 pathkey->pk_strategy);
+		if (!is_foreign_sort(em_found->em_datatype, ec->ec_collation,
+							 sortop, &reverse))
+			break;
+
+		appendStringInfoString(&orderby, (orderby.len > 0) ? ", " : "");
+		deparseExpr(&orderby, root, em_found->em_expr);
+		appendStringInfo(&orderby, " %s NULLS %s",
+						 reverse ? "DESC" : "ASC",
+						 pathkey->pk_nulls_first ? "FIRST" : "LAST");
+		pathkeys = lappend(pathkeys, pathkey);
+	}
+
+	/* Send the sort only if it covers the ordering the query wants */
+	if (pathkeys != NIL && lc == NULL)
+		appendStringInfo(sql, " ORDER BY %s", orderby.data);
+	else
+		pathkeys = NIL;
+	pfree(orderby.data);
+
+	/*
+	 * The LIMIT, including any OFFSET rows, can be sent if the rows come out
+	 * in the required order, and all the rows we return reach the Limit
+	 * node: nothing in between may filter them or multiply them.
+	 */
+	if (root->limit_tuples >= 0 &&
+		(pathkeys != NIL || root->query_pathkeys == NIL) &&
+		((PgFdwRelationInfo *) rel->fdw_private)->local_conds == NIL &&
+		root->rowMarks == NIL &&
+		!root->hasPseudoConstantQuals &&
+		!expression_returns_set((Node *) parse->targetList))
+	{
+		appendStringInfo(sql, " LIMIT %.0f", root->limit_tuples);
+		*rows = Min(*rows, root->limit_tuples);
+	}
+
+	return pathkeys;
+}
+
+/*
+ * Build the FdwPlan for a remote query returning 'retrieved_rows' rows,
+ * which costs the remote server 'remote_cost' to run.
+ */
+static FdwPlan *
+make_fdwplan(PgFdwRelationInfo *fpinfo, StringInfo sql,
+			 List *retrieved_attrs, double retrieved_rows,
+			 Cost remote_cost)
+{
+	FdwPlan    *fdwplan = makeNode(FdwPlan);
+
+	fdwplan->startup_cost = fpinfo->fdw_startup_cost;
+	fdwplan->total_cost = fdwplan->startup_cost + remote_cost +
+		(fpinfo->fdw_tuple_cost + cpu_tuple_cost) * retrieved_rows;
+
+	fdwplan->fdw_private = list_make2(makeString(sql->data),
+									  retrieved_attrs);
+
+	return fdwplan;
+}
+
+/*
+ * Get the estimated size and cost of a remote query from the remote
+ * server's EXPLAIN.
+ */
+static void
+get_remote_estimate(PgFdwRelationInfo *fpinfo, const char *sql,
+					double *rows, Cost *startup_cost, Cost *total_cost)
+{
+	PGconn	   *conn;
+	PgFdwConnState *conn_state;
+	PGresult   *volatile res = NULL;
+
+	conn = GetConnection(fpinfo->server, fpinfo->user, &conn_state);
+
+	/* The connection might be busy with a FETCH of an outer query */
+	if (conn_state->pending_scan)
+		process_pending_request(conn_state->pending_scan);
+
+	/* PGresult must be released before leaving this function. */
+	PG_TRY();
+	{
+		char	   *line;
+		char	   *p;
+		int			n;
+		int			width;
+		StringInfoData buf;
+
+		initStringInfo(&buf);
+		appendStringInfo(&buf, "EXPLAIN %s", sql);
+		res = PQexec(conn, buf.data);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pgfdw_report_error(ERROR, res, false, buf.data);
+
+		/*
+		 * Extract cost numbers for topmost plan node.  Note we search for a
+		 * left paren from the end of the line to avoid being confused by
+		 * other uses of parentheses.
+		 */
+		line = PQgetvalue(res, 0, 0);
+		p = strrchr(line, '(');
+		if (p == NULL)
+			elog(ERROR, "could not interpret EXPLAIN output: \"%s\"", line);
+		n = sscanf(p, "(cost=%lf..%lf rows=%lf width=%d)",
+				   startup_cost, total_cost, rows, &width);
+		if (n != 4)
+			elog(ERROR, "could not interpret EXPLAIN output: \"%s\"", line);
+
+		PQclear(res);
+		res = NULL;
+	}
+	PG_CATCH();
+	{
+		if (res)
+			PQclear(res);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	ReleaseConnection(conn);
+}
+
+/*
+ * Send a FETCH for the next batch of rows of the node's cursor, without
+ * waiting for the result; if the cursor doesn't exist yet, declare it in
+ * the same round trip.  Any other scan's FETCH still in progress on the
+ * connection is collected first.
+ */
+static void
+send_fetch_request(PgFdwScanState *festate)
+{
+	StringInfoData buf;
+
+	Assert(!festate->fetch_pending);
+
+	if (festate->conn_state->pending_scan)
+		process_pending_request(festate->conn_state->pending_scan);
+
+	initStringInfo(&buf);
+	if (!festate->cursor_exists)
+	{
+		appendStringInfo(&buf, "DECLARE c%u CURSOR FOR\n%s;\n",
+						 festate->cursor_number, festate->query);
+
+		/* Show no tuples have been retrieved */
+		festate->tuples = NULL;
+		festate->num_tuples = 0;
+		festate->next_tuple = 0;
+		festate->eof_reached = false;
+	}
+	appendStringInfo(&buf, "FETCH %d FROM c%u",
+					 FETCH_SIZE, festate->cursor_number);
+
+	if (!PQsendQuery(festate->conn, buf.data))
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not send query to server: %s",
+						PQerrorMessage(festate->conn)),
+				 errcontext("Remote SQL command: %s", festate->query)));
+
+	/* The cursor is created as far as the remote side is concerned */
+	festate->cursor_exists = true;
+	festate->fetch_pending = true;
+	festate->conn_state->pending_scan = festate;
+
+	pfree(buf.data);
+}
+
+/*
+ * Collect the rows of a scan's FETCH still in progress, because someone
+ * else needs the connection.  They're kept for the scan to return later.
+ */
+void
+process_pending_request(PgFdwScanState *festate)
+{
+	Assert(festate->fetch_pending);
+
+	fetch_more_data(festate);
+}
+
+/*
+ * Fetch some more rows from the node's cursor, sending the FETCH if it
+ * hasn't been sent already.
+ */
+static void
+fetch_more_data(PgFdwScanState *festate)
+{
+	PGresult   *volatile res = NULL;
+	MemoryContext oldcontext;
+
+	if (!festate->fetch_pending)
+		send_fetch_request(festate);
+
+	/*
+	 * The request is no longer pending, whatever happens.  (If we fail, the
+	 * transaction is going to be aborted anyway.)
+	 */
+	festate->fetch_pending = false;
+	festate->conn_state->pending_scan = NULL;
+
+	/*
+	 * We'll store the tuples in the batch_cxt.  First, flush the previous
+	 * batch.
+	 */
+	festate->tuples = NULL;
+	MemoryContextReset(festate->batch_cxt);
+	oldcontext = MemoryContextSwitchTo(festate->batch_cxt);
+
+	/* PGresult must be released before leaving this function. */
+	PG_TRY();
+	{
+		PGresult   *next;
+		int			numrows;
+		int			i;
+
+		/*
+		 * Read all the results of the command.  There are two if the cursor
+		 * was declared along with the FETCH; we want the FETCH's, or the
+		 * first error.
+		 */
+		while ((next = PQgetResult(festate->conn)) != NULL)
+		{
+			if (res == NULL && PQresultStatus(next) != PGRES_COMMAND_OK)
+				res = next;
+			else
+				PQclear(next);
+		}
+
+		/* On error, report the original query, not the FETCH. */
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pgfdw_report_error(ERROR, res, false, festate->query);
+
+		/* Convert the data into HeapTuples */
+		numrows = PQntuples(res);
+		festate->tuples = (HeapTuple *) palloc0(numrows * sizeof(HeapTuple));
+		festate->num_tuples = numrows;
+		festate->next_tuple = 0;
+
+		for (i = 0; i < numrows; i++)
+		{
+			festate->tuples[i] =
+				make_tuple_from_result_row(res, i,
+										   festate->tupdesc,
+										   festate->attinmeta,
+										   festate->retrieved_attrs);
+		}
+
+		/* Must be EOF if we didn't get as many tuples as we asked for. */
+		festate->eof_reached = (numrows < FETCH_SIZE);
+
+		PQclear(res);
+		res = NULL;
+	}
+	PG_CATCH();
+	{
+		if (res)
+			PQclear(res);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Close the node's cursor, so that the next Iterate call reopens it.
+ */
+static void
+close_cursor(PgFdwScanState *festate)
+{
+	char		sql[64];
+	PGresult   *res;
+
+	/* The connection must be free, and we don't want our FETCH's rows */
+	if (festate->conn_state->pending_scan)
+		process_pending_request(festate->conn_state->pending_scan);
+
+	snprintf(sql, sizeof(sql), "CLOSE c%u", festate->cursor_number);
+
+	res = PQexec(festate->conn, sql);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pgfdw_report_error(ERROR, res, true, sql);
+	PQclear(res);
+
+	festate->cursor_exists = false;
+	festate->tuples = NULL;
+	festate->num_tuples = 0;
+	festate->next_tuple = 0;
+	festate->eof_reached = false;
+	MemoryContextReset(festate->batch_cxt);
+}
+
+/*
+ * Create a tuple from the specified row of the PGresult.
+ *
+ * The result's columns are converted, in order, into the scan tuple
+ * attributes listed in retrieved_attrs; the other attributes are null.
+ */
+static HeapTuple
+make_tuple_from_result_row(PGresult *res, int row,
+						   TupleDesc tupdesc,
+						   AttInMetadata *attinmeta,
+						   List *retrieved_attrs)
+{
+	Datum	   *values;
+	bool	   *nulls;
+	ListCell   *lc;
+	int			j;
+
+	Assert(row < PQntuples(res));
+
+	values = (Datum *) palloc0(tupdesc->natts * sizeof(Datum));
+	nulls = (bool *) palloc(tupdesc->natts * sizeof(bool));
+	/* Initialize to nulls for any columns not present in result */
+	memset(nulls, true, tupdesc->natts * sizeof(bool));
+
+	j = 0;
+	foreach(lc, retrieved_attrs)
+	{
+		int			i = lfirst_int(lc);
+		char	   *valstr;
+
+		/* fetch next column's textual value */
+		if (PQgetisnull(res, row, j))
+			valstr = NULL;
+		else
+			valstr = PQgetvalue(res, row, j);
+
+		/* convert value to internal representation */
+		nulls[i - 1] = (valstr == NULL);
+		values[i - 1] = InputFunctionCall(&attinmeta->attinfuncs[i - 1],
+										  valstr,
+										  attinmeta->attioparams[i - 1],
+										  attinmeta->atttypmods[i - 1]);
+		j++;
+	}
+
+	/*
+	 * Check we got the expected number of columns.  Note: j == 0 and
+	 * PQnfields == 1 is expected, since deparse emits a NULL if no columns.
+	 */
+	if (j > 0 && j != PQnfields(res))
+		elog(ERROR, "remote query result does not match the foreign table");
+
+	return heap_form_tuple(tupdesc, values, nulls);
+}
@@ -0,0 +1,98 @@
+/*-------------------------------------------------------------------------
+ *
+ * postgres_fdw.h
+ *		  foreign-data wrapper for remote PostgreSQL servers
+ *
+ * Copyright (c) 2012, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  contrib/postgres_fdw/postgres_fdw.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef POSTGRES_FDW_H
+#define POSTGRES_FDW_H
+
+#include "foreign/foreign.h"
+#include "lib/stringinfo.h"
+#include "nodes/relation.h"
+#include "utils/rel.h"
+
+#include "libpq-fe.h"
+
+/*
+ * Planner information about a foreign relation, kept in its
+ * RelOptInfo.fdw_private.  A base relation always has one; a join relation
+ * has one only if the join can be performed on the remote server.
+ */
+typedef struct PgFdwRelationInfo
+{
+	/*
+	 * Restriction clauses of a base relation, divided into those that can
+	 * be checked remotely and those that can't (lists of RestrictInfos).
+	 * A join relation never has local_conds.
+	 */
+	List	   *remote_conds;
+	List	   *local_conds;
+
+	/* Bare clauses that go in the WHERE clause of a query over the rel */
+	List	   *where_conds;
+
+	/* FROM-clause item for the relation, eg "public.t1 r1" or a join */
+	char	   *relation_sql;
+
+	/* Columns of a base relation that have to be retrieved */
+	Bitmapset  *attrs_used;
+
+	/* Cost-related options */
+	bool		use_remote_estimate;
+	Cost		fdw_startup_cost;
+	Cost		fdw_tuple_cost;
+
+	/* Whose user mapping is used to access the relation */
+	Oid			userid;
+	ForeignServer *server;
+	UserMapping *user;
+} PgFdwRelationInfo;
+
+/*
+ * Execution state of a connection, shared by all the scans using it.  Only
+ * one command can be in progress on a connection at a time; pending_scan is
+ * the scan whose FETCH was sent asynchronously and whose result hasn't been
+ * collected yet, if any.  Anyone else wanting to use the connection must
+ * first collect that result, with process_pending_request.
+ */
+typedef struct PgFdwConnState
+{
+	struct PgFdwScanState *pending_scan;
+} PgFdwConnState;
+
+/* in postgres_fdw.c */
+extern void process_pending_request(struct PgFdwScanState *festate);
+
+/* in connection.c */
+extern PGconn *GetConnection(ForeignServer *server, UserMapping *user,
+			  PgFdwConnState **state);
+extern void ReleaseConnection(PGconn *conn);
+extern unsigned int GetCursorNumber(PGconn *conn);
+extern void pgfdw_report_error(int elevel, PGresult *res, bool clear,
+				   const char *sql);
+
+/* in option.c */
+extern int ExtractConnectionOptions(List *defelems,
+						 const char **keywords,
+						 const char **values);
+
+/* in deparse.c */
+extern bool is_foreign_expr(PlannerInfo *root, RelOptInfo *foreignrel,
+				Expr *expr, bool allow_aggs);
+extern bool is_foreign_sort(Oid exprtype, Oid exprcollation, Oid sortop,
+				bool *reverse);
+extern void deparseRelation(StringInfo buf, Oid relid, Index rtindex);
+extern void deparseColumnRef(StringInfo buf, PlannerInfo *root,
+				 Index varno, AttrNumber varattno);
+extern void deparseExpr(StringInfo buf, PlannerInfo *root, Expr *expr);
+extern void deparseConditions(StringInfo buf, PlannerInfo *root,
+				  List *exprs);
+
+#endif   /* POSTGRES_FDW_H */
@@ -0,0 +1,97 @@
+-- ===================================================================
+-- create FDW objects
+-- ===================================================================
+CREATE EXTENSION postgres_fdw;
+
+DO $d$
+    BEGIN
+        EXECUTE $$CREATE SERVER loopback FOREIGN DATA WRAPPER postgres_fdw
+            OPTIONS (dbname '$$||current_database()||$$',
+                     port '$$||current_setting('port')||$$'
+            )$$;
+    END;
+$d$;
+CREATE USER MAPPING FOR CURRENT_USER SERVER loopback;
+
+-- ===================================================================
+-- create objects used through FDW loopback server
+-- ===================================================================
+CREATE SCHEMA "S 1";
+CREATE TABLE "S 1"."T 1" (c1 int, c2 int, c3 text);
+CREATE TABLE "S 1"."T 2" (c1 int, c2 text);
+INSERT INTO "S 1"."T 1"
+    SELECT id, id % 3, 'AAA' || to_char(id, 'FM00')
+    FROM generate_series(1, 10) id;
+INSERT INTO "S 1"."T 2"
+    SELECT id * 2, 'BBB' || to_char(id * 2, 'FM00')
+    FROM generate_series(1, 6) id;
+
+-- ===================================================================
+-- create foreign tables
+-- ===================================================================
+CREATE FOREIGN TABLE ft1 (c1 int, c2 int, c3 text)
+    SERVER loopback OPTIONS (schema_name 'S 1', table_name 'T 1');
+CREATE FOREIGN TABLE ft2 (c1 int, cx text OPTIONS (column_name 'c2'))
+    SERVER loopback OPTIONS (schema_name 'S 1', table_name 'T 2');
+
+-- option validation
+ALTER FOREIGN TABLE ft1 OPTIONS (ADD invalid_option 'value');  -- ERROR
+ALTER SERVER loopback OPTIONS (ADD fdw_startup_cost '-1');     -- ERROR
+ALTER SERVER loopback OPTIONS (ADD use_remote_estimate 'maybe'); -- ERROR
+
+-- ===================================================================
+-- simple queries
+-- ===================================================================
+-- conditions that can be evaluated remotely are sent to the remote server
+EXPLAIN (VERBOSE, COSTS false) SELECT c1, c2, c3 FROM ft1 WHERE c1 = 3;
+SELECT c1, c2, c3 FROM ft1 WHERE c1 = 3;
+-- others are checked locally
+EXPLAIN (VERBOSE, COSTS false) SELECT c1, c3 FROM ft1 WHERE c1::text = '3';
+SELECT c1, c3 FROM ft1 WHERE c1::text = '3';
+-- ORDER BY and LIMIT are sent as well
+EXPLAIN (VERBOSE, COSTS false) SELECT c1, c3 FROM ft1 ORDER BY c1 DESC LIMIT 3;
+SELECT c1, c3 FROM ft1 ORDER BY c1 DESC LIMIT 3;
+
+-- ===================================================================
+-- joins
+-- ===================================================================
+EXPLAIN (VERBOSE, COSTS false)
+SELECT t1.c1, t2.cx FROM ft1 t1 JOIN ft2 t2 ON (t1.c1 = t2.c1) ORDER BY t1.c1;
+SELECT t1.c1, t2.cx FROM ft1 t1 JOIN ft2 t2 ON (t1.c1 = t2.c1) ORDER BY t1.c1;
+EXPLAIN (VERBOSE, COSTS false)
+SELECT t1.c1, t2.cx FROM ft1 t1 LEFT JOIN ft2 t2 ON (t1.c1 = t2.c1) WHERE t1.c1 < 5 ORDER BY t1.c1;
+SELECT t1.c1, t2.cx FROM ft1 t1 LEFT JOIN ft2 t2 ON (t1.c1 = t2.c1) WHERE t1.c1 < 5 ORDER BY t1.c1;
+
+-- ===================================================================
+-- aggregates
+-- ===================================================================
+EXPLAIN (VERBOSE, COSTS false)
+SELECT c2, count(*), sum(c1) FROM ft1 GROUP BY c2 HAVING sum(c1) > 16 ORDER BY c2;
+SELECT c2, count(*), sum(c1) FROM ft1 GROUP BY c2 HAVING sum(c1) > 16 ORDER BY c2;
+EXPLAIN (VERBOSE, COSTS false)
+SELECT count(*) FROM ft1 t1 JOIN ft2 t2 ON (t1.c1 = t2.c1);
+SELECT count(*) FROM ft1 t1 JOIN ft2 t2 ON (t1.c1 = t2.c1);
+
+-- ===================================================================
+-- asynchronous execution
+-- ===================================================================
+DO $d$
+    BEGIN
+        EXECUTE $$CREATE SERVER loopback2 FOREIGN DATA WRAPPER postgres_fdw
+            OPTIONS (dbname '$$||current_database()||$$',
+                     port '$$||current_setting('port')||$$'
+            )$$;
+    END;
+$d$;
+CREATE USER MAPPING FOR CURRENT_USER SERVER loopback2;
+CREATE FOREIGN TABLE ft3 (c1 int, c2 text)
+    SERVER loopback2 OPTIONS (schema_name 'S 1', table_name 'T 2');
+ALTER SERVER loopback OPTIONS (ADD async_capable 'true');
+ALTER SERVER loopback2 OPTIONS (ADD async_capable 'true');
+ALTER FOREIGN TABLE ft3 OPTIONS (ADD async_capable 'maybe');  -- ERROR
+SELECT count(*), sum(c1) FROM (SELECT c1 FROM ft1 UNION ALL SELECT c1 FROM ft3) s;
+SELECT c1 FROM (SELECT c1 FROM ft1 UNION ALL SELECT c1 FROM ft3) s
+    WHERE c1 > 8 ORDER BY c1;
+-- ft1 and ft2 share a connection, so only one of them runs asynchronously
+SELECT count(*), sum(c1) FROM (SELECT c1 FROM ft1 UNION ALL SELECT c1 FROM ft2
+    UNION ALL SELECT c1 FROM ft3) s;
@@ -0,0 +1,823 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin.c
+ *	  Implementation of BRIN (block range) indexes for Postgres
+ *
+ * A BRIN index stores, for each range of pagesPerRange consecutive heap
+ * blocks, the minimum and maximum value of every indexed column found in
+ * that range.  A bitmap scan returns every block of each range whose
+ * summary is consistent with the scan keys, as lossy bitmap pages; the
+ * heap scan then rechecks the quals.  The index is tiny and cheap to
+ * maintain, and is useful when the column values are well correlated with
+ * their physical location in the heap.
+ *
+ * Summaries are only ever widened: deleting or updating heap tuples does not
+ * shrink them, so a heavily updated table may need REINDEX to regain
+ * precision.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			src/backend/access/brin/brin.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin.h"
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/relscan.h"
+#include "access/reloptions.h"
+#include "access/tupmacs.h"
+#include "catalog/index.h"
+#include "miscadmin.h"
+#include "nodes/tidbitmap.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+
+typedef struct
+{
+	BrinDesc   *desc;			/* index layout */
+	Buffer		buffer;			/* currently pinned summary page, if any */
+	MemoryContext tmpCtx;		/* per-tuple temporary context */
+} BrinBuildState;
+
+
+/*
+ * Compute the summary slot layout for an index.  pagesPerRange is left
+ * unset; the caller fills it in from the metapage or the reloptions.
+ */
+static BrinDesc *
+brin_makedesc(Relation index)
+{
+	TupleDesc	tupdesc = RelationGetDescr(index);
+	int			natts = tupdesc->natts;
+	BrinDesc   *desc;
+	uint32		off;
+	int			i;
+
+	desc = MemoryContextAllocZero(index->rd_indexcxt,
+								  offsetof(BrinDesc, columns) +
+								  natts * sizeof(BrinColumn));
+	desc->natts = natts;
+
+	/* validity byte and one flag byte per column come first */
+	off = 1 + natts;
+
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		BrinColumn *col = &desc->columns[i];
+
+		if (attr->attlen <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("BRIN indexes do not support variable-length type %s",
+							format_type_be(attr->atttypid))));
+
+		col->typlen = attr->attlen;
+		col->typbyval = attr->attbyval;
+
+		off = att_align_nominal(off, attr->attalign);
+		col->minOffset = off;
+		off += attr->attlen;
+		off = att_align_nominal(off, attr->attalign);
+		col->maxOffset = off;
+		off += attr->attlen;
+
+		col->cmpProc = index_getprocinfo(index, i + 1, BRIN_CMP_PROC);
+		col->collation = index->rd_indcollation[i];
+	}
+
+	desc->summarySize = MAXALIGN(off);
+	desc->summariesPerPage = (BLCKSZ - BRIN_SUMMARY_START) / desc->summarySize;
+	if (desc->summariesPerPage == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("BRIN summary of %u bytes does not fit on an index page",
+						desc->summarySize)));
+
+	return desc;
+}
+
+/*
+ * Fetch the cached layout of a BRIN index, building it on first use
+ */
+BrinDesc *
+brin_getdesc(Relation index)
+{
+	BrinDesc   *desc;
+	Buffer		metabuffer;
+	BrinMetaPageData *metadata;
+
+	if (index->rd_amcache != NULL)
+		return (BrinDesc *) index->rd_amcache;
+
+	desc = brin_makedesc(index);
+
+	metabuffer = ReadBuffer(index, BRIN_METAPAGE_BLKNO);
+	LockBuffer(metabuffer, BUFFER_LOCK_SHARE);
+
+	metadata = BrinPageGetMeta(BufferGetPage(metabuffer));
+
+	if (metadata->brinMagic != BRIN_MAGIC_NUMBER)
+		elog(ERROR, "index \"%s\" is not a BRIN index",
+			 RelationGetRelationName(index));
+	if (metadata->brinVersion != BRIN_VERSION ||
+		metadata->summarySize != desc->summarySize)
+		elog(ERROR, "index \"%s\" has incompatible BRIN layout",
+			 RelationGetRelationName(index));
+
+	desc->pagesPerRange = metadata->pagesPerRange;
+
+	UnlockReleaseBuffer(metabuffer);
+
+	index->rd_amcache = (void *) desc;
+
+	return desc;
+}
+
+/*
+ * Initialize a BRIN metapage
+ */
+static void
+brin_initmetapage(Page page, BrinDesc *desc)
+{
+	BrinMetaPageData *metadata;
+
+	PageInit(page, BLCKSZ, 0);
+
+	metadata = BrinPageGetMeta(page);
+	metadata->brinMagic = BRIN_MAGIC_NUMBER;
+	metadata->brinVersion = BRIN_VERSION;
+	metadata->pagesPerRange = desc->pagesPerRange;
+	metadata->summarySize = desc->summarySize;
+	metadata->summariesPerPage = desc->summariesPerPage;
+}
+
+/*
+ * Add a new, empty page to the end of the index and return it exclusively
+ * locked.  The caller must hold the relation extension lock if other
+ * backends could be extending the index concurrently.
+ */
+static Buffer
+brin_newbuffer(Relation index, bool needWAL)
+{
+	Buffer		buffer;
+	Page		page;
+
+	buffer = ReadBuffer(index, P_NEW);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	page = BufferGetPage(buffer);
+
+	START_CRIT_SECTION();
+
+	PageInit(page, BLCKSZ, 0);
+	MarkBufferDirty(buffer);
+
+	if (needWAL)
+		log_newpage(&index->rd_node, MAIN_FORKNUM,
+					BufferGetBlockNumber(buffer), page);
+
+	END_CRIT_SECTION();
+
+	return buffer;
+}
+
+/*
+ * Return the summary page blkno exclusively locked, extending the index
+ * as far as needed first.
+ */
+static Buffer
+brin_getbuffer(Relation index, BlockNumber blkno)
+{
+	Buffer		buffer;
+
+	if (blkno >= RelationGetNumberOfBlocks(index))
+	{
+		LockRelationForExtension(index, ExclusiveLock);
+
+		/* recheck, someone else may have extended it meanwhile */
+		while (blkno >= RelationGetNumberOfBlocks(index))
+			UnlockReleaseBuffer(brin_newbuffer(index,
+											   RelationNeedsWAL(index)));
+
+		UnlockRelationForExtension(index, ExclusiveLock);
+	}
+
+	buffer = ReadBuffer(index, blkno);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	return buffer;
+}
+
+/*
+ * Support routines for reading and writing summary values
+ */
+static Datum
+brin_fetch(BrinColumn *col, char *slot, uint16 offset)
+{
+	return fetch_att(slot + offset, col->typbyval, col->typlen);
+}
+
+static void
+brin_store(BrinColumn *col, char *slot, uint16 offset, Datum value)
+{
+	if (col->typbyval)
+		store_att_byval(slot + offset, value, col->typlen);
+	else
+		memcpy(slot + offset, DatumGetPointer(value), col->typlen);
+}
+
+static int32
+brin_compare(BrinColumn *col, Datum a, Datum b)
+{
+	return DatumGetInt32(FunctionCall2Coll(col->cmpProc, col->collation,
+										   a, b));
+}
+
+/*
+ * Widen the summary in slot to cover the given index tuple values.
+ * Returns true if the slot was changed.
+ */
+static bool
+brin_add_values(BrinDesc *desc, char *slot, Datum *values, bool *isnull)
+{
+	bool		changed = false;
+	int			i;
+
+	if (!(slot[0] & BRIN_SUMMARY_VALID))
+	{
+		slot[0] |= BRIN_SUMMARY_VALID;
+		changed = true;
+	}
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		BrinColumn *col = &desc->columns[i];
+		char	   *flags = &slot[1 + i];
+
+		if (isnull[i])
+		{
+			if (!(*flags & BRIN_COL_HASNULLS))
+			{
+				*flags |= BRIN_COL_HASNULLS;
+				changed = true;
+			}
+		}
+		else if (!(*flags & BRIN_COL_HASVALUES))
+		{
+			brin_store(col, slot, col->minOffset, values[i]);
+			brin_store(col, slot, col->maxOffset, values[i]);
+			*flags |= BRIN_COL_HASVALUES;
+			changed = true;
+		}
+		else
+		{
+			if (brin_compare(col, values[i],
+							 brin_fetch(col, slot, col->minOffset)) < 0)
+			{
+				brin_store(col, slot, col->minOffset, values[i]);
+				changed = true;
+			}
+			if (brin_compare(col, values[i],
+							 brin_fetch(col, slot, col->maxOffset)) > 0)
+			{
+				brin_store(col, slot, col->maxOffset, values[i]);
+				changed = true;
+			}
+		}
+	}
+
+	return changed;
+}
+
+/*
+ * Can the range summarized in slot contain tuples satisfying all the keys?
+ */
+static bool
+brin_range_consistent(BrinDesc *desc, char *slot, ScanKey keys, int nkeys)
+{
+	int			i;
+
+	/* a range that was never summarized might contain anything */
+	if (!(slot[0] & BRIN_SUMMARY_VALID))
+		return true;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		ScanKey		key = &keys[i];
+		BrinColumn *col = &desc->columns[key->sk_attno - 1];
+		Datum		min,
+					max;
+		bool		match;
+
+		/* all our operators are strict */
+		if (key->sk_flags & SK_ISNULL)
+			return false;
+
+		if (!(slot[key->sk_attno] & BRIN_COL_HASVALUES))
+			return false;
+
+		min = brin_fetch(col, slot, col->minOffset);
+		max = brin_fetch(col, slot, col->maxOffset);
+
+		switch (key->sk_strategy)
+		{
+			case BRINLessStrategyNumber:
+				match = brin_compare(col, min, key->sk_argument) < 0;
+				break;
+			case BRINLessEqualStrategyNumber:
+				match = brin_compare(col, min, key->sk_argument) <= 0;
+				break;
+			case BRINEqualStrategyNumber:
+				match = brin_compare(col, min, key->sk_argument) <= 0 &&
+					brin_compare(col, max, key->sk_argument) >= 0;
+				break;
+			case BRINGreaterEqualStrategyNumber:
+				match = brin_compare(col, max, key->sk_argument) >= 0;
+				break;
+			case BRINGreaterStrategyNumber:
+				match = brin_compare(col, max, key->sk_argument) > 0;
+				break;
+			default:
+				elog(ERROR, "unrecognized strategy number: %d",
+					 key->sk_strategy);
+				match = false;	/* keep compiler quiet */
+				break;
+		}
+
+		if (!match)
+			return false;
+	}
+
+	return true;
+}
+
+/* Callback to process one heap tuple during IndexBuildHeapScan */
+static void
+brinBuildCallback(Relation index, HeapTuple htup, Datum *values,
+				  bool *isnull, bool tupleIsAlive, void *state)
+{
+	BrinBuildState *buildstate = (BrinBuildState *) state;
+	BrinDesc   *desc = buildstate->desc;
+	BlockNumber range;
+	BlockNumber blkno;
+	MemoryContext oldCtx;
+
+	range = BrinRangeOfBlock(desc, ItemPointerGetBlockNumber(&htup->t_self));
+	blkno = BrinSummaryBlock(desc, range);
+
+	if (!BufferIsValid(buildstate->buffer) ||
+		BufferGetBlockNumber(buildstate->buffer) != blkno)
+	{
+		if (BufferIsValid(buildstate->buffer))
+			UnlockReleaseBuffer(buildstate->buffer);
+		buildstate->buffer = ReadBuffer(index, blkno);
+		LockBuffer(buildstate->buffer, BUFFER_LOCK_EXCLUSIVE);
+	}
+
+	/* Work in temp context, and reset it after each tuple */
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	/*
+	 * The whole index is WAL-logged page by page when the build is done, so
+	 * we can update the page in place here.
+	 */
+	if (brin_add_values(desc,
+						(char *) BufferGetPage(buildstate->buffer) +
+						BrinSummaryOffset(desc, range),
+						values, isnull))
+		MarkBufferDirty(buildstate->buffer);
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(buildstate->tmpCtx);
+}
+
+/*
+ * Build a new BRIN index.
+ */
+Datum
+brinbuild(PG_FUNCTION_ARGS)
+{
+	Relation	heap = (Relation) PG_GETARG_POINTER(0);
+	Relation	index = (Relation) PG_GETARG_POINTER(1);
+	IndexInfo  *indexInfo = (IndexInfo *) PG_GETARG_POINTER(2);
+	IndexBuildResult *result;
+	double		reltuples;
+	BrinBuildState buildstate;
+	BrinDesc   *desc;
+	BlockNumber nranges;
+	BlockNumber npages;
+	BlockNumber blkno;
+	Buffer		buffer;
+
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	desc = brin_makedesc(index);
+	desc->pagesPerRange = BrinGetPagesPerRange(index);
+
+	/*
+	 * Lay out the metapage and a summary slot for every range the heap has
+	 * now.  Nobody else can insert into the heap while we're building, so
+	 * the build scan won't see blocks beyond these.
+	 */
+	nranges = (RelationGetNumberOfBlocks(heap) + desc->pagesPerRange - 1) /
+		desc->pagesPerRange;
+	npages = (nranges > 0) ? BrinSummaryBlock(desc, nranges - 1) + 1 : 1;
+
+	for (blkno = 0; blkno < npages; blkno++)
+	{
+		buffer = brin_newbuffer(index, false);
+		Assert(BufferGetBlockNumber(buffer) == blkno);
+		if (blkno == BRIN_METAPAGE_BLKNO)
+			brin_initmetapage(BufferGetPage(buffer), desc);
+		UnlockReleaseBuffer(buffer);
+	}
+
+	index->rd_amcache = (void *) desc;
+
+	/*
+	 * Now summarize all the heap data
+	 */
+	buildstate.desc = desc;
+	buildstate.buffer = InvalidBuffer;
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "BRIN build temporary context",
+											  ALLOCSET_DEFAULT_MINSIZE,
+											  ALLOCSET_DEFAULT_INITSIZE,
+											  ALLOCSET_DEFAULT_MAXSIZE);
+
+	reltuples = IndexBuildHeapScan(heap, index, indexInfo, false,
+								   brinBuildCallback, (void *) &buildstate);
+
+	if (BufferIsValid(buildstate.buffer))
+		UnlockReleaseBuffer(buildstate.buffer);
+
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	/*
+	 * Mark every range as summarized, including those in which the scan
+	 * found nothing, and WAL-log the finished pages.
+	 */
+	for (blkno = 0; blkno < npages; blkno++)
+	{
+		Page		page;
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		START_CRIT_SECTION();
+
+		if (blkno != BRIN_METAPAGE_BLKNO)
+		{
+			BlockNumber range = (blkno - 1) * desc->summariesPerPage;
+			uint32		i;
+
+			for (i = 0; i < desc->summariesPerPage && range < nranges;
+				 i++, range++)
+				((char *) page)[BrinSummaryOffset(desc, range)] |=
+					BRIN_SUMMARY_VALID;
+		}
+		MarkBufferDirty(buffer);
+
+		if (RelationNeedsWAL(index))
+			log_newpage(&index->rd_node, MAIN_FORKNUM, blkno, page);
+
+		END_CRIT_SECTION();
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	result = (IndexBuildResult *) palloc0(sizeof(IndexBuildResult));
+	result->heap_tuples = result->index_tuples = reltuples;
+
+	PG_RETURN_POINTER(result);
+}
+
+/*
+ * Build an empty BRIN index in the initialization fork
+ */
+Datum
+brinbuildempty(PG_FUNCTION_ARGS)
+{
+	Relation	index = (Relation) PG_GETARG_POINTER(0);
+	BrinDesc   *desc;
+	Page		page;
+
+	desc = brin_makedesc(index);
+	desc->pagesPerRange = BrinGetPagesPerRange(index);
+
+	/* Construct metapage; summary pages are added by the first inserts */
+	page = (Page) palloc(BLCKSZ);
+	brin_initmetapage(page, desc);
+
+	/* Write the page.	If archiving/streaming, XLOG it. */
+	smgrwrite(index->rd_smgr, INIT_FORKNUM, BRIN_METAPAGE_BLKNO,
+			  (char *) page, true);
+	if (XLogIsNeeded())
+		log_newpage(&index->rd_smgr->smgr_rnode.node, INIT_FORKNUM,
+					BRIN_METAPAGE_BLKNO, page);
+
+	/*
+	 * An immediate sync is required even if we xlog'd the page, because the
+	 * write did not go through shared buffers and therefore a concurrent
+	 * checkpoint may have moved the redo pointer past our xlog record.
+	 */
+	smgrimmedsync(index->rd_smgr, INIT_FORKNUM);
+
+	pfree(desc);
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Insert one new tuple into a BRIN index, by widening the summary of the
+ * range that the heap tuple fell into.
+ */
+Datum
+brininsert(PG_FUNCTION_ARGS)
+{
+	Relation	index = (Relation) PG_GETARG_POINTER(0);
+	Datum	   *values = (Datum *) PG_GETARG_POINTER(1);
+	bool	   *isnull = (bool *) PG_GETARG_POINTER(2);
+	ItemPointer ht_ctid = (ItemPointer) PG_GETARG_POINTER(3);
+
+#ifdef NOT_USED
+	Relation	heapRel = (Relation) PG_GETARG_POINTER(4);
+	IndexUniqueCheck checkUnique = (IndexUniqueCheck) PG_GETARG_INT32(5);
+#endif
+	BrinDesc   *desc = brin_getdesc(index);
+	BlockNumber range;
+	uint16		offset;
+	Buffer		buffer;
+	Page		page;
+	char	   *slot;
+
+	range = BrinRangeOfBlock(desc, ItemPointerGetBlockNumber(ht_ctid));
+	offset = BrinSummaryOffset(desc, range);
+
+	buffer = brin_getbuffer(index, BrinSummaryBlock(desc, range));
+	page = BufferGetPage(buffer);
+
+	/* work on a copy, so that no error can leave the page half-updated */
+	slot = palloc(desc->summarySize);
+	memcpy(slot, (char *) page + offset, desc->summarySize);
+
+	if (brin_add_values(desc, slot, values, isnull))
+	{
+		START_CRIT_SECTION();
+
+		memcpy((char *) page + offset, slot, desc->summarySize);
+		MarkBufferDirty(buffer);
+
+		if (RelationNeedsWAL(index))
+		{
+			XLogRecPtr	recptr;
+			XLogRecData rdata[2];
+			xl_brin_update xlrec;
+
+			xlrec.node = index->rd_node;
+			xlrec.blkno = BufferGetBlockNumber(buffer);
+			xlrec.offset = offset;
+			xlrec.len = desc->summarySize;
+
+			rdata[0].data = (char *) &xlrec;
+			rdata[0].len = SizeOfBrinUpdate;
+			rdata[0].buffer = InvalidBuffer;
+			rdata[0].next = &(rdata[1]);
+
+			/* summary pages have no hole, so use buffer_std = false */
+			rdata[1].data = slot;
+			rdata[1].len = desc->summarySize;
+			rdata[1].buffer = buffer;
+			rdata[1].buffer_std = false;
+			rdata[1].next = NULL;
+
+			recptr = XLogInsert(RM_BRIN_ID, XLOG_BRIN_UPDATE, rdata);
+
+			PageSetLSN(page, recptr);
+			PageSetTLI(page, ThisTimeLineID);
+		}
+
+		END_CRIT_SECTION();
+	}
+
+	UnlockReleaseBuffer(buffer);
+	pfree(slot);
+
+	/* BRIN indexes are never unique */
+	PG_RETURN_BOOL(false);
+}
+
+Datum
+brinbeginscan(PG_FUNCTION_ARGS)
+{
+	Relation	rel = (Relation) PG_GETARG_POINTER(0);
+	int			nkeys = PG_GETARG_INT32(1);
+	int			norderbys = PG_GETARG_INT32(2);
+	IndexScanDesc scan;
+
+	/* no order by operators allowed */
+	Assert(norderbys == 0);
+
+	scan = RelationGetIndexScan(rel, nkeys, norderbys);
+	scan->opaque = NULL;
+
+	PG_RETURN_POINTER(scan);
+}
+
+Datum
+brinrescan(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	ScanKey		scankey = (ScanKey) PG_GETARG_POINTER(1);
+
+	/* remaining arguments are ignored */
+
+	if (scankey && scan->numberOfKeys > 0)
+	{
+		memmove(scan->keyData, scankey,
+				scan->numberOfKeys * sizeof(ScanKeyData));
+	}
+
+	PG_RETURN_VOID();
+}
+
+Datum
+brinendscan(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_VOID();
+}
+
+Datum
+brinmarkpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "BRIN does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+Datum
+brinrestrpos(PG_FUNCTION_ARGS)
+{
+	elog(ERROR, "BRIN does not support mark/restore");
+	PG_RETURN_VOID();
+}
+
+/*
+ * Add every heap block of each range consistent with the scan keys to the
+ * bitmap, as lossy pages.
+ */
+Datum
+bringetbitmap(PG_FUNCTION_ARGS)
+{
+	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
+	TIDBitmap  *tbm = (TIDBitmap *) PG_GETARG_POINTER(1);
+	Relation	index = scan->indexRelation;
+	BrinDesc   *desc = brin_getdesc(index);
+	Relation	heap;
+	BlockNumber heapBlocks;
+	BlockNumber nranges;
+	BlockNumber range;
+	Buffer		buffer = InvalidBuffer;
+	int64		ntids = 0;
+
+	/*
+	 * Only look at ranges overlapping the heap as it is now; tuples added
+	 * after this point are invisible to our snapshot anyway.
+	 */
+	heap = heap_open(index->rd_index->indrelid, AccessShareLock);
+	heapBlocks = RelationGetNumberOfBlocks(heap);
+	heap_close(heap, AccessShareLock);
+
+	nranges = (heapBlocks + desc->pagesPerRange - 1) / desc->pagesPerRange;
+
+	for (range = 0; range < nranges; range++)
+	{
+		BlockNumber blkno = BrinSummaryBlock(desc, range);
+		bool		match;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (!BufferIsValid(buffer) || BufferGetBlockNumber(buffer) != blkno)
+		{
+			if (BufferIsValid(buffer))
+				UnlockReleaseBuffer(buffer);
+
+			/*
+			 * A range whose summary page doesn't exist yet has never had a
+			 * tuple inserted into it, and neither have any later ones.
+			 */
+			if (blkno >= RelationGetNumberOfBlocks(index))
+			{
+				buffer = InvalidBuffer;
+				break;
+			}
+
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		}
+
+		match = brin_range_consistent(desc,
+									  (char *) BufferGetPage(buffer) +
+									  BrinSummaryOffset(desc, range),
+									  scan->keyData, scan->numberOfKeys);
+
+		if (match)
+		{
+			BlockNumber heapBlk = range * desc->pagesPerRange;
+			BlockNumber endBlk = Min(heapBlk + desc->pagesPerRange, heapBlocks);
+
+			for (; heapBlk < endBlk; heapBlk++)
+			{
+				tbm_add_page(tbm, heapBlk);
+				/* we have no idea how many tuples there are; guess */
+				ntids += 10;
+			}
+		}
+	}
+
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+
+	PG_RETURN_INT64(ntids);
+}
+
+/*
+ * Bulk deletion of all index entries pointing to a set of heap tuples.
+ *
+ * BRIN has no per-tuple entries, so there is nothing to delete; summaries
+ * stay valid (if possibly wider than necessary) when tuples go away.
+ */
+Datum
+brinbulkdelete(PG_FUNCTION_ARGS)
+{
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	PG_RETURN_POINTER(stats);
+}
+
+/*
+ * Post-VACUUM cleanup: just report statistics.
+ */
+Datum
+brinvacuumcleanup(PG_FUNCTION_ARGS)
+{
+	IndexVacuumInfo *info = (IndexVacuumInfo *) PG_GETARG_POINTER(0);
+	IndexBulkDeleteResult *stats = (IndexBulkDeleteResult *) PG_GETARG_POINTER(1);
+
+	/* No-op in ANALYZE ONLY mode */
+	if (info->analyze_only)
+		PG_RETURN_POINTER(stats);
+
+	if (stats == NULL)
+		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
+
+	stats->num_pages = RelationGetNumberOfBlocks(info->index);
+	stats->num_index_tuples = info->num_heap_tuples;
+	stats->estimated_count = info->estimated_count;
+
+	PG_RETURN_POINTER(stats);
+}
+
+Datum
+brinoptions(PG_FUNCTION_ARGS)
+{
+	Datum		reloptions = PG_GETARG_DATUM(0);
+	bool		validate = PG_GETARG_BOOL(1);
+	relopt_value *options;
+	BrinOptions *rdopts;
+	int			numoptions;
+	static const relopt_parse_elt tab[] = {
+		{"pages_per_range", RELOPT_TYPE_INT, offsetof(BrinOptions, pagesPerRange)}
+	};
+
+	options = parseRelOptions(reloptions, validate, RELOPT_KIND_BRIN,
+							  &numoptions);
+
+	/* if none set, we're done */
+	if (numoptions == 0)
+		PG_RETURN_NULL();
+
+	rdopts = allocateReloptStruct(sizeof(BrinOptions), options, numoptions);
+
+	fillRelOptions((void *) rdopts, sizeof(BrinOptions), options, numoptions,
+				   validate, tab, lengthof(tab));
+
+	pfree(options);
+
+	PG_RETURN_BYTEA_P(rdopts);
+}
@@ -0,0 +1,95 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin_xlog.c
+ *	  WAL replay logic for BRIN indexes.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			src/backend/access/brin/brin_xlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/brin.h"
+#include "access/xlogutils.h"
+#include "storage/bufmgr.h"
+
+
+static void
+brinRedoUpdate(XLogRecPtr lsn, XLogRecord *record)
+{
+	char	   *ptr = XLogRecGetData(record);
+	xl_brin_update *xldata = (xl_brin_update *) ptr;
+	Buffer		buffer;
+	Page		page;
+
+	/* If we have a full-page image, restore it and we're done */
+	if (record->xl_info & XLR_BKP_BLOCK_1)
+		return;
+
+	ptr += SizeOfBrinUpdate;
+
+	buffer = XLogReadBuffer(xldata->node, xldata->blkno, false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (!XLByteLE(lsn, PageGetLSN(page)))
+	{
+		Assert(xldata->offset + xldata->len <= BLCKSZ);
+		memcpy((char *) page + xldata->offset, ptr, xldata->len);
+
+		PageSetLSN(page, lsn);
+		PageSetTLI(page, ThisTimeLineID);
+		MarkBufferDirty(buffer);
+	}
+	UnlockReleaseBuffer(buffer);
+}
+
+void
+brin_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	/*
+	 * BRIN indexes do not require any conflict processing: summaries are
+	 * only ever widened, never removed.
+	 */
+	RestoreBkpBlocks(lsn, record, false);
+
+	switch (info)
+	{
+		case XLOG_BRIN_UPDATE:
+			brinRedoUpdate(lsn, record);
+			break;
+		default:
+			elog(PANIC, "brin_redo: unknown op code %u", info);
+	}
+}
+
+void
+brin_desc(StringInfo buf, uint8 xl_info, char *rec)
+{
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_BRIN_UPDATE:
+			{
+				xl_brin_update *xlrec = (xl_brin_update *) rec;
+
+				appendStringInfo(buf, "update summary: rel %u/%u/%u; blk %u off %u",
+								 xlrec->node.spcNode, xlrec->node.dbNode,
+								 xlrec->node.relNode, xlrec->blkno,
+								 xlrec->offset);
+			}
+			break;
+		default:
+			appendStringInfo(buf, "unknown brin op code %u", info);
+			break;
+	}
+}
@@ -75,6 +75,60 @@
  * ----------------------------------------------------------------
  */
 
+/*
+ * Return the missing value of an attribute, or NULL if there isn't one.
+ * This is what tuples stored before the attribute was added to the relation
+ * contain for it.
+ */
+Datum
+getmissingattr(TupleDesc tupleDesc, int attnum, bool *isnull)
+{
+	Assert(attnum > 0 && attnum <= tupleDesc->natts);
+
+	if (tupleDesc->constr && tupleDesc->constr->missing)
+	{
+		AttrMissing *attrmiss = tupleDesc->constr->missing + (attnum - 1);
+
+		if (attrmiss->am_present)
+		{
+			*isnull = false;
+			return attrmiss->am_value;
+		}
+	}
+
+	*isnull = true;
+	return (Datum) 0;
+}
+
+/*
+ * Fill in the values of attributes startAttNum to lastAttNum - 1 (counting
+ * from 0) of a tuple that doesn't contain them, from their missing values.
+ */
+static void
+getmissingattrs(TupleDesc tupleDesc, int startAttNum, int lastAttNum,
+				Datum *values, bool *isnull)
+{
+	AttrMissing *attrmiss = NULL;
+	int			attnum;
+
+	if (tupleDesc->constr)
+		attrmiss = tupleDesc->constr->missing;
+
+	for (attnum = startAttNum; attnum < lastAttNum; attnum++)
+	{
+		if (attrmiss && attrmiss[attnum].am_present)
+		{
+			values[attnum] = attrmiss[attnum].am_value;
+			isnull[attnum] = false;
+		}
+		else
+		{
+			values[attnum] = (Datum) 0;
+			isnull[attnum] = true;
+		}
+	}
+}
+
 
 /*
  * heap_compute_data_size
@@ -262,13 +316,23 @@ heap_fill_tuple(TupleDesc tupleDesc,
 
 /* ----------------
  *		heap_attisnull	- returns TRUE iff tuple attribute is not present
+ *
+ * tupleDesc is only needed to look up the missing value of an attribute the
+ * tuple doesn't contain; it may be NULL for catalogs and other relations
+ * that can't have any.
  * ----------------
  */
 bool
-heap_attisnull(HeapTuple tup, int attnum)
+heap_attisnull(HeapTuple tup, int attnum, TupleDesc tupleDesc)
 {
 	if (attnum > (int) HeapTupleHeaderGetNatts(tup->t_data))
-		return true;
+	{
+		bool		isnull = true;
+
+		if (tupleDesc)
+			(void) getmissingattr(tupleDesc, attnum, &isnull);
+		return isnull;
+	}
 
 	if (attnum > 0)
 	{
@@ -617,6 +681,49 @@ heap_copytuple_with_tuple(HeapTuple src, HeapTuple dest)
 	memcpy((char *) dest->t_data, (char *) src->t_data, src->t_len);
 }
 
+/* ----------------
+ *		heap_expand_tuple
+ *
+ *		returns a copy of a tuple that lacks some of the trailing attributes
+ *		of tupleDesc, because it was stored before they were added, with
+ *		those attributes filled in from their missing values, or nulls.
+ *
+ * The tuple's header fields, including its transaction status, are copied
+ * too, so the result can be used in place of the original.
+ * ----------------
+ */
+HeapTuple
+heap_expand_tuple(HeapTuple sourceTuple, TupleDesc tupleDesc)
+{
+	HeapTuple	tuple;
+	Datum	   *values;
+	bool	   *isnull;
+
+	Assert(HeapTupleHeaderGetNatts(sourceTuple->t_data) < tupleDesc->natts);
+
+	values = (Datum *) palloc(tupleDesc->natts * sizeof(Datum));
+	isnull = (bool *) palloc(tupleDesc->natts * sizeof(bool));
+
+	heap_deform_tuple(sourceTuple, tupleDesc, values, isnull);
+	tuple = heap_form_tuple(tupleDesc, values, isnull);
+
+	tuple->t_self = sourceTuple->t_self;
+	tuple->t_tableOid = sourceTuple->t_tableOid;
+	tuple->t_data->t_choice = sourceTuple->t_data->t_choice;
+	tuple->t_data->t_ctid = sourceTuple->t_data->t_ctid;
+	tuple->t_data->t_infomask |=
+		sourceTuple->t_data->t_infomask & HEAP_XACT_MASK;
+	tuple->t_data->t_infomask2 |=
+		sourceTuple->t_data->t_infomask2 & HEAP2_XACT_MASK;
+	if (tupleDesc->tdhasoid)
+		HeapTupleSetOid(tuple, HeapTupleGetOid(sourceTuple));
+
+	pfree(values);
+	pfree(isnull);
+
+	return tuple;
+}
+
 /*
  * heap_form_tuple
  *		construct a tuple from the given values[] and isnull[] arrays,
@@ -865,6 +972,127 @@ heap_modifytuple(HeapTuple tuple,
 	return result;
 }
 
+/*
+ * heap_first_null
+ *		Return the (zero-based) number of the first null attribute among
+ *		attributes start .. limit-1 of a tuple with null bitmap bp, or limit
+ *		if none of them is null.
+ *
+ * Whole bytes of the bitmap are checked at a time where possible, so this is
+ * cheap even for wide tuples.
+ */
+static int
+heap_first_null(bits8 *bp, int start, int limit)
+{
+	int			attnum = start;
+
+	while (attnum < limit && (attnum & 0x07) != 0)
+	{
+		if (att_isnull(attnum, bp))
+			return attnum;
+		attnum++;
+	}
+	while (attnum + 8 <= limit && bp[attnum >> 3] == 0xFF)
+		attnum += 8;
+	while (attnum < limit && !att_isnull(attnum, bp))
+		attnum++;
+
+	return attnum;
+}
+
+/*
+ * deform_attrs
+ *		Common guts of heap_deform_tuple and slot_deform_tuple: extract
+ *		attributes *attnump .. natts-1 of the tuple into values/isnull.
+ *
+ * *offp is the data offset just past the last attribute already extracted,
+ * and *slowp says whether some earlier attribute was null or variable-width,
+ * in which case the offsets precomputed in the deforming info no longer
+ * apply.  All three are updated on return, so that the caller can resume
+ * extraction later.
+ */
+static void
+deform_attrs(TupleDeformInfo *info, HeapTupleHeader tup, bool hasnulls,
+			 int natts, Datum *values, bool *isnull,
+			 int *attnump, long *offp, bool *slowp)
+{
+	bits8	   *bp = tup->t_bits;		/* ptr to null bitmap in tuple */
+	char	   *tp = (char *) tup + tup->t_hoff;		/* ptr to tuple data */
+	int			attnum = *attnump;
+	long		off = *offp;
+	bool		slow = *slowp;
+
+	/*
+	 * While the offsets are known in advance, fetch the attributes directly
+	 * without tracking the running offset or testing each null bit.  Nulls
+	 * in the tuple only stop this at the first of them, which we can find
+	 * by scanning the bitmap a byte at a time.
+	 */
+	if (!slow && attnum < info->ncached)
+	{
+		int			limit = Min(natts, info->ncached);
+		TupleDeformAttr *da;
+
+		if (hasnulls)
+			limit = heap_first_null(bp, attnum, limit);
+
+		if (attnum < limit)
+		{
+			for (; attnum < limit; attnum++)
+			{
+				da = &info->attrs[attnum];
+				values[attnum] = fetch_att(tp + da->cacheoff,
+										   da->attbyval, da->attlen);
+				isnull[attnum] = false;
+			}
+
+			/* only the last attribute with a cacheoff can be variable-width */
+			da = &info->attrs[attnum - 1];
+			off = att_addlength_pointer(da->cacheoff, da->attlen,
+										tp + da->cacheoff);
+			if (da->attlen <= 0)
+				slow = true;
+		}
+	}
+
+	for (; attnum < natts; attnum++)
+	{
+		TupleDeformAttr *da = &info->attrs[attnum];
+
+		if (hasnulls && att_isnull(attnum, bp))
+		{
+			values[attnum] = (Datum) 0;
+			isnull[attnum] = true;
+			slow = true;		/* can't use cacheoff anymore */
+			continue;
+		}
+
+		isnull[attnum] = false;
+
+		if (!slow && da->cacheoff >= 0)
+			off = da->cacheoff;
+		else if (da->attlen == -1)
+		{
+			/* as in att_align_pointer: short-header varlenas aren't padded */
+			if (!VARATT_NOT_PAD_BYTE(tp + off))
+				off = TYPEALIGN(da->alignby, off);
+		}
+		else
+			off = TYPEALIGN(da->alignby, off);
+
+		values[attnum] = fetch_att(tp + off, da->attbyval, da->attlen);
+
+		off = att_addlength_pointer(off, da->attlen, tp + off);
+
+		if (da->attlen <= 0)
+			slow = true;		/* can't use cacheoff anymore */
+	}
+
+	*attnump = attnum;
+	*offp = off;
+	*slowp = slow;
+}
+
 /*
  * heap_deform_tuple
  *		Given a tuple, extract data into values/isnull arrays; this is
@@ -886,15 +1114,11 @@ heap_deform_tuple(HeapTuple tuple, TupleDesc tupleDesc,
 				  Datum *values, bool *isnull)
 {
 	HeapTupleHeader tup = tuple->t_data;
-	bool		hasnulls = HeapTupleHasNulls(tuple);
-	Form_pg_attribute *att = tupleDesc->attrs;
 	int			tdesc_natts = tupleDesc->natts;
 	int			natts;			/* number of atts to extract */
-	int			attnum;
-	char	   *tp;				/* ptr to tuple data */
-	long		off;			/* offset in tuple data */
-	bits8	   *bp = tup->t_bits;		/* ptr to null bitmap in tuple */
-	bool		slow = false;	/* can we use/set attcacheoff? */
+	int			attnum = 0;
+	long		off = 0;		/* offset in tuple data */
+	bool		slow = false;	/* can we use precomputed offsets? */
 
 	natts = HeapTupleHeaderGetNatts(tup);
 
@@ -905,70 +1129,15 @@ heap_deform_tuple(HeapTuple tuple, TupleDesc tupleDesc,
 	 */
 	natts = Min(natts, tdesc_natts);
 
-	tp = (char *) tup + tup->t_hoff;
-
-	off = 0;
-
-	for (attnum = 0; attnum < natts; attnum++)
-	{
-		Form_pg_attribute thisatt = att[attnum];
-
-		if (hasnulls && att_isnull(attnum, bp))
-		{
-			values[attnum] = (Datum) 0;
-			isnull[attnum] = true;
-			slow = true;		/* can't use attcacheoff anymore */
-			continue;
-		}
-
-		isnull[attnum] = false;
-
-		if (!slow && thisatt->attcacheoff >= 0)
-			off = thisatt->attcacheoff;
-		else if (thisatt->attlen == -1)
-		{
-			/*
-			 * We can only cache the offset for a varlena attribute if the
-			 * offset is already suitably aligned, so that there would be no
-			 * pad bytes in any case: then the offset will be valid for either
-			 * an aligned or unaligned value.
-			 */
-			if (!slow &&
-				off == att_align_nominal(off, thisatt->attalign))
-				thisatt->attcacheoff = off;
-			else
-			{
-				off = att_align_pointer(off, thisatt->attalign, -1,
-										tp + off);
-				slow = true;
-			}
-		}
-		else
-		{
-			/* not varlena, so safe to use att_align_nominal */
-			off = att_align_nominal(off, thisatt->attalign);
-
-			if (!slow)
-				thisatt->attcacheoff = off;
-		}
-
-		values[attnum] = fetchatt(thisatt, tp + off);
-
-		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
-
-		if (thisatt->attlen <= 0)
-			slow = true;		/* can't use attcacheoff anymore */
-	}
+	deform_attrs(TupleDescGetDeformInfo(tupleDesc), tup,
+				 HeapTupleHasNulls(tuple), natts, values, isnull,
+				 &attnum, &off, &slow);
 
 	/*
 	 * If tuple doesn't have all the atts indicated by tupleDesc, read the
-	 * rest as null
+	 * rest from their missing values, or as null
 	 */
-	for (; attnum < tdesc_natts; attnum++)
-	{
-		values[attnum] = (Datum) 0;
-		isnull[attnum] = true;
-	}
+	getmissingattrs(tupleDesc, attnum, tdesc_natts, values, isnull);
 }
 
 /*
@@ -1025,17 +1194,9 @@ static void
 slot_deform_tuple(TupleTableSlot *slot, int natts)
 {
 	HeapTuple	tuple = slot->tts_tuple;
-	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
-	Datum	   *values = slot->tts_values;
-	bool	   *isnull = slot->tts_isnull;
-	HeapTupleHeader tup = tuple->t_data;
-	bool		hasnulls = HeapTupleHasNulls(tuple);
-	Form_pg_attribute *att = tupleDesc->attrs;
 	int			attnum;
-	char	   *tp;				/* ptr to tuple data */
 	long		off;			/* offset in tuple data */
-	bits8	   *bp = tup->t_bits;		/* ptr to null bitmap in tuple */
-	bool		slow;			/* can we use/set attcacheoff? */
+	bool		slow;			/* can we use precomputed offsets? */
 
 	/*
 	 * Check whether the first call for this tuple, and initialize or restore
@@ -1055,58 +1216,10 @@ slot_deform_tuple(TupleTableSlot *slot, int natts)
 		slow = slot->tts_slow;
 	}
 
-	tp = (char *) tup + tup->t_hoff;
-
-	for (; attnum < natts; attnum++)
-	{
-		Form_pg_attribute thisatt = att[attnum];
-
-		if (hasnulls && att_isnull(attnum, bp))
-		{
-			values[attnum] = (Datum) 0;
-			isnull[attnum] = true;
-			slow = true;		/* can't use attcacheoff anymore */
-			continue;
-		}
-
-		isnull[attnum] = false;
-
-		if (!slow && thisatt->attcacheoff >= 0)
-			off = thisatt->attcacheoff;
-		else if (thisatt->attlen == -1)
-		{
-			/*
-			 * We can only cache the offset for a varlena attribute if the
-			 * offset is already suitably aligned, so that there would be no
-			 * pad bytes in any case: then the offset will be valid for either
-			 * an aligned or unaligned value.
-			 */
-			if (!slow &&
-				off == att_align_nominal(off, thisatt->attalign))
-				thisatt->attcacheoff = off;
-			else
-			{
-				off = att_align_pointer(off, thisatt->attalign, -1,
-										tp + off);
-				slow = true;
-			}
-		}
-		else
-		{
-			/* not varlena, so safe to use att_align_nominal */
-			off = att_align_nominal(off, thisatt->attalign);
-
-			if (!slow)
-				thisatt->attcacheoff = off;
-		}
-
-		values[attnum] = fetchatt(thisatt, tp + off);
-
-		off = att_addlength_pointer(off, thisatt->attlen, tp + off);
-
-		if (thisatt->attlen <= 0)
-			slow = true;		/* can't use attcacheoff anymore */
-	}
+	deform_attrs(TupleDescGetDeformInfo(slot->tts_tupleDescriptor),
+				 tuple->t_data, HeapTupleHasNulls(tuple), natts,
+				 slot->tts_values, slot->tts_isnull,
+				 &attnum, &off, &slow);
 
 	/*
 	 * Save state for next execution
@@ -1173,7 +1286,8 @@ slot_getattr(TupleTableSlot *slot, int attnum, bool *isnull)
 		elog(ERROR, "cannot extract attribute from empty tuple slot");
 
 	/*
-	 * return NULL if attnum is out of range according to the tuple
+	 * return the missing value, or NULL, if attnum is out of range according
+	 * to the tuple
 	 *
 	 * (We have to check this separately because of various inheritance and
 	 * table-alteration scenarios: the tuple could be either longer or shorter
@@ -1181,10 +1295,7 @@ slot_getattr(TupleTableSlot *slot, int attnum, bool *isnull)
 	 */
 	tup = tuple->t_data;
 	if (attnum > HeapTupleHeaderGetNatts(tup))
-	{
-		*isnull = true;
-		return (Datum) 0;
-	}
+		return getmissingattr(tupleDesc, attnum, isnull);
 
 	/*
 	 * check if target attribute is null: no point in groveling through tuple
@@ -1206,6 +1317,31 @@ slot_getattr(TupleTableSlot *slot, int attnum, bool *isnull)
 		return (Datum) 0;
 	}
 
+	/*
+	 * If no attribute before this one is null and the attribute's offset is
+	 * known to be fixed, we can fetch it directly, without deforming all the
+	 * attributes that precede it.  This matters for quals on columns far
+	 * into a wide row, where most rows are rejected and their other columns
+	 * are never looked at.  We only do this when at least one not-yet-valid
+	 * attribute would be skipped; fetching the next attribute in sequence is
+	 * better done by slot_deform_tuple, which caches the result.
+	 */
+	if (attnum > slot->tts_nvalid + 1)
+	{
+		TupleDeformInfo *info = TupleDescGetDeformInfo(tupleDesc);
+
+		if (attnum <= info->ncached &&
+			(!HeapTupleHasNulls(tuple) ||
+			 heap_first_null(tup->t_bits, 0, attnum - 1) == attnum - 1))
+		{
+			TupleDeformAttr *da = &info->attrs[attnum - 1];
+
+			*isnull = false;
+			return fetch_att((char *) tup + tup->t_hoff + da->cacheoff,
+							 da->attbyval, da->attlen);
+		}
+	}
+
 	/*
 	 * Extract the attribute, along with any preceding attributes.
 	 */
@@ -1253,13 +1389,10 @@ slot_getallattrs(TupleTableSlot *slot)
 
 	/*
 	 * If tuple doesn't have all the atts indicated by tupleDesc, read the
-	 * rest as null
+	 * rest from their missing values, or as null
 	 */
-	for (; attnum < tdesc_natts; attnum++)
-	{
-		slot->tts_values[attnum] = (Datum) 0;
-		slot->tts_isnull[attnum] = true;
-	}
+	getmissingattrs(slot->tts_tupleDescriptor, attnum, tdesc_natts,
+					slot->tts_values, slot->tts_isnull);
 	slot->tts_nvalid = tdesc_natts;
 }
 
@@ -1300,13 +1433,10 @@ slot_getsomeattrs(TupleTableSlot *slot, int attnum)
 
 	/*
 	 * If tuple doesn't have all the atts indicated by tupleDesc, read the
-	 * rest as null
+	 * rest from their missing values, or as null
 	 */
-	for (; attno < attnum; attno++)
-	{
-		slot->tts_values[attno] = (Datum) 0;
-		slot->tts_isnull[attno] = true;
-	}
+	getmissingattrs(slot->tts_tupleDescriptor, attno, attnum,
+					slot->tts_values, slot->tts_isnull);
 	slot->tts_nvalid = attnum;
 }
 
@@ -1330,7 +1460,7 @@ slot_attisnull(TupleTableSlot *slot, int attnum)
 			elog(ERROR, "cannot extract system attribute from virtual tuple");
 		if (tuple == &(slot->tts_minhdr))		/* internal error */
 			elog(ERROR, "cannot extract system attribute from minimal tuple");
-		return heap_attisnull(tuple, attnum);
+		return heap_attisnull(tuple, attnum, tupleDesc);
 	}
 
 	/*
@@ -1353,7 +1483,7 @@ slot_attisnull(TupleTableSlot *slot, int attnum)
 		elog(ERROR, "cannot extract attribute from empty tuple slot");
 
 	/* and let the tuple tell it */
-	return heap_attisnull(tuple, attnum);
+	return heap_attisnull(tuple, attnum, tupleDesc);
 }
 
 /*
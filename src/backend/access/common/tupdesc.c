@@ -24,6 +24,8 @@
 #include "parser/parse_type.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
 #include "utils/resowner.h"
 #include "utils/syscache.h"
 
@@ -91,6 +93,7 @@ CreateTemplateTupleDesc(int natts, bool hasoid)
 	desc->tdtypmod = -1;
 	desc->tdhasoid = hasoid;
 	desc->tdrefcount = -1;		/* assume not reference-counted */
+	desc->tddeform = NULL;
 
 	return desc;
 }
@@ -124,6 +127,7 @@ CreateTupleDesc(int natts, bool hasoid, Form_pg_attribute *attrs)
 	desc->tdtypmod = -1;
 	desc->tdhasoid = hasoid;
 	desc->tdrefcount = -1;		/* assume not reference-counted */
+	desc->tddeform = NULL;
 
 	return desc;
 }
@@ -148,6 +152,7 @@ CreateTupleDescCopy(TupleDesc tupdesc)
 		memcpy(desc->attrs[i], tupdesc->attrs[i], ATTRIBUTE_FIXED_PART_SIZE);
 		desc->attrs[i]->attnotnull = false;
 		desc->attrs[i]->atthasdef = false;
+		desc->attrs[i]->atthasmissing = false;
 	}
 
 	desc->tdtypeid = tupdesc->tdtypeid;
@@ -206,6 +211,21 @@ CreateTupleDescCopyConstr(TupleDesc tupdesc)
 			}
 		}
 
+		if (constr->missing)
+		{
+			cpy->missing = (AttrMissing *) palloc(tupdesc->natts * sizeof(AttrMissing));
+			memcpy(cpy->missing, constr->missing, tupdesc->natts * sizeof(AttrMissing));
+			for (i = tupdesc->natts - 1; i >= 0; i--)
+			{
+				Form_pg_attribute attr = tupdesc->attrs[i];
+
+				if (constr->missing[i].am_present && !attr->attbyval)
+					cpy->missing[i].am_value = datumCopy(constr->missing[i].am_value,
+														 attr->attbyval,
+														 attr->attlen);
+			}
+		}
+
 		desc->constr = cpy;
 	}
 
@@ -255,12 +275,103 @@ FreeTupleDesc(TupleDesc tupdesc)
 			}
 			pfree(check);
 		}
+		if (tupdesc->constr->missing)
+		{
+			AttrMissing *missing = tupdesc->constr->missing;
+
+			for (i = tupdesc->natts - 1; i >= 0; i--)
+			{
+				if (missing[i].am_present && !tupdesc->attrs[i]->attbyval)
+					pfree(DatumGetPointer(missing[i].am_value));
+			}
+			pfree(missing);
+		}
 		pfree(tupdesc->constr);
 	}
 
+	if (tupdesc->tddeform)
+		pfree(tupdesc->tddeform);
+
 	pfree(tupdesc);
 }
 
+/*
+ * BuildTupleDescDeformInfo
+ *		Compute the deforming information for a tuple descriptor, and
+ *		remember it in the descriptor.  Callers should normally go through
+ *		the TupleDescGetDeformInfo macro, which builds it only once.
+ *
+ * The result is allocated in the same memory context as the descriptor
+ * itself, so that it lives exactly as long as the descriptor does; this
+ * matters for descriptors belonging to the relcache and typcache.
+ */
+TupleDeformInfo *
+BuildTupleDescDeformInfo(TupleDesc tupdesc)
+{
+	TupleDeformInfo *info;
+	int			natts = tupdesc->natts;
+	long		off = 0;
+	bool		fixed = true;
+	int			i;
+
+	info = (TupleDeformInfo *)
+		MemoryContextAlloc(GetMemoryChunkContext(tupdesc),
+						   offsetof(TupleDeformInfo, attrs) +
+						   Max(natts, 1) * sizeof(TupleDeformAttr));
+	info->ncached = 0;
+
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute att = tupdesc->attrs[i];
+		TupleDeformAttr *da = &info->attrs[i];
+
+		da->attlen = att->attlen;
+		da->attbyval = att->attbyval;
+		switch (att->attalign)
+		{
+			case 'i':
+				da->alignby = ALIGNOF_INT;
+				break;
+			case 'd':
+				da->alignby = ALIGNOF_DOUBLE;
+				break;
+			case 's':
+				da->alignby = ALIGNOF_SHORT;
+				break;
+			default:
+				da->alignby = 1;
+				break;
+		}
+
+		/*
+		 * The offset is fixed as long as every earlier attribute is fixed
+		 * width.  A varlena's offset can only be fixed if it is already
+		 * suitably aligned, so that there would be no pad bytes whether the
+		 * value is stored aligned or not.  This is the same rule the
+		 * deforming routines have always used for attcacheoff.
+		 */
+		da->cacheoff = -1;
+		if (fixed)
+		{
+			if (att->attlen != -1)
+				off = TYPEALIGN(da->alignby, off);
+			if (off == TYPEALIGN(da->alignby, off))
+			{
+				da->cacheoff = off;
+				info->ncached = i + 1;
+			}
+			if (att->attlen > 0)
+				off += att->attlen;
+			else
+				fixed = false;
+		}
+	}
+
+	tupdesc->tddeform = info;
+
+	return info;
+}
+
 /*
  * Increment the reference count of a tupdesc, and log the reference in
  * CurrentResourceOwner.
@@ -357,6 +468,8 @@ equalTupleDescs(TupleDesc tupdesc1, TupleDesc tupdesc2)
 			return false;
 		if (attr1->atthasdef != attr2->atthasdef)
 			return false;
+		if (attr1->atthasmissing != attr2->atthasmissing)
+			return false;
 		if (attr1->attisdropped != attr2->attisdropped)
 			return false;
 		if (attr1->attislocal != attr2->attislocal)
@@ -422,6 +535,26 @@ equalTupleDescs(TupleDesc tupdesc1, TupleDesc tupdesc2)
 			if (j >= n)
 				return false;
 		}
+		if (constr1->missing)
+		{
+			if (!constr2->missing)
+				return false;
+			for (i = 0; i < tupdesc1->natts; i++)
+			{
+				AttrMissing *missval1 = constr1->missing + i;
+				AttrMissing *missval2 = constr2->missing + i;
+
+				if (missval1->am_present != missval2->am_present)
+					return false;
+				if (missval1->am_present &&
+					!datumIsEqual(missval1->am_value, missval2->am_value,
+								  tupdesc1->attrs[i]->attbyval,
+								  tupdesc1->attrs[i]->attlen))
+					return false;
+			}
+		}
+		else if (constr2->missing)
+			return false;
 	}
 	else if (tupdesc2->constr != NULL)
 		return false;
@@ -477,11 +610,19 @@ TupleDescInitEntry(TupleDesc desc,
 	att->attcacheoff = -1;
 	att->atttypmod = typmod;
 
+	/* forget any deforming info computed from the old definition */
+	if (desc->tddeform)
+	{
+		pfree(desc->tddeform);
+		desc->tddeform = NULL;
+	}
+
 	att->attnum = attributeNumber;
 	att->attndims = attdim;
 
 	att->attnotnull = false;
 	att->atthasdef = false;
+	att->atthasmissing = false;
 	att->attisdropped = false;
 	att->attislocal = true;
 	att->attinhcount = 0;
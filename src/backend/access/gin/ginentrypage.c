@@ -28,9 +28,9 @@
  * are making a leaf-level key entry containing a posting list of nipd items.
  * If the caller is actually trying to make a posting-tree entry, non-leaf
  * entry, or pending-list entry, it should pass nipd = 0 and then overwrite
- * the t_tid fields as necessary.  In any case, ipd can be NULL to skip
- * copying any itempointers into the posting list; the caller is responsible
- * for filling the posting list afterwards, if ipd = NULL and nipd > 0.
+ * the t_tid fields as necessary.  Otherwise ipd[] must be in sorted order
+ * with no duplicates; it is stored in compressed form (see
+ * ginpostinglist.c), so the caller can't fill it in afterwards.
  */
 IndexTuple
 GinFormTuple(GinState *ginstate,
@@ -42,6 +42,10 @@ GinFormTuple(GinState *ginstate,
 	bool		isnull[2];
 	IndexTuple	itup;
 	uint32		newsize;
+	Size		postingsize = 0;
+	bool		compress = true;
+
+	Assert(ipd != NULL || nipd == 0);
 
 	/* Build the basic tuple: optional column number, plus key datum */
 	if (ginstate->oneCol)
@@ -82,7 +86,27 @@ GinFormTuple(GinState *ginstate,
 
 	newsize = SHORTALIGN(newsize);
 
-	GinSetPostingOffset(itup, newsize);
+	/*
+	 * Work out the size of the compressed posting list.  In the unlikely
+	 * event that compression doesn't pay off (TIDs very far apart), store a
+	 * plain array instead, as tuples in indexes built before compression
+	 * was added do.  That also guarantees that removing items from a
+	 * posting list never makes the tuple grow.
+	 */
+	if (nipd > 0)
+	{
+		postingsize = ginCompressedPostingListSize(ipd, nipd);
+		if (postingsize > sizeof(ItemPointerData) * nipd)
+		{
+			postingsize = sizeof(ItemPointerData) * nipd;
+			compress = false;
+		}
+	}
+
+	if (compress)
+		GinSetPostingOffset(itup, newsize | GIN_ITUP_COMPRESSED);
+	else
+		GinSetPostingOffset(itup, newsize);
 
 	GinSetNPosting(itup, nipd);
 
@@ -90,7 +114,7 @@ GinFormTuple(GinState *ginstate,
 	 * Add space needed for posting list, if any.  Then check that the tuple
 	 * won't be too big to store.
 	 */
-	newsize += sizeof(ItemPointerData) * nipd;
+	newsize += postingsize;
 	newsize = MAXALIGN(newsize);
 	if (newsize > Min(INDEX_SIZE_MASK, GinMaxItemSize))
 	{
@@ -128,37 +152,20 @@ GinFormTuple(GinState *ginstate,
 	}
 
 	/*
-	 * Copy in the posting list, if provided
+	 * Copy in the posting list, if any
 	 */
-	if (ipd)
-		memcpy(GinGetPosting(itup), ipd, sizeof(ItemPointerData) * nipd);
+	if (nipd > 0)
+	{
+		if (!compress)
+			memcpy(GinGetPosting(itup), ipd, postingsize);
+		else if (ginCompressPostingList(ipd, nipd,
+										GinGetPosting(itup)) != postingsize)
+			elog(ERROR, "unexpected compressed posting list size");
+	}
 
 	return itup;
 }
 
-/*
- * Sometimes we reduce the number of posting list items in a tuple after
- * having built it with GinFormTuple.  This function adjusts the size
- * fields to match.
- */
-void
-GinShortenTuple(IndexTuple itup, uint32 nipd)
-{
-	uint32		newsize;
-
-	Assert(nipd <= GinGetNPosting(itup));
-
-	newsize = GinGetPostingOffset(itup) + sizeof(ItemPointerData) * nipd;
-	newsize = MAXALIGN(newsize);
-
-	Assert(newsize <= (itup->t_info & INDEX_SIZE_MASK));
-
-	itup->t_info &= ~INDEX_SIZE_MASK;
-	itup->t_info |= newsize;
-
-	GinSetNPosting(itup, nipd);
-}
-
 /*
  * Form a non-leaf entry tuple by copying the key data from the given tuple,
  * which can be either a leaf or non-leaf entry tuple.
@@ -554,6 +561,7 @@ entrySplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogR
 	Size		totalsize = 0;
 	Size		lsize = 0,
 				size;
+	bool		appending;
 	char	   *ptr;
 	IndexTuple	itup,
 				leftrightmost = NULL;
@@ -575,6 +583,15 @@ entrySplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogR
 	maxoff = PageGetMaxOffsetNumber(lpage);
 	ptr = tupstore;
 
+	/*
+	 * An index build inserts keys in order once it has sorted them, so a
+	 * tuple added at the end of the rightmost page will be followed by more.
+	 * In that case leave the left page full and start the right one with
+	 * just the new tuple, as dataSplitPage does for TIDs.
+	 */
+	appending = (btree->isBuild && GinPageRightMost(lpage) &&
+				 off > maxoff);
+
 	for (i = FirstOffsetNumber; i <= maxoff; i++)
 	{
 		if (i == off)
@@ -612,7 +629,7 @@ entrySplitPage(GinBtree btree, Buffer lbuf, Buffer rbuf, OffsetNumber off, XLogR
 	{
 		itup = (IndexTuple) ptr;
 
-		if (lsize > totalsize / 2)
+		if (appending ? (i == maxoff) : (lsize > totalsize / 2))
 		{
 			if (separator == InvalidOffsetNumber)
 				separator = i - 1;
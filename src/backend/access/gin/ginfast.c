@@ -21,6 +21,7 @@
 #include "access/gin_private.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
+#include "storage/lmgr.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
@@ -229,6 +230,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
+	int			cleanupSize;
 
 	if (collector->ntuples == 0)
 		return;
@@ -413,15 +415,16 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 		UnlockReleaseBuffer(buffer);
 
 	/*
-	 * Force pending list cleanup when it becomes too long. And,
-	 * ginInsertCleanup could take significant amount of time, so we prefer to
-	 * call it when it can do all the work in a single collection cycle. In
-	 * non-vacuum mode, it shouldn't require maintenance_work_mem, so fire it
-	 * while pending list is still small enough to fit into work_mem.
+	 * Force pending list cleanup when it becomes too long, as set by the
+	 * index's gin_pending_list_limit storage parameter or else the GUC of the
+	 * same name.  ginInsertCleanup could take significant amount of time, so
+	 * we prefer to call it when it can do all the work in a single
+	 * collection cycle; a limit small enough to fit into work_mem is best.
 	 *
 	 * ginInsertCleanup() should not be called inside our CRIT_SECTION.
 	 */
-	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > work_mem * 1024L)
+	cleanupSize = GinGetPendingListLimit(index);
+	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * 1024L)
 		needCleanup = true;
 
 	UnlockReleaseBuffer(metabuffer);
@@ -429,7 +432,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	END_CRIT_SECTION();
 
 	if (needCleanup)
-		ginInsertCleanup(ginstate, false, NULL);
+		ginInsertCleanup(ginstate, false, false, NULL);
 }
 
 /*
@@ -716,12 +719,23 @@ processPendingPage(BuildAccumulator *accum, KeyArray *ka,
  * action of removing a page from the pending list really needs exclusive
  * lock.
  *
+ * Still, there's no point in two backends doing the same work, and an
+ * inserter that has to wait for someone else's cleanup to finish before
+ * its own insertion returns sees a long, unpredictable stall.  So cleanups
+ * are serialized with a heavyweight lock on the metapage.  An inserter that
+ * finds a cleanup already in progress just returns, leaving the work to
+ * the backend that is doing it; and an inserter's cleanup stops at the
+ * page that was the tail of the list when it started, so that it can't be
+ * kept busy indefinitely by concurrent insertions.
+ *
+ * full_clean means that the whole pending list should be processed, waiting
+ * for any concurrent cleanup to finish first; VACUUM uses this.
  * vac_delay indicates that ginInsertCleanup is called from vacuum process,
  * so call vacuum_delay_point() periodically.
  * If stats isn't null, we count deleted pending pages into the counts.
  */
 void
-ginInsertCleanup(GinState *ginstate,
+ginInsertCleanup(GinState *ginstate, bool full_clean,
 				 bool vac_delay, IndexBulkDeleteResult *stats)
 {
 	Relation	index = ginstate->index;
@@ -734,7 +748,18 @@ ginInsertCleanup(GinState *ginstate,
 				oldCtx;
 	BuildAccumulator accum;
 	KeyArray	datums;
-	BlockNumber blkno;
+	BlockNumber blkno,
+				blknoFinish;
+	bool		cleanupFinish = false;
+
+	/*
+	 * Only one backend cleans up the pending list at a time.  VACUUM waits
+	 * its turn, but an inserter leaves the job to whoever is already at it.
+	 */
+	if (full_clean)
+		LockPage(index, GIN_METAPAGE_BLKNO, ExclusiveLock);
+	else if (!ConditionalLockPage(index, GIN_METAPAGE_BLKNO, ExclusiveLock))
+		return;
 
 	metabuffer = ReadBuffer(index, GIN_METAPAGE_BLKNO);
 	LockBuffer(metabuffer, GIN_SHARE);
@@ -745,9 +770,17 @@ ginInsertCleanup(GinState *ginstate,
 	{
 		/* Nothing to do */
 		UnlockReleaseBuffer(metabuffer);
+		UnlockPage(index, GIN_METAPAGE_BLKNO, ExclusiveLock);
 		return;
 	}
 
+	/*
+	 * Remember the current tail page.  Unless asked for a full clean, we stop
+	 * after processing it, leaving anything added meanwhile for the next
+	 * cleanup.  The tail page always ends a sublist, so it has a full row.
+	 */
+	blknoFinish = metadata->tail;
+
 	/*
 	 * Read and lock head of pending list
 	 */
@@ -787,6 +820,9 @@ ginInsertCleanup(GinState *ginstate,
 			break;
 		}
 
+		if (blkno == blknoFinish && !full_clean)
+			cleanupFinish = true;
+
 		/*
 		 * read page's datums into accum
 		 */
@@ -797,15 +833,16 @@ ginInsertCleanup(GinState *ginstate,
 
 		/*
 		 * Is it time to flush memory to disk?	Flush if we are at the end of
-		 * the pending list, or if we have a full row and memory is getting
-		 * full.
+		 * the pending list or of the part of it we were asked to clean, or
+		 * if we have a full row and memory is getting full.
 		 *
 		 * XXX using up maintenance_work_mem here is probably unreasonably
 		 * much, since vacuum might already be using that much.
 		 */
 		if (GinPageGetOpaque(page)->rightlink == InvalidBlockNumber ||
 			(GinPageHasFullRow(page) &&
-			 (accum.allocatedMemory >= maintenance_work_mem * 1024L)))
+			 (cleanupFinish ||
+			  accum.allocatedMemory >= maintenance_work_mem * 1024L)))
 		{
 			ItemPointerData *list;
 			uint32		nlist;
@@ -893,9 +930,10 @@ ginInsertCleanup(GinState *ginstate,
 			LockBuffer(metabuffer, GIN_UNLOCK);
 
 			/*
-			 * if we removed the whole pending list just exit
+			 * if we removed the whole pending list, or the part of it we
+			 * meant to clean, just exit
 			 */
-			if (blkno == InvalidBlockNumber)
+			if (blkno == InvalidBlockNumber || cleanupFinish)
 				break;
 
 			/*
@@ -921,6 +959,7 @@ ginInsertCleanup(GinState *ginstate,
 	}
 
 	ReleaseBuffer(metabuffer);
+	UnlockPage(index, GIN_METAPAGE_BLKNO, ExclusiveLock);
 
 	/* Clean up temporary space */
 	MemoryContextSwitchTo(oldCtx);
@@ -344,9 +344,13 @@ collectMatchBitmap(GinBtreeData *btree, GinBtreeStack *stack,
 		}
 		else
 		{
-			tbm_add_tuples(scanEntry->matchBitmap,
-						   GinGetPosting(itup), GinGetNPosting(itup), false);
-			scanEntry->predictNumberResult += GinGetNPosting(itup);
+			ItemPointerData *ipd;
+			uint32		nipd;
+
+			ipd = ginReadTuple(itup, &nipd);
+			tbm_add_tuples(scanEntry->matchBitmap, ipd, nipd, false);
+			scanEntry->predictNumberResult += nipd;
+			pfree(ipd);
 		}
 
 		/*
@@ -371,6 +375,7 @@ startScanEntry(GinState *ginstate, GinScanEntry entry)
 
 restartScanEntry:
 	entry->buffer = InvalidBuffer;
+	entry->postingRoot = InvalidBlockNumber;
 	ItemPointerSetMin(&entry->curItem);
 	entry->offset = InvalidOffsetNumber;
 	entry->list = NULL;
@@ -450,6 +455,7 @@ restartScanEntry:
 			 */
 			LockBuffer(stackEntry->buffer, GIN_UNLOCK);
 			needUnlock = FALSE;
+			entry->postingRoot = rootPostingTree;
 			gdi = ginPrepareScanPostingTree(ginstate->index, rootPostingTree, TRUE);
 
 			entry->buffer = ginScanBeginPostingTree(gdi);
@@ -479,9 +485,7 @@ restartScanEntry:
 		}
 		else if (GinGetNPosting(itup) > 0)
 		{
-			entry->nlist = GinGetNPosting(itup);
-			entry->list = (ItemPointerData *) palloc(sizeof(ItemPointerData) * entry->nlist);
-			memcpy(entry->list, GinGetPosting(itup), sizeof(ItemPointerData) * entry->nlist);
+			entry->list = ginReadTuple(itup, &entry->nlist);
 			entry->isFinished = FALSE;
 		}
 	}
@@ -491,9 +495,73 @@ restartScanEntry:
 	freeGinBtreeStack(stackEntry);
 }
 
+/*
+ * Keys with more user entries than this don't get their required entries
+ * identified, since that takes 2^(nentries - 1) consistentFn calls per entry.
+ */
+#define MAX_REQUIRED_CHECK_ENTRIES	6
+
+/*
+ * Determine which entries of a key are required, ie, the consistentFn
+ * returns false whenever that entry is false, whatever the other entries are.
+ *
+ * We can't tell that from a single consistentFn call, since the combining
+ * logic might not be monotonic (think NOT), so all combinations of the
+ * other entries are tried.  That's only done for keys with a few entries,
+ * but it's done once per scan, not per TID.  The consistentFn's result
+ * depends only on the check array, so the answer holds for the whole scan.
+ */
 static void
-startScanKey(GinState *ginstate, GinScanKey key)
+setRequiredEntries(GinState *ginstate, MemoryContext tempCtx, GinScanKey key)
 {
+	uint32		nentries = key->nuserentries;
+	uint32		i,
+				j;
+	MemoryContext oldCtx;
+
+	memset(key->entryRequired, FALSE, key->nentries);
+
+	if (key->searchMode == GIN_SEARCH_MODE_EVERYTHING ||
+		nentries == 0 || nentries > MAX_REQUIRED_CHECK_ENTRIES)
+		return;
+
+	oldCtx = MemoryContextSwitchTo(tempCtx);
+
+	for (i = 0; i < nentries; i++)
+	{
+		uint32		ncombos = 1 << (nentries - 1);
+		uint32		combo;
+		bool		required = true;
+
+		for (combo = 0; combo < ncombos && required; combo++)
+		{
+			uint32		bit = 0;
+
+			/* distribute the bits of combo over the entries other than i */
+			for (j = 0; j < nentries; j++)
+			{
+				if (j == i)
+					key->entryRes[j] = FALSE;
+				else
+					key->entryRes[j] = (combo & (1 << bit++)) ? TRUE : FALSE;
+			}
+
+			if (callConsistentFn(ginstate, key))
+				required = false;
+		}
+
+		key->entryRequired[i] = required;
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextReset(tempCtx);
+}
+
+static void
+startScanKey(GinState *ginstate, MemoryContext tempCtx, GinScanKey key)
+{
+	setRequiredEntries(ginstate, tempCtx, key);
+
 	ItemPointerSetMin(&key->curItem);
 	key->curItemMatches = false;
 	key->recheckCurItem = false;
@@ -532,7 +600,7 @@ startScan(IndexScanDesc scan)
 	}
 
 	for (i = 0; i < so->nkeys; i++)
-		startScanKey(ginstate, so->keys + i);
+		startScanKey(ginstate, so->tempCtx, so->keys + i);
 }
 
 /*
@@ -708,6 +776,139 @@ entryGetItem(GinState *ginstate, GinScanEntry entry)
 	}
 }
 
+/*
+ * Find the first item in entry->list[start .. entry->nlist - 1] that is
+ * greater than advancePast, or return entry->nlist if there's none.
+ */
+static uint32
+entryFindInList(GinScanEntry entry, uint32 start, ItemPointer advancePast)
+{
+	uint32		low = start,
+				high = entry->nlist;
+
+	while (low < high)
+	{
+		uint32		mid = low + (high - low) / 2;
+
+		if (ginCompareItemPointers(&entry->list[mid], advancePast) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/*
+ * Advance an entry stream to its first item greater than advancePast.
+ *
+ * This gives the same result as calling entryGetItem until curItem passes
+ * advancePast, but binary-searches the in-memory posting list or page, and
+ * for a posting tree descends from the root to the right leaf page instead
+ * of reading every page in between.  The caller must already have checked
+ * that the entry isn't finished, and that curItem is <= advancePast.
+ */
+static void
+entrySkipPast(GinState *ginstate, GinScanEntry entry, ItemPointer advancePast)
+{
+	uint32		idx;
+
+	Assert(!entry->isFinished);
+
+	if (entry->matchBitmap || entry->reduceResult)
+	{
+		/* no way to seek in a bitmap, nor to skip items while reducing */
+		do
+		{
+			entryGetItem(ginstate, entry);
+		} while (entry->isFinished == FALSE &&
+				 ginCompareItemPointers(&entry->curItem, advancePast) <= 0);
+		return;
+	}
+
+	if (!BufferIsValid(entry->buffer))
+	{
+		/* posting list kept in memory; entry->offset items are consumed */
+		idx = entryFindInList(entry, entry->offset, advancePast);
+		if (idx < entry->nlist)
+		{
+			entry->curItem = entry->list[idx];
+			entry->offset = idx + 1;
+		}
+		else
+		{
+			ItemPointerSetInvalid(&entry->curItem);
+			entry->offset = entry->nlist;
+			entry->isFinished = TRUE;
+		}
+		return;
+	}
+
+	/* Posting tree: is the wanted item on the page we already have? */
+	if (entry->offset < entry->nlist &&
+		ginCompareItemPointers(&entry->list[entry->nlist - 1], advancePast) > 0)
+	{
+		idx = entryFindInList(entry, entry->offset, advancePast);
+		entry->curItem = entry->list[idx];
+		entry->offset = idx + 1;
+		return;
+	}
+
+	/*
+	 * No, so descend the posting tree again to the leaf page that should
+	 * contain advancePast.  This is just like the initial descent in
+	 * startScanEntry, and is safe against concurrent vacuum for the same
+	 * reasons.
+	 */
+	{
+		GinPostingTreeScan *gdi;
+		Page		page;
+
+		ReleaseBuffer(entry->buffer);
+
+		gdi = ginPrepareScanPostingTree(ginstate->index, entry->postingRoot,
+										TRUE);
+		/* search for advancePast rather than for the leftmost page */
+		gdi->btree.fullScan = FALSE;
+		gdi->btree.items = advancePast;
+		gdi->btree.nitem = 1;
+		gdi->btree.curitem = 0;
+
+		entry->buffer = ginScanBeginPostingTree(gdi);
+		IncrBufferRefCount(entry->buffer);
+
+		page = BufferGetPage(entry->buffer);
+		entry->nlist = GinPageGetOpaque(page)->maxoff;
+		memcpy(entry->list, GinDataPageGetItem(page, FirstOffsetNumber),
+			   GinPageGetOpaque(page)->maxoff * sizeof(ItemPointerData));
+
+		LockBuffer(entry->buffer, GIN_UNLOCK);
+		freeGinBtreeStack(gdi->stack);
+		pfree(gdi);
+	}
+
+	idx = entryFindInList(entry, 0, advancePast);
+	if (idx < entry->nlist)
+	{
+		entry->curItem = entry->list[idx];
+		entry->offset = idx + 1;
+		return;
+	}
+
+	/*
+	 * Everything on this leaf is <= advancePast (or it is empty), so let
+	 * entryGetNextItem follow the right links from here, looking for the
+	 * first item > advancePast.
+	 */
+	entry->offset = entry->nlist;
+	entry->curItem = *advancePast;
+	do
+	{
+		entryGetNextItem(ginstate, entry);
+	} while (entry->isFinished == FALSE &&
+			 ginCompareItemPointers(&entry->curItem, advancePast) <= 0);
+}
+
 /*
  * Identify the "current" item among the input entry streams for this scan key,
  * and test whether it passes the scan key qual condition.
@@ -913,6 +1114,7 @@ scanGetItem(IndexScanDesc scan, ItemPointer advancePast,
 	ItemPointerData myAdvancePast = *advancePast;
 	uint32		i;
 	bool		allFinished;
+	bool		skipped;
 	bool		match;
 
 	for (;;)
@@ -928,10 +1130,9 @@ scanGetItem(IndexScanDesc scan, ItemPointer advancePast,
 		{
 			GinScanEntry entry = so->entries[i];
 
-			while (entry->isFinished == FALSE &&
-				   ginCompareItemPointers(&entry->curItem,
-										  &myAdvancePast) <= 0)
-				entryGetItem(ginstate, entry);
+			if (entry->isFinished == FALSE &&
+				ginCompareItemPointers(&entry->curItem, &myAdvancePast) <= 0)
+				entrySkipPast(ginstate, entry, &myAdvancePast);
 
 			if (entry->isFinished == FALSE)
 				allFinished = FALSE;
@@ -943,6 +1144,55 @@ scanGetItem(IndexScanDesc scan, ItemPointer advancePast,
 			return false;
 		}
 
+		/*
+		 * Since the keys are ANDed, nothing can match before every required
+		 * entry of every key has reached it.  If some required entry is
+		 * ahead of myAdvancePast, we can skip all other entries forward to
+		 * it without testing the TIDs in between.  A required entry's
+		 * lossy-page pointer might match anything on its page, so skip only
+		 * to the start of that page.  This is what makes 'rare & common'
+		 * cheap: the common entry jumps from one TID of the rare entry to
+		 * the next.
+		 */
+		skipped = false;
+		for (i = 0; i < so->nkeys; i++)
+		{
+			GinScanKey	key = so->keys + i;
+			uint32		j;
+
+			for (j = 0; j < key->nuserentries; j++)
+			{
+				GinScanEntry entry = key->scanEntry[j];
+				ItemPointerData bound;
+
+				if (!key->entryRequired[j])
+					continue;
+
+				/* a required entry is exhausted, so its key can't match */
+				if (entry->isFinished)
+					return false;
+
+				/* compute the last TID that can't match */
+				if (ItemPointerIsLossyPage(&entry->curItem))
+					ItemPointerSet(&bound,
+								   GinItemPointerGetBlockNumber(&entry->curItem),
+								   InvalidOffsetNumber);
+				else
+					ItemPointerSet(&bound,
+								   GinItemPointerGetBlockNumber(&entry->curItem),
+								   GinItemPointerGetOffsetNumber(&entry->curItem) - 1);
+
+				if (ginCompareItemPointers(&bound, &myAdvancePast) > 0)
+				{
+					myAdvancePast = bound;
+					skipped = true;
+				}
+			}
+		}
+
+		if (skipped)
+			continue;
+
 		/*
 		 * Perform the consistentFn test for each scan key.  If any key
 		 * reports isFinished, meaning its subset of the entries is exhausted,
@@ -22,6 +22,7 @@
 #include "storage/indexfsm.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/tuplesort.h"
 
 
 typedef struct
@@ -32,6 +33,7 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+	Tuplesortstate *sortstate;	/* spilled entries, or NULL if none yet */
 } GinBuildState;
 
 /*
@@ -94,89 +96,10 @@ createPostingTree(Relation index, ItemPointerData *items, uint32 nitems)
 }
 
 
-/*
- * Adds array of item pointers to tuple's posting list, or
- * creates posting tree and tuple pointing to tree in case
- * of not enough space.  Max size of tuple is defined in
- * GinFormTuple().	Returns a new, modified index tuple.
- * items[] must be in sorted order with no duplicates.
- */
-static IndexTuple
-addItemPointersToLeafTuple(GinState *ginstate,
-						   IndexTuple old,
-						   ItemPointerData *items, uint32 nitem,
-						   GinStatsData *buildStats)
-{
-	OffsetNumber attnum;
-	Datum		key;
-	GinNullCategory category;
-	IndexTuple	res;
-
-	Assert(!GinIsPostingTree(old));
-
-	attnum = gintuple_get_attrnum(ginstate, old);
-	key = gintuple_get_key(ginstate, old, &category);
-
-	/* try to build tuple with room for all the items */
-	res = GinFormTuple(ginstate, attnum, key, category,
-					   NULL, nitem + GinGetNPosting(old),
-					   false);
-
-	if (res)
-	{
-		/* good, small enough */
-		uint32		newnitem;
-
-		/* fill in the posting list with union of old and new TIDs */
-		newnitem = ginMergeItemPointers(GinGetPosting(res),
-										GinGetPosting(old),
-										GinGetNPosting(old),
-										items, nitem);
-		/* merge might have eliminated some duplicate items */
-		GinShortenTuple(res, newnitem);
-	}
-	else
-	{
-		/* posting list would be too big, convert to posting tree */
-		BlockNumber postingRoot;
-		GinPostingTreeScan *gdi;
-
-		/*
-		 * Initialize posting tree with the old tuple's posting list.  It's
-		 * surely small enough to fit on one posting-tree page, and should
-		 * already be in order with no duplicates.
-		 */
-		postingRoot = createPostingTree(ginstate->index,
-										GinGetPosting(old),
-										GinGetNPosting(old));
-
-		/* During index build, count the newly-added data page */
-		if (buildStats)
-			buildStats->nDataPages++;
-
-		/* Now insert the TIDs-to-be-added into the posting tree */
-		gdi = ginPrepareScanPostingTree(ginstate->index, postingRoot, FALSE);
-		gdi->btree.isBuild = (buildStats != NULL);
-
-		ginInsertItemPointers(gdi, items, nitem, buildStats);
-
-		pfree(gdi);
-
-		/* And build a new posting-tree-only result tuple */
-		res = GinFormTuple(ginstate, attnum, key, category, NULL, 0, true);
-		GinSetPostingTree(res, postingRoot);
-	}
-
-	return res;
-}
-
 /*
  * Build a fresh leaf tuple, either posting-list or posting-tree format
  * depending on whether the given items list will fit.
  * items[] must be in sorted order with no duplicates.
- *
- * This is basically the same logic as in addItemPointersToLeafTuple,
- * but working from slightly different input.
  */
 static IndexTuple
 buildFreshLeafTuple(GinState *ginstate,
@@ -236,6 +159,56 @@ buildFreshLeafTuple(GinState *ginstate,
 	return res;
 }
 
+/*
+ * Adds array of item pointers to tuple's posting list, or
+ * creates posting tree and tuple pointing to tree in case
+ * of not enough space.  Max size of tuple is defined in
+ * GinFormTuple().	Returns a new, modified index tuple.
+ * items[] must be in sorted order with no duplicates.
+ */
+static IndexTuple
+addItemPointersToLeafTuple(GinState *ginstate,
+						   IndexTuple old,
+						   ItemPointerData *items, uint32 nitem,
+						   GinStatsData *buildStats)
+{
+	OffsetNumber attnum;
+	Datum		key;
+	GinNullCategory category;
+	IndexTuple	res;
+	ItemPointerData *oldItems;
+	uint32		oldNPosting;
+	ItemPointerData *newItems;
+	uint32		newNPosting;
+
+	Assert(!GinIsPostingTree(old));
+
+	attnum = gintuple_get_attrnum(ginstate, old);
+	key = gintuple_get_key(ginstate, old, &category);
+
+	/*
+	 * The posting list is compressed, so we can't tell whether the result
+	 * will fit without building the union of old and new TIDs first.
+	 */
+	oldItems = ginReadTuple(old, &oldNPosting);
+
+	newItems = (ItemPointerData *)
+		palloc(sizeof(ItemPointerData) * (oldNPosting + nitem));
+	/* merge might eliminate some duplicate items */
+	newNPosting = ginMergeItemPointers(newItems,
+									   oldItems, oldNPosting,
+									   items, nitem);
+
+	/* build a posting-list or posting-tree tuple, whichever fits */
+	res = buildFreshLeafTuple(ginstate, attnum, key, category,
+							  newItems, newNPosting, buildStats);
+
+	pfree(newItems);
+	pfree(oldItems);
+
+	return res;
+}
+
 /*
  * Insert one or more heap TIDs associated with the given key value.
  * This will either add a single key entry, or enlarge a pre-existing entry.
@@ -302,10 +275,267 @@ ginEntryInsert(GinState *ginstate,
 
 	/* Insert the new or modified leaf tuple */
 	btree.entry = itup;
+	btree.isBuild = (buildStats != NULL);
 	ginInsertValue(&btree, stack, buildStats);
 	pfree(itup);
 }
 
+/*
+ * Compare the keys of two leaf tuples.
+ */
+static int
+ginCompareTupleKeys(GinState *ginstate, IndexTuple a, IndexTuple b)
+{
+	Datum		keya,
+				keyb;
+	GinNullCategory categorya,
+				categoryb;
+
+	keya = gintuple_get_key(ginstate, a, &categorya);
+	keyb = gintuple_get_key(ginstate, b, &categoryb);
+
+	return ginCompareAttEntries(ginstate,
+								gintuple_get_attrnum(ginstate, a),
+								keya, categorya,
+								gintuple_get_attrnum(ginstate, b),
+								keyb, categoryb);
+}
+
+/*
+ * Sort order of the leaf tuples that an index build spills to a tuplesort:
+ * by key, then by the first TID of the (non-empty) posting list.  Reading
+ * the sorted tuples back therefore yields each key's TIDs in nearly sorted
+ * order, since each spilled run of TIDs for a key is itself sorted.
+ */
+int
+ginCompareBuildTuples(GinState *ginstate, IndexTuple a, IndexTuple b)
+{
+	ItemPointerData firsta,
+				firstb;
+	int			res;
+
+	res = ginCompareTupleKeys(ginstate, a, b);
+	if (res != 0)
+		return res;
+
+	ginReadTupleFirstItem(a, &firsta);
+	ginReadTupleFirstItem(b, &firstb);
+
+	return ginCompareItemPointers(&firsta, &firstb);
+}
+
+/*
+ * Add one key's TIDs from the BuildAccumulator to the build's tuplesort, as
+ * leaf tuples each holding as many of the TIDs as fit in a posting list.
+ * items[] must be in sorted order with no duplicates.
+ */
+static void
+ginBuildSpillEntry(GinBuildState *buildstate,
+				   OffsetNumber attnum, Datum key, GinNullCategory category,
+				   ItemPointerData *items, uint32 nitem)
+{
+	uint32		chunk = nitem;
+
+	while (nitem > 0)
+	{
+		IndexTuple	itup;
+
+		chunk = Min(chunk, nitem);
+		itup = GinFormTuple(&buildstate->ginstate, attnum, key, category,
+							items, chunk, false);
+		if (itup == NULL)
+		{
+			if (chunk > 1)
+			{
+				chunk /= 2;
+				continue;
+			}
+
+			/*
+			 * The key leaves no room for even one TID.  Such a key is always
+			 * stored with a posting tree, and can't take part in the sort,
+			 * so add its TIDs to the index straight away.
+			 */
+			ginEntryInsert(&buildstate->ginstate, attnum, key, category,
+						   items, nitem, &buildstate->buildStats);
+			return;
+		}
+
+		tuplesort_putindextuple(buildstate->sortstate, itup);
+		pfree(itup);
+
+		items += chunk;
+		nitem -= chunk;
+
+		/* the next TIDs are likely to compress about as well */
+		if (chunk < nitem)
+			chunk *= 2;
+	}
+}
+
+/*
+ * Move everything in the BuildAccumulator to the build's tuplesort,
+ * starting the sort if this is the first time.  Caller must reset the
+ * accumulator afterwards.
+ */
+static void
+ginBuildSpill(GinBuildState *buildstate)
+{
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+
+	/*
+	 * The sort and the accumulator get half of maintenance_work_mem each.
+	 * The sort must survive resets of tmpCtx, so create it in tmpCtx's
+	 * parent.
+	 */
+	if (buildstate->sortstate == NULL)
+	{
+		MemoryContext oldCtx;
+
+		oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx->parent);
+		buildstate->sortstate =
+			tuplesort_begin_index_gin(buildstate->ginstate.index,
+									  &buildstate->ginstate,
+									  maintenance_work_mem / 2,
+									  false);
+		MemoryContextSwitchTo(oldCtx);
+	}
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+		ginBuildSpillEntry(buildstate, attnum, key, category, list, nlist);
+	}
+}
+
+/*
+ * Read back the tuples spilled to the build's tuplesort, and insert each key
+ * into the index with all of its TIDs at once, in key order.  That way each
+ * entry is inserted once rather than enlarged after every spill, insertions
+ * go to the rightmost leaf page and fill it (see entrySplitPage), and each
+ * posting tree is built by appending TIDs in order.
+ *
+ * The TIDs collected for one key are bounded by half of
+ * maintenance_work_mem; beyond that we insert what we have and carry on.
+ */
+static void
+ginBuildInsertSorted(GinBuildState *buildstate)
+{
+	GinState   *ginstate = &buildstate->ginstate;
+	IndexTuple	curtup = NULL;
+	IndexTuple	itup;
+	bool		should_free;
+	ItemPointerData *items;
+	uint32		nitems = 0;
+	uint32		maxitems;
+	long		itemlimit;
+
+	tuplesort_performsort(buildstate->sortstate);
+
+	itemlimit = (maintenance_work_mem * 1024L / 2) / sizeof(ItemPointerData);
+	itemlimit = Min(itemlimit, MaxAllocSize / sizeof(ItemPointerData));
+	itemlimit = Max(itemlimit, GinMaxLeafDataItems);
+
+	maxitems = GinMaxLeafDataItems;
+	items = (ItemPointerData *) palloc(sizeof(ItemPointerData) * maxitems);
+
+	for (;;)
+	{
+		ItemPointerData *chunk;
+		uint32		nchunk;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		itup = tuplesort_getindextuple(buildstate->sortstate, true,
+									   &should_free);
+
+		/* Insert the previous key if this tuple belongs to another */
+		if (curtup != NULL &&
+			(itup == NULL || ginCompareTupleKeys(ginstate, curtup, itup) != 0))
+		{
+			Datum		key;
+			GinNullCategory category;
+
+			key = gintuple_get_key(ginstate, curtup, &category);
+			ginEntryInsert(ginstate, gintuple_get_attrnum(ginstate, curtup),
+						   key, category, items, nitems,
+						   &buildstate->buildStats);
+			pfree(curtup);
+			curtup = NULL;
+			nitems = 0;
+		}
+
+		if (itup == NULL)
+			break;
+
+		if (curtup == NULL)
+			curtup = CopyIndexTuple(itup);
+
+		chunk = ginReadTuple(itup, &nchunk);
+
+		if (nitems + nchunk > maxitems)
+		{
+			if (nitems > 0 && nitems + nchunk > itemlimit)
+			{
+				/* out of room, so insert what we have so far */
+				Datum		key;
+				GinNullCategory category;
+
+				key = gintuple_get_key(ginstate, curtup, &category);
+				ginEntryInsert(ginstate,
+							   gintuple_get_attrnum(ginstate, curtup),
+							   key, category, items, nitems,
+							   &buildstate->buildStats);
+				nitems = 0;
+			}
+			while (nitems + nchunk > maxitems)
+				maxitems *= 2;
+			items = (ItemPointerData *)
+				repalloc(items, sizeof(ItemPointerData) * maxitems);
+		}
+
+		if (nitems > 0 && ginCompareItemPointers(&items[nitems - 1],
+												 &chunk[0]) >= 0)
+		{
+			/*
+			 * The runs overlap.  This can happen because a HOT chain is
+			 * indexed under the TID of its root tuple, which may come after
+			 * TIDs already collected from the same heap page in an earlier
+			 * run.  Merge them.
+			 */
+			ItemPointerData *merged;
+
+			merged = (ItemPointerData *)
+				palloc(sizeof(ItemPointerData) * maxitems);
+			nitems = ginMergeItemPointers(merged, items, nitems,
+										  chunk, nchunk);
+			pfree(items);
+			items = merged;
+		}
+		else
+		{
+			memcpy(items + nitems, chunk, sizeof(ItemPointerData) * nchunk);
+			nitems += nchunk;
+		}
+
+		pfree(chunk);
+		if (should_free)
+			pfree(itup);
+	}
+
+	pfree(items);
+	tuplesort_end(buildstate->sortstate);
+	buildstate->sortstate = NULL;
+}
+
 /*
  * Extract index entries for a single indexable item, and add them to the
  * BuildAccumulator's state.
@@ -351,24 +581,13 @@ ginBuildCallback(Relation index, HeapTuple htup, Datum *values,
 							   values[i], isnull[i],
 							   &htup->t_self);
 
-	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= maintenance_work_mem * 1024L)
+	/*
+	 * If we've maxed out our share of memory, move everything to the sort.
+	 * The other half of maintenance_work_mem belongs to the sort.
+	 */
+	if (buildstate->accum.allocatedMemory >= maintenance_work_mem * 1024L / 2)
 	{
-		ItemPointerData *list;
-		Datum		key;
-		GinNullCategory category;
-		uint32		nlist;
-		OffsetNumber attnum;
-
-		ginBeginBAScan(&buildstate->accum);
-		while ((list = ginGetBAEntry(&buildstate->accum,
-								  &attnum, &key, &category, &nlist)) != NULL)
-		{
-			/* there could be many entries, so be willing to abort here */
-			CHECK_FOR_INTERRUPTS();
-			ginEntryInsert(&buildstate->ginstate, attnum, key, category,
-						   list, nlist, &buildstate->buildStats);
-		}
+		ginBuildSpill(buildstate);
 
 		MemoryContextReset(buildstate->tmpCtx);
 		ginInitBA(&buildstate->accum);
@@ -462,6 +681,7 @@ ginbuild(PG_FUNCTION_ARGS)
 
 	buildstate.accum.ginstate = &buildstate.ginstate;
 	ginInitBA(&buildstate.accum);
+	buildstate.sortstate = NULL;
 
 	/*
 	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
@@ -470,16 +690,26 @@ ginbuild(PG_FUNCTION_ARGS)
 	reltuples = IndexBuildHeapScan(heap, index, indexInfo, false,
 								   ginBuildCallback, (void *) &buildstate);
 
-	/* dump remaining entries to the index */
 	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (buildstate.sortstate != NULL)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		/* add the remaining entries to the sort, then build from that */
+		ginBuildSpill(&buildstate);
+		MemoryContextReset(buildstate.tmpCtx);
+		ginBuildInsertSorted(&buildstate);
+	}
+	else
+	{
+		/* everything fit in memory, so dump the entries to the index */
+		ginBeginBAScan(&buildstate.accum);
+		while ((list = ginGetBAEntry(&buildstate.accum,
+									 &attnum, &key, &category, &nlist)) != NULL)
+		{
+			/* there could be many entries, so be willing to abort here */
+			CHECK_FOR_INTERRUPTS();
+			ginEntryInsert(&buildstate.ginstate, attnum, key, category,
+						   list, nlist, &buildstate.buildStats);
+		}
 	}
 	MemoryContextSwitchTo(oldCtx);
 
@@ -576,6 +806,7 @@ gininsert(PG_FUNCTION_ARGS)
 #ifdef NOT_USED
 	Relation	heapRel = (Relation) PG_GETARG_POINTER(4);
 	IndexUniqueCheck checkUnique = (IndexUniqueCheck) PG_GETARG_INT32(5);
+	bool		indexUnchanged = PG_GETARG_BOOL(6);
 #endif
 	GinState	ginstate;
 	MemoryContext oldCtx;
@@ -0,0 +1,222 @@
+/*-------------------------------------------------------------------------
+ *
+ * ginpostinglist.c
+ *	  routines for dealing with compressed posting lists.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *			src/backend/access/gin/ginpostinglist.c
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/gin_private.h"
+#include "access/htup.h"
+
+/*
+ * Posting lists stored in leaf entry tuples are compressed.  Each item
+ * pointer is converted to a 64-bit integer, with the block number in the
+ * high bits and the offset number in the low MaxHeapTuplesPerPageBits bits,
+ * so that the integers sort in the same order as the item pointers.  The
+ * differences between successive integers (the first one is taken relative
+ * to zero) are then stored using variable-byte encoding: 7 bits of payload
+ * per byte, least significant group first, with the high bit set on every
+ * byte but the last of each number.
+ *
+ * Heap TIDs for nearby rows differ mostly in the offset number, and the
+ * delta from one to the next typically fits in one or two bytes, against
+ * six bytes for an uncompressed ItemPointerData.
+ *
+ * A block number is 32 bits, so a delta never needs more than
+ * 32 + MaxHeapTuplesPerPageBits bits, or 7 bytes.
+ */
+#define MaxHeapTuplesPerPageBits		11
+
+static inline uint64
+itemptr_to_uint64(const ItemPointer iptr)
+{
+	uint64		val;
+
+	Assert(GinItemPointerGetOffsetNumber(iptr) < (1 << MaxHeapTuplesPerPageBits));
+
+	val = GinItemPointerGetBlockNumber(iptr);
+	val <<= MaxHeapTuplesPerPageBits;
+	val |= GinItemPointerGetOffsetNumber(iptr);
+
+	return val;
+}
+
+static inline void
+uint64_to_itemptr(uint64 val, ItemPointer iptr)
+{
+	ItemPointerSet(iptr,
+				   (BlockNumber) (val >> MaxHeapTuplesPerPageBits),
+				   (OffsetNumber) (val & ((1 << MaxHeapTuplesPerPageBits) - 1)));
+}
+
+/*
+ * Varbyte-encode 'val' into *ptr.  *ptr is incremented to next byte.
+ */
+static void
+encode_varbyte(uint64 val, unsigned char **ptr)
+{
+	unsigned char *p = *ptr;
+
+	while (val > 0x7F)
+	{
+		*(p++) = 0x80 | (val & 0x7F);
+		val >>= 7;
+	}
+	*(p++) = (unsigned char) val;
+
+	*ptr = p;
+}
+
+/*
+ * Decode varbyte-encoded integer at *ptr.  *ptr is incremented to next
+ * integer.
+ */
+static uint64
+decode_varbyte(unsigned char **ptr)
+{
+	uint64		val;
+	unsigned char *p = *ptr;
+	uint64		c;
+	int			shift;
+
+	/* the common one- and two-byte cases are handled without looping */
+	c = *(p++);
+	val = c & 0x7F;
+	if (c & 0x80)
+	{
+		c = *(p++);
+		val |= (c & 0x7F) << 7;
+		shift = 14;
+		while (c & 0x80)
+		{
+			c = *(p++);
+			val |= (c & 0x7F) << shift;
+			shift += 7;
+		}
+	}
+
+	*ptr = p;
+
+	return val;
+}
+
+/*
+ * Compute the number of bytes needed to store the given sorted,
+ * duplicate-free array of item pointers in compressed form.
+ */
+Size
+ginCompressedPostingListSize(ItemPointerData *ipd, uint32 nipd)
+{
+	uint64		prev = 0;
+	Size		size = 0;
+	uint32		i;
+
+	for (i = 0; i < nipd; i++)
+	{
+		uint64		val = itemptr_to_uint64(&ipd[i]);
+		uint64		delta = val - prev;
+
+		Assert(i == 0 || val > prev);
+
+		do
+		{
+			size++;
+			delta >>= 7;
+		} while (delta > 0);
+
+		prev = val;
+	}
+
+	return size;
+}
+
+/*
+ * Compress the given sorted, duplicate-free array of item pointers into
+ * dst, which must have room for ginCompressedPostingListSize() bytes.
+ * Returns the number of bytes written.
+ */
+Size
+ginCompressPostingList(ItemPointerData *ipd, uint32 nipd, char *dst)
+{
+	unsigned char *ptr = (unsigned char *) dst;
+	uint64		prev = 0;
+	uint32		i;
+
+	for (i = 0; i < nipd; i++)
+	{
+		uint64		val = itemptr_to_uint64(&ipd[i]);
+
+		Assert(i == 0 || val > prev);
+		encode_varbyte(val - prev, &ptr);
+		prev = val;
+	}
+
+	return (char *) ptr - dst;
+}
+
+/*
+ * Decode nipd compressed item pointers from src into the array dst.
+ */
+void
+ginDecompressPostingList(char *src, uint32 nipd, ItemPointerData *dst)
+{
+	unsigned char *ptr = (unsigned char *) src;
+	uint64		val = 0;
+	uint32		i;
+
+	for (i = 0; i < nipd; i++)
+	{
+		val += decode_varbyte(&ptr);
+		uint64_to_itemptr(val, &dst[i]);
+	}
+}
+
+/*
+ * Return a palloc'd array of the item pointers in the posting list of
+ * a leaf entry tuple, and the number of items in *nitems.  Tuples written
+ * before posting lists were compressed store a plain ItemPointerData
+ * array, and are handled here too.
+ */
+ItemPointerData *
+ginReadTuple(IndexTuple itup, uint32 *nitems)
+{
+	uint32		nipd = GinGetNPosting(itup);
+	ItemPointerData *ipd;
+
+	Assert(!GinIsPostingTree(itup));
+
+	ipd = (ItemPointerData *) palloc(sizeof(ItemPointerData) * Max(nipd, 1));
+
+	if (GinItupIsCompressed(itup))
+		ginDecompressPostingList(GinGetPosting(itup), nipd, ipd);
+	else
+		memcpy(ipd, GinGetPosting(itup), sizeof(ItemPointerData) * nipd);
+
+	*nitems = nipd;
+	return ipd;
+}
+
+/*
+ * Fetch just the first item pointer of a leaf entry tuple's posting list,
+ * which must not be empty.
+ */
+void
+ginReadTupleFirstItem(IndexTuple itup, ItemPointer first)
+{
+	Assert(!GinIsPostingTree(itup));
+	Assert(GinGetNPosting(itup) > 0);
+
+	if (GinItupIsCompressed(itup))
+		ginDecompressPostingList(GinGetPosting(itup), 1, first);
+	else
+		memcpy(first, GinGetPosting(itup), sizeof(ItemPointerData));
+}
@@ -150,6 +150,7 @@ ginFillScanKey(GinScanOpaque so, OffsetNumber attnum,
 
 	key->scanEntry = (GinScanEntry *) palloc(sizeof(GinScanEntry) * nQueryValues);
 	key->entryRes = (bool *) palloc0(sizeof(bool) * nQueryValues);
+	key->entryRequired = (bool *) palloc0(sizeof(bool) * nQueryValues);
 
 	key->query = query;
 	key->queryValues = queryValues;
@@ -235,6 +236,7 @@ freeScanKeys(GinScanOpaque so)
 
 		pfree(key->scanEntry);
 		pfree(key->entryRes);
+		pfree(key->entryRequired);
 	}
 
 	pfree(so->keys);
@@ -520,41 +520,32 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 		}
 		else if (GinGetNPosting(itup) > 0)
 		{
+			ItemPointerData *items;
+			uint32		nitems;
+			ItemPointerData *cleaned = NULL;
+			uint32		newN;
+
 			/*
-			 * if we already create temporary page, we will make changes in
-			 * place
+			 * The posting list is compressed, so we work on a decoded copy
+			 * of it, and rebuild the tuple if any items were removed.
 			 */
-			ItemPointerData *cleaned = (tmppage == origpage) ? NULL : GinGetPosting(itup);
-			uint32		newN = ginVacuumPostingList(gvs, GinGetPosting(itup), GinGetNPosting(itup), &cleaned);
+			items = ginReadTuple(itup, &nitems);
+			newN = ginVacuumPostingList(gvs, items, nitems, &cleaned);
 
-			if (GinGetNPosting(itup) != newN)
+			if (nitems != newN)
 			{
 				OffsetNumber attnum;
 				Datum		key;
 				GinNullCategory category;
 
 				/*
-				 * Some ItemPointers was deleted, so we should remake our
-				 * tuple
+				 * On first difference we create temporary page in memory and
+				 * copies content in to it.
 				 */
-
 				if (tmppage == origpage)
 				{
-					/*
-					 * On first difference we create temporary page in memory
-					 * and copies content in to it.
-					 */
 					tmppage = PageGetTempPageCopy(origpage);
 
-					if (newN > 0)
-					{
-						Size		pos = ((char *) GinGetPosting(itup)) - ((char *) origpage);
-
-						memcpy(tmppage + pos, cleaned, sizeof(ItemPointerData) * newN);
-					}
-
-					pfree(cleaned);
-
 					/* set itup pointer to new page */
 					itup = (IndexTuple) PageGetItem(tmppage, PageGetItemId(tmppage, i));
 				}
@@ -562,7 +553,7 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 				attnum = gintuple_get_attrnum(&gvs->ginstate, itup);
 				key = gintuple_get_key(&gvs->ginstate, itup, &category);
 				itup = GinFormTuple(&gvs->ginstate, attnum, key, category,
-									GinGetPosting(itup), newN, true);
+									cleaned, newN, true);
 				PageIndexTupleDelete(tmppage, i);
 
 				if (PageAddItem(tmppage, (Item) itup, IndexTupleSize(itup), i, false, false) != i)
@@ -571,6 +562,10 @@ ginVacuumEntryPage(GinVacuumState *gvs, Buffer buffer, BlockNumber *roots, uint3
 
 				pfree(itup);
 			}
+
+			if (cleaned)
+				pfree(cleaned);
+			pfree(items);
 		}
 	}
 
@@ -603,7 +598,7 @@ ginbulkdelete(PG_FUNCTION_ARGS)
 		/* Yes, so initialize stats to zeroes */
 		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
 		/* and cleanup any pending inserts */
-		ginInsertCleanup(&gvs.ginstate, true, stats);
+		ginInsertCleanup(&gvs.ginstate, true, true, stats);
 	}
 
 	/* we'll re-count the tuples each time */
@@ -716,7 +711,7 @@ ginvacuumcleanup(PG_FUNCTION_ARGS)
 		if (IsAutoVacuumWorkerProcess())
 		{
 			initGinState(&ginstate, index);
-			ginInsertCleanup(&ginstate, true, stats);
+			ginInsertCleanup(&ginstate, true, true, stats);
 		}
 		PG_RETURN_POINTER(stats);
 	}
@@ -729,7 +724,7 @@ ginvacuumcleanup(PG_FUNCTION_ARGS)
 	{
 		stats = (IndexBulkDeleteResult *) palloc0(sizeof(IndexBulkDeleteResult));
 		initGinState(&ginstate, index);
-		ginInsertCleanup(&ginstate, true, stats);
+		ginInsertCleanup(&ginstate, true, true, stats);
 	}
 
 	memset(&idxStat, 0, sizeof(idxStat));
@@ -713,6 +713,28 @@ gin_redo(XLogRecPtr lsn, XLogRecord *record)
 	MemoryContextReset(opCtx);
 }
 
+/*
+ * Prefetch the index page that replay of a GIN record will read
+ */
+void
+gin_prefetch(XLogRecord *record, char *data, uint32 len)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	RelFileNode node;
+	BlockNumber blkno;
+
+	if (info != XLOG_GIN_INSERT && info != XLOG_GIN_VACUUM_PAGE)
+		return;
+
+	/* both start with the RelFileNode and block number */
+	if ((record->xl_info & XLR_BKP_BLOCK_1) ||
+		len < sizeof(RelFileNode) + sizeof(BlockNumber))
+		return;
+	memcpy(&node, data, sizeof(RelFileNode));
+	memcpy(&blkno, data + sizeof(RelFileNode), sizeof(BlockNumber));
+	XLogPrefetchBlock(node, MAIN_FORKNUM, blkno);
+}
+
 static void
 desc_node(StringInfo buf, RelFileNode node, BlockNumber blkno)
 {
@@ -92,6 +92,7 @@ gistinsert(PG_FUNCTION_ARGS)
 #ifdef NOT_USED
 	Relation	heapRel = (Relation) PG_GETARG_POINTER(4);
 	IndexUniqueCheck checkUnique = (IndexUniqueCheck) PG_GETARG_INT32(5);
+	bool		indexUnchanged = PG_GETARG_BOOL(6);
 #endif
 	IndexTuple	itup;
 	GISTSTATE  *giststate;
@@ -1246,6 +1247,7 @@ initGISTstate(Relation index)
 	giststate->scanCxt = scanCxt;
 	giststate->tempCxt = scanCxt;	/* caller must change this if needed */
 	giststate->tupdesc = index->rd_att;
+	giststate->fetchTupdesc = NULL;	/* set up by gistrescan if needed */
 
 	for (i = 0; i < index->rd_att->natts; i++)
 	{
@@ -1277,6 +1279,13 @@ initGISTstate(Relation index)
 						   scanCxt);
 		else
 			giststate->distanceFn[i].fn_oid = InvalidOid;
+		/* opclasses are not required to provide a Fetch method */
+		if (OidIsValid(index_getprocid(index, i + 1, GIST_FETCH_PROC)))
+			fmgr_info_copy(&(giststate->fetchFn[i]),
+						   index_getprocinfo(index, i + 1, GIST_FETCH_PROC),
+						   scanCxt);
+		else
+			giststate->fetchFn[i].fn_oid = InvalidOid;
 
 		/*
 		 * If the index column has a specified collation, we should honor that
@@ -18,6 +18,7 @@
 
 #include "access/genam.h"
 #include "access/gist_private.h"
+#include "access/heapam.h"
 #include "catalog/index.h"
 #include "miscadmin.h"
 #include "optimizer/cost.h"
@@ -25,6 +26,7 @@
 #include "storage/smgr.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/tuplesort.h"
 
 /* Step of index tuples for check whether to switch to buffering build mode */
 #define BUFFERING_MODE_SWITCH_CHECK_STEP 256
@@ -63,8 +65,24 @@ typedef struct
 	Size		freespace;		/* amount of free space to leave on pages */
 
 	GistBufferingMode bufferingMode;
+
+	/*
+	 * In a sorted build, the index tuples are collected here, and then loaded
+	 * into the index bottom-up; NULL in a regular or buffering build.
+	 */
+	Tuplesortstate *sortstate;
 } GISTBuildState;
 
+/*
+ * State of one level of the tree in a sorted build: the page being filled,
+ * which hasn't been written out yet.
+ */
+typedef struct GistSortedBuildLevelState
+{
+	Page		page;
+	struct GistSortedBuildLevelState *parent;	/* next level up, or NULL */
+} GistSortedBuildLevelState;
+
 static void gistInitBuffering(GISTBuildState *buildstate);
 static int	calculatePagesPerBuffer(GISTBuildState *buildstate, int levelStep);
 static void gistBuildCallback(Relation index,
@@ -87,12 +105,28 @@ static void gistProcessEmptyingQueue(GISTBuildState *buildstate);
 static void gistEmptyAllBuffers(GISTBuildState *buildstate);
 static void gistFreeUnreferencedPath(GISTBufferingInsertStack *path);
 static int	gistGetMaxLevel(Relation index);
+static bool gistCanSortedBuild(Relation index);
+static void gistSortedBuild(GISTBuildState *buildstate);
+static GistSortedBuildLevelState *gistSortedBuildNewLevel(GISTBuildState *buildstate,
+						uint32 flags);
+static void gistSortedBuildAdd(GISTBuildState *buildstate,
+				   GistSortedBuildLevelState *levelstate,
+				   IndexTuple itup);
+static void gistSortedBuildFlushPage(GISTBuildState *buildstate,
+						 GistSortedBuildLevelState *levelstate);
+static BlockNumber gistSortedBuildWritePage(GISTBuildState *buildstate,
+						 Page page, BlockNumber blkno);
 
 
 /*
  * Main entry point to GiST index build. Initially calls insert over and over,
  * but switches to more efficient buffering build algorithm after a certain
  * number of tuples (unless buffering mode is disabled).
+ *
+ * If the opclasses of all the index columns can sort their keys, and the
+ * buffering option was left at "auto", we instead sort all the index tuples
+ * and pack them into pages bottom-up, which is much faster still and makes
+ * better-clustered pages.
  */
 Datum
 gistbuild(PG_FUNCTION_ARGS)
@@ -147,6 +181,18 @@ gistbuild(PG_FUNCTION_ARGS)
 	/* no locking is needed */
 	buildstate.giststate = initGISTstate(index);
 
+	/*
+	 * Use a sorted build if we can, unless buffering was explicitly asked
+	 * for or against.
+	 */
+	if (buildstate.bufferingMode == GIST_BUFFERING_AUTO &&
+		gistCanSortedBuild(index))
+		buildstate.sortstate = tuplesort_begin_index_gist(index,
+													  maintenance_work_mem,
+														  false);
+	else
+		buildstate.sortstate = NULL;
+
 	/*
 	 * Create a temporary memory context that is reset once for each tuple
 	 * processed.  (Note: we don't bother to make this a child of the
@@ -197,10 +243,15 @@ gistbuild(PG_FUNCTION_ARGS)
 								   gistBuildCallback, (void *) &buildstate);
 
 	/*
-	 * If buffering was used, flush out all the tuples that are still in the
-	 * buffers.
+	 * In a sorted build, now load the sorted tuples.  If buffering was used,
+	 * flush out all the tuples that are still in the buffers.
 	 */
-	if (buildstate.bufferingMode == GIST_BUFFERING_ACTIVE)
+	if (buildstate.sortstate)
+	{
+		gistSortedBuild(&buildstate);
+		tuplesort_end(buildstate.sortstate);
+	}
+	else if (buildstate.bufferingMode == GIST_BUFFERING_ACTIVE)
 	{
 		elog(DEBUG1, "all tuples processed, emptying buffers");
 		gistEmptyAllBuffers(&buildstate);
@@ -446,6 +497,19 @@ gistBuildCallback(Relation index,
 	itup = gistFormTuple(buildstate->giststate, index, values, isnull, true);
 	itup->t_tid = htup->t_self;
 
+	if (buildstate->sortstate)
+	{
+		/* Just collect the tuple; they're all loaded after sorting */
+		tuplesort_putindextuple(buildstate->sortstate, itup);
+
+		buildstate->indtuples += 1;
+		buildstate->indtuplesSize += IndexTupleSize(itup);
+
+		MemoryContextSwitchTo(oldCtx);
+		MemoryContextReset(buildstate->giststate->tempCxt);
+		return;
+	}
+
 	if (buildstate->bufferingMode == GIST_BUFFERING_ACTIVE)
 	{
 		/* We have buffers, so use them. */
@@ -1072,3 +1136,197 @@ gistGetMaxLevel(Relation index)
 	}
 	return maxLevel;
 }
+
+
+/*
+ * Sorted build support functions.
+ *
+ * The index tuples are sorted by the opclasses' sort support functions, which
+ * order them so that nearby keys end up nearby in the sort (for example, by
+ * the Z-order of points).  The sorted tuples are then packed into leaf pages
+ * in order, each page being filled up to the fillfactor.  When a page is
+ * full, it is written out, and a downlink to it, carrying the union of its
+ * keys, is added to the page being filled on the next level up, in the same
+ * way.  No penalty or picksplit calls are needed at all.
+ *
+ * Pages are written out as they fill up, each in a new block, except that the
+ * root has to be in block 0, which was initialized as an empty leaf page
+ * before the heap scan.  So the single page left on the topmost level at the
+ * end is written over that.
+ */
+
+/*
+ * Can we do a sorted build?  Only if the opclasses of all the index columns
+ * provide a sort support function.
+ */
+static bool
+gistCanSortedBuild(Relation index)
+{
+	int			i;
+
+	for (i = 0; i < index->rd_att->natts; i++)
+	{
+		if (!OidIsValid(index_getprocid(index, i + 1, GIST_SORTSUPPORT_PROC)))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Load the sorted index tuples into the index.
+ */
+static void
+gistSortedBuild(GISTBuildState *buildstate)
+{
+	GistSortedBuildLevelState *leafstate,
+			   *levelstate;
+	IndexTuple	itup;
+	bool		should_free;
+	MemoryContext oldCtx;
+
+	tuplesort_performsort(buildstate->sortstate);
+
+	leafstate = gistSortedBuildNewLevel(buildstate, F_LEAF);
+
+	oldCtx = MemoryContextSwitchTo(buildstate->giststate->tempCxt);
+
+	while ((itup = tuplesort_getindextuple(buildstate->sortstate,
+										   true, &should_free)) != NULL)
+	{
+		gistSortedBuildAdd(buildstate, leafstate, itup);
+		if (should_free)
+			pfree(itup);
+
+		MemoryContextReset(buildstate->giststate->tempCxt);
+	}
+
+	/*
+	 * Write out the partially filled pages, linking each into the level
+	 * above, until we're left with the single page of the topmost level.
+	 * That's the root.
+	 */
+	for (levelstate = leafstate;
+		 levelstate->parent != NULL;
+		 levelstate = levelstate->parent)
+	{
+		gistSortedBuildFlushPage(buildstate, levelstate);
+		MemoryContextReset(buildstate->giststate->tempCxt);
+	}
+
+	gistSortedBuildWritePage(buildstate, levelstate->page, GIST_ROOT_BLKNO);
+
+	MemoryContextSwitchTo(oldCtx);
+}
+
+/*
+ * Set up the state for a new level of the tree, with an empty page having
+ * the given flags.
+ */
+static GistSortedBuildLevelState *
+gistSortedBuildNewLevel(GISTBuildState *buildstate, uint32 flags)
+{
+	GistSortedBuildLevelState *levelstate;
+	GISTPageOpaque opaque;
+
+	levelstate = (GistSortedBuildLevelState *)
+		MemoryContextAlloc(buildstate->giststate->scanCxt,
+						   sizeof(GistSortedBuildLevelState));
+	levelstate->page = (Page) MemoryContextAlloc(buildstate->giststate->scanCxt,
+												 BLCKSZ);
+	levelstate->parent = NULL;
+
+	PageInit(levelstate->page, BLCKSZ, sizeof(GISTPageOpaqueData));
+	opaque = GistPageGetOpaque(levelstate->page);
+	opaque->rightlink = InvalidBlockNumber;
+	opaque->flags = flags;
+	opaque->gist_page_id = GIST_PAGE_ID;
+
+	return levelstate;
+}
+
+/*
+ * Add an index tuple to the page being filled at the given level, first
+ * writing the page out if the tuple won't fit on it.
+ */
+static void
+gistSortedBuildAdd(GISTBuildState *buildstate,
+				   GistSortedBuildLevelState *levelstate,
+				   IndexTuple itup)
+{
+	if (!PageIsEmpty(levelstate->page) &&
+		gistnospace(levelstate->page, &itup, 1, InvalidOffsetNumber,
+					buildstate->freespace))
+		gistSortedBuildFlushPage(buildstate, levelstate);
+
+	gistfillbuffer(levelstate->page, &itup, 1, InvalidOffsetNumber);
+}
+
+/*
+ * Write out the page being filled at the given level, add a downlink to it
+ * to the level above, and start over with an empty page.
+ */
+static void
+gistSortedBuildFlushPage(GISTBuildState *buildstate,
+						 GistSortedBuildLevelState *levelstate)
+{
+	Page		page = levelstate->page;
+	uint16		flags = GistPageGetOpaque(page)->flags;
+	GISTPageOpaque opaque;
+	IndexTuple *itvec;
+	IndexTuple	downlink;
+	int			len;
+	BlockNumber blkno;
+
+	blkno = gistSortedBuildWritePage(buildstate, page, InvalidBlockNumber);
+
+	itvec = gistextractpage(page, &len);
+	downlink = gistunion(buildstate->indexrel, itvec, len,
+						 buildstate->giststate);
+	ItemPointerSetBlockNumber(&(downlink->t_tid), blkno);
+
+	PageInit(page, BLCKSZ, sizeof(GISTPageOpaqueData));
+	opaque = GistPageGetOpaque(page);
+	opaque->rightlink = InvalidBlockNumber;
+	opaque->flags = flags;
+	opaque->gist_page_id = GIST_PAGE_ID;
+
+	if (levelstate->parent == NULL)
+		levelstate->parent = gistSortedBuildNewLevel(buildstate, 0);
+
+	gistSortedBuildAdd(buildstate, levelstate->parent, downlink);
+}
+
+/*
+ * Write a finished page to block blkno of the index, or to a new block if
+ * blkno is InvalidBlockNumber.  Returns the block number written.
+ */
+static BlockNumber
+gistSortedBuildWritePage(GISTBuildState *buildstate, Page page,
+						 BlockNumber blkno)
+{
+	Relation	index = buildstate->indexrel;
+	Buffer		buffer;
+	Page		bufpage;
+
+	/* There's no concurrent access during index build */
+	buffer = ReadBuffer(index, (blkno == InvalidBlockNumber) ? P_NEW : blkno);
+	LockBuffer(buffer, GIST_EXCLUSIVE);
+	bufpage = BufferGetPage(buffer);
+	blkno = BufferGetBlockNumber(buffer);
+
+	START_CRIT_SECTION();
+
+	memcpy(bufpage, page, BLCKSZ);
+	MarkBufferDirty(buffer);
+
+	if (RelationNeedsWAL(index))
+		log_newpage(&index->rd_node, MAIN_FORKNUM, blkno, bufpage);
+	else
+		PageSetLSN(bufpage, GetXLogRecPtrForTemp());
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(buffer);
+
+	return blkno;
+}
@@ -16,9 +16,12 @@
  */
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/gist.h"
 #include "access/skey.h"
 #include "utils/geo_decls.h"
+#include "utils/sortsupport.h"
 
 
 static bool gist_box_leaf_consistent(BOX *key, BOX *query,
@@ -142,7 +145,8 @@ gist_box_compress(PG_FUNCTION_ARGS)
  * GiST DeCompress method for boxes (also used for points, polygons
  * and circles)
  *
- * do not do anything --- we just use the stored box as is.
+ * do not do anything --- we just use the stored box as is.  Since boxes
+ * are stored losslessly, this also serves as the Fetch method for boxes.
  */
 Datum
 gist_box_decompress(PG_FUNCTION_ARGS)
@@ -1202,6 +1206,130 @@ gist_point_compress(PG_FUNCTION_ARGS)
 	PG_RETURN_POINTER(entry);
 }
 
+/*
+ * GiST Fetch method for point
+ *
+ * Get point coordinates from its bounding box coordinates and form new
+ * gistentry.
+ */
+Datum
+gist_point_fetch(PG_FUNCTION_ARGS)
+{
+	GISTENTRY  *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+	BOX		   *in = DatumGetBoxP(entry->key);
+	Point	   *r;
+	GISTENTRY  *retval;
+
+	retval = palloc(sizeof(GISTENTRY));
+
+	r = (Point *) palloc(sizeof(Point));
+	r->x = in->high.x;
+	r->y = in->high.y;
+	gistentryinit(*retval, PointerGetDatum(r),
+				  entry->rel, entry->page,
+				  entry->offset, FALSE);
+
+	PG_RETURN_POINTER(retval);
+}
+
+/*
+ * Map a float4 to a uint32 that sorts the same way, for Z-order
+ * computation.  NaNs sort after everything else.
+ */
+static uint32
+ieee_float32_to_uint32(float4 f)
+{
+	union
+	{
+		float4		f;
+		uint32		i;
+	}			u;
+
+	if (isnan(f))
+		return 0xFFFFFFFF;
+
+	u.f = f;
+
+	/*
+	 * Negative values have the sign bit set and grow more negative as the
+	 * remaining bits grow, so flip all of their bits; for positive values,
+	 * just set the sign bit so that they sort above the negative ones.
+	 */
+	if (u.i & 0x80000000)
+		u.i ^= 0xFFFFFFFF;
+	else
+		u.i |= 0x80000000;
+
+	return u.i;
+}
+
+/*
+ * Spread the 32 bits of x out over the even-numbered bits of the result.
+ */
+static uint64
+part_bits32_by2(uint32 x)
+{
+	uint64		n = x;
+
+	n = (n | (n << 16)) & UINT64CONST(0x0000FFFF0000FFFF);
+	n = (n | (n << 8)) & UINT64CONST(0x00FF00FF00FF00FF);
+	n = (n | (n << 4)) & UINT64CONST(0x0F0F0F0F0F0F0F0F);
+	n = (n | (n << 2)) & UINT64CONST(0x3333333333333333);
+	n = (n | (n << 1)) & UINT64CONST(0x5555555555555555);
+
+	return n;
+}
+
+/*
+ * Compute the Z-order (Morton code) of a point: the bits of the x and y
+ * coordinates, interleaved.  Points close together in space mostly get
+ * close Z-order values.  The coordinates are reduced to float4 precision,
+ * which is plenty for ordering purposes.
+ */
+static uint64
+point_zorder_internal(float4 x, float4 y)
+{
+	return part_bits32_by2(ieee_float32_to_uint32(x)) |
+		(part_bits32_by2(ieee_float32_to_uint32(y)) << 1);
+}
+
+/*
+ * Sort support comparator for point_ops leaf keys, which are boxes with
+ * both corners at the point.  Orders them by Z-order.
+ */
+static int
+gist_bbox_zorder_cmp(Datum a, Datum b, SortSupport ssup)
+{
+	Point	   *p1 = &(DatumGetBoxP(a)->low);
+	Point	   *p2 = &(DatumGetBoxP(b)->low);
+	uint64		z1;
+	uint64		z2;
+
+	/* Exactly equal points are common enough to check for up front */
+	if (p1->x == p2->x && p1->y == p2->y)
+		return 0;
+
+	z1 = point_zorder_internal(p1->x, p1->y);
+	z2 = point_zorder_internal(p2->x, p2->y);
+	if (z1 > z2)
+		return 1;
+	else if (z1 < z2)
+		return -1;
+	return 0;
+}
+
+/*
+ * Sort support routine for sorted GiST index builds on points.
+ */
+Datum
+gist_point_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = gist_bbox_zorder_cmp;
+	PG_RETURN_VOID();
+}
+
 #define point_point_distance(p1,p2) \
 	DatumGetFloat8(DirectFunctionCall2(point_distance, \
 									   PointPGetDatum(p1), PointPGetDatum(p2)))
@@ -199,6 +199,41 @@ gistrescan(PG_FUNCTION_ARGS)
 	so->curTreeItem = NULL;
 	so->firstCall = true;
 
+	/*
+	 * If we're doing an index-only scan, on the first call, also set up a
+	 * tuple descriptor for the returned tuples and a memory context to hold
+	 * them.  The index's own descriptor won't do, since the storage type of
+	 * a column can differ from the indexed datatype (point_ops stores boxes,
+	 * for example), so build one with the opclass input types instead.
+	 */
+	if (scan->xs_want_itup && so->giststate->fetchTupdesc == NULL)
+	{
+		int			natts = RelationGetNumberOfAttributes(scan->indexRelation);
+		int			attno;
+
+		oldCxt = MemoryContextSwitchTo(so->giststate->scanCxt);
+
+		so->giststate->fetchTupdesc = CreateTemplateTupleDesc(natts, false);
+		for (attno = 1; attno <= natts; attno++)
+		{
+			TupleDescInitEntry(so->giststate->fetchTupdesc, attno, NULL,
+							   scan->indexRelation->rd_opcintype[attno - 1],
+							   -1, 0);
+		}
+		scan->xs_itupdesc = so->giststate->fetchTupdesc;
+
+		so->pageDataCxt = AllocSetContextCreate(so->giststate->scanCxt,
+												"GiST page data context",
+												ALLOCSET_DEFAULT_MINSIZE,
+												ALLOCSET_DEFAULT_INITSIZE,
+												ALLOCSET_DEFAULT_MAXSIZE);
+
+		MemoryContextSwitchTo(oldCxt);
+	}
+
+	/* Any previously returned tuple may be gone with the old queue */
+	scan->xs_itup = NULL;
+
 	/* Update scan key, if a new one is given */
 	if (key && scan->numberOfKeys > 0)
 	{
@@ -15,6 +15,7 @@
 
 #include <math.h>
 
+#include "access/genam.h"
 #include "access/gist_private.h"
 #include "access/reloptions.h"
 #include "storage/indexfsm.h"
@@ -517,6 +518,49 @@ gistFormTuple(GISTSTATE *giststate, Relation r,
 	return res;
 }
 
+/*
+ * Fetch the original values of a leaf index tuple's keys, for an index-only
+ * scan, and return them as an index tuple laid out per giststate->fetchTupdesc.
+ *
+ * The opclass Fetch methods are called in tempCxt; the result is allocated
+ * in the caller's memory context.
+ */
+IndexTuple
+gistFetchTuple(GISTSTATE *giststate, Relation r, IndexTuple tuple)
+{
+	MemoryContext oldcxt = MemoryContextSwitchTo(giststate->tempCxt);
+	Datum		fetchatt[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	int			i;
+
+	for (i = 0; i < r->rd_att->natts; i++)
+	{
+		Datum		datum;
+
+		datum = index_getattr(tuple, i + 1, giststate->tupdesc, &isnull[i]);
+
+		if (isnull[i])
+			fetchatt[i] = (Datum) 0;
+		else
+		{
+			GISTENTRY	fentry;
+			GISTENTRY  *fep;
+
+			gistentryinit(fentry, datum, r, NULL, (OffsetNumber) 0, FALSE);
+
+			fep = (GISTENTRY *)
+				DatumGetPointer(FunctionCall1Coll(&giststate->fetchFn[i],
+											  giststate->supportCollation[i],
+												  PointerGetDatum(&fentry)));
+			fetchatt[i] = fep->key;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return index_form_tuple(giststate->fetchTupdesc, fetchatt, isnull);
+}
+
 float
 gistpenalty(GISTSTATE *giststate, int attno,
 			GISTENTRY *orig, bool isNullOrig,
@@ -696,6 +740,27 @@ gistoptions(PG_FUNCTION_ARGS)
 
 }
 
+/*
+ *	gistcanreturn() -- Check whether a GiST index supports index-only scans.
+ *
+ * We can do it if the opclass of every column provides a Fetch method to
+ * reconstruct the original value from the stored key.
+ */
+Datum
+gistcanreturn(PG_FUNCTION_ARGS)
+{
+	Relation	index = (Relation) PG_GETARG_POINTER(0);
+	int			i;
+
+	for (i = 0; i < RelationGetNumberOfAttributes(index); i++)
+	{
+		if (!OidIsValid(index_getprocid(index, i + 1, GIST_FETCH_PROC)))
+			PG_RETURN_BOOL(false);
+	}
+
+	PG_RETURN_BOOL(true);
+}
+
 /*
  * Temporary GiST indexes are not WAL-logged, but we need LSNs to detect
  * concurrent page splits anyway. GetXLogRecPtrForTemp() provides a fake
@@ -355,6 +355,28 @@ out_gistxlogPageDelete(StringInfo buf, gistxlogPageDelete *xlrec)
 					 xlrec->blkno);
 }
 
+/*
+ * Prefetch the index page that replay of a GiST record will read
+ */
+void
+gist_prefetch(XLogRecord *record, char *data, uint32 len)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	RelFileNode node;
+	BlockNumber blkno;
+
+	if (info != XLOG_GIST_PAGE_UPDATE && info != XLOG_GIST_PAGE_DELETE)
+		return;
+
+	/* both start with the RelFileNode and block number */
+	if ((record->xl_info & XLR_BKP_BLOCK_1) ||
+		len < sizeof(RelFileNode) + sizeof(BlockNumber))
+		return;
+	memcpy(&node, data, sizeof(RelFileNode));
+	memcpy(&blkno, data + sizeof(RelFileNode), sizeof(BlockNumber));
+	XLogPrefetchBlock(node, MAIN_FORKNUM, blkno);
+}
+
 static void
 out_gistxlogPageSplit(StringInfo buf, gistxlogPageSplit *xlrec)
 {
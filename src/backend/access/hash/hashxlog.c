@@ -0,0 +1,739 @@
+/*-------------------------------------------------------------------------
+ *
+ * hashxlog.c
+ *	  WAL replay logic for hash index.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/hash/hashxlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/xlogutils.h"
+#include "storage/bufmgr.h"
+
+
+/*
+ * Fetch and lock one of the pages a hash WAL record was registered with.
+ *
+ * block_index is the page's position among the record's registered buffers.
+ * If the record carries a full-page image of it, the image is restored and
+ * *apply is set to false.  Otherwise *apply tells whether the record's
+ * changes still have to be applied to the page.  The page is returned
+ * exclusive-locked, or cleanup-locked if cleanup is true, so that the caller
+ * can keep it locked until it has replayed the whole record.  InvalidBuffer
+ * is returned if the page no longer exists.
+ */
+static Buffer
+hash_xlog_readbuf(XLogRecPtr lsn, XLogRecord *record, int block_index,
+				  RelFileNode node, BlockNumber blkno, bool cleanup,
+				  bool *apply)
+{
+	Buffer		buffer;
+
+	*apply = false;
+
+	if (record->xl_info & XLR_SET_BKP_BLOCK(block_index))
+		return RestoreBackupBlock(lsn, record, block_index, cleanup, true);
+
+	buffer = XLogReadBufferExtended(node, MAIN_FORKNUM, blkno, RBM_NORMAL);
+	if (!BufferIsValid(buffer))
+		return InvalidBuffer;
+
+	if (cleanup)
+		LockBufferForCleanup(buffer);
+	else
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	*apply = XLByteLT(PageGetLSN(BufferGetPage(buffer)), lsn);
+
+	return buffer;
+}
+
+/*
+ * Fetch and lock a page that the record initializes from scratch.  Such
+ * pages are never registered with the record, so there is neither a
+ * full-page image nor an LSN interlock to consider: the caller simply
+ * rebuilds the page.
+ */
+static Buffer
+hash_xlog_initbuf(RelFileNode node, BlockNumber blkno)
+{
+	Buffer		buffer;
+
+	buffer = XLogReadBufferExtended(node, MAIN_FORKNUM, blkno, RBM_ZERO);
+	Assert(BufferIsValid(buffer));
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	return buffer;
+}
+
+/*
+ * Cleanup-lock a bucket's primary page, to out-wait any hot standby scan of
+ * the bucket just as the operation being replayed did on the primary.
+ */
+static Buffer
+hash_xlog_lockbucket(RelFileNode node, BlockNumber bucketblkno)
+{
+	Buffer		buffer;
+
+	buffer = XLogReadBufferExtended(node, MAIN_FORKNUM, bucketblkno,
+									RBM_NORMAL);
+	if (BufferIsValid(buffer))
+		LockBufferForCleanup(buffer);
+
+	return buffer;
+}
+
+/* Stamp a replayed page with the record's LSN and mark it dirty */
+static void
+hash_xlog_setlsn(Buffer buffer, XLogRecPtr lsn)
+{
+	Page		page = BufferGetPage(buffer);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+}
+
+static void
+hash_xlog_release(Buffer buffer)
+{
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+}
+
+/*
+ * replay a simple insert
+ */
+static void
+hash_xlog_insert(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_insert *xlrec = (xl_hash_insert *) XLogRecGetData(record);
+	Buffer		buffer;
+	Buffer		metabuf;
+	bool		apply;
+
+	buffer = hash_xlog_readbuf(lsn, record, 0, xlrec->node, xlrec->blkno,
+							   false, &apply);
+	if (apply)
+	{
+		char	   *datapos = (char *) xlrec + SizeOfHashInsert;
+		Size		datalen = record->xl_len - SizeOfHashInsert;
+
+		if (PageAddItem(BufferGetPage(buffer), (Item) datapos, datalen,
+						xlrec->offnum, false, false) == InvalidOffsetNumber)
+			elog(PANIC, "hash_xlog_insert: failed to add item");
+
+		hash_xlog_setlsn(buffer, lsn);
+	}
+
+	metabuf = hash_xlog_readbuf(lsn, record, 1, xlrec->node, HASH_METAPAGE,
+								false, &apply);
+	if (apply)
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(metabuf));
+
+		metap->hashm_ntuples += 1;
+
+		hash_xlog_setlsn(metabuf, lsn);
+	}
+
+	hash_xlog_release(buffer);
+	hash_xlog_release(metabuf);
+}
+
+/*
+ * replay addition of overflow page for hash index
+ */
+static void
+hash_xlog_add_ovfl_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_add_ovfl_page *xlrec = (xl_hash_add_ovfl_page *) XLogRecGetData(record);
+	int			block_index = 0;
+	Buffer		prevbuf;
+	Buffer		ovflbuf;
+	Buffer		mapbuf = InvalidBuffer;
+	Buffer		newmapbuf = InvalidBuffer;
+	Buffer		metabuf;
+	Page		ovflpage;
+	HashPageOpaque ovflopaque;
+	bool		apply;
+
+	/* link the new page to the end of the bucket chain */
+	prevbuf = hash_xlog_readbuf(lsn, record, block_index++, xlrec->node,
+								xlrec->prevblkno, false, &apply);
+	if (apply)
+	{
+		Page		prevpage = BufferGetPage(prevbuf);
+		HashPageOpaque prevopaque = (HashPageOpaque) PageGetSpecialPointer(prevpage);
+
+		prevopaque->hasho_nextblkno = xlrec->ovflblkno;
+
+		hash_xlog_setlsn(prevbuf, lsn);
+	}
+
+	/* rebuild the new overflow page */
+	ovflbuf = hash_xlog_initbuf(xlrec->node, xlrec->ovflblkno);
+	ovflpage = BufferGetPage(ovflbuf);
+	_hash_pageinit(ovflpage, BufferGetPageSize(ovflbuf));
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+	ovflopaque->hasho_prevblkno = xlrec->prevblkno;
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = xlrec->bucket;
+	ovflopaque->hasho_flag = LH_OVERFLOW_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_setlsn(ovflbuf, lsn);
+
+	/* a reused page has to be marked "in use" in its bitmap */
+	if (BlockNumberIsValid(xlrec->mapblkno))
+	{
+		mapbuf = hash_xlog_readbuf(lsn, record, block_index++, xlrec->node,
+								   xlrec->mapblkno, false, &apply);
+		if (apply)
+		{
+			uint32	   *freep = HashPageGetBitmap(BufferGetPage(mapbuf));
+
+			SETBIT(freep, xlrec->bitmap_page_bit);
+
+			hash_xlog_setlsn(mapbuf, lsn);
+		}
+	}
+
+	/* rebuild the new bitmap page, if one was added */
+	if (BlockNumberIsValid(xlrec->newmapblkno))
+	{
+		newmapbuf = hash_xlog_initbuf(xlrec->node, xlrec->newmapblkno);
+		_hash_initbitmapbuffer(newmapbuf, xlrec->bmsize, true);
+		hash_xlog_setlsn(newmapbuf, lsn);
+	}
+
+	metabuf = hash_xlog_readbuf(lsn, record, block_index++, xlrec->node,
+								HASH_METAPAGE, false, &apply);
+	if (apply)
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(metabuf));
+
+		metap->hashm_firstfree = xlrec->firstfree;
+		metap->hashm_spares[metap->hashm_ovflpoint] = xlrec->spares;
+
+		if (BlockNumberIsValid(xlrec->newmapblkno))
+		{
+			metap->hashm_mapp[metap->hashm_nmaps] = xlrec->newmapblkno;
+			metap->hashm_nmaps++;
+		}
+
+		hash_xlog_setlsn(metabuf, lsn);
+	}
+
+	hash_xlog_release(prevbuf);
+	hash_xlog_release(ovflbuf);
+	hash_xlog_release(mapbuf);
+	hash_xlog_release(newmapbuf);
+	hash_xlog_release(metabuf);
+}
+
+/*
+ * replay allocation of page for split operation
+ */
+static void
+hash_xlog_split_allocate_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_allocate_page *xlrec = (xl_hash_split_allocate_page *) XLogRecGetData(record);
+	Buffer		oldbuf;
+	Buffer		newbuf;
+	Buffer		metabuf;
+	bool		apply;
+
+	/*
+	 * To be consistent with the primary, take a cleanup lock on the old
+	 * bucket's primary page; no standby scan may be in that bucket while the
+	 * split starts.
+	 */
+	oldbuf = hash_xlog_readbuf(lsn, record, 0, xlrec->node, xlrec->oblkno,
+							   true, &apply);
+	if (apply)
+	{
+		Page		oldpage = BufferGetPage(oldbuf);
+		HashPageOpaque oldopaque = (HashPageOpaque) PageGetSpecialPointer(oldpage);
+
+		oldopaque->hasho_flag |= LH_BUCKET_BEING_SPLIT;
+		oldopaque->hasho_prevblkno = xlrec->maxbucket;
+
+		hash_xlog_setlsn(oldbuf, lsn);
+	}
+
+	/* rebuild the new bucket's primary page */
+	newbuf = hash_xlog_initbuf(xlrec->node, xlrec->nblkno);
+	_hash_initbuf(newbuf, xlrec->maxbucket, xlrec->new_bucket,
+				  LH_BUCKET_PAGE | LH_BUCKET_BEING_POPULATED, true);
+	hash_xlog_setlsn(newbuf, lsn);
+
+	metabuf = hash_xlog_readbuf(lsn, record, 1, xlrec->node, HASH_METAPAGE,
+								false, &apply);
+	if (apply)
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(metabuf));
+
+		metap->hashm_maxbucket = xlrec->maxbucket;
+		metap->hashm_highmask = xlrec->highmask;
+		metap->hashm_lowmask = xlrec->lowmask;
+		metap->hashm_ovflpoint = xlrec->ovflpoint;
+		metap->hashm_spares[xlrec->ovflpoint] = xlrec->spares;
+
+		hash_xlog_setlsn(metabuf, lsn);
+	}
+
+	hash_xlog_release(oldbuf);
+	hash_xlog_release(newbuf);
+	hash_xlog_release(metabuf);
+}
+
+/*
+ * replay completion of split operation
+ */
+static void
+hash_xlog_split_complete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_complete *xlrec = (xl_hash_split_complete *) XLogRecGetData(record);
+	Buffer		oldbuf;
+	Buffer		newbuf;
+	bool		apply;
+
+	oldbuf = hash_xlog_readbuf(lsn, record, 0, xlrec->node, xlrec->oblkno,
+							   false, &apply);
+	if (apply)
+	{
+		Page		oldpage = BufferGetPage(oldbuf);
+		HashPageOpaque oldopaque = (HashPageOpaque) PageGetSpecialPointer(oldpage);
+
+		oldopaque->hasho_flag = xlrec->old_bucket_flag;
+
+		hash_xlog_setlsn(oldbuf, lsn);
+	}
+
+	newbuf = hash_xlog_readbuf(lsn, record, 1, xlrec->node, xlrec->nblkno,
+							   false, &apply);
+	if (apply)
+	{
+		Page		newpage = BufferGetPage(newbuf);
+		HashPageOpaque newopaque = (HashPageOpaque) PageGetSpecialPointer(newpage);
+
+		newopaque->hasho_flag = xlrec->new_bucket_flag;
+
+		hash_xlog_setlsn(newbuf, lsn);
+	}
+
+	hash_xlog_release(oldbuf);
+	hash_xlog_release(newbuf);
+}
+
+/*
+ * replay move of page contents for squeeze operation of hash index
+ */
+static void
+hash_xlog_move_page_contents(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_move_page_contents *xlrec = (xl_hash_move_page_contents *) XLogRecGetData(record);
+	Buffer		bucketbuf = InvalidBuffer;
+	Buffer		wbuf;
+	Buffer		rbuf;
+	bool		apply;
+
+	if (xlrec->bucketblkno != xlrec->wblkno)
+		bucketbuf = hash_xlog_lockbucket(xlrec->node, xlrec->bucketblkno);
+
+	wbuf = hash_xlog_readbuf(lsn, record, 0, xlrec->node, xlrec->wblkno,
+							 xlrec->bucketblkno == xlrec->wblkno, &apply);
+	if (apply)
+	{
+		Page		wpage = BufferGetPage(wbuf);
+		OffsetNumber *towrite;
+		char	   *tupdata;
+		int			i;
+
+		towrite = (OffsetNumber *) ((char *) xlrec + SizeOfHashMovePageContents);
+		tupdata = (char *) towrite + xlrec->ntups * sizeof(OffsetNumber);
+
+		for (i = 0; i < xlrec->ntups; i++)
+		{
+			IndexTupleData itupdata;
+			Size		itemsz;
+
+			/* the tuples are not aligned within the record */
+			memcpy(&itupdata, tupdata, sizeof(IndexTupleData));
+			itemsz = IndexTupleDSize(itupdata);
+
+			if (PageAddItem(wpage, (Item) tupdata, itemsz, towrite[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "hash_xlog_move_page_contents: failed to add item");
+
+			tupdata += MAXALIGN(itemsz);
+		}
+
+		hash_xlog_setlsn(wbuf, lsn);
+	}
+
+	rbuf = hash_xlog_readbuf(lsn, record, 1, xlrec->node, xlrec->rblkno,
+							 false, &apply);
+	if (apply)
+	{
+		OffsetNumber *deletable;
+
+		/* the source offsets are always the last part of the record */
+		deletable = (OffsetNumber *) ((char *) xlrec + record->xl_len -
+									  xlrec->ntups * sizeof(OffsetNumber));
+
+		PageIndexMultiDelete(BufferGetPage(rbuf), deletable, xlrec->ntups);
+
+		hash_xlog_setlsn(rbuf, lsn);
+	}
+
+	hash_xlog_release(wbuf);
+	hash_xlog_release(rbuf);
+	hash_xlog_release(bucketbuf);
+}
+
+/*
+ * replay unlinking and freeing of an overflow page for squeeze operation
+ */
+static void
+hash_xlog_squeeze_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_squeeze_page *xlrec = (xl_hash_squeeze_page *) XLogRecGetData(record);
+	int			block_index = 0;
+	Buffer		bucketbuf = InvalidBuffer;
+	Buffer		prevbuf;
+	Buffer		nextbuf = InvalidBuffer;
+	Buffer		ovflbuf;
+	Buffer		mapbuf;
+	Buffer		metabuf = InvalidBuffer;
+	Page		ovflpage;
+	HashPageOpaque ovflopaque;
+	bool		apply;
+
+	if (xlrec->bucketblkno != xlrec->prevblkno)
+		bucketbuf = hash_xlog_lockbucket(xlrec->node, xlrec->bucketblkno);
+
+	prevbuf = hash_xlog_readbuf(lsn, record, block_index++, xlrec->node,
+								xlrec->prevblkno,
+								xlrec->bucketblkno == xlrec->prevblkno,
+								&apply);
+	if (apply)
+	{
+		Page		prevpage = BufferGetPage(prevbuf);
+		HashPageOpaque prevopaque = (HashPageOpaque) PageGetSpecialPointer(prevpage);
+
+		prevopaque->hasho_nextblkno = xlrec->nextblkno;
+
+		hash_xlog_setlsn(prevbuf, lsn);
+	}
+
+	/* the freed page is reinitialized as an unused page */
+	ovflbuf = hash_xlog_initbuf(xlrec->node, xlrec->ovflblkno);
+	ovflpage = BufferGetPage(ovflbuf);
+	_hash_pageinit(ovflpage, BufferGetPageSize(ovflbuf));
+	ovflopaque = (HashPageOpaque) PageGetSpecialPointer(ovflpage);
+	ovflopaque->hasho_prevblkno = InvalidBlockNumber;
+	ovflopaque->hasho_nextblkno = InvalidBlockNumber;
+	ovflopaque->hasho_bucket = InvalidBucket;
+	ovflopaque->hasho_flag = LH_UNUSED_PAGE;
+	ovflopaque->hasho_page_id = HASHO_PAGE_ID;
+	hash_xlog_setlsn(ovflbuf, lsn);
+
+	if (BlockNumberIsValid(xlrec->nextblkno))
+	{
+		nextbuf = hash_xlog_readbuf(lsn, record, block_index++, xlrec->node,
+									xlrec->nextblkno, false, &apply);
+		if (apply)
+		{
+			Page		nextpage = BufferGetPage(nextbuf);
+			HashPageOpaque nextopaque = (HashPageOpaque) PageGetSpecialPointer(nextpage);
+
+			nextopaque->hasho_prevblkno = xlrec->prevblkno;
+
+			hash_xlog_setlsn(nextbuf, lsn);
+		}
+	}
+
+	mapbuf = hash_xlog_readbuf(lsn, record, block_index++, xlrec->node,
+							   xlrec->mapblkno, false, &apply);
+	if (apply)
+	{
+		uint32	   *freep = HashPageGetBitmap(BufferGetPage(mapbuf));
+
+		CLRBIT(freep, xlrec->bitmapbit);
+
+		hash_xlog_setlsn(mapbuf, lsn);
+	}
+
+	if (xlrec->update_firstfree)
+	{
+		metabuf = hash_xlog_readbuf(lsn, record, block_index++, xlrec->node,
+									HASH_METAPAGE, false, &apply);
+		if (apply)
+		{
+			HashMetaPage metap = HashPageGetMeta(BufferGetPage(metabuf));
+
+			metap->hashm_firstfree = xlrec->firstfree;
+
+			hash_xlog_setlsn(metabuf, lsn);
+		}
+	}
+
+	hash_xlog_release(prevbuf);
+	hash_xlog_release(ovflbuf);
+	hash_xlog_release(nextbuf);
+	hash_xlog_release(mapbuf);
+	hash_xlog_release(metabuf);
+	hash_xlog_release(bucketbuf);
+}
+
+/*
+ * replay delete operation of hash index
+ */
+static void
+hash_xlog_delete(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_delete *xlrec = (xl_hash_delete *) XLogRecGetData(record);
+	Buffer		bucketbuf = InvalidBuffer;
+	Buffer		buffer;
+	bool		apply;
+
+	if (xlrec->bucketblkno != xlrec->blkno)
+		bucketbuf = hash_xlog_lockbucket(xlrec->node, xlrec->bucketblkno);
+
+	buffer = hash_xlog_readbuf(lsn, record, 0, xlrec->node, xlrec->blkno,
+							   xlrec->bucketblkno == xlrec->blkno, &apply);
+	if (apply)
+	{
+		OffsetNumber *unused;
+		int			nunused;
+
+		unused = (OffsetNumber *) ((char *) xlrec + SizeOfHashDelete);
+		nunused = (record->xl_len - SizeOfHashDelete) / sizeof(OffsetNumber);
+
+		if (nunused > 0)
+			PageIndexMultiDelete(BufferGetPage(buffer), unused, nunused);
+
+		hash_xlog_setlsn(buffer, lsn);
+	}
+
+	hash_xlog_release(buffer);
+	hash_xlog_release(bucketbuf);
+}
+
+/*
+ * replay split cleanup flag operation for primary bucket page.
+ */
+static void
+hash_xlog_split_cleanup(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_split_cleanup *xlrec = (xl_hash_split_cleanup *) XLogRecGetData(record);
+	Buffer		buffer;
+	bool		apply;
+
+	buffer = hash_xlog_readbuf(lsn, record, 0, xlrec->node, xlrec->blkno,
+							   false, &apply);
+	if (apply)
+	{
+		Page		page = BufferGetPage(buffer);
+		HashPageOpaque bucket_opaque = (HashPageOpaque) PageGetSpecialPointer(page);
+
+		bucket_opaque->hasho_flag &= ~LH_BUCKET_NEEDS_SPLIT_CLEANUP;
+
+		hash_xlog_setlsn(buffer, lsn);
+	}
+
+	hash_xlog_release(buffer);
+}
+
+/*
+ * replay for update meta page
+ */
+static void
+hash_xlog_update_meta_page(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_hash_update_meta_page *xlrec = (xl_hash_update_meta_page *) XLogRecGetData(record);
+	Buffer		metabuf;
+	bool		apply;
+
+	metabuf = hash_xlog_readbuf(lsn, record, 0, xlrec->node, HASH_METAPAGE,
+								false, &apply);
+	if (apply)
+	{
+		HashMetaPage metap = HashPageGetMeta(BufferGetPage(metabuf));
+
+		metap->hashm_ntuples = xlrec->ntuples;
+
+		hash_xlog_setlsn(metabuf, lsn);
+	}
+
+	hash_xlog_release(metabuf);
+}
+
+void
+hash_redo(XLogRecPtr lsn, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	/*
+	 * Hash indexes do not require any conflict processing: tuples are only
+	 * removed by VACUUM, whose heap cleanup records already resolve any
+	 * conflicts.  Backup blocks are restored by the individual routines, so
+	 * that every page touched by a record stays locked until the whole
+	 * record has been replayed.
+	 */
+	switch (info)
+	{
+		case XLOG_HASH_INSERT:
+			hash_xlog_insert(lsn, record);
+			break;
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			hash_xlog_add_ovfl_page(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_ALLOCATE_PAGE:
+			hash_xlog_split_allocate_page(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_COMPLETE:
+			hash_xlog_split_complete(lsn, record);
+			break;
+		case XLOG_HASH_MOVE_PAGE_CONTENTS:
+			hash_xlog_move_page_contents(lsn, record);
+			break;
+		case XLOG_HASH_SQUEEZE_PAGE:
+			hash_xlog_squeeze_page(lsn, record);
+			break;
+		case XLOG_HASH_DELETE:
+			hash_xlog_delete(lsn, record);
+			break;
+		case XLOG_HASH_SPLIT_CLEANUP:
+			hash_xlog_split_cleanup(lsn, record);
+			break;
+		case XLOG_HASH_UPDATE_META_PAGE:
+			hash_xlog_update_meta_page(lsn, record);
+			break;
+		default:
+			elog(PANIC, "hash_redo: unknown op code %u", info);
+	}
+}
+
+static void
+out_target(StringInfo buf, RelFileNode node)
+{
+	appendStringInfo(buf, "rel %u/%u/%u ",
+					 node.spcNode, node.dbNode, node.relNode);
+}
+
+void
+hash_desc(StringInfo buf, uint8 xl_info, char *rec)
+{
+	uint8		info = xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_HASH_INSERT:
+			{
+				xl_hash_insert *xlrec = (xl_hash_insert *) rec;
+
+				appendStringInfo(buf, "insert: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "tid %u/%u",
+								 xlrec->blkno, xlrec->offnum);
+				break;
+			}
+		case XLOG_HASH_ADD_OVFL_PAGE:
+			{
+				xl_hash_add_ovfl_page *xlrec = (xl_hash_add_ovfl_page *) rec;
+
+				appendStringInfo(buf, "add overflow page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "blk %u after %u in bucket %u",
+								 xlrec->ovflblkno, xlrec->prevblkno,
+								 xlrec->bucket);
+				if (BlockNumberIsValid(xlrec->newmapblkno))
+					appendStringInfo(buf, ", new bitmap page %u",
+									 xlrec->newmapblkno);
+				break;
+			}
+		case XLOG_HASH_SPLIT_ALLOCATE_PAGE:
+			{
+				xl_hash_split_allocate_page *xlrec = (xl_hash_split_allocate_page *) rec;
+
+				appendStringInfo(buf, "split allocate page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "bucket %u at blk %u from blk %u",
+								 xlrec->new_bucket, xlrec->nblkno,
+								 xlrec->oblkno);
+				break;
+			}
+		case XLOG_HASH_SPLIT_COMPLETE:
+			{
+				xl_hash_split_complete *xlrec = (xl_hash_split_complete *) rec;
+
+				appendStringInfo(buf, "split complete: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "old blk %u flag %u, new blk %u flag %u",
+								 xlrec->oblkno, xlrec->old_bucket_flag,
+								 xlrec->nblkno, xlrec->new_bucket_flag);
+				break;
+			}
+		case XLOG_HASH_MOVE_PAGE_CONTENTS:
+			{
+				xl_hash_move_page_contents *xlrec = (xl_hash_move_page_contents *) rec;
+
+				appendStringInfo(buf, "move page contents: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "%u tuples from blk %u to blk %u",
+								 xlrec->ntups, xlrec->rblkno, xlrec->wblkno);
+				break;
+			}
+		case XLOG_HASH_SQUEEZE_PAGE:
+			{
+				xl_hash_squeeze_page *xlrec = (xl_hash_squeeze_page *) rec;
+
+				appendStringInfo(buf, "squeeze page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "free blk %u, prev %u, next %u",
+								 xlrec->ovflblkno, xlrec->prevblkno,
+								 xlrec->nextblkno);
+				break;
+			}
+		case XLOG_HASH_DELETE:
+			{
+				xl_hash_delete *xlrec = (xl_hash_delete *) rec;
+
+				appendStringInfo(buf, "delete: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "blk %u", xlrec->blkno);
+				break;
+			}
+		case XLOG_HASH_SPLIT_CLEANUP:
+			{
+				xl_hash_split_cleanup *xlrec = (xl_hash_split_cleanup *) rec;
+
+				appendStringInfo(buf, "split cleanup: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "blk %u", xlrec->blkno);
+				break;
+			}
+		case XLOG_HASH_UPDATE_META_PAGE:
+			{
+				xl_hash_update_meta_page *xlrec = (xl_hash_update_meta_page *) rec;
+
+				appendStringInfo(buf, "update meta page: ");
+				out_target(buf, xlrec->node);
+				appendStringInfo(buf, "ntuples %g", xlrec->ntuples);
+				break;
+			}
+		default:
+			appendStringInfo(buf, "UNKNOWN");
+			break;
+	}
+}
@@ -19,6 +19,7 @@
  *		heap_openrv		- open a heap relation specified by a RangeVar
  *		heap_close		- (now just a macro for relation_close)
  *		heap_beginscan	- begin relation scan
+ *		heap_beginscan_parallel - join a relation scan shared among backends
  *		heap_rescan		- restart a relation scan
  *		heap_endscan	- end relation scan
  *		heap_getnext	- retrieve next tuple in scan
@@ -56,6 +57,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
+#include "storage/fd.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
@@ -74,19 +76,48 @@
 /* GUC variable */
 bool		synchronize_seqscans = true;
 
+/*
+ * Number of consecutive blocks a participant in a parallel heap scan claims
+ * at a time.  Claiming a run of blocks rather than single blocks keeps the
+ * traffic on the shared allocator's spinlock down, and lets each backend
+ * issue sequential reads that the kernel's readahead can recognize.
+ */
+#define PARALLEL_SCAN_CHUNK_BLOCKS	16
+
+/*
+ * Do changes to this relation need an XLOG_HEAP2_LOGICAL record?  Only user
+ * tables (and their TOAST tables) are decoded; catalog changes are not.
+ */
+#define RelationIsLogicallyLogged(relation) \
+	(XLogLogicalInfoActive() && \
+	 RelationNeedsWAL(relation) && \
+	 RelationGetRelid(relation) >= FirstNormalObjectId)
+
 
 static HeapScanDesc heap_beginscan_internal(Relation relation,
 						Snapshot snapshot,
 						int nkeys, ScanKey key,
 						bool allow_strat, bool allow_sync,
-						bool is_bitmapscan);
+						bool is_bitmapscan,
+						ParallelHeapScanDesc parallel_scan);
+static BlockNumber heap_parallelscan_nextpage(HeapScanDesc scan);
+static void heap_prefetch_start(HeapScanDesc scan, BlockNumber page,
+					BlockNumber nblocks);
+static void heap_prefetch_advance(HeapScanDesc scan, BlockNumber page);
 static HeapTuple heap_prepare_insert(Relation relation, HeapTuple tup,
 					TransactionId xid, CommandId cid, int options);
 static XLogRecPtr log_heap_update(Relation reln, Buffer oldbuf,
 				ItemPointerData from, Buffer newbuf, HeapTuple newtup,
 				bool all_visible_cleared, bool new_all_visible_cleared);
+static void log_heap_logical(Relation relation, char action,
+				 HeapTuple oldtup, HeapTuple newtup);
 static bool HeapSatisfiesHOTUpdate(Relation relation, Bitmapset *hot_attrs,
 					   HeapTuple oldtup, HeapTuple newtup);
+static HTSU_Result heap_update_internal(Relation relation, ItemPointer otid,
+					 HeapTuple newtup,
+					 ItemPointer ctid, TransactionId *update_xmax,
+					 CommandId cid, Snapshot crosscheck, bool wait,
+					 bool move, bool *noroom);
 
 
 /* ----------------------------------------------------------------
@@ -114,8 +145,14 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 	 * might go into pages we already scanned.	To guarantee consistent
 	 * results for a non-MVCC snapshot, the caller must hold some higher-level
 	 * lock that ensures the interesting tuple(s) won't change.)
+	 *
+	 * A parallel scan must use the block count that was fixed when the shared
+	 * state was set up, so that all participants agree on it.
 	 */
-	scan->rs_nblocks = RelationGetNumberOfBlocks(scan->rs_rd);
+	if (scan->rs_parallel != NULL)
+		scan->rs_nblocks = scan->rs_parallel->phs_nblocks;
+	else
+		scan->rs_nblocks = RelationGetNumberOfBlocks(scan->rs_rd);
 
 	/*
 	 * If the table is large relative to NBuffers, use a bulk-read access
@@ -149,7 +186,16 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 		scan->rs_strategy = NULL;
 	}
 
-	if (is_rescan)
+	if (scan->rs_parallel != NULL)
+	{
+		/*
+		 * The shared state chooses the start block and reports our progress
+		 * to the syncscan logic itself; see heap_parallelscan_nextpage.
+		 */
+		scan->rs_syncscan = false;
+		scan->rs_startblock = scan->rs_parallel->phs_startblock;
+	}
+	else if (is_rescan)
 	{
 		/*
 		 * If rescan, keep the previous startblock setting so that rewinding a
@@ -169,11 +215,20 @@ initscan(HeapScanDesc scan, ScanKey key, bool is_rescan)
 		scan->rs_startblock = 0;
 	}
 
+	scan->rs_numblocks = InvalidBlockNumber;
 	scan->rs_inited = false;
 	scan->rs_ctup.t_data = NULL;
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_pnext = scan->rs_pend = 0;
+	scan->rs_prefetch_next = InvalidBlockNumber;
+	scan->rs_prefetch_left = 0;
+	if (scan->rs_readstream != NULL)
+	{
+		ReadStreamReset(scan->rs_readstream);
+		scan->rs_readstream->strategy = scan->rs_strategy;
+	}
 
 	/* we don't have a marked position... */
 	ItemPointerSetInvalid(&(scan->rs_mctid));
@@ -222,6 +277,10 @@ heapgetpage(HeapScanDesc scan, BlockNumber page)
 		scan->rs_cbuf = InvalidBuffer;
 	}
 
+	/* keep read-ahead going, if this scan does any */
+	if (scan->rs_readstream != NULL)
+		heap_prefetch_advance(scan, page);
+
 	/* read page using selected strategy */
 	scan->rs_cbuf = ReadBufferExtended(scan->rs_rd, MAIN_FORKNUM, page,
 									   RBM_NORMAL, scan->rs_strategy);
@@ -347,7 +406,25 @@ heapgettup(HeapScanDesc scan,
 				tuple->t_data = NULL;
 				return;
 			}
-			page = scan->rs_startblock; /* first page */
+			if (scan->rs_parallel != NULL)
+			{
+				page = heap_parallelscan_nextpage(scan);
+
+				/* other participants may have already finished the scan */
+				if (page == InvalidBlockNumber)
+				{
+					Assert(!BufferIsValid(scan->rs_cbuf));
+					tuple->t_data = NULL;
+					return;
+				}
+			}
+			else
+			{
+				page = scan->rs_startblock;		/* first page */
+				heap_prefetch_start(scan, page,
+									scan->rs_numblocks != InvalidBlockNumber ?
+									scan->rs_numblocks : scan->rs_nblocks);
+			}
 			heapgetpage(scan, page);
 			lineoff = FirstOffsetNumber;		/* first offnum */
 			scan->rs_inited = true;
@@ -389,8 +466,13 @@ heapgettup(HeapScanDesc scan,
 			 * forward scanners.
 			 */
 			scan->rs_syncscan = false;
+			/* a shared scan can only be run forwards */
+			Assert(scan->rs_parallel == NULL);
 			/* start from last page of the scan */
-			if (scan->rs_startblock > 0)
+			if (scan->rs_numblocks != InvalidBlockNumber)
+				page = (scan->rs_startblock + scan->rs_numblocks - 1) %
+					scan->rs_nblocks;
+			else if (scan->rs_startblock > 0)
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
@@ -514,17 +596,26 @@ heapgettup(HeapScanDesc scan,
 		 */
 		if (backward)
 		{
-			finished = (page == scan->rs_startblock);
+			finished = (page == scan->rs_startblock) ||
+				(scan->rs_numblocks != InvalidBlockNumber ?
+				 --scan->rs_numblocks == 0 : false);
 			if (page == 0)
 				page = scan->rs_nblocks;
 			page--;
 		}
+		else if (scan->rs_parallel != NULL)
+		{
+			page = heap_parallelscan_nextpage(scan);
+			finished = (page == InvalidBlockNumber);
+		}
 		else
 		{
 			page++;
 			if (page >= scan->rs_nblocks)
 				page = 0;
-			finished = (page == scan->rs_startblock);
+			finished = (page == scan->rs_startblock) ||
+				(scan->rs_numblocks != InvalidBlockNumber ?
+				 --scan->rs_numblocks == 0 : false);
 
 			/*
 			 * Report our new scan position for synchronization purposes. We
@@ -622,7 +713,25 @@ heapgettup_pagemode(HeapScanDesc scan,
 				tuple->t_data = NULL;
 				return;
 			}
-			page = scan->rs_startblock; /* first page */
+			if (scan->rs_parallel != NULL)
+			{
+				page = heap_parallelscan_nextpage(scan);
+
+				/* other participants may have already finished the scan */
+				if (page == InvalidBlockNumber)
+				{
+					Assert(!BufferIsValid(scan->rs_cbuf));
+					tuple->t_data = NULL;
+					return;
+				}
+			}
+			else
+			{
+				page = scan->rs_startblock;		/* first page */
+				heap_prefetch_start(scan, page,
+									scan->rs_numblocks != InvalidBlockNumber ?
+									scan->rs_numblocks : scan->rs_nblocks);
+			}
 			heapgetpage(scan, page);
 			lineindex = 0;
 			scan->rs_inited = true;
@@ -661,8 +770,13 @@ heapgettup_pagemode(HeapScanDesc scan,
 			 * forward scanners.
 			 */
 			scan->rs_syncscan = false;
+			/* a shared scan can only be run forwards */
+			Assert(scan->rs_parallel == NULL);
 			/* start from last page of the scan */
-			if (scan->rs_startblock > 0)
+			if (scan->rs_numblocks != InvalidBlockNumber)
+				page = (scan->rs_startblock + scan->rs_numblocks - 1) %
+					scan->rs_nblocks;
+			else if (scan->rs_startblock > 0)
 				page = scan->rs_startblock - 1;
 			else
 				page = scan->rs_nblocks - 1;
@@ -775,17 +889,26 @@ heapgettup_pagemode(HeapScanDesc scan,
 		 */
 		if (backward)
 		{
-			finished = (page == scan->rs_startblock);
+			finished = (page == scan->rs_startblock) ||
+				(scan->rs_numblocks != InvalidBlockNumber ?
+				 --scan->rs_numblocks == 0 : false);
 			if (page == 0)
 				page = scan->rs_nblocks;
 			page--;
 		}
+		else if (scan->rs_parallel != NULL)
+		{
+			page = heap_parallelscan_nextpage(scan);
+			finished = (page == InvalidBlockNumber);
+		}
 		else
 		{
 			page++;
 			if (page >= scan->rs_nblocks)
 				page = 0;
-			finished = (page == scan->rs_startblock);
+			finished = (page == scan->rs_startblock) ||
+				(scan->rs_numblocks != InvalidBlockNumber ?
+				 --scan->rs_numblocks == 0 : false);
 
 			/*
 			 * Report our new scan position for synchronization purposes. We
@@ -1139,6 +1262,9 @@ heap_openrv_extended(const RangeVar *relation, LOCKMODE lockmode,
  * HeapScanDesc for a bitmap heap scan.  Although that scan technology is
  * really quite unlike a standard seqscan, there is just enough commonality
  * to make it worth using the same data structure.
+ *
+ * heap_beginscan_parallel (see below) sets up a scan that shares its pages
+ * with scans running in other backends.
  * ----------------
  */
 HeapScanDesc
@@ -1146,7 +1272,7 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 			   int nkeys, ScanKey key)
 {
 	return heap_beginscan_internal(relation, snapshot, nkeys, key,
-								   true, true, false);
+								   true, true, false, NULL);
 }
 
 HeapScanDesc
@@ -1155,7 +1281,7 @@ heap_beginscan_strat(Relation relation, Snapshot snapshot,
 					 bool allow_strat, bool allow_sync)
 {
 	return heap_beginscan_internal(relation, snapshot, nkeys, key,
-								   allow_strat, allow_sync, false);
+								   allow_strat, allow_sync, false, NULL);
 }
 
 HeapScanDesc
@@ -1163,14 +1289,38 @@ heap_beginscan_bm(Relation relation, Snapshot snapshot,
 				  int nkeys, ScanKey key)
 {
 	return heap_beginscan_internal(relation, snapshot, nkeys, key,
-								   false, false, true);
+								   false, false, true, NULL);
+}
+
+/* ----------------
+ *		heap_setscanlimits - restrict range of a heapscan
+ *
+ * startBlk is the page to start at
+ * numBlks is number of pages to scan (InvalidBlockNumber means "all")
+ *
+ * This must be called before the first tuple is fetched; the limits stay in
+ * effect until the scan is restarted with heap_rescan.
+ * ----------------
+ */
+void
+heap_setscanlimits(HeapScanDesc scan, BlockNumber startBlk, BlockNumber numBlks)
+{
+	Assert(!scan->rs_inited);
+	Assert(scan->rs_parallel == NULL);
+
+	scan->rs_startblock = startBlk;
+	scan->rs_numblocks = numBlks;
+
+	/* the caller picked the start page, so don't confuse syncscan */
+	scan->rs_syncscan = false;
 }
 
 static HeapScanDesc
 heap_beginscan_internal(Relation relation, Snapshot snapshot,
 						int nkeys, ScanKey key,
 						bool allow_strat, bool allow_sync,
-						bool is_bitmapscan)
+						bool is_bitmapscan,
+						ParallelHeapScanDesc parallel_scan)
 {
 	HeapScanDesc scan;
 
@@ -1195,6 +1345,24 @@ heap_beginscan_internal(Relation relation, Snapshot snapshot,
 	scan->rs_strategy = NULL;	/* set in initscan */
 	scan->rs_allow_strat = allow_strat;
 	scan->rs_allow_sync = allow_sync;
+	scan->rs_parallel = parallel_scan;
+
+	/*
+	 * Forward scans read ahead of themselves, if prefetching is enabled.
+	 * Bitmap heap scans prefetch on their own, using the bitmap.  With
+	 * direct I/O the kernel does no read-ahead for us, so we always do our
+	 * own, in batches big enough to coalesce.
+	 */
+	if (!is_bitmapscan && (direct_io & DIRECT_IO_DATA))
+		scan->rs_readstream = ReadStreamCreate(relation, MAIN_FORKNUM,
+											   MAX_BUFFER_READAHEAD,
+											   MAX_BUFFER_READAHEAD);
+	else if (!is_bitmapscan && target_prefetch_pages > 0)
+		scan->rs_readstream = ReadStreamCreate(relation, MAIN_FORKNUM,
+											   target_prefetch_pages,
+											   target_prefetch_pages);
+	else
+		scan->rs_readstream = NULL;
 
 	/*
 	 * we can use page-at-a-time mode if it's an MVCC-safe snapshot
@@ -1234,6 +1402,11 @@ heap_beginscan_internal(Relation relation, Snapshot snapshot,
 
 /* ----------------
  *		heap_rescan		- restart a relation scan
+ *
+ * For a parallel scan this only resets the local state; the shared state
+ * must also be reset with heap_parallelscan_reinitialize, once all the
+ * participants are done with the previous pass, before any of them
+ * fetch again.
  * ----------------
  */
 void
@@ -1281,9 +1454,200 @@ heap_endscan(HeapScanDesc scan)
 	if (scan->rs_strategy != NULL)
 		FreeAccessStrategy(scan->rs_strategy);
 
+	if (scan->rs_readstream != NULL)
+		ReadStreamFree(scan->rs_readstream);
+
 	pfree(scan);
 }
 
+/* ----------------
+ *		heap_parallelscan_estimate - estimate storage for ParallelHeapScanDesc
+ *
+ *		Callers outside the heap AM don't know the struct layout, so they
+ *		use this to size the chunk of shared memory they hand to
+ *		heap_parallelscan_initialize.
+ * ----------------
+ */
+Size
+heap_parallelscan_estimate(void)
+{
+	return sizeof(ParallelHeapScanDescData);
+}
+
+/* ----------------
+ *		heap_parallelscan_initialize - initialize ParallelHeapScanDesc
+ *
+ *		Must be called by exactly one backend, before any participant
+ *		starts scanning.  The block count is fixed here, so the same
+ *		considerations about tuples added during the scan apply as in
+ *		initscan().
+ * ----------------
+ */
+void
+heap_parallelscan_initialize(ParallelHeapScanDesc target, Relation relation)
+{
+	/* other backends can't see our local buffers */
+	if (RelationUsesLocalBuffers(relation))
+		elog(ERROR, "cannot share a scan of temporary relation \"%s\"",
+			 RelationGetRelationName(relation));
+
+	target->phs_relid = RelationGetRelid(relation);
+	target->phs_nblocks = RelationGetNumberOfBlocks(relation);
+
+	/* use the same size threshold for syncscan as initscan() does */
+	if (synchronize_seqscans && target->phs_nblocks > NBuffers / 4)
+	{
+		target->phs_syncscan = true;
+		target->phs_startblock = ss_get_location(relation,
+												 target->phs_nblocks);
+	}
+	else
+	{
+		target->phs_syncscan = false;
+		target->phs_startblock = 0;
+	}
+
+	SpinLockInit(&target->phs_mutex);
+	target->phs_nallocated = 0;
+}
+
+/* ----------------
+ *		heap_parallelscan_reinitialize - reset a parallel scan
+ *
+ *		Lets the same shared state be used for another pass over the
+ *		relation.  The caller must make sure no participant is still
+ *		fetching from the previous pass.
+ * ----------------
+ */
+void
+heap_parallelscan_reinitialize(ParallelHeapScanDesc parallel_scan)
+{
+	SpinLockAcquire(&parallel_scan->phs_mutex);
+	parallel_scan->phs_nallocated = 0;
+	SpinLockRelease(&parallel_scan->phs_mutex);
+}
+
+/* ----------------
+ *		heap_beginscan_parallel - join a parallel relation scan
+ *
+ *		Each participating backend calls this with the same shared state.
+ *		Between them, the scans return every tuple of the relation that is
+ *		visible to the snapshot exactly once, in no particular order; each
+ *		backend only sees the tuples on the blocks it claimed.  It is the
+ *		caller's business to make sure all participants use equivalent
+ *		snapshots.  Only forward scans are supported.
+ * ----------------
+ */
+HeapScanDesc
+heap_beginscan_parallel(Relation relation, Snapshot snapshot,
+						ParallelHeapScanDesc parallel_scan)
+{
+	Assert(RelationGetRelid(relation) == parallel_scan->phs_relid);
+
+	return heap_beginscan_internal(relation, snapshot, 0, NULL,
+								   true, false, false, parallel_scan);
+}
+
+/* ----------------
+ *		heap_parallelscan_nextpage - get the next page to scan
+ *
+ *		Returns InvalidBlockNumber once all pages of the relation have been
+ *		handed out.  Blocks are claimed from the shared state a chunk at a
+ *		time and then returned one by one from the local copy.
+ * ----------------
+ */
+static BlockNumber
+heap_parallelscan_nextpage(HeapScanDesc scan)
+{
+	ParallelHeapScanDesc parallel_scan = scan->rs_parallel;
+	uint64		page;
+	bool		newchunk = false;
+
+	if (scan->rs_pnext >= scan->rs_pend)
+	{
+		/* use volatile pointer to prevent code rearrangement */
+		volatile ParallelHeapScanDescData *pscan = parallel_scan;
+
+		SpinLockAcquire(&pscan->phs_mutex);
+		scan->rs_pnext = pscan->phs_nallocated;
+		if (pscan->phs_nblocks - pscan->phs_nallocated > PARALLEL_SCAN_CHUNK_BLOCKS)
+			pscan->phs_nallocated += PARALLEL_SCAN_CHUNK_BLOCKS;
+		else
+			pscan->phs_nallocated = pscan->phs_nblocks;
+		scan->rs_pend = pscan->phs_nallocated;
+		SpinLockRelease(&pscan->phs_mutex);
+
+		if (scan->rs_pnext >= scan->rs_pend)
+			return InvalidBlockNumber;
+		newchunk = true;
+	}
+
+	/* positions are counted from the start block, wrapping at the end */
+	page = (uint64) parallel_scan->phs_startblock + scan->rs_pnext++;
+	if (page >= parallel_scan->phs_nblocks)
+		page -= parallel_scan->phs_nblocks;
+
+	/* we can read ahead as far as the end of the chunk */
+	if (newchunk)
+		heap_prefetch_start(scan, (BlockNumber) page,
+							scan->rs_pend - scan->rs_pnext + 1);
+
+	/*
+	 * Report our scan position for synchronization purposes, as the
+	 * non-parallel code does.  With several of us reporting, the hint ends up
+	 * roughly where the front of the shared scan is.
+	 */
+	if (parallel_scan->phs_syncscan)
+		ss_report_location(scan->rs_rd, (BlockNumber) page);
+
+	return (BlockNumber) page;
+}
+
+/* ----------------
+ *		heap_prefetch_start - begin read-ahead for a run of blocks
+ *
+ *		page is the first block of a run of nblocks blocks that a forward
+ *		scan is going to read in order, wrapping around at the end of the
+ *		relation; the caller reads page itself right away.  The rest are fed
+ *		to the scan's read stream by heap_prefetch_advance as the scan moves
+ *		through them.
+ * ----------------
+ */
+static void
+heap_prefetch_start(HeapScanDesc scan, BlockNumber page, BlockNumber nblocks)
+{
+	if (scan->rs_readstream == NULL || nblocks == 0)
+		return;
+
+	ReadStreamReset(scan->rs_readstream);
+	scan->rs_prefetch_next = page + 1;
+	if (scan->rs_prefetch_next >= scan->rs_nblocks)
+		scan->rs_prefetch_next = 0;
+	scan->rs_prefetch_left = nblocks - 1;
+}
+
+/* ----------------
+ *		heap_prefetch_advance - keep read-ahead going as the scan moves on
+ *
+ *		Called by heapgetpage before it reads page.
+ * ----------------
+ */
+static void
+heap_prefetch_advance(HeapScanDesc scan, BlockNumber page)
+{
+	ReadStream *stream = scan->rs_readstream;
+
+	ReadStreamConsume(stream, page);
+
+	while (scan->rs_prefetch_left > 0 &&
+		   ReadStreamQueue(stream, scan->rs_prefetch_next))
+	{
+		if (++scan->rs_prefetch_next >= scan->rs_nblocks)
+			scan->rs_prefetch_next = 0;
+		scan->rs_prefetch_left--;
+	}
+}
+
 /* ----------------
  *		heap_getnext	- retrieve next tuple in scan
  *
@@ -1559,6 +1923,16 @@ heap_hot_search_buffer(ItemPointer tid, Relation relation, Buffer buffer,
 			break;
 		}
 
+		/*
+		 * The tuple we returned last time might have been pruned since then
+		 * by someone holding only an exclusive lock, and its line pointer
+		 * reused for an unrelated tuple.  Pruning without a cleanup lock
+		 * never moves tuple data, so if that happened the line pointer no
+		 * longer points where it did.
+		 */
+		if (skip && heapTuple->t_data != (HeapTupleHeader) PageGetItem(dp, lp))
+			break;
+
 		heapTuple->t_data = (HeapTupleHeader) PageGetItem(dp, lp);
 		heapTuple->t_len = ItemIdGetLength(lp);
 		heapTuple->t_tableOid = relation->rd_id;
@@ -1909,7 +2283,7 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 		PageClearAllVisible(BufferGetPage(buffer));
 		visibilitymap_clear(relation,
 							ItemPointerGetBlockNumber(&(heaptup->t_self)),
-							vmbuffer);
+							vmbuffer, VISIBILITYMAP_VALID_BITS);
 	}
 
 	/*
@@ -1981,6 +2355,10 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 
 		PageSetLSN(page, recptr);
 		PageSetTLI(page, ThisTimeLineID);
+
+		if (!(options & HEAP_INSERT_NO_LOGICAL) &&
+			RelationIsLogicallyLogged(relation))
+			log_heap_logical(relation, XLH_LOGICAL_INSERT, NULL, heaptup);
 	}
 
 	END_CRIT_SECTION();
@@ -2059,7 +2437,8 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 	 * If the new tuple is too big for storage or contains already toasted
 	 * out-of-line attributes from some other relation, invoke the toaster.
 	 */
-	if (relation->rd_rel->relkind != RELKIND_RELATION)
+	if (relation->rd_rel->relkind != RELKIND_RELATION &&
+		relation->rd_rel->relkind != RELKIND_MATVIEW)
 	{
 		/* toast table entries should never be recursively toasted */
 		Assert(!HeapTupleHasExternal(tup));
@@ -2149,7 +2528,7 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 			PageClearAllVisible(page);
 			visibilitymap_clear(relation,
 								BufferGetBlockNumber(buffer),
-								vmbuffer);
+								vmbuffer, VISIBILITYMAP_VALID_BITS);
 		}
 
 		/* NO EREPORT(ERROR) from here till changes are logged */
@@ -2268,6 +2647,14 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 
 			PageSetLSN(page, recptr);
 			PageSetTLI(page, ThisTimeLineID);
+
+			if (!(options & HEAP_INSERT_NO_LOGICAL) &&
+				RelationIsLogicallyLogged(relation))
+			{
+				for (i = 0; i < nthispage; i++)
+					log_heap_logical(relation, XLH_LOGICAL_INSERT,
+									 NULL, heaptuples[ndone + i]);
+			}
 		}
 
 		END_CRIT_SECTION();
@@ -2291,6 +2678,15 @@ heap_multi_insert(Relation relation, HeapTuple *tuples, int ntuples,
 			CacheInvalidateHeapTuple(relation, heaptuples[i], NULL);
 	}
 
+	/*
+	 * Copy t_self fields back to the caller's original tuples, which the
+	 * caller needs for making index entries.  This does nothing for
+	 * untoasted tuples (tuples[i] == heaptuples[i]), but it's probably
+	 * faster to always copy than check.
+	 */
+	for (i = 0; i < ntuples; i++)
+		tuples[i]->t_self = heaptuples[i]->t_self;
+
 	pgstat_count_heap_insert(relation, ntuples);
 }
 
@@ -2533,7 +2929,7 @@ l1:
 		all_visible_cleared = true;
 		PageClearAllVisible(page);
 		visibilitymap_clear(relation, BufferGetBlockNumber(buffer),
-							vmbuffer);
+							vmbuffer, VISIBILITYMAP_VALID_BITS);
 	}
 
 	/* store transaction information of xact deleting the tuple */
@@ -2575,6 +2971,11 @@ l1:
 
 		PageSetLSN(page, recptr);
 		PageSetTLI(page, ThisTimeLineID);
+
+		/* TOAST chunks are only needed by the decoder as they're inserted */
+		if (RelationIsLogicallyLogged(relation) &&
+			relation->rd_rel->relkind != RELKIND_TOASTVALUE)
+			log_heap_logical(relation, XLH_LOGICAL_DELETE, &tp, NULL);
 	}
 
 	END_CRIT_SECTION();
@@ -2590,7 +2991,8 @@ l1:
 	 * because we need to look at the contents of the tuple, but it's OK to
 	 * release the content lock on the buffer first.
 	 */
-	if (relation->rd_rel->relkind != RELKIND_RELATION)
+	if (relation->rd_rel->relkind != RELKIND_RELATION &&
+		relation->rd_rel->relkind != RELKIND_MATVIEW)
 	{
 		/* toast table entries should never be recursively toasted */
 		Assert(!HeapTupleHasExternal(&tp));
@@ -2695,6 +3097,44 @@ HTSU_Result
 heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 			ItemPointer ctid, TransactionId *update_xmax,
 			CommandId cid, Snapshot crosscheck, bool wait)
+{
+	return heap_update_internal(relation, otid, newtup, ctid, update_xmax,
+								cid, crosscheck, wait, false, NULL);
+}
+
+/*
+ *	heap_move_tuple - replace a tuple with a copy on another page
+ *
+ * This is heap_update for VACUUM (COMPACT), which moves rows towards the
+ * start of the table.  The new tuple version only ever goes on a page below
+ * the old one's, preferably the relation's current target block, and the
+ * relation is never extended for it.  If no page below has room, the old
+ * tuple is left alone, *noroom is set and HeapTupleMayBeUpdated returned.
+ * newtup must be an unchanged copy of the old tuple, so it needs no
+ * toasting.  We never wait for a conflicting transaction, but return
+ * HeapTupleBeingUpdated instead.  Otherwise this works exactly like
+ * heap_update.
+ */
+HTSU_Result
+heap_move_tuple(Relation relation, ItemPointer otid, HeapTuple newtup,
+				ItemPointer ctid, TransactionId *update_xmax,
+				CommandId cid, bool *noroom)
+{
+	*noroom = false;
+	return heap_update_internal(relation, otid, newtup, ctid, update_xmax,
+								cid, InvalidSnapshot, false, true, noroom);
+}
+
+/*
+ * Workhorse for heap_update and heap_move_tuple.  If move is true, the new
+ * tuple version always goes on a lower page than the old one, and *noroom
+ * is set if no such page has room for it.
+ */
+static HTSU_Result
+heap_update_internal(Relation relation, ItemPointer otid, HeapTuple newtup,
+					 ItemPointer ctid, TransactionId *update_xmax,
+					 CommandId cid, Snapshot crosscheck, bool wait,
+					 bool move, bool *noroom)
 {
 	HTSU_Result result;
 	TransactionId xid = GetCurrentTransactionId();
@@ -2947,7 +3387,8 @@ l2:
 	 * We need to invoke the toaster if there are already any out-of-line
 	 * toasted values present, or if the new tuple is over-threshold.
 	 */
-	if (relation->rd_rel->relkind != RELKIND_RELATION)
+	if (relation->rd_rel->relkind != RELKIND_RELATION &&
+		relation->rd_rel->relkind != RELKIND_MATVIEW)
 	{
 		/* toast table entries should never be recursively toasted */
 		Assert(!HeapTupleHasExternal(&oldtup));
@@ -2963,7 +3404,59 @@ l2:
 
 	newtupsize = MAXALIGN(newtup->t_len);
 
-	if (need_toast || newtupsize > pagefree)
+	if (move)
+	{
+		TransactionId oldxmax = HeapTupleHeaderGetXmax(oldtup.t_data);
+		uint16		oldinfomask = oldtup.t_data->t_infomask;
+
+		/*
+		 * The new version is an exact copy of the old one, so it needs no
+		 * toasting, but it must go on a lower page, whose lock we have to
+		 * take first.  Unlike the case below, we don't mark the old tuple
+		 * before letting go of its page: if there turns out to be no room
+		 * below, it must be left exactly as it was.  So instead, check
+		 * afterwards that nobody else locked or updated it meanwhile.
+		 */
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		heaptup = newtup;
+		already_marked = false;
+		newbuf = RelationGetBufferForTuple(relation, heaptup->t_len,
+										   buffer, HEAP_INSERT_LOWER_ONLY,
+										   NULL, &vmbuffer_new, &vmbuffer);
+		if (newbuf == InvalidBuffer)
+		{
+			ReleaseBuffer(buffer);
+			if (have_tuple_lock)
+				UnlockTuple(relation, &(oldtup.t_self), ExclusiveLock);
+			if (vmbuffer != InvalidBuffer)
+				ReleaseBuffer(vmbuffer);
+			if (vmbuffer_new != InvalidBuffer)
+				ReleaseBuffer(vmbuffer_new);
+			bms_free(hot_attrs);
+			*noroom = true;
+			return HeapTupleMayBeUpdated;
+		}
+
+		if (!TransactionIdEquals(HeapTupleHeaderGetXmax(oldtup.t_data),
+								 oldxmax) ||
+			((oldtup.t_data->t_infomask ^ oldinfomask) &
+			 (HEAP_XMAX_IS_MULTI | HEAP_IS_LOCKED)) != 0)
+		{
+			*ctid = oldtup.t_data->t_ctid;
+			*update_xmax = HeapTupleHeaderGetXmax(oldtup.t_data);
+			UnlockReleaseBuffer(newbuf);
+			UnlockReleaseBuffer(buffer);
+			if (have_tuple_lock)
+				UnlockTuple(relation, &(oldtup.t_self), ExclusiveLock);
+			if (vmbuffer != InvalidBuffer)
+				ReleaseBuffer(vmbuffer);
+			if (vmbuffer_new != InvalidBuffer)
+				ReleaseBuffer(vmbuffer_new);
+			bms_free(hot_attrs);
+			return HeapTupleBeingUpdated;
+		}
+	}
+	else if (need_toast || newtupsize > pagefree)
 	{
 		/* Clear obsolete visibility flags ... */
 		oldtup.t_data->t_infomask &= ~(HEAP_XMAX_COMMITTED |
@@ -3143,14 +3636,14 @@ l2:
 		all_visible_cleared = true;
 		PageClearAllVisible(BufferGetPage(buffer));
 		visibilitymap_clear(relation, BufferGetBlockNumber(buffer),
-							vmbuffer);
+							vmbuffer, VISIBILITYMAP_VALID_BITS);
 	}
 	if (newbuf != buffer && PageIsAllVisible(BufferGetPage(newbuf)))
 	{
 		all_visible_cleared_new = true;
 		PageClearAllVisible(BufferGetPage(newbuf));
 		visibilitymap_clear(relation, BufferGetBlockNumber(newbuf),
-							vmbuffer_new);
+							vmbuffer_new, VISIBILITYMAP_VALID_BITS);
 	}
 
 	if (newbuf != buffer)
@@ -3172,6 +3665,9 @@ l2:
 		}
 		PageSetLSN(BufferGetPage(buffer), recptr);
 		PageSetTLI(BufferGetPage(buffer), ThisTimeLineID);
+
+		if (RelationIsLogicallyLogged(relation))
+			log_heap_logical(relation, XLH_LOGICAL_UPDATE, &oldtup, heaptup);
 	}
 
 	END_CRIT_SECTION();
@@ -3449,13 +3945,25 @@ heap_lock_tuple(Relation relation, HeapTuple tuple, Buffer *buffer,
 	uint16		new_infomask;
 	LOCKMODE	tuple_lock_type;
 	bool		have_tuple_lock = false;
+	BlockNumber block;
+	Buffer		vmbuffer = InvalidBuffer;
+	bool		all_frozen_cleared = false;
 
 	tuple_lock_type = (mode == LockTupleShared) ? ShareLock : ExclusiveLock;
 
-	*buffer = ReadBuffer(relation, ItemPointerGetBlockNumber(tid));
-	LockBuffer(*buffer, BUFFER_LOCK_EXCLUSIVE);
-
+	block = ItemPointerGetBlockNumber(tid);
+	*buffer = ReadBuffer(relation, block);
 	page = BufferGetPage(*buffer);
+
+	/*
+	 * Locking a tuple stores our xid in its xmax, so the page can no longer
+	 * be considered all-frozen.  Pin the visibility map page before locking
+	 * the buffer if it looks like we'll need it, as in heap_delete.
+	 */
+	if (PageIsAllVisible(page))
+		visibilitymap_pin(relation, block, &vmbuffer);
+
+	LockBuffer(*buffer, BUFFER_LOCK_EXCLUSIVE);
 	lp = PageGetItemId(page, ItemPointerGetOffsetNumber(tid));
 	Assert(ItemIdIsNormal(lp));
 
@@ -3498,6 +4006,8 @@ l3:
 			/* Probably can't hold tuple lock here, but may as well check */
 			if (have_tuple_lock)
 				UnlockTuple(relation, tid, tuple_lock_type);
+			if (vmbuffer != InvalidBuffer)
+				ReleaseBuffer(vmbuffer);
 			return HeapTupleMayBeUpdated;
 		}
 
@@ -3627,9 +4137,25 @@ l3:
 		LockBuffer(*buffer, BUFFER_LOCK_UNLOCK);
 		if (have_tuple_lock)
 			UnlockTuple(relation, tid, tuple_lock_type);
+		if (vmbuffer != InvalidBuffer)
+			ReleaseBuffer(vmbuffer);
 		return result;
 	}
 
+	/*
+	 * If we didn't pin the visibility map page and the page has become all
+	 * visible while we were busy locking the buffer or waiting for another
+	 * locker, unlock, pin it, and start over.  From here on we keep the
+	 * buffer lock until the tuple is marked.
+	 */
+	if (vmbuffer == InvalidBuffer && PageIsAllVisible(page))
+	{
+		LockBuffer(*buffer, BUFFER_LOCK_UNLOCK);
+		visibilitymap_pin(relation, block, &vmbuffer);
+		LockBuffer(*buffer, BUFFER_LOCK_EXCLUSIVE);
+		goto l3;
+	}
+
 	/*
 	 * We might already hold the desired lock (or stronger), possibly under a
 	 * different subtransaction of the current top transaction.  If so, there
@@ -3656,6 +4182,8 @@ l3:
 		/* Probably can't hold tuple lock here, but may as well check */
 		if (have_tuple_lock)
 			UnlockTuple(relation, tid, tuple_lock_type);
+		if (vmbuffer != InvalidBuffer)
+			ReleaseBuffer(vmbuffer);
 		return HeapTupleMayBeUpdated;
 	}
 
@@ -3707,10 +4235,18 @@ l3:
 			{
 				/*
 				 * If the XMAX is already a MultiXactId, then we need to
-				 * expand it to include our own TransactionId.
+				 * expand it to include our own TransactionId -- unless all
+				 * its members have finished meanwhile, in which case we are
+				 * the only locker.
 				 */
-				xid = MultiXactIdExpand((MultiXactId) xmax, xid);
-				new_infomask |= HEAP_XMAX_IS_MULTI;
+				MultiXactId newmulti;
+
+				newmulti = MultiXactIdExpand((MultiXactId) xmax, xid);
+				if (MultiXactIdIsValid(newmulti))
+				{
+					xid = (TransactionId) newmulti;
+					new_infomask |= HEAP_XMAX_IS_MULTI;
+				}
 			}
 			else if (TransactionIdIsInProgress(xmax))
 			{
@@ -3760,6 +4296,13 @@ l3:
 	/* Make sure there is no forward chain link in t_ctid */
 	tuple->t_data->t_ctid = *tid;
 
+	if (PageIsAllVisible(page))
+	{
+		all_frozen_cleared = true;
+		visibilitymap_clear(relation, block, vmbuffer,
+							VISIBILITYMAP_ALL_FROZEN);
+	}
+
 	MarkBufferDirty(*buffer);
 
 	/*
@@ -3785,6 +4328,7 @@ l3:
 		xlrec.locking_xid = xid;
 		xlrec.xid_is_mxact = ((new_infomask & HEAP_XMAX_IS_MULTI) != 0);
 		xlrec.shared_lock = (mode == LockTupleShared);
+		xlrec.all_frozen_cleared = all_frozen_cleared;
 		rdata[0].data = (char *) &xlrec;
 		rdata[0].len = SizeOfHeapLock;
 		rdata[0].buffer = InvalidBuffer;
@@ -3807,9 +4351,11 @@ l3:
 	LockBuffer(*buffer, BUFFER_LOCK_UNLOCK);
 
 	/*
-	 * Don't update the visibility map here. Locking a tuple doesn't change
-	 * visibility info.
+	 * The all-visible bit is left alone, since locking a tuple doesn't
+	 * change visibility info; only the all-frozen bit was cleared above.
 	 */
+	if (vmbuffer != InvalidBuffer)
+		ReleaseBuffer(vmbuffer);
 
 	/*
 	 * Now that we have successfully marked the tuple as locked, we can
@@ -4124,6 +4670,35 @@ heap_tuple_needs_freeze(HeapTupleHeader tuple, TransactionId cutoff_xid,
 	return false;
 }
 
+/*
+ * heap_tuple_is_frozen
+ *
+ * Check whether none of a tuple's XID fields holds a normal XID that might
+ * still have to be looked up in clog, so that the tuple never needs freezing
+ * again and does not hold back relfrozenxid.  A page whose tuples are all visible to everyone and pass
+ * this test can be marked all-frozen in the visibility map.
+ */
+bool
+heap_tuple_is_frozen(HeapTupleHeader tuple)
+{
+	if (TransactionIdIsNormal(HeapTupleHeaderGetXmin(tuple)))
+		return false;
+
+	if (!(tuple->t_infomask & HEAP_XMAX_INVALID))
+	{
+		if (tuple->t_infomask & HEAP_XMAX_IS_MULTI)
+			return false;
+		if (TransactionIdIsNormal(HeapTupleHeaderGetXmax(tuple)))
+			return false;
+	}
+
+	if ((tuple->t_infomask & HEAP_MOVED) &&
+		TransactionIdIsNormal(HeapTupleHeaderGetXvac(tuple)))
+		return false;
+
+	return true;
+}
+
 /* ----------------
  *		heap_markpos	- mark scan position
  * ----------------
@@ -4401,7 +4976,8 @@ log_heap_freeze(Relation reln, Buffer buffer,
  * and dirtied.
  */
 XLogRecPtr
-log_heap_visible(RelFileNode rnode, BlockNumber block, Buffer vm_buffer)
+log_heap_visible(RelFileNode rnode, BlockNumber block, Buffer vm_buffer,
+				 uint8 vmflags)
 {
 	xl_heap_visible xlrec;
 	XLogRecPtr	recptr;
@@ -4409,6 +4985,7 @@ log_heap_visible(RelFileNode rnode, BlockNumber block, Buffer vm_buffer)
 
 	xlrec.node = rnode;
 	xlrec.block = block;
+	xlrec.flags = vmflags;
 
 	rdata[0].data = (char *) &xlrec;
 	rdata[0].len = SizeOfHeapVisible;
@@ -4501,6 +5078,73 @@ log_heap_update(Relation reln, Buffer oldbuf, ItemPointerData from,
 	return recptr;
 }
 
+/*
+ * Perform XLogInsert of an XLOG_HEAP2_LOGICAL record that describes a row
+ * change for logical decoding.  This goes right after the regular record for
+ * the same change, inside the same critical section.  Either tuple may be
+ * NULL, depending on the action.
+ *
+ * The tuples are logged whole, regardless of any full-page image taken for
+ * the regular record, since the decoder never looks at data pages.
+ */
+static void
+log_heap_logical(Relation relation, char action,
+				 HeapTuple oldtup, HeapTuple newtup)
+{
+	xl_heap_logical xlrec;
+	xl_heap_logical_tuple oldhdr;
+	xl_heap_logical_tuple newhdr;
+	XLogRecData rdata[5];
+	int			nrdata = 0;
+	int			i;
+
+	xlrec.dbNode = relation->rd_node.dbNode;
+	xlrec.relid = RelationGetRelid(relation);
+	xlrec.action = action;
+	xlrec.flags = 0;
+	rdata[nrdata].data = (char *) &xlrec;
+	rdata[nrdata].len = SizeOfHeapLogical;
+	nrdata++;
+
+	if (oldtup != NULL)
+	{
+		xlrec.flags |= XLH_LOGICAL_HAS_OLD;
+		oldhdr.datalen = oldtup->t_len - offsetof(HeapTupleHeaderData, t_bits);
+		oldhdr.t_infomask2 = oldtup->t_data->t_infomask2;
+		oldhdr.t_infomask = oldtup->t_data->t_infomask;
+		oldhdr.t_hoff = oldtup->t_data->t_hoff;
+		rdata[nrdata].data = (char *) &oldhdr;
+		rdata[nrdata].len = SizeOfHeapLogicalTuple;
+		nrdata++;
+		rdata[nrdata].data = (char *) oldtup->t_data + offsetof(HeapTupleHeaderData, t_bits);
+		rdata[nrdata].len = oldhdr.datalen;
+		nrdata++;
+	}
+
+	if (newtup != NULL)
+	{
+		xlrec.flags |= XLH_LOGICAL_HAS_NEW;
+		newhdr.datalen = newtup->t_len - offsetof(HeapTupleHeaderData, t_bits);
+		newhdr.t_infomask2 = newtup->t_data->t_infomask2;
+		newhdr.t_infomask = newtup->t_data->t_infomask;
+		newhdr.t_hoff = newtup->t_data->t_hoff;
+		rdata[nrdata].data = (char *) &newhdr;
+		rdata[nrdata].len = SizeOfHeapLogicalTuple;
+		nrdata++;
+		rdata[nrdata].data = (char *) newtup->t_data + offsetof(HeapTupleHeaderData, t_bits);
+		rdata[nrdata].len = newhdr.datalen;
+		nrdata++;
+	}
+
+	for (i = 0; i < nrdata; i++)
+	{
+		rdata[i].buffer = InvalidBuffer;
+		rdata[i].next = (i + 1 < nrdata) ? &(rdata[i + 1]) : NULL;
+	}
+
+	(void) XLogInsert(RM_HEAP2_ID, XLOG_HEAP2_LOGICAL, rdata);
+}
+
 /*
  * Perform XLogInsert of a HEAP_NEWPAGE record to WAL. Caller is responsible
  * for writing the page to disk after calling this routine.
@@ -4633,7 +5277,8 @@ heap_xlog_clean(XLogRecPtr lsn, XLogRecord *record)
 	heap_page_prune_execute(buffer,
 							redirected, nredirected,
 							nowdead, ndead,
-							nowunused, nunused);
+							nowunused, nunused,
+							true);
 
 	freespace = PageGetHeapFreeSpace(page);		/* needed to update FSM below */
 
@@ -4793,7 +5438,8 @@ heap_xlog_visible(XLogRecPtr lsn, XLogRecord *record)
 		 * harm is done; and the next VACUUM will fix it.
 		 */
 		if (!XLByteLE(lsn, PageGetLSN(BufferGetPage(vmbuffer))))
-			visibilitymap_set(reln, xlrec->block, lsn, vmbuffer);
+			visibilitymap_set(reln, xlrec->block, lsn, vmbuffer,
+							  xlrec->flags);
 
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
@@ -4857,7 +5503,7 @@ heap_xlog_delete(XLogRecPtr lsn, XLogRecord *record)
 		Buffer		vmbuffer = InvalidBuffer;
 
 		visibilitymap_pin(reln, blkno, &vmbuffer);
-		visibilitymap_clear(reln, blkno, vmbuffer);
+		visibilitymap_clear(reln, blkno, vmbuffer, VISIBILITYMAP_VALID_BITS);
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
 	}
@@ -4938,7 +5584,7 @@ heap_xlog_insert(XLogRecPtr lsn, XLogRecord *record)
 		Buffer		vmbuffer = InvalidBuffer;
 
 		visibilitymap_pin(reln, blkno, &vmbuffer);
-		visibilitymap_clear(reln, blkno, vmbuffer);
+		visibilitymap_clear(reln, blkno, vmbuffer, VISIBILITYMAP_VALID_BITS);
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
 	}
@@ -5071,7 +5717,7 @@ heap_xlog_multi_insert(XLogRecPtr lsn, XLogRecord *record)
 		Buffer		vmbuffer = InvalidBuffer;
 
 		visibilitymap_pin(reln, blkno, &vmbuffer);
-		visibilitymap_clear(reln, blkno, vmbuffer);
+		visibilitymap_clear(reln, blkno, vmbuffer, VISIBILITYMAP_VALID_BITS);
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
 	}
@@ -5199,7 +5845,7 @@ heap_xlog_update(XLogRecPtr lsn, XLogRecord *record, bool hot_update)
 		Buffer		vmbuffer = InvalidBuffer;
 
 		visibilitymap_pin(reln, block, &vmbuffer);
-		visibilitymap_clear(reln, block, vmbuffer);
+		visibilitymap_clear(reln, block, vmbuffer, VISIBILITYMAP_VALID_BITS);
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
 	}
@@ -5283,7 +5929,7 @@ newt:;
 		Buffer		vmbuffer = InvalidBuffer;
 
 		visibilitymap_pin(reln, block, &vmbuffer);
-		visibilitymap_clear(reln, block, vmbuffer);
+		visibilitymap_clear(reln, block, vmbuffer, VISIBILITYMAP_VALID_BITS);
 		ReleaseBuffer(vmbuffer);
 		FreeFakeRelcacheEntry(reln);
 	}
@@ -5389,13 +6035,29 @@ heap_xlog_lock(XLogRecPtr lsn, XLogRecord *record)
 	OffsetNumber offnum;
 	ItemId		lp = NULL;
 	HeapTupleHeader htup;
+	BlockNumber blkno;
+
+	blkno = ItemPointerGetBlockNumber(&(xlrec->target.tid));
+
+	/*
+	 * The visibility map may need to be fixed even if the heap page is
+	 * already up-to-date.
+	 */
+	if (xlrec->all_frozen_cleared)
+	{
+		Relation	reln = CreateFakeRelcacheEntry(xlrec->target.node);
+		Buffer		vmbuffer = InvalidBuffer;
+
+		visibilitymap_pin(reln, blkno, &vmbuffer);
+		visibilitymap_clear(reln, blkno, vmbuffer, VISIBILITYMAP_ALL_FROZEN);
+		ReleaseBuffer(vmbuffer);
+		FreeFakeRelcacheEntry(reln);
+	}
 
 	if (record->xl_info & XLR_BKP_BLOCK_1)
 		return;
 
-	buffer = XLogReadBuffer(xlrec->target.node,
-							ItemPointerGetBlockNumber(&(xlrec->target.tid)),
-							false);
+	buffer = XLogReadBuffer(xlrec->target.node, blkno, false);
 	if (!BufferIsValid(buffer))
 		return;
 	page = (Page) BufferGetPage(buffer);
@@ -5556,11 +6218,88 @@ heap2_redo(XLogRecPtr lsn, XLogRecord *record)
 		case XLOG_HEAP2_MULTI_INSERT:
 			heap_xlog_multi_insert(lsn, record);
 			break;
+		case XLOG_HEAP2_LOGICAL:
+			/* only of interest to logical decoding */
+			break;
 		default:
 			elog(PANIC, "heap2_redo: unknown op code %u", info);
 	}
 }
 
+/*
+ * Prefetch the heap pages that replay of a heap record will read
+ */
+void
+heap_prefetch(XLogRecord *record, char *data, uint32 len)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	uint8		op = info & XLOG_HEAP_OPMASK;
+	bool		init = (info & XLOG_HEAP_INIT_PAGE) != 0;
+	xl_heaptid	target;
+
+	/* all but NEWPAGE start with the target tuple */
+	if (op == XLOG_HEAP_NEWPAGE || len < SizeOfHeapTid)
+		return;
+	memcpy(&target, data, SizeOfHeapTid);
+
+	if (op == XLOG_HEAP_UPDATE || op == XLOG_HEAP_HOT_UPDATE)
+	{
+		ItemPointerData newtid;
+
+		if (!(record->xl_info & XLR_BKP_BLOCK_1))
+			XLogPrefetchBlock(target.node, MAIN_FORKNUM,
+							  ItemPointerGetBlockNumber(&target.tid));
+
+		if (len < offsetof(xl_heap_update, newtid) + SizeOfIptrData)
+			return;
+		memcpy(&newtid, data + offsetof(xl_heap_update, newtid),
+			   SizeOfIptrData);
+		if (!(record->xl_info & XLR_BKP_BLOCK_2) && !init)
+			XLogPrefetchBlock(target.node, MAIN_FORKNUM,
+							  ItemPointerGetBlockNumber(&newtid));
+	}
+	else if (!(record->xl_info & XLR_BKP_BLOCK_1) &&
+			 !(op == XLOG_HEAP_INSERT && init))
+		XLogPrefetchBlock(target.node, MAIN_FORKNUM,
+						  ItemPointerGetBlockNumber(&target.tid));
+}
+
+/*
+ * Prefetch the heap page that replay of a heap2 record will read
+ */
+void
+heap2_prefetch(XLogRecord *record, char *data, uint32 len)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+	RelFileNode node;
+	BlockNumber blkno;
+
+	switch (info & XLOG_HEAP_OPMASK)
+	{
+		case XLOG_HEAP2_FREEZE:
+		case XLOG_HEAP2_CLEAN:
+			if (record->xl_info & XLR_BKP_BLOCK_1)
+				return;
+			break;
+		case XLOG_HEAP2_MULTI_INSERT:
+			if ((record->xl_info & XLR_BKP_BLOCK_1) ||
+				(info & XLOG_HEAP_INIT_PAGE))
+				return;
+			break;
+		case XLOG_HEAP2_VISIBLE:
+			break;
+		default:
+			return;
+	}
+
+	/* these all start with the RelFileNode and block number */
+	if (len < sizeof(RelFileNode) + sizeof(BlockNumber))
+		return;
+	memcpy(&node, data, sizeof(RelFileNode));
+	memcpy(&blkno, data + sizeof(RelFileNode), sizeof(BlockNumber));
+	XLogPrefetchBlock(node, MAIN_FORKNUM, blkno);
+}
+
 static void
 out_target(StringInfo buf, xl_heaptid *target)
 {
@@ -5689,9 +6428,9 @@ heap2_desc(StringInfo buf, uint8 xl_info, char *rec)
 	{
 		xl_heap_visible *xlrec = (xl_heap_visible *) rec;
 
-		appendStringInfo(buf, "visible: rel %u/%u/%u; blk %u",
+		appendStringInfo(buf, "visible: rel %u/%u/%u; blk %u; flags 0x%02X",
 						 xlrec->node.spcNode, xlrec->node.dbNode,
-						 xlrec->node.relNode, xlrec->block);
+						 xlrec->node.relNode, xlrec->block, xlrec->flags);
 	}
 	else if (info == XLOG_HEAP2_MULTI_INSERT)
 	{
@@ -5705,6 +6444,13 @@ heap2_desc(StringInfo buf, uint8 xl_info, char *rec)
 						 xlrec->node.spcNode, xlrec->node.dbNode, xlrec->node.relNode,
 						 xlrec->blkno, xlrec->ntuples);
 	}
+	else if (info == XLOG_HEAP2_LOGICAL)
+	{
+		xl_heap_logical *xlrec = (xl_heap_logical *) rec;
+
+		appendStringInfo(buf, "logical %c: db %u; rel %u",
+						 xlrec->action, xlrec->dbNode, xlrec->relid);
+	}
 	else
 		appendStringInfo(buf, "UNKNOWN");
 }
@@ -0,0 +1,207 @@
+/*-------------------------------------------------------------------------
+ *
+ * heapam_handler.c
+ *	  heap table access method code
+ *
+ * The heap is the table access method of every table unless an extension
+ * chooses another one.  The routines here just adapt heapam.c's interface
+ * to the TableAmRoutine one, which passes tuples in slots.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/heap/heapam_handler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/relscan.h"
+#include "access/tableam.h"
+#include "commands/vacuum.h"
+#include "storage/bufmgr.h"
+
+
+/* A heap scan, as seen through the table access method interface */
+typedef struct HeapamScanDescData
+{
+	TableScanDescData base;		/* must be first */
+	HeapScanDesc heapscan;		/* the underlying heap scan */
+} HeapamScanDescData;
+
+typedef HeapamScanDescData *HeapamScanDesc;
+
+
+static TableScanDesc heapam_beginscan(Relation rel, Snapshot snapshot,
+				 int nkeys, ScanKey key);
+static bool heapam_getnextslot(TableScanDesc scan, ScanDirection direction,
+				   TupleTableSlot *slot);
+static void heapam_rescan(TableScanDesc scan, ScanKey key);
+static void heapam_endscan(TableScanDesc scan);
+static void heapam_markpos(TableScanDesc scan);
+static void heapam_restrpos(TableScanDesc scan);
+static bool heapam_fetch(Relation rel, ItemPointer tid, Snapshot snapshot,
+			 TupleTableSlot *slot);
+static Oid heapam_insert(Relation rel, TupleTableSlot *slot, CommandId cid,
+			  int options, BulkInsertState bistate);
+static HTSU_Result heapam_update(Relation rel, ItemPointer otid,
+			  TupleTableSlot *slot,
+			  ItemPointer ctid, TransactionId *update_xmax,
+			  CommandId cid, Snapshot crosscheck, bool wait,
+			  bool *update_indexes);
+static void heapam_finish_bulk_insert(Relation rel, int options);
+
+/*
+ * The heap's callbacks.  ANALYZE and the planner's size estimates know
+ * about heaps already, so those are left NULL.
+ */
+static const TableAmRoutine heapam_methods = {
+	T_TableAmRoutine,
+
+	heapam_beginscan,
+	heapam_getnextslot,
+	heapam_rescan,
+	heapam_endscan,
+	heapam_markpos,
+	heapam_restrpos,
+
+	heapam_fetch,
+
+	heapam_insert,
+	heap_multi_insert,
+	heap_delete,
+	heapam_update,
+	heapam_finish_bulk_insert,
+
+	lazy_vacuum_rel,
+	NULL,
+	NULL
+};
+
+
+/*
+ * GetHeapamTableAmRoutine - return the heap's TableAmRoutine
+ */
+const TableAmRoutine *
+GetHeapamTableAmRoutine(void)
+{
+	return &heapam_methods;
+}
+
+static TableScanDesc
+heapam_beginscan(Relation rel, Snapshot snapshot, int nkeys, ScanKey key)
+{
+	HeapamScanDesc scan = (HeapamScanDesc) palloc(sizeof(HeapamScanDescData));
+
+	scan->base.rs_rd = rel;
+	scan->base.rs_tableam = &heapam_methods;
+	scan->heapscan = heap_beginscan(rel, snapshot, nkeys, key);
+
+	return (TableScanDesc) scan;
+}
+
+static bool
+heapam_getnextslot(TableScanDesc scan, ScanDirection direction,
+				   TupleTableSlot *slot)
+{
+	HeapScanDesc heapscan = ((HeapamScanDesc) scan)->heapscan;
+	HeapTuple	tuple;
+
+	tuple = heap_getnext(heapscan, direction);
+	if (tuple == NULL)
+	{
+		ExecClearTuple(slot);
+		return false;
+	}
+
+	/*
+	 * The tuple points into the scan's current buffer; the slot keeps a pin
+	 * on it for as long as it holds the tuple.
+	 */
+	ExecStoreTuple(tuple, slot, heapscan->rs_cbuf, false);
+	return true;
+}
+
+static void
+heapam_rescan(TableScanDesc scan, ScanKey key)
+{
+	heap_rescan(((HeapamScanDesc) scan)->heapscan, key);
+}
+
+static void
+heapam_endscan(TableScanDesc scan)
+{
+	heap_endscan(((HeapamScanDesc) scan)->heapscan);
+	pfree(scan);
+}
+
+static void
+heapam_markpos(TableScanDesc scan)
+{
+	heap_markpos(((HeapamScanDesc) scan)->heapscan);
+}
+
+static void
+heapam_restrpos(TableScanDesc scan)
+{
+	heap_restrpos(((HeapamScanDesc) scan)->heapscan);
+}
+
+static bool
+heapam_fetch(Relation rel, ItemPointer tid, Snapshot snapshot,
+			 TupleTableSlot *slot)
+{
+	HeapTupleData tuple;
+	Buffer		buffer;
+
+	tuple.t_self = *tid;
+	if (!heap_fetch(rel, snapshot, &tuple, &buffer, false, NULL))
+	{
+		ExecClearTuple(slot);
+		return false;
+	}
+
+	/* tuple only lives on our stack, so the slot gets a copy */
+	ExecStoreTuple(heap_copytuple(&tuple), slot, InvalidBuffer, true);
+	ReleaseBuffer(buffer);
+	return true;
+}
+
+static Oid
+heapam_insert(Relation rel, TupleTableSlot *slot, CommandId cid,
+			  int options, BulkInsertState bistate)
+{
+	/*
+	 * heap_insert stamps the tuple's header and t_self in place, so the
+	 * caller sees the new row's TID in the slot's own tuple.  Callers only
+	 * pass slots whose tuple they own.
+	 */
+	return heap_insert(rel, ExecFetchSlotTuple(slot), cid, options, bistate);
+}
+
+static HTSU_Result
+heapam_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
+			  ItemPointer ctid, TransactionId *update_xmax,
+			  CommandId cid, Snapshot crosscheck, bool wait,
+			  bool *update_indexes)
+{
+	HeapTuple	tuple = ExecFetchSlotTuple(slot);
+	HTSU_Result result;
+
+	result = heap_update(rel, otid, tuple, ctid, update_xmax,
+						 cid, crosscheck, wait);
+
+	/* a HOT update doesn't need new index entries */
+	*update_indexes = (result == HeapTupleMayBeUpdated &&
+					   !HeapTupleIsHeapOnly(tuple));
+	return result;
+}
+
+static void
+heapam_finish_bulk_insert(Relation rel, int options)
+{
+	/* If we skipped writing WAL, the heap must be synced to disk now */
+	if (options & HEAP_INSERT_SKIP_WAL)
+		heap_sync(rel);
+}
@@ -17,11 +17,13 @@
 
 #include "access/heapam.h"
 #include "access/hio.h"
+#include "access/transam.h"
 #include "access/visibilitymap.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
 #include "storage/smgr.h"
+#include "utils/snapmgr.h"
 
 
 /*
@@ -154,6 +156,77 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 	}
 }
 
+/*
+ * Extend a relation by multiple blocks to avoid future contention on the
+ * relation extension lock.  Our goal is to pre-extend the relation by an
+ * amount which ramps up as the degree of contention ramps up, but limiting
+ * the result to some sane overall value.
+ *
+ * Caller must hold the relation extension lock.
+ */
+static void
+RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+{
+	Page		page;
+	BlockNumber blockNum = InvalidBlockNumber,
+				firstBlock = InvalidBlockNumber;
+	int			extraBlocks = 0;
+	int			lockWaiters = 0;
+	Size		freespace = 0;
+	Buffer		buffer;
+
+	/* Use the length of the lock wait queue to judge how much to extend. */
+	lockWaiters = RelationExtensionLockWaiterCount(relation);
+	if (lockWaiters <= 0)
+		return;
+
+	/*
+	 * It might seem like multiplying the number of lock waiters by as much
+	 * as 20 is too aggressive, but benchmarking revealed that smaller numbers
+	 * were insufficient.  512 is just an arbitrary cap to prevent
+	 * pathological results.
+	 */
+	extraBlocks = Min(512, lockWaiters * 20);
+
+	while (extraBlocks-- >= 0)
+	{
+		/* Ouch - an unnecessary lseek() each time through the loop! */
+		buffer = ReadBufferBI(relation, P_NEW, bistate);
+
+		/* Extend by one page. */
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+		PageInit(page, BufferGetPageSize(buffer), 0);
+		MarkBufferDirty(buffer);
+		blockNum = BufferGetBlockNumber(buffer);
+		freespace = PageGetHeapFreeSpace(page);
+		UnlockReleaseBuffer(buffer);
+
+		/* Remember first block number thus added. */
+		if (firstBlock == InvalidBlockNumber)
+			firstBlock = blockNum;
+
+		/*
+		 * Immediately update the bottom level of the FSM.  This has a good
+		 * chance of making this page visible to other concurrently inserting
+		 * backends, and we want that to happen without delay.
+		 */
+		RecordPageWithFreeSpace(relation, blockNum, freespace);
+	}
+
+	/*
+	 * Updating the upper levels of the free space map is too expensive to do
+	 * for every block, but it's worth doing once at the end to make sure that
+	 * subsequent insertion activity sees all of those nifty free pages we
+	 * just inserted.
+	 *
+	 * Note that we're using the freespace value that was reported for the
+	 * last block we added as if it were the freespace value for every block
+	 * we added.  That's actually true, because they're all equally empty.
+	 */
+	UpdateFreeSpaceMap(relation, firstBlock, blockNum, freespace);
+}
+
 /*
  * RelationGetBufferForTuple
  *
@@ -196,6 +269,11 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
  *	any committed data of other transactions.  (See heap_insert's comments
  *	for additional constraints needed for safe usage of this behavior.)
  *
+ *	HEAP_INSERT_LOWER_ONLY restricts the choice to pages below otherBuffer's
+ *	page, and never extends the relation; if no such page has room, we return
+ *	InvalidBuffer without holding any locks.  heap_move_tuple uses this to
+ *	move rows towards the start of the table.
+ *
  *	The caller can also provide a BulkInsertState object to optimize many
  *	insertions into the same relation.	This keeps a pin on the current
  *	insertion target page (to save pin/unpin cycles) and also passes a
@@ -217,18 +295,21 @@ RelationGetBufferForTuple(Relation relation, Size len,
 						  Buffer *vmbuffer, Buffer *vmbuffer_other)
 {
 	bool		use_fsm = !(options & HEAP_INSERT_SKIP_FSM);
+	bool		lower_only = (options & HEAP_INSERT_LOWER_ONLY) != 0;
 	Buffer		buffer = InvalidBuffer;
 	Page		page;
 	Size		pageFreeSpace,
 				saveFreeSpace;
 	BlockNumber targetBlock,
-				otherBlock;
+				otherBlock,
+				prunedBlock = InvalidBlockNumber;
 	bool		needLock;
 
 	len = MAXALIGN(len);		/* be conservative */
 
 	/* Bulk insert is not supported for updates, only inserts. */
 	Assert(otherBuffer == InvalidBuffer || !bistate);
+	Assert(otherBuffer != InvalidBuffer || !lower_only);
 
 	/*
 	 * If we're gonna fail for oversize tuple, do it right away
@@ -286,7 +367,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		 * give up and extend.	This avoids one-tuple-per-page syndrome during
 		 * bootstrapping or in a recently-started system.
 		 */
-		if (targetBlock == InvalidBlockNumber)
+		if (targetBlock == InvalidBlockNumber && !lower_only)
 		{
 			BlockNumber nblocks = RelationGetNumberOfBlocks(relation);
 
@@ -295,8 +376,13 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		}
 	}
 
+loop:
 	while (targetBlock != InvalidBlockNumber)
 	{
+		/* Pages at or above the other block won't do for a move */
+		if (lower_only && targetBlock >= otherBlock)
+			break;
+
 		/*
 		 * Read and exclusive-lock the target block, as well as the other
 		 * block if one was given, taking suitable care with lock ordering and
@@ -394,14 +480,33 @@ RelationGetBufferForTuple(Relation relation, Size len,
 		 * code above.
 		 */
 		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
-		if (otherBuffer == InvalidBuffer)
-			ReleaseBuffer(buffer);
-		else if (otherBlock != targetBlock)
-		{
+		if (otherBuffer != InvalidBuffer && otherBlock != targetBlock)
 			LockBuffer(otherBuffer, BUFFER_LOCK_UNLOCK);
-			ReleaseBuffer(buffer);
+
+		/*
+		 * Before giving up on the page, though, see whether pruning it would
+		 * make room; that's a lot cheaper than extending the relation, and
+		 * keeps update-heavy tables from growing between vacuums.  We try
+		 * that only once per page, and never on the caller's own page, since
+		 * the caller holds a pointer to the old tuple version on it.
+		 */
+		if (buffer != otherBuffer && targetBlock != prunedBlock &&
+			TransactionIdIsNormal(RecentGlobalXmin) &&
+			(PageIsPrunable(page, RecentGlobalXmin) || PageNeedsDefrag(page)))
+		{
+			prunedBlock = targetBlock;
+			if (heap_page_prune_nowait(relation, buffer, RecentGlobalXmin,
+									   len + saveFreeSpace))
+			{
+				/* Free space may have grown, so look at the page again */
+				ReleaseBuffer(buffer);
+				continue;
+			}
 		}
 
+		if (buffer != otherBuffer)
+			ReleaseBuffer(buffer);
+
 		/* Without FSM, always fall out of the loop and extend */
 		if (!use_fsm)
 			break;
@@ -416,6 +521,10 @@ RelationGetBufferForTuple(Relation relation, Size len,
 													len + saveFreeSpace);
 	}
 
+	/* A move that found no room below must not extend the relation */
+	if (lower_only)
+		return InvalidBuffer;
+
 	/*
 	 * Have to extend the relation.
 	 *
@@ -426,8 +535,41 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	 */
 	needLock = !RELATION_IS_LOCAL(relation);
 
+	/*
+	 * If we need the lock but are not able to acquire it immediately, we'll
+	 * consider extending the relation by multiple blocks at a time to manage
+	 * contention on the relation extension lock.  However, this only makes
+	 * sense if we're using the FSM; otherwise, there's no point.
+	 */
 	if (needLock)
-		LockRelationForExtension(relation, ExclusiveLock);
+	{
+		if (!use_fsm)
+			LockRelationForExtension(relation, ExclusiveLock);
+		else if (!ConditionalLockRelationForExtension(relation, ExclusiveLock))
+		{
+			/* Couldn't get the lock immediately; wait for it. */
+			LockRelationForExtension(relation, ExclusiveLock);
+
+			/*
+			 * Check if some other backend has extended a block for us while
+			 * we were waiting on the lock.
+			 */
+			targetBlock = GetPageWithFreeSpace(relation, len + saveFreeSpace);
+
+			/*
+			 * If some other waiter has already extended the relation, we
+			 * don't need to do so; just use the existing freespace.
+			 */
+			if (targetBlock != InvalidBlockNumber)
+			{
+				UnlockRelationForExtension(relation, ExclusiveLock);
+				goto loop;
+			}
+
+			/* Time to bulk-extend. */
+			RelationAddExtraBlocks(relation, bistate);
+		}
+	}
 
 	/*
 	 * XXX This does an lseek - rather expensive - but at the moment it is the
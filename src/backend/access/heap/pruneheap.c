@@ -57,7 +57,7 @@ static void heap_prune_record_unused(PruneState *prstate, OffsetNumber offnum);
  *
  * This is an opportunistic function.  It will perform housekeeping
  * only if the page heuristically looks like a candidate for pruning and we
- * can acquire buffer cleanup lock without blocking.
+ * can lock it without blocking; see heap_page_prune_nowait.
  *
  * Note: this is called quite often.  It's important that it fall out quickly
  * if there's not any use in pruning.
@@ -77,9 +77,9 @@ heap_page_prune_opt(Relation relation, Buffer buffer, TransactionId OldestXmin)
 	 * Let's see if we really need pruning.
 	 *
 	 * Forget it if page is not hinted to contain something prunable that's
-	 * older than OldestXmin.
+	 * older than OldestXmin, nor left fragmented by an earlier prune.
 	 */
-	if (!PageIsPrunable(page, OldestXmin))
+	if (!PageIsPrunable(page, OldestXmin) && !PageNeedsDefrag(page))
 		return;
 
 	/*
@@ -92,8 +92,9 @@ heap_page_prune_opt(Relation relation, Buffer buffer, TransactionId OldestXmin)
 
 	/*
 	 * We prune when a previous UPDATE failed to find enough space on the page
-	 * for a new tuple version, or when free space falls below the relation's
-	 * fill-factor target (but not less than 10%).
+	 * for a new tuple version, when free space falls below the relation's
+	 * fill-factor target (but not less than 10%), or when an earlier prune
+	 * couldn't defragment the page.
 	 *
 	 * Checking free space here is questionable since we aren't holding any
 	 * lock on the buffer; in the worst case we could get a bogus answer. It's
@@ -106,37 +107,78 @@ heap_page_prune_opt(Relation relation, Buffer buffer, TransactionId OldestXmin)
 											 HEAP_DEFAULT_FILLFACTOR);
 	minfree = Max(minfree, BLCKSZ / 10);
 
-	if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
-	{
-		/* OK, try to get exclusive buffer lock */
-		if (!ConditionalLockBufferForCleanup(buffer))
-			return;
+	if (PageIsFull(page) || PageNeedsDefrag(page) ||
+		PageGetHeapFreeSpace(page) < minfree)
+		(void) heap_page_prune_nowait(relation, buffer, OldestXmin, minfree);
+}
 
-		/*
-		 * Now that we have buffer lock, get accurate information about the
-		 * page's free space, and recheck the heuristic about whether to
-		 * prune. (We needn't recheck PageIsPrunable, since no one else could
-		 * have pruned while we hold pin.)
-		 */
-		if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
-		{
-			TransactionId ignore = InvalidTransactionId;		/* return value not
-																 * needed */
 
-			/* OK to prune */
-			(void) heap_page_prune(relation, buffer, OldestXmin, true, &ignore);
-		}
+/*
+ * Prune the specified page if it has less than minfree bytes of free space
+ * (or is hinted as full or fragmented), provided that can be done without
+ * blocking.
+ *
+ * If we can get a buffer cleanup lock, the page is pruned and defragmented.
+ * Otherwise, if the page holds something prunable and we can get a plain
+ * exclusive lock, dead tuples are pruned but their space is left where it
+ * is, since other backends may still be looking at tuples on the page; the
+ * page is then marked PD_NEEDS_DEFRAG, and whoever next gets a cleanup lock
+ * on it will repair the fragmentation.
+ *
+ * Returns true if the page was defragmented, so that its free space may
+ * have grown.
+ *
+ * Caller must have pin on the buffer, and must *not* have a lock on it.
+ */
+bool
+heap_page_prune_nowait(Relation relation, Buffer buffer,
+					   TransactionId OldestXmin, Size minfree)
+{
+	Page		page = BufferGetPage(buffer);
+	bool		defragment;
+
+	if (ConditionalLockBufferForCleanup(buffer))
+		defragment = true;
+	else if (PageIsPrunable(page, OldestXmin) && ConditionalLockBuffer(buffer))
+		defragment = false;
+	else
+		return false;
+
+	/*
+	 * Now that we have buffer lock, get accurate information about the
+	 * page's free space, and recheck the heuristic about whether to prune.
+	 * Without a cleanup lock, someone else may also have pruned the page
+	 * since we looked, so recheck PageIsPrunable too in that case.
+	 */
+	if ((PageIsFull(page) || PageNeedsDefrag(page) ||
+		 PageGetHeapFreeSpace(page) < minfree) &&
+		(defragment || PageIsPrunable(page, OldestXmin)))
+	{
+		TransactionId ignore = InvalidTransactionId;	/* return value not
+														 * needed */
 
-		/* And release buffer lock */
-		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		/* OK to prune */
+		(void) heap_page_prune(relation, buffer, OldestXmin, true, defragment,
+							   &ignore);
 	}
+	else
+		defragment = false;
+
+	/* And release buffer lock */
+	LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+	return defragment;
 }
 
 
 /*
- * Prune and repair fragmentation in the specified page.
+ * Prune and, if defragment is true, repair fragmentation in the specified
+ * page.
  *
- * Caller must have pin and buffer cleanup lock on the page.
+ * Caller must have pin and exclusive lock on the page.  Repairing
+ * fragmentation moves tuples around, so it requires a buffer cleanup lock;
+ * without one, pass defragment = false, and the page is left marked
+ * PD_NEEDS_DEFRAG instead.
  *
  * OldestXmin is the cutoff XID used to distinguish whether tuples are DEAD
  * or RECENTLY_DEAD (see HeapTupleSatisfiesVacuum).
@@ -151,7 +193,8 @@ heap_page_prune_opt(Relation relation, Buffer buffer, TransactionId OldestXmin)
  */
 int
 heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
-				bool report_stats, TransactionId *latestRemovedXid)
+				bool report_stats, bool defragment,
+				TransactionId *latestRemovedXid)
 {
 	int			ndeleted = 0;
 	Page		page = BufferGetPage(buffer);
@@ -201,17 +244,22 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 	/* Any error while applying the changes is critical */
 	START_CRIT_SECTION();
 
-	/* Have we found any prunable items? */
-	if (prstate.nredirected > 0 || prstate.ndead > 0 || prstate.nunused > 0)
+	/*
+	 * Have we found any prunable items, or left over fragmentation from an
+	 * earlier prune that we can repair now?
+	 */
+	if (prstate.nredirected > 0 || prstate.ndead > 0 || prstate.nunused > 0 ||
+		(defragment && PageNeedsDefrag(page)))
 	{
 		/*
-		 * Apply the planned item changes, then repair page fragmentation, and
-		 * update the page's hint bit about whether it has free line pointers.
+		 * Apply the planned item changes, then repair page fragmentation if
+		 * we can, and update the page's hint bits.
 		 */
 		heap_page_prune_execute(buffer,
 								prstate.redirected, prstate.nredirected,
 								prstate.nowdead, prstate.ndead,
-								prstate.nowunused, prstate.nunused);
+								prstate.nowunused, prstate.nunused,
+								defragment);
 
 		/*
 		 * Update the page's pd_prune_xid field to either zero, or the lowest
@@ -222,9 +270,11 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 		/*
 		 * Also clear the "page is full" flag, since there's no point in
 		 * repeating the prune/defrag process until something else happens to
-		 * the page.
+		 * the page.  If we couldn't defragment, though, the page is still
+		 * just as full as before.
 		 */
-		PageClearFull(page);
+		if (defragment)
+			PageClearFull(page);
 
 		MarkBufferDirty(buffer);
 
@@ -254,13 +304,14 @@ heap_page_prune(Relation relation, Buffer buffer, TransactionId OldestXmin,
 		 *
 		 * Also clear the "page is full" flag if it is set, since there's no
 		 * point in repeating the prune/defrag process until something else
-		 * happens to the page.
+		 * happens to the page --- unless a defrag is still pending.
 		 */
 		if (((PageHeader) page)->pd_prune_xid != prstate.new_prune_xid ||
-			PageIsFull(page))
+			(PageIsFull(page) && !PageNeedsDefrag(page)))
 		{
 			((PageHeader) page)->pd_prune_xid = prstate.new_prune_xid;
-			PageClearFull(page);
+			if (!PageNeedsDefrag(page))
+				PageClearFull(page);
 			SetBufferCommitInfoNeedsSave(buffer);
 		}
 	}
@@ -637,13 +688,19 @@ heap_prune_record_unused(PruneState *prstate, OffsetNumber offnum)
  *
  * This is split out because it is also used by heap_xlog_clean()
  * to replay the WAL record when needed after a crash.	Note that the
- * arguments are identical to those of log_heap_clean().
+ * arguments are identical to those of log_heap_clean(), except for
+ * defragment: fragmentation may only be repaired under a buffer cleanup
+ * lock.  Without one, we only change line pointers, which doesn't disturb
+ * the tuple data that other backends may be pointing at, and mark the page
+ * as needing a defrag.  Replay always defragments, since the startup process
+ * takes a cleanup lock anyway.
  */
 void
 heap_page_prune_execute(Buffer buffer,
 						OffsetNumber *redirected, int nredirected,
 						OffsetNumber *nowdead, int ndead,
-						OffsetNumber *nowunused, int nunused)
+						OffsetNumber *nowunused, int nunused,
+						bool defragment)
 {
 	Page		page = (Page) BufferGetPage(buffer);
 	OffsetNumber *offnum;
@@ -682,9 +739,17 @@ heap_page_prune_execute(Buffer buffer,
 
 	/*
 	 * Finally, repair any fragmentation, and update the page's hint bit about
-	 * whether it has free pointers.
+	 * whether it has free pointers.  If we can't defragment, leave that to
+	 * someone else.
 	 */
-	PageRepairFragmentation(page);
+	if (defragment)
+		PageRepairFragmentation(page);
+	else
+	{
+		if (nunused > 0)
+			PageSetHasFreeLinePointers(page);
+		PageSetNeedsDefrag(page);
+	}
 }
 
 
@@ -581,6 +581,7 @@ raw_heap_insert(RewriteState state, HeapTuple tup)
 	else if (HeapTupleHasExternal(tup) || tup->t_len > TOAST_TUPLE_THRESHOLD)
 		heaptup = toast_insert_or_update(state->rs_new_rel, tup, NULL,
 										 HEAP_INSERT_SKIP_FSM |
+										 HEAP_INSERT_NO_LOGICAL |
 										 (state->rs_use_wal ?
 										  0 : HEAP_INSERT_SKIP_WAL));
 	else
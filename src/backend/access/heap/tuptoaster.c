@@ -35,6 +35,7 @@
 #include "access/tuptoaster.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "storage/bufmgr.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_lzcompress.h"
 #include "utils/rel.h"
@@ -48,29 +49,18 @@
 #define TOAST_POINTER_SIZE (VARHDRSZ_EXTERNAL + sizeof(struct varatt_external))
 
 /*
- * Testing whether an externally-stored value is compressed now requires
- * comparing extsize (the actual length of the external data) to rawsize
- * (the original uncompressed datum's size).  The latter includes VARHDRSZ
- * overhead, the former doesn't.  We never use compression unless it actually
- * saves space, so we expect either equality or less-than.
+ * State for prefetching the toast heap pages of a value being fetched.  A
+ * second scan of the toast index runs ahead of the one returning chunks and
+ * issues PrefetchBuffer for each new heap block it sees, so that reading a
+ * large value that isn't cached doesn't wait for its pages one at a time.
  */
-#define VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) \
-	((toast_pointer).va_extsize < (toast_pointer).va_rawsize - VARHDRSZ)
-
-/*
- * Macro to fetch the possibly-unaligned contents of an EXTERNAL datum
- * into a local "struct varatt_external" toast pointer.  This should be
- * just a memcpy, but some versions of gcc seem to produce broken code
- * that assumes the datum contents are aligned.  Introducing an explicit
- * intermediate "varattrib_1b_e *" variable seems to fix it.
- */
-#define VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr) \
-do { \
-	varattrib_1b_e *attre = (varattrib_1b_e *) (attr); \
-	Assert(VARATT_IS_EXTERNAL(attre)); \
-	Assert(VARSIZE_EXTERNAL(attre) == sizeof(toast_pointer) + VARHDRSZ_EXTERNAL); \
-	memcpy(&(toast_pointer), VARDATA_EXTERNAL(attre), sizeof(toast_pointer)); \
-} while (0)
+typedef struct ToastPrefetchState
+{
+	IndexScanDesc scan;			/* look-ahead scan, or NULL if not in use */
+	BlockNumber last_prefetched;	/* last block the scan prefetched */
+	BlockNumber last_read;		/* last block the main scan returned */
+	int			pending;		/* blocks prefetched but not yet read */
+} ToastPrefetchState;
 
 
 static void toast_delete_datum(Relation rel, Datum value);
@@ -80,6 +70,12 @@ static bool toast_valueid_exists(Oid toastrelid, Oid valueid);
 static struct varlena *toast_fetch_datum(struct varlena * attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena * attr,
 						int32 sliceoffset, int32 length);
+static void toast_prefetch_begin(ToastPrefetchState *pstate, Relation toastrel,
+					 Relation toastidx, int nkeys, ScanKey keys,
+					 int32 numchunks);
+static void toast_prefetch_advance(ToastPrefetchState *pstate,
+					   Relation toastrel, HeapTuple ttup);
+static void toast_prefetch_end(ToastPrefetchState *pstate);
 
 
 /* ----------
@@ -189,6 +185,16 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 	struct varlena *result;
 	char	   *attrdata;
 	int32		attrsize;
+	int32		rawneeded = -1;
+
+	/*
+	 * pglz output can be produced front to back, so if the caller only needs
+	 * a prefix of a compressed value, we need only decompress that much, and
+	 * only fetch enough compressed data from the toast table to produce it.
+	 */
+	if (sliceoffset >= 0 && slicelength >= 0)
+		rawneeded = (int32) Min((int64) sliceoffset + slicelength,
+								(int64) INT_MAX);
 
 	if (VARATT_IS_EXTERNAL(attr))
 	{
@@ -201,7 +207,19 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 			return toast_fetch_datum_slice(attr, sliceoffset, slicelength);
 
 		/* fetch it back (compressed marker will get set automatically) */
-		preslice = toast_fetch_datum(attr);
+		if (rawneeded >= 0 &&
+			rawneeded < toast_pointer.va_rawsize - VARHDRSZ)
+		{
+			int32		compsize = toast_pointer.va_extsize -
+				(sizeof(PGLZ_Header) - VARHDRSZ);
+
+			preslice = toast_fetch_datum_slice(attr, 0,
+											   sizeof(PGLZ_Header) - VARHDRSZ +
+								   pglz_maximum_compressed_size(rawneeded,
+																compsize));
+		}
+		else
+			preslice = toast_fetch_datum(attr);
 	}
 	else
 		preslice = attr;
@@ -209,11 +227,22 @@ heap_tuple_untoast_attr_slice(struct varlena * attr,
 	if (VARATT_IS_COMPRESSED(preslice))
 	{
 		PGLZ_Header *tmp = (PGLZ_Header *) preslice;
-		Size		size = PGLZ_RAW_SIZE(tmp) + VARHDRSZ;
+		Size		size;
 
-		preslice = (struct varlena *) palloc(size);
-		SET_VARSIZE(preslice, size);
-		pglz_decompress(tmp, VARDATA(preslice));
+		if (rawneeded >= 0 && rawneeded < PGLZ_RAW_SIZE(tmp))
+		{
+			size = rawneeded + VARHDRSZ;
+			preslice = (struct varlena *) palloc(size);
+			SET_VARSIZE(preslice, size);
+			pglz_decompress_prefix(tmp, VARDATA(preslice), rawneeded);
+		}
+		else
+		{
+			size = PGLZ_RAW_SIZE(tmp) + VARHDRSZ;
+			preslice = (struct varlena *) palloc(size);
+			SET_VARSIZE(preslice, size);
+			pglz_decompress(tmp, VARDATA(preslice));
+		}
 
 		if (tmp != (PGLZ_Header *) attr)
 			pfree(tmp);
@@ -352,10 +381,11 @@ toast_delete(Relation rel, HeapTuple oldtup)
 	bool		toast_isnull[MaxHeapAttributeNumber];
 
 	/*
-	 * We should only ever be called for tuples of plain relations ---
-	 * recursing on a toast rel is bad news.
+	 * We should only ever be called for tuples of plain relations or
+	 * materialized views --- recursing on a toast rel is bad news.
 	 */
-	Assert(rel->rd_rel->relkind == RELKIND_RELATION);
+	Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+		   rel->rd_rel->relkind == RELKIND_MATVIEW);
 
 	/*
 	 * Get the tuple descriptor and break down the tuple into fields.
@@ -439,10 +469,11 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 	bool		toast_delold[MaxHeapAttributeNumber];
 
 	/*
-	 * We should only ever be called for tuples of plain relations ---
-	 * recursing on a toast rel is bad news.
+	 * We should only ever be called for tuples of plain relations or
+	 * materialized views --- recursing on a toast rel is bad news.
 	 */
-	Assert(rel->rd_rel->relkind == RELKIND_RELATION);
+	Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+		   rel->rd_rel->relkind == RELKIND_MATVIEW);
 
 	/*
 	 * Get the tuple descriptor and break down the tuple(s) into fields.
@@ -1402,7 +1433,8 @@ toast_save_datum(Relation rel, Datum value,
 					 &(toasttup->t_self),
 					 toastrel,
 					 toastidx->rd_index->indisunique ?
-					 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO);
+					 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO,
+					 false);
 
 		/*
 		 * Free memory
@@ -1566,6 +1598,7 @@ toast_fetch_datum(struct varlena * attr)
 	bool		isnull;
 	char	   *chunkdata;
 	int32		chunksize;
+	ToastPrefetchState pstate;
 
 	/* Must copy to access aligned fields */
 	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
@@ -1606,8 +1639,12 @@ toast_fetch_datum(struct varlena * attr)
 
 	toastscan = systable_beginscan_ordered(toastrel, toastidx,
 										   SnapshotToast, 1, &toastkey);
+	toast_prefetch_begin(&pstate, toastrel, toastidx, 1, &toastkey,
+						 numchunks);
 	while ((ttup = systable_getnext_ordered(toastscan, ForwardScanDirection)) != NULL)
 	{
+		toast_prefetch_advance(&pstate, toastrel, ttup);
+
 		/*
 		 * Have a chunk, extract the sequence number and the data
 		 */
@@ -1692,6 +1729,7 @@ toast_fetch_datum(struct varlena * attr)
 	/*
 	 * End scan and close relations
 	 */
+	toast_prefetch_end(&pstate);
 	systable_endscan_ordered(toastscan);
 	index_close(toastidx, AccessShareLock);
 	heap_close(toastrel, AccessShareLock);
@@ -1733,6 +1771,7 @@ toast_fetch_datum_slice(struct varlena * attr, int32 sliceoffset, int32 length)
 	int32		chunksize;
 	int32		chcpystrt;
 	int32		chcpyend;
+	ToastPrefetchState pstate;
 
 	Assert(VARATT_IS_EXTERNAL(attr));
 
@@ -1742,8 +1781,10 @@ toast_fetch_datum_slice(struct varlena * attr, int32 sliceoffset, int32 length)
 	/*
 	 * It's nonsense to fetch slices of a compressed datum -- this isn't lo_*
 	 * we can't return a compressed datum which is meaningful to toast later
+	 * -- except for a prefix, which heap_tuple_untoast_attr_slice can
+	 * decompress partially.
 	 */
-	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
+	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) || sliceoffset == 0);
 
 	attrsize = toast_pointer.va_extsize;
 	totalchunks = ((attrsize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
@@ -1822,8 +1863,12 @@ toast_fetch_datum_slice(struct varlena * attr, int32 sliceoffset, int32 length)
 	nextidx = startchunk;
 	toastscan = systable_beginscan_ordered(toastrel, toastidx,
 										 SnapshotToast, nscankeys, toastkey);
+	toast_prefetch_begin(&pstate, toastrel, toastidx, nscankeys, toastkey,
+						 numchunks);
 	while ((ttup = systable_getnext_ordered(toastscan, ForwardScanDirection)) != NULL)
 	{
+		toast_prefetch_advance(&pstate, toastrel, ttup);
+
 		/*
 		 * Have a chunk, extract the sequence number and the data
 		 */
@@ -1916,9 +1961,104 @@ toast_fetch_datum_slice(struct varlena * attr, int32 sliceoffset, int32 length)
 	/*
 	 * End scan and close relations
 	 */
+	toast_prefetch_end(&pstate);
 	systable_endscan_ordered(toastscan);
 	index_close(toastidx, AccessShareLock);
 	heap_close(toastrel, AccessShareLock);
 
 	return result;
 }
+
+/* ----------
+ * toast_prefetch_begin -
+ *
+ *	Start prefetching the heap pages holding the chunks that an ordered
+ *	toast index scan with the given (already index-relative) keys will
+ *	return.  Values that fit in a couple of pages aren't worth a second
+ *	index scan.
+ * ----------
+ */
+static void
+toast_prefetch_begin(ToastPrefetchState *pstate, Relation toastrel,
+					 Relation toastidx, int nkeys, ScanKey keys,
+					 int32 numchunks)
+{
+	pstate->scan = NULL;
+	pstate->last_prefetched = InvalidBlockNumber;
+	pstate->last_read = InvalidBlockNumber;
+	pstate->pending = 0;
+
+#ifdef USE_PREFETCH
+	if (target_prefetch_pages <= 0 ||
+		numchunks <= 2 * EXTERN_TUPLES_PER_PAGE)
+		return;
+
+	pstate->scan = index_beginscan(toastrel, toastidx, SnapshotToast,
+								   nkeys, 0);
+	index_rescan(pstate->scan, keys, nkeys, NULL, 0);
+#endif   /* USE_PREFETCH */
+}
+
+/* ----------
+ * toast_prefetch_advance -
+ *
+ *	Note that the main scan has returned ttup, and keep the look-ahead
+ *	scan target_prefetch_pages blocks ahead of it.
+ * ----------
+ */
+static void
+toast_prefetch_advance(ToastPrefetchState *pstate, Relation toastrel,
+					   HeapTuple ttup)
+{
+#ifdef USE_PREFETCH
+	BlockNumber blkno;
+
+	if (pstate->scan == NULL)
+		return;
+
+	blkno = ItemPointerGetBlockNumber(&ttup->t_self);
+	if (blkno != pstate->last_read)
+	{
+		pstate->last_read = blkno;
+		if (pstate->pending > 0)
+			pstate->pending--;
+	}
+
+	while (pstate->pending < target_prefetch_pages)
+	{
+		ItemPointer tid;
+
+		tid = index_getnext_tid(pstate->scan, ForwardScanDirection);
+		if (tid == NULL)
+		{
+			/* all of the value's pages have been prefetched */
+			toast_prefetch_end(pstate);
+			break;
+		}
+
+		blkno = ItemPointerGetBlockNumber(tid);
+		if (blkno != pstate->last_prefetched)
+		{
+			PrefetchBuffer(toastrel, MAIN_FORKNUM, blkno);
+			pstate->last_prefetched = blkno;
+			pstate->pending++;
+		}
+	}
+#endif   /* USE_PREFETCH */
+}
+
+/* ----------
+ * toast_prefetch_end -
+ *
+ *	Release the look-ahead scan, if any.
+ * ----------
+ */
+static void
+toast_prefetch_end(ToastPrefetchState *pstate)
+{
+	if (pstate->scan != NULL)
+	{
+		index_endscan(pstate->scan);
+		pstate->scan = NULL;
+	}
+}
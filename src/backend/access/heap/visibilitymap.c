@@ -11,21 +11,26 @@
  *	  src/backend/access/heap/visibilitymap.c
  *
  * INTERFACE ROUTINES
- *		visibilitymap_clear  - clear a bit in the visibility map
+ *		visibilitymap_clear  - clear bits in the visibility map
  *		visibilitymap_pin	 - pin a map page for setting a bit
  *		visibilitymap_pin_ok - check whether correct map page is already pinned
- *		visibilitymap_set	 - set a bit in a previously pinned page
- *		visibilitymap_test	 - test if a bit is set
- *		visibilitymap_count	 - count number of bits set in visibility map
+ *		visibilitymap_set	 - set bits in a previously pinned page
+ *		visibilitymap_get_status - get the bits for a heap page
+ *		visibilitymap_test	 - test if the all-visible bit is set
+ *		visibilitymap_count	 - count number of all-visible pages in the map
  *		visibilitymap_truncate	- truncate the visibility map
  *
  * NOTES
  *
- * The visibility map is a bitmap with one bit per heap page. A set bit means
- * that all tuples on the page are known visible to all transactions, and
- * therefore the page doesn't need to be vacuumed. The map is conservative in
- * the sense that we make sure that whenever a bit is set, we know the
- * condition is true, but if a bit is not set, it might or might not be true.
+ * The visibility map is a bitmap with two bits per heap page.  The first
+ * (all-visible) bit means that all tuples on the page are known visible to
+ * all transactions, and therefore the page doesn't need to be vacuumed.  The
+ * second (all-frozen) bit, which is only ever set together with the first,
+ * means that in addition all tuples on the page have been frozen, so that
+ * not even an anti-wraparound vacuum needs to look at the page.  The map is
+ * conservative in the sense that we make sure that whenever a bit is set, we
+ * know the condition is true, but if a bit is not set, it might or might not
+ * be true.
  *
  * Clearing a visibility map bit is not separately WAL-logged.  The callers
  * must make sure that whenever a bit is cleared, the bit is cleared on WAL
@@ -43,11 +48,13 @@
  * visibility map bit must be cleared, possibly causing index-only scans to
  * return wrong answers.
  *
- * VACUUM will normally skip pages for which the visibility map bit is set;
+ * VACUUM will normally skip pages for which the all-visible bit is set;
  * such pages can't contain any dead tuples and therefore don't need vacuuming.
- * The visibility map is not used for anti-wraparound vacuums, because
- * an anti-wraparound vacuum needs to freeze tuples and observe the latest xid
- * present in the table, even on pages that don't have any dead tuples.
+ * An anti-wraparound vacuum, which needs to freeze tuples and observe the
+ * latest xid present in the table even on pages that don't have any dead
+ * tuples, can only skip pages whose all-frozen bit is set as well.  Any
+ * modification of a page clears both bits, except for row locking, which
+ * clears only the all-frozen bit (the locker's xid is stored in xmax).
  *
  * LOCKING
  *
@@ -100,10 +107,10 @@
 #define MAPSIZE (BLCKSZ - MAXALIGN(SizeOfPageHeaderData))
 
 /* Number of bits allocated for each heap block. */
-#define BITS_PER_HEAPBLOCK 1
+#define BITS_PER_HEAPBLOCK 2
 
 /* Number of heap blocks we can represent in one byte. */
-#define HEAPBLOCKS_PER_BYTE 8
+#define HEAPBLOCKS_PER_BYTE 4
 
 /* Number of heap blocks we can represent in one visibility map page. */
 #define HEAPBLOCKS_PER_PAGE (MAPSIZE * HEAPBLOCKS_PER_BYTE)
@@ -111,7 +118,10 @@
 /* Mapping from heap block number to the right bit in the visibility map */
 #define HEAPBLK_TO_MAPBLOCK(x) ((x) / HEAPBLOCKS_PER_PAGE)
 #define HEAPBLK_TO_MAPBYTE(x) (((x) % HEAPBLOCKS_PER_PAGE) / HEAPBLOCKS_PER_BYTE)
-#define HEAPBLK_TO_MAPBIT(x) ((x) % HEAPBLOCKS_PER_BYTE)
+#define HEAPBLK_TO_OFFSET(x) (((x) % HEAPBLOCKS_PER_BYTE) * BITS_PER_HEAPBLOCK)
+
+/* Masks for counting subsets of bits in the visibility map */
+#define VISIBLE_MASK8	(0x55)	/* The lower bit of each bit pair */
 
 /* table for fast counting of set bits */
 static const uint8 number_of_ones[256] = {
@@ -139,25 +149,35 @@ static void vm_extend(Relation rel, BlockNumber nvmblocks);
 
 
 /*
- *	visibilitymap_clear - clear a bit in visibility map
+ *	visibilitymap_clear - clear bits in visibility map
+ *
+ * flags is the set of VISIBILITYMAP_* bits to clear; callers that modify
+ * tuples on the page pass VISIBILITYMAP_VALID_BITS.  Clearing the all-visible
+ * bit always clears the all-frozen bit too.
  *
  * You must pass a buffer containing the correct map page to this function.
  * Call visibilitymap_pin first to pin the right one. This function doesn't do
  * any I/O.
  */
 void
-visibilitymap_clear(Relation rel, BlockNumber heapBlk, Buffer buf)
+visibilitymap_clear(Relation rel, BlockNumber heapBlk, Buffer buf, uint8 flags)
 {
 	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
 	int			mapByte = HEAPBLK_TO_MAPBYTE(heapBlk);
-	int			mapBit = HEAPBLK_TO_MAPBIT(heapBlk);
-	uint8		mask = 1 << mapBit;
+	int			mapOffset = HEAPBLK_TO_OFFSET(heapBlk);
+	uint8		mask;
 	char	   *map;
 
 #ifdef TRACE_VISIBILITYMAP
-	elog(DEBUG1, "vm_clear %s %d", RelationGetRelationName(rel), heapBlk);
+	elog(DEBUG1, "vm_clear %s %d %u", RelationGetRelationName(rel), heapBlk,
+		 flags);
 #endif
 
+	Assert(flags != 0 && (flags & ~VISIBILITYMAP_VALID_BITS) == 0);
+	if (flags & VISIBILITYMAP_ALL_VISIBLE)
+		flags |= VISIBILITYMAP_ALL_FROZEN;
+	mask = flags << mapOffset;
+
 	if (!BufferIsValid(buf) || BufferGetBlockNumber(buf) != mapBlock)
 		elog(ERROR, "wrong buffer passed to visibilitymap_clear");
 
@@ -223,7 +243,10 @@ visibilitymap_pin_ok(BlockNumber heapBlk, Buffer buf)
 }
 
 /*
- *	visibilitymap_set - set a bit on a previously pinned page
+ *	visibilitymap_set - set bits on a previously pinned page
+ *
+ * flags is the set of VISIBILITYMAP_* bits to set.  VISIBILITYMAP_ALL_FROZEN
+ * must always be accompanied by VISIBILITYMAP_ALL_VISIBLE.
  *
  * recptr is the LSN of the XLOG record we're replaying, if we're in recovery,
  * or InvalidXLogRecPtr in normal running.  The page LSN is advanced to the
@@ -236,19 +259,23 @@ visibilitymap_pin_ok(BlockNumber heapBlk, Buffer buf)
  */
 void
 visibilitymap_set(Relation rel, BlockNumber heapBlk, XLogRecPtr recptr,
-				  Buffer buf)
+				  Buffer buf, uint8 flags)
 {
 	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
 	uint32		mapByte = HEAPBLK_TO_MAPBYTE(heapBlk);
-	uint8		mapBit = HEAPBLK_TO_MAPBIT(heapBlk);
+	uint8		mapOffset = HEAPBLK_TO_OFFSET(heapBlk);
 	Page		page;
 	char	   *map;
 
 #ifdef TRACE_VISIBILITYMAP
-	elog(DEBUG1, "vm_set %s %d", RelationGetRelationName(rel), heapBlk);
+	elog(DEBUG1, "vm_set %s %d %u", RelationGetRelationName(rel), heapBlk,
+		 flags);
 #endif
 
 	Assert(InRecovery || XLogRecPtrIsInvalid(recptr));
+	Assert(flags != 0 && (flags & ~VISIBILITYMAP_VALID_BITS) == 0);
+	Assert(!(flags & VISIBILITYMAP_ALL_FROZEN) ||
+		   (flags & VISIBILITYMAP_ALL_VISIBLE));
 
 	/* Check that we have the right page pinned */
 	if (!BufferIsValid(buf) || BufferGetBlockNumber(buf) != mapBlock)
@@ -258,17 +285,17 @@ visibilitymap_set(Relation rel, BlockNumber heapBlk, XLogRecPtr recptr,
 	map = PageGetContents(page);
 	LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
 
-	if (!(map[mapByte] & (1 << mapBit)))
+	if (flags != ((map[mapByte] >> mapOffset) & flags))
 	{
 		START_CRIT_SECTION();
 
-		map[mapByte] |= (1 << mapBit);
+		map[mapByte] |= (flags << mapOffset);
 		MarkBufferDirty(buf);
 
 		if (RelationNeedsWAL(rel))
 		{
 			if (XLogRecPtrIsInvalid(recptr))
-				recptr = log_heap_visible(rel->rd_node, heapBlk, buf);
+				recptr = log_heap_visible(rel->rd_node, heapBlk, buf, flags);
 			PageSetLSN(page, recptr);
 			PageSetTLI(page, ThisTimeLineID);
 		}
@@ -280,27 +307,28 @@ visibilitymap_set(Relation rel, BlockNumber heapBlk, XLogRecPtr recptr,
 }
 
 /*
- *	visibilitymap_test - test if a bit is set
+ *	visibilitymap_get_status - get the visibility map bits of a heap page
  *
- * Are all tuples on heapBlk visible to all, according to the visibility map?
+ * Returns the set of VISIBILITYMAP_* bits currently set for heapBlk, or 0
+ * if the map doesn't cover it.
  *
  * On entry, *buf should be InvalidBuffer or a valid buffer returned by an
- * earlier call to visibilitymap_pin or visibilitymap_test on the same
+ * earlier call to visibilitymap_pin or visibilitymap_get_status on the same
  * relation. On return, *buf is a valid buffer with the map page containing
- * the bit for heapBlk, or InvalidBuffer. The caller is responsible for
+ * the bits for heapBlk, or InvalidBuffer. The caller is responsible for
  * releasing *buf after it's done testing and setting bits.
  */
-bool
-visibilitymap_test(Relation rel, BlockNumber heapBlk, Buffer *buf)
+uint8
+visibilitymap_get_status(Relation rel, BlockNumber heapBlk, Buffer *buf)
 {
 	BlockNumber mapBlock = HEAPBLK_TO_MAPBLOCK(heapBlk);
 	uint32		mapByte = HEAPBLK_TO_MAPBYTE(heapBlk);
-	uint8		mapBit = HEAPBLK_TO_MAPBIT(heapBlk);
-	bool		result;
+	uint8		mapOffset = HEAPBLK_TO_OFFSET(heapBlk);
+	uint8		result;
 	char	   *map;
 
 #ifdef TRACE_VISIBILITYMAP
-	elog(DEBUG1, "vm_test %s %d", RelationGetRelationName(rel), heapBlk);
+	elog(DEBUG1, "vm_get_status %s %d", RelationGetRelationName(rel), heapBlk);
 #endif
 
 	/* Reuse the old pinned buffer if possible */
@@ -317,21 +345,34 @@ visibilitymap_test(Relation rel, BlockNumber heapBlk, Buffer *buf)
 	{
 		*buf = vm_readbuf(rel, mapBlock, false);
 		if (!BufferIsValid(*buf))
-			return false;
+			return 0;
 	}
 
 	map = PageGetContents(BufferGetPage(*buf));
 
 	/*
-	 * We don't need to lock the page, as we're only looking at a single bit.
+	 * We don't need to lock the page, as we're only looking at a single byte.
 	 */
-	result = (map[mapByte] & (1 << mapBit)) ? true : false;
+	result = ((map[mapByte] >> mapOffset) & VISIBILITYMAP_VALID_BITS);
 
 	return result;
 }
 
 /*
- *	visibilitymap_count	 - count number of bits set in visibility map
+ *	visibilitymap_test - test if the all-visible bit is set
+ *
+ * Are all tuples on heapBlk visible to all, according to the visibility map?
+ * See visibilitymap_get_status for the handling of *buf.
+ */
+bool
+visibilitymap_test(Relation rel, BlockNumber heapBlk, Buffer *buf)
+{
+	return (visibilitymap_get_status(rel, heapBlk, buf) &
+			VISIBILITYMAP_ALL_VISIBLE) != 0;
+}
+
+/*
+ *	visibilitymap_count	 - count number of all-visible pages in visibility map
  *
  * Note: we ignore the possibility of race conditions when the table is being
  * extended concurrently with the call.  New pages added to the table aren't
@@ -367,7 +408,7 @@ visibilitymap_count(Relation rel)
 
 		for (i = 0; i < MAPSIZE; i++)
 		{
-			result += number_of_ones[map[i]];
+			result += number_of_ones[map[i] & VISIBLE_MASK8];
 		}
 
 		ReleaseBuffer(mapBuffer);
@@ -393,7 +434,7 @@ visibilitymap_truncate(Relation rel, BlockNumber nheapblocks)
 	/* last remaining block, byte, and bit */
 	BlockNumber truncBlock = HEAPBLK_TO_MAPBLOCK(nheapblocks);
 	uint32		truncByte = HEAPBLK_TO_MAPBYTE(nheapblocks);
-	uint8		truncBit = HEAPBLK_TO_MAPBIT(nheapblocks);
+	uint8		truncOffset = HEAPBLK_TO_OFFSET(nheapblocks);
 
 #ifdef TRACE_VISIBILITYMAP
 	elog(DEBUG1, "vm_truncate %s %d", RelationGetRelationName(rel), nheapblocks);
@@ -415,7 +456,7 @@ visibilitymap_truncate(Relation rel, BlockNumber nheapblocks)
 	 * because we don't get a chance to clear the bits if the heap is extended
 	 * again.
 	 */
-	if (truncByte != 0 || truncBit != 0)
+	if (truncByte != 0 || truncOffset != 0)
 	{
 		Buffer		mapBuffer;
 		Page		page;
@@ -441,10 +482,10 @@ visibilitymap_truncate(Relation rel, BlockNumber nheapblocks)
 		/*
 		 * Mask out the unwanted bits of the last remaining byte.
 		 *
-		 * ((1 << 0) - 1) = 00000000 ((1 << 1) - 1) = 00000001 ... ((1 << 6) -
-		 * 1) = 00111111 ((1 << 7) - 1) = 01111111
+		 * ((1 << 0) - 1) = 00000000 ((1 << 2) - 1) = 00000011 ((1 << 4) - 1)
+		 * = 00001111 ((1 << 6) - 1) = 00111111
 		 */
-		map[truncByte] &= (1 << truncBit) - 1;
+		map[truncByte] &= (1 << truncOffset) - 1;
 
 		MarkBufferDirty(mapBuffer);
 		UnlockReleaseBuffer(mapBuffer);
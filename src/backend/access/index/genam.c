@@ -118,6 +118,7 @@ RelationGetIndexScan(Relation indexRelation, int nkeys, int norderbys)
 	scan->xs_ctup.t_data = NULL;
 	scan->xs_cbuf = InvalidBuffer;
 	scan->xs_continue_hot = false;
+	scan->xs_readstream = NULL;
 
 	return scan;
 }
@@ -161,7 +162,7 @@ BuildIndexValueDescription(Relation indexRelation,
 						   Datum *values, bool *isnull)
 {
 	StringInfoData buf;
-	int			natts = indexRelation->rd_rel->relnatts;
+	int			natts = IndexRelationGetNumberOfKeyAttributes(indexRelation);
 	int			i;
 
 	initStringInfo(&buf);
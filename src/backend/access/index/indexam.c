@@ -76,6 +76,9 @@
 #include "utils/tqual.h"
 
 
+/* GUC parameter */
+int			index_prefetch_distance = -1;
+
 /* ----------------------------------------------------------------
  *					macros used in index_ routines
  *
@@ -198,7 +201,8 @@ index_insert(Relation indexRelation,
 			 bool *isnull,
 			 ItemPointer heap_t_ctid,
 			 Relation heapRelation,
-			 IndexUniqueCheck checkUnique)
+			 IndexUniqueCheck checkUnique,
+			 bool indexUnchanged)
 {
 	FmgrInfo   *procedure;
 
@@ -213,13 +217,14 @@ index_insert(Relation indexRelation,
 	/*
 	 * have the am's insert proc do all the work.
 	 */
-	return DatumGetBool(FunctionCall6(procedure,
+	return DatumGetBool(FunctionCall7(procedure,
 									  PointerGetDatum(indexRelation),
 									  PointerGetDatum(values),
 									  PointerGetDatum(isnull),
 									  PointerGetDatum(heap_t_ctid),
 									  PointerGetDatum(heapRelation),
-									  Int32GetDatum((int32) checkUnique)));
+									  Int32GetDatum((int32) checkUnique),
+									  BoolGetDatum(indexUnchanged)));
 }
 
 /*
@@ -505,6 +510,11 @@ index_fetch_heap(IndexScanDesc scan)
 		/* Switch to correct buffer if we don't have it already */
 		Buffer		prev_buf = scan->xs_cbuf;
 
+		/* Let the AM's read-ahead, if any, move on past this block */
+		if (scan->xs_readstream != NULL)
+			ReadStreamConsume(scan->xs_readstream,
+							  ItemPointerGetBlockNumber(tid));
+
 		scan->xs_cbuf = ReleaseAndReadBuffer(scan->xs_cbuf,
 											 scan->heapRelation,
 											 ItemPointerGetBlockNumber(tid));
@@ -21,10 +21,18 @@
 #include "miscadmin.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#include "storage/smgr.h"
 #include "utils/inval.h"
 #include "utils/tqual.h"
 
 
+/*
+ * Minimum tree height at which we remember the rightmost leaf page as the
+ * relation's target block, for the fast path in _bt_doinsert.  In smaller
+ * trees the descent costs so little that it's not worth the bother.
+ */
+#define BTREE_FASTPATH_MIN_LEVEL	2
+
 typedef struct
 {
 	/* context data for _bt_checksplitloc */
@@ -58,6 +66,7 @@ static void _bt_findinsertloc(Relation rel,
 				  int keysz,
 				  ScanKey scankey,
 				  IndexTuple newtup,
+				  bool indexUnchanged,
 				  Relation heapRel);
 static void _bt_insertonpg(Relation rel, Buffer buf,
 			   BTStack stack,
@@ -79,6 +88,9 @@ static bool _bt_pgaddtup(Page page, Size itemsize, IndexTuple itup,
 static bool _bt_isequal(TupleDesc itupdesc, Page page, OffsetNumber offnum,
 			int keysz, ScanKey scankey);
 static void _bt_vacuum_one_page(Relation rel, Buffer buffer, Relation heapRel);
+static bool _bt_bottomup_delete(Relation rel, Buffer buffer, Relation heapRel,
+					int keysz, ScanKey scankey);
+static bool _bt_dedup_one_page(Relation rel, Buffer buffer);
 
 
 /*
@@ -98,39 +110,96 @@ static void _bt_vacuum_one_page(Relation rel, Buffer buffer, Relation heapRel);
  *		(In the current implementation we'll also return TRUE after a
  *		successful UNIQUE_CHECK_YES or UNIQUE_CHECK_EXISTING call, but
  *		that's just a coding artifact.)
+ *
+ *		indexUnchanged is the caller's hint that the tuple is a new version
+ *		of a row whose key in this index didn't change; see
+ *		_bt_bottomup_delete.
  */
 bool
 _bt_doinsert(Relation rel, IndexTuple itup,
-			 IndexUniqueCheck checkUnique, Relation heapRel)
+			 IndexUniqueCheck checkUnique, bool indexUnchanged,
+			 Relation heapRel)
 {
 	bool		is_unique = false;
-	int			natts = rel->rd_rel->relnatts;
+	int			natts = IndexRelationGetNumberOfKeyAttributes(rel);
 	ScanKey		itup_scankey;
 	BTStack		stack;
 	Buffer		buf;
 	OffsetNumber offset;
+	bool		fastpath;
 
 	/* we need an insertion scan key to do our search, so build one */
 	itup_scankey = _bt_mkscankey(rel, itup);
 
 top:
-	/* find the first page containing this key */
-	stack = _bt_search(rel, natts, itup_scankey, false, &buf, BT_WRITE);
-
+	stack = NULL;
 	offset = InvalidOffsetNumber;
-
-	/* trade in our read lock for a write lock */
-	LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-	LockBuffer(buf, BT_WRITE);
+	fastpath = false;
 
 	/*
-	 * If the page was split between the time that we surrendered our read
-	 * lock and acquired our write lock, then this page may no longer be the
-	 * right place for the key we want to insert.  In this case, we need to
-	 * move right in the tree.	See Lehman and Yao for an excruciatingly
-	 * precise description.
+	 * Indexes on ever-increasing keys, such as serial or timestamp columns,
+	 * receive nearly all their insertions on the rightmost leaf page.  After
+	 * an insertion there, _bt_insertonpg remembers that page as the
+	 * relation's target block, so that the next insertion can try it without
+	 * descending the tree.  We use it only if we can lock it at once, and it
+	 * is still the rightmost leaf, has room for the new item, and the new
+	 * key is greater than the first key on it: then no other page can be
+	 * the right place for the key.  Otherwise we forget it and do the normal
+	 * search.  Since there is room on the page, it won't be split, so we
+	 * don't need the search stack that _bt_search would have built.
 	 */
-	buf = _bt_moveright(rel, buf, natts, itup_scankey, false, BT_WRITE);
+	if (RelationGetTargetBlock(rel) != InvalidBlockNumber)
+	{
+		Size		itemsz = MAXALIGN(IndexTupleDSize(*itup));
+		Page		page;
+		BTPageOpaque lpageop;
+
+		buf = ReadBuffer(rel, RelationGetTargetBlock(rel));
+
+		if (ConditionalLockBuffer(buf))
+		{
+			_bt_checkpage(rel, buf);
+			page = BufferGetPage(buf);
+			lpageop = (BTPageOpaque) PageGetSpecialPointer(page);
+
+			if (P_ISLEAF(lpageop) && P_RIGHTMOST(lpageop) &&
+				!P_IGNORE(lpageop) &&
+				PageGetFreeSpace(page) > itemsz &&
+				PageGetMaxOffsetNumber(page) >= P_FIRSTDATAKEY(lpageop) &&
+				_bt_compare(rel, natts, itup_scankey, page,
+							P_FIRSTDATAKEY(lpageop)) > 0)
+				fastpath = true;
+			else
+			{
+				_bt_relbuf(rel, buf);
+				RelationSetTargetBlock(rel, InvalidBlockNumber);
+			}
+		}
+		else
+		{
+			ReleaseBuffer(buf);
+			RelationSetTargetBlock(rel, InvalidBlockNumber);
+		}
+	}
+
+	if (!fastpath)
+	{
+		/* find the first page containing this key */
+		stack = _bt_search(rel, natts, itup_scankey, false, &buf, BT_WRITE);
+
+		/* trade in our read lock for a write lock */
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBuffer(buf, BT_WRITE);
+
+		/*
+		 * If the page was split between the time that we surrendered our
+		 * read lock and acquired our write lock, then this page may no longer
+		 * be the right place for the key we want to insert.  In this case, we
+		 * need to move right in the tree.  See Lehman and Yao for an
+		 * excruciatingly precise description.
+		 */
+		buf = _bt_moveright(rel, buf, natts, itup_scankey, false, BT_WRITE);
+	}
 
 	/*
 	 * If we're not allowing duplicates, make sure the key isn't already in
@@ -183,7 +252,8 @@ top:
 		 */
 		CheckForSerializableConflictIn(rel, NULL, buf);
 		/* do the insertion */
-		_bt_findinsertloc(rel, &buf, &offset, natts, itup_scankey, itup, heapRel);
+		_bt_findinsertloc(rel, &buf, &offset, natts, itup_scankey, itup,
+						  indexUnchanged, heapRel);
 		_bt_insertonpg(rel, buf, stack, itup, offset, false);
 	}
 	else
@@ -221,7 +291,7 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
 				 IndexUniqueCheck checkUnique, bool *is_unique)
 {
 	TupleDesc	itupdesc = RelationGetDescr(rel);
-	int			natts = rel->rd_rel->relnatts;
+	int			natts = IndexRelationGetNumberOfKeyAttributes(rel);
 	SnapshotData SnapshotDirty;
 	OffsetNumber maxoff;
 	Page		page;
@@ -479,7 +549,9 @@ _bt_check_unique(Relation rel, IndexTuple itup, Relation heapRel,
  *		any existing equal keys because of the way _bt_binsrch() works.
  *
  *		If there's not enough room in the space, we try to make room by
- *		removing any LP_DEAD tuples.
+ *		removing any LP_DEAD tuples, then, if indexUnchanged says the new
+ *		tuple is just another version of an existing row, by removing equal
+ *		tuples whose heap rows are all dead.
  *
  *		On entry, *buf and *offsetptr point to the first legal position
  *		where the new tuple could be inserted.	The caller should hold an
@@ -500,6 +572,7 @@ _bt_findinsertloc(Relation rel,
 				  int keysz,
 				  ScanKey scankey,
 				  IndexTuple newtup,
+				  bool indexUnchanged,
 				  Relation heapRel)
 {
 	Buffer		buf = *bufptr;
@@ -577,6 +650,37 @@ _bt_findinsertloc(Relation rel,
 				break;			/* OK, now we have enough space */
 		}
 
+		/*
+		 * If the new tuple is another version of a row whose key didn't
+		 * change, the page is likely full of older versions of rows with this
+		 * key, which nobody has yet noticed to be dead.  Look for them now,
+		 * rather than split the page to keep them.
+		 */
+		if (P_ISLEAF(lpageop) && indexUnchanged &&
+			_bt_bottomup_delete(rel, buf, heapRel, keysz, scankey))
+		{
+			_bt_vacuum_one_page(rel, buf, heapRel);
+			vacuumed = true;
+
+			if (PageGetFreeSpace(page) >= itemsz)
+				break;			/* OK, now we have enough space */
+		}
+
+		/*
+		 * Next, see if merging duplicates into posting tuples frees enough
+		 * space.  Unique indexes don't have enough duplicates to make that
+		 * worthwhile, and _bt_check_unique doesn't expect posting tuples.
+		 */
+		if (P_ISLEAF(lpageop) && !rel->rd_index->indisunique &&
+			_bt_dedup_one_page(rel, buf))
+		{
+			/* the page was rewritten, so the hint is invalid here too */
+			vacuumed = true;
+
+			if (PageGetFreeSpace(page) >= itemsz)
+				break;			/* OK, now we have enough space */
+		}
+
 		/*
 		 * nope, so check conditions (b) and (c) enumerated above
 		 */
@@ -733,10 +837,18 @@ _bt_insertonpg(Relation rel,
 		BTMetaPageData *metad = NULL;
 		OffsetNumber itup_off;
 		BlockNumber itup_blkno;
+		BlockNumber cachedBlock = InvalidBlockNumber;
 
 		itup_off = newitemoff;
 		itup_blkno = BufferGetBlockNumber(buf);
 
+		/*
+		 * Remember a rightmost leaf we inserted into, for the fast path in
+		 * _bt_doinsert.  It's set below, after we've let go of the page.
+		 */
+		if (P_ISLEAF(lpageop) && P_RIGHTMOST(lpageop))
+			cachedBlock = itup_blkno;
+
 		/*
 		 * If we are doing this insert because we split a page that was the
 		 * only one on its tree level, but was not the root, it may have been
@@ -800,8 +912,9 @@ _bt_insertonpg(Relation rel,
 				xlinfo = XLOG_BTREE_INSERT_LEAF;
 			else
 			{
-				xldownlink = ItemPointerGetBlockNumber(&(itup->t_tid));
-				Assert(ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
+				xldownlink = BTreeInnerTupleGetDownLink(itup);
+				Assert(BTreeTupleIsTruncated(itup) ||
+					   ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
 
 				nextrdata->data = (char *) &xldownlink;
 				nextrdata->len = sizeof(BlockNumber);
@@ -868,6 +981,16 @@ _bt_insertonpg(Relation rel,
 		}
 
 		_bt_relbuf(rel, buf);
+
+		/*
+		 * The tree height comes from the metapage copy cached by
+		 * _bt_getroot; it may be a little stale, but that's fine for a
+		 * heuristic.
+		 */
+		if (cachedBlock != InvalidBlockNumber && rel->rd_amcache != NULL &&
+			((BTMetaPageData *) rel->rd_amcache)->btm_fastlevel >=
+			BTREE_FASTPATH_MIN_LEVEL)
+			RelationSetTargetBlock(rel, cachedBlock);
 	}
 }
 
@@ -989,7 +1112,12 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 	/*
 	 * The "high key" for the new left page will be the first key that's going
 	 * to go into the new right page.  This might be either the existing data
-	 * item at position firstright, or the incoming tuple.
+	 * item at position firstright, or the incoming tuple.  On the leaf level,
+	 * we pass it through _bt_truncate, which cuts off the columns that are
+	 * not needed to distinguish it from the last item staying on the left;
+	 * that also gets rid of any posting list.  Upper-level high keys are
+	 * copied from lower-level ones, so they are already as short as they can
+	 * be.
 	 */
 	leftoff = P_HIKEY;
 	if (!newitemonleft && newitemoff == firstright)
@@ -1005,6 +1133,23 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 		itemsz = ItemIdGetLength(itemid);
 		item = (IndexTuple) PageGetItem(origpage, itemid);
 	}
+	if (P_ISLEAF(oopaque))
+	{
+		IndexTuple	lastleft;
+
+		if (newitemonleft && newitemoff == firstright)
+		{
+			/* incoming tuple will become last on left page */
+			lastleft = newitem;
+		}
+		else
+		{
+			itemid = PageGetItemId(origpage, OffsetNumberPrev(firstright));
+			lastleft = (IndexTuple) PageGetItem(origpage, itemid);
+		}
+		item = _bt_truncate(rel, lastleft, item);
+		itemsz = MAXALIGN(IndexTupleSize(item));
+	}
 	if (PageAddItem(leftpage, (Item) item, itemsz, leftoff,
 					false, false) == InvalidOffsetNumber)
 	{
@@ -1206,24 +1351,25 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 			lastrdata->data = (char *) &newitem->t_tid.ip_blkid;
 			lastrdata->len = sizeof(BlockIdData);
 			lastrdata->buffer = InvalidBuffer;
+		}
 
-			/*
-			 * We must also log the left page's high key, because the right
-			 * page's leftmost key is suppressed on non-leaf levels.  Show it
-			 * as belonging to the left page buffer, so that it is not stored
-			 * if XLogInsert decides it needs a full-page image of the left
-			 * page.
-			 */
-			lastrdata->next = lastrdata + 1;
-			lastrdata++;
+		/*
+		 * We must also log the left page's high key, because the right page's
+		 * leftmost key is suppressed on non-leaf levels, and on the leaf level
+		 * the high key may have been truncated.  Show it as belonging to the
+		 * left page buffer, so that it is not stored if XLogInsert decides it
+		 * needs a full-page image of the left page.  This also ensures that
+		 * the left page is always backup block 1.
+		 */
+		lastrdata->next = lastrdata + 1;
+		lastrdata++;
 
-			itemid = PageGetItemId(origpage, P_HIKEY);
-			item = (IndexTuple) PageGetItem(origpage, itemid);
-			lastrdata->data = (char *) item;
-			lastrdata->len = MAXALIGN(IndexTupleSize(item));
-			lastrdata->buffer = buf;	/* backup block 1 */
-			lastrdata->buffer_std = true;
-		}
+		itemid = PageGetItemId(origpage, P_HIKEY);
+		item = (IndexTuple) PageGetItem(origpage, itemid);
+		lastrdata->data = (char *) item;
+		lastrdata->len = MAXALIGN(IndexTupleSize(item));
+		lastrdata->buffer = buf;	/* backup block 1 */
+		lastrdata->buffer_std = true;
 
 		/*
 		 * Log the new item and its offset, if it was inserted on the left
@@ -1251,22 +1397,6 @@ _bt_split(Relation rel, Buffer buf, OffsetNumber firstright,
 			lastrdata->buffer = buf;	/* backup block 1 */
 			lastrdata->buffer_std = true;
 		}
-		else if (ropaque->btpo.level == 0)
-		{
-			/*
-			 * Although we don't need to WAL-log the new item, we still need
-			 * XLogInsert to consider storing a full-page image of the left
-			 * page, so make an empty entry referencing that buffer. This also
-			 * ensures that the left page is always backup block 1.
-			 */
-			lastrdata->next = lastrdata + 1;
-			lastrdata++;
-
-			lastrdata->data = NULL;
-			lastrdata->len = 0;
-			lastrdata->buffer = buf;	/* backup block 1 */
-			lastrdata->buffer_std = true;
-		}
 
 		/*
 		 * Log the contents of the right page in the format understood by
@@ -1669,7 +1799,7 @@ _bt_insert_parent(Relation rel,
 
 		/* form an index tuple that points at the new right page */
 		new_item = CopyIndexTuple(ritem);
-		ItemPointerSet(&(new_item->t_tid), rbknum, P_HIKEY);
+		BTreeInnerTupleSetDownLink(new_item, rbknum);
 
 		/*
 		 * Find the parent buffer and get the parent page.
@@ -1909,7 +2039,7 @@ _bt_newroot(Relation rel, Buffer lbuf, Buffer rbuf)
 	itemsz = ItemIdGetLength(itemid);
 	item = (IndexTuple) PageGetItem(lpage, itemid);
 	new_item = CopyIndexTuple(item);
-	ItemPointerSet(&(new_item->t_tid), rbkno, P_HIKEY);
+	BTreeInnerTupleSetDownLink(new_item, rbkno);
 
 	/*
 	 * insert the right page pointer into the new root page.
@@ -1998,6 +2128,7 @@ _bt_pgaddtup(Page page,
 	{
 		trunctuple = *itup;
 		trunctuple.t_info = sizeof(IndexTupleData);
+		ItemPointerSetOffsetNumber(&trunctuple.t_tid, P_HIKEY);
 		itup = &trunctuple;
 		itemsize = sizeof(IndexTupleData);
 	}
@@ -2027,6 +2158,13 @@ _bt_isequal(TupleDesc itupdesc, Page page, OffsetNumber offnum,
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
 
+	/*
+	 * A truncated high key is less than every key that matches it on the
+	 * columns it still has, so it cannot equal a full-width key.
+	 */
+	if (BTreeTupleIsTruncated(itup))
+		return false;
+
 	for (i = 1; i <= keysz; i++)
 	{
 		AttrNumber	attno;
@@ -2101,3 +2239,144 @@ _bt_vacuum_one_page(Relation rel, Buffer buffer, Relation heapRel)
 	 * the page.
 	 */
 }
+
+/*
+ * _bt_bottomup_delete - mark dead versions of rows with the new key.
+ *
+ * An UPDATE that can't be HOT inserts a new entry into every index, even
+ * those whose key it didn't change, so these fill up with entries for old
+ * versions of the same rows, all with equal keys.  Index scans mark such
+ * entries LP_DEAD when they happen to visit them, but an index that's
+ * rarely scanned on those keys gets split again and again instead.  So
+ * before splitting a leaf page for such an insertion, we check the heap for
+ * the items on the page with the same key, and mark those whose HOT chains
+ * are dead to everyone LP_DEAD.  A posting tuple is only marked if all its
+ * heap TIDs are dead.  To keep the cost bounded we give up after visiting
+ * BT_BOTTOMUP_MAX_HEAP_TIDS heap TIDs.
+ *
+ * Returns true if any item was marked, in which case the caller should use
+ * _bt_vacuum_one_page to actually remove them.  The buffer must be
+ * exclusive-locked, as for _bt_vacuum_one_page.
+ */
+#define BT_BOTTOMUP_MAX_HEAP_TIDS	64
+
+static bool
+_bt_bottomup_delete(Relation rel, Buffer buffer, Relation heapRel,
+					int keysz, ScanKey scankey)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	Page		page = BufferGetPage(buffer);
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	SnapshotData SnapshotDirty;
+	OffsetNumber offnum,
+				maxoff;
+	int			nvisited = 0;
+	bool		marked = false;
+
+	InitDirtySnapshot(SnapshotDirty);
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = _bt_binsrch(rel, buffer, keysz, scankey, false);
+		 offnum <= maxoff && nvisited < BT_BOTTOMUP_MAX_HEAP_TIDS;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		IndexTuple	itup;
+		int			nhtids;
+		int			i;
+
+		if (ItemIdIsDead(itemid))
+			continue;
+
+		if (!_bt_isequal(itupdesc, page, offnum, keysz, scankey))
+			break;				/* we're past all the equal tuples */
+
+		itup = (IndexTuple) PageGetItem(page, itemid);
+		nhtids = BTreeTupleGetNHeapTids(itup);
+		for (i = 0; i < nhtids; i++)
+		{
+			ItemPointerData htid = *BTreeTupleGetHeapTid(itup, i);
+			bool		all_dead;
+
+			nvisited++;
+			if (heap_hot_search(&htid, heapRel, &SnapshotDirty, &all_dead) ||
+				!all_dead)
+				break;
+		}
+
+		/* did every heap TID of the item turn out dead? */
+		if (i == nhtids)
+		{
+			ItemIdMarkDead(itemid);
+			marked = true;
+		}
+	}
+
+	if (marked)
+	{
+		opaque->btpo_flags |= BTP_HAS_GARBAGE;
+		SetBufferCommitInfoNeedsSave(buffer);
+	}
+
+	return marked;
+}
+
+/*
+ * _bt_dedup_one_page - merge duplicates on one leaf page into posting tuples.
+ *
+ * Returns true if the page was changed.  The passed buffer must be
+ * exclusive-locked; as with _bt_vacuum_one_page, a cleanup lock is not
+ * needed, since every heap TID stays in the index.
+ */
+static bool
+_bt_dedup_one_page(Relation rel, Buffer buffer)
+{
+	Page		page = BufferGetPage(buffer);
+	Page		newpage;
+
+	newpage = _bt_dedup_build(page);
+	if (newpage == NULL)
+		return false;
+
+	/* No ereport(ERROR) until changes are logged */
+	START_CRIT_SECTION();
+
+	PageRestoreTempPage(newpage, page);
+
+	MarkBufferDirty(buffer);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(rel))
+	{
+		xl_btree_dedup xlrec;
+		XLogRecPtr	recptr;
+		XLogRecData rdata[2];
+
+		xlrec.node = rel->rd_node;
+		xlrec.block = BufferGetBlockNumber(buffer);
+
+		rdata[0].data = (char *) &xlrec;
+		rdata[0].len = SizeOfBtreeDedup;
+		rdata[0].buffer = InvalidBuffer;
+		rdata[0].next = &(rdata[1]);
+
+		/*
+		 * Redo repeats the pass on the old page contents, so all we need is
+		 * to give XLogInsert the chance to take a full-page image.
+		 */
+		rdata[1].data = NULL;
+		rdata[1].len = 0;
+		rdata[1].buffer = buffer;
+		rdata[1].buffer_std = true;
+		rdata[1].next = NULL;
+
+		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_DEDUP, rdata);
+
+		PageSetLSN(page, recptr);
+		PageSetTLI(page, ThisTimeLineID);
+	}
+
+	END_CRIT_SECTION();
+
+	return true;
+}
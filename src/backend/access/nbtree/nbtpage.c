@@ -724,6 +724,10 @@ _bt_page_recyclable(Page page)
  * This routine assumes that the caller has pinned and locked the buffer.
  * Also, the given itemnos *must* appear in increasing order in the array.
  *
+ * updatenos and updated give posting tuples that lost only some of their
+ * heap TIDs, and the smaller tuples to replace them with.  None of them may
+ * also appear in itemnos.
+ *
  * We record VACUUMs and b-tree deletes differently in WAL. InHotStandby
  * we need to be able to pin all of the blocks in the btree in physical
  * order when replaying the effects of a VACUUM, just as we do for the
@@ -736,15 +740,55 @@ _bt_page_recyclable(Page page)
  */
 void
 _bt_delitems_vacuum(Relation rel, Buffer buf,
-			OffsetNumber *itemnos, int nitems, BlockNumber lastBlockVacuumed)
+					OffsetNumber *itemnos, int nitems,
+					OffsetNumber *updatenos, IndexTuple *updated, int nupdated,
+					BlockNumber lastBlockVacuumed)
 {
 	Page		page = BufferGetPage(buf);
 	BTPageOpaque opaque;
+	char	   *updatedbuf = NULL;
+	Size		updatedbuflen = 0;
+	int			i;
+
+	/*
+	 * Gather the replacement tuples into one chunk for the WAL record.  Do
+	 * it now, since we can't palloc inside the critical section.
+	 */
+	if (nupdated > 0 && RelationNeedsWAL(rel))
+	{
+		Size		offset = 0;
+
+		for (i = 0; i < nupdated; i++)
+			updatedbuflen += MAXALIGN(IndexTupleSize(updated[i]));
+		updatedbuf = palloc(updatedbuflen);
+		for (i = 0; i < nupdated; i++)
+		{
+			Size		itemsz = MAXALIGN(IndexTupleSize(updated[i]));
+
+			memcpy(updatedbuf + offset, updated[i], itemsz);
+			offset += itemsz;
+		}
+	}
 
 	/* No ereport(ERROR) until changes are logged */
 	START_CRIT_SECTION();
 
-	/* Fix the page */
+	/*
+	 * Fix the page.  Replace the updated tuples first: deleting and re-adding
+	 * an item at the same offset leaves all the other item numbers, which
+	 * itemnos refers to, unchanged.
+	 */
+	for (i = 0; i < nupdated; i++)
+	{
+		Size		itemsz = MAXALIGN(IndexTupleSize(updated[i]));
+
+		PageIndexTupleDelete(page, updatenos[i]);
+		if (PageAddItem(page, (Item) updated[i], itemsz, updatenos[i],
+						false, false) == InvalidOffsetNumber)
+			elog(PANIC, "failed to add updated item to index page in \"%s\"",
+				 RelationGetRelationName(rel));
+	}
+
 	if (nitems > 0)
 		PageIndexMultiDelete(page, itemnos, nitems);
 
@@ -770,7 +814,7 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	if (RelationNeedsWAL(rel))
 	{
 		XLogRecPtr	recptr;
-		XLogRecData rdata[2];
+		XLogRecData rdata[4];
 
 		xl_btree_vacuum xlrec_vacuum;
 
@@ -778,6 +822,8 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		xlrec_vacuum.block = BufferGetBlockNumber(buf);
 
 		xlrec_vacuum.lastBlockVacuumed = lastBlockVacuumed;
+		xlrec_vacuum.ndeleted = nitems;
+		xlrec_vacuum.nupdated = nupdated;
 		rdata[0].data = (char *) &xlrec_vacuum;
 		rdata[0].len = SizeOfBtreeVacuum;
 		rdata[0].buffer = InvalidBuffer;
@@ -786,7 +832,7 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		/*
 		 * The target-offsets array is not in the buffer, but pretend that it
 		 * is.	When XLogInsert stores the whole buffer, the offsets array
-		 * need not be stored too.
+		 * need not be stored too.  Likewise for the updated tuples.
 		 */
 		if (nitems > 0)
 		{
@@ -802,6 +848,23 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 		rdata[1].buffer_std = true;
 		rdata[1].next = NULL;
 
+		if (nupdated > 0)
+		{
+			rdata[1].next = &(rdata[2]);
+
+			rdata[2].data = (char *) updatenos;
+			rdata[2].len = nupdated * sizeof(OffsetNumber);
+			rdata[2].buffer = buf;
+			rdata[2].buffer_std = true;
+			rdata[2].next = &(rdata[3]);
+
+			rdata[3].data = updatedbuf;
+			rdata[3].len = updatedbuflen;
+			rdata[3].buffer = buf;
+			rdata[3].buffer_std = true;
+			rdata[3].next = NULL;
+		}
+
 		recptr = XLogInsert(RM_BTREE_ID, XLOG_BTREE_VACUUM, rdata);
 
 		PageSetLSN(page, recptr);
@@ -809,6 +872,9 @@ _bt_delitems_vacuum(Relation rel, Buffer buf,
 	}
 
 	END_CRIT_SECTION();
+
+	if (updatedbuf != NULL)
+		pfree(updatedbuf);
 }
 
 void
@@ -1068,11 +1134,14 @@ _bt_pagedel(Relation rel, Buffer buf, BTStack stack)
 	{
 		if (!InRecovery)
 		{
-			/* we need an insertion scan key to do our search, so build one */
+			/*
+			 * We need an insertion scan key to do our search, so build one.
+			 * A truncated high key provides only its leading columns.
+			 */
 			itup_scankey = _bt_mkscankey(rel, targetkey);
 			/* find the leftmost leaf page containing this key */
-			stack = _bt_search(rel, rel->rd_rel->relnatts, itup_scankey, false,
-							   &lbuf, BT_READ);
+			stack = _bt_search(rel, BTreeTupleGetNAtts(targetkey, rel),
+							   itup_scankey, false, &lbuf, BT_READ);
 			/* don't need a pin on that either */
 			_bt_relbuf(rel, lbuf);
 
@@ -1337,7 +1406,7 @@ _bt_pagedel(Relation rel, Buffer buf, BTStack stack)
 
 		itemid = PageGetItemId(page, poffset);
 		itup = (IndexTuple) PageGetItem(page, itemid);
-		ItemPointerSet(&(itup->t_tid), rightsib, P_HIKEY);
+		BTreeInnerTupleSetDownLink(itup, rightsib);
 
 		nextoffset = OffsetNumberNext(poffset);
 		PageIndexTupleDelete(page, nextoffset);
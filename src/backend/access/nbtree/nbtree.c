@@ -21,7 +21,10 @@
 #include "access/nbtree.h"
 #include "access/relscan.h"
 #include "catalog/index.h"
+#include "commands/progress.h"
 #include "commands/vacuum.h"
+#include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/indexfsm.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
@@ -87,6 +90,8 @@ btbuild(PG_FUNCTION_ARGS)
 	IndexBuildResult *result;
 	double		reltuples;
 	BTBuildState buildstate;
+	BlockNumber nblocks;
+	int			nparts;
 
 	buildstate.isUnique = indexInfo->ii_Unique;
 	buildstate.haveDead = false;
@@ -108,27 +113,98 @@ btbuild(PG_FUNCTION_ARGS)
 		elog(ERROR, "index \"%s\" already contains data",
 			 RelationGetRelationName(index));
 
-	buildstate.spool = _bt_spoolinit(index, indexInfo->ii_Unique, false);
-
 	/*
-	 * If building a unique index, put dead tuples in a second spool to keep
-	 * them out of the uniqueness check.
+	 * Decide how many parts to divide the heap into.  Each part is scanned
+	 * into spools of its own, which are sorted separately and merged as the
+	 * leaf level is written.  Concurrent builds must see the whole heap
+	 * through a single snapshot, so they always use one part.
 	 */
-	if (indexInfo->ii_Unique)
-		buildstate.spool2 = _bt_spoolinit(index, false, true);
+	nblocks = RelationGetNumberOfBlocks(heap);
+	nparts = btree_build_partitions;
+	if (indexInfo->ii_Concurrent || IsBootstrapProcessingMode())
+		nparts = 1;
+	if ((BlockNumber) nparts > nblocks)
+		nparts = Max(nblocks, 1);
+
+	if (nparts == 1)
+	{
+		buildstate.spool = _bt_spoolinit(index, indexInfo->ii_Unique,
+										 false, 1);
+
+		/*
+		 * If building a unique index, put dead tuples in a second spool to
+		 * keep them out of the uniqueness check.
+		 */
+		if (indexInfo->ii_Unique)
+			buildstate.spool2 = _bt_spoolinit(index, false, true, 1);
 
-	/* do the heap scan */
-	reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
-								   btbuildCallback, (void *) &buildstate);
+		/* do the heap scan */
+		reltuples = IndexBuildHeapScan(heap, index, indexInfo, true,
+									   btbuildCallback, (void *) &buildstate);
 
-	/* okay, all heap tuples are indexed */
-	if (buildstate.spool2 && !buildstate.haveDead)
+		/* okay, all heap tuples are indexed */
+		if (buildstate.spool2 && !buildstate.haveDead)
+		{
+			/* spool2 turns out to be unnecessary */
+			_bt_spooldestroy(buildstate.spool2);
+			buildstate.spool2 = NULL;
+		}
+	}
+	else
 	{
-		/* spool2 turns out to be unnecessary */
-		_bt_spooldestroy(buildstate.spool2);
+		BTSpool   **parts;
+		BTSpool   **parts2 = NULL;
+		int			i;
+
+		parts = (BTSpool **) palloc(nparts * sizeof(BTSpool *));
+		if (indexInfo->ii_Unique)
+			parts2 = (BTSpool **) palloc(nparts * sizeof(BTSpool *));
+
+		reltuples = 0;
+		for (i = 0; i < nparts; i++)
+		{
+			BlockNumber startblk = (BlockNumber) ((uint64) nblocks * i / nparts);
+			BlockNumber endblk = (BlockNumber) ((uint64) nblocks * (i + 1) / nparts);
+
+			parts[i] = _bt_spoolinit(index, indexInfo->ii_Unique,
+									 false, nparts);
+			buildstate.spool = parts[i];
+			if (parts2)
+			{
+				parts2[i] = _bt_spoolinit(index, false, true, nparts);
+				buildstate.spool2 = parts2[i];
+			}
+
+			/*
+			 * Every part, the last included, must give its block count: a
+			 * scan without one would wrap around to block 0 and visit the
+			 * earlier parts' blocks again.
+			 */
+			reltuples += IndexBuildHeapRangeScan(heap, index, indexInfo, false,
+												 startblk,
+												 endblk - startblk,
+												 btbuildCallback,
+												 (void *) &buildstate);
+		}
+
+		buildstate.spool = _bt_spoolmerge(parts, nparts);
 		buildstate.spool2 = NULL;
+		if (parts2)
+		{
+			if (buildstate.haveDead)
+				buildstate.spool2 = _bt_spoolmerge(parts2, nparts);
+			else
+			{
+				for (i = 0; i < nparts; i++)
+					_bt_spooldestroy(parts2[i]);
+				pfree(parts2);
+			}
+		}
 	}
 
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL,
+								 buildstate.indtuples);
+
 	/*
 	 * Finish the build by (1) completing the sort of the spool file, (2)
 	 * inserting the sorted tuples into btree pages and (3) building the upper
@@ -247,6 +323,7 @@ btinsert(PG_FUNCTION_ARGS)
 	ItemPointer ht_ctid = (ItemPointer) PG_GETARG_POINTER(3);
 	Relation	heapRel = (Relation) PG_GETARG_POINTER(4);
 	IndexUniqueCheck checkUnique = (IndexUniqueCheck) PG_GETARG_INT32(5);
+	bool		indexUnchanged = PG_GETARG_BOOL(6);
 	bool		result;
 	IndexTuple	itup;
 
@@ -254,7 +331,7 @@ btinsert(PG_FUNCTION_ARGS)
 	itup = index_form_tuple(RelationGetDescr(rel), values, isnull);
 	itup->t_tid = *ht_ctid;
 
-	result = _bt_doinsert(rel, itup, checkUnique, heapRel);
+	result = _bt_doinsert(rel, itup, checkUnique, indexUnchanged, heapRel);
 
 	pfree(itup);
 
@@ -289,7 +366,21 @@ btgettuple(PG_FUNCTION_ARGS)
 		_bt_start_array_keys(scan, dir);
 	}
 
-	/* This loop handles advancing to the next array elements, if any */
+	/*
+	 * Likewise, a skip scan has to find its first leading-column value
+	 * before the first primitive scan.
+	 */
+	if (so->skipScan && !BTScanPosIsValid(so->currPos))
+	{
+		so->skipHaveValue = false;
+		if (!_bt_skip_advance(scan, dir))
+			PG_RETURN_BOOL(false);
+	}
+
+	/*
+	 * This loop handles advancing to the next array elements, or the next
+	 * leading-column value of a skip scan, if any
+	 */
 	do
 	{
 		/*
@@ -317,8 +408,8 @@ btgettuple(PG_FUNCTION_ARGS)
 				 */
 				if (so->killedItems == NULL)
 					so->killedItems = (int *)
-						palloc(MaxIndexTuplesPerPage * sizeof(int));
-				if (so->numKilled < MaxIndexTuplesPerPage)
+						palloc(MaxTIDsPerBTreePage * sizeof(int));
+				if (so->numKilled < MaxTIDsPerBTreePage)
 					so->killedItems[so->numKilled++] = so->currPos.itemIndex;
 			}
 
@@ -332,7 +423,8 @@ btgettuple(PG_FUNCTION_ARGS)
 		if (res)
 			break;
 		/* ... otherwise see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, dir));
+	} while ((so->numArrayKeys && _bt_advance_array_keys(scan, dir)) ||
+			 (so->skipScan && _bt_skip_advance(scan, dir)));
 
 	PG_RETURN_BOOL(res);
 }
@@ -361,6 +453,14 @@ btgetbitmap(PG_FUNCTION_ARGS)
 		_bt_start_array_keys(scan, ForwardScanDirection);
 	}
 
+	/* Likewise for the leading-column value of a skip scan */
+	if (so->skipScan)
+	{
+		so->skipHaveValue = false;
+		if (!_bt_skip_advance(scan, ForwardScanDirection))
+			PG_RETURN_INT64(ntids);
+	}
+
 	/* This loop handles advancing to the next array elements, if any */
 	do
 	{
@@ -391,8 +491,11 @@ btgetbitmap(PG_FUNCTION_ARGS)
 				ntids++;
 			}
 		}
-		/* Now see if we have more array keys to deal with */
-	} while (so->numArrayKeys && _bt_advance_array_keys(scan, ForwardScanDirection));
+		/* Now see if we have more array keys or skip values to deal with */
+	} while ((so->numArrayKeys &&
+			  _bt_advance_array_keys(scan, ForwardScanDirection)) ||
+			 (so->skipScan &&
+			  _bt_skip_advance(scan, ForwardScanDirection)));
 
 	PG_RETURN_INT64(ntids);
 }
@@ -418,8 +521,9 @@ btbeginscan(PG_FUNCTION_ARGS)
 	/* allocate private workspace */
 	so = (BTScanOpaque) palloc(sizeof(BTScanOpaqueData));
 	so->currPos.buf = so->markPos.buf = InvalidBuffer;
+	/* leave room for the extra leading-column key of a skip scan */
 	if (scan->numberOfKeys > 0)
-		so->keyData = (ScanKey) palloc(scan->numberOfKeys * sizeof(ScanKeyData));
+		so->keyData = (ScanKey) palloc((scan->numberOfKeys + 1) * sizeof(ScanKeyData));
 	else
 		so->keyData = NULL;
 
@@ -428,6 +532,11 @@ btbeginscan(PG_FUNCTION_ARGS)
 	so->arrayKeys = NULL;
 	so->arrayContext = NULL;
 
+	so->skipScan = false;		/* likewise for skip scan */
+	so->skipHaveValue = false;
+	so->skipKeyData = NULL;
+	so->markSkipValid = false;
+
 	so->killedItems = NULL;		/* until needed */
 	so->numKilled = 0;
 
@@ -498,6 +607,27 @@ btrescan(PG_FUNCTION_ARGS)
 		so->markTuples = so->currTuples + BLCKSZ;
 	}
 
+	/*
+	 * Likewise set up read-ahead of the heap blocks that our TIDs point to,
+	 * if prefetching is enabled; _bt_readpage queues them.  Index-only scans
+	 * mostly don't visit the heap, so they don't bother.
+	 */
+	if (scan->heapRelation != NULL && !scan->xs_want_itup &&
+		scan->xs_readstream == NULL)
+	{
+		int			distance = index_prefetch_distance;
+
+		if (distance < 0)
+			distance = target_prefetch_pages;
+		if (distance > 0)
+			scan->xs_readstream = ReadStreamCreate(scan->heapRelation,
+												   MAIN_FORKNUM,
+												   MaxTIDsPerBTreePage,
+												   distance);
+	}
+	if (scan->xs_readstream != NULL)
+		ReadStreamReset(scan->xs_readstream);
+
 	/*
 	 * Reset the scan keys. Note that keys ordering stuff moved to _bt_first.
 	 * - vadim 05/05/97
@@ -511,6 +641,9 @@ btrescan(PG_FUNCTION_ARGS)
 	/* If any keys are SK_SEARCHARRAY type, set up array-key info */
 	_bt_preprocess_array_keys(scan);
 
+	/* See whether we can skip over distinct leading-column values */
+	_bt_preprocess_skip_key(scan);
+
 	PG_RETURN_VOID();
 }
 
@@ -551,6 +684,11 @@ btendscan(PG_FUNCTION_ARGS)
 	if (so->currTuples != NULL)
 		pfree(so->currTuples);
 	/* so->markTuples should not be pfree'd, see btrescan */
+	if (scan->xs_readstream != NULL)
+	{
+		ReadStreamFree(scan->xs_readstream);
+		scan->xs_readstream = NULL;
+	}
 	pfree(so);
 
 	PG_RETURN_VOID();
@@ -583,6 +721,10 @@ btmarkpos(PG_FUNCTION_ARGS)
 	else
 		so->markItemIndex = -1;
 
+	/* A skip scan must also remember which leading-column value it was on */
+	if (so->skipScan)
+		_bt_mark_skip_value(scan);
+
 	PG_RETURN_VOID();
 }
 
@@ -595,6 +737,10 @@ btrestrpos(PG_FUNCTION_ARGS)
 	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
 	BTScanOpaque so = (BTScanOpaque) scan->opaque;
 
+	/* the queued heap blocks no longer match what we'll return next */
+	if (scan->xs_readstream != NULL)
+		ReadStreamReset(scan->xs_readstream);
+
 	if (so->markItemIndex >= 0)
 	{
 		/*
@@ -626,6 +772,10 @@ btrestrpos(PG_FUNCTION_ARGS)
 			if (so->currTuples)
 				memcpy(so->currTuples, so->markTuples,
 					   so->markPos.nextTupleOffset);
+
+			/* the mark may belong to an earlier skip-scan primitive scan */
+			if (so->skipScan)
+				_bt_restore_skip_value(scan);
 		}
 	}
 
@@ -737,6 +887,9 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 	BlockNumber num_pages;
 	BlockNumber blkno;
 	bool		needLock;
+#ifdef USE_PREFETCH
+	BlockNumber prefetch_blkno;
+#endif
 
 	/*
 	 * Reset counts that will be incremented during the scan; needed in case
@@ -789,6 +942,9 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 	needLock = !RELATION_IS_LOCAL(rel);
 
 	blkno = BTREE_METAPAGE + 1;
+#ifdef USE_PREFETCH
+	prefetch_blkno = blkno;
+#endif
 	for (;;)
 	{
 		/* Get the current relation length */
@@ -804,6 +960,20 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 		/* Iterate over pages, then loop back to recheck length */
 		for (; blkno < num_pages; blkno++)
 		{
+#ifdef USE_PREFETCH
+
+			/*
+			 * Keep up to effective_io_concurrency reads in flight ahead of
+			 * us.  Kernel read-ahead alone issues one stream at a time, which
+			 * leaves most spindles of a striped array idle while we plod
+			 * through a large index.
+			 */
+			if (prefetch_blkno <= blkno)
+				prefetch_blkno = blkno + 1;
+			while (prefetch_blkno < num_pages &&
+				   prefetch_blkno <= blkno + target_prefetch_pages)
+				PrefetchBuffer(rel, MAIN_FORKNUM, prefetch_blkno++);
+#endif
 			btvacuumpage(&vstate, blkno, blkno);
 		}
 	}
@@ -830,7 +1000,8 @@ btvacuumscan(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
 		buf = ReadBufferExtended(rel, MAIN_FORKNUM, num_pages - 1, RBM_NORMAL,
 								 info->strategy);
 		LockBufferForCleanup(buf);
-		_bt_delitems_vacuum(rel, buf, NULL, 0, vstate.lastBlockVacuumed);
+		_bt_delitems_vacuum(rel, buf, NULL, 0, NULL, NULL, 0,
+							vstate.lastBlockVacuumed);
 		_bt_relbuf(rel, buf);
 	}
 
@@ -930,6 +1101,11 @@ restart:
 	{
 		OffsetNumber deletable[MaxOffsetNumber];
 		int			ndeletable;
+		OffsetNumber updatable[MaxIndexTuplesPerPage];
+		IndexTuple	updated[MaxIndexTuplesPerPage];
+		int			nupdatable;
+		ItemPointerData remaining[MaxTIDsPerBTreePage];
+		double		nremoved;
 		OffsetNumber offnum,
 					minoff,
 					maxoff;
@@ -962,6 +1138,8 @@ restart:
 		 * callback function.
 		 */
 		ndeletable = 0;
+		nupdatable = 0;
+		nremoved = 0;
 		minoff = P_FIRSTDATAKEY(opaque);
 		maxoff = PageGetMaxOffsetNumber(page);
 		if (callback)
@@ -972,6 +1150,9 @@ restart:
 			{
 				IndexTuple	itup;
 				ItemPointer htup;
+				int			nposting;
+				int			nremaining;
+				int			i;
 
 				itup = (IndexTuple) PageGetItem(page,
 												PageGetItemId(page, offnum));
@@ -998,8 +1179,40 @@ restart:
 				 * applies to *any* type of index that marks index tuples as
 				 * killed.
 				 */
-				if (callback(htup, callback_state))
+				if (!BTreeTupleIsPosting(itup))
+				{
+					if (callback(htup, callback_state))
+					{
+						deletable[ndeletable++] = offnum;
+						nremoved++;
+					}
+					continue;
+				}
+
+				/*
+				 * For a posting tuple, ask about each heap TID.  If they are
+				 * all dead, delete the tuple; if only some are, replace it
+				 * with a tuple holding just the survivors.
+				 */
+				nposting = BTreeTupleGetNPosting(itup);
+				nremaining = 0;
+				for (i = 0; i < nposting; i++)
+				{
+					htup = BTreeTupleGetPostingN(itup, i);
+					if (!callback(htup, callback_state))
+						remaining[nremaining++] = *htup;
+				}
+
+				if (nremaining == 0)
 					deletable[ndeletable++] = offnum;
+				else if (nremaining < nposting)
+				{
+					updatable[nupdatable] = offnum;
+					updated[nupdatable] = _bt_form_posting(itup, remaining,
+														   nremaining);
+					nupdatable++;
+				}
+				nremoved += nposting - nremaining;
 			}
 		}
 
@@ -1007,11 +1220,17 @@ restart:
 		 * Apply any needed deletes.  We issue just one _bt_delitems() call
 		 * per page, so as to minimize WAL traffic.
 		 */
-		if (ndeletable > 0)
+		if (ndeletable > 0 || nupdatable > 0)
 		{
 			BlockNumber lastBlockVacuumed = BufferGetBlockNumber(buf);
+			int			i;
+
+			_bt_delitems_vacuum(rel, buf, deletable, ndeletable,
+								updatable, updated, nupdatable,
+								vstate->lastBlockVacuumed);
 
-			_bt_delitems_vacuum(rel, buf, deletable, ndeletable, vstate->lastBlockVacuumed);
+			for (i = 0; i < nupdatable; i++)
+				pfree(updated[i]);
 
 			/*
 			 * Keep track of the block number of the lastBlockVacuumed, so we
@@ -1022,7 +1241,7 @@ restart:
 			if (lastBlockVacuumed > vstate->lastBlockVacuumed)
 				vstate->lastBlockVacuumed = lastBlockVacuumed;
 
-			stats->tuples_removed += ndeletable;
+			stats->tuples_removed += nremoved;
 			/* must recompute maxoff */
 			maxoff = PageGetMaxOffsetNumber(page);
 		}
@@ -1054,7 +1273,19 @@ restart:
 		if (minoff > maxoff)
 			delete_now = (blkno == orig_blkno);
 		else
-			stats->num_index_tuples += maxoff - minoff + 1;
+		{
+			/* count heap TIDs, not tuples, to compare with the heap */
+			for (offnum = minoff;
+				 offnum <= maxoff;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				IndexTuple	itup;
+
+				itup = (IndexTuple) PageGetItem(page,
+												PageGetItemId(page, offnum));
+				stats->num_index_tuples += BTreeTupleGetNHeapTids(itup);
+			}
+		}
 	}
 
 	if (delete_now)
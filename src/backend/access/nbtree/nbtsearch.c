@@ -28,6 +28,7 @@ static bool _bt_readpage(IndexScanDesc scan, ScanDirection dir,
 			 OffsetNumber offnum);
 static void _bt_saveitem(BTScanOpaque so, int itemIndex,
 			 OffsetNumber offnum, IndexTuple itup);
+static void _bt_queue_heap_blocks(IndexScanDesc scan, ScanDirection dir);
 static bool _bt_steppage(IndexScanDesc scan, ScanDirection dir);
 static Buffer _bt_walk_left(Relation rel, Buffer buf);
 static bool _bt_endpoint(IndexScanDesc scan, ScanDirection dir);
@@ -345,6 +346,7 @@ _bt_compare(Relation rel,
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
 	IndexTuple	itup;
+	int			ntupatts;
 	int			i;
 
 	/*
@@ -355,6 +357,7 @@ _bt_compare(Relation rel,
 		return 1;
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	ntupatts = BTreeTupleGetNAtts(itup, rel);
 
 	/*
 	 * The scan key is set up with the attribute number associated with each
@@ -374,6 +377,13 @@ _bt_compare(Relation rel,
 		bool		isNull;
 		int32		result;
 
+		/*
+		 * Columns cut off a truncated pivot are minus infinity, so once the
+		 * scan key matches all the columns the pivot has, it is greater.
+		 */
+		if (scankey->sk_attno > ntupatts)
+			return 1;
+
 		datum = index_getattr(itup, scankey->sk_attno, itupdesc, &isNull);
 
 		/* see comments about NULLs handling in btbuild */
@@ -1096,7 +1106,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			{
 				/* tuple passes all scan key conditions, so remember it */
 				_bt_saveitem(so, itemIndex, offnum, itup);
-				itemIndex++;
+				itemIndex += BTreeTupleGetNHeapTids(itup);
 			}
 			if (!continuescan)
 			{
@@ -1108,7 +1118,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			offnum = OffsetNumberNext(offnum);
 		}
 
-		Assert(itemIndex <= MaxIndexTuplesPerPage);
+		Assert(itemIndex <= MaxTIDsPerBTreePage);
 		so->currPos.firstItem = 0;
 		so->currPos.lastItem = itemIndex - 1;
 		so->currPos.itemIndex = 0;
@@ -1116,7 +1126,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 	else
 	{
 		/* load items[] in descending order */
-		itemIndex = MaxIndexTuplesPerPage;
+		itemIndex = MaxTIDsPerBTreePage;
 
 		offnum = Min(offnum, maxoff);
 
@@ -1126,7 +1136,7 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 			if (itup != NULL)
 			{
 				/* tuple passes all scan key conditions, so remember it */
-				itemIndex--;
+				itemIndex -= BTreeTupleGetNHeapTids(itup);
 				_bt_saveitem(so, itemIndex, offnum, itup);
 			}
 			if (!continuescan)
@@ -1141,30 +1151,98 @@ _bt_readpage(IndexScanDesc scan, ScanDirection dir, OffsetNumber offnum)
 
 		Assert(itemIndex >= 0);
 		so->currPos.firstItem = itemIndex;
-		so->currPos.lastItem = MaxIndexTuplesPerPage - 1;
-		so->currPos.itemIndex = MaxIndexTuplesPerPage - 1;
+		so->currPos.lastItem = MaxTIDsPerBTreePage - 1;
+		so->currPos.itemIndex = MaxTIDsPerBTreePage - 1;
+	}
+
+	if (scan->xs_readstream != NULL)
+	{
+		_bt_queue_heap_blocks(scan, dir);
+
+		/*
+		 * Also start reading the sibling leaf page we'll go to next, so that
+		 * stepping to it doesn't stall the read-ahead.
+		 */
+		if (ScanDirectionIsForward(dir))
+		{
+			if (so->currPos.moreRight && !P_RIGHTMOST(opaque))
+				PrefetchBuffer(scan->indexRelation, MAIN_FORKNUM,
+							   opaque->btpo_next);
+		}
+		else
+		{
+			if (so->currPos.moreLeft && !P_LEFTMOST(opaque))
+				PrefetchBuffer(scan->indexRelation, MAIN_FORKNUM,
+							   opaque->btpo_prev);
+		}
 	}
 
 	return (so->currPos.firstItem <= so->currPos.lastItem);
 }
 
-/* Save an index item into so->currPos.items[itemIndex] */
+/*
+ * Queue the heap blocks of the items just loaded into so->currPos, in the
+ * order the scan will return them, for read-ahead by index_fetch_heap.
+ */
+static void
+_bt_queue_heap_blocks(IndexScanDesc scan, ScanDirection dir)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	ReadStream *stream = scan->xs_readstream;
+	int			i;
+
+	ReadStreamReset(stream);
+
+	if (ScanDirectionIsForward(dir))
+	{
+		for (i = so->currPos.firstItem; i <= so->currPos.lastItem; i++)
+		{
+			if (!ReadStreamQueue(stream,
+						ItemPointerGetBlockNumber(&so->currPos.items[i].heapTid)))
+				break;
+		}
+	}
+	else
+	{
+		for (i = so->currPos.lastItem; i >= so->currPos.firstItem; i--)
+		{
+			if (!ReadStreamQueue(stream,
+						ItemPointerGetBlockNumber(&so->currPos.items[i].heapTid)))
+				break;
+		}
+	}
+}
+
+/*
+ * Save an index item into so->currPos.items[itemIndex].  A posting tuple
+ * fills one entry per heap TID, starting there, in TID order; its tuple is
+ * saved just once.
+ */
 static void
 _bt_saveitem(BTScanOpaque so, int itemIndex,
 			 OffsetNumber offnum, IndexTuple itup)
 {
-	BTScanPosItem *currItem = &so->currPos.items[itemIndex];
+	int			nhtids = BTreeTupleGetNHeapTids(itup);
+	LocationIndex tupleOffset = 0;
+	int			i;
 
-	currItem->heapTid = itup->t_tid;
-	currItem->indexOffset = offnum;
 	if (so->currTuples)
 	{
 		Size		itupsz = IndexTupleSize(itup);
 
-		currItem->tupleOffset = so->currPos.nextTupleOffset;
+		tupleOffset = so->currPos.nextTupleOffset;
 		memcpy(so->currTuples + so->currPos.nextTupleOffset, itup, itupsz);
 		so->currPos.nextTupleOffset += MAXALIGN(itupsz);
 	}
+
+	for (i = 0; i < nhtids; i++)
+	{
+		BTScanPosItem *currItem = &so->currPos.items[itemIndex + i];
+
+		currItem->heapTid = *BTreeTupleGetHeapTid(itup, i);
+		currItem->indexOffset = offnum;
+		currItem->tupleOffset = tupleOffset;
+	}
 }
 
 /*
@@ -1602,3 +1680,133 @@ _bt_endpoint(IndexScanDesc scan, ScanDirection dir)
 
 	return true;
 }
+
+/*
+ *	_bt_skip_advance() -- Find the next leading-column value for a skip scan
+ *
+ * Locate the first index entry whose leading-column value is beyond the
+ * skip scan's current value, in the given scan direction, and install its
+ * value as the argument of the scan's leading-column "=" key.  If the scan
+ * has no current value yet, we start from the appropriate end of the index.
+ * The caller then runs a new primitive scan with _bt_first().
+ *
+ * Returns false if there are no more leading-column values to visit.
+ */
+bool
+_bt_skip_advance(IndexScanDesc scan, ScanDirection dir)
+{
+	Relation	rel = scan->indexRelation;
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Buffer		buf;
+	Page		page;
+	BTPageOpaque opaque;
+	OffsetNumber offnum;
+	IndexTuple	itup;
+	Datum		value;
+	bool		isnull;
+
+	Assert(so->skipScan);
+
+	if (!so->skipHaveValue)
+	{
+		/* Start of scan: begin at the first or last leaf page */
+		buf = _bt_get_endpoint(rel, 0, ScanDirectionIsBackward(dir));
+		if (!BufferIsValid(buf))
+		{
+			/* Empty index; lock the whole relation, as _bt_endpoint does */
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+		if (ScanDirectionIsForward(dir))
+			offnum = P_FIRSTDATAKEY(opaque);
+		else
+			offnum = PageGetMaxOffsetNumber(page);
+	}
+	else
+	{
+		ScanKey		cur = &so->skipKeyData[0];
+		ScanKeyData skey;
+		BTStack		stack;
+		bool		nextkey;
+		int			flags;
+
+		/*
+		 * Build a one-column insertion scankey for the current value.  For a
+		 * forward scan we want the first item > that value; for a backward
+		 * scan, the last item < that value, which is just before the first
+		 * item >= it.
+		 */
+		flags = (rel->rd_indoption[0] << SK_BT_INDOPTION_SHIFT);
+		if (cur->sk_flags & SK_ISNULL)
+			flags |= SK_ISNULL;
+		ScanKeyEntryInitializeWithInfo(&skey,
+									   flags,
+									   1,
+									   InvalidStrategy,
+									   InvalidOid,
+									   rel->rd_indcollation[0],
+									   index_getprocinfo(rel, 1, BTORDER_PROC),
+									   cur->sk_argument);
+
+		nextkey = ScanDirectionIsForward(dir);
+		stack = _bt_search(rel, 1, &skey, nextkey, &buf, BT_READ);
+		_bt_freestack(stack);
+		if (!BufferIsValid(buf))
+		{
+			PredicateLockRelation(rel, scan->xs_snapshot);
+			return false;
+		}
+		offnum = _bt_binsrch(rel, buf, 1, &skey, nextkey);
+		if (ScanDirectionIsBackward(dir))
+			offnum = OffsetNumberPrev(offnum);
+	}
+
+	/*
+	 * We may have landed just past the end of a page (or before the start of
+	 * one, going backwards), so step to a neighboring page until we find an
+	 * item.
+	 */
+	for (;;)
+	{
+		PredicateLockPage(rel, BufferGetBlockNumber(buf), scan->xs_snapshot);
+		page = BufferGetPage(buf);
+		opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+
+		if (ScanDirectionIsForward(dir))
+		{
+			if (!P_IGNORE(opaque) &&
+				offnum <= PageGetMaxOffsetNumber(page))
+				break;
+			if (P_RIGHTMOST(opaque))
+			{
+				_bt_relbuf(rel, buf);
+				return false;
+			}
+			buf = _bt_relandgetbuf(rel, buf, opaque->btpo_next, BT_READ);
+			page = BufferGetPage(buf);
+			opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+			offnum = P_FIRSTDATAKEY(opaque);
+		}
+		else
+		{
+			if (offnum >= P_FIRSTDATAKEY(opaque))
+				break;
+			buf = _bt_walk_left(rel, buf);
+			if (!BufferIsValid(buf))
+				return false;
+			page = BufferGetPage(buf);
+			offnum = PageGetMaxOffsetNumber(page);
+		}
+	}
+
+	/* Fetch the leading-column value from the item we found */
+	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+	value = index_getattr(itup, 1, RelationGetDescr(rel), &isnull);
+	_bt_set_skip_value(scan, value, isnull);
+
+	_bt_relbuf(rel, buf);
+
+	return true;
+}
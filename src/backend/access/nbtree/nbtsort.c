@@ -67,7 +67,10 @@
 #include "postgres.h"
 
 #include "access/nbtree.h"
+#include "commands/progress.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/fd.h"
 #include "storage/smgr.h"
 #include "tcop/tcopprot.h"
 #include "utils/rel.h"
@@ -84,8 +87,13 @@ struct BTSpool
 	Tuplesortstate *sortstate;	/* state data for tuplesort.c */
 	Relation	index;
 	bool		isunique;
+	BTSpool   **parts;			/* spools merged into this one, if any */
+	int			nparts;
 };
 
+/* GUC parameter */
+int			btree_build_partitions = 1;
+
 /*
  * Status record for a btree page being built.	We have one of these
  * for each active tree level.
@@ -130,6 +138,8 @@ static void _bt_sortaddtup(Page page, Size itemsize,
 			   IndexTuple itup, OffsetNumber itup_off);
 static void _bt_buildadd(BTWriteState *wstate, BTPageState *state,
 			 IndexTuple itup);
+static void _bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids);
 static void _bt_uppershutdown(BTWriteState *wstate, BTPageState *state);
 static void _bt_load(BTWriteState *wstate,
 		 BTSpool *btspool, BTSpool *btspool2);
@@ -142,9 +152,12 @@ static void _bt_load(BTWriteState *wstate,
 
 /*
  * create and initialize a spool structure
+ *
+ * nparts is the number of spools of this kind that will be filled at the
+ * same time (see _bt_spoolmerge); they share the sort memory between them.
  */
 BTSpool *
-_bt_spoolinit(Relation index, bool isunique, bool isdead)
+_bt_spoolinit(Relation index, bool isunique, bool isdead, int nparts)
 {
 	BTSpool    *btspool = (BTSpool *) palloc0(sizeof(BTSpool));
 	int			btKbytes;
@@ -161,19 +174,65 @@ _bt_spoolinit(Relation index, bool isunique, bool isdead)
 	 * work_mem.
 	 */
 	btKbytes = isdead ? work_mem : maintenance_work_mem;
+	btKbytes = Max(btKbytes / nparts, 64);
 	btspool->sortstate = tuplesort_begin_index_btree(index, isunique,
 													 btKbytes, false);
 
 	return btspool;
 }
 
+/*
+ * combine spools filled from separate parts of the heap
+ *
+ * Each part is sorted on its own, and the result's sorted output is the
+ * merge of theirs, checked for uniqueness across the parts if they are
+ * unique spools.  The parts then belong to the result, and are destroyed
+ * with it.
+ */
+BTSpool *
+_bt_spoolmerge(BTSpool **parts, int nparts)
+{
+	BTSpool    *btspool = (BTSpool *) palloc0(sizeof(BTSpool));
+	Tuplesortstate **inputs;
+	int			i;
+
+	Assert(nparts > 0);
+
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_BUILD_SORT);
+
+	btspool->index = parts[0]->index;
+	btspool->isunique = parts[0]->isunique;
+	btspool->parts = parts;
+	btspool->nparts = nparts;
+
+	inputs = (Tuplesortstate **) palloc(nparts * sizeof(Tuplesortstate *));
+	for (i = 0; i < nparts; i++)
+	{
+		tuplesort_performsort(parts[i]->sortstate);
+		inputs[i] = parts[i]->sortstate;
+	}
+	btspool->sortstate = tuplesort_begin_index_merge(btspool->index,
+													 btspool->isunique,
+													 inputs, nparts);
+	pfree(inputs);
+
+	return btspool;
+}
+
 /*
  * clean up a spool structure and its substructures.
  */
 void
 _bt_spooldestroy(BTSpool *btspool)
 {
+	int			i;
+
 	tuplesort_end(btspool->sortstate);
+	for (i = 0; i < btspool->nparts; i++)
+		_bt_spooldestroy(btspool->parts[i]);
+	if (btspool->parts)
+		pfree(btspool->parts);
 	pfree(btspool);
 }
 
@@ -203,10 +262,15 @@ _bt_leafbuild(BTSpool *btspool, BTSpool *btspool2)
 	}
 #endif   /* BTREE_BUILD_STATS */
 
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_BUILD_SORT);
 	tuplesort_performsort(btspool->sortstate);
 	if (btspool2)
 		tuplesort_performsort(btspool2->sortstate);
 
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_BUILD_LOAD);
+
 	wstate.index = btspool->index;
 
 	/*
@@ -284,14 +348,25 @@ _bt_blwritepage(BTWriteState *wstate, Page page, BlockNumber blkno)
 	 * zeroes anyway), but it should help to avoid fragmentation. The dummy
 	 * pages aren't WAL-logged though.
 	 */
-	while (blkno > wstate->btws_pages_written)
+	if (blkno > wstate->btws_pages_written)
 	{
+		char	   *zeropages[PG_IOV_MAX];
+		int			i;
+
 		if (!wstate->btws_zeropage)
 			wstate->btws_zeropage = (Page) palloc0(BLCKSZ);
-		smgrextend(wstate->index->rd_smgr, MAIN_FORKNUM,
-				   wstate->btws_pages_written++,
-				   (char *) wstate->btws_zeropage,
-				   true);
+		for (i = 0; i < PG_IOV_MAX; i++)
+			zeropages[i] = (char *) wstate->btws_zeropage;
+
+		while (blkno > wstate->btws_pages_written)
+		{
+			BlockNumber nzero = Min(blkno - wstate->btws_pages_written,
+									PG_IOV_MAX);
+
+			smgrextendv(wstate->index->rd_smgr, MAIN_FORKNUM,
+						wstate->btws_pages_written, zeropages, nzero, true);
+			wstate->btws_pages_written += nzero;
+		}
 	}
 
 	/*
@@ -400,6 +475,7 @@ _bt_sortaddtup(Page page,
 	{
 		trunctuple = *itup;
 		trunctuple.t_info = sizeof(IndexTupleData);
+		ItemPointerSetOffsetNumber(&trunctuple.t_tid, P_HIKEY);
 		itup = &trunctuple;
 		itemsize = sizeof(IndexTupleData);
 	}
@@ -522,13 +598,46 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 		oitup = (IndexTuple) PageGetItem(opage, ii);
 		_bt_sortaddtup(npage, ItemIdGetLength(ii), oitup, P_FIRSTKEY);
 
-		/*
-		 * Move 'last' into the high key position on opage
-		 */
-		hii = PageGetItemId(opage, P_HIKEY);
-		*hii = *ii;
-		ItemIdSetUnused(ii);	/* redundant */
-		((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
+		if (state->btps_level > 0)
+		{
+			/*
+			 * Move 'last' into the high key position on opage
+			 */
+			hii = PageGetItemId(opage, P_HIKEY);
+			*hii = *ii;
+			ItemIdSetUnused(ii);	/* redundant */
+			((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
+		}
+		else
+		{
+			/*
+			 * On the leaf level the high key is 'last' truncated to the
+			 * columns that distinguish it from the item before it (see
+			 * _bt_truncate), so remove 'last' from opage altogether and put
+			 * the truncated copy in the high key position instead.  Since
+			 * 'last' was the most recently added item, its space is at
+			 * pd_upper and is easily given back.
+			 */
+			IndexTuple	lastleft;
+			IndexTuple	hikey;
+
+			lastleft = (IndexTuple)
+				PageGetItem(opage, PageGetItemId(opage, OffsetNumberPrev(last_off)));
+			hikey = _bt_truncate(wstate->index, lastleft, oitup);
+
+			Assert(ItemIdGetOffset(ii) == ((PageHeader) opage)->pd_upper);
+			((PageHeader) opage)->pd_upper += ItemIdGetLength(ii);
+			ItemIdSetUnused(ii);
+			((PageHeader) opage)->pd_lower -= sizeof(ItemIdData);
+
+			if (PageAddItem(opage, (Item) hikey,
+							MAXALIGN(IndexTupleSize(hikey)), P_HIKEY,
+							true, false) == InvalidOffsetNumber)
+				elog(ERROR, "failed to add high key to the index page");
+			oitup = (IndexTuple) PageGetItem(opage,
+											 PageGetItemId(opage, P_HIKEY));
+			pfree(hikey);
+		}
 
 		/*
 		 * Link the old page into its parent, using its minimum key. If we
@@ -539,7 +648,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 			state->btps_next = _bt_pagestate(wstate, state->btps_level + 1);
 
 		Assert(state->btps_minkey != NULL);
-		ItemPointerSet(&(state->btps_minkey->t_tid), oblkno, P_HIKEY);
+		BTreeInnerTupleSetDownLink(state->btps_minkey, oblkno);
 		_bt_buildadd(wstate, state->btps_next, state->btps_minkey);
 		pfree(state->btps_minkey);
 
@@ -583,7 +692,7 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	if (last_off == P_HIKEY)
 	{
 		Assert(state->btps_minkey == NULL);
-		state->btps_minkey = CopyIndexTuple(itup);
+		state->btps_minkey = _bt_form_plain(itup);
 	}
 
 	/*
@@ -597,6 +706,27 @@ _bt_buildadd(BTWriteState *wstate, BTPageState *state, IndexTuple itup)
 	state->btps_lastoff = last_off;
 }
 
+/*
+ * Add a run of tuples with key base and the given heap TIDs, as a posting
+ * tuple if there is more than one of them.
+ */
+static void
+_bt_buildadd_posting(BTWriteState *wstate, BTPageState *state,
+					 IndexTuple base, ItemPointer htids, int nhtids)
+{
+	IndexTuple	itup;
+
+	if (nhtids == 1)
+	{
+		_bt_buildadd(wstate, state, base);
+		return;
+	}
+
+	itup = _bt_form_posting(base, htids, nhtids);
+	_bt_buildadd(wstate, state, itup);
+	pfree(itup);
+}
+
 /*
  * Finish writing out the completed btree.
  */
@@ -636,7 +766,7 @@ _bt_uppershutdown(BTWriteState *wstate, BTPageState *state)
 		else
 		{
 			Assert(s->btps_minkey != NULL);
-			ItemPointerSet(&(s->btps_minkey->t_tid), blkno, P_HIKEY);
+			BTreeInnerTupleSetDownLink(s->btps_minkey, blkno);
 			_bt_buildadd(wstate, s->btps_next, s->btps_minkey);
 			pfree(s->btps_minkey);
 			s->btps_minkey = NULL;
@@ -678,8 +808,9 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 				load1;
 	TupleDesc	tupdes = RelationGetDescr(wstate->index);
 	int			i,
-				keysz = RelationGetNumberOfAttributes(wstate->index);
+				keysz = IndexRelationGetNumberOfKeyAttributes(wstate->index);
 	ScanKey		indexScanKey = NULL;
+	int64		tuples_done = 0;
 
 	if (merge)
 	{
@@ -760,6 +891,9 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			if (state == NULL)
 				state = _bt_pagestate(wstate, 0);
 
+			pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_DONE,
+										 ++tuples_done);
+
 			if (load1)
 			{
 				_bt_buildadd(wstate, state, itup);
@@ -779,7 +913,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 		}
 		_bt_freeskey(indexScanKey);
 	}
-	else
+	else if (btspool->isunique)
 	{
 		/* merge is unnecessary */
 		while ((itup = tuplesort_getindextuple(btspool->sortstate,
@@ -792,7 +926,65 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 			_bt_buildadd(wstate, state, itup);
 			if (should_free)
 				pfree(itup);
+
+			pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_DONE,
+										 ++tuples_done);
+		}
+	}
+	else
+	{
+		/*
+		 * Merge is unnecessary, but we deduplicate as we go.  The sort
+		 * returns equal keys in heap TID order, so each run of identical
+		 * keys arrives together with its TIDs already sorted.
+		 */
+		IndexTuple	base = NULL;
+		ItemPointer htids;
+		int			nhtids = 0;
+		Size		maxpostingsize = 0;
+
+		htids = (ItemPointer) palloc(MaxTIDsPerBTreePage *
+									 sizeof(ItemPointerData));
+
+		while ((itup = tuplesort_getindextuple(btspool->sortstate,
+											   true, &should_free)) != NULL)
+		{
+			/* When we see first tuple, create first index page */
+			if (state == NULL)
+			{
+				state = _bt_pagestate(wstate, 0);
+				maxpostingsize = BTMaxPostingSize(state->btps_page);
+			}
+
+			if (base != NULL &&
+				_bt_dedup_same_key(base, itup) &&
+				_bt_posting_size(base, nhtids + 1) <= maxpostingsize)
+				htids[nhtids++] = itup->t_tid;
+			else
+			{
+				if (base != NULL)
+				{
+					_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+					pfree(base);
+				}
+				base = CopyIndexTuple(itup);
+				htids[0] = itup->t_tid;
+				nhtids = 1;
+			}
+
+			if (should_free)
+				pfree(itup);
+
+			pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_DONE,
+										 ++tuples_done);
+		}
+
+		if (base != NULL)
+		{
+			_bt_buildadd_posting(wstate, state, base, htids, nhtids);
+			pfree(base);
 		}
+		pfree(htids);
 	}
 
 	/* Close down final pages and write the metapage */
@@ -20,11 +20,14 @@
 #include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
+#include "catalog/pg_statistic.h"
 #include "miscadmin.h"
 #include "utils/array.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/syscache.h"
 
 
 typedef struct BTSortArrayContext
@@ -41,6 +44,7 @@ static int	_bt_sort_array_elements(IndexScanDesc scan, ScanKey skey,
 						bool reverse,
 						Datum *elems, int nelems);
 static int _bt_compare_array_elements(const void *a, const void *b, void *arg);
+static bool _bt_skip_worthwhile(Relation rel);
 static bool _bt_compare_scankey_args(IndexScanDesc scan, ScanKey op,
 						 ScanKey leftarg, ScanKey rightarg,
 						 bool *result);
@@ -56,7 +60,8 @@ static bool _bt_check_rowcompare(ScanKey skey,
  *		Build an insertion scan key that contains comparison data from itup
  *		as well as comparator routines appropriate to the key datatypes.
  *
- *		The result is intended for use with _bt_compare().
+ *		The result is intended for use with _bt_compare().  It covers only
+ *		the key columns; any INCLUDE columns of itup are left out.
  */
 ScanKey
 _bt_mkscankey(Relation rel, IndexTuple itup)
@@ -64,11 +69,13 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 	ScanKey		skey;
 	TupleDesc	itupdesc;
 	int			natts;
+	int			tupnatts;
 	int16	   *indoption;
 	int			i;
 
 	itupdesc = RelationGetDescr(rel);
-	natts = RelationGetNumberOfAttributes(rel);
+	natts = IndexRelationGetNumberOfKeyAttributes(rel);
+	tupnatts = BTreeTupleGetNAtts(itup, rel);
 	indoption = rel->rd_indoption;
 
 	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
@@ -85,7 +92,18 @@ _bt_mkscankey(Relation rel, IndexTuple itup)
 		 * comparison can be needed.
 		 */
 		procinfo = index_getprocinfo(rel, i + 1, BTORDER_PROC);
-		arg = index_getattr(itup, i + 1, itupdesc, &null);
+
+		/*
+		 * Columns cut off a truncated pivot get a NULL placeholder; callers
+		 * must not use more than BTreeTupleGetNAtts() keys of such a tuple.
+		 */
+		if (i < tupnatts)
+			arg = index_getattr(itup, i + 1, itupdesc, &null);
+		else
+		{
+			arg = (Datum) 0;
+			null = true;
+		}
 		flags = (null ? SK_ISNULL : 0) | (indoption[i] << SK_BT_INDOPTION_SHIFT);
 		ScanKeyEntryInitializeWithInfo(&skey[i],
 									   flags,
@@ -119,7 +137,7 @@ _bt_mkscankey_nodata(Relation rel)
 	int16	   *indoption;
 	int			i;
 
-	natts = RelationGetNumberOfAttributes(rel);
+	natts = IndexRelationGetNumberOfKeyAttributes(rel);
 	indoption = rel->rd_indoption;
 
 	skey = (ScanKey) palloc(natts * sizeof(ScanKeyData));
@@ -593,6 +611,225 @@ _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir)
 	return found;
 }
 
+/*
+ * _bt_preprocess_skip_key() -- Decide whether to run the scan as a skip scan
+ *
+ * If there are no scan keys on the first index column but there are some
+ * on the second, as for "WHERE b = 5" with an index on (a, b), an ordinary
+ * scan must read the whole index.  Instead we can do one primitive index
+ * scan per distinct value of "a", adding an implicit "a = value" key so
+ * that the keys on "b" become usable for positioning and for ending each
+ * primitive scan.  The values of "a" are discovered as the scan proceeds,
+ * by _bt_skip_advance.
+ *
+ * Each primitive scan costs a couple of descents of the tree, so we only
+ * do this when the statistics say that the leading column has few enough
+ * distinct values for it to be a win.  Skipping is not combined with
+ * array keys.
+ *
+ * so->skipKeyData is built as the implicit leading-column key followed by
+ * a copy of scan->keyData, so it can stand in for the input keys in
+ * _bt_preprocess_keys.  It lives in so->arrayContext, which array keys
+ * aren't using in this case.
+ */
+void
+_bt_preprocess_skip_key(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	Relation	rel = scan->indexRelation;
+	int			numberOfKeys = scan->numberOfKeys;
+	bool		found = false;
+	Form_pg_attribute attr;
+	Oid			eq_opr;
+	MemoryContext oldContext;
+	int			i;
+
+	so->skipScan = false;
+	so->skipHaveValue = false;
+	so->skipKeyData = NULL;
+	so->markSkipValid = false;
+
+	if (numberOfKeys < 1 || so->numArrayKeys != 0 ||
+		IndexRelationGetNumberOfKeyAttributes(rel) < 2)
+		return;
+
+	for (i = 0; i < numberOfKeys; i++)
+	{
+		ScanKey		cur = &scan->keyData[i];
+
+		if (cur->sk_attno == 1)
+			return;
+		if (cur->sk_attno == 2 && !(cur->sk_flags & SK_ROW_HEADER))
+			found = true;
+	}
+	if (!found)
+		return;
+
+	if (!_bt_skip_worthwhile(rel))
+		return;
+
+	eq_opr = get_opfamily_member(rel->rd_opfamily[0],
+								 rel->rd_opcintype[0],
+								 rel->rd_opcintype[0],
+								 BTEqualStrategyNumber);
+	if (!OidIsValid(eq_opr))
+		return;
+
+	if (so->arrayContext == NULL)
+		so->arrayContext = AllocSetContextCreate(CurrentMemoryContext,
+												 "BTree Array Context",
+												 ALLOCSET_SMALL_MINSIZE,
+												 ALLOCSET_SMALL_INITSIZE,
+												 ALLOCSET_SMALL_MAXSIZE);
+	else
+		MemoryContextReset(so->arrayContext);
+
+	oldContext = MemoryContextSwitchTo(so->arrayContext);
+
+	so->skipKeyData = (ScanKey) palloc((numberOfKeys + 1) * sizeof(ScanKeyData));
+	ScanKeyEntryInitialize(&so->skipKeyData[0],
+						   0,
+						   1,
+						   BTEqualStrategyNumber,
+						   InvalidOid,
+						   rel->rd_indcollation[0],
+						   get_opcode(eq_opr),
+						   (Datum) 0);
+	memcpy(&so->skipKeyData[1],
+		   scan->keyData,
+		   numberOfKeys * sizeof(ScanKeyData));
+
+	MemoryContextSwitchTo(oldContext);
+
+	attr = RelationGetDescr(rel)->attrs[0];
+	so->skipAttByVal = attr->attbyval;
+	so->skipAttLen = attr->attlen;
+	so->skipScan = true;
+}
+
+/*
+ * Check pg_statistic to see whether the index's leading column has few
+ * enough distinct values to make a skip scan worthwhile.
+ */
+static bool
+_bt_skip_worthwhile(Relation rel)
+{
+	AttrNumber	heapattno = rel->rd_index->indkey.values[0];
+	HeapTuple	statsTuple;
+	double		stadistinct;
+	double		ndistinct;
+
+	/* we have no statistics for expression columns */
+	if (heapattno <= 0)
+		return false;
+
+	statsTuple = SearchSysCache3(STATRELATTINH,
+								 ObjectIdGetDatum(rel->rd_index->indrelid),
+								 Int16GetDatum(heapattno),
+								 BoolGetDatum(false));
+	if (!HeapTupleIsValid(statsTuple))
+		return false;
+	stadistinct = ((Form_pg_statistic) GETSTRUCT(statsTuple))->stadistinct;
+	ReleaseSysCache(statsTuple);
+
+	if (stadistinct > 0.0)
+		ndistinct = stadistinct;
+	else
+		ndistinct = -stadistinct * rel->rd_rel->reltuples;
+
+	return BTSkipScanWorthwhile(ndistinct, rel->rd_rel->relpages);
+}
+
+/*
+ * _bt_set_skip_value() -- Install a new leading-column value in a skip scan
+ *
+ * The value is copied into the scan's workspace, and the previous value, if
+ * any, is freed.  A NULL value turns the key into an IS NULL search.  The
+ * caller must arrange for _bt_preprocess_keys to be run before the keys are
+ * used again.
+ */
+void
+_bt_set_skip_value(IndexScanDesc scan, Datum value, bool isnull)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	ScanKey		skey = &so->skipKeyData[0];
+
+	if (so->skipHaveValue && !(skey->sk_flags & SK_ISNULL) &&
+		!so->skipAttByVal)
+		pfree(DatumGetPointer(skey->sk_argument));
+
+	if (isnull)
+	{
+		skey->sk_flags = SK_ISNULL | SK_SEARCHNULL;
+		skey->sk_strategy = InvalidStrategy;
+		skey->sk_argument = (Datum) 0;
+	}
+	else
+	{
+		MemoryContext oldContext;
+
+		oldContext = MemoryContextSwitchTo(so->arrayContext);
+		skey->sk_flags = 0;
+		skey->sk_strategy = BTEqualStrategyNumber;
+		skey->sk_collation = scan->indexRelation->rd_indcollation[0];
+		skey->sk_argument = datumCopy(value, so->skipAttByVal, so->skipAttLen);
+		MemoryContextSwitchTo(oldContext);
+	}
+	skey->sk_subtype = InvalidOid;
+	so->skipHaveValue = true;
+}
+
+/*
+ * _bt_mark_skip_value() -- Remember the current skip value for btrestrpos
+ */
+void
+_bt_mark_skip_value(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+	ScanKey		skey = &so->skipKeyData[0];
+
+	if (so->markSkipValid && !so->markSkipIsNull && !so->skipAttByVal)
+		pfree(DatumGetPointer(so->markSkipValue));
+
+	so->markSkipValid = so->skipHaveValue;
+	if (!so->skipHaveValue)
+		return;
+
+	if (skey->sk_flags & SK_ISNULL)
+	{
+		so->markSkipIsNull = true;
+		so->markSkipValue = (Datum) 0;
+	}
+	else
+	{
+		MemoryContext oldContext;
+
+		oldContext = MemoryContextSwitchTo(so->arrayContext);
+		so->markSkipIsNull = false;
+		so->markSkipValue = datumCopy(skey->sk_argument,
+									  so->skipAttByVal, so->skipAttLen);
+		MemoryContextSwitchTo(oldContext);
+	}
+}
+
+/*
+ * _bt_restore_skip_value() -- Go back to the skip value saved at the mark
+ *
+ * The marked position may belong to an earlier primitive scan, so we must
+ * reinstate its leading-column value and redo key preprocessing.
+ */
+void
+_bt_restore_skip_value(IndexScanDesc scan)
+{
+	BTScanOpaque so = (BTScanOpaque) scan->opaque;
+
+	if (!so->markSkipValid)
+		return;
+
+	_bt_set_skip_value(scan, so->markSkipValue, so->markSkipIsNull);
+	_bt_preprocess_keys(scan);
+}
+
 
 /*
  *	_bt_preprocess_keys() -- Preprocess scan keys
@@ -703,10 +940,16 @@ _bt_preprocess_keys(IndexScanDesc scan)
 		return;					/* done if qual-less scan */
 
 	/*
-	 * Read so->arrayKeyData if array keys are present, else scan->keyData
+	 * Read so->arrayKeyData if array keys are present, or so->skipKeyData
+	 * (which has one extra key) during a skip scan, else scan->keyData
 	 */
 	if (so->arrayKeyData != NULL)
 		inkeys = so->arrayKeyData;
+	else if (so->skipScan && so->skipHaveValue)
+	{
+		inkeys = so->skipKeyData;
+		numberOfKeys++;
+	}
 	else
 		inkeys = scan->keyData;
 
@@ -1649,6 +1892,47 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
 	return result;
 }
 
+/*
+ * Does posting tuple itup contain heap TID htid?
+ */
+static bool
+_bt_posting_has_tid(IndexTuple itup, ItemPointer htid)
+{
+	int			i;
+
+	for (i = 0; i < BTreeTupleGetNPosting(itup); i++)
+	{
+		if (ItemPointerEquals(BTreeTupleGetPostingN(itup, i), htid))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Were all the heap TIDs of posting tuple itup among the scan's killed items?
+ */
+static bool
+_bt_posting_all_killed(BTScanOpaque so, IndexTuple itup)
+{
+	int			i,
+				j;
+
+	for (i = 0; i < BTreeTupleGetNPosting(itup); i++)
+	{
+		ItemPointer htid = BTreeTupleGetPostingN(itup, i);
+
+		for (j = 0; j < so->numKilled; j++)
+		{
+			if (ItemPointerEquals(&so->currPos.items[so->killedItems[j]].heapTid,
+								  htid))
+				break;
+		}
+		if (j >= so->numKilled)
+			return false;
+	}
+	return true;
+}
+
 /*
  * _bt_killitems - set LP_DEAD state for items an indexscan caller has
  * told us were killed
@@ -1670,7 +1954,10 @@ _bt_check_rowcompare(ScanKey skey, IndexTuple tuple, TupleDesc tupdesc,
  * the page, and so there is no need to search left from the recorded offset.
  * (This observation also guarantees that the item is still the right one
  * to delete, which might otherwise be questionable since heap TIDs can get
- * recycled.)
+ * recycled.)  An insertion's deduplication pass can move items left, though;
+ * we'll miss those, which is harmless.
+ *
+ * A posting tuple is marked only if every one of its heap TIDs was killed.
  */
 void
 _bt_killitems(IndexScanDesc scan, bool haveLock)
@@ -1708,7 +1995,23 @@ _bt_killitems(IndexScanDesc scan, bool haveLock)
 			ItemId		iid = PageGetItemId(page, offnum);
 			IndexTuple	ituple = (IndexTuple) PageGetItem(page, iid);
 
-			if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
+			if (BTreeTupleIsPosting(ituple))
+			{
+				if (_bt_posting_has_tid(ituple, &kitem->heapTid))
+				{
+					/*
+					 * found the item; but a posting tuple can be marked dead
+					 * only if all of its heap TIDs were killed
+					 */
+					if (_bt_posting_all_killed(so, ituple))
+					{
+						ItemIdMarkDead(iid);
+						killedsomething = true;
+					}
+					break;		/* out of inner search loop */
+				}
+			}
+			else if (ItemPointerEquals(&ituple->t_tid, &kitem->heapTid))
 			{
 				/* found the item */
 				ItemIdMarkDead(iid);
@@ -1966,3 +2269,327 @@ btoptions(PG_FUNCTION_ARGS)
 		PG_RETURN_BYTEA_P(result);
 	PG_RETURN_NULL();
 }
+
+
+/*
+ * _bt_dedup_same_key() -- Can these two leaf tuples share a posting tuple?
+ *
+ * We merge only tuples whose keys are identical byte for byte.  That is
+ * stricter than opclass equality (think of numeric 1.0 and 1.00, or
+ * case-insensitive collations), but it means the merged tuple can stand in
+ * for every one of its members without any knowledge of the opclass, and
+ * it lets WAL replay repeat a deduplication pass from the page alone.
+ */
+bool
+_bt_dedup_same_key(IndexTuple itup1, IndexTuple itup2)
+{
+	Size		keysize = BTreeTupleGetKeySize(itup1);
+
+	if (keysize != BTreeTupleGetKeySize(itup2))
+		return false;
+	if ((itup1->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)) !=
+		(itup2->t_info & (INDEX_NULL_MASK | INDEX_VAR_MASK)))
+		return false;
+
+	return memcmp((char *) itup1 + sizeof(IndexTupleData),
+				  (char *) itup2 + sizeof(IndexTupleData),
+				  keysize - sizeof(IndexTupleData)) == 0;
+}
+
+/*
+ * _bt_posting_size() -- Size of a posting tuple with base's key and nhtids TIDs
+ */
+Size
+_bt_posting_size(IndexTuple base, int nhtids)
+{
+	return MAXALIGN(BTreeTupleGetKeySize(base) +
+					nhtids * sizeof(ItemPointerData));
+}
+
+/*
+ * _bt_form_posting() -- Build a tuple with base's key and the given TIDs
+ *
+ * base may be a plain or a posting tuple; only its key is used.  The TIDs
+ * must already be sorted.  If there is just one TID, the result is a plain
+ * tuple.  The result is palloc'd.
+ */
+IndexTuple
+_bt_form_posting(IndexTuple base, ItemPointer htids, int nhtids)
+{
+	Size		keysize = BTreeTupleGetKeySize(base);
+	Size		newsize;
+	IndexTuple	itup;
+
+	Assert(nhtids > 0);
+
+	if (nhtids == 1)
+	{
+		itup = (IndexTuple) palloc(keysize);
+		memcpy(itup, base, keysize);
+		itup->t_info &= ~(INDEX_SIZE_MASK | BT_ALT_TID);
+		itup->t_info |= keysize;
+		itup->t_tid = htids[0];
+		return itup;
+	}
+
+	newsize = _bt_posting_size(base, nhtids);
+	Assert(newsize <= INDEX_SIZE_MASK);
+
+	itup = (IndexTuple) palloc0(newsize);
+	memcpy(itup, base, keysize);
+	itup->t_info &= ~INDEX_SIZE_MASK;
+	itup->t_info |= newsize;
+	BTreeTupleSetPosting(itup, keysize, nhtids);
+	memcpy((char *) itup + keysize, htids, nhtids * sizeof(ItemPointerData));
+
+	return itup;
+}
+
+/*
+ * _bt_form_plain() -- Return a palloc'd plain copy of a leaf tuple
+ *
+ * A posting tuple is reduced to its key and its first heap TID.  This is
+ * what we use for high keys and downlinks, which must never be posting
+ * tuples.
+ */
+IndexTuple
+_bt_form_plain(IndexTuple itup)
+{
+	if (!BTreeTupleIsPosting(itup))
+		return CopyIndexTuple(itup);
+
+	return _bt_form_posting(itup, BTreeTupleGetPostingN(itup, 0), 1);
+}
+
+/*
+ * _bt_keep_natts() -- How many leading columns separate lastleft from
+ *		firstright?
+ *
+ * Returns the 1-based number of the first column on which the two tuples
+ * differ according to the opclass, or the number of key columns if they
+ * agree on every key column.  INCLUDE columns are never kept.
+ */
+static int
+_bt_keep_natts(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	int			natts = IndexRelationGetNumberOfKeyAttributes(rel);
+	int			attnum;
+
+	for (attnum = 1; attnum < natts; attnum++)
+	{
+		Datum		datum1,
+					datum2;
+		bool		isnull1,
+					isnull2;
+
+		datum1 = index_getattr(lastleft, attnum, itupdesc, &isnull1);
+		datum2 = index_getattr(firstright, attnum, itupdesc, &isnull2);
+
+		if (isnull1 != isnull2)
+			return attnum;
+		if (!isnull1)
+		{
+			FmgrInfo   *procinfo = index_getprocinfo(rel, attnum, BTORDER_PROC);
+
+			if (DatumGetInt32(FunctionCall2Coll(procinfo,
+												rel->rd_indcollation[attnum - 1],
+												datum1, datum2)) != 0)
+				return attnum;
+		}
+	}
+
+	return natts;
+}
+
+/*
+ * _bt_truncate() -- Build the high key for a leaf page split
+ *
+ * lastleft is the last data item that will remain on the left page and
+ * firstright the first data item that moves to the right page.  The
+ * classic choice of high key is a copy of firstright, but any key that is
+ * greater than lastleft and no greater than firstright separates the pages
+ * equally well.  We keep only as many leading columns of firstright as are
+ * needed to tell it apart from lastleft; the remaining columns are treated
+ * as minus infinity by _bt_compare.  On wide composite keys this makes the
+ * high key, and every downlink copied from it, much smaller, so that upper
+ * pages have higher fan-out.  The INCLUDE columns of an index, which only
+ * leaf tuples need, are always cut off.
+ *
+ * If every column is needed, a plain copy of firstright (without any
+ * posting list) is returned.  The result is palloc'd.
+ */
+IndexTuple
+_bt_truncate(Relation rel, IndexTuple lastleft, IndexTuple firstright)
+{
+	TupleDesc	itupdesc = RelationGetDescr(rel);
+	TupleDesc	truncdesc;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	IndexTuple	pivot;
+	int			keepnatts;
+
+	Assert(!BTreeTupleIsTruncated(lastleft) &&
+		   !BTreeTupleIsTruncated(firstright));
+
+	keepnatts = _bt_keep_natts(rel, lastleft, firstright);
+	if (keepnatts >= RelationGetNumberOfAttributes(rel))
+		return _bt_form_plain(firstright);
+
+	/*
+	 * Form a tuple from the leading columns only.  The layout of those
+	 * columns is the same as in a full-width tuple, so ordinary
+	 * index_getattr calls on the result work for them.
+	 */
+	index_deform_tuple(firstright, itupdesc, values, isnull);
+	truncdesc = CreateTupleDescCopy(itupdesc);
+	truncdesc->natts = keepnatts;
+	pivot = index_form_tuple(truncdesc, values, isnull);
+	FreeTupleDesc(truncdesc);
+
+	ItemPointerSetInvalid(&pivot->t_tid);
+	BTreeTupleSetNAtts(pivot, keepnatts);
+
+	return pivot;
+}
+
+/* qsort comparator for heap TIDs */
+static int
+_bt_htid_cmp(const void *a, const void *b)
+{
+	return ItemPointerCompare((ItemPointer) a, (ItemPointer) b);
+}
+
+/*
+ * Add the tuple for one group of equal-keyed tuples to the page being built
+ * by _bt_dedup_build.  A group with a single member is copied unchanged.
+ */
+static void
+_bt_dedup_add_group(Page newpage, IndexTuple base, int nmembers,
+					ItemPointer htids, int nhtids)
+{
+	IndexTuple	itup = base;
+	OffsetNumber off = OffsetNumberNext(PageGetMaxOffsetNumber(newpage));
+
+	if (nmembers > 1)
+	{
+		qsort(htids, nhtids, sizeof(ItemPointerData), _bt_htid_cmp);
+		itup = _bt_form_posting(base, htids, nhtids);
+	}
+
+	if (PageAddItem(newpage, (Item) itup, MAXALIGN(IndexTupleSize(itup)), off,
+					false, false) == InvalidOffsetNumber)
+		elog(ERROR, "failed to add item to deduplicated index page");
+
+	if (itup != base)
+		pfree(itup);
+}
+
+/*
+ * _bt_dedup_build() -- Merge runs of duplicates on a leaf page
+ *
+ * Returns a temporary page (see PageGetTempPage) holding the page's contents
+ * with each run of adjacent tuples having identical keys merged into posting
+ * tuples, or NULL if there is nothing to merge.  The caller is responsible
+ * for copying it back over the original and WAL-logging that.
+ *
+ * The result depends only on the tuples on the page and their order, not on
+ * LP_DEAD hints or the physical layout of the page, which is what allows
+ * btree_redo to reproduce it.  Items marked LP_DEAD are merged like any
+ * others, and lose the mark; the caller should have tried
+ * _bt_vacuum_one_page first if that matters.
+ */
+Page
+_bt_dedup_build(Page page)
+{
+	BTPageOpaque opaque = (BTPageOpaque) PageGetSpecialPointer(page);
+	OffsetNumber minoff = P_FIRSTDATAKEY(opaque);
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	OffsetNumber offnum;
+	Size		maxpostingsize = BTMaxPostingSize(page);
+	Page		newpage;
+	BTPageOpaque nopaque;
+	IndexTuple	base = NULL;
+	IndexTuple	itup;
+	ItemPointer htids;
+	int			nhtids = 0;
+	int			nmembers = 0;
+	bool		found = false;
+
+	Assert(P_ISLEAF(opaque));
+
+	/*
+	 * First make a cheap pass to see whether any two neighbors can be
+	 * merged at all; usually, when there is nothing to do, we find that out
+	 * quickly enough.
+	 */
+	for (offnum = minoff; offnum < maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		IndexTuple	next;
+
+		itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+		next = (IndexTuple) PageGetItem(page,
+						PageGetItemId(page, OffsetNumberNext(offnum)));
+		if (_bt_dedup_same_key(itup, next) &&
+			_bt_posting_size(itup, BTreeTupleGetNHeapTids(itup) +
+							 BTreeTupleGetNHeapTids(next)) <= maxpostingsize)
+		{
+			found = true;
+			break;
+		}
+	}
+	if (!found)
+		return NULL;
+
+	newpage = PageGetTempPageCopySpecial(page);
+	PageSetLSN(newpage, PageGetLSN(page));
+	PageSetTLI(newpage, PageGetTLI(page));
+	nopaque = (BTPageOpaque) PageGetSpecialPointer(newpage);
+	nopaque->btpo_flags &= ~BTP_HAS_GARBAGE;
+
+	if (!P_RIGHTMOST(opaque))
+	{
+		ItemId		hitemid = PageGetItemId(page, P_HIKEY);
+
+		if (PageAddItem(newpage, PageGetItem(page, hitemid),
+						ItemIdGetLength(hitemid), P_HIKEY,
+						false, false) == InvalidOffsetNumber)
+			elog(ERROR, "failed to add high key to deduplicated index page");
+	}
+
+	htids = (ItemPointer) palloc(MaxTIDsPerBTreePage * sizeof(ItemPointerData));
+
+	for (offnum = minoff; offnum <= maxoff; offnum = OffsetNumberNext(offnum))
+	{
+		int			n;
+
+		itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+		n = BTreeTupleGetNHeapTids(itup);
+
+		if (base == NULL ||
+			!_bt_dedup_same_key(base, itup) ||
+			_bt_posting_size(base, nhtids + n) > maxpostingsize)
+		{
+			/* close out the current group, and start a new one */
+			if (base != NULL)
+				_bt_dedup_add_group(newpage, base, nmembers, htids, nhtids);
+			base = itup;
+			nmembers = 0;
+			nhtids = 0;
+		}
+
+		if (BTreeTupleIsPosting(itup))
+			memcpy(htids + nhtids, BTreeTupleGetPostingN(itup, 0),
+				   n * sizeof(ItemPointerData));
+		else
+			htids[nhtids] = itup->t_tid;
+		nhtids += n;
+		nmembers++;
+	}
+	if (base != NULL)
+		_bt_dedup_add_group(newpage, base, nmembers, htids, nhtids);
+
+	pfree(htids);
+
+	return newpage;
+}
@@ -16,6 +16,7 @@
 
 #include "access/nbtree.h"
 #include "access/transam.h"
+#include "access/xlogutils.h"
 #include "storage/procarray.h"
 #include "miscadmin.h"
 
@@ -287,17 +288,17 @@ btree_xlog_split(bool onleft, bool isroot,
 		datalen -= sizeof(BlockIdData);
 
 		forget_matching_split(xlrec->node, downlink, false);
+	}
 
-		/* Extract left hikey and its size (still assuming 16-bit alignment) */
-		if (!(record->xl_info & XLR_BKP_BLOCK_1))
-		{
-			/* We assume 16-bit alignment is enough for IndexTupleSize */
-			left_hikey = (Item) datapos;
-			left_hikeysz = MAXALIGN(IndexTupleSize(left_hikey));
+	/* Extract left hikey and its size (still assuming 16-bit alignment) */
+	if (!(record->xl_info & XLR_BKP_BLOCK_1))
+	{
+		/* We assume 16-bit alignment is enough for IndexTupleSize */
+		left_hikey = (Item) datapos;
+		left_hikeysz = MAXALIGN(IndexTupleSize(left_hikey));
 
-			datapos += left_hikeysz;
-			datalen -= left_hikeysz;
-		}
+		datapos += left_hikeysz;
+		datalen -= left_hikeysz;
 	}
 
 	/* Extract newitem and newitemoff, if present */
@@ -338,18 +339,6 @@ btree_xlog_split(bool onleft, bool isroot,
 
 	_bt_restore_page(rpage, datapos, datalen);
 
-	/*
-	 * On leaf level, the high key of the left page is equal to the first key
-	 * on the right page.
-	 */
-	if (xlrec->level == 0)
-	{
-		ItemId		hiItemId = PageGetItemId(rpage, P_FIRSTDATAKEY(ropaque));
-
-		left_hikey = PageGetItem(rpage, hiItemId);
-		left_hikeysz = ItemIdGetLength(hiItemId);
-	}
-
 	PageSetLSN(rpage, lsn);
 	PageSetTLI(rpage, ThisTimeLineID);
 	MarkBufferDirty(rbuf);
@@ -528,13 +517,32 @@ btree_xlog_vacuum(XLogRecPtr lsn, XLogRecord *record)
 	if (record->xl_len > SizeOfBtreeVacuum)
 	{
 		OffsetNumber *unused;
-		OffsetNumber *unend;
+		OffsetNumber *updated;
+		char	   *tuples;
+		int			i;
 
 		unused = (OffsetNumber *) ((char *) xlrec + SizeOfBtreeVacuum);
-		unend = (OffsetNumber *) ((char *) xlrec + record->xl_len);
+		updated = unused + xlrec->ndeleted;
+		tuples = (char *) (updated + xlrec->nupdated);
+
+		/*
+		 * Replace the shrunken posting tuples first, as _bt_delitems_vacuum
+		 * did; that leaves the item numbers of the others unchanged.  We
+		 * assume 16-bit alignment is enough for IndexTupleSize, as elsewhere.
+		 */
+		for (i = 0; i < xlrec->nupdated; i++)
+		{
+			Size		itemsz = MAXALIGN(IndexTupleSize((IndexTuple) tuples));
 
-		if ((unend - unused) > 0)
-			PageIndexMultiDelete(page, unused, unend - unused);
+			PageIndexTupleDelete(page, updated[i]);
+			if (PageAddItem(page, (Item) tuples, itemsz, updated[i],
+							false, false) == InvalidOffsetNumber)
+				elog(PANIC, "btree_xlog_vacuum: failed to add updated item");
+			tuples += itemsz;
+		}
+
+		if (xlrec->ndeleted > 0)
+			PageIndexMultiDelete(page, unused, xlrec->ndeleted);
 	}
 
 	/*
@@ -604,68 +612,77 @@ btree_xlog_delete_get_latestRemovedXid(XLogRecord *record)
 
 	for (i = 0; i < xlrec->nitems; i++)
 	{
+		int			j;
+
 		/*
 		 * Identify the index tuple about to be deleted
 		 */
 		iitemid = PageGetItemId(ipage, unused[i]);
 		itup = (IndexTuple) PageGetItem(ipage, iitemid);
 
-		/*
-		 * Locate the heap page that the index tuple points at
-		 */
-		hblkno = ItemPointerGetBlockNumber(&(itup->t_tid));
-		hbuffer = XLogReadBuffer(xlrec->hnode, hblkno, false);
-		if (!BufferIsValid(hbuffer))
+		/* A posting tuple points at each of its heap TIDs */
+		for (j = 0; j < BTreeTupleGetNHeapTids(itup); j++)
 		{
-			UnlockReleaseBuffer(ibuffer);
-			return InvalidTransactionId;
-		}
-		hpage = (Page) BufferGetPage(hbuffer);
+			ItemPointer htid = BTreeTupleGetHeapTid(itup, j);
 
-		/*
-		 * Look up the heap tuple header that the index tuple points at by
-		 * using the heap node supplied with the xlrec. We can't use
-		 * heap_fetch, since it uses ReadBuffer rather than XLogReadBuffer.
-		 * Note that we are not looking at tuple data here, just headers.
-		 */
-		hoffnum = ItemPointerGetOffsetNumber(&(itup->t_tid));
-		hitemid = PageGetItemId(hpage, hoffnum);
+			/*
+			 * Locate the heap page that the index tuple points at
+			 */
+			hblkno = ItemPointerGetBlockNumber(htid);
+			hbuffer = XLogReadBuffer(xlrec->hnode, hblkno, false);
+			if (!BufferIsValid(hbuffer))
+			{
+				UnlockReleaseBuffer(ibuffer);
+				return InvalidTransactionId;
+			}
+			hpage = (Page) BufferGetPage(hbuffer);
 
-		/*
-		 * Follow any redirections until we find something useful.
-		 */
-		while (ItemIdIsRedirected(hitemid))
-		{
-			hoffnum = ItemIdGetRedirect(hitemid);
+			/*
+			 * Look up the heap tuple header that the index tuple points at
+			 * by using the heap node supplied with the xlrec. We can't use
+			 * heap_fetch, since it uses ReadBuffer rather than
+			 * XLogReadBuffer. Note that we are not looking at tuple data
+			 * here, just headers.
+			 */
+			hoffnum = ItemPointerGetOffsetNumber(htid);
 			hitemid = PageGetItemId(hpage, hoffnum);
-			CHECK_FOR_INTERRUPTS();
-		}
 
-		/*
-		 * If the heap item has storage, then read the header and use that to
-		 * set latestRemovedXid.
-		 *
-		 * Some LP_DEAD items may not be accessible, so we ignore them.
-		 */
-		if (ItemIdHasStorage(hitemid))
-		{
-			htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
+			/*
+			 * Follow any redirections until we find something useful.
+			 */
+			while (ItemIdIsRedirected(hitemid))
+			{
+				hoffnum = ItemIdGetRedirect(hitemid);
+				hitemid = PageGetItemId(hpage, hoffnum);
+				CHECK_FOR_INTERRUPTS();
+			}
 
-			HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr, &latestRemovedXid);
-		}
-		else if (ItemIdIsDead(hitemid))
-		{
 			/*
-			 * Conjecture: if hitemid is dead then it had xids before the xids
-			 * marked on LP_NORMAL items. So we just ignore this item and move
-			 * onto the next, for the purposes of calculating
-			 * latestRemovedxids.
+			 * If the heap item has storage, then read the header and use
+			 * that to set latestRemovedXid.
+			 *
+			 * Some LP_DEAD items may not be accessible, so we ignore them.
 			 */
-		}
-		else
-			Assert(!ItemIdIsUsed(hitemid));
+			if (ItemIdHasStorage(hitemid))
+			{
+				htuphdr = (HeapTupleHeader) PageGetItem(hpage, hitemid);
 
-		UnlockReleaseBuffer(hbuffer);
+				HeapTupleHeaderAdvanceLatestRemovedXid(htuphdr, &latestRemovedXid);
+			}
+			else if (ItemIdIsDead(hitemid))
+			{
+				/*
+				 * Conjecture: if hitemid is dead then it had xids before the
+				 * xids marked on LP_NORMAL items. So we just ignore this item
+				 * and move onto the next, for the purposes of calculating
+				 * latestRemovedxids.
+				 */
+			}
+			else
+				Assert(!ItemIdIsUsed(hitemid));
+
+			UnlockReleaseBuffer(hbuffer);
+		}
 	}
 
 	UnlockReleaseBuffer(ibuffer);
@@ -781,7 +798,7 @@ btree_xlog_delete_page(uint8 info, XLogRecPtr lsn, XLogRecord *record)
 					Assert(info != XLOG_BTREE_DELETE_PAGE_HALF);
 					itemid = PageGetItemId(page, poffset);
 					itup = (IndexTuple) PageGetItem(page, itemid);
-					ItemPointerSet(&(itup->t_tid), rightsib, P_HIKEY);
+					BTreeInnerTupleSetDownLink(itup, rightsib);
 					nextoffset = OffsetNumberNext(poffset);
 					PageIndexTupleDelete(page, nextoffset);
 				}
@@ -916,8 +933,9 @@ btree_xlog_newroot(XLogRecPtr lsn, XLogRecord *record)
 						 record->xl_len - SizeOfBtreeNewroot);
 		/* extract downlink to the right-hand split page */
 		itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, P_FIRSTKEY));
-		downlink = ItemPointerGetBlockNumber(&(itup->t_tid));
-		Assert(ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
+		downlink = BTreeInnerTupleGetDownLink(itup);
+		Assert(BTreeTupleIsTruncated(itup) ||
+			   ItemPointerGetOffsetNumber(&(itup->t_tid)) == P_HIKEY);
 	}
 
 	PageSetLSN(page, lsn);
@@ -935,6 +953,47 @@ btree_xlog_newroot(XLogRecPtr lsn, XLogRecord *record)
 }
 
 
+static void
+btree_xlog_dedup(XLogRecPtr lsn, XLogRecord *record)
+{
+	xl_btree_dedup *xlrec = (xl_btree_dedup *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+	Page		newpage;
+
+	/* If we have a full-page image, it's all been done for us */
+	if (record->xl_info & XLR_BKP_BLOCK_1)
+		return;
+
+	buffer = XLogReadBuffer(xlrec->node, xlrec->block, false);
+	if (!BufferIsValid(buffer))
+		return;
+	page = (Page) BufferGetPage(buffer);
+
+	if (XLByteLE(lsn, PageGetLSN(page)))
+	{
+		UnlockReleaseBuffer(buffer);
+		return;
+	}
+
+	/*
+	 * The pass depends only on the page contents, which are just what they
+	 * were when the record was written, so repeating it gives the same
+	 * result.
+	 */
+	newpage = _bt_dedup_build(page);
+	if (newpage == NULL)
+		elog(PANIC, "btree_xlog_dedup: nothing to deduplicate on block %u",
+			 xlrec->block);
+	PageRestoreTempPage(newpage, page);
+
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+}
+
+
 void
 btree_redo(XLogRecPtr lsn, XLogRecord *record)
 {
@@ -1028,11 +1087,79 @@ btree_redo(XLogRecPtr lsn, XLogRecord *record)
 		case XLOG_BTREE_REUSE_PAGE:
 			/* Handled above before restoring bkp block */
 			break;
+		case XLOG_BTREE_DEDUP:
+			btree_xlog_dedup(lsn, record);
+			break;
 		default:
 			elog(PANIC, "btree_redo: unknown op code %u", info);
 	}
 }
 
+/*
+ * Prefetch the index pages that replay of a btree record will read
+ */
+void
+btree_prefetch(XLogRecord *record, char *data, uint32 len)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	switch (info)
+	{
+		case XLOG_BTREE_INSERT_LEAF:
+		case XLOG_BTREE_INSERT_UPPER:
+		case XLOG_BTREE_INSERT_META:
+			{
+				xl_btreetid target;
+
+				if ((record->xl_info & XLR_BKP_BLOCK_1) ||
+					len < offsetof(xl_btreetid, tid) + SizeOfIptrData)
+					return;
+				memcpy(&target, data, offsetof(xl_btreetid, tid) + SizeOfIptrData);
+				XLogPrefetchBlock(target.node, MAIN_FORKNUM,
+								  ItemPointerGetBlockNumber(&target.tid));
+				break;
+			}
+
+		case XLOG_BTREE_SPLIT_L:
+		case XLOG_BTREE_SPLIT_R:
+		case XLOG_BTREE_SPLIT_L_ROOT:
+		case XLOG_BTREE_SPLIT_R_ROOT:
+			{
+				xl_btree_split xlrec;
+
+				if (len < offsetof(xl_btree_split, level))
+					return;
+				memcpy(&xlrec, data, offsetof(xl_btree_split, level));
+				/* the new right page is initialized, but not the others */
+				if (!(record->xl_info & XLR_BKP_BLOCK_1))
+					XLogPrefetchBlock(xlrec.node, MAIN_FORKNUM, xlrec.leftsib);
+				if (xlrec.rnext != P_NONE &&
+					!(record->xl_info & XLR_BKP_BLOCK_2))
+					XLogPrefetchBlock(xlrec.node, MAIN_FORKNUM, xlrec.rnext);
+				break;
+			}
+
+		case XLOG_BTREE_DELETE:
+		case XLOG_BTREE_VACUUM:
+			{
+				RelFileNode node;
+				BlockNumber blkno;
+
+				/* both start with the RelFileNode and block number */
+				if ((record->xl_info & XLR_BKP_BLOCK_1) ||
+					len < sizeof(RelFileNode) + sizeof(BlockNumber))
+					return;
+				memcpy(&node, data, sizeof(RelFileNode));
+				memcpy(&blkno, data + sizeof(RelFileNode), sizeof(BlockNumber));
+				XLogPrefetchBlock(node, MAIN_FORKNUM, blkno);
+				break;
+			}
+
+		default:
+			break;
+	}
+}
+
 static void
 out_target(StringInfo buf, xl_btreetid *target)
 {
@@ -1125,10 +1252,11 @@ btree_desc(StringInfo buf, uint8 xl_info, char *rec)
 			{
 				xl_btree_vacuum *xlrec = (xl_btree_vacuum *) rec;
 
-				appendStringInfo(buf, "vacuum: rel %u/%u/%u; blk %u, lastBlockVacuumed %u",
+				appendStringInfo(buf, "vacuum: rel %u/%u/%u; blk %u, lastBlockVacuumed %u, deleted %u, updated %u",
 								 xlrec->node.spcNode, xlrec->node.dbNode,
 								 xlrec->node.relNode, xlrec->block,
-								 xlrec->lastBlockVacuumed);
+								 xlrec->lastBlockVacuumed,
+								 xlrec->ndeleted, xlrec->nupdated);
 				break;
 			}
 		case XLOG_BTREE_DELETE:
@@ -1172,6 +1300,15 @@ btree_desc(StringInfo buf, uint8 xl_info, char *rec)
 							   xlrec->node.relNode, xlrec->latestRemovedXid);
 				break;
 			}
+		case XLOG_BTREE_DEDUP:
+			{
+				xl_btree_dedup *xlrec = (xl_btree_dedup *) rec;
+
+				appendStringInfo(buf, "dedup: rel %u/%u/%u; blk %u",
+								 xlrec->node.spcNode, xlrec->node.dbNode,
+								 xlrec->node.relNode, xlrec->block);
+				break;
+			}
 		default:
 			appendStringInfo(buf, "UNKNOWN");
 			break;
@@ -189,6 +189,7 @@ spginsert(PG_FUNCTION_ARGS)
 #ifdef NOT_USED
 	Relation	heapRel = (Relation) PG_GETARG_POINTER(4);
 	IndexUniqueCheck checkUnique = (IndexUniqueCheck) PG_GETARG_INT32(5);
+	bool		indexUnchanged = PG_GETARG_BOOL(6);
 #endif
 	SpGistState spgstate;
 	MemoryContext oldCtx;
@@ -154,6 +154,53 @@ spg_kd_picksplit(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/*
+ * Subroutine to fill out->distances[] for spg_kd_inner_consistent, once
+ * out->nodeNumbers[] has been set.  Node 0 holds points below the split
+ * coordinate and node 1 those at or above it, so a lower bound on the
+ * distance to any point of a node is the distance along the split axis,
+ * less EPSILON of slack for the fuzzy comparisons used in building it.
+ */
+static void
+setDistances(spgInnerConsistentIn *in, spgInnerConsistentOut *out,
+			 double coord)
+{
+	int			i,
+				j;
+
+	out->distances = (double **) palloc(sizeof(double *) * out->nNodes);
+	for (i = 0; i < out->nNodes; i++)
+	{
+		double	   *distances = (double *) palloc(sizeof(double) * in->norderbys);
+
+		for (j = 0; j < in->norderbys; j++)
+		{
+			ScanKey		orderby = &in->orderbys[j];
+			Point	   *query;
+			double		qcoord;
+
+			if (orderby->sk_strategy != RTKNNSearchStrategyNumber)
+				elog(ERROR, "unrecognized ordering strategy number: %d",
+					 orderby->sk_strategy);
+
+			if (orderby->sk_flags & SK_ISNULL)
+			{
+				distances[j] = get_float8_infinity();
+				continue;
+			}
+
+			query = DatumGetPointP(orderby->sk_argument);
+			qcoord = (in->level % 2) ? query->x : query->y;
+
+			if (out->nodeNumbers[i] == 0)
+				distances[j] = Max(0.0, qcoord - coord - EPSILON);
+			else
+				distances[j] = Max(0.0, coord - EPSILON - qcoord);
+		}
+		out->distances[i] = distances;
+	}
+}
+
 Datum
 spg_kd_inner_consistent(PG_FUNCTION_ARGS)
 {
@@ -289,11 +336,15 @@ spg_kd_inner_consistent(PG_FUNCTION_ARGS)
 			break;
 	}
 
+	if (in->norderbys > 0)
+		setDistances(in, out, coord);
+
 	PG_RETURN_VOID();
 }
 
 /*
  * spg_kd_leaf_consistent() is the same as spg_quad_leaf_consistent(),
- * since we support the same operators and the same leaf data type.
+ * since we support the same operators (including the distance ordering
+ * operator) and the same leaf data type.
  * So we just borrow that function.
  */
@@ -190,6 +190,72 @@ spg_quad_picksplit(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Compute a lower bound on the distance from the query point to any point
+ * in the given quadrant (numbered as for getQuadrant) of the centroid.
+ * We allow EPSILON of slack, since getQuadrant's tests are fuzzy.
+ */
+static double
+pointToQuadrantDistance(Point *centroid, int quadrant, Point *query)
+{
+	double		dx,
+				dy;
+
+	if (quadrant == 1 || quadrant == 2)
+		dx = Max(0.0, (centroid->x - EPSILON) - query->x);
+	else
+		dx = Max(0.0, query->x - (centroid->x + EPSILON));
+
+	if (quadrant == 1 || quadrant == 4)
+		dy = Max(0.0, (centroid->y - EPSILON) - query->y);
+	else
+		dy = Max(0.0, query->y - (centroid->y + EPSILON));
+
+	return HYPOT(dx, dy);
+}
+
+/*
+ * Subroutine to fill out->distances[] for spg_quad_inner_consistent, once
+ * out->nodeNumbers[] has been set.  For an allTheSame tuple, the nodes
+ * don't correspond to quadrants, so we can only say zero.
+ */
+static void
+setDistances(spgInnerConsistentIn *in, spgInnerConsistentOut *out,
+			 Point *centroid)
+{
+	int			i,
+				j;
+
+	out->distances = (double **) palloc(sizeof(double *) * out->nNodes);
+	for (i = 0; i < out->nNodes; i++)
+	{
+		double	   *distances = (double *) palloc(sizeof(double) * in->norderbys);
+
+		for (j = 0; j < in->norderbys; j++)
+		{
+			ScanKey		orderby = &in->orderbys[j];
+
+			if (orderby->sk_strategy != RTKNNSearchStrategyNumber)
+				elog(ERROR, "unrecognized ordering strategy number: %d",
+					 orderby->sk_strategy);
+
+			if (orderby->sk_flags & SK_ISNULL)
+				distances[j] = get_float8_infinity();
+			else if (in->allTheSame)
+				distances[j] = 0.0;
+			else
+			{
+				Point	   *query = DatumGetPointP(orderby->sk_argument);
+
+				distances[j] = pointToQuadrantDistance(centroid,
+													   out->nodeNumbers[i] + 1,
+													   query);
+			}
+		}
+		out->distances[i] = distances;
+	}
+}
+
 /* Subroutine to fill out->nodeNumbers[] for spg_quad_inner_consistent */
 static void
 setNodes(spgInnerConsistentOut *out, bool isAll, int first, int second)
@@ -233,6 +299,8 @@ spg_quad_inner_consistent(PG_FUNCTION_ARGS)
 		out->nodeNumbers = (int *) palloc(sizeof(int) * in->nNodes);
 		for (i = 0; i < in->nNodes; i++)
 			out->nodeNumbers[i] = i;
+		if (in->norderbys > 0)
+			setDistances(in, out, centroid);
 		PG_RETURN_VOID();
 	}
 
@@ -309,6 +377,9 @@ spg_quad_inner_consistent(PG_FUNCTION_ARGS)
 			break;
 	}
 
+	if (in->norderbys > 0)
+		setDistances(in, out, centroid);
+
 	PG_RETURN_VOID();
 }
 
@@ -360,5 +431,27 @@ spg_quad_leaf_consistent(PG_FUNCTION_ARGS)
 			break;
 	}
 
+	/* compute the exact distances, if it's an ordered scan and we match */
+	if (res && in->norderbys > 0)
+	{
+		int			i;
+
+		out->distances = (double *) palloc(sizeof(double) * in->norderbys);
+		for (i = 0; i < in->norderbys; i++)
+		{
+			ScanKey		orderby = &in->orderbys[i];
+
+			if (orderby->sk_strategy != RTKNNSearchStrategyNumber)
+				elog(ERROR, "unrecognized ordering strategy number: %d",
+					 orderby->sk_strategy);
+
+			if (orderby->sk_flags & SK_ISNULL)
+				out->distances[i] = get_float8_infinity();
+			else
+				out->distances[i] = point_dt(datum,
+											 DatumGetPointP(orderby->sk_argument));
+		}
+	}
+
 	PG_RETURN_BOOL(res);
 }
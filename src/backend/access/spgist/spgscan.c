@@ -23,11 +23,19 @@
 #include "utils/memutils.h"
 
 
+/*
+ * An item yet to be visited.  In an ordered scan, matching heap tuples are
+ * queued as well as index tuples; for those, ptr is the heap TID and
+ * reconstructedValue is the leaf value to return (if wanted).
+ */
 typedef struct ScanStackEntry
 {
 	Datum		reconstructedValue;		/* value reconstructed from parent */
 	int			level;			/* level of items on this page */
 	ItemPointerData ptr;		/* block and offset to scan from */
+	struct ScanStackEntry *next;	/* next item at same distances, if queued */
+	bool		isHeap;			/* is this a matching heap tuple? */
+	bool		recheck;		/* if so, must the quals be rechecked? */
 } ScanStackEntry;
 
 
@@ -56,18 +64,200 @@ freeScanStack(SpGistScanOpaque so)
 }
 
 /*
- * Initialize scanStack with a single entry for the root page, resetting
- * any previously active scan
+ * RBTree support functions for the SpGistSearchTreeItem queue used by
+ * ordered scans.  These work just like GiST's; see gistscan.c.
  */
+
+static int
+SpGistSearchTreeItemComparator(const RBNode *a, const RBNode *b, void *arg)
+{
+	const SpGistSearchTreeItem *sa = (const SpGistSearchTreeItem *) a;
+	const SpGistSearchTreeItem *sb = (const SpGistSearchTreeItem *) b;
+	SpGistScanOpaque so = (SpGistScanOpaque) arg;
+	int			i;
+
+	/* Order according to distance comparison */
+	for (i = 0; i < so->numberOfOrderBys; i++)
+	{
+		if (sa->distances[i] != sb->distances[i])
+			return (sa->distances[i] > sb->distances[i]) ? 1 : -1;
+	}
+
+	return 0;
+}
+
 static void
-resetSpGistScanOpaque(SpGistScanOpaque so)
+SpGistSearchTreeItemCombiner(RBNode *existing, const RBNode *newrb, void *arg)
+{
+	SpGistSearchTreeItem *scurrent = (SpGistSearchTreeItem *) existing;
+	const SpGistSearchTreeItem *snew = (const SpGistSearchTreeItem *) newrb;
+	ScanStackEntry *newitem = snew->head;
+
+	/* snew should have just one item in its chain */
+	Assert(newitem && newitem->next == NULL);
+
+	/*
+	 * If new item is a heap tuple, it goes to front of chain; otherwise
+	 * insert it before the first index item, so that index tuples are
+	 * visited in LIFO order, ensuring depth-first search of the tree.
+	 */
+	if (newitem->isHeap)
+	{
+		newitem->next = scurrent->head;
+		scurrent->head = newitem;
+		if (scurrent->lastHeap == NULL)
+			scurrent->lastHeap = newitem;
+	}
+	else if (scurrent->lastHeap == NULL)
+	{
+		newitem->next = scurrent->head;
+		scurrent->head = newitem;
+	}
+	else
+	{
+		newitem->next = scurrent->lastHeap->next;
+		scurrent->lastHeap->next = newitem;
+	}
+}
+
+static RBNode *
+SpGistSearchTreeItemAllocator(void *arg)
+{
+	SpGistScanOpaque so = (SpGistScanOpaque) arg;
+
+	return palloc(SGSTIHDRSZ + sizeof(double) * so->numberOfOrderBys);
+}
+
+static void
+SpGistSearchTreeItemDeleter(RBNode *rb, void *arg)
+{
+	pfree(rb);
+}
+
+/*
+ * Add an item, which must have been allocated in queueCxt, to the queue of
+ * an ordered scan at the given distances
+ */
+static void
+spgAddQueueItem(SpGistScanOpaque so, ScanStackEntry *item, double *distances)
+{
+	SpGistSearchTreeItem *tmpItem = so->tmpTreeItem;
+	MemoryContext oldCxt;
+	bool		isNew;
+
+	item->next = NULL;
+	tmpItem->head = item;
+	tmpItem->lastHeap = item->isHeap ? item : NULL;
+	memcpy(tmpItem->distances, distances,
+		   sizeof(double) * so->numberOfOrderBys);
+
+	oldCxt = MemoryContextSwitchTo(so->queueCxt);
+	(void) rb_insert(so->queue, (RBNode *) tmpItem, &isNew);
+	MemoryContextSwitchTo(oldCxt);
+}
+
+/*
+ * Queue a heap tuple that passed the quals of an ordered scan, at the
+ * distances just computed for it by spgLeafTest
+ */
+static void
+spgAddQueueHeap(SpGistScanOpaque so, ItemPointer heapPtr,
+				Datum leafValue, bool recheck)
 {
-	ScanStackEntry *startEntry = palloc0(sizeof(ScanStackEntry));
+	ScanStackEntry *item;
+
+	item = MemoryContextAllocZero(so->queueCxt, sizeof(ScanStackEntry));
+	item->ptr = *heapPtr;
+	item->isHeap = true;
+	item->recheck = recheck;
+	/* Must copy value out of temp context, if we'll need it */
+	if (so->want_itup)
+	{
+		MemoryContext oldCxt = MemoryContextSwitchTo(so->queueCxt);
+
+		item->reconstructedValue = datumCopy(leafValue,
+											 so->state.attType.attbyval,
+											 so->state.attType.attlen);
+		MemoryContextSwitchTo(oldCxt);
+	}
 
-	ItemPointerSet(&startEntry->ptr, SPGIST_HEAD_BLKNO, FirstOffsetNumber);
+	spgAddQueueItem(so, item, so->distances);
+}
+
+/*
+ * Extract the next item, in order of distance, from the queue of an ordered
+ * scan.  Returns NULL if the queue is empty.
+ *
+ * The SpGistSearchTreeItem the item came from is left in so->curTreeItem,
+ * so its distances stay available until the next call.
+ */
+static ScanStackEntry *
+spgGetQueueItem(SpGistScanOpaque so)
+{
+	for (;;)
+	{
+		ScanStackEntry *item;
+
+		/* Update curTreeItem if we don't have one */
+		if (so->curTreeItem == NULL)
+		{
+			so->curTreeItem = (SpGistSearchTreeItem *) rb_leftmost(so->queue);
+			/* Done when tree is empty */
+			if (so->curTreeItem == NULL)
+				return NULL;
+		}
+
+		item = so->curTreeItem->head;
+		if (item != NULL)
+		{
+			/* Delink item from chain */
+			so->curTreeItem->head = item->next;
+			if (item == so->curTreeItem->lastHeap)
+				so->curTreeItem->lastHeap = NULL;
+			return item;
+		}
+
+		/* curTreeItem is exhausted, so remove it from rbtree */
+		rb_delete(so->queue, (RBNode *) so->curTreeItem);
+		so->curTreeItem = NULL;
+	}
+}
+
+/*
+ * Initialize scanStack (or, in an ordered scan, the queue) with a single
+ * entry for the root page, resetting any previously active scan
+ */
+static void
+resetSpGistScanOpaque(SpGistScanOpaque so)
+{
+	ScanStackEntry *startEntry;
 
 	freeScanStack(so);
-	so->scanStack = list_make1(startEntry);
+
+	if (so->numberOfOrderBys > 0)
+	{
+		/* Throw away any old queue wholesale, and make a new one */
+		MemoryContextReset(so->queueCxt);
+		so->queue = rb_create(SGSTIHDRSZ + sizeof(double) * so->numberOfOrderBys,
+							  SpGistSearchTreeItemComparator,
+							  SpGistSearchTreeItemCombiner,
+							  SpGistSearchTreeItemAllocator,
+							  SpGistSearchTreeItemDeleter,
+							  so);
+		so->curTreeItem = NULL;
+
+		startEntry = MemoryContextAllocZero(so->queueCxt,
+											sizeof(ScanStackEntry));
+		ItemPointerSet(&startEntry->ptr, SPGIST_HEAD_BLKNO, FirstOffsetNumber);
+		memset(so->distances, 0, sizeof(double) * so->numberOfOrderBys);
+		spgAddQueueItem(so, startEntry, so->distances);
+	}
+	else
+	{
+		startEntry = palloc0(sizeof(ScanStackEntry));
+		ItemPointerSet(&startEntry->ptr, SPGIST_HEAD_BLKNO, FirstOffsetNumber);
+		so->scanStack = list_make1(startEntry);
+	}
 
 	if (so->want_itup)
 	{
@@ -85,11 +275,11 @@ spgbeginscan(PG_FUNCTION_ARGS)
 {
 	Relation	rel = (Relation) PG_GETARG_POINTER(0);
 	int			keysz = PG_GETARG_INT32(1);
-	/* ScanKey			scankey = (ScanKey) PG_GETARG_POINTER(2); */
+	int			norderbys = PG_GETARG_INT32(2);
 	IndexScanDesc scan;
 	SpGistScanOpaque so;
 
-	scan = RelationGetIndexScan(rel, keysz, 0);
+	scan = RelationGetIndexScan(rel, keysz, norderbys);
 
 	so = (SpGistScanOpaque) palloc0(sizeof(SpGistScanOpaqueData));
 	initSpGistState(&so->state, scan->indexRelation);
@@ -98,6 +288,22 @@ spgbeginscan(PG_FUNCTION_ARGS)
 										ALLOCSET_DEFAULT_MINSIZE,
 										ALLOCSET_DEFAULT_INITSIZE,
 										ALLOCSET_DEFAULT_MAXSIZE);
+
+	/* Set up the queue and its workspaces, if it's an ordered scan */
+	so->numberOfOrderBys = scan->numberOfOrderBys;
+	so->orderByData = scan->orderByData;
+	if (so->numberOfOrderBys > 0)
+	{
+		so->queueCxt = AllocSetContextCreate(CurrentMemoryContext,
+											 "SP-GiST queue context",
+											 ALLOCSET_DEFAULT_MINSIZE,
+											 ALLOCSET_DEFAULT_INITSIZE,
+											 ALLOCSET_DEFAULT_MAXSIZE);
+		so->tmpTreeItem = palloc(SGSTIHDRSZ +
+								 sizeof(double) * so->numberOfOrderBys);
+		so->distances = palloc(sizeof(double) * so->numberOfOrderBys);
+	}
+
 	resetSpGistScanOpaque(so);
 
 	/* Set up indexTupDesc and xs_itupdesc in case it's an index-only scan */
@@ -114,6 +320,7 @@ spgrescan(PG_FUNCTION_ARGS)
 	IndexScanDesc scan = (IndexScanDesc) PG_GETARG_POINTER(0);
 	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
 	ScanKey		scankey = (ScanKey) PG_GETARG_POINTER(1);
+	ScanKey		orderbys = (ScanKey) PG_GETARG_POINTER(3);
 
 	if (scankey && scan->numberOfKeys > 0)
 	{
@@ -121,6 +328,12 @@ spgrescan(PG_FUNCTION_ARGS)
 				scan->numberOfKeys * sizeof(ScanKeyData));
 	}
 
+	if (orderbys && scan->numberOfOrderBys > 0)
+	{
+		memmove(scan->orderByData, orderbys,
+				scan->numberOfOrderBys * sizeof(ScanKeyData));
+	}
+
 	resetSpGistScanOpaque(so);
 
 	PG_RETURN_VOID();
@@ -133,6 +346,8 @@ spgendscan(PG_FUNCTION_ARGS)
 	SpGistScanOpaque so = (SpGistScanOpaque) scan->opaque;
 
 	MemoryContextDelete(so->tempCxt);
+	if (so->queueCxt)
+		MemoryContextDelete(so->queueCxt);
 
 	PG_RETURN_VOID();
 }
@@ -156,6 +371,10 @@ spgrestrpos(PG_FUNCTION_ARGS)
  *
  * *leafValue is set to the reconstructed datum, if provided
  * *recheck is set true if any of the operators are lossy
+ *
+ * In an ordered scan, the leaf's distances are also computed into
+ * so->distances.  The ordering operators are passed along with the first
+ * qual only, so that the opclass computes them just once.
  */
 static bool
 spgLeafTest(Relation index, SpGistScanOpaque so, Datum leafDatum,
@@ -196,9 +415,12 @@ spgLeafTest(Relation index, SpGistScanOpaque so, Datum leafDatum,
 
 		in.strategy = skey->sk_strategy;
 		in.query = skey->sk_argument;
+		in.orderbys = (i == 0) ? so->orderByData : NULL;
+		in.norderbys = (i == 0) ? so->numberOfOrderBys : 0;
 
 		out.leafValue = (Datum) 0;
 		out.recheck = false;
+		out.distances = NULL;
 
 		result = DatumGetBool(FunctionCall2Coll(procinfo,
 												skey->sk_collation,
@@ -208,6 +430,14 @@ spgLeafTest(Relation index, SpGistScanOpaque so, Datum leafDatum,
 		*recheck |= out.recheck;
 		if (!result)
 			break;
+
+		if (in.norderbys > 0)
+		{
+			if (out.distances == NULL)
+				elog(ERROR, "SP-GiST leaf_consistent function did not return distances");
+			memcpy(so->distances, out.distances,
+				   sizeof(double) * in.norderbys);
+		}
 	}
 	MemoryContextSwitchTo(oldCtx);
 
@@ -220,6 +450,11 @@ spgLeafTest(Relation index, SpGistScanOpaque so, Datum leafDatum,
  *
  * If scanWholeIndex is true, we'll do just that.  If not, we'll stop at the
  * next page boundary once we have reported at least one tuple.
+ *
+ * In an ordered scan, the items to visit come off the distance-ordered
+ * queue instead of the stack, and matching leaf tuples go back into the
+ * queue rather than being reported at once; so tuples are reported one at
+ * a time, as each reaches the front of the queue.
  */
 static void
 spgWalk(Relation index, SpGistScanOpaque so, bool scanWholeIndex,
@@ -235,12 +470,33 @@ spgWalk(Relation index, SpGistScanOpaque so, bool scanWholeIndex,
 		OffsetNumber offset;
 		Page		page;
 
-		/* Pull next to-do item from the list */
-		if (so->scanStack == NIL)
-			break;				/* there are no more pages to scan */
+		if (so->numberOfOrderBys > 0)
+		{
+			/* Pull nearest to-do item from the queue */
+			stackEntry = spgGetQueueItem(so);
+			if (stackEntry == NULL)
+				break;			/* there is nothing more to scan */
 
-		stackEntry = (ScanStackEntry *) linitial(so->scanStack);
-		so->scanStack = list_delete_first(so->scanStack);
+			if (stackEntry->isHeap)
+			{
+				/* it's the nearest remaining match, so report it */
+				storeRes(so, &stackEntry->ptr,
+						 stackEntry->reconstructedValue,
+						 stackEntry->recheck);
+				reportedSome = true;
+				freeScanStackEntry(so, stackEntry);
+				continue;
+			}
+		}
+		else
+		{
+			/* Pull next to-do item from the list */
+			if (so->scanStack == NIL)
+				break;			/* there are no more pages to scan */
+
+			stackEntry = (ScanStackEntry *) linitial(so->scanStack);
+			so->scanStack = list_delete_first(so->scanStack);
+		}
 
 redirect:
 		/* Check for interrupts, just in case of infinite loop */
@@ -293,8 +549,14 @@ redirect:
 									&leafValue,
 									&recheck))
 					{
-						storeRes(so, &leafTuple->heapPtr, leafValue, recheck);
-						reportedSome = true;
+						if (so->numberOfOrderBys > 0)
+							spgAddQueueHeap(so, &leafTuple->heapPtr,
+											leafValue, recheck);
+						else
+						{
+							storeRes(so, &leafTuple->heapPtr, leafValue, recheck);
+							reportedSome = true;
+						}
 					}
 				}
 			}
@@ -338,8 +600,14 @@ redirect:
 									&leafValue,
 									&recheck))
 					{
-						storeRes(so, &leafTuple->heapPtr, leafValue, recheck);
-						reportedSome = true;
+						if (so->numberOfOrderBys > 0)
+							spgAddQueueHeap(so, &leafTuple->heapPtr,
+											leafValue, recheck);
+						else
+						{
+							storeRes(so, &leafTuple->heapPtr, leafValue, recheck);
+							reportedSome = true;
+						}
 					}
 
 					offset = leafTuple->nextOffset;
@@ -407,6 +675,7 @@ redirect:
 				int		   *andMap;
 				int		   *levelAdds;
 				Datum	   *reconstructedValues;
+				double	   *nodeDistances = NULL;
 				int			j,
 							nMatches = 0;
 				MemoryContext oldCtx;
@@ -434,6 +703,9 @@ redirect:
 				andMap = (int *) palloc0(sizeof(int) * in.nNodes);
 				levelAdds = (int *) palloc0(sizeof(int) * in.nNodes);
 				reconstructedValues = (Datum *) palloc0(sizeof(Datum) * in.nNodes);
+				if (so->numberOfOrderBys > 0)
+					nodeDistances = (double *)
+						palloc0(sizeof(double) * so->numberOfOrderBys * in.nNodes);
 
 				procinfo = index_getprocinfo(index, 1, SPGIST_INNER_CONSISTENT_PROC);
 
@@ -450,6 +722,9 @@ redirect:
 
 					in.strategy = skey->sk_strategy;
 					in.query = skey->sk_argument;
+					/* pass the ordering operators along with the first qual */
+					in.orderbys = (j == 0) ? so->orderByData : NULL;
+					in.norderbys = (j == 0) ? so->numberOfOrderBys : 0;
 
 					memset(&out, 0, sizeof(out));
 
@@ -463,6 +738,10 @@ redirect:
 						if (out.nNodes != 0 && out.nNodes != in.nNodes)
 							elog(ERROR, "inconsistent inner_consistent results for allTheSame inner tuple");
 
+					if (in.norderbys > 0 && out.nNodes > 0 &&
+						out.distances == NULL)
+						elog(ERROR, "SP-GiST inner_consistent function did not return distances");
+
 					nMatches = 0;
 					for (i = 0; i < out.nNodes; i++)
 					{
@@ -475,6 +754,10 @@ redirect:
 							levelAdds[nodeN] = out.levelAdds[i];
 						if (out.reconstructedValues)
 							reconstructedValues[nodeN] = out.reconstructedValues[i];
+						if (in.norderbys > 0)
+							memcpy(nodeDistances + nodeN * in.norderbys,
+								   out.distances[i],
+								   sizeof(double) * in.norderbys);
 					}
 
 					/* quit as soon as all nodes have failed some qual */
@@ -494,7 +777,9 @@ redirect:
 							ScanStackEntry *newEntry;
 
 							/* Create new work item for this node */
-							newEntry = palloc(sizeof(ScanStackEntry));
+							if (so->numberOfOrderBys > 0)
+								oldCtx = MemoryContextSwitchTo(so->queueCxt);
+							newEntry = palloc0(sizeof(ScanStackEntry));
 							newEntry->ptr = nodes[i]->t_tid;
 							newEntry->level = stackEntry->level + levelAdds[i];
 							/* Must copy value out of temp context */
@@ -503,7 +788,26 @@ redirect:
 										  so->state.attType.attbyval,
 										  so->state.attType.attlen);
 
-							so->scanStack = lcons(newEntry, so->scanStack);
+							if (so->numberOfOrderBys > 0)
+							{
+								double	   *distances;
+								int			k;
+
+								MemoryContextSwitchTo(oldCtx);
+
+								/*
+								 * A child can be no nearer than its parent,
+								 * whatever bound the opclass computed.
+								 */
+								distances = nodeDistances + i * so->numberOfOrderBys;
+								for (k = 0; k < so->numberOfOrderBys; k++)
+									so->distances[k] =
+										Max(distances[k],
+											so->curTreeItem->distances[k]);
+								spgAddQueueItem(so, newEntry, so->distances);
+							}
+							else
+								so->scanStack = lcons(newEntry, so->scanStack);
 						}
 					}
 				}
@@ -0,0 +1,80 @@
+/*-------------------------------------------------------------------------
+ *
+ * tableam.c
+ *	  table access method selection
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/table/tableam.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tableam.h"
+#include "catalog/catalog.h"
+#include "catalog/pg_class.h"
+#include "utils/rel.h"
+
+
+/* Hook for plugins to choose the access method of a table */
+table_am_lookup_hook_type table_am_lookup_hook = NULL;
+
+
+/*
+ * GetTableAmRoutine - get the table access method of a relation
+ *
+ * Only plain tables may use another access method than heap; the hook is
+ * consulted once for each relcache entry, and its answer kept there.
+ */
+const TableAmRoutine *
+GetTableAmRoutine(Relation rel)
+{
+	const TableAmRoutine *routine;
+
+	if (rel->rd_tableam != NULL)
+		return rel->rd_tableam;
+
+	routine = NULL;
+	if (table_am_lookup_hook && rel->rd_rel->relkind == RELKIND_RELATION &&
+		!IsSystemRelation(rel))
+		routine = (*table_am_lookup_hook) (rel);
+	if (routine == NULL)
+		routine = GetHeapamTableAmRoutine();
+	else if (!IsA(routine, TableAmRoutine))
+		elog(ERROR, "table access method of relation \"%s\" is not a TableAmRoutine struct",
+			 RelationGetRelationName(rel));
+
+	rel->rd_tableam = routine;
+	return routine;
+}
+
+/*
+ * RelationIsHeap - is the relation stored as a heap?
+ *
+ * Code that works on heap pages directly, such as index builds and table
+ * rewrites, must check this first.
+ */
+bool
+RelationIsHeap(Relation rel)
+{
+	return GetTableAmRoutine(rel) == GetHeapamTableAmRoutine();
+}
+
+/*
+ * CheckTableIsHeap - complain if the table isn't stored as a heap
+ *
+ * what names the command that needs a heap, eg "CLUSTER".
+ */
+void
+CheckTableIsHeap(Relation rel, const char *what)
+{
+	if (!RelationIsHeap(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("%s is not supported for table \"%s\"",
+						what, RelationGetRelationName(rel)),
+				 errdetail("The table's access method does not store it as a heap.")));
+}
@@ -99,6 +99,10 @@ static SlruCtlData MultiXactMemberCtlData;
 #define MultiXactOffsetCtl	(&MultiXactOffsetCtlData)
 #define MultiXactMemberCtl	(&MultiXactMemberCtlData)
 
+/* GUC parameters: numbers of buffers, or 0 to size by shared_buffers */
+int			multixact_offset_buffers = 0;
+int			multixact_member_buffers = 0;
+
 /*
  * MultiXact state shared across all backends.	All this state is protected
  * by MultiXactGenLock.  (We also use MultiXactOffsetControlLock and
@@ -281,7 +285,10 @@ MultiXactIdCreate(TransactionId xid1, TransactionId xid2)
  *		Add a TransactionId to a pre-existing MultiXactId.
  *
  * If the TransactionId is already a member of the passed MultiXactId,
- * just return it as-is.
+ * just return it as-is.  If none of the existing members is still running,
+ * return InvalidMultiXactId: the caller should then store the bare
+ * TransactionId, since a one-member MultiXactId would only consume space
+ * in pg_multixact and make every later visibility check look it up.
  *
  * Note that we do NOT actually modify the membership of a pre-existing
  * MultiXactId; instead we create a new one.  This is necessary to avoid
@@ -315,13 +322,10 @@ MultiXactIdExpand(MultiXactId multi, TransactionId xid)
 		 * MultiXactId members stop running between the caller checking and
 		 * passing it to us.  It would be better to return that fact to the
 		 * caller, but it would complicate the API and it's unlikely to happen
-		 * too often, so just deal with it by creating a singleton MultiXact.
+		 * too often, so just tell the caller to use the bare xid.
 		 */
-		newMulti = CreateMultiXactId(1, &xid);
-
-		debug_elog4(DEBUG2, "Expand: %u has no members, create singleton %u",
-					multi, newMulti);
-		return newMulti;
+		debug_elog3(DEBUG2, "Expand: %u has no members", multi);
+		return InvalidMultiXactId;
 	}
 
 	/*
@@ -343,7 +347,8 @@ MultiXactIdExpand(MultiXactId multi, TransactionId xid)
 	 * Determine which of the members of the MultiXactId are still running,
 	 * and use them to create a new one.  (Removing dead members is just an
 	 * optimization, but a useful one.	Note we have the same race condition
-	 * here as above: j could be 0 at the end of the loop.)
+	 * here as above: j could be 0 at the end of the loop, handled the same
+	 * way.)
 	 */
 	newMembers = (TransactionId *)
 		palloc(sizeof(TransactionId) * (nmembers + 1));
@@ -354,6 +359,14 @@ MultiXactIdExpand(MultiXactId multi, TransactionId xid)
 			newMembers[j++] = members[i];
 	}
 
+	if (j == 0)
+	{
+		debug_elog3(DEBUG2, "Expand: no member of %u is running", multi);
+		pfree(members);
+		pfree(newMembers);
+		return InvalidMultiXactId;
+	}
+
 	newMembers[j++] = xid;
 	newMulti = CreateMultiXactId(j, newMembers);
 
@@ -784,7 +797,10 @@ RecordNewMultiXact(MultiXactId multi, MultiXactOffset offset,
 
 		if (pageno != prev_pageno)
 		{
-			slotno = SimpleLruReadPage(MultiXactMemberCtl, pageno, true, multi);
+			if (prev_pageno != -1)
+				LWLockRelease(MultiXactMemberControlLock);
+			slotno = SimpleLruReadPage_ReadOnly(MultiXactMemberCtl, pageno,
+												multi);
 			prev_pageno = pageno;
 		}
 
@@ -999,12 +1015,18 @@ GetMultiXactIdMembers(MultiXactId multi, TransactionId **xids)
 	 * time on every multixact creation.
 	 */
 retry:
-	LWLockAcquire(MultiXactOffsetControlLock, LW_EXCLUSIVE);
-
 	pageno = MultiXactIdToOffsetPage(multi);
 	entryno = MultiXactIdToOffsetEntry(multi);
 
-	slotno = SimpleLruReadPage(MultiXactOffsetCtl, pageno, true, multi);
+	/*
+	 * We only read the SLRU pages here, so use the shared-lock path: lookups
+	 * of running multixacts (every visibility check on a share-locked row)
+	 * then don't serialize on the control locks when the pages are cached.
+	 * We get the control lock back from SimpleLruReadPage_ReadOnly, in
+	 * shared or exclusive mode, and must drop it before reading another
+	 * page.
+	 */
+	slotno = SimpleLruReadPage_ReadOnly(MultiXactOffsetCtl, pageno, multi);
 	offptr = (MultiXactOffset *) MultiXactOffsetCtl->shared->page_buffer[slotno];
 	offptr += entryno;
 	offset = *offptr;
@@ -1036,7 +1058,11 @@ retry:
 		entryno = MultiXactIdToOffsetEntry(tmpMXact);
 
 		if (pageno != prev_pageno)
-			slotno = SimpleLruReadPage(MultiXactOffsetCtl, pageno, true, tmpMXact);
+		{
+			LWLockRelease(MultiXactOffsetControlLock);
+			slotno = SimpleLruReadPage_ReadOnly(MultiXactOffsetCtl, pageno,
+												tmpMXact);
+		}
 
 		offptr = (MultiXactOffset *) MultiXactOffsetCtl->shared->page_buffer[slotno];
 		offptr += entryno;
@@ -1059,8 +1085,6 @@ retry:
 	*xids = ptr;
 
 	/* Now get the members themselves. */
-	LWLockAcquire(MultiXactMemberControlLock, LW_EXCLUSIVE);
-
 	truelength = 0;
 	prev_pageno = -1;
 	for (i = 0; i < length; i++, offset++)
@@ -1090,7 +1114,8 @@ retry:
 		ptr[truelength++] = *xactptr;
 	}
 
-	LWLockRelease(MultiXactMemberControlLock);
+	if (prev_pageno != -1)
+		LWLockRelease(MultiXactMemberControlLock);
 
 	/*
 	 * Copy the result into the local cache.
@@ -1382,6 +1407,28 @@ multixact_twophase_postabort(TransactionId xid, uint16 info,
  * thus double memory.	Also, reserve space for the shared MultiXactState
  * struct and the per-backend MultiXactId arrays (two of those, too).
  */
+/*
+ * Numbers of shared buffers for the MultiXact SLRUs.  By default they grow
+ * from the 8 and 16 that used to be fixed as shared_buffers increases, since
+ * row locking by many sessions (foreign key checks, for instance) can touch
+ * many pages.
+ */
+Size
+MultiXactOffsetShmemBuffers(void)
+{
+	if (multixact_offset_buffers > 0)
+		return Max(4, multixact_offset_buffers);
+	return Min(128, Max(8, NBuffers / 1024));
+}
+
+Size
+MultiXactMemberShmemBuffers(void)
+{
+	if (multixact_member_buffers > 0)
+		return Max(4, multixact_member_buffers);
+	return Min(256, Max(16, NBuffers / 512));
+}
+
 Size
 MultiXactShmemSize(void)
 {
@@ -1392,8 +1439,8 @@ MultiXactShmemSize(void)
 			 mul_size(sizeof(MultiXactId) * 2, MaxOldestSlot))
 
 	size = SHARED_MULTIXACT_STATE_SIZE;
-	size = add_size(size, SimpleLruShmemSize(NUM_MXACTOFFSET_BUFFERS, 0));
-	size = add_size(size, SimpleLruShmemSize(NUM_MXACTMEMBER_BUFFERS, 0));
+	size = add_size(size, SimpleLruShmemSize(MultiXactOffsetShmemBuffers(), 0));
+	size = add_size(size, SimpleLruShmemSize(MultiXactMemberShmemBuffers(), 0));
 
 	return size;
 }
@@ -1409,10 +1456,10 @@ MultiXactShmemInit(void)
 	MultiXactMemberCtl->PagePrecedes = MultiXactMemberPagePrecedes;
 
 	SimpleLruInit(MultiXactOffsetCtl,
-				  "MultiXactOffset Ctl", NUM_MXACTOFFSET_BUFFERS, 0,
+				  "MultiXactOffset Ctl", MultiXactOffsetShmemBuffers(), 0,
 				  MultiXactOffsetControlLock, "pg_multixact/offsets");
 	SimpleLruInit(MultiXactMemberCtl,
-				  "MultiXactMember Ctl", NUM_MXACTMEMBER_BUFFERS, 0,
+				  "MultiXactMember Ctl", MultiXactMemberShmemBuffers(), 0,
 				  MultiXactMemberControlLock, "pg_multixact/members");
 
 	/* Initialize our shared state struct */
@@ -13,6 +13,14 @@
  * The management algorithm is straight LRU except that we will never swap
  * out the latest page (since we know it's going to be hit again eventually).
  *
+ * Some workloads do want many buffers, though (pg_subtrans with many
+ * subtransactions, for instance), and then a linear search of all of them
+ * would be slow.  So the buffers are divided into banks of at most
+ * SLRU_BANK_SIZE slots, and each page can only live in the bank selected
+ * by its page number.  Searches and LRU replacement look at that bank only;
+ * consecutive pages go to different banks, so the recently used pages are
+ * spread over all of them.
+ *
  * We use a control LWLock to protect the shared data structures, plus
  * per-buffer LWLocks that synchronize I/O for each buffer.  The control lock
  * must be held to examine or modify any shared state.	A process that is
@@ -108,6 +116,25 @@ typedef struct SlruFlushData *SlruFlush;
 		} \
 	} while (0)
 
+/*
+ * The slots of a bank are bank_start(bankno) .. bank_start(bankno + 1) - 1.
+ * Banks differ by at most one slot in size if num_slots isn't a multiple of
+ * num_banks.
+ */
+#define SlruBankStart(shared, bankno) \
+	((int) (((int64) (bankno) * (shared)->num_slots) / (shared)->num_banks))
+#define SlruPageBank(shared, pageno) \
+	((int) ((uint32) (pageno) % (uint32) (shared)->num_banks))
+
+/*
+ * SLRUs initialized in this process, for SlruGetStats.  There are only a
+ * handful of them.
+ */
+#define MAX_REGISTERED_SLRUS	16
+
+static SlruCtl RegisteredSlrus[MAX_REGISTERED_SLRUS];
+static int	NumRegisteredSlrus = 0;
+
 /* Saved info for SlruReportIOError */
 typedef enum
 {
@@ -184,6 +211,7 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 		shared->ControlLock = ctllock;
 
 		shared->num_slots = nslots;
+		shared->num_banks = Max(nslots / SLRU_BANK_SIZE, 1);
 		shared->lsn_groups_per_page = nlsns;
 
 		shared->cur_lru_count = 0;
@@ -232,6 +260,19 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 	ctl->shared = shared;
 	ctl->do_fsync = true;		/* default behavior */
 	StrNCpy(ctl->Dir, subdir, sizeof(ctl->Dir));
+
+	/* Remember it for SlruGetStats, unless we're reinitializing */
+	{
+		int			i;
+
+		for (i = 0; i < NumRegisteredSlrus; i++)
+		{
+			if (RegisteredSlrus[i] == ctl)
+				break;
+		}
+		if (i == NumRegisteredSlrus && i < MAX_REGISTERED_SLRUS)
+			RegisteredSlrus[NumRegisteredSlrus++] = ctl;
+	}
 }
 
 /*
@@ -385,6 +426,7 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 			}
 			/* Otherwise, it's ready to use */
 			SlruRecentlyUsed(shared, slotno);
+			shared->stat_hits++;
 			return slotno;
 		}
 
@@ -424,6 +466,7 @@ SimpleLruReadPage(SlruCtl ctl, int pageno, bool write_ok,
 			   !shared->page_dirty[slotno]);
 
 		shared->page_status[slotno] = ok ? SLRU_PAGE_VALID : SLRU_PAGE_EMPTY;
+		shared->stat_reads++;
 
 		LWLockRelease(shared->buffer_locks[slotno]);
 
@@ -454,13 +497,15 @@ int
 SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankno = SlruPageBank(shared, pageno);
+	int			bankend = SlruBankStart(shared, bankno + 1);
 	int			slotno;
 
 	/* Try to find the page while holding only shared lock */
 	LWLockAcquire(shared->ControlLock, LW_SHARED);
 
 	/* See if page is already in a buffer */
-	for (slotno = 0; slotno < shared->num_slots; slotno++)
+	for (slotno = SlruBankStart(shared, bankno); slotno < bankend; slotno++)
 	{
 		if (shared->page_number[slotno] == pageno &&
 			shared->page_status[slotno] != SLRU_PAGE_EMPTY &&
@@ -468,6 +513,7 @@ SimpleLruReadPage_ReadOnly(SlruCtl ctl, int pageno, TransactionId xid)
 		{
 			/* See comments for SlruRecentlyUsed macro */
 			SlruRecentlyUsed(shared, slotno);
+			shared->stat_hits++;
 			return slotno;
 		}
 	}
@@ -547,6 +593,8 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruFlush fdata)
 	/* If we failed to write, mark the page dirty again */
 	if (!ok)
 		shared->page_dirty[slotno] = true;
+	else
+		shared->stat_writes++;
 
 	shared->page_status[slotno] = SLRU_PAGE_VALID;
 
@@ -893,7 +941,7 @@ SlruReportIOError(SlruCtl ctl, int pageno, TransactionId xid)
  * any slot already holds the target page, and return that slot if so.
  * Thus, the returned slot is *either* a slot already holding the pageno
  * (could be any state except EMPTY), *or* a freeable slot (state EMPTY
- * or CLEAN).
+ * or CLEAN).  Either way it is in the page's bank.
  *
  * Control lock must be held at entry, and will be held at exit.
  */
@@ -901,6 +949,9 @@ static int
 SlruSelectLRUPage(SlruCtl ctl, int pageno)
 {
 	SlruShared	shared = ctl->shared;
+	int			bankno = SlruPageBank(shared, pageno);
+	int			bankstart = SlruBankStart(shared, bankno);
+	int			bankend = SlruBankStart(shared, bankno + 1);
 
 	/* Outer loop handles restart after I/O */
 	for (;;)
@@ -912,7 +963,7 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		int			best_page_number;
 
 		/* See if page already has a buffer assigned */
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			if (shared->page_number[slotno] == pageno &&
 				shared->page_status[slotno] != SLRU_PAGE_EMPTY)
@@ -943,9 +994,9 @@ SlruSelectLRUPage(SlruCtl ctl, int pageno)
 		 */
 		cur_count = (shared->cur_lru_count)++;
 		best_delta = -1;
-		bestslot = 0;			/* no-op, just keeps compiler quiet */
+		bestslot = bankstart;	/* no-op, just keeps compiler quiet */
 		best_page_number = 0;	/* ditto */
-		for (slotno = 0; slotno < shared->num_slots; slotno++)
+		for (slotno = bankstart; slotno < bankend; slotno++)
 		{
 			int			this_delta;
 			int			this_page_number;
@@ -1237,3 +1288,32 @@ SlruScanDirectory(SlruCtl ctl, SlruScanCallback callback, void *data)
 
 	return retval;
 }
+
+/*
+ * SlruGetStats
+ *		Report on the index'th SLRU known to this process
+ *
+ * Returns false if there are fewer SLRUs than that.  The name reported is
+ * the SLRU's directory.
+ */
+bool
+SlruGetStats(int index, const char **name, int *nslots,
+			 int64 *hits, int64 *reads, int64 *writes)
+{
+	SlruShared	shared;
+
+	if (index < 0 || index >= NumRegisteredSlrus)
+		return false;
+
+	shared = RegisteredSlrus[index]->shared;
+
+	LWLockAcquire(shared->ControlLock, LW_SHARED);
+	*name = RegisteredSlrus[index]->Dir;
+	*nslots = shared->num_slots;
+	*hits = shared->stat_hits;
+	*reads = shared->stat_reads;
+	*writes = shared->stat_writes;
+	LWLockRelease(shared->ControlLock);
+
+	return true;
+}
@@ -31,6 +31,8 @@
 #include "access/slru.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
+#include "access/xlog.h"
+#include "miscadmin.h"
 #include "pg_trace.h"
 #include "utils/snapmgr.h"
 
@@ -61,6 +63,39 @@ static SlruCtlData SubTransCtlData;
 
 #define SubTransCtl  (&SubTransCtlData)
 
+/* GUC parameter: number of SUBTRANS buffers, or 0 to size by shared_buffers */
+int			subtrans_buffers = 0;
+
+/*
+ * Backend-local cache of SubTransGetTopmostTransaction results.
+ *
+ * Once a transaction with more than PGPROC_MAX_CACHED_SUBXIDS
+ * subtransactions has overflowed its PGPROC subxid cache, snapshots taken
+ * while it runs check every xid they see against pg_subtrans,
+ * and they see the same few xids over and over (those of the rows a scan
+ * visits).  Remembering the answers saves most of the trips through the
+ * shared SUBTRANS buffers and their control lock.
+ *
+ * An xid's parent doesn't change once it is set, which happens before the
+ * xid can be seen anywhere but in its PGPROC (see AssignTransactionId);
+ * so the answers stay right until the xid counter wraps around.  We empty
+ * the cache whenever TransactionXmin has moved more than
+ * TOPMOST_CACHE_HORIZON from where it was at the last emptying, long before
+ * that.  In hot standby, parents are recorded only as WAL replay gets to
+ * them, so we don't cache at all during recovery.
+ */
+#define TOPMOST_CACHE_SIZE		1024	/* must be a power of 2 */
+#define TOPMOST_CACHE_HORIZON	((uint32) 1 << 24)
+
+typedef struct TopmostCacheEntry
+{
+	TransactionId xid;			/* InvalidTransactionId if unused */
+	TransactionId topmostXid;
+} TopmostCacheEntry;
+
+static TopmostCacheEntry topmostCache[TOPMOST_CACHE_SIZE];
+static TransactionId topmostCacheXmin = InvalidTransactionId;
+
 
 static int	ZeroSUBTRANSPage(int pageno);
 static bool SubTransPagePrecedes(int page1, int page2);
@@ -147,10 +182,29 @@ SubTransGetTopmostTransaction(TransactionId xid)
 {
 	TransactionId parentXid = xid,
 				previousXid = xid;
+	TopmostCacheEntry *entry = NULL;
 
 	/* Can't ask about stuff that might not be around anymore */
 	Assert(TransactionIdFollowsOrEquals(xid, TransactionXmin));
 
+	if (TransactionIdIsNormal(xid) && !RecoveryInProgress())
+	{
+		/*
+		 * The unsigned difference is also large if TransactionXmin has gone
+		 * backwards, which is fine: we just start over.
+		 */
+		if (!TransactionIdIsValid(topmostCacheXmin) ||
+			(uint32) (TransactionXmin - topmostCacheXmin) > TOPMOST_CACHE_HORIZON)
+		{
+			MemSet(topmostCache, 0, sizeof(topmostCache));
+			topmostCacheXmin = TransactionXmin;
+		}
+
+		entry = &topmostCache[xid & (TOPMOST_CACHE_SIZE - 1)];
+		if (entry->xid == xid)
+			return entry->topmostXid;
+	}
+
 	while (TransactionIdIsValid(parentXid))
 	{
 		previousXid = parentXid;
@@ -161,24 +215,47 @@ SubTransGetTopmostTransaction(TransactionId xid)
 
 	Assert(TransactionIdIsValid(previousXid));
 
+	if (entry != NULL)
+	{
+		entry->xid = xid;
+		entry->topmostXid = previousXid;
+	}
+
 	return previousXid;
 }
 
 
+/*
+ * Number of shared SUBTRANS buffers.
+ *
+ * Transactions with many subtransactions, once they overflow the subxid
+ * cache in PGPROC, make every snapshot check look up parents here, over a
+ * range of pages that grows with the age of the oldest such transaction.
+ * So by default we scale the number with shared_buffers, from the 32 that
+ * used to be fixed up to 1024.
+ */
+Size
+SUBTRANSShmemBuffers(void)
+{
+	if (subtrans_buffers > 0)
+		return Max(16, subtrans_buffers);
+	return Min(1024, Max(32, NBuffers / 256));
+}
+
 /*
  * Initialization of shared memory for SUBTRANS
  */
 Size
 SUBTRANSShmemSize(void)
 {
-	return SimpleLruShmemSize(NUM_SUBTRANS_BUFFERS, 0);
+	return SimpleLruShmemSize(SUBTRANSShmemBuffers(), 0);
 }
 
 void
 SUBTRANSShmemInit(void)
 {
 	SubTransCtl->PagePrecedes = SubTransPagePrecedes;
-	SimpleLruInit(SubTransCtl, "SUBTRANS Ctl", NUM_SUBTRANS_BUFFERS, 0,
+	SimpleLruInit(SubTransCtl, "SUBTRANS Ctl", SUBTRANSShmemBuffers(), 0,
 				  SubtransControlLock, "pg_subtrans");
 	/* Override default assumption that writes should be fsync'd */
 	SubTransCtl->do_fsync = false;
@@ -28,14 +28,51 @@
 const XLogRecPtr InvalidXLogRecPtr = {0, 0};
 
 /*
- * Single-item cache for results of TransactionLogFetch.  It's worth having
- * such a cache because we frequently find ourselves repeatedly checking the
- * same XID, for example when scanning a table just after a bulk insert,
- * update, or delete.
+ * Cache for results of TransactionLogFetch.  It's worth having such a cache
+ * because we frequently find ourselves repeatedly checking the same XIDs,
+ * for example when scanning a table just after a bulk insert, update, or
+ * delete, or one whose rows were written by a mix of recent transactions
+ * and so can't be hinted yet.  It is direct-mapped by XID.
+ *
+ * Only final statuses are cached, and those don't change until the XID
+ * counter wraps around.  To be sure we never get that far, the cache is
+ * emptied whenever TransactionXmin has advanced (or gone back) more than
+ * XID_STATUS_CACHE_HORIZON since it was last emptied.  A process that has
+ * no TransactionXmin uses a single entry of its own instead, like the
+ * single-item cache this replaced.
+ */
+#define XID_STATUS_CACHE_SIZE		512		/* must be a power of 2 */
+#define XID_STATUS_CACHE_HORIZON	((uint32) 1 << 24)
+
+typedef struct XidStatusCacheEntry
+{
+	TransactionId xid;			/* InvalidTransactionId if unused */
+	XidStatus	status;
+	XLogRecPtr	commitLSN;
+} XidStatusCacheEntry;
+
+static XidStatusCacheEntry xidStatusCache[XID_STATUS_CACHE_SIZE];
+static XidStatusCacheEntry xidStatusFallback;
+static TransactionId xidStatusCacheXmin = InvalidTransactionId;
+
+/*
+ * Find the cache entry for an XID, which may currently hold another one.
  */
-static TransactionId cachedFetchXid = InvalidTransactionId;
-static XidStatus cachedFetchXidStatus;
-static XLogRecPtr cachedCommitLSN;
+static inline XidStatusCacheEntry *
+XidStatusCacheSlot(TransactionId xid)
+{
+	if (!TransactionIdIsValid(TransactionXmin))
+		return &xidStatusFallback;
+
+	if (!TransactionIdIsValid(xidStatusCacheXmin) ||
+		(uint32) (TransactionXmin - xidStatusCacheXmin) > XID_STATUS_CACHE_HORIZON)
+	{
+		MemSet(xidStatusCache, 0, sizeof(xidStatusCache));
+		xidStatusCacheXmin = TransactionXmin;
+	}
+
+	return &xidStatusCache[xid & (XID_STATUS_CACHE_SIZE - 1)];
+}
 
 /* Local functions */
 static XidStatus TransactionLogFetch(TransactionId transactionId);
@@ -56,16 +93,10 @@ TransactionLogFetch(TransactionId transactionId)
 {
 	XidStatus	xidstatus;
 	XLogRecPtr	xidlsn;
+	XidStatusCacheEntry *entry;
 
 	/*
-	 * Before going to the commit log manager, check our single item cache to
-	 * see if we didn't just check the transaction status a moment ago.
-	 */
-	if (TransactionIdEquals(transactionId, cachedFetchXid))
-		return cachedFetchXidStatus;
-
-	/*
-	 * Also, check to see if the transaction ID is a permanent one.
+	 * Check to see if the transaction ID is a permanent one.
 	 */
 	if (!TransactionIdIsNormal(transactionId))
 	{
@@ -76,6 +107,14 @@ TransactionLogFetch(TransactionId transactionId)
 		return TRANSACTION_STATUS_ABORTED;
 	}
 
+	/*
+	 * Before going to the commit log manager, check our cache to see if we
+	 * didn't check the transaction status a moment ago.
+	 */
+	entry = XidStatusCacheSlot(transactionId);
+	if (TransactionIdEquals(entry->xid, transactionId))
+		return entry->status;
+
 	/*
 	 * Get the transaction status.
 	 */
@@ -88,9 +127,9 @@ TransactionLogFetch(TransactionId transactionId)
 	if (xidstatus != TRANSACTION_STATUS_IN_PROGRESS &&
 		xidstatus != TRANSACTION_STATUS_SUB_COMMITTED)
 	{
-		cachedFetchXid = transactionId;
-		cachedFetchXidStatus = xidstatus;
-		cachedCommitLSN = xidlsn;
+		entry->xid = transactionId;
+		entry->status = xidstatus;
+		entry->commitLSN = xidlsn;
 	}
 
 	return xidstatus;
@@ -240,13 +279,10 @@ TransactionIdDidAbort(TransactionId transactionId)
 bool
 TransactionIdIsKnownCompleted(TransactionId transactionId)
 {
-	if (TransactionIdEquals(transactionId, cachedFetchXid))
-	{
-		/* If it's in the cache at all, it must be completed. */
-		return true;
-	}
+	XidStatusCacheEntry *entry = XidStatusCacheSlot(transactionId);
 
-	return false;
+	/* If it's in the cache at all, it must be completed. */
+	return TransactionIdEquals(entry->xid, transactionId);
 }
 
 /*
@@ -405,6 +441,11 @@ XLogRecPtr
 TransactionIdGetCommitLSN(TransactionId xid)
 {
 	XLogRecPtr	result;
+	XidStatusCacheEntry *entry;
+
+	/* Special XIDs are always known committed */
+	if (!TransactionIdIsNormal(xid))
+		return InvalidXLogRecPtr;
 
 	/*
 	 * Currently, all uses of this function are for xids that were just
@@ -412,12 +453,9 @@ TransactionIdGetCommitLSN(TransactionId xid)
 	 * checking TransactionLogFetch's cache will usually succeed and avoid an
 	 * extra trip to shared memory.
 	 */
-	if (TransactionIdEquals(xid, cachedFetchXid))
-		return cachedCommitLSN;
-
-	/* Special XIDs are always known committed */
-	if (!TransactionIdIsNormal(xid))
-		return InvalidXLogRecPtr;
+	entry = XidStatusCacheSlot(xid);
+	if (entry != NULL && TransactionIdEquals(entry->xid, xid))
+		return entry->commitLSN;
 
 	/*
 	 * Get the transaction status.
@@ -67,9 +67,6 @@ bool		XactDeferrable;
 
 int			synchronous_commit = SYNCHRONOUS_COMMIT_ON;
 
-int			CommitDelay = 0;	/* precommit delay in microseconds */
-int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
-
 /*
  * MyXactAccessedTempRel is set when a temporary relation is accessed.
  * We don't allow PREPARE TRANSACTION in that case.  (This is global
@@ -1097,19 +1094,10 @@ RecordTransactionCommit(void)
 		/*
 		 * Synchronous commit case:
 		 *
-		 * Sleep before flush! So we can flush more than one commit records
-		 * per single fsync.  (The idea is some other backend may do the
-		 * XLogFlush while we're sleeping.  This needs work still, because on
-		 * most Unixen, the minimum select() delay is 10msec or more, which is
-		 * way too long.)
-		 *
-		 * We do not sleep if enableFsync is not turned on, nor if there are
-		 * fewer than CommitSiblings other backends with active transactions.
+		 * XLogFlush batches concurrent commits: whichever backend gets
+		 * WALWriteLock flushes everyone's commit records, and the others
+		 * just wait for it to finish.  See also commit_delay there.
 		 */
-		if (CommitDelay > 0 && enableFsync &&
-			MinimumActiveBackends(CommitSiblings))
-			pg_usleep(CommitDelay);
-
 		XLogFlush(XactLastRecEnd);
 
 		/*
@@ -2250,6 +2238,11 @@ AbortTransaction(void)
 	 */
 	LWLockReleaseAll();
 
+	/* An error may have interrupted some wait; we're not waiting anymore */
+	pgstat_report_wait_end();
+	/* ... nor running whatever maintenance command we were reporting on */
+	pgstat_progress_end_command();
+
 	/* Clean up buffer I/O and buffer context locks, too */
 	AbortBufferIO();
 	UnlockBuffers();
@@ -4140,6 +4133,9 @@ AbortSubTransaction(void)
 	 */
 	LWLockReleaseAll();
 
+	pgstat_report_wait_end();
+	pgstat_progress_end_command();
+
 	AbortBufferIO();
 	UnlockBuffers();
 
@@ -4588,17 +4584,24 @@ xact_redo_commit_internal(TransactionId xid, XLogRecPtr lsn,
 	}
 
 	/* Make sure files supposed to be dropped are dropped */
-	for (i = 0; i < nrels; i++)
+	if (nrels > 0)
 	{
-		SMgrRelation srel = smgropen(xnodes[i], InvalidBackendId);
-		ForkNumber	fork;
+		SMgrRelation *srels = palloc(sizeof(SMgrRelation) * nrels);
 
-		for (fork = 0; fork <= MAX_FORKNUM; fork++)
+		for (i = 0; i < nrels; i++)
 		{
-			XLogDropRelation(xnodes[i], fork);
-			smgrdounlink(srel, fork, true);
+			ForkNumber	fork;
+
+			srels[i] = smgropen(xnodes[i], InvalidBackendId);
+			for (fork = 0; fork <= MAX_FORKNUM; fork++)
+				XLogDropRelation(xnodes[i], fork);
 		}
-		smgrclose(srel);
+
+		smgrdounlinkall(srels, nrels, true);
+
+		for (i = 0; i < nrels; i++)
+			smgrclose(srels[i]);
+		pfree(srels);
 	}
 
 	/*
@@ -4728,17 +4731,24 @@ xact_redo_abort(xl_xact_abort *xlrec, TransactionId xid)
 	}
 
 	/* Make sure files supposed to be dropped are dropped */
-	for (i = 0; i < xlrec->nrels; i++)
+	if (xlrec->nrels > 0)
 	{
-		SMgrRelation srel = smgropen(xlrec->xnodes[i], InvalidBackendId);
-		ForkNumber	fork;
+		SMgrRelation *srels = palloc(sizeof(SMgrRelation) * xlrec->nrels);
 
-		for (fork = 0; fork <= MAX_FORKNUM; fork++)
+		for (i = 0; i < xlrec->nrels; i++)
 		{
-			XLogDropRelation(xlrec->xnodes[i], fork);
-			smgrdounlink(srel, fork, true);
+			ForkNumber	fork;
+
+			srels[i] = smgropen(xlrec->xnodes[i], InvalidBackendId);
+			for (fork = 0; fork <= MAX_FORKNUM; fork++)
+				XLogDropRelation(xlrec->xnodes[i], fork);
 		}
-		smgrclose(srel);
+
+		smgrdounlinkall(srels, xlrec->nrels, true);
+
+		for (i = 0; i < xlrec->nrels; i++)
+			smgrclose(srels[i]);
+		pfree(srels);
 	}
 }
 
@@ -42,6 +42,7 @@
 #include "postmaster/startup.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/barrier.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
@@ -55,6 +56,7 @@
 #include "storage/spin.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/pg_lzcompress.h"
 #include "utils/ps_status.h"
 #include "utils/relmapper.h"
 #include "utils/snapmgr.h"
@@ -77,9 +79,12 @@ bool		XLogArchiveMode = false;
 char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
+bool		wal_compression = false;
 bool		log_checkpoints = false;
 int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
+int			CommitDelay = 0;	/* precommit delay in microseconds */
+int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
 
 #ifdef WAL_DEBUG
 bool		XLOG_DEBUG = false;
@@ -105,6 +110,7 @@ const struct config_enum_entry wal_level_options[] = {
 	{"minimal", WAL_LEVEL_MINIMAL, false},
 	{"archive", WAL_LEVEL_ARCHIVE, false},
 	{"hot_standby", WAL_LEVEL_HOT_STANDBY, false},
+	{"logical", WAL_LEVEL_LOGICAL, false},
 	{NULL, 0, false}
 };
 
@@ -272,6 +278,18 @@ static XLogRecPtr RedoRecPtr;
  */
 static XLogRecPtr RedoStartLSN = {0, 0};
 
+/*
+ * Work space for compressing backup blocks in XLogInsert.  This has to be
+ * static, since XLogInsert is commonly called inside a critical section
+ * where we mustn't palloc.
+ */
+static char bkpPageImage[BLCKSZ];
+static union
+{
+	PGLZ_Header hdr;
+	char		data[PGLZ_MAX_OUTPUT(BLCKSZ)];
+}			bkpCompressed[XLR_MAX_BKP_BLOCKS];
+
 /*----------
  * Shared-memory data structures for XLOG control
  *
@@ -282,11 +300,10 @@ static XLogRecPtr RedoStartLSN = {0, 0};
  * slightly different functions.
  *
  * We do a lot of pushups to minimize the amount of access to lockable
- * shared memory values.  There are actually three shared-memory copies of
+ * shared memory values.  There are actually two shared-memory copies of
  * LogwrtResult, plus one unshared copy in each backend.  Here's how it works:
  *		XLogCtl->LogwrtResult is protected by info_lck
  *		XLogCtl->Write.LogwrtResult is protected by WALWriteLock
- *		XLogCtl->Insert.LogwrtResult is protected by WALInsertLock
  * One must hold the associated lock to read or write any of these, but
  * of course no lock is needed to read/write the unshared LogwrtResult.
  *
@@ -296,11 +313,7 @@ static XLogRecPtr RedoStartLSN = {0, 0};
  * is that it can be examined/modified by code that already holds WALWriteLock
  * without needing to grab info_lck as well.
  *
- * XLogCtl->Insert.LogwrtResult may lag behind the reality of the other two,
- * but is updated when convenient.	Again, it exists for the convenience of
- * code that is already holding WALInsertLock but not the other locks.
- *
- * The unshared LogwrtResult may lag behind any or all of these, and again
+ * The unshared LogwrtResult may lag behind either or both of these, and again
  * is updated when convenient.
  *
  * The request bookkeeping is simpler: there is a shared XLogCtl->LogwrtRqst
@@ -311,10 +324,25 @@ static XLogRecPtr RedoStartLSN = {0, 0};
  * values is "more up to date".
  *
  * info_lck is only held long enough to read/update the protected variables,
- * so it's a plain spinlock.  The other locks are held longer (potentially
- * over I/O operations), so we use LWLocks for them.  These locks are:
- *
- * WALInsertLock: must be held to insert a record into the WAL buffers.
+ * so it's a plain spinlock.  Likewise insertpos_lck, which protects the
+ * current WAL insert position.  The other locks are held longer
+ * (potentially over I/O operations), so we use LWLocks for them.  These
+ * locks are:
+ *
+ * WAL insertion locks (FirstWALInsertLock ... +NUM_XLOGINSERT_LOCKS-1): one
+ * of these must be held while copying a record into the WAL buffers.  Space
+ * for the record is reserved first, under insertpos_lck, by simple
+ * arithmetic on the insert position; the copying itself then proceeds in
+ * parallel with other backends holding the other insertion locks.  Each
+ * insertion lock carries the position up to which its holder has finished
+ * copying (see XLogCtlInsertSlot), so that XLogWrite can wait for just the
+ * insertions into the range it's about to write.  Holding all of them
+ * blocks out new insertions altogether, and is how RedoRecPtr,
+ * forcePageWrites and the backup counters are protected.
+ *
+ * WALBufMappingLock: must be held to replace a page in the WAL buffer cache.
+ * This is only needed when an inserter crosses into a page that hasn't been
+ * initialized yet.
  *
  * WALWriteLock: must be held to write WAL buffers to disk (XLogWrite or
  * XLogFlush).
@@ -341,16 +369,44 @@ typedef struct XLogwrtResult
 	XLogRecPtr	Flush;			/* last byte + 1 flushed */
 } XLogwrtResult;
 
+/*
+ * Progress of an in-progress insertion, one per WAL insertion lock.
+ *
+ * insertingAt is the position, as an XLogRecPtr packed into a uint64 with
+ * XLogRecPtrToUInt64, up to which the holder of the insertion lock has
+ * finished copying its record; 0 means the holder hasn't advertised a
+ * position yet.  It is only updated with LWLockAcquireWithVar and
+ * LWLockUpdateVar, and read with LWLockWaitForVar.  Each slot is padded so
+ * that backends advertising their progress don't fight over a cache line.
+ */
+#define XLOG_INSERT_SLOT_PADDED_SIZE	64
+
+typedef union XLogCtlInsertSlot
+{
+	uint64		insertingAt;
+	char		pad[XLOG_INSERT_SLOT_PADDED_SIZE];
+} XLogCtlInsertSlot;
+
 /*
  * Shared state data for XLogInsert.
  */
 typedef struct XLogCtlInsert
 {
-	XLogwrtResult LogwrtResult; /* a recent value of LogwrtResult */
-	XLogRecPtr	PrevRecord;		/* start of previously-inserted record */
-	int			curridx;		/* current block index in cache */
-	XLogPageHeader currpage;	/* points to header of block in cache */
-	char	   *currpos;		/* current insertion point in cache */
+	slock_t		insertpos_lck;	/* protects CurrPos and PrevRecord */
+
+	/*
+	 * CurrPos is the end of reserved WAL.  The next record will be inserted
+	 * at that position, or at the start of the next page if there isn't
+	 * room for a record header on the current one.  PrevRecord is the start
+	 * of the previously reserved record.
+	 */
+	XLogRecPtr	CurrPos;
+	XLogRecPtr	PrevRecord;
+
+	/*
+	 * To change RedoRecPtr or forcePageWrites, you need to hold all the WAL
+	 * insertion locks.  Holding any one of them is enough to read them.
+	 */
 	XLogRecPtr	RedoRecPtr;		/* current redo point for insertions */
 	bool		forcePageWrites;	/* forcing full-page writes for PITR? */
 
@@ -360,6 +416,7 @@ typedef struct XLogCtlInsert
 	 * of streaming base backups currently in progress. forcePageWrites is set
 	 * to true when either of these is non-zero. lastBackupStart is the latest
 	 * checkpoint redo location used as a starting point for an online backup.
+	 * These are protected by holding all the WAL insertion locks.
 	 */
 	bool		exclusiveBackup;
 	int			nonExclusiveBackups;
@@ -381,8 +438,9 @@ typedef struct XLogCtlWrite
  */
 typedef struct XLogCtlData
 {
-	/* Protected by WALInsertLock: */
+	/* Protected by insertpos_lck and the WAL insertion locks: */
 	XLogCtlInsert Insert;
+	XLogCtlInsertSlot insertSlots[NUM_XLOGINSERT_LOCKS];
 
 	/* Protected by info_lck: */
 	XLogwrtRqst LogwrtRqst;
@@ -396,10 +454,23 @@ typedef struct XLogCtlData
 	/* Protected by WALWriteLock: */
 	XLogCtlWrite Write;
 
+	/*
+	 * Latest initialized page in the cache (last byte position + 1).
+	 *
+	 * To change the identity of a buffer (and InitializedUpTo), you need to
+	 * hold WALBufMappingLock.  To change the identity of a buffer that's
+	 * still dirty, the old page needs to be written out first, and for that
+	 * you need WALWriteLock, and you need to ensure that there are no
+	 * in-progress insertions to the page by calling
+	 * WaitXLogInsertionsToFinish().
+	 */
+	XLogRecPtr	InitializedUpTo;
+
 	/*
 	 * These values do not change after startup, although the pointed-to pages
-	 * and xlblocks values certainly do.  Permission to read/write the pages
-	 * and xlblocks values depends on WALInsertLock and WALWriteLock.
+	 * and xlblocks values certainly do.  xlblock values are protected by
+	 * WALBufMappingLock; a page's contents may be written by anyone holding
+	 * a WAL insertion lock whose reserved space lies on the page.
 	 */
 	char	   *pages;			/* buffers for unwritten XLOG pages */
 	XLogRecPtr *xlblocks;		/* 1st byte ptr-s + XLOG_BLCKSZ */
@@ -471,29 +542,49 @@ static XLogCtlData *XLogCtl = NULL;
 static ControlFileData *ControlFile = NULL;
 
 /*
- * Macros for managing XLogInsert state.  In most cases, the calling routine
- * has local copies of XLogCtl->Insert and/or XLogCtl->Insert->curridx,
- * so these are passed as parameters instead of being fetched via XLogCtl.
+ * Macros for managing XLogInsert state.
  */
 
-/* Free space remaining in the current xlog page buffer */
-#define INSERT_FREESPACE(Insert)  \
-	(XLOG_BLCKSZ - ((Insert)->currpos - (char *) (Insert)->currpage))
-
-/* Construct XLogRecPtr value for current insertion point */
-#define INSERT_RECPTR(recptr,Insert,curridx)  \
-	( \
-	  (recptr).xlogid = XLogCtl->xlblocks[curridx].xlogid, \
-	  (recptr).xrecoff = \
-		XLogCtl->xlblocks[curridx].xrecoff - INSERT_FREESPACE(Insert) \
-	)
+/* Free space remaining in the xlog page that 'endptr' points into */
+#define INSERT_FREESPACE(endptr)	\
+	(((endptr).xrecoff % XLOG_BLCKSZ == 0) ? 0 : \
+	 (XLOG_BLCKSZ - (endptr).xrecoff % XLOG_BLCKSZ))
 
-#define PrevBufIdx(idx)		\
-		(((idx) == 0) ? XLogCtl->XLogCacheBlck : ((idx) - 1))
+/* Size of the header of the xlog page beginning at 'pageoff' */
+#define XLogPageHeaderSizeAt(pageoff)	\
+	(((pageoff) % XLogSegSize == 0) ? SizeOfXLogLongPHD : SizeOfXLogShortPHD)
 
 #define NextBufIdx(idx)		\
 		(((idx) == XLogCtl->XLogCacheBlck) ? 0 : ((idx) + 1))
 
+/*
+ * XLogRecPtrToBufIdx returns the index of the WAL buffer that holds, or
+ * would hold if it was in cache, the page containing 'recptr'.  Consecutive
+ * pages map to consecutive buffers, so the buffer a page must go into can
+ * be computed from its address alone.
+ */
+#define XLogRecPtrToBufIdx(recptr)	\
+	((int) ((((uint64) (recptr).xlogid * (XLogFileSize / XLOG_BLCKSZ)) + \
+			 (recptr).xrecoff / XLOG_BLCKSZ) % \
+			(uint64) (XLogCtl->XLogCacheBlck + 1)))
+
+/*
+ * Conversions between XLogRecPtr and the uint64 representation used for
+ * the insertion lock variables.  The packing preserves XLogRecPtr ordering.
+ */
+#define XLogRecPtrToUInt64(recptr) \
+	(((uint64) (recptr).xlogid << 32) | (uint64) (recptr).xrecoff)
+#define UInt64ToXLogRecPtr(val, recptr) \
+	((recptr).xlogid = (uint32) ((val) >> 32), \
+	 (recptr).xrecoff = (uint32) (val))
+
+/*
+ * The WAL insertion lock that this backend uses for its insertions, and
+ * whether we're currently holding all of them.  See WALInsertLockAcquire.
+ */
+static int	MyLockNo = 0;
+static bool holdingAllLocks = false;
+
 /*
  * Private, possibly out-of-date copy of shared LogwrtResult.
  * See discussion above.
@@ -618,9 +709,11 @@ static void KeepLogSeg(XLogRecPtr recptr, uint32 *logId, uint32 *logSeg);
 
 static bool XLogCheckBuffer(XLogRecData *rdata, bool doPageWrites,
 				XLogRecPtr *lsn, BkpBlock *bkpb);
-static bool AdvanceXLInsertBuffer(bool new_segment);
+static void XLogCompressBkpBlock(BkpBlock *bkpb, char *page,
+					 PGLZ_Header *dest);
+static void AdvanceXLInsertBuffer(XLogRecPtr upto);
 static bool XLogCheckpointNeeded(uint32 logid, uint32 logseg);
-static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible, bool xlog_switch);
+static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible);
 static bool InstallXLogFileSegment(uint32 *log, uint32 *seg, char *tmppath,
 					   bool find_free, int *max_advance,
 					   bool use_lock);
@@ -665,8 +758,24 @@ static void pg_start_backup_callback(int code, Datum arg);
 static bool read_backup_label(XLogRecPtr *checkPointLoc,
 				  bool *backupEndRequired);
 static void rm_redo_error_callback(void *arg);
+static int	get_direct_bit(void);
 static int	get_sync_bit(int method);
 
+static XLogRecPtr XLogRecordStartPos(XLogRecPtr pos);
+static void ReserveXLogInsertLocation(uint32 size, XLogRecPtr *StartPos,
+						  XLogRecPtr *EndPos, XLogRecPtr *PrevPtr);
+static bool ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
+				  XLogRecPtr *PrevPtr);
+static void CopyXLogRecordToWAL(XLogRecord *rechdr, XLogRecData *rdata,
+					uint32 write_len, bool isLogSwitch,
+					XLogRecPtr StartPos, XLogRecPtr EndPos);
+static char *GetXLogBuffer(XLogRecPtr ptr);
+static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
+static void WALInsertLockAcquire(void);
+static void WALInsertLockAcquireExclusive(void);
+static void WALInsertLockRelease(void);
+static void WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt);
+
 
 /*
  * Insert an XLOG record having the specified RMID and info bytes,
@@ -687,12 +796,15 @@ XLogRecPtr
 XLogInsert(RmgrId rmid, uint8 info, XLogRecData *rdata)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
-	XLogRecord *record;
-	XLogContRecord *contrecord;
-	XLogRecPtr	RecPtr;
-	XLogRecPtr	WriteRqst;
-	uint32		freespace;
-	int			curridx;
+	union
+	{
+		XLogRecord	rec;
+		char		data[SizeOfXLogRecord];
+	}			rechdrbuf;
+	XLogRecord *rechdr;
+	XLogRecPtr	StartPos;
+	XLogRecPtr	EndPos;
+	bool		inserted;
 	XLogRecData *rdt;
 	Buffer		dtbuf[XLR_MAX_BKP_BLOCKS];
 	bool		dtbuf_bkp[XLR_MAX_BKP_BLOCKS];
@@ -705,7 +817,6 @@ XLogInsert(RmgrId rmid, uint8 info, XLogRecData *rdata)
 	uint32		len,
 				write_len;
 	unsigned	i;
-	bool		updrqst;
 	bool		doPageWrites;
 	bool		isLogSwitch = (rmid == RM_XLOG_ID && info == XLOG_SWITCH);
 
@@ -725,9 +836,9 @@ XLogInsert(RmgrId rmid, uint8 info, XLogRecData *rdata)
 	 */
 	if (IsBootstrapProcessingMode() && rmid != RM_XLOG_ID)
 	{
-		RecPtr.xlogid = 0;
-		RecPtr.xrecoff = SizeOfXLogLongPHD;		/* start of 1st chkpt record */
-		return RecPtr;
+		EndPos.xlogid = 0;
+		EndPos.xrecoff = SizeOfXLogLongPHD;		/* start of 1st chkpt record */
+		return EndPos;
 	}
 
 	/*
@@ -764,7 +875,7 @@ begin:;
 	 */
 	doPageWrites = fullPageWrites || Insert->forcePageWrites;
 
-	INIT_CRC32(rdata_crc);
+	INIT_CRC32C(rdata_crc);
 	len = 0;
 	for (rdt = rdata;;)
 	{
@@ -772,7 +883,7 @@ begin:;
 		{
 			/* Simple data, just include it */
 			len += rdt->len;
-			COMP_CRC32(rdata_crc, rdt->data, rdt->len);
+			COMP_CRC32C(rdata_crc, rdt->data, rdt->len);
 		}
 		else
 		{
@@ -787,7 +898,7 @@ begin:;
 					else if (rdt->data)
 					{
 						len += rdt->len;
-						COMP_CRC32(rdata_crc, rdt->data, rdt->len);
+						COMP_CRC32C(rdata_crc, rdt->data, rdt->len);
 					}
 					break;
 				}
@@ -804,7 +915,7 @@ begin:;
 					else if (rdt->data)
 					{
 						len += rdt->len;
-						COMP_CRC32(rdata_crc, rdt->data, rdt->len);
+						COMP_CRC32C(rdata_crc, rdt->data, rdt->len);
 					}
 					break;
 				}
@@ -820,7 +931,8 @@ begin:;
 	}
 
 	/*
-	 * Now add the backup block headers and data into the CRC
+	 * Now add the backup block headers and data into the CRC, compressing
+	 * the block images first if requested.
 	 */
 	for (i = 0; i < XLR_MAX_BKP_BLOCKS; i++)
 	{
@@ -829,23 +941,31 @@ begin:;
 			BkpBlock   *bkpb = &(dtbuf_xlg[i]);
 			char	   *page;
 
-			COMP_CRC32(rdata_crc,
+			page = (char *) BufferGetBlock(dtbuf[i]);
+			if (wal_compression)
+				XLogCompressBkpBlock(bkpb, page, &bkpCompressed[i].hdr);
+			COMP_CRC32C(rdata_crc,
 					   (char *) bkpb,
 					   sizeof(BkpBlock));
-			page = (char *) BufferGetBlock(dtbuf[i]);
-			if (bkpb->hole_length == 0)
+			if (bkpb->compressed_length > 0)
 			{
-				COMP_CRC32(rdata_crc,
+				COMP_CRC32C(rdata_crc,
+						   bkpCompressed[i].data,
+						   bkpb->compressed_length);
+			}
+			else if (bkpb->hole_length == 0)
+			{
+				COMP_CRC32C(rdata_crc,
 						   page,
 						   BLCKSZ);
 			}
 			else
 			{
 				/* must skip the hole */
-				COMP_CRC32(rdata_crc,
+				COMP_CRC32C(rdata_crc,
 						   page,
 						   bkpb->hole_offset);
-				COMP_CRC32(rdata_crc,
+				COMP_CRC32C(rdata_crc,
 						   page + (bkpb->hole_offset + bkpb->hole_length),
 						   BLCKSZ - (bkpb->hole_offset + bkpb->hole_length));
 			}
@@ -864,8 +984,42 @@ begin:;
 
 	START_CRIT_SECTION();
 
-	/* Now wait to get insert lock */
-	LWLockAcquire(WALInsertLock, LW_EXCLUSIVE);
+	/*----------
+	 *
+	 * We have now done all the preparatory work we can without holding a
+	 * lock or modifying shared state.  From here on, inserting the new WAL
+	 * record into the shared WAL buffer cache is a two-step process:
+	 *
+	 * 1. Reserve the right amount of space from the WAL.  The current head
+	 *	  of reserved space is kept in Insert->CurrPos, and is protected by
+	 *	  insertpos_lck.  Reserving is plain arithmetic on the insert
+	 *	  position, so the spinlock is held only very briefly.
+	 *
+	 * 2. Copy the record to the reserved WAL space.  This involves finding
+	 *	  the correct WAL buffer containing the reserved space, and copying
+	 *	  the record in place.  This can be done concurrently in multiple
+	 *	  processes.
+	 *
+	 * To keep track of which insertions are still in-progress, each
+	 * concurrent inserter holds a WAL insertion lock.  In addition to just
+	 * indicating that an insertion is in progress, the lock tells others how
+	 * far the inserter has progressed.  When an inserter crosses into a page
+	 * that hasn't been initialized yet, it advertises how far it has got
+	 * before initializing the page, so that the older buffer that the page
+	 * replaces can be flushed.
+	 *
+	 * Holding an insertion lock also protects RedoRecPtr and forcePageWrites
+	 * from changing until the insertion is finished.
+	 *
+	 * An XLOG_SWITCH record takes all the insertion locks, to keep other
+	 * insertions out while it fills the rest of the segment.
+	 *
+	 *----------
+	 */
+	if (isLogSwitch)
+		WALInsertLockAcquireExclusive();
+	else
+		WALInsertLockAcquire();
 
 	/*
 	 * Check to see if my RedoRecPtr is out of date.  If so, may have to go
@@ -894,7 +1048,7 @@ begin:;
 					 * Oops, this buffer now needs to be backed up, but we
 					 * didn't think so above.  Start over.
 					 */
-					LWLockRelease(WALInsertLock);
+					WALInsertLockRelease();
 					END_CRIT_SECTION();
 					goto begin;
 				}
@@ -911,7 +1065,7 @@ begin:;
 	if (Insert->forcePageWrites && !doPageWrites)
 	{
 		/* Oops, must redo it with full-page data */
-		LWLockRelease(WALInsertLock);
+		WALInsertLockRelease();
 		END_CRIT_SECTION();
 		goto begin;
 	}
@@ -950,7 +1104,14 @@ begin:;
 		rdt->next = &(dtbuf_rdt2[i]);
 		rdt = rdt->next;
 
-		if (bkpb->hole_length == 0)
+		if (bkpb->compressed_length > 0)
+		{
+			rdt->data = bkpCompressed[i].data;
+			rdt->len = bkpb->compressed_length;
+			write_len += bkpb->compressed_length;
+			rdt->next = NULL;
+		}
+		else if (bkpb->hole_length == 0)
 		{
 			rdt->data = page;
 			rdt->len = BLCKSZ;
@@ -975,74 +1136,103 @@ begin:;
 	}
 
 	/*
-	 * If there isn't enough space on the current XLOG page for a record
-	 * header, advance to the next page (leaving the unused space as zeroes).
+	 * Construct the record header.  It's built in a zeroed, MAXALIGN'd
+	 * buffer, so that the alignment padding covered by the CRC is zeroes,
+	 * as it is in the WAL buffers.
 	 */
-	updrqst = false;
-	freespace = INSERT_FREESPACE(Insert);
-	if (freespace < SizeOfXLogRecord)
-	{
-		updrqst = AdvanceXLInsertBuffer(false);
-		freespace = INSERT_FREESPACE(Insert);
-	}
-
-	/* Compute record's XLOG location */
-	curridx = Insert->curridx;
-	INSERT_RECPTR(RecPtr, Insert, curridx);
+	MemSet(&rechdrbuf, 0, sizeof(rechdrbuf));
+	rechdr = &rechdrbuf.rec;
+	rechdr->xl_xid = GetCurrentTransactionIdIfAny();
+	rechdr->xl_tot_len = SizeOfXLogRecord + write_len;
+	rechdr->xl_len = len;		/* doesn't include backup blocks */
+	rechdr->xl_info = info;
+	rechdr->xl_rmid = rmid;
 
 	/*
-	 * If the record is an XLOG_SWITCH, and we are exactly at the start of a
-	 * segment, we need not insert it (and don't want to because we'd like
-	 * consecutive switch requests to be no-ops).  Instead, make sure
-	 * everything is written and flushed through the end of the prior segment,
-	 * and return the prior segment's end address.
+	 * Reserve space for the record in the WAL.  This also sets the xl_prev
+	 * pointer.
 	 */
-	if (isLogSwitch &&
-		(RecPtr.xrecoff % XLogSegSize) == SizeOfXLogLongPHD)
+	if (isLogSwitch)
+		inserted = ReserveXLogSwitch(&StartPos, &EndPos, &rechdr->xl_prev);
+	else
 	{
-		/* We can release insert lock immediately */
-		LWLockRelease(WALInsertLock);
+		ReserveXLogInsertLocation(SizeOfXLogRecord + write_len,
+								  &StartPos, &EndPos, &rechdr->xl_prev);
+		inserted = true;
+	}
 
-		RecPtr.xrecoff -= SizeOfXLogLongPHD;
-		if (RecPtr.xrecoff == 0)
-		{
-			/* crossing a logid boundary */
-			RecPtr.xlogid -= 1;
-			RecPtr.xrecoff = XLogFileSize;
-		}
+	if (inserted)
+	{
+		/* Now we can finish computing the record's CRC */
+		COMP_CRC32C(rdata_crc, (char *) rechdr + sizeof(pg_crc32),
+				   SizeOfXLogRecord - sizeof(pg_crc32));
+		FIN_CRC32C(rdata_crc);
+		rechdr->xl_crc = rdata_crc;
 
-		LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
-		LogwrtResult = XLogCtl->Write.LogwrtResult;
-		if (!XLByteLE(RecPtr, LogwrtResult.Flush))
-		{
-			XLogwrtRqst FlushRqst;
+		/*
+		 * All the record data, including the header, is now ready to be
+		 * inserted.  Copy the record in the space reserved.
+		 */
+		CopyXLogRecordToWAL(rechdr, rdata, write_len, isLogSwitch,
+							StartPos, EndPos);
+	}
+	else
+	{
+		/*
+		 * This was an xlog-switch record, but the current insert location
+		 * was already exactly at the beginning of a segment, so there was no
+		 * need to do anything.
+		 */
+	}
 
-			FlushRqst.Write = RecPtr;
-			FlushRqst.Flush = RecPtr;
-			XLogWrite(FlushRqst, false, false);
-		}
-		LWLockRelease(WALWriteLock);
+	/*
+	 * Done!  Let others know that we're finished.
+	 */
+	WALInsertLockRelease();
 
-		END_CRIT_SECTION();
+	END_CRIT_SECTION();
 
-		return RecPtr;
-	}
+	/*
+	 * Update shared LogwrtRqst.Write, if we crossed a page boundary, so that
+	 * the walwriter knows there's a completed page to write.
+	 */
+	if (inserted && !isLogSwitch &&
+		(StartPos.xlogid != EndPos.xlogid ||
+		 StartPos.xrecoff / XLOG_BLCKSZ != EndPos.xrecoff / XLOG_BLCKSZ))
+	{
+		/* use volatile pointer to prevent code rearrangement */
+		volatile XLogCtlData *xlogctl = XLogCtl;
 
-	/* Insert record header */
+		SpinLockAcquire(&xlogctl->info_lck);
+		/* advance global request to include new block(s) */
+		if (XLByteLT(xlogctl->LogwrtRqst.Write, EndPos))
+			xlogctl->LogwrtRqst.Write = EndPos;
+		/* update local result copy while I have the chance */
+		LogwrtResult = xlogctl->LogwrtResult;
+		SpinLockRelease(&xlogctl->info_lck);
+	}
 
-	record = (XLogRecord *) Insert->currpos;
-	record->xl_prev = Insert->PrevRecord;
-	record->xl_xid = GetCurrentTransactionIdIfAny();
-	record->xl_tot_len = SizeOfXLogRecord + write_len;
-	record->xl_len = len;		/* doesn't include backup blocks */
-	record->xl_info = info;
-	record->xl_rmid = rmid;
+	/*
+	 * If this was an XLOG_SWITCH record, flush the record and the empty
+	 * padding space that fills the rest of the segment, and perform
+	 * end-of-segment actions (eg, notifying archiver).
+	 */
+	if (isLogSwitch)
+	{
+		TRACE_POSTGRESQL_XLOG_SWITCH();
+		XLogFlush(EndPos);
 
-	/* Now we can finish computing the record's CRC */
-	COMP_CRC32(rdata_crc, (char *) record + sizeof(pg_crc32),
-			   SizeOfXLogRecord - sizeof(pg_crc32));
-	FIN_CRC32(rdata_crc);
-	record->xl_crc = rdata_crc;
+		/*
+		 * Even though we reserved the rest of the segment for us, which is
+		 * reflected in EndPos, we return a pointer to just the end of the
+		 * xlog-switch record.  (The record header never crosses a page.)
+		 */
+		if (inserted)
+		{
+			EndPos = StartPos;
+			EndPos.xrecoff += SizeOfXLogRecord;
+		}
+	}
 
 #ifdef WAL_DEBUG
 	if (XLOG_DEBUG)
@@ -1051,23 +1241,202 @@ begin:;
 
 		initStringInfo(&buf);
 		appendStringInfo(&buf, "INSERT @ %X/%X: ",
-						 RecPtr.xlogid, RecPtr.xrecoff);
-		xlog_outrec(&buf, record);
+						 EndPos.xlogid, EndPos.xrecoff);
+		xlog_outrec(&buf, rechdr);
 		if (rdata->data != NULL)
 		{
 			appendStringInfo(&buf, " - ");
-			RmgrTable[record->xl_rmid].rm_desc(&buf, record->xl_info, rdata->data);
+			RmgrTable[rechdr->xl_rmid].rm_desc(&buf, rechdr->xl_info, rdata->data);
 		}
 		elog(LOG, "%s", buf.data);
 		pfree(buf.data);
 	}
 #endif
 
-	/* Record begin of record in appropriate places */
-	ProcLastRecPtr = RecPtr;
-	Insert->PrevRecord = RecPtr;
+	/*
+	 * Update our global variables
+	 */
+	ProcLastRecPtr = StartPos;
+	XactLastRecEnd = EndPos;
+
+	return EndPos;
+}
+
+/*
+ * Compute the position where a record would begin, if inserted at CurrPos
+ * 'pos': skip over the page header if 'pos' is at a page boundary, and move
+ * to the next page if there isn't room for a record header on this one.
+ */
+static XLogRecPtr
+XLogRecordStartPos(XLogRecPtr pos)
+{
+	if (INSERT_FREESPACE(pos) < SizeOfXLogRecord)
+	{
+		NextLogPage(pos);
+		pos.xrecoff += XLogPageHeaderSizeAt(pos.xrecoff);
+	}
+	return pos;
+}
+
+/*
+ * Reserves the right amount of space for a record of given size from the WAL.
+ * *StartPos is set to the beginning of the reserved section, *EndPos to
+ * its end+1, and *PrevPtr to the beginning of the previous record, to set
+ * as the xl_prev of this record.
+ *
+ * This is the performance critical part of XLogInsert that must be
+ * serialized across backends.  The rest can happen mostly in parallel.
+ * Try to keep this section as short as possible, insertpos_lck can be
+ * heavily contended on a busy system.  We only do arithmetic on the insert
+ * position here: the page and continuation record headers that the record
+ * will cross are accounted for, but not written; that's left to
+ * CopyXLogRecordToWAL.
+ */
+static void
+ReserveXLogInsertLocation(uint32 size, XLogRecPtr *StartPos,
+						  XLogRecPtr *EndPos, XLogRecPtr *PrevPtr)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogCtlInsert *Insert = &XLogCtl->Insert;
+	XLogRecPtr	startpos;
+	XLogRecPtr	endpos;
+	uint32		freespace;
+	uint32		left;
+
+	SpinLockAcquire(&Insert->insertpos_lck);
+
+	startpos = XLogRecordStartPos(Insert->CurrPos);
+
+	/*
+	 * Walk over the pages the record will span.  The record header is never
+	 * split, and each continuation page begins with a page header and an
+	 * XLogContRecord.  Records spanning more than a couple of pages are
+	 * rare, so this loop is short in practice.
+	 */
+	endpos = startpos;
+	freespace = INSERT_FREESPACE(endpos);
+	left = size;
+	while (left > freespace)
+	{
+		left -= freespace;
+		endpos.xrecoff += freespace;
+		NextLogPage(endpos);
+		endpos.xrecoff += XLogPageHeaderSizeAt(endpos.xrecoff) +
+			SizeOfXLogContRecord;
+		freespace = INSERT_FREESPACE(endpos);
+	}
+	endpos.xrecoff += left;
+
+	/* Ensure next record will be properly aligned */
+	endpos.xrecoff += MAXALIGN(endpos.xrecoff % XLOG_BLCKSZ) -
+		endpos.xrecoff % XLOG_BLCKSZ;
+
+	Insert->CurrPos = endpos;
+	*PrevPtr = Insert->PrevRecord;
+	Insert->PrevRecord = startpos;
+
+	SpinLockRelease(&Insert->insertpos_lck);
+
+	*StartPos = startpos;
+	*EndPos = endpos;
+}
+
+/*
+ * Like ReserveXLogInsertLocation(), but for an xlog-switch record.
+ *
+ * A log-switch record is handled slightly differently.  The rest of the
+ * segment will be reserved for this insertion, as indicated by the returned
+ * *EndPos value.  However, if we are already at the beginning of the current
+ * segment, *StartPos and *EndPos are set to the current location without
+ * reserving any space, and the function returns false.
+ */
+static bool
+ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
+				  XLogRecPtr *PrevPtr)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogCtlInsert *Insert = &XLogCtl->Insert;
+	XLogRecPtr	startpos;
+	XLogRecPtr	endpos;
+
+	/*
+	 * These calculations are a bit heavy-weight to be done while holding a
+	 * spinlock, but since we're holding all the WAL insertion locks, there
+	 * are no other inserters competing for it.  GetXLogInsertRecPtr() does
+	 * compete for it, but that's not called very frequently.
+	 */
+	SpinLockAcquire(&Insert->insertpos_lck);
+
+	startpos = XLogRecordStartPos(Insert->CurrPos);
+
+	/*
+	 * If we are exactly at the start of a segment, we need not insert the
+	 * record (and don't want to because we'd like consecutive switch
+	 * requests to be no-ops).  Return the prior segment's end address.
+	 */
+	if (startpos.xrecoff % XLogSegSize == SizeOfXLogLongPHD)
+	{
+		SpinLockRelease(&Insert->insertpos_lck);
+
+		endpos = startpos;
+		endpos.xrecoff -= SizeOfXLogLongPHD;
+		if (endpos.xrecoff == 0)
+		{
+			/* crossing a logid boundary */
+			endpos.xlogid -= 1;
+			endpos.xrecoff = XLogFileSize;
+		}
+		*StartPos = *EndPos = endpos;
+		return false;
+	}
+
+	/* The rest of the segment is reserved for the switch record */
+	endpos = startpos;
+	endpos.xrecoff += XLogSegSize - 1;
+	endpos.xrecoff -= endpos.xrecoff % XLogSegSize;
+
+	Insert->CurrPos = endpos;
+	*PrevPtr = Insert->PrevRecord;
+	Insert->PrevRecord = startpos;
+
+	SpinLockRelease(&Insert->insertpos_lck);
+
+	*StartPos = startpos;
+	*EndPos = endpos;
+
+	Assert(INSERT_FREESPACE(startpos) >= SizeOfXLogRecord);
+	Assert(endpos.xrecoff % XLogSegSize == 0);
+
+	return true;
+}
+
+/*
+ * Subroutine of XLogInsert.  Copies a WAL record to an already-reserved
+ * area in the WAL.
+ */
+static void
+CopyXLogRecordToWAL(XLogRecord *rechdr, XLogRecData *rdata, uint32 write_len,
+					bool isLogSwitch, XLogRecPtr StartPos, XLogRecPtr EndPos)
+{
+	char	   *currpos;
+	uint32		freespace;
+	XLogRecPtr	CurrPos;
+	XLogPageHeader pagehdr;
+	XLogContRecord *contrecord;
+
+	/*
+	 * Get a pointer to the right place in the right WAL buffer to start
+	 * inserting to, and insert the record header, which always fits on the
+	 * first page.
+	 */
+	CurrPos = StartPos;
+	currpos = GetXLogBuffer(CurrPos);
+	freespace = INSERT_FREESPACE(CurrPos);
+	Assert(freespace >= SizeOfXLogRecord);
 
-	Insert->currpos += SizeOfXLogRecord;
+	memcpy(currpos, rechdr, SizeOfXLogRecord);
+	currpos += SizeOfXLogRecord;
+	CurrPos.xrecoff += SizeOfXLogRecord;
 	freespace -= SizeOfXLogRecord;
 
 	/*
@@ -1082,154 +1451,365 @@ begin:;
 		{
 			if (rdata->len > freespace)
 			{
-				memcpy(Insert->currpos, rdata->data, freespace);
+				memcpy(currpos, rdata->data, freespace);
 				rdata->data += freespace;
 				rdata->len -= freespace;
 				write_len -= freespace;
+				CurrPos.xrecoff += freespace;
 			}
 			else
 			{
-				memcpy(Insert->currpos, rdata->data, rdata->len);
+				memcpy(currpos, rdata->data, rdata->len);
 				freespace -= rdata->len;
 				write_len -= rdata->len;
-				Insert->currpos += rdata->len;
+				currpos += rdata->len;
+				CurrPos.xrecoff += rdata->len;
 				rdata = rdata->next;
 				continue;
 			}
 		}
 
-		/* Use next buffer */
-		updrqst = AdvanceXLInsertBuffer(false);
-		curridx = Insert->curridx;
-		/* Insert cont-record header */
-		Insert->currpage->xlp_info |= XLP_FIRST_IS_CONTRECORD;
-		contrecord = (XLogContRecord *) Insert->currpos;
+		/*
+		 * Use next page.  Get pointer to it and insert the continuation
+		 * record header after the page header.
+		 */
+		NextLogPage(CurrPos);
+		currpos = GetXLogBuffer(CurrPos);
+		pagehdr = (XLogPageHeader) currpos;
+		pagehdr->xlp_info |= XLP_FIRST_IS_CONTRECORD;
+
+		currpos += XLogPageHeaderSize(pagehdr);
+		CurrPos.xrecoff += XLogPageHeaderSize(pagehdr);
+
+		contrecord = (XLogContRecord *) currpos;
 		contrecord->xl_rem_len = write_len;
-		Insert->currpos += SizeOfXLogContRecord;
-		freespace = INSERT_FREESPACE(Insert);
+		currpos += SizeOfXLogContRecord;
+		CurrPos.xrecoff += SizeOfXLogContRecord;
+
+		freespace = INSERT_FREESPACE(CurrPos);
 	}
 
 	/* Ensure next record will be properly aligned */
-	Insert->currpos = (char *) Insert->currpage +
-		MAXALIGN(Insert->currpos - (char *) Insert->currpage);
-	freespace = INSERT_FREESPACE(Insert);
+	CurrPos.xrecoff += MAXALIGN(CurrPos.xrecoff % XLOG_BLCKSZ) -
+		CurrPos.xrecoff % XLOG_BLCKSZ;
 
 	/*
-	 * The recptr I return is the beginning of the *next* record. This will be
-	 * stored as LSN for changed data pages...
+	 * If this was an xlog-switch, it's not enough to write the switch record,
+	 * we also have to consume all the remaining space in the WAL segment.  We
+	 * have already reserved it for us, but we still need to make sure it's
+	 * allocated and zeroed in the WAL buffers so that when the caller (or
+	 * someone else) does XLogWrite(), it can really write out all the zeros.
 	 */
-	INSERT_RECPTR(RecPtr, Insert, curridx);
+	if (isLogSwitch && CurrPos.xrecoff % XLogSegSize != 0)
+	{
+		/* The remainder of the current page is already zeroes */
+		CurrPos.xrecoff += INSERT_FREESPACE(CurrPos);
+		Assert(CurrPos.xlogid == EndPos.xlogid);
+		while (XLByteLT(CurrPos, EndPos))
+		{
+			/* initialize the next page (if not initialized already) */
+			(void) GetXLogBuffer(CurrPos);
+			CurrPos.xrecoff += XLOG_BLCKSZ;
+		}
+	}
+
+	if (!XLByteEQ(CurrPos, EndPos))
+		elog(PANIC, "space reserved for WAL record does not match what was written");
+}
+
+/*
+ * Acquire a WAL insertion lock, for inserting to WAL.
+ */
+static void
+WALInsertLockAcquire(void)
+{
+	bool		immed;
 
 	/*
-	 * If the record is an XLOG_SWITCH, we must now write and flush all the
-	 * existing data, and then forcibly advance to the start of the next
-	 * segment.  It's not good to do this I/O while holding the insert lock,
-	 * but there seems too much risk of confusion if we try to release the
-	 * lock sooner.  Fortunately xlog switch needn't be a high-performance
-	 * operation anyway...
+	 * It doesn't matter which of the WAL insertion locks we acquire, so try
+	 * the one we used last time.  If the system isn't particularly busy,
+	 * it's a good bet that it's still available, and it's good to have some
+	 * affinity to a particular lock so that you don't unnecessarily bounce
+	 * cache lines between processes when there's no contention.
+	 *
+	 * If this is the first time through in this backend, pick a lock
+	 * (semi-)randomly.  This allows the locks to be used evenly if you have
+	 * a lot of very short connections.
 	 */
-	if (isLogSwitch)
-	{
-		XLogCtlWrite *Write = &XLogCtl->Write;
-		XLogwrtRqst FlushRqst;
-		XLogRecPtr	OldSegEnd;
-
-		TRACE_POSTGRESQL_XLOG_SWITCH();
+	static int	lockToTry = -1;
 
-		LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
+	if (lockToTry == -1)
+		lockToTry = (MyProc ? MyProc->pgprocno : 0) % NUM_XLOGINSERT_LOCKS;
+	MyLockNo = lockToTry;
 
+	/*
+	 * The insertingAt value is initially set to 0, as we don't know our
+	 * insert location yet.
+	 */
+	immed = LWLockAcquireWithVar(FirstWALInsertLock + MyLockNo,
+								 &XLogCtl->insertSlots[MyLockNo].insertingAt,
+								 0);
+	if (!immed)
+	{
 		/*
-		 * Flush through the end of the page containing XLOG_SWITCH, and
-		 * perform end-of-segment actions (eg, notifying archiver).
+		 * If we couldn't get the lock immediately, try another lock next
+		 * time.  On a system with more insertion locks than concurrent
+		 * inserters, this causes all the inserters to eventually migrate to
+		 * a lock that no-one else is using.  On a system with more inserters
+		 * than locks, it still helps to distribute the inserters evenly
+		 * across the locks.
 		 */
-		WriteRqst = XLogCtl->xlblocks[curridx];
-		FlushRqst.Write = WriteRqst;
-		FlushRqst.Flush = WriteRqst;
-		XLogWrite(FlushRqst, false, true);
-
-		/* Set up the next buffer as first page of next segment */
-		/* Note: AdvanceXLInsertBuffer cannot need to do I/O here */
-		(void) AdvanceXLInsertBuffer(true);
-
-		/* There should be no unwritten data */
-		curridx = Insert->curridx;
-		Assert(curridx == Write->curridx);
-
-		/* Compute end address of old segment */
-		OldSegEnd = XLogCtl->xlblocks[curridx];
-		OldSegEnd.xrecoff -= XLOG_BLCKSZ;
-		if (OldSegEnd.xrecoff == 0)
+		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+	}
+}
+
+/*
+ * Acquire all WAL insertion locks, to prevent other backends from inserting
+ * to WAL.
+ */
+static void
+WALInsertLockAcquireExclusive(void)
+{
+	int			i;
+
+	/*
+	 * When holding all the locks, we only update the last lock's insertingAt
+	 * indicator.  The others are set to 0xFFFFFFFFFFFFFFFF, which is higher
+	 * than any real XLogRecPtr value, to make sure that no-one blocks
+	 * waiting on those.
+	 */
+	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+		(void) LWLockAcquireWithVar(FirstWALInsertLock + i,
+									&XLogCtl->insertSlots[i].insertingAt,
+									UINT64CONST(0xFFFFFFFFFFFFFFFF));
+	(void) LWLockAcquireWithVar(FirstWALInsertLock + i,
+								&XLogCtl->insertSlots[i].insertingAt,
+								0);
+
+	holdingAllLocks = true;
+}
+
+/*
+ * Release our insertion lock (or locks, if we're holding them all).
+ */
+static void
+WALInsertLockRelease(void)
+{
+	if (holdingAllLocks)
+	{
+		int			i;
+
+		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+			LWLockRelease(FirstWALInsertLock + i);
+
+		holdingAllLocks = false;
+	}
+	else
+		LWLockRelease(FirstWALInsertLock + MyLockNo);
+}
+
+/*
+ * Update our insertingAt value, to let others know that we've finished
+ * inserting up to that point.
+ */
+static void
+WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
+{
+	int			lockno = holdingAllLocks ? NUM_XLOGINSERT_LOCKS - 1 : MyLockNo;
+
+	LWLockUpdateVar(FirstWALInsertLock + lockno,
+					&XLogCtl->insertSlots[lockno].insertingAt,
+					XLogRecPtrToUInt64(insertingAt));
+}
+
+/*
+ * Wait for any WAL insertions < upto to finish.
+ *
+ * Returns the location of the oldest insertion that is still in-progress.
+ * Any WAL prior to that point has been fully copied into WAL buffers, and
+ * can be flushed out to disk.  Because this waits for any insertions older
+ * than 'upto' to finish, the return value is always >= 'upto'.
+ *
+ * Note: When you are about to write out WAL, you must call this function
+ * *before* acquiring WALWriteLock, to avoid deadlocks.  This function might
+ * need to wait for an insertion to finish (or at least advance to next
+ * uninitialized page), and the inserter might need to evict an old WAL
+ * buffer to make room for a new one, which in turn requires WALWriteLock.
+ */
+static XLogRecPtr
+WaitXLogInsertionsToFinish(XLogRecPtr upto)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogCtlInsert *Insert = &XLogCtl->Insert;
+	XLogRecPtr	reservedUpto;
+	XLogRecPtr	finishedUpto;
+	uint64		uptoval;
+	uint64		finishedval;
+	int			i;
+
+	if (MyProc == NULL)
+		elog(PANIC, "cannot wait without a PGPROC structure");
+
+	/* Read the current insert position */
+	SpinLockAcquire(&Insert->insertpos_lck);
+	reservedUpto = Insert->CurrPos;
+	SpinLockRelease(&Insert->insertpos_lck);
+
+	/*
+	 * No-one should request to flush a piece of WAL that hasn't even been
+	 * reserved yet.  However, it can happen if there is a block with a bogus
+	 * LSN on disk, for example.  XLogFlush checks for that situation and
+	 * complains, but only after the flush.  Here we just assume that to mean
+	 * that all WAL that has been reserved needs to be finished.  In this
+	 * corner-case, the return value can be smaller than 'upto' argument.
+	 */
+	if (XLByteLT(reservedUpto, upto))
+	{
+		elog(LOG, "request to flush past end of generated WAL; request %X/%X, currpos %X/%X",
+			 upto.xlogid, upto.xrecoff,
+			 reservedUpto.xlogid, reservedUpto.xrecoff);
+		upto = reservedUpto;
+	}
+
+	/*
+	 * Loop through all the locks, sleeping on any in-progress insert older
+	 * than 'upto'.
+	 *
+	 * finishedUpto is our return value, indicating the point upto which all
+	 * the WAL insertions have been finished.  Initialize it to the head of
+	 * reserved WAL, and as we iterate through the insertion locks, back it
+	 * out for any insertion that's still in progress.
+	 */
+	uptoval = XLogRecPtrToUInt64(upto);
+	finishedval = XLogRecPtrToUInt64(reservedUpto);
+	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	{
+		uint64		insertingat = 0;
+
+		do
 		{
-			/* crossing a logid boundary */
-			OldSegEnd.xlogid -= 1;
-			OldSegEnd.xrecoff = XLogFileSize;
-		}
+			/*
+			 * See if this insertion is in progress.  LWLockWaitForVar will
+			 * wait for the lock to be released, or for the 'value' to be set
+			 * by a LWLockUpdateVar call.  When a lock is initially acquired,
+			 * its value is 0, which means that we don't know where it's
+			 * inserting yet.  We will have to wait for it.  If it's a small
+			 * insertion, the record will most likely fit on the same page and
+			 * the inserter will release the lock without ever calling
+			 * LWLockUpdateVar.  But if it has to sleep, it will advertise the
+			 * insertion point with LWLockUpdateVar before sleeping.
+			 */
+			if (LWLockWaitForVar(FirstWALInsertLock + i,
+								 &XLogCtl->insertSlots[i].insertingAt,
+								 insertingat, &insertingat))
+			{
+				/* the lock was free, so no insertion in progress */
+				insertingat = 0;
+				break;
+			}
+
+			/*
+			 * This insertion is still in progress.  Have to wait, unless the
+			 * inserter has proceeded past 'upto'.
+			 */
+		} while (insertingat < uptoval);
+
+		if (insertingat != 0 && insertingat < finishedval)
+			finishedval = insertingat;
+	}
+
+	UInt64ToXLogRecPtr(finishedval, finishedUpto);
+	return finishedUpto;
+}
+
+/*
+ * Get a pointer to the right location in the WAL buffer containing the
+ * given XLogRecPtr.
+ *
+ * If the page is not initialized yet, it is initialized.  That might require
+ * evicting an old dirty buffer from the buffer cache, which means I/O.
+ *
+ * The caller must ensure that the page containing the requested location
+ * isn't evicted yet, and won't be evicted.  The way to ensure that is to
+ * hold onto a WAL insertion lock with the insertingAt position set to
+ * something <= ptr.  GetXLogBuffer() will update insertingAt if it needs
+ * to evict an old page from the buffer.  (This means that once you call
+ * GetXLogBuffer() with a given 'ptr', you must not access anything before
+ * that point anymore, and must not call GetXLogBuffer() with an older 'ptr'
+ * later, because older buffers might be recycled already.)
+ */
+static char *
+GetXLogBuffer(XLogRecPtr ptr)
+{
+	int			idx;
+	XLogRecPtr	endptr;
+	XLogRecPtr	expectedEndPtr;
+	XLogRecPtr	pagebegin;
+
+	/*
+	 * The XLog buffer cache is organized so that a page is always loaded to
+	 * a particular buffer.  That way we can easily calculate the buffer a
+	 * given page must be loaded into, from the XLogRecPtr alone.
+	 */
+	idx = XLogRecPtrToBufIdx(ptr);
+
+	pagebegin = ptr;
+	pagebegin.xrecoff -= ptr.xrecoff % XLOG_BLCKSZ;
+	expectedEndPtr = pagebegin;
+	expectedEndPtr.xrecoff += XLOG_BLCKSZ;
+
+	/*
+	 * See what page is loaded in the buffer at the moment.  It could be the
+	 * page we're looking for, or something older.  It can't be anything
+	 * newer - that would imply the page we're looking for has already been
+	 * written out to disk and evicted, and the caller is responsible for
+	 * making sure that doesn't happen.
+	 *
+	 * However, we don't hold a lock while we read the value.  If someone has
+	 * just initialized the page, it's possible that we get a "torn read" of
+	 * the XLogRecPtr, which is two separate 32-bit fields.  Any torn value
+	 * still fails to match expectedEndPtr unless both halves are already
+	 * the new ones, so in that case we just fall into the slow path below
+	 * and recheck under the lock.
+	 */
+	endptr = *((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]);
 
-		/* Make it look like we've written and synced all of old segment */
-		LogwrtResult.Write = OldSegEnd;
-		LogwrtResult.Flush = OldSegEnd;
+	if (!XLByteEQ(expectedEndPtr, endptr))
+	{
+		XLogRecPtr	finishedto = pagebegin;
 
 		/*
-		 * Update shared-memory status --- this code should match XLogWrite
+		 * Let others know that we're finished inserting the record up to the
+		 * page boundary, before we possibly have to sleep initializing the
+		 * page.  At the start of a logical log file, express the boundary as
+		 * the end of the previous file, like the xlblocks entries and the
+		 * XLogWrite() request pointers do.
 		 */
+		if (finishedto.xrecoff == 0)
 		{
-			/* use volatile pointer to prevent code rearrangement */
-			volatile XLogCtlData *xlogctl = XLogCtl;
-
-			SpinLockAcquire(&xlogctl->info_lck);
-			xlogctl->LogwrtResult = LogwrtResult;
-			if (XLByteLT(xlogctl->LogwrtRqst.Write, LogwrtResult.Write))
-				xlogctl->LogwrtRqst.Write = LogwrtResult.Write;
-			if (XLByteLT(xlogctl->LogwrtRqst.Flush, LogwrtResult.Flush))
-				xlogctl->LogwrtRqst.Flush = LogwrtResult.Flush;
-			SpinLockRelease(&xlogctl->info_lck);
+			finishedto.xlogid -= 1;
+			finishedto.xrecoff = XLogFileSize;
 		}
+		WALInsertLockUpdateInsertingAt(finishedto);
 
-		Write->LogwrtResult = LogwrtResult;
-
-		LWLockRelease(WALWriteLock);
+		AdvanceXLInsertBuffer(pagebegin);
+		endptr = XLogCtl->xlblocks[idx];
 
-		updrqst = false;		/* done already */
+		if (!XLByteEQ(expectedEndPtr, endptr))
+			elog(PANIC, "could not find WAL buffer for %X/%X",
+				 ptr.xlogid, ptr.xrecoff);
 	}
 	else
 	{
-		/* normal case, ie not xlog switch */
-
-		/* Need to update shared LogwrtRqst if some block was filled up */
-		if (freespace < SizeOfXLogRecord)
-		{
-			/* curridx is filled and available for writing out */
-			updrqst = true;
-		}
-		else
-		{
-			/* if updrqst already set, write through end of previous buf */
-			curridx = PrevBufIdx(curridx);
-		}
-		WriteRqst = XLogCtl->xlblocks[curridx];
-	}
-
-	LWLockRelease(WALInsertLock);
-
-	if (updrqst)
-	{
-		/* use volatile pointer to prevent code rearrangement */
-		volatile XLogCtlData *xlogctl = XLogCtl;
-
-		SpinLockAcquire(&xlogctl->info_lck);
-		/* advance global request to include new block(s) */
-		if (XLByteLT(xlogctl->LogwrtRqst.Write, WriteRqst))
-			xlogctl->LogwrtRqst.Write = WriteRqst;
-		/* update local result copy while I have the chance */
-		LogwrtResult = xlogctl->LogwrtResult;
-		SpinLockRelease(&xlogctl->info_lck);
+		/*
+		 * Make sure the initialization of the page is visible to us, and
+		 * won't arrive later to overwrite the WAL data we write on the page.
+		 */
+		pg_memory_barrier();
 	}
 
-	XactLastRecEnd = RecPtr;
-
-	END_CRIT_SECTION();
-
-	return RecPtr;
+	return XLogCtl->pages + idx * (Size) XLOG_BLCKSZ +
+		ptr.xrecoff % XLOG_BLCKSZ;
 }
 
 /*
@@ -1256,8 +1836,10 @@ XLogCheckBuffer(XLogRecData *rdata, bool doPageWrites,
 		XLByteLE(PageGetLSN(page), RedoRecPtr))
 	{
 		/*
-		 * The page needs to be backed up, so set up *bkpb
+		 * The page needs to be backed up, so set up *bkpb.  Zero it first so
+		 * that no stray padding bytes find their way into the WAL.
 		 */
+		MemSet(bkpb, 0, sizeof(BkpBlock));
 		BufferGetTag(rdata->buffer, &bkpb->node, &bkpb->fork, &bkpb->block);
 
 		if (rdata->buffer_std)
@@ -1293,6 +1875,36 @@ XLogCheckBuffer(XLogRecData *rdata, bool doPageWrites,
 	return false;				/* buffer does not need to be backed up */
 }
 
+/*
+ * Try to compress the image of a page that is to be backed up, leaving out
+ * its hole, into *dest.  If that works and actually saves space, set
+ * bkpb->compressed_length; otherwise leave it zero so that the image is
+ * stored as is.
+ */
+static void
+XLogCompressBkpBlock(BkpBlock *bkpb, char *page, PGLZ_Header *dest)
+{
+	int32		rawlen = BLCKSZ - bkpb->hole_length;
+	char	   *source;
+
+	bkpb->compressed_length = 0;
+
+	if (bkpb->hole_length == 0)
+		source = page;
+	else
+	{
+		memcpy(bkpPageImage, page, bkpb->hole_offset);
+		memcpy(bkpPageImage + bkpb->hole_offset,
+			   page + (bkpb->hole_offset + bkpb->hole_length),
+			   BLCKSZ - (bkpb->hole_offset + bkpb->hole_length));
+		source = bkpPageImage;
+	}
+
+	if (pglz_compress(source, rawlen, dest, PGLZ_strategy_default) &&
+		VARSIZE(dest) < rawlen)
+		bkpb->compressed_length = VARSIZE(dest);
+}
+
 /*
  * XLogArchiveNotify
  *
@@ -1456,173 +2068,189 @@ XLogArchiveCleanup(const char *xlog)
 }
 
 /*
- * Advance the Insert state to the next buffer page, writing out the next
- * buffer if it still contains unwritten data.
+ * Initialize XLOG buffers, writing out old buffers if they still contain
+ * unwritten data, upto the page containing 'upto'.
  *
- * If new_segment is TRUE then we set up the next buffer page as the first
- * page of the next xlog segment file, possibly but not usually the next
- * consecutive file page.
+ * The pages are initialized in order; a page is never initialized before
+ * all the pages preceding it have been.  InitializedUpTo is the end of the
+ * last page that was initialized.
  *
- * The global LogwrtRqst.Write pointer needs to be advanced to include the
- * just-filled page.  If we can do this for free (without an extra lock),
- * we do so here.  Otherwise the caller must do it.  We return TRUE if the
- * request update still needs to be done, FALSE if we did it internally.
- *
- * Must be called with WALInsertLock held.
+ * Must be called with an insertion lock held, with its insertingAt set to
+ * no later than 'upto', so that WaitXLogInsertionsToFinish() doesn't wait
+ * for us.  Write-out of old pages and the waiting for other insertions
+ * that it implies are done without holding WALBufMappingLock.
  */
-static bool
-AdvanceXLInsertBuffer(bool new_segment)
+static void
+AdvanceXLInsertBuffer(XLogRecPtr upto)
 {
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
-	XLogCtlWrite *Write = &XLogCtl->Write;
-	int			nextidx = NextBufIdx(Insert->curridx);
-	bool		update_needed = true;
+	int			nextidx;
 	XLogRecPtr	OldPageRqstPtr;
 	XLogwrtRqst WriteRqst;
+	XLogRecPtr	NewPageBeginPtr;
 	XLogRecPtr	NewPageEndPtr;
 	XLogPageHeader NewPage;
 
-	/* Use Insert->LogwrtResult copy if it's more fresh */
-	if (XLByteLT(LogwrtResult.Write, Insert->LogwrtResult.Write))
-		LogwrtResult = Insert->LogwrtResult;
+	LWLockAcquire(WALBufMappingLock, LW_EXCLUSIVE);
 
 	/*
-	 * Get ending-offset of the buffer page we need to replace (this may be
-	 * zero if the buffer hasn't been used yet).  Fall through if it's already
-	 * written out.
+	 * Now that we have the lock, check if someone initialized the page
+	 * already.
 	 */
-	OldPageRqstPtr = XLogCtl->xlblocks[nextidx];
-	if (!XLByteLE(OldPageRqstPtr, LogwrtResult.Write))
+	while (XLByteLE(XLogCtl->InitializedUpTo, upto))
 	{
-		/* nope, got work to do... */
-		XLogRecPtr	FinishedPageRqstPtr;
-
-		FinishedPageRqstPtr = XLogCtl->xlblocks[Insert->curridx];
-
-		/* Before waiting, get info_lck and update LogwrtResult */
+		/*
+		 * Get the beginning of the next page to initialize.  InitializedUpTo
+		 * may point to the very end of a logical log file, which is really
+		 * the beginning of the next one.
+		 */
+		NewPageBeginPtr = XLogCtl->InitializedUpTo;
+		if (NewPageBeginPtr.xrecoff >= XLogFileSize)
 		{
-			/* use volatile pointer to prevent code rearrangement */
-			volatile XLogCtlData *xlogctl = XLogCtl;
-
-			SpinLockAcquire(&xlogctl->info_lck);
-			if (XLByteLT(xlogctl->LogwrtRqst.Write, FinishedPageRqstPtr))
-				xlogctl->LogwrtRqst.Write = FinishedPageRqstPtr;
-			LogwrtResult = xlogctl->LogwrtResult;
-			SpinLockRelease(&xlogctl->info_lck);
+			/* crossing a logid boundary */
+			NewPageBeginPtr.xlogid += 1;
+			NewPageBeginPtr.xrecoff = 0;
 		}
+		nextidx = XLogRecPtrToBufIdx(NewPageBeginPtr);
 
-		update_needed = false;	/* Did the shared-request update */
-
-		if (XLByteLE(OldPageRqstPtr, LogwrtResult.Write))
-		{
-			/* OK, someone wrote it already */
-			Insert->LogwrtResult = LogwrtResult;
-		}
-		else
+		/*
+		 * Get ending-offset of the buffer page we need to replace (this may
+		 * be zero if the buffer hasn't been used yet).  Fall through if it's
+		 * already written out.
+		 */
+		OldPageRqstPtr = XLogCtl->xlblocks[nextidx];
+		if (!XLByteLE(OldPageRqstPtr, LogwrtResult.Write))
 		{
-			/* Must acquire write lock */
-			LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
-			LogwrtResult = Write->LogwrtResult;
-			if (XLByteLE(OldPageRqstPtr, LogwrtResult.Write))
+			/* nope, got work to do... */
+
+			/* Before waiting, get info_lck and update LogwrtResult */
 			{
-				/* OK, someone wrote it already */
-				LWLockRelease(WALWriteLock);
-				Insert->LogwrtResult = LogwrtResult;
+				/* use volatile pointer to prevent code rearrangement */
+				volatile XLogCtlData *xlogctl = XLogCtl;
+
+				SpinLockAcquire(&xlogctl->info_lck);
+				if (XLByteLT(xlogctl->LogwrtRqst.Write, OldPageRqstPtr))
+					xlogctl->LogwrtRqst.Write = OldPageRqstPtr;
+				LogwrtResult = xlogctl->LogwrtResult;
+				SpinLockRelease(&xlogctl->info_lck);
 			}
-			else
+
+			/*
+			 * Now that we have an up-to-date LogwrtResult value, see if we
+			 * still need to write it or if someone else already did.
+			 */
+			if (!XLByteLE(OldPageRqstPtr, LogwrtResult.Write))
 			{
 				/*
-				 * Have to write buffers while holding insert lock. This is
-				 * not good, so only write as much as we absolutely must.
+				 * Must acquire write lock.  Release WALBufMappingLock first,
+				 * to make sure that all insertions that we need to wait for
+				 * can finish (up to this same position).  Otherwise we risk
+				 * deadlock.
 				 */
-				TRACE_POSTGRESQL_WAL_BUFFER_WRITE_DIRTY_START();
-				WriteRqst.Write = OldPageRqstPtr;
-				WriteRqst.Flush.xlogid = 0;
-				WriteRqst.Flush.xrecoff = 0;
-				XLogWrite(WriteRqst, false, false);
-				LWLockRelease(WALWriteLock);
-				Insert->LogwrtResult = LogwrtResult;
-				TRACE_POSTGRESQL_WAL_BUFFER_WRITE_DIRTY_DONE();
+				LWLockRelease(WALBufMappingLock);
+
+				WaitXLogInsertionsToFinish(OldPageRqstPtr);
+
+				LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
+
+				LogwrtResult = XLogCtl->Write.LogwrtResult;
+				if (XLByteLE(OldPageRqstPtr, LogwrtResult.Write))
+				{
+					/* OK, someone wrote it already */
+					LWLockRelease(WALWriteLock);
+				}
+				else
+				{
+					/* Have to write it ourselves */
+					TRACE_POSTGRESQL_WAL_BUFFER_WRITE_DIRTY_START();
+					WriteRqst.Write = OldPageRqstPtr;
+					WriteRqst.Flush.xlogid = 0;
+					WriteRqst.Flush.xrecoff = 0;
+					XLogWrite(WriteRqst, false);
+					LWLockRelease(WALWriteLock);
+					TRACE_POSTGRESQL_WAL_BUFFER_WRITE_DIRTY_DONE();
+				}
+				/* Re-acquire WALBufMappingLock and retry */
+				LWLockAcquire(WALBufMappingLock, LW_EXCLUSIVE);
+				continue;
 			}
 		}
-	}
 
-	/*
-	 * Now the next buffer slot is free and we can set it up to be the next
-	 * output page.
-	 */
-	NewPageEndPtr = XLogCtl->xlblocks[Insert->curridx];
+		/*
+		 * Now the next buffer slot is free and we can set it up to be the
+		 * next output page.
+		 */
+		NewPageEndPtr = NewPageBeginPtr;
+		NewPageEndPtr.xrecoff += XLOG_BLCKSZ;
 
-	if (new_segment)
-	{
-		/* force it to a segment start point */
-		NewPageEndPtr.xrecoff += XLogSegSize - 1;
-		NewPageEndPtr.xrecoff -= NewPageEndPtr.xrecoff % XLogSegSize;
-	}
+		Assert(XLogRecPtrToBufIdx(NewPageBeginPtr) == nextidx);
 
-	if (NewPageEndPtr.xrecoff >= XLogFileSize)
-	{
-		/* crossing a logid boundary */
-		NewPageEndPtr.xlogid += 1;
-		NewPageEndPtr.xrecoff = XLOG_BLCKSZ;
-	}
-	else
-		NewPageEndPtr.xrecoff += XLOG_BLCKSZ;
-	XLogCtl->xlblocks[nextidx] = NewPageEndPtr;
-	NewPage = (XLogPageHeader) (XLogCtl->pages + nextidx * (Size) XLOG_BLCKSZ);
+		NewPage = (XLogPageHeader) (XLogCtl->pages + nextidx * (Size) XLOG_BLCKSZ);
 
-	Insert->curridx = nextidx;
-	Insert->currpage = NewPage;
+		/*
+		 * Mark the buffer as holding no page before we start scribbling on
+		 * it.  XLogReadFromBuffers() copies old pages out without a lock, and
+		 * relies on xlblocks changing before the contents do.
+		 */
+		*((volatile XLogRecPtr *) &XLogCtl->xlblocks[nextidx]) = InvalidXLogRecPtr;
+		pg_write_barrier();
+
+		/*
+		 * Be sure to re-zero the buffer so that bytes beyond what we've
+		 * written will look like zeroes and not valid XLOG records...
+		 */
+		MemSet((char *) NewPage, 0, XLOG_BLCKSZ);
 
-	Insert->currpos = ((char *) NewPage) +SizeOfXLogShortPHD;
+		/*
+		 * Fill the new page's header
+		 */
+		NewPage   ->xlp_magic = XLOG_PAGE_MAGIC;
 
-	/*
-	 * Be sure to re-zero the buffer so that bytes beyond what we've written
-	 * will look like zeroes and not valid XLOG records...
-	 */
-	MemSet((char *) NewPage, 0, XLOG_BLCKSZ);
+		/* NewPage->xlp_info = 0; */	/* done by memset */
+		NewPage   ->xlp_tli = ThisTimeLineID;
+		NewPage   ->xlp_pageaddr = NewPageBeginPtr;
 
-	/*
-	 * Fill the new page's header
-	 */
-	NewPage   ->xlp_magic = XLOG_PAGE_MAGIC;
+		/*
+		 * If online backup is not in progress, mark the header to indicate
+		 * that WAL records beginning in this page have removable backup
+		 * blocks.  This allows the WAL archiver to know whether it is safe to
+		 * compress archived WAL data by transforming full-block records into
+		 * the non-full-block format.  It is sufficient to record this at the
+		 * page level because we force a page switch (in fact a segment
+		 * switch) when starting a backup, so the flag will be off before any
+		 * records can be written during the backup.  At the end of a backup,
+		 * the last page will be marked as all unsafe when perhaps only part
+		 * is unsafe, but at worst the archiver would miss the opportunity to
+		 * compress a few records.
+		 */
+		if (!Insert->forcePageWrites)
+			NewPage->xlp_info |= XLP_BKP_REMOVABLE;
 
-	/* NewPage->xlp_info = 0; */	/* done by memset */
-	NewPage   ->xlp_tli = ThisTimeLineID;
-	NewPage   ->xlp_pageaddr.xlogid = NewPageEndPtr.xlogid;
-	NewPage   ->xlp_pageaddr.xrecoff = NewPageEndPtr.xrecoff - XLOG_BLCKSZ;
+		/*
+		 * If first page of an XLOG segment file, make it a long header.
+		 */
+		if ((NewPage->xlp_pageaddr.xrecoff % XLogSegSize) == 0)
+		{
+			XLogLongPageHeader NewLongPage = (XLogLongPageHeader) NewPage;
 
-	/*
-	 * If online backup is not in progress, mark the header to indicate that
-	 * WAL records beginning in this page have removable backup blocks.  This
-	 * allows the WAL archiver to know whether it is safe to compress archived
-	 * WAL data by transforming full-block records into the non-full-block
-	 * format.  It is sufficient to record this at the page level because we
-	 * force a page switch (in fact a segment switch) when starting a backup,
-	 * so the flag will be off before any records can be written during the
-	 * backup.  At the end of a backup, the last page will be marked as all
-	 * unsafe when perhaps only part is unsafe, but at worst the archiver
-	 * would miss the opportunity to compress a few records.
-	 */
-	if (!Insert->forcePageWrites)
-		NewPage->xlp_info |= XLP_BKP_REMOVABLE;
+			NewLongPage->xlp_sysid = ControlFile->system_identifier;
+			NewLongPage->xlp_seg_size = XLogSegSize;
+			NewLongPage->xlp_xlog_blcksz = XLOG_BLCKSZ;
+			NewPage   ->xlp_info |= XLP_LONG_HEADER;
+		}
 
-	/*
-	 * If first page of an XLOG segment file, make it a long header.
-	 */
-	if ((NewPage->xlp_pageaddr.xrecoff % XLogSegSize) == 0)
-	{
-		XLogLongPageHeader NewLongPage = (XLogLongPageHeader) NewPage;
+		/*
+		 * Make sure the initialization of the page becomes visible to others
+		 * before the xlblocks update.  GetXLogBuffer() reads xlblocks without
+		 * holding a lock.
+		 */
+		pg_write_barrier();
 
-		NewLongPage->xlp_sysid = ControlFile->system_identifier;
-		NewLongPage->xlp_seg_size = XLogSegSize;
-		NewLongPage->xlp_xlog_blcksz = XLOG_BLCKSZ;
-		NewPage   ->xlp_info |= XLP_LONG_HEADER;
+		*((volatile XLogRecPtr *) &XLogCtl->xlblocks[nextidx]) = NewPageEndPtr;
 
-		Insert->currpos = ((char *) NewPage) +SizeOfXLogLongPHD;
+		XLogCtl->InitializedUpTo = NewPageEndPtr;
 	}
-
-	return update_needed;
+	LWLockRelease(WALBufMappingLock);
 }
 
 /*
@@ -1667,16 +2295,12 @@ XLogCheckpointNeeded(uint32 logid, uint32 logseg)
  * This option allows us to avoid uselessly issuing multiple writes when a
  * single one would do.
  *
- * If xlog_switch == TRUE, we are intending an xlog segment switch, so
- * perform end-of-segment actions after writing the last page, even if
- * it's not physically the end of its segment.  (NB: this will work properly
- * only if caller specifies WriteRqst == page-end and flexible == false,
- * and there is some data to write.)
- *
- * Must be called with WALWriteLock held.
+ * Must be called with WALWriteLock held.  WaitXLogInsertionsToFinish(WriteRqst)
+ * must be called before grabbing the lock, to make sure the data is ready to
+ * write.
  */
 static void
-XLogWrite(XLogwrtRqst WriteRqst, bool flexible, bool xlog_switch)
+XLogWrite(XLogwrtRqst WriteRqst, bool flexible)
 {
 	XLogCtlWrite *Write = &XLogCtl->Write;
 	bool		ispartialpage;
@@ -1804,6 +2428,7 @@ XLogWrite(XLogwrtRqst WriteRqst, bool flexible, bool xlog_switch)
 			from = XLogCtl->pages + startidx * (Size) XLOG_BLCKSZ;
 			nbytes = npages * (Size) XLOG_BLCKSZ;
 			errno = 0;
+			pgstat_report_wait_start(WAIT_EVENT_WAL_WRITE);
 			if (write(openLogFile, from, nbytes) != nbytes)
 			{
 				/* if write didn't set errno, assume no disk space */
@@ -1816,6 +2441,7 @@ XLogWrite(XLogwrtRqst WriteRqst, bool flexible, bool xlog_switch)
 								openLogId, openLogSeg,
 								openLogOff, (unsigned long) nbytes)));
 			}
+			pgstat_report_wait_end();
 
 			/* Update state for write */
 			openLogOff += nbytes;
@@ -1829,16 +2455,13 @@ XLogWrite(XLogwrtRqst WriteRqst, bool flexible, bool xlog_switch)
 			 * later. Doing it here ensures that one and only one backend will
 			 * perform this fsync.
 			 *
-			 * We also do this if this is the last page written for an xlog
-			 * switch.
-			 *
 			 * This is also the right place to notify the Archiver that the
 			 * segment is ready to copy to archival storage, and to update the
 			 * timer for archive_timeout, and to signal for a checkpoint if
 			 * too many logfile segments have been used since the last
 			 * checkpoint.
 			 */
-			if (finishing_seg || (xlog_switch && last_iteration))
+			if (finishing_seg)
 			{
 				issue_xlog_fsync(openLogFile, openLogId, openLogSeg);
 				LogwrtResult.Flush = LogwrtResult.Write;		/* end of page */
@@ -2086,51 +2709,99 @@ XLogFlush(XLogRecPtr record)
 	/* initialize to given target; may increase below */
 	WriteRqstPtr = record;
 
-	/* read LogwrtResult and update local state */
+	/*
+	 * Now wait until we get the write lock, or someone else does the flush
+	 * for us.
+	 */
+	for (;;)
 	{
 		/* use volatile pointer to prevent code rearrangement */
 		volatile XLogCtlData *xlogctl = XLogCtl;
+		XLogRecPtr	insertpos;
 
+		/* read LogwrtResult and update local state */
 		SpinLockAcquire(&xlogctl->info_lck);
 		if (XLByteLT(WriteRqstPtr, xlogctl->LogwrtRqst.Write))
 			WriteRqstPtr = xlogctl->LogwrtRqst.Write;
 		LogwrtResult = xlogctl->LogwrtResult;
 		SpinLockRelease(&xlogctl->info_lck);
-	}
 
-	/* done already? */
-	if (!XLByteLE(record, LogwrtResult.Flush))
-	{
-		/* now wait for the write lock */
-		LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
+		/* done already? */
+		if (XLByteLE(record, LogwrtResult.Flush))
+			break;
+
+		/*
+		 * Before actually performing the write, wait for all in-flight
+		 * insertions to the pages we're about to write to finish.  This also
+		 * tells us how far the WAL has been completely copied into the
+		 * buffers, so that we can write and flush any later additions as
+		 * well.  This must be done before acquiring WALWriteLock, see
+		 * WaitXLogInsertionsToFinish().
+		 */
+		insertpos = WaitXLogInsertionsToFinish(WriteRqstPtr);
+
+		/*
+		 * Try to get the write lock.  If we can't get it immediately, wait
+		 * until it's released, and recheck if we still need to do the flush
+		 * or if the backend that held the lock did it for us already.  This
+		 * way, while one backend is busy fsyncing, all the backends that
+		 * queue up behind it are satisfied by the next single fsync, done by
+		 * whichever of them gets the lock first.
+		 */
+		if (!LWLockAcquireOrWait(WALWriteLock, LW_EXCLUSIVE))
+		{
+			/*
+			 * The lock is now free, but we didn't acquire it yet.  Before we
+			 * do, loop back to check if someone else flushed the record for
+			 * us already.
+			 */
+			continue;
+		}
+
+		/* Got the lock; recheck whether request is satisfied */
 		LogwrtResult = XLogCtl->Write.LogwrtResult;
-		if (!XLByteLE(record, LogwrtResult.Flush))
+		if (XLByteLE(record, LogwrtResult.Flush))
 		{
-			/* try to write/flush later additions to XLOG as well */
-			if (LWLockConditionalAcquire(WALInsertLock, LW_EXCLUSIVE))
-			{
-				XLogCtlInsert *Insert = &XLogCtl->Insert;
-				uint32		freespace = INSERT_FREESPACE(Insert);
+			LWLockRelease(WALWriteLock);
+			break;
+		}
 
-				if (freespace < SizeOfXLogRecord)		/* buffer is full */
-					WriteRqstPtr = XLogCtl->xlblocks[Insert->curridx];
-				else
-				{
-					WriteRqstPtr = XLogCtl->xlblocks[Insert->curridx];
-					WriteRqstPtr.xrecoff -= freespace;
-				}
-				LWLockRelease(WALInsertLock);
-				WriteRqst.Write = WriteRqstPtr;
-				WriteRqst.Flush = WriteRqstPtr;
-			}
-			else
-			{
-				WriteRqst.Write = WriteRqstPtr;
-				WriteRqst.Flush = record;
-			}
-			XLogWrite(WriteRqst, false, false);
+		/*
+		 * Sleep before flush!  By adding a delay here, we may give further
+		 * backends the opportunity to join the backlog of group commit
+		 * followers; this can significantly improve transaction throughput,
+		 * at the risk of increasing transaction latency.
+		 *
+		 * We do not sleep if enableFsync is not turned on, nor if there are
+		 * fewer than CommitSiblings other backends with active transactions.
+		 */
+		if (CommitDelay > 0 && enableFsync &&
+			MinimumActiveBackends(CommitSiblings))
+		{
+			pg_usleep(CommitDelay);
+
+			/*
+			 * Re-check how far we can now flush the WAL.  It's generally not
+			 * safe to call WaitXLogInsertionsToFinish while holding
+			 * WALWriteLock, because an in-progress insertion might need to
+			 * also grab WALWriteLock to make progress.  But we know that all
+			 * the insertions up to insertpos have already finished, because
+			 * that's what the earlier WaitXLogInsertionsToFinish() returned.
+			 * We're only calling it again to allow insertpos to be moved
+			 * further forward, not to actually wait for anyone.
+			 */
+			insertpos = WaitXLogInsertionsToFinish(insertpos);
 		}
+
+		/* try to write/flush later additions to XLOG as well */
+		WriteRqst.Write = insertpos;
+		WriteRqst.Flush = insertpos;
+
+		XLogWrite(WriteRqst, false);
+
 		LWLockRelease(WALWriteLock);
+		/* done */
+		break;
 	}
 
 	END_CRIT_SECTION();
@@ -2241,7 +2912,8 @@ XLogBackgroundFlush(void)
 
 	START_CRIT_SECTION();
 
-	/* now wait for the write lock */
+	/* now wait for any in-progress insertions to finish and get write lock */
+	WaitXLogInsertionsToFinish(WriteRqstPtr);
 	LWLockAcquire(WALWriteLock, LW_EXCLUSIVE);
 	LogwrtResult = XLogCtl->Write.LogwrtResult;
 	if (!XLByteLE(WriteRqstPtr, LogwrtResult.Flush))
@@ -2250,7 +2922,7 @@ XLogBackgroundFlush(void)
 
 		WriteRqst.Write = WriteRqstPtr;
 		WriteRqst.Flush = WriteRqstPtr;
-		XLogWrite(WriteRqst, flexible, false);
+		XLogWrite(WriteRqst, flexible);
 	}
 	LWLockRelease(WALWriteLock);
 
@@ -2349,6 +3021,7 @@ XLogFileInit(uint32 log, uint32 seg,
 {
 	char		path[MAXPGPATH];
 	char		tmppath[MAXPGPATH];
+	char	   *zbuffer_raw;
 	char	   *zbuffer;
 	uint32		installed_log;
 	uint32		installed_seg;
@@ -2389,8 +3062,12 @@ XLogFileInit(uint32 log, uint32 seg,
 
 	unlink(tmppath);
 
-	/* do not use get_sync_bit() here --- want to fsync only at end of fill */
-	fd = BasicOpenFile(tmppath, O_RDWR | O_CREAT | O_EXCL | PG_BINARY,
+	/*
+	 * do not use get_sync_bit() here --- want to fsync only at end of fill.
+	 * But do bypass the kernel cache if direct I/O was requested for WAL.
+	 */
+	fd = BasicOpenFile(tmppath,
+					   O_RDWR | O_CREAT | O_EXCL | PG_BINARY | get_direct_bit(),
 					   S_IRUSR | S_IWUSR);
 	if (fd < 0)
 		ereport(ERROR,
@@ -2406,11 +3083,12 @@ XLogFileInit(uint32 log, uint32 seg,
 	 * fdatasync(2) or O_DSYNC will be sufficient to sync future writes to the
 	 * log file.
 	 *
-	 * Note: palloc zbuffer, instead of just using a local char array, to
-	 * ensure it is reasonably well-aligned; this may save a few cycles
-	 * transferring data to the kernel.
+	 * Note: palloc zbuffer, instead of just using a local char array, and
+	 * align it for direct I/O.  Even without that, alignment may save a few
+	 * cycles transferring data to the kernel.
 	 */
-	zbuffer = (char *) palloc0(XLOG_BLCKSZ);
+	zbuffer_raw = (char *) palloc0(XLOG_BLCKSZ + PG_IO_ALIGN_SIZE);
+	zbuffer = (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, zbuffer_raw);
 	for (nbytes = 0; nbytes < XLogSegSize; nbytes += XLOG_BLCKSZ)
 	{
 		errno = 0;
@@ -2430,7 +3108,7 @@ XLogFileInit(uint32 log, uint32 seg,
 					 errmsg("could not write to file \"%s\": %m", tmppath)));
 		}
 	}
-	pfree(zbuffer);
+	pfree(zbuffer_raw);
 
 	if (pg_fsync(fd) != 0)
 		ereport(ERROR,
@@ -3622,21 +4300,55 @@ CleanupBackupHistory(void)
  * Otherwise, a normal exclusive lock is used.	During crash recovery, that's
  * just pro forma because there can't be any regular backends in the system,
  * but in hot standby mode the distinction is important. The 'cleanup'
- * argument applies to all backup blocks in the WAL record, that suffices for
- * now.
+ * argument applies to all backup blocks in the WAL record; redo routines
+ * that need finer control use RestoreBackupBlock instead.
  */
 void
 RestoreBkpBlocks(XLogRecPtr lsn, XLogRecord *record, bool cleanup)
+{
+	int			i;
+
+	if (!(record->xl_info & XLR_BKP_BLOCK_MASK))
+		return;
+
+	for (i = 0; i < XLR_MAX_BKP_BLOCKS; i++)
+	{
+		if (!(record->xl_info & XLR_SET_BKP_BLOCK(i)))
+			continue;
+
+		(void) RestoreBackupBlock(lsn, record, i, cleanup, false);
+	}
+}
+
+/*
+ * Restore a single backup block of an XLOG record.
+ *
+ * block_index identifies the backup block (0 .. XLR_MAX_BKP_BLOCKS - 1);
+ * the caller must have checked that the record actually contains it.
+ * get_cleanup_lock selects a cleanup lock rather than a plain exclusive
+ * lock, as for RestoreBkpBlocks.  If keep_buffer is true, the restored
+ * buffer is returned still pinned and locked, so that the caller can hold
+ * it while it works on other pages touched by the same record; otherwise
+ * it is released and InvalidBuffer is returned.
+ */
+Buffer
+RestoreBackupBlock(XLogRecPtr lsn, XLogRecord *record, int block_index,
+				   bool get_cleanup_lock, bool keep_buffer)
 {
 	Buffer		buffer;
 	Page		page;
 	BkpBlock	bkpb;
 	char	   *blk;
+	char	   *src;
 	int			i;
+	union
+	{
+		PGLZ_Header hdr;
+		char		data[PGLZ_MAX_OUTPUT(BLCKSZ)];
+	}			compressed;
+	char		image[BLCKSZ];
 
-	if (!(record->xl_info & XLR_BKP_BLOCK_MASK))
-		return;
-
+	/* Locate requested BkpBlock in the record */
 	blk = (char *) XLogRecGetData(record) + record->xl_len;
 	for (i = 0; i < XLR_MAX_BKP_BLOCKS; i++)
 	{
@@ -3646,37 +4358,68 @@ RestoreBkpBlocks(XLogRecPtr lsn, XLogRecord *record, bool cleanup)
 		memcpy(&bkpb, blk, sizeof(BkpBlock));
 		blk += sizeof(BkpBlock);
 
-		buffer = XLogReadBufferExtended(bkpb.node, bkpb.fork, bkpb.block,
-										RBM_ZERO);
-		Assert(BufferIsValid(buffer));
-		if (cleanup)
-			LockBufferForCleanup(buffer);
+		if (i == block_index)
+			break;
+
+		if (bkpb.compressed_length > 0)
+			blk += bkpb.compressed_length;
 		else
-			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			blk += BLCKSZ - bkpb.hole_length;
+	}
 
-		page = (Page) BufferGetPage(buffer);
+	if (i != block_index)
+		elog(PANIC, "backup block %d not present in record at %X/%X",
+			 block_index, lsn.xlogid, lsn.xrecoff);
 
-		if (bkpb.hole_length == 0)
-		{
-			memcpy((char *) page, blk, BLCKSZ);
-		}
-		else
-		{
-			/* must zero-fill the hole */
-			MemSet((char *) page, 0, BLCKSZ);
-			memcpy((char *) page, blk, bkpb.hole_offset);
-			memcpy((char *) page + (bkpb.hole_offset + bkpb.hole_length),
-				   blk + bkpb.hole_offset,
-				   BLCKSZ - (bkpb.hole_offset + bkpb.hole_length));
-		}
+	buffer = XLogReadBufferExtended(bkpb.node, bkpb.fork, bkpb.block,
+									RBM_ZERO);
+	Assert(BufferIsValid(buffer));
+	if (get_cleanup_lock)
+		LockBufferForCleanup(buffer);
+	else
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
 
-		PageSetLSN(page, lsn);
-		PageSetTLI(page, ThisTimeLineID);
-		MarkBufferDirty(buffer);
-		UnlockReleaseBuffer(buffer);
+	page = (Page) BufferGetPage(buffer);
+
+	if (bkpb.compressed_length > 0)
+	{
+		/* decompress into aligned storage, then copy as usual */
+		memcpy(compressed.data, blk, bkpb.compressed_length);
+		if (VARSIZE(&compressed.hdr) != bkpb.compressed_length ||
+			PGLZ_RAW_SIZE(&compressed.hdr) != BLCKSZ - bkpb.hole_length)
+			elog(PANIC, "invalid compressed backup block in record at %X/%X",
+				 lsn.xlogid, lsn.xrecoff);
+		pglz_decompress(&compressed.hdr, image);
+		src = image;
+	}
+	else
+		src = blk;
+
+	if (bkpb.hole_length == 0)
+	{
+		memcpy((char *) page, src, BLCKSZ);
+	}
+	else
+	{
+		/* must zero-fill the hole */
+		MemSet((char *) page, 0, BLCKSZ);
+		memcpy((char *) page, src, bkpb.hole_offset);
+		memcpy((char *) page + (bkpb.hole_offset + bkpb.hole_length),
+			   src + bkpb.hole_offset,
+			   BLCKSZ - (bkpb.hole_offset + bkpb.hole_length));
+	}
 
-		blk += BLCKSZ - bkpb.hole_length;
+	PageSetLSN(page, lsn);
+	PageSetTLI(page, ThisTimeLineID);
+	MarkBufferDirty(buffer);
+
+	if (!keep_buffer)
+	{
+		UnlockReleaseBuffer(buffer);
+		buffer = InvalidBuffer;
 	}
+
+	return buffer;
 }
 
 /*
@@ -3696,8 +4439,8 @@ RecordIsValid(XLogRecord *record, XLogRecPtr recptr, int emode)
 	char	   *blk;
 
 	/* First the rmgr data */
-	INIT_CRC32(crc);
-	COMP_CRC32(crc, XLogRecGetData(record), len);
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, XLogRecGetData(record), len);
 
 	/* Add in the backup blocks, if any */
 	blk = (char *) XLogRecGetData(record) + len;
@@ -3716,8 +4459,18 @@ RecordIsValid(XLogRecord *record, XLogRecPtr recptr, int emode)
 							recptr.xlogid, recptr.xrecoff)));
 			return false;
 		}
-		blen = sizeof(BkpBlock) + BLCKSZ - bkpb.hole_length;
-		COMP_CRC32(crc, blk, blen);
+		if (bkpb.compressed_length > BLCKSZ - bkpb.hole_length)
+		{
+			ereport(emode_for_corrupt_record(emode, recptr),
+					(errmsg("incorrect compressed block size in record at %X/%X",
+							recptr.xlogid, recptr.xrecoff)));
+			return false;
+		}
+		if (bkpb.compressed_length > 0)
+			blen = sizeof(BkpBlock) + bkpb.compressed_length;
+		else
+			blen = sizeof(BkpBlock) + BLCKSZ - bkpb.hole_length;
+		COMP_CRC32C(crc, blk, blen);
 		blk += blen;
 	}
 
@@ -3731,11 +4484,11 @@ RecordIsValid(XLogRecord *record, XLogRecPtr recptr, int emode)
 	}
 
 	/* Finally include the record header */
-	COMP_CRC32(crc, (char *) record + sizeof(pg_crc32),
+	COMP_CRC32C(crc, (char *) record + sizeof(pg_crc32),
 			   SizeOfXLogRecord - sizeof(pg_crc32));
-	FIN_CRC32(crc);
+	FIN_CRC32C(crc);
 
-	if (!EQ_CRC32(record->xl_crc, crc))
+	if (!EQ_CRC32C(record->xl_crc, crc))
 	{
 		ereport(emode_for_corrupt_record(emode, recptr),
 		(errmsg("incorrect resource manager data checksum in record at %X/%X",
@@ -4672,11 +5425,11 @@ WriteControlFile(void)
 	ControlFile->float8ByVal = FLOAT8PASSBYVAL;
 
 	/* Contents are protected with a CRC */
-	INIT_CRC32(ControlFile->crc);
-	COMP_CRC32(ControlFile->crc,
+	INIT_CRC32C(ControlFile->crc);
+	COMP_CRC32C(ControlFile->crc,
 			   (char *) ControlFile,
 			   offsetof(ControlFileData, crc));
-	FIN_CRC32(ControlFile->crc);
+	FIN_CRC32C(ControlFile->crc);
 
 	/*
 	 * We write out PG_CONTROL_SIZE bytes into pg_control, zero-padding the
@@ -4772,13 +5525,13 @@ ReadControlFile(void)
 				 errhint("It looks like you need to initdb.")));
 
 	/* Now check the CRC. */
-	INIT_CRC32(crc);
-	COMP_CRC32(crc,
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc,
 			   (char *) ControlFile,
 			   offsetof(ControlFileData, crc));
-	FIN_CRC32(crc);
+	FIN_CRC32C(crc);
 
-	if (!EQ_CRC32(crc, ControlFile->crc))
+	if (!EQ_CRC32C(crc, ControlFile->crc))
 		ereport(FATAL,
 				(errmsg("incorrect checksum in control file")));
 
@@ -4910,11 +5663,11 @@ UpdateControlFile(void)
 {
 	int			fd;
 
-	INIT_CRC32(ControlFile->crc);
-	COMP_CRC32(ControlFile->crc,
+	INIT_CRC32C(ControlFile->crc);
+	COMP_CRC32C(ControlFile->crc,
 			   (char *) ControlFile,
 			   offsetof(ControlFileData, crc));
-	FIN_CRC32(ControlFile->crc);
+	FIN_CRC32C(ControlFile->crc);
 
 	fd = BasicOpenFile(XLOG_CONTROL_FILE,
 					   O_RDWR | PG_BINARY,
@@ -5102,7 +5855,7 @@ XLOGShmemInit(void)
 	XLogCtl->XLogCacheBlck = XLOGbuffers - 1;
 	XLogCtl->SharedRecoveryInProgress = true;
 	XLogCtl->SharedHotStandbyActive = false;
-	XLogCtl->Insert.currpage = (XLogPageHeader) (XLogCtl->pages);
+	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
 	SpinLockInit(&XLogCtl->info_lck);
 	InitSharedLatch(&XLogCtl->recoveryWakeupLatch);
 	InitSharedLatch(&XLogCtl->WALWriterLatch);
@@ -5205,11 +5958,11 @@ BootStrapXLOG(void)
 	record->xl_rmid = RM_XLOG_ID;
 	memcpy(XLogRecGetData(record), &checkPoint, sizeof(checkPoint));
 
-	INIT_CRC32(crc);
-	COMP_CRC32(crc, &checkPoint, sizeof(checkPoint));
-	COMP_CRC32(crc, (char *) record + sizeof(pg_crc32),
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, &checkPoint, sizeof(checkPoint));
+	COMP_CRC32C(crc, (char *) record + sizeof(pg_crc32),
 			   SizeOfXLogRecord - sizeof(pg_crc32));
-	FIN_CRC32(crc);
+	FIN_CRC32C(crc);
 	record->xl_crc = crc;
 
 	/* Create first XLOG segment file */
@@ -5975,9 +6728,13 @@ StartupXLOG(void)
 	XLogRecPtr	RecPtr,
 				checkPointLoc,
 				EndOfLog;
+	XLogRecPtr	pageBeginPtr;
+	XLogRecPtr	pageEndPtr;
 	uint32		endLogId;
 	uint32		endLogSeg;
 	XLogRecord *record;
+	char	   *page;
+	int			firstIdx;
 	uint32		freespace;
 	TransactionId oldestActiveXID;
 	bool		backupEndRequired = false;
@@ -6579,6 +7336,22 @@ StartupXLOG(void)
 					TransactionIdIsValid(record->xl_xid))
 					RecordKnownAssignedTransactionIds(record->xl_xid);
 
+				/*
+				 * Get the kernel started on reading the pages that the
+				 * records to come will need.  WAL restored from the archive
+				 * is not in pg_xlog under its own name, so there's nothing
+				 * to look ahead at in that case.
+				 */
+				if (recovery_prefetch_distance > 0 &&
+					readSource != XLOG_FROM_ARCHIVE)
+				{
+					XLogRecPtr	limit = InvalidXLogRecPtr;
+
+					if (readSource == XLOG_FROM_STREAM)
+						limit = GetWalRcvWriteRecPtr(NULL);
+					XLogPrefetch(ReadRecPtr, EndRecPtr, limit, curFileTLI);
+				}
+
 				RmgrTable[record->xl_rmid].rm_redo(EndRecPtr, record);
 
 				/* Pop the error context stack */
@@ -6618,6 +7391,14 @@ StartupXLOG(void)
 					(errmsg("redo is not required")));
 		}
 	}
+	else
+	{
+		/*
+		 * After a clean shutdown, restore the statistics that were saved by
+		 * ShutdownXLOG.  After recovery they were reset above instead.
+		 */
+		pgstat_read_statsfile();
+	}
 
 	/*
 	 * Kill WAL receiver, if it's still running, before we continue to write
@@ -6737,35 +7518,39 @@ StartupXLOG(void)
 	openLogOff = 0;
 	Insert = &XLogCtl->Insert;
 	Insert->PrevRecord = LastRec;
-	XLogCtl->xlblocks[0].xlogid = openLogId;
-	XLogCtl->xlblocks[0].xrecoff =
-		((EndOfLog.xrecoff - 1) / XLOG_BLCKSZ + 1) * XLOG_BLCKSZ;
+	Insert->CurrPos = EndOfLog;
+
+	pageBeginPtr.xlogid = openLogId;
+	pageBeginPtr.xrecoff = ((EndOfLog.xrecoff - 1) / XLOG_BLCKSZ) * XLOG_BLCKSZ;
+	pageEndPtr = pageBeginPtr;
+	pageEndPtr.xrecoff += XLOG_BLCKSZ;
+	firstIdx = XLogRecPtrToBufIdx(pageBeginPtr);
+	XLogCtl->xlblocks[firstIdx] = pageEndPtr;
+	XLogCtl->InitializedUpTo = pageEndPtr;
 
 	/*
 	 * Tricky point here: readBuf contains the *last* block that the LastRec
 	 * record spans, not the one it starts in.	The last block is indeed the
 	 * one we want to use.
 	 */
-	Assert(readOff == (XLogCtl->xlblocks[0].xrecoff - XLOG_BLCKSZ) % XLogSegSize);
-	memcpy((char *) Insert->currpage, readBuf, XLOG_BLCKSZ);
-	Insert->currpos = (char *) Insert->currpage +
-		(EndOfLog.xrecoff + XLOG_BLCKSZ - XLogCtl->xlblocks[0].xrecoff);
+	Assert(readOff == pageBeginPtr.xrecoff % XLogSegSize);
+	page = XLogCtl->pages + firstIdx * (Size) XLOG_BLCKSZ;
+	memcpy(page, readBuf, XLOG_BLCKSZ);
 
 	LogwrtResult.Write = LogwrtResult.Flush = EndOfLog;
 
 	XLogCtl->Write.LogwrtResult = LogwrtResult;
-	Insert->LogwrtResult = LogwrtResult;
 	XLogCtl->LogwrtResult = LogwrtResult;
 
 	XLogCtl->LogwrtRqst.Write = EndOfLog;
 	XLogCtl->LogwrtRqst.Flush = EndOfLog;
 
-	freespace = INSERT_FREESPACE(Insert);
+	freespace = INSERT_FREESPACE(EndOfLog);
 	if (freespace > 0)
 	{
 		/* Make sure rest of page is zero */
-		MemSet(Insert->currpos, 0, freespace);
-		XLogCtl->Write.curridx = 0;
+		MemSet(page + EndOfLog.xrecoff % XLOG_BLCKSZ, 0, freespace);
+		XLogCtl->Write.curridx = firstIdx;
 	}
 	else
 	{
@@ -6777,7 +7562,7 @@ StartupXLOG(void)
 		 * this is sufficient.	The first actual attempt to insert a log
 		 * record will advance the insert state.
 		 */
-		XLogCtl->Write.curridx = NextBufIdx(0);
+		XLogCtl->Write.curridx = NextBufIdx(firstIdx);
 	}
 
 	/* Pre-scan prepared transactions to find out the range of XIDs present */
@@ -7271,9 +8056,8 @@ GetRedoRecPtr(void)
  *
  * NOTE: The value *actually* returned is the position of the last full
  * xlog page. It lags behind the real insert position by at most 1 page.
- * For that, we don't need to acquire WALInsertLock which can be quite
- * heavily contended, and an approximation is enough for the current
- * usage of this function.
+ * For that, we don't need to scan through WAL insertion locks, and an
+ * approximation is enough for the current usage of this function.
  */
 XLogRecPtr
 GetInsertRecPtr(void)
@@ -7307,6 +8091,64 @@ GetFlushRecPtr(void)
 	return recptr;
 }
 
+/*
+ * XLogReadFromBuffers -- copy already-flushed WAL out of the WAL buffers
+ *
+ * Copies WAL starting at startptr into buf, for as long as the pages are
+ * still resident in the WAL buffers, up to count bytes.  Returns the number
+ * of bytes copied; the caller has to get the remainder, if any, from disk.
+ * This lets walsenders that keep up with the primary serve WAL from memory,
+ * so that each additional standby doesn't add another reader of the
+ * segment files.
+ *
+ * The caller must not ask for WAL beyond the flush pointer.  Flushed data on
+ * a resident page never changes, but the buffer can be recycled for a newer
+ * page at any moment since we take no lock.  AdvanceXLInsertBuffer()
+ * invalidates the xlblocks entry before it touches the page, so we check
+ * the entry both before and after copying and only trust the copy if it
+ * held steady.
+ */
+Size
+XLogReadFromBuffers(char *buf, XLogRecPtr startptr, Size count)
+{
+	XLogRecPtr	ptr = startptr;
+	Size		nread = 0;
+
+	if (RecoveryInProgress())
+		return 0;				/* WAL buffers aren't in use yet */
+
+	while (nread < count)
+	{
+		int			idx = XLogRecPtrToBufIdx(ptr);
+		uint32		offset = ptr.xrecoff % XLOG_BLCKSZ;
+		Size		nbytes = Min(XLOG_BLCKSZ - offset, count - nread);
+		XLogRecPtr	expectedEndPtr;
+		XLogRecPtr	endptr;
+
+		expectedEndPtr = ptr;
+		expectedEndPtr.xrecoff += XLOG_BLCKSZ - offset;
+
+		endptr = *((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]);
+		if (!XLByteEQ(expectedEndPtr, endptr))
+			break;
+		pg_read_barrier();
+
+		memcpy(buf + nread,
+			   XLogCtl->pages + idx * (Size) XLOG_BLCKSZ + offset,
+			   nbytes);
+
+		pg_read_barrier();
+		endptr = *((volatile XLogRecPtr *) &XLogCtl->xlblocks[idx]);
+		if (!XLByteEQ(expectedEndPtr, endptr))
+			break;
+
+		nread += nbytes;
+		XLByteAdvance(ptr, nbytes);
+	}
+
+	return nread;
+}
+
 /*
  * Get the time of the last xlog segment switch
  */
@@ -7401,6 +8243,13 @@ ShutdownXLOG(int code, Datum arg)
 	ShutdownSUBTRANS();
 	ShutdownMultiXact();
 
+	/*
+	 * Save the statistics, so that they survive the restart.  Nobody else
+	 * should be updating them anymore at this point.
+	 */
+	pgstat_send_bgwriter();
+	pgstat_write_statsfile();
+
 	ereport(LOG,
 			(errmsg("database system is shut down")));
 }
@@ -7538,7 +8387,7 @@ CreateCheckPoint(int flags)
 	XLogRecPtr	recptr;
 	XLogCtlInsert *Insert = &XLogCtl->Insert;
 	XLogRecData rdata;
-	uint32		freespace;
+	XLogRecPtr	curInsert;
 	uint32		_logId;
 	uint32		_logSeg;
 	uint32		redo_logId;
@@ -7615,10 +8464,11 @@ CreateCheckPoint(int flags)
 		checkPoint.oldestActiveXid = InvalidTransactionId;
 
 	/*
-	 * We must hold WALInsertLock while examining insert state to determine
-	 * the checkpoint REDO pointer.
+	 * We must block concurrent insertions while examining insert state to
+	 * determine the checkpoint REDO pointer.
 	 */
-	LWLockAcquire(WALInsertLock, LW_EXCLUSIVE);
+	WALInsertLockAcquireExclusive();
+	curInsert = Insert->CurrPos;
 
 	/*
 	 * If this isn't a shutdown or forced checkpoint, and we have not switched
@@ -7630,7 +8480,7 @@ CreateCheckPoint(int flags)
 	 * (Perhaps it'd make even more sense to checkpoint only when the previous
 	 * checkpoint record is in a different xlog page?)
 	 *
-	 * While holding the WALInsertLock we find the current WAL insertion point
+	 * While holding the insertion locks we find the current WAL insertion point
 	 * and compare that with the starting point of the last checkpoint, which
 	 * is the redo pointer. We use the redo pointer because the start and end
 	 * points of a checkpoint can be hundreds of files apart on large systems
@@ -7639,15 +8489,12 @@ CreateCheckPoint(int flags)
 	if ((flags & (CHECKPOINT_IS_SHUTDOWN | CHECKPOINT_END_OF_RECOVERY |
 				  CHECKPOINT_FORCE)) == 0)
 	{
-		XLogRecPtr	curInsert;
-
-		INSERT_RECPTR(curInsert, Insert, Insert->curridx);
 		XLByteToSeg(curInsert, insert_logId, insert_logSeg);
 		XLByteToSeg(ControlFile->checkPointCopy.redo, redo_logId, redo_logSeg);
 		if (insert_logId == redo_logId &&
 			insert_logSeg == redo_logSeg)
 		{
-			LWLockRelease(WALInsertLock);
+			WALInsertLockRelease();
 			LWLockRelease(CheckpointLock);
 			END_CRIT_SECTION();
 			return;
@@ -7673,18 +8520,11 @@ CreateCheckPoint(int flags)
 	 * the buffer flush work.  Those XLOG records are logically after the
 	 * checkpoint, even though physically before it.  Got that?
 	 */
-	freespace = INSERT_FREESPACE(Insert);
-	if (freespace < SizeOfXLogRecord)
-	{
-		(void) AdvanceXLInsertBuffer(false);
-		/* OK to ignore update return flag, since we will do flush anyway */
-		freespace = INSERT_FREESPACE(Insert);
-	}
-	INSERT_RECPTR(checkPoint.redo, Insert, Insert->curridx);
+	checkPoint.redo = XLogRecordStartPos(curInsert);
 
 	/*
 	 * Here we update the shared RedoRecPtr for future XLogInsert calls; this
-	 * must be done while holding the insert lock AND the info_lck.
+	 * must be done while holding all the insertion locks AND the info_lck.
 	 *
 	 * Note: if we fail to complete the checkpoint, RedoRecPtr will be left
 	 * pointing past where it really needs to point.  This is okay; the only
@@ -7703,10 +8543,10 @@ CreateCheckPoint(int flags)
 	}
 
 	/*
-	 * Now we can release WAL insert lock, allowing other xacts to proceed
-	 * while we are flushing disk buffers.
+	 * Now we can release the WAL insertion locks, allowing other xacts to
+	 * proceed while we are flushing disk buffers.
 	 */
-	LWLockRelease(WALInsertLock);
+	WALInsertLockRelease();
 
 	/*
 	 * If enabled, log checkpoint start.  We postpone this until now so as not
@@ -7726,7 +8566,7 @@ CreateCheckPoint(int flags)
 	 * we wait till he's out of his commit critical section before proceeding.
 	 * See notes in RecordTransactionCommit().
 	 *
-	 * Because we've already released WALInsertLock, this test is a bit fuzzy:
+	 * Because we've already released the insertion locks, this test is a bit fuzzy:
 	 * it is possible that we will wait for xacts we didn't really need to
 	 * wait for.  But the delay should be short and it seems better to make
 	 * checkpoint take a bit longer than to hold locks longer than necessary.
@@ -8093,15 +8933,15 @@ CreateRestartPoint(int flags)
 	 * the number of segments replayed since last restartpoint, and request a
 	 * restartpoint if it exceeds checkpoint_segments.
 	 *
-	 * You need to hold WALInsertLock and info_lck to update it, although
-	 * during recovery acquiring WALInsertLock is just pro forma, because
-	 * there is no other processes updating Insert.RedoRecPtr.
+	 * You need to hold all WAL insertion locks and info_lck to update it,
+	 * although during recovery acquiring the insertion locks is just pro
+	 * forma, because there is no other processes updating Insert.RedoRecPtr.
 	 */
-	LWLockAcquire(WALInsertLock, LW_EXCLUSIVE);
+	WALInsertLockAcquireExclusive();
 	SpinLockAcquire(&xlogctl->info_lck);
 	xlogctl->Insert.RedoRecPtr = lastCheckPoint.redo;
 	SpinLockRelease(&xlogctl->info_lck);
-	LWLockRelease(WALInsertLock);
+	WALInsertLockRelease();
 
 	/*
 	 * Prepare to accumulate statistics.
@@ -8701,18 +9541,31 @@ xlog_outrec(StringInfo buf, XLogRecord *record)
 #endif   /* WAL_DEBUG */
 
 
+/*
+ * Return the O_DIRECT flag to open WAL segments with, if direct_io asks for
+ * that.  Never in the walreceiver, though, which performs unaligned writes.
+ */
+static int
+get_direct_bit(void)
+{
+	if ((direct_io & DIRECT_IO_WAL) && !am_walreceiver)
+		return PG_O_DIRECT;
+	return 0;
+}
+
 /*
  * Return the (possible) sync flag used for opening a file, depending on the
- * value of the GUC wal_sync_method.
+ * value of the GUC wal_sync_method.  This includes O_DIRECT if direct I/O
+ * was requested for WAL.
  */
 static int
 get_sync_bit(int method)
 {
-	int			o_direct_flag = 0;
+	int			o_direct_flag = get_direct_bit();
 
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return o_direct_flag;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -8742,7 +9595,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return get_direct_bit();
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
@@ -8795,6 +9648,7 @@ assign_xlog_sync_method(int new_sync_method, void *extra)
 void
 issue_xlog_fsync(int fd, uint32 log, uint32 seg)
 {
+	pgstat_report_wait_start(WAIT_EVENT_WAL_SYNC);
 	switch (sync_method)
 	{
 		case SYNC_METHOD_FSYNC:
@@ -8830,6 +9684,7 @@ issue_xlog_fsync(int fd, uint32 log, uint32 seg)
 			elog(PANIC, "unrecognized wal_sync_method: %d", sync_method);
 			break;
 	}
+	pgstat_report_wait_end();
 }
 
 /*
@@ -8905,15 +9760,15 @@ do_pg_start_backup(const char *backupidstr, bool fast, char **labelfile)
 	 * since we expect that any pages not modified during the backup interval
 	 * must have been correctly captured by the backup.)
 	 *
-	 * We must hold WALInsertLock to change the value of forcePageWrites, to
-	 * ensure adequate interlocking against XLogInsert().
+	 * We must hold all the insertion locks to change the value of
+	 * forcePageWrites, to ensure adequate interlocking against XLogInsert().
 	 */
-	LWLockAcquire(WALInsertLock, LW_EXCLUSIVE);
+	WALInsertLockAcquireExclusive();
 	if (exclusive)
 	{
 		if (XLogCtl->Insert.exclusiveBackup)
 		{
-			LWLockRelease(WALInsertLock);
+			WALInsertLockRelease();
 			ereport(ERROR,
 					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 					 errmsg("a backup is already in progress"),
@@ -8924,7 +9779,7 @@ do_pg_start_backup(const char *backupidstr, bool fast, char **labelfile)
 	else
 		XLogCtl->Insert.nonExclusiveBackups++;
 	XLogCtl->Insert.forcePageWrites = true;
-	LWLockRelease(WALInsertLock);
+	WALInsertLockRelease();
 
 	/* Ensure we release forcePageWrites if fail below */
 	PG_ENSURE_ERROR_CLEANUP(pg_start_backup_callback, (Datum) BoolGetDatum(exclusive));
@@ -8986,13 +9841,13 @@ do_pg_start_backup(const char *backupidstr, bool fast, char **labelfile)
 			 * taking a checkpoint right after another is not that expensive
 			 * either because only few buffers have been dirtied yet.
 			 */
-			LWLockAcquire(WALInsertLock, LW_SHARED);
+			WALInsertLockAcquireExclusive();
 			if (XLByteLT(XLogCtl->Insert.lastBackupStart, startpoint))
 			{
 				XLogCtl->Insert.lastBackupStart = startpoint;
 				gotUniqueStartpoint = true;
 			}
-			LWLockRelease(WALInsertLock);
+			WALInsertLockRelease();
 		} while (!gotUniqueStartpoint);
 
 		XLByteToSeg(startpoint, _logId, _logSeg);
@@ -9077,7 +9932,7 @@ pg_start_backup_callback(int code, Datum arg)
 	bool		exclusive = DatumGetBool(arg);
 
 	/* Update backup counters and forcePageWrites on failure */
-	LWLockAcquire(WALInsertLock, LW_EXCLUSIVE);
+	WALInsertLockAcquireExclusive();
 	if (exclusive)
 	{
 		Assert(XLogCtl->Insert.exclusiveBackup);
@@ -9094,7 +9949,7 @@ pg_start_backup_callback(int code, Datum arg)
 	{
 		XLogCtl->Insert.forcePageWrites = false;
 	}
-	LWLockRelease(WALInsertLock);
+	WALInsertLockRelease();
 }
 
 /*
@@ -9148,7 +10003,7 @@ do_pg_stop_backup(char *labelfile, bool waitforarchive)
 	/*
 	 * OK to update backup counters and forcePageWrites
 	 */
-	LWLockAcquire(WALInsertLock, LW_EXCLUSIVE);
+	WALInsertLockAcquireExclusive();
 	if (exclusive)
 		XLogCtl->Insert.exclusiveBackup = false;
 	else
@@ -9168,7 +10023,7 @@ do_pg_stop_backup(char *labelfile, bool waitforarchive)
 	{
 		XLogCtl->Insert.forcePageWrites = false;
 	}
-	LWLockRelease(WALInsertLock);
+	WALInsertLockRelease();
 
 	if (exclusive)
 	{
@@ -9370,7 +10225,7 @@ do_pg_stop_backup(char *labelfile, bool waitforarchive)
 void
 do_pg_abort_backup(void)
 {
-	LWLockAcquire(WALInsertLock, LW_EXCLUSIVE);
+	WALInsertLockAcquireExclusive();
 	Assert(XLogCtl->Insert.nonExclusiveBackups > 0);
 	XLogCtl->Insert.nonExclusiveBackups--;
 
@@ -9379,7 +10234,7 @@ do_pg_abort_backup(void)
 	{
 		XLogCtl->Insert.forcePageWrites = false;
 	}
-	LWLockRelease(WALInsertLock);
+	WALInsertLockRelease();
 }
 
 /*
@@ -9431,16 +10286,15 @@ GetStandbyFlushRecPtr(void)
  * Get latest WAL insert pointer
  */
 XLogRecPtr
-GetXLogInsertRecPtr(bool needlock)
+GetXLogInsertRecPtr(void)
 {
-	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	/* use volatile pointer to prevent code rearrangement */
+	volatile XLogCtlInsert *Insert = &XLogCtl->Insert;
 	XLogRecPtr	current_recptr;
 
-	if (needlock)
-		LWLockAcquire(WALInsertLock, LW_SHARED);
-	INSERT_RECPTR(current_recptr, Insert, Insert->curridx);
-	if (needlock)
-		LWLockRelease(WALInsertLock);
+	SpinLockAcquire(&Insert->insertpos_lck);
+	current_recptr = Insert->CurrPos;
+	SpinLockRelease(&Insert->insertpos_lck);
 
 	return current_recptr;
 }
@@ -9777,6 +10631,13 @@ retry:
 					if (CheckForStandbyTrigger())
 						goto retry;
 
+					/*
+					 * We're about to sleep anyway, so compress
+					 * KnownAssignedXids now, rather than while replaying.
+					 */
+					if (standbyState >= STANDBY_INITIALIZED)
+						KnownAssignedTransactionIdsIdleMaintenance();
+
 					/*
 					 * Wait for more WAL to arrive, or timeout to be reached
 					 */
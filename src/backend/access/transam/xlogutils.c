@@ -17,9 +17,14 @@
  */
 #include "postgres.h"
 
-#include "access/xlog.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/xlog_internal.h"
 #include "access/xlogutils.h"
 #include "catalog/catalog.h"
+#include "catalog/pg_control.h"
+#include "storage/fd.h"
 #include "storage/smgr.h"
 #include "utils/guc.h"
 #include "utils/hsearch.h"
@@ -472,3 +477,293 @@ XLogTruncateRelation(RelFileNode rnode, ForkNumber forkNum,
 {
 	forget_invalid_pages(rnode, forkNum, nblocks);
 }
+
+
+/*
+ * WAL prefetching
+ *
+ * Replay reads the pages that records modify one at a time, so on a large
+ * database it spends most of its time waiting for reads that could perfectly
+ * well have been issued in advance.  To help with that, the startup process
+ * calls XLogPrefetch before replaying each record; that looks at the WAL up
+ * to recovery_prefetch_distance kilobytes beyond the record, has the
+ * resource managers find the pages that the records there will read, and
+ * advises the kernel to start reading those that aren't in shared buffers
+ * already.
+ *
+ * All of this is merely advisory.  The look-ahead reads WAL segment files
+ * from pg_xlog on its own, doesn't verify CRCs, and requires only that each
+ * page header and prev-link looks right; whenever something doesn't (we're
+ * past the end of valid WAL, or the next segment hasn't arrived yet), it
+ * stops and tries again once replay has advanced.
+ */
+int			recovery_prefetch_distance = 0;
+
+/* number of recently prefetched blocks remembered to avoid repeat advice */
+#define PREFETCH_RECENT_BLOCKS	16
+
+typedef struct XLogPrefetchRecent
+{
+	RelFileNode node;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetchRecent;
+
+typedef struct XLogPrefetchState
+{
+	TimeLineID	tli;			/* timeline of the WAL we're reading */
+	uint64		nextPos;		/* end+1 of last record examined, or 0 */
+	XLogRecPtr	prevRec;		/* start of last record examined */
+	uint64		retryPos;		/* after a failure, wait for replay to
+								 * get past this */
+	int			fd;				/* open WAL segment, or -1 */
+	uint64		fdSegNo;		/* its segment number */
+	uint64		pagePos;		/* position of page in page[] */
+	bool		pageValid;		/* page[] holds a complete, valid page */
+	XLogPrefetchRecent recent[PREFETCH_RECENT_BLOCKS];
+	int			nextRecent;		/* next slot of recent[] to overwrite */
+} XLogPrefetchState;
+
+static XLogPrefetchState prefetch = {0, 0, {0, 0}, 0, -1};
+
+/* aligned buffer for the WAL page being looked at */
+static union
+{
+	XLogPageHeaderData hdr;
+	double		force_align;
+	char		data[XLOG_BLCKSZ];
+}			prefetchPage;
+
+/*
+ * XLogRecPtrs are awkward to do arithmetic on, so internally we use byte
+ * positions in the WAL stream, counting XLogFileSize bytes per log file.
+ */
+static uint64
+XLogPrefetchPos(XLogRecPtr ptr)
+{
+	return (uint64) ptr.xlogid * XLogFileSize + ptr.xrecoff;
+}
+
+static XLogRecPtr
+XLogPrefetchRecPtr(uint64 pos)
+{
+	XLogRecPtr	ptr;
+
+	ptr.xlogid = (uint32) (pos / XLogFileSize);
+	ptr.xrecoff = (uint32) (pos % XLogFileSize);
+	return ptr;
+}
+
+/*
+ * Read the WAL page starting at pagePos into prefetchPage, unless it's
+ * there already.  limitPos, if not zero, is the end of the WAL known to be
+ * valid; a page extending past it isn't kept for reuse, since its tail may
+ * not have been written yet.
+ */
+static bool
+XLogPrefetchReadPage(uint64 pagePos, uint64 limitPos)
+{
+	uint64		segno = pagePos / XLogSegSize;
+	XLogRecPtr	pageaddr;
+
+	if (prefetch.pageValid && prefetch.pagePos == pagePos)
+		return true;
+	prefetch.pageValid = false;
+
+	if (prefetch.fd < 0 || prefetch.fdSegNo != segno)
+	{
+		char		path[MAXPGPATH];
+
+		if (prefetch.fd >= 0)
+			close(prefetch.fd);
+		XLogFilePath(path, prefetch.tli,
+					 (uint32) (segno / XLogSegsPerFile),
+					 (uint32) (segno % XLogSegsPerFile));
+		prefetch.fd = BasicOpenFile(path, O_RDONLY | PG_BINARY, 0);
+		if (prefetch.fd < 0)
+			return false;
+		prefetch.fdSegNo = segno;
+	}
+
+	if (lseek(prefetch.fd, (off_t) (pagePos % XLogSegSize), SEEK_SET) < 0 ||
+		read(prefetch.fd, prefetchPage.data, XLOG_BLCKSZ) != XLOG_BLCKSZ)
+		return false;
+
+	/* Insist on a sane header for the page we expect */
+	pageaddr = XLogPrefetchRecPtr(pagePos);
+	if (prefetchPage.hdr.xlp_magic != XLOG_PAGE_MAGIC ||
+		!XLByteEQ(prefetchPage.hdr.xlp_pageaddr, pageaddr))
+		return false;
+
+	prefetch.pagePos = pagePos;
+	prefetch.pageValid = (limitPos == 0 || pagePos + XLOG_BLCKSZ <= limitPos);
+	return true;
+}
+
+/*
+ * Advise the kernel that the given page will be read soon by replay.
+ *
+ * This is for use by the rm_prefetch functions of resource managers, which
+ * are called for records that XLogPrefetch looks ahead at.  They get the
+ * record header and as much of the rmgr data as could be read at once, so
+ * must check that what they look at is within the length given.  They
+ * should skip pages that the record has a backup block for, or initializes
+ * from scratch, since those won't be read.
+ */
+void
+XLogPrefetchBlock(RelFileNode node, ForkNumber forknum, BlockNumber blkno)
+{
+	int			i;
+
+	/* Records often touch the same page as their predecessors */
+	for (i = 0; i < PREFETCH_RECENT_BLOCKS; i++)
+	{
+		if (prefetch.recent[i].blkno == blkno &&
+			prefetch.recent[i].forknum == forknum &&
+			RelFileNodeEquals(prefetch.recent[i].node, node))
+			return;
+	}
+	prefetch.recent[prefetch.nextRecent].node = node;
+	prefetch.recent[prefetch.nextRecent].forknum = forknum;
+	prefetch.recent[prefetch.nextRecent].blkno = blkno;
+	prefetch.nextRecent = (prefetch.nextRecent + 1) % PREFETCH_RECENT_BLOCKS;
+
+	PrefetchBufferWithoutRelcache(node, forknum, blkno);
+}
+
+/*
+ * Look ahead in the WAL from the record about to be replayed, which starts
+ * at replayRecPtr and ends at replayEndPtr, and prefetch the pages needed
+ * by the records to come.  tli is the timeline being replayed.  If limitPtr
+ * is valid, no WAL beyond it is to be looked at, because it may not have
+ * been received yet.
+ */
+void
+XLogPrefetch(XLogRecPtr replayRecPtr, XLogRecPtr replayEndPtr,
+			 XLogRecPtr limitPtr, TimeLineID tli)
+{
+	uint64		replayEndPos = XLogPrefetchPos(replayEndPtr);
+	uint64		limitPos = XLogPrefetchPos(limitPtr);
+	uint64		targetPos;
+
+	if (recovery_prefetch_distance <= 0)
+		return;
+
+	/*
+	 * Start over at the replay position if we haven't started yet, replay
+	 * has overtaken us, or we've moved to another timeline.
+	 */
+	if (prefetch.nextPos < replayEndPos || prefetch.tli != tli)
+	{
+		if (prefetch.tli != tli && prefetch.fd >= 0)
+		{
+			close(prefetch.fd);
+			prefetch.fd = -1;
+		}
+		prefetch.tli = tli;
+		prefetch.nextPos = replayEndPos;
+		prefetch.prevRec = replayRecPtr;
+		prefetch.pageValid = false;
+	}
+
+	/* After a failure, give the WAL some time to appear */
+	if (replayEndPos < prefetch.retryPos)
+		return;
+
+	targetPos = replayEndPos + (uint64) recovery_prefetch_distance * 1024;
+	if (limitPos != 0 && limitPos < targetPos)
+		targetPos = limitPos;
+
+	while (prefetch.nextPos < targetPos)
+	{
+		uint64		pos = prefetch.nextPos;
+		uint64		endPos;
+		uint32		pageOff;
+		uint32		avail;
+		uint32		datalen;
+		XLogRecord *record;
+
+		/* A record header never spans pages; skip to next page if need be */
+		if (XLOG_BLCKSZ - pos % XLOG_BLCKSZ < SizeOfXLogRecord)
+			pos += XLOG_BLCKSZ - pos % XLOG_BLCKSZ;
+
+		if (!XLogPrefetchReadPage(pos - pos % XLOG_BLCKSZ, limitPos))
+			goto stall;
+
+		pageOff = pos % XLOG_BLCKSZ;
+		if (pageOff == 0)
+		{
+			if (prefetchPage.hdr.xlp_info & XLP_FIRST_IS_CONTRECORD)
+				goto stall;
+			pageOff = XLogPageHeaderSize(&prefetchPage.hdr);
+			pos += pageOff;
+		}
+		else if (pageOff < XLogPageHeaderSize(&prefetchPage.hdr))
+			goto stall;
+
+		if (limitPos != 0 && pos + SizeOfXLogRecord > limitPos)
+			goto stall;
+
+		/* Check that it looks like the record we expect */
+		record = (XLogRecord *) (prefetchPage.data + pageOff);
+		if (!XLByteEQ(record->xl_prev, prefetch.prevRec) ||
+			record->xl_rmid > RM_MAX_ID ||
+			record->xl_tot_len < SizeOfXLogRecord + record->xl_len ||
+			record->xl_tot_len > SizeOfXLogRecord + record->xl_len +
+			XLR_MAX_BKP_BLOCKS * (sizeof(BkpBlock) + BLCKSZ))
+			goto stall;
+
+		/* Look at as much of the rmgr data as is on this page */
+		avail = XLOG_BLCKSZ - pageOff - SizeOfXLogRecord;
+		if (limitPos != 0 && pos + SizeOfXLogRecord + avail > limitPos)
+			avail = limitPos - (pos + SizeOfXLogRecord);
+		datalen = Min(record->xl_len, avail);
+		if (RmgrTable[record->xl_rmid].rm_prefetch != NULL)
+			RmgrTable[record->xl_rmid].rm_prefetch(record,
+									  (char *) record + SizeOfXLogRecord,
+												   datalen);
+
+		/*
+		 * Work out where the record ends.  The page headers on continuation
+		 * pages have a known size, so there's no need to read those pages.
+		 */
+		if (record->xl_rmid == RM_XLOG_ID && record->xl_info == XLOG_SWITCH)
+		{
+			/* the rest of the segment is unused */
+			endPos = pos - pos % XLogSegSize + XLogSegSize;
+		}
+		else if (record->xl_tot_len <= XLOG_BLCKSZ - pageOff)
+			endPos = pos + MAXALIGN(record->xl_tot_len);
+		else
+		{
+			uint32		remaining = record->xl_tot_len - (XLOG_BLCKSZ - pageOff);
+			uint64		pagePos = pos - pageOff;
+
+			for (;;)
+			{
+				uint32		hdrlen;
+				uint32		room;
+
+				pagePos += XLOG_BLCKSZ;
+				hdrlen = (pagePos % XLogSegSize == 0) ?
+					SizeOfXLogLongPHD : SizeOfXLogShortPHD;
+				room = XLOG_BLCKSZ - hdrlen - SizeOfXLogContRecord;
+				if (remaining <= room)
+				{
+					endPos = pagePos + hdrlen +
+						MAXALIGN(SizeOfXLogContRecord + remaining);
+					break;
+				}
+				remaining -= room;
+			}
+		}
+
+		prefetch.prevRec = XLogPrefetchRecPtr(pos);
+		prefetch.nextPos = endPos;
+	}
+	return;
+
+stall:
+	prefetch.retryPos = replayEndPos + XLOG_BLCKSZ;
+	prefetch.pageValid = false;
+}
@@ -289,6 +289,7 @@ Boot_DeclareIndexStmt:
 								$8,
 								NULL,
 								$10,
+								NIL,
 								NULL, NIL, NIL,
 								false, false, false, false, false,
 								false, false, true, false, false);
@@ -308,6 +309,7 @@ Boot_DeclareUniqueIndexStmt:
 								$9,
 								NULL,
 								$11,
+								NIL,
 								NULL, NIL, NIL,
 								true, false, false, false, false,
 								false, false, true, false, false);
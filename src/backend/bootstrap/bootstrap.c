@@ -138,7 +138,9 @@ static const struct typinfo TypInfo[] = {
 	{"_char", 1002, CHAROID, -1, false, 'i', 'x', InvalidOid,
 	F_ARRAY_IN, F_ARRAY_OUT},
 	{"_aclitem", 1034, ACLITEMOID, -1, false, 'i', 'x', InvalidOid,
-	F_ARRAY_IN, F_ARRAY_OUT}
+	F_ARRAY_IN, F_ARRAY_OUT},
+	{"anyarray", ANYARRAYOID, 0, -1, false, 'd', 'x', InvalidOid,
+	F_ANYARRAY_IN, F_ANYARRAY_OUT}
 };
 
 static const int n_types = sizeof(TypInfo) / sizeof(struct typinfo);
@@ -365,12 +365,14 @@ sub emit_pgattr_row
         attcacheoff   => '-1',
         atttypmod     => '-1',
         atthasdef     => 'f',
+        atthasmissing => 'f',
         attisdropped  => 'f',
         attislocal    => 't',
         attinhcount   => '0',
         attacl        => '_null_',
         attoptions    => '_null_',
-        attfdwoptions => '_null_'
+        attfdwoptions => '_null_',
+        attmissingval => '_null_'
     );
     return {%PGATTR_DEFAULTS, %row};
 }
@@ -402,6 +404,7 @@ sub emit_schemapg_row
     delete $row->{attacl};
     delete $row->{attoptions};
     delete $row->{attfdwoptions};
+    delete $row->{attmissingval};
 
     # Expand booleans from 'f'/'t' to 'false'/'true'.
     # Some values might be other macros (eg FLOAT4PASSBYVAL), don't change.
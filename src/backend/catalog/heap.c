@@ -37,6 +37,7 @@
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
+#include "catalog/partition.h"
 #include "catalog/pg_attrdef.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
@@ -44,6 +45,7 @@
 #include "catalog/pg_inherits.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_statistic.h"
+#include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_tablespace.h"
 #include "catalog/pg_type.h"
 #include "catalog/pg_type_fn.h"
@@ -60,6 +62,7 @@
 #include "storage/predicate.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
@@ -128,37 +131,37 @@ static List *insert_ordered_unique_oid(List *list, Oid datum);
 static FormData_pg_attribute a1 = {
 	0, {"ctid"}, TIDOID, 0, sizeof(ItemPointerData),
 	SelfItemPointerAttributeNumber, 0, -1, -1,
-	false, 'p', 's', true, false, false, true, 0
+	false, 'p', 's', true, false, false, false, true, 0
 };
 
 static FormData_pg_attribute a2 = {
 	0, {"oid"}, OIDOID, 0, sizeof(Oid),
 	ObjectIdAttributeNumber, 0, -1, -1,
-	true, 'p', 'i', true, false, false, true, 0
+	true, 'p', 'i', true, false, false, false, true, 0
 };
 
 static FormData_pg_attribute a3 = {
 	0, {"xmin"}, XIDOID, 0, sizeof(TransactionId),
 	MinTransactionIdAttributeNumber, 0, -1, -1,
-	true, 'p', 'i', true, false, false, true, 0
+	true, 'p', 'i', true, false, false, false, true, 0
 };
 
 static FormData_pg_attribute a4 = {
 	0, {"cmin"}, CIDOID, 0, sizeof(CommandId),
 	MinCommandIdAttributeNumber, 0, -1, -1,
-	true, 'p', 'i', true, false, false, true, 0
+	true, 'p', 'i', true, false, false, false, true, 0
 };
 
 static FormData_pg_attribute a5 = {
 	0, {"xmax"}, XIDOID, 0, sizeof(TransactionId),
 	MaxTransactionIdAttributeNumber, 0, -1, -1,
-	true, 'p', 'i', true, false, false, true, 0
+	true, 'p', 'i', true, false, false, false, true, 0
 };
 
 static FormData_pg_attribute a6 = {
 	0, {"cmax"}, CIDOID, 0, sizeof(CommandId),
 	MaxCommandIdAttributeNumber, 0, -1, -1,
-	true, 'p', 'i', true, false, false, true, 0
+	true, 'p', 'i', true, false, false, false, true, 0
 };
 
 /*
@@ -170,7 +173,7 @@ static FormData_pg_attribute a6 = {
 static FormData_pg_attribute a7 = {
 	0, {"tableoid"}, OIDOID, 0, sizeof(Oid),
 	TableOidAttributeNumber, 0, -1, -1,
-	true, 'p', 'i', true, false, false, true, 0
+	true, 'p', 'i', true, false, false, false, true, 0
 };
 
 static const Form_pg_attribute SysAtt[] = {&a1, &a2, &a3, &a4, &a5, &a6, &a7};
@@ -606,6 +609,7 @@ InsertPgAttributeTuple(Relation pg_attribute_rel,
 	values[Anum_pg_attribute_attalign - 1] = CharGetDatum(new_attribute->attalign);
 	values[Anum_pg_attribute_attnotnull - 1] = BoolGetDatum(new_attribute->attnotnull);
 	values[Anum_pg_attribute_atthasdef - 1] = BoolGetDatum(new_attribute->atthasdef);
+	values[Anum_pg_attribute_atthasmissing - 1] = BoolGetDatum(false);
 	values[Anum_pg_attribute_attisdropped - 1] = BoolGetDatum(new_attribute->attisdropped);
 	values[Anum_pg_attribute_attislocal - 1] = BoolGetDatum(new_attribute->attislocal);
 	values[Anum_pg_attribute_attinhcount - 1] = Int32GetDatum(new_attribute->attinhcount);
@@ -615,6 +619,8 @@ InsertPgAttributeTuple(Relation pg_attribute_rel,
 	nulls[Anum_pg_attribute_attacl - 1] = true;
 	nulls[Anum_pg_attribute_attoptions - 1] = true;
 	nulls[Anum_pg_attribute_attfdwoptions - 1] = true;
+	/* a new attribute has no missing value until StoreAttrDefault says so */
+	nulls[Anum_pg_attribute_attmissingval - 1] = true;
 
 	tup = heap_form_tuple(RelationGetDescr(pg_attribute_rel), values, nulls);
 
@@ -841,6 +847,7 @@ AddNewRelationTuple(Relation pg_class_desc,
 	switch (relkind)
 	{
 		case RELKIND_RELATION:
+		case RELKIND_MATVIEW:
 		case RELKIND_INDEX:
 		case RELKIND_TOASTVALUE:
 			/* The relation is real, but as yet empty */
@@ -864,6 +871,7 @@ AddNewRelationTuple(Relation pg_class_desc,
 
 	/* Initialize relfrozenxid */
 	if (relkind == RELKIND_RELATION ||
+		relkind == RELKIND_MATVIEW ||
 		relkind == RELKIND_TOASTVALUE)
 	{
 		/*
@@ -1063,7 +1071,8 @@ heap_create_with_catalog(const char *relname,
 		if (IsBinaryUpgrade &&
 			OidIsValid(binary_upgrade_next_heap_pg_class_oid) &&
 			(relkind == RELKIND_RELATION || relkind == RELKIND_SEQUENCE ||
-			 relkind == RELKIND_VIEW || relkind == RELKIND_COMPOSITE_TYPE ||
+			 relkind == RELKIND_VIEW || relkind == RELKIND_MATVIEW ||
+			 relkind == RELKIND_COMPOSITE_TYPE ||
 			 relkind == RELKIND_FOREIGN_TABLE))
 		{
 			relid = binary_upgrade_next_heap_pg_class_oid;
@@ -1090,6 +1099,7 @@ heap_create_with_catalog(const char *relname,
 		{
 			case RELKIND_RELATION:
 			case RELKIND_VIEW:
+			case RELKIND_MATVIEW:
 			case RELKIND_FOREIGN_TABLE:
 				relacl = get_user_default_acl(ACL_OBJECT_RELATION, ownerid,
 											  relnamespace);
@@ -1129,11 +1139,12 @@ heap_create_with_catalog(const char *relname,
 	 * Decide whether to create an array type over the relation's rowtype. We
 	 * do not create any array types for system catalogs (ie, those made
 	 * during initdb).	We create array types for regular relations, views,
-	 * composite types and foreign tables ... but not, eg, for toast tables or
-	 * sequences.
+	 * materialized views, composite types and foreign tables ... but not, eg,
+	 * for toast tables or sequences.
 	 */
 	if (IsUnderPostmaster && (relkind == RELKIND_RELATION ||
 							  relkind == RELKIND_VIEW ||
+							  relkind == RELKIND_MATVIEW ||
 							  relkind == RELKIND_FOREIGN_TABLE ||
 							  relkind == RELKIND_COMPOSITE_TYPE))
 		new_array_oid = AssignTypeArrayOid();
@@ -1355,7 +1366,11 @@ RelationRemoveInheritance(Oid relid)
 							  SnapshotNow, 1, &key);
 
 	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		/* The parent's partition descriptor includes this rel */
+		CacheInvalidateRelcacheByRelid(((Form_pg_inherits) GETSTRUCT(tuple))->inhparent);
 		simple_heap_delete(catalogRelation, &tuple->t_self);
+	}
 
 	systable_endscan(scan);
 	heap_close(catalogRelation, RowExclusiveLock);
@@ -1490,6 +1505,29 @@ RemoveAttributeById(Oid relid, AttrNumber attnum)
 		/* Remove any NOT NULL constraint the column may have */
 		attStruct->attnotnull = false;
 
+		/* Nor do we need its missing value */
+		if (attStruct->atthasmissing)
+		{
+			Datum		valuesAtt[Natts_pg_attribute];
+			bool		nullsAtt[Natts_pg_attribute];
+			bool		replacesAtt[Natts_pg_attribute];
+			HeapTuple	newtuple;
+
+			memset(valuesAtt, 0, sizeof(valuesAtt));
+			memset(nullsAtt, false, sizeof(nullsAtt));
+			memset(replacesAtt, false, sizeof(replacesAtt));
+
+			attStruct->atthasmissing = false;
+			nullsAtt[Anum_pg_attribute_attmissingval - 1] = true;
+			replacesAtt[Anum_pg_attribute_attmissingval - 1] = true;
+
+			newtuple = heap_modify_tuple(tuple, RelationGetDescr(attr_rel),
+										 valuesAtt, nullsAtt, replacesAtt);
+			heap_freetuple(tuple);
+			tuple = newtuple;
+			attStruct = (Form_pg_attribute) GETSTRUCT(tuple);
+		}
+
 		/* We don't want to keep stats for it anymore */
 		attStruct->attstattarget = 0;
 
@@ -1515,7 +1553,10 @@ RemoveAttributeById(Oid relid, AttrNumber attnum)
 	heap_close(attr_rel, RowExclusiveLock);
 
 	if (attnum > 0)
+	{
 		RemoveStatistics(relid, attnum);
+		RemoveExtStatistics(relid, attnum);
+	}
 
 	relation_close(rel, NoLock);
 }
@@ -1740,6 +1781,7 @@ heap_drop_with_catalog(Oid relid)
 	 * delete statistics
 	 */
 	RemoveStatistics(relid, 0);
+	RemoveExtStatistics(relid, 0);
 
 	/*
 	 * delete attribute tuples
@@ -1851,6 +1893,118 @@ StoreAttrDefault(Relation rel, AttrNumber attnum, Node *expr)
 	recordDependencyOnExpr(&defobject, expr, NIL, DEPENDENCY_NORMAL);
 }
 
+/*
+ * Store the missing value of column attnum of relation rel: the value that
+ * the rows stored before the column was added have for it.  This lets
+ * ALTER TABLE ADD COLUMN with a default skip rewriting the table, when the
+ * default is the same for every row.
+ *
+ * The caller must hold AccessExclusiveLock on rel.
+ */
+void
+StoreAttrMissingVal(Relation rel, AttrNumber attnum, Datum missingval)
+{
+	Relation	attrrel;
+	HeapTuple	atttup;
+	HeapTuple	newtup;
+	Form_pg_attribute attStruct;
+	ArrayType  *missingarray;
+	Datum		values[Natts_pg_attribute];
+	bool		nulls[Natts_pg_attribute];
+	bool		replace[Natts_pg_attribute];
+
+	attrrel = heap_open(AttributeRelationId, RowExclusiveLock);
+	atttup = SearchSysCache2(ATTNUM,
+							 ObjectIdGetDatum(RelationGetRelid(rel)),
+							 Int16GetDatum(attnum));
+	if (!HeapTupleIsValid(atttup))
+		elog(ERROR, "cache lookup failed for attribute %d of relation %u",
+			 attnum, RelationGetRelid(rel));
+	attStruct = (Form_pg_attribute) GETSTRUCT(atttup);
+
+	/* The value is kept as a one-element array of the column's type */
+	missingarray = construct_array(&missingval, 1,
+								   attStruct->atttypid,
+								   attStruct->attlen,
+								   attStruct->attbyval,
+								   attStruct->attalign);
+
+	memset(values, 0, sizeof(values));
+	memset(nulls, false, sizeof(nulls));
+	memset(replace, false, sizeof(replace));
+
+	values[Anum_pg_attribute_atthasmissing - 1] = BoolGetDatum(true);
+	replace[Anum_pg_attribute_atthasmissing - 1] = true;
+	values[Anum_pg_attribute_attmissingval - 1] = PointerGetDatum(missingarray);
+	replace[Anum_pg_attribute_attmissingval - 1] = true;
+
+	newtup = heap_modify_tuple(atttup, RelationGetDescr(attrrel),
+							   values, nulls, replace);
+	simple_heap_update(attrrel, &newtup->t_self, newtup);
+	CatalogUpdateIndexes(attrrel, newtup);
+
+	heap_freetuple(newtup);
+	ReleaseSysCache(atttup);
+	heap_close(attrrel, RowExclusiveLock);
+}
+
+/*
+ * Forget the missing values of all the columns of relation rel.  This is
+ * done once the table has been rewritten, as by CLUSTER, VACUUM FULL or
+ * ALTER TABLE, since then every row contains all of its columns.
+ *
+ * The caller must hold AccessExclusiveLock on rel.
+ */
+void
+RelationClearMissing(Relation rel)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	Relation	attrrel = NULL;
+	int			i;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		HeapTuple	atttup;
+		HeapTuple	newtup;
+		Datum		values[Natts_pg_attribute];
+		bool		nulls[Natts_pg_attribute];
+		bool		replace[Natts_pg_attribute];
+
+		if (!tupdesc->attrs[i]->atthasmissing)
+			continue;
+
+		if (attrrel == NULL)
+			attrrel = heap_open(AttributeRelationId, RowExclusiveLock);
+
+		atttup = SearchSysCache2(ATTNUM,
+								 ObjectIdGetDatum(RelationGetRelid(rel)),
+								 Int16GetDatum(i + 1));
+		if (!HeapTupleIsValid(atttup))
+			elog(ERROR, "cache lookup failed for attribute %d of relation %u",
+				 i + 1, RelationGetRelid(rel));
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, false, sizeof(nulls));
+		memset(replace, false, sizeof(replace));
+
+		values[Anum_pg_attribute_atthasmissing - 1] = BoolGetDatum(false);
+		replace[Anum_pg_attribute_atthasmissing - 1] = true;
+		nulls[Anum_pg_attribute_attmissingval - 1] = true;
+		replace[Anum_pg_attribute_attmissingval - 1] = true;
+
+		newtup = heap_modify_tuple(atttup, RelationGetDescr(attrrel),
+								   values, nulls, replace);
+		simple_heap_update(attrrel, &newtup->t_self, newtup);
+		CatalogUpdateIndexes(attrrel, newtup);
+
+		heap_freetuple(newtup);
+		ReleaseSysCache(atttup);
+	}
+
+	if (attrrel != NULL)
+		heap_close(attrrel, RowExclusiveLock);
+}
+
 /*
  * Store a check-constraint expression for the given relation.
  *
@@ -1945,6 +2099,9 @@ StoreRelCheck(Relation rel, char *ccname, Node *expr,
 						  inhcount,		/* coninhcount */
 						  is_only);		/* conisonly */
 
+	/* The rel's parents may partition on this constraint */
+	CacheInvalidatePartitionParents(RelationGetRelid(rel));
+
 	pfree(ccbin);
 	pfree(ccsrc);
 }
@@ -2575,6 +2732,50 @@ RemoveStatistics(Oid relid, AttrNumber attnum)
 }
 
 
+/*
+ * RemoveExtStatistics --- remove entries in pg_statistic_ext for a rel or
+ * column
+ *
+ * If attnum is zero, remove all column groups of rel; else remove only the
+ * groups that include that column.  Callers are changing the rel's catalog
+ * entries anyway, so we needn't send a relcache invalidation of our own.
+ */
+void
+RemoveExtStatistics(Oid relid, AttrNumber attnum)
+{
+	Relation	sd;
+	SysScanDesc scan;
+	ScanKeyData key;
+	HeapTuple	tuple;
+
+	sd = heap_open(StatisticExtRelationId, RowExclusiveLock);
+
+	ScanKeyInit(&key,
+				Anum_pg_statistic_ext_starelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+
+	scan = systable_beginscan(sd, StatisticExtRelidIndexId, true,
+							  SnapshotNow, 1, &key);
+
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_statistic_ext form = (Form_pg_statistic_ext) GETSTRUCT(tuple);
+		bool		match = (attnum == 0);
+		int			i;
+
+		for (i = 0; i < form->stakeys.dim1 && !match; i++)
+			match = (form->stakeys.values[i] == attnum);
+
+		if (match)
+			simple_heap_delete(sd, &tuple->t_self);
+	}
+
+	systable_endscan(scan);
+
+	heap_close(sd, RowExclusiveLock);
+}
+
 /*
  * RelationTruncateIndexes - truncate all indexes associated
  * with the heap relation to zero tuples.
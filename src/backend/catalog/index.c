@@ -41,6 +41,7 @@
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
 #include "catalog/storage.h"
+#include "commands/progress.h"
 #include "commands/tablecmds.h"
 #include "commands/trigger.h"
 #include "executor/executor.h"
@@ -49,6 +50,7 @@
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "parser/parser.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
@@ -200,10 +202,11 @@ index_check_primary_key(Relation heapRel,
 
 	/*
 	 * Check that all of the attributes in a primary key are marked as not
-	 * null, otherwise attempt to ALTER TABLE .. SET NOT NULL
+	 * null, otherwise attempt to ALTER TABLE .. SET NOT NULL.  INCLUDE
+	 * columns are not part of the key.
 	 */
 	cmds = NIL;
-	for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
+	for (i = 0; i < indexInfo->ii_NumIndexKeyAttrs; i++)
 	{
 		AttrNumber	attnum = indexInfo->ii_KeyAttrNumbers[i];
 		HeapTuple	atttuple;
@@ -417,6 +420,12 @@ ConstructTupleDescriptor(Relation heapRelation,
 		namestrcpy(&to->attname, (const char *) lfirst(colnames_item));
 		colnames_item = lnext(colnames_item);
 
+		/*
+		 * INCLUDE columns have no opclass, and are stored as they are.
+		 */
+		if (!OidIsValid(classObjectId[i]))
+			continue;
+
 		/*
 		 * Check the opclass and index AM to see if either provides a keytype
 		 * (overriding the attribute type).  Opclass takes precedence.
@@ -598,6 +607,7 @@ UpdateIndexRelation(Oid indexoid,
 	values[Anum_pg_index_indexrelid - 1] = ObjectIdGetDatum(indexoid);
 	values[Anum_pg_index_indrelid - 1] = ObjectIdGetDatum(heapoid);
 	values[Anum_pg_index_indnatts - 1] = Int16GetDatum(indexInfo->ii_NumIndexAttrs);
+	values[Anum_pg_index_indnkeyatts - 1] = Int16GetDatum(indexInfo->ii_NumIndexKeyAttrs);
 	values[Anum_pg_index_indisunique - 1] = BoolGetDatum(indexInfo->ii_Unique);
 	values[Anum_pg_index_indisprimary - 1] = BoolGetDatum(primary);
 	values[Anum_pg_index_indisexclusion - 1] = BoolGetDatum(isexclusion);
@@ -981,8 +991,8 @@ index_create(Relation heapRelation,
 			}
 		}
 
-		/* Store dependency on operator classes */
-		for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
+		/* Store dependency on operator classes of the key columns */
+		for (i = 0; i < indexInfo->ii_NumIndexKeyAttrs; i++)
 		{
 			referenced.classId = OperatorClassRelationId;
 			referenced.objectId = classObjectId[i];
@@ -1138,7 +1148,7 @@ index_constraint_create(Relation heapRelation,
 								   true,
 								   RelationGetRelid(heapRelation),
 								   indexInfo->ii_KeyAttrNumbers,
-								   indexInfo->ii_NumIndexAttrs,
+								   indexInfo->ii_NumIndexKeyAttrs,
 								   InvalidOid,	/* no domain */
 								   indexRelationId,		/* index OID */
 								   InvalidOid,	/* no foreign key */
@@ -1341,7 +1351,7 @@ index_drop(Oid indexId)
 	if (!HeapTupleIsValid(tuple))
 		elog(ERROR, "cache lookup failed for index %u", indexId);
 
-	hasexprs = !heap_attisnull(tuple, Anum_pg_index_indexprs);
+	hasexprs = !heap_attisnull(tuple, Anum_pg_index_indexprs, NULL);
 
 	simple_heap_delete(indexRelation, &tuple->t_self);
 
@@ -1409,6 +1419,9 @@ BuildIndexInfo(Relation index)
 		elog(ERROR, "invalid indnatts %d for index %u",
 			 numKeys, RelationGetRelid(index));
 	ii->ii_NumIndexAttrs = numKeys;
+	ii->ii_NumIndexKeyAttrs = indexStruct->indnkeyatts;
+	Assert(ii->ii_NumIndexKeyAttrs > 0 &&
+		   ii->ii_NumIndexKeyAttrs <= numKeys);
 	for (i = 0; i < numKeys; i++)
 		ii->ii_KeyAttrNumbers[i] = indexStruct->indkey.values[i];
 
@@ -1757,6 +1770,10 @@ index_build(Relation heapRelation,
 						   save_sec_context | SECURITY_RESTRICTED_OPERATION);
 	save_nestlevel = NewGUCNestLevel();
 
+	/* Report that the build is starting with its heap scan */
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_BUILD_SCAN);
+
 	/*
 	 * Call the access method's build procedure
 	 */
@@ -1888,6 +1905,29 @@ IndexBuildHeapScan(Relation heapRelation,
 				   bool allow_sync,
 				   IndexBuildCallback callback,
 				   void *callback_state)
+{
+	return IndexBuildHeapRangeScan(heapRelation, indexRelation,
+								   indexInfo, allow_sync,
+								   0, InvalidBlockNumber,
+								   callback, callback_state);
+}
+
+/*
+ * As above, except that only the given range of heap blocks is scanned
+ * (numblocks == InvalidBlockNumber means to the end of the relation).  An
+ * index build can use this to divide the heap into parts that are processed
+ * separately.  Since each block is visited by exactly one of the scans, HOT
+ * chains are never split between them.
+ */
+double
+IndexBuildHeapRangeScan(Relation heapRelation,
+						Relation indexRelation,
+						IndexInfo *indexInfo,
+						bool allow_sync,
+						BlockNumber start_blockno,
+						BlockNumber numblocks,
+						IndexBuildCallback callback,
+						void *callback_state)
 {
 	bool		is_system_catalog;
 	bool		checking_uniqueness;
@@ -1964,6 +2004,14 @@ IndexBuildHeapScan(Relation heapRelation,
 								true,	/* buffer access strategy OK */
 								allow_sync);	/* syncscan OK? */
 
+	/* set our scan endpoints, if a range was requested */
+	if (start_blockno != 0 || numblocks != InvalidBlockNumber)
+		heap_setscanlimits(scan, start_blockno, numblocks);
+
+	/* the block counts cover the whole heap, even for a range */
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_BLOCKS_TOTAL,
+								 scan->rs_nblocks);
+
 	reltuples = 0;
 
 	/*
@@ -2009,6 +2057,16 @@ IndexBuildHeapScan(Relation heapRelation,
 			LockBuffer(scan->rs_cbuf, BUFFER_LOCK_UNLOCK);
 
 			root_blkno = scan->rs_cblock;
+
+			/*
+			 * A synchronized scan may have started in the middle of the
+			 * heap, so count blocks from where it started.
+			 */
+			pgstat_progress_update_param(PROGRESS_CREATEIDX_BLOCKS_DONE,
+										 start_blockno +
+										 (scan->rs_cblock + scan->rs_nblocks -
+										  scan->rs_startblock) %
+										 scan->rs_nblocks + 1);
 		}
 
 		if (snapshot == SnapshotAny)
@@ -2605,6 +2663,9 @@ validate_index_heapscan(Relation heapRelation,
 								true,	/* buffer access strategy OK */
 								false); /* syncscan not OK */
 
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_BLOCKS_TOTAL,
+								 scan->rs_nblocks);
+
 	/*
 	 * Scan all tuples matching the snapshot.
 	 */
@@ -2643,6 +2704,11 @@ validate_index_heapscan(Relation heapRelation,
 			memset(in_index, 0, sizeof(in_index));
 
 			root_blkno = scan->rs_cblock;
+
+			pgstat_progress_update_param(PROGRESS_CREATEIDX_BLOCKS_DONE,
+										 (scan->rs_cblock + scan->rs_nblocks -
+										  scan->rs_startblock) %
+										 scan->rs_nblocks + 1);
 		}
 
 		/* Convert actual tuple TID to root TID */
@@ -2741,7 +2807,8 @@ validate_index_heapscan(Relation heapRelation,
 						 &rootTuple,
 						 heapRelation,
 						 indexInfo->ii_Unique ?
-						 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO);
+						 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO,
+						 false);
 
 			state->tups_inserted += 1;
 		}
@@ -3037,6 +3104,9 @@ reindex_relation(Oid relid, int flags)
 
 			CommandCounterIncrement();
 
+			/* CLUSTER and VACUUM FULL show how many indexes are done */
+			pgstat_progress_incr_param(PROGRESS_CLUSTER_INDEX_REBUILD_COUNT, 1);
+
 			/* Index should no longer be in the pending list */
 			Assert(!ReindexIsProcessingIndex(indexOid));
 
@@ -299,6 +299,7 @@ get_object_address(ObjectType objtype, List *objname, List *objargs,
 			case OBJECT_SEQUENCE:
 			case OBJECT_TABLE:
 			case OBJECT_VIEW:
+			case OBJECT_MATVIEW:
 			case OBJECT_FOREIGN_TABLE:
 				address =
 					get_relation_by_qualified_name(objtype, objname,
@@ -662,6 +663,13 @@ get_relation_by_qualified_name(ObjectType objtype, List *objname,
 						 errmsg("\"%s\" is not a view",
 								RelationGetRelationName(relation))));
 			break;
+		case OBJECT_MATVIEW:
+			if (relation->rd_rel->relkind != RELKIND_MATVIEW)
+				ereport(ERROR,
+						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+						 errmsg("\"%s\" is not a materialized view",
+								RelationGetRelationName(relation))));
+			break;
 		case OBJECT_FOREIGN_TABLE:
 			if (relation->rd_rel->relkind != RELKIND_FOREIGN_TABLE)
 				ereport(ERROR,
@@ -914,6 +922,7 @@ check_object_ownership(Oid roleid, ObjectType objtype, ObjectAddress address,
 		case OBJECT_SEQUENCE:
 		case OBJECT_TABLE:
 		case OBJECT_VIEW:
+		case OBJECT_MATVIEW:
 		case OBJECT_FOREIGN_TABLE:
 		case OBJECT_COLUMN:
 		case OBJECT_RULE:
@@ -0,0 +1,951 @@
+/*-------------------------------------------------------------------------
+ *
+ * partition.c
+ *	  Partition descriptors: the range bounds of an inheritance parent's
+ *	  children, derived from the children's CHECK constraints.
+ *
+ * Constraint exclusion must run predicate_refuted_by() against the
+ * constraints of every child of an inheritance parent, and lock every child
+ * first, which gets slow with thousands of children.  For the common
+ * layout in which each child holds one range of a key column, we instead
+ * keep the children's ranges sorted in the parent's relcache entry so that
+ * the planner can binary-search for the children a query can touch, and
+ * need not so much as lock the others.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/partition.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/nbtree.h"
+#include "catalog/indexing.h"
+#include "catalog/partition.h"
+#include "catalog/pg_constraint.h"
+#include "catalog/pg_inherits.h"
+#include "catalog/pg_inherits_fn.h"
+#include "catalog/pg_opclass.h"
+#include "commands/defrem.h"
+#include "optimizer/clauses.h"
+#include "optimizer/prep.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/tqual.h"
+
+
+/* A usable conjunct of a child's CHECK constraints */
+typedef struct KeyCondition
+{
+	AttrNumber	attno;			/* parent's column number */
+	int			strategy;		/* btree strategy, column on the left */
+	Datum		value;
+} KeyCondition;
+
+/* Working state for one child while building a descriptor */
+typedef struct ChildBounds
+{
+	Oid			relid;
+	List	   *conditions;		/* list of KeyCondition */
+	PartitionRange range;		/* range of the chosen key */
+	bool		bounded;		/* is the range of any use? */
+} ChildBounds;
+
+/* Per-column operator info of the parent, looked up as columns are seen */
+typedef struct KeyColumnInfo
+{
+	bool		valid;			/* has this entry been filled in? */
+	Oid			opfamily;		/* InvalidOid if column has no btree opclass */
+	Oid			opcintype;
+} KeyColumnInfo;
+
+static Node *strip_relabel(Node *node);
+static bool match_var_op_expr(Expr *clause, Index varno,
+				  Var **var, Expr **other, bool *commuted);
+static int	clause_strategy(OpExpr *opexpr, bool commuted, Oid opfamily,
+				Oid opcintype, Oid collation);
+static List *child_key_conditions(Relation parent, Oid childoid,
+					 KeyColumnInfo *columns);
+static void partition_range_search(PartitionDesc pdesc, PartitionRange *range,
+					   int *first, int *last);
+static bool partition_range_below(PartitionDesc pdesc,
+					  PartitionBound *upper, PartitionBound *lower);
+static bool partition_bound_equal(PartitionDesc pdesc, PartitionBound *b1,
+					  PartitionBound *b2);
+static bool parent_is_empty(Relation rel);
+static int	partition_lower_cmp(const void *a, const void *b, void *arg);
+static int	oid_cmp(const void *p1, const void *p2);
+
+
+/*
+ * RelationBuildPartitionDesc
+ *		Build the partition descriptor of an inheritance parent, and store it
+ *		in its relcache entry.
+ *
+ * rd_partdesc is left NULL if the children aren't laid out in usable ranges.
+ * Note that we look only at catalog rows and never open (or lock) the
+ * children; whatever changes their constraints or the set of children must
+ * invalidate the parent's relcache entry, see CacheInvalidatePartitionParents.
+ */
+void
+RelationBuildPartitionDesc(Relation rel)
+{
+	Oid			parentoid = RelationGetRelid(rel);
+	int			natts = RelationGetNumberOfAttributes(rel);
+	MemoryContext buildcxt;
+	MemoryContext partcxt;
+	MemoryContext oldcxt;
+	List	   *children;
+	ListCell   *lc;
+	ChildBounds *childbounds;
+	KeyColumnInfo *columns;
+	int		   *counts;
+	int			nchildren;
+	int			nbounded;
+	int			nunbounded;
+	AttrNumber	keyattno;
+	Form_pg_attribute keyatt;
+	Oid			cmpproc;
+	PartitionDesc pdesc;
+	int			i;
+
+	rel->rd_partdesc = NULL;
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		!rel->rd_rel->relhassubclass)
+		return;
+
+	/* Do all the work in a temporary context, and copy out the result */
+	buildcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "partition descriptor build",
+									 ALLOCSET_SMALL_MINSIZE,
+									 ALLOCSET_SMALL_INITSIZE,
+									 ALLOCSET_DEFAULT_MAXSIZE);
+	oldcxt = MemoryContextSwitchTo(buildcxt);
+
+	children = find_inheritance_children(parentoid, NoLock);
+	nchildren = list_length(children);
+
+	/*
+	 * Collect each child's usable constraint conjuncts, and count the
+	 * children that bound each of the parent's columns.
+	 */
+	childbounds = (ChildBounds *) palloc0(nchildren * sizeof(ChildBounds));
+	columns = (KeyColumnInfo *) palloc0((natts + 1) * sizeof(KeyColumnInfo));
+	counts = (int *) palloc0((natts + 1) * sizeof(int));
+
+	i = 0;
+	foreach(lc, children)
+	{
+		ChildBounds *cb = &childbounds[i++];
+		Bitmapset  *seen = NULL;
+		ListCell   *lc2;
+
+		cb->relid = lfirst_oid(lc);
+		cb->conditions = child_key_conditions(rel, cb->relid, columns);
+
+		foreach(lc2, cb->conditions)
+		{
+			KeyCondition *cond = (KeyCondition *) lfirst(lc2);
+
+			if (!bms_is_member(cond->attno, seen))
+			{
+				counts[cond->attno]++;
+				seen = bms_add_member(seen, cond->attno);
+			}
+		}
+	}
+
+	keyattno = InvalidAttrNumber;
+	for (i = 1; i <= natts; i++)
+	{
+		if (counts[i] > 0 && (keyattno == InvalidAttrNumber ||
+							  counts[i] > counts[keyattno]))
+			keyattno = i;
+	}
+
+	if (keyattno == InvalidAttrNumber)
+		goto done;
+
+	keyatt = rel->rd_att->attrs[keyattno - 1];
+	cmpproc = get_opfamily_proc(columns[keyattno].opfamily,
+								columns[keyattno].opcintype,
+								columns[keyattno].opcintype,
+								BTORDER_PROC);
+	if (!OidIsValid(cmpproc))
+		goto done;
+
+	/*
+	 * Set up the descriptor proper; it doesn't become visible to anyone
+	 * until we store it in the relcache entry at the end.
+	 */
+	partcxt = AllocSetContextCreate(CacheMemoryContext,
+									RelationGetRelationName(rel),
+									ALLOCSET_SMALL_MINSIZE,
+									ALLOCSET_SMALL_INITSIZE,
+									ALLOCSET_DEFAULT_MAXSIZE);
+	pdesc = (PartitionDesc) MemoryContextAllocZero(partcxt,
+												   sizeof(PartitionDescData));
+	pdesc->keyattno = keyattno;
+	pdesc->keytype = keyatt->atttypid;
+	pdesc->keycoll = keyatt->attcollation;
+	pdesc->opfamily = columns[keyattno].opfamily;
+	pdesc->opcintype = columns[keyattno].opcintype;
+	get_typlenbyval(pdesc->keytype, &pdesc->keytyplen, &pdesc->keytypbyval);
+	fmgr_info_cxt(cmpproc, &pdesc->cmpfn, partcxt);
+	pdesc->parentempty = parent_is_empty(rel);
+
+	/*
+	 * Work out each child's range of the key.  A child with no bound on it,
+	 * or whose constraints allow no non-null key at all, is unbounded; the
+	 * latter could hold only NULL keys, which no strict qual matches, but
+	 * it's not worth being clever about that.
+	 */
+	nbounded = 0;
+	nunbounded = 0;
+	for (i = 0; i < nchildren; i++)
+	{
+		ChildBounds *cb = &childbounds[i];
+		ListCell   *lc2;
+
+		cb->range.lower.infinite = true;
+		cb->range.upper.infinite = true;
+		foreach(lc2, cb->conditions)
+		{
+			KeyCondition *cond = (KeyCondition *) lfirst(lc2);
+
+			if (cond->attno == keyattno)
+				partition_range_restrict(pdesc, &cb->range,
+										 cond->strategy, cond->value);
+		}
+
+		if ((cb->range.lower.infinite && cb->range.upper.infinite) ||
+			partition_range_below(pdesc, &cb->range.upper, &cb->range.lower))
+			nunbounded++;
+		else
+		{
+			cb->bounded = true;
+			nbounded++;
+		}
+	}
+
+	pdesc->nbounded = nbounded;
+	pdesc->boundedoids = (Oid *) MemoryContextAlloc(partcxt,
+												(nbounded + 1) * sizeof(Oid));
+	pdesc->ranges = (PartitionRange *)
+		MemoryContextAlloc(partcxt, (nbounded + 1) * sizeof(PartitionRange));
+	pdesc->nunbounded = nunbounded;
+	pdesc->unboundedoids = (Oid *) MemoryContextAlloc(partcxt,
+											  (nunbounded + 1) * sizeof(Oid));
+
+	/*
+	 * Move the bounded children to the front of the array, and the OIDs of
+	 * the others to their own array; the latter stay in OID order.  Then
+	 * sort the bounded children by lower bound, and insist that each range
+	 * end before the next one begins.  If they overlap, a binary search
+	 * can't find all the matches, so don't build a descriptor at all.
+	 */
+	nbounded = 0;
+	nunbounded = 0;
+	for (i = 0; i < nchildren; i++)
+	{
+		if (childbounds[i].bounded)
+			childbounds[nbounded++] = childbounds[i];
+		else
+			pdesc->unboundedoids[nunbounded++] = childbounds[i].relid;
+	}
+
+	qsort_arg(childbounds, nbounded, sizeof(ChildBounds),
+			  partition_lower_cmp, pdesc);
+
+	for (i = 1; i < nbounded; i++)
+	{
+		if (!partition_range_below(pdesc, &childbounds[i - 1].range.upper,
+								   &childbounds[i].range.lower))
+		{
+			MemoryContextDelete(partcxt);
+			goto done;
+		}
+	}
+
+	MemoryContextSwitchTo(partcxt);
+	for (i = 0; i < nbounded; i++)
+	{
+		PartitionRange *dst = &pdesc->ranges[i];
+
+		pdesc->boundedoids[i] = childbounds[i].relid;
+		*dst = childbounds[i].range;
+		if (!dst->lower.infinite)
+			dst->lower.value = datumCopy(dst->lower.value,
+										 pdesc->keytypbyval,
+										 pdesc->keytyplen);
+		if (!dst->upper.infinite)
+			dst->upper.value = datumCopy(dst->upper.value,
+										 pdesc->keytypbyval,
+										 pdesc->keytyplen);
+	}
+
+	rel->rd_partcxt = partcxt;
+	rel->rd_partdesc = pdesc;
+
+done:
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(buildcxt);
+}
+
+/*
+ * copy_partition_desc
+ *		Copy a partition descriptor into the current memory context.
+ */
+PartitionDesc
+copy_partition_desc(PartitionDesc pdesc)
+{
+	PartitionDesc newdesc;
+	int			i;
+
+	newdesc = (PartitionDesc) palloc(sizeof(PartitionDescData));
+	memcpy(newdesc, pdesc, sizeof(PartitionDescData));
+	fmgr_info_copy(&newdesc->cmpfn, &pdesc->cmpfn, CurrentMemoryContext);
+
+	newdesc->boundedoids = (Oid *) palloc((pdesc->nbounded + 1) * sizeof(Oid));
+	memcpy(newdesc->boundedoids, pdesc->boundedoids,
+		   pdesc->nbounded * sizeof(Oid));
+	newdesc->ranges = (PartitionRange *)
+		palloc((pdesc->nbounded + 1) * sizeof(PartitionRange));
+	for (i = 0; i < pdesc->nbounded; i++)
+	{
+		PartitionRange *dst = &newdesc->ranges[i];
+
+		*dst = pdesc->ranges[i];
+		if (!dst->lower.infinite)
+			dst->lower.value = datumCopy(dst->lower.value,
+										 pdesc->keytypbyval,
+										 pdesc->keytyplen);
+		if (!dst->upper.infinite)
+			dst->upper.value = datumCopy(dst->upper.value,
+										 pdesc->keytypbyval,
+										 pdesc->keytyplen);
+	}
+	newdesc->unboundedoids = (Oid *)
+		palloc((pdesc->nunbounded + 1) * sizeof(Oid));
+	memcpy(newdesc->unboundedoids, pdesc->unboundedoids,
+		   pdesc->nunbounded * sizeof(Oid));
+
+	return newdesc;
+}
+
+/*
+ * child_key_conditions
+ *		Return the usable conjuncts of a child's CHECK constraints, as a list
+ *		of KeyCondition expressed in terms of the parent's columns.
+ *
+ * We consider only validated constraints that the child's own children
+ * must share, so that the result bounds the whole subtree.  'columns' caches
+ * the operator family lookups for the parent's columns across calls.
+ */
+static List *
+child_key_conditions(Relation parent, Oid childoid, KeyColumnInfo *columns)
+{
+	List	   *result = NIL;
+	Relation	conrel;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	htup;
+
+	ScanKeyInit(&skey,
+				Anum_pg_constraint_conrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(childoid));
+
+	conrel = heap_open(ConstraintRelationId, AccessShareLock);
+	scan = systable_beginscan(conrel, ConstraintRelidIndexId, true,
+							  SnapshotNow, 1, &skey);
+
+	while (HeapTupleIsValid(htup = systable_getnext(scan)))
+	{
+		Form_pg_constraint con = (Form_pg_constraint) GETSTRUCT(htup);
+		Datum		val;
+		bool		isnull;
+		Node	   *expr;
+		List	   *conjuncts;
+		ListCell   *lc;
+
+		if (con->contype != CONSTRAINT_CHECK || !con->convalidated ||
+			con->conisonly)
+			continue;
+
+		val = heap_getattr(htup, Anum_pg_constraint_conbin,
+						   RelationGetDescr(conrel), &isnull);
+		if (isnull)
+			elog(ERROR, "null conbin for constraint %u",
+				 HeapTupleGetOid(htup));
+
+		/* Fold any casts of the constants, as get_relation_constraints does */
+		expr = stringToNode(TextDatumGetCString(val));
+		expr = eval_const_expressions(NULL, expr);
+		conjuncts = make_ands_implicit(canonicalize_qual((Expr *) expr));
+
+		foreach(lc, conjuncts)
+		{
+			Expr	   *clause = (Expr *) lfirst(lc);
+			Var		   *var;
+			Expr	   *other;
+			Const	   *cst;
+			bool		commuted;
+			char	   *attname;
+			AttrNumber	attno;
+			KeyColumnInfo *col;
+			int			strategy;
+			KeyCondition *cond;
+
+			if (!match_var_op_expr(clause, 1, &var, &other, &commuted) ||
+				var->varattno <= 0)
+				continue;
+			cst = (Const *) strip_relabel((Node *) other);
+			if (!IsA(cst, Const) || cst->constisnull)
+				continue;
+
+			/* Map the child's column to the parent's by name */
+			attname = get_relid_attribute_name(childoid, var->varattno);
+			attno = get_attnum(RelationGetRelid(parent), attname);
+			if (attno <= 0)
+				continue;
+
+			col = &columns[attno];
+			if (!col->valid)
+			{
+				Oid			opclass;
+
+				opclass = GetDefaultOpClass(parent->rd_att->attrs[attno - 1]->atttypid,
+											BTREE_AM_OID);
+				if (OidIsValid(opclass))
+				{
+					col->opfamily = get_opclass_family(opclass);
+					col->opcintype = get_opclass_input_type(opclass);
+				}
+				col->valid = true;
+			}
+			if (!OidIsValid(col->opfamily))
+				continue;
+
+			strategy = clause_strategy((OpExpr *) clause, commuted,
+									   col->opfamily, col->opcintype,
+							  parent->rd_att->attrs[attno - 1]->attcollation);
+			if (strategy == 0)
+				continue;
+
+			cond = (KeyCondition *) palloc(sizeof(KeyCondition));
+			cond->attno = attno;
+			cond->strategy = strategy;
+			cond->value = cst->constvalue;
+			result = lappend(result, cond);
+		}
+	}
+
+	systable_endscan(scan);
+	heap_close(conrel, AccessShareLock);
+
+	return result;
+}
+
+/*
+ * partition_clause_match
+ *		Does 'clause' compare the key column of relation 'varno' to some other
+ *		expression, with one of the key's btree operators?
+ *
+ * If so, the other expression is returned in *other, and the result is the
+ * operator's strategy number, commuted if need be so that it applies with
+ * the column on the left.  Otherwise the result is zero.  It's up to the
+ * caller to decide whether it can evaluate *other.
+ */
+int
+partition_clause_match(PartitionDesc pdesc, Expr *clause, Index varno,
+					   Expr **other)
+{
+	Var		   *var;
+	bool		commuted;
+	int			strategy;
+
+	if (!match_var_op_expr(clause, varno, &var, other, &commuted) ||
+		var->varattno != pdesc->keyattno || var->varlevelsup != 0)
+		return 0;
+
+	strategy = clause_strategy((OpExpr *) clause, commuted, pdesc->opfamily,
+							   pdesc->opcintype, pdesc->keycoll);
+	return strategy;
+}
+
+/*
+ * partition_clause_strategy
+ *		As partition_clause_match, but the key must be compared to a non-null
+ *		constant, which is returned in *value.
+ *
+ * Constants must already have been folded.
+ */
+int
+partition_clause_strategy(PartitionDesc pdesc, Expr *clause, Index varno,
+						  Datum *value)
+{
+	Expr	   *other;
+	Const	   *cst;
+	int			strategy;
+
+	strategy = partition_clause_match(pdesc, clause, varno, &other);
+	if (strategy == 0)
+		return 0;
+
+	cst = (Const *) strip_relabel((Node *) other);
+	if (!IsA(cst, Const) || cst->constisnull)
+		return 0;
+
+	*value = cst->constvalue;
+	return strategy;
+}
+
+/*
+ * strip_relabel
+ *		Look through any binary-compatible relabeling of an expression.
+ */
+static Node *
+strip_relabel(Node *node)
+{
+	while (node && IsA(node, RelabelType))
+		node = (Node *) ((RelabelType *) node)->arg;
+	return node;
+}
+
+/*
+ * match_var_op_expr
+ *		Is 'clause' a binary operator with a Var of relation 'varno' (possibly
+ *		under binary-compatible relabeling) on one side?
+ *
+ * *other is set to the other argument, and *commuted is set true if that's
+ * on the left.
+ */
+static bool
+match_var_op_expr(Expr *clause, Index varno,
+				  Var **var, Expr **other, bool *commuted)
+{
+	Node	   *leftop;
+	Node	   *rightop;
+
+	if (!is_opclause(clause) || list_length(((OpExpr *) clause)->args) != 2)
+		return false;
+
+	leftop = strip_relabel(get_leftop(clause));
+	rightop = strip_relabel(get_rightop(clause));
+
+	if (IsA(leftop, Var) && ((Var *) leftop)->varno == varno)
+	{
+		*var = (Var *) leftop;
+		*other = (Expr *) get_rightop(clause);
+		*commuted = false;
+	}
+	else if (IsA(rightop, Var) && ((Var *) rightop)->varno == varno)
+	{
+		*var = (Var *) rightop;
+		*other = (Expr *) get_leftop(clause);
+		*commuted = true;
+	}
+	else
+		return false;
+
+	return true;
+}
+
+/*
+ * clause_strategy
+ *		Strategy number of a Var-vs-Const operator in the given opfamily,
+ *		with the Var on the left, or zero if the operator isn't usable.
+ */
+static int
+clause_strategy(OpExpr *opexpr, bool commuted, Oid opfamily, Oid opcintype,
+				Oid collation)
+{
+	int			strategy;
+	Oid			lefttype;
+	Oid			righttype;
+
+	if (!op_in_opfamily(opexpr->opno, opfamily) ||
+		opexpr->inputcollid != collation ||
+		!op_strict(opexpr->opno))
+		return 0;
+
+	get_op_opfamily_properties(opexpr->opno, opfamily, false,
+							   &strategy, &lefttype, &righttype);
+	if (lefttype != opcintype || righttype != opcintype)
+		return 0;
+
+	if (commuted)
+		strategy = BTCommuteStrategyNumber(strategy);
+
+	return strategy;
+}
+
+/*
+ * partition_range_restrict
+ *		Narrow a range by "key <op> value", where <op> has the strategy given.
+ *
+ * The range may end up pointing at 'value', so it must live as long as the
+ * range does.
+ */
+void
+partition_range_restrict(PartitionDesc pdesc, PartitionRange *range,
+						 int strategy, Datum value)
+{
+	bool		lower = false;
+	bool		upper = false;
+	bool		inclusive = false;
+	int32		cmp = 0;
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			upper = true;
+			break;
+		case BTLessEqualStrategyNumber:
+			upper = inclusive = true;
+			break;
+		case BTEqualStrategyNumber:
+			lower = upper = inclusive = true;
+			break;
+		case BTGreaterEqualStrategyNumber:
+			lower = inclusive = true;
+			break;
+		case BTGreaterStrategyNumber:
+			lower = true;
+			break;
+		default:
+			elog(ERROR, "unrecognized btree strategy number: %d", strategy);
+	}
+
+	if (lower)
+	{
+		if (!range->lower.infinite)
+			cmp = DatumGetInt32(FunctionCall2Coll(&pdesc->cmpfn,
+												  pdesc->keycoll,
+												  value,
+												  range->lower.value));
+		if (range->lower.infinite || cmp > 0 ||
+			(cmp == 0 && !inclusive))
+		{
+			range->lower.value = value;
+			range->lower.infinite = false;
+			range->lower.inclusive = inclusive;
+		}
+	}
+	if (upper)
+	{
+		if (!range->upper.infinite)
+			cmp = DatumGetInt32(FunctionCall2Coll(&pdesc->cmpfn,
+												  pdesc->keycoll,
+												  value,
+												  range->upper.value));
+		if (range->upper.infinite || cmp < 0 ||
+			(cmp == 0 && !inclusive))
+		{
+			range->upper.value = value;
+			range->upper.infinite = false;
+			range->upper.inclusive = inclusive;
+		}
+	}
+}
+
+/*
+ * get_partitions_in_range
+ *		Return the OIDs of the children that may hold keys in the range,
+ *		sorted by OID as find_inheritance_children does.
+ *
+ * The unbounded children are always included.  The result is palloc'd in
+ * the caller's context, so it may outlive the descriptor.
+ */
+List *
+get_partitions_in_range(PartitionDesc pdesc, PartitionRange *range)
+{
+	Oid		   *oidarr;
+	int			numoids = 0;
+	List	   *result = NIL;
+	int			first;
+	int			last;
+	int			i;
+
+	oidarr = (Oid *) palloc((pdesc->nbounded + pdesc->nunbounded + 1) *
+							sizeof(Oid));
+
+	partition_range_search(pdesc, range, &first, &last);
+	for (i = first; i < last; i++)
+		oidarr[numoids++] = pdesc->boundedoids[i];
+	for (i = 0; i < pdesc->nunbounded; i++)
+		oidarr[numoids++] = pdesc->unboundedoids[i];
+
+	if (numoids > 1)
+		qsort(oidarr, numoids, sizeof(Oid), oid_cmp);
+
+	for (i = 0; i < numoids; i++)
+		result = lappend_oid(result, oidarr[i]);
+
+	pfree(oidarr);
+
+	return result;
+}
+
+/*
+ * get_partitions_excluded_by_range
+ *		Return the OIDs of the bounded children that can't hold any key in
+ *		the range, as a palloc'd array sorted by OID, and their number in
+ *		*nexcluded.
+ *
+ * This is the complement of get_partitions_in_range, for callers that
+ * already have all the children and want to know which to skip.
+ */
+Oid *
+get_partitions_excluded_by_range(PartitionDesc pdesc, PartitionRange *range,
+								 int *nexcluded)
+{
+	Oid		   *oidarr;
+	int			numoids = 0;
+	int			first;
+	int			last;
+	int			i;
+
+	oidarr = (Oid *) palloc((pdesc->nbounded + 1) * sizeof(Oid));
+
+	partition_range_search(pdesc, range, &first, &last);
+	for (i = 0; i < first; i++)
+		oidarr[numoids++] = pdesc->boundedoids[i];
+	for (i = last; i < pdesc->nbounded; i++)
+		oidarr[numoids++] = pdesc->boundedoids[i];
+
+	if (numoids > 1)
+		qsort(oidarr, numoids, sizeof(Oid), oid_cmp);
+
+	*nexcluded = numoids;
+	return oidarr;
+}
+
+/*
+ * partition_bounds_equal
+ *		Are two parents partitioned alike, that is, on keys of the same type
+ *		and collation, into the same ranges?
+ *
+ * If so, and the keys are equated by an operator of the common opfamily, a
+ * row of the i'th bounded child of one can only match rows of the i'th
+ * bounded child of the other.  The key columns needn't be the same, nor the
+ * children's OIDs; the unbounded children are the caller's concern.
+ */
+bool
+partition_bounds_equal(PartitionDesc pdesc1, PartitionDesc pdesc2)
+{
+	int			i;
+
+	if (pdesc1->keytype != pdesc2->keytype ||
+		pdesc1->keycoll != pdesc2->keycoll ||
+		pdesc1->opfamily != pdesc2->opfamily ||
+		pdesc1->nbounded != pdesc2->nbounded)
+		return false;
+
+	for (i = 0; i < pdesc1->nbounded; i++)
+	{
+		PartitionRange *r1 = &pdesc1->ranges[i];
+		PartitionRange *r2 = &pdesc2->ranges[i];
+
+		if (!partition_bound_equal(pdesc1, &r1->lower, &r2->lower) ||
+			!partition_bound_equal(pdesc1, &r1->upper, &r2->upper))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * partition_bound_equal
+ *		Are two bounds of the same end of a range equal?
+ */
+static bool
+partition_bound_equal(PartitionDesc pdesc, PartitionBound *b1,
+					  PartitionBound *b2)
+{
+	if (b1->infinite || b2->infinite)
+		return b1->infinite == b2->infinite;
+	if (b1->inclusive != b2->inclusive)
+		return false;
+	return DatumGetInt32(FunctionCall2Coll(&pdesc->cmpfn, pdesc->keycoll,
+										   b1->value, b2->value)) == 0;
+}
+
+/*
+ * parent_is_empty
+ *		Does one of the relation's own CHECK constraints reduce to FALSE?
+ */
+static bool
+parent_is_empty(Relation rel)
+{
+	TupleConstr *constr = rel->rd_att->constr;
+	int			i;
+
+	if (constr == NULL)
+		return false;
+
+	for (i = 0; i < constr->num_check; i++)
+	{
+		ConstrCheck *check = &constr->check[i];
+		Node	   *expr;
+
+		if (!check->ccvalid)
+			continue;
+
+		expr = eval_const_expressions(NULL, stringToNode(check->ccbin));
+		if (IsA(expr, Const) &&
+			!((Const *) expr)->constisnull &&
+			!DatumGetBool(((Const *) expr)->constvalue))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * partition_range_search
+ *		Find the bounded children whose ranges overlap the given range; they
+ *		are those from *first up to but not including *last.
+ */
+static void
+partition_range_search(PartitionDesc pdesc, PartitionRange *range,
+					   int *first, int *last)
+{
+	int			lo = 0;
+	int			hi = pdesc->nbounded;
+	int			i;
+
+	if (partition_range_below(pdesc, &range->upper, &range->lower))
+	{
+		/* the range is empty */
+		*first = *last = 0;
+		return;
+	}
+
+	/*
+	 * Find the first child whose range doesn't end below ours; the ranges
+	 * don't overlap, so their upper bounds are in order too.  Then take
+	 * children until one begins above our range.
+	 */
+	while (lo < hi)
+	{
+		int			mid = (lo + hi) / 2;
+
+		if (partition_range_below(pdesc, &pdesc->ranges[mid].upper,
+								  &range->lower))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (i = lo; i < pdesc->nbounded; i++)
+	{
+		if (partition_range_below(pdesc, &range->upper,
+								  &pdesc->ranges[i].lower))
+			break;
+	}
+
+	*first = lo;
+	*last = i;
+}
+
+/*
+ * partition_range_below
+ *		Does every key satisfying 'upper' sort before every key satisfying
+ *		'lower'?  That is, does a range ending at 'upper' end before one
+ *		beginning at 'lower' begins?
+ */
+static bool
+partition_range_below(PartitionDesc pdesc,
+					  PartitionBound *upper, PartitionBound *lower)
+{
+	int32		cmp;
+
+	if (upper->infinite || lower->infinite)
+		return false;
+
+	cmp = DatumGetInt32(FunctionCall2Coll(&pdesc->cmpfn, pdesc->keycoll,
+										  upper->value, lower->value));
+	return cmp < 0 || (cmp == 0 && !(upper->inclusive && lower->inclusive));
+}
+
+/*
+ * qsort_arg comparator for ChildBounds, by lower bound
+ */
+static int
+partition_lower_cmp(const void *a, const void *b, void *arg)
+{
+	const PartitionBound *la = &((const ChildBounds *) a)->range.lower;
+	const PartitionBound *lb = &((const ChildBounds *) b)->range.lower;
+	PartitionDesc pdesc = (PartitionDesc) arg;
+	int32		cmp;
+
+	if (la->infinite || lb->infinite)
+		return (int) lb->infinite - (int) la->infinite;
+
+	cmp = DatumGetInt32(FunctionCall2Coll(&pdesc->cmpfn, pdesc->keycoll,
+										  la->value, lb->value));
+	if (cmp != 0)
+		return cmp;
+	return (int) lb->inclusive - (int) la->inclusive;
+}
+
+/*
+ * CacheInvalidatePartitionParents
+ *		Invalidate the relcache entries of a relation's inheritance parents.
+ *
+ * A parent's partition descriptor depends on its children's CHECK
+ * constraints, so whatever changes those must call this as well as
+ * invalidating the child itself.  Changes to the set of children must
+ * similarly invalidate the parent.
+ */
+void
+CacheInvalidatePartitionParents(Oid relid)
+{
+	Relation	inhrel;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	htup;
+
+	ScanKeyInit(&skey,
+				Anum_pg_inherits_inhrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(relid));
+
+	inhrel = heap_open(InheritsRelationId, AccessShareLock);
+	scan = systable_beginscan(inhrel, InheritsRelidSeqnoIndexId, true,
+							  SnapshotNow, 1, &skey);
+
+	while (HeapTupleIsValid(htup = systable_getnext(scan)))
+		CacheInvalidateRelcacheByRelid(((Form_pg_inherits) GETSTRUCT(htup))->inhparent);
+
+	systable_endscan(scan);
+	heap_close(inhrel, AccessShareLock);
+}
+
+/* qsort comparison function for OIDs */
+static int
+oid_cmp(const void *p1, const void *p2)
+{
+	Oid			v1 = *((const Oid *) p1);
+	Oid			v2 = *((const Oid *) p2);
+
+	if (v1 < v2)
+		return -1;
+	if (v1 > v2)
+		return 1;
+	return 0;
+}
@@ -48,6 +48,8 @@ AggregateCreate(const char *aggName,
 				int numArgs,
 				List *aggtransfnName,
 				List *aggfinalfnName,
+				List *aggcombinefnName,
+				List *agginvtransfnName,
 				List *aggsortopName,
 				Oid aggTransType,
 				const char *agginitval)
@@ -59,6 +61,8 @@ AggregateCreate(const char *aggName,
 	Form_pg_proc proc;
 	Oid			transfn;
 	Oid			finalfn = InvalidOid;	/* can be omitted */
+	Oid			combinefn = InvalidOid; /* can be omitted */
+	Oid			invtransfn = InvalidOid;	/* can be omitted */
 	Oid			sortop = InvalidOid;	/* can be omitted */
 	bool		hasPolyArg;
 	bool		hasInternalArg;
@@ -189,6 +193,50 @@ AggregateCreate(const char *aggName,
 				 errmsg("unsafe use of pseudo-type \"internal\""),
 				 errdetail("A function returning \"internal\" must have at least one \"internal\" argument.")));
 
+	/*
+	 * Handle combinefn, if supplied.  It merges two transition states into
+	 * one, so it must take two arguments of the transition type and return
+	 * that type.
+	 */
+	if (aggcombinefnName)
+	{
+		Oid			combineArgs[2];
+		Oid			combinetype;
+
+		combineArgs[0] = aggTransType;
+		combineArgs[1] = aggTransType;
+		combinefn = lookup_agg_function(aggcombinefnName, 2, combineArgs,
+										&combinetype);
+
+		if (combinetype != aggTransType)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("return type of combine function %s is not %s",
+							NameListToString(aggcombinefnName),
+							format_type_be(aggTransType))));
+	}
+
+	/*
+	 * Handle invtransfn, if supplied.  It removes an input row from the
+	 * transition state, so it takes the same arguments as the transfn and
+	 * must return the transition type too.
+	 */
+	if (agginvtransfnName)
+	{
+		Oid			invtranstype;
+
+		fnArgs[0] = aggTransType;
+		invtransfn = lookup_agg_function(agginvtransfnName, nargs_transfn,
+										 fnArgs, &invtranstype);
+
+		if (invtranstype != aggTransType)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("return type of inverse transition function %s is not %s",
+							NameListToString(agginvtransfnName),
+							format_type_be(aggTransType))));
+	}
+
 	/* handle sortop, if supplied */
 	if (aggsortopName)
 	{
@@ -267,6 +315,8 @@ AggregateCreate(const char *aggName,
 	values[Anum_pg_aggregate_aggfnoid - 1] = ObjectIdGetDatum(procOid);
 	values[Anum_pg_aggregate_aggtransfn - 1] = ObjectIdGetDatum(transfn);
 	values[Anum_pg_aggregate_aggfinalfn - 1] = ObjectIdGetDatum(finalfn);
+	values[Anum_pg_aggregate_aggcombinefn - 1] = ObjectIdGetDatum(combinefn);
+	values[Anum_pg_aggregate_agginvtransfn - 1] = ObjectIdGetDatum(invtransfn);
 	values[Anum_pg_aggregate_aggsortop - 1] = ObjectIdGetDatum(sortop);
 	values[Anum_pg_aggregate_aggtranstype - 1] = ObjectIdGetDatum(aggTransType);
 	if (agginitval)
@@ -308,6 +358,24 @@ AggregateCreate(const char *aggName,
 		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
 	}
 
+	/* Depends on combine function, if any */
+	if (OidIsValid(combinefn))
+	{
+		referenced.classId = ProcedureRelationId;
+		referenced.objectId = combinefn;
+		referenced.objectSubId = 0;
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+	}
+
+	/* Depends on inverse transition function, if any */
+	if (OidIsValid(invtransfn))
+	{
+		referenced.classId = ProcedureRelationId;
+		referenced.objectId = invtransfn;
+		referenced.objectSubId = 0;
+		recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+	}
+
 	/* Depends on sort operator, if any */
 	if (OidIsValid(sortop))
 	{
@@ -319,7 +387,8 @@ AggregateCreate(const char *aggName,
 }
 
 /*
- * lookup_agg_function -- common code for finding both transfn and finalfn
+ * lookup_agg_function -- common code for finding transfn, finalfn,
+ * combinefn and invtransfn
  */
 static Oid
 lookup_agg_function(List *fnName,
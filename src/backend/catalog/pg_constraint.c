@@ -19,6 +19,7 @@
 #include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/objectaccess.h"
+#include "catalog/partition.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_type.h"
@@ -584,6 +585,9 @@ RemoveConstraintById(Oid conId)
 			heap_freetuple(relTup);
 
 			heap_close(pgrel, RowExclusiveLock);
+
+			/* The rel's parents may have been partitioning on it, too */
+			CacheInvalidatePartitionParents(con->conrelid);
 		}
 
 		/* Keep lock on constraint's rel until end of xact */
@@ -153,6 +153,12 @@ CREATE VIEW pg_locks AS
 CREATE VIEW pg_cursors AS
     SELECT * FROM pg_cursor() AS C;
 
+CREATE VIEW pg_backend_memory_contexts AS
+    SELECT * FROM pg_get_backend_memory_contexts();
+
+REVOKE ALL ON pg_backend_memory_contexts FROM PUBLIC;
+REVOKE EXECUTE ON FUNCTION pg_get_backend_memory_contexts() FROM PUBLIC;
+
 CREATE VIEW pg_available_extensions AS
     SELECT E.name, E.default_version, X.extversion AS installed_version,
            E.comment
@@ -531,6 +537,8 @@ CREATE VIEW pg_stat_activity AS
             S.xact_start,
             S.query_start,
             S.waiting,
+            S.wait_event_type,
+            S.wait_event,
             S.current_query
     FROM pg_database D, pg_stat_get_activity(NULL) AS S, pg_authid U
     WHERE S.datid = D.oid AND
@@ -574,6 +582,12 @@ CREATE VIEW pg_stat_database AS
             pg_stat_get_db_tuples_updated(D.oid) AS tup_updated,
             pg_stat_get_db_tuples_deleted(D.oid) AS tup_deleted,
             pg_stat_get_db_conflict_all(D.oid) AS conflicts,
+            pg_stat_get_db_temp_files(D.oid) AS temp_files,
+            pg_stat_get_db_temp_bytes(D.oid) AS temp_bytes,
+            pg_stat_get_db_blk_read_time(D.oid) AS blk_read_time,
+            pg_stat_get_db_blk_write_time(D.oid) AS blk_write_time,
+            pg_stat_get_db_ssl_handshakes(D.oid) AS ssl_handshakes,
+            pg_stat_get_db_ssl_resumptions(D.oid) AS ssl_resumptions,
             pg_stat_get_db_stat_reset_time(D.oid) AS stats_reset
     FROM pg_database D;
 
@@ -624,6 +638,80 @@ CREATE VIEW pg_stat_bgwriter AS
         pg_stat_get_buf_alloc() AS buffers_alloc,
         pg_stat_get_bgwriter_stat_reset_time() AS stats_reset;
 
+CREATE VIEW pg_stat_lwlocks AS
+    SELECT
+            L.lock_name,
+            L.acquisitions,
+            L.contended,
+            L.spin_delays,
+            L.wait_time
+    FROM pg_stat_get_lwlocks() AS L;
+
+CREATE VIEW pg_stat_progress_vacuum AS
+    SELECT
+        S.pid AS pid, S.datid AS datid, D.datname AS datname,
+        S.relid AS relid,
+        CASE WHEN S.param1 = 0 THEN 'initializing'
+             WHEN S.param1 = 1 THEN 'scanning heap'
+             WHEN S.param1 = 2 THEN 'vacuuming indexes'
+             WHEN S.param1 = 3 THEN 'vacuuming heap'
+             WHEN S.param1 = 4 THEN 'cleaning up indexes'
+             WHEN S.param1 = 5 THEN 'truncating heap'
+             WHEN S.param1 = 6 THEN 'performing final cleanup'
+             END AS phase,
+        S.param2 AS heap_blks_total, S.param3 AS heap_blks_scanned,
+        S.param4 AS heap_blks_vacuumed, S.param5 AS index_vacuum_count,
+        S.param6 AS max_dead_tuple_bytes, S.param7 AS num_dead_tuples,
+        S.param8 AS delay_time
+    FROM pg_stat_get_progress_info('VACUUM') AS S
+        LEFT JOIN pg_database D ON S.datid = D.oid;
+
+CREATE VIEW pg_stat_progress_cluster AS
+    SELECT
+        S.pid AS pid,
+        S.datid AS datid,
+        D.datname AS datname,
+        S.relid AS relid,
+        CASE WHEN S.param1 = 1 THEN 'CLUSTER'
+             WHEN S.param1 = 2 THEN 'VACUUM FULL'
+             END AS command,
+        CASE WHEN S.param2 = 0 THEN 'initializing'
+             WHEN S.param2 = 1 THEN 'seq scanning heap'
+             WHEN S.param2 = 2 THEN 'index scanning heap'
+             WHEN S.param2 = 3 THEN 'sorting tuples'
+             WHEN S.param2 = 4 THEN 'writing new heap'
+             WHEN S.param2 = 5 THEN 'swapping relation files'
+             WHEN S.param2 = 6 THEN 'rebuilding index'
+             WHEN S.param2 = 7 THEN 'performing final cleanup'
+             END AS phase,
+        CAST(S.param3 AS oid) AS cluster_index_relid,
+        S.param4 AS heap_tuples_scanned,
+        S.param5 AS heap_tuples_written,
+        S.param6 AS heap_blks_total,
+        S.param7 AS heap_blks_scanned,
+        S.param9 AS index_rebuild_count
+    FROM pg_stat_get_progress_info('CLUSTER') AS S
+        LEFT JOIN pg_database D ON S.datid = D.oid;
+
+CREATE VIEW pg_stat_progress_create_index AS
+    SELECT
+        S.pid AS pid, S.datid AS datid, D.datname AS datname,
+        S.relid AS relid,
+        CAST(S.param10 AS oid) AS index_relid,
+        CASE WHEN S.param11 = 0 THEN 'initializing'
+             WHEN S.param11 = 1 THEN 'building index: scanning table'
+             WHEN S.param11 = 2 THEN 'building index: sorting'
+             WHEN S.param11 = 3 THEN 'building index: loading tuples'
+             WHEN S.param11 = 4 THEN 'waiting for transactions'
+             WHEN S.param11 = 5 THEN 'validating index'
+             END AS phase,
+        S.param12 AS blocks_total,
+        S.param13 AS blocks_done,
+        S.param14 AS tuples_total,
+        S.param15 AS tuples_done
+    FROM pg_stat_get_progress_info('CREATE INDEX') AS S
+        LEFT JOIN pg_database D ON S.datid = D.oid;
+
 CREATE VIEW pg_user_mappings AS
     SELECT
         U.oid       AS umid,
@@ -53,6 +53,8 @@ DefineAggregate(List *name, List *args, bool oldstyle, List *parameters)
 	AclResult	aclresult;
 	List	   *transfuncName = NIL;
 	List	   *finalfuncName = NIL;
+	List	   *combinefuncName = NIL;
+	List	   *invfuncName = NIL;
 	List	   *sortoperatorName = NIL;
 	TypeName   *baseType = NULL;
 	TypeName   *transType = NULL;
@@ -85,6 +87,10 @@ DefineAggregate(List *name, List *args, bool oldstyle, List *parameters)
 			transfuncName = defGetQualifiedName(defel);
 		else if (pg_strcasecmp(defel->defname, "finalfunc") == 0)
 			finalfuncName = defGetQualifiedName(defel);
+		else if (pg_strcasecmp(defel->defname, "combinefunc") == 0)
+			combinefuncName = defGetQualifiedName(defel);
+		else if (pg_strcasecmp(defel->defname, "invfunc") == 0)
+			invfuncName = defGetQualifiedName(defel);
 		else if (pg_strcasecmp(defel->defname, "sortop") == 0)
 			sortoperatorName = defGetQualifiedName(defel);
 		else if (pg_strcasecmp(defel->defname, "basetype") == 0)
@@ -201,6 +207,8 @@ DefineAggregate(List *name, List *args, bool oldstyle, List *parameters)
 					numArgs,
 					transfuncName,		/* step function name */
 					finalfuncName,		/* final function name */
+					combinefuncName,	/* combine function name */
+					invfuncName,	/* inverse transition function name */
 					sortoperatorName,	/* sort operator name */
 					transTypeId,	/* transition data type */
 					initval);	/* initial condition */
@@ -16,6 +16,7 @@
 
 #include <math.h>
 
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/tupconvert.h"
 #include "access/tuptoaster.h"
@@ -26,10 +27,12 @@
 #include "catalog/pg_collation.h"
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_namespace.h"
+#include "catalog/pg_statistic_ext.h"
 #include "commands/dbcommands.h"
 #include "commands/tablecmds.h"
 #include "commands/vacuum.h"
 #include "executor/executor.h"
+#include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "parser/parse_oper.h"
@@ -41,9 +44,12 @@
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/attoptcache.h"
 #include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/guc.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -85,7 +91,9 @@ static MemoryContext anl_context = NULL;
 static BufferAccessStrategy vac_strategy;
 
 
-static void do_analyze_rel(Relation onerel, VacuumStmt *vacstmt, bool inh);
+static void do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
+			   AcquireSampleRowsFunc acquirefunc, BlockNumber relpages,
+			   bool inh);
 static void BlockSampler_Init(BlockSampler bs, BlockNumber nblocks,
 				  int samplesize);
 static bool BlockSampler_HasMore(BlockSampler bs);
@@ -96,18 +104,25 @@ static void compute_index_stats(Relation onerel, double totalrows,
 					MemoryContext col_context);
 static VacAttrStats *examine_attribute(Relation onerel, int attnum,
 				  Node *index_expr);
-static int acquire_sample_rows(Relation onerel, HeapTuple *rows,
-					int targrows, double *totalrows, double *totaldeadrows);
-static double random_fract(void);
-static double init_selection_state(int n);
-static double get_next_S(double t, int n, double *stateptr);
+static bool get_table_sampler(Relation onerel, AcquireSampleRowsFunc *func,
+				  BlockNumber *relpages);
+static int acquire_sample_rows(Relation onerel, int elevel,
+					HeapTuple *rows, int targrows,
+					double *totalrows, double *totaldeadrows);
 static int	compare_rows(const void *a, const void *b);
 static int acquire_inherited_sample_rows(Relation onerel,
 							  HeapTuple *rows, int targrows,
 							  double *totalrows, double *totaldeadrows);
 static void update_attstats(Oid relid, bool inh,
 				int natts, VacAttrStats **vacattrstats);
-static Datum std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
+static void compute_ext_stats(Relation onerel, double totalrows,
+				  HeapTuple *rows, int numrows);
+static void update_ext_stats(Relation onerel,
+				 ExtStatistics *groups, int ngroups);
+static void compute_column_stats(Relation onerel, bool inh,
+					 VacAttrStats **vacattrstats, int attr_cnt,
+					 HeapTuple *rows, int numrows, double totalrows,
+					 MemoryContext col_context);
 static Datum ind_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
 
 static bool std_typanalyze(VacAttrStats *stats);
@@ -120,6 +135,8 @@ void
 analyze_rel(Oid relid, VacuumStmt *vacstmt, BufferAccessStrategy bstrategy)
 {
 	Relation	onerel;
+	AcquireSampleRowsFunc acquirefunc = NULL;
+	BlockNumber relpages = 0;
 
 	/* Set up static variables */
 	if (vacstmt->options & VACOPT_VERBOSE)
@@ -184,10 +201,52 @@ analyze_rel(Oid relid, VacuumStmt *vacstmt, BufferAccessStrategy bstrategy)
 	}
 
 	/*
-	 * Check that it's a plain table; we used to do this in get_rel_oids() but
+	 * Check that it's a plain table, a materialized view, or a foreign table
+	 * that its wrapper can sample; we used to do this in get_rel_oids() but
 	 * seems safer to check after we've locked the relation.
 	 */
-	if (onerel->rd_rel->relkind != RELKIND_RELATION)
+	if (onerel->rd_rel->relkind == RELKIND_RELATION ||
+		onerel->rd_rel->relkind == RELKIND_MATVIEW)
+	{
+		/*
+		 * Regular table, so we'll use the regular row acquisition function,
+		 * unless its table access method has its own
+		 */
+		if (!get_table_sampler(onerel, &acquirefunc, &relpages))
+		{
+			ereport(WARNING,
+					(errmsg("skipping \"%s\" --- cannot analyze this table",
+							RelationGetRelationName(onerel))));
+			relation_close(onerel, ShareUpdateExclusiveLock);
+			return;
+		}
+	}
+	else if (onerel->rd_rel->relkind == RELKIND_FOREIGN_TABLE)
+	{
+		/*
+		 * For a foreign table, call the FDW's hook function to see whether it
+		 * supports analysis.
+		 */
+		FdwRoutine *fdwroutine;
+		bool		ok = false;
+
+		fdwroutine = GetFdwRoutineByRelId(RelationGetRelid(onerel));
+
+		if (fdwroutine->AnalyzeForeignTable != NULL)
+			ok = fdwroutine->AnalyzeForeignTable(onerel,
+												 &acquirefunc,
+												 &relpages);
+
+		if (!ok)
+		{
+			ereport(WARNING,
+			 (errmsg("skipping \"%s\" --- cannot analyze this foreign table",
+					 RelationGetRelationName(onerel))));
+			relation_close(onerel, ShareUpdateExclusiveLock);
+			return;
+		}
+	}
+	else
 	{
 		/* No need for a WARNING if we already complained during VACUUM */
 		if (!(vacstmt->options & VACOPT_VACUUM))
@@ -229,13 +288,13 @@ analyze_rel(Oid relid, VacuumStmt *vacstmt, BufferAccessStrategy bstrategy)
 	/*
 	 * Do the normal non-recursive ANALYZE.
 	 */
-	do_analyze_rel(onerel, vacstmt, false);
+	do_analyze_rel(onerel, vacstmt, acquirefunc, relpages, false);
 
 	/*
 	 * If there are child tables, do recursive ANALYZE.
 	 */
 	if (onerel->rd_rel->relhassubclass)
-		do_analyze_rel(onerel, vacstmt, true);
+		do_analyze_rel(onerel, vacstmt, acquirefunc, relpages, true);
 
 	/*
 	 * Close source relation now, but keep lock so that no one deletes it
@@ -256,9 +315,14 @@ analyze_rel(Oid relid, VacuumStmt *vacstmt, BufferAccessStrategy bstrategy)
 
 /*
  *	do_analyze_rel() -- analyze one relation, recursively or not
+ *
+ * acquirefunc samples the relation's own rows, and relpages is its size;
+ * both are only used in the non-recursive case.
  */
 static void
-do_analyze_rel(Relation onerel, VacuumStmt *vacstmt, bool inh)
+do_analyze_rel(Relation onerel, VacuumStmt *vacstmt,
+			   AcquireSampleRowsFunc acquirefunc, BlockNumber relpages,
+			   bool inh)
 {
 	int			attr_cnt,
 				tcnt,
@@ -452,8 +516,9 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt, bool inh)
 		numrows = acquire_inherited_sample_rows(onerel, rows, targrows,
 												&totalrows, &totaldeadrows);
 	else
-		numrows = acquire_sample_rows(onerel, rows, targrows,
-									  &totalrows, &totaldeadrows);
+		numrows = (*acquirefunc) (onerel, elevel,
+								  rows, targrows,
+								  &totalrows, &totaldeadrows);
 
 	/*
 	 * Compute the statistics.	Temporary results during the calculations for
@@ -473,34 +538,8 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt, bool inh)
 											ALLOCSET_DEFAULT_MAXSIZE);
 		old_context = MemoryContextSwitchTo(col_context);
 
-		for (i = 0; i < attr_cnt; i++)
-		{
-			VacAttrStats *stats = vacattrstats[i];
-			AttributeOpts *aopt =
-			get_attribute_options(onerel->rd_id, stats->attr->attnum);
-
-			stats->rows = rows;
-			stats->tupDesc = onerel->rd_att;
-			(*stats->compute_stats) (stats,
-									 std_fetch_func,
-									 numrows,
-									 totalrows);
-
-			/*
-			 * If the appropriate flavor of the n_distinct option is
-			 * specified, override with the corresponding value.
-			 */
-			if (aopt != NULL)
-			{
-				float8		n_distinct =
-				inh ? aopt->n_distinct_inherited : aopt->n_distinct;
-
-				if (n_distinct != 0.0)
-					stats->stadistinct = n_distinct;
-			}
-
-			MemoryContextResetAndDeleteChildren(col_context);
-		}
+		compute_column_stats(onerel, inh, vacattrstats, attr_cnt,
+							 rows, numrows, totalrows, col_context);
 
 		if (hasindex)
 			compute_index_stats(onerel, totalrows,
@@ -526,6 +565,14 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt, bool inh)
 			update_attstats(RelationGetRelid(Irel[ind]), false,
 							thisdata->attr_cnt, thisdata->vacattrstats);
 		}
+
+		/*
+		 * Likewise for any column groups declared with ADD STATISTICS, but
+		 * only when analyzing the whole of a single table: the groups'
+		 * statistics describe the table itself, not its inheritance tree.
+		 */
+		if (!inh && vacstmt->va_cols == NIL)
+			compute_ext_stats(onerel, totalrows, rows, numrows);
 	}
 
 	/*
@@ -534,9 +581,11 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt, bool inh)
 	 */
 	if (!inh)
 		vac_update_relstats(onerel,
-							RelationGetNumberOfBlocks(onerel),
+							relpages,
 							totalrows,
-							visibilitymap_count(onerel),
+							(onerel->rd_rel->relkind == RELKIND_RELATION ||
+							 onerel->rd_rel->relkind == RELKIND_MATVIEW) ?
+							visibilitymap_count(onerel) : 0,
 							hasindex,
 							InvalidTransactionId);
 
@@ -621,6 +670,103 @@ do_analyze_rel(Relation onerel, VacuumStmt *vacstmt, bool inh)
 	anl_context = NULL;
 }
 
+/*
+ * Compute statistics about the columns of a relation
+ *
+ * Fetching a column with heap_getattr means walking over the columns before
+ * it whenever one of them is null or variable-width, so fetching every
+ * column of every sample row that way costs time quadratic in the number of
+ * columns.  Instead we deform each sample row once for a batch of columns,
+ * into Datum arrays that the compute_stats routines read the same way they
+ * read index expression values.  The batches are as large as
+ * maintenance_work_mem allows; usually one batch covers all the columns.
+ */
+static void
+compute_column_stats(Relation onerel, bool inh,
+					 VacAttrStats **vacattrstats, int attr_cnt,
+					 HeapTuple *rows, int numrows, double totalrows,
+					 MemoryContext col_context)
+{
+	TupleDesc	tupDesc = RelationGetDescr(onerel);
+	MemoryContext old_context;
+	Datum	   *row_values;
+	bool	   *row_nulls;
+	Datum	   *batch_values;
+	bool	   *batch_nulls;
+	long		batch_size;
+	int			batch_cols;
+	int			first;
+
+	batch_size = (maintenance_work_mem * 1024L) /
+		((long) numrows * (sizeof(Datum) + sizeof(bool)));
+	batch_cols = (int) Max(Min(batch_size, (long) attr_cnt), 1);
+
+	/* These must survive the per-column resets of col_context */
+	old_context = MemoryContextSwitchTo(anl_context);
+	row_values = (Datum *) palloc(tupDesc->natts * sizeof(Datum));
+	row_nulls = (bool *) palloc(tupDesc->natts * sizeof(bool));
+	batch_values = (Datum *) palloc((Size) numrows * batch_cols * sizeof(Datum));
+	batch_nulls = (bool *) palloc((Size) numrows * batch_cols * sizeof(bool));
+	MemoryContextSwitchTo(old_context);
+
+	for (first = 0; first < attr_cnt; first += batch_cols)
+	{
+		int			ncols = Min(batch_cols, attr_cnt - first);
+		int			rownum;
+		int			i;
+
+		for (rownum = 0; rownum < numrows; rownum++)
+		{
+			heap_deform_tuple(rows[rownum], tupDesc, row_values, row_nulls);
+
+			for (i = 0; i < ncols; i++)
+			{
+				int			attnum = vacattrstats[first + i]->tupattnum;
+
+				batch_values[rownum * ncols + i] = row_values[attnum - 1];
+				batch_nulls[rownum * ncols + i] = row_nulls[attnum - 1];
+			}
+		}
+
+		for (i = 0; i < ncols; i++)
+		{
+			VacAttrStats *stats = vacattrstats[first + i];
+			AttributeOpts *aopt =
+			get_attribute_options(onerel->rd_id, stats->attr->attnum);
+
+			stats->rows = rows;
+			stats->tupDesc = tupDesc;
+			stats->exprvals = batch_values + i;
+			stats->exprnulls = batch_nulls + i;
+			stats->rowstride = ncols;
+			(*stats->compute_stats) (stats,
+									 ind_fetch_func,
+									 numrows,
+									 totalrows);
+
+			/*
+			 * If the appropriate flavor of the n_distinct option is
+			 * specified, override with the corresponding value.
+			 */
+			if (aopt != NULL)
+			{
+				float8		n_distinct =
+				inh ? aopt->n_distinct_inherited : aopt->n_distinct;
+
+				if (n_distinct != 0.0)
+					stats->stadistinct = n_distinct;
+			}
+
+			MemoryContextResetAndDeleteChildren(col_context);
+		}
+	}
+
+	pfree(row_values);
+	pfree(row_nulls);
+	pfree(batch_values);
+	pfree(batch_nulls);
+}
+
 /*
  * Compute statistics about indexes of a relation
  */
@@ -949,8 +1095,8 @@ BlockSampler_Next(BlockSampler bs)
 	 * Knuth says to skip the current block with probability 1 - k/K.
 	 * If we are to skip, we should advance t (hence decrease K), and
 	 * repeat the same probabilistic test for the next block.  The naive
-	 * implementation thus requires a random_fract() call for each block
-	 * number.	But we can reduce this to one random_fract() call per
+	 * implementation thus requires an anl_random_fract() call for each block
+	 * number.	But we can reduce this to one anl_random_fract() call per
 	 * selected block, by noting that each time the while-test succeeds,
 	 * we can reinterpret V as a uniform random number in the range 0 to p.
 	 * Therefore, instead of choosing a new V, we just adjust p to be
@@ -965,7 +1111,7 @@ BlockSampler_Next(BlockSampler bs)
 	 * less than k, which means that we cannot fail to select enough blocks.
 	 *----------
 	 */
-	V = random_fract();
+	V = anl_random_fract();
 	p = 1.0 - (double) k / (double) K;
 	while (V < p)
 	{
@@ -982,6 +1128,32 @@ BlockSampler_Next(BlockSampler bs)
 	return bs->t++;
 }
 
+/*
+ * get_table_sampler -- find the row sampling function of a plain table
+ *
+ * Heaps are sampled by acquire_sample_rows; other table access methods
+ * supply their own function, or none.  Sets *func and the table's size in
+ * pages, and returns false if the table can't be sampled.
+ */
+static bool
+get_table_sampler(Relation onerel, AcquireSampleRowsFunc *func,
+				  BlockNumber *relpages)
+{
+	const TableAmRoutine *tableam;
+
+	if (RelationIsHeap(onerel))
+	{
+		*func = acquire_sample_rows;
+		*relpages = RelationGetNumberOfBlocks(onerel);
+		return true;
+	}
+
+	tableam = GetTableAmRoutine(onerel);
+	if (tableam->AnalyzeTable == NULL)
+		return false;
+	return tableam->AnalyzeTable(onerel, func, relpages);
+}
+
 /*
  * acquire_sample_rows -- acquire a random sample of rows from the table
  *
@@ -1016,7 +1188,8 @@ BlockSampler_Next(BlockSampler bs)
  * density near the start of the table.
  */
 static int
-acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
+acquire_sample_rows(Relation onerel, int elevel,
+					HeapTuple *rows, int targrows,
 					double *totalrows, double *totaldeadrows)
 {
 	int			numrows = 0;	/* # rows now in reservoir */
@@ -1027,6 +1200,12 @@ acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 	BlockNumber totalblocks;
 	TransactionId OldestXmin;
 	BlockSamplerData bs;
+	BlockNumber *blocks;
+	int			nblocks = 0;
+	int			blockidx;
+#ifdef USE_PREFETCH
+	int			prefetch_idx = 0;	/* next entry of blocks[] to prefetch */
+#endif
 	double		rstate;
 
 	Assert(targrows > 0);
@@ -1036,15 +1215,24 @@ acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 	/* Need a cutoff xmin for HeapTupleSatisfiesVacuum */
 	OldestXmin = GetOldestXmin(onerel->rd_rel->relisshared, true);
 
-	/* Prepare for sampling block numbers */
+	/*
+	 * Select the sample blocks up front, rather than one at a time as we go,
+	 * so that we can tell the kernel which ones we'll be reading next.  The
+	 * block sampler returns them in increasing order.
+	 */
 	BlockSampler_Init(&bs, totalblocks, targrows);
+	blocks = (BlockNumber *) palloc(Min(totalblocks, targrows) *
+									sizeof(BlockNumber));
+	while (BlockSampler_HasMore(&bs))
+		blocks[nblocks++] = BlockSampler_Next(&bs);
+
 	/* Prepare for sampling rows */
-	rstate = init_selection_state(targrows);
+	rstate = anl_init_selection_state(targrows);
 
 	/* Outer loop over blocks to sample */
-	while (BlockSampler_HasMore(&bs))
+	for (blockidx = 0; blockidx < nblocks; blockidx++)
 	{
-		BlockNumber targblock = BlockSampler_Next(&bs);
+		BlockNumber targblock = blocks[blockidx];
 		Buffer		targbuffer;
 		Page		targpage;
 		OffsetNumber targoffset,
@@ -1052,6 +1240,22 @@ acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 
 		vacuum_delay_point();
 
+#ifdef USE_PREFETCH
+
+		/*
+		 * Keep up to target_prefetch_pages of the following sample blocks
+		 * prefetched, as a bitmap heap scan does.
+		 */
+		if (prefetch_idx <= blockidx)
+			prefetch_idx = blockidx + 1;
+		while (prefetch_idx < nblocks &&
+			   prefetch_idx <= blockidx + target_prefetch_pages)
+		{
+			PrefetchBuffer(onerel, MAIN_FORKNUM, blocks[prefetch_idx]);
+			prefetch_idx++;
+		}
+#endif
+
 		/*
 		 * We must maintain a pin on the target page's buffer to ensure that
 		 * the maxoffset value stays good (else concurrent VACUUM might delete
@@ -1186,7 +1390,7 @@ acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 					 * t.
 					 */
 					if (rowstoskip < 0)
-						rowstoskip = get_next_S(samplerows, targrows, &rstate);
+						rowstoskip = anl_get_next_S(samplerows, targrows, &rstate);
 
 					if (rowstoskip <= 0)
 					{
@@ -1194,7 +1398,7 @@ acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 						 * Found a suitable tuple, so save it, replacing one
 						 * old tuple at random
 						 */
-						int			k = (int) (targrows * random_fract());
+						int			k = (int) (targrows * anl_random_fract());
 
 						Assert(k >= 0 && k < targrows);
 						heap_freetuple(rows[k]);
@@ -1212,6 +1416,8 @@ acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 		UnlockReleaseBuffer(targbuffer);
 	}
 
+	pfree(blocks);
+
 	/*
 	 * If we didn't find as many tuples as we wanted then we're done. No sort
 	 * is needed, since they're already in order.
@@ -1254,8 +1460,8 @@ acquire_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 }
 
 /* Select a random value R uniformly distributed in (0 - 1) */
-static double
-random_fract(void)
+double
+anl_random_fract(void)
 {
 	return ((double) random() + 1) / ((double) MAX_RANDOM_VALUE + 2);
 }
@@ -1268,21 +1474,21 @@ random_fract(void)
  * It is computed primarily based on t, the number of records already read.
  * The only extra state needed between calls is W, a random state variable.
  *
- * init_selection_state computes the initial W value.
+ * anl_init_selection_state computes the initial W value.
  *
- * Given that we've already read t records (t >= n), get_next_S
+ * Given that we've already read t records (t >= n), anl_get_next_S
  * determines the number of records to skip before the next record is
  * processed.
  */
-static double
-init_selection_state(int n)
+double
+anl_init_selection_state(int n)
 {
 	/* Initial value of W (for use when Algorithm Z is first applied) */
-	return exp(-log(random_fract()) / n);
+	return exp(-log(anl_random_fract()) / n);
 }
 
-static double
-get_next_S(double t, int n, double *stateptr)
+double
+anl_get_next_S(double t, int n, double *stateptr)
 {
 	double		S;
 
@@ -1293,7 +1499,7 @@ get_next_S(double t, int n, double *stateptr)
 		double		V,
 					quot;
 
-		V = random_fract();		/* Generate V */
+		V = anl_random_fract();	/* Generate V */
 		S = 0;
 		t += 1;
 		/* Note: "num" in Vitter's code is always equal to t - n */
@@ -1325,7 +1531,7 @@ get_next_S(double t, int n, double *stateptr)
 						tmp;
 
 			/* Generate U and X */
-			U = random_fract();
+			U = anl_random_fract();
 			X = t * (W - 1.0);
 			S = floor(X);		/* S is tentatively set to floor(X) */
 			/* Test if U <= h(S)/cg(X) in the manner of (6.3) */
@@ -1354,7 +1560,7 @@ get_next_S(double t, int n, double *stateptr)
 				y *= numer / denom;
 				denom -= 1;
 			}
-			W = exp(-log(random_fract()) / n);	/* Generate W in advance */
+			W = exp(-log(anl_random_fract()) / n);	/* Generate W in advance */
 			if (exp(log(y) / n) <= (t + X) / t)
 				break;
 		}
@@ -1401,6 +1607,7 @@ acquire_inherited_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 {
 	List	   *tableOIDs;
 	Relation   *rels;
+	AcquireSampleRowsFunc *acquirefuncs;
 	double	   *relblocks;
 	double		totalblocks;
 	int			numrows,
@@ -1435,6 +1642,8 @@ acquire_inherited_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 	 * BlockNumber, so we use double arithmetic.
 	 */
 	rels = (Relation *) palloc(list_length(tableOIDs) * sizeof(Relation));
+	acquirefuncs = (AcquireSampleRowsFunc *)
+		palloc(list_length(tableOIDs) * sizeof(AcquireSampleRowsFunc));
 	relblocks = (double *) palloc(list_length(tableOIDs) * sizeof(double));
 	totalblocks = 0;
 	nrels = 0;
@@ -1442,6 +1651,7 @@ acquire_inherited_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 	{
 		Oid			childOID = lfirst_oid(lc);
 		Relation	childrel;
+		BlockNumber relpages;
 
 		/* We already got the needed lock */
 		childrel = heap_open(childOID, NoLock);
@@ -1455,8 +1665,15 @@ acquire_inherited_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 			continue;
 		}
 
+		/* Ignore if its table access method can't sample it */
+		if (!get_table_sampler(childrel, &acquirefuncs[nrels], &relpages))
+		{
+			heap_close(childrel, NoLock);
+			continue;
+		}
+
 		rels[nrels] = childrel;
-		relblocks[nrels] = (double) RelationGetNumberOfBlocks(childrel);
+		relblocks[nrels] = (double) relpages;
 		totalblocks += relblocks[nrels];
 		nrels++;
 	}
@@ -1489,11 +1706,12 @@ acquire_inherited_sample_rows(Relation onerel, HeapTuple *rows, int targrows,
 							tdrows;
 
 				/* Fetch a random sample of the child's rows */
-				childrows = acquire_sample_rows(childrel,
-												rows + numrows,
-												childtargrows,
-												&trows,
-												&tdrows);
+				childrows = acquirefuncs[i] (childrel,
+											 elevel,
+											 rows + numrows,
+											 childtargrows,
+											 &trows,
+											 &tdrows);
 
 				/* We may need to convert from child's rowtype to parent's */
 				if (childrows > 0 &&
@@ -1692,27 +1910,341 @@ update_attstats(Oid relid, bool inh, int natts, VacAttrStats **vacattrstats)
 	heap_close(sd, RowExclusiveLock);
 }
 
+
 /*
- * Standard fetch function for use by compute_stats subroutines.
+ * Extended statistics over groups of columns
  *
- * This exists to provide some insulation between compute_stats routines
- * and the actual storage of the sample data.
+ * For each column group of the table, we estimate the number of distinct
+ * combinations of values of the group's columns, and for each ordered pair
+ * of columns (a, b) the degree to which a determines b: the fraction of
+ * sample rows whose value of a is always accompanied by the same value of
+ * b.  Both are found by sorting the sample, so we need a default btree
+ * ordering operator for every column; a group with a column that has none
+ * is left alone.
  */
-static Datum
-std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull)
+typedef struct
+{
+	int			ncols;			/* number of leading cols[] to compare */
+	int		   *cols;			/* group column indexes, in sort order */
+	SortSupport ssup;			/* per group column */
+	Datum	  **values;			/* per group column, indexed by sample row */
+	bool	  **isnull;			/* likewise */
+} CompareMultiContext;
+
+/*
+ * qsort_arg comparator for sorting sample row numbers on several columns
+ */
+static int
+compare_multi(const void *a, const void *b, void *arg)
+{
+	int			ra = *(const int *) a;
+	int			rb = *(const int *) b;
+	CompareMultiContext *cxt = (CompareMultiContext *) arg;
+	int			i;
+
+	for (i = 0; i < cxt->ncols; i++)
+	{
+		int			col = cxt->cols[i];
+		int			compare;
+
+		compare = ApplySortComparator(cxt->values[col][ra],
+									  cxt->isnull[col][ra],
+									  cxt->values[col][rb],
+									  cxt->isnull[col][rb],
+									  &cxt->ssup[col]);
+		if (compare != 0)
+			return compare;
+	}
+	return 0;
+}
+
+/*
+ *	compute_ext_stats() -- compute and store statistics for column groups
+ */
+static void
+compute_ext_stats(Relation onerel, double totalrows,
+				  HeapTuple *rows, int numrows)
+{
+	TupleDesc	tupdesc = RelationGetDescr(onerel);
+	List	   *extstats;
+	ExtStatistics *groups;
+	int			ngroups;
+	int			g;
+	ListCell   *lc;
+	MemoryContext ext_context,
+				old_context;
+
+	extstats = RelationGetExtStatistics(onerel);
+	if (extstats == NIL)
+		return;
+
+	/*
+	 * Work on a copy of the definitions: the relcache entry could be rebuilt
+	 * under us as soon as we take another lock.
+	 */
+	ngroups = list_length(extstats);
+	groups = (ExtStatistics *) palloc(ngroups * sizeof(ExtStatistics));
+	g = 0;
+	foreach(lc, extstats)
+		memcpy(&groups[g++], lfirst(lc), sizeof(ExtStatistics));
+
+	ext_context = AllocSetContextCreate(anl_context,
+										"Analyze Column Group",
+										ALLOCSET_DEFAULT_MINSIZE,
+										ALLOCSET_DEFAULT_INITSIZE,
+										ALLOCSET_DEFAULT_MAXSIZE);
+	old_context = MemoryContextSwitchTo(ext_context);
+
+	for (g = 0; g < ngroups; g++)
+	{
+		ExtStatistics *group = &groups[g];
+		int			nkeys = group->nkeys;
+		SortSupportData ssup[STATISTIC_EXT_MAX_COLUMNS];
+		Datum	   *values[STATISTIC_EXT_MAX_COLUMNS];
+		bool	   *isnull[STATISTIC_EXT_MAX_COLUMNS];
+		int			cols[STATISTIC_EXT_MAX_COLUMNS];
+		CompareMultiContext cxt;
+		int		   *items;
+		int			d,
+					f1;
+		double		stadistinct;
+		int			i,
+					j,
+					a,
+					b;
+
+		vacuum_delay_point();
+
+		for (a = 0; a < nkeys; a++)
+		{
+			Form_pg_attribute attr = tupdesc->attrs[group->keys[a] - 1];
+			Oid			ltopr;
+
+			get_sort_group_operators(attr->atttypid,
+									 false, false, false,
+									 &ltopr, NULL, NULL,
+									 NULL);
+			if (!OidIsValid(ltopr))
+				break;
+
+			memset(&ssup[a], 0, sizeof(SortSupportData));
+			ssup[a].ssup_cxt = CurrentMemoryContext;
+			/* We always use the default collation for statistics */
+			ssup[a].ssup_collation = DEFAULT_COLLATION_OID;
+			ssup[a].ssup_nulls_first = false;
+			PrepareSortSupportFromOrderingOp(ltopr, &ssup[a]);
+
+			values[a] = (Datum *) palloc(numrows * sizeof(Datum));
+			isnull[a] = (bool *) palloc(numrows * sizeof(bool));
+			for (i = 0; i < numrows; i++)
+				values[a][i] = heap_getattr(rows[i], group->keys[a], tupdesc,
+											&isnull[a][i]);
+		}
+		if (a < nkeys)
+		{
+			/* unsortable column, skip the group */
+			group->nkeys = 0;
+			MemoryContextResetAndDeleteChildren(ext_context);
+			continue;
+		}
+
+		items = (int *) palloc(numrows * sizeof(int));
+		cxt.cols = cols;
+		cxt.ssup = ssup;
+		cxt.values = values;
+		cxt.isnull = isnull;
+
+		/*
+		 * Count the distinct combinations in the sample, and those that
+		 * occur only once, then scale up as compute_distinct_stats does.
+		 */
+		for (a = 0; a < nkeys; a++)
+			cols[a] = a;
+		cxt.ncols = nkeys;
+		for (i = 0; i < numrows; i++)
+			items[i] = i;
+		qsort_arg(items, numrows, sizeof(int), compare_multi, &cxt);
+
+		d = f1 = 0;
+		for (i = 0; i < numrows; i = j)
+		{
+			for (j = i + 1; j < numrows; j++)
+			{
+				if (compare_multi(&items[i], &items[j], &cxt) != 0)
+					break;
+			}
+			d++;
+			if (j - i == 1)
+				f1++;
+		}
+
+		if (f1 == d)
+		{
+			/* every combination in the sample is unique */
+			stadistinct = -1.0;
+		}
+		else
+		{
+			/* Haas and Stokes' Duj1 estimator; see compute_distinct_stats */
+			double		numer,
+						denom;
+
+			numer = (double) numrows *(double) d;
+			denom = (double) (numrows - f1) +
+				(double) f1 *(double) numrows / totalrows;
+			stadistinct = numer / denom;
+			/* Clamp to sane range in case of roundoff error */
+			if (stadistinct < (double) d)
+				stadistinct = (double) d;
+			if (stadistinct > totalrows)
+				stadistinct = totalrows;
+			stadistinct = floor(stadistinct + 0.5);
+			if (stadistinct > 0.1 * totalrows)
+				stadistinct = -(stadistinct / totalrows);
+		}
+		group->ndistinct = stadistinct;
+
+		/*
+		 * Now the functional dependencies.  Sorting on (a, b) brings the rows
+		 * that agree on a together, each such run sorted on b; the run
+		 * supports "a determines b" if its first and last rows agree on b.
+		 */
+		for (a = 0; a < nkeys; a++)
+		{
+			for (b = 0; b < nkeys; b++)
+			{
+				double		supporting = 0;
+
+				if (a == b)
+				{
+					group->dependencies[a * nkeys + b] = 1.0;
+					continue;
+				}
+
+				cols[0] = a;
+				cols[1] = b;
+				cxt.ncols = 2;
+				qsort_arg(items, numrows, sizeof(int), compare_multi, &cxt);
+
+				for (i = 0; i < numrows; i = j)
+				{
+					cxt.ncols = 1;
+					for (j = i + 1; j < numrows; j++)
+					{
+						if (compare_multi(&items[i], &items[j], &cxt) != 0)
+							break;
+					}
+					cxt.ncols = 2;
+					if (compare_multi(&items[i], &items[j - 1], &cxt) == 0)
+						supporting += j - i;
+				}
+				group->dependencies[a * nkeys + b] = supporting / numrows;
+			}
+		}
+		group->has_dependencies = true;
+
+		MemoryContextResetAndDeleteChildren(ext_context);
+	}
+
+	MemoryContextSwitchTo(old_context);
+	MemoryContextDelete(ext_context);
+
+	update_ext_stats(onerel, groups, ngroups);
+}
+
+/*
+ *	update_ext_stats() -- store column group statistics in pg_statistic_ext
+ *
+ * Groups whose nkeys has been zeroed are left untouched.  The relcache entry
+ * carries the statistics, so we must also send an invalidation for it.
+ */
+static void
+update_ext_stats(Relation onerel, ExtStatistics *groups, int ngroups)
 {
-	int			attnum = stats->tupattnum;
-	HeapTuple	tuple = stats->rows[rownum];
-	TupleDesc	tupDesc = stats->tupDesc;
+	Relation	sd;
+	SysScanDesc scan;
+	ScanKeyData key;
+	HeapTuple	oldtup;
+
+	sd = heap_open(StatisticExtRelationId, RowExclusiveLock);
+
+	ScanKeyInit(&key,
+				Anum_pg_statistic_ext_starelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(RelationGetRelid(onerel)));
 
-	return heap_getattr(tuple, attnum, tupDesc, isNull);
+	scan = systable_beginscan(sd, StatisticExtRelidIndexId, true,
+							  SnapshotNow, 1, &key);
+
+	while (HeapTupleIsValid(oldtup = systable_getnext(scan)))
+	{
+		Form_pg_statistic_ext form = (Form_pg_statistic_ext) GETSTRUCT(oldtup);
+		ExtStatistics *group = NULL;
+		int			g;
+		int			n;
+		Datum		values[Natts_pg_statistic_ext];
+		bool		nulls[Natts_pg_statistic_ext];
+		bool		replaces[Natts_pg_statistic_ext];
+		Datum	   *numdatums;
+		ArrayType  *arry;
+		HeapTuple	stup;
+
+		for (g = 0; g < ngroups; g++)
+		{
+			if (groups[g].nkeys == form->stakeys.dim1 &&
+				memcmp(groups[g].keys, form->stakeys.values,
+					   groups[g].nkeys * sizeof(int2)) == 0)
+			{
+				group = &groups[g];
+				break;
+			}
+		}
+		if (group == NULL)
+			continue;			/* group added concurrently, or skipped */
+
+		memset(nulls, false, sizeof(nulls));
+		memset(replaces, false, sizeof(replaces));
+
+		values[Anum_pg_statistic_ext_stadistinct - 1] =
+			Float4GetDatum(group->ndistinct);
+		replaces[Anum_pg_statistic_ext_stadistinct - 1] = true;
+
+		n = group->nkeys * group->nkeys;
+		numdatums = (Datum *) palloc(n * sizeof(Datum));
+		for (g = 0; g < n; g++)
+			numdatums[g] = Float4GetDatum(group->dependencies[g]);
+		/* XXX knows more than it should about type float4: */
+		arry = construct_array(numdatums, n,
+							   FLOAT4OID,
+							   sizeof(float4), FLOAT4PASSBYVAL, 'i');
+		values[Anum_pg_statistic_ext_stadependencies - 1] =
+			PointerGetDatum(arry);
+		replaces[Anum_pg_statistic_ext_stadependencies - 1] = true;
+
+		stup = heap_modify_tuple(oldtup, RelationGetDescr(sd),
+								 values, nulls, replaces);
+		simple_heap_update(sd, &stup->t_self, stup);
+
+		/* update indexes too */
+		CatalogUpdateIndexes(sd, stup);
+
+		heap_freetuple(stup);
+	}
+
+	systable_endscan(scan);
+	heap_close(sd, RowExclusiveLock);
+
+	CacheInvalidateRelcache(onerel);
 }
 
 /*
- * Fetch function for analyzing index expressions.
+ * Fetch function for use by compute_stats subroutines.
  *
- * We have not bothered to construct index tuples, instead the data is
- * just in Datum arrays.
+ * This exists to provide some insulation between compute_stats routines
+ * and the actual storage of the sample data.  We have not bothered to
+ * construct index tuples for index expressions, and we deform the sample
+ * rows for table columns (see compute_column_stats), so the data is just in
+ * Datum arrays.
  */
 static Datum
 ind_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull)
@@ -39,12 +39,15 @@
  *	  is no need for WAL support or fsync'ing.
  *
  * 3. Every backend that is listening on at least one channel registers by
- *	  entering its PID into the array in AsyncQueueControl. It then scans all
- *	  incoming notifications in the central queue and first compares the
- *	  database OID of the notification with its own database OID and then
- *	  compares the notified channel with the list of channels that it listens
- *	  to. In case there is a match it delivers the notification event to its
- *	  frontend.  Non-matching events are simply skipped.
+ *	  entering its PID and database OID into the array in AsyncQueueControl,
+ *	  together with hash values of the names of the channels it listens on
+ *	  (or a marker saying it listens on too many channels to list).  It then
+ *	  scans all incoming notifications in the central queue and first
+ *	  compares the database OID of the notification with its own database
+ *	  OID and then compares the notified channel with the list of channels
+ *	  that it listens to. In case there is a match it delivers the
+ *	  notification event to its frontend.  Non-matching events are simply
+ *	  skipped.
  *
  * 4. The NOTIFY statement (routine Async_Notify) stores the notification in
  *	  a backend-local list which will not be processed until transaction end.
@@ -73,10 +76,14 @@
  *	  Finally, after we are out of the transaction altogether, we check if
  *	  we need to signal listening backends.  In SignalBackends() we scan the
  *	  list of listening backends and send a PROCSIG_NOTIFY_INTERRUPT signal
- *	  to every listening backend (we don't know which backend is listening on
- *	  which channel so we must signal them all). We can exclude backends that
- *	  are already up to date, though.  We don't bother with a self-signal
- *	  either, but just process the queue directly.
+ *	  to those in our database that might listen on one of the channels we
+ *	  notified, going by their channel hashes.  We can exclude backends that
+ *	  are already up to date, though.  The other backends would only skip
+ *	  over our notifications, so if nothing but our notifications lies ahead
+ *	  of them, we advance their pointers past them ourselves; otherwise we
+ *	  signal them only once they fall QUEUE_CLEANUP_DELAY pages behind, so
+ *	  that the queue can still be truncated.  We don't bother with a
+ *	  self-signal either, but just process the queue directly.
  *
  * 5. Upon receipt of a PROCSIG_NOTIFY_INTERRUPT signal, the signal handler
  *	  can call inbound-notify processing immediately if this backend is idle
@@ -115,6 +122,7 @@
 #include <unistd.h>
 #include <signal.h>
 
+#include "access/hash.h"
 #include "access/slru.h"
 #include "access/transam.h"
 #include "access/xact.h"
@@ -198,13 +206,25 @@ typedef struct QueuePosition
 	 (x).page != (y).page ? (y) : \
 	 (x).offset < (y).offset ? (x) : (y))
 
+/*
+ * Maximum number of channels a listening backend advertises in shared
+ * memory.  A backend listening on more channels advertises none, and is
+ * signaled for every notification in its database.
+ */
+#define QUEUE_BACKEND_MAX_CHANNELS	16
+
 /*
  * Struct describing a listening backend's status
  */
 typedef struct QueueBackendStatus
 {
 	int32		pid;			/* either a PID or InvalidPid */
+	Oid			dboid;			/* backend's database OID */
 	QueuePosition pos;			/* backend has read queue up to here */
+	bool		reading;		/* backend is reading the queue from pos */
+	int			nchannels;		/* # of valid channelHashes, or -1 if the
+								 * backend listens on too many channels */
+	uint32		channelHashes[QUEUE_BACKEND_MAX_CHANNELS];
 } QueueBackendStatus;
 
 #define InvalidPid				(-1)
@@ -220,7 +240,9 @@ typedef struct QueueBackendStatus
  * other backend will inspect it).
  *
  * When holding the lock in EXCLUSIVE mode, backends can inspect the entries
- * of other backends and also change the head and tail pointers.
+ * of other backends and also change the head and tail pointers.  A notifying
+ * backend may also advance the pointer of another backend that is not
+ * reading the queue (see SignalBackends).
  *
  * In order to avoid deadlocks, whenever we need both locks, we always first
  * get AsyncQueueLock and then AsyncCtlLock.
@@ -244,7 +266,9 @@ static AsyncQueueControl *asyncQueueControl;
 #define QUEUE_HEAD					(asyncQueueControl->head)
 #define QUEUE_TAIL					(asyncQueueControl->tail)
 #define QUEUE_BACKEND_PID(i)		(asyncQueueControl->backend[i].pid)
+#define QUEUE_BACKEND_DBOID(i)		(asyncQueueControl->backend[i].dboid)
 #define QUEUE_BACKEND_POS(i)		(asyncQueueControl->backend[i].pos)
+#define QUEUE_BACKEND_READING(i)	(asyncQueueControl->backend[i].reading)
 
 /*
  * The SLRU buffer area through which we access the notification queue
@@ -274,6 +298,13 @@ static SlruCtlData AsyncCtlData;
  */
 #define QUEUE_MAX_PAGE			(SLRU_PAGES_PER_SEGMENT * 0x10000 - 1)
 
+/*
+ * A listening backend that doesn't care about a notification isn't signaled
+ * for it until it lags this many pages behind the queue head, at which point
+ * it is signaled anyway so that it moves on and the queue can be truncated.
+ */
+#define QUEUE_CLEANUP_DELAY		4
+
 /*
  * listenChannels identifies the channels we are actually listening to
  * (ie, have committed a LISTEN on).  It is a simple list of channel names,
@@ -334,6 +365,17 @@ static List *pendingNotifies = NIL;		/* list of Notifications */
 
 static List *upperPendingNotifies = NIL;		/* list of upper-xact lists */
 
+/*
+ * PreCommit_Notify remembers where in the queue it put this transaction's
+ * notifications, and the hash values of the channels they were sent on, for
+ * SignalBackends.  notifyChannelCount is -1 if there were too many channels
+ * to remember.
+ */
+static QueuePosition queueHeadBeforeWrite;
+static QueuePosition queueHeadAfterWrite;
+static uint32 notifyChannelHashes[QUEUE_BACKEND_MAX_CHANNELS];
+static int	notifyChannelCount = 0;
+
 /*
  * State for inbound notifications consists of two flags: one saying whether
  * the signal handler is currently allowed to call ProcessIncomingNotify
@@ -361,14 +403,19 @@ bool		Trace_notify = false;
 
 /* local function prototypes */
 static bool asyncQueuePagePrecedes(int p, int q);
+static int	asyncQueuePageDiff(int p, int q);
+static uint32 asyncChannelHash(const char *channel);
+static bool asyncAddChannelHash(uint32 *hashes, int *nhashes, uint32 hash);
 static void queue_listen(ListenActionKind action, const char *channel);
 static void Async_UnlistenOnExit(int code, Datum arg);
-static void Exec_ListenPreCommit(void);
+static void Exec_ListenPreCommit(const char *channel);
 static void Exec_ListenCommit(const char *channel);
 static void Exec_UnlistenCommit(const char *channel);
 static void Exec_UnlistenAllCommit(void);
 static bool IsListeningOn(const char *channel);
 static void asyncQueueUnregister(void);
+static void asyncQueueAdvertiseChannels(void);
+static bool asyncQueueBackendIsInterested(int i);
 static bool asyncQueueIsFull(void);
 static bool asyncQueueAdvance(QueuePosition *position, int entryLength);
 static void asyncQueueNotificationToEntry(Notification *n, AsyncQueueEntry *qe);
@@ -392,6 +439,16 @@ static void ClearPendingActionsAndNotifies(void);
  */
 static bool
 asyncQueuePagePrecedes(int p, int q)
+{
+	return asyncQueuePageDiff(p, q) < 0;
+}
+
+/*
+ * Compute the difference between two queue page numbers, allowing for
+ * wraparound; the result is negative if p precedes q.
+ */
+static int
+asyncQueuePageDiff(int p, int q)
 {
 	int			diff;
 
@@ -407,7 +464,38 @@ asyncQueuePagePrecedes(int p, int q)
 		diff -= QUEUE_MAX_PAGE + 1;
 	else if (diff < -((QUEUE_MAX_PAGE + 1) / 2))
 		diff += QUEUE_MAX_PAGE + 1;
-	return diff < 0;
+	return diff;
+}
+
+/*
+ * Hash value of a channel name, as advertised in shared memory.  Different
+ * channels may of course hash alike; that only costs a needless signal.
+ */
+static uint32
+asyncChannelHash(const char *channel)
+{
+	return DatumGetUInt32(hash_any((const unsigned char *) channel,
+								   strlen(channel)));
+}
+
+/*
+ * Add a hash value to an array of up to QUEUE_BACKEND_MAX_CHANNELS of them,
+ * unless it's there already.  Returns false if the array is full.
+ */
+static bool
+asyncAddChannelHash(uint32 *hashes, int *nhashes, uint32 hash)
+{
+	int			i;
+
+	for (i = 0; i < *nhashes; i++)
+	{
+		if (hashes[i] == hash)
+			return true;
+	}
+	if (*nhashes >= QUEUE_BACKEND_MAX_CHANNELS)
+		return false;
+	hashes[(*nhashes)++] = hash;
+	return true;
 }
 
 /*
@@ -462,7 +550,10 @@ AsyncShmemInit(void)
 		for (i = 0; i <= MaxBackends; i++)
 		{
 			QUEUE_BACKEND_PID(i) = InvalidPid;
+			QUEUE_BACKEND_DBOID(i) = InvalidOid;
 			SET_QUEUE_POS(QUEUE_BACKEND_POS(i), 0, 0);
+			QUEUE_BACKEND_READING(i) = false;
+			asyncQueueControl->backend[i].nchannels = 0;
 		}
 	}
 
@@ -778,7 +869,7 @@ PreCommit_Notify(void)
 		switch (actrec->action)
 		{
 			case LISTEN_LISTEN:
-				Exec_ListenPreCommit();
+				Exec_ListenPreCommit(actrec->channel);
 				break;
 			case LISTEN_UNLISTEN:
 				/* there is no Exec_UnlistenPreCommit() */
@@ -802,6 +893,20 @@ PreCommit_Notify(void)
 		 */
 		(void) GetCurrentTransactionId();
 
+		/* Remember the channels we notify, for SignalBackends */
+		notifyChannelCount = 0;
+		foreach(p, pendingNotifies)
+		{
+			Notification *n = (Notification *) lfirst(p);
+
+			if (!asyncAddChannelHash(notifyChannelHashes, &notifyChannelCount,
+									 asyncChannelHash(n->channel)))
+			{
+				notifyChannelCount = -1;
+				break;
+			}
+		}
+
 		/*
 		 * Serialize writers by acquiring a special lock that we hold till
 		 * after commit.  This ensures that queue entries appear in commit
@@ -824,6 +929,14 @@ PreCommit_Notify(void)
 		/* Now push the notifications into the queue */
 		backendHasSentNotifications = true;
 
+		/*
+		 * Since writers are serialized, everything between the head as we
+		 * find it now and as we leave it is ours.
+		 */
+		LWLockAcquire(AsyncQueueLock, LW_SHARED);
+		queueHeadBeforeWrite = queueHeadAfterWrite = QUEUE_HEAD;
+		LWLockRelease(AsyncQueueLock);
+
 		nextNotify = list_head(pendingNotifies);
 		while (nextNotify != NULL)
 		{
@@ -846,6 +959,7 @@ PreCommit_Notify(void)
 						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
 					  errmsg("too many notifications in the NOTIFY queue")));
 			nextNotify = asyncQueueAddEntries(nextNotify);
+			queueHeadAfterWrite = QUEUE_HEAD;
 			LWLockRelease(AsyncQueueLock);
 		}
 	}
@@ -892,6 +1006,10 @@ AtCommit_Notify(void)
 		}
 	}
 
+	/* Advertise exactly the channels we now listen on */
+	if (pendingActions != NIL && listenChannels != NIL)
+		asyncQueueAdvertiseChannels();
+
 	/*
 	 * If we did an initial LISTEN, listenChannels now has the entry, so we no
 	 * longer need or want the flag to be set.
@@ -905,17 +1023,29 @@ AtCommit_Notify(void)
 /*
  * Exec_ListenPreCommit --- subroutine for PreCommit_Notify
  *
- * This function must make sure we are ready to catch any incoming messages.
+ * This function must make sure we are ready to catch any incoming messages
+ * on the channel.
  */
 static void
-Exec_ListenPreCommit(void)
+Exec_ListenPreCommit(const char *channel)
 {
 	/*
-	 * Nothing to do if we are already listening to something, nor if we
-	 * already ran this routine in this transaction.
+	 * If we are already registered, just advertise the channel, so that
+	 * notifiers committing after us will signal us for it.  Until we commit,
+	 * this only costs us some needless signals.
 	 */
 	if (listenChannels != NIL || backendHasExecutedInitialListen)
+	{
+		QueueBackendStatus *status = &asyncQueueControl->backend[MyBackendId];
+
+		LWLockAcquire(AsyncQueueLock, LW_SHARED);
+		if (status->nchannels >= 0 &&
+			!asyncAddChannelHash(status->channelHashes, &status->nchannels,
+								 asyncChannelHash(channel)))
+			status->nchannels = -1;
+		LWLockRelease(AsyncQueueLock);
 		return;
+	}
 
 	if (Trace_notify)
 		elog(DEBUG1, "Exec_ListenPreCommit(%d)", MyProcPid);
@@ -948,6 +1078,10 @@ Exec_ListenPreCommit(void)
 	LWLockAcquire(AsyncQueueLock, LW_SHARED);
 	QUEUE_BACKEND_POS(MyBackendId) = QUEUE_TAIL;
 	QUEUE_BACKEND_PID(MyBackendId) = MyProcPid;
+	QUEUE_BACKEND_DBOID(MyBackendId) = MyDatabaseId;
+	asyncQueueControl->backend[MyBackendId].nchannels = 1;
+	asyncQueueControl->backend[MyBackendId].channelHashes[0] =
+		asyncChannelHash(channel);
 	LWLockRelease(AsyncQueueLock);
 
 	/*
@@ -1166,6 +1300,8 @@ asyncQueueUnregister(void)
 		QUEUE_POS_EQUAL(QUEUE_BACKEND_POS(MyBackendId), QUEUE_TAIL);
 	/* ... then mark it invalid */
 	QUEUE_BACKEND_PID(MyBackendId) = InvalidPid;
+	QUEUE_BACKEND_DBOID(MyBackendId) = InvalidOid;
+	asyncQueueControl->backend[MyBackendId].nchannels = 0;
 	LWLockRelease(AsyncQueueLock);
 
 	/* If we were the laziest backend, try to advance the tail pointer */
@@ -1173,6 +1309,32 @@ asyncQueueUnregister(void)
 		asyncQueueAdvanceTail();
 }
 
+/*
+ * Advertise the channels in listenChannels in our listeners array entry,
+ * replacing whatever was advertised before.
+ */
+static void
+asyncQueueAdvertiseChannels(void)
+{
+	QueueBackendStatus *status = &asyncQueueControl->backend[MyBackendId];
+	ListCell   *p;
+
+	Assert(listenChannels != NIL);		/* else caller error */
+
+	LWLockAcquire(AsyncQueueLock, LW_SHARED);
+	status->nchannels = 0;
+	foreach(p, listenChannels)
+	{
+		if (!asyncAddChannelHash(status->channelHashes, &status->nchannels,
+								 asyncChannelHash((char *) lfirst(p))))
+		{
+			status->nchannels = -1;
+			break;
+		}
+	}
+	LWLockRelease(AsyncQueueLock);
+}
+
 /*
  * Test whether there is room to insert more notification messages.
  *
@@ -1419,7 +1581,37 @@ asyncQueueFillWarning(void)
 }
 
 /*
- * Send signals to all listening backends (except our own).
+ * Might the listening backend with the given BackendId listen on one of the
+ * channels we just notified?
+ *
+ * Caller must hold exclusive AsyncQueueLock.
+ */
+static bool
+asyncQueueBackendIsInterested(int i)
+{
+	QueueBackendStatus *status = &asyncQueueControl->backend[i];
+	int			j,
+				k;
+
+	if (status->dboid != MyDatabaseId)
+		return false;
+	if (status->nchannels < 0 || notifyChannelCount < 0)
+		return true;
+
+	for (j = 0; j < notifyChannelCount; j++)
+	{
+		for (k = 0; k < status->nchannels; k++)
+		{
+			if (status->channelHashes[k] == notifyChannelHashes[j])
+				return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Send signals to the listening backends (except our own) that might be
+ * interested in the notifications we just sent.
  *
  * Returns true if we sent at least one signal.
  *
@@ -1427,7 +1619,8 @@ asyncQueueFillWarning(void)
  * backends and in case one is already up-to-date we don't signal it.
  * This can happen if concurrent notifying transactions have sent a signal and
  * the signaled backend has read the other notifications and ours in the same
- * step.
+ * step.  A backend that doesn't care about our notifications, and has read
+ * everything before them, we move past them right here instead.
  *
  * Since we know the BackendId and the Pid the signalling is quite cheap.
  */
@@ -1435,6 +1628,7 @@ static bool
 SignalBackends(void)
 {
 	bool		signalled = false;
+	bool		advanceTail = false;
 	int32	   *pids;
 	BackendId  *ids;
 	int			count;
@@ -1457,21 +1651,48 @@ SignalBackends(void)
 	LWLockAcquire(AsyncQueueLock, LW_EXCLUSIVE);
 	for (i = 1; i <= MaxBackends; i++)
 	{
+		QueuePosition pos;
+
 		pid = QUEUE_BACKEND_PID(i);
-		if (pid != InvalidPid && pid != MyProcPid)
-		{
-			QueuePosition pos = QUEUE_BACKEND_POS(i);
+		if (pid == InvalidPid || pid == MyProcPid)
+			continue;
+		pos = QUEUE_BACKEND_POS(i);
 
-			if (!QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
+		if (!asyncQueueBackendIsInterested(i))
+		{
+			/*
+			 * If nothing but our notifications lies ahead of the backend,
+			 * skip it past them, unless it's busy reading the queue and will
+			 * overwrite its pointer when done.
+			 */
+			if (QUEUE_POS_EQUAL(pos, queueHeadBeforeWrite) &&
+				!QUEUE_BACKEND_READING(i))
 			{
-				pids[count] = pid;
-				ids[count] = i;
-				count++;
+				if (QUEUE_POS_EQUAL(pos, QUEUE_TAIL))
+					advanceTail = true;
+				pos = queueHeadAfterWrite;
+				QUEUE_BACKEND_POS(i) = pos;
 			}
+
+			/* Otherwise, leave it alone unless it's holding up the tail */
+			if (asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
+								   QUEUE_POS_PAGE(pos)) < QUEUE_CLEANUP_DELAY)
+				continue;
+		}
+
+		if (!QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
+		{
+			pids[count] = pid;
+			ids[count] = i;
+			count++;
 		}
 	}
 	LWLockRelease(AsyncQueueLock);
 
+	/* If we moved the laziest backend, try to advance the tail pointer */
+	if (advanceTail)
+		asyncQueueAdvanceTail();
+
 	/* Now send signals */
 	for (i = 0; i < count; i++)
 	{
@@ -1523,6 +1744,10 @@ AtAbort_Notify(void)
 		backendHasExecutedInitialListen = false;
 	}
 
+	/* Stop advertising any channels PreCommit_Notify added */
+	if (pendingActions != NIL && listenChannels != NIL)
+		asyncQueueAdvertiseChannels();
+
 	/* And clean up */
 	ClearPendingActionsAndNotifies();
 }
@@ -1798,12 +2023,17 @@ asyncQueueReadAllNotifications(void)
 		AsyncQueueEntry align;
 	}			page_buffer;
 
-	/* Fetch current state */
+	/*
+	 * Fetch current state, and keep notifiers from moving our pointer until
+	 * we're done.
+	 */
 	LWLockAcquire(AsyncQueueLock, LW_SHARED);
 	/* Assert checks that we have a valid state entry */
 	Assert(MyProcPid == QUEUE_BACKEND_PID(MyBackendId));
 	pos = oldpos = QUEUE_BACKEND_POS(MyBackendId);
 	head = QUEUE_HEAD;
+	if (!QUEUE_POS_EQUAL(pos, head))
+		QUEUE_BACKEND_READING(MyBackendId) = true;
 	LWLockRelease(AsyncQueueLock);
 
 	if (QUEUE_POS_EQUAL(pos, head))
@@ -1907,6 +2137,7 @@ asyncQueueReadAllNotifications(void)
 		/* Update shared state */
 		LWLockAcquire(AsyncQueueLock, LW_SHARED);
 		QUEUE_BACKEND_POS(MyBackendId) = pos;
+		QUEUE_BACKEND_READING(MyBackendId) = false;
 		advanceTail = QUEUE_POS_EQUAL(oldpos, QUEUE_TAIL);
 		LWLockRelease(AsyncQueueLock);
 
@@ -1921,6 +2152,7 @@ asyncQueueReadAllNotifications(void)
 	/* Update shared state */
 	LWLockAcquire(AsyncQueueLock, LW_SHARED);
 	QUEUE_BACKEND_POS(MyBackendId) = pos;
+	QUEUE_BACKEND_READING(MyBackendId) = false;
 	advanceTail = QUEUE_POS_EQUAL(oldpos, QUEUE_TAIL);
 	LWLockRelease(AsyncQueueLock);
 
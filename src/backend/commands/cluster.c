@@ -19,6 +19,7 @@
 
 #include "access/relscan.h"
 #include "access/rewriteheap.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
@@ -28,10 +29,12 @@
 #include "catalog/namespace.h"
 #include "catalog/toasting.h"
 #include "commands/cluster.h"
+#include "commands/progress.h"
 #include "commands/tablecmds.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "optimizer/planner.h"
+#include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
@@ -366,6 +369,9 @@ cluster_rel(Oid tableOid, Oid indexOid, bool recheck, bool verbose,
 				errmsg("cannot vacuum temporary tables of other sessions")));
 	}
 
+	/* Only heaps can be rewritten this way */
+	CheckTableIsHeap(OldHeap, OidIsValid(indexOid) ? "CLUSTER" : "VACUUM FULL");
+
 	/*
 	 * Also check for active uses of the relation in the current transaction,
 	 * including open scans and pending AFTER trigger events.
@@ -384,11 +390,19 @@ cluster_rel(Oid tableOid, Oid indexOid, bool recheck, bool verbose,
 	 */
 	TransferPredicateLocksToHeapRelation(OldHeap);
 
+	pgstat_progress_start_command(PROGRESS_COMMAND_CLUSTER, tableOid);
+	pgstat_progress_update_param(PROGRESS_CLUSTER_COMMAND,
+								 OidIsValid(indexOid) ?
+								 PROGRESS_CLUSTER_COMMAND_CLUSTER :
+								 PROGRESS_CLUSTER_COMMAND_VACUUM_FULL);
+
 	/* rebuild_relation does all the dirty work */
 	rebuild_relation(OldHeap, indexOid, freeze_min_age, freeze_table_age,
 					 verbose);
 
 	/* NB: rebuild_relation does heap_close() on OldHeap */
+
+	pgstat_progress_end_command();
 }
 
 /*
@@ -430,7 +444,7 @@ check_index_is_clusterable(Relation OldHeap, Oid indexOid, bool recheck, LOCKMOD
 	 * seqscan pass over the table to copy the missing rows, but that seems
 	 * expensive and tedious.
 	 */
-	if (!heap_attisnull(OldIndex->rd_indextuple, Anum_pg_index_indpred))
+	if (!heap_attisnull(OldIndex->rd_indextuple, Anum_pg_index_indpred, NULL))
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("cannot cluster on partial index \"%s\"",
@@ -541,6 +555,7 @@ rebuild_relation(Relation OldHeap, Oid indexOid,
 	bool		is_system_catalog;
 	bool		swap_toast_by_content;
 	TransactionId frozenXid;
+	char		relpersistence;
 
 	/* Mark the correct index as clustered */
 	if (OidIsValid(indexOid))
@@ -548,12 +563,14 @@ rebuild_relation(Relation OldHeap, Oid indexOid,
 
 	/* Remember if it's a system catalog */
 	is_system_catalog = IsSystemRelation(OldHeap);
+	relpersistence = OldHeap->rd_rel->relpersistence;
 
 	/* Close relcache entry, but keep lock until transaction commit */
 	heap_close(OldHeap, NoLock);
 
 	/* Create the transient table that will receive the re-ordered data */
-	OIDNewHeap = make_new_heap(tableOid, tableSpace);
+	OIDNewHeap = make_new_heap(tableOid, tableSpace, relpersistence,
+							   AccessExclusiveLock);
 
 	/* Copy the heap data into the new table in the desired order */
 	copy_heap_data(OIDNewHeap, tableOid, indexOid,
@@ -573,13 +590,17 @@ rebuild_relation(Relation OldHeap, Oid indexOid,
  * Create the transient table that will be filled with new data during
  * CLUSTER, ALTER TABLE, and similar operations.  The transient table
  * duplicates the logical structure of the OldHeap, but is placed in
- * NewTableSpace which might be different from OldHeap's.
+ * NewTableSpace which might be different from OldHeap's.  It has the given
+ * relpersistence; if that's temporary, it goes in the session's temporary
+ * namespace rather than OldHeap's.  lockmode is the lock the caller already
+ * holds (or wants) on OldHeap.
  *
  * After this, the caller should load the new heap with transferred/modified
  * data, then call finish_heap_swap to complete the operation.
  */
 Oid
-make_new_heap(Oid OIDOldHeap, Oid NewTableSpace)
+make_new_heap(Oid OIDOldHeap, Oid NewTableSpace, char relpersistence,
+			  LOCKMODE lockmode)
 {
 	TupleDesc	OldHeapDesc;
 	char		NewHeapName[NAMEDATALEN];
@@ -589,8 +610,9 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace)
 	HeapTuple	tuple;
 	Datum		reloptions;
 	bool		isNull;
+	Oid			namespaceid;
 
-	OldHeap = heap_open(OIDOldHeap, AccessExclusiveLock);
+	OldHeap = heap_open(OIDOldHeap, lockmode);
 	OldHeapDesc = RelationGetDescr(OldHeap);
 
 	/*
@@ -611,6 +633,11 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace)
 	if (isNull)
 		reloptions = (Datum) 0;
 
+	if (relpersistence == RELPERSISTENCE_TEMP)
+		namespaceid = LookupCreationNamespace("pg_temp");
+	else
+		namespaceid = RelationGetNamespace(OldHeap);
+
 	/*
 	 * Create the new heap, using a temporary name in the same namespace as
 	 * the existing table.	NOTE: there is some risk of collision with user
@@ -626,7 +653,7 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace)
 	snprintf(NewHeapName, sizeof(NewHeapName), "pg_temp_%u", OIDOldHeap);
 
 	OIDNewHeap = heap_create_with_catalog(NewHeapName,
-										  RelationGetNamespace(OldHeap),
+										  namespaceid,
 										  NewTableSpace,
 										  InvalidOid,
 										  InvalidOid,
@@ -635,7 +662,7 @@ make_new_heap(Oid OIDOldHeap, Oid NewTableSpace)
 										  OldHeapDesc,
 										  NIL,
 										  OldHeap->rd_rel->relkind,
-										  OldHeap->rd_rel->relpersistence,
+										  relpersistence,
 										  false,
 										  RelationIsMapped(OldHeap),
 										  true,
@@ -854,14 +881,34 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 	 */
 	if (OldIndex != NULL && !use_sort)
 	{
+		const int	index[] = {
+			PROGRESS_CLUSTER_PHASE,
+			PROGRESS_CLUSTER_INDEX_RELID
+		};
+		int64		val[2];
+
 		heapScan = NULL;
 		indexScan = index_beginscan(OldHeap, OldIndex, SnapshotAny, 0, 0);
 		index_rescan(indexScan, NULL, 0, NULL, 0);
+
+		val[0] = PROGRESS_CLUSTER_PHASE_INDEX_SCAN_HEAP;
+		val[1] = OIDOldIndex;
+		pgstat_progress_update_multi_param(2, index, val);
 	}
 	else
 	{
+		const int	index[] = {
+			PROGRESS_CLUSTER_PHASE,
+			PROGRESS_CLUSTER_TOTAL_HEAP_BLKS
+		};
+		int64		val[2];
+
 		heapScan = heap_beginscan(OldHeap, SnapshotAny, 0, (ScanKey) NULL);
 		indexScan = NULL;
+
+		val[0] = PROGRESS_CLUSTER_PHASE_SEQ_SCAN_HEAP;
+		val[1] = heapScan->rs_nblocks;
+		pgstat_progress_update_multi_param(2, index, val);
 	}
 
 	/* Log what we're doing */
@@ -910,11 +957,25 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 		}
 		else
 		{
+			BlockNumber prev_cblock = heapScan->rs_cblock;
+
 			tuple = heap_getnext(heapScan, ForwardScanDirection);
 			if (tuple == NULL)
 				break;
 
 			buf = heapScan->rs_cbuf;
+
+			/*
+			 * Report blocks done each time we move on to a new one.  The scan
+			 * may have started in the middle of the table, so count from its
+			 * start block.
+			 */
+			if (heapScan->rs_cblock != prev_cblock)
+				pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_BLKS_SCANNED,
+											 (heapScan->rs_cblock +
+											  heapScan->rs_nblocks -
+											  heapScan->rs_startblock) %
+											 heapScan->rs_nblocks + 1);
 		}
 
 		LockBuffer(buf, BUFFER_LOCK_SHARE);
@@ -986,12 +1047,27 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 
 		num_tuples += 1;
 		if (tuplesort != NULL)
+		{
 			tuplesort_putheaptuple(tuplesort, tuple);
+			pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_SCANNED,
+										 num_tuples);
+		}
 		else
+		{
+			const int	index[] = {
+				PROGRESS_CLUSTER_HEAP_TUPLES_SCANNED,
+				PROGRESS_CLUSTER_HEAP_TUPLES_WRITTEN
+			};
+			int64		val[2];
+
 			reform_and_rewrite_tuple(tuple,
 									 oldTupDesc, newTupDesc,
 									 values, isnull,
 									 NewHeap->rd_rel->relhasoids, rwstate);
+
+			val[0] = val[1] = num_tuples;
+			pgstat_progress_update_multi_param(2, index, val);
+		}
 	}
 
 	if (indexScan != NULL)
@@ -1005,8 +1081,16 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 	 */
 	if (tuplesort != NULL)
 	{
+		double		n_tuples = 0;
+
+		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+									 PROGRESS_CLUSTER_PHASE_SORT_TUPLES);
+
 		tuplesort_performsort(tuplesort);
 
+		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+									 PROGRESS_CLUSTER_PHASE_WRITE_NEW_HEAP);
+
 		for (;;)
 		{
 			HeapTuple	tuple;
@@ -1023,6 +1107,10 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
 									 values, isnull,
 									 NewHeap->rd_rel->relhasoids, rwstate);
 
+			n_tuples += 1;
+			pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_WRITTEN,
+										 n_tuples);
+
 			if (shouldfree)
 				heap_freetuple(tuple);
 		}
@@ -1081,7 +1169,7 @@ copy_heap_data(Oid OIDNewHeap, Oid OIDOldHeap, Oid OIDOldIndex,
  * their OIDs are emitted into mapped_tables[].  This is hacky but beats
  * having to look the information up again later in finish_heap_swap.
  */
-static void
+void
 swap_relation_files(Oid r1, Oid r2, bool target_is_pg_class,
 					bool swap_toast_by_content,
 					TransactionId frozenXid,
@@ -1396,6 +1484,10 @@ finish_heap_swap(Oid OIDOldHeap, Oid OIDNewHeap,
 	/* Zero out possible results from swapped_relation_files */
 	memset(mapped_tables, 0, sizeof(mapped_tables));
 
+	/* Report that we are now swapping relation files */
+	pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+								 PROGRESS_CLUSTER_PHASE_SWAP_REL_FILES);
+
 	/*
 	 * Swap the contents of the heap relations (including any toast tables).
 	 * Also set old heap's relfrozenxid to frozenXid.
@@ -1429,8 +1521,29 @@ finish_heap_swap(Oid OIDOldHeap, Oid OIDNewHeap,
 	reindex_flags = REINDEX_REL_SUPPRESS_INDEX_USE;
 	if (check_constraints)
 		reindex_flags |= REINDEX_REL_CHECK_CONSTRAINTS;
+
+	/* Report that we are now reindexing relations */
+	pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+								 PROGRESS_CLUSTER_PHASE_REBUILD_INDEX);
+
 	reindex_relation(OIDOldHeap, reindex_flags);
 
+	/* Report that we are now doing clean up */
+	pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+								 PROGRESS_CLUSTER_PHASE_FINAL_CLEANUP);
+
+	/*
+	 * Every row now contains all of the relation's columns, so the missing
+	 * values of the columns added without a rewrite are no longer needed.
+	 */
+	if (!is_system_catalog)
+	{
+		Relation	newrel = heap_open(OIDOldHeap, NoLock);
+
+		RelationClearMissing(newrel);
+		heap_close(newrel, NoLock);
+	}
+
 	/* Destroy new heap with old filenode */
 	object.classId = RelationRelationId;
 	object.objectId = OIDNewHeap;
@@ -82,8 +82,9 @@ CommentObject(CommentStmt *stmt)
 		case OBJECT_COLUMN:
 
 			/*
-			 * Allow comments only on columns of tables, views, composite
-			 * types, and foreign tables (which are the only relkinds for
+			 * Allow comments only on columns of tables, views, materialized
+			 * views, composite types, and foreign tables (which are the only
+			 * relkinds for
 			 * which pg_dump will dump per-column comments).  In particular we
 			 * wish to disallow comments on index columns, because the naming
 			 * of an index's columns may change across PG versions, so dumping
@@ -91,11 +92,12 @@ CommentObject(CommentStmt *stmt)
 			 */
 			if (relation->rd_rel->relkind != RELKIND_RELATION &&
 				relation->rd_rel->relkind != RELKIND_VIEW &&
+				relation->rd_rel->relkind != RELKIND_MATVIEW &&
 				relation->rd_rel->relkind != RELKIND_COMPOSITE_TYPE &&
 				relation->rd_rel->relkind != RELKIND_FOREIGN_TABLE)
 				ereport(ERROR,
 						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-						 errmsg("\"%s\" is not a table, view, composite type, or foreign table",
+						 errmsg("\"%s\" is not a table, view, materialized view, composite type, or foreign table",
 								RelationGetRelationName(relation))));
 			break;
 		default:
@@ -19,9 +19,13 @@
 #include <sys/stat.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "access/heapam.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_type.h"
@@ -88,6 +92,22 @@ typedef enum EolType
  * invoke pg_encoding_mblen() to skip over them. encoding_embeds_ascii is TRUE
  * when we have to do it the hard way.
  */
+/*
+ * In columnar format, the values of each output column are collected here
+ * until a whole row group can be sent.  COPY FROM reads each row group into
+ * the same structure before returning its rows.
+ */
+typedef struct CopyColumnChunk
+{
+	StringInfoData data;		/* send-function output of non-null values */
+	StringInfoData offsets;		/* end offset of each row's value in data,
+								 * as int32 in network byte order */
+	bits8	   *nullbitmap;		/* bit set where the row's value isn't null */
+	int32		width;			/* common length of the values, or -1 */
+	bool		any_values;		/* has there been a non-null value? */
+	int32		nvalues;		/* COPY FROM: non-null values returned so far */
+} CopyColumnChunk;
+
 typedef struct CopyStateData
 {
 	/* low-level state data */
@@ -107,6 +127,9 @@ typedef struct CopyStateData
 	List	   *attnumlist;		/* integer list of attnums to copy */
 	char	   *filename;		/* filename, or NULL for STDIN/STDOUT */
 	bool		binary;			/* binary format? */
+	bool		columnar;		/* column-chunked binary format? (implies
+								 * binary) */
+	int			row_group_size; /* rows per row group in columnar format */
 	bool		oids;			/* include OIDs? */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	bool		header_line;	/* CSV header line? */
@@ -121,6 +144,9 @@ typedef struct CopyStateData
 	bool	   *force_quote_flags;		/* per-column CSV FQ flags */
 	List	   *force_notnull;	/* list of column names */
 	bool	   *force_notnull_flags;	/* per-column CSV FNN flags */
+	bool		convert_selectively;	/* do selective binary conversion? */
+	List	   *convert_select; /* list of column names (can be NIL) */
+	bool	   *convert_select_flags;	/* per-column CS flags */
 
 	/* these are just for error messages, see CopyFromErrorCallback */
 	const char *cur_relname;	/* table name for error messages */
@@ -138,6 +164,9 @@ typedef struct CopyStateData
 	 */
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
 	MemoryContext rowcontext;	/* per-row evaluation context */
+	struct CopyColumnChunk *col_chunks; /* per-output-column row group
+										 * buffers, in columnar format */
+	int			group_rows;		/* rows in the current row group */
 
 	/*
 	 * Working state for COPY FROM
@@ -151,6 +180,9 @@ typedef struct CopyStateData
 	int		   *defmap;			/* array of default att numbers */
 	ExprState **defexprs;		/* array of default att expressions */
 	bool		volatile_defexprs; /* is any of defexprs volatile? */
+	int			group_next;		/* next row of the row group to return, in
+								 * columnar format (see also col_chunks,
+								 * group_rows and rowcontext) */
 
 	/*
 	 * These variables are used to reduce overhead in textual COPY FROM.
@@ -265,6 +297,10 @@ if (1) \
 } else ((void) 0)
 
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
+static const char ColumnarSignature[11] = "PGCOLS\n\377\r\n\0";
+
+/* default number of rows per row group in columnar format */
+#define DEFAULT_ROW_GROUP_SIZE	1024
 
 
 /* non-export function prototypes */
@@ -278,6 +314,8 @@ static uint64 DoCopyTo(CopyState cstate);
 static uint64 CopyTo(CopyState cstate);
 static void CopyOneRowTo(CopyState cstate, Oid tupleOid,
 			 Datum *values, bool *nulls);
+static void CopyOneRowToColumnar(CopyState cstate, Datum *values, bool *nulls);
+static void CopySendRowGroup(CopyState cstate);
 static uint64 CopyFrom(CopyState cstate);
 static void CopyFromInsertBatch(CopyState cstate, EState *estate,
 					CommandId mycid, int hi_options,
@@ -286,6 +324,8 @@ static void CopyFromInsertBatch(CopyState cstate, EState *estate,
 					int nBufferedTuples, HeapTuple *bufferedTuples);
 static bool CopyReadLine(CopyState cstate);
 static bool CopyReadLineText(CopyState cstate);
+static char *CopyScanSpecial(char *ptr, char *end,
+				const char *specials, int nspecials, bool stop_highbit);
 static int	CopyReadAttributesText(CopyState cstate);
 static int	CopyReadAttributesCSV(CopyState cstate);
 static Datum CopyReadBinaryAttribute(CopyState cstate,
@@ -313,6 +353,9 @@ static void CopySendInt32(CopyState cstate, int32 val);
 static bool CopyGetInt32(CopyState cstate, int32 *val);
 static void CopySendInt16(CopyState cstate, int16 val);
 static bool CopyGetInt16(CopyState cstate, int16 *val);
+static bool CopySkipData(CopyState cstate, int nbytes);
+static bool CopyReadRowGroup(CopyState cstate);
+static bool CopyFromColumnarRow(CopyState cstate, Datum *values, bool *nulls);
 
 
 /*
@@ -682,6 +725,39 @@ CopyGetInt16(CopyState cstate, int16 *val)
 	return true;
 }
 
+/*
+ * CopySkipData skips nbytes of input
+ *
+ * When reading a file we just seek past them, so that the skipped data
+ * needn't be read at all; otherwise they are read and thrown away.
+ *
+ * Returns true if OK, false if EOF.  (Seeking past the end of a file isn't
+ * noticed here, but the next read will fail.)
+ */
+static bool
+CopySkipData(CopyState cstate, int nbytes)
+{
+	if (nbytes <= 0)
+		return true;
+
+	/* fseek fails if the file is a pipe; fall back to reading then */
+	if (cstate->copy_dest == COPY_FILE &&
+		fseek(cstate->copy_file, (long) nbytes, SEEK_CUR) == 0)
+		return true;
+
+	resetStringInfo(&cstate->attribute_buf);
+	enlargeStringInfo(&cstate->attribute_buf, Min(nbytes, RAW_BUF_SIZE));
+	while (nbytes > 0)
+	{
+		int			n = Min(nbytes, RAW_BUF_SIZE);
+
+		if (CopyGetData(cstate, cstate->attribute_buf.data, n, n) != n)
+			return false;
+		nbytes -= n;
+	}
+	return true;
+}
+
 
 /*
  * CopyLoadRawBuf loads some more data into raw_buf
@@ -876,6 +952,11 @@ ProcessCopyOptions(CopyState cstate,
 				cstate->csv_mode = true;
 			else if (strcmp(fmt, "binary") == 0)
 				cstate->binary = true;
+			else if (strcmp(fmt, "columnar") == 0)
+			{
+				cstate->binary = true;
+				cstate->columnar = true;
+			}
 			else
 				ereport(ERROR,
 						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -959,6 +1040,44 @@ ProcessCopyOptions(CopyState cstate,
 						 errmsg("argument to option \"%s\" must be a list of column names",
 								defel->defname)));
 		}
+		else if (strcmp(defel->defname, "convert_selectively") == 0)
+		{
+			/*
+			 * Undocumented option, meant for callers of BeginCopyFrom such as
+			 * file_fdw: convert only the named columns to binary form,
+			 * storing the rest as NULLs.  It's allowed for the column list to
+			 * be NIL.  Binary-format input ignores it; columnar input skips
+			 * the other columns without reading them.
+			 */
+			if (cstate->convert_selectively)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			cstate->convert_selectively = true;
+			if (defel->arg == NULL || IsA(defel->arg, List))
+				cstate->convert_select = (List *) defel->arg;
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("argument to option \"%s\" must be a list of column names",
+								defel->defname)));
+		}
+		else if (strcmp(defel->defname, "row_group_size") == 0)
+		{
+			int64		size;
+
+			if (cstate->row_group_size > 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			size = defGetInt64(defel);
+			if (size < 1 || size > MaxAllocSize / sizeof(int32))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("argument to option \"%s\" must be a positive integer",
+								defel->defname)));
+			cstate->row_group_size = (int) size;
+		}
 		else if (strcmp(defel->defname, "encoding") == 0)
 		{
 			if (cstate->file_encoding >= 0)
@@ -1098,6 +1217,22 @@ ProcessCopyOptions(CopyState cstate,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 			  errmsg("COPY force not null only available using COPY FROM")));
 
+	/* Check columnar format */
+	if (cstate->columnar && cstate->oids)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot specify OIDS in COLUMNAR mode")));
+	if (!cstate->columnar && cstate->row_group_size > 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY row group size available only in COLUMNAR mode")));
+	if (cstate->row_group_size > 0 && is_from)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("COPY row group size only available using COPY TO")));
+	if (cstate->row_group_size == 0)
+		cstate->row_group_size = DEFAULT_ROW_GROUP_SIZE;
+
 	/* Don't allow the delimiter to appear in the null string. */
 	if (strchr(cstate->null_print, cstate->delim[0]) != NULL)
 		ereport(ERROR,
@@ -1303,6 +1438,32 @@ BeginCopy(bool is_from,
 		}
 	}
 
+	/* Convert convert_selectively name list to per-column flags */
+	if (cstate->convert_selectively)
+	{
+		cstate->convert_select_flags = (bool *) palloc0(num_phys_attrs * sizeof(bool));
+		if (cstate->convert_select)
+		{
+			List	   *attnums;
+			ListCell   *cur;
+
+			attnums = CopyGetAttnums(tupDesc, cstate->rel,
+									 cstate->convert_select);
+
+			foreach(cur, attnums)
+			{
+				int			attnum = lfirst_int(cur);
+
+				if (!list_member_int(cstate->attnumlist, attnum))
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_COLUMN_REFERENCE),
+							 errmsg_internal("selected column \"%s\" not referenced by COPY",
+							 NameStr(tupDesc->attrs[attnum - 1]->attname))));
+				cstate->convert_select_flags[attnum - 1] = true;
+			}
+		}
+	}
+
 	/* Use client encoding when ENCODING option is not specified. */
 	if (cstate->file_encoding < 0)
 		cstate->file_encoding = pg_get_client_encoding();
@@ -1356,7 +1517,8 @@ BeginCopyTo(Relation rel,
 	bool		pipe = (filename == NULL);
 	MemoryContext oldcontext;
 
-	if (rel != NULL && rel->rd_rel->relkind != RELKIND_RELATION)
+	if (rel != NULL && rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_MATVIEW)
 	{
 		if (rel->rd_rel->relkind == RELKIND_VIEW)
 			ereport(ERROR,
@@ -1536,7 +1698,42 @@ CopyTo(CopyState cstate)
 											   ALLOCSET_DEFAULT_INITSIZE,
 											   ALLOCSET_DEFAULT_MAXSIZE);
 
-	if (cstate->binary)
+	if (cstate->columnar)
+	{
+		/* Generate header for a columnar copy */
+		int			ncolumns = list_length(cstate->attnumlist);
+		int			i;
+
+		CopySendData(cstate, ColumnarSignature, 11);
+		/* Flags field, and no header extension */
+		CopySendInt32(cstate, 0);
+		CopySendInt32(cstate, 0);
+		/* Column count and types */
+		CopySendInt16(cstate, ncolumns);
+		foreach(cur, cstate->attnumlist)
+		{
+			int			attnum = lfirst_int(cur);
+
+			CopySendInt32(cstate, attr[attnum - 1]->atttypid);
+		}
+
+		/* Set up the row group buffers */
+		cstate->col_chunks = (CopyColumnChunk *)
+			palloc(ncolumns * sizeof(CopyColumnChunk));
+		for (i = 0; i < ncolumns; i++)
+		{
+			CopyColumnChunk *chunk = &cstate->col_chunks[i];
+
+			initStringInfo(&chunk->data);
+			initStringInfo(&chunk->offsets);
+			chunk->nullbitmap = (bits8 *)
+				palloc0(BITMAPLEN(cstate->row_group_size));
+			chunk->width = 0;
+			chunk->any_values = false;
+		}
+		cstate->group_rows = 0;
+	}
+	else if (cstate->binary)
 	{
 		/* Generate header for a binary copy */
 		int32		tmp;
@@ -1589,33 +1786,35 @@ CopyTo(CopyState cstate)
 
 	if (cstate->rel)
 	{
-		Datum	   *values;
-		bool	   *nulls;
-		HeapScanDesc scandesc;
-		HeapTuple	tuple;
-
-		values = (Datum *) palloc(num_phys_attrs * sizeof(Datum));
-		nulls = (bool *) palloc(num_phys_attrs * sizeof(bool));
+		TupleTableSlot *slot;
+		TableScanDesc scandesc;
 
-		scandesc = heap_beginscan(cstate->rel, GetActiveSnapshot(), 0, NULL);
+		slot = MakeSingleTupleTableSlot(tupDesc);
+		scandesc = GetTableAmRoutine(cstate->rel)->BeginTableScan(cstate->rel,
+													 GetActiveSnapshot(),
+																  0, NULL);
 
 		processed = 0;
-		while ((tuple = heap_getnext(scandesc, ForwardScanDirection)) != NULL)
+		while (scandesc->rs_tableam->IterateTableScan(scandesc,
+													  ForwardScanDirection,
+													  slot))
 		{
+			Oid			tupleOid = InvalidOid;
+
 			CHECK_FOR_INTERRUPTS();
 
 			/* Deconstruct the tuple ... faster than repeated heap_getattr */
-			heap_deform_tuple(tuple, tupDesc, values, nulls);
+			slot_getallattrs(slot);
+			if (cstate->oids)
+				tupleOid = HeapTupleGetOid(ExecFetchSlotTuple(slot));
 
 			/* Format and send the data */
-			CopyOneRowTo(cstate, HeapTupleGetOid(tuple), values, nulls);
+			CopyOneRowTo(cstate, tupleOid, slot->tts_values, slot->tts_isnull);
 			processed++;
 		}
 
-		heap_endscan(scandesc);
-
-		pfree(values);
-		pfree(nulls);
+		scandesc->rs_tableam->EndTableScan(scandesc);
+		ExecDropSingleTupleTableSlot(slot);
 	}
 	else
 	{
@@ -1624,7 +1823,14 @@ CopyTo(CopyState cstate)
 		processed = ((DR_copy *) cstate->queryDesc->dest)->processed;
 	}
 
-	if (cstate->binary)
+	if (cstate->columnar)
+	{
+		/* Send the last, partial row group, then the trailer */
+		CopySendRowGroup(cstate);
+		CopySendInt32(cstate, -1);
+		CopySendEndOfRow(cstate);
+	}
+	else if (cstate->binary)
 	{
 		/* Generate trailer for a binary copy */
 		CopySendInt16(cstate, -1);
@@ -1652,6 +1858,13 @@ CopyOneRowTo(CopyState cstate, Oid tupleOid, Datum *values, bool *nulls)
 	MemoryContextReset(cstate->rowcontext);
 	oldcontext = MemoryContextSwitchTo(cstate->rowcontext);
 
+	if (cstate->columnar)
+	{
+		CopyOneRowToColumnar(cstate, values, nulls);
+		MemoryContextSwitchTo(oldcontext);
+		return;
+	}
+
 	if (cstate->binary)
 	{
 		/* Binary per-tuple header */
@@ -1728,6 +1941,104 @@ CopyOneRowTo(CopyState cstate, Oid tupleOid, Datum *values, bool *nulls)
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Add one row to the current row group during a columnar CopyTo().
+ *
+ * Each value goes through the column's send function, as in binary format,
+ * but is appended to its column's buffer instead of the output: the row
+ * group is sent as a whole once row_group_size rows have been collected.
+ * Called in the per-row memory context.
+ */
+static void
+CopyOneRowToColumnar(CopyState cstate, Datum *values, bool *nulls)
+{
+	FmgrInfo   *out_functions = cstate->out_functions;
+	int			row = cstate->group_rows;
+	CopyColumnChunk *chunk = cstate->col_chunks;
+	ListCell   *cur;
+
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+		uint32		offset;
+
+		if (!nulls[attnum - 1])
+		{
+			bytea	   *outputbytes;
+			int32		len;
+
+			outputbytes = SendFunctionCall(&out_functions[attnum - 1],
+										   values[attnum - 1]);
+			len = VARSIZE(outputbytes) - VARHDRSZ;
+			appendBinaryStringInfo(&chunk->data, VARDATA(outputbytes), len);
+			chunk->nullbitmap[row >> 3] |= (1 << (row & 0x07));
+
+			/* keep track of whether all the values are the same width */
+			if (!chunk->any_values)
+			{
+				chunk->width = len;
+				chunk->any_values = true;
+			}
+			else if (chunk->width != len)
+				chunk->width = -1;
+		}
+
+		offset = htonl((uint32) chunk->data.len);
+		appendBinaryStringInfo(&chunk->offsets, (char *) &offset,
+							   sizeof(offset));
+		chunk++;
+	}
+
+	if (++cstate->group_rows >= cstate->row_group_size)
+		CopySendRowGroup(cstate);
+}
+
+/*
+ * Send the row group collected by CopyOneRowToColumnar, if any, and reset
+ * the column buffers for the next one.
+ *
+ * A row group is the row count, then for each column: the common width of
+ * its values or -1 if they vary, the null bitmap, the total length of the
+ * value data, the row offsets into that data if the width is -1, and the
+ * data itself.  Null values take no space in the data.
+ */
+static void
+CopySendRowGroup(CopyState cstate)
+{
+	int			nrows = cstate->group_rows;
+	CopyColumnChunk *chunk = cstate->col_chunks;
+	int			i;
+
+	if (nrows == 0)
+		return;
+
+	CopySendInt32(cstate, nrows);
+	for (i = 0; i < list_length(cstate->attnumlist); i++, chunk++)
+	{
+		int32		width = chunk->any_values ? chunk->width : 0;
+
+		CopySendInt32(cstate, width);
+		CopySendData(cstate, chunk->nullbitmap, BITMAPLEN(nrows));
+		CopySendInt32(cstate, chunk->data.len);
+		if (width < 0)
+		{
+			/* the offsets array starts with the start of the first value */
+			CopySendInt32(cstate, 0);
+			CopySendData(cstate, chunk->offsets.data, chunk->offsets.len);
+		}
+		CopySendData(cstate, chunk->data.data, chunk->data.len);
+
+		resetStringInfo(&chunk->data);
+		resetStringInfo(&chunk->offsets);
+		memset(chunk->nullbitmap, 0, BITMAPLEN(nrows));
+		chunk->width = 0;
+		chunk->any_values = false;
+	}
+	cstate->group_rows = 0;
+
+	CopySendEndOfRow(cstate);
+}
+
 
 /*
  * error context callback for COPY FROM
@@ -1845,6 +2156,7 @@ CopyFrom(CopyState cstate)
 	Datum	   *values;
 	bool	   *nulls;
 	ResultRelInfo *resultRelInfo;
+	const TableAmRoutine *tableam;
 	EState	   *estate = CreateExecutorState(); /* for ExecConstraints() */
 	ExprContext *econtext;
 	TupleTableSlot *myslot;
@@ -1870,6 +2182,12 @@ CopyFrom(CopyState cstate)
 					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 					 errmsg("cannot copy to view \"%s\"",
 							RelationGetRelationName(cstate->rel))));
+		else if (cstate->rel->rd_rel->relkind == RELKIND_MATVIEW)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("cannot copy to materialized view \"%s\"",
+							RelationGetRelationName(cstate->rel)),
+					 errhint("Use REFRESH MATERIALIZED VIEW to change its contents.")));
 		else if (cstate->rel->rd_rel->relkind == RELKIND_FOREIGN_TABLE)
 			ereport(ERROR,
 					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
@@ -1888,6 +2206,7 @@ CopyFrom(CopyState cstate)
 	}
 
 	tupDesc = RelationGetDescr(cstate->rel);
+	tableam = GetTableAmRoutine(cstate->rel);
 
 	/*----------
 	 * Check to see if we can avoid writing WAL
@@ -2083,11 +2402,12 @@ CopyFrom(CopyState cstate)
 				List	   *recheckIndexes = NIL;
 
 				/* OK, store the tuple and create index entries for it */
-				heap_insert(cstate->rel, tuple, mycid, hi_options, bistate);
+				tableam->InsertTableRow(cstate->rel, slot, mycid, hi_options,
+										bistate);
 
 				if (resultRelInfo->ri_NumIndices > 0)
 					recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
-														   estate);
+														   estate, false);
 
 				/* AFTER ROW INSERT Triggers */
 				ExecARInsertTriggers(estate, resultRelInfo, tuple,
@@ -2134,11 +2454,10 @@ CopyFrom(CopyState cstate)
 	FreeExecutorState(estate);
 
 	/*
-	 * If we skipped writing WAL, then we need to sync the heap (but not
-	 * indexes since those use WAL anyway)
+	 * Let the access method finish up; if we skipped writing WAL, the heap
+	 * needs to be synced (but not indexes since those use WAL anyway)
 	 */
-	if (hi_options & HEAP_INSERT_SKIP_WAL)
-		heap_sync(cstate->rel);
+	tableam->FinishBulkInsert(cstate->rel, hi_options);
 
 	return processed;
 }
@@ -2162,12 +2481,12 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 	 * context before calling it.
 	 */
 	oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	heap_multi_insert(cstate->rel,
-					  bufferedTuples,
-					  nBufferedTuples,
-					  mycid,
-					  hi_options,
-					  bistate);
+	GetTableAmRoutine(cstate->rel)->MultiInsertTableRows(cstate->rel,
+														 bufferedTuples,
+														 nBufferedTuples,
+														 mycid,
+														 hi_options,
+														 bistate);
 	MemoryContextSwitchTo(oldcontext);
 
 	/*
@@ -2183,7 +2502,7 @@ CopyFromInsertBatch(CopyState cstate, EState *estate, CommandId mycid,
 			ExecStoreTuple(bufferedTuples[i], myslot, InvalidBuffer, false);
 			recheckIndexes =
 				ExecInsertIndexTuples(myslot, &(bufferedTuples[i]->t_self),
-									  estate);
+									  estate, false);
 			ExecARInsertTriggers(estate, resultRelInfo,
 								 bufferedTuples[i],
 								 recheckIndexes);
@@ -2346,6 +2665,74 @@ BeginCopyFrom(Relation rel,
 		/* must rely on user to tell us... */
 		cstate->file_has_oids = cstate->oids;
 	}
+	else if (cstate->columnar)
+	{
+		/* Read and verify columnar header */
+		char		readSig[11];
+		int32		tmp;
+		int16		ncolumns;
+		int			i;
+
+		/* Signature */
+		if (CopyGetData(cstate, readSig, 11, 11) != 11 ||
+			memcmp(readSig, ColumnarSignature, 11) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("COPY file signature not recognized")));
+		/* Flags field; no flags are defined yet */
+		if (!CopyGetInt32(cstate, &tmp))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid COPY file header (missing flags)")));
+		if ((tmp >> 16) != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("unrecognized critical flags in COPY file header")));
+		/* Header extension length, and extension to skip */
+		if (!CopyGetInt32(cstate, &tmp) ||
+			tmp < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid COPY file header (missing length)")));
+		if (!CopySkipData(cstate, tmp))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid COPY file header (wrong length)")));
+
+		/*
+		 * Column count and types.  As in binary format, the types aren't
+		 * checked: the receive functions will complain about data they
+		 * can't read.
+		 */
+		if (!CopyGetInt16(cstate, &ncolumns) ||
+			!CopySkipData(cstate, ncolumns * sizeof(int32)))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid COPY file header (missing column types)")));
+		if (ncolumns != list_length(cstate->attnumlist))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("COPY file has %d columns, expected %d",
+							(int) ncolumns,
+							list_length(cstate->attnumlist))));
+		cstate->file_has_oids = false;
+
+		/* Set up the row group buffers */
+		cstate->col_chunks = (CopyColumnChunk *)
+			palloc(ncolumns * sizeof(CopyColumnChunk));
+		for (i = 0; i < ncolumns; i++)
+		{
+			initStringInfo(&cstate->col_chunks[i].data);
+			initStringInfo(&cstate->col_chunks[i].offsets);
+		}
+		cstate->rowcontext = AllocSetContextCreate(CurrentMemoryContext,
+												   "COPY FROM row group",
+												   ALLOCSET_DEFAULT_MINSIZE,
+												   ALLOCSET_DEFAULT_INITSIZE,
+												   ALLOCSET_DEFAULT_MAXSIZE);
+		cstate->group_rows = 0;
+		cstate->group_next = 0;
+	}
 	else
 	{
 		/* Read and verify binary header */
@@ -2559,6 +2946,13 @@ NextCopyFrom(CopyState cstate, ExprContext *econtext,
 								NameStr(attr[m]->attname))));
 			string = field_strings[fieldno++];
 
+			if (cstate->convert_select_flags &&
+				!cstate->convert_select_flags[m])
+			{
+				/* ignore input field, leaving column as NULL */
+				continue;
+			}
+
 			if (cstate->csv_mode && string == NULL &&
 				cstate->force_notnull_flags[m])
 			{
@@ -2580,6 +2974,11 @@ NextCopyFrom(CopyState cstate, ExprContext *econtext,
 
 		Assert(fieldno == nfields);
 	}
+	else if (cstate->columnar)
+	{
+		if (!CopyFromColumnarRow(cstate, values, nulls))
+			return false;
+	}
 	else
 	{
 		/* binary */
@@ -2684,6 +3083,222 @@ NextCopyFrom(CopyState cstate, ExprContext *econtext,
 	return true;
 }
 
+/*
+ * Read the next row group of a columnar COPY FROM into the column buffers.
+ *
+ * Columns that convert_selectively doesn't ask for are skipped, without
+ * being read at all if the input is a file.  Returns false at the end of
+ * the data.
+ */
+static bool
+CopyReadRowGroup(CopyState cstate)
+{
+	int32		nrows;
+	CopyColumnChunk *chunk = cstate->col_chunks;
+	ListCell   *cur;
+
+	cstate->group_rows = 0;
+	cstate->group_next = 0;
+	MemoryContextReset(cstate->rowcontext);
+
+	/* Unlike binary format, the trailer is required */
+	if (!CopyGetInt32(cstate, &nrows))
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("unexpected EOF in COPY data")));
+
+	if (nrows == -1)
+	{
+		/* Received EOF marker; see the comments in NextCopyFrom */
+		char		dummy;
+
+		if (cstate->copy_dest != COPY_OLD_FE &&
+			CopyGetData(cstate, &dummy, 1, 1) > 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("received copy data after EOF marker")));
+		return false;
+	}
+	if (nrows <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("invalid row count in COPY row group")));
+
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+		bool		wanted;
+		int32		width;
+		int32		datalen;
+		int			bitmaplen = BITMAPLEN(nrows);
+		int			offsetslen;
+
+		wanted = (cstate->convert_select_flags == NULL ||
+				  cstate->convert_select_flags[attnum - 1]);
+
+		if (!CopyGetInt32(cstate, &width))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in COPY data")));
+		if (width < -1)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid field size")));
+		offsetslen = (width < 0) ? (nrows + 1) * sizeof(int32) : 0;
+
+		/* The null bitmap */
+		if (wanted)
+		{
+			chunk->nullbitmap = (bits8 *)
+				MemoryContextAlloc(cstate->rowcontext, bitmaplen);
+			if (CopyGetData(cstate, chunk->nullbitmap,
+							bitmaplen, bitmaplen) != bitmaplen)
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("unexpected EOF in COPY data")));
+		}
+		else if (!CopySkipData(cstate, bitmaplen))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in COPY data")));
+
+		/* The length of the value data, then the offsets and the data */
+		if (!CopyGetInt32(cstate, &datalen))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in COPY data")));
+		if (datalen < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid field size")));
+
+		if (wanted)
+		{
+			resetStringInfo(&chunk->offsets);
+			enlargeStringInfo(&chunk->offsets, offsetslen);
+			if (CopyGetData(cstate, chunk->offsets.data,
+							offsetslen, offsetslen) != offsetslen)
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("unexpected EOF in COPY data")));
+			chunk->offsets.len = offsetslen;
+
+			resetStringInfo(&chunk->data);
+			enlargeStringInfo(&chunk->data, datalen);
+			if (CopyGetData(cstate, chunk->data.data,
+							datalen, datalen) != datalen)
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("unexpected EOF in COPY data")));
+			chunk->data.len = datalen;
+		}
+		else if (!CopySkipData(cstate, offsetslen) ||
+				 !CopySkipData(cstate, datalen))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("unexpected EOF in COPY data")));
+
+		chunk->width = width;
+		chunk->nvalues = 0;
+		chunk++;
+	}
+
+	cstate->group_rows = nrows;
+	return true;
+}
+
+/*
+ * Return the next row of a columnar COPY FROM, reading the next row group
+ * first if the current one is used up.  Returns false at the end of the
+ * data.
+ */
+static bool
+CopyFromColumnarRow(CopyState cstate, Datum *values, bool *nulls)
+{
+	Form_pg_attribute *attr = RelationGetDescr(cstate->rel)->attrs;
+	CopyColumnChunk *chunk = cstate->col_chunks;
+	ListCell   *cur;
+	int			row;
+
+	if (cstate->group_next >= cstate->group_rows &&
+		!CopyReadRowGroup(cstate))
+		return false;
+
+	row = cstate->group_next++;
+	cstate->cur_lineno++;
+
+	foreach(cur, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(cur);
+		int			m = attnum - 1;
+		FmgrInfo   *flinfo = &cstate->in_functions[m];
+		Oid			typioparam = cstate->typioparams[m];
+		int32		start;
+		int32		end;
+
+		/* A column we didn't read is left NULL */
+		if (cstate->convert_select_flags && !cstate->convert_select_flags[m])
+		{
+			chunk++;
+			continue;
+		}
+
+		cstate->cur_attname = NameStr(attr[m]->attname);
+
+		if ((chunk->nullbitmap[row >> 3] & (1 << (row & 0x07))) == 0)
+		{
+			values[m] = ReceiveFunctionCall(flinfo, NULL, typioparam,
+											attr[m]->atttypmod);
+			nulls[m] = true;
+			cstate->cur_attname = NULL;
+			chunk++;
+			continue;
+		}
+
+		/* Find the value in the column's data */
+		if (chunk->width >= 0)
+		{
+			start = chunk->nvalues * chunk->width;
+			end = start + chunk->width;
+		}
+		else
+		{
+			uint32		offsets[2];
+
+			memcpy(offsets, chunk->offsets.data + row * sizeof(uint32),
+				   sizeof(offsets));
+			start = (int32) ntohl(offsets[0]);
+			end = (int32) ntohl(offsets[1]);
+		}
+		if (start < 0 || end < start || end > chunk->data.len)
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("invalid field size")));
+		chunk->nvalues++;
+
+		/* Copy it to attribute_buf, so that it's null-terminated */
+		resetStringInfo(&cstate->attribute_buf);
+		appendBinaryStringInfo(&cstate->attribute_buf,
+							   chunk->data.data + start, end - start);
+
+		/* Call the column type's binary input converter */
+		values[m] = ReceiveFunctionCall(flinfo, &cstate->attribute_buf,
+										typioparam, attr[m]->atttypmod);
+
+		/* Trouble if it didn't eat the whole value */
+		if (cstate->attribute_buf.cursor != cstate->attribute_buf.len)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+					 errmsg("incorrect binary data format")));
+
+		nulls[m] = false;
+		cstate->cur_attname = NULL;
+		chunk++;
+	}
+
+	return true;
+}
+
 /*
  * Clean up storage and release resources for COPY FROM.
  */
@@ -2809,6 +3424,10 @@ CopyReadLineText(CopyState cstate)
 	char		quotec = '\0';
 	char		escapec = '\0';
 
+	/* bytes that end a run of ordinary line content */
+	char		specials[5];
+	int			nspecials = 0;
+
 	if (cstate->csv_mode)
 	{
 		quotec = cstate->quote[0];
@@ -2818,6 +3437,16 @@ CopyReadLineText(CopyState cstate)
 			escapec = '\0';
 	}
 
+	specials[nspecials++] = '\n';
+	specials[nspecials++] = '\r';
+	specials[nspecials++] = '\\';
+	if (cstate->csv_mode)
+	{
+		specials[nspecials++] = quotec;
+		if (escapec != '\0')
+			specials[nspecials++] = escapec;
+	}
+
 	mblen_str[1] = '\0';
 
 	/*
@@ -2885,6 +3514,32 @@ CopyReadLineText(CopyState cstate)
 			need_data = false;
 		}
 
+		/*
+		 * Only a handful of byte values mean anything to the code below: \r,
+		 * \n and backslash, the CSV quote and escape characters, and the
+		 * lead byte of a multibyte character in an encoding that can embed
+		 * ASCII bytes.  Runs of anything else are part of the line whatever
+		 * they contain, so step over them in bulk rather than going around
+		 * the whole state machine once per byte.
+		 */
+		{
+			char	   *run_end;
+
+			run_end = CopyScanSpecial(copy_raw_buf + raw_buf_ptr,
+									  copy_raw_buf + copy_buf_len,
+									  specials, nspecials,
+									  cstate->encoding_embeds_ascii);
+			if (run_end > copy_raw_buf + raw_buf_ptr)
+			{
+				raw_buf_ptr = run_end - copy_raw_buf;
+				first_char_in_line = false;
+				last_was_esc = false;
+			}
+			/* ran off the end of the buffer: go back to load more */
+			if (raw_buf_ptr >= copy_buf_len)
+				continue;
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -3147,6 +3802,93 @@ not_end_of_copy:
 	return result;
 }
 
+/*
+ * Return a pointer to the first byte in [ptr, end) that is one of the
+ * nspecials characters in specials[], or that has its high bit set if
+ * stop_highbit is true; return end if there is no such byte.
+ *
+ * COPY FROM spends much of its time looking for the few interesting bytes
+ * in long runs of plain data, so this examines a whole vector register (or,
+ * without SSE2, a 64-bit word) at a time, and only drops to byte-at-a-time
+ * comparisons for the block containing the first hit and the tail.
+ */
+static char *
+CopyScanSpecial(char *ptr, char *end,
+				const char *specials, int nspecials, bool stop_highbit)
+{
+	int			i;
+
+#ifdef __SSE2__
+	__m128i		vspecials[5];
+
+	Assert(nspecials <= lengthof(vspecials));
+	for (i = 0; i < nspecials; i++)
+		vspecials[i] = _mm_set1_epi8(specials[i]);
+
+	while (end - ptr >= (int) sizeof(__m128i))
+	{
+		__m128i		chunk = _mm_loadu_si128((const __m128i *) ptr);
+		__m128i		hits;
+
+		/* movemask looks at the high bit of each byte */
+		hits = stop_highbit ? chunk : _mm_setzero_si128();
+		for (i = 0; i < nspecials; i++)
+			hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, vspecials[i]));
+		if (_mm_movemask_epi8(hits) != 0)
+			break;
+		ptr += sizeof(__m128i);
+	}
+#else
+#define WORD_ONES	UINT64CONST(0x0101010101010101)
+#define WORD_HIGHS	UINT64CONST(0x8080808080808080)
+	uint64		wspecials[5];
+
+	Assert(nspecials <= lengthof(wspecials));
+	for (i = 0; i < nspecials; i++)
+		wspecials[i] = WORD_ONES * (unsigned char) specials[i];
+
+	while (end - ptr >= (int) sizeof(uint64))
+	{
+		uint64		word;
+		uint64		hits;
+
+		memcpy(&word, ptr, sizeof(uint64));
+		hits = stop_highbit ? word : 0;
+
+		/*
+		 * A byte of word ^ wspecials[i] is zero where the input matches.  The
+		 * classic has-zero-byte test can also flag a byte above a real match,
+		 * but never produces a hit where there is none, which is all we need.
+		 */
+		for (i = 0; i < nspecials; i++)
+		{
+			uint64		x = word ^ wspecials[i];
+
+			hits |= (x - WORD_ONES) & ~x;
+		}
+		if ((hits & WORD_HIGHS) != 0)
+			break;
+		ptr += sizeof(uint64);
+	}
+#undef WORD_ONES
+#undef WORD_HIGHS
+#endif
+
+	for (; ptr < end; ptr++)
+	{
+		char		c = *ptr;
+
+		if (stop_highbit && IS_HIGHBIT_SET(c))
+			return ptr;
+		for (i = 0; i < nspecials; i++)
+		{
+			if (c == specials[i])
+				return ptr;
+		}
+	}
+	return end;
+}
+
 /*
  *	Return decimal value for a hexadecimal digit
  */
@@ -3182,6 +3924,7 @@ static int
 CopyReadAttributesText(CopyState cstate)
 {
 	char		delimc = cstate->delim[0];
+	char		specials[2];
 	int			fieldno;
 	char	   *output_ptr;
 	char	   *cur_ptr;
@@ -3217,6 +3960,10 @@ CopyReadAttributesText(CopyState cstate)
 	cur_ptr = cstate->line_buf.data;
 	line_end_ptr = cstate->line_buf.data + cstate->line_buf.len;
 
+	/* bytes needing attention while scanning a field */
+	specials[0] = delimc;
+	specials[1] = '\\';
+
 	/* Outer loop iterates over fields */
 	fieldno = 0;
 	for (;;)
@@ -3243,6 +3990,17 @@ CopyReadAttributesText(CopyState cstate)
 		for (;;)
 		{
 			char		c;
+			char	   *run_end;
+
+			/* copy any run of bytes needing no de-escaping in one go */
+			run_end = CopyScanSpecial(cur_ptr, line_end_ptr, specials, 2,
+									  false);
+			if (run_end > cur_ptr)
+			{
+				memcpy(output_ptr, cur_ptr, run_end - cur_ptr);
+				output_ptr += run_end - cur_ptr;
+				cur_ptr = run_end;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -3399,6 +4157,8 @@ CopyReadAttributesCSV(CopyState cstate)
 	char		delimc = cstate->delim[0];
 	char		quotec = cstate->quote[0];
 	char		escapec = cstate->escape[0];
+	char		unquoted_specials[2];
+	char		quoted_specials[2];
 	int			fieldno;
 	char	   *output_ptr;
 	char	   *cur_ptr;
@@ -3434,6 +4194,12 @@ CopyReadAttributesCSV(CopyState cstate)
 	cur_ptr = cstate->line_buf.data;
 	line_end_ptr = cstate->line_buf.data + cstate->line_buf.len;
 
+	/* bytes needing attention outside and inside quotes, respectively */
+	unquoted_specials[0] = delimc;
+	unquoted_specials[1] = quotec;
+	quoted_specials[0] = escapec;
+	quoted_specials[1] = quotec;
+
 	/* Outer loop iterates over fields */
 	fieldno = 0;
 	for (;;)
@@ -3470,6 +4236,17 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* Not in quote */
 			for (;;)
 			{
+				char	   *run_end;
+
+				run_end = CopyScanSpecial(cur_ptr, line_end_ptr,
+										  unquoted_specials, 2, false);
+				if (run_end > cur_ptr)
+				{
+					memcpy(output_ptr, cur_ptr, run_end - cur_ptr);
+					output_ptr += run_end - cur_ptr;
+					cur_ptr = run_end;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -3493,6 +4270,17 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* In quote */
 			for (;;)
 			{
+				char	   *run_end;
+
+				run_end = CopyScanSpecial(cur_ptr, line_end_ptr,
+										  quoted_specials, 2, false);
+				if (run_end > cur_ptr)
+				{
+					memcpy(output_ptr, cur_ptr, run_end - cur_ptr);
+					output_ptr += run_end - cur_ptr;
+					cur_ptr = run_end;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -51,6 +51,7 @@
 #include "storage/smgr.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_locale.h"
 #include "utils/snapmgr.h"
@@ -846,6 +847,14 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	pgstat_drop_database(db_id);
 
+	/*
+	 * Likewise empty the shared catalog cache, so that a new database that
+	 * gets the same OID doesn't find this one's catalog rows there.  No
+	 * session can be connected to the database by now, so none can enter
+	 * more.
+	 */
+	SharedCatCacheFlush();
+
 	/*
 	 * Tell checkpointer to forget any pending fsync and unlink requests for files
 	 * in the database; else the fsyncs will fail at next checkpoint, or
@@ -22,6 +22,7 @@
 #include "optimizer/clauses.h"
 #include "parser/parsetree.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/bufmgr.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -71,10 +72,12 @@ static void show_sort_keys(SortState *sortstate, List *ancestors,
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 					   ExplainState *es);
 static void show_sort_keys_common(PlanState *planstate,
-					  int nkeys, AttrNumber *keycols,
+					  int nkeys, int npresorted, AttrNumber *keycols,
 					  List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_material_cache_info(MaterialState *mstate, List *ancestors,
+						 ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
 						   PlanState *planstate, ExplainState *es);
 static void show_foreignscan_info(ForeignScanState *fsstate, ExplainState *es);
@@ -84,7 +87,7 @@ static void ExplainIndexScanDetails(Oid indexid, ScanDirection indexorderdir,
 static void ExplainScanTarget(Scan *plan, ExplainState *es);
 static void ExplainModifyTarget(ModifyTable *plan, ExplainState *es);
 static void ExplainTargetRel(Plan *plan, Index rti, ExplainState *es);
-static void ExplainMemberNodes(List *plans, PlanState **planstates,
+static void ExplainMemberNodes(PlanState **planstates, int nplans,
 				   List *ancestors, ExplainState *es);
 static void ExplainSubPlans(List *plans, List *ancestors,
 				const char *relationship, ExplainState *es);
@@ -116,6 +119,7 @@ ExplainQuery(ExplainStmt *stmt, const char *queryString,
 	TupOutputState *tstate;
 	List	   *rewritten;
 	ListCell   *lc;
+	bool		timing_set = false;
 
 	/* Initialize ExplainState. */
 	ExplainInitState(&es);
@@ -133,6 +137,11 @@ ExplainQuery(ExplainStmt *stmt, const char *queryString,
 			es.costs = defGetBoolean(opt);
 		else if (strcmp(opt->defname, "buffers") == 0)
 			es.buffers = defGetBoolean(opt);
+		else if (strcmp(opt->defname, "timing") == 0)
+		{
+			timing_set = true;
+			es.timing = defGetBoolean(opt);
+		}
 		else if (strcmp(opt->defname, "format") == 0)
 		{
 			char	   *p = defGetString(opt);
@@ -163,6 +172,15 @@ ExplainQuery(ExplainStmt *stmt, const char *queryString,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("EXPLAIN option BUFFERS requires ANALYZE")));
 
+	/* if the timing was not set explicitly, set default value */
+	es.timing = (timing_set) ? es.timing : es.analyze;
+
+	/* check that timing is used with EXPLAIN ANALYZE */
+	if (es.timing && !es.analyze)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("EXPLAIN option TIMING requires ANALYZE")));
+
 	/*
 	 * Parse analysis was done already, but we still have to run the rule
 	 * rewriter.  We do not do AcquireRewriteLocks: we assume the query either
@@ -355,8 +373,11 @@ ExplainOnePlan(PlannedStmt *plannedstmt, ExplainState *es,
 	int			eflags;
 	int			instrument_option = 0;
 
-	if (es->analyze)
+	if (es->analyze && es->timing)
 		instrument_option |= INSTRUMENT_TIMER;
+	else if (es->analyze)
+		instrument_option |= INSTRUMENT_ROWS;
+
 	if (es->buffers)
 		instrument_option |= INSTRUMENT_BUFFERS;
 
@@ -541,8 +562,11 @@ report_triggers(ResultRelInfo *rInfo, bool show_relname, ExplainState *es)
 				appendStringInfo(es->str, " for constraint %s", conname);
 			if (show_relname)
 				appendStringInfo(es->str, " on %s", relname);
-			appendStringInfo(es->str, ": time=%.3f calls=%.0f\n",
-							 1000.0 * instr->total, instr->ntuples);
+			if (es->timing)
+				appendStringInfo(es->str, ": time=%.3f calls=%.0f\n",
+								 1000.0 * instr->total, instr->ntuples);
+			else
+				appendStringInfo(es->str, ": calls=%.0f\n", instr->ntuples);
 		}
 		else
 		{
@@ -550,7 +574,8 @@ report_triggers(ResultRelInfo *rInfo, bool show_relname, ExplainState *es)
 			if (conname)
 				ExplainPropertyText("Constraint Name", conname, es);
 			ExplainPropertyText("Relation", relname, es);
-			ExplainPropertyFloat("Time", 1000.0 * instr->total, 3, es);
+			if (es->timing)
+				ExplainPropertyFloat("Time", 1000.0 * instr->total, 3, es);
 			ExplainPropertyFloat("Calls", instr->ntuples, 0, es);
 		}
 
@@ -803,9 +828,13 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_ValuesScan:
 		case T_CteScan:
 		case T_WorkTableScan:
-		case T_ForeignScan:
 			ExplainScanTarget((Scan *) plan, es);
 			break;
+		case T_ForeignScan:
+			/* a remote join or grouping has no single scan target */
+			if (((Scan *) plan)->scanrelid > 0)
+				ExplainScanTarget((Scan *) plan, es);
+			break;
 		case T_IndexScan:
 			{
 				IndexScan  *indexscan = (IndexScan *) plan;
@@ -951,14 +980,22 @@ ExplainNode(PlanState *planstate, List *ancestors,
 
 		if (es->format == EXPLAIN_FORMAT_TEXT)
 		{
-			appendStringInfo(es->str,
-							 " (actual time=%.3f..%.3f rows=%.0f loops=%.0f)",
-							 startup_sec, total_sec, rows, nloops);
+			if (es->timing)
+				appendStringInfo(es->str,
+							" (actual time=%.3f..%.3f rows=%.0f loops=%.0f)",
+								 startup_sec, total_sec, rows, nloops);
+			else
+				appendStringInfo(es->str,
+								 " (actual rows=%.0f loops=%.0f)",
+								 rows, nloops);
 		}
 		else
 		{
-			ExplainPropertyFloat("Actual Startup Time", startup_sec, 3, es);
-			ExplainPropertyFloat("Actual Total Time", total_sec, 3, es);
+			if (es->timing)
+			{
+				ExplainPropertyFloat("Actual Startup Time", startup_sec, 3, es);
+				ExplainPropertyFloat("Actual Total Time", total_sec, 3, es);
+			}
 			ExplainPropertyFloat("Actual Rows", rows, 0, es);
 			ExplainPropertyFloat("Actual Loops", nloops, 0, es);
 		}
@@ -969,8 +1006,11 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			appendStringInfo(es->str, " (never executed)");
 		else
 		{
-			ExplainPropertyFloat("Actual Startup Time", 0.0, 3, es);
-			ExplainPropertyFloat("Actual Total Time", 0.0, 3, es);
+			if (es->timing)
+			{
+				ExplainPropertyFloat("Actual Startup Time", 0.0, 3, es);
+				ExplainPropertyFloat("Actual Total Time", 0.0, 3, es);
+			}
 			ExplainPropertyFloat("Actual Rows", 0.0, 0, es);
 			ExplainPropertyFloat("Actual Loops", 0.0, 0, es);
 		}
@@ -1069,6 +1109,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_foreignscan_info((ForeignScanState *) planstate, es);
 			break;
 		case T_NestLoop:
+			if (es->verbose)
+				ExplainPropertyText("Inner Unique",
+									((Join *) plan)->inner_unique ?
+									"true" : "false", es);
 			show_upper_qual(((NestLoop *) plan)->join.joinqual,
 							"Join Filter", planstate, ancestors, es);
 			if (((NestLoop *) plan)->join.joinqual)
@@ -1080,6 +1124,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 										   planstate, es);
 			break;
 		case T_MergeJoin:
+			if (es->verbose)
+				ExplainPropertyText("Inner Unique",
+									((Join *) plan)->inner_unique ?
+									"true" : "false", es);
 			show_upper_qual(((MergeJoin *) plan)->mergeclauses,
 							"Merge Cond", planstate, ancestors, es);
 			show_upper_qual(((MergeJoin *) plan)->join.joinqual,
@@ -1093,6 +1141,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 										   planstate, es);
 			break;
 		case T_HashJoin:
+			if (es->verbose)
+				ExplainPropertyText("Inner Unique",
+									((Join *) plan)->inner_unique ?
+									"true" : "false", es);
 			show_upper_qual(((HashJoin *) plan)->hashclauses,
 							"Hash Cond", planstate, ancestors, es);
 			show_upper_qual(((HashJoin *) plan)->join.joinqual,
@@ -1116,9 +1168,17 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_sort_keys((SortState *) planstate, ancestors, es);
 			show_sort_info((SortState *) planstate, es);
 			break;
+		case T_Append:
+			if (((AppendState *) planstate)->as_nremoved > 0)
+				ExplainPropertyInteger("Subplans Removed",
+								((AppendState *) planstate)->as_nremoved, es);
+			break;
 		case T_MergeAppend:
 			show_merge_append_keys((MergeAppendState *) planstate,
 								   ancestors, es);
+			if (((MergeAppendState *) planstate)->ms_nremoved > 0)
+				ExplainPropertyInteger("Subplans Removed",
+							((MergeAppendState *) planstate)->ms_nremoved, es);
 			break;
 		case T_Result:
 			show_upper_qual((List *) ((Result *) plan)->resconstantqual,
@@ -1131,6 +1191,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Hash:
 			show_hash_info((HashState *) planstate, es);
 			break;
+		case T_Material:
+			show_material_cache_info((MaterialState *) planstate,
+									 ancestors, es);
+			break;
 		default:
 			break;
 	}
@@ -1149,7 +1213,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 									 usage->local_blks_read > 0 ||
 									 usage->local_blks_written);
 			bool		has_temp = (usage->temp_blks_read > 0 ||
-									usage->temp_blks_written);
+									usage->temp_blks_written ||
+									usage->temp_files > 0);
+			bool		has_timing = (!INSTR_TIME_IS_ZERO(usage->blk_read_time) ||
+									  !INSTR_TIME_IS_ZERO(usage->blk_write_time));
 
 			/* Show only positive counter values. */
 			if (has_shared || has_local || has_temp)
@@ -1196,9 +1263,26 @@ ExplainNode(PlanState *planstate, List *ancestors,
 					if (usage->temp_blks_written > 0)
 						appendStringInfo(es->str, " written=%ld",
 										 usage->temp_blks_written);
+					if (usage->temp_files > 0)
+						appendStringInfo(es->str, " files=%ld",
+										 usage->temp_files);
 				}
 				appendStringInfoChar(es->str, '\n');
 			}
+
+			/* As above, show only positive counter values. */
+			if (has_timing)
+			{
+				appendStringInfoSpaces(es->str, es->indent * 2);
+				appendStringInfoString(es->str, "I/O Timings:");
+				if (!INSTR_TIME_IS_ZERO(usage->blk_read_time))
+					appendStringInfo(es->str, " read=%0.3f",
+							  INSTR_TIME_GET_MILLISEC(usage->blk_read_time));
+				if (!INSTR_TIME_IS_ZERO(usage->blk_write_time))
+					appendStringInfo(es->str, " write=%0.3f",
+							 INSTR_TIME_GET_MILLISEC(usage->blk_write_time));
+				appendStringInfoChar(es->str, '\n');
+			}
 		}
 		else
 		{
@@ -1210,6 +1294,12 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			ExplainPropertyLong("Local Written Blocks", usage->local_blks_written, es);
 			ExplainPropertyLong("Temp Read Blocks", usage->temp_blks_read, es);
 			ExplainPropertyLong("Temp Written Blocks", usage->temp_blks_written, es);
+			ExplainPropertyLong("Temp Files", usage->temp_files, es);
+			if (track_io_timing)
+			{
+				ExplainPropertyFloat("I/O Read Time", INSTR_TIME_GET_MILLISEC(usage->blk_read_time), 3, es);
+				ExplainPropertyFloat("I/O Write Time", INSTR_TIME_GET_MILLISEC(usage->blk_write_time), 3, es);
+			}
 		}
 	}
 
@@ -1249,28 +1339,28 @@ ExplainNode(PlanState *planstate, List *ancestors,
 	switch (nodeTag(plan))
 	{
 		case T_ModifyTable:
-			ExplainMemberNodes(((ModifyTable *) plan)->plans,
-							   ((ModifyTableState *) planstate)->mt_plans,
+			ExplainMemberNodes(((ModifyTableState *) planstate)->mt_plans,
+							   list_length(((ModifyTable *) plan)->plans),
 							   ancestors, es);
 			break;
 		case T_Append:
-			ExplainMemberNodes(((Append *) plan)->appendplans,
-							   ((AppendState *) planstate)->appendplans,
+			ExplainMemberNodes(((AppendState *) planstate)->appendplans,
+							   ((AppendState *) planstate)->as_nplans,
 							   ancestors, es);
 			break;
 		case T_MergeAppend:
-			ExplainMemberNodes(((MergeAppend *) plan)->mergeplans,
-							   ((MergeAppendState *) planstate)->mergeplans,
+			ExplainMemberNodes(((MergeAppendState *) planstate)->mergeplans,
+							   ((MergeAppendState *) planstate)->ms_nplans,
 							   ancestors, es);
 			break;
 		case T_BitmapAnd:
-			ExplainMemberNodes(((BitmapAnd *) plan)->bitmapplans,
-							   ((BitmapAndState *) planstate)->bitmapplans,
+			ExplainMemberNodes(((BitmapAndState *) planstate)->bitmapplans,
+							   list_length(((BitmapAnd *) plan)->bitmapplans),
 							   ancestors, es);
 			break;
 		case T_BitmapOr:
-			ExplainMemberNodes(((BitmapOr *) plan)->bitmapplans,
-							   ((BitmapOrState *) planstate)->bitmapplans,
+			ExplainMemberNodes(((BitmapOrState *) planstate)->bitmapplans,
+							   list_length(((BitmapOr *) plan)->bitmapplans),
 							   ancestors, es);
 			break;
 		case T_SubqueryScan:
@@ -1426,7 +1516,9 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 	Sort	   *plan = (Sort *) sortstate->ss.ps.plan;
 
 	show_sort_keys_common((PlanState *) sortstate,
-						  plan->numCols, plan->sortColIdx,
+						  plan->numCols,
+						  sortstate->incremental ? plan->numPresortedCols : 0,
+						  plan->sortColIdx,
 						  ancestors, es);
 }
 
@@ -1440,17 +1532,23 @@ show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 	MergeAppend *plan = (MergeAppend *) mstate->ps.plan;
 
 	show_sort_keys_common((PlanState *) mstate,
-						  plan->numCols, plan->sortColIdx,
+						  plan->numCols, 0, plan->sortColIdx,
 						  ancestors, es);
 }
 
+/*
+ * Show the first nkeys sort keys, and the first npresorted of them again as
+ * the keys the input is already sorted by (for an incremental sort).
+ */
 static void
-show_sort_keys_common(PlanState *planstate, int nkeys, AttrNumber *keycols,
+show_sort_keys_common(PlanState *planstate, int nkeys, int npresorted,
+					  AttrNumber *keycols,
 					  List *ancestors, ExplainState *es)
 {
 	Plan	   *plan = planstate->plan;
 	List	   *context;
 	List	   *result = NIL;
+	List	   *presorted = NIL;
 	bool		useprefix;
 	int			keyno;
 	char	   *exprstr;
@@ -1477,9 +1575,13 @@ show_sort_keys_common(PlanState *planstate, int nkeys, AttrNumber *keycols,
 		exprstr = deparse_expression((Node *) target->expr, context,
 									 useprefix, true);
 		result = lappend(result, exprstr);
+		if (keyno < npresorted)
+			presorted = lappend(presorted, exprstr);
 	}
 
 	ExplainPropertyList("Sort Key", result, es);
+	if (presorted != NIL)
+		ExplainPropertyList("Presorted Key", presorted, es);
 }
 
 /*
@@ -1489,8 +1591,10 @@ static void
 show_sort_info(SortState *sortstate, ExplainState *es)
 {
 	Assert(IsA(sortstate, SortState));
+
+	/* An incremental sort has no single tuplesort to report on */
 	if (es->analyze && sortstate->sort_Done &&
-		sortstate->tuplesortstate != NULL)
+		sortstate->tuplesortstate != NULL && !sortstate->incremental)
 	{
 		Tuplesortstate *state = (Tuplesortstate *) sortstate->tuplesortstate;
 		const char *sortMethod;
@@ -1556,6 +1660,60 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * Show the keys of a caching Material node, and for EXPLAIN ANALYZE how well
+ * the cache did.
+ */
+static void
+show_material_cache_info(MaterialState *mstate, List *ancestors,
+						 ExplainState *es)
+{
+	Material   *plan = (Material *) mstate->ss.ps.plan;
+	List	   *context;
+	List	   *result = NIL;
+	bool		useprefix;
+	ListCell   *lc;
+
+	if (plan->numCacheKeys == 0)
+		return;
+
+	/* Set up deparsing context */
+	context = deparse_context_for_planstate((Node *) mstate,
+											ancestors,
+											es->rtable);
+	useprefix = (list_length(es->rtable) > 1 || es->verbose);
+
+	foreach(lc, plan->cacheKeys)
+		result = lappend(result,
+						 deparse_expression((Node *) lfirst(lc), context,
+											useprefix, true));
+
+	ExplainPropertyList("Cache Key", result, es);
+
+	if (es->analyze && mstate->cache != NULL)
+	{
+		long		peakMemKb = (mstate->cache_peakmem + 1023) / 1024;
+
+		if (es->format != EXPLAIN_FORMAT_TEXT)
+		{
+			ExplainPropertyLong("Cache Hits", mstate->cache_hits, es);
+			ExplainPropertyLong("Cache Misses", mstate->cache_misses, es);
+			ExplainPropertyLong("Cache Evictions", mstate->cache_evictions, es);
+			ExplainPropertyLong("Cache Overflows", mstate->cache_overflows, es);
+			ExplainPropertyLong("Peak Memory Usage", peakMemKb, es);
+		}
+		else
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str,
+							 "Hits: %ld  Misses: %ld  Evictions: %ld  Overflows: %ld  Memory Usage: %ldkB\n",
+							 mstate->cache_hits, mstate->cache_misses,
+							 mstate->cache_evictions, mstate->cache_overflows,
+							 peakMemKb);
+		}
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show instrumentation information for a plan node
  *
@@ -1797,14 +1955,14 @@ ExplainTargetRel(Plan *plan, Index rti, ExplainState *es)
  * The ancestors list should already contain the immediate parent of these
  * plans.
  *
- * Note: we don't actually need to examine the Plan list members, but
- * we need the list in order to determine the length of the PlanState array.
+ * The PlanState array needn't be as long as the Plan's list of subplans;
+ * Append and MergeAppend don't initialize the subplans they prune away at
+ * startup.
  */
 static void
-ExplainMemberNodes(List *plans, PlanState **planstates,
+ExplainMemberNodes(PlanState **planstates, int nplans,
 				   List *ancestors, ExplainState *es)
 {
-	int			nplans = list_length(plans);
 	int			j;
 
 	for (j = 0; j < nplans; j++)
@@ -16,15 +16,20 @@
 #include "postgres.h"
 
 #include "access/reloptions.h"
+#include "access/tableam.h"
+#include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "catalog/dependency.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_opclass.h"
 #include "catalog/pg_opfamily.h"
 #include "catalog/pg_tablespace.h"
+#include "commands/cluster.h"
 #include "commands/dbcommands.h"
 #include "commands/defrem.h"
+#include "commands/progress.h"
 #include "commands/tablecmds.h"
 #include "commands/tablespace.h"
 #include "mb/pg_wchar.h"
@@ -35,11 +40,14 @@
 #include "parser/parse_coerce.h"
 #include "parser/parse_func.h"
 #include "parser/parse_oper.h"
+#include "pgstat.h"
 #include "storage/lmgr.h"
+#include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
@@ -64,6 +72,10 @@ static void ComputeIndexAttrs(IndexInfo *indexInfo,
 static Oid GetIndexOpClass(List *opclass, Oid attrType,
 				char *accessMethodName, Oid accessMethodId);
 static char *ChooseIndexNameAddition(List *colnames);
+static void WaitForOlderSnapshots(TransactionId limitXmin);
+static bool ReindexRelationConcurrently(Oid relationOid);
+static Oid	CreateConcurrentIndexCopy(Relation heapRel, Relation indexRel);
+static void SetIndexState(Oid indexId, bool ready, bool valid);
 static void RangeVarCallbackForReindexIndex(const RangeVar *relation,
 								Oid relId, Oid oldRelId, void *arg);
 
@@ -77,6 +89,7 @@ static void RangeVarCallbackForReindexIndex(const RangeVar *relation,
  * 'accessMethodName': name of the AM to use.
  * 'attributeList': a list of IndexElem specifying columns and expressions
  *		to index on.
+ * 'includeList': a list of IndexElem specifying non-key columns.
  * 'exclusionOpNames': list of names of exclusion-constraint operators,
  *		or NIL if not an exclusion constraint.
  *
@@ -108,6 +121,7 @@ CheckIndexCompatible(Oid oldId,
 					 RangeVar *heapRelation,
 					 char *accessMethodName,
 					 List *attributeList,
+					 List *includeList,
 					 List *exclusionOpNames)
 {
 	bool		isconstraint;
@@ -121,6 +135,8 @@ CheckIndexCompatible(Oid oldId,
 	int16	   *coloptions;
 	IndexInfo  *indexInfo;
 	int			numberOfAttributes;
+	int			numberOfKeyAttributes;
+	List	   *allIndexParams;
 	int			old_natts;
 	bool		isnull;
 	bool		family_am;
@@ -138,8 +154,11 @@ CheckIndexCompatible(Oid oldId,
 	 */
 	isconstraint = false;
 
-	numberOfAttributes = list_length(attributeList);
-	Assert(numberOfAttributes > 0);
+	numberOfKeyAttributes = list_length(attributeList);
+	allIndexParams = list_concat(list_copy(attributeList),
+								 list_copy(includeList));
+	numberOfAttributes = list_length(allIndexParams);
+	Assert(numberOfKeyAttributes > 0);
 	Assert(numberOfAttributes <= INDEX_MAX_KEYS);
 
 	/* look up the access method */
@@ -162,6 +181,8 @@ CheckIndexCompatible(Oid oldId,
 	 * later on, and it would have failed then anyway.
 	 */
 	indexInfo = makeNode(IndexInfo);
+	indexInfo->ii_NumIndexAttrs = numberOfAttributes;
+	indexInfo->ii_NumIndexKeyAttrs = numberOfKeyAttributes;
 	indexInfo->ii_Expressions = NIL;
 	indexInfo->ii_ExpressionsState = NIL;
 	indexInfo->ii_PredicateState = NIL;
@@ -172,7 +193,7 @@ CheckIndexCompatible(Oid oldId,
 	classObjectId = (Oid *) palloc(numberOfAttributes * sizeof(Oid));
 	coloptions = (int16 *) palloc(numberOfAttributes * sizeof(int16));
 	ComputeIndexAttrs(indexInfo, collationObjectId, classObjectId,
-					  coloptions, attributeList,
+					  coloptions, allIndexParams,
 					  exclusionOpNames, relationId,
 					  accessMethodName, accessMethodId,
 					  amcanorder, isconstraint);
@@ -184,8 +205,8 @@ CheckIndexCompatible(Oid oldId,
 		elog(ERROR, "cache lookup failed for index %u", oldId);
 
 	/* We don't assess expressions or predicates; assume incompatibility. */
-	if (!(heap_attisnull(tuple, Anum_pg_index_indpred) &&
-		  heap_attisnull(tuple, Anum_pg_index_indexprs)))
+	if (!(heap_attisnull(tuple, Anum_pg_index_indpred, NULL) &&
+		  heap_attisnull(tuple, Anum_pg_index_indexprs, NULL)))
 	{
 		ReleaseSysCache(tuple);
 		return false;
@@ -200,6 +221,13 @@ CheckIndexCompatible(Oid oldId,
 	old_natts = ((Form_pg_index) GETSTRUCT(tuple))->indnatts;
 	Assert(old_natts == numberOfAttributes);
 
+	/* The key columns must be the same, too */
+	if (((Form_pg_index) GETSTRUCT(tuple))->indnkeyatts != numberOfKeyAttributes)
+	{
+		ReleaseSysCache(tuple);
+		return false;
+	}
+
 	d = SysCacheGetAttr(INDEXRELID, tuple, Anum_pg_index_indcollation, &isnull);
 	Assert(!isnull);
 	old_indcollation = (oidvector *) DatumGetPointer(d);
@@ -273,6 +301,9 @@ CheckIndexCompatible(Oid oldId,
  *		NULL specifies using the appropriate default.
  * 'attributeList': a list of IndexElem specifying columns and expressions
  *		to index on.
+ * 'includeList': a list of IndexElem specifying columns to store in the
+ *		index's leaf tuples without making them part of the key, so that
+ *		index-only scans can return them.
  * 'predicate': the partial-index condition, or NULL if none.
  * 'options': reloptions from WITH (in list-of-DefElem form).
  * 'exclusionOpNames': list of names of exclusion-constraint operators,
@@ -301,6 +332,7 @@ DefineIndex(RangeVar *heapRelation,
 			char *accessMethodName,
 			char *tableSpaceName,
 			List *attributeList,
+			List *includeList,
 			Expr *predicate,
 			List *options,
 			List *exclusionOpNames,
@@ -332,25 +364,29 @@ DefineIndex(RangeVar *heapRelation,
 	int16	   *coloptions;
 	IndexInfo  *indexInfo;
 	int			numberOfAttributes;
+	int			numberOfKeyAttributes;
+	List	   *allIndexParams;
 	VirtualTransactionId *old_lockholders;
-	VirtualTransactionId *old_snapshots;
-	int			n_old_snapshots;
 	LockRelId	heaprelid;
 	LOCKTAG		heaplocktag;
 	Snapshot	snapshot;
 	Relation	pg_index;
 	HeapTuple	indexTuple;
 	Form_pg_index indexForm;
-	int			i;
 
 	/*
-	 * count attributes in index
+	 * count attributes in index.  The INCLUDE columns follow the key columns,
+	 * and from here on are treated as index columns like any other, except
+	 * where it matters that they're not part of the key.
 	 */
-	numberOfAttributes = list_length(attributeList);
-	if (numberOfAttributes <= 0)
+	numberOfKeyAttributes = list_length(attributeList);
+	if (numberOfKeyAttributes <= 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
 				 errmsg("must specify at least one column")));
+	allIndexParams = list_concat(list_copy(attributeList),
+								 list_copy(includeList));
+	numberOfAttributes = list_length(allIndexParams);
 	if (numberOfAttributes > INDEX_MAX_KEYS)
 		ereport(ERROR,
 				(errcode(ERRCODE_TOO_MANY_COLUMNS),
@@ -370,8 +406,11 @@ DefineIndex(RangeVar *heapRelation,
 	relationId = RelationGetRelid(rel);
 	namespaceId = RelationGetNamespace(rel);
 
+	pgstat_progress_start_command(PROGRESS_COMMAND_CREATE_INDEX, relationId);
+
 	/* Note: during bootstrap may see uncataloged relation */
 	if (rel->rd_rel->relkind != RELKIND_RELATION &&
+		rel->rd_rel->relkind != RELKIND_MATVIEW &&
 		rel->rd_rel->relkind != RELKIND_UNCATALOGED)
 	{
 		if (rel->rd_rel->relkind == RELKIND_FOREIGN_TABLE)
@@ -399,6 +438,9 @@ DefineIndex(RangeVar *heapRelation,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				 errmsg("cannot create indexes on temporary tables of other sessions")));
 
+	/* Index builds and index scans read heap pages */
+	CheckTableIsHeap(rel, "CREATE INDEX");
+
 	/*
 	 * Verify we (still) have CREATE rights in the rel's namespace.
 	 * (Presumably we did when the rel was created, but maybe not anymore.)
@@ -457,7 +499,7 @@ DefineIndex(RangeVar *heapRelation,
 	/*
 	 * Choose the index column names.
 	 */
-	indexColNames = ChooseIndexColumnNames(attributeList);
+	indexColNames = ChooseIndexColumnNames(allIndexParams);
 
 	/*
 	 * Select name for index if caller didn't specify
@@ -502,6 +544,11 @@ DefineIndex(RangeVar *heapRelation,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 			   errmsg("access method \"%s\" does not support unique indexes",
 					  accessMethodName)));
+	if (includeList != NIL && !accessMethodForm->amcaninclude)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			errmsg("access method \"%s\" does not support included columns",
+				   accessMethodName)));
 	if (numberOfAttributes > 1 && !accessMethodForm->amcanmulticol)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
@@ -537,6 +584,7 @@ DefineIndex(RangeVar *heapRelation,
 	 */
 	indexInfo = makeNode(IndexInfo);
 	indexInfo->ii_NumIndexAttrs = numberOfAttributes;
+	indexInfo->ii_NumIndexKeyAttrs = numberOfKeyAttributes;
 	indexInfo->ii_Expressions = NIL;	/* for now */
 	indexInfo->ii_ExpressionsState = NIL;
 	indexInfo->ii_Predicate = make_ands_implicit(predicate);
@@ -554,7 +602,7 @@ DefineIndex(RangeVar *heapRelation,
 	classObjectId = (Oid *) palloc(numberOfAttributes * sizeof(Oid));
 	coloptions = (int16 *) palloc(numberOfAttributes * sizeof(int16));
 	ComputeIndexAttrs(indexInfo, collationObjectId, classObjectId,
-					  coloptions, attributeList,
+					  coloptions, allIndexParams,
 					  exclusionOpNames, relationId,
 					  accessMethodName, accessMethodId,
 					  amcanorder, isconstraint);
@@ -617,9 +665,17 @@ DefineIndex(RangeVar *heapRelation,
 	{
 		/* Close the heap and we're done, in the non-concurrent case */
 		heap_close(rel, NoLock);
+		pgstat_progress_end_command();
 		return indexRelationId;
 	}
 
+	/*
+	 * The index's OID is only known now, after a non-concurrent build has
+	 * already finished inside index_create.
+	 */
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_INDEX_OID,
+								 indexRelationId);
+
 	/* save lockrelid and locktag for below, then close rel */
 	heaprelid = rel->rd_lockInfo.lockRelId;
 	SET_LOCKTAG_RELATION(heaplocktag, heaprelid.dbId, heaprelid.relId);
@@ -674,6 +730,8 @@ DefineIndex(RangeVar *heapRelation,
 	 * check for that.	Also, prepared xacts are not reported, which is fine
 	 * since they certainly aren't going to do anything more.
 	 */
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_WAIT_XACTS);
 	old_lockholders = GetLockConflicts(&heaplocktag, ShareLock);
 
 	while (VirtualTransactionIdIsValid(*old_lockholders))
@@ -760,6 +818,8 @@ DefineIndex(RangeVar *heapRelation,
 	 * We once again wait until no transaction can have the table open with
 	 * the index marked as read-only for updates.
 	 */
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_WAIT_XACTS);
 	old_lockholders = GetLockConflicts(&heaplocktag, ShareLock);
 
 	while (VirtualTransactionIdIsValid(*old_lockholders))
@@ -789,6 +849,8 @@ DefineIndex(RangeVar *heapRelation,
 	/*
 	 * Scan the index and the heap, insert any missing index entries.
 	 */
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_VALIDATE);
 	validate_index(relationId, indexRelationId, snapshot);
 
 	/*
@@ -823,46 +885,9 @@ DefineIndex(RangeVar *heapRelation,
 	 * GetCurrentVirtualXIDs.  If, during any iteration, a particular vxid
 	 * doesn't show up in the output, we know we can forget about it.
 	 */
-	old_snapshots = GetCurrentVirtualXIDs(snapshot->xmin, true, false,
-										  PROC_IS_AUTOVACUUM | PROC_IN_VACUUM,
-										  &n_old_snapshots);
-
-	for (i = 0; i < n_old_snapshots; i++)
-	{
-		if (!VirtualTransactionIdIsValid(old_snapshots[i]))
-			continue;			/* found uninteresting in previous cycle */
-
-		if (i > 0)
-		{
-			/* see if anything's changed ... */
-			VirtualTransactionId *newer_snapshots;
-			int			n_newer_snapshots;
-			int			j;
-			int			k;
-
-			newer_snapshots = GetCurrentVirtualXIDs(snapshot->xmin,
-													true, false,
-										 PROC_IS_AUTOVACUUM | PROC_IN_VACUUM,
-													&n_newer_snapshots);
-			for (j = i; j < n_old_snapshots; j++)
-			{
-				if (!VirtualTransactionIdIsValid(old_snapshots[j]))
-					continue;	/* found uninteresting in previous cycle */
-				for (k = 0; k < n_newer_snapshots; k++)
-				{
-					if (VirtualTransactionIdEquals(old_snapshots[j],
-												   newer_snapshots[k]))
-						break;
-				}
-				if (k >= n_newer_snapshots)		/* not there anymore */
-					SetInvalidVirtualTransactionId(old_snapshots[j]);
-			}
-			pfree(newer_snapshots);
-		}
-
-		if (VirtualTransactionIdIsValid(old_snapshots[i]))
-			VirtualXactLock(old_snapshots[i], true);
-	}
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
+								 PROGRESS_CREATEIDX_PHASE_WAIT_XACTS);
+	WaitForOlderSnapshots(snapshot->xmin);
 
 	/*
 	 * Index can now be marked valid -- update its pg_index entry
@@ -906,9 +931,65 @@ DefineIndex(RangeVar *heapRelation,
 	 */
 	UnlockRelationIdForSession(&heaprelid, ShareUpdateExclusiveLock);
 
+	pgstat_progress_end_command();
+
 	return indexRelationId;
 }
 
+/*
+ * WaitForOlderSnapshots
+ *		Wait out the transactions whose snapshots might be older than
+ *		limitXmin, for phase 3 of a concurrent index build.
+ */
+static void
+WaitForOlderSnapshots(TransactionId limitXmin)
+{
+	int			i;
+	int			n_old_snapshots;
+	VirtualTransactionId *old_snapshots;
+
+	old_snapshots = GetCurrentVirtualXIDs(limitXmin, true, false,
+										  PROC_IS_AUTOVACUUM | PROC_IN_VACUUM,
+										  &n_old_snapshots);
+
+	for (i = 0; i < n_old_snapshots; i++)
+	{
+		if (!VirtualTransactionIdIsValid(old_snapshots[i]))
+			continue;			/* found uninteresting in previous cycle */
+
+		if (i > 0)
+		{
+			/* see if anything's changed ... */
+			VirtualTransactionId *newer_snapshots;
+			int			n_newer_snapshots;
+			int			j;
+			int			k;
+
+			newer_snapshots = GetCurrentVirtualXIDs(limitXmin,
+													true, false,
+										 PROC_IS_AUTOVACUUM | PROC_IN_VACUUM,
+													&n_newer_snapshots);
+			for (j = i; j < n_old_snapshots; j++)
+			{
+				if (!VirtualTransactionIdIsValid(old_snapshots[j]))
+					continue;	/* found uninteresting in previous cycle */
+				for (k = 0; k < n_newer_snapshots; k++)
+				{
+					if (VirtualTransactionIdEquals(old_snapshots[j],
+												   newer_snapshots[k]))
+						break;
+				}
+				if (k >= n_newer_snapshots)		/* not there anymore */
+					SetInvalidVirtualTransactionId(old_snapshots[j]);
+			}
+			pfree(newer_snapshots);
+		}
+
+		if (VirtualTransactionIdIsValid(old_snapshots[i]))
+			VirtualXactLock(old_snapshots[i], true);
+	}
+}
+
 
 /*
  * CheckMutability
@@ -977,6 +1058,10 @@ CheckPredicate(Expr *predicate)
 /*
  * Compute per-index-column information, including indexed column numbers
  * or index expressions, opclasses, and indoptions.
+ *
+ * attList holds the key columns followed by the INCLUDE columns, if any;
+ * indexInfo->ii_NumIndexKeyAttrs says where the latter start.  They get no
+ * collation, opclass or options, since they're never compared.
  */
 static void
 ComputeIndexAttrs(IndexInfo *indexInfo,
@@ -994,11 +1079,12 @@ ComputeIndexAttrs(IndexInfo *indexInfo,
 	ListCell   *nextExclOp;
 	ListCell   *lc;
 	int			attn;
+	int			nkeycols = indexInfo->ii_NumIndexKeyAttrs;
 
 	/* Allocate space for exclusion operator info, if needed */
 	if (exclusionOpNames)
 	{
-		int			ncols = list_length(attList);
+		int			ncols = nkeycols;
 
 		Assert(list_length(exclusionOpNames) == ncols);
 		indexInfo->ii_ExclusionOps = (Oid *) palloc(sizeof(Oid) * ncols);
@@ -1019,6 +1105,30 @@ ComputeIndexAttrs(IndexInfo *indexInfo,
 		Oid			atttype;
 		Oid			attcollation;
 
+		/*
+		 * Included columns must be plain columns, used as they are.
+		 */
+		if (attn >= nkeycols)
+		{
+			if (attribute->expr != NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("expressions are not supported in included columns")));
+			if (attribute->collation != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("including column does not support a collation")));
+			if (attribute->opclass != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("including column does not support an operator class")));
+			if (attribute->ordering != SORTBY_DEFAULT ||
+				attribute->nulls_ordering != SORTBY_NULLS_DEFAULT)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("including column does not support ASC/DESC/NULLS options")));
+		}
+
 		/*
 		 * Process the column-or-expression to be indexed.
 		 */
@@ -1108,6 +1218,19 @@ ComputeIndexAttrs(IndexInfo *indexInfo,
 			}
 		}
 
+		/*
+		 * Included columns have no collation, opclass or options, and no
+		 * exclusion operator either.
+		 */
+		if (attn >= nkeycols)
+		{
+			collationOidP[attn] = InvalidOid;
+			classOidP[attn] = InvalidOid;
+			colOptionP[attn] = 0;
+			attn++;
+			continue;
+		}
+
 		/*
 		 * Apply collation override if any
 		 */
@@ -1719,23 +1842,40 @@ ChooseIndexColumnNames(List *indexElems)
 	return result;
 }
 
+/* State passed to RangeVarCallbackForReindexIndex */
+struct ReindexIndexCallbackState
+{
+	bool		concurrent;		/* REINDEX CONCURRENTLY? */
+	Oid			heapOid;		/* OID of the table we locked, if any */
+};
+
 /*
  * ReindexIndex
  *		Recreate a specific index.
  */
 void
-ReindexIndex(RangeVar *indexRelation)
+ReindexIndex(RangeVar *indexRelation, bool concurrent)
 {
+	struct ReindexIndexCallbackState state;
 	Oid			indOid;
-	Oid			heapOid = InvalidOid;
 
-	/* lock level used here should match index lock reindex_index() */
-	indOid = RangeVarGetRelidExtended(indexRelation, AccessExclusiveLock,
+	/*
+	 * Lock level used here should match index lock reindex_index(), or
+	 * ReindexRelationConcurrently() in the concurrent case.
+	 */
+	state.concurrent = concurrent;
+	state.heapOid = InvalidOid;
+	indOid = RangeVarGetRelidExtended(indexRelation,
+									  concurrent ? ShareUpdateExclusiveLock :
+									  AccessExclusiveLock,
 									  false, false,
 									  RangeVarCallbackForReindexIndex,
-									  (void *) &heapOid);
+									  (void *) &state);
 
-	reindex_index(indOid, false);
+	if (concurrent)
+		ReindexRelationConcurrently(indOid);
+	else
+		reindex_index(indOid, false);
 }
 
 /*
@@ -1748,7 +1888,14 @@ RangeVarCallbackForReindexIndex(const RangeVar *relation,
 								Oid relId, Oid oldRelId, void *arg)
 {
 	char		relkind;
-	Oid		   *heapOid = (Oid *) arg;
+	struct ReindexIndexCallbackState *state = arg;
+	LOCKMODE	table_lockmode;
+
+	/*
+	 * Lock level here should match the table lock of reindex_index(), or of
+	 * ReindexRelationConcurrently() in the concurrent case.
+	 */
+	table_lockmode = state->concurrent ? ShareUpdateExclusiveLock : ShareLock;
 
 	/*
 	 * If we previously locked some other index's heap, and the name we're
@@ -1757,9 +1904,8 @@ RangeVarCallbackForReindexIndex(const RangeVar *relation,
 	 */
 	if (relId != oldRelId && OidIsValid(oldRelId))
 	{
-		/* lock level here should match reindex_index() heap lock */
-		UnlockRelationOid(*heapOid, ShareLock);
-		*heapOid = InvalidOid;
+		UnlockRelationOid(state->heapOid, table_lockmode);
+		state->heapOid = InvalidOid;
 	}
 
 	/* If the relation does not exist, there's nothing more to do. */
@@ -1787,13 +1933,12 @@ RangeVarCallbackForReindexIndex(const RangeVar *relation,
 	if (relId != oldRelId)
 	{
 		/*
-		 * Lock level here should match reindex_index() heap lock.
 		 * If the OID isn't valid, it means the index as concurrently dropped,
 		 * which is not a problem for us; just return normally.
 		 */
-		*heapOid = IndexGetRelation(relId, true);
-		if (OidIsValid(*heapOid))
-			LockRelationOid(*heapOid, ShareLock);
+		state->heapOid = IndexGetRelation(relId, true);
+		if (OidIsValid(state->heapOid))
+			LockRelationOid(state->heapOid, table_lockmode);
 	}
 }
 
@@ -1802,20 +1947,417 @@ RangeVarCallbackForReindexIndex(const RangeVar *relation,
  *		Recreate all indexes of a table (and of its toast table, if any)
  */
 void
-ReindexTable(RangeVar *relation)
+ReindexTable(RangeVar *relation, bool concurrent)
 {
 	Oid			heapOid;
+	bool		result;
 
-	/* The lock level used here should match reindex_relation(). */
-	heapOid = RangeVarGetRelidExtended(relation, ShareLock, false, false,
+	/*
+	 * The lock level used here should match reindex_relation(), or
+	 * ReindexRelationConcurrently() in the concurrent case.
+	 */
+	heapOid = RangeVarGetRelidExtended(relation,
+									   concurrent ? ShareUpdateExclusiveLock :
+									   ShareLock,
+									   false, false,
 									   RangeVarCallbackOwnsTable, NULL);
 
-	if (!reindex_relation(heapOid, REINDEX_REL_PROCESS_TOAST))
+	if (concurrent)
+		result = ReindexRelationConcurrently(heapOid);
+	else
+		result = reindex_relation(heapOid, REINDEX_REL_PROCESS_TOAST);
+
+	if (!result)
 		ereport(NOTICE,
 				(errmsg("table \"%s\" has no indexes",
 						relation->relname)));
 }
 
+/*
+ * ReindexRelationConcurrently
+ *		Rebuild the indexes of a table, or a single index, without blocking
+ *		writes to the table.
+ *
+ * Each index is rebuilt the way CREATE INDEX CONCURRENTLY builds one: we make
+ * a copy of the index that nobody uses yet, then build and validate the copy
+ * while holding only ShareUpdateExclusiveLock on the table.  Finally the
+ * storage of the copy and of the original index are swapped, which needs
+ * only a brief AccessExclusiveLock on the two indexes, and the copy, which
+ * now holds the old storage, is dropped.  Since the original index keeps
+ * its OID, the constraints and other objects that depend on it don't change.
+ *
+ * The indexes of the table's TOAST table are not rebuilt.  Invalid indexes
+ * are skipped when rebuilding a whole table, as are the copies that a failed
+ * REINDEX CONCURRENTLY leaves behind; those should be dropped.
+ *
+ * Like DefineIndex, this commits several transactions, so it must not be
+ * called within a user transaction block.  Returns false if the table has
+ * no indexes.
+ */
+static bool
+ReindexRelationConcurrently(Oid relationOid)
+{
+	MemoryContext private_context;
+	MemoryContext oldcontext;
+	List	   *candidateIds;
+	List	   *indexIds = NIL;
+	List	   *newIndexIds = NIL;
+	ListCell   *lc,
+			   *lc2;
+	Relation	heapRel;
+	Oid			heapId;
+	LockRelId	heaprelid;
+	LOCKTAG		heaplocktag;
+	VirtualTransactionId *old_lockholders;
+	bool		is_table;
+
+	/*
+	 * Create a memory context that will survive the transaction commits we
+	 * do below, as in ReindexDatabase.
+	 */
+	private_context = AllocSetContextCreate(PortalContext,
+											"ReindexConcurrent",
+											ALLOCSET_DEFAULT_MINSIZE,
+											ALLOCSET_DEFAULT_INITSIZE,
+											ALLOCSET_DEFAULT_MAXSIZE);
+
+	/*
+	 * Phase 1: collect the indexes to rebuild, and make the catalog entries
+	 * for their copies.  The caller has already locked the table.
+	 */
+	is_table = (get_rel_relkind(relationOid) == RELKIND_RELATION);
+	if (is_table)
+		heapId = relationOid;
+	else
+		heapId = IndexGetRelation(relationOid, false);
+
+	heapRel = heap_open(heapId, ShareUpdateExclusiveLock);
+
+	/*
+	 * Concurrent index builds are unsafe on system catalogs, because we tend
+	 * to release locks on them before committing.
+	 */
+	if (IsSystemRelation(heapRel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot reindex system catalogs concurrently")));
+
+	if (is_table)
+		candidateIds = RelationGetIndexList(heapRel);
+	else
+		candidateIds = list_make1_oid(relationOid);
+
+	foreach(lc, candidateIds)
+	{
+		Oid			indexId = lfirst_oid(lc);
+		Relation	indexRel;
+		Oid			newIndexId;
+
+		indexRel = index_open(indexId, ShareUpdateExclusiveLock);
+
+		if (!indexRel->rd_index->indisvalid)
+		{
+			if (!is_table)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot reindex invalid index \"%s\" concurrently",
+								RelationGetRelationName(indexRel)),
+						 errhint("Drop the index, or use REINDEX without CONCURRENTLY.")));
+			ereport(WARNING,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot reindex invalid index \"%s\" concurrently, skipping",
+							RelationGetRelationName(indexRel))));
+			index_close(indexRel, NoLock);
+			continue;
+		}
+
+		/* As in index_create, concurrent builds can't check exclusions */
+		if (indexRel->rd_index->indisexclusion)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot reindex exclusion constraint index \"%s\" concurrently",
+							RelationGetRelationName(indexRel))));
+
+		/*
+		 * The copy checks uniqueness immediately, which would break a
+		 * deferrable constraint while it's being rebuilt.
+		 */
+		if (!indexRel->rd_index->indimmediate)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot reindex deferrable constraint index \"%s\" concurrently",
+							RelationGetRelationName(indexRel))));
+
+		newIndexId = CreateConcurrentIndexCopy(heapRel, indexRel);
+
+		index_close(indexRel, NoLock);
+
+		oldcontext = MemoryContextSwitchTo(private_context);
+		indexIds = lappend_oid(indexIds, indexId);
+		newIndexIds = lappend_oid(newIndexIds, newIndexId);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	if (newIndexIds == NIL)
+	{
+		heap_close(heapRel, NoLock);
+		MemoryContextDelete(private_context);
+		return false;
+	}
+
+	/*
+	 * Keep a session-level lock on the table across the transactions below,
+	 * as DefineIndex does.  It also keeps the original indexes from being
+	 * dropped, since DROP INDEX locks the table.
+	 */
+	heaprelid = heapRel->rd_lockInfo.lockRelId;
+	SET_LOCKTAG_RELATION(heaplocktag, heaprelid.dbId, heaprelid.relId);
+	heap_close(heapRel, NoLock);
+
+	LockRelationIdForSession(&heaprelid, ShareUpdateExclusiveLock);
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+	StartTransactionCommand();
+
+	/*
+	 * Phase 2: wait for the transactions that might not know about the
+	 * copies yet, then build them.  See DefineIndex.
+	 */
+	old_lockholders = GetLockConflicts(&heaplocktag, ShareLock);
+
+	while (VirtualTransactionIdIsValid(*old_lockholders))
+	{
+		VirtualXactLock(*old_lockholders, true);
+		old_lockholders++;
+	}
+
+	foreach(lc, newIndexIds)
+	{
+		Oid			newIndexId = lfirst_oid(lc);
+		Relation	indexRel;
+		IndexInfo  *indexInfo;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Set ActiveSnapshot since functions in the indexes may need it */
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		heapRel = heap_open(heapId, ShareUpdateExclusiveLock);
+		indexRel = index_open(newIndexId, RowExclusiveLock);
+
+		indexInfo = BuildIndexInfo(indexRel);
+		Assert(!indexInfo->ii_ReadyForInserts);
+		indexInfo->ii_Concurrent = true;
+		indexInfo->ii_BrokenHotChain = false;
+
+		index_build(heapRel, indexRel, indexInfo, false, false);
+
+		heap_close(heapRel, NoLock);
+		index_close(indexRel, NoLock);
+
+		/* From now on, new transactions must insert into the copy too */
+		SetIndexState(newIndexId, true, false);
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+		StartTransactionCommand();
+	}
+
+	/*
+	 * Phase 3: wait until no transaction can have the table open without
+	 * inserting into the copies, then add the rows they lack.
+	 */
+	old_lockholders = GetLockConflicts(&heaplocktag, ShareLock);
+
+	while (VirtualTransactionIdIsValid(*old_lockholders))
+	{
+		VirtualXactLock(*old_lockholders, true);
+		old_lockholders++;
+	}
+
+	foreach(lc, newIndexIds)
+	{
+		Oid			newIndexId = lfirst_oid(lc);
+		Snapshot	snapshot;
+		TransactionId limitXmin;
+
+		CHECK_FOR_INTERRUPTS();
+
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+		PushActiveSnapshot(snapshot);
+
+		validate_index(heapId, newIndexId, snapshot);
+
+		limitXmin = snapshot->xmin;
+		PopActiveSnapshot();
+		UnregisterSnapshot(snapshot);
+
+		/*
+		 * Commit before waiting, so that our own snapshot doesn't hold back
+		 * the other REINDEX CONCURRENTLY or CREATE INDEX CONCURRENTLY runs
+		 * that wait for us.
+		 */
+		CommitTransactionCommand();
+		StartTransactionCommand();
+
+		WaitForOlderSnapshots(limitXmin);
+
+		SetIndexState(newIndexId, true, true);
+
+		CommitTransactionCommand();
+		StartTransactionCommand();
+	}
+
+	/*
+	 * Phase 4: swap the storage of each original index with that of its
+	 * copy, then drop the copies, in the transaction that our caller will
+	 * commit.  Taking AccessExclusiveLock on an index waits for everyone who
+	 * is scanning it or inserting into it.
+	 */
+	forboth(lc, indexIds, lc2, newIndexIds)
+	{
+		Oid			indexId = lfirst_oid(lc);
+		Oid			newIndexId = lfirst_oid(lc2);
+		Relation	indexRel;
+		Relation	newIndexRel;
+
+		CHECK_FOR_INTERRUPTS();
+
+		indexRel = index_open(indexId, AccessExclusiveLock);
+		newIndexRel = index_open(newIndexId, AccessExclusiveLock);
+
+		CheckTableNotInUse(indexRel, "REINDEX INDEX");
+
+		/* Predicate locks on the old pages don't mean anything anymore */
+		TransferPredicateLocksToHeapRelation(indexRel);
+		TransferPredicateLocksToHeapRelation(newIndexRel);
+
+		index_close(indexRel, NoLock);
+		index_close(newIndexRel, NoLock);
+
+		swap_relation_files(indexId, newIndexId, false, false,
+							InvalidTransactionId, NULL);
+	}
+
+	CommandCounterIncrement();
+
+	foreach(lc, newIndexIds)
+	{
+		ObjectAddress object;
+
+		object.classId = RelationRelationId;
+		object.objectId = lfirst_oid(lc);
+		object.objectSubId = 0;
+
+		performDeletion(&object, DROP_RESTRICT);
+	}
+
+	/* Make the new storage of the original indexes visible to plans */
+	CacheInvalidateRelcacheByRelid(heapId);
+
+	UnlockRelationIdForSession(&heaprelid, ShareUpdateExclusiveLock);
+
+	MemoryContextDelete(private_context);
+
+	return true;
+}
+
+/*
+ * CreateConcurrentIndexCopy
+ *		Make the catalog entries for an unbuilt copy of an index, for
+ *		ReindexRelationConcurrently.  Returns the OID of the copy.
+ *
+ * The copy has the same definition as the original, but isn't a constraint
+ * index, and is named after the original with "_ccnew" appended.  It is
+ * marked not ready for inserts and not valid, like an index created by
+ * CREATE INDEX CONCURRENTLY before its build.
+ */
+static Oid
+CreateConcurrentIndexCopy(Relation heapRel, Relation indexRel)
+{
+	IndexInfo  *indexInfo;
+	List	   *indexColNames = NIL;
+	oidvector  *indclass;
+	Datum		indclassDatum;
+	HeapTuple	classTuple;
+	Datum		reloptions;
+	bool		isnull;
+	char	   *newName;
+	int			i;
+
+	indexInfo = BuildIndexInfo(indexRel);
+	indexInfo->ii_ReadyForInserts = false;
+	indexInfo->ii_Concurrent = true;
+	indexInfo->ii_BrokenHotChain = false;
+
+	for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
+		indexColNames = lappend(indexColNames,
+						NameStr(indexRel->rd_att->attrs[i]->attname));
+
+	indclassDatum = SysCacheGetAttr(INDEXRELID, indexRel->rd_indextuple,
+									Anum_pg_index_indclass, &isnull);
+	Assert(!isnull);
+	indclass = (oidvector *) DatumGetPointer(indclassDatum);
+
+	classTuple = SearchSysCache1(RELOID,
+								 ObjectIdGetDatum(RelationGetRelid(indexRel)));
+	if (!HeapTupleIsValid(classTuple))
+		elog(ERROR, "cache lookup failed for relation %u",
+			 RelationGetRelid(indexRel));
+	reloptions = SysCacheGetAttr(RELOID, classTuple,
+								 Anum_pg_class_reloptions, &isnull);
+	if (isnull)
+		reloptions = (Datum) 0;
+	else
+		reloptions = datumCopy(reloptions, false, -1);
+	ReleaseSysCache(classTuple);
+
+	newName = ChooseRelationName(RelationGetRelationName(indexRel),
+								 NULL,
+								 "ccnew",
+								 RelationGetNamespace(indexRel));
+
+	return index_create(heapRel, newName, InvalidOid, InvalidOid,
+						indexInfo, indexColNames,
+						indexRel->rd_rel->relam,
+						indexRel->rd_rel->reltablespace,
+						indexRel->rd_indcollation,
+						indclass->values,
+						indexRel->rd_indoption,
+						reloptions,
+						false, false, false, false,
+						false, true, true);
+}
+
+/*
+ * SetIndexState
+ *		Update the indisready and indisvalid flags of an index that is
+ *		being built concurrently.
+ */
+static void
+SetIndexState(Oid indexId, bool ready, bool valid)
+{
+	Relation	pg_index;
+	HeapTuple	indexTuple;
+	Form_pg_index indexForm;
+
+	pg_index = heap_open(IndexRelationId, RowExclusiveLock);
+
+	indexTuple = SearchSysCacheCopy1(INDEXRELID, ObjectIdGetDatum(indexId));
+	if (!HeapTupleIsValid(indexTuple))
+		elog(ERROR, "cache lookup failed for index %u", indexId);
+	indexForm = (Form_pg_index) GETSTRUCT(indexTuple);
+
+	indexForm->indisready = ready;
+	indexForm->indisvalid = valid;
+
+	simple_heap_update(pg_index, &indexTuple->t_self, indexTuple);
+	CatalogUpdateIndexes(pg_index, indexTuple);
+
+	heap_close(pg_index, RowExclusiveLock);
+}
+
 /*
  * ReindexDatabase
  *		Recreate indexes of a database.
@@ -1883,7 +2425,8 @@ ReindexDatabase(const char *databaseName, bool do_system, bool do_user)
 	{
 		Form_pg_class classtuple = (Form_pg_class) GETSTRUCT(tuple);
 
-		if (classtuple->relkind != RELKIND_RELATION)
+		if (classtuple->relkind != RELKIND_RELATION &&
+			classtuple->relkind != RELKIND_MATVIEW)
 			continue;
 
 		/* Skip temp tables of other backends; we can't reindex them at all */
@@ -0,0 +1,522 @@
+/*-------------------------------------------------------------------------
+ *
+ * matview.c
+ *	  materialized view support
+ *
+ * A materialized view is stored as an ordinary heap, together with the
+ * defining query, which is kept as an ON SELECT rule just as for a view.
+ * The rewriter does not expand that rule, so queries read the stored data;
+ * REFRESH MATERIALIZED VIEW runs the rule's query to regenerate it.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/matview.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "catalog/dependency.h"
+#include "catalog/namespace.h"
+#include "commands/cluster.h"
+#include "commands/matview.h"
+#include "commands/tablecmds.h"
+#include "executor/executor.h"
+#include "executor/spi.h"
+#include "miscadmin.h"
+#include "rewrite/rewriteHandler.h"
+#include "storage/lmgr.h"
+#include "storage/smgr.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/typcache.h"
+
+
+typedef struct
+{
+	DestReceiver pub;			/* publicly-known function pointers */
+	Oid			transientoid;	/* OID of new heap into which to store */
+	/* These fields are filled by transientrel_startup: */
+	Relation	transientrel;	/* relation to write to */
+	CommandId	output_cid;		/* cmin to insert in output tuples */
+	int			hi_options;		/* heap_insert performance options */
+	BulkInsertState bistate;	/* bulk insert state */
+} DR_transientrel;
+
+/*
+ * Nesting depth of REFRESH ... CONCURRENTLY maintenance; while it's nonzero,
+ * DML against materialized views is allowed.
+ */
+static int	matview_maintenance_depth = 0;
+
+static void transientrel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
+static void transientrel_receive(TupleTableSlot *slot, DestReceiver *self);
+static void transientrel_shutdown(DestReceiver *self);
+static void transientrel_destroy(DestReceiver *self);
+static void refresh_matview_datafill(DestReceiver *dest, Query *query,
+						 const char *queryString);
+static void refresh_by_diff(Oid matviewOid, Oid tempOid);
+
+/*
+ * ExecRefreshMatView -- execute a REFRESH MATERIALIZED VIEW command
+ *
+ * The stored query is run into a new heap.  Ordinarily that heap then
+ * replaces the old one wholesale, as CLUSTER does, which needs an
+ * AccessExclusiveLock for the duration.  With CONCURRENTLY the new heap is a
+ * temporary table instead, and only the rows that differ are deleted from and
+ * inserted into the materialized view, so that readers are never blocked.
+ *
+ * WITH NO DATA leaves the materialized view empty.
+ */
+void
+ExecRefreshMatView(RefreshMatViewStmt *stmt, const char *queryString,
+				   ParamListInfo params, char *completionTag)
+{
+	Oid			matviewOid;
+	Relation	matviewRel;
+	RewriteRule *rule;
+	List	   *actions;
+	Query	   *dataQuery;
+	Oid			tableSpace;
+	char		relpersistence;
+	Oid			relowner;
+	Oid			OIDNewHeap;
+	DestReceiver *dest;
+	LOCKMODE	lockmode;
+	Oid			save_userid;
+	int			save_sec_context;
+
+	if (stmt->concurrent && stmt->skipData)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("CONCURRENTLY and WITH NO DATA options cannot be used together")));
+
+	/* A concurrent refresh must let readers in */
+	lockmode = stmt->concurrent ? ExclusiveLock : AccessExclusiveLock;
+
+	/* Look up, check permissions on, and lock the matview */
+	matviewOid = RangeVarGetRelidExtended(stmt->relation, lockmode, false,
+										  false, RangeVarCallbackOwnsTable,
+										  NULL);
+	matviewRel = heap_open(matviewOid, NoLock);
+
+	/* Make sure it is a materialized view. */
+	if (matviewRel->rd_rel->relkind != RELKIND_MATVIEW)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not a materialized view",
+						RelationGetRelationName(matviewRel))));
+
+	/* We don't allow an oid column for a materialized view. */
+	Assert(!matviewRel->rd_rel->relhasoids);
+
+	/*
+	 * Check that everything is correct for a refresh.  Problems at this point
+	 * are internal errors, so elog is sufficient.
+	 */
+	if (matviewRel->rd_rel->relhasrules == false ||
+		matviewRel->rd_rules->numLocks < 1)
+		elog(ERROR,
+			 "materialized view \"%s\" is missing rewrite information",
+			 RelationGetRelationName(matviewRel));
+
+	if (matviewRel->rd_rules->numLocks > 1)
+		elog(ERROR,
+			 "materialized view \"%s\" has too many rules",
+			 RelationGetRelationName(matviewRel));
+
+	rule = matviewRel->rd_rules->rules[0];
+	if (rule->event != CMD_SELECT || !(rule->isInstead))
+		elog(ERROR,
+			 "the rule for materialized view \"%s\" is not a SELECT INSTEAD OF rule",
+			 RelationGetRelationName(matviewRel));
+
+	actions = rule->actions;
+	if (list_length(actions) != 1)
+		elog(ERROR,
+			 "the rule for materialized view \"%s\" is not a single action",
+			 RelationGetRelationName(matviewRel));
+
+	/*
+	 * The stored query was rewritten at the time of the MV definition, but
+	 * has not been scribbled on by the planner.
+	 */
+	dataQuery = (Query *) copyObject(linitial(actions));
+	Assert(IsA(dataQuery, Query));
+
+	/* Don't let anyone else refresh it while we work on it. */
+	CheckTableNotInUse(matviewRel, "REFRESH MATERIALIZED VIEW");
+
+	/*
+	 * A concurrent refresh sorts and compares whole rows, which needs an
+	 * ordering for every column type.  Check that up front, so the user gets
+	 * a clearer message than the one from deep inside the diff query.
+	 */
+	if (stmt->concurrent)
+	{
+		TupleDesc	tupdesc = RelationGetDescr(matviewRel);
+		int			i;
+
+		for (i = 0; i < tupdesc->natts; i++)
+		{
+			Form_pg_attribute attr = tupdesc->attrs[i];
+			TypeCacheEntry *typentry;
+
+			if (attr->attisdropped)
+				continue;
+			typentry = lookup_type_cache(attr->atttypid,
+										 TYPECACHE_EQ_OPR | TYPECACHE_CMP_PROC);
+			if (!OidIsValid(typentry->eq_opr) ||
+				!OidIsValid(typentry->cmp_proc))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot refresh materialized view \"%s\" concurrently",
+								RelationGetRelationName(matviewRel)),
+						 errdetail("Column \"%s\" has type %s, which has no default btree operator class.",
+								   NameStr(attr->attname),
+								   format_type_be(attr->atttypid))));
+		}
+	}
+
+	tableSpace = matviewRel->rd_rel->reltablespace;
+	relpersistence = matviewRel->rd_rel->relpersistence;
+	relowner = matviewRel->rd_rel->relowner;
+
+	heap_close(matviewRel, NoLock);
+
+	/*
+	 * Run the query as the owner of the materialized view, as is done when a
+	 * view is expanded, so that the result doesn't depend on who refreshes it.
+	 */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(relowner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE);
+
+	/*
+	 * Create the transient table that will receive the regenerated data.  For
+	 * a concurrent refresh it's a temporary table that we compare against
+	 * the current contents; otherwise it's swapped in for the old heap.
+	 */
+	if (stmt->concurrent)
+		relpersistence = RELPERSISTENCE_TEMP;
+	OIDNewHeap = make_new_heap(matviewOid, tableSpace, relpersistence,
+							   lockmode);
+	LockRelationOid(OIDNewHeap, AccessExclusiveLock);
+
+	/* Generate the data, if wanted. */
+	if (!stmt->skipData)
+	{
+		dest = CreateTransientRelDestReceiver(OIDNewHeap);
+		refresh_matview_datafill(dest, dataQuery, queryString);
+	}
+
+	if (stmt->concurrent)
+		refresh_by_diff(matviewOid, OIDNewHeap);
+	else
+	{
+		/*
+		 * Swap the physical files of the target and transient tables, then
+		 * rebuild the target's indexes and throw away the transient table.
+		 */
+		finish_heap_swap(matviewOid, OIDNewHeap, false, false, true,
+						 RecentXmin);
+	}
+
+	/* Restore userid and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+}
+
+/*
+ * refresh_matview_datafill
+ *
+ * Rewrite, plan and run the materialized view's query, sending the results
+ * to the given DestReceiver.
+ */
+static void
+refresh_matview_datafill(DestReceiver *dest, Query *query,
+						 const char *queryString)
+{
+	List	   *rewritten;
+	PlannedStmt *plan;
+	QueryDesc  *queryDesc;
+
+	/* The rule action came from the relcache, so lock what it references */
+	AcquireRewriteLocks(query, false);
+
+	/* Caller passed a copy, so the rewriter may scribble on it */
+	rewritten = QueryRewrite(query);
+
+	/* SELECT should never rewrite to more or less than one SELECT query */
+	if (list_length(rewritten) != 1)
+		elog(ERROR, "unexpected rewrite result for REFRESH MATERIALIZED VIEW");
+	query = (Query *) linitial(rewritten);
+
+	/* Check for user-requested abort. */
+	CHECK_FOR_INTERRUPTS();
+
+	/* Plan the query which will generate data for the refresh. */
+	plan = pg_plan_query(query, 0, NULL);
+
+	/*
+	 * Use a snapshot with an updated command ID to ensure this query sees
+	 * results of any previously executed queries.  (This could only matter if
+	 * the planner executed an allegedly-stable function that changed the
+	 * database contents, but let's do it anyway to be safe.)
+	 */
+	PushCopiedSnapshot(GetActiveSnapshot());
+	UpdateActiveSnapshotCommandId();
+
+	/* Create a QueryDesc, redirecting output to our tuple receiver */
+	queryDesc = CreateQueryDesc(plan, queryString,
+								GetActiveSnapshot(), InvalidSnapshot,
+								dest, NULL, 0);
+
+	/* call ExecutorStart to prepare the plan for execution */
+	ExecutorStart(queryDesc, 0);
+
+	/* run the plan */
+	ExecutorRun(queryDesc, ForwardScanDirection, 0L);
+
+	/* and clean up */
+	ExecutorFinish(queryDesc);
+	ExecutorEnd(queryDesc);
+
+	FreeQueryDesc(queryDesc);
+
+	PopActiveSnapshot();
+
+	(*dest->rDestroy) (dest);
+}
+
+/*
+ * refresh_by_diff
+ *
+ * Bring the materialized view's contents in line with the freshly generated
+ * data in the temporary table tempOid, by deleting the rows that are no
+ * longer present and inserting the ones that are new.  Rows that didn't
+ * change are left alone, so an unchanged row keeps its tuple and a small
+ * change to the result costs a small amount of write activity.
+ *
+ * Rows are matched with the record "=" operator, numbered within each group
+ * of equal rows so that duplicates are matched one to one; this doesn't
+ * require a unique index.  "=" uses each column type's own equality, which
+ * treats some distinguishable values as equal (numeric 1.0 and 1.00, say),
+ * so a matched pair is also compared with the "*=" operator, which checks
+ * that the stored images are identical, and replaced if they are not.
+ *
+ * The differences are saved in a second temporary table first, and then
+ * applied by deleting before inserting, so that a unique index on the
+ * materialized view doesn't see a replacement row while the row it replaces
+ * is still there.  Both temporary tables are dropped when done.
+ */
+static void
+refresh_by_diff(Oid matviewOid, Oid tempOid)
+{
+	StringInfoData querybuf;
+	char	   *matviewname;
+	char	   *tempname;
+	char	   *diffname;
+	char		diffrelname[NAMEDATALEN];
+	ObjectAddress object;
+
+	matviewname = quote_qualified_identifier(get_namespace_name(get_rel_namespace(matviewOid)),
+											 get_rel_name(matviewOid));
+	tempname = quote_qualified_identifier(get_namespace_name(get_rel_namespace(tempOid)),
+										  get_rel_name(tempOid));
+	snprintf(diffrelname, sizeof(diffrelname), "%s_2", get_rel_name(tempOid));
+	diffname = quote_qualified_identifier(get_namespace_name(get_rel_namespace(tempOid)),
+										  diffrelname);
+
+	initStringInfo(&querybuf);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	/*
+	 * Find the rows to delete (tid set) and to insert (newrn set).  The whole
+	 * rows are written as "m.*" rather than "m" so that a column of that name
+	 * can't be picked up instead.
+	 */
+	appendStringInfo(&querybuf,
+					 "CREATE TEMP TABLE %s AS "
+					 "SELECT mv.tid, nd.newdata, nd.rn AS newrn FROM "
+					 "(SELECT m.ctid AS tid, m.*::%s AS olddata, "
+					 "row_number() OVER (PARTITION BY m.*) AS rn "
+					 "FROM %s m) mv "
+					 "FULL JOIN "
+					 "(SELECT n.*::%s AS newdata, "
+					 "row_number() OVER (PARTITION BY n.*) AS rn "
+					 "FROM %s n) nd "
+					 "ON mv.olddata OPERATOR(pg_catalog.=) nd.newdata "
+					 "AND mv.rn = nd.rn "
+					 "WHERE mv.rn IS NULL OR nd.rn IS NULL "
+					 "OR NOT (mv.olddata OPERATOR(pg_catalog.*=) nd.newdata)",
+					 diffname, matviewname, matviewname, tempname, tempname);
+	if (SPI_execute(querybuf.data, false, 0) != SPI_OK_SELINTO)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	matview_maintenance_depth++;
+	PG_TRY();
+	{
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf,
+						 "DELETE FROM %s WHERE ctid = ANY "
+						 "(ARRAY(SELECT tid FROM %s WHERE tid IS NOT NULL))",
+						 matviewname, diffname);
+		if (SPI_execute(querybuf.data, false, 0) != SPI_OK_DELETE)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+		resetStringInfo(&querybuf);
+		appendStringInfo(&querybuf,
+						 "INSERT INTO %s SELECT (newdata).* FROM %s "
+						 "WHERE newrn IS NOT NULL",
+						 matviewname, diffname);
+		if (SPI_execute(querybuf.data, false, 0) != SPI_OK_INSERT)
+			elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+	}
+	PG_CATCH();
+	{
+		matview_maintenance_depth--;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	matview_maintenance_depth--;
+
+	/* The diff table uses the temporary table's rowtype, so drop it first */
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "DROP TABLE %s", diffname);
+	if (SPI_execute(querybuf.data, false, 0) != SPI_OK_UTILITY)
+		elog(ERROR, "SPI_exec failed: %s", querybuf.data);
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		elog(ERROR, "SPI_finish failed");
+
+	/*
+	 * The temporary table is local to our transaction and we know nothing
+	 * depends on it, so DROP_RESTRICT should be OK.
+	 */
+	object.classId = RelationRelationId;
+	object.objectId = tempOid;
+	object.objectSubId = 0;
+	performDeletion(&object, DROP_RESTRICT);
+
+	pfree(querybuf.data);
+}
+
+/*
+ * MatViewMaintenanceIsEnabled
+ *		Is a REFRESH CONCURRENTLY currently changing a materialized view?
+ *
+ * The executor refuses DML against a materialized view otherwise.
+ */
+bool
+MatViewMaintenanceIsEnabled(void)
+{
+	return matview_maintenance_depth > 0;
+}
+
+/*
+ * CreateTransientRelDestReceiver -- create a suitable DestReceiver object
+ */
+DestReceiver *
+CreateTransientRelDestReceiver(Oid transientoid)
+{
+	DR_transientrel *self = (DR_transientrel *) palloc0(sizeof(DR_transientrel));
+
+	self->pub.receiveSlot = transientrel_receive;
+	self->pub.rStartup = transientrel_startup;
+	self->pub.rShutdown = transientrel_shutdown;
+	self->pub.rDestroy = transientrel_destroy;
+	self->pub.mydest = DestTransientRel;
+	self->transientoid = transientoid;
+
+	return (DestReceiver *) self;
+}
+
+/*
+ * transientrel_startup --- executor startup
+ */
+static void
+transientrel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	DR_transientrel *myState = (DR_transientrel *) self;
+	Relation	transientrel;
+
+	transientrel = heap_open(myState->transientoid, NoLock);
+
+	/*
+	 * Fill private fields of myState for use by later routines
+	 */
+	myState->transientrel = transientrel;
+	myState->output_cid = GetCurrentCommandId(true);
+
+	/*
+	 * We can skip WAL-logging the insertions, unless PITR or streaming
+	 * replication is in use. We can skip the FSM in any case.
+	 */
+	myState->hi_options = HEAP_INSERT_SKIP_FSM |
+		(XLogIsNeeded() ? 0 : HEAP_INSERT_SKIP_WAL);
+	myState->bistate = GetBulkInsertState();
+
+	/* Not using WAL requires smgr_targblock be initially invalid */
+	Assert(RelationGetTargetBlock(transientrel) == InvalidBlockNumber);
+}
+
+/*
+ * transientrel_receive --- receive one tuple
+ */
+static void
+transientrel_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	DR_transientrel *myState = (DR_transientrel *) self;
+
+	/*
+	 * get the heap tuple out of the tuple table slot, making sure we have a
+	 * writable copy
+	 */
+	(void) ExecMaterializeSlot(slot);
+
+	GetTableAmRoutine(myState->transientrel)->InsertTableRow(myState->transientrel,
+															 slot,
+														myState->output_cid,
+														myState->hi_options,
+														  myState->bistate);
+
+	/* We know this is a newly created relation, so there are no indexes */
+}
+
+/*
+ * transientrel_shutdown --- executor end
+ */
+static void
+transientrel_shutdown(DestReceiver *self)
+{
+	DR_transientrel *myState = (DR_transientrel *) self;
+
+	FreeBulkInsertState(myState->bistate);
+
+	/* If we skipped using WAL, must heap_sync before commit */
+	GetTableAmRoutine(myState->transientrel)->FinishBulkInsert(myState->transientrel,
+														myState->hi_options);
+
+	/* close transientrel, but keep lock until commit */
+	heap_close(myState->transientrel, NoLock);
+	myState->transientrel = NULL;
+}
+
+/*
+ * transientrel_destroy --- release DestReceiver object
+ */
+static void
+transientrel_destroy(DestReceiver *self)
+{
+	pfree(self);
+}
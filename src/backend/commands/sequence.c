@@ -42,6 +42,14 @@
  */
 #define SEQ_LOG_VALS	32
 
+/*
+ * GUC parameter: if more than the sequence's own CACHE value, each backend
+ * fetches more and more values at a time from a sequence it uses a lot,
+ * doubling the number at every refill up to this limit.  Concurrent callers
+ * of nextval() then rarely need to lock the sequence's buffer, or write WAL.
+ */
+int			max_sequence_cache = 1;
+
 /*
  * The "special area" of a sequence's buffer page looks like this.
  */
@@ -74,6 +82,7 @@ typedef struct SeqTableData
 	/* if last != cached, we have not used up all the cached values */
 	int64		increment;		/* copy of sequence's increment field */
 	/* note that increment is zero until we first do read_info() */
+	int64		fetch_size;		/* number of values fetched at last refill */
 } SeqTableData;
 
 typedef SeqTableData *SeqTable;
@@ -297,6 +306,7 @@ ResetSequence(Oid seq_relid)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	elm->fetch_size = 0;
 
 	relation_close(seq_rel, NoLock);
 }
@@ -446,6 +456,7 @@ AlterSequence(AlterSeqStmt *stmt)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	elm->fetch_size = 0;
 
 	/* Now okay to update the on-disk tuple */
 	memcpy(seq, &new, sizeof(FormData_pg_sequence));
@@ -578,9 +589,22 @@ nextval_internal(Oid relid)
 	incby = seq->increment_by;
 	maxv = seq->max_value;
 	minv = seq->min_value;
-	fetch = cache = seq->cache_value;
+	cache = seq->cache_value;
 	log = seq->log_cnt;
 
+	/*
+	 * If allowed, fetch twice as many values as last time, so that a backend
+	 * calling nextval() often ends up taking large ranges of values, and
+	 * touching the sequence's buffer only once per range.
+	 */
+	if (max_sequence_cache > cache)
+	{
+		if (elm->fetch_size >= cache)
+			cache = Min(elm->fetch_size * 2, (int64) max_sequence_cache);
+		elm->fetch_size = cache;
+	}
+	fetch = cache;
+
 	if (!seq->is_called)
 	{
 		rescnt++;				/* last_value if not called */
@@ -863,8 +887,9 @@ do_setval(Oid relid, int64 next, bool iscalled)
 		elm->last_valid = true;
 	}
 
-	/* In any case, forget any future cached numbers */
+	/* In any case, forget any future cached numbers, and start small again */
 	elm->cached = elm->last;
+	elm->fetch_size = 0;
 
 	START_CRIT_SECTION();
 
@@ -1026,6 +1051,7 @@ init_sequence(Oid relid, SeqTable *p_elm, Relation *p_rel)
 		elm->lxid = InvalidLocalTransactionId;
 		elm->last_valid = false;
 		elm->last = elm->cached = elm->increment = 0;
+		elm->fetch_size = 0;
 		elm->next = seqtab;
 		seqtab = elm;
 	}
@@ -1050,6 +1076,7 @@ init_sequence(Oid relid, SeqTable *p_elm, Relation *p_rel)
 	{
 		elm->filenode = seqrel->rd_rel->relfilenode;
 		elm->cached = elm->last;
+		elm->fetch_size = 0;
 	}
 
 	/* Return results */
@@ -19,6 +19,7 @@
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
@@ -27,6 +28,7 @@
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
+#include "catalog/partition.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_depend.h"
@@ -35,6 +37,7 @@
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_opclass.h"
+#include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_tablespace.h"
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
@@ -69,11 +72,13 @@
 #include "rewrite/rewriteDefine.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/bufmgr.h"
+#include "storage/fd.h"
 #include "storage/lmgr.h"
 #include "storage/lock.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
@@ -214,6 +219,12 @@ static const struct dropmsgstrings dropmsgstringarray[] = {
 		gettext_noop("view \"%s\" does not exist, skipping"),
 		gettext_noop("\"%s\" is not a view"),
 	gettext_noop("Use DROP VIEW to remove a view.")},
+	{RELKIND_MATVIEW,
+		ERRCODE_UNDEFINED_TABLE,
+		gettext_noop("materialized view \"%s\" does not exist"),
+		gettext_noop("materialized view \"%s\" does not exist, skipping"),
+		gettext_noop("\"%s\" is not a materialized view"),
+	gettext_noop("Use DROP MATERIALIZED VIEW to remove a materialized view.")},
 	{RELKIND_INDEX,
 		ERRCODE_UNDEFINED_OBJECT,
 		gettext_noop("index \"%s\" does not exist"),
@@ -304,6 +315,7 @@ static void ATPrepAddColumn(List **wqueue, Relation rel, bool recurse, bool recu
 static void ATExecAddColumn(List **wqueue, AlteredTableInfo *tab, Relation rel,
 				ColumnDef *colDef, bool isOid,
 				bool recurse, bool recursing, LOCKMODE lockmode);
+static bool ATStoreMissingValue(Relation rel, AttrNumber attnum, Expr *expr);
 static void add_column_datatype_dependency(Oid relid, int32 attnum, Oid typid);
 static void add_column_collation_dependency(Oid relid, int32 attnum, Oid collid);
 static void ATPrepAddOids(List **wqueue, Relation rel, bool recurse,
@@ -321,6 +333,10 @@ static void ATExecSetOptions(Relation rel, const char *colName,
 				 Node *options, bool isReset, LOCKMODE lockmode);
 static void ATExecSetStorage(Relation rel, const char *colName,
 				 Node *newValue, LOCKMODE lockmode);
+static void ATExecAddStatistics(Relation rel, List *colNames,
+					LOCKMODE lockmode);
+static void ATExecDropStatistics(Relation rel, List *colNames,
+					 LOCKMODE lockmode);
 static void ATPrepDropColumn(List **wqueue, Relation rel, bool recurse, bool recursing,
 				 AlterTableCmd *cmd, LOCKMODE lockmode);
 static void ATExecDropColumn(List **wqueue, Relation rel, const char *colName,
@@ -758,6 +774,10 @@ RemoveRelations(DropStmt *drop)
 			relkind = RELKIND_VIEW;
 			break;
 
+		case OBJECT_MATVIEW:
+			relkind = RELKIND_MATVIEW;
+			break;
+
 		case OBJECT_FOREIGN_TABLE:
 			relkind = RELKIND_FOREIGN_TABLE;
 			break;
@@ -1137,6 +1157,12 @@ ExecuteTruncate(TruncateStmt *stmt)
 		}
 	}
 
+	/*
+	 * The referenced keys that foreign-key checks have verified may be gone
+	 * now.
+	 */
+	RI_ForgetAllCheckedKeys();
+
 	/*
 	 * Restart owned sequences if we were asked to.
 	 */
@@ -2011,6 +2037,9 @@ StoreCatalogInheritance1(Oid relationId, Oid parentOid,
 	 * Mark the parent as having subclasses.
 	 */
 	SetRelationHasSubclass(parentOid, true);
+
+	/* The parent's partition descriptor must include the new child */
+	CacheInvalidateRelcacheByRelid(parentOid);
 }
 
 /*
@@ -2748,6 +2777,8 @@ AlterTableGetLockLevel(List *cmds)
 			case AT_SetOptions:
 			case AT_ResetOptions:
 			case AT_SetStorage:
+			case AT_AddStatistics:
+			case AT_DropStatistics:
 			case AT_ValidateConstraint:
 				cmd_lockmode = ShareUpdateExclusiveLock;
 				break;
@@ -2885,6 +2916,13 @@ ATPrepCmd(List **wqueue, Relation rel, AlterTableCmd *cmd,
 			/* No command-specific prep needed */
 			pass = AT_PASS_MISC;
 			break;
+		case AT_AddStatistics:	/* ADD STATISTICS */
+		case AT_DropStatistics:	/* DROP STATISTICS */
+			ATSimplePermissions(rel, ATT_TABLE);
+			/* This command never recurses */
+			/* No command-specific prep needed */
+			pass = AT_PASS_MISC;
+			break;
 		case AT_DropColumn:		/* DROP COLUMN */
 			ATSimplePermissions(rel,
 						 ATT_TABLE | ATT_COMPOSITE_TYPE | ATT_FOREIGN_TABLE);
@@ -3133,6 +3171,12 @@ ATExecCmd(List **wqueue, AlteredTableInfo *tab, Relation rel,
 		case AT_SetStorage:		/* ALTER COLUMN SET STORAGE */
 			ATExecSetStorage(rel, cmd->name, cmd->def, lockmode);
 			break;
+		case AT_AddStatistics:	/* ADD STATISTICS */
+			ATExecAddStatistics(rel, (List *) cmd->def, lockmode);
+			break;
+		case AT_DropStatistics:	/* DROP STATISTICS */
+			ATExecDropStatistics(rel, (List *) cmd->def, lockmode);
+			break;
 		case AT_DropColumn:		/* DROP COLUMN */
 			ATExecDropColumn(wqueue, rel, cmd->name,
 					 cmd->behavior, false, false, cmd->missing_ok, lockmode);
@@ -3350,6 +3394,7 @@ ATRewriteTables(List **wqueue, LOCKMODE lockmode)
 			Relation	OldHeap;
 			Oid			OIDNewHeap;
 			Oid			NewTableSpace;
+			char		persistence;
 
 			OldHeap = heap_open(tab->relid, NoLock);
 
@@ -3363,6 +3408,7 @@ ATRewriteTables(List **wqueue, LOCKMODE lockmode)
 						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 						 errmsg("cannot rewrite system relation \"%s\"",
 								RelationGetRelationName(OldHeap))));
+			CheckTableIsHeap(OldHeap, "ALTER TABLE");
 
 			/*
 			 * Don't allow rewrite on temp tables of other backends ... their
@@ -3382,10 +3428,13 @@ ATRewriteTables(List **wqueue, LOCKMODE lockmode)
 			else
 				NewTableSpace = OldHeap->rd_rel->reltablespace;
 
+			persistence = OldHeap->rd_rel->relpersistence;
+
 			heap_close(OldHeap, NoLock);
 
 			/* Create transient table that will receive the modified data */
-			OIDNewHeap = make_new_heap(tab->relid, NewTableSpace);
+			OIDNewHeap = make_new_heap(tab->relid, NewTableSpace, persistence,
+									   AccessExclusiveLock);
 
 			/*
 			 * Copy the heap data into the new table with the desired
@@ -3646,6 +3695,7 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap, LOCKMODE lockmode)
 		 * Scan through the rows, generating a new row if needed and then
 		 * checking all the constraints.
 		 */
+		CheckTableIsHeap(oldrel, "ALTER TABLE");
 		scan = heap_beginscan(oldrel, SnapshotNow, 0, NULL);
 
 		/*
@@ -3705,7 +3755,7 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap, LOCKMODE lockmode)
 			{
 				int			attn = lfirst_int(l);
 
-				if (heap_attisnull(tuple, attn + 1))
+				if (heap_attisnull(tuple, attn + 1, newTupDesc))
 					ereport(ERROR,
 							(errcode(ERRCODE_NOT_NULL_VIOLATION),
 							 errmsg("column \"%s\" contains null values",
@@ -3785,11 +3835,13 @@ ATGetQueueEntry(List **wqueue, Relation rel)
 	/*
 	 * Not there, so add it.  Note that we make a copy of the relation's
 	 * existing descriptor before anything interesting can happen to it.
+	 * The copy includes the missing values of the columns, which a rewrite
+	 * needs to read the old rows.
 	 */
 	tab = (AlteredTableInfo *) palloc0(sizeof(AlteredTableInfo));
 	tab->relid = relid;
 	tab->relkind = rel->rd_rel->relkind;
-	tab->oldDesc = CreateTupleDescCopy(RelationGetDescr(rel));
+	tab->oldDesc = CreateTupleDescCopyConstr(RelationGetDescr(rel));
 
 	*wqueue = lappend(*wqueue, tab);
 
@@ -4213,6 +4265,7 @@ ATExecAddColumn(List **wqueue, AlteredTableInfo *tab, Relation rel,
 	Oid			collOid;
 	Form_pg_type tform;
 	Expr	   *defval;
+	bool		has_missing = false;
 	List	   *children;
 	ListCell   *child;
 	AclResult	aclresult;
@@ -4415,8 +4468,10 @@ ATExecAddColumn(List **wqueue, AlteredTableInfo *tab, Relation rel,
 	 * If there is no default, Phase 3 doesn't have to do anything, because
 	 * that effectively means that the default is NULL.  The heap tuple access
 	 * routines always check for attnum > # of attributes in tuple, and return
-	 * NULL if so, so without any modification of the tuple data we will get
-	 * the effect of NULL values in the new column.
+	 * the column's missing value, or NULL if it has none, so without any
+	 * modification of the tuple data we will get the effect of NULL values in
+	 * the new column.  Likewise, a default that is the same for every row
+	 * needs no rewrite, because we store it as the missing value.
 	 *
 	 * An exception occurs when the new column is of a domain type: the domain
 	 * might have a NOT NULL constraint, or a check constraint that indirectly
@@ -4473,16 +4528,38 @@ ATExecAddColumn(List **wqueue, AlteredTableInfo *tab, Relation rel,
 			newval->expr = expression_planner(defval);
 
 			tab->newvals = lappend(tab->newvals, newval);
-			tab->rewrite = true;
+
+			/*
+			 * If the default is the same for every row, we can store its
+			 * value as the column's missing value, which the existing rows
+			 * will then be read with, instead of rewriting the table.  We
+			 * still keep the expression in newvals, in case some other
+			 * subcommand forces a rewrite anyway.  Domain constraints are
+			 * checked by the rewrite, and system catalogs and tables of
+			 * other access methods can't have missing values.
+			 */
+			if (relkind == RELKIND_RELATION &&
+				RelationIsHeap(rel) &&
+				!IsSystemRelation(rel) &&
+				GetDomainConstraints(typeOid) == NIL &&
+				!contain_volatile_functions((Node *) newval->expr))
+			{
+				if (ATStoreMissingValue(rel, attribute.attnum, newval->expr))
+					has_missing = true;
+			}
+			else
+				tab->rewrite = true;
 		}
 
 		/*
-		 * If the new column is NOT NULL, tell Phase 3 it needs to test that.
+		 * If the new column is NOT NULL, tell Phase 3 it needs to test that,
+		 * unless every existing row gets a non-null missing value for it.
 		 * (Note we don't do this for an OID column.  OID will be marked not
 		 * null, but since it's filled specially, there's no need to test
 		 * anything.)
 		 */
-		tab->new_notnull |= colDef->is_not_null;
+		if (!has_missing)
+			tab->new_notnull |= colDef->is_not_null;
 	}
 
 	/*
@@ -4543,6 +4620,39 @@ ATExecAddColumn(List **wqueue, AlteredTableInfo *tab, Relation rel,
 	}
 }
 
+/*
+ * Evaluate the default of a column being added, and store the value as the
+ * column's missing value, so that the existing rows don't have to be
+ * rewritten.  The expression must already be planned, and not be volatile.
+ *
+ * Returns false if the value is NULL, which needs no missing value.
+ */
+static bool
+ATStoreMissingValue(Relation rel, AttrNumber attnum, Expr *expr)
+{
+	EState	   *estate;
+	ExprState  *exprstate;
+	Datum		value;
+	bool		isnull;
+
+	estate = CreateExecutorState();
+	exprstate = ExecInitExpr(expr, NULL);
+	value = ExecEvalExpr(exprstate, GetPerTupleExprContext(estate),
+						 &isnull, NULL);
+
+	if (!isnull)
+	{
+		StoreAttrMissingVal(rel, attnum, value);
+
+		/* Make the missing value visible to Phase 3 */
+		CommandCounterIncrement();
+	}
+
+	FreeExecutorState(estate);
+
+	return !isnull;
+}
+
 /*
  * Install a column's dependency on its datatype.
  */
@@ -4671,7 +4781,7 @@ ATExecDropNotNull(Relation rel, const char *colName, LOCKMODE lockmode)
 			 * Loop over each attribute in the primary key and see if it
 			 * matches the to-be-altered attribute
 			 */
-			for (i = 0; i < indexStruct->indnatts; i++)
+			for (i = 0; i < indexStruct->indnkeyatts; i++)
 			{
 				if (indexStruct->indkey.values[i] == attnum)
 					ereport(ERROR,
@@ -5022,6 +5132,173 @@ ATExecSetStorage(Relation rel, const char *colName, Node *newValue, LOCKMODE loc
 }
 
 
+/*
+ * ALTER TABLE ADD/DROP STATISTICS
+ *
+ * A column group is identified by its set of columns, so the order in which
+ * they are listed doesn't matter; we keep them sorted by column number.
+ */
+static int
+ATStatisticsColumns(Relation rel, List *colNames, int2 *attnums)
+{
+	int			natts = 0;
+	ListCell   *lc;
+
+	foreach(lc, colNames)
+	{
+		char	   *colName = strVal(lfirst(lc));
+		AttrNumber	attnum;
+		int			i;
+
+		attnum = get_attnum(RelationGetRelid(rel), colName);
+		if (attnum == InvalidAttrNumber)
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_COLUMN),
+					 errmsg("column \"%s\" of relation \"%s\" does not exist",
+							colName, RelationGetRelationName(rel))));
+		if (attnum <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot collect statistics on system column \"%s\"",
+							colName)));
+		if (natts >= STATISTIC_EXT_MAX_COLUMNS)
+			ereport(ERROR,
+					(errcode(ERRCODE_TOO_MANY_COLUMNS),
+					 errmsg("cannot collect statistics on more than %d columns together",
+							STATISTIC_EXT_MAX_COLUMNS)));
+
+		/* insertion sort, checking for duplicates as we go */
+		for (i = natts; i > 0 && attnums[i - 1] >= attnum; i--)
+		{
+			if (attnums[i - 1] == attnum)
+				ereport(ERROR,
+						(errcode(ERRCODE_DUPLICATE_COLUMN),
+						 errmsg("column \"%s\" appears more than once in statistics definition",
+								colName)));
+			attnums[i] = attnums[i - 1];
+		}
+		attnums[i] = attnum;
+		natts++;
+	}
+
+	if (natts < STATISTIC_EXT_MIN_COLUMNS)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+				 errmsg("statistics must be collected on at least %d columns together",
+						STATISTIC_EXT_MIN_COLUMNS)));
+
+	return natts;
+}
+
+/*
+ * Find the pg_statistic_ext row for a column group, if any; the result is
+ * a copy.
+ */
+static HeapTuple
+ATFindStatistics(Relation sd, Relation rel, int2 *attnums, int natts)
+{
+	SysScanDesc scan;
+	ScanKeyData key;
+	HeapTuple	tuple;
+	HeapTuple	result = NULL;
+
+	ScanKeyInit(&key,
+				Anum_pg_statistic_ext_starelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(RelationGetRelid(rel)));
+
+	scan = systable_beginscan(sd, StatisticExtRelidIndexId, true,
+							  SnapshotNow, 1, &key);
+
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_statistic_ext form = (Form_pg_statistic_ext) GETSTRUCT(tuple);
+
+		if (form->stakeys.dim1 == natts &&
+			memcmp(form->stakeys.values, attnums, natts * sizeof(int2)) == 0)
+		{
+			result = heap_copytuple(tuple);
+			break;
+		}
+	}
+
+	systable_endscan(scan);
+
+	return result;
+}
+
+static void
+ATExecAddStatistics(Relation rel, List *colNames, LOCKMODE lockmode)
+{
+	int2		attnums[STATISTIC_EXT_MAX_COLUMNS];
+	int			natts;
+	Relation	sd;
+	HeapTuple	tuple;
+	Datum		values[Natts_pg_statistic_ext];
+	bool		nulls[Natts_pg_statistic_ext];
+
+	natts = ATStatisticsColumns(rel, colNames, attnums);
+
+	sd = heap_open(StatisticExtRelationId, RowExclusiveLock);
+
+	if (ATFindStatistics(sd, rel, attnums, natts) != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_DUPLICATE_OBJECT),
+				 errmsg("statistics on these columns of relation \"%s\" already exist",
+						RelationGetRelationName(rel))));
+
+	memset(nulls, false, sizeof(nulls));
+	values[Anum_pg_statistic_ext_starelid - 1] =
+		ObjectIdGetDatum(RelationGetRelid(rel));
+	values[Anum_pg_statistic_ext_stadistinct - 1] = Float4GetDatum(0.0);
+	values[Anum_pg_statistic_ext_stakeys - 1] =
+		PointerGetDatum(buildint2vector(attnums, natts));
+	/* filled in by the next ANALYZE */
+	values[Anum_pg_statistic_ext_stadependencies - 1] = (Datum) 0;
+	nulls[Anum_pg_statistic_ext_stadependencies - 1] = true;
+
+	tuple = heap_form_tuple(RelationGetDescr(sd), values, nulls);
+	simple_heap_insert(sd, tuple);
+
+	/* keep system catalog indexes current */
+	CatalogUpdateIndexes(sd, tuple);
+
+	heap_freetuple(tuple);
+
+	heap_close(sd, RowExclusiveLock);
+
+	/* the column groups are cached in the relcache entry */
+	CacheInvalidateRelcache(rel);
+}
+
+static void
+ATExecDropStatistics(Relation rel, List *colNames, LOCKMODE lockmode)
+{
+	int2		attnums[STATISTIC_EXT_MAX_COLUMNS];
+	int			natts;
+	Relation	sd;
+	HeapTuple	tuple;
+
+	natts = ATStatisticsColumns(rel, colNames, attnums);
+
+	sd = heap_open(StatisticExtRelationId, RowExclusiveLock);
+
+	tuple = ATFindStatistics(sd, rel, attnums, natts);
+	if (tuple == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("statistics on these columns of relation \"%s\" do not exist",
+						RelationGetRelationName(rel))));
+
+	simple_heap_delete(sd, &tuple->t_self);
+
+	heap_freetuple(tuple);
+
+	heap_close(sd, RowExclusiveLock);
+
+	CacheInvalidateRelcache(rel);
+}
+
 /*
  * ALTER TABLE DROP COLUMN
  *
@@ -5271,6 +5548,7 @@ ATExecAddIndex(AlteredTableInfo *tab, Relation rel,
 							stmt->accessMethod, /* am name */
 							stmt->tableSpace,
 							stmt->indexParams,	/* parameters */
+							stmt->indexIncludingParams,
 							(Expr *) stmt->whereClause,
 							stmt->options,
 							stmt->excludeOpNames,
@@ -5987,9 +6265,11 @@ ATExecValidateConstraint(Relation rel, char *constrName, bool recurse,
 
 			/*
 			 * Invalidate relcache so that others see the new validated
-			 * constraint.
+			 * constraint.  The parents' partition descriptors may now be
+			 * able to use it, too.
 			 */
 			CacheInvalidateRelcache(rel);
+			CacheInvalidatePartitionParents(RelationGetRelid(rel));
 		}
 
 		/*
@@ -6129,10 +6409,11 @@ transformFkeyGetPrimaryKey(Relation pkrel, Oid *indexOid,
 
 	/*
 	 * Now build the list of PK attributes from the indkey definition (we
-	 * assume a primary key cannot have expressional elements)
+	 * assume a primary key cannot have expressional elements).  Any INCLUDE
+	 * columns are not part of the key.
 	 */
 	*attnamelist = NIL;
-	for (i = 0; i < indexStruct->indnatts; i++)
+	for (i = 0; i < indexStruct->indnkeyatts; i++)
 	{
 		int			pkattno = indexStruct->indkey.values[i];
 
@@ -6188,13 +6469,13 @@ transformFkeyCheckAttrs(Relation pkrel,
 		indexStruct = (Form_pg_index) GETSTRUCT(indexTuple);
 
 		/*
-		 * Must have the right number of columns; must be unique and not a
-		 * partial index; forget it if there are any expressions, too
+		 * Must have the right number of key columns; must be unique and not
+		 * a partial index; forget it if there are any expressions, too
 		 */
-		if (indexStruct->indnatts == numattrs &&
+		if (indexStruct->indnkeyatts == numattrs &&
 			indexStruct->indisunique &&
-			heap_attisnull(indexTuple, Anum_pg_index_indpred) &&
-			heap_attisnull(indexTuple, Anum_pg_index_indexprs))
+			heap_attisnull(indexTuple, Anum_pg_index_indpred, NULL) &&
+			heap_attisnull(indexTuple, Anum_pg_index_indexprs, NULL))
 		{
 			/* Must get indclass the hard way */
 			Datum		indclassDatum;
@@ -6352,6 +6633,7 @@ validateCheckConstraint(Relation rel, HeapTuple constrtup)
 	slot = MakeSingleTupleTableSlot(tupdesc);
 	econtext->ecxt_scantuple = slot;
 
+	CheckTableIsHeap(rel, "ALTER TABLE");
 	scan = heap_beginscan(rel, SnapshotNow, 0, NULL);
 
 	/*
@@ -6426,6 +6708,7 @@ validateForeignKeyConstraint(char *conname,
 	 * if that tuple had just been inserted.  If any of those fail, it should
 	 * ereport(ERROR) and that's that.
 	 */
+	CheckTableIsHeap(rel, "ALTER TABLE");
 	scan = heap_beginscan(rel, SnapshotNow, 0, NULL);
 
 	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
@@ -6451,6 +6734,8 @@ validateForeignKeyConstraint(char *conname,
 		trigdata.tg_trigger = &trig;
 		trigdata.tg_trigtuplebuf = scan->rs_cbuf;
 		trigdata.tg_newtuplebuf = InvalidBuffer;
+		trigdata.tg_oldtable = NULL;
+		trigdata.tg_newtable = NULL;
 
 		fcinfo.context = (Node *) &trigdata;
 
@@ -7387,6 +7672,60 @@ ATExecAlterColumnType(AlteredTableInfo *tab, Relation rel,
 
 	heap_close(depRel, RowExclusiveLock);
 
+	/*
+	 * The column's missing value, if it has one, must change type too.  If
+	 * the table is being rewritten, the rewrite reads the old rows through
+	 * the old descriptor, which keeps the old missing value, so we can just
+	 * drop it.  Otherwise the new type is binary-compatible with the old
+	 * one, so the value itself stays valid and we only need to store it in
+	 * an array of the new type.
+	 */
+	if (attTup->atthasmissing)
+	{
+		Datum		valuesAtt[Natts_pg_attribute];
+		bool		nullsAtt[Natts_pg_attribute];
+		bool		replacesAtt[Natts_pg_attribute];
+		HeapTuple	newTup;
+
+		memset(valuesAtt, 0, sizeof(valuesAtt));
+		memset(nullsAtt, false, sizeof(nullsAtt));
+		memset(replacesAtt, false, sizeof(replacesAtt));
+
+		if (tab->rewrite)
+		{
+			attTup->atthasmissing = false;
+			nullsAtt[Anum_pg_attribute_attmissingval - 1] = true;
+		}
+		else
+		{
+			Datum		missingval;
+			bool		missingNull;
+			int			one = 1;
+
+			missingval = heap_getattr(heapTup, Anum_pg_attribute_attmissingval,
+									  RelationGetDescr(attrelation),
+									  &missingNull);
+			Assert(!missingNull);
+			missingval = array_ref(DatumGetArrayTypeP(missingval),
+								   1, &one, -1,
+								   attTup->attlen, attTup->attbyval,
+								   attTup->attalign, &missingNull);
+			valuesAtt[Anum_pg_attribute_attmissingval - 1] =
+				PointerGetDatum(construct_array(&missingval, 1,
+												targettype,
+												tform->typlen,
+												tform->typbyval,
+												tform->typalign));
+		}
+		replacesAtt[Anum_pg_attribute_attmissingval - 1] = true;
+
+		newTup = heap_modify_tuple(heapTup, RelationGetDescr(attrelation),
+								   valuesAtt, nullsAtt, replacesAtt);
+		heap_freetuple(heapTup);
+		heapTup = newTup;
+		attTup = (Form_pg_attribute) GETSTRUCT(heapTup);
+	}
+
 	/*
 	 * Here we go --- change the recorded column type and collation.  (Note
 	 * heapTup is a copy of the syscache entry, so okay to scribble on.)
@@ -7711,6 +8050,7 @@ TryReuseIndex(Oid oldId, IndexStmt *stmt)
 							 stmt->relation,
 							 stmt->accessMethod,
 							 stmt->indexParams,
+							 stmt->indexIncludingParams,
 							 stmt->excludeOpNames))
 	{
 		Relation irel = index_open(oldId, NoLock);
@@ -8459,19 +8799,25 @@ copy_relation_data(SMgrRelation src, SMgrRelation dst,
 				   ForkNumber forkNum, char relpersistence)
 {
 	char	   *buf;
-	Page		page;
+	char	   *bufs[PG_IOV_MAX];
 	bool		use_wal;
 	BlockNumber nblocks;
+	BlockNumber nbatch;
 	BlockNumber blkno;
+	int			i;
 
 	/*
 	 * palloc the buffer so that it's MAXALIGN'd.  If it were just a local
 	 * char[] array, the compiler might align it on any byte boundary, which
 	 * can seriously hurt transfer speed to and from the kernel; not to
 	 * mention possibly making log_newpage's accesses to the page header fail.
+	 *
+	 * We copy PG_IOV_MAX blocks at a time, so that smgr can transfer each
+	 * batch with one read and one write call.
 	 */
-	buf = (char *) palloc(BLCKSZ);
-	page = (Page) buf;
+	buf = (char *) palloc(PG_IOV_MAX * BLCKSZ);
+	for (i = 0; i < PG_IOV_MAX; i++)
+		bufs[i] = buf + i * BLCKSZ;
 
 	/*
 	 * We need to log the copied data in WAL iff WAL archiving/streaming is
@@ -8481,23 +8827,29 @@ copy_relation_data(SMgrRelation src, SMgrRelation dst,
 
 	nblocks = smgrnblocks(src, forkNum);
 
-	for (blkno = 0; blkno < nblocks; blkno++)
+	for (blkno = 0; blkno < nblocks; blkno += nbatch)
 	{
+		nbatch = Min(nblocks - blkno, PG_IOV_MAX);
+
 		/* If we got a cancel signal during the copy of the data, quit */
 		CHECK_FOR_INTERRUPTS();
 
-		smgrread(src, forkNum, blkno, buf);
+		smgrreadv(src, forkNum, blkno, bufs, nbatch);
 
 		/* XLOG stuff */
 		if (use_wal)
-			log_newpage(&dst->smgr_rnode.node, forkNum, blkno, page);
+		{
+			for (i = 0; i < nbatch; i++)
+				log_newpage(&dst->smgr_rnode.node, forkNum, blkno + i,
+							(Page) bufs[i]);
+		}
 
 		/*
-		 * Now write the page.	We say isTemp = true even if it's not a temp
+		 * Now write the pages.  We say isTemp = true even if it's not a temp
 		 * rel, because there's no need for smgr to schedule an fsync for this
 		 * write; we'll do it ourselves below.
 		 */
-		smgrextend(dst, forkNum, blkno, buf, true);
+		smgrextendv(dst, forkNum, blkno, bufs, nbatch, true);
 	}
 
 	pfree(buf);
@@ -8976,6 +9328,7 @@ ATExecDropInherit(Relation rel, RangeVar *parent, LOCKMODE lockmode)
 		if (inhparent == RelationGetRelid(parent_rel))
 		{
 			simple_heap_delete(catalogRelation, &inheritsTuple->t_self);
+			CacheInvalidateRelcache(parent_rel);
 			found = true;
 			break;
 		}
@@ -9853,10 +10206,12 @@ RangeVarCallbackOwnsTable(const RangeVar *relation,
 	relkind = get_rel_relkind(relId);
 	if (!relkind)
 		return;
-	if (relkind != RELKIND_RELATION && relkind != RELKIND_TOASTVALUE)
+	if (relkind != RELKIND_RELATION && relkind != RELKIND_TOASTVALUE &&
+		relkind != RELKIND_MATVIEW)
 		ereport(ERROR,
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
-				 errmsg("\"%s\" is not a table", relation->relname)));
+				 errmsg("\"%s\" is not a table or materialized view",
+						relation->relname)));
 
 	/* Check permissions */
 	if (!pg_class_ownercheck(relId, GetUserId()))
@@ -42,6 +42,7 @@
 #include "pgstat.h"
 #include "rewrite/rewriteManip.h"
 #include "storage/bufmgr.h"
+#include "storage/buffile.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -51,6 +52,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/resowner.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
@@ -59,6 +61,9 @@
 /* GUC variables */
 int			SessionReplicationRole = SESSION_REPLICATION_ROLE_ORIGIN;
 
+/* Trigger whose transition tables pg_transition_table() can see, if any */
+static TriggerData *TransitionTriggerData = NULL;
+
 
 #define GetModifiedColumns(relinfo, estate) \
 	(rt_fetch((relinfo)->ri_RangeTableIndex, (estate)->es_range_table)->modifiedCols)
@@ -140,6 +145,8 @@ CreateTrigger(CreateTrigStmt *stmt, const char *queryString,
 	char		internaltrigname[NAMEDATALEN];
 	char	   *trigname;
 	Oid			constrrelid = InvalidOid;
+	char	   *oldtablename = NULL;
+	char	   *newtablename = NULL;
 	ObjectAddress myself,
 				referenced;
 
@@ -253,6 +260,97 @@ CreateTrigger(CreateTrigStmt *stmt, const char *queryString,
 					 errmsg("INSTEAD OF triggers cannot have column lists")));
 	}
 
+	/*
+	 * Check the REFERENCING clause, if any.  We don't support naming
+	 * transition rows (OLD and NEW serve for that), but the parser accepts
+	 * the syntax so that we can give a helpful message.  Transition tables
+	 * are collected while the statement runs and handed to the trigger when
+	 * it fires at the end of the statement, so only non-deferred AFTER
+	 * statement-level triggers on tables can have them.
+	 */
+	if (stmt->transitionRels != NIL)
+	{
+		ListCell   *lc;
+
+		foreach(lc, stmt->transitionRels)
+		{
+			TriggerTransition *tt = (TriggerTransition *) lfirst(lc);
+
+			Assert(IsA(tt, TriggerTransition));
+
+			if (!tt->isTable)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("ROW variable naming in the REFERENCING clause is not supported"),
+						 errhint("Use OLD and NEW to refer to the row values instead.")));
+
+			if (rel->rd_rel->relkind != RELKIND_RELATION)
+				ereport(ERROR,
+						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+						 errmsg("\"%s\" is a view",
+								RelationGetRelationName(rel)),
+						 errdetail("Triggers on views cannot have transition tables.")));
+
+			if (!TRIGGER_FOR_AFTER(tgtype))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+						 errmsg("transition table name can only be specified for an AFTER trigger")));
+
+			if (TRIGGER_FOR_TRUNCATE(tgtype))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("TRUNCATE triggers with transition tables are not supported")));
+
+			if (stmt->isconstraint)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("constraint triggers cannot have transition tables")));
+
+			if (TRIGGER_FOR_ROW(tgtype))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("transition tables are only supported for statement-level triggers")));
+
+			if (stmt->columns != NIL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("transition tables cannot be specified for triggers with column lists")));
+
+			if (tt->isNew)
+			{
+				if (!TRIGGER_FOR_INSERT(tgtype) &&
+					!TRIGGER_FOR_UPDATE(tgtype))
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+							 errmsg("NEW TABLE can only be specified for an INSERT or UPDATE trigger")));
+				if (newtablename != NULL)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+							 errmsg("NEW TABLE cannot be specified multiple times")));
+				newtablename = tt->name;
+			}
+			else
+			{
+				if (!TRIGGER_FOR_DELETE(tgtype) &&
+					!TRIGGER_FOR_UPDATE(tgtype))
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+							 errmsg("OLD TABLE can only be specified for a DELETE or UPDATE trigger")));
+				if (oldtablename != NULL)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+							 errmsg("OLD TABLE cannot be specified multiple times")));
+				oldtablename = tt->name;
+			}
+		}
+
+		if (newtablename != NULL && oldtablename != NULL &&
+			strcmp(newtablename, oldtablename) == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+					 errmsg("OLD TABLE name and NEW TABLE name cannot be the same")));
+	}
+
 	/*
 	 * Parse the WHEN clause, if any
 	 */
@@ -617,6 +715,18 @@ CreateTrigger(CreateTrigStmt *stmt, const char *queryString,
 	else
 		nulls[Anum_pg_trigger_tgqual - 1] = true;
 
+	/* set the transition table names, if any */
+	if (oldtablename)
+		values[Anum_pg_trigger_tgoldtable - 1] = DirectFunctionCall1(namein,
+											  CStringGetDatum(oldtablename));
+	else
+		nulls[Anum_pg_trigger_tgoldtable - 1] = true;
+	if (newtablename)
+		values[Anum_pg_trigger_tgnewtable - 1] = DirectFunctionCall1(namein,
+											  CStringGetDatum(newtablename));
+	else
+		nulls[Anum_pg_trigger_tgnewtable - 1] = true;
+
 	tuple = heap_form_tuple(tgrel->rd_att, values, nulls);
 
 	/* force tuple to have the desired OID */
@@ -1525,6 +1635,18 @@ RelationBuildTriggers(Relation relation)
 			build->tgqual = TextDatumGetCString(datum);
 		else
 			build->tgqual = NULL;
+		datum = fastgetattr(htup, Anum_pg_trigger_tgoldtable,
+							tgrel->rd_att, &isnull);
+		if (!isnull)
+			build->tgoldtable = pstrdup(NameStr(*DatumGetName(datum)));
+		else
+			build->tgoldtable = NULL;
+		datum = fastgetattr(htup, Anum_pg_trigger_tgnewtable,
+							tgrel->rd_att, &isnull);
+		if (!isnull)
+			build->tgnewtable = pstrdup(NameStr(*DatumGetName(datum)));
+		else
+			build->tgnewtable = NULL;
 
 		numtrigs++;
 	}
@@ -1615,6 +1737,15 @@ SetTriggerFlags(TriggerDesc *trigdesc, Trigger *trigger)
 	trigdesc->trig_truncate_after_statement |=
 		TRIGGER_TYPE_MATCHES(tgtype, TRIGGER_TYPE_STATEMENT,
 							 TRIGGER_TYPE_AFTER, TRIGGER_TYPE_TRUNCATE);
+
+	trigdesc->trig_insert_new_table |=
+		(TRIGGER_FOR_INSERT(tgtype) && trigger->tgnewtable != NULL);
+	trigdesc->trig_update_old_table |=
+		(TRIGGER_FOR_UPDATE(tgtype) && trigger->tgoldtable != NULL);
+	trigdesc->trig_update_new_table |=
+		(TRIGGER_FOR_UPDATE(tgtype) && trigger->tgnewtable != NULL);
+	trigdesc->trig_delete_old_table |=
+		(TRIGGER_FOR_DELETE(tgtype) && trigger->tgoldtable != NULL);
 }
 
 /*
@@ -1664,6 +1795,10 @@ CopyTriggerDesc(TriggerDesc *trigdesc)
 		}
 		if (trigger->tgqual)
 			trigger->tgqual = pstrdup(trigger->tgqual);
+		if (trigger->tgoldtable)
+			trigger->tgoldtable = pstrdup(trigger->tgoldtable);
+		if (trigger->tgnewtable)
+			trigger->tgnewtable = pstrdup(trigger->tgnewtable);
 		trigger++;
 	}
 
@@ -1696,6 +1831,10 @@ FreeTriggerDesc(TriggerDesc *trigdesc)
 		}
 		if (trigger->tgqual)
 			pfree(trigger->tgqual);
+		if (trigger->tgoldtable)
+			pfree(trigger->tgoldtable);
+		if (trigger->tgnewtable)
+			pfree(trigger->tgnewtable);
 		trigger++;
 	}
 	pfree(trigdesc->triggers);
@@ -1774,6 +1913,18 @@ equalTriggerDescs(TriggerDesc *trigdesc1, TriggerDesc *trigdesc2)
 				return false;
 			else if (strcmp(trig1->tgqual, trig2->tgqual) != 0)
 				return false;
+			if (trig1->tgoldtable == NULL && trig2->tgoldtable == NULL)
+				 /* ok */ ;
+			else if (trig1->tgoldtable == NULL || trig2->tgoldtable == NULL)
+				return false;
+			else if (strcmp(trig1->tgoldtable, trig2->tgoldtable) != 0)
+				return false;
+			if (trig1->tgnewtable == NULL && trig2->tgnewtable == NULL)
+				 /* ok */ ;
+			else if (trig1->tgnewtable == NULL || trig2->tgnewtable == NULL)
+				return false;
+			else if (strcmp(trig1->tgnewtable, trig2->tgnewtable) != 0)
+				return false;
 		}
 	}
 	else if (trigdesc2 != NULL)
@@ -1838,7 +1989,36 @@ ExecCallTriggerFunc(TriggerData *trigdata,
 
 	pgstat_init_function_usage(&fcinfo, &fcusage);
 
-	result = FunctionCallInvoke(&fcinfo);
+	/*
+	 * If the trigger has transition tables, make them visible to
+	 * pg_transition_table() while it runs.  Only then do we need to take
+	 * care of restoring the outer trigger's tables on error.
+	 */
+	if (trigdata->tg_oldtable != NULL || trigdata->tg_newtable != NULL ||
+		TransitionTriggerData != NULL)
+	{
+		TriggerData *save_trigdata = TransitionTriggerData;
+
+		if (trigdata->tg_oldtable != NULL || trigdata->tg_newtable != NULL)
+			TransitionTriggerData = trigdata;
+		else
+			TransitionTriggerData = NULL;
+
+		PG_TRY();
+		{
+			result = FunctionCallInvoke(&fcinfo);
+		}
+		PG_CATCH();
+		{
+			TransitionTriggerData = save_trigdata;
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		TransitionTriggerData = save_trigdata;
+	}
+	else
+		result = FunctionCallInvoke(&fcinfo);
 
 	pgstat_end_function_usage(&fcusage, true);
 
@@ -1882,6 +2062,8 @@ ExecBSInsertTriggers(EState *estate, ResultRelInfo *relinfo)
 	LocTriggerData.tg_event = TRIGGER_EVENT_INSERT |
 		TRIGGER_EVENT_BEFORE;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_trigtuple = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_trigtuplebuf = InvalidBuffer;
@@ -1940,6 +2122,8 @@ ExecBRInsertTriggers(EState *estate, ResultRelInfo *relinfo,
 		TRIGGER_EVENT_ROW |
 		TRIGGER_EVENT_BEFORE;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_newtuplebuf = InvalidBuffer;
 	for (i = 0; i < trigdesc->numtriggers; i++)
@@ -1994,7 +2178,8 @@ ExecARInsertTriggers(EState *estate, ResultRelInfo *relinfo,
 {
 	TriggerDesc *trigdesc = relinfo->ri_TrigDesc;
 
-	if (trigdesc && trigdesc->trig_insert_after_row)
+	if (trigdesc &&
+		(trigdesc->trig_insert_after_row || trigdesc->trig_insert_new_table))
 		AfterTriggerSaveEvent(estate, relinfo, TRIGGER_EVENT_INSERT,
 							  true, NULL, trigtuple, recheckIndexes, NULL);
 }
@@ -2015,6 +2200,8 @@ ExecIRInsertTriggers(EState *estate, ResultRelInfo *relinfo,
 		TRIGGER_EVENT_ROW |
 		TRIGGER_EVENT_INSTEAD;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_newtuplebuf = InvalidBuffer;
 	for (i = 0; i < trigdesc->numtriggers; i++)
@@ -2081,6 +2268,8 @@ ExecBSDeleteTriggers(EState *estate, ResultRelInfo *relinfo)
 	LocTriggerData.tg_event = TRIGGER_EVENT_DELETE |
 		TRIGGER_EVENT_BEFORE;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_trigtuple = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_trigtuplebuf = InvalidBuffer;
@@ -2146,6 +2335,8 @@ ExecBRDeleteTriggers(EState *estate, EPQState *epqstate,
 		TRIGGER_EVENT_ROW |
 		TRIGGER_EVENT_BEFORE;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_newtuplebuf = InvalidBuffer;
 	for (i = 0; i < trigdesc->numtriggers; i++)
@@ -2188,7 +2379,8 @@ ExecARDeleteTriggers(EState *estate, ResultRelInfo *relinfo,
 {
 	TriggerDesc *trigdesc = relinfo->ri_TrigDesc;
 
-	if (trigdesc && trigdesc->trig_delete_after_row)
+	if (trigdesc &&
+		(trigdesc->trig_delete_after_row || trigdesc->trig_delete_old_table))
 	{
 		HeapTuple	trigtuple = GetTupleForTrigger(estate, NULL, relinfo,
 												   tupleid, NULL);
@@ -2213,6 +2405,8 @@ ExecIRDeleteTriggers(EState *estate, ResultRelInfo *relinfo,
 		TRIGGER_EVENT_ROW |
 		TRIGGER_EVENT_INSTEAD;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_newtuplebuf = InvalidBuffer;
 	for (i = 0; i < trigdesc->numtriggers; i++)
@@ -2265,6 +2459,8 @@ ExecBSUpdateTriggers(EState *estate, ResultRelInfo *relinfo)
 	LocTriggerData.tg_event = TRIGGER_EVENT_UPDATE |
 		TRIGGER_EVENT_BEFORE;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_trigtuple = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_trigtuplebuf = InvalidBuffer;
@@ -2354,6 +2550,8 @@ ExecBRUpdateTriggers(EState *estate, EPQState *epqstate,
 		TRIGGER_EVENT_ROW |
 		TRIGGER_EVENT_BEFORE;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	for (i = 0; i < trigdesc->numtriggers; i++)
 	{
 		Trigger    *trigger = &trigdesc->triggers[i];
@@ -2413,7 +2611,9 @@ ExecARUpdateTriggers(EState *estate, ResultRelInfo *relinfo,
 {
 	TriggerDesc *trigdesc = relinfo->ri_TrigDesc;
 
-	if (trigdesc && trigdesc->trig_update_after_row)
+	if (trigdesc &&
+		(trigdesc->trig_update_after_row || trigdesc->trig_update_old_table ||
+		 trigdesc->trig_update_new_table))
 	{
 		HeapTuple	trigtuple = GetTupleForTrigger(estate, NULL, relinfo,
 												   tupleid, NULL);
@@ -2441,6 +2641,8 @@ ExecIRUpdateTriggers(EState *estate, ResultRelInfo *relinfo,
 		TRIGGER_EVENT_ROW |
 		TRIGGER_EVENT_INSTEAD;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	for (i = 0; i < trigdesc->numtriggers; i++)
 	{
 		Trigger    *trigger = &trigdesc->triggers[i];
@@ -2507,6 +2709,8 @@ ExecBSTruncateTriggers(EState *estate, ResultRelInfo *relinfo)
 	LocTriggerData.tg_event = TRIGGER_EVENT_TRUNCATE |
 		TRIGGER_EVENT_BEFORE;
 	LocTriggerData.tg_relation = relinfo->ri_RelationDesc;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
 	LocTriggerData.tg_trigtuple = NULL;
 	LocTriggerData.tg_newtuple = NULL;
 	LocTriggerData.tg_trigtuplebuf = InvalidBuffer;
@@ -2654,7 +2858,11 @@ ltrmark:;
 		tuple.t_tableOid = RelationGetRelid(relation);
 	}
 
-	result = heap_copytuple(&tuple);
+	/* Give the trigger all of the columns, even ones added since */
+	if (HeapTupleNeedsExpansion(&tuple, RelationGetDescr(relation)))
+		result = heap_expand_tuple(&tuple, RelationGetDescr(relation));
+	else
+		result = heap_copytuple(&tuple);
 	ReleaseBuffer(buffer);
 
 	return result;
@@ -2812,10 +3020,9 @@ TriggerEnabled(EState *estate, ResultRelInfo *relinfo,
  * Because the list of pending events can grow large, we go to some
  * considerable effort to minimize per-event memory consumption.  The event
  * records are grouped into chunks and common data for similar events in the
- * same chunk is only stored once.
- *
- * XXX We need to be able to save the per-event data in a file if it grows too
- * large.
+ * same chunk is only stored once.  Once the chunks of all event lists take
+ * more than work_mem, completed chunks of the list being added to are written
+ * out to a temporary file, and read back in when the list is scanned.
  * ----------
  */
 
@@ -2918,24 +3125,42 @@ typedef struct AfterTriggerEventDataOneCtid
  * array).	The space between CHUNK_DATA_START and freeptr is occupied by
  * AfterTriggerEventData records; the space between endfree and endptr is
  * occupied by AfterTriggerSharedData records.
+ *
+ * The chunk data is allocated separately from the chunk header, so that it
+ * can be spilled to the temporary file while the header stays in the list.
+ * A spilled chunk has data == NULL, and remembers its free space as offsets
+ * from the start of the data.  Since events refer to their shared records by
+ * offset, the data can be read back to any address.  A chunk keeps its place
+ * in the file once it has one, so it is rewritten in place when spilled
+ * again.
  */
 typedef struct AfterTriggerEventChunk
 {
 	struct AfterTriggerEventChunk *next;		/* list link */
+	char	   *data;			/* chunk data, or NULL if spilled */
 	char	   *freeptr;		/* start of free space in chunk */
 	char	   *endfree;		/* end of free space in chunk */
 	char	   *endptr;			/* end of chunk */
-	/* event data follows here */
+	Size		size;			/* allocated size of chunk data */
+	Size		freeoff;		/* freeptr - data, while spilled */
+	Size		endfreeoff;		/* endfree - data, while spilled */
+	int			spill_fileno;	/* position in spill file, or -1 if none */
+	off_t		spill_offset;
 } AfterTriggerEventChunk;
 
-#define CHUNK_DATA_START(cptr) ((char *) (cptr) + MAXALIGN(sizeof(AfterTriggerEventChunk)))
+#define CHUNK_DATA_START(cptr) ((cptr)->data)
 
-/* A list of events */
+/*
+ * A list of events.  nscans counts the loops currently walking the list;
+ * chunks may only be spilled by a loop that is alone on the list, since
+ * others may hold pointers into the data.
+ */
 typedef struct AfterTriggerEventList
 {
 	AfterTriggerEventChunk *head;
 	AfterTriggerEventChunk *tail;
 	char	   *tailfree;		/* freeptr of tail chunk */
+	int			nscans;			/* number of active scans of the list */
 } AfterTriggerEventList;
 
 /* Macros to help in iterating over a list of events */
@@ -2968,7 +3193,10 @@ typedef struct AfterTriggerEventList
  * all subtransactions of the current transaction.	In a subtransaction
  * abort, we know that the events added by the subtransaction are at the
  * end of the list, so it is relatively easy to discard them.  The event
- * list chunks themselves are stored in event_cxt.
+ * list chunks themselves are stored in event_cxt.  event_mem is the total
+ * size of the chunk data currently in memory, for all event lists, and
+ * spill_file is the temporary file chunks are spilled to once that exceeds
+ * work_mem; spill_end_fileno/spill_end_offset is its current end.
  *
  * query_depth is the current depth of nested AfterTriggerBeginQuery calls
  * (-1 when the stack is empty).
@@ -2980,7 +3208,13 @@ typedef struct AfterTriggerEventList
  * immediate-mode triggers, and append any deferred events to the main events
  * list.
  *
- * maxquerydepth is just the allocated length of query_stack.
+ * trans_stack[query_depth] is a list of AfterTriggerTransTables holding the
+ * transition tables captured by the current query, one entry per target
+ * relation that has statement-level triggers with a REFERENCING clause.
+ * They are handed to those triggers when they fire at the end of the query,
+ * and are released afterwards.
+ *
+ * maxquerydepth is just the allocated length of query_stack and trans_stack.
  *
  * state_stack is a stack of pointers to saved copies of the SET CONSTRAINTS
  * state data; each subtransaction level that modifies that state first
@@ -3009,8 +3243,13 @@ typedef struct AfterTriggersData
 	AfterTriggerEventList events;		/* deferred-event list */
 	int			query_depth;	/* current query list index */
 	AfterTriggerEventList *query_stack; /* events pending from each query */
-	int			maxquerydepth;	/* allocated len of above array */
+	List	  **trans_stack;	/* transition tables from each query */
+	int			maxquerydepth;	/* allocated len of above arrays */
 	MemoryContext event_cxt;	/* memory context for events, if any */
+	Size		event_mem;		/* memory used by in-memory chunk data */
+	BufFile    *spill_file;		/* file for spilled chunks, if any */
+	int			spill_end_fileno;	/* end of spill_file */
+	off_t		spill_end_offset;
 
 	/* these fields are just for resetting at subtrans abort: */
 
@@ -3023,6 +3262,13 @@ typedef struct AfterTriggersData
 
 typedef AfterTriggersData *AfterTriggers;
 
+typedef struct AfterTriggerTransTables
+{
+	Oid			relid;			/* target relation */
+	Tuplestorestate *old_tuplestore;	/* rows deleted or replaced, if any */
+	Tuplestorestate *new_tuplestore;	/* rows inserted or updated, if any */
+} AfterTriggerTransTables;
+
 static AfterTriggers afterTriggers;
 
 
@@ -3031,6 +3277,14 @@ static void AfterTriggerExecute(AfterTriggerEvent event,
 					FmgrInfo *finfo,
 					Instrumentation *instr,
 					MemoryContext per_tuple_context);
+static bool afterTriggerLoadChunk(AfterTriggerEventChunk *chunk);
+static void afterTriggerSpillChunk(AfterTriggerEventChunk *chunk);
+static void afterTriggerSpillEventList(AfterTriggerEventList *events);
+static void afterTriggerFreeChunk(AfterTriggerEventChunk *chunk);
+static bool afterTriggerPendingInList(AfterTriggerEventList *events, Oid relid);
+static AfterTriggerTransTables *GetAfterTriggerTransTables(Oid relid);
+static Tuplestorestate *GetTransTableTuplestore(Tuplestorestate **tuplestore);
+static void afterTriggerFreeTransTables(List *tables);
 static SetConstraintState SetConstraintStateCreate(int numalloc);
 static SetConstraintState SetConstraintStateCopy(SetConstraintState state);
 static SetConstraintState SetConstraintStateAddItem(SetConstraintState state,
@@ -3142,7 +3396,7 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 		else
 		{
 			/* preceding chunk size... */
-			chunksize = chunk->endptr - (char *) chunk;
+			chunksize = chunk->size;
 			/* check number of shared records in preceding chunk */
 			if ((chunk->endptr - chunk->endfree) <=
 				(100 * sizeof(AfterTriggerSharedData)))
@@ -3151,11 +3405,18 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 				chunksize /= 2; /* too many shared records */
 			chunksize = Min(chunksize, MAX_CHUNK_SIZE);
 		}
-		chunk = MemoryContextAlloc(afterTriggers->event_cxt, chunksize);
+		chunk = (AfterTriggerEventChunk *)
+			MemoryContextAlloc(afterTriggers->event_cxt,
+							   sizeof(AfterTriggerEventChunk));
 		chunk->next = NULL;
+		chunk->data = MemoryContextAlloc(afterTriggers->event_cxt, chunksize);
+		chunk->size = chunksize;
 		chunk->freeptr = CHUNK_DATA_START(chunk);
-		chunk->endptr = chunk->endfree = (char *) chunk + chunksize;
+		chunk->endptr = chunk->endfree = chunk->data + chunksize;
+		chunk->spill_fileno = -1;
+		chunk->spill_offset = 0;
 		Assert(chunk->endfree - chunk->freeptr >= needed);
+		afterTriggers->event_mem += chunksize;
 
 		if (events->head == NULL)
 			events->head = chunk;
@@ -3163,6 +3424,14 @@ afterTriggerAddEvent(AfterTriggerEventList *events,
 			events->tail->next = chunk;
 		events->tail = chunk;
 		/* events->tailfree is now out of sync, but we'll fix it below */
+
+		/*
+		 * If the events take too much memory, push out the chunks we have
+		 * finished filling, unless someone is walking this list.
+		 */
+		if (events->nscans == 0 &&
+			afterTriggers->event_mem > work_mem * 1024L)
+			afterTriggerSpillEventList(events);
 	}
 
 	/*
@@ -3212,11 +3481,12 @@ afterTriggerFreeEventList(AfterTriggerEventList *events)
 	for (chunk = events->head; chunk != NULL; chunk = next_chunk)
 	{
 		next_chunk = chunk->next;
-		pfree(chunk);
+		afterTriggerFreeChunk(chunk);
 	}
 	events->head = NULL;
 	events->tail = NULL;
 	events->tailfree = NULL;
+	events->nscans = 0;
 }
 
 /* ----------
@@ -3245,7 +3515,7 @@ afterTriggerRestoreEventList(AfterTriggerEventList *events,
 		for (chunk = events->tail->next; chunk != NULL; chunk = next_chunk)
 		{
 			next_chunk = chunk->next;
-			pfree(chunk);
+			afterTriggerFreeChunk(chunk);
 		}
 		/* and clean up the tail chunk to be the right length */
 		events->tail->next = NULL;
@@ -3258,6 +3528,243 @@ afterTriggerRestoreEventList(AfterTriggerEventList *events,
 	}
 }
 
+/* ----------
+ * afterTriggerLoadChunk()
+ *
+ *	Make sure the data of an event chunk is in memory, reading it back from
+ *	the spill file if needed.  Returns TRUE if we had to read it; the caller
+ *	then normally spills it again once done with it.
+ * ----------
+ */
+static bool
+afterTriggerLoadChunk(AfterTriggerEventChunk *chunk)
+{
+	if (chunk->data != NULL)
+		return false;
+
+	Assert(afterTriggers->spill_file != NULL && chunk->spill_fileno >= 0);
+
+	chunk->data = MemoryContextAlloc(afterTriggers->event_cxt, chunk->size);
+	if (BufFileSeek(afterTriggers->spill_file, chunk->spill_fileno,
+					chunk->spill_offset, SEEK_SET) != 0 ||
+		BufFileRead(afterTriggers->spill_file, chunk->data,
+					chunk->size) != chunk->size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read after-trigger events from temporary file: %m")));
+
+	chunk->freeptr = chunk->data + chunk->freeoff;
+	chunk->endfree = chunk->data + chunk->endfreeoff;
+	chunk->endptr = chunk->data + chunk->size;
+	afterTriggers->event_mem += chunk->size;
+
+	return true;
+}
+
+/* ----------
+ * afterTriggerSpillChunk()
+ *
+ *	Write the data of an event chunk to the spill file and release it.
+ *	The caller must make sure that nobody holds pointers into the data, and
+ *	that the chunk isn't the tail of its list or of a saved copy of it.
+ * ----------
+ */
+static void
+afterTriggerSpillChunk(AfterTriggerEventChunk *chunk)
+{
+	ResourceOwner oldowner;
+
+	Assert(chunk->data != NULL);
+
+	/*
+	 * The file must survive until the end of the transaction, even if the
+	 * subtransaction we're in now is aborted, so charge it to the top
+	 * transaction's resource owner.
+	 */
+	oldowner = CurrentResourceOwner;
+	CurrentResourceOwner = TopTransactionResourceOwner;
+
+	if (afterTriggers->spill_file == NULL)
+	{
+		MemoryContext oldcxt;
+
+		oldcxt = MemoryContextSwitchTo(afterTriggers->event_cxt);
+		afterTriggers->spill_file = BufFileCreateTemp(false);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	/* Chunks are written at the end of the file the first time around */
+	if (chunk->spill_fileno < 0)
+	{
+		chunk->spill_fileno = afterTriggers->spill_end_fileno;
+		chunk->spill_offset = afterTriggers->spill_end_offset;
+	}
+
+	if (BufFileSeek(afterTriggers->spill_file, chunk->spill_fileno,
+					chunk->spill_offset, SEEK_SET) != 0 ||
+		BufFileWrite(afterTriggers->spill_file, chunk->data,
+					 chunk->size) != chunk->size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write after-trigger events to temporary file: %m")));
+
+	if (chunk->spill_fileno == afterTriggers->spill_end_fileno &&
+		chunk->spill_offset == afterTriggers->spill_end_offset)
+		BufFileTell(afterTriggers->spill_file,
+					&afterTriggers->spill_end_fileno,
+					&afterTriggers->spill_end_offset);
+
+	CurrentResourceOwner = oldowner;
+
+	chunk->freeoff = chunk->freeptr - chunk->data;
+	chunk->endfreeoff = chunk->endfree - chunk->data;
+	pfree(chunk->data);
+	chunk->data = NULL;
+	chunk->freeptr = chunk->endfree = chunk->endptr = NULL;
+	afterTriggers->event_mem -= chunk->size;
+}
+
+/* ----------
+ * afterTriggerSpillEventList()
+ *
+ *	Spill all chunks of an event list that are in memory, except those that
+ *	may still be added to: the list's tail, and, for the deferred-event
+ *	list, the tails saved at the start of the open subtransactions (see
+ *	afterTriggerRestoreEventList).  Nobody may be scanning the list.
+ * ----------
+ */
+static void
+afterTriggerSpillEventList(AfterTriggerEventList *events)
+{
+	int			my_level = GetCurrentTransactionNestLevel();
+	AfterTriggerEventChunk *chunk;
+
+	Assert(events->nscans == 0);
+
+	for_each_chunk(chunk, *events)
+	{
+		if (chunk->data == NULL || chunk == events->tail)
+			continue;
+
+		if (events == &afterTriggers->events)
+		{
+			bool		saved_tail = false;
+			int			level;
+
+			for (level = 0;
+				 level <= my_level && level < afterTriggers->maxtransdepth;
+				 level++)
+			{
+				if (afterTriggers->events_stack[level].tail == chunk)
+				{
+					saved_tail = true;
+					break;
+				}
+			}
+			if (saved_tail)
+				continue;
+		}
+
+		afterTriggerSpillChunk(chunk);
+	}
+}
+
+/* ----------
+ * afterTriggerFreeChunk()
+ *
+ *	Release an event chunk that has been removed from its list.  Its place
+ *	in the spill file, if any, is not reused.
+ * ----------
+ */
+static void
+afterTriggerFreeChunk(AfterTriggerEventChunk *chunk)
+{
+	if (chunk->data != NULL)
+	{
+		pfree(chunk->data);
+		afterTriggers->event_mem -= chunk->size;
+	}
+	pfree(chunk);
+}
+
+
+/* ----------
+ * GetAfterTriggerTransTables()
+ *
+ *	Find or create the transition table entry of the current query for
+ *	the given relation.  The tuplestores themselves are created lazily by
+ *	the caller, in TopTransactionContext.
+ * ----------
+ */
+static AfterTriggerTransTables *
+GetAfterTriggerTransTables(Oid relid)
+{
+	List	  **tables = &afterTriggers->trans_stack[afterTriggers->query_depth];
+	AfterTriggerTransTables *table;
+	MemoryContext oldcxt;
+	ListCell   *lc;
+
+	foreach(lc, *tables)
+	{
+		table = (AfterTriggerTransTables *) lfirst(lc);
+		if (table->relid == relid)
+			return table;
+	}
+
+	oldcxt = MemoryContextSwitchTo(TopTransactionContext);
+	table = (AfterTriggerTransTables *) palloc(sizeof(AfterTriggerTransTables));
+	table->relid = relid;
+	table->old_tuplestore = NULL;
+	table->new_tuplestore = NULL;
+	*tables = lappend(*tables, table);
+	MemoryContextSwitchTo(oldcxt);
+
+	return table;
+}
+
+/* ----------
+ * GetTransTableTuplestore()
+ *
+ *	Return the given tuplestore, creating it first if needed.
+ * ----------
+ */
+static Tuplestorestate *
+GetTransTableTuplestore(Tuplestorestate **tuplestore)
+{
+	if (*tuplestore == NULL)
+	{
+		MemoryContext oldcxt;
+
+		oldcxt = MemoryContextSwitchTo(TopTransactionContext);
+		*tuplestore = tuplestore_begin_heap(false, false, work_mem);
+		MemoryContextSwitchTo(oldcxt);
+	}
+	return *tuplestore;
+}
+
+/* ----------
+ * afterTriggerFreeTransTables()
+ *
+ *	Release the transition tables of a finished query.
+ * ----------
+ */
+static void
+afterTriggerFreeTransTables(List *tables)
+{
+	ListCell   *lc;
+
+	foreach(lc, tables)
+	{
+		AfterTriggerTransTables *table = (AfterTriggerTransTables *) lfirst(lc);
+
+		if (table->old_tuplestore)
+			tuplestore_end(table->old_tuplestore);
+		if (table->new_tuplestore)
+			tuplestore_end(table->new_tuplestore);
+	}
+	list_free_deep(tables);
+}
+
 
 /* ----------
  * AfterTriggerExecute()
@@ -3357,6 +3864,28 @@ AfterTriggerExecute(AfterTriggerEvent event,
 	LocTriggerData.tg_event =
 		evtshared->ats_event & (TRIGGER_EVENT_OPMASK | TRIGGER_EVENT_ROW);
 	LocTriggerData.tg_relation = rel;
+	LocTriggerData.tg_oldtable = NULL;
+	LocTriggerData.tg_newtable = NULL;
+
+	/*
+	 * Statement-level triggers with a REFERENCING clause get the transition
+	 * tables captured by the current query.  CreateTrigger doesn't allow
+	 * them to be deferred, so they always fire at the query's own level.
+	 */
+	if (!TRIGGER_FIRED_FOR_ROW(LocTriggerData.tg_event) &&
+		(LocTriggerData.tg_trigger->tgoldtable != NULL ||
+		 LocTriggerData.tg_trigger->tgnewtable != NULL))
+	{
+		AfterTriggerTransTables *table;
+
+		table = GetAfterTriggerTransTables(RelationGetRelid(rel));
+		if (LocTriggerData.tg_trigger->tgoldtable != NULL)
+			LocTriggerData.tg_oldtable =
+				GetTransTableTuplestore(&table->old_tuplestore);
+		if (LocTriggerData.tg_trigger->tgnewtable != NULL)
+			LocTriggerData.tg_newtable =
+				GetTransTableTuplestore(&table->new_tuplestore);
+	}
 
 	MemoryContextReset(per_tuple_context);
 
@@ -3409,48 +3938,61 @@ afterTriggerMarkEvents(AfterTriggerEventList *events,
 					   bool immediate_only)
 {
 	bool		found = false;
-	AfterTriggerEvent event;
 	AfterTriggerEventChunk *chunk;
 
-	for_each_event_chunk(event, chunk, *events)
+	events->nscans++;
+
+	for_each_chunk(chunk, *events)
 	{
-		AfterTriggerShared evtshared = GetTriggerSharedData(event);
-		bool		defer_it = false;
+		AfterTriggerEvent event;
+		bool		loaded = afterTriggerLoadChunk(chunk);
 
-		if (!(event->ate_flags &
-			  (AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS)))
+		for_each_event(event, chunk)
 		{
-			/*
-			 * This trigger hasn't been called or scheduled yet. Check if we
-			 * should call it now.
-			 */
-			if (immediate_only && afterTriggerCheckState(evtshared))
-			{
-				defer_it = true;
-			}
-			else
+			AfterTriggerShared evtshared = GetTriggerSharedData(event);
+			bool		defer_it = false;
+
+			if (!(event->ate_flags &
+				  (AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS)))
 			{
 				/*
-				 * Mark it as to be fired in this firing cycle.
+				 * This trigger hasn't been called or scheduled yet. Check if
+				 * we should call it now.
 				 */
-				evtshared->ats_firing_id = afterTriggers->firing_counter;
-				event->ate_flags |= AFTER_TRIGGER_IN_PROGRESS;
-				found = true;
+				if (immediate_only && afterTriggerCheckState(evtshared))
+				{
+					defer_it = true;
+				}
+				else
+				{
+					/*
+					 * Mark it as to be fired in this firing cycle.
+					 */
+					evtshared->ats_firing_id = afterTriggers->firing_counter;
+					event->ate_flags |= AFTER_TRIGGER_IN_PROGRESS;
+					found = true;
+				}
 			}
-		}
 
-		/*
-		 * If it's deferred, move it to move_list, if requested.
-		 */
-		if (defer_it && move_list != NULL)
-		{
-			/* add it to move_list */
-			afterTriggerAddEvent(move_list, event, evtshared);
-			/* mark original copy "done" so we don't do it again */
-			event->ate_flags |= AFTER_TRIGGER_DONE;
+			/*
+			 * If it's deferred, move it to move_list, if requested.
+			 */
+			if (defer_it && move_list != NULL)
+			{
+				/* add it to move_list */
+				afterTriggerAddEvent(move_list, event, evtshared);
+				/* mark original copy "done" so we don't do it again */
+				event->ate_flags |= AFTER_TRIGGER_DONE;
+			}
 		}
+
+		/* Write the chunk back out if we read it in */
+		if (loaded && events->nscans == 1)
+			afterTriggerSpillChunk(chunk);
 	}
 
+	events->nscans--;
+
 	return found;
 }
 
@@ -3505,10 +4047,13 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 							  ALLOCSET_DEFAULT_INITSIZE,
 							  ALLOCSET_DEFAULT_MAXSIZE);
 
+	events->nscans++;
+
 	for_each_chunk(chunk, *events)
 	{
 		AfterTriggerEvent event;
 		bool		all_fired_in_chunk = true;
+		bool		loaded = afterTriggerLoadChunk(chunk);
 
 		for_each_event(event, chunk)
 		{
@@ -3574,8 +4119,14 @@ afterTriggerInvokeEvents(AfterTriggerEventList *events,
 			if (chunk == events->tail)
 				events->tailfree = chunk->freeptr;
 		}
+
+		/* Write the chunk back out if we read it in */
+		if (loaded && events->nscans == 1)
+			afterTriggerSpillChunk(chunk);
 	}
 
+	events->nscans--;
+
 	/* Release working resources */
 	MemoryContextDelete(per_tuple_context);
 
@@ -3622,16 +4173,24 @@ AfterTriggerBeginXact(void)
 	afterTriggers->events.head = NULL;
 	afterTriggers->events.tail = NULL;
 	afterTriggers->events.tailfree = NULL;
+	afterTriggers->events.nscans = 0;
 	afterTriggers->query_depth = -1;
 
 	/* We initialize the query stack to a reasonable size */
 	afterTriggers->query_stack = (AfterTriggerEventList *)
 		MemoryContextAlloc(TopTransactionContext,
 						   8 * sizeof(AfterTriggerEventList));
+	afterTriggers->trans_stack = (List **)
+		MemoryContextAlloc(TopTransactionContext,
+						   8 * sizeof(List *));
 	afterTriggers->maxquerydepth = 8;
 
-	/* Context for events is created only when needed */
+	/* Context and spill file for events are created only when needed */
 	afterTriggers->event_cxt = NULL;
+	afterTriggers->event_mem = 0;
+	afterTriggers->spill_file = NULL;
+	afterTriggers->spill_end_fileno = 0;
+	afterTriggers->spill_end_offset = 0;
 
 	/* Subtransaction stack is empty until/unless needed */
 	afterTriggers->state_stack = NULL;
@@ -3673,14 +4232,19 @@ AfterTriggerBeginQuery(void)
 		afterTriggers->query_stack = (AfterTriggerEventList *)
 			repalloc(afterTriggers->query_stack,
 					 new_alloc * sizeof(AfterTriggerEventList));
+		afterTriggers->trans_stack = (List **)
+			repalloc(afterTriggers->trans_stack,
+					 new_alloc * sizeof(List *));
 		afterTriggers->maxquerydepth = new_alloc;
 	}
 
-	/* Initialize this query's list to empty */
+	/* Initialize this query's lists to empty */
 	events = &afterTriggers->query_stack[afterTriggers->query_depth];
 	events->head = NULL;
 	events->tail = NULL;
 	events->tailfree = NULL;
+	events->nscans = 0;
+	afterTriggers->trans_stack[afterTriggers->query_depth] = NIL;
 }
 
 
@@ -3740,8 +4304,10 @@ AfterTriggerEndQuery(EState *estate)
 			break;
 	}
 
-	/* Release query-local storage for events */
+	/* Release query-local storage for events and transition tables */
 	afterTriggerFreeEventList(&afterTriggers->query_stack[afterTriggers->query_depth]);
+	afterTriggerFreeTransTables(afterTriggers->trans_stack[afterTriggers->query_depth]);
+	afterTriggers->trans_stack[afterTriggers->query_depth] = NIL;
 
 	afterTriggers->query_depth--;
 }
@@ -3829,6 +4395,8 @@ AfterTriggerEndXact(bool isCommit)
 	 * soon as possible --- especially if we are aborting because we ran out
 	 * of memory for the list!
 	 */
+	if (afterTriggers && afterTriggers->spill_file)
+		BufFileClose(afterTriggers->spill_file);
 	if (afterTriggers && afterTriggers->event_cxt)
 		MemoryContextDelete(afterTriggers->event_cxt);
 
@@ -3963,6 +4531,8 @@ AfterTriggerEndSubXact(bool isCommit)
 		while (afterTriggers->query_depth > afterTriggers->depth_stack[my_level])
 		{
 			afterTriggerFreeEventList(&afterTriggers->query_stack[afterTriggers->query_depth]);
+			/* tuplestores are reclaimed with TopTransactionContext */
+			afterTriggers->trans_stack[afterTriggers->query_depth] = NIL;
 			afterTriggers->query_depth--;
 		}
 		Assert(afterTriggers->query_depth ==
@@ -3997,17 +4567,25 @@ AfterTriggerEndSubXact(bool isCommit)
 		 * subxacts started after it.)
 		 */
 		subxact_firing_id = afterTriggers->firing_stack[my_level];
-		for_each_event_chunk(event, chunk, afterTriggers->events)
+		for_each_chunk(chunk, afterTriggers->events)
 		{
-			AfterTriggerShared evtshared = GetTriggerSharedData(event);
+			bool		loaded = afterTriggerLoadChunk(chunk);
 
-			if (event->ate_flags &
-				(AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS))
+			for_each_event(event, chunk)
 			{
-				if (evtshared->ats_firing_id >= subxact_firing_id)
-					event->ate_flags &=
-						~(AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS);
+				AfterTriggerShared evtshared = GetTriggerSharedData(event);
+
+				if (event->ate_flags &
+					(AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS))
+				{
+					if (evtshared->ats_firing_id >= subxact_firing_id)
+						event->ate_flags &=
+							~(AFTER_TRIGGER_DONE | AFTER_TRIGGER_IN_PROGRESS);
+				}
 			}
+
+			if (loaded)
+				afterTriggerSpillChunk(chunk);
 		}
 	}
 }
@@ -4388,30 +4966,19 @@ AfterTriggerSetState(ConstraintsSetStmt *stmt)
 bool
 AfterTriggerPendingOnRel(Oid relid)
 {
-	AfterTriggerEvent event;
-	AfterTriggerEventChunk *chunk;
 	int			depth;
 
 	/* No-op if we aren't in a transaction.  (Shouldn't happen?) */
 	if (afterTriggers == NULL)
 		return false;
 
-	/* Scan queued events */
-	for_each_event_chunk(event, chunk, afterTriggers->events)
-	{
-		AfterTriggerShared evtshared = GetTriggerSharedData(event);
-
-		/*
-		 * We can ignore completed events.	(Even if a DONE flag is rolled
-		 * back by subxact abort, it's OK because the effects of the TRUNCATE
-		 * or whatever must get rolled back too.)
-		 */
-		if (event->ate_flags & AFTER_TRIGGER_DONE)
-			continue;
-
-		if (evtshared->ats_relid == relid)
-			return true;
-	}
+	/*
+	 * Scan queued events.  We can ignore completed events.  (Even if a DONE
+	 * flag is rolled back by subxact abort, it's OK because the effects of
+	 * the TRUNCATE or whatever must get rolled back too.)
+	 */
+	if (afterTriggerPendingInList(&afterTriggers->events, relid))
+		return true;
 
 	/*
 	 * Also scan events queued by incomplete queries.  This could only matter
@@ -4420,7 +4987,29 @@ AfterTriggerPendingOnRel(Oid relid)
 	 */
 	for (depth = 0; depth <= afterTriggers->query_depth; depth++)
 	{
-		for_each_event_chunk(event, chunk, afterTriggers->query_stack[depth])
+		if (afterTriggerPendingInList(&afterTriggers->query_stack[depth],
+									  relid))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Subroutine for AfterTriggerPendingOnRel: scan one event list.
+ */
+static bool
+afterTriggerPendingInList(AfterTriggerEventList *events, Oid relid)
+{
+	AfterTriggerEventChunk *chunk;
+	bool		found = false;
+
+	for_each_chunk(chunk, *events)
+	{
+		AfterTriggerEvent event;
+		bool		loaded = afterTriggerLoadChunk(chunk);
+
+		for_each_event(event, chunk)
 		{
 			AfterTriggerShared evtshared = GetTriggerSharedData(event);
 
@@ -4428,11 +5017,21 @@ AfterTriggerPendingOnRel(Oid relid)
 				continue;
 
 			if (evtshared->ats_relid == relid)
-				return true;
+			{
+				found = true;
+				break;
+			}
 		}
+
+		/* we didn't change anything, but must not leave it in memory */
+		if (loaded)
+			afterTriggerSpillChunk(chunk);
+
+		if (found)
+			break;
 	}
 
-	return false;
+	return found;
 }
 
 
@@ -4546,6 +5145,39 @@ AfterTriggerSaveEvent(EState *estate, ResultRelInfo *relinfo,
 			break;
 	}
 
+	/*
+	 * Capture the affected rows into the transition tables, if any trigger
+	 * on the relation asked for them.
+	 */
+	if (row_trigger)
+	{
+		bool		save_old = false;
+		bool		save_new = false;
+
+		if (event == TRIGGER_EVENT_INSERT)
+			save_new = trigdesc->trig_insert_new_table;
+		else if (event == TRIGGER_EVENT_UPDATE)
+		{
+			save_old = trigdesc->trig_update_old_table;
+			save_new = trigdesc->trig_update_new_table;
+		}
+		else if (event == TRIGGER_EVENT_DELETE)
+			save_old = trigdesc->trig_delete_old_table;
+
+		if (save_old || save_new)
+		{
+			AfterTriggerTransTables *table;
+
+			table = GetAfterTriggerTransTables(RelationGetRelid(rel));
+			if (save_old)
+				tuplestore_puttuple(GetTransTableTuplestore(&table->old_tuplestore),
+									oldtup);
+			if (save_new)
+				tuplestore_puttuple(GetTransTableTuplestore(&table->new_tuplestore),
+									newtup);
+		}
+	}
+
 	tgtype_level = (row_trigger ? TRIGGER_TYPE_ROW : TRIGGER_TYPE_STATEMENT);
 
 	for (i = 0; i < trigdesc->numtriggers; i++)
@@ -4632,3 +5264,90 @@ AfterTriggerSaveEvent(EState *estate, ResultRelInfo *relinfo,
 							 &new_event, &new_shared);
 	}
 }
+
+
+/*
+ * SQL function pg_transition_table(name text, rowtype anyelement)
+ *
+ *	Return the contents of the named transition table of the statement-level
+ *	trigger currently being fired.  The second argument is only there to
+ *	fix the result type, and must be of the row type of the trigger's table,
+ *	as in pg_transition_table('new_rows', NULL::mytable).
+ */
+Datum
+pg_transition_table(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TriggerData *trigdata = TransitionTriggerData;
+	Tuplestorestate *source = NULL;
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	TupleTableSlot *slot;
+	MemoryContext oldcontext;
+	char	   *name;
+
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("transition table name must not be null")));
+	name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not allowed in this context")));
+
+	if (trigdata != NULL)
+	{
+		Trigger    *trigger = trigdata->tg_trigger;
+
+		if (trigger->tgoldtable != NULL &&
+			strcmp(trigger->tgoldtable, name) == 0)
+			source = trigdata->tg_oldtable;
+		else if (trigger->tgnewtable != NULL &&
+				 strcmp(trigger->tgnewtable, name) == 0)
+			source = trigdata->tg_newtable;
+	}
+	if (source == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_TABLE),
+				 errmsg("transition table \"%s\" is not available", name),
+				 errhint("Transition tables can only be read from the statement-level trigger that declares them.")));
+
+	if (get_fn_expr_argtype(fcinfo->flinfo, 1) !=
+		RelationGetForm(trigdata->tg_relation)->reltype)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("transition table \"%s\" has row type %s",
+						name,
+						format_type_be(RelationGetForm(trigdata->tg_relation)->reltype))));
+
+	/*
+	 * Copy the rows into a new tuplestore, since the executor takes
+	 * ownership of the one we return and other triggers may still need the
+	 * transition table.
+	 */
+	oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+
+	tupdesc = CreateTupleDescCopy(RelationGetDescr(trigdata->tg_relation));
+	tupstore = tuplestore_begin_heap(rsinfo->allowedModes & SFRM_Materialize_Random,
+									 false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	slot = MakeSingleTupleTableSlot(tupdesc);
+	tuplestore_rescan(source);
+	while (tuplestore_gettupleslot(source, true, false, slot))
+		tuplestore_puttupleslot(tupstore, slot);
+	ExecDropSingleTupleTableSlot(slot);
+
+	return (Datum) 0;
+}
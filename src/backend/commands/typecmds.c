@@ -2227,7 +2227,7 @@ AlterDomainNotNull(List *names, bool notNull)
 				{
 					int			attnum = rtc->atts[i];
 
-					if (heap_attisnull(tuple, attnum))
+					if (heap_attisnull(tuple, attnum, tupdesc))
 						ereport(ERROR,
 								(errcode(ERRCODE_NOT_NULL_VIOLATION),
 								 errmsg("column \"%s\" of table \"%s\" contains null values",
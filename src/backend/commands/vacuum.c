@@ -25,12 +25,15 @@
 #include "access/clog.h"
 #include "access/genam.h"
 #include "access/heapam.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
+#include "catalog/catalog.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_namespace.h"
 #include "commands/cluster.h"
+#include "commands/progress.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -104,6 +107,11 @@ vacuum(VacuumStmt *vacstmt, Oid relid, bool do_toast,
 		   !(vacstmt->options & (VACOPT_FULL | VACOPT_FREEZE)));
 	Assert((vacstmt->options & VACOPT_ANALYZE) || vacstmt->va_cols == NIL);
 
+	if ((vacstmt->options & VACOPT_COMPACT) && (vacstmt->options & VACOPT_FULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("VACUUM option COMPACT cannot be used with FULL")));
+
 	stmttype = (vacstmt->options & VACOPT_VACUUM) ? "VACUUM" : "ANALYZE";
 
 	/*
@@ -339,23 +347,26 @@ get_rel_oids(Oid relid, const RangeVar *vacrel)
 	}
 	else
 	{
-		/* Process all plain relations listed in pg_class */
+		/*
+		 * Process all plain relations and materialized views listed in
+		 * pg_class
+		 */
 		Relation	pgclass;
 		HeapScanDesc scan;
 		HeapTuple	tuple;
-		ScanKeyData key;
-
-		ScanKeyInit(&key,
-					Anum_pg_class_relkind,
-					BTEqualStrategyNumber, F_CHAREQ,
-					CharGetDatum(RELKIND_RELATION));
 
 		pgclass = heap_open(RelationRelationId, AccessShareLock);
 
-		scan = heap_beginscan(pgclass, SnapshotNow, 1, &key);
+		scan = heap_beginscan(pgclass, SnapshotNow, 0, NULL);
 
 		while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
 		{
+			Form_pg_class classForm = (Form_pg_class) GETSTRUCT(tuple);
+
+			if (classForm->relkind != RELKIND_RELATION &&
+				classForm->relkind != RELKIND_MATVIEW)
+				continue;
+
 			/* Make a relation list entry for this guy */
 			oldcontext = MemoryContextSwitchTo(vac_context);
 			oid_list = lappend_oid(oid_list, HeapTupleGetOid(tuple));
@@ -701,10 +712,11 @@ vac_update_datfrozenxid(void)
 		Form_pg_class classForm = (Form_pg_class) GETSTRUCT(classTup);
 
 		/*
-		 * Only consider heap and TOAST tables (anything else should have
-		 * InvalidTransactionId in relfrozenxid anyway.)
+		 * Only consider heap, matview and TOAST tables (anything else should
+		 * have InvalidTransactionId in relfrozenxid anyway.)
 		 */
 		if (classForm->relkind != RELKIND_RELATION &&
+			classForm->relkind != RELKIND_MATVIEW &&
 			classForm->relkind != RELKIND_TOASTVALUE)
 			continue;
 
@@ -860,6 +872,7 @@ vacuum_rel(Oid relid, VacuumStmt *vacstmt, bool do_toast, bool for_wraparound)
 	Relation	onerel;
 	LockRelId	onerelid;
 	Oid			toast_relid;
+	bool		compact;
 	Oid			save_userid;
 	int			save_sec_context;
 	int			save_nestlevel;
@@ -982,6 +995,7 @@ vacuum_rel(Oid relid, VacuumStmt *vacstmt, bool do_toast, bool for_wraparound)
 	 * relation.
 	 */
 	if (onerel->rd_rel->relkind != RELKIND_RELATION &&
+		onerel->rd_rel->relkind != RELKIND_MATVIEW &&
 		onerel->rd_rel->relkind != RELKIND_TOASTVALUE)
 	{
 		ereport(WARNING,
@@ -1031,6 +1045,15 @@ vacuum_rel(Oid relid, VacuumStmt *vacstmt, bool do_toast, bool for_wraparound)
 	else
 		toast_relid = InvalidOid;
 
+	/*
+	 * For VACUUM (COMPACT), remember whether to move rows after vacuuming.
+	 * System catalogs, and tables not stored as heaps, just get vacuumed.
+	 */
+	compact = (vacstmt->options & VACOPT_COMPACT) != 0 &&
+		onerel->rd_rel->relkind == RELKIND_RELATION &&
+		!IsSystemRelation(onerel) &&
+		RelationIsHeap(onerel);
+
 	/*
 	 * Switch to the table owner's userid, so that any index functions are run
 	 * as that user.  Also lock down security-restricted operations and
@@ -1057,7 +1080,13 @@ vacuum_rel(Oid relid, VacuumStmt *vacstmt, bool do_toast, bool for_wraparound)
 					vacstmt->freeze_min_age, vacstmt->freeze_table_age);
 	}
 	else
-		lazy_vacuum_rel(onerel, vacstmt, vac_strategy);
+	{
+		const TableAmRoutine *tableam = GetTableAmRoutine(onerel);
+
+		/* an access method that needs no vacuuming leaves this NULL */
+		if (tableam->VacuumTable)
+			tableam->VacuumTable(onerel, vacstmt, vac_strategy);
+	}
 
 	/* Roll back any GUC changes executed by index functions */
 	AtEOXact_GUC(false, save_nestlevel);
@@ -1075,6 +1104,19 @@ vacuum_rel(Oid relid, VacuumStmt *vacstmt, bool do_toast, bool for_wraparound)
 	PopActiveSnapshot();
 	CommitTransactionCommand();
 
+	/*
+	 * Now move rows from the end of the table into the free space the vacuum
+	 * found, and vacuum again to get rid of the row versions left behind and
+	 * truncate the emptied pages.
+	 */
+	if (compact && compact_rel(relid, vacstmt, vac_strategy))
+	{
+		VacuumStmt	again = *vacstmt;
+
+		again.options &= ~VACOPT_COMPACT;
+		(void) vacuum_rel(relid, &again, false, for_wraparound);
+	}
+
 	/*
 	 * If the relation has a secondary toast rel, vacuum that too while we
 	 * still hold the session lock on the master table.  Note however that
@@ -1173,6 +1215,9 @@ vacuum_delay_point(void)
 
 		pg_usleep(msec * 1000L);
 
+		/* Let the progress views show how much we're being throttled */
+		pgstat_progress_incr_param(PROGRESS_VACUUM_DELAY_TIME, msec);
+
 		VacuumCostBalance = 0;
 
 		/* update balance values for workers */
@@ -0,0 +1,359 @@
+/*-------------------------------------------------------------------------
+ *
+ * vacuumcompact.c
+ *	  Moving rows towards the start of a table, for VACUUM (COMPACT).
+ *
+ *
+ * Lazy VACUUM can only give space back to the operating system when the
+ * pages at the end of the table happen to be empty, and VACUUM FULL needs an
+ * exclusive lock for as long as it takes to rewrite the table.  VACUUM
+ * (COMPACT) instead vacuums the table as usual, which fills in the free
+ * space map, then empties the pages at the end of the table by moving their
+ * live rows into free space nearer the start, and finally vacuums again to
+ * remove the row versions left behind and truncate the emptied pages.
+ *
+ * Rows are moved by updates that always put the new version on a lower page,
+ * without ever extending the table (see heap_move_tuple), so to everyone
+ * else a moved row just looks like a row that was updated without changing
+ * it.  Throughout, the table keeps the ShareUpdateExclusiveLock that lazy
+ * VACUUM takes, so it can be read and written concurrently.  Rows that are
+ * locked or being modified are left where they are, and no triggers fire
+ * for the moves.
+ *
+ * We commit every few pages, since a moved row is locked by us until we
+ * commit, and concurrent updaters of it have to wait for that.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/vacuumcompact.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "commands/vacuum.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/freespace.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/procarray.h"
+#include "storage/smgr.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tqual.h"
+
+
+/* Number of pages to empty in each transaction */
+#define COMPACT_PAGES_PER_XACT	16
+
+static bool compact_page(Relation onerel, BlockNumber blkno,
+			 EState *estate, TupleTableSlot *slot,
+			 BufferAccessStrategy bstrategy,
+			 double *nmoved, double *nleft);
+static void wait_for_older_snapshots(TransactionId xid);
+
+
+/*
+ *	compact_rel() -- move rows off the end of one heap relation
+ *
+ *		The caller has already vacuumed the relation, and holds a
+ *		session-level ShareUpdateExclusiveLock on it.  Returns true if any
+ *		rows were moved, in which case the caller should vacuum the
+ *		relation again to truncate it; by then, no snapshot can see the
+ *		row versions we left behind anymore.
+ *
+ *		At entry and exit, we are not inside a transaction.
+ */
+bool
+compact_rel(Oid relid, VacuumStmt *vacstmt, BufferAccessStrategy bstrategy)
+{
+	BlockNumber blkno = InvalidBlockNumber;
+	TransactionId lastXid = InvalidTransactionId;
+	double		nmoved = 0,
+				nleft = 0;
+	char	   *relname = NULL;
+	bool		done = false;
+	int			elevel;
+
+	if (vacstmt->options & VACOPT_VERBOSE)
+		elevel = INFO;
+	else
+		elevel = DEBUG2;
+
+	while (!done)
+	{
+		Relation	onerel;
+		EState	   *estate;
+		ResultRelInfo *resultRelInfo;
+		TupleTableSlot *slot;
+		Oid			save_userid;
+		int			save_sec_context;
+		int			save_nestlevel;
+		int			npages;
+
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		onerel = relation_open(relid, ShareUpdateExclusiveLock);
+
+		if (relname == NULL)
+		{
+			MemoryContext oldcxt = MemoryContextSwitchTo(PortalContext);
+
+			relname = pstrdup(RelationGetRelationName(onerel));
+			MemoryContextSwitchTo(oldcxt);
+
+			/* Start with the last page */
+			blkno = RelationGetNumberOfBlocks(onerel);
+		}
+
+		/* Run index functions as the table owner, as vacuum_rel does */
+		GetUserIdAndSecContext(&save_userid, &save_sec_context);
+		SetUserIdAndSecContext(onerel->rd_rel->relowner,
+							save_sec_context | SECURITY_RESTRICTED_OPERATION);
+		save_nestlevel = NewGUCNestLevel();
+
+		/*
+		 * We need a ResultRelInfo so we can use the regular executor's
+		 * index-entry-making machinery, as COPY does.
+		 */
+		estate = CreateExecutorState();
+		resultRelInfo = makeNode(ResultRelInfo);
+		resultRelInfo->ri_RangeTableIndex = 1;	/* dummy */
+		resultRelInfo->ri_RelationDesc = onerel;
+		ExecOpenIndices(resultRelInfo);
+		estate->es_result_relations = resultRelInfo;
+		estate->es_num_result_relations = 1;
+		estate->es_result_relation_info = resultRelInfo;
+
+		slot = ExecInitExtraTupleSlot(estate);
+		ExecSetSlotDescriptor(slot, RelationGetDescr(onerel));
+
+		for (npages = 0; npages < COMPACT_PAGES_PER_XACT; npages++)
+		{
+			if (blkno == 0)
+			{
+				done = true;
+				break;
+			}
+			blkno--;
+
+			vacuum_delay_point();
+
+			if (!compact_page(onerel, blkno, estate, slot, bstrategy,
+							  &nmoved, &nleft))
+			{
+				done = true;
+				break;
+			}
+		}
+
+		ExecResetTupleTable(estate->es_tupleTable, false);
+		ExecCloseIndices(resultRelInfo);
+		FreeExecutorState(estate);
+
+		AtEOXact_GUC(false, save_nestlevel);
+		SetUserIdAndSecContext(save_userid, save_sec_context);
+
+		/* Remember the newest transaction that moved anything */
+		if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+			lastXid = GetTopTransactionIdIfAny();
+
+		relation_close(onerel, NoLock);
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+	}
+
+	if (nleft > 0)
+		ereport(elevel,
+				(errmsg("\"%s\": moved %.0f row versions towards the start of the table",
+						relname, nmoved),
+				 errdetail("%.0f row versions could not be moved because they were locked or being modified.",
+						   nleft)));
+	else
+		ereport(elevel,
+				(errmsg("\"%s\": moved %.0f row versions towards the start of the table",
+						relname, nmoved)));
+
+	pfree(relname);
+
+	if (!TransactionIdIsValid(lastXid))
+		return false;
+
+	/*
+	 * The old versions of the moved rows can't be removed while there are
+	 * snapshots that might still see them, so wait for those to go away.
+	 */
+	StartTransactionCommand();
+	wait_for_older_snapshots(lastXid);
+	CommitTransactionCommand();
+
+	return true;
+}
+
+/*
+ *	compact_page() -- move the live rows of one page to lower pages
+ *
+ *		Returns false once there's no more room below the page, and we
+ *		should stop.
+ */
+static bool
+compact_page(Relation onerel, BlockNumber blkno,
+			 EState *estate, TupleTableSlot *slot,
+			 BufferAccessStrategy bstrategy,
+			 double *nmoved, double *nleft)
+{
+	HeapTuple	tuples[MaxHeapTuplesPerPage];
+	int			ntuples = 0;
+	Size		saveFreeSpace;
+	Buffer		buf;
+	Page		page;
+	OffsetNumber offnum,
+				maxoff;
+	int			i;
+
+	saveFreeSpace = RelationGetTargetPageFreeSpace(onerel,
+												   HEAP_DEFAULT_FILLFACTOR);
+
+	/*
+	 * Make sure that neither we nor anyone else puts new rows on this page
+	 * while we're emptying it; the vacuum that follows will record its real
+	 * free space again.
+	 */
+	RecordPageWithFreeSpace(onerel, blkno, 0);
+
+	/* Collect copies of the rows that everyone can see */
+	buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+							 bstrategy);
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buf);
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		HeapTupleData tuple;
+
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+		tuple.t_len = ItemIdGetLength(itemid);
+		tuple.t_tableOid = RelationGetRelid(onerel);
+		ItemPointerSet(&(tuple.t_self), blkno, offnum);
+
+		switch (HeapTupleSatisfiesVacuum(tuple.t_data, RecentGlobalXmin, buf))
+		{
+			case HEAPTUPLE_LIVE:
+				tuples[ntuples++] = heap_copytuple(&tuple);
+				break;
+			case HEAPTUPLE_INSERT_IN_PROGRESS:
+			case HEAPTUPLE_DELETE_IN_PROGRESS:
+				(*nleft) += 1;
+				break;
+			default:
+				/* dead, or soon will be; vacuum will get it */
+				break;
+		}
+	}
+
+	UnlockReleaseBuffer(buf);
+
+	for (i = 0; i < ntuples; i++)
+	{
+		HeapTuple	tuple = tuples[i];
+		ItemPointerData otid = tuple->t_self;
+		ItemPointerData update_ctid;
+		TransactionId update_xmax;
+		BlockNumber target;
+		HTSU_Result result;
+		bool		noroom;
+
+		/*
+		 * Point the relation's insertion target at a lower page with room
+		 * for the row, unless it already is at one.  If the target turns out
+		 * to be full, heap_move_tuple will consult the free space map for
+		 * another lower page itself.
+		 */
+		target = RelationGetTargetBlock(onerel);
+		if (target == InvalidBlockNumber || target >= blkno)
+		{
+			target = GetPageWithFreeSpace(onerel,
+										  MAXALIGN(tuple->t_len) + saveFreeSpace);
+			if (target == InvalidBlockNumber || target >= blkno)
+				return false;
+			RelationSetTargetBlock(onerel, target);
+		}
+
+		result = heap_move_tuple(onerel, &otid, tuple,
+								 &update_ctid, &update_xmax,
+								 GetCurrentCommandId(true), &noroom);
+		if (noroom)
+			return false;
+		if (result != HeapTupleMayBeUpdated)
+		{
+			/* someone else got there first; leave the row alone */
+			(*nleft) += 1;
+			continue;
+		}
+		Assert(ItemPointerGetBlockNumber(&(tuple->t_self)) < blkno);
+		(*nmoved) += 1;
+
+		/* The new version needs index entries, unless it's heap-only */
+		if (!HeapTupleIsHeapOnly(tuple))
+		{
+			List	   *recheckIndexes;
+
+			ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+
+			/*
+			 * A deferrable unique constraint may ask us to recheck, but the
+			 * moved row can't be the one that violates it: the constraint
+			 * held for the old version, which nobody but us can see as
+			 * deleted yet.
+			 */
+			recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
+												   estate, false);
+			list_free(recheckIndexes);
+
+			ResetPerTupleExprContext(estate);
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Wait for every transaction that might still see row versions deleted by
+ * transaction xid as live, as CREATE INDEX CONCURRENTLY does.  Lazy vacuums
+ * don't matter, since they won't look at our rows anyway.
+ */
+static void
+wait_for_older_snapshots(TransactionId xid)
+{
+	VirtualTransactionId *old_snapshots;
+	int			n_old_snapshots;
+	int			i;
+
+	old_snapshots = GetCurrentVirtualXIDs(xid, true, false,
+										  PROC_IS_AUTOVACUUM | PROC_IN_VACUUM,
+										  &n_old_snapshots);
+
+	for (i = 0; i < n_old_snapshots; i++)
+		VirtualXactLock(old_snapshots[i], true);
+
+	pfree(old_snapshots);
+}
@@ -43,6 +43,7 @@
 #include "access/visibilitymap.h"
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
+#include "commands/progress.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -68,11 +69,24 @@
 #define REL_TRUNCATE_FRACTION	16
 
 /*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
+ * Dead tuple TIDs are remembered as one bitmap of line pointer offsets per
+ * heap block, which takes a small fraction of the space of an array of
+ * ItemPointers when each block has more than a couple of dead tuples.  The
+ * per-block bitmaps are packed one after another from the start of the
+ * allocated space in block order, while a fixed-size header for each block
+ * is stored downwards from the end; the space is full when the two meet.
  */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
+typedef struct LVDeadBlock
+{
+	BlockNumber blkno;			/* heap block */
+	uint32		bitmapoff;		/* start of its offset bitmap in dead_space */
+} LVDeadBlock;
+
+#define DEAD_BITMAP_BYTES(noffsets)	(((noffsets) + 7) / 8)
+
+/* Worst-case space needed to remember the dead tuples of one heap block */
+#define LAZY_MAX_BLOCK_SPACE \
+	(sizeof(LVDeadBlock) + DEAD_BITMAP_BYTES(MaxHeapTuplesPerPage))
 
 /*
  * Before we consider skipping a page that's marked as clean in
@@ -88,17 +102,20 @@ typedef struct LVRelStats
 	BlockNumber old_rel_pages;	/* previous value of pg_class.relpages */
 	BlockNumber rel_pages;		/* total number of pages */
 	BlockNumber scanned_pages;	/* number of pages we examined */
+	BlockNumber frozenskipped_pages;	/* # of all-frozen pages we skipped */
 	double		scanned_tuples; /* counts only tuples on scanned pages */
 	double		old_rel_tuples; /* previous value of pg_class.reltuples */
 	double		new_rel_tuples; /* new estimated total # of tuples */
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete, kept in block order */
+	int			num_dead_tuples;	/* current # of TIDs */
+	int			num_dead_blocks;	/* current # of LVDeadBlock headers */
+	char	   *dead_space;		/* offset bitmaps, then headers at the end */
+	Size		dead_space_size;	/* allocated size of dead_space */
+	Size		dead_bitmap_used;	/* bytes of dead_space used by bitmaps */
+	int			last_lookup;	/* header found by last lazy_tid_reaped */
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 } LVRelStats;
@@ -113,6 +130,17 @@ static TransactionId FreezeLimit;
 static BufferAccessStrategy vac_strategy;
 
 
+/* The i'th dead block header, counting from the end of dead_space */
+#define LVDeadBlockAt(vacrelstats, i) \
+	((LVDeadBlock *) ((vacrelstats)->dead_space + \
+					  (vacrelstats)->dead_space_size) - ((i) + 1))
+
+/* Bytes of dead_space not yet used by either bitmaps or headers */
+#define LVDeadSpaceAvail(vacrelstats) \
+	((vacrelstats)->dead_space_size - (vacrelstats)->dead_bitmap_used - \
+	 (vacrelstats)->num_dead_blocks * sizeof(LVDeadBlock))
+
+
 /* non-export function prototypes */
 static void lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			   Relation *Irel, int nindexes, bool scan_all);
@@ -125,15 +153,15 @@ static void lazy_cleanup_index(Relation indrel,
 				   IndexBulkDeleteResult *stats,
 				   LVRelStats *vacrelstats);
 static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats);
+				 int blkindex, LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
 static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
 static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr);
+static void lazy_forget_dead_tuples(LVRelStats *vacrelstats);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 
 
 /*
@@ -180,6 +208,9 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 
 	vac_strategy = bstrategy;
 
+	pgstat_progress_start_command(PROGRESS_COMMAND_VACUUM,
+								  RelationGetRelid(onerel));
+
 	vacuum_set_xid_limits(vacstmt->freeze_min_age, vacstmt->freeze_table_age,
 						  onerel->rd_rel->relisshared,
 						  &OldestXmin, &FreezeLimit, &freezeTableLimit);
@@ -212,7 +243,14 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	if (possibly_freeable > 0 &&
 		(possibly_freeable >= REL_TRUNCATE_MINIMUM ||
 		 possibly_freeable >= vacrelstats->rel_pages / REL_TRUNCATE_FRACTION))
+	{
+		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+									 PROGRESS_VACUUM_PHASE_TRUNCATE);
 		lazy_truncate_heap(onerel, vacrelstats);
+	}
+
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_FINAL_CLEANUP);
 
 	/* Vacuum the Free Space Map */
 	FreeSpaceMapVacuum(onerel);
@@ -231,8 +269,9 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 	 * table is all-visible we'd definitely like to know that.  But clamp
 	 * the value to be not more than what we're setting relpages to.
 	 *
-	 * Also, don't change relfrozenxid if we skipped any pages, since then
-	 * we don't know for certain that all tuples have a newer xmin.
+	 * Also, don't change relfrozenxid if we skipped any pages that weren't
+	 * all-frozen, since then we don't know for certain that all tuples have
+	 * a newer xmin.
 	 */
 	new_rel_pages = vacrelstats->rel_pages;
 	new_rel_tuples = vacrelstats->new_rel_tuples;
@@ -247,7 +286,8 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 		new_rel_allvisible = new_rel_pages;
 
 	new_frozen_xid = FreezeLimit;
-	if (vacrelstats->scanned_pages < vacrelstats->rel_pages)
+	if (vacrelstats->scanned_pages + vacrelstats->frozenskipped_pages <
+		vacrelstats->rel_pages)
 		new_frozen_xid = InvalidTransactionId;
 
 	vac_update_relstats(onerel,
@@ -262,6 +302,8 @@ lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 						 onerel->rd_rel->relisshared,
 						 new_rel_tuples);
 
+	pgstat_progress_end_command();
+
 	/* and log the action if appropriate */
 	if (IsAutoVacuumWorkerProcess() && Log_autovacuum_min_duration >= 0)
 	{
@@ -368,8 +410,9 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
-	BlockNumber next_not_all_visible_block;
-	bool		skipping_all_visible_blocks;
+	BlockNumber next_unskippable_block;
+	bool		skipping_blocks;
+	uint8		skip_flags;
 
 	pg_rusage_init(&ru0);
 
@@ -388,45 +431,64 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	nblocks = RelationGetNumberOfBlocks(onerel);
 	vacrelstats->rel_pages = nblocks;
 	vacrelstats->scanned_pages = 0;
+	vacrelstats->frozenskipped_pages = 0;
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
 	lazy_space_alloc(vacrelstats, nblocks);
 
+	/* Report that we're scanning the heap, and how much there is to do */
+	{
+		const int	index[] = {
+			PROGRESS_VACUUM_PHASE,
+			PROGRESS_VACUUM_TOTAL_HEAP_BLKS,
+			PROGRESS_VACUUM_MAX_DEAD_TUPLE_BYTES
+		};
+		int64		val[3];
+
+		val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
+		val[1] = nblocks;
+		val[2] = vacrelstats->dead_space_size;
+		pgstat_progress_update_multi_param(3, index, val);
+	}
+
 	/*
 	 * We want to skip pages that don't require vacuuming according to the
 	 * visibility map, but only when we can skip at least SKIP_PAGES_THRESHOLD
 	 * consecutive pages.  Since we're reading sequentially, the OS should be
 	 * doing readahead for us, so there's no gain in skipping a page now and
 	 * then; that's likely to disable readahead and so be counterproductive.
-	 * Also, skipping even a single page means that we can't update
-	 * relfrozenxid, so we only want to do it if we can skip a goodly number
-	 * of pages.
+	 * Also, skipping even a single page that isn't all-frozen means that we
+	 * can't update relfrozenxid, so we only want to do it if we can skip a
+	 * goodly number of pages.
 	 *
-	 * Before entering the main loop, establish the invariant that
-	 * next_not_all_visible_block is the next block number >= blkno that's not
-	 * all-visible according to the visibility map, or nblocks if there's no
-	 * such block.	Also, we set up the skipping_all_visible_blocks flag,
-	 * which is needed because we need hysteresis in the decision: once we've
-	 * started skipping blocks, we may as well skip everything up to the next
-	 * not-all-visible block.
+	 * An ordinary vacuum can skip every all-visible page.  A vacuum that
+	 * scans the whole relation to guard against XID wraparound must look at
+	 * all pages that might contain unfrozen xids, but it can still skip
+	 * pages that the visibility map says are all-frozen.
 	 *
-	 * Note: if scan_all is true, we won't actually skip any pages; but we
-	 * maintain next_not_all_visible_block anyway, so as to set up the
-	 * all_visible_according_to_vm flag correctly for each page.
+	 * Before entering the main loop, establish the invariant that
+	 * next_unskippable_block is the next block number >= blkno that we can't
+	 * skip according to the visibility map, or nblocks if there's no such
+	 * block.  Also, we set up the skipping_blocks flag, which is needed
+	 * because we need hysteresis in the decision: once we've started
+	 * skipping blocks, we may as well skip everything up to the next
+	 * unskippable block.
 	 */
-	for (next_not_all_visible_block = 0;
-		 next_not_all_visible_block < nblocks;
-		 next_not_all_visible_block++)
+	skip_flags = scan_all ? VISIBILITYMAP_ALL_FROZEN : VISIBILITYMAP_ALL_VISIBLE;
+	for (next_unskippable_block = 0;
+		 next_unskippable_block < nblocks;
+		 next_unskippable_block++)
 	{
-		if (!visibilitymap_test(onerel, next_not_all_visible_block, &vmbuffer))
+		if ((visibilitymap_get_status(onerel, next_unskippable_block,
+									  &vmbuffer) & skip_flags) == 0)
 			break;
 		vacuum_delay_point();
 	}
-	if (next_not_all_visible_block >= SKIP_PAGES_THRESHOLD)
-		skipping_all_visible_blocks = true;
+	if (next_unskippable_block >= SKIP_PAGES_THRESHOLD)
+		skipping_blocks = true;
 	else
-		skipping_all_visible_blocks = false;
+		skipping_blocks = false;
 
 	for (blkno = 0; blkno < nblocks; blkno++)
 	{
@@ -440,41 +502,69 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		OffsetNumber frozen[MaxOffsetNumber];
 		int			nfrozen;
 		Size		freespace;
+		uint8		vmstatus;
 		bool		all_visible_according_to_vm;
+		bool		all_frozen_according_to_vm;
 		bool		all_visible;
+		bool		all_frozen;
 		bool		has_dead_tuples;
 
-		if (blkno == next_not_all_visible_block)
 		{
-			/* Time to advance next_not_all_visible_block */
-			for (next_not_all_visible_block++;
-				 next_not_all_visible_block < nblocks;
-				 next_not_all_visible_block++)
+			const int	index[] = {
+				PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+				PROGRESS_VACUUM_NUM_DEAD_TUPLES
+			};
+			int64		val[2];
+
+			val[0] = blkno;
+			val[1] = vacrelstats->num_dead_tuples;
+			pgstat_progress_update_multi_param(2, index, val);
+		}
+
+		if (blkno == next_unskippable_block)
+		{
+			/* Time to advance next_unskippable_block */
+			for (next_unskippable_block++;
+				 next_unskippable_block < nblocks;
+				 next_unskippable_block++)
 			{
-				if (!visibilitymap_test(onerel, next_not_all_visible_block,
-										&vmbuffer))
+				if ((visibilitymap_get_status(onerel, next_unskippable_block,
+											  &vmbuffer) & skip_flags) == 0)
 					break;
 				vacuum_delay_point();
 			}
 
 			/*
 			 * We know we can't skip the current block.  But set up
-			 * skipping_all_visible_blocks to do the right thing at the
-			 * following blocks.
+			 * skipping_blocks to do the right thing at the following blocks.
 			 */
-			if (next_not_all_visible_block - blkno > SKIP_PAGES_THRESHOLD)
-				skipping_all_visible_blocks = true;
+			if (next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD)
+				skipping_blocks = true;
 			else
-				skipping_all_visible_blocks = false;
-			all_visible_according_to_vm = false;
+				skipping_blocks = false;
+
+			/*
+			 * In a whole-relation scan, an unskippable block may still be
+			 * all-visible; an ordinary vacuum would have skipped it if so.
+			 */
+			vmstatus = scan_all ?
+				visibilitymap_get_status(onerel, blkno, &vmbuffer) : 0;
 		}
 		else
 		{
-			/* Current block is all-visible */
-			if (skipping_all_visible_blocks && !scan_all)
+			/* Current block is skippable */
+			vmstatus = visibilitymap_get_status(onerel, blkno, &vmbuffer);
+			if (skipping_blocks)
+			{
+				if (vmstatus & VISIBILITYMAP_ALL_FROZEN)
+					vacrelstats->frozenskipped_pages++;
 				continue;
-			all_visible_according_to_vm = true;
+			}
 		}
+		all_visible_according_to_vm =
+			(vmstatus & VISIBILITYMAP_ALL_VISIBLE) != 0;
+		all_frozen_according_to_vm =
+			(vmstatus & VISIBILITYMAP_ALL_FROZEN) != 0;
 
 		vacuum_delay_point();
 
@@ -482,13 +572,15 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
+		if (LVDeadSpaceAvail(vacrelstats) < LAZY_MAX_BLOCK_SPACE &&
 			vacrelstats->num_dead_tuples > 0)
 		{
 			/* Log cleanup info before we touch indexes */
 			vacuum_log_cleanup_info(onerel, vacrelstats);
 
 			/* Remove index entries */
+			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+										 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 			for (i = 0; i < nindexes; i++)
 				lazy_vacuum_index(Irel[i],
 								  &indstats[i],
@@ -501,8 +593,23 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			lazy_forget_dead_tuples(vacrelstats);
 			vacrelstats->num_index_scans++;
+
+			/* Back to scanning the heap */
+			{
+				const int	index[] = {
+					PROGRESS_VACUUM_PHASE,
+					PROGRESS_VACUUM_NUM_INDEX_VACUUMS,
+					PROGRESS_VACUUM_NUM_DEAD_TUPLES
+				};
+				int64		val[3];
+
+				val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
+				val[1] = vacrelstats->num_index_scans;
+				val[2] = 0;
+				pgstat_progress_update_multi_param(3, index, val);
+			}
 		}
 
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
@@ -598,19 +705,21 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			if (!PageIsAllVisible(page))
 			{
 				PageSetAllVisible(page);
-				SetBufferCommitInfoNeedsSave(buf);
+				MarkBufferDirty(buf);
 			}
 
 			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 
-			/* Update the visibility map */
-			if (!all_visible_according_to_vm)
+			/* Update the visibility map; an empty page is trivially frozen */
+			if (!all_visible_according_to_vm || !all_frozen_according_to_vm)
 			{
 				visibilitymap_pin(onerel, blkno, &vmbuffer);
 				LockBuffer(buf, BUFFER_LOCK_SHARE);
 				if (PageIsAllVisible(page))
 					visibilitymap_set(onerel, blkno, InvalidXLogRecPtr,
-									  vmbuffer);
+									  vmbuffer,
+									  VISIBILITYMAP_ALL_VISIBLE |
+									  VISIBILITYMAP_ALL_FROZEN);
 				LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 			}
 
@@ -624,7 +733,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 *
 		 * We count tuples removed by the pruning step as removed by VACUUM.
 		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
+		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false, true,
 										 &vacrelstats->latestRemovedXid);
 
 		/*
@@ -632,6 +741,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		 * requiring freezing.
 		 */
 		all_visible = true;
+		all_frozen = true;
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
@@ -787,6 +897,10 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 				if (heap_freeze_tuple(tuple.t_data, FreezeLimit,
 									  InvalidBuffer))
 					frozen[nfrozen++] = offnum;
+
+				/* Check it's frozen now, if the page may be marked so */
+				if (all_frozen && !heap_tuple_is_frozen(tuple.t_data))
+					all_frozen = false;
 			}
 		}						/* scan along page */
 
@@ -824,7 +938,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			lazy_forget_dead_tuples(vacrelstats);
 			vacuumed_pages++;
 		}
 
@@ -834,7 +948,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		if (!PageIsAllVisible(page) && all_visible)
 		{
 			PageSetAllVisible(page);
-			SetBufferCommitInfoNeedsSave(buf);
+			MarkBufferDirty(buf);
 		}
 
 		/*
@@ -855,7 +969,7 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
 				 relname, blkno);
 			PageClearAllVisible(page);
-			SetBufferCommitInfoNeedsSave(buf);
+			MarkBufferDirty(buf);
 
 			/*
 			 * Normally, we would drop the lock on the heap page before
@@ -863,18 +977,30 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			 * happen anyway, don't worry about that.
 			 */
 			visibilitymap_pin(onerel, blkno, &vmbuffer);
-			visibilitymap_clear(onerel, blkno, vmbuffer);
+			visibilitymap_clear(onerel, blkno, vmbuffer,
+								VISIBILITYMAP_VALID_BITS);
 		}
 
 		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 
-		/* Update the visibility map */
-		if (!all_visible_according_to_vm && all_visible)
+		/*
+		 * Update the visibility map.  A page that was already all-visible
+		 * may have become all-frozen through the freezing done above.
+		 */
+		if (all_visible &&
+			(!all_visible_according_to_vm ||
+			 (all_frozen && !all_frozen_according_to_vm)))
 		{
+			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+			if (all_frozen)
+				flags |= VISIBILITYMAP_ALL_FROZEN;
+
 			visibilitymap_pin(onerel, blkno, &vmbuffer);
 			LockBuffer(buf, BUFFER_LOCK_SHARE);
 			if (PageIsAllVisible(page))
-				visibilitymap_set(onerel, blkno, InvalidXLogRecPtr, vmbuffer);
+				visibilitymap_set(onerel, blkno, InvalidXLogRecPtr, vmbuffer,
+								  flags);
 			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
 		}
 
@@ -895,6 +1021,9 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
+	/* report that everything is scanned */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, nblocks);
+
 	/* save stats for use later */
 	vacrelstats->scanned_tuples = num_tuples;
 	vacrelstats->tuples_deleted = tups_vacuumed;
@@ -913,6 +1042,17 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		vacuum_log_cleanup_info(onerel, vacrelstats);
 
 		/* Remove index entries */
+		{
+			const int	index[] = {
+				PROGRESS_VACUUM_PHASE,
+				PROGRESS_VACUUM_NUM_DEAD_TUPLES
+			};
+			int64		val[2];
+
+			val[0] = PROGRESS_VACUUM_PHASE_VACUUM_INDEX;
+			val[1] = vacrelstats->num_dead_tuples;
+			pgstat_progress_update_multi_param(2, index, val);
+		}
 		for (i = 0; i < nindexes; i++)
 			lazy_vacuum_index(Irel[i],
 							  &indstats[i],
@@ -920,6 +1060,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 		/* Remove tuples from heap */
 		lazy_vacuum_heap(onerel, vacrelstats);
 		vacrelstats->num_index_scans++;
+		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_INDEX_VACUUMS,
+									 vacrelstats->num_index_scans);
 	}
 
 	/* Release the pin on the visibility map page */
@@ -930,6 +1072,8 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 	}
 
 	/* Do post-vacuum cleanup and statistics update for each index */
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
 	for (i = 0; i < nindexes; i++)
 		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
 
@@ -970,15 +1114,20 @@ lazy_scan_heap(Relation onerel, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	int			blkindex;
+	int			ntuples;
 	int			npages;
 	PGRUsage	ru0;
 
+	/* Report that we are now vacuuming the heap */
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_VACUUM_HEAP);
+
 	pg_rusage_init(&ru0);
+	ntuples = 0;
 	npages = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	for (blkindex = 0; blkindex < vacrelstats->num_dead_blocks; blkindex++)
 	{
 		BlockNumber tblk;
 		Buffer		buf;
@@ -987,12 +1136,15 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
+		tblk = LVDeadBlockAt(vacrelstats, blkindex)->blkno;
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
+		{
+			ReleaseBuffer(buf);
 			continue;
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats);
+		}
+		ntuples += lazy_vacuum_page(onerel, tblk, buf, blkindex, vacrelstats);
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -1001,12 +1153,16 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 		UnlockReleaseBuffer(buf);
 		RecordPageWithFreeSpace(onerel, tblk, freespace);
 		npages++;
+
+		/* Pages are visited in order, so this is how far we've got */
+		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED,
+									 tblk + 1);
 	}
 
 	ereport(elevel,
 			(errmsg("\"%s\": removed %d row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					ntuples, npages),
 			 errdetail("%s.",
 					   pg_rusage_show(&ru0))));
 }
@@ -1017,30 +1173,39 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * blkindex is the index of this page's dead block header in vacrelstats.
+ * The return value is the number of tuples freed.
  */
 static int
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats)
+				 int blkindex, LVRelStats *vacrelstats)
 {
 	Page		page = BufferGetPage(buffer);
+	LVDeadBlock *dblk = LVDeadBlockAt(vacrelstats, blkindex);
+	uint8	   *bitmap = (uint8 *) vacrelstats->dead_space + dblk->bitmapoff;
+	int			nbits;
+	int			bit;
 	OffsetNumber unused[MaxOffsetNumber];
 	int			uncnt = 0;
 
+	Assert(dblk->blkno == blkno);
+
+	if (blkindex + 1 < vacrelstats->num_dead_blocks)
+		nbits = (LVDeadBlockAt(vacrelstats, blkindex + 1)->bitmapoff -
+				 dblk->bitmapoff) * 8;
+	else
+		nbits = (vacrelstats->dead_bitmap_used - dblk->bitmapoff) * 8;
+
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (bit = 0; bit < nbits; bit++)
 	{
-		BlockNumber tblk;
 		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
+		if (!(bitmap[bit / 8] & (1 << (bit % 8))))
+			continue;
+		toff = (OffsetNumber) (bit + FirstOffsetNumber);
 		itemid = PageGetItemId(page, toff);
 		ItemIdSetUnused(itemid);
 		unused[uncnt++] = toff;
@@ -1065,7 +1230,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 	END_CRIT_SECTION();
 
-	return tupindex;
+	return uncnt;
 }
 
 /*
@@ -1115,8 +1280,8 @@ lazy_check_needs_freeze(Buffer buf)
 /*
  *	lazy_vacuum_index() -- vacuum one index relation.
  *
- *		Delete all the index entries pointing to tuples listed in
- *		vacrelstats->dead_tuples, and update running statistics.
+ *		Delete all the index entries pointing to tuples recorded in
+ *		vacrelstats, and update running statistics.
  */
 static void
 lazy_vacuum_index(Relation indrel,
@@ -1373,49 +1538,100 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 static void
 lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
 {
-	long		maxtuples;
+	long		maxbytes;
 
 	if (vacrelstats->hasindex)
 	{
-		maxtuples = (maintenance_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+		maxbytes = maintenance_work_mem * 1024L;
+		maxbytes = Min(maxbytes, MaxAllocSize);
 
 		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
-
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+		if ((BlockNumber) (maxbytes / LAZY_MAX_BLOCK_SPACE) > relblocks)
+			maxbytes = relblocks * LAZY_MAX_BLOCK_SPACE;
 	}
 	else
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		/* one page at a time is enough */
+		maxbytes = 0;
 	}
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	/* must hold a whole number of headers, and at least one full page */
+	maxbytes = TYPEALIGN_DOWN(sizeof(LVDeadBlock), maxbytes);
+	maxbytes = Max(maxbytes,
+				   (long) TYPEALIGN(sizeof(LVDeadBlock), LAZY_MAX_BLOCK_SPACE));
+
+	vacrelstats->dead_space = (char *) palloc(maxbytes);
+	vacrelstats->dead_space_size = maxbytes;
+	lazy_forget_dead_tuples(vacrelstats);
 }
 
 /*
  * lazy_record_dead_tuple - remember one deletable tuple
+ *
+ * Tuples must be recorded in TID order.
  */
 static void
 lazy_record_dead_tuple(LVRelStats *vacrelstats,
 					   ItemPointer itemptr)
 {
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	int			bit = ItemPointerGetOffsetNumber(itemptr) - FirstOffsetNumber;
+	LVDeadBlock *dblk = NULL;
+	Size		needed;
+
+	if (vacrelstats->num_dead_blocks > 0)
+	{
+		dblk = LVDeadBlockAt(vacrelstats, vacrelstats->num_dead_blocks - 1);
+		Assert(dblk->blkno <= blkno);
+		if (dblk->blkno != blkno)
+			dblk = NULL;
+	}
+
 	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
+	 * The space shouldn't overflow under normal behavior, since the caller
+	 * checks for room for a whole page before starting on one, but perhaps
+	 * it could if we are given a really small maintenance_work_mem.  In that
 	 * case, just forget the last few tuples (we'll get 'em next time).
 	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
+	if (vacrelstats->num_dead_tuples == INT_MAX)
+		return;
+	if (dblk == NULL)
+	{
+		if (LVDeadSpaceAvail(vacrelstats) <
+			sizeof(LVDeadBlock) + DEAD_BITMAP_BYTES(bit + 1))
+			return;
+		dblk = LVDeadBlockAt(vacrelstats, vacrelstats->num_dead_blocks);
+		dblk->blkno = blkno;
+		dblk->bitmapoff = vacrelstats->dead_bitmap_used;
+		vacrelstats->num_dead_blocks++;
+	}
+
+	/* extend this block's bitmap, which is always the last one, if needed */
+	needed = dblk->bitmapoff + DEAD_BITMAP_BYTES(bit + 1);
+	if (needed > vacrelstats->dead_bitmap_used)
 	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
+		if (needed - vacrelstats->dead_bitmap_used >
+			LVDeadSpaceAvail(vacrelstats))
+			return;
+		memset(vacrelstats->dead_space + vacrelstats->dead_bitmap_used, 0,
+			   needed - vacrelstats->dead_bitmap_used);
+		vacrelstats->dead_bitmap_used = needed;
 	}
+
+	vacrelstats->dead_space[dblk->bitmapoff + bit / 8] |= 1 << (bit % 8);
+	vacrelstats->num_dead_tuples++;
+}
+
+/*
+ * lazy_forget_dead_tuples - empty the dead tuple store
+ */
+static void
+lazy_forget_dead_tuples(LVRelStats *vacrelstats)
+{
+	vacrelstats->num_dead_tuples = 0;
+	vacrelstats->num_dead_blocks = 0;
+	vacrelstats->dead_bitmap_used = 0;
+	vacrelstats->last_lookup = 0;
 }
 
 /*
@@ -1423,49 +1639,53 @@ lazy_record_dead_tuple(LVRelStats *vacrelstats,
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
  *
- *		Assumes dead_tuples array is in sorted order.
+ *		Index entries pointing into the same heap block tend to come in
+ *		runs, so we first try the block that satisfied the previous call,
+ *		and binary-search the block headers only when that misses.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	int			bit = ItemPointerGetOffsetNumber(itemptr) - FirstOffsetNumber;
+	int			blkindex = vacrelstats->last_lookup;
+	LVDeadBlock *dblk;
+	Size		bitmapend;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
-
-	return (res != NULL);
-}
-
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
+	if (vacrelstats->num_dead_blocks == 0)
+		return false;
 
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	dblk = LVDeadBlockAt(vacrelstats, blkindex);
+	if (dblk->blkno != blkno)
+	{
+		int			low = 0;
+		int			high = vacrelstats->num_dead_blocks - 1;
 
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
+		for (;;)
+		{
+			if (low > high)
+				return false;
+			blkindex = (low + high) / 2;
+			dblk = LVDeadBlockAt(vacrelstats, blkindex);
+			if (dblk->blkno < blkno)
+				low = blkindex + 1;
+			else if (dblk->blkno > blkno)
+				high = blkindex - 1;
+			else
+				break;
+		}
+		vacrelstats->last_lookup = blkindex;
+	}
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+	if (blkindex + 1 < vacrelstats->num_dead_blocks)
+		bitmapend = LVDeadBlockAt(vacrelstats, blkindex + 1)->bitmapoff;
+	else
+		bitmapend = vacrelstats->dead_bitmap_used;
 
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
+	if (dblk->bitmapoff + bit / 8 >= bitmapend)
+		return false;
 
-	return 0;
+	return (vacrelstats->dead_space[dblk->bitmapoff + bit / 8] &
+			(1 << (bit % 8))) != 0;
 }
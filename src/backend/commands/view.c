@@ -45,7 +45,7 @@ static bool isViewOnTempTable_walker(Node *node, void *context);
  * temporary tables.
  *---------------------------------------------------------------------
  */
-static bool
+bool
 isViewOnTempTable(Query *viewParse)
 {
 	return isViewOnTempTable_walker((Node *) viewParse, NULL);
@@ -534,6 +534,20 @@ DefineView(ViewStmt *stmt, const char *queryString)
 	 */
 	CommandCounterIncrement();
 
+	/* Store the query as the view's ON SELECT rule */
+	StoreViewQuery(viewOid, viewParse, stmt->replace);
+}
+
+/*
+ * StoreViewQuery
+ *		Store the analyzed query of a view or materialized view as its
+ *		ON SELECT rule.
+ *
+ * The relation must already exist and be visible.
+ */
+void
+StoreViewQuery(Oid viewOid, Query *viewParse, bool replace)
+{
 	/*
 	 * The range table of 'viewParse' does not contain entries for the "OLD"
 	 * and "NEW" relations. So... add them!
@@ -543,5 +557,5 @@ DefineView(ViewStmt *stmt, const char *queryString)
 	/*
 	 * Now create the rules associated with the view.
 	 */
-	DefineViewRules(viewOid, viewParse, stmt->replace);
+	DefineViewRules(viewOid, viewParse, replace);
 }
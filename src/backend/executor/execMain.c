@@ -39,13 +39,16 @@
 
 #include "access/reloptions.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
 #include "catalog/heap.h"
 #include "catalog/namespace.h"
 #include "catalog/toasting.h"
+#include "commands/matview.h"
 #include "commands/tablespace.h"
 #include "commands/trigger.h"
+#include "commands/view.h"
 #include "executor/execdebug.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
@@ -833,6 +836,8 @@ InitPlan(QueryDesc *queryDesc, int eflags)
 			case ROW_MARK_SHARE:
 				relid = getrelid(rc->rti, rangeTable);
 				relation = heap_open(relid, RowShareLock);
+				/* heap_lock_tuple only knows heap pages */
+				CheckTableIsHeap(relation, "SELECT FOR UPDATE/SHARE");
 				break;
 			case ROW_MARK_REFERENCE:
 				relid = getrelid(rc->rti, rangeTable);
@@ -872,7 +877,10 @@ InitPlan(QueryDesc *queryDesc, int eflags)
 	if (operation == CMD_SELECT && plannedstmt->intoClause != NULL)
 	{
 		estate->es_select_into = true;
-		estate->es_into_oids = interpretOidsOption(plannedstmt->intoClause->options);
+		/* materialized views never have OIDs */
+		estate->es_into_oids =
+			plannedstmt->intoClause->relkind != RELKIND_MATVIEW &&
+			interpretOidsOption(plannedstmt->intoClause->options);
 	}
 
 	/*
@@ -1044,6 +1052,14 @@ CheckValidResultRel(Relation resultRel, CmdType operation)
 					break;
 			}
 			break;
+		case RELKIND_MATVIEW:
+			/* only REFRESH ... CONCURRENTLY may change its rows */
+			if (!MatViewMaintenanceIsEnabled())
+				ereport(ERROR,
+						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+						 errmsg("cannot change materialized view \"%s\"",
+								RelationGetRelationName(resultRel))));
+			break;
 		case RELKIND_FOREIGN_TABLE:
 			ereport(ERROR,
 					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
@@ -1094,6 +1110,14 @@ CheckValidRowMarkRel(Relation rel, RowMarkType markType)
 					 errmsg("cannot lock rows in view \"%s\"",
 							RelationGetRelationName(rel))));
 			break;
+		case RELKIND_MATVIEW:
+			/* Its rows can be referenced, but not locked */
+			if (markType != ROW_MARK_REFERENCE)
+				ereport(ERROR,
+						(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+						 errmsg("cannot lock rows in materialized view \"%s\"",
+								RelationGetRelationName(rel))));
+			break;
 		case RELKIND_FOREIGN_TABLE:
 			/* Perhaps we can support this someday, but not today */
 			ereport(ERROR,
@@ -2457,6 +2481,9 @@ typedef struct
  * This also replaces QueryDesc->dest with the special DestReceiver for
  * SELECT INTO.  We assume that the correct result tuple type has already
  * been placed in queryDesc->tupDesc.
+ *
+ * For CREATE MATERIALIZED VIEW, the relation is a matview, and the query
+ * saved by parse analysis is stored as its ON SELECT rule.
  */
 static void
 OpenIntoRel(QueryDesc *queryDesc)
@@ -2476,6 +2503,8 @@ OpenIntoRel(QueryDesc *queryDesc)
 	static char *validnsps[] = HEAP_RELOPT_NAMESPACES;
 
 	Assert(into);
+	Assert(into->relkind == RELKIND_RELATION ||
+		   (into->relkind == RELKIND_MATVIEW && into->viewQuery != NULL));
 
 	/*
 	 * XXX This code needs to be kept in sync with DefineRelation(). Maybe we
@@ -2491,6 +2520,16 @@ OpenIntoRel(QueryDesc *queryDesc)
 				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
 				 errmsg("ON COMMIT can only be used on temporary tables")));
 
+	/*
+	 * A materialized view outlives the session, so it can't be built on
+	 * anything that doesn't.
+	 */
+	if (into->relkind == RELKIND_MATVIEW &&
+		isViewOnTempTable((Query *) into->viewQuery))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialized views must not use temporary tables or views")));
+
 	{
 		AclResult aclresult;
 		int i;
@@ -2583,7 +2622,7 @@ OpenIntoRel(QueryDesc *queryDesc)
 									 validnsps,
 									 true,
 									 false);
-	(void) heap_reloptions(RELKIND_RELATION, reloptions, true);
+	(void) heap_reloptions(into->relkind, reloptions, true);
 
 	/* Now we can actually create the new relation */
 	intoRelationId = heap_create_with_catalog(intoName,
@@ -2595,7 +2634,7 @@ OpenIntoRel(QueryDesc *queryDesc)
 											  GetUserId(),
 											  intoTupDesc,
 											  NIL,
-											  RELKIND_RELATION,
+											  into->relkind,
 											  into->rel->relpersistence,
 											  false,
 											  false,
@@ -2629,6 +2668,13 @@ OpenIntoRel(QueryDesc *queryDesc)
 
 	AlterTableCreateToastTable(intoRelationId, reloptions);
 
+	/* Remember a materialized view's query, for REFRESH */
+	if (into->relkind == RELKIND_MATVIEW)
+	{
+		StoreViewQuery(intoRelationId, (Query *) into->viewQuery, false);
+		CommandCounterIncrement();
+	}
+
 	/*
 	 * And open the constructed table for writing.
 	 */
@@ -2640,7 +2686,7 @@ OpenIntoRel(QueryDesc *queryDesc)
 	rte = makeNode(RangeTblEntry);
 	rte->rtekind = RTE_RELATION;
 	rte->relid = intoRelationId;
-	rte->relkind = RELKIND_RELATION;
+	rte->relkind = into->relkind;
 	rte->requiredPerms = ACL_INSERT;
 
 	for (attnum = 1; attnum <= intoTupDesc->natts; attnum++)
@@ -2689,8 +2735,8 @@ CloseIntoRel(QueryDesc *queryDesc)
 		FreeBulkInsertState(myState->bistate);
 
 		/* If we skipped using WAL, must heap_sync before commit */
-		if (myState->hi_options & HEAP_INSERT_SKIP_WAL)
-			heap_sync(myState->rel);
+		GetTableAmRoutine(myState->rel)->FinishBulkInsert(myState->rel,
+													myState->hi_options);
 
 		/* close rel, but keep lock until commit */
 		heap_close(myState->rel, NoLock);
@@ -2752,11 +2798,11 @@ intorel_receive(TupleTableSlot *slot, DestReceiver *self)
 	if (myState->rel->rd_rel->relhasoids)
 		HeapTupleSetOid(tuple, InvalidOid);
 
-	heap_insert(myState->rel,
-				tuple,
-				myState->estate->es_output_cid,
-				myState->hi_options,
-				myState->bistate);
+	GetTableAmRoutine(myState->rel)->InsertTableRow(myState->rel,
+													slot,
+											myState->estate->es_output_cid,
+													myState->hi_options,
+													myState->bistate);
 
 	/* We know this is a newly created relation, so there are no indexes */
 }
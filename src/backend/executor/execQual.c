@@ -46,6 +46,7 @@
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/planmain.h"
 #include "optimizer/planner.h"
 #include "parser/parse_coerce.h"
 #include "pgstat.h"
@@ -57,6 +58,33 @@
 #include "utils/xml.h"
 
 
+/*
+ * "scalar op ANY/ALL (array)" with a constant array of at least this many
+ * elements is evaluated by probing a hash table of the elements, if the
+ * operator allows.  Below that, comparing against each element in turn is
+ * about as fast.
+ */
+#define MIN_ARRAY_SIZE_FOR_HASHED_SAOP	9
+
+/*
+ * The hash table for that: open addressing with linear probing, over a
+ * power-of-two number of buckets that is at least twice the number of
+ * non-null elements.  Duplicate elements are simply stored twice.
+ */
+typedef struct SAOPHashTable
+{
+	FmgrInfo	hash_finfo;		/* element hash function */
+	FunctionCallInfoData hash_fcinfo;
+	FmgrInfo	eq_finfo;		/* equality function */
+	FunctionCallInfoData eq_fcinfo;
+	uint32		mask;			/* number of buckets - 1 */
+	Datum	   *values;			/* element in each bucket */
+	uint32	   *hashes;			/* its hash value */
+	bool	   *used;			/* is the bucket in use? */
+	bool		has_nulls;		/* does the array contain NULLs? */
+} SAOPHashTable;
+
+
 /* static function decls */
 static Datum ExecEvalArrayRef(ArrayRefExprState *astate,
 				 ExprContext *econtext,
@@ -102,6 +130,10 @@ static Datum ExecMakeFunctionResult(FuncExprState *fcache,
 static Datum ExecMakeFunctionResultNoSets(FuncExprState *fcache,
 							 ExprContext *econtext,
 							 bool *isNull, ExprDoneCond *isDone);
+static Datum ExecMakeFunctionResultSimpleArgs(FuncExprState *fcache,
+								 ExprContext *econtext,
+								 bool *isNull, ExprDoneCond *isDone);
+static bool func_args_are_simple(FuncExprState *fcache);
 static Datum ExecEvalFunc(FuncExprState *fcache, ExprContext *econtext,
 			 bool *isNull, ExprDoneCond *isDone);
 static Datum ExecEvalOper(FuncExprState *fcache, ExprContext *econtext,
@@ -111,6 +143,9 @@ static Datum ExecEvalDistinct(FuncExprState *fcache, ExprContext *econtext,
 static Datum ExecEvalScalarArrayOp(ScalarArrayOpExprState *sstate,
 					  ExprContext *econtext,
 					  bool *isNull, ExprDoneCond *isDone);
+static SAOPHashTable *build_saop_hash_table(ScalarArrayOpExprState *sstate);
+static Datum ExecEvalHashedScalarArrayOp(ScalarArrayOpExprState *sstate,
+							Datum scalar, bool *isNull);
 static Datum ExecEvalNot(BoolExprState *notclause, ExprContext *econtext,
 			bool *isNull, ExprDoneCond *isDone);
 static Datum ExecEvalOr(BoolExprState *orExpr, ExprContext *econtext,
@@ -166,6 +201,7 @@ static Datum ExecEvalFieldStore(FieldStoreState *fstate,
 static Datum ExecEvalRelabelType(GenericExprState *exprstate,
 					ExprContext *econtext,
 					bool *isNull, ExprDoneCond *isDone);
+static List *ExecInitFuncArgs(List *args, PlanState *parent);
 static Datum ExecEvalCoerceViaIO(CoerceViaIOState *iostate,
 					ExprContext *econtext,
 					bool *isNull, ExprDoneCond *isDone);
@@ -917,7 +953,7 @@ ExecEvalWholeRowSlow(ExprState *exprstate, ExprContext *econtext,
 
 		if (!vattr->attisdropped)
 			continue;			/* already checked non-dropped cols */
-		if (heap_attisnull(tuple, i + 1))
+		if (heap_attisnull(tuple, i + 1, slot->tts_tupleDescriptor))
 			continue;			/* null is always okay */
 		if (vattr->attlen != sattr->attlen ||
 			vattr->attalign != sattr->attalign)
@@ -1803,9 +1839,14 @@ restart:
 		 * We change the ExprState function pointer to use the simpler
 		 * ExecMakeFunctionResultNoSets on subsequent calls.  This amounts to
 		 * assuming that no argument can return a set if it didn't do so the
-		 * first time.
+		 * first time.  If all the arguments are plain scalar Vars or Consts,
+		 * which is the common case for WHERE-clause operators, use the even
+		 * simpler ExecMakeFunctionResultSimpleArgs instead.
 		 */
-		fcache->xprstate.evalfunc = (ExprStateEvalFunc) ExecMakeFunctionResultNoSets;
+		if (func_args_are_simple(fcache))
+			fcache->xprstate.evalfunc = (ExprStateEvalFunc) ExecMakeFunctionResultSimpleArgs;
+		else
+			fcache->xprstate.evalfunc = (ExprStateEvalFunc) ExecMakeFunctionResultNoSets;
 
 		if (isDone)
 			*isDone = ExprSingleResult;
@@ -1903,6 +1944,120 @@ ExecMakeFunctionResultNoSets(FuncExprState *fcache,
 	return result;
 }
 
+/*
+ * func_args_are_simple
+ *
+ * Check whether every argument of an already-initialized function call is
+ * either a scalar Var or a Const.  We rely on the argument ExprStates having
+ * been evaluated at least once, so that ExecEvalVar has already done its
+ * one-time checks and replaced itself with ExecEvalScalarVar.
+ */
+static bool
+func_args_are_simple(FuncExprState *fcache)
+{
+	ListCell   *arg;
+
+	if (fcache->args == NIL)
+		return false;
+
+	foreach(arg, fcache->args)
+	{
+		ExprState  *argstate = (ExprState *) lfirst(arg);
+
+		if (argstate->evalfunc != ExecEvalScalarVar &&
+			argstate->evalfunc != ExecEvalConst)
+			return false;
+	}
+	return true;
+}
+
+/*
+ *		ExecMakeFunctionResultSimpleArgs
+ *
+ * Version of ExecMakeFunctionResultNoSets for functions whose arguments are
+ * all scalar Vars or Consts.  We fetch Var values straight from the input
+ * slots, without going through a per-argument evalfunc call, which takes a
+ * noticeable fraction of the per-row cost of simple qual evaluation.
+ */
+static Datum
+ExecMakeFunctionResultSimpleArgs(FuncExprState *fcache,
+								 ExprContext *econtext,
+								 bool *isNull,
+								 ExprDoneCond *isDone)
+{
+	ListCell   *arg;
+	Datum		result;
+	FunctionCallInfo fcinfo;
+	PgStat_FunctionCallUsage fcusage;
+	int			i;
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+
+	fcinfo = &fcache->fcinfo_data;
+	i = 0;
+	foreach(arg, fcache->args)
+	{
+		ExprState  *argstate = (ExprState *) lfirst(arg);
+
+		if (argstate->evalfunc == ExecEvalScalarVar)
+		{
+			Var		   *variable = (Var *) argstate->expr;
+			TupleTableSlot *slot;
+
+			switch (variable->varno)
+			{
+				case INNER_VAR:
+					slot = econtext->ecxt_innertuple;
+					break;
+				case OUTER_VAR:
+					slot = econtext->ecxt_outertuple;
+					break;
+				default:
+					slot = econtext->ecxt_scantuple;
+					break;
+			}
+			fcinfo->arg[i] = slot_getattr(slot, variable->varattno,
+										  &fcinfo->argnull[i]);
+		}
+		else
+		{
+			Const	   *con = (Const *) argstate->expr;
+
+			Assert(argstate->evalfunc == ExecEvalConst);
+			fcinfo->arg[i] = con->constvalue;
+			fcinfo->argnull[i] = con->constisnull;
+		}
+		i++;
+	}
+
+	/*
+	 * If function is strict, and there are any NULL arguments, skip calling
+	 * the function and return NULL.
+	 */
+	if (fcache->func.fn_strict)
+	{
+		while (--i >= 0)
+		{
+			if (fcinfo->argnull[i])
+			{
+				*isNull = true;
+				return (Datum) 0;
+			}
+		}
+	}
+
+	pgstat_init_function_usage(fcinfo, &fcusage);
+
+	fcinfo->isnull = false;
+	result = FunctionCallInvoke(fcinfo);
+	*isNull = fcinfo->isnull;
+
+	pgstat_end_function_usage(&fcusage, true);
+
+	return result;
+}
+
 
 /*
  *		ExecMakeTableFunctionResult
@@ -2468,6 +2623,10 @@ ExecEvalScalarArrayOp(ScalarArrayOpExprState *sstate,
 	typbyval = sstate->typbyval;
 	typalign = sstate->typalign;
 
+	/* Large constant arrays are looked up in a hash table instead */
+	if (OidIsValid(sstate->hash_funcid))
+		return ExecEvalHashedScalarArrayOp(sstate, fcinfo->arg[0], isNull);
+
 	result = BoolGetDatum(!useOr);
 	resultnull = false;
 
@@ -2546,6 +2705,181 @@ ExecEvalScalarArrayOp(ScalarArrayOpExprState *sstate,
 	return result;
 }
 
+/*
+ * ExecScalarArrayOpIsHashable
+ *
+ * Can "scalar op ANY/ALL (array)" be evaluated by probing a hash table of
+ * the array's elements?  That takes a constant array of at least
+ * MIN_ARRAY_SIZE_FOR_HASHED_SAOP elements and a strict operator.  For ANY,
+ * the operator must be hashable, with the same hash function on both sides;
+ * for ALL, its negator must be, as in "x <> ALL (...)", which is
+ * "NOT (x = ANY (...))" but for the handling of NULLs.
+ *
+ * If so, returns true, with the OIDs of the hash function and of the
+ * equality function to probe with.  The planner uses this for costing too.
+ */
+bool
+ExecScalarArrayOpIsHashable(ScalarArrayOpExpr *opexpr,
+							Oid *hashfuncid, Oid *eqfuncid)
+{
+	Node	   *arrayarg = (Node *) lsecond(opexpr->args);
+	ArrayType  *arr;
+	Oid			eqop;
+	RegProcedure lefthashfunc;
+	RegProcedure righthashfunc;
+
+	if (!IsA(arrayarg, Const) || ((Const *) arrayarg)->constisnull)
+		return false;
+	arr = DatumGetArrayTypeP(((Const *) arrayarg)->constvalue);
+	if (ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr)) <
+		MIN_ARRAY_SIZE_FOR_HASHED_SAOP)
+		return false;
+
+	if (opexpr->useOr)
+		eqop = opexpr->opno;
+	else
+	{
+		eqop = get_negator(opexpr->opno);
+		if (!OidIsValid(eqop))
+			return false;
+	}
+
+	if (!get_op_hash_functions(eqop, &lefthashfunc, &righthashfunc) ||
+		lefthashfunc != righthashfunc)
+		return false;
+
+	/* We rely on strictness to deal with NULL inputs */
+	set_sa_opfuncid(opexpr);
+	*eqfuncid = get_opcode(eqop);
+	if (!func_strict(opexpr->opfuncid) || !func_strict(*eqfuncid))
+		return false;
+
+	*hashfuncid = lefthashfunc;
+	return true;
+}
+
+/*
+ * Build the hash table of the elements of a constant array, in the
+ * per-query memory context
+ */
+static SAOPHashTable *
+build_saop_hash_table(ScalarArrayOpExprState *sstate)
+{
+	ScalarArrayOpExpr *opexpr = (ScalarArrayOpExpr *) sstate->fxprstate.xprstate.expr;
+	Const	   *arrayconst = (Const *) lsecond(opexpr->args);
+	MemoryContext oldcontext;
+	SAOPHashTable *htab;
+	ArrayType  *arr;
+	Datum	   *elems;
+	bool	   *nulls;
+	int			nitems;
+	uint32		nbuckets;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(sstate->fxprstate.func.fn_mcxt);
+
+	htab = (SAOPHashTable *) palloc0(sizeof(SAOPHashTable));
+
+	fmgr_info(sstate->hash_funcid, &htab->hash_finfo);
+	InitFunctionCallInfoData(htab->hash_fcinfo, &htab->hash_finfo, 1,
+							 opexpr->inputcollid, NULL, NULL);
+	htab->hash_fcinfo.argnull[0] = false;
+	fmgr_info(sstate->hash_eqfuncid, &htab->eq_finfo);
+	InitFunctionCallInfoData(htab->eq_fcinfo, &htab->eq_finfo, 2,
+							 opexpr->inputcollid, NULL, NULL);
+	htab->eq_fcinfo.argnull[0] = false;
+	htab->eq_fcinfo.argnull[1] = false;
+
+	/* the elements point into the array, so it must stay around */
+	arr = DatumGetArrayTypeP(arrayconst->constvalue);
+	deconstruct_array(arr, ARR_ELEMTYPE(arr),
+					  sstate->typlen, sstate->typbyval, sstate->typalign,
+					  &elems, &nulls, &nitems);
+
+	nbuckets = 1;
+	while (nbuckets < (uint32) nitems * 2)
+		nbuckets <<= 1;
+	htab->mask = nbuckets - 1;
+	htab->values = (Datum *) palloc(nbuckets * sizeof(Datum));
+	htab->hashes = (uint32 *) palloc(nbuckets * sizeof(uint32));
+	htab->used = (bool *) palloc0(nbuckets * sizeof(bool));
+
+	for (i = 0; i < nitems; i++)
+	{
+		uint32		hash;
+		uint32		bucket;
+
+		if (nulls[i])
+		{
+			htab->has_nulls = true;
+			continue;
+		}
+
+		htab->hash_fcinfo.arg[0] = elems[i];
+		htab->hash_fcinfo.isnull = false;
+		hash = DatumGetUInt32(FunctionCallInvoke(&htab->hash_fcinfo));
+
+		bucket = hash & htab->mask;
+		while (htab->used[bucket])
+			bucket = (bucket + 1) & htab->mask;
+		htab->values[bucket] = elems[i];
+		htab->hashes[bucket] = hash;
+		htab->used[bucket] = true;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return htab;
+}
+
+/*
+ * Evaluate "scalar op ANY/ALL (array)" by a hash table lookup, for a
+ * non-null scalar.  See ExecScalarArrayOpIsHashable.
+ */
+static Datum
+ExecEvalHashedScalarArrayOp(ScalarArrayOpExprState *sstate,
+							Datum scalar, bool *isNull)
+{
+	ScalarArrayOpExpr *opexpr = (ScalarArrayOpExpr *) sstate->fxprstate.xprstate.expr;
+	SAOPHashTable *htab = sstate->hashtab;
+	uint32		hash;
+	uint32		bucket;
+
+	if (htab == NULL)
+		htab = sstate->hashtab = build_saop_hash_table(sstate);
+
+	htab->hash_fcinfo.arg[0] = scalar;
+	htab->hash_fcinfo.isnull = false;
+	hash = DatumGetUInt32(FunctionCallInvoke(&htab->hash_fcinfo));
+
+	for (bucket = hash & htab->mask;
+		 htab->used[bucket];
+		 bucket = (bucket + 1) & htab->mask)
+	{
+		Datum		eqresult;
+
+		if (htab->hashes[bucket] != hash)
+			continue;
+
+		htab->eq_fcinfo.arg[0] = scalar;
+		htab->eq_fcinfo.arg[1] = htab->values[bucket];
+		htab->eq_fcinfo.isnull = false;
+		eqresult = FunctionCallInvoke(&htab->eq_fcinfo);
+
+		/* found: true for ANY, false for ALL of the negator */
+		if (!htab->eq_fcinfo.isnull && DatumGetBool(eqresult))
+			return BoolGetDatum(opexpr->useOr);
+	}
+
+	/* not found, but a NULL element might have matched */
+	if (htab->has_nulls)
+	{
+		*isNull = true;
+		return (Datum) 0;
+	}
+	return BoolGetDatum(!opexpr->useOr);
+}
+
 /* ----------------------------------------------------------------
  *		ExecEvalNot
  *		ExecEvalOr
@@ -3624,7 +3958,7 @@ ExecEvalNullTest(NullTestState *nstate,
 			/* ignore dropped columns */
 			if (tupDesc->attrs[att - 1]->attisdropped)
 				continue;
-			if (heap_attisnull(&tmptup, att))
+			if (heap_attisnull(&tmptup, att, tupDesc))
 			{
 				/* null field disproves IS NOT NULL */
 				if (ntest->nulltesttype == IS_NOT_NULL)
@@ -4369,8 +4703,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FuncExprState *fstate = makeNode(FuncExprState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalFunc;
-				fstate->args = (List *)
-					ExecInitExpr((Expr *) funcexpr->args, parent);
+				fstate->args = ExecInitFuncArgs(funcexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4381,8 +4714,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FuncExprState *fstate = makeNode(FuncExprState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalOper;
-				fstate->args = (List *)
-					ExecInitExpr((Expr *) opexpr->args, parent);
+				fstate->args = ExecInitFuncArgs(opexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4393,8 +4725,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FuncExprState *fstate = makeNode(FuncExprState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalDistinct;
-				fstate->args = (List *)
-					ExecInitExpr((Expr *) distinctexpr->args, parent);
+				fstate->args = ExecInitFuncArgs(distinctexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4405,8 +4736,7 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				FuncExprState *fstate = makeNode(FuncExprState);
 
 				fstate->xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalNullIf;
-				fstate->args = (List *)
-					ExecInitExpr((Expr *) nullifexpr->args, parent);
+				fstate->args = ExecInitFuncArgs(nullifexpr->args, parent);
 				fstate->func.fn_oid = InvalidOid;		/* not initialized */
 				state = (ExprState *) fstate;
 			}
@@ -4417,10 +4747,14 @@ ExecInitExpr(Expr *node, PlanState *parent)
 				ScalarArrayOpExprState *sstate = makeNode(ScalarArrayOpExprState);
 
 				sstate->fxprstate.xprstate.evalfunc = (ExprStateEvalFunc) ExecEvalScalarArrayOp;
-				sstate->fxprstate.args = (List *)
-					ExecInitExpr((Expr *) opexpr->args, parent);
+				sstate->fxprstate.args = ExecInitFuncArgs(opexpr->args, parent);
 				sstate->fxprstate.func.fn_oid = InvalidOid;		/* not initialized */
 				sstate->element_type = InvalidOid;		/* ditto */
+				if (!ExecScalarArrayOpIsHashable(opexpr,
+												 &sstate->hash_funcid,
+												 &sstate->hash_eqfuncid))
+					sstate->hash_funcid = InvalidOid;
+				sstate->hashtab = NULL;
 				state = (ExprState *) sstate;
 			}
 			break;
@@ -4910,6 +5244,35 @@ ExecInitExpr(Expr *node, PlanState *parent)
 	return state;
 }
 
+/*
+ * ExecInitFuncArgs --- initialize the argument list of a function or
+ * operator call
+ *
+ * A RelabelType is a no-op at runtime, since its input and output types are
+ * binary compatible, so here we initialize the RelabelType's input in its
+ * place.  That saves a level of evalfunc dispatch per argument, and lets the
+ * fast path in ExecMakeFunctionResult see a plain Var or Const argument.
+ * This is only safe because the function call code gets argument types from
+ * the call's own expression node, never from the argument ExprStates, whose
+ * expr fields here point to the RelabelType's input instead.
+ */
+static List *
+ExecInitFuncArgs(List *args, PlanState *parent)
+{
+	List	   *result = NIL;
+	ListCell   *l;
+
+	foreach(l, args)
+	{
+		Expr	   *arg = (Expr *) lfirst(l);
+
+		while (arg && IsA(arg, RelabelType))
+			arg = ((RelabelType *) arg)->arg;
+		result = lappend(result, ExecInitExpr(arg, parent));
+	}
+	return result;
+}
+
 /*
  * ExecPrepareExpr --- initialize for expression execution outside a normal
  * Plan tree context.
@@ -248,8 +248,12 @@ ExecAssignScanProjectionInfo(ScanState *node)
 	Scan	   *scan = (Scan *) node->ps.plan;
 	Index		varno;
 
-	/* Vars in an index-only scan's tlist should be INDEX_VAR */
-	if (IsA(scan, IndexOnlyScan))
+	/*
+	 * Vars in an index-only scan's tlist should be INDEX_VAR, and so should
+	 * those of a foreign scan that has no scan relation of its own.
+	 */
+	if (IsA(scan, IndexOnlyScan) ||
+		(IsA(scan, ForeignScan) && scan->scanrelid == 0))
 		varno = INDEX_VAR;
 	else
 		varno = scan->scanrelid;
@@ -559,10 +559,15 @@ ExecCopySlotTuple(TupleTableSlot *slot)
 	Assert(!slot->tts_isempty);
 
 	/*
-	 * If we have a physical tuple (either format) then just copy it.
+	 * If we have a physical tuple (either format) then just copy it, adding
+	 * any columns it was stored without.
 	 */
 	if (TTS_HAS_PHYSICAL_TUPLE(slot))
+	{
+		if (HeapTupleNeedsExpansion(slot->tts_tuple, slot->tts_tupleDescriptor))
+			return heap_expand_tuple(slot->tts_tuple, slot->tts_tupleDescriptor);
 		return heap_copytuple(slot->tts_tuple);
+	}
 	if (slot->tts_mintuple)
 		return heap_tuple_from_minimal_tuple(slot->tts_mintuple);
 
@@ -597,7 +602,20 @@ ExecCopySlotMinimalTuple(TupleTableSlot *slot)
 	if (slot->tts_mintuple)
 		return heap_copy_minimal_tuple(slot->tts_mintuple);
 	if (slot->tts_tuple)
+	{
+		if (HeapTupleNeedsExpansion(slot->tts_tuple, slot->tts_tupleDescriptor))
+		{
+			HeapTuple	tuple;
+			MinimalTuple mtup;
+
+			tuple = heap_expand_tuple(slot->tts_tuple,
+									  slot->tts_tupleDescriptor);
+			mtup = minimal_tuple_from_heap_tuple(tuple);
+			heap_freetuple(tuple);
+			return mtup;
+		}
 		return minimal_tuple_from_heap_tuple(slot->tts_tuple);
+	}
 
 	/*
 	 * Otherwise we need to build a tuple from the Datum array.
@@ -632,10 +650,26 @@ ExecFetchSlotTuple(TupleTableSlot *slot)
 	Assert(!slot->tts_isempty);
 
 	/*
-	 * If we have a regular physical tuple then just return it.
+	 * If we have a regular physical tuple then just return it, unless it
+	 * lacks columns that were added since it was stored.  Then we replace
+	 * it with a copy that has them, so that the caller can read the tuple
+	 * without the slot's tuple descriptor.
 	 */
 	if (TTS_HAS_PHYSICAL_TUPLE(slot))
+	{
+		if (HeapTupleNeedsExpansion(slot->tts_tuple, slot->tts_tupleDescriptor))
+		{
+			HeapTuple	tuple;
+			MemoryContext oldContext;
+
+			oldContext = MemoryContextSwitchTo(slot->tts_mcxt);
+			tuple = heap_expand_tuple(slot->tts_tuple,
+									  slot->tts_tupleDescriptor);
+			MemoryContextSwitchTo(oldContext);
+			slot = ExecStoreTuple(tuple, slot, InvalidBuffer, true);
+		}
 		return slot->tts_tuple;
+	}
 
 	/*
 	 * Otherwise materialize the slot...
@@ -43,10 +43,12 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "access/sysattr.h"
 #include "access/transam.h"
 #include "catalog/index.h"
 #include "executor/execdebug.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/var.h"
 #include "parser/parsetree.h"
 #include "storage/lmgr.h"
 #include "utils/memutils.h"
@@ -54,6 +56,8 @@
 
 
 static bool get_last_attnums(Node *node, ProjectionInfo *projInfo);
+static bool index_unchanged_by_update(ResultRelInfo *resultRelInfo,
+						  EState *estate, IndexInfo *indexInfo);
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 						 Datum *existing_values, bool *existing_isnull,
 						 Datum *new_values);
@@ -975,6 +979,10 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *		constraints that are deferred and that had
  *		potential (unconfirmed) conflicts.
  *
+ *		update is true if the heap tuple is the new version of an updated
+ *		row; then each index is told whether the UPDATE left its columns
+ *		alone, which the index AM may use to clean out old versions.
+ *
  *		CAUTION: this must not be called for a HOT update.
  *		We can't defend against that here for lack of info.
  *		Should we change the API to make it safer?
@@ -983,7 +991,8 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
 List *
 ExecInsertIndexTuples(TupleTableSlot *slot,
 					  ItemPointer tupleid,
-					  EState *estate)
+					  EState *estate,
+					  bool update)
 {
 	List	   *result = NIL;
 	ResultRelInfo *resultRelInfo;
@@ -1089,7 +1098,10 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 						 isnull,	/* null flags */
 						 tupleid,		/* tid of heap tuple */
 						 heapRelation,	/* heap relation */
-						 checkUnique);	/* type of uniqueness check to do */
+						 checkUnique,	/* type of uniqueness check to do */
+						 update &&
+						 index_unchanged_by_update(resultRelInfo, estate,
+												   indexInfo));
 
 		/*
 		 * If the index has an associated exclusion constraint, check that.
@@ -1129,6 +1141,48 @@ ExecInsertIndexTuples(TupleTableSlot *slot,
 	return result;
 }
 
+/*
+ * index_unchanged_by_update
+ *
+ * Does the UPDATE being executed leave the columns this index depends on
+ * unchanged?  We go by the columns the statement assigns, so a BEFORE
+ * trigger changing another column can fool us; the answer is only a hint
+ * for the index AM, so that does no harm.
+ */
+static bool
+index_unchanged_by_update(ResultRelInfo *resultRelInfo, EState *estate,
+						  IndexInfo *indexInfo)
+{
+	Bitmapset  *modifiedCols;
+	Bitmapset  *indexCols = NULL;
+	bool		result;
+	int			i;
+
+	modifiedCols = rt_fetch(resultRelInfo->ri_RangeTableIndex,
+							estate->es_range_table)->modifiedCols;
+
+	for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
+	{
+		int			attnum = indexInfo->ii_KeyAttrNumbers[i];
+
+		/* expression columns are handled below */
+		if (attnum != 0 &&
+			bms_is_member(attnum - FirstLowInvalidHeapAttributeNumber,
+						  modifiedCols))
+			return false;
+	}
+
+	if (indexInfo->ii_Expressions == NIL && indexInfo->ii_Predicate == NIL)
+		return true;
+
+	pull_varattnos((Node *) indexInfo->ii_Expressions, 1, &indexCols);
+	pull_varattnos((Node *) indexInfo->ii_Predicate, 1, &indexCols);
+	result = !bms_overlap(indexCols, modifiedCols);
+	bms_free(indexCols);
+
+	return result;
+}
+
 /*
  * Check for violation of an exclusion constraint
  *
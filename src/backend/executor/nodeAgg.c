@@ -78,6 +78,7 @@
 
 #include "postgres.h"
 
+#include "access/hash.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
@@ -95,6 +96,7 @@
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
+#include "utils/tuplestore.h"
 #include "utils/datum.h"
 
 
@@ -133,6 +135,13 @@ typedef struct AggStatePerAggData
 	/* Input collation derived for aggregate */
 	Oid			aggCollation;
 
+	/*
+	 * Call data for the transition function.  This is initialized once in
+	 * ExecInitAgg(), rather than for every input row; the per-row code only
+	 * fills in the arguments and resets isnull.
+	 */
+	FunctionCallInfoData transfn_fcinfo;
+
 	/* number of sorting columns */
 	int			numSortCols;
 
@@ -240,16 +249,30 @@ typedef struct AggStatePerGroupData
  * To implement hashed aggregation, we need a hashtable that stores a
  * representative tuple and an array of AggStatePerGroup structs for each
  * distinct set of GROUP BY column values.	We compute the hash key from
- * the GROUP BY columns.
+ * the GROUP BY columns.  The array is the additional data of each
+ * TupleHashEntry.
+ */
+
+/*
+ * If the hash table would grow beyond work_mem, input tuples belonging to
+ * groups that are not already in the table are instead written out to one
+ * of HASHAGG_SPILL_PARTITIONS spill files, chosen by hashing the grouping
+ * columns, so that all tuples of any one group end up in the same file.
+ * Once the input is exhausted, the groups in the hash table are complete
+ * and are returned; then the table is emptied, and each spill file is read
+ * back in turn as though it were the input.  A spill file that still has
+ * too many groups simply spills again, using a different hash, so every
+ * pass finishes at least hash_max_groups groups.
+ *
+ * Each spilled batch awaiting processing is represented by one of these.
  */
-typedef struct AggHashEntryData *AggHashEntry;
+#define HASHAGG_SPILL_PARTITIONS	16
 
-typedef struct AggHashEntryData
+typedef struct AggSpillBatch
 {
-	TupleHashEntryData shared;	/* common header for hash table entries */
-	/* per-aggregate transition status array - must be last! */
-	AggStatePerGroupData pergroup[1];	/* VARIABLE LENGTH ARRAY */
-}	AggHashEntryData;	/* VARIABLE LENGTH STRUCT */
+	Tuplestorestate *tuples;	/* spilled input tuples */
+	int			depth;			/* how many times they have been spilled */
+} AggSpillBatch;
 
 
 static void initialize_aggregates(AggState *aggstate,
@@ -257,8 +280,7 @@ static void initialize_aggregates(AggState *aggstate,
 					  AggStatePerGroup pergroup);
 static void advance_transition_function(AggState *aggstate,
 							AggStatePerAgg peraggstate,
-							AggStatePerGroup pergroupstate,
-							FunctionCallInfoData *fcinfo);
+							AggStatePerGroup pergroupstate);
 static void advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup);
 static void process_ordered_aggregate_single(AggState *aggstate,
 								 AggStatePerAgg peraggstate,
@@ -273,11 +295,14 @@ static void finalize_aggregate(AggState *aggstate,
 static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
-static AggHashEntry lookup_hash_entry(AggState *aggstate,
+static TupleHashEntry lookup_hash_entry(AggState *aggstate,
 				  TupleTableSlot *inputslot);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
+static void agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot);
+static void agg_reset_spill(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 
 
@@ -366,17 +391,18 @@ initialize_aggregates(AggState *aggstate,
  * Given new input value(s), advance the transition function of an aggregate.
  *
  * The new values (and null flags) have been preloaded into argument positions
- * 1 and up in fcinfo, so that we needn't copy them again to pass to the
- * transition function.  No other fields of fcinfo are assumed valid.
+ * 1 and up in peraggstate->transfn_fcinfo, so that we needn't copy them again
+ * to pass to the transition function.  The other fields of that struct were
+ * set up by ExecInitAgg().
  *
  * It doesn't matter which memory context this is called in.
  */
 static void
 advance_transition_function(AggState *aggstate,
 							AggStatePerAgg peraggstate,
-							AggStatePerGroup pergroupstate,
-							FunctionCallInfoData *fcinfo)
+							AggStatePerGroup pergroupstate)
 {
+	FunctionCallInfoData *fcinfo = &peraggstate->transfn_fcinfo;
 	int			numArguments = peraggstate->numArguments;
 	MemoryContext oldContext;
 	Datum		newVal;
@@ -431,12 +457,9 @@ advance_transition_function(AggState *aggstate,
 	/*
 	 * OK to call the transition function
 	 */
-	InitFunctionCallInfoData(*fcinfo, &(peraggstate->transfn),
-							 numArguments + 1,
-							 peraggstate->aggCollation,
-							 (void *) aggstate, NULL);
 	fcinfo->arg[0] = pergroupstate->transValue;
 	fcinfo->argnull[0] = pergroupstate->transValueIsNull;
+	fcinfo->isnull = false;
 
 	newVal = FunctionCallInvoke(fcinfo);
 
@@ -523,19 +546,18 @@ advance_aggregates(AggState *aggstate, AggStatePerGroup pergroup)
 		else
 		{
 			/* We can apply the transition function immediately */
-			FunctionCallInfoData fcinfo;
+			FunctionCallInfoData *fcinfo = &peraggstate->transfn_fcinfo;
 
 			/* Load values into fcinfo */
 			/* Start from 1, since the 0th arg will be the transition value */
 			Assert(slot->tts_nvalid >= nargs);
 			for (i = 0; i < nargs; i++)
 			{
-				fcinfo.arg[i + 1] = slot->tts_values[i];
-				fcinfo.argnull[i + 1] = slot->tts_isnull[i];
+				fcinfo->arg[i + 1] = slot->tts_values[i];
+				fcinfo->argnull[i + 1] = slot->tts_isnull[i];
 			}
 
-			advance_transition_function(aggstate, peraggstate, pergroupstate,
-										&fcinfo);
+			advance_transition_function(aggstate, peraggstate, pergroupstate);
 		}
 	}
 }
@@ -573,15 +595,15 @@ process_ordered_aggregate_single(AggState *aggstate,
 	bool		isDistinct = (peraggstate->numDistinctCols > 0);
 	Datum	   *newVal;
 	bool	   *isNull;
-	FunctionCallInfoData fcinfo;
+	FunctionCallInfoData *fcinfo = &peraggstate->transfn_fcinfo;
 
 	Assert(peraggstate->numDistinctCols < 2);
 
 	tuplesort_performsort(peraggstate->sortstate);
 
 	/* Load the column into argument 1 (arg 0 will be transition value) */
-	newVal = fcinfo.arg + 1;
-	isNull = fcinfo.argnull + 1;
+	newVal = fcinfo->arg + 1;
+	isNull = fcinfo->argnull + 1;
 
 	/*
 	 * Note: if input type is pass-by-ref, the datums returned by the sort are
@@ -617,8 +639,7 @@ process_ordered_aggregate_single(AggState *aggstate,
 		}
 		else
 		{
-			advance_transition_function(aggstate, peraggstate, pergroupstate,
-										&fcinfo);
+			advance_transition_function(aggstate, peraggstate, pergroupstate);
 			/* forget the old value, if any */
 			if (!oldIsNull && !peraggstate->inputtypeByVal)
 				pfree(DatumGetPointer(oldVal));
@@ -653,7 +674,7 @@ process_ordered_aggregate_multi(AggState *aggstate,
 								AggStatePerGroup pergroupstate)
 {
 	MemoryContext workcontext = aggstate->tmpcontext->ecxt_per_tuple_memory;
-	FunctionCallInfoData fcinfo;
+	FunctionCallInfoData *fcinfo = &peraggstate->transfn_fcinfo;
 	TupleTableSlot *slot1 = peraggstate->evalslot;
 	TupleTableSlot *slot2 = peraggstate->uniqslot;
 	int			numArguments = peraggstate->numArguments;
@@ -687,12 +708,11 @@ process_ordered_aggregate_multi(AggState *aggstate,
 			/* Start from 1, since the 0th arg will be the transition value */
 			for (i = 0; i < numArguments; i++)
 			{
-				fcinfo.arg[i + 1] = slot1->tts_values[i];
-				fcinfo.argnull[i + 1] = slot1->tts_isnull[i];
+				fcinfo->arg[i + 1] = slot1->tts_values[i];
+				fcinfo->argnull[i + 1] = slot1->tts_isnull[i];
 			}
 
-			advance_transition_function(aggstate, peraggstate, pergroupstate,
-										&fcinfo);
+			advance_transition_function(aggstate, peraggstate, pergroupstate);
 
 			if (numDistinctCols > 0)
 			{
@@ -828,20 +848,19 @@ build_hash_table(AggState *aggstate)
 {
 	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
 	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
-	Size		entrysize;
+	Size		additionalsize;
 
 	Assert(node->aggstrategy == AGG_HASHED);
 	Assert(node->numGroups > 0);
 
-	entrysize = sizeof(AggHashEntryData) +
-		(aggstate->numaggs - 1) * sizeof(AggStatePerGroupData);
+	additionalsize = aggstate->numaggs * sizeof(AggStatePerGroupData);
 
 	aggstate->hashtable = BuildTupleHashTable(node->numCols,
 											  node->grpColIdx,
 											  aggstate->eqfunctions,
 											  aggstate->hashfunctions,
 											  node->numGroups,
-											  entrysize,
+											  additionalsize,
 											  aggstate->aggcontext,
 											  tmpmem);
 }
@@ -905,27 +924,27 @@ hash_agg_entry_size(int numAggs)
 	Size		entrysize;
 
 	/* This must match build_hash_table */
-	entrysize = sizeof(AggHashEntryData) +
-		(numAggs - 1) * sizeof(AggStatePerGroupData);
-	entrysize = MAXALIGN(entrysize);
-	/* Account for hashtable overhead (assuming fill factor = 1) */
-	entrysize += 3 * sizeof(void *);
+	entrysize = MAXALIGN(numAggs * sizeof(AggStatePerGroupData)) +
+		2 * sizeof(void *);		/* palloc overhead of the additional data */
+	/* Account for the bucket, and the empty buckets beside it */
+	entrysize += sizeof(TupleHashEntryData) + sizeof(TupleHashEntryData) / 8;
 	return entrysize;
 }
 
 /*
  * Find or create a hashtable entry for the tuple group containing the
- * given tuple.
+ * given tuple.  If the hash table already holds hash_max_groups groups,
+ * no new entry is created, and NULL is returned if the group isn't there.
  *
  * When called, CurrentMemoryContext should be the per-query context.
  */
-static AggHashEntry
+static TupleHashEntry
 lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 {
 	TupleTableSlot *hashslot = aggstate->hashslot;
 	ListCell   *l;
-	AggHashEntry entry;
-	bool		isnew;
+	TupleHashEntry entry;
+	bool		isnew = false;
 
 	/* if first time through, initialize hashslot by cloning input slot */
 	if (hashslot->tts_tupleDescriptor == NULL)
@@ -946,19 +965,114 @@ lookup_hash_entry(AggState *aggstate, TupleTableSlot *inputslot)
 	}
 
 	/* find or create the hashtable entry using the filtered tuple */
-	entry = (AggHashEntry) LookupTupleHashEntry(aggstate->hashtable,
-												hashslot,
-												&isnew);
+	entry = LookupTupleHashEntry(aggstate->hashtable,
+								 hashslot,
+							aggstate->hash_ngroups < aggstate->hash_max_groups ?
+								 &isnew : NULL);
 
 	if (isnew)
 	{
 		/* initialize aggregates for new tuple group */
-		initialize_aggregates(aggstate, aggstate->peragg, entry->pergroup);
+		initialize_aggregates(aggstate, aggstate->peragg,
+							  (AggStatePerGroup) entry->additional);
+		aggstate->hash_ngroups++;
 	}
 
 	return entry;
 }
 
+/*
+ * Write an input tuple whose group didn't fit in the hash table to the
+ * appropriate spill file, creating the file if need be.
+ *
+ * The partition is chosen by the same hash of the grouping columns that
+ * the hash table uses, remixed with the current spill depth so that a batch
+ * that has to be spilled again gets divided up differently.
+ */
+static void
+agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	uint32		hashkey = 0;
+	int			partno;
+	int			i;
+
+	for (i = 0; i < node->numCols; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step, as execGrouping.c does */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, node->grpColIdx[i], &isNull);
+
+		if (!isNull)			/* treat nulls as having hash key 0 */
+			hashkey ^= DatumGetUInt32(FunctionCall1(&aggstate->hashfunctions[i],
+													attr));
+	}
+	partno = DatumGetUInt32(hash_uint32(hashkey ^ (uint32) aggstate->hash_depth)) %
+		HASHAGG_SPILL_PARTITIONS;
+
+	/* The spill files must survive resets of the aggcontext */
+	if (aggstate->hash_spill == NULL)
+		aggstate->hash_spill = (Tuplestorestate **)
+			MemoryContextAllocZero(aggstate->ss.ps.state->es_query_cxt,
+						HASHAGG_SPILL_PARTITIONS * sizeof(Tuplestorestate *));
+
+	if (aggstate->hash_spill[partno] == NULL)
+	{
+		MemoryContext oldcontext;
+
+		oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+		aggstate->hash_spill[partno] =
+			tuplestore_begin_heap(false, false,
+								  Max(work_mem / HASHAGG_SPILL_PARTITIONS, 64));
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	tuplestore_puttupleslot(aggstate->hash_spill[partno], slot);
+	aggstate->hash_spilled = true;
+}
+
+/*
+ * Release all spill files, both pending and in progress.
+ */
+static void
+agg_reset_spill(AggState *aggstate)
+{
+	ListCell   *l;
+	int			i;
+
+	if (aggstate->hash_input != NULL)
+		tuplestore_end(aggstate->hash_input);
+	aggstate->hash_input = NULL;
+
+	if (aggstate->hash_spill != NULL)
+	{
+		for (i = 0; i < HASHAGG_SPILL_PARTITIONS; i++)
+		{
+			if (aggstate->hash_spill[i] != NULL)
+				tuplestore_end(aggstate->hash_spill[i]);
+		}
+		pfree(aggstate->hash_spill);
+	}
+	aggstate->hash_spill = NULL;
+
+	foreach(l, aggstate->hash_batches)
+	{
+		AggSpillBatch *batch = (AggSpillBatch *) lfirst(l);
+
+		tuplestore_end(batch->tuples);
+		pfree(batch);
+	}
+	list_free(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_depth = 0;
+	aggstate->hash_spilled = false;
+}
+
 /*
  * ExecAgg -
  *
@@ -1214,13 +1328,17 @@ agg_retrieve_direct(AggState *aggstate)
 
 /*
  * ExecAgg for hashed case: phase 1, read input and build hash table
+ *
+ * The input is the outer plan, or a previously spilled batch if
+ * aggstate->hash_input is set.  Tuples of groups that don't fit in the
+ * table are spilled into new batches.
  */
 static void
 agg_fill_hash_table(AggState *aggstate)
 {
 	PlanState  *outerPlan;
 	ExprContext *tmpcontext;
-	AggHashEntry entry;
+	TupleHashEntry entry;
 	TupleTableSlot *outerslot;
 
 	/*
@@ -1236,27 +1354,104 @@ agg_fill_hash_table(AggState *aggstate)
 	 */
 	for (;;)
 	{
-		outerslot = ExecProcNode(outerPlan);
-		if (TupIsNull(outerslot))
-			break;
+		if (aggstate->hash_input != NULL)
+		{
+			outerslot = aggstate->hash_spillslot;
+			if (!tuplestore_gettupleslot(aggstate->hash_input, true, false,
+										 outerslot))
+				break;
+		}
+		else
+		{
+			outerslot = ExecProcNode(outerPlan);
+			if (TupIsNull(outerslot))
+				break;
+		}
 		/* set up for advance_aggregates call */
 		tmpcontext->ecxt_outertuple = outerslot;
 
 		/* Find or build hashtable entry for this tuple's group */
 		entry = lookup_hash_entry(aggstate, outerslot);
 
-		/* Advance the aggregates */
-		advance_aggregates(aggstate, entry->pergroup);
+		/* Advance the aggregates, or save the tuple for a later pass */
+		if (entry != NULL)
+			advance_aggregates(aggstate, (AggStatePerGroup) entry->additional);
+		else
+			agg_spill_tuple(aggstate, outerslot);
 
 		/* Reset per-input-tuple context after each tuple */
 		ResetExprContext(tmpcontext);
 	}
 
+	/* We're done with the input batch, if any */
+	if (aggstate->hash_input != NULL)
+	{
+		ExecClearTuple(aggstate->hash_spillslot);
+		tuplestore_end(aggstate->hash_input);
+		aggstate->hash_input = NULL;
+	}
+
+	/* Queue up whatever we spilled on this pass */
+	if (aggstate->hash_spill != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < HASHAGG_SPILL_PARTITIONS; i++)
+		{
+			AggSpillBatch *batch;
+
+			if (aggstate->hash_spill[i] == NULL)
+				continue;
+			batch = (AggSpillBatch *)
+				MemoryContextAlloc(aggstate->ss.ps.state->es_query_cxt,
+								   sizeof(AggSpillBatch));
+			batch->tuples = aggstate->hash_spill[i];
+			batch->depth = aggstate->hash_depth + 1;
+			aggstate->hash_batches = lappend(aggstate->hash_batches, batch);
+		}
+		pfree(aggstate->hash_spill);
+		aggstate->hash_spill = NULL;
+	}
+
 	aggstate->table_filled = true;
 	/* Initialize to walk the hash table */
 	ResetTupleHashIterator(aggstate->hashtable, &aggstate->hashiter);
 }
 
+/*
+ * Empty the hash table and refill it from the next spilled batch.
+ *
+ * Returns false if there are no more batches.
+ */
+static bool
+agg_refill_hash_table(AggState *aggstate)
+{
+	AggSpillBatch *batch;
+	MemoryContext oldcontext;
+
+	if (aggstate->hash_batches == NIL)
+		return false;
+
+	batch = (AggSpillBatch *) linitial(aggstate->hash_batches);
+	oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Forget the finished groups; see ExecReScanAgg */
+	ExecClearTuple(aggstate->ss.ss_ScanTupleSlot);
+	MemoryContextResetAndDeleteChildren(aggstate->aggcontext);
+	build_hash_table(aggstate);
+	aggstate->hash_ngroups = 0;
+
+	aggstate->hash_input = batch->tuples;
+	aggstate->hash_depth = batch->depth;
+	pfree(batch);
+
+	agg_fill_hash_table(aggstate);
+
+	return true;
+}
+
 /*
  * ExecAgg for hashed case: phase 2, retrieving groups from hash table
  */
@@ -1268,7 +1463,7 @@ agg_retrieve_hash_table(AggState *aggstate)
 	bool	   *aggnulls;
 	AggStatePerAgg peragg;
 	AggStatePerGroup pergroup;
-	AggHashEntry entry;
+	TupleHashEntry entry;
 	TupleTableSlot *firstSlot;
 	int			aggno;
 
@@ -1291,9 +1486,13 @@ agg_retrieve_hash_table(AggState *aggstate)
 		/*
 		 * Find the next entry in the hash table
 		 */
-		entry = (AggHashEntry) ScanTupleHashTable(&aggstate->hashiter);
+		entry = ScanTupleHashTable(aggstate->hashtable, &aggstate->hashiter);
 		if (entry == NULL)
 		{
+			/* Move on to the next spilled batch, if any */
+			if (agg_refill_hash_table(aggstate))
+				continue;
+
 			/* No more entries in hashtable, so done */
 			aggstate->agg_done = TRUE;
 			return NULL;
@@ -1308,11 +1507,11 @@ agg_retrieve_hash_table(AggState *aggstate)
 		 * Store the copied first input tuple in the tuple table slot reserved
 		 * for it, so that it can be used in ExecProject.
 		 */
-		ExecStoreMinimalTuple(entry->shared.firstTuple,
+		ExecStoreMinimalTuple(entry->firstTuple,
 							  firstSlot,
 							  false);
 
-		pergroup = entry->pergroup;
+		pergroup = (AggStatePerGroup) entry->additional;
 
 		/*
 		 * Finalize each aggregate calculation, and stash results in the
@@ -1401,6 +1600,14 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	aggstate->pergroup = NULL;
 	aggstate->grp_firstTuple = NULL;
 	aggstate->hashtable = NULL;
+	aggstate->hash_max_groups = 0;
+	aggstate->hash_ngroups = 0;
+	aggstate->hash_spilled = false;
+	aggstate->hash_depth = 0;
+	aggstate->hash_input = NULL;
+	aggstate->hash_spill = NULL;
+	aggstate->hash_batches = NIL;
+	aggstate->hash_spillslot = NULL;
 
 	/*
 	 * Create expression contexts.	We need two, one for per-input-tuple
@@ -1432,6 +1639,8 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	ExecInitScanTupleSlot(estate, &aggstate->ss);
 	ExecInitResultTupleSlot(estate, &aggstate->ss.ps);
 	aggstate->hashslot = ExecInitExtraTupleSlot(estate);
+	if (node->aggstrategy == AGG_HASHED)
+		aggstate->hash_spillslot = ExecInitExtraTupleSlot(estate);
 
 	/*
 	 * initialize child expressions
@@ -1697,6 +1906,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 		peraggstate->aggCollation = aggref->inputcollid;
 
+		InitFunctionCallInfoData(peraggstate->transfn_fcinfo,
+								 &peraggstate->transfn,
+								 numArguments + 1,
+								 peraggstate->aggCollation,
+								 (void *) aggstate, NULL);
+
 		get_typlenbyval(aggref->aggtype,
 						&peraggstate->resulttypeLen,
 						&peraggstate->resulttypeByVal);
@@ -1855,6 +2070,33 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 	/* Update numaggs to match number of unique aggregates found */
 	aggstate->numaggs = aggno + 1;
 
+	/*
+	 * Work out how many groups fit in work_mem, using the same estimate of
+	 * the space per group as the planner (see choose_hashed_grouping).
+	 */
+	if (node->aggstrategy == AGG_HASHED)
+	{
+		Size		entrysize;
+
+		ExecSetSlotDescriptor(aggstate->hash_spillslot,
+							  ExecGetResultType(outerPlanState(aggstate)));
+
+		entrysize = MAXALIGN(outerPlan(node)->plan_width) +
+			MAXALIGN(sizeof(MinimalTupleData)) +
+			hash_agg_entry_size(aggstate->numaggs);
+		for (aggno = 0; aggno < aggstate->numaggs; aggno++)
+		{
+			AggStatePerAgg peraggstate = &peragg[aggno];
+
+			/* as in count_agg_clauses, assume 32 bytes for varlenas */
+			if (!peraggstate->transtypeByVal)
+				entrysize += MAXALIGN(peraggstate->transtypeLen > 0 ?
+									  peraggstate->transtypeLen : 32);
+		}
+		aggstate->hash_max_groups = Max(work_mem * 1024L / (long) entrysize,
+										1);
+	}
+
 	return aggstate;
 }
 
@@ -1899,6 +2141,9 @@ ExecEndAgg(AggState *node)
 	/* clean up tuple table */
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
+	/* release any spill files */
+	agg_reset_spill(node);
+
 	MemoryContextDelete(node->aggcontext);
 
 	outerPlan = outerPlanState(node);
@@ -1929,13 +2174,17 @@ ExecReScanAgg(AggState *node)
 		/*
 		 * If we do have the hash table and the subplan does not have any
 		 * parameter changes, then we can just rescan the existing hash table;
-		 * no need to build it again.
+		 * no need to build it again.  That doesn't work if some groups had to
+		 * be spilled, though, since the table no longer holds them all.
 		 */
-		if (node->ss.ps.lefttree->chgParam == NULL)
+		if (node->ss.ps.lefttree->chgParam == NULL && !node->hash_spilled)
 		{
 			ResetTupleHashIterator(node->hashtable, &node->hashiter);
 			return;
 		}
+
+		agg_reset_spill(node);
+		node->hash_ngroups = 0;
 	}
 
 	/* Make sure we have closed any open tuplesorts */
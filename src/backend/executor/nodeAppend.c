@@ -17,6 +17,7 @@
  *		ExecAppend		- retrieve the next tuple from the node
  *		ExecEndAppend	- shut down the append node
  *		ExecReScanAppend - rescan the append node
+ *		ExecFindMatchingSubPlans - run-time partition pruning
  *
  *	 NOTES
  *		Each append node contains a list of one or more subplans which
@@ -53,14 +54,42 @@
  *			  nil	nil		 Scan	 Scan	  Scan	   Scan
  *							  |		  |		   |		|
  *							person employee student student-emp
+ *
+ *		When the children are range partitions (see catalog/partition.c)
+ *		and the query compares the partition key to a Param, the planner
+ *		can't tell which children will be needed, but leaves us a
+ *		PartitionPruneInfo so that we can.  If the Params are all supplied
+ *		with the query, we find the matching children once, at startup, and
+ *		never even initialize the others.  If some are set by the executor,
+ *		as in a correlated subquery, we redo the job at each rescan that
+ *		changes them, and skip the children found not to match.
+ *
+ *		Children that are foreign scans can be run asynchronously, if
+ *		their FDW supports it.  They are all started at the first call,
+ *		so that the remote servers work in parallel while we run the
+ *		other children; then we return their rows in whatever order
+ *		they arrive, waiting on all their connections at once.
  */
 
 #include "postgres.h"
 
+#include "access/heapam.h"
+#include "catalog/partition.h"
 #include "executor/execdebug.h"
 #include "executor/nodeAppend.h"
+#include "executor/nodeForeignscan.h"
+#include "foreign/fdwapi.h"
+#include "miscadmin.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
 
 static bool exec_append_initialize_next(AppendState *appendstate);
+static void exec_append_async_init(AppendState *appendstate);
+static void exec_append_async_start(AppendState *appendstate);
+static TupleTableSlot *exec_append_async_next(AppendState *appendstate);
+static int	oid_cmp(const void *p1, const void *p2);
 
 
 /* ----------------------------------------------------------------
@@ -120,9 +149,12 @@ AppendState *
 ExecInitAppend(Append *node, EState *estate, int eflags)
 {
 	AppendState *appendstate = makeNode(AppendState);
+	PartitionPruneInfo *pinfo = node->part_prune_info;
 	PlanState **appendplanstates;
+	bool	   *valid = NULL;
 	int			nplans;
 	int			i;
+	int			j;
 	ListCell   *lc;
 
 	/* check for unsupported flags */
@@ -146,9 +178,36 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	/*
 	 * Miscellaneous initialization
 	 *
-	 * Append plans don't have expression contexts because they never call
-	 * ExecQual or ExecProject.
+	 * Append plans don't call ExecQual or ExecProject, so they need an
+	 * expression context only to evaluate the run-time pruning expressions.
 	 */
+	if (pinfo != NULL)
+	{
+		ExecAssignExprContext(estate, &appendstate->ps);
+		appendstate->as_prune_exprs = (List *)
+			ExecInitExpr((Expr *) pinfo->exprs, &appendstate->ps);
+		valid = (bool *) palloc(nplans * sizeof(bool));
+
+		if (bms_is_empty(pinfo->execparams))
+		{
+			/*
+			 * The Params' values are known already, so we can leave out the
+			 * subplans that don't match altogether.  Keep at least one, so
+			 * that we have a result type and something for EXPLAIN to show.
+			 */
+			if (ExecFindMatchingSubPlans(pinfo, appendstate->as_prune_exprs,
+										 appendstate->ps.ps_ExprContext,
+										 valid) == 0)
+				valid[0] = true;
+		}
+		else
+		{
+			/* Initialize everything, and decide at the first ExecAppend */
+			memset(valid, true, nplans * sizeof(bool));
+			appendstate->as_valid = valid;
+			appendstate->as_prune_pending = true;
+		}
+	}
 
 	/*
 	 * append nodes still have Result slots, which hold pointers to tuples, so
@@ -161,13 +220,27 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 * results into the array "appendplans".
 	 */
 	i = 0;
+	j = 0;
 	foreach(lc, node->appendplans)
 	{
 		Plan	   *initNode = (Plan *) lfirst(lc);
 
+		/* Skip subplans pruned at startup */
+		if (valid && !appendstate->as_prune_pending && !valid[j++])
+			continue;
 		appendplanstates[i] = ExecInitNode(initNode, estate, eflags);
 		i++;
 	}
+	appendstate->as_nremoved = nplans - i;
+	appendstate->as_nplans = i;
+
+	/*
+	 * Get ready to run foreign scans asynchronously.  Not in EXPLAIN without
+	 * ANALYZE, nor while rechecking rows for EvalPlanQual, where the scans
+	 * just return the test tuple.
+	 */
+	if (!(eflags & EXEC_FLAG_EXPLAIN_ONLY) && estate->es_epqTuple == NULL)
+		exec_append_async_init(appendstate);
 
 	/*
 	 * initialize output tuple type
@@ -193,11 +266,40 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 TupleTableSlot *
 ExecAppend(AppendState *node)
 {
+	if (node->as_prune_pending)
+	{
+		PartitionPruneInfo *pinfo = ((Append *) node->ps.plan)->part_prune_info;
+
+		(void) ExecFindMatchingSubPlans(pinfo, node->as_prune_exprs,
+										node->ps.ps_ExprContext,
+										node->as_valid);
+		node->as_prune_pending = false;
+	}
+
+	if (node->as_async)
+	{
+		if (!node->as_async_started)
+			exec_append_async_start(node);
+		if (node->as_syncdone)
+			return exec_append_async_next(node);
+	}
+
 	for (;;)
 	{
 		PlanState  *subnode;
 		TupleTableSlot *result;
 
+		/*
+		 * If run-time pruning found that the current subplan can't produce
+		 * anything, don't bother to run it.
+		 */
+		if (node->as_valid && !node->as_valid[node->as_whichplan])
+			goto next_subplan;
+
+		/* Asynchronous subplans are read once the others are done */
+		if (node->as_async && node->as_async[node->as_whichplan])
+			goto next_subplan;
+
 		/*
 		 * figure out which subplan we are currently processing
 		 */
@@ -218,22 +320,161 @@ ExecAppend(AppendState *node)
 			return result;
 		}
 
+next_subplan:
+
 		/*
 		 * Go on to the "next" subplan in the appropriate direction. If no
-		 * more subplans, return the empty slot set up for us by
-		 * ExecInitAppend.
+		 * more subplans, return the rows of the asynchronous ones, if any,
+		 * else the empty slot set up for us by ExecInitAppend.
 		 */
 		if (ScanDirectionIsForward(node->ps.state->es_direction))
 			node->as_whichplan++;
 		else
 			node->as_whichplan--;
 		if (!exec_append_initialize_next(node))
+		{
+			if (node->as_async)
+			{
+				node->as_syncdone = true;
+				return exec_append_async_next(node);
+			}
 			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+		}
 
 		/* Else loop back and try to get a tuple from the new subplan */
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		exec_append_async_init
+ *
+ *		Allocates the state for running subplans asynchronously, if any
+ *		of them might be.
+ * ----------------------------------------------------------------
+ */
+static void
+exec_append_async_init(AppendState *appendstate)
+{
+	int			nplans = appendstate->as_nplans;
+	int			i;
+
+	for (i = 0; i < nplans; i++)
+	{
+		PlanState  *subnode = appendstate->appendplans[i];
+
+		if (IsA(subnode, ForeignScanState) &&
+			((ForeignScanState *) subnode)->fdwroutine->StartAsyncForeignScan)
+			break;
+	}
+	if (i == nplans)
+		return;
+
+	appendstate->as_async = (bool *) palloc0(nplans * sizeof(bool));
+	appendstate->as_asyncplans = (int *) palloc(nplans * sizeof(int));
+	appendstate->as_asyncsocks = (pgsocket *) palloc(nplans * sizeof(pgsocket));
+	appendstate->as_nasyncplans = 0;
+	appendstate->as_async_started = false;
+	appendstate->as_syncdone = false;
+}
+
+/* ----------------------------------------------------------------
+ *		exec_append_async_start
+ *
+ *		Starts the subplans that can run asynchronously, and marks them
+ *		so.  We can wait on only so many connections at once; any
+ *		further subplans are run the usual way.
+ * ----------------------------------------------------------------
+ */
+static void
+exec_append_async_start(AppendState *appendstate)
+{
+	int			i;
+
+	appendstate->as_nasyncplans = 0;
+	appendstate->as_nextasync = 0;
+	for (i = 0; i < appendstate->as_nplans; i++)
+	{
+		PlanState  *subnode = appendstate->appendplans[i];
+
+		appendstate->as_async[i] = false;
+		if (appendstate->as_valid && !appendstate->as_valid[i])
+			continue;
+		if (appendstate->as_nasyncplans >= MAX_WAIT_SOCKETS)
+			continue;
+		if (IsA(subnode, ForeignScanState) &&
+			ExecForeignScanStartAsync((ForeignScanState *) subnode))
+		{
+			appendstate->as_async[i] = true;
+			appendstate->as_asyncplans[appendstate->as_nasyncplans++] = i;
+		}
+	}
+	appendstate->as_async_started = true;
+}
+
+/* ----------------------------------------------------------------
+ *		exec_append_async_next
+ *
+ *		Returns the next row of any asynchronous subplan, waiting until
+ *		one has a row ready, or the empty slot if they're all finished.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+exec_append_async_next(AppendState *appendstate)
+{
+	for (;;)
+	{
+		int			nsocks = 0;
+		int			i = 0;
+
+		/*
+		 * Look for a subplan that can return a row without blocking.  We
+		 * start with the one we last returned a row from, so that each
+		 * batch of rows is consumed before moving on to the next subplan.
+		 */
+		while (i < appendstate->as_nasyncplans)
+		{
+			int			k;
+			PlanState  *subnode;
+			pgsocket	sock;
+			TupleTableSlot *result;
+
+			k = (appendstate->as_nextasync + i) % appendstate->as_nasyncplans;
+			subnode = appendstate->appendplans[appendstate->as_asyncplans[k]];
+			sock = ExecForeignScanPollAsync((ForeignScanState *) subnode);
+			if (sock != PGINVALID_SOCKET)
+			{
+				appendstate->as_asyncsocks[nsocks++] = sock;
+				i++;
+				continue;
+			}
+
+			result = ExecProcNode(subnode);
+			if (!TupIsNull(result))
+			{
+				appendstate->as_nextasync = k;
+				return result;
+			}
+
+			/* This subplan is finished; forget it and look again */
+			appendstate->as_asyncplans[k] =
+				appendstate->as_asyncplans[--appendstate->as_nasyncplans];
+			appendstate->as_nextasync = 0;
+			nsocks = 0;
+			i = 0;
+		}
+
+		if (appendstate->as_nasyncplans == 0)
+			return ExecClearTuple(appendstate->ps.ps_ResultTupleSlot);
+
+		/* Sleep until some rows arrive, or we're interrupted */
+		(void) WaitLatchOrSockets(&MyProc->procLatch,
+								  WL_LATCH_SET | WL_SOCKET_READABLE,
+								  appendstate->as_asyncsocks, nsocks, -1);
+		ResetLatch(&MyProc->procLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndAppend
  *
@@ -267,6 +508,15 @@ ExecReScanAppend(AppendState *node)
 {
 	int			i;
 
+	/*
+	 * If any Param the pruning expressions use has changed, we must
+	 * reconsider which subplans to run.
+	 */
+	if (node->as_valid &&
+		bms_overlap(node->ps.chgParam,
+					((Append *) node->ps.plan)->part_prune_info->execparams))
+		node->as_prune_pending = true;
+
 	for (i = 0; i < node->as_nplans; i++)
 	{
 		PlanState  *subnode = node->appendplans[i];
@@ -287,4 +537,127 @@ ExecReScanAppend(AppendState *node)
 	}
 	node->as_whichplan = 0;
 	exec_append_initialize_next(node);
+
+	/* Start the asynchronous subplans anew at the next call */
+	if (node->as_async)
+	{
+		node->as_async_started = false;
+		node->as_syncdone = false;
+		node->as_nasyncplans = 0;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecFindMatchingSubPlans
+ *
+ *		Work out which subplans of an Append or MergeAppend can produce
+ *		any rows, given the current values of the Params in the run-time
+ *		pruning expressions.  valid[i] is set according to whether the i'th
+ *		subplan of the plan matches; the number of matches is returned.
+ * ----------------------------------------------------------------
+ */
+int
+ExecFindMatchingSubPlans(PartitionPruneInfo *pinfo, List *exprstates,
+						 ExprContext *econtext, bool *valid)
+{
+	int			nplans = list_length(pinfo->subplan_oids);
+	int			nexprs = list_length(exprstates);
+	int			nvalid = nplans;
+	Datum	   *values;
+	Relation	rel;
+	PartitionDesc pdesc;
+	MemoryContext oldcontext;
+	PartitionRange range;
+	Oid		   *excluded;
+	int			nexcluded;
+	ListCell   *lc;
+	int			i;
+
+	ResetExprContext(econtext);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	/*
+	 * Evaluate the expressions before looking at the partition descriptor,
+	 * since evaluating them could process invalidations and so free it.
+	 */
+	values = (Datum *) palloc(nexprs * sizeof(Datum));
+	i = 0;
+	foreach(lc, exprstates)
+	{
+		ExprState  *exprstate = (ExprState *) lfirst(lc);
+		bool		isnull;
+
+		values[i++] = ExecEvalExpr(exprstate, econtext, &isnull, NULL);
+
+		/* The operators are strict, so a null matches nothing at all */
+		if (isnull)
+		{
+			MemoryContextSwitchTo(oldcontext);
+			memset(valid, false, nplans * sizeof(bool));
+			return 0;
+		}
+	}
+
+	memset(valid, true, nplans * sizeof(bool));
+
+	/* The parent was locked at executor startup */
+	rel = heap_open(pinfo->relid, NoLock);
+
+	/*
+	 * The descriptor can only have gone away if the children's constraints
+	 * changed, and then the plan will be replanned next time; meanwhile,
+	 * just run everything.
+	 */
+	pdesc = RelationGetPartitionDesc(rel);
+	if (pdesc != NULL)
+	{
+		range.lower.infinite = true;
+		range.lower.inclusive = false;
+		range.upper.infinite = true;
+		range.upper.inclusive = false;
+		i = 0;
+		foreach(lc, pinfo->strategies)
+		{
+			partition_range_restrict(pdesc, &range, lfirst_int(lc),
+									 values[i]);
+			i++;
+		}
+
+		excluded = get_partitions_excluded_by_range(pdesc, &range,
+													&nexcluded);
+
+		i = 0;
+		foreach(lc, pinfo->subplan_oids)
+		{
+			Oid			childoid = lfirst_oid(lc);
+
+			if (nexcluded > 0 &&
+				bsearch(&childoid, excluded, nexcluded, sizeof(Oid),
+						oid_cmp) != NULL)
+			{
+				valid[i] = false;
+				nvalid--;
+			}
+			i++;
+		}
+	}
+
+	heap_close(rel, NoLock);
+	MemoryContextSwitchTo(oldcontext);
+
+	return nvalid;
+}
+
+/* qsort/bsearch comparator for OIDs */
+static int
+oid_cmp(const void *p1, const void *p2)
+{
+	Oid			v1 = *((const Oid *) p1);
+	Oid			v2 = *((const Oid *) p2);
+
+	if (v1 < v2)
+		return -1;
+	if (v1 > v2)
+		return 1;
+	return 0;
 }
@@ -19,6 +19,8 @@
  *		ExecInitForeignScan		creates and initializes state info.
  *		ExecReScanForeignScan	rescans the foreign relation.
  *		ExecEndForeignScan		releases any resources allocated.
+ *		ExecForeignScanStartAsync	starts an asynchronous scan.
+ *		ExecForeignScanPollAsync	checks whether rows are ready.
  */
 #include "postgres.h"
 
@@ -141,16 +143,25 @@ ExecInitForeignScan(ForeignScan *node, EState *estate, int eflags)
 	ExecInitScanTupleSlot(estate, &scanstate->ss);
 
 	/*
-	 * open the base relation and acquire appropriate lock on it.
+	 * open the base relation and acquire appropriate lock on it, and get the
+	 * scan type from the relation descriptor.  A scan that computes a join
+	 * or a grouped result remotely has no relation of its own; its scan
+	 * tuples are described by fdw_scan_tlist instead.
 	 */
-	currentRelation = ExecOpenScanRelation(estate, node->scan.scanrelid);
+	if (node->scan.scanrelid > 0)
+	{
+		currentRelation = ExecOpenScanRelation(estate, node->scan.scanrelid);
+		ExecAssignScanType(&scanstate->ss,
+						   RelationGetDescr(currentRelation));
+	}
+	else
+	{
+		currentRelation = NULL;
+		ExecAssignScanType(&scanstate->ss,
+						   ExecTypeFromTL(node->fdw_scan_tlist, false));
+	}
 	scanstate->ss.ss_currentRelation = currentRelation;
 
-	/*
-	 * get the scan type from the relation descriptor.
-	 */
-	ExecAssignScanType(&scanstate->ss, RelationGetDescr(currentRelation));
-
 	/*
 	 * Initialize result tuple type and projection info.
 	 */
@@ -160,7 +171,7 @@ ExecInitForeignScan(ForeignScan *node, EState *estate, int eflags)
 	/*
 	 * Acquire function pointers from the FDW's handler, and init fdw_state.
 	 */
-	fdwroutine = GetFdwRoutineByRelId(RelationGetRelid(currentRelation));
+	fdwroutine = GetFdwRoutineByServerId(node->fs_server);
 	scanstate->fdwroutine = fdwroutine;
 	scanstate->fdw_state = NULL;
 
@@ -191,8 +202,9 @@ ExecEndForeignScan(ForeignScanState *node)
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 	ExecClearTuple(node->ss.ss_ScanTupleSlot);
 
-	/* close the relation. */
-	ExecCloseScanRelation(node->ss.ss_currentRelation);
+	/* close the relation, if we opened one. */
+	if (node->ss.ss_currentRelation)
+		ExecCloseScanRelation(node->ss.ss_currentRelation);
 }
 
 /* ----------------------------------------------------------------
@@ -208,3 +220,37 @@ ExecReScanForeignScan(ForeignScanState *node)
 
 	ExecScanReScan(&node->ss);
 }
+
+/* ----------------------------------------------------------------
+ *		ExecForeignScanStartAsync
+ *
+ *		Asks the FDW to start the scan without waiting for its rows.
+ *		Returns false if the scan must be run synchronously instead.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecForeignScanStartAsync(ForeignScanState *node)
+{
+	if (node->fdwroutine->StartAsyncForeignScan == NULL)
+		return false;
+
+	/* Do any rescan that ExecProcNode would have done first */
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	return node->fdwroutine->StartAsyncForeignScan(node);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecForeignScanPollAsync
+ *
+ *		Returns PGINVALID_SOCKET if ExecForeignScan can be called
+ *		without blocking, else the socket to wait on before trying
+ *		again.
+ * ----------------------------------------------------------------
+ */
+pgsocket
+ExecForeignScanPollAsync(ForeignScanState *node)
+{
+	return node->fdwroutine->PollAsyncForeignScan(node);
+}
@@ -46,6 +46,10 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 						int bucketNumber);
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
+static void ExecHashBloomAdd(HashJoinTable hashtable, uint32 hashvalue);
+static void ExecHashBloomFinish(HashJoinTable hashtable);
+static void *dense_alloc(HashJoinTable hashtable, Size size);
+
 
 /* ----------------------------------------------------------------
  *		ExecHash
@@ -109,6 +113,9 @@ MultiExecHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (hashtable->bloomFilter != NULL)
+				ExecHashBloomAdd(hashtable, hashvalue);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -125,6 +132,10 @@ MultiExecHash(HashState *node)
 		}
 	}
 
+	/* drop the bloom filter again if it won't reject much */
+	if (hashtable->bloomFilter != NULL)
+		ExecHashBloomFinish(hashtable);
+
 	/* must provide our own instrumentation support */
 	if (node->ps.instrument)
 		InstrStopNode(node->ps.instrument, hashtable->totalTuples);
@@ -292,6 +303,10 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
+	hashtable->chunks = NULL;
+	hashtable->bloomFilter = NULL;
+	hashtable->bloomMask = 0;
+	hashtable->bloomShift = 0;
 
 	/*
 	 * Get info about the hash functions to be used for each hash key. Also
@@ -553,10 +568,10 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	int			oldnbatch = hashtable->nbatch;
 	int			curbatch = hashtable->curbatch;
 	int			nbatch;
-	int			i;
 	MemoryContext oldcxt;
 	long		ninmemory;
 	long		nfreed;
+	HashMemoryChunk oldchunks;
 
 	/* do nothing if we've decided to shut off growth */
 	if (!hashtable->growEnabled)
@@ -605,55 +620,70 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 
 	/*
 	 * Scan through the existing hash table entries and dump out any that are
-	 * no longer of the current batch.
+	 * no longer of the current batch.  Rather than following the bucket
+	 * chains, we walk the dense-allocated chunks, so the tuples are visited
+	 * in memory order; the ones we keep are copied into fresh chunks and the
+	 * old chunks are freed as we go.  That also compacts away the space the
+	 * dumped tuples occupied.
 	 */
 	ninmemory = nfreed = 0;
 
-	for (i = 0; i < hashtable->nbuckets; i++)
-	{
-		HashJoinTuple prevtuple;
-		HashJoinTuple tuple;
+	/* we're going to rebuild all the bucket chains from scratch */
+	memset(hashtable->buckets, 0, sizeof(HashJoinTuple) * hashtable->nbuckets);
 
-		prevtuple = NULL;
-		tuple = hashtable->buckets[i];
+	oldchunks = hashtable->chunks;
+	hashtable->chunks = NULL;
 
-		while (tuple != NULL)
+	while (oldchunks != NULL)
+	{
+		HashMemoryChunk nextchunk = oldchunks->next;
+		size_t		idx = 0;
+
+		/* position within the buffer (up to oldchunks->used) */
+		while (idx < oldchunks->used)
 		{
-			/* save link in case we delete */
-			HashJoinTuple nexttuple = tuple->next;
+			HashJoinTuple hashTuple = (HashJoinTuple) (oldchunks->data + idx);
+			MinimalTuple tuple = HJTUPLE_MINTUPLE(hashTuple);
+			int			hashTupleSize = (HJTUPLE_OVERHEAD + tuple->t_len);
 			int			bucketno;
 			int			batchno;
 
 			ninmemory++;
-			ExecHashGetBucketAndBatch(hashtable, tuple->hashvalue,
+			ExecHashGetBucketAndBatch(hashtable, hashTuple->hashvalue,
 									  &bucketno, &batchno);
-			Assert(bucketno == i);
+
 			if (batchno == curbatch)
 			{
-				/* keep tuple */
-				prevtuple = tuple;
+				/* keep tuple in memory - copy it into the new chunk */
+				HashJoinTuple copyTuple;
+
+				copyTuple = (HashJoinTuple) dense_alloc(hashtable,
+														hashTupleSize);
+				memcpy(copyTuple, hashTuple, hashTupleSize);
+
+				/* and add it back to the appropriate bucket */
+				copyTuple->next = hashtable->buckets[bucketno];
+				hashtable->buckets[bucketno] = copyTuple;
 			}
 			else
 			{
 				/* dump it out */
 				Assert(batchno > curbatch);
-				ExecHashJoinSaveTuple(HJTUPLE_MINTUPLE(tuple),
-									  tuple->hashvalue,
+				ExecHashJoinSaveTuple(HJTUPLE_MINTUPLE(hashTuple),
+									  hashTuple->hashvalue,
 									  &hashtable->innerBatchFile[batchno]);
-				/* and remove from hash table */
-				if (prevtuple)
-					prevtuple->next = nexttuple;
-				else
-					hashtable->buckets[i] = nexttuple;
-				/* prevtuple doesn't change */
-				hashtable->spaceUsed -=
-					HJTUPLE_OVERHEAD + HJTUPLE_MINTUPLE(tuple)->t_len;
-				pfree(tuple);
+
+				hashtable->spaceUsed -= hashTupleSize;
 				nfreed++;
 			}
 
-			tuple = nexttuple;
+			/* next tuple in this chunk */
+			idx += MAXALIGN(hashTupleSize);
 		}
+
+		/* we're done with this chunk - free it and proceed to the next one */
+		pfree(oldchunks);
+		oldchunks = nextchunk;
 	}
 
 #ifdef HJDEBUG
@@ -714,8 +744,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 
 		/* Create the HashJoinTuple */
 		hashTupleSize = HJTUPLE_OVERHEAD + tuple->t_len;
-		hashTuple = (HashJoinTuple) MemoryContextAlloc(hashtable->batchCxt,
-													   hashTupleSize);
+		hashTuple = (HashJoinTuple) dense_alloc(hashtable, hashTupleSize);
 		hashTuple->hashvalue = hashvalue;
 		memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
 
@@ -1065,6 +1094,9 @@ ExecHashTableReset(HashJoinTable hashtable)
 	hashtable->spaceUsed = 0;
 
 	MemoryContextSwitchTo(oldcxt);
+
+	/* Forget the chunks (the memory was freed by the context reset above). */
+	hashtable->chunks = NULL;
 }
 
 /*
@@ -1407,8 +1439,19 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 		if (batchno == hashtable->curbatch)
 		{
 			/* Move the tuple to the main hash table */
-			hashTuple->next = hashtable->buckets[bucketno];
-			hashtable->buckets[bucketno] = hashTuple;
+			HashJoinTuple copyTuple;
+
+			/*
+			 * We must copy the tuple into the dense storage, else it will not
+			 * be found by, eg, ExecHashIncreaseNumBatches.
+			 */
+			copyTuple = (HashJoinTuple) dense_alloc(hashtable, tupleSize);
+			memcpy(copyTuple, hashTuple, tupleSize);
+			pfree(hashTuple);
+
+			copyTuple->next = hashtable->buckets[bucketno];
+			hashtable->buckets[bucketno] = copyTuple;
+
 			/* We have reduced skew space, but overall space doesn't change */
 			hashtable->spaceUsedSkew -= tupleSize;
 		}
@@ -1459,3 +1502,185 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 		hashtable->spaceUsedSkew = 0;
 	}
 }
+
+/*
+ * Allocate 'size' bytes from the currently active HashMemoryChunk
+ */
+static void *
+dense_alloc(HashJoinTable hashtable, Size size)
+{
+	HashMemoryChunk newChunk;
+	char	   *ptr;
+
+	/* just in case the size is not already aligned properly */
+	size = MAXALIGN(size);
+
+	/*
+	 * If tuple size is larger than of 1/4 of chunk size, allocate a separate
+	 * chunk.
+	 */
+	if (size > HASH_CHUNK_THRESHOLD)
+	{
+		/* allocate new chunk and put it at the beginning of the list */
+		newChunk = (HashMemoryChunk) MemoryContextAlloc(hashtable->batchCxt,
+								 offsetof(HashMemoryChunkData, data) + size);
+		newChunk->maxlen = size;
+		newChunk->used = 0;
+		newChunk->ntuples = 0;
+
+		/*
+		 * Add this chunk to the list after the first existing chunk, so that
+		 * we don't lose the remaining space in the "current" chunk.
+		 */
+		if (hashtable->chunks != NULL)
+		{
+			newChunk->next = hashtable->chunks->next;
+			hashtable->chunks->next = newChunk;
+		}
+		else
+		{
+			newChunk->next = hashtable->chunks;
+			hashtable->chunks = newChunk;
+		}
+
+		newChunk->used += size;
+		newChunk->ntuples += 1;
+
+		return newChunk->data;
+	}
+
+	/*
+	 * See if we have enough space for it in the current chunk (if any). If
+	 * not, allocate a fresh chunk.
+	 */
+	if ((hashtable->chunks == NULL) ||
+		(hashtable->chunks->maxlen - hashtable->chunks->used) < size)
+	{
+		/* allocate new chunk and put it at the beginning of the list */
+		newChunk = (HashMemoryChunk) MemoryContextAlloc(hashtable->batchCxt,
+					  offsetof(HashMemoryChunkData, data) + HASH_CHUNK_SIZE);
+
+		newChunk->maxlen = HASH_CHUNK_SIZE;
+		newChunk->used = size;
+		newChunk->ntuples = 1;
+
+		newChunk->next = hashtable->chunks;
+		hashtable->chunks = newChunk;
+
+		return newChunk->data;
+	}
+
+	/* There is enough space in the current chunk, let's add the tuple */
+	ptr = hashtable->chunks->data + hashtable->chunks->used;
+	hashtable->chunks->used += size;
+	hashtable->chunks->ntuples += 1;
+
+	/* return pointer to the start of the tuple memory */
+	return ptr;
+}
+
+/*
+ * Bloom filter support
+ *
+ * For joins that don't have to return unmatched outer tuples, the hash
+ * join asks us to build a bloom filter over the hash values of the inner
+ * tuples while we load the table.  An outer tuple whose hash value isn't in
+ * the filter can't have a match, so the join discards it right after
+ * computing its hash value, without scanning a bucket or, more importantly,
+ * writing it out to a batch file.  This pays off mainly when the inner side
+ * is small and selective compared to the outer side.
+ *
+ * The filter uses two bits per hash value: the low-order bits of the hash
+ * value itself, and the high-order bits of a multiplicative rehash of it.
+ * We size it for about 8 bits per expected inner tuple, which gives a false
+ * positive rate of a few percent, but limit its size to a small fraction of
+ * work_mem.
+ */
+#define BLOOM_BITS_PER_TUPLE	8
+#define BLOOM_MIN_BITS			1024
+
+void
+ExecHashBloomInit(HashJoinTable hashtable, double ntuples)
+{
+	double		nbits;
+	double		maxbits;
+	int			log2_nbits;
+
+	nbits = Max(ntuples * BLOOM_BITS_PER_TUPLE, BLOOM_MIN_BITS);
+	/* at most 1/16th of work_mem, and comfortably within MaxAllocSize */
+	maxbits = Min(hashtable->spaceAllowed / 16, MaxAllocSize / 2) * BITS_PER_BYTE;
+	if (nbits > maxbits)
+		nbits = maxbits;
+	if (nbits < BLOOM_MIN_BITS)
+		return;
+	for (log2_nbits = 10; log2_nbits < 31; log2_nbits++)
+	{
+		if (((double) ((uint32) 1 << (log2_nbits + 1))) > nbits)
+			break;
+	}
+
+	hashtable->bloomFilter = (uint32 *)
+		MemoryContextAllocZero(hashtable->hashCxt,
+							   ((Size) 1 << log2_nbits) / BITS_PER_BYTE);
+	hashtable->bloomMask = ((uint32) 1 << log2_nbits) - 1;
+	hashtable->bloomShift = 32 - log2_nbits;
+}
+
+static void
+ExecHashBloomAdd(HashJoinTable hashtable, uint32 hashvalue)
+{
+	uint32		bit1 = hashvalue & hashtable->bloomMask;
+	uint32		bit2 = (hashvalue * 0x9E3779B1) >> hashtable->bloomShift;
+
+	hashtable->bloomFilter[bit1 / 32] |= (uint32) 1 << (bit1 % 32);
+	hashtable->bloomFilter[bit2 / 32] |= (uint32) 1 << (bit2 % 32);
+}
+
+/*
+ * Could an outer tuple with this hash value have a match?
+ */
+bool
+ExecHashBloomMayMatch(HashJoinTable hashtable, uint32 hashvalue)
+{
+	uint32		bit1;
+	uint32		bit2;
+
+	if (hashtable->bloomFilter == NULL)
+		return true;
+
+	bit1 = hashvalue & hashtable->bloomMask;
+	bit2 = (hashvalue * 0x9E3779B1) >> hashtable->bloomShift;
+
+	return (hashtable->bloomFilter[bit1 / 32] & ((uint32) 1 << (bit1 % 32))) != 0 &&
+		(hashtable->bloomFilter[bit2 / 32] & ((uint32) 1 << (bit2 % 32))) != 0;
+}
+
+/*
+ * Once the inner side is loaded, see whether the filter is selective enough
+ * to be worth checking.  If more than half its bits are set (because the
+ * planner underestimated the inner side, say) most outer tuples would pass
+ * anyway, so just get rid of it.
+ */
+static void
+ExecHashBloomFinish(HashJoinTable hashtable)
+{
+	uint32		nwords = (hashtable->bloomMask + 1) / 32;
+	uint32		nset = 0;
+	uint32		i;
+
+	for (i = 0; i < nwords; i++)
+	{
+		uint32		w = hashtable->bloomFilter[i];
+
+		/* count the set bits in w */
+		w = w - ((w >> 1) & 0x55555555);
+		w = (w & 0x33333333) + ((w >> 2) & 0x33333333);
+		nset += (((w + (w >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+	}
+
+	if (nset > (hashtable->bloomMask + 1) / 2)
+	{
+		pfree(hashtable->bloomFilter);
+		hashtable->bloomFilter = NULL;
+	}
+}
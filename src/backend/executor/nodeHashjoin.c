@@ -170,6 +170,15 @@ ExecHashJoin(HashJoinState *node)
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
 
+				/*
+				 * Unless we must return unmatched outer tuples, have the
+				 * Hash node build a bloom filter we can use to discard outer
+				 * tuples early.
+				 */
+				if (!HJ_FILL_OUTER(node))
+					ExecHashBloomInit(hashtable,
+									  outerPlan(hashNode->ps.plan)->plan_rows);
+
 				/*
 				 * execute the Hash node, to build the hash table
 				 */
@@ -305,10 +314,11 @@ ExecHashJoin(HashJoinState *node)
 					}
 
 					/*
-					 * In a semijoin, we'll consider returning the first
-					 * match, but after that we're done with this outer tuple.
+					 * If we only need to join to the first matching inner
+					 * tuple, then consider returning this one, but after
+					 * that continue with next outer tuple.
 					 */
-					if (node->js.jointype == JOIN_SEMI)
+					if (node->js.single_match)
 						node->hj_JoinState = HJ_NEED_NEW_OUTER;
 
 					if (otherqual == NIL ||
@@ -468,6 +478,8 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 		ExecInitExpr((Expr *) node->join.plan.qual,
 					 (PlanState *) hjstate);
 	hjstate->js.jointype = node->join.jointype;
+	hjstate->js.single_match = (node->join.inner_unique ||
+								node->join.jointype == JOIN_SEMI);
 	hjstate->js.joinqual = (List *)
 		ExecInitExpr((Expr *) node->join.joinqual,
 					 (PlanState *) hjstate);
@@ -680,12 +692,19 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 				/* remember outer relation is not empty for possible rescan */
 				hjstate->hj_OuterNotEmpty = true;
 
-				return slot;
+				/*
+				 * The bloom filter, if any, can tell us the tuple has no
+				 * match without probing the table.  It's only built when we
+				 * don't need unmatched outer tuples.
+				 */
+				if (ExecHashBloomMayMatch(hashtable, *hashvalue))
+					return slot;
 			}
 
 			/*
-			 * That tuple couldn't match because of a NULL, so discard it and
-			 * continue with the next one.
+			 * That tuple couldn't match because of a NULL, or because it's
+			 * not in the bloom filter, so discard it and continue with the
+			 * next one.
 			 */
 			slot = ExecProcNode(outerNode);
 		}
@@ -875,8 +894,14 @@ ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 
 	if (file == NULL)
 	{
-		/* First write to this batch file, so open it. */
-		file = BufFileCreateTemp(false);
+		/*
+		 * First write to this batch file, so open it.  Batch files are only
+		 * ever rewound and read through once, so they can be compressed.
+		 */
+		if (temp_file_compression)
+			file = BufFileCreateCompressedTemp(false);
+		else
+			file = BufFileCreateTemp(false);
 		*fileptr = file;
 	}
 
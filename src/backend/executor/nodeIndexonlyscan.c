@@ -118,8 +118,9 @@ IndexOnlyNext(IndexOnlyScanState *node)
 
 		/*
 		 * If the index was lossy, we have to recheck the index quals.
-		 * (Currently, this can never happen, but we should support the case
-		 * for possible future use, eg with GiST indexes.)
+		 * This can happen with GiST indexes, whose Consistent methods may
+		 * report a match that has to be confirmed against the original value
+		 * reconstructed by the Fetch method.
 		 */
 		if (scandesc->xs_recheck)
 		{
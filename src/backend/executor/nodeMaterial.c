@@ -18,12 +18,80 @@
  *		ExecInitMaterial		- initialize node and subnodes
  *		ExecEndMaterial			- shutdown node and subnodes
  *
+ * NOTES
+ *		On the inner side of a parameterized nestloop, a Material node can
+ *		instead cache the subplan's results per distinct set of values of
+ *		the nestloop parameters (Material.cacheKeys).  Each rescan looks up
+ *		the current values in a hash table; a complete entry is replayed
+ *		without running the subplan at all, otherwise the subplan is run and
+ *		its output copied into the entry as it is returned.  The entries are
+ *		kept in least-recently-used order, and the oldest are thrown away to
+ *		keep the cache within work_mem; if the output of a single scan won't
+ *		fit, it is passed through without being cached.
  */
 #include "postgres.h"
 
 #include "executor/executor.h"
 #include "executor/nodeMaterial.h"
+#include "lib/dllist.h"
 #include "miscadmin.h"
+#include "utils/memutils.h"
+
+
+typedef struct MaterialCacheEntryData *MaterialCacheEntry;
+
+/*
+ * This is the additional data of a hash table entry, which unlike the entry
+ * itself stays put as other entries come and go.
+ */
+typedef struct MaterialCacheEntryData
+{
+	MinimalTuple key;			/* the hash table entry's firstTuple */
+	Dlelem		lru;			/* links in the LRU list */
+	List	   *tuples;			/* the subplan's output, as MinimalTuples */
+	bool		complete;		/* did the subplan run to the end? */
+	Size		size;			/* memory charged to this entry */
+} MaterialCacheEntryData;
+
+typedef enum
+{
+	MATCACHE_LOOKUP,			/* must look up the current key first */
+	MATCACHE_REPLAY,			/* returning the tuples of a cached entry */
+	MATCACHE_FILL,				/* reading the subplan into a new entry */
+	MATCACHE_BYPASS,			/* reading the subplan without caching */
+	MATCACHE_DONE				/* returned everything for this key */
+} MaterialCacheStatus;
+
+typedef struct MaterialCacheData
+{
+	int			numKeys;
+	List	   *keyexprs;		/* ExprStates computing the key values */
+	Bitmapset  *keyparams;		/* paramids of the keys */
+	AttrNumber *keyColIdx;		/* 1..numKeys, for the hash table */
+	FmgrInfo   *eqfunctions;	/* per-key equality functions */
+	FmgrInfo   *hashfunctions;	/* per-key hash functions */
+	TupleTableSlot *keyslot;	/* holds the current key values */
+	TupleTableSlot *evictslot;	/* holds the key of an entry to evict */
+	long		nbuckets;		/* initial hash table size */
+	MemoryContext tablecxt;		/* holds the hash table and its entries */
+	TupleHashTable hashtable;
+	Dllist		lru;			/* entries, most recently used first */
+	Size		mem_used;		/* memory charged to entries */
+	Size		mem_limit;		/* ... and the most we'll allow */
+	MaterialCacheStatus status;
+	MaterialCacheEntry entry;	/* entry being replayed or filled */
+	ListCell   *next;			/* next tuple of it to replay */
+	bool		subplan_used;	/* subplan read since its last rescan? */
+} MaterialCacheData;
+
+static MaterialCache material_cache_create(MaterialState *node,
+					  Material *plan);
+static void material_cache_build(MaterialState *node);
+static void material_cache_lookup(MaterialState *node);
+static void material_cache_store(MaterialState *node, TupleTableSlot *slot);
+static void material_cache_evict(MaterialState *node,
+					 MaterialCacheEntry entry);
+static TupleTableSlot *ExecMaterialCached(MaterialState *node);
 
 /* ----------------------------------------------------------------
  *		ExecMaterial
@@ -45,6 +113,9 @@ ExecMaterial(MaterialState *node)
 	bool		eof_tuplestore;
 	TupleTableSlot *slot;
 
+	if (node->cache != NULL)
+		return ExecMaterialCached(node);
+
 	/*
 	 * get state info from node
 	 */
@@ -155,6 +226,289 @@ ExecMaterial(MaterialState *node)
 	return ExecClearTuple(slot);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecMaterialCached
+ *
+ *		Return the next tuple for the current cache key, either from the
+ *		cache or from the subplan.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecMaterialCached(MaterialState *node)
+{
+	MaterialCache cache = node->cache;
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+	TupleTableSlot *outerslot;
+
+	if (cache->status == MATCACHE_LOOKUP)
+		material_cache_lookup(node);
+
+	switch (cache->status)
+	{
+		case MATCACHE_REPLAY:
+			if (cache->next != NULL)
+			{
+				ExecStoreMinimalTuple((MinimalTuple) lfirst(cache->next),
+									  slot, false);
+				cache->next = lnext(cache->next);
+				return slot;
+			}
+			cache->status = MATCACHE_DONE;
+			break;
+
+		case MATCACHE_FILL:
+		case MATCACHE_BYPASS:
+			cache->subplan_used = true;
+			outerslot = ExecProcNode(outerPlanState(node));
+			if (TupIsNull(outerslot))
+			{
+				if (cache->status == MATCACHE_FILL)
+					cache->entry->complete = true;
+				cache->status = MATCACHE_DONE;
+				break;
+			}
+			if (cache->status == MATCACHE_FILL)
+				material_cache_store(node, outerslot);
+			return outerslot;
+
+		case MATCACHE_DONE:
+			break;
+
+		default:
+			elog(ERROR, "unrecognized material cache status: %d",
+				 (int) cache->status);
+	}
+
+	return ExecClearTuple(slot);
+}
+
+/*
+ * Set up the cache of a caching Material node.
+ */
+static MaterialCache
+material_cache_create(MaterialState *node, Material *plan)
+{
+	EState	   *estate = node->ss.ps.state;
+	MaterialCache cache;
+	TupleDesc	keydesc;
+	ListCell   *lc;
+	int			i;
+
+	cache = (MaterialCache) palloc0(sizeof(MaterialCacheData));
+	cache->numKeys = plan->numCacheKeys;
+	cache->keyexprs = (List *) ExecInitExpr((Expr *) plan->cacheKeys,
+											(PlanState *) node);
+	foreach(lc, plan->cacheKeys)
+	{
+		Param	   *param = (Param *) lfirst(lc);
+
+		Assert(IsA(param, Param) && param->paramkind == PARAM_EXEC);
+		cache->keyparams = bms_add_member(cache->keyparams, param->paramid);
+	}
+
+	cache->keyColIdx = (AttrNumber *) palloc(cache->numKeys * sizeof(AttrNumber));
+	for (i = 0; i < cache->numKeys; i++)
+		cache->keyColIdx[i] = i + 1;
+	execTuplesHashPrepare(cache->numKeys, plan->cacheEqOperators,
+						  &cache->eqfunctions, &cache->hashfunctions);
+
+	keydesc = ExecTypeFromExprList(plan->cacheKeys);
+	cache->keyslot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(cache->keyslot, keydesc);
+	cache->evictslot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(cache->evictslot, keydesc);
+
+	cache->nbuckets = Max(plan->numCacheEntries, 1);
+	cache->mem_limit = work_mem * 1024L;
+	cache->tablecxt = AllocSetContextCreate(CurrentMemoryContext,
+											"MaterialCache",
+											ALLOCSET_DEFAULT_MINSIZE,
+											ALLOCSET_DEFAULT_INITSIZE,
+											ALLOCSET_DEFAULT_MAXSIZE);
+	cache->status = MATCACHE_LOOKUP;
+
+	return cache;
+}
+
+/*
+ * (Re)build an empty cache in the cache's memory context, which the caller
+ * must have emptied.
+ */
+static void
+material_cache_build(MaterialState *node)
+{
+	MaterialCache cache = node->cache;
+
+	cache->hashtable = BuildTupleHashTable(cache->numKeys,
+										   cache->keyColIdx,
+										   cache->eqfunctions,
+										   cache->hashfunctions,
+										   cache->nbuckets,
+										   sizeof(MaterialCacheEntryData),
+										   cache->tablecxt,
+						   node->ss.ps.ps_ExprContext->ecxt_per_tuple_memory);
+	DLInitList(&cache->lru);
+	cache->mem_used = 0;
+	cache->entry = NULL;
+	cache->next = NULL;
+}
+
+/*
+ * Look up the entry for the current values of the cache keys, and decide
+ * whether to replay it or to run the subplan to fill it in.
+ */
+static void
+material_cache_lookup(MaterialState *node)
+{
+	MaterialCache cache = node->cache;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	TupleTableSlot *keyslot = cache->keyslot;
+	PlanState  *outerNode = outerPlanState(node);
+	TupleHashEntry hashentry;
+	MaterialCacheEntry entry;
+	bool		isnew;
+	ListCell   *lc;
+	int			i;
+
+	ResetExprContext(econtext);
+
+	ExecClearTuple(keyslot);
+	i = 0;
+	foreach(lc, cache->keyexprs)
+	{
+		ExprState  *keystate = (ExprState *) lfirst(lc);
+
+		keyslot->tts_values[i] = ExecEvalExprSwitchContext(keystate,
+														   econtext,
+												   &keyslot->tts_isnull[i],
+														   NULL);
+		i++;
+	}
+	ExecStoreVirtualTuple(keyslot);
+
+	hashentry = LookupTupleHashEntry(cache->hashtable, keyslot, &isnew);
+	entry = (MaterialCacheEntry) hashentry->additional;
+
+	if (!isnew && entry->complete)
+	{
+		DLMoveToFront(&entry->lru);
+		cache->entry = entry;
+		cache->next = list_head(entry->tuples);
+		cache->status = MATCACHE_REPLAY;
+		node->cache_hits++;
+		return;
+	}
+
+	node->cache_misses++;
+
+	if (isnew)
+	{
+		entry->key = hashentry->firstTuple;
+		DLInitElem(&entry->lru, entry);
+		DLAddHead(&cache->lru, &entry->lru);
+		entry->size = sizeof(TupleHashEntryData) +
+			sizeof(MaterialCacheEntryData) +
+			GetMemoryChunkSpace(entry->key);
+		cache->mem_used += entry->size;
+	}
+	else
+	{
+		/*
+		 * An earlier scan for this key was abandoned before the end; throw
+		 * away what it stored and start over.
+		 */
+		Size		keysize = sizeof(TupleHashEntryData) +
+		sizeof(MaterialCacheEntryData) +
+		GetMemoryChunkSpace(entry->key);
+
+		list_free_deep(entry->tuples);
+		entry->tuples = NIL;
+		cache->mem_used -= entry->size - keysize;
+		entry->size = keysize;
+		DLMoveToFront(&entry->lru);
+	}
+	cache->entry = entry;
+	cache->status = MATCACHE_FILL;
+
+	/*
+	 * If the subplan's parameters have changed, ExecProcNode will rescan it;
+	 * otherwise we must, unless it is still at its start.
+	 */
+	if (cache->subplan_used && outerNode->chgParam == NULL)
+		ExecReScan(outerNode);
+	cache->subplan_used = false;
+}
+
+/*
+ * Add a tuple returned by the subplan to the entry being filled, evicting
+ * older entries as needed to stay within the memory limit.
+ */
+static void
+material_cache_store(MaterialState *node, TupleTableSlot *slot)
+{
+	MaterialCache cache = node->cache;
+	MaterialCacheEntry entry = cache->entry;
+	MemoryContext oldcxt;
+	MinimalTuple tuple;
+	Size		size;
+
+	oldcxt = MemoryContextSwitchTo(cache->tablecxt);
+	tuple = ExecCopySlotMinimalTuple(slot);
+	entry->tuples = lappend(entry->tuples, tuple);
+	MemoryContextSwitchTo(oldcxt);
+
+	size = GetMemoryChunkSpace(tuple) + sizeof(ListCell);
+	entry->size += size;
+	cache->mem_used += size;
+
+	while (cache->mem_used > cache->mem_limit)
+	{
+		MaterialCacheEntry victim;
+
+		victim = (MaterialCacheEntry) DLE_VAL(DLGetTail(&cache->lru));
+		if (victim == entry)
+		{
+			/*
+			 * The current entry is the only one left, and still too big;
+			 * give up on caching it and just pass the rest through.
+			 */
+			material_cache_evict(node, entry);
+			cache->entry = NULL;
+			cache->status = MATCACHE_BYPASS;
+			node->cache_overflows++;
+			break;
+		}
+		material_cache_evict(node, victim);
+		node->cache_evictions++;
+	}
+
+	if (cache->mem_used > node->cache_peakmem)
+		node->cache_peakmem = cache->mem_used;
+}
+
+/*
+ * Remove an entry from the cache, and free its memory.
+ */
+static void
+material_cache_evict(MaterialState *node, MaterialCacheEntry entry)
+{
+	MaterialCache cache = node->cache;
+	MinimalTuple key = entry->key;
+	List	   *tuples = entry->tuples;
+
+	DLRemove(&entry->lru);
+	cache->mem_used -= entry->size;
+
+	ExecStoreMinimalTuple(key, cache->evictslot, false);
+	if (!RemoveTupleHashEntry(cache->hashtable, cache->evictslot))
+		elog(ERROR, "material cache entry to evict not found");
+	ExecClearTuple(cache->evictslot);
+
+	pfree(key);
+	list_free_deep(tuples);
+	pfree(entry);
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitMaterial
  * ----------------------------------------------------------------
@@ -229,6 +583,20 @@ ExecInitMaterial(Material *node, EState *estate, int eflags)
 	ExecAssignScanTypeFromOuterPlan(&matstate->ss);
 	matstate->ss.ps.ps_ProjInfo = NULL;
 
+	/*
+	 * A caching Material needs an ExprContext to compute its keys in, but no
+	 * tuplestore.  It's only used under a nestloop, which never asks for
+	 * backward scan or mark/restore.
+	 */
+	if (node->numCacheKeys > 0)
+	{
+		Assert(!(matstate->eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+		matstate->eflags = 0;
+		ExecAssignExprContext(estate, &matstate->ss.ps);
+		matstate->cache = material_cache_create(matstate, node);
+		material_cache_build(matstate);
+	}
+
 	return matstate;
 }
 
@@ -251,6 +619,15 @@ ExecEndMaterial(MaterialState *node)
 		tuplestore_end(node->tuplestorestate);
 	node->tuplestorestate = NULL;
 
+	/*
+	 * Release the cache, if any
+	 */
+	if (node->cache != NULL)
+	{
+		MemoryContextDelete(node->cache->tablecxt);
+		ExecFreeExprContext(&node->ss.ps);
+	}
+
 	/*
 	 * shut down the subplan
 	 */
@@ -319,7 +696,25 @@ ExecReScanMaterial(MaterialState *node)
 {
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 
-	if (node->eflags != 0)
+	if (node->cache != NULL)
+	{
+		MaterialCache cache = node->cache;
+
+		/*
+		 * The cached results depend only on the values of the keys, as long
+		 * as no other parameter of the subplan changes; if one does, all of
+		 * them are stale.  Either way, the next fetch looks up the keys'
+		 * current values.
+		 */
+		if (node->ss.ps.chgParam != NULL &&
+			!bms_is_subset(node->ss.ps.chgParam, cache->keyparams))
+		{
+			MemoryContextReset(cache->tablecxt);
+			material_cache_build(node);
+		}
+		cache->status = MATCACHE_LOOKUP;
+	}
+	else if (node->eflags != 0)
 	{
 		/*
 		 * If we haven't materialized yet, just return. If outerplan's
@@ -39,6 +39,7 @@
 #include "postgres.h"
 
 #include "executor/execdebug.h"
+#include "executor/nodeAppend.h"
 #include "executor/nodeMergeAppend.h"
 
 /*
@@ -64,9 +65,12 @@ MergeAppendState *
 ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 {
 	MergeAppendState *mergestate = makeNode(MergeAppendState);
+	PartitionPruneInfo *pinfo = node->part_prune_info;
 	PlanState **mergeplanstates;
+	bool	   *valid = NULL;
 	int			nplans;
 	int			i;
+	int			j;
 	ListCell   *lc;
 
 	/* check for unsupported flags */
@@ -93,9 +97,31 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 	/*
 	 * Miscellaneous initialization
 	 *
-	 * MergeAppend plans don't have expression contexts because they never
-	 * call ExecQual or ExecProject.
+	 * MergeAppend plans don't call ExecQual or ExecProject, so they need an
+	 * expression context only for run-time pruning, which works just as in
+	 * ExecInitAppend.
 	 */
+	if (pinfo != NULL)
+	{
+		ExecAssignExprContext(estate, &mergestate->ps);
+		mergestate->ms_prune_exprs = (List *)
+			ExecInitExpr((Expr *) pinfo->exprs, &mergestate->ps);
+		valid = (bool *) palloc(nplans * sizeof(bool));
+
+		if (bms_is_empty(pinfo->execparams))
+		{
+			if (ExecFindMatchingSubPlans(pinfo, mergestate->ms_prune_exprs,
+										 mergestate->ps.ps_ExprContext,
+										 valid) == 0)
+				valid[0] = true;
+		}
+		else
+		{
+			memset(valid, true, nplans * sizeof(bool));
+			mergestate->ms_valid = valid;
+			mergestate->ms_prune_pending = true;
+		}
+	}
 
 	/*
 	 * MergeAppend nodes do have Result slots, which hold pointers to tuples,
@@ -108,13 +134,19 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 	 * results into the array "mergeplans".
 	 */
 	i = 0;
+	j = 0;
 	foreach(lc, node->mergeplans)
 	{
 		Plan	   *initNode = (Plan *) lfirst(lc);
 
+		/* Skip subplans pruned at startup */
+		if (valid && !mergestate->ms_prune_pending && !valid[j++])
+			continue;
 		mergeplanstates[i] = ExecInitNode(initNode, estate, eflags);
 		i++;
 	}
+	mergestate->ms_nremoved = nplans - i;
+	mergestate->ms_nplans = i;
 
 	/*
 	 * initialize output tuple type
@@ -164,12 +196,25 @@ ExecMergeAppend(MergeAppendState *node)
 
 	if (!node->ms_initialized)
 	{
+		if (node->ms_prune_pending)
+		{
+			PartitionPruneInfo *pinfo;
+
+			pinfo = ((MergeAppend *) node->ps.plan)->part_prune_info;
+			(void) ExecFindMatchingSubPlans(pinfo, node->ms_prune_exprs,
+											node->ps.ps_ExprContext,
+											node->ms_valid);
+			node->ms_prune_pending = false;
+		}
+
 		/*
-		 * First time through: pull the first tuple from each subplan, and set
-		 * up the heap.
+		 * First time through: pull the first tuple from each subplan that
+		 * run-time pruning didn't eliminate, and set up the heap.
 		 */
 		for (i = 0; i < node->ms_nplans; i++)
 		{
+			if (node->ms_valid && !node->ms_valid[i])
+				continue;
 			node->ms_slots[i] = ExecProcNode(node->mergeplans[i]);
 			if (!TupIsNull(node->ms_slots[i]))
 				heap_insert_slot(node, i);
@@ -329,6 +374,12 @@ ExecReScanMergeAppend(MergeAppendState *node)
 {
 	int			i;
 
+	/* Redo run-time pruning if any of its Params have changed */
+	if (node->ms_valid &&
+		bms_overlap(node->ps.chgParam,
+				((MergeAppend *) node->ps.plan)->part_prune_info->execparams))
+		node->ms_prune_pending = true;
+
 	for (i = 0; i < node->ms_nplans; i++)
 	{
 		PlanState  *subnode = node->mergeplans[i];
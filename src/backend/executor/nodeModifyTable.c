@@ -37,6 +37,7 @@
 
 #include "postgres.h"
 
+#include "access/tableam.h"
 #include "access/xact.h"
 #include "commands/trigger.h"
 #include "executor/executor.h"
@@ -50,6 +51,14 @@
 #include "utils/tqual.h"
 
 
+/*
+ * When an INSERT buffers its rows for heap_multi_insert, write them out
+ * after this many rows, or this many bytes of tuple data, like COPY FROM.
+ */
+#define MAX_BUFFERED_INSERT_TUPLES	1000
+#define MAX_BUFFERED_INSERT_BYTES	65535
+
+
 /*
  * Verify that the tuples to be produced by INSERT or UPDATE match the
  * target relation's rowtype
@@ -149,17 +158,91 @@ ExecProcessReturning(ProjectionInfo *projectReturning,
 	return ExecProject(projectReturning, NULL);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecFlushBufferedInserts
+ *
+ *		Write out the rows ExecInsert has buffered, make their index
+ *		entries and queue their AFTER ROW triggers.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecFlushBufferedInserts(ModifyTableState *mtstate, EState *estate)
+{
+	ResultRelInfo *resultRelInfo = mtstate->resultRelInfo;
+	Relation	resultRelationDesc = resultRelInfo->ri_RelationDesc;
+	const TableAmRoutine *tableam = GetTableAmRoutine(resultRelationDesc);
+	HeapTuple  *tuples = mtstate->mt_bufferedTuples;
+	int			ntuples = mtstate->mt_nBufferedTuples;
+	MemoryContext oldcontext;
+	int			i;
+
+	if (ntuples == 0)
+		return;
+
+	/*
+	 * heap_multi_insert leaks memory, so run it in the batch context, which
+	 * we reset below anyway.  A lone row goes through heap_insert, so that
+	 * a single-row INSERT writes exactly the WAL it always has.
+	 */
+	oldcontext = MemoryContextSwitchTo(mtstate->mt_batchcxt);
+	if (ntuples == 1)
+	{
+		ExecStoreTuple(tuples[0], mtstate->mt_batchslot,
+					   InvalidBuffer, false);
+		tableam->InsertTableRow(resultRelationDesc, mtstate->mt_batchslot,
+								estate->es_output_cid, 0, NULL);
+	}
+	else
+		tableam->MultiInsertTableRows(resultRelationDesc, tuples, ntuples,
+									  estate->es_output_cid, 0, NULL);
+	MemoryContextSwitchTo(oldcontext);
+
+	for (i = 0; i < ntuples; i++)
+	{
+		List	   *recheckIndexes = NIL;
+
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			ExecStoreTuple(tuples[i], mtstate->mt_batchslot,
+						   InvalidBuffer, false);
+			recheckIndexes = ExecInsertIndexTuples(mtstate->mt_batchslot,
+												   &(tuples[i]->t_self),
+												   estate, false);
+		}
+
+		/* AFTER ROW INSERT Triggers */
+		ExecARInsertTriggers(estate, resultRelInfo, tuples[i],
+							 recheckIndexes);
+
+		list_free(recheckIndexes);
+	}
+
+	if (mtstate->canSetTag)
+	{
+		estate->es_lastoid = HeapTupleGetOid(tuples[ntuples - 1]);
+		setLastTid(&(tuples[ntuples - 1]->t_self));
+	}
+
+	ExecClearTuple(mtstate->mt_batchslot);
+	MemoryContextReset(mtstate->mt_batchcxt);
+	mtstate->mt_nBufferedTuples = 0;
+	mtstate->mt_bufferedTuplesSize = 0;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInsert
  *
  *		For INSERT, we have to insert the tuple into the target relation
- *		and insert appropriate tuples into the index relations.
+ *		and insert appropriate tuples into the index relations.  If the
+ *		node is batching its rows, we just add the tuple to the buffer,
+ *		and ExecFlushBufferedInserts does the rest later.
  *
  *		Returns RETURNING result if any, otherwise NULL.
  * ----------------------------------------------------------------
  */
 static TupleTableSlot *
-ExecInsert(TupleTableSlot *slot,
+ExecInsert(ModifyTableState *mtstate,
+		   TupleTableSlot *slot,
 		   TupleTableSlot *planSlot,
 		   EState *estate,
 		   bool canSetTag)
@@ -167,6 +250,7 @@ ExecInsert(TupleTableSlot *slot,
 	HeapTuple	tuple;
 	ResultRelInfo *resultRelInfo;
 	Relation	resultRelationDesc;
+	const TableAmRoutine *tableam;
 	Oid			newId;
 	List	   *recheckIndexes = NIL;
 
@@ -232,21 +316,46 @@ ExecInsert(TupleTableSlot *slot,
 		if (resultRelationDesc->rd_att->constr)
 			ExecConstraints(resultRelInfo, slot, estate);
 
+		/*
+		 * If batching, keep a copy of the tuple until the buffer fills up.
+		 * There can be no RETURNING list in that case.
+		 */
+		if (mtstate->mt_bufferedTuples != NULL)
+		{
+			MemoryContext oldcontext;
+
+			oldcontext = MemoryContextSwitchTo(mtstate->mt_batchcxt);
+			mtstate->mt_bufferedTuples[mtstate->mt_nBufferedTuples++] =
+				heap_copytuple(tuple);
+			MemoryContextSwitchTo(oldcontext);
+			mtstate->mt_bufferedTuplesSize += tuple->t_len;
+
+			if (canSetTag)
+				(estate->es_processed)++;
+
+			if (mtstate->mt_nBufferedTuples == MAX_BUFFERED_INSERT_TUPLES ||
+				mtstate->mt_bufferedTuplesSize > MAX_BUFFERED_INSERT_BYTES)
+				ExecFlushBufferedInserts(mtstate, estate);
+
+			return NULL;
+		}
+
 		/*
 		 * insert the tuple
 		 *
-		 * Note: heap_insert returns the tid (location) of the new tuple in
-		 * the t_self field.
+		 * Note: the access method returns the tid (location) of the new
+		 * tuple in the t_self field.
 		 */
-		newId = heap_insert(resultRelationDesc, tuple,
-							estate->es_output_cid, 0, NULL);
+		tableam = GetTableAmRoutine(resultRelationDesc);
+		newId = tableam->InsertTableRow(resultRelationDesc, slot,
+										estate->es_output_cid, 0, NULL);
 
 		/*
 		 * insert index entries for tuple
 		 */
 		if (resultRelInfo->ri_NumIndices > 0)
 			recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
-												   estate);
+												   estate, false);
 	}
 
 	if (canSetTag)
@@ -293,6 +402,7 @@ ExecDelete(ItemPointer tupleid,
 {
 	ResultRelInfo *resultRelInfo;
 	Relation	resultRelationDesc;
+	const TableAmRoutine *tableam;
 	HTSU_Result result;
 	ItemPointerData update_ctid;
 	TransactionId update_xmax;
@@ -302,6 +412,7 @@ ExecDelete(ItemPointer tupleid,
 	 */
 	resultRelInfo = estate->es_result_relation_info;
 	resultRelationDesc = resultRelInfo->ri_RelationDesc;
+	tableam = GetTableAmRoutine(resultRelationDesc);
 
 	/* BEFORE ROW DELETE Triggers */
 	if (resultRelInfo->ri_TrigDesc &&
@@ -346,11 +457,11 @@ ExecDelete(ItemPointer tupleid,
 		 * mode transactions.
 		 */
 ldelete:;
-		result = heap_delete(resultRelationDesc, tupleid,
-							 &update_ctid, &update_xmax,
-							 estate->es_output_cid,
-							 estate->es_crosscheck_snapshot,
-							 true /* wait for commit */ );
+		result = tableam->DeleteTableRow(resultRelationDesc, tupleid,
+										 &update_ctid, &update_xmax,
+										 estate->es_output_cid,
+										 estate->es_crosscheck_snapshot,
+										 true /* wait for commit */ );
 		switch (result)
 		{
 			case HeapTupleSelfUpdated:
@@ -480,9 +591,11 @@ ExecUpdate(ItemPointer tupleid,
 	HeapTuple	tuple;
 	ResultRelInfo *resultRelInfo;
 	Relation	resultRelationDesc;
+	const TableAmRoutine *tableam;
 	HTSU_Result result;
 	ItemPointerData update_ctid;
 	TransactionId update_xmax;
+	bool		update_indexes;
 	List	   *recheckIndexes = NIL;
 
 	/*
@@ -502,6 +615,7 @@ ExecUpdate(ItemPointer tupleid,
 	 */
 	resultRelInfo = estate->es_result_relation_info;
 	resultRelationDesc = resultRelInfo->ri_RelationDesc;
+	tableam = GetTableAmRoutine(resultRelationDesc);
 
 	/* BEFORE ROW UPDATE Triggers */
 	if (resultRelInfo->ri_TrigDesc &&
@@ -562,11 +676,12 @@ lreplace:;
 		 * needed for referential integrity updates in transaction-snapshot
 		 * mode transactions.
 		 */
-		result = heap_update(resultRelationDesc, tupleid, tuple,
-							 &update_ctid, &update_xmax,
-							 estate->es_output_cid,
-							 estate->es_crosscheck_snapshot,
-							 true /* wait for commit */ );
+		result = tableam->UpdateTableRow(resultRelationDesc, tupleid, slot,
+										 &update_ctid, &update_xmax,
+										 estate->es_output_cid,
+										 estate->es_crosscheck_snapshot,
+										 true /* wait for commit */ ,
+										 &update_indexes);
 		switch (result)
 		{
 			case HeapTupleSelfUpdated:
@@ -618,14 +733,14 @@ lreplace:;
 		/*
 		 * insert index entries for tuple
 		 *
-		 * Note: heap_update returns the tid (location) of the new tuple in
-		 * the t_self field.
+		 * Note: the access method returns the tid (location) of the new
+		 * tuple in the t_self field.
 		 *
 		 * If it's a HOT update, we mustn't insert new index entries.
 		 */
-		if (resultRelInfo->ri_NumIndices > 0 && !HeapTupleIsHeapOnly(tuple))
+		if (resultRelInfo->ri_NumIndices > 0 && update_indexes)
 			recheckIndexes = ExecInsertIndexTuples(slot, &(tuple->t_self),
-												   estate);
+												   estate, true);
 	}
 
 	if (canSetTag)
@@ -796,7 +911,8 @@ ExecModifyTable(ModifyTableState *node)
 				Datum		datum;
 				bool		isNull;
 
-				if (resultRelInfo->ri_RelationDesc->rd_rel->relkind == RELKIND_RELATION)
+				if (resultRelInfo->ri_RelationDesc->rd_rel->relkind == RELKIND_RELATION ||
+					resultRelInfo->ri_RelationDesc->rd_rel->relkind == RELKIND_MATVIEW)
 				{
 					datum = ExecGetJunkAttribute(slot,
 												 junkfilter->jf_junkAttNo,
@@ -833,7 +949,8 @@ ExecModifyTable(ModifyTableState *node)
 		switch (operation)
 		{
 			case CMD_INSERT:
-				slot = ExecInsert(slot, planSlot, estate, node->canSetTag);
+				slot = ExecInsert(node, slot, planSlot, estate,
+								  node->canSetTag);
 				break;
 			case CMD_UPDATE:
 				slot = ExecUpdate(tupleid, oldtuple, slot, planSlot,
@@ -859,6 +976,10 @@ ExecModifyTable(ModifyTableState *node)
 		}
 	}
 
+	/* Write out whatever an INSERT still has buffered */
+	if (node->mt_bufferedTuples != NULL)
+		ExecFlushBufferedInserts(node, estate);
+
 	/* Restore es_result_relation_info before exiting */
 	estate->es_result_relation_info = saved_resultRelInfo;
 
@@ -1110,7 +1231,8 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 				if (operation == CMD_UPDATE || operation == CMD_DELETE)
 				{
 					/* For UPDATE/DELETE, find the appropriate junk attr now */
-					if (resultRelInfo->ri_RelationDesc->rd_rel->relkind == RELKIND_RELATION)
+					if (resultRelInfo->ri_RelationDesc->rd_rel->relkind == RELKIND_RELATION ||
+						resultRelInfo->ri_RelationDesc->rd_rel->relkind == RELKIND_MATVIEW)
 					{
 						j->jf_junkAttNo = ExecFindJunkAttribute(j, "ctid");
 						if (!AttributeNumberIsValid(j->jf_junkAttNo))
@@ -1144,6 +1266,38 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	if (estate->es_trig_tuple_slot == NULL)
 		estate->es_trig_tuple_slot = ExecInitExtraTupleSlot(estate);
 
+	/*
+	 * If the planner found nothing in the query that could tell, buffer an
+	 * INSERT's rows and write them with heap_multi_insert, which costs one
+	 * buffer lock cycle and WAL record per page rather than per row.  BEFORE
+	 * and INSTEAD OF row triggers could look at the table between rows, so
+	 * they rule it out.  The planner already excluded RETURNING.
+	 */
+	if (node->batchInserts && operation == CMD_INSERT)
+	{
+		Relation	rel = mtstate->resultRelInfo->ri_RelationDesc;
+		TriggerDesc *trigDesc = mtstate->resultRelInfo->ri_TrigDesc;
+
+		Assert(node->returningLists == NIL);
+
+		if (rel->rd_rel->relkind == RELKIND_RELATION &&
+			!(trigDesc != NULL &&
+			  (trigDesc->trig_insert_before_row ||
+			   trigDesc->trig_insert_instead_row)))
+		{
+			mtstate->mt_bufferedTuples = (HeapTuple *)
+				palloc(MAX_BUFFERED_INSERT_TUPLES * sizeof(HeapTuple));
+			mtstate->mt_batchcxt =
+				AllocSetContextCreate(CurrentMemoryContext,
+									  "ModifyTable insert batch",
+									  ALLOCSET_DEFAULT_MINSIZE,
+									  ALLOCSET_DEFAULT_INITSIZE,
+									  ALLOCSET_DEFAULT_MAXSIZE);
+			mtstate->mt_batchslot = ExecInitExtraTupleSlot(estate);
+			ExecSetSlotDescriptor(mtstate->mt_batchslot, RelationGetDescr(rel));
+		}
+	}
+
 	/*
 	 * Lastly, if this is not the primary (canSetTag) ModifyTable node, add it
 	 * to estate->es_auxmodifytables so that it will be run to completion by
@@ -1193,6 +1347,10 @@ ExecEndModifyTable(ModifyTableState *node)
 	 */
 	for (i = 0; i < node->mt_nplans; i++)
 		ExecEndNode(node->mt_plans[i]);
+
+	/* release the INSERT batch buffer, if any */
+	if (node->mt_batchcxt != NULL)
+		MemoryContextDelete(node->mt_batchcxt);
 }
 
 void
@@ -18,9 +18,14 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/tuplesort.h"
 
 
+static TupleTableSlot *ExecIncrementalSort(SortState *node);
+
+
 /* ----------------------------------------------------------------
  *		ExecSort
  *
@@ -53,6 +58,9 @@ ExecSort(SortState *node)
 	dir = estate->es_direction;
 	tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
 
+	if (node->incremental)
+		return ExecIncrementalSort(node);
+
 	/*
 	 * If first time through, read all tuples from outer plan and pass them to
 	 * tuplesort.c. Subsequent calls just fetch tuples from tuplesort.
@@ -141,6 +149,122 @@ ExecSort(SortState *node)
 	return slot;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		ExecSort for a Sort node whose input is already sorted by the
+ *		first numPresortedCols sort columns.  Rather than sorting the
+ *		whole input, we read one group of tuples that are equal on those
+ *		columns at a time, sort it by the remaining columns, and return
+ *		its tuples before reading the next group.  This bounds the memory
+ *		used to the largest group, and lets us stop reading the input
+ *		early when the result is bounded.
+ *
+ *		Only forward scans without mark/restore are supported; see
+ *		ExecInitSort.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	int			npresorted = plannode->numPresortedCols;
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *result = node->ss.ps.ps_ResultTupleSlot;
+	TupleTableSlot *pivot = node->groupPivot;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+
+	for (;;)
+	{
+		/* Return the next tuple of the current group, if there is one */
+		tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+		if (tuplesortstate != NULL)
+		{
+			if (tuplesort_gettupleslot(tuplesortstate, true, result))
+			{
+				node->incr_returned++;
+				return result;
+			}
+			tuplesort_end(tuplesortstate);
+			node->tuplesortstate = NULL;
+		}
+
+		/* Done if we have returned enough tuples or there are no more */
+		if (node->bounded && node->incr_returned >= node->bound)
+			return ExecClearTuple(result);
+
+		if (TupIsNull(pivot))
+		{
+			if (node->outerDone)
+				return ExecClearTuple(result);
+
+			/* First time through: fetch the first tuple of the first group */
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+			{
+				node->outerDone = true;
+				return ExecClearTuple(result);
+			}
+			ExecCopySlot(pivot, slot);
+		}
+
+		SO1_printf("ExecIncrementalSort: %s\n",
+				   "sorting next group");
+
+		node->sort_Done = true;
+		node->bounded_Done = node->bounded;
+		node->bound_Done = node->bound;
+
+		/*
+		 * The tuples of a group all agree on the presorted columns, so only
+		 * the remaining ones need to be compared.
+		 */
+		tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+											  plannode->numCols - npresorted,
+											  plannode->sortColIdx + npresorted,
+										plannode->sortOperators + npresorted,
+											plannode->collations + npresorted,
+											 plannode->nullsFirst + npresorted,
+											  work_mem,
+											  false);
+		if (node->bounded)
+			tuplesort_set_bound(tuplesortstate,
+								node->bound - node->incr_returned);
+		node->tuplesortstate = (void *) tuplesortstate;
+
+		/*
+		 * Feed the group's first tuple, then everything that matches it on
+		 * the presorted columns.  The first tuple that doesn't match begins
+		 * the next group, and is kept in the pivot slot for next time.
+		 */
+		tuplesort_puttupleslot(tuplesortstate, pivot);
+		for (;;)
+		{
+			slot = ExecProcNode(outerNode);
+
+			if (TupIsNull(slot))
+			{
+				node->outerDone = true;
+				ExecClearTuple(pivot);
+				break;
+			}
+
+			if (!execTuplesMatch(slot, pivot,
+								 npresorted, plannode->sortColIdx,
+								 node->presortedEq, node->groupCxt))
+			{
+				ExecCopySlot(pivot, slot);
+				break;
+			}
+
+			tuplesort_puttupleslot(tuplesortstate, slot);
+		}
+
+		tuplesort_performsort(tuplesortstate);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitSort
  *
@@ -176,6 +300,18 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
 
+	/*
+	 * We can sort one presorted group at a time only if nobody needs to
+	 * revisit earlier groups.
+	 */
+	sortstate->incremental = (node->numPresortedCols > 0 &&
+							  !sortstate->randomAccess);
+	sortstate->outerDone = false;
+	sortstate->incr_returned = 0;
+	sortstate->presortedEq = NULL;
+	sortstate->groupPivot = NULL;
+	sortstate->groupCxt = NULL;
+
 	/*
 	 * Miscellaneous initialization
 	 *
@@ -209,6 +345,40 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	ExecAssignScanTypeFromOuterPlan(&sortstate->ss);
 	sortstate->ss.ps.ps_ProjInfo = NULL;
 
+	/*
+	 * For an incremental sort, look up the equality operators that go with
+	 * the presorted columns' ordering operators, so that we can find the
+	 * group boundaries.
+	 */
+	if (sortstate->incremental)
+	{
+		int			npresorted = node->numPresortedCols;
+		Oid		   *eqOperators;
+		int			i;
+
+		eqOperators = (Oid *) palloc(npresorted * sizeof(Oid));
+		for (i = 0; i < npresorted; i++)
+		{
+			eqOperators[i] = get_equality_op_for_ordering_op(node->sortOperators[i],
+															 NULL);
+			if (!OidIsValid(eqOperators[i]))
+				elog(ERROR, "could not find equality operator for ordering operator %u",
+					 node->sortOperators[i]);
+		}
+		sortstate->presortedEq = execTuplesMatchPrepare(npresorted,
+														eqOperators);
+		pfree(eqOperators);
+
+		sortstate->groupPivot =
+			MakeSingleTupleTableSlot(ExecGetResultType(outerPlanState(sortstate)));
+		sortstate->groupCxt =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "Sort group comparisons",
+								  ALLOCSET_SMALL_MINSIZE,
+								  ALLOCSET_SMALL_INITSIZE,
+								  ALLOCSET_SMALL_MAXSIZE);
+	}
+
 	SO1_printf("ExecInitSort: %s\n",
 			   "sort node initialized");
 
@@ -239,6 +409,11 @@ ExecEndSort(SortState *node)
 		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
 	node->tuplesortstate = NULL;
 
+	if (node->groupPivot != NULL)
+		ExecDropSingleTupleTableSlot(node->groupPivot);
+	if (node->groupCxt != NULL)
+		MemoryContextDelete(node->groupCxt);
+
 	/*
 	 * shut down the subplan
 	 */
@@ -301,6 +476,25 @@ ExecReScanSort(SortState *node)
 	/* must drop pointer to sort result tuple */
 	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 
+	/*
+	 * An incremental sort never keeps more than the current group, so it
+	 * always has to start over from the beginning of the subplan.
+	 */
+	if (node->incremental)
+	{
+		node->sort_Done = false;
+		if (node->tuplesortstate != NULL)
+			tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		node->tuplesortstate = NULL;
+		ExecClearTuple(node->groupPivot);
+		node->outerDone = false;
+		node->incr_returned = 0;
+
+		if (node->ss.ps.lefttree->chgParam == NULL)
+			ExecReScan(node->ss.ps.lefttree);
+		return;
+	}
+
 	/*
 	 * If subnode is to be rescanned then we forget previous sort results; we
 	 * have to re-read the subplan and re-sort.  Also must re-sort if the
@@ -103,6 +103,7 @@ typedef struct WindowStatePerAggData
 {
 	/* Oids of transfer functions */
 	Oid			transfn_oid;
+	Oid			invtransfn_oid; /* may be InvalidOid */
 	Oid			finalfn_oid;	/* may be InvalidOid */
 
 	/*
@@ -111,6 +112,7 @@ typedef struct WindowStatePerAggData
 	 * flags are kept here.
 	 */
 	FmgrInfo	transfn;
+	FmgrInfo	invtransfn;
 	FmgrInfo	finalfn;
 
 	/*
@@ -143,6 +145,9 @@ typedef struct WindowStatePerAggData
 	bool		transValueIsNull;
 
 	bool		noTransValue;	/* true if transValue not set yet */
+
+	/* number of rows aggregated into transValue with no null argument */
+	int64		transValueCount;
 } WindowStatePerAggData;
 
 static void initialize_windowaggregate(WindowAggState *winstate,
@@ -204,6 +209,7 @@ initialize_windowaggregate(WindowAggState *winstate,
 	}
 	peraggstate->transValueIsNull = peraggstate->initValueIsNull;
 	peraggstate->noTransValue = peraggstate->initValueIsNull;
+	peraggstate->transValueCount = 0;
 	peraggstate->resultValueIsNull = true;
 }
 
@@ -239,6 +245,15 @@ advance_windowaggregate(WindowAggState *winstate,
 		i++;
 	}
 
+	/* Count the rows that the inverse transition function may remove */
+	for (i = 1; i <= numArguments; i++)
+	{
+		if (fcinfo->argnull[i])
+			break;
+	}
+	if (i > numArguments)
+		peraggstate->transValueCount++;
+
 	if (peraggstate->transfn.fn_strict)
 	{
 		/*
@@ -321,6 +336,104 @@ advance_windowaggregate(WindowAggState *winstate,
 	peraggstate->transValueIsNull = fcinfo->isnull;
 }
 
+/*
+ * advance_windowaggregate_base
+ * remove the row at the frame head from the transition value, by calling
+ * the aggregate's inverse transition function
+ *
+ * Returns false if that can't be done, in which case the caller must
+ * restart the aggregate from the new frame head.
+ */
+static bool
+advance_windowaggregate_base(WindowAggState *winstate,
+							 WindowStatePerFunc perfuncstate,
+							 WindowStatePerAgg peraggstate)
+{
+	WindowFuncExprState *wfuncstate = perfuncstate->wfuncstate;
+	int			numArguments = perfuncstate->numArguments;
+	FunctionCallInfoData fcinfodata;
+	FunctionCallInfo fcinfo = &fcinfodata;
+	Datum		newVal;
+	ListCell   *arg;
+	int			i;
+	MemoryContext oldContext;
+	ExprContext *econtext = winstate->tmpcontext;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	/* We start from 1, since the 0th arg will be the transition value */
+	i = 1;
+	foreach(arg, wfuncstate->args)
+	{
+		ExprState  *argstate = (ExprState *) lfirst(arg);
+
+		fcinfo->arg[i] = ExecEvalExpr(argstate, econtext,
+									  &fcinfo->argnull[i], NULL);
+		i++;
+	}
+
+	/*
+	 * Rows with a NULL argument were not counted, and are not passed to the
+	 * inverse transition function: an aggregate that has one must ignore
+	 * such rows in its transition function as well.
+	 */
+	for (i = 1; i <= numArguments; i++)
+	{
+		if (fcinfo->argnull[i])
+		{
+			MemoryContextSwitchTo(oldContext);
+			return true;
+		}
+	}
+
+	/*
+	 * Removing the last counted row must get us back to the initial state,
+	 * which the inverse function can't be expected to produce (a sum would
+	 * have to go back to NULL, say), and there's nothing it could do with a
+	 * NULL transition value.  Have the caller start over in both cases.
+	 */
+	if (peraggstate->transValueCount <= 1 || peraggstate->transValueIsNull)
+	{
+		MemoryContextSwitchTo(oldContext);
+		return false;
+	}
+
+	/*
+	 * OK to call the inverse transition function
+	 */
+	InitFunctionCallInfoData(*fcinfo, &(peraggstate->invtransfn),
+							 numArguments + 1,
+							 perfuncstate->winCollation,
+							 (void *) winstate, NULL);
+	fcinfo->arg[0] = peraggstate->transValue;
+	fcinfo->argnull[0] = false;
+	newVal = FunctionCallInvoke(fcinfo);
+
+	/* A NULL result means the function couldn't remove the row */
+	if (fcinfo->isnull)
+	{
+		MemoryContextSwitchTo(oldContext);
+		return false;
+	}
+
+	/* Same as in advance_windowaggregate */
+	if (!peraggstate->transtypeByVal &&
+		DatumGetPointer(newVal) != DatumGetPointer(peraggstate->transValue))
+	{
+		MemoryContextSwitchTo(winstate->aggcontext);
+		newVal = datumCopy(newVal,
+						   peraggstate->transtypeByVal,
+						   peraggstate->transtypeLen);
+		pfree(DatumGetPointer(peraggstate->transValue));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	peraggstate->transValue = newVal;
+	peraggstate->transValueCount--;
+
+	return true;
+}
+
 /*
  * finalize_windowaggregate
  * parallel to finalize_aggregate in nodeAgg.c
@@ -397,6 +510,8 @@ eval_windowaggregates(WindowAggState *winstate)
 	ExprContext *econtext;
 	WindowObject agg_winobj;
 	TupleTableSlot *agg_row_slot;
+	bool		restart;
+	bool		headmoved;
 
 	numaggs = winstate->numaggs;
 	if (numaggs == 0)
@@ -423,8 +538,12 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * damage the running transition value, but we have the same assumption in
 	 * nodeAgg.c too (when it rescans an existing hash table).
 	 *
-	 * For other frame start rules, we discard the aggregate state and re-run
-	 * the aggregates whenever the frame head row moves.  We can still
+	 * For other frame start rules, rows also exit the frame when the frame
+	 * head row moves.  If every aggregate has an inverse transition function,
+	 * we call it for each row that exits, which makes a sliding frame cost
+	 * O(1) per row rather than O(frame size).  Otherwise, or if an inverse
+	 * transition function gives up, we discard the aggregate state and re-run
+	 * the aggregates from the new frame head.  Either way, we can still
 	 * optimize as above whenever successive rows share the same frame head.
 	 *
 	 * In many common cases, multiple rows share the same frame and hence the
@@ -437,12 +556,7 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * 'aggregatedupto' keeps track of the first row that has not yet been
 	 * accumulated into the aggregate transition values.  Whenever we start a
 	 * new peer group, we accumulate forward to the end of the peer group.
-	 *
-	 * TODO: Rerunning aggregates from the frame start can be pretty slow. For
-	 * some aggregates like SUM and COUNT we could avoid that by implementing
-	 * a "negative transition function" that would be called for each row as
-	 * it exits the frame.	We'd have to think about avoiding recalculation of
-	 * volatile arguments of aggregate functions, too.
+	 * Likewise, 'aggregatedbase' is the first row still accumulated.
 	 */
 
 	/*
@@ -451,11 +565,59 @@ eval_windowaggregates(WindowAggState *winstate)
 	update_frameheadpos(agg_winobj, winstate->temp_slot_1);
 
 	/*
-	 * Initialize aggregates on first call for partition, or if the frame head
-	 * position moved since last time.
+	 * Initialize aggregates on first call for partition.  If the frame head
+	 * position moved since last time, remove the rows that exited the frame
+	 * with the inverse transition functions if we can, else initialize them
+	 * too.  No rows can be removed if none of the new frame was aggregated.
 	 */
-	if (winstate->currentpos == 0 ||
-		winstate->frameheadpos != winstate->aggregatedbase)
+	headmoved = (winstate->frameheadpos != winstate->aggregatedbase);
+	restart = (winstate->currentpos == 0 ||
+			   (headmoved &&
+				(winstate->agg_base_winobj == NULL ||
+				 winstate->frameheadpos < winstate->aggregatedbase ||
+				 winstate->frameheadpos >= winstate->aggregatedupto)));
+
+	if (!restart && headmoved)
+	{
+		TupleTableSlot *temp_slot = winstate->temp_slot_1;
+
+		while (winstate->aggregatedbase < winstate->frameheadpos)
+		{
+			if (!window_gettupleslot(winstate->agg_base_winobj,
+									 winstate->aggregatedbase, temp_slot))
+				elog(ERROR, "could not re-fetch previously fetched frame row");
+
+			/* Set tuple context for evaluation of aggregate arguments */
+			winstate->tmpcontext->ecxt_outertuple = temp_slot;
+
+			/* Remove row from the aggregates */
+			for (i = 0; i < numaggs; i++)
+			{
+				peraggstate = &winstate->peragg[i];
+				wfuncno = peraggstate->wfuncno;
+				if (!advance_windowaggregate_base(winstate,
+												  &winstate->perfunc[wfuncno],
+												  peraggstate))
+				{
+					restart = true;
+					break;
+				}
+			}
+
+			ResetExprContext(winstate->tmpcontext);
+			ExecClearTuple(temp_slot);
+
+			if (restart)
+				break;
+			winstate->aggregatedbase++;
+		}
+
+		/* keep the mark pointer pushed up to frame head, as below */
+		if (!restart && agg_winobj->markptr >= 0)
+			WinSetMarkPosition(agg_winobj, winstate->frameheadpos);
+	}
+
+	if (restart)
 	{
 		/*
 		 * Discard transient aggregate values
@@ -493,7 +655,8 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * advanced past the place we'd aggregated up to.  Check for these cases
 	 * and if so, reuse the saved result values.
 	 */
-	if ((winstate->frameOptions & (FRAMEOPTION_END_UNBOUNDED_FOLLOWING |
+	if (!headmoved &&
+		(winstate->frameOptions & (FRAMEOPTION_END_UNBOUNDED_FOLLOWING |
 								   FRAMEOPTION_END_CURRENT_ROW)) &&
 		winstate->aggregatedbase <= winstate->currentpos &&
 		winstate->aggregatedupto > winstate->currentpos)
@@ -726,6 +889,20 @@ begin_partition(WindowAggState *winstate)
 		agg_winobj->markpos = -1;
 		agg_winobj->seekpos = -1;
 
+		/*
+		 * Rows leaving the frame are fetched in order through a pointer of
+		 * their own, so that agg_winobj's doesn't have to seek back and forth.
+		 */
+		if (winstate->agg_base_winobj)
+		{
+			WindowObject agg_base_winobj = winstate->agg_base_winobj;
+
+			agg_base_winobj->readptr =
+				tuplestore_alloc_read_pointer(winstate->buffer, 0);
+			agg_base_winobj->markpos = -1;
+			agg_base_winobj->seekpos = -1;
+		}
+
 		/* Also reset the row counters for aggregates */
 		winstate->aggregatedbase = 0;
 		winstate->aggregatedupto = 0;
@@ -1615,6 +1792,31 @@ ExecInitWindowAgg(WindowAgg *node, EState *estate, int eflags)
 		agg_winobj->markptr = -1;
 		agg_winobj->readptr = -1;
 		winstate->agg_winobj = agg_winobj;
+
+		/*
+		 * If the frame head can move and all the aggregates can remove rows
+		 * from their state, set up a WindowObject to fetch the rows that
+		 * exit the frame.
+		 */
+		if (!(node->frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING))
+		{
+			for (aggno = 0; aggno < winstate->numaggs; aggno++)
+			{
+				if (!OidIsValid(peragg[aggno].invtransfn_oid))
+					break;
+			}
+			if (aggno == winstate->numaggs)
+			{
+				WindowObject agg_base_winobj = makeNode(WindowObjectData);
+
+				agg_base_winobj->winstate = winstate;
+				agg_base_winobj->argstates = NIL;
+				agg_base_winobj->localmem = NULL;
+				agg_base_winobj->markptr = -1;
+				agg_base_winobj->readptr = -1;
+				winstate->agg_base_winobj = agg_base_winobj;
+			}
+		}
 	}
 
 	/* copy frame options to state node for easy access */
@@ -1719,6 +1921,7 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	Oid			aggtranstype;
 	AclResult	aclresult;
 	Oid			transfn_oid,
+				invtransfn_oid,
 				finalfn_oid;
 	Expr	   *transfnexpr,
 			   *finalfnexpr;
@@ -1748,6 +1951,15 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	peraggstate->transfn_oid = transfn_oid = aggform->aggtransfn;
 	peraggstate->finalfn_oid = finalfn_oid = aggform->aggfinalfn;
 
+	/*
+	 * Rows removed with the inverse transition function would have their
+	 * arguments evaluated a second time, so don't use it if they're volatile.
+	 */
+	peraggstate->invtransfn_oid = invtransfn_oid = aggform->agginvtransfn;
+	if (OidIsValid(invtransfn_oid) &&
+		contain_volatile_functions((Node *) wfunc))
+		peraggstate->invtransfn_oid = invtransfn_oid = InvalidOid;
+
 	/* Check that aggregate owner has permission to call component fns */
 	{
 		HeapTuple	procTuple;
@@ -1766,6 +1978,14 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		if (aclresult != ACLCHECK_OK)
 			aclcheck_error(aclresult, ACL_KIND_PROC,
 						   get_func_name(transfn_oid));
+		if (OidIsValid(invtransfn_oid))
+		{
+			aclresult = pg_proc_aclcheck(invtransfn_oid, aggOwner,
+										 ACL_EXECUTE);
+			if (aclresult != ACLCHECK_OK)
+				aclcheck_error(aclresult, ACL_KIND_PROC,
+							   get_func_name(invtransfn_oid));
+		}
 		if (OidIsValid(finalfn_oid))
 		{
 			aclresult = pg_proc_aclcheck(finalfn_oid, aggOwner,
@@ -1809,6 +2029,13 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	fmgr_info(transfn_oid, &peraggstate->transfn);
 	fmgr_info_set_expr((Node *) transfnexpr, &peraggstate->transfn);
 
+	/* the inverse takes the same arguments as the transfn */
+	if (OidIsValid(invtransfn_oid))
+	{
+		fmgr_info(invtransfn_oid, &peraggstate->invtransfn);
+		fmgr_info_set_expr((Node *) transfnexpr, &peraggstate->invtransfn);
+	}
+
 	if (OidIsValid(finalfn_oid))
 	{
 		fmgr_info(finalfn_oid, &peraggstate->finalfn);
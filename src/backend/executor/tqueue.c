@@ -0,0 +1,156 @@
+/*-------------------------------------------------------------------------
+ *
+ * tqueue.c
+ *	  Use shm_mq to send & receive tuples between parallel backends
+ *
+ * A DestReceiver of type DestTupleQueue, which is a TQueueDestReceiver
+ * under the hood, writes tuples from the executor to a shm_mq.  The other
+ * end reads them back with TupleQueueReadTuple.
+ *
+ * Tuples are sent as their bare t_data; the reader must know the tuple
+ * descriptor, which must not contain transient record types, since their
+ * typmods mean nothing in another backend.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/tqueue.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup.h"
+#include "executor/tqueue.h"
+
+
+typedef struct
+{
+	DestReceiver pub;
+	shm_mq_handle *handle;		/* where to send the tuples */
+	bool		detached;		/* has the receiver gone away? */
+} TQueueDestReceiver;
+
+
+/*
+ * Receive a tuple from the executor and send it to the queue.
+ *
+ * If the reader has detached, there's nobody to send the tuple to; we just
+ * drop it, and the rest of the tuples too.
+ */
+static void
+tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+{
+	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
+	HeapTuple	tuple;
+
+	if (tqueue->detached)
+		return;
+
+	tuple = ExecMaterializeSlot(slot);
+	if (shm_mq_send(tqueue->handle, tuple->t_len, tuple->t_data,
+					false) == SHM_MQ_DETACHED)
+		tqueue->detached = true;
+}
+
+/*
+ * Prepare to receive tuples from executor.
+ */
+static void
+tqueueStartupReceiver(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	/* do nothing */
+}
+
+/*
+ * Clean up at end of an executor run
+ */
+static void
+tqueueShutdownReceiver(DestReceiver *self)
+{
+	/* do nothing */
+}
+
+/*
+ * Destroy receiver when done with it
+ */
+static void
+tqueueDestroyReceiver(DestReceiver *self)
+{
+	pfree(self);
+}
+
+/*
+ * Create a DestReceiver that sends tuples to a tuple queue.
+ */
+DestReceiver *
+CreateTupleQueueDestReceiver(void)
+{
+	TQueueDestReceiver *self;
+
+	self = (TQueueDestReceiver *) palloc0(sizeof(TQueueDestReceiver));
+
+	self->pub.receiveSlot = tqueueReceiveSlot;
+	self->pub.rStartup = tqueueStartupReceiver;
+	self->pub.rShutdown = tqueueShutdownReceiver;
+	self->pub.rDestroy = tqueueDestroyReceiver;
+	self->pub.mydest = DestTupleQueue;
+
+	/* private fields will be set by SetTupleQueueDestReceiverParams */
+
+	return (DestReceiver *) self;
+}
+
+/*
+ * Set parameters for a TQueueDestReceiver
+ */
+void
+SetTupleQueueDestReceiverParams(DestReceiver *self, shm_mq_handle *handle)
+{
+	TQueueDestReceiver *myState = (TQueueDestReceiver *) self;
+
+	Assert(myState->pub.mydest == DestTupleQueue);
+	myState->handle = handle;
+	myState->detached = false;
+}
+
+/*
+ * Fetch a tuple from a tuple queue.
+ *
+ * Returns a palloc'd copy of the tuple, or NULL if no tuple could be read.
+ * In the latter case, *done is set to true if the sender has detached and
+ * no more tuples will come; otherwise (only possible if nowait is true) the
+ * caller should try again when its latch is next set.
+ */
+HeapTuple
+TupleQueueReadTuple(shm_mq_handle *handle, bool nowait, bool *done)
+{
+	shm_mq_result result;
+	Size		nbytes;
+	void	   *data;
+	HeapTuple	tuple;
+
+	*done = false;
+
+	result = shm_mq_receive(handle, &nbytes, &data, nowait);
+	if (result == SHM_MQ_DETACHED)
+	{
+		*done = true;
+		return NULL;
+	}
+	if (result == SHM_MQ_WOULD_BLOCK)
+		return NULL;
+	Assert(result == SHM_MQ_SUCCESS);
+
+	/* The data may point into the queue, so copy it out */
+	tuple = (HeapTuple) palloc(HEAPTUPLESIZE + nbytes);
+	tuple->t_len = nbytes;
+	ItemPointerSetInvalid(&tuple->t_self);
+	tuple->t_tableOid = InvalidOid;
+	tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+	memcpy(tuple->t_data, data, nbytes);
+
+	return tuple;
+}
@@ -57,7 +57,13 @@
 bool		lo_compat_privileges;
 
 /*#define FSDB 1*/
-#define BUFSIZE			8192
+
+/*
+ * Transfer size for server-side lo_import and lo_export.  Each inv_read or
+ * inv_write call costs an index scan of pg_largeobject, so we move many
+ * pages per call; a multiple of LOBLKSIZE keeps the calls page-aligned.
+ */
+#define BUFSIZE			(LOBLKSIZE * 64)
 
 /*
  * LO "FD"s are indexes into the cookies array.
@@ -216,7 +222,7 @@ lo_lseek(PG_FUNCTION_ARGS)
 	int32		fd = PG_GETARG_INT32(0);
 	int32		offset = PG_GETARG_INT32(1);
 	int32		whence = PG_GETARG_INT32(2);
-	int			status;
+	int64		status;
 
 	if (fd < 0 || fd >= cookies_size || cookies[fd] == NULL)
 		ereport(ERROR,
@@ -225,7 +231,33 @@ lo_lseek(PG_FUNCTION_ARGS)
 
 	status = inv_seek(cookies[fd], offset, whence);
 
-	PG_RETURN_INT32(status);
+	/* guard against result overflow */
+	if (status != (int32) status)
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("lo_lseek result out of range for large-object descriptor %d",
+						fd),
+				 errhint("Use lo_lseek64 for large objects bigger than 2GB.")));
+
+	PG_RETURN_INT32((int32) status);
+}
+
+Datum
+lo_lseek64(PG_FUNCTION_ARGS)
+{
+	int32		fd = PG_GETARG_INT32(0);
+	int64		offset = PG_GETARG_INT64(1);
+	int32		whence = PG_GETARG_INT32(2);
+	int64		status;
+
+	if (fd < 0 || fd >= cookies_size || cookies[fd] == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("invalid large-object descriptor: %d", fd)));
+
+	status = inv_seek(cookies[fd], offset, whence);
+
+	PG_RETURN_INT64(status);
 }
 
 Datum
@@ -262,6 +294,30 @@ lo_create(PG_FUNCTION_ARGS)
 
 Datum
 lo_tell(PG_FUNCTION_ARGS)
+{
+	int32		fd = PG_GETARG_INT32(0);
+	int64		offset;
+
+	if (fd < 0 || fd >= cookies_size || cookies[fd] == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("invalid large-object descriptor: %d", fd)));
+
+	offset = inv_tell(cookies[fd]);
+
+	/* guard against result overflow */
+	if (offset != (int32) offset)
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("lo_tell result out of range for large-object descriptor %d",
+						fd),
+				 errhint("Use lo_tell64 for large objects bigger than 2GB.")));
+
+	PG_RETURN_INT32((int32) offset);
+}
+
+Datum
+lo_tell64(PG_FUNCTION_ARGS)
 {
 	int32		fd = PG_GETARG_INT32(0);
 
@@ -270,7 +326,7 @@ lo_tell(PG_FUNCTION_ARGS)
 				(errcode(ERRCODE_UNDEFINED_OBJECT),
 				 errmsg("invalid large-object descriptor: %d", fd)));
 
-	PG_RETURN_INT32(inv_tell(cookies[fd]));
+	PG_RETURN_INT64(inv_tell(cookies[fd]));
 }
 
 Datum
@@ -379,7 +435,7 @@ lo_import_internal(text *filename, Oid lobjOid)
 	File		fd;
 	int			nbytes,
 				tmp;
-	char		buf[BUFSIZE];
+	char	   *buf;
 	char		fnamebuf[MAXPGPATH];
 	LargeObjectDesc *lobj;
 	Oid			oid;
@@ -415,11 +471,13 @@ lo_import_internal(text *filename, Oid lobjOid)
 	 */
 	lobj = inv_open(oid, INV_WRITE, fscxt);
 
+	buf = palloc(BUFSIZE);
 	while ((nbytes = FileRead(fd, buf, BUFSIZE)) > 0)
 	{
 		tmp = inv_write(lobj, buf, nbytes);
 		Assert(tmp == nbytes);
 	}
+	pfree(buf);
 
 	if (nbytes < 0)
 		ereport(ERROR,
@@ -445,7 +503,7 @@ lo_export(PG_FUNCTION_ARGS)
 	File		fd;
 	int			nbytes,
 				tmp;
-	char		buf[BUFSIZE];
+	char	   *buf;
 	char		fnamebuf[MAXPGPATH];
 	LargeObjectDesc *lobj;
 	mode_t		oumask;
@@ -486,6 +544,7 @@ lo_export(PG_FUNCTION_ARGS)
 	/*
 	 * read in from the inversion file and write to the filesystem
 	 */
+	buf = palloc(BUFSIZE);
 	while ((nbytes = inv_read(lobj, buf, BUFSIZE)) > 0)
 	{
 		tmp = FileWrite(fd, buf, nbytes);
@@ -495,6 +554,7 @@ lo_export(PG_FUNCTION_ARGS)
 					 errmsg("could not write server file \"%s\": %m",
 							fnamebuf)));
 	}
+	pfree(buf);
 
 	FileClose(fd);
 	inv_close(lobj);
@@ -506,17 +566,24 @@ lo_export(PG_FUNCTION_ARGS)
  * lo_truncate -
  *	  truncate a large object to a specified length
  */
-Datum
-lo_truncate(PG_FUNCTION_ARGS)
+static void
+lo_truncate_internal(int32 fd, int64 len)
 {
-	int32		fd = PG_GETARG_INT32(0);
-	int32		len = PG_GETARG_INT32(1);
-
 	if (fd < 0 || fd >= cookies_size || cookies[fd] == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_UNDEFINED_OBJECT),
 				 errmsg("invalid large-object descriptor: %d", fd)));
 
+	/*
+	 * use errmsg_internal here because we don't want to expose INT64_FORMAT
+	 * in translatable strings; doing better is not worth the trouble
+	 */
+	if (len < 0 || len > MAX_LARGE_OBJECT_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg_internal("invalid large object truncation target: " INT64_FORMAT,
+								 len)));
+
 	/* Permission checks */
 	if (!lo_compat_privileges &&
 		pg_largeobject_aclcheck_snapshot(cookies[fd]->id,
@@ -529,7 +596,25 @@ lo_truncate(PG_FUNCTION_ARGS)
 						cookies[fd]->id)));
 
 	inv_truncate(cookies[fd], len);
+}
+
+Datum
+lo_truncate(PG_FUNCTION_ARGS)
+{
+	int32		fd = PG_GETARG_INT32(0);
+	int32		len = PG_GETARG_INT32(1);
+
+	lo_truncate_internal(fd, len);
+	PG_RETURN_INT32(0);
+}
+
+Datum
+lo_truncate64(PG_FUNCTION_ARGS)
+{
+	int32		fd = PG_GETARG_INT32(0);
+	int64		len = PG_GETARG_INT64(1);
 
+	lo_truncate_internal(fd, len);
 	PG_RETURN_INT32(0);
 }
 
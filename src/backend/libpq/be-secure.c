@@ -45,6 +45,13 @@
  *	  amounts of data are sent with the same session key, the
  *	  session keys are periodically renegotiated.
  *
+ *	  Every connection is served by a new backend process, so a
+ *	  session cache kept in process memory would never be hit.
+ *	  Sessions are instead resumed with RFC 5077 session tickets,
+ *	  which the client keeps: the ticket keys are generated when the
+ *	  postmaster creates the SSL context, so every backend shares
+ *	  them, and tickets stay valid until the server restarts.
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -69,9 +76,13 @@
 #if SSLEAY_VERSION_NUMBER >= 0x0907000L
 #include <openssl/conf.h>
 #endif
+#if SSLEAY_VERSION_NUMBER >= 0x0090800fL && !defined(OPENSSL_NO_ECDH)
+#include <openssl/ec.h>
+#endif
 #endif   /* USE_SSL */
 
 #include "libpq/libpq.h"
+#include "pgstat.h"
 #include "tcop/tcopprot.h"
 
 
@@ -87,6 +98,7 @@ static DH  *load_dh_buffer(const char *, size_t);
 static DH  *tmp_dh_cb(SSL *s, int is_export, int keylength);
 static int	verify_cb(int, X509_STORE_CTX *);
 static void info_cb(const SSL *ssl, int type, int args);
+static void initialize_ecdh(void);
 static void initialize_SSL(void);
 static int	open_server_SSL(Port *);
 static void close_SSL(Port *);
@@ -108,6 +120,16 @@ static bool ssl_loaded_verify_locations = false;
 /* GUC variable controlling SSL cipher list */
 char	   *SSLCipherSuites = NULL;
 
+/* GUC variable for default ECDH curve */
+char	   *SSLECDHCurve;
+
+/* GUC variable: if false, prefer client ciphers */
+bool		SSLPreferServerCiphers;
+
+/* GUC variables controlling session resumption */
+bool		SSLSessionTickets = true;
+int			SSLSessionTimeout = 300;	/* seconds */
+
 /* ------------------------------------------------------------ */
 /*						 Hardcoded values						*/
 /* ------------------------------------------------------------ */
@@ -713,6 +735,32 @@ info_cb(const SSL *ssl, int type, int args)
 	}
 }
 
+/*
+ *	Set up the curve for ephemeral ECDH key exchange.
+ */
+static void
+initialize_ecdh(void)
+{
+#if SSLEAY_VERSION_NUMBER >= 0x0090800fL && !defined(OPENSSL_NO_ECDH)
+	EC_KEY	   *ecdh;
+	int			nid;
+
+	nid = OBJ_sn2nid(SSLECDHCurve);
+	if (!nid)
+		ereport(FATAL,
+				(errmsg("ECDH: unrecognized curve name: %s", SSLECDHCurve)));
+
+	ecdh = EC_KEY_new_by_curve_name(nid);
+	if (!ecdh)
+		ereport(FATAL,
+				(errmsg("ECDH: could not create key")));
+
+	SSL_CTX_set_options(SSL_context, SSL_OP_SINGLE_ECDH_USE);
+	SSL_CTX_set_tmp_ecdh(SSL_context, ecdh);
+	EC_KEY_free(ecdh);
+#endif
+}
+
 /*
  *	Initialize global SSL context.
  */
@@ -792,10 +840,33 @@ initialize_SSL(void)
 	SSL_CTX_set_tmp_dh_callback(SSL_context, tmp_dh_cb);
 	SSL_CTX_set_options(SSL_context, SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2);
 
+	/* set up ephemeral ECDH keys, which are much cheaper than DH */
+	initialize_ecdh();
+
 	/* set up the allowed cipher list */
 	if (SSL_CTX_set_cipher_list(SSL_context, SSLCipherSuites) != 1)
 		elog(FATAL, "could not set the cipher list (no valid ciphers available)");
 
+	/* Let server choose order */
+	if (SSLPreferServerCiphers)
+		SSL_CTX_set_options(SSL_context, SSL_OP_CIPHER_SERVER_PREFERENCE);
+
+	/*
+	 * Set up session resumption.  The per-process session cache is useless,
+	 * see above; resumption relies on tickets alone.  The session ID context
+	 * must be set for sessions to be resumable when client certificates are
+	 * verified.
+	 */
+	SSL_CTX_set_session_cache_mode(SSL_context, SSL_SESS_CACHE_OFF);
+	SSL_CTX_set_session_id_context(SSL_context,
+								   (unsigned char *) "PostgreSQL",
+								   strlen("PostgreSQL"));
+	SSL_CTX_set_timeout(SSL_context, SSLSessionTimeout);
+#ifdef SSL_OP_NO_TICKET
+	if (!SSLSessionTickets)
+		SSL_CTX_set_options(SSL_context, SSL_OP_NO_TICKET);
+#endif
+
 	/*
 	 * Attempt to load CA store, so we can verify client certificates if
 	 * needed.
@@ -964,6 +1035,8 @@ aloop:
 
 	port->count = 0;
 
+	pgstat_count_ssl_handshake(SSL_session_reused(port->ssl));
+
 	/* get client certificate, if available. */
 	port->peer = SSL_get_peer_certificate(port->ssl);
 	if (port->peer == NULL)
@@ -57,6 +57,7 @@
  *		pq_flush		- flush pending output
  *		pq_flush_if_writable - flush pending output if writable without blocking
  *		pq_getbyte_if_available - get a byte if available without blocking
+ *		pq_startcompression - compress all further traffic with the client
  *
  * message-level I/O (and old-style-COPY-OUT cruft):
  *		pq_putmessage	- send a normal message (suppressed in COPY OUT mode)
@@ -76,6 +77,9 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
 #include <netdb.h>
 #include <netinet/in.h>
 #ifdef HAVE_NETINET_TCP_H
@@ -88,10 +92,14 @@
 #ifdef WIN32_ONLY_COMPILER		/* mstcpip.h is missing on mingw */
 #include <mstcpip.h>
 #endif
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include "libpq/ip.h"
 #include "libpq/libpq.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
@@ -101,6 +109,8 @@
  */
 int			Unix_socket_permissions;
 char	   *Unix_socket_group;
+int			client_send_buffer_size = 64;	/* in kilobytes */
+int			max_compression_level = 6;
 
 
 /* Where the Unix socket file is */
@@ -110,11 +120,12 @@ static char sock_path[MAXPGPATH];
 /*
  * Buffers for low-level I/O.
  *
- * The receive buffer is fixed size. Send buffer is usually 8k, but can be
- * enlarged by pq_putmessage_noblock() if the message doesn't fit otherwise.
+ * The receive buffer is fixed size. Send buffer is client_send_buffer_size
+ * kilobytes, but can be enlarged by pq_putmessage_noblock() if the message
+ * doesn't fit otherwise.  Data at least as large as the send buffer is not
+ * copied into it, but sent straight from the caller's memory.
  */
 
-#define PQ_SEND_BUFFER_SIZE 8192
 #define PQ_RECV_BUFFER_SIZE 8192
 
 static char *PqSendBuffer;
@@ -126,6 +137,27 @@ static char PqRecvBuffer[PQ_RECV_BUFFER_SIZE];
 static int	PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+#ifdef HAVE_LIBZ
+/*
+ * Once pq_startcompression() has been called, everything passes through a
+ * zlib stream in each direction.  The buffers above then hold uncompressed
+ * data; these hold the compressed data on its way to or from the socket.
+ */
+#define PQ_ZBUFFER_SIZE 8192
+
+static z_stream *PqZSendStream;	/* NULL if not compressing */
+static z_stream *PqZRecvStream;
+static char *PqZSendBuffer;
+static int	PqZSendPointer;		/* Next index to store a byte in PqZSendBuffer */
+static int	PqZSendStart;		/* Next index to send a byte in PqZSendBuffer */
+static bool PqZSendFlushed;		/* all input so far is in PqZSendBuffer? */
+static char *PqZRecvBuffer;
+static int	PqZRecvPointer;		/* Next index to inflate from PqZRecvBuffer */
+static int	PqZRecvLength;		/* End of data available in PqZRecvBuffer */
+#endif
+
+static int	last_reported_send_errno = 0;
+
 /*
  * Message status
  */
@@ -137,8 +169,16 @@ static bool DoingCopyOut;
 static void pq_close(int code, Datum arg);
 static int	internal_putbytes(const char *s, size_t len);
 static int	internal_flush(void);
+static int	internal_send(const char *s, size_t len);
+static int	internal_send_failed(void);
+static int	internal_recv(char *ptr, size_t len);
 static void pq_set_nonblocking(bool nonblocking);
 
+#ifdef HAVE_LIBZ
+static int	internal_send_compressed(const char *s, size_t len);
+static int	internal_recv_compressed(char *ptr, size_t len);
+#endif
+
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(unsigned short portNumber, char *unixSocketName);
 static int	Setup_AF_UNIX(void);
@@ -152,7 +192,7 @@ static int	Setup_AF_UNIX(void);
 void
 pq_init(void)
 {
-	PqSendBufferSize = PQ_SEND_BUFFER_SIZE;
+	PqSendBufferSize = client_send_buffer_size * 1024;
 	PqSendBuffer = MemoryContextAlloc(TopMemoryContext, PqSendBufferSize);
 	PqSendPointer = PqSendStart = PqRecvPointer = PqRecvLength = 0;
 	PqCommBusy = false;
@@ -813,8 +853,10 @@ pq_recvbuf(void)
 	{
 		int			r;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
-						PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		pgstat_report_wait_start(WAIT_EVENT_CLIENT_READ);
+		r = internal_recv(PqRecvBuffer + PqRecvLength,
+						  PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		pgstat_report_wait_end();
 
 		if (r < 0)
 		{
@@ -877,6 +919,23 @@ pq_peekbyte(void)
 	return (unsigned char) PqRecvBuffer[PqRecvPointer];
 }
 
+/* --------------------------------
+ *		pq_peekbufferedinput	- peek at all buffered input
+ *
+ *		Sets *s to point to whatever input has been received from the client
+ *		but not consumed yet, and returns its length, without blocking and
+ *		without advancing the pointer.  This is for handing the connection
+ *		over to another process, which must also get the buffered data; the
+ *		caller can discard it with pq_discardbytes() afterwards.
+ * --------------------------------
+ */
+int
+pq_peekbufferedinput(const char **s)
+{
+	*s = PqRecvBuffer + PqRecvPointer;
+	return PqRecvLength - PqRecvPointer;
+}
+
 /* --------------------------------
  *		pq_getbyte_if_available - get a single byte from connection,
  *			if available
@@ -899,7 +958,7 @@ pq_getbyte_if_available(unsigned char *c)
 	/* Put the socket into non-blocking mode */
 	pq_set_nonblocking(true);
 
-	r = secure_read(MyProcPort, c, 1);
+	r = internal_recv((char *) c, 1);
 	if (r < 0)
 	{
 		/*
@@ -931,6 +990,107 @@ pq_getbyte_if_available(unsigned char *c)
 	return r;
 }
 
+/* --------------------------------
+ *		internal_recv - read some bytes from the client
+ *
+ * Returns the number of bytes read, 0 on EOF, or -1 with errno set, just
+ * like secure_read().  If compression is active the bytes are inflated from
+ * the compressed input first, and a corrupt stream is reported and then
+ * treated as EOF.
+ * --------------------------------
+ */
+static int
+internal_recv(char *ptr, size_t len)
+{
+#ifdef HAVE_LIBZ
+	if (PqZRecvStream != NULL)
+		return internal_recv_compressed(ptr, len);
+#endif
+	return secure_read(MyProcPort, ptr, len);
+}
+
+#ifdef HAVE_LIBZ
+static int
+internal_recv_compressed(char *ptr, size_t len)
+{
+	z_stream   *zs = PqZRecvStream;
+
+	for (;;)
+	{
+		int			rc;
+		int			r;
+
+		/*
+		 * Inflate whatever is buffered, even if that is nothing: zlib may
+		 * still hold output that did not fit last time.
+		 */
+		zs->next_in = (Bytef *) (PqZRecvBuffer + PqZRecvPointer);
+		zs->avail_in = PqZRecvLength - PqZRecvPointer;
+		zs->next_out = (Bytef *) ptr;
+		zs->avail_out = len;
+		rc = inflate(zs, Z_SYNC_FLUSH);
+		PqZRecvPointer = PqZRecvLength - zs->avail_in;
+		if (rc != Z_OK && rc != Z_BUF_ERROR)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("could not decompress data from client: %s",
+							zs->msg ? zs->msg : "unexpected end of stream")));
+			return 0;
+		}
+		if (zs->avail_out < len)
+			return len - zs->avail_out;
+
+		/* No output means all the input was used up; read some more */
+		r = secure_read(MyProcPort, PqZRecvBuffer, PQ_ZBUFFER_SIZE);
+		if (r <= 0)
+			return r;
+		PqZRecvPointer = 0;
+		PqZRecvLength = r;
+	}
+}
+#endif   /* HAVE_LIBZ */
+
+/* --------------------------------
+ *		pq_startcompression - compress all further traffic with the client
+ *
+ * Called once the client has been told that compression is accepted; the
+ * client switches over as soon as it has read that message, and so must we.
+ * level is a zlib compression level, 1 to 9.
+ * --------------------------------
+ */
+void
+pq_startcompression(int level)
+{
+#ifdef HAVE_LIBZ
+	z_stream   *send_stream;
+	z_stream   *recv_stream;
+
+	Assert(PqZSendStream == NULL);
+	Assert(PqSendStart == PqSendPointer);
+
+	send_stream = MemoryContextAllocZero(TopMemoryContext, sizeof(z_stream));
+	recv_stream = MemoryContextAllocZero(TopMemoryContext, sizeof(z_stream));
+	if (deflateInit(send_stream, level) != Z_OK ||
+		inflateInit(recv_stream) != Z_OK)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("could not initialize compression: %s",
+						send_stream->msg ? send_stream->msg :
+						recv_stream->msg ? recv_stream->msg :
+						"out of memory")));
+
+	PqZSendBuffer = MemoryContextAlloc(TopMemoryContext, PQ_ZBUFFER_SIZE);
+	PqZRecvBuffer = MemoryContextAlloc(TopMemoryContext, PQ_ZBUFFER_SIZE);
+	PqZSendPointer = PqZSendStart = PqZRecvPointer = PqZRecvLength = 0;
+	PqZSendFlushed = true;
+	PqZRecvStream = recv_stream;
+	PqZSendStream = send_stream;
+#else
+	elog(FATAL, "compression is not supported by this build");
+#endif
+}
+
 /* --------------------------------
  *		pq_getbytes		- get a known number of bytes from connection
  *
@@ -969,7 +1129,7 @@ pq_getbytes(char *s, size_t len)
  *		returns 0 if OK, EOF if trouble
  * --------------------------------
  */
-static int
+int
 pq_discardbytes(size_t len)
 {
 	size_t		amount;
@@ -1151,6 +1311,22 @@ internal_putbytes(const char *s, size_t len)
 {
 	size_t		amount;
 
+	/*
+	 * Copying data that does not fit in the buffer anyway would only cut it
+	 * into buffer-sized sends; send it along with the buffered data instead.
+	 */
+	if (len >= (size_t) PqSendBufferSize &&
+		len > (size_t) (PqSendBufferSize - PqSendPointer))
+	{
+		int			r;
+
+		pq_set_nonblocking(false);
+		pgstat_report_wait_start(WAIT_EVENT_CLIENT_WRITE);
+		r = internal_send(s, len);
+		pgstat_report_wait_end();
+		return r;
+	}
+
 	while (len > 0)
 	{
 		/* If buffer is full, then flush it out */
@@ -1202,16 +1378,62 @@ pq_flush(void)
 static int
 internal_flush(void)
 {
-	static int	last_reported_send_errno = 0;
+	int			r;
 
-	char	   *bufptr = PqSendBuffer + PqSendStart;
-	char	   *bufend = PqSendBuffer + PqSendPointer;
+	pgstat_report_wait_start(WAIT_EVENT_CLIENT_WRITE);
+	r = internal_send(NULL, 0);
+	pgstat_report_wait_end();
+	return r;
+}
 
-	while (bufptr < bufend)
+/* --------------------------------
+ *		internal_send - send pending output, then len bytes at s
+ *
+ * The bytes at s are sent without being copied into the send buffer.  On a
+ * plain connection they are gathered with the pending output into as few
+ * writev() calls as possible; over SSL, they are simply written after it.
+ * The socket must be in blocking mode if len > 0.
+ *
+ * Returns 0 if OK (meaning everything was sent, or operation would block
+ * and the socket is in non-blocking mode), or EOF if trouble.
+ * --------------------------------
+ */
+static int
+internal_send(const char *s, size_t len)
+{
+#ifdef HAVE_LIBZ
+	if (PqZSendStream != NULL)
+		return internal_send_compressed(s, len);
+#endif
+
+	while (PqSendStart < PqSendPointer || len > 0)
 	{
+		size_t		pending = PqSendPointer - PqSendStart;
 		int			r;
 
-		r = secure_write(MyProcPort, bufptr, bufend - bufptr);
+#ifndef WIN32
+		bool		gather = (len > 0 && pending > 0);
+
+#ifdef USE_SSL
+		if (MyProcPort->ssl)
+			gather = false;
+#endif
+		if (gather)
+		{
+			struct iovec iov[2];
+
+			iov[0].iov_base = PqSendBuffer + PqSendStart;
+			iov[0].iov_len = pending;
+			iov[1].iov_base = (char *) s;
+			iov[1].iov_len = len;
+			r = writev(MyProcPort->sock, iov, 2);
+		}
+		else
+#endif
+		if (pending > 0)
+			r = secure_write(MyProcPort, PqSendBuffer + PqSendStart, pending);
+		else
+			r = secure_write(MyProcPort, (char *) s, len);
 
 		if (r <= 0)
 		{
@@ -1225,46 +1447,165 @@ internal_flush(void)
 			if (errno == EAGAIN ||
 				errno == EWOULDBLOCK)
 			{
+				Assert(len == 0);
 				return 0;
 			}
 
-			/*
-			 * Careful: an ereport() that tries to write to the client would
-			 * cause recursion to here, leading to stack overflow and core
-			 * dump!  This message must go *only* to the postmaster log.
-			 *
-			 * If a client disconnects while we're in the midst of output, we
-			 * might write quite a bit of data before we get to a safe query
-			 * abort point.  So, suppress duplicate log messages.
-			 */
-			if (errno != last_reported_send_errno)
+			return internal_send_failed();
+		}
+
+		last_reported_send_errno = 0;	/* reset after any successful send */
+
+		/* What was sent comes out of the buffered data first */
+		if ((size_t) r < pending)
+			PqSendStart += r;
+		else
+		{
+			PqSendStart = PqSendPointer = 0;
+			s += r - pending;
+			len -= r - pending;
+		}
+	}
+
+	PqSendStart = PqSendPointer = 0;
+	return 0;
+}
+
+#ifdef HAVE_LIBZ
+/*
+ * internal_send for a compressed connection.  The pending output and then
+ * the bytes at s are deflated into PqZSendBuffer, which is written out
+ * whenever it fills up; once all input is in, the stream is flushed so that
+ * the client can decode everything sent so far.
+ */
+static int
+internal_send_compressed(const char *s, size_t len)
+{
+	z_stream   *zs = PqZSendStream;
+
+	for (;;)
+	{
+		int			r;
+
+		/* Compress as much as there is room for */
+		while (PqZSendPointer < PQ_ZBUFFER_SIZE &&
+			   (PqSendStart < PqSendPointer || len > 0 || !PqZSendFlushed))
+		{
+			bool		from_buffer = (PqSendStart < PqSendPointer);
+			int			flush;
+			size_t		consumed;
+
+			if (from_buffer)
 			{
-				last_reported_send_errno = errno;
-				ereport(COMMERROR,
-						(errcode_for_socket_access(),
-						 errmsg("could not send data to client: %m")));
+				zs->next_in = (Bytef *) (PqSendBuffer + PqSendStart);
+				zs->avail_in = PqSendPointer - PqSendStart;
+				flush = (len > 0) ? Z_NO_FLUSH : Z_SYNC_FLUSH;
+			}
+			else
+			{
+				zs->next_in = (Bytef *) s;
+				zs->avail_in = len;
+				flush = Z_SYNC_FLUSH;
+			}
+			consumed = zs->avail_in;
+			zs->next_out = (Bytef *) (PqZSendBuffer + PqZSendPointer);
+			zs->avail_out = PQ_ZBUFFER_SIZE - PqZSendPointer;
+
+			(void) deflate(zs, flush);
+
+			consumed -= zs->avail_in;
+			PqZSendPointer = PQ_ZBUFFER_SIZE - zs->avail_out;
+			if (from_buffer)
+			{
+				PqSendStart += consumed;
+				if (PqSendStart == PqSendPointer)
+					PqSendStart = PqSendPointer = 0;
+			}
+			else
+			{
+				s += consumed;
+				len -= consumed;
 			}
 
 			/*
-			 * We drop the buffered data anyway so that processing can
-			 * continue, even though we'll probably quit soon. We also
-			 * set a flag that'll cause the next CHECK_FOR_INTERRUPTS
-			 * to terminate the connection.
+			 * A flush is only complete once deflate() has had output space
+			 * left over; otherwise it has to be called again.
 			 */
-			PqSendStart = PqSendPointer = 0;
-			ClientConnectionLost = 1;
-			InterruptPending = 1;
-			return EOF;
+			PqZSendFlushed = (flush == Z_SYNC_FLUSH && zs->avail_in == 0 &&
+							  zs->avail_out > 0);
+		}
+
+		if (PqZSendStart == PqZSendPointer)
+			break;				/* all compressed and sent */
+
+		r = secure_write(MyProcPort, PqZSendBuffer + PqZSendStart,
+						 PqZSendPointer - PqZSendStart);
+		if (r <= 0)
+		{
+			if (errno == EINTR)
+				continue;		/* Ok if we were interrupted */
+
+			/*
+			 * Ok if no data writable without blocking, and the socket is in
+			 * non-blocking mode.
+			 */
+			if (errno == EAGAIN ||
+				errno == EWOULDBLOCK)
+			{
+				Assert(len == 0);
+				return 0;
+			}
+
+			PqZSendStart = PqZSendPointer = 0;
+			return internal_send_failed();
 		}
 
 		last_reported_send_errno = 0;	/* reset after any successful send */
-		bufptr += r;
-		PqSendStart += r;
+
+		PqZSendStart += r;
+		if (PqZSendStart == PqZSendPointer)
+			PqZSendStart = PqZSendPointer = 0;
 	}
 
-	PqSendStart = PqSendPointer = 0;
 	return 0;
 }
+#endif   /* HAVE_LIBZ */
+
+/*
+ * internal_send_failed - report a failure to send data to the client
+ *
+ * Drops the pending output and returns EOF.
+ */
+static int
+internal_send_failed(void)
+{
+	/*
+	 * Careful: an ereport() that tries to write to the client would cause
+	 * recursion to here, leading to stack overflow and core dump!  This
+	 * message must go *only* to the postmaster log.
+	 *
+	 * If a client disconnects while we're in the midst of output, we might
+	 * write quite a bit of data before we get to a safe query abort point.
+	 * So, suppress duplicate log messages.
+	 */
+	if (errno != last_reported_send_errno)
+	{
+		last_reported_send_errno = errno;
+		ereport(COMMERROR,
+				(errcode_for_socket_access(),
+				 errmsg("could not send data to client: %m")));
+	}
+
+	/*
+	 * We drop the buffered data anyway so that processing can continue, even
+	 * though we'll probably quit soon. We also set a flag that'll cause the
+	 * next CHECK_FOR_INTERRUPTS to terminate the connection.
+	 */
+	PqSendStart = PqSendPointer = 0;
+	ClientConnectionLost = 1;
+	InterruptPending = 1;
+	return EOF;
+}
 
 /* --------------------------------
  *		pq_flush_if_writable - flush pending output if writable without blocking
@@ -1278,7 +1619,7 @@ pq_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (!pq_is_send_pending())
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1301,6 +1642,11 @@ pq_flush_if_writable(void)
 bool
 pq_is_send_pending(void)
 {
+#ifdef HAVE_LIBZ
+	if (PqZSendStream != NULL &&
+		(PqZSendStart < PqZSendPointer || !PqZSendFlushed))
+		return true;
+#endif
 	return (PqSendStart < PqSendPointer);
 }
 
@@ -36,11 +36,24 @@
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 
 
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+int			join_search_limit = 0;
+
+/*
+ * The join order of a relation found by block_join_search(): a tree whose
+ * leaves are the items the search started from.
+ */
+typedef struct JoinOrderNode
+{
+	RelOptInfo *rel;			/* leaf: an input item; NULL for a join */
+	struct JoinOrderNode *outer;
+	struct JoinOrderNode *inner;
+} JoinOrderNode;
 
 /* Hook for plugins to replace standard_join_search() */
 join_search_hook_type join_search_hook = NULL;
@@ -65,6 +78,10 @@ static void set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel,
 				 RangeTblEntry *rte);
 static void set_worktable_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					   RangeTblEntry *rte);
+static RelOptInfo *block_join_search(PlannerInfo *root, int levels_needed,
+				  List *initial_rels);
+static JoinOrderNode *extract_join_order(Path *path, List *items);
+static RelOptInfo *rebuild_join_order(PlannerInfo *root, JoinOrderNode *node);
 static void set_foreign_pathlist(PlannerInfo *root, RelOptInfo *rel,
 					 RangeTblEntry *rte);
 static RelOptInfo *make_rel_from_joinlist(PlannerInfo *root, List *joinlist);
@@ -1057,7 +1074,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 	{
 		/*
 		 * Consider the different orders in which we could join the rels,
-		 * using a plugin, GEQO, or the regular join search code.
+		 * using a plugin, a block-by-block search, GEQO, or the regular join
+		 * search code.
 		 *
 		 * We put the initial_rels list into a PlannerInfo field because
 		 * has_legal_joinclause() needs to look at it (ugly :-().
@@ -1066,6 +1084,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
+		else if (join_search_limit >= 2 && levels_needed > join_search_limit)
+			return block_join_search(root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
 			return geqo(root, levels_needed, initial_rels);
 		else
@@ -1170,6 +1190,220 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	return rel;
 }
 
+/*
+ * block_join_search
+ *	  Find a join order for a problem too big to search exhaustively, by
+ *	  searching exhaustively for the best way to join join_search_limit of
+ *	  its items at a time.
+ *
+ * This is "iterative dynamic programming": we run the dynamic-programming
+ * search of standard_join_search up to join_search_limit items only, pick
+ * the cheapest of the largest joins it found, and make that a single item
+ * replacing the ones it is made of.  Repeat until the problem is small
+ * enough to finish with standard_join_search.  Unlike GEQO, the result is
+ * deterministic, and since each step sees the actual costs of complete
+ * sub-joins, the plans are generally good; but a join order that only pays
+ * off when more than join_search_limit items are considered together can
+ * be missed.
+ *
+ * Each step's search is done in a temporary memory context, like a GEQO
+ * evaluation, so that memory use stays proportional to one step's search.
+ * Only the chosen join is rebuilt afterwards, outside that context, by
+ * repeating the joins along the join order of its cheapest path.
+ */
+static RelOptInfo *
+block_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	List	   *items = initial_rels;
+	RelOptInfo *rel;
+
+	Assert(root->join_rel_level == NULL);
+
+	while (list_length(items) > join_search_limit)
+	{
+		MemoryContext mycontext;
+		MemoryContext oldcxt;
+		int			savelength;
+		struct HTAB *savehash;
+		JoinOrderNode *order;
+		RelOptInfo *best = NULL;
+		List	   *newitems;
+		ListCell   *lc;
+		int			lev;
+
+		mycontext = AllocSetContextCreate(CurrentMemoryContext,
+										  "block join search",
+										  ALLOCSET_DEFAULT_MINSIZE,
+										  ALLOCSET_DEFAULT_INITSIZE,
+										  ALLOCSET_DEFAULT_MAXSIZE);
+		oldcxt = MemoryContextSwitchTo(mycontext);
+
+		/* See geqo_eval() for why this is needed */
+		savelength = list_length(root->join_rel_list);
+		savehash = root->join_rel_hash;
+		root->join_rel_hash = NULL;
+
+		/* has_legal_joinclause() looks at initial_rels */
+		root->initial_rels = items;
+		root->join_rel_level = (List **)
+			palloc0((join_search_limit + 1) * sizeof(List *));
+		root->join_rel_level[1] = items;
+
+		for (lev = 2; lev <= join_search_limit; lev++)
+		{
+			join_search_one_level(root, lev);
+
+			foreach(lc, root->join_rel_level[lev])
+				set_cheapest((RelOptInfo *) lfirst(lc));
+		}
+
+		/*
+		 * Take the cheapest join of the highest level we got to.  There can
+		 * be levels with no legal joins when special joins are involved.
+		 */
+		for (lev = join_search_limit; lev >= 2 && best == NULL; lev--)
+		{
+			foreach(lc, root->join_rel_level[lev])
+			{
+				rel = (RelOptInfo *) lfirst(lc);
+
+				if (best == NULL ||
+					rel->cheapest_total_path->total_cost <
+					best->cheapest_total_path->total_cost)
+					best = rel;
+			}
+		}
+		if (best == NULL)
+			elog(ERROR, "failed to build any joins of %d items",
+				 list_length(items));
+
+		root->join_rel_level = NULL;
+		MemoryContextSwitchTo(oldcxt);
+
+		order = extract_join_order(best->cheapest_total_path, items);
+		if (order != NULL)
+		{
+			/* Throw away the search, and rebuild just the join we want */
+			root->join_rel_list = list_truncate(root->join_rel_list,
+												savelength);
+			root->join_rel_hash = savehash;
+			MemoryContextDelete(mycontext);
+
+			best = rebuild_join_order(root, order);
+		}
+
+		/*
+		 * Else we can't tell how best was built, which can happen if it's
+		 * a dummy rel; keep the whole search in that case.  The hashtable
+		 * built during the search, if any, covers all of join_rel_list, and
+		 * if there's none a new one will be built when needed.
+		 */
+
+		/* Replace the items best is made of with best itself */
+		newitems = NIL;
+		foreach(lc, items)
+		{
+			rel = (RelOptInfo *) lfirst(lc);
+
+			if (!bms_is_subset(rel->relids, best->relids))
+				newitems = lappend(newitems, rel);
+		}
+		items = lappend(newitems, best);
+	}
+
+	if (list_length(items) == 1)
+		rel = (RelOptInfo *) linitial(items);
+	else
+	{
+		root->initial_rels = items;
+		rel = standard_join_search(root, list_length(items), items);
+	}
+
+	root->initial_rels = initial_rels;
+
+	return rel;
+}
+
+/*
+ * extract_join_order
+ *	  Find the join order of the given path, down to the given items.
+ *
+ * Returns NULL if the path contains something other than joins of rels
+ * between the items and itself.
+ */
+static JoinOrderNode *
+extract_join_order(Path *path, List *items)
+{
+	JoinOrderNode *node;
+	ListCell   *lc;
+
+	foreach(lc, items)
+	{
+		RelOptInfo *item = (RelOptInfo *) lfirst(lc);
+
+		if (bms_equal(item->relids, path->parent->relids))
+		{
+			node = (JoinOrderNode *) palloc0(sizeof(JoinOrderNode));
+			node->rel = item;
+			return node;
+		}
+	}
+
+	switch (path->pathtype)
+	{
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			{
+				JoinPath   *jpath = (JoinPath *) path;
+				JoinOrderNode *outer;
+				JoinOrderNode *inner;
+
+				outer = extract_join_order(jpath->outerjoinpath, items);
+				inner = extract_join_order(jpath->innerjoinpath, items);
+				if (outer == NULL || inner == NULL)
+					return NULL;
+				node = (JoinOrderNode *) palloc0(sizeof(JoinOrderNode));
+				node->outer = outer;
+				node->inner = inner;
+				return node;
+			}
+		case T_Material:
+			return extract_join_order(((MaterialPath *) path)->subpath, items);
+		case T_Unique:
+			return extract_join_order(((UniquePath *) path)->subpath, items);
+		default:
+			return NULL;
+	}
+}
+
+/*
+ * rebuild_join_order
+ *	  Build the join relation for a join order found by extract_join_order.
+ *
+ * make_join_rel considers all join methods and both input orders for each
+ * join, so the result has at least the path the order was extracted from.
+ */
+static RelOptInfo *
+rebuild_join_order(PlannerInfo *root, JoinOrderNode *node)
+{
+	RelOptInfo *outer;
+	RelOptInfo *inner;
+	RelOptInfo *joinrel;
+
+	if (node->rel != NULL)
+		return node->rel;
+
+	outer = rebuild_join_order(root, node->outer);
+	inner = rebuild_join_order(root, node->inner);
+	joinrel = make_join_rel(root, outer, inner);
+	if (joinrel == NULL)
+		elog(ERROR, "failed to rebuild join order");
+	set_cheapest(joinrel);
+
+	return joinrel;
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
@@ -22,6 +22,7 @@
 #include "optimizer/plancat.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
 #include "utils/selfuncs.h"
 
 
@@ -39,8 +40,27 @@ typedef struct RangeQueryClause
 	Selectivity hibound;		/* Selectivity of a var < something clause */
 } RangeQueryClause;
 
+/*
+ * Data structure describing a clause of the form "Var = pseudoconstant"
+ * that clauselist_selectivity might estimate together with others, using
+ * the functional dependencies of a group of the Var's table's columns.
+ */
+typedef struct EqualityClause
+{
+	int			clauseno;		/* position of clause in the list */
+	Index		varno;			/* rel of the Var, or 0 once processed */
+	AttrNumber	varattno;		/* column of the Var */
+} EqualityClause;
+
 static void addRangeClause(RangeQueryClause **rqlist, Node *clause,
 			   bool varonleft, bool isLTsel, Selectivity s2);
+static Selectivity dependencies_clauselist_selectivity(PlannerInfo *root,
+									List *clauses, int varRelid,
+									JoinType jointype,
+									SpecialJoinInfo *sjinfo,
+									Bitmapset **estimated);
+static Var *dependency_compatible_clause(PlannerInfo *root, Node *clause,
+							 int varRelid);
 
 
 /****************************************************************************
@@ -62,7 +82,11 @@ static void addRangeClause(RangeQueryClause **rqlist, Node *clause,
  * probabilities, and in reality they are often NOT independent.  So,
  * we want to be smarter where we can.
 
- * Currently, the only extra smarts we have is to recognize "range queries",
+ * First, if a table has functional dependency statistics for a group of its
+ * columns (see pg_statistic_ext), equality clauses on those columns are
+ * estimated together; see dependencies_clauselist_selectivity.
+ *
+ * The other extra smarts we have is to recognize "range queries",
  * such as "x > 34 AND x < 42".  Clauses are recognized as possible range
  * query components if they are restriction opclauses whose operators have
  * scalarltsel() or scalargtsel() as their restriction selectivity estimator.
@@ -98,6 +122,8 @@ clauselist_selectivity(PlannerInfo *root,
 {
 	Selectivity s1 = 1.0;
 	RangeQueryClause *rqlist = NULL;
+	Bitmapset  *estimated = NULL;
+	int			clauseno;
 	ListCell   *l;
 
 	/*
@@ -108,17 +134,28 @@ clauselist_selectivity(PlannerInfo *root,
 		return clause_selectivity(root, (Node *) linitial(clauses),
 								  varRelid, jointype, sjinfo);
 
+	/*
+	 * Estimate the clauses covered by functional dependency statistics
+	 * first; the loop below skips those.
+	 */
+	s1 = dependencies_clauselist_selectivity(root, clauses, varRelid,
+											 jointype, sjinfo, &estimated);
+
 	/*
 	 * Initial scan over clauses.  Anything that doesn't look like a potential
 	 * rangequery clause gets multiplied into s1 and forgotten. Anything that
 	 * does gets inserted into an rqlist entry.
 	 */
+	clauseno = -1;
 	foreach(l, clauses)
 	{
 		Node	   *clause = (Node *) lfirst(l);
 		RestrictInfo *rinfo;
 		Selectivity s2;
 
+		if (bms_is_member(++clauseno, estimated))
+			continue;
+
 		/* Always compute the selectivity using clause_selectivity */
 		s2 = clause_selectivity(root, clause, varRelid, jointype, sjinfo);
 
@@ -278,6 +315,262 @@ clauselist_selectivity(PlannerInfo *root,
 	return s1;
 }
 
+/*
+ * dependencies_clauselist_selectivity --- estimate correlated equality
+ * clauses for clauselist_selectivity
+ *
+ * We look for clauses comparing a column of a base table with a
+ * pseudoconstant, using an operator whose restriction estimator is eqsel.
+ * If a group of the table's columns with functional dependency statistics
+ * covers two or more of them, we apply the dependencies: if column a
+ * determines column b to degree f, then
+ *		P(a = x AND b = y) = P(a = x) * (f + (1 - f) * P(b = y))
+ * since b's value is implied by a's for a fraction f of the rows, and for
+ * the rest we assume independence as usual.  We repeatedly apply the
+ * strongest dependency among the clauses not yet accounted for.  A column
+ * whose clause has been explained by another's isn't then used to explain
+ * any others, which keeps us from going round in circles (a -> b -> a).
+ *
+ * Returns the combined selectivity of the clauses so estimated, and adds
+ * their positions in the list to *estimated; if there are none, it returns
+ * 1.0 and leaves *estimated alone.
+ */
+static Selectivity
+dependencies_clauselist_selectivity(PlannerInfo *root,
+									List *clauses,
+									int varRelid,
+									JoinType jointype,
+									SpecialJoinInfo *sjinfo,
+									Bitmapset **estimated)
+{
+	Selectivity s1 = 1.0;
+	EqualityClause *eqclauses = NULL;
+	int			neqclauses = 0;
+	int			clauseno = 0;
+	int			i;
+	ListCell   *l;
+
+	foreach(l, clauses)
+	{
+		Var		   *var = dependency_compatible_clause(root,
+													   (Node *) lfirst(l),
+													   varRelid);
+
+		if (var != NULL)
+		{
+			if (eqclauses == NULL)
+				eqclauses = (EqualityClause *)
+					palloc(list_length(clauses) * sizeof(EqualityClause));
+			eqclauses[neqclauses].clauseno = clauseno;
+			eqclauses[neqclauses].varno = var->varno;
+			eqclauses[neqclauses].varattno = var->varattno;
+			neqclauses++;
+		}
+		clauseno++;
+	}
+
+	if (neqclauses < 2)
+		return 1.0;
+
+	/* Process the clauses one rel at a time */
+	for (i = 0; i < neqclauses; i++)
+	{
+		Index		varno = eqclauses[i].varno;
+		RelOptInfo *rel;
+		ExtStatistics *best = NULL;
+		int			bestmatched = 1;
+		int			keyclause[STATISTIC_EXT_MAX_COLUMNS];
+		Selectivity keysel[STATISTIC_EXT_MAX_COLUMNS];
+		bool		active[STATISTIC_EXT_MAX_COLUMNS];
+		int			j,
+					k;
+
+		if (varno == 0)
+			continue;			/* rel already processed */
+		rel = find_base_rel(root, varno);
+
+		/* Choose the column group covering the most of the rel's clauses */
+		foreach(l, rel->extstats)
+		{
+			ExtStatistics *stat = (ExtStatistics *) lfirst(l);
+			int			nmatched = 0;
+
+			if (!stat->has_dependencies)
+				continue;
+			for (k = 0; k < stat->nkeys; k++)
+			{
+				for (j = i; j < neqclauses; j++)
+				{
+					if (eqclauses[j].varno == varno &&
+						eqclauses[j].varattno == stat->keys[k])
+					{
+						nmatched++;
+						break;
+					}
+				}
+			}
+			if (nmatched > bestmatched)
+			{
+				best = stat;
+				bestmatched = nmatched;
+			}
+		}
+
+		if (best == NULL)
+		{
+			for (j = i; j < neqclauses; j++)
+			{
+				if (eqclauses[j].varno == varno)
+					eqclauses[j].varno = 0;
+			}
+			continue;
+		}
+
+		/*
+		 * Match each column of the group with its first clause.  Any further
+		 * clauses on the same column are left for the generic code.
+		 */
+		for (k = 0; k < best->nkeys; k++)
+			keyclause[k] = -1;
+		for (j = i; j < neqclauses; j++)
+		{
+			if (eqclauses[j].varno != varno)
+				continue;
+			eqclauses[j].varno = 0;
+			for (k = 0; k < best->nkeys; k++)
+			{
+				if (best->keys[k] == eqclauses[j].varattno)
+				{
+					if (keyclause[k] < 0)
+						keyclause[k] = eqclauses[j].clauseno;
+					break;
+				}
+			}
+		}
+
+		for (k = 0; k < best->nkeys; k++)
+		{
+			active[k] = (keyclause[k] >= 0);
+			if (active[k])
+				keysel[k] = clause_selectivity(root,
+											   (Node *) list_nth(clauses,
+															  keyclause[k]),
+											   varRelid, jointype, sjinfo);
+		}
+
+		/* Apply the strongest remaining dependency until none are left */
+		for (;;)
+		{
+			float4		degree = 0.0;
+			int			implied = -1;
+			int			a,
+						b;
+
+			for (a = 0; a < best->nkeys; a++)
+			{
+				if (!active[a])
+					continue;
+				for (b = 0; b < best->nkeys; b++)
+				{
+					if (b == a || !active[b])
+						continue;
+					if (best->dependencies[a * best->nkeys + b] > degree)
+					{
+						degree = best->dependencies[a * best->nkeys + b];
+						implied = b;
+					}
+				}
+			}
+			if (implied < 0)
+				break;
+			keysel[implied] = degree + (1.0 - degree) * keysel[implied];
+			active[implied] = false;
+		}
+
+		for (k = 0; k < best->nkeys; k++)
+		{
+			if (keyclause[k] >= 0)
+			{
+				s1 *= keysel[k];
+				*estimated = bms_add_member(*estimated, keyclause[k]);
+			}
+		}
+	}
+
+	pfree(eqclauses);
+
+	return s1;
+}
+
+/*
+ * dependency_compatible_clause --- is clause usable by
+ * dependencies_clauselist_selectivity?
+ *
+ * If so, return its Var.
+ */
+static Var *
+dependency_compatible_clause(PlannerInfo *root, Node *clause, int varRelid)
+{
+	OpExpr	   *expr;
+	Node	   *left,
+			   *right;
+	Node	   *other;
+	Var		   *var;
+	RelOptInfo *rel;
+
+	if (IsA(clause, RestrictInfo))
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) clause;
+
+		if (rinfo->pseudoconstant)
+			return NULL;
+		clause = (Node *) rinfo->clause;
+	}
+
+	if (!is_opclause(clause) || list_length(((OpExpr *) clause)->args) != 2)
+		return NULL;
+	expr = (OpExpr *) clause;
+
+	left = (Node *) linitial(expr->args);
+	right = (Node *) lsecond(expr->args);
+	if (IsA(left, RelabelType))
+		left = (Node *) ((RelabelType *) left)->arg;
+	if (IsA(right, RelabelType))
+		right = (Node *) ((RelabelType *) right)->arg;
+
+	if (IsA(left, Var))
+	{
+		var = (Var *) left;
+		other = (Node *) lsecond(expr->args);
+	}
+	else if (IsA(right, Var))
+	{
+		var = (Var *) right;
+		other = (Node *) linitial(expr->args);
+	}
+	else
+		return NULL;
+
+	if (var->varlevelsup != 0 || var->varattno <= 0)
+		return NULL;
+	if (varRelid != 0 && var->varno != varRelid)
+		return NULL;
+
+	/* Check for statistics first; it's much the cheapest test to fail */
+	if (var->varno >= root->simple_rel_array_size)
+		return NULL;
+	rel = root->simple_rel_array[var->varno];
+	if (rel == NULL || rel->extstats == NIL)
+		return NULL;
+
+	if (!is_pseudo_constant_clause(other))
+		return NULL;
+	if (get_oprrest(expr->opno) != F_EQSEL)
+		return NULL;
+
+	return var;
+}
+
 /*
  * addRangeClause --- add a new range clause for clauselist_selectivity
  *
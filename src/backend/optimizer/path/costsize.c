@@ -116,11 +116,14 @@ bool		enable_indexonlyscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
+bool		enable_memoize = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_partitionwise_join = true;
 
 typedef struct
 {
@@ -133,6 +136,9 @@ static MergeScanSelCache *cached_scansel(PlannerInfo *root,
 			   PathKey *pathkey);
 static void cost_rescan(PlannerInfo *root, Path *path,
 			Cost *rescan_startup_cost, Cost *rescan_total_cost);
+static void cost_memoize_rescan(PlannerInfo *root, MaterialPath *path,
+					Cost *rescan_startup_cost, Cost *rescan_total_cost);
+static double nestloop_inner_path_rows(Path *path);
 static bool cost_qual_eval_walker(Node *node, cost_qual_eval_context *context);
 static bool adjust_semi_join(PlannerInfo *root, JoinPath *path,
 				 SpecialJoinInfo *sjinfo,
@@ -1105,8 +1111,8 @@ cost_recursive_union(Plan *runion, Plan *nrterm, Plan *rterm)
  * total, but we will also need to write and read each tuple once per
  * merge pass.	We expect about ceil(logM(r)) merge passes where r is the
  * number of initial runs formed and M is the merge order used by tuplesort.c.
- * Since the average initial run should be about twice sort_mem, we have
- *		disk traffic = 2 * relsize * ceil(logM(p / (2*sort_mem)))
+ * Since each initial run is one sort_mem's worth of tuples, we have
+ *		disk traffic = 2 * relsize * ceil(logM(p / sort_mem))
  *		cpu = comparison_cost * t * log2(t)
  *
  * If the sort is bounded (i.e., only the first k result tuples are needed)
@@ -1180,7 +1186,7 @@ cost_sort(Path *path, PlannerInfo *root,
 		 * We'll have to use a disk-based sort of all the tuples
 		 */
 		double		npages = ceil(input_bytes / BLCKSZ);
-		double		nruns = (input_bytes / sort_mem_bytes) * 0.5;
+		double		nruns = input_bytes / sort_mem_bytes;
 		double		mergeorder = tuplesort_merge_order(sort_mem_bytes);
 		double		log_runs;
 		double		npageaccesses;
@@ -1234,6 +1240,92 @@ cost_sort(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of sorting a relation that is already
+ *	  sorted by a prefix of the requested sort keys.
+ *
+ * The input is divided into groups of tuples that are equal on the first
+ * 'presorted_keys' pathkeys, and each group is sorted separately.  With G
+ * groups of t/G tuples, that takes roughly t*log2(t/G) comparisons overall
+ * rather than t*log2(t), and only the first group has to be read and sorted
+ * before the first tuple can be returned.  We also charge for comparing
+ * each input tuple's prefix columns against its group's first tuple, and a
+ * fixed amount per group for setting up its tuplesort.
+ *
+ * Arguments are as for cost_sort, except that we need both the startup and
+ * total cost of the input, and 'presorted_keys' is the number of leading
+ * pathkeys by which the input is known to be sorted.
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double tuples, int width,
+					  Cost comparison_cost, int sort_mem,
+					  double limit_tuples)
+{
+	Cost		startup_cost;
+	Cost		run_cost;
+	Cost		input_run_cost = input_total_cost - input_startup_cost;
+	Cost		group_startup_cost;
+	Cost		group_run_cost;
+	double		num_groups;
+	double		group_tuples;
+	List	   *presortedExprs = NIL;
+	ListCell   *l;
+	int			i = 0;
+	Path		sort_path;		/* dummy for result of cost_sort */
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	if (tuples < 2.0)
+		tuples = 2.0;
+
+	/* Estimate the number of groups of the presorted prefix */
+	foreach(l, pathkeys)
+	{
+		PathKey    *key = (PathKey *) lfirst(l);
+		EquivalenceMember *member;
+
+		if (i++ >= presorted_keys)
+			break;
+		member = (EquivalenceMember *) linitial(key->pk_eclass->ec_members);
+		presortedExprs = lappend(presortedExprs, member->em_expr);
+	}
+	num_groups = estimate_num_groups(root, presortedExprs, tuples);
+	group_tuples = tuples / num_groups;
+
+	/*
+	 * Cost of sorting a single group.  cost_sort charges disable_cost if
+	 * enable_sort is off; we want that counted once, not once per group.
+	 */
+	cost_sort(&sort_path, root, pathkeys, 0.0, group_tuples, width,
+			  comparison_cost, sort_mem, -1.0);
+	group_startup_cost = sort_path.startup_cost;
+	group_run_cost = sort_path.total_cost - sort_path.startup_cost;
+	if (!enable_sort)
+		group_startup_cost -= disable_cost;
+	group_startup_cost += 10.0 * cpu_tuple_cost;
+
+	/* We must read and sort the first group before returning anything */
+	startup_cost = input_startup_cost + input_run_cost / num_groups +
+		group_startup_cost;
+	if (!enable_sort)
+		startup_cost += disable_cost;
+
+	/* ... and then the rest of the groups */
+	run_cost = input_run_cost * (num_groups - 1.0) / num_groups +
+		group_run_cost +
+		(num_groups - 1.0) * (group_startup_cost + group_run_cost);
+
+	/* Checking each tuple for the start of a new group */
+	run_cost += cpu_operator_cost * tuples * presorted_keys;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * cost_merge_append
  *	  Determines and returns the cost of a MergeAppend node.
@@ -1351,6 +1443,39 @@ cost_material(Path *path,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_memoize
+ *	  Determines and returns the cost of a Material node that caches the
+ *	  results of a nestloop inner indexscan for each distinct set of outer
+ *	  values, including the cost of the first scan.
+ *
+ * 'calls' is the estimated number of scans, ie, of outer rows.  The first
+ * scan always misses the cache, so the costs stored in the path are those of
+ * the subpath plus the bookkeeping; cost_rescan estimates the average cost
+ * of the later scans, some of which find their results in the cache.
+ */
+void
+cost_memoize(MaterialPath *path, PlannerInfo *root, Path *subpath,
+			 double calls)
+{
+	double		tuples = nestloop_inner_path_rows(subpath);
+	Cost		lookup_cost;
+
+	path->cache_calls = clamp_row_est(calls);
+	path->cache_ndistinct = estimate_num_groups(root, path->cache_keys,
+												path->cache_calls);
+
+	/*
+	 * Charge cpu_operator_cost per key to hash and compare it, and, as for a
+	 * plain Material, 2x cpu_operator_cost per tuple stored.
+	 */
+	lookup_cost = cpu_operator_cost * list_length(path->cache_keys);
+
+	path->path.startup_cost = subpath->startup_cost + lookup_cost;
+	path->path.total_cost = subpath->total_cost + lookup_cost +
+		2 * cpu_operator_cost * tuples;
+}
+
 /*
  * cost_agg
  *		Determines and returns the cost of performing an Agg plan node,
@@ -1550,6 +1675,9 @@ nestloop_inner_path_rows(Path *path)
 		result = ((IndexPath *) path)->rows;
 	else if (IsA(path, BitmapHeapPath))
 		result = ((BitmapHeapPath *) path)->rows;
+	else if (IsA(path, MaterialPath) &&
+			 ((MaterialPath *) path)->cache_keys != NIL)
+		result = nestloop_inner_path_rows(((MaterialPath *) path)->subpath);
 	else if (IsA(path, AppendPath))
 	{
 		ListCell   *l;
@@ -1637,7 +1765,8 @@ cost_nestloop(NestPath *path, PlannerInfo *root, SpecialJoinInfo *sjinfo)
 		Selectivity inner_scan_frac;
 
 		/*
-		 * SEMI or ANTI join: executor will stop after first match.
+		 * SEMI or ANTI join, or unique inner rel: executor will stop after
+		 * first match.
 		 *
 		 * For an outer-rel row that has at least one match, we can expect the
 		 * inner scan to stop after a fraction 1/(match_count+1) of the inner
@@ -2329,7 +2458,8 @@ cost_hashjoin(HashPath *path, PlannerInfo *root, SpecialJoinInfo *sjinfo)
 		Selectivity inner_scan_frac;
 
 		/*
-		 * SEMI or ANTI join: executor will stop after first match.
+		 * SEMI or ANTI join, or unique inner rel: executor will stop after
+		 * first match.
 		 *
 		 * For an outer-rel row that has at least one match, we can expect the
 		 * bucket scan to stop after a fraction 1/(match_count+1) of the
@@ -2364,10 +2494,10 @@ cost_hashjoin(HashPath *path, PlannerInfo *root, SpecialJoinInfo *sjinfo)
 			clamp_row_est(inner_path_rows / virtualbuckets) * 0.05;
 
 		/* Get # of tuples that will pass the basic join */
-		if (path->jpath.jointype == JOIN_SEMI)
-			hashjointuples = outer_matched_rows;
-		else
+		if (path->jpath.jointype == JOIN_ANTI)
 			hashjointuples = outer_path_rows - outer_matched_rows;
+		else
+			hashjointuples = outer_matched_rows;
 	}
 	else
 	{
@@ -2563,6 +2693,13 @@ cost_rescan(PlannerInfo *root, Path *path,
 			break;
 		case T_Material:
 		case T_Sort:
+			if (IsA(path, MaterialPath) &&
+				((MaterialPath *) path)->cache_keys != NIL)
+			{
+				cost_memoize_rescan(root, (MaterialPath *) path,
+									rescan_startup_cost, rescan_total_cost);
+				break;
+			}
 			{
 				/*
 				 * These plan types not only materialize their results, but do
@@ -2595,6 +2732,51 @@ cost_rescan(PlannerInfo *root, Path *path,
 	}
 }
 
+/*
+ * cost_memoize_rescan
+ *	  Estimate the average cost of a rescan of a caching Material node.
+ *
+ * Of the cache_calls - 1 rescans, one per remaining distinct key value has
+ * to run the subpath; the others find their results in the cache, if it
+ * can hold the results for all the distinct values at once.  If it can't,
+ * we assume the fraction of repeat visits that hit is the fraction of the
+ * entries that fit.
+ */
+static void
+cost_memoize_rescan(PlannerInfo *root, MaterialPath *path,
+					Cost *rescan_startup_cost, Cost *rescan_total_cost)
+{
+	Path	   *subpath = path->subpath;
+	double		tuples = nestloop_inner_path_rows(subpath);
+	double		calls = path->cache_calls;
+	double		ndistinct = Max(path->cache_ndistinct, 1.0);
+	double		entry_bytes;
+	double		hit_ratio;
+	Cost		lookup_cost;
+	Cost		sub_rescan_startup;
+	Cost		sub_rescan_total;
+
+	cost_rescan(root, subpath, &sub_rescan_startup, &sub_rescan_total);
+
+	entry_bytes = relation_byte_size(Max(tuples, 1.0),
+									 subpath->parent->width);
+	if (calls > 1)
+		hit_ratio = (calls - ndistinct) / (calls - 1) *
+			Min(work_mem * 1024.0 / entry_bytes / ndistinct, 1.0);
+	else
+		hit_ratio = 0;
+	hit_ratio = Max(hit_ratio, 0.0);
+
+	lookup_cost = cpu_operator_cost * list_length(path->cache_keys);
+
+	/* A hit costs only the lookup and returning the stored tuples */
+	*rescan_startup_cost = lookup_cost +
+		(1 - hit_ratio) * sub_rescan_startup;
+	*rescan_total_cost = lookup_cost +
+		hit_ratio * cpu_operator_cost * tuples +
+		(1 - hit_ratio) * (sub_rescan_total + 2 * cpu_operator_cost * tuples);
+}
+
 
 /*
  * cost_qual_eval
@@ -2727,16 +2909,34 @@ cost_qual_eval_walker(Node *node, cost_qual_eval_context *context)
 	}
 	else if (IsA(node, ScalarArrayOpExpr))
 	{
-		/*
-		 * Estimate that the operator will be applied to about half of the
-		 * array elements before the answer is determined.
-		 */
 		ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) node;
 		Node	   *arraynode = (Node *) lsecond(saop->args);
+		Oid			hashfuncid;
+		Oid			eqfuncid;
 
 		set_sa_opfuncid(saop);
-		context->total.per_tuple += get_func_cost(saop->opfuncid) *
-			cpu_operator_cost * estimate_array_length(arraynode) * 0.5;
+		if (ExecScalarArrayOpIsHashable(saop, &hashfuncid, &eqfuncid))
+		{
+			/*
+			 * The executor will hash every array element once, and then
+			 * hash each input value and usually compare it with one element.
+			 */
+			Cost		hashcost = get_func_cost(hashfuncid) * cpu_operator_cost;
+
+			context->total.startup += hashcost *
+				estimate_array_length(arraynode);
+			context->total.per_tuple += hashcost +
+				get_func_cost(eqfuncid) * cpu_operator_cost;
+		}
+		else
+		{
+			/*
+			 * Estimate that the operator will be applied to about half of
+			 * the array elements before the answer is determined.
+			 */
+			context->total.per_tuple += get_func_cost(saop->opfuncid) *
+				cpu_operator_cost * estimate_array_length(arraynode) * 0.5;
+		}
 	}
 	else if (IsA(node, Aggref) ||
 			 IsA(node, WindowFunc))
@@ -2842,18 +3042,21 @@ cost_qual_eval_walker(Node *node, cost_qual_eval_context *context)
 
 /*
  * adjust_semi_join
- *	  Estimate how much of the inner input a SEMI or ANTI join
- *	  can be expected to scan.
+ *	  Estimate how much of the inner input a SEMI or ANTI join, or an
+ *	  inner or left join to a unique inner rel, can be expected to scan.
  *
  * In a hash or nestloop SEMI/ANTI join, the executor will stop scanning
  * inner rows as soon as it finds a match to the current outer row.
- * We should therefore adjust some of the cost components for this effect.
- * This function computes some estimates needed for these adjustments.
+ * It does the same when the inner rel is known to have at most one match
+ * for each outer row (path->inner_unique).  We should therefore adjust
+ * some of the cost components for this effect.  This function computes
+ * some estimates needed for these adjustments.
  *
  * 'path' is already filled in except for the cost fields
  * 'sjinfo' is extra info about the join for selectivity estimation
  *
- * Returns TRUE if this is a SEMI or ANTI join, FALSE if not.
+ * Returns TRUE if this is a SEMI or ANTI join or a unique-inner INNER or
+ * LEFT join, FALSE if not.
  *
  * Output parameters (set only in TRUE-result case):
  * *outer_match_frac is set to the fraction of the outer tuples that are
@@ -2880,8 +3083,10 @@ adjust_semi_join(PlannerInfo *root, JoinPath *path, SpecialJoinInfo *sjinfo,
 	List	   *joinquals;
 	ListCell   *l;
 
-	/* Fall out if it's not JOIN_SEMI or JOIN_ANTI */
-	if (jointype != JOIN_SEMI && jointype != JOIN_ANTI)
+	/* Fall out if it's not JOIN_SEMI or JOIN_ANTI, or a unique inner join */
+	if (jointype != JOIN_SEMI && jointype != JOIN_ANTI &&
+		!(path->inner_unique &&
+		  (jointype == JOIN_INNER || jointype == JOIN_LEFT)))
 		return false;
 
 	/*
@@ -2893,12 +3098,12 @@ adjust_semi_join(PlannerInfo *root, JoinPath *path, SpecialJoinInfo *sjinfo,
 	 */
 
 	/*
-	 * In an ANTI join, we must ignore clauses that are "pushed down", since
-	 * those won't affect the match logic.  In a SEMI join, we do not
-	 * distinguish joinquals from "pushed down" quals, so just use the whole
-	 * restrictinfo list.
+	 * In an ANTI or LEFT join, we must ignore clauses that are "pushed down",
+	 * since those won't affect the match logic.  In a SEMI or INNER join, we
+	 * do not distinguish joinquals from "pushed down" quals, so just use the
+	 * whole restrictinfo list.
 	 */
-	if (jointype == JOIN_ANTI)
+	if (jointype == JOIN_ANTI || jointype == JOIN_LEFT)
 	{
 		joinquals = NIL;
 		foreach(l, path->joinrestrictinfo)
@@ -2914,16 +3119,7 @@ adjust_semi_join(PlannerInfo *root, JoinPath *path, SpecialJoinInfo *sjinfo,
 		joinquals = path->joinrestrictinfo;
 
 	/*
-	 * Get the JOIN_SEMI or JOIN_ANTI selectivity of the join clauses.
-	 */
-	jselec = clauselist_selectivity(root,
-									joinquals,
-									0,
-									jointype,
-									sjinfo);
-
-	/*
-	 * Also get the normal inner-join selectivity of the join clauses.
+	 * Get the normal inner-join selectivity of the join clauses.
 	 */
 	norm_sjinfo.type = T_SpecialJoinInfo;
 	norm_sjinfo.min_lefthand = path->outerjoinpath->parent->relids;
@@ -2942,8 +3138,26 @@ adjust_semi_join(PlannerInfo *root, JoinPath *path, SpecialJoinInfo *sjinfo,
 									JOIN_INNER,
 									&norm_sjinfo);
 
+	/*
+	 * Also get the JOIN_SEMI or JOIN_ANTI selectivity of the join clauses.
+	 * With a unique inner rel, the number of matches of an outer row is
+	 * zero or one, so the fraction of outer rows having a match is just
+	 * the expected number of matches per outer row.
+	 */
+	if (jointype == JOIN_SEMI || jointype == JOIN_ANTI)
+		jselec = clauselist_selectivity(root,
+										joinquals,
+										0,
+										jointype,
+										sjinfo);
+	else
+	{
+		jselec = nselec * path->innerjoinpath->parent->rows;
+		jselec = Min(jselec, 1.0);
+	}
+
 	/* Avoid leaking a lot of ListCells */
-	if (jointype == JOIN_ANTI)
+	if (jointype == JOIN_ANTI || jointype == JOIN_LEFT)
 		list_free(joinquals);
 
 	/*
@@ -2958,7 +3172,9 @@ adjust_semi_join(PlannerInfo *root, JoinPath *path, SpecialJoinInfo *sjinfo,
 	 * indexscan.  This is because we have included all the join clauses in
 	 * the selectivity estimate, even ones used in an inner indexscan.
 	 */
-	if (jselec > 0)				/* protect against zero divide */
+	if (path->inner_unique && jointype != JOIN_SEMI && jointype != JOIN_ANTI)
+		avgmatch = 1.0;
+	else if (jselec > 0)		/* protect against zero divide */
 	{
 		avgmatch = nselec * path->innerjoinpath->parent->rows / jselec;
 		/* Clamp to sane range */
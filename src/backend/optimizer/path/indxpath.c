@@ -25,6 +25,7 @@
 #include "catalog/pg_opfamily.h"
 #include "catalog/pg_type.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
@@ -32,6 +33,7 @@
 #include "optimizer/predtest.h"
 #include "optimizer/restrictinfo.h"
 #include "optimizer/var.h"
+#include "parser/parsetree.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
 #include "utils/lsyscache.h"
@@ -70,6 +72,14 @@ typedef struct
 	Bitmapset  *clauseids;		/* quals+preds represented as a bitmapset */
 } PathClauseUsage;
 
+/* Workspace for pull_index_only_varattnos() */
+typedef struct
+{
+	Bitmapset  *varattnos;		/* attnos found so far */
+	Index		varno;			/* rel whose Vars we are collecting */
+	List	   *indexprs;		/* index expressions returnable as a whole */
+} pull_index_only_varattnos_context;
+
 
 static List *find_usable_indexes(PlannerInfo *root, RelOptInfo *rel,
 					List *clauses, List *outer_clauses,
@@ -89,7 +99,13 @@ static PathClauseUsage *classify_index_clause_usage(Path *path,
 							List **clauselist);
 static void find_indexpath_quals(Path *bitmapqual, List **quals, List **preds);
 static int	find_list_position(Node *node, List **nodelist);
-static bool check_index_only(RelOptInfo *rel, IndexOptInfo *index);
+static bool check_index_only(PlannerInfo *root, RelOptInfo *rel,
+				 IndexOptInfo *index);
+static bool is_only_baserel(PlannerInfo *root, RelOptInfo *rel);
+static void pull_index_only_varattnos(Node *node, Index varno,
+						  IndexOptInfo *index, Bitmapset **varattnos);
+static bool pull_index_only_varattnos_walker(Node *node,
+								 pull_index_only_varattnos_context *context);
 static void match_clauses_to_index(IndexOptInfo *index,
 					   List *clauses, List *outer_clauses,
 					   Relids outer_relids,
@@ -457,7 +473,7 @@ find_usable_indexes(PlannerInfo *root, RelOptInfo *rel,
 		/*
 		 * 3. Check if an index-only scan is possible.
 		 */
-		index_only_scan = check_index_only(rel, index);
+		index_only_scan = check_index_only(root, rel, index);
 
 		/*
 		 * 4. Generate an indexscan path if there are relevant restriction
@@ -1082,11 +1098,12 @@ find_list_position(Node *node, List **nodelist)
  *		Determine whether an index-only scan is possible for this index.
  */
 static bool
-check_index_only(RelOptInfo *rel, IndexOptInfo *index)
+check_index_only(PlannerInfo *root, RelOptInfo *rel, IndexOptInfo *index)
 {
 	bool		result;
 	Bitmapset  *attrs_used = NULL;
 	Bitmapset  *index_attrs = NULL;
+	bool		pred_checked;
 	ListCell   *lc;
 	int			i;
 
@@ -1098,47 +1115,79 @@ check_index_only(RelOptInfo *rel, IndexOptInfo *index)
 
 	/*
 	 * Check that all needed attributes of the relation are available from
-	 * the index.
+	 * the index.  An expression that matches one of the index's expressions
+	 * is available as a whole, since setrefs.c will replace it by a
+	 * reference to that index column; so we only count the Vars used
+	 * outside such expressions.
 	 *
-	 * XXX this is overly conservative for partial indexes, since we will
-	 * consider attributes involved in the index predicate as required even
-	 * though the predicate won't need to be checked at runtime.  (The same
-	 * is true for attributes used only in index quals, if we are certain
-	 * that the index is not lossy.)  However, it would be quite expensive
-	 * to determine that accurately at this point, so for now we take the
-	 * easy way out.
+	 * XXX this is still conservative for attributes used only in index
+	 * quals, which needn't be available if we are certain that the index is
+	 * not lossy.  However, we don't know yet which clauses will end up as
+	 * index quals, so for now we take the easy way out.
 	 */
 
+	/* Construct a bitmapset of columns stored in the index. */
+	for (i = 0; i < index->ncolumns; i++)
+	{
+		int			attno = index->indexkeys[i];
+
+		/* Expression columns are dealt with by pull_index_only_varattnos */
+		if (attno == 0)
+			continue;
+
+		index_attrs =
+			bms_add_member(index_attrs,
+						   attno - FirstLowInvalidHeapAttributeNumber);
+	}
+
 	/*
 	 * Add all the attributes needed for joins or final output.  Note: we must
 	 * look at reltargetlist, not the attr_needed data, because attr_needed
 	 * isn't computed for inheritance child rels.
+	 *
+	 * reltargetlist is flattened to bare Vars, though.  When this is the
+	 * only relation in the query, the scan plan will be given the tlist that
+	 * query_planner was called with, so we can look at that instead and
+	 * credit expressions the index can return.  That doesn't hold if a
+	 * gating Result node might be put on top of the scan.
 	 */
-	pull_varattnos((Node *) rel->reltargetlist, rel->relid, &attrs_used);
+	if (rel->reloptkind == RELOPT_BASEREL &&
+		!root->hasPseudoConstantQuals &&
+		is_only_baserel(root, rel))
+		pull_index_only_varattnos((Node *) root->scanjoin_tlist,
+								  rel->relid, index, &attrs_used);
+	else
+		pull_varattnos((Node *) rel->reltargetlist, rel->relid, &attrs_used);
+
+	/*
+	 * Add all the attributes used by restriction clauses.  A clause that is
+	 * implied by the predicate of a partial index won't be rechecked at run
+	 * time (see create_indexscan_plan, whose rules we must follow here), so
+	 * we needn't count it.  It's only worth proving that for clauses that
+	 * would otherwise add columns the index lacks.
+	 */
+	pred_checked = (index->indpred != NIL &&
+					rel->relid != root->parse->resultRelation &&
+					get_parse_rowmark(root->parse, rel->relid) == NULL);
 
-	/* Add all the attributes used by restriction clauses. */
 	foreach(lc, rel->baserestrictinfo)
 	{
-		RestrictInfo   *rinfo = (RestrictInfo *) lfirst(lc);
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		Bitmapset  *clause_attrs = NULL;
 
-		pull_varattnos((Node *) rinfo->clause, rel->relid, &attrs_used);
-	}
-
-	/* Construct a bitmapset of columns stored in the index. */
-	for (i = 0; i < index->ncolumns; i++)
-	{
-		int		attno = index->indexkeys[i];
+		pull_index_only_varattnos((Node *) rinfo->clause, rel->relid, index,
+								  &clause_attrs);
 
-		/*
-		 * For the moment, we just ignore index expressions.  It might be nice
-		 * to do something with them, later.
-		 */
-		if (attno == 0)
+		if (pred_checked &&
+			!bms_is_subset(clause_attrs, index_attrs) &&
+			!contain_mutable_functions((Node *) rinfo->clause) &&
+			predicate_implied_by(list_make1(rinfo->clause), index->indpred))
+		{
+			bms_free(clause_attrs);
 			continue;
+		}
 
-		index_attrs =
-			bms_add_member(index_attrs,
-						   attno - FirstLowInvalidHeapAttributeNumber);
+		attrs_used = bms_join(attrs_used, clause_attrs);
 	}
 
 	/* Do we have all the necessary attributes? */
@@ -1150,6 +1199,71 @@ check_index_only(RelOptInfo *rel, IndexOptInfo *index)
 	return result;
 }
 
+/*
+ * is_only_baserel
+ *		Is rel the only base relation taking part in the query?
+ */
+static bool
+is_only_baserel(PlannerInfo *root, RelOptInfo *rel)
+{
+	Index		rti;
+
+	for (rti = 1; rti < root->simple_rel_array_size; rti++)
+	{
+		RelOptInfo *brel = root->simple_rel_array[rti];
+
+		if (brel != NULL && brel != rel &&
+			brel->reloptkind == RELOPT_BASEREL)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * pull_index_only_varattnos
+ *		Like pull_varattnos, but ignore Vars appearing within a subexpression
+ *		that equals one of the index's expressions.
+ *
+ * The subexpressions are compared with equal(), the same way setrefs.c will
+ * match them against the index's targetlist.
+ */
+static void
+pull_index_only_varattnos(Node *node, Index varno, IndexOptInfo *index,
+						  Bitmapset **varattnos)
+{
+	pull_index_only_varattnos_context context;
+
+	context.varattnos = *varattnos;
+	context.varno = varno;
+	context.indexprs = index->indexprs;
+
+	(void) pull_index_only_varattnos_walker(node, &context);
+
+	*varattnos = context.varattnos;
+}
+
+static bool
+pull_index_only_varattnos_walker(Node *node,
+								 pull_index_only_varattnos_context *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == context->varno && var->varlevelsup == 0)
+			context->varattnos =
+				bms_add_member(context->varattnos,
+						 var->varattno - FirstLowInvalidHeapAttributeNumber);
+		return false;
+	}
+	if (context->indexprs != NIL && list_member(context->indexprs, node))
+		return false;
+	return expression_tree_walker(node, pull_index_only_varattnos_walker,
+								  (void *) context);
+}
+
 
 /****************************************************************************
  *				----  ROUTINES TO CHECK RESTRICTIONS  ----
@@ -1210,7 +1324,7 @@ match_clauses_to_index(IndexOptInfo *index,
 	if (clauses == NIL && outer_clauses == NIL)
 		return;					/* cannot succeed */
 
-	for (indexcol = 0; indexcol < index->ncolumns; indexcol++)
+	for (indexcol = 0; indexcol < index->nkeycolumns; indexcol++)
 	{
 		ListCell   *l;
 
@@ -1627,7 +1741,7 @@ match_pathkeys_to_index(IndexOptInfo *index, List *pathkeys,
 			if (!bms_equal(member->em_relids, index->rel->relids))
 				continue;
 
-			for (indexcol = 0; indexcol < index->ncolumns; indexcol++)
+			for (indexcol = 0; indexcol < index->nkeycolumns; indexcol++)
 			{
 				Expr	   *expr;
 
@@ -1951,7 +2065,7 @@ matches_any_index(RestrictInfo *rinfo, RelOptInfo *rel, Relids outer_relids)
 		IndexOptInfo *index = (IndexOptInfo *) lfirst(l);
 		int			indexcol;
 
-		for (indexcol = 0; indexcol < index->ncolumns; indexcol++)
+		for (indexcol = 0; indexcol < index->nkeycolumns; indexcol++)
 		{
 			if (match_clause_to_indexcol(index,
 										 indexcol,
@@ -1983,7 +2097,7 @@ eclass_matches_any_index(EquivalenceClass *ec, EquivalenceMember *em,
 		IndexOptInfo *index = (IndexOptInfo *) lfirst(l);
 		int			indexcol;
 
-		for (indexcol = 0; indexcol < index->ncolumns; indexcol++)
+		for (indexcol = 0; indexcol < index->nkeycolumns; indexcol++)
 		{
 			Oid			curFamily = index->opfamily[indexcol];
 			Oid			curCollation = index->indexcollations[indexcol];
@@ -2374,7 +2488,7 @@ relation_has_unique_index_for(PlannerInfo *root, RelOptInfo *rel,
 		 * Try to find each index column in the lists of conditions.  This is
 		 * O(N^2) or worse, but we expect all the lists to be short.
 		 */
-		for (c = 0; c < ind->ncolumns; c++)
+		for (c = 0; c < ind->nkeycolumns; c++)
 		{
 			bool		matched = false;
 			ListCell   *lc;
@@ -2450,7 +2564,7 @@ relation_has_unique_index_for(PlannerInfo *root, RelOptInfo *rel,
 		}
 
 		/* Matched all columns of this index? */
-		if (c == ind->ncolumns)
+		if (c == ind->nkeycolumns)
 			return true;
 	}
 
@@ -3209,7 +3323,7 @@ adjust_rowcompare_for_index(RowCompareExpr *clause,
 		/*
 		 * The Var side can match any column of the index.
 		 */
-		for (i = 0; i < index->ncolumns; i++)
+		for (i = 0; i < index->nkeycolumns; i++)
 		{
 			if (match_index_to_operand(varop, i, index) &&
 				get_op_opfamily_strategy(expr_op,
@@ -3218,7 +3332,7 @@ adjust_rowcompare_for_index(RowCompareExpr *clause,
 										 lfirst_oid(collids_cell)))
 				break;
 		}
-		if (i >= index->ncolumns)
+		if (i >= index->nkeycolumns)
 			break;				/* no match found */
 
 		/* Add column number to returned list */
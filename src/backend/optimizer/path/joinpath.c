@@ -17,23 +17,28 @@
 #include <math.h>
 
 #include "executor/executor.h"
+#include "foreign/fdwapi.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
+#include "optimizer/planmain.h"
 
 
 static void sort_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 					 RelOptInfo *outerrel, RelOptInfo *innerrel,
 					 List *restrictlist, List *mergeclause_list,
-					 JoinType jointype, SpecialJoinInfo *sjinfo);
+					 JoinType jointype, SpecialJoinInfo *sjinfo,
+					 bool inner_unique);
 static void match_unsorted_outer(PlannerInfo *root, RelOptInfo *joinrel,
 					 RelOptInfo *outerrel, RelOptInfo *innerrel,
 					 List *restrictlist, List *mergeclause_list,
-					 JoinType jointype, SpecialJoinInfo *sjinfo);
+					 JoinType jointype, SpecialJoinInfo *sjinfo,
+					 bool inner_unique);
 static void hash_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 					 RelOptInfo *outerrel, RelOptInfo *innerrel,
 					 List *restrictlist,
-					 JoinType jointype, SpecialJoinInfo *sjinfo);
+					 JoinType jointype, SpecialJoinInfo *sjinfo,
+					 bool inner_unique);
 static Path *best_appendrel_indexscan(PlannerInfo *root, RelOptInfo *rel,
 						 RelOptInfo *outer_rel, JoinType jointype);
 static List *select_mergejoin_clauses(PlannerInfo *root,
@@ -79,6 +84,33 @@ add_paths_to_joinrel(PlannerInfo *root,
 {
 	List	   *mergeclause_list = NIL;
 	bool		mergejoin_allowed = true;
+	bool		inner_unique;
+
+	/*
+	 * See if each outer row can match at most one inner row, in which case
+	 * the executor can stop looking for matches after the first one, as it
+	 * does anyway for SEMI and ANTI joins.  A unique-ified inner rel is
+	 * unique by construction; a unique-ified outer rel is joined to the
+	 * inner rel as in a plain inner join.
+	 */
+	switch (jointype)
+	{
+		case JOIN_SEMI:
+		case JOIN_ANTI:
+			inner_unique = false;
+			break;
+		case JOIN_UNIQUE_INNER:
+			inner_unique = true;
+			break;
+		case JOIN_UNIQUE_OUTER:
+			inner_unique = innerrel_is_unique(root, outerrel, innerrel,
+											  JOIN_INNER, restrictlist);
+			break;
+		default:
+			inner_unique = innerrel_is_unique(root, outerrel, innerrel,
+											  jointype, restrictlist);
+			break;
+	}
 
 	/*
 	 * Find potential mergejoin clauses.  We can skip this if we are not
@@ -101,7 +133,8 @@ add_paths_to_joinrel(PlannerInfo *root,
 	 */
 	if (mergejoin_allowed)
 		sort_inner_and_outer(root, joinrel, outerrel, innerrel,
-						   restrictlist, mergeclause_list, jointype, sjinfo);
+						   restrictlist, mergeclause_list, jointype, sjinfo,
+						   inner_unique);
 
 	/*
 	 * 2. Consider paths where the outer relation need not be explicitly
@@ -112,7 +145,8 @@ add_paths_to_joinrel(PlannerInfo *root,
 	 */
 	if (mergejoin_allowed)
 		match_unsorted_outer(root, joinrel, outerrel, innerrel,
-						   restrictlist, mergeclause_list, jointype, sjinfo);
+						   restrictlist, mergeclause_list, jointype, sjinfo,
+						   inner_unique);
 
 #ifdef NOT_USED
 
@@ -129,7 +163,8 @@ add_paths_to_joinrel(PlannerInfo *root,
 	 */
 	if (mergejoin_allowed)
 		match_unsorted_inner(root, joinrel, outerrel, innerrel,
-						   restrictlist, mergeclause_list, jointype, sjinfo);
+						   restrictlist, mergeclause_list, jointype, sjinfo,
+						   inner_unique);
 #endif
 
 	/*
@@ -139,7 +174,27 @@ add_paths_to_joinrel(PlannerInfo *root,
 	 */
 	if (enable_hashjoin || jointype == JOIN_FULL)
 		hash_inner_and_outer(root, joinrel, outerrel, innerrel,
-							 restrictlist, jointype, sjinfo);
+							 restrictlist, jointype, sjinfo,
+							 inner_unique);
+
+	/*
+	 * 5. If both relations are foreign tables (or joins of them) of the same
+	 * server, consider having the server do the join.  We can't do that if
+	 * any rows are to be locked, since the ForeignScan node couldn't hand
+	 * back the joined tables' rows for EvalPlanQual.  The unique-ifying join
+	 * types are private to this module, so they're not offered to the FDW.
+	 */
+	if (joinrel->fdwroutine && joinrel->fdwroutine->PlanForeignJoin &&
+		root->rowMarks == NIL &&
+		jointype != JOIN_UNIQUE_OUTER && jointype != JOIN_UNIQUE_INNER)
+	{
+		ForeignPath *fpath;
+
+		fpath = create_foreignjoin_path(root, joinrel, outerrel, innerrel,
+										jointype, sjinfo, restrictlist);
+		if (fpath)
+			add_path(joinrel, (Path *) fpath);
+	}
 }
 
 /*
@@ -196,7 +251,8 @@ sort_inner_and_outer(PlannerInfo *root,
 					 List *restrictlist,
 					 List *mergeclause_list,
 					 JoinType jointype,
-					 SpecialJoinInfo *sjinfo)
+					 SpecialJoinInfo *sjinfo,
+					 bool inner_unique)
 {
 	Path	   *outer_path;
 	Path	   *inner_path;
@@ -307,6 +363,7 @@ sort_inner_and_outer(PlannerInfo *root,
 									   joinrel,
 									   jointype,
 									   sjinfo,
+									   inner_unique,
 									   outer_path,
 									   inner_path,
 									   restrictlist,
@@ -359,7 +416,8 @@ match_unsorted_outer(PlannerInfo *root,
 					 List *restrictlist,
 					 List *mergeclause_list,
 					 JoinType jointype,
-					 SpecialJoinInfo *sjinfo)
+					 SpecialJoinInfo *sjinfo,
+					 bool inner_unique)
 {
 	JoinType	save_jointype = jointype;
 	bool		nestjoinOK;
@@ -369,6 +427,7 @@ match_unsorted_outer(PlannerInfo *root,
 	Path	   *matpath = NULL;
 	Path	   *index_cheapest_startup = NULL;
 	Path	   *index_cheapest_total = NULL;
+	Path	   *memopath = NULL;
 	ListCell   *l;
 
 	/*
@@ -445,6 +504,19 @@ match_unsorted_outer(PlannerInfo *root,
 									 &index_cheapest_startup,
 									 &index_cheapest_total);
 		}
+
+		/*
+		 * Consider caching the results of the cheapest innerjoin indexpath
+		 * for each distinct set of outer values it uses, which pays off if
+		 * the outer rows repeat them a lot.  Semi and anti joins stop
+		 * reading the inner side at the first match, which would leave the
+		 * cache entries incomplete, so don't bother for them.
+		 */
+		if (enable_memoize && index_cheapest_total != NULL &&
+			(save_jointype == JOIN_INNER || save_jointype == JOIN_LEFT))
+			memopath = (Path *)
+				create_memoize_path(root, innerrel, index_cheapest_total,
+									outerrel);
 	}
 
 	foreach(l, outerrel->pathlist)
@@ -494,6 +566,7 @@ match_unsorted_outer(PlannerInfo *root,
 										  joinrel,
 										  jointype,
 										  sjinfo,
+										  inner_unique,
 										  outerpath,
 										  inner_cheapest_total,
 										  restrictlist,
@@ -504,6 +577,7 @@ match_unsorted_outer(PlannerInfo *root,
 											  joinrel,
 											  jointype,
 											  sjinfo,
+											  inner_unique,
 											  outerpath,
 											  matpath,
 											  restrictlist,
@@ -514,6 +588,7 @@ match_unsorted_outer(PlannerInfo *root,
 											  joinrel,
 											  jointype,
 											  sjinfo,
+											  inner_unique,
 											  outerpath,
 											  inner_cheapest_startup,
 											  restrictlist,
@@ -524,6 +599,7 @@ match_unsorted_outer(PlannerInfo *root,
 											  joinrel,
 											  jointype,
 											  sjinfo,
+											  inner_unique,
 											  outerpath,
 											  index_cheapest_total,
 											  restrictlist,
@@ -535,10 +611,22 @@ match_unsorted_outer(PlannerInfo *root,
 											  joinrel,
 											  jointype,
 											  sjinfo,
+											  inner_unique,
 											  outerpath,
 											  index_cheapest_startup,
 											  restrictlist,
 											  merge_pathkeys));
+			if (memopath != NULL)
+				add_path(joinrel, (Path *)
+						 create_nestloop_path(root,
+											  joinrel,
+											  jointype,
+											  sjinfo,
+											  inner_unique,
+											  outerpath,
+											  memopath,
+											  restrictlist,
+											  merge_pathkeys));
 		}
 
 		/* Can't do anything else if outer path needs to be unique'd */
@@ -586,6 +674,7 @@ match_unsorted_outer(PlannerInfo *root,
 									   joinrel,
 									   jointype,
 									   sjinfo,
+									   inner_unique,
 									   outerpath,
 									   inner_cheapest_total,
 									   restrictlist,
@@ -678,6 +767,7 @@ match_unsorted_outer(PlannerInfo *root,
 											   joinrel,
 											   jointype,
 											   sjinfo,
+											   inner_unique,
 											   outerpath,
 											   innerpath,
 											   restrictlist,
@@ -722,6 +812,7 @@ match_unsorted_outer(PlannerInfo *root,
 												   joinrel,
 												   jointype,
 												   sjinfo,
+												   inner_unique,
 												   outerpath,
 												   innerpath,
 												   restrictlist,
@@ -762,7 +853,8 @@ hash_inner_and_outer(PlannerInfo *root,
 					 RelOptInfo *innerrel,
 					 List *restrictlist,
 					 JoinType jointype,
-					 SpecialJoinInfo *sjinfo)
+					 SpecialJoinInfo *sjinfo,
+					 bool inner_unique)
 {
 	bool		isouterjoin = IS_OUTER_JOIN(jointype);
 	List	   *hashclauses;
@@ -836,6 +928,7 @@ hash_inner_and_outer(PlannerInfo *root,
 									  joinrel,
 									  jointype,
 									  sjinfo,
+									  inner_unique,
 									  cheapest_total_outer,
 									  cheapest_total_inner,
 									  restrictlist,
@@ -846,6 +939,7 @@ hash_inner_and_outer(PlannerInfo *root,
 										  joinrel,
 										  jointype,
 										  sjinfo,
+										  inner_unique,
 										  cheapest_startup_outer,
 										  cheapest_total_inner,
 										  restrictlist,
@@ -14,10 +14,17 @@
  */
 #include "postgres.h"
 
+#include "access/heapam.h"
+#include "access/skey.h"
+#include "catalog/partition.h"
+#include "optimizer/cost.h"
 #include "optimizer/joininfo.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
+#include "optimizer/prep.h"
+#include "parser/parsetree.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 
 
 static void make_rels_by_clause_joins(PlannerInfo *root,
@@ -32,6 +39,32 @@ static bool is_dummy_rel(RelOptInfo *rel);
 static void mark_dummy_rel(RelOptInfo *rel);
 static bool restriction_is_constant_false(List *restrictlist,
 							  bool only_pushed_down);
+static void populate_joinrel_with_paths(PlannerInfo *root, RelOptInfo *rel1,
+							RelOptInfo *rel2, RelOptInfo *joinrel,
+							SpecialJoinInfo *sjinfo, List *restrictlist);
+static void try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1,
+					   RelOptInfo *rel2, RelOptInfo *joinrel,
+					   SpecialJoinInfo *sjinfo, List *restrictlist);
+static PartitionDesc get_rel_partition_desc(PlannerInfo *root,
+					   RelOptInfo *rel);
+static bool have_partkey_equijoin(RelOptInfo *rel1, RelOptInfo *rel2,
+					  PartitionDesc pdesc1, PartitionDesc pdesc2,
+					  JoinType jointype, List *restrictlist);
+static bool find_partition_members(PlannerInfo *root, RelOptInfo *rel,
+					   PartitionDesc pdesc, AppendRelInfo **members);
+static Node *adjust_child_join_attrs(Node *node, AppendRelInfo *appinfo1,
+						AppendRelInfo *appinfo2);
+static Relids adjust_child_join_relids(Relids relids,
+						 AppendRelInfo *appinfo1,
+						 AppendRelInfo *appinfo2);
+static int	member_oid_cmp(const void *a, const void *b);
+
+/* Used by find_partition_members to look up children by OID */
+typedef struct
+{
+	Oid			relid;
+	int			index;			/* subscript in the descriptor's arrays */
+} MemberOid;
 
 
 /*
@@ -595,6 +628,32 @@ make_join_rel(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
 		return joinrel;
 	}
 
+	/* Add paths to the join relation. */
+	populate_joinrel_with_paths(root, rel1, rel2, joinrel, sjinfo,
+								restrictlist);
+
+	/* Also consider joining the rels partition by partition */
+	if (enable_partitionwise_join && !is_dummy_rel(joinrel))
+		try_partitionwise_join(root, rel1, rel2, joinrel, sjinfo,
+							   restrictlist);
+
+	bms_free(joinrelids);
+
+	return joinrel;
+}
+
+
+/*
+ * populate_joinrel_with_paths
+ *	  Add paths to 'joinrel' for joining 'rel1' (the LHS, if the join is an
+ *	  outer join or semijoin) to 'rel2', with the given join info and
+ *	  restriction clauses.
+ */
+static void
+populate_joinrel_with_paths(PlannerInfo *root, RelOptInfo *rel1,
+							RelOptInfo *rel2, RelOptInfo *joinrel,
+							SpecialJoinInfo *sjinfo, List *restrictlist)
+{
 	/*
 	 * Consider paths using each rel as both outer and inner.  Depending on
 	 * the join type, a provably empty outer or inner rel might mean the join
@@ -739,10 +798,310 @@ make_join_rel(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
 			elog(ERROR, "unrecognized join type: %d", (int) sjinfo->jointype);
 			break;
 	}
+}
 
-	bms_free(joinrelids);
 
-	return joinrel;
+/*
+ * try_partitionwise_join
+ *	  Consider joining two inheritance parents one pair of matching
+ *	  partitions at a time, and add an Append of the pairwise joins to the
+ *	  paths of 'joinrel'.
+ *
+ * This works if the parents are partitioned alike (see catalog/partition.c)
+ * and the join equates their key columns, for then a row of the i'th
+ * partition of one can only join to rows of the i'th partition of the
+ * other; each of the smaller joins may well fit in memory where the whole
+ * one would not.  Every row must belong to some bounded partition, so we
+ * insist that neither parent have unbounded children, nor rows of its own,
+ * and that all the members of the appendrels be direct children; a
+ * grandchild's bounds are those of its parent, but the appendrel doesn't
+ * tell us who that was.
+ *
+ * A partition missing from one side, having been pruned away already, just
+ * contributes nothing to an inner join; but if the other side's rows must be
+ * preserved we give up, having no rel to stand in for the missing one.
+ *
+ * For now we only consider joins of two base rels.  The child joins are
+ * planned independently, and the Append is left to compete on cost with the
+ * other paths of the join.
+ */
+static void
+try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1,
+					   RelOptInfo *rel2, RelOptInfo *joinrel,
+					   SpecialJoinInfo *sjinfo, List *restrictlist)
+{
+	JoinType	jointype = sjinfo->jointype;
+	PartitionDesc pdesc1;
+	PartitionDesc pdesc2;
+	AppendRelInfo **members1;
+	AppendRelInfo **members2;
+	List	   *subpaths = NIL;
+	ListCell   *lc;
+	int			i;
+
+	/* A placeholder's evaluation level doesn't translate to children */
+	if (root->placeholder_list != NIL)
+		return;
+
+	pdesc1 = get_rel_partition_desc(root, rel1);
+	if (pdesc1 == NULL)
+		return;
+	pdesc2 = get_rel_partition_desc(root, rel2);
+	if (pdesc2 == NULL)
+		return;
+
+	if (!partition_bounds_equal(pdesc1, pdesc2) ||
+		!have_partkey_equijoin(rel1, rel2, pdesc1, pdesc2, jointype,
+							   restrictlist))
+		return;
+
+	/*
+	 * The Append must emit the join's output columns in the same positions
+	 * as each child join; that's easy to be sure of only for plain Vars.
+	 */
+	foreach(lc, joinrel->reltargetlist)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) || var->varattno == 0)
+			return;
+	}
+
+	members1 = (AppendRelInfo **)
+		palloc0(pdesc1->nbounded * sizeof(AppendRelInfo *));
+	members2 = (AppendRelInfo **)
+		palloc0(pdesc2->nbounded * sizeof(AppendRelInfo *));
+	if (!find_partition_members(root, rel1, pdesc1, members1) ||
+		!find_partition_members(root, rel2, pdesc2, members2))
+		return;
+
+	for (i = 0; i < pdesc1->nbounded; i++)
+	{
+		AppendRelInfo *appinfo1 = members1[i];
+		AppendRelInfo *appinfo2 = members2[i];
+		RelOptInfo *child1;
+		RelOptInfo *child2;
+		RelOptInfo *child_joinrel;
+		SpecialJoinInfo *child_sjinfo;
+		List	   *child_restrictlist;
+		List	   *child_tlist;
+
+		if (appinfo1 == NULL || appinfo2 == NULL)
+		{
+			if (appinfo1 != NULL &&
+				(jointype == JOIN_LEFT || jointype == JOIN_ANTI ||
+				 jointype == JOIN_FULL))
+				return;
+			if (appinfo2 != NULL && jointype == JOIN_FULL)
+				return;
+			continue;
+		}
+
+		child1 = find_base_rel(root, appinfo1->child_relid);
+		child2 = find_base_rel(root, appinfo2->child_relid);
+
+		child_sjinfo = makeNode(SpecialJoinInfo);
+		memcpy(child_sjinfo, sjinfo, sizeof(SpecialJoinInfo));
+		child_sjinfo->min_lefthand =
+			adjust_child_join_relids(sjinfo->min_lefthand, appinfo1, appinfo2);
+		child_sjinfo->min_righthand =
+			adjust_child_join_relids(sjinfo->min_righthand, appinfo1, appinfo2);
+		child_sjinfo->syn_lefthand =
+			adjust_child_join_relids(sjinfo->syn_lefthand, appinfo1, appinfo2);
+		child_sjinfo->syn_righthand =
+			adjust_child_join_relids(sjinfo->syn_righthand, appinfo1, appinfo2);
+		child_sjinfo->join_quals = (List *)
+			adjust_child_join_attrs((Node *) sjinfo->join_quals,
+									appinfo1, appinfo2);
+
+		child_restrictlist = (List *)
+			adjust_child_join_attrs((Node *) restrictlist, appinfo1, appinfo2);
+		child_tlist = (List *)
+			adjust_child_join_attrs((Node *) joinrel->reltargetlist,
+									appinfo1, appinfo2);
+
+		child_joinrel = build_child_join_rel(root, joinrel, child1, child2,
+											 child_tlist, child_sjinfo,
+											 child_restrictlist);
+		populate_joinrel_with_paths(root, child1, child2, child_joinrel,
+									child_sjinfo, child_restrictlist);
+
+		/* A provably empty pair needn't appear in the Append at all */
+		if (is_dummy_rel(child_joinrel))
+			continue;
+		if (child_joinrel->pathlist == NIL)
+			return;
+		set_cheapest(child_joinrel);
+		subpaths = lappend(subpaths, child_joinrel->cheapest_total_path);
+	}
+
+	add_path(joinrel, (Path *) create_append_path(joinrel, subpaths));
+}
+
+/*
+ * get_rel_partition_desc
+ *	  Return a copy of the partition descriptor of an inheritance parent,
+ *	  if it's of use to try_partitionwise_join; otherwise NULL.
+ */
+static PartitionDesc
+get_rel_partition_desc(PlannerInfo *root, RelOptInfo *rel)
+{
+	RangeTblEntry *rte;
+	Relation	relation;
+	PartitionDesc pdesc;
+
+	if (rel->reloptkind != RELOPT_BASEREL || rel->rtekind != RTE_RELATION)
+		return NULL;
+	rte = planner_rt_fetch(rel->relid, root);
+	if (!rte->inh)
+		return NULL;
+
+	/* We assume the parent is already locked */
+	relation = heap_open(rte->relid, NoLock);
+	pdesc = RelationGetPartitionDesc(relation);
+	if (pdesc != NULL && pdesc->nunbounded == 0 && pdesc->parentempty)
+		pdesc = copy_partition_desc(pdesc);
+	else
+		pdesc = NULL;
+	heap_close(relation, NoLock);
+
+	return pdesc;
+}
+
+/*
+ * have_partkey_equijoin
+ *	  Does the join equate the partition keys of the two rels?
+ *
+ * For an outer join or semijoin, only the join's own conditions decide
+ * which rows match; a pushed-down qual is just a filter on the result.
+ */
+static bool
+have_partkey_equijoin(RelOptInfo *rel1, RelOptInfo *rel2,
+					  PartitionDesc pdesc1, PartitionDesc pdesc2,
+					  JoinType jointype, List *restrictlist)
+{
+	ListCell   *lc;
+
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		Node	   *other;
+
+		if (jointype != JOIN_INNER && rinfo->is_pushed_down)
+			continue;
+
+		if (partition_clause_match(pdesc1, rinfo->clause, rel1->relid,
+								   (Expr **) &other) != BTEqualStrategyNumber)
+			continue;
+
+		while (other && IsA(other, RelabelType))
+			other = (Node *) ((RelabelType *) other)->arg;
+		if (other && IsA(other, Var) &&
+			((Var *) other)->varno == rel2->relid &&
+			((Var *) other)->varattno == pdesc2->keyattno &&
+			((Var *) other)->varlevelsup == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * find_partition_members
+ *	  Fill members[i] with the AppendRelInfo of the i'th bounded child of
+ *	  the parent 'rel', or NULL if it isn't in the appendrel.
+ *
+ * Returns false if the appendrel has any member that isn't either the parent
+ * itself (which we know to be empty) or one of the bounded children.
+ */
+static bool
+find_partition_members(PlannerInfo *root, RelOptInfo *rel,
+					   PartitionDesc pdesc, AppendRelInfo **members)
+{
+	Oid			parentoid = planner_rt_fetch(rel->relid, root)->relid;
+	MemberOid  *oids;
+	ListCell   *lc;
+	int			i;
+
+	oids = (MemberOid *) palloc((pdesc->nbounded + 1) * sizeof(MemberOid));
+	for (i = 0; i < pdesc->nbounded; i++)
+	{
+		oids[i].relid = pdesc->boundedoids[i];
+		oids[i].index = i;
+	}
+	qsort(oids, pdesc->nbounded, sizeof(MemberOid), member_oid_cmp);
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(lc);
+		MemberOid	key;
+		MemberOid  *match;
+
+		if (appinfo->parent_relid != rel->relid)
+			continue;
+
+		key.relid = planner_rt_fetch(appinfo->child_relid, root)->relid;
+		if (key.relid == parentoid)
+			continue;
+
+		match = (MemberOid *) bsearch(&key, oids, pdesc->nbounded,
+									  sizeof(MemberOid), member_oid_cmp);
+		if (match == NULL)
+			return false;
+		members[match->index] = appinfo;
+	}
+
+	return true;
+}
+
+/*
+ * adjust_child_join_attrs
+ *	  Translate an expression, or list of RestrictInfos, from the parents
+ *	  of a partition-wise join to a pair of their children.
+ */
+static Node *
+adjust_child_join_attrs(Node *node, AppendRelInfo *appinfo1,
+						AppendRelInfo *appinfo2)
+{
+	node = adjust_appendrel_attrs(node, appinfo1);
+	return adjust_appendrel_attrs(node, appinfo2);
+}
+
+/*
+ * adjust_child_join_relids
+ *	  Likewise for a set of relids.
+ */
+static Relids
+adjust_child_join_relids(Relids relids, AppendRelInfo *appinfo1,
+						 AppendRelInfo *appinfo2)
+{
+	Relids		result = bms_copy(relids);
+
+	if (bms_is_member(appinfo1->parent_relid, result))
+	{
+		result = bms_del_member(result, appinfo1->parent_relid);
+		result = bms_add_member(result, appinfo1->child_relid);
+	}
+	if (bms_is_member(appinfo2->parent_relid, result))
+	{
+		result = bms_del_member(result, appinfo2->parent_relid);
+		result = bms_add_member(result, appinfo2->child_relid);
+	}
+	return result;
+}
+
+/* qsort/bsearch comparator for MemberOid */
+static int
+member_oid_cmp(const void *a, const void *b)
+{
+	Oid			oid1 = ((const MemberOid *) a)->relid;
+	Oid			oid2 = ((const MemberOid *) b)->relid;
+
+	if (oid1 < oid2)
+		return -1;
+	if (oid1 > oid2)
+		return 1;
+	return 0;
 }
 
 
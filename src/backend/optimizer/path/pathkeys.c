@@ -400,6 +400,31 @@ pathkeys_contained_in(List *keys1, List *keys2)
 	return false;
 }
 
+/*
+ * pathkeys_common
+ *	  Return the number of leading pathkeys that keys1 and keys2 have in
+ *	  common.  If keys2 is sorted by keys1 only partially, this is the
+ *	  length of the prefix of keys1 that keys2 satisfies.
+ */
+int
+pathkeys_common(List *keys1, List *keys2)
+{
+	int			n = 0;
+	ListCell   *key1,
+			   *key2;
+
+	/*
+	 * As in compare_pathkeys, canonical pathkeys can be compared by pointer.
+	 */
+	forboth(key1, keys1, key2, keys2)
+	{
+		if (lfirst(key1) != lfirst(key2))
+			break;
+		n++;
+	}
+	return n;
+}
+
 /*
  * get_cheapest_path_for_pathkeys
  *	  Find the cheapest path (according to the specified criterion) that
@@ -516,6 +541,10 @@ build_index_pathkeys(PlannerInfo *root,
 		bool		nulls_first;
 		PathKey    *cpathkey;
 
+		/* INCLUDE columns don't contribute to the sort order */
+		if (i >= index->nkeycolumns)
+			break;
+
 		/* We assume we don't need to make a copy of the tlist item */
 		indexkey = indextle->expr;
 
@@ -22,11 +22,13 @@
  */
 #include "postgres.h"
 
+#include "optimizer/clauses.h"
 #include "optimizer/joininfo.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/var.h"
+#include "parser/parsetree.h"
 
 /* local functions */
 static bool join_is_removable(PlannerInfo *root, SpecialJoinInfo *sjinfo);
@@ -281,6 +283,106 @@ join_is_removable(PlannerInfo *root, SpecialJoinInfo *sjinfo)
 }
 
 
+/*
+ * innerrel_is_unique
+ *	  Check whether each row of outerrel can match at most one row of
+ *	  innerrel in a join of the given type, using the given join clauses.
+ *
+ * As in join_is_removable, we look for mergejoinable clauses equating inner
+ * columns to outer expressions, which behave like equality for some btree
+ * opclass.  The inner rel is unique for them if it's a table with a unique
+ * index on a subset of the inner columns, or a subquery whose DISTINCT or
+ * GROUP BY makes those columns distinct.  In an outer join, quals that were
+ * pushed down to the join are applied only after matching, so they can't
+ * be used.
+ */
+bool
+innerrel_is_unique(PlannerInfo *root, RelOptInfo *outerrel,
+				   RelOptInfo *innerrel, JoinType jointype,
+				   List *restrictlist)
+{
+	List	   *clause_list = NIL;
+	ListCell   *l;
+
+	/* Only base rels can be proven unique, for now */
+	if (innerrel->reloptkind != RELOPT_BASEREL)
+		return false;
+	if (innerrel->rtekind == RTE_RELATION)
+	{
+		if (innerrel->indexlist == NIL)
+			return false;
+	}
+	else if (innerrel->rtekind != RTE_SUBQUERY)
+		return false;
+
+	foreach(l, restrictlist)
+	{
+		RestrictInfo *restrictinfo = (RestrictInfo *) lfirst(l);
+
+		if (IS_OUTER_JOIN(jointype) && restrictinfo->is_pushed_down)
+			continue;
+
+		/* Ignore if it's not a mergejoinable clause */
+		if (!restrictinfo->can_join ||
+			restrictinfo->mergeopfamilies == NIL)
+			continue;			/* not mergejoinable */
+
+		/*
+		 * Check if clause has the form "outer op inner" or "inner op outer".
+		 */
+		if (!clause_sides_match_join(restrictinfo, outerrel->relids,
+									 innerrel->relids))
+			continue;			/* no good for these input relations */
+
+		clause_list = lappend(clause_list, restrictinfo);
+	}
+
+	if (clause_list == NIL)
+		return false;
+
+	if (innerrel->rtekind == RTE_RELATION)
+	{
+		/*
+		 * relation_has_unique_index_for automatically adds any usable
+		 * restriction clauses for the innerrel, so we needn't do that here.
+		 */
+		return relation_has_unique_index_for(root, innerrel, clause_list,
+											 NIL, NIL);
+	}
+	else
+	{
+		RangeTblEntry *rte = planner_rt_fetch(innerrel->relid, root);
+		List	   *colnos = NIL;
+		List	   *opids = NIL;
+
+		/*
+		 * The inner side of each clause must be a plain output column of the
+		 * subquery, as in create_unique_path.
+		 */
+		foreach(l, clause_list)
+		{
+			RestrictInfo *restrictinfo = (RestrictInfo *) lfirst(l);
+			OpExpr	   *clause = (OpExpr *) restrictinfo->clause;
+			Var		   *var;
+
+			if (restrictinfo->outer_is_left)
+				var = (Var *) get_rightop((Expr *) clause);
+			else
+				var = (Var *) get_leftop((Expr *) clause);
+
+			if (!var || !IsA(var, Var) ||
+				var->varno != innerrel->relid || var->varattno <= 0)
+				continue;
+
+			colnos = lappend_int(colnos, var->varattno);
+			opids = lappend_oid(opids, clause->opno);
+		}
+
+		return colnos != NIL &&
+			query_is_distinct_for(rte->subquery, colnos, opids);
+	}
+}
+
 /*
  * Remove the target relid from the planner's data structures, having
  * determined that there is no need to include it in the query.
@@ -19,7 +19,9 @@
 #include <limits.h>
 #include <math.h>
 
+#include "access/heapam.h"
 #include "access/skey.h"
+#include "catalog/partition.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
@@ -38,6 +40,8 @@
 #include "parser/parse_clause.h"
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
 
 
 static Plan *create_plan_recurse(PlannerInfo *root, Path *best_path);
@@ -49,6 +53,9 @@ static Plan *create_gating_plan(PlannerInfo *root, Plan *plan, List *quals);
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path);
+static PartitionPruneInfo *make_partition_prune_info(PlannerInfo *root,
+						  RelOptInfo *rel, List *subpaths);
+static bool exec_params_walker(Node *node, Bitmapset **execparams);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path);
@@ -77,6 +84,7 @@ static ForeignScan *create_foreignscan_plan(PlannerInfo *root, ForeignPath *best
 						List *tlist, List *scan_clauses);
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path,
 					 Plan *outer_plan, Plan *inner_plan);
+static void set_material_cache_keys(Material *matplan, List *nestParams);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path,
 					  Plan *outer_plan, Plan *inner_plan);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path,
@@ -121,7 +129,9 @@ static CteScan *make_ctescan(List *qptlist, List *qpqual,
 static WorkTableScan *make_worktablescan(List *qptlist, List *qpqual,
 				   Index scanrelid, int wtParam);
 static ForeignScan *make_foreignscan(List *qptlist, List *qpqual,
-				 Index scanrelid, bool fsSystemCol, FdwPlan *fdwplan);
+				 Index scanrelid, Oid serverid, List *fdw_scan_tlist,
+				 Relids relids, bool fsSystemCol, FdwPlan *fdwplan);
+static FdwPlan *make_plan_fdwplan(FdwPlan *fdwplan);
 static BitmapAnd *make_bitmap_and(List *bitmapplans);
 static BitmapOr *make_bitmap_or(List *bitmapplans);
 static NestLoop *make_nestloop(List *tlist,
@@ -298,9 +308,16 @@ create_scan_plan(PlannerInfo *root, Path *best_path)
 	/*
 	 * Extract the relevant restriction clauses from the parent relation. The
 	 * executor must apply all these restrictions during the scan, except for
-	 * pseudoconstants which we'll take care of below.
+	 * pseudoconstants which we'll take care of below.  A foreign scan of a
+	 * join relation applies the join's clauses instead.
 	 */
-	scan_clauses = rel->baserestrictinfo;
+	if (rel->reloptkind == RELOPT_JOINREL)
+	{
+		Assert(best_path->pathtype == T_ForeignScan);
+		scan_clauses = ((ForeignPath *) best_path)->joinrestrictinfo;
+	}
+	else
+		scan_clauses = rel->baserestrictinfo;
 
 	switch (best_path->pathtype)
 	{
@@ -673,6 +690,9 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 	}
 
 	plan = make_append(subplans, tlist);
+	plan->part_prune_info = make_partition_prune_info(root,
+													  best_path->path.parent,
+													  best_path->subpaths);
 
 	return (Plan *) plan;
 }
@@ -770,10 +790,119 @@ create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path)
 	}
 
 	node->mergeplans = subplans;
+	node->part_prune_info = make_partition_prune_info(root,
+													  best_path->path.parent,
+													  best_path->subpaths);
 
 	return (Plan *) node;
 }
 
+/*
+ * make_partition_prune_info
+ *	  Build the run-time pruning info for an Append or MergeAppend over the
+ *	  children of an inheritance parent, or return NULL if there's no use.
+ *
+ * Plan-time pruning (see prune_inheritance_children) and constraint exclusion
+ * have already dealt with comparisons of the partition key to constants.
+ * Here we pick up the comparisons to expressions whose values are known only
+ * when the plan is run: the parameters of a generic plan, stable functions
+ * such as now(), and the outer references of a correlated subquery (or the
+ * outputs of an initplan).  We don't try to use join clauses, not even
+ * those of a parameterized path.
+ */
+static PartitionPruneInfo *
+make_partition_prune_info(PlannerInfo *root, RelOptInfo *rel, List *subpaths)
+{
+	PartitionPruneInfo *pinfo;
+	RangeTblEntry *rte;
+	Relation	relation;
+	PartitionDesc pdesc;
+	List	   *exprs = NIL;
+	List	   *strategies = NIL;
+	Bitmapset  *execparams = NULL;
+	ListCell   *lc;
+
+	if (constraint_exclusion == CONSTRAINT_EXCLUSION_OFF ||
+		rel->reloptkind != RELOPT_BASEREL)
+		return NULL;
+	rte = planner_rt_fetch(rel->relid, root);
+	if (rte->rtekind != RTE_RELATION || !rte->inh)
+		return NULL;
+
+	/* We assume the parent is already locked */
+	relation = heap_open(rte->relid, NoLock);
+	pdesc = RelationGetPartitionDesc(relation);
+
+	if (pdesc != NULL)
+	{
+		/* Looking up the operators could free the relcache's copy */
+		pdesc = copy_partition_desc(pdesc);
+
+		foreach(lc, rel->baserestrictinfo)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+			Expr	   *other;
+			int			strategy;
+
+			/* Comparisons to constants were used at plan time */
+			strategy = partition_clause_match(pdesc, rinfo->clause,
+											  rel->relid, &other);
+			if (strategy == 0 ||
+				IsA(other, Const) ||
+				contain_var_clause((Node *) other) ||
+				contain_volatile_functions((Node *) other) ||
+				contain_subplans((Node *) other))
+				continue;
+
+			exprs = lappend(exprs, other);
+			strategies = lappend_int(strategies, strategy);
+			(void) exec_params_walker((Node *) other, &execparams);
+		}
+	}
+
+	heap_close(relation, NoLock);
+
+	if (exprs == NIL)
+		return NULL;
+
+	pinfo = makeNode(PartitionPruneInfo);
+	pinfo->relid = rte->relid;
+	foreach(lc, subpaths)
+	{
+		Path	   *subpath = (Path *) lfirst(lc);
+		RangeTblEntry *childrte = planner_rt_fetch(subpath->parent->relid,
+												   root);
+
+		pinfo->subplan_oids = lappend_oid(pinfo->subplan_oids,
+										  childrte->relid);
+	}
+	pinfo->exprs = exprs;
+	pinfo->strategies = strategies;
+	pinfo->execparams = execparams;
+
+	return pinfo;
+}
+
+/*
+ * Collect the IDs of the PARAM_EXEC Params in an expression.
+ */
+static bool
+exec_params_walker(Node *node, Bitmapset **execparams)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		if (param->paramkind == PARAM_EXEC)
+			*execparams = bms_add_member(*execparams, param->paramid);
+		return false;
+	}
+	return expression_tree_walker(node, exec_params_walker,
+								  (void *) execparams);
+}
+
 /*
  * create_result_plan
  *	  Create a Result plan for 'best_path'.
@@ -818,6 +947,14 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path)
 
 	plan = make_material(subplan);
 
+	/*
+	 * For a caching Material, note the expected number of entries; the keys
+	 * themselves are filled in by create_nestloop_plan, once it knows the
+	 * nestloop's parameters.
+	 */
+	if (best_path->cache_keys != NIL)
+		plan->numCacheEntries = (long) Max(best_path->cache_ndistinct, 1.0);
+
 	copy_path_costsize(&plan->plan, (Path *) best_path);
 
 	return plan;
@@ -1810,8 +1947,10 @@ create_worktablescan_plan(PlannerInfo *root, Path *best_path,
 
 /*
  * create_foreignscan_plan
- *	 Returns a foreignscan plan for the base relation scanned by 'best_path'
+ *	 Returns a foreignscan plan for the relation scanned by 'best_path'
  *	 with restriction clauses 'scan_clauses' and targetlist 'tlist'.
+ *	 The relation is either a base relation or a join done by the foreign
+ *	 server.
  */
 static ForeignScan *
 create_foreignscan_plan(PlannerInfo *root, ForeignPath *best_path,
@@ -1820,44 +1959,106 @@ create_foreignscan_plan(PlannerInfo *root, ForeignPath *best_path,
 	ForeignScan *scan_plan;
 	RelOptInfo *rel = best_path->path.parent;
 	Index		scan_relid = rel->relid;
-	RangeTblEntry *rte;
+	List	   *fdw_scan_tlist = NIL;
 	bool		fsSystemCol;
 	int			i;
 
-	/* it should be a base rel... */
-	Assert(scan_relid > 0);
-	Assert(rel->rtekind == RTE_RELATION);
-	rte = planner_rt_fetch(scan_relid, root);
-	Assert(rte->rtekind == RTE_RELATION);
-
 	/* Sort clauses into best execution order */
 	scan_clauses = order_qual_clauses(root, scan_clauses);
 
 	/* Reduce RestrictInfo list to bare expressions; ignore pseudoconstants */
 	scan_clauses = extract_actual_clauses(scan_clauses, false);
 
-	/* Detect whether any system columns are requested from rel */
-	fsSystemCol = false;
-	for (i = rel->min_attr; i < 0; i++)
+	/* Leave out the clauses that the FDW has the remote server check */
+	scan_clauses = list_difference_ptr(scan_clauses,
+									   best_path->fdwplan->remote_conds);
+
+	if (scan_relid > 0)
 	{
-		if (!bms_is_empty(rel->attr_needed[i - rel->min_attr]))
+		/* it should be a base rel... */
+		Assert(rel->rtekind == RTE_RELATION);
+		Assert(planner_rt_fetch(scan_relid, root)->rtekind == RTE_RELATION);
+
+		/* Detect whether any system columns are requested from rel */
+		fsSystemCol = false;
+		for (i = rel->min_attr; i < 0; i++)
 		{
-			fsSystemCol = true;
-			break;
+			if (!bms_is_empty(rel->attr_needed[i - rel->min_attr]))
+			{
+				fsSystemCol = true;
+				break;
+			}
 		}
 	}
+	else
+	{
+		/*
+		 * A join.  The scan tuples consist of the join's output columns,
+		 * followed by any other columns that the quals we check locally
+		 * need.
+		 */
+		List	   *qual_vars;
+
+		Assert(rel->reloptkind == RELOPT_JOINREL);
+		qual_vars = pull_var_clause((Node *) scan_clauses,
+									PVC_REJECT_AGGREGATES,
+									PVC_INCLUDE_PLACEHOLDERS);
+		fdw_scan_tlist = add_to_flat_tlist(NIL,
+										   get_tlist_exprs(tlist, false));
+		fdw_scan_tlist = add_to_flat_tlist(fdw_scan_tlist, qual_vars);
+		fsSystemCol = false;
+	}
 
 	scan_plan = make_foreignscan(tlist,
 								 scan_clauses,
 								 scan_relid,
+								 rel->serverid,
+								 fdw_scan_tlist,
+								 rel->relids,
 								 fsSystemCol,
-								 best_path->fdwplan);
+								 make_plan_fdwplan(best_path->fdwplan));
 
 	copy_path_costsize(&scan_plan->scan.plan, &best_path->path);
 
 	return scan_plan;
 }
 
+/*
+ * create_foreigngrouping_plan
+ *	 Returns a foreignscan plan computing the grouped and aggregated
+ *	 targetlist 'tlist' remotely, as planned by the FDW of 'rel'.  The plan
+ *	 is expected to produce 'num_groups' rows.
+ *
+ * This is used by grouping_planner() in place of the usual Agg or Group
+ * node atop a scan of the query's FROM clause.
+ */
+ForeignScan *
+create_foreigngrouping_plan(PlannerInfo *root, RelOptInfo *rel,
+							List *tlist, FdwPlan *fdwplan,
+							double num_groups)
+{
+	ForeignScan *scan_plan;
+
+	/*
+	 * The scan tuples are the final targetlist, computed remotely; setrefs.c
+	 * will turn the node's own targetlist into references to them.
+	 */
+	scan_plan = make_foreignscan(tlist,
+								 NIL,
+								 0,
+								 rel->serverid,
+								 copyObject(tlist),
+								 rel->relids,
+								 false,
+								 make_plan_fdwplan(fdwplan));
+
+	scan_plan->scan.plan.startup_cost = fdwplan->startup_cost;
+	scan_plan->scan.plan.total_cost = fdwplan->total_cost;
+	scan_plan->scan.plan.plan_rows = num_groups;
+	scan_plan->scan.plan.plan_width = rel->width;
+
+	return scan_plan;
+}
 
 /*****************************************************************************
  *
@@ -1944,6 +2145,11 @@ create_nestloop_plan(PlannerInfo *root,
 			prev = cell;
 	}
 
+	/* A caching Material on the inner side is keyed by those parameters */
+	if (IsA(inner_plan, Material) &&
+		((Material *) inner_plan)->numCacheEntries > 0)
+		set_material_cache_keys((Material *) inner_plan, nestParams);
+
 	join_plan = make_nestloop(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -1951,12 +2157,65 @@ create_nestloop_plan(PlannerInfo *root,
 							  outer_plan,
 							  inner_plan,
 							  best_path->jointype);
+	join_plan->join.inner_unique = best_path->inner_unique;
 
 	copy_path_costsize(&join_plan->join.plan, &best_path->path);
 
 	return join_plan;
 }
 
+/*
+ * set_material_cache_keys
+ *	  Key the cache of a caching Material node on the given nestloop
+ *	  parameters.
+ *
+ * If there are none, or one of them lacks a hashable equality operator, the
+ * node is left to work as a plain Material.
+ */
+static void
+set_material_cache_keys(Material *matplan, List *nestParams)
+{
+	int			numKeys = list_length(nestParams);
+	List	   *cacheKeys = NIL;
+	Oid		   *eqOperators;
+	int			i;
+	ListCell   *lc;
+
+	if (numKeys == 0)
+		return;
+
+	eqOperators = (Oid *) palloc(numKeys * sizeof(Oid));
+	i = 0;
+	foreach(lc, nestParams)
+	{
+		NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+		Node	   *paramval = (Node *) nlp->paramval;
+		Oid			keytype = exprType(paramval);
+		TypeCacheEntry *typentry;
+		Param	   *param;
+
+		typentry = lookup_type_cache(keytype, TYPECACHE_EQ_OPR);
+		if (!OidIsValid(typentry->eq_opr) ||
+			!op_hashjoinable(typentry->eq_opr, keytype))
+			return;
+
+		param = makeNode(Param);
+		param->paramkind = PARAM_EXEC;
+		param->paramid = nlp->paramno;
+		param->paramtype = keytype;
+		param->paramtypmod = exprTypmod(paramval);
+		param->paramcollid = exprCollation(paramval);
+		param->location = -1;
+
+		cacheKeys = lappend(cacheKeys, param);
+		eqOperators[i++] = typentry->eq_opr;
+	}
+
+	matplan->numCacheKeys = numKeys;
+	matplan->cacheKeys = cacheKeys;
+	matplan->cacheEqOperators = eqOperators;
+}
+
 static MergeJoin *
 create_mergejoin_plan(PlannerInfo *root,
 					  MergePath *best_path,
@@ -2233,6 +2492,7 @@ create_mergejoin_plan(PlannerInfo *root,
 							   outer_plan,
 							   inner_plan,
 							   best_path->jpath.jointype);
+	join_plan->join.inner_unique = best_path->jpath.inner_unique;
 
 	/* Costs of sort and material steps are included in path cost already */
 	copy_path_costsize(&join_plan->join.plan, &best_path->jpath.path);
@@ -2347,6 +2607,7 @@ create_hashjoin_plan(PlannerInfo *root,
 							  outer_plan,
 							  (Plan *) hash_plan,
 							  best_path->jpath.jointype);
+	join_plan->join.inner_unique = best_path->jpath.inner_unique;
 
 	copy_path_costsize(&join_plan->join.plan, &best_path->jpath.path);
 
@@ -3190,6 +3451,9 @@ static ForeignScan *
 make_foreignscan(List *qptlist,
 				 List *qpqual,
 				 Index scanrelid,
+				 Oid serverid,
+				 List *fdw_scan_tlist,
+				 Relids relids,
 				 bool fsSystemCol,
 				 FdwPlan *fdwplan)
 {
@@ -3202,12 +3466,34 @@ make_foreignscan(List *qptlist,
 	plan->lefttree = NULL;
 	plan->righttree = NULL;
 	node->scan.scanrelid = scanrelid;
+	node->fs_server = serverid;
+	node->fdw_scan_tlist = fdw_scan_tlist;
+	node->fs_relids = bms_copy(relids);
 	node->fsSystemCol = fsSystemCol;
 	node->fdwplan = fdwplan;
 
 	return node;
 }
 
+/*
+ * The FdwPlan of a finished plan only carries the FDW's private data: its
+ * remote_conds are of no further use, and its pathkeys refer to planner data
+ * structures.
+ */
+static FdwPlan *
+make_plan_fdwplan(FdwPlan *fdwplan)
+{
+	FdwPlan    *result = makeNode(FdwPlan);
+
+	result->startup_cost = fdwplan->startup_cost;
+	result->total_cost = fdwplan->total_cost;
+	result->fdw_private = fdwplan->fdw_private;
+	result->remote_conds = NIL;
+	result->pathkeys = NIL;
+
+	return result;
+}
+
 Append *
 make_append(List *appendplans, List *tlist)
 {
@@ -3814,6 +4100,66 @@ make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree, List *pathkeys,
 					 nullsFirst, limit_tuples);
 }
 
+/*
+ * make_incremental_sort_from_pathkeys
+ *	  Create sort plan to sort according to given pathkeys, when the input
+ *	  is already sorted by the first 'presorted_keys' of them
+ *
+ * The result is an ordinary Sort node, marked to sort each group of tuples
+ * that are equal on the presorted columns separately if cost_incremental_sort
+ * thinks that is cheaper than sorting the whole input at once.
+ */
+Sort *
+make_incremental_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree,
+									List *pathkeys, int presorted_keys,
+									double limit_tuples)
+{
+	Sort	   *node;
+	Plan	   *plan;
+	Path		sort_path;		/* dummy for result of cost_incremental_sort */
+	double		fraction;
+	Cost		full_cost;
+	Cost		incr_cost;
+
+	node = make_sort_from_pathkeys(root, lefttree, pathkeys, limit_tuples);
+	plan = &node->plan;
+
+	/*
+	 * If some pathkeys were redundant, or new tlist entries had to be added
+	 * under us, the sort columns no longer line up one-to-one with the
+	 * pathkeys; just do a full sort then.
+	 */
+	if (presorted_keys <= 0 ||
+		presorted_keys >= node->numCols ||
+		node->numCols != list_length(pathkeys))
+		return node;
+
+	lefttree = plan->lefttree;
+	cost_incremental_sort(&sort_path, root, pathkeys, presorted_keys,
+						  lefttree->startup_cost, lefttree->total_cost,
+						  lefttree->plan_rows, lefttree->plan_width,
+						  0.0, work_mem, limit_tuples);
+
+	/* With a LIMIT, what matters is the cost of fetching that many rows */
+	if (limit_tuples > 0 && limit_tuples < plan->plan_rows)
+		fraction = limit_tuples / plan->plan_rows;
+	else
+		fraction = 1.0;
+	full_cost = plan->startup_cost +
+		fraction * (plan->total_cost - plan->startup_cost);
+	incr_cost = sort_path.startup_cost +
+		fraction * (sort_path.total_cost - sort_path.startup_cost);
+
+	if (incr_cost < full_cost)
+	{
+		plan->startup_cost = sort_path.startup_cost;
+		plan->total_cost = sort_path.total_cost;
+		node->numPresortedCols = presorted_keys;
+	}
+
+	return node;
+}
+
 /*
  * make_sort_from_sortclauses
  *	  Create sort plan to sort according to given sortclauses
@@ -4451,7 +4797,7 @@ ModifyTable *
 make_modifytable(CmdType operation, bool canSetTag,
 				 List *resultRelations,
 				 List *subplans, List *returningLists,
-				 List *rowMarks, int epqParam)
+				 List *rowMarks, int epqParam, bool batchInserts)
 {
 	ModifyTable *node = makeNode(ModifyTable);
 	Plan	   *plan = &node->plan;
@@ -4506,6 +4852,7 @@ make_modifytable(CmdType operation, bool canSetTag,
 	node->returningLists = returningLists;
 	node->rowMarks = rowMarks;
 	node->epqParam = epqParam;
+	node->batchInserts = batchInserts;
 
 	return node;
 }
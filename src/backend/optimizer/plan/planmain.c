@@ -97,10 +97,15 @@ query_planner(PlannerInfo *root, List *tlist,
 	RelOptInfo *final_rel;
 	Path	   *cheapestpath;
 	Path	   *sortedpath;
+	Path		sort_path;		/* dummy for result of cost_sort */
 	Index		rti;
 	double		total_pages;
 
-	/* Make tuple_fraction, limit_tuples accessible to lower-level routines */
+	/*
+	 * Make tlist, tuple_fraction, limit_tuples accessible to lower-level
+	 * routines
+	 */
+	root->scanjoin_tlist = tlist;
 	root->tuple_fraction = tuple_fraction;
 	root->limit_tuples = limit_tuples;
 
@@ -386,33 +391,87 @@ query_planner(PlannerInfo *root, List *tlist,
 	 * cheapest-total path.  Here we need consider only the behavior at the
 	 * tuple fraction point.
 	 */
-	if (sortedpath)
+	if (root->query_pathkeys == NIL ||
+		pathkeys_contained_in(root->query_pathkeys,
+							  cheapestpath->pathkeys))
+	{
+		/* No sort needed for cheapest path */
+		sort_path.startup_cost = cheapestpath->startup_cost;
+		sort_path.total_cost = cheapestpath->total_cost;
+	}
+	else
 	{
-		Path		sort_path;	/* dummy for result of cost_sort */
+		/* Figure cost for sorting */
+		cost_sort(&sort_path, root, root->query_pathkeys,
+				  cheapestpath->total_cost,
+				  final_rel->rows, final_rel->width,
+				  0.0, work_mem, limit_tuples);
+	}
 
-		if (root->query_pathkeys == NIL ||
-			pathkeys_contained_in(root->query_pathkeys,
-								  cheapestpath->pathkeys))
-		{
-			/* No sort needed for cheapest path */
-			sort_path.startup_cost = cheapestpath->startup_cost;
-			sort_path.total_cost = cheapestpath->total_cost;
-		}
-		else
-		{
-			/* Figure cost for sorting */
-			cost_sort(&sort_path, root, root->query_pathkeys,
-					  cheapestpath->total_cost,
-					  final_rel->rows, final_rel->width,
-					  0.0, work_mem, limit_tuples);
-		}
+	if (sortedpath &&
+		compare_fractional_path_costs(sortedpath, &sort_path,
+									  tuple_fraction) > 0)
+	{
+		/* Presorted path is a loser */
+		sortedpath = NULL;
+	}
 
-		if (compare_fractional_path_costs(sortedpath, &sort_path,
-										  tuple_fraction) > 0)
+	/*
+	 * For a plain ORDER BY query, a path that is sorted by only a prefix of
+	 * the wanted ordering can be finished off by an incremental sort, which
+	 * grouping_planner will add on top.  Return the best such path as the
+	 * presorted path if that beats both alternatives above.  This matters
+	 * mostly with a LIMIT, since an incremental sort can start returning
+	 * tuples after reading just the first group.
+	 */
+	if (enable_incrementalsort &&
+		root->query_pathkeys != NIL &&
+		root->query_pathkeys == root->sort_pathkeys &&
+		root->group_pathkeys == NIL &&
+		root->window_pathkeys == NIL &&
+		root->distinct_pathkeys == NIL &&
+		!parse->hasAggs &&
+		!pathkeys_contained_in(root->query_pathkeys, cheapestpath->pathkeys))
+	{
+		int			nkeys = list_length(root->query_pathkeys);
+		Path	   *best_incr_path = NULL;
+		Path		best_incr_cost;
+		ListCell   *l;
+
+		foreach(l, final_rel->pathlist)
 		{
-			/* Presorted path is a loser */
-			sortedpath = NULL;
+			Path	   *path = (Path *) lfirst(l);
+			Path		incr_path;	/* dummy for cost_incremental_sort */
+			int			presorted_keys;
+
+			presorted_keys = pathkeys_common(root->query_pathkeys,
+											 path->pathkeys);
+			/* cheapestpath gets an incremental sort anyway, if it helps */
+			if (path == cheapestpath ||
+				presorted_keys == 0 || presorted_keys >= nkeys)
+				continue;
+
+			cost_incremental_sort(&incr_path, root, root->query_pathkeys,
+								  presorted_keys,
+								  path->startup_cost, path->total_cost,
+								  final_rel->rows, final_rel->width,
+								  0.0, work_mem, limit_tuples);
+			if (best_incr_path == NULL ||
+				compare_fractional_path_costs(&incr_path, &best_incr_cost,
+											  tuple_fraction) < 0)
+			{
+				best_incr_path = path;
+				best_incr_cost = incr_path;
+			}
 		}
+
+		if (best_incr_path &&
+			compare_fractional_path_costs(&best_incr_cost, &sort_path,
+										  tuple_fraction) < 0 &&
+			(sortedpath == NULL ||
+			 compare_fractional_path_costs(&best_incr_cost, sortedpath,
+										   tuple_fraction) < 0))
+			sortedpath = best_incr_path;
 	}
 
 	*cheapest_path = cheapestpath;
@@ -19,8 +19,10 @@
 
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
+#include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #ifdef OPTIMIZER_DEBUG
 #include "nodes/print.h"
 #endif
@@ -77,6 +79,9 @@ static bool choose_hashed_distinct(PlannerInfo *root,
 					   Cost sorted_startup_cost, Cost sorted_total_cost,
 					   List *sorted_pathkeys,
 					   double dNumDistinctRows);
+static Plan *plan_foreign_grouping(PlannerInfo *root, List *tlist,
+					  Path *cheapest_path, double dNumGroups,
+					  List **current_pathkeys);
 static List *make_subplanTargetList(PlannerInfo *root, List *tlist,
 					   AttrNumber **groupColIdx, bool *need_tlist_eval);
 static int	get_grouping_column_index(Query *parse, TargetEntry *tle);
@@ -225,6 +230,7 @@ standard_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	result = makeNode(PlannedStmt);
 
 	result->commandType = parse->commandType;
+	result->queryId = parse->queryId;
 	result->hasReturning = (parse->returningList != NIL);
 	result->hasModifyingCTE = parse->hasModifyingCTE;
 	result->canSetTag = parse->canSetTag;
@@ -283,8 +289,21 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	Plan	   *plan;
 	List	   *newHaving;
 	bool		hasOuterJoins;
+	bool		batchInserts;
 	ListCell   *l;
 
+	/*
+	 * Decide whether an INSERT may buffer its rows and write them with
+	 * heap_multi_insert.  That is invisible unless something in the query
+	 * could see the target table change part way through the statement,
+	 * which we assume only a volatile function can do; and RETURNING needs
+	 * each row back as soon as it is inserted.  Check this now, before
+	 * preprocessing turns sub-selects into SubPlans we can't look into.
+	 */
+	batchInserts = (parse->commandType == CMD_INSERT &&
+					parse->returningList == NIL &&
+					!contain_volatile_functions_in_query(parse, true));
+
 	/* Create a PlannerInfo data structure for this subquery */
 	root = makeNode(PlannerInfo);
 	root->parse = parse;
@@ -564,7 +583,8 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 											 list_make1(plan),
 											 returningLists,
 											 rowMarks,
-											 SS_assign_special_param(root));
+											 SS_assign_special_param(root),
+											 batchInserts);
 		}
 	}
 
@@ -945,7 +965,8 @@ inheritance_planner(PlannerInfo *root)
 									 subplans,
 									 returningLists,
 									 rowMarks,
-									 SS_assign_special_param(root));
+									 SS_assign_special_param(root),
+									 false);
 }
 
 /*--------------------
@@ -1302,24 +1323,31 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 			best_path = sorted_path;
 
 		/*
-		 * Check to see if it's possible to optimize MIN/MAX aggregates. If
-		 * so, we will forget all the work we did so far to choose a "regular"
-		 * path ... but we had to do it anyway to be able to tell which way is
-		 * cheaper.
+		 * If all the input comes from one foreign server, its wrapper may be
+		 * able to do the grouping and aggregation remotely.  Failing that,
+		 * check to see if it's possible to optimize MIN/MAX aggregates. In
+		 * either case we will forget all the work we did so far to choose a
+		 * "regular" path ... but we had to do it anyway to be able to tell
+		 * which way is cheaper.
 		 */
-		result_plan = optimize_minmax_aggregates(root,
-												 tlist,
-												 &agg_costs,
-												 best_path);
-		if (result_plan != NULL)
+		result_plan = plan_foreign_grouping(root,
+											tlist,
+											cheapest_path,
+											dNumGroups,
+											&current_pathkeys);
+		if (result_plan == NULL)
 		{
 			/*
-			 * optimize_minmax_aggregates generated the full plan, with the
+			 * optimize_minmax_aggregates generates the full plan, with the
 			 * right tlist, and it has no sort order.
 			 */
+			result_plan = optimize_minmax_aggregates(root,
+													 tlist,
+													 &agg_costs,
+													 best_path);
 			current_pathkeys = NIL;
 		}
-		else
+		if (result_plan == NULL)
 		{
 			/*
 			 * Normal case --- create a plan according to query_planner's
@@ -1787,10 +1815,28 @@ grouping_planner(PlannerInfo *root, double tuple_fraction)
 	{
 		if (!pathkeys_contained_in(root->sort_pathkeys, current_pathkeys))
 		{
-			result_plan = (Plan *) make_sort_from_pathkeys(root,
-														   result_plan,
+			int			presorted_keys = 0;
+
+			/*
+			 * If the input is already sorted by a prefix of the requested
+			 * ordering, we may be able to get away with sorting each group
+			 * of prefix-equal tuples separately.
+			 */
+			if (enable_incrementalsort)
+				presorted_keys = pathkeys_common(root->sort_pathkeys,
+												 current_pathkeys);
+			if (presorted_keys > 0)
+				result_plan = (Plan *)
+					make_incremental_sort_from_pathkeys(root,
+														result_plan,
+														root->sort_pathkeys,
+														presorted_keys,
+														limit_tuples);
+			else
+				result_plan = (Plan *) make_sort_from_pathkeys(root,
+															   result_plan,
 														 root->sort_pathkeys,
-														   limit_tuples);
+															   limit_tuples);
 			current_pathkeys = root->sort_pathkeys;
 		}
 	}
@@ -2608,6 +2654,54 @@ choose_hashed_distinct(PlannerInfo *root,
 	return false;
 }
 
+/*
+ * plan_foreign_grouping
+ *		Give the foreign-data wrapper a chance to do the grouping step.
+ *
+ * When the scan/join relation underlying the query is a foreign table, or
+ * a join that has been planned to run entirely on one foreign server, its
+ * wrapper may offer to compute the grouped and aggregated result (including
+ * any HAVING qual) remotely.  If it does, we return a ForeignScan producing
+ * the final tlist, and set *current_pathkeys to the sort order of its
+ * output; otherwise we return NULL.
+ */
+static Plan *
+plan_foreign_grouping(PlannerInfo *root, List *tlist,
+					  Path *cheapest_path, double dNumGroups,
+					  List **current_pathkeys)
+{
+	Query	   *parse = root->parse;
+	RelOptInfo *rel = cheapest_path->parent;
+	FdwPlan    *fdwplan;
+
+	if (rel == NULL || rel->fdwroutine == NULL ||
+		rel->fdwroutine->PlanForeignGrouping == NULL)
+		return NULL;
+
+	/*
+	 * Only plain grouping is handled.  Window functions and set-returning
+	 * functions have to be evaluated locally on top of the grouped rows,
+	 * which the caller isn't prepared for; row marks and pseudoconstant
+	 * quals would need plan nodes below the grouping step.
+	 */
+	if (!parse->hasAggs && parse->groupClause == NIL)
+		return NULL;
+	if (parse->hasWindowFuncs || expression_returns_set((Node *) tlist))
+		return NULL;
+	if (root->rowMarks != NIL || root->hasPseudoConstantQuals)
+		return NULL;
+
+	fdwplan = rel->fdwroutine->PlanForeignGrouping(root, rel, tlist,
+												   dNumGroups);
+	if (fdwplan == NULL)
+		return NULL;
+
+	*current_pathkeys = fdwplan->pathkeys;
+
+	return (Plan *) create_foreigngrouping_plan(root, rel, tlist, fdwplan,
+												dNumGroups);
+}
+
 /*
  * make_subplanTargetList
  *	  Generate appropriate target list when grouping is required.
@@ -85,6 +85,10 @@ static Plan *set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset);
 static Plan *set_indexonlyscan_references(PlannerInfo *root,
 							 IndexOnlyScan *plan,
 							 int rtoffset);
+static Plan *set_foreignscan_references(PlannerInfo *root,
+						   ForeignScan *plan,
+						   int rtoffset);
+static Relids offset_relid_set(Relids relids, int rtoffset);
 static Plan *set_subqueryscan_references(PlannerInfo *root,
 							SubqueryScan *plan,
 							int rtoffset);
@@ -424,11 +428,15 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			{
 				ForeignScan *splan = (ForeignScan *) plan;
 
+				if (splan->scan.scanrelid == 0)
+					return set_foreignscan_references(root, splan, rtoffset);
 				splan->scan.scanrelid += rtoffset;
 				splan->scan.plan.targetlist =
 					fix_scan_list(root, splan->scan.plan.targetlist, rtoffset);
 				splan->scan.plan.qual =
 					fix_scan_list(root, splan->scan.plan.qual, rtoffset);
+				splan->fs_relids = offset_relid_set(splan->fs_relids,
+													rtoffset);
 			}
 			break;
 
@@ -599,6 +607,11 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 											  (Plan *) lfirst(l),
 											  rtoffset);
 				}
+				if (splan->part_prune_info)
+					splan->part_prune_info->exprs = (List *)
+						fix_scan_expr(root,
+									  (Node *) splan->part_prune_info->exprs,
+									  rtoffset);
 			}
 			break;
 		case T_MergeAppend:
@@ -617,6 +630,11 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 											  (Plan *) lfirst(l),
 											  rtoffset);
 				}
+				if (splan->part_prune_info)
+					splan->part_prune_info->exprs = (List *)
+						fix_scan_expr(root,
+									  (Node *) splan->part_prune_info->exprs,
+									  rtoffset);
 			}
 			break;
 		case T_RecursiveUnion:
@@ -717,6 +735,65 @@ set_indexonlyscan_references(PlannerInfo *root,
 	return (Plan *) plan;
 }
 
+/*
+ * set_foreignscan_references
+ *		Do set_plan_references processing on a ForeignScan that computes a
+ *		join or a grouped result remotely
+ *
+ * Such a scan has no scan relation; its output columns are described by
+ * fdw_scan_tlist, and we convert the Vars of the tlist and quals into
+ * INDEX_VAR references to that, much as for an IndexOnlyScan.
+ */
+static Plan *
+set_foreignscan_references(PlannerInfo *root,
+						   ForeignScan *plan,
+						   int rtoffset)
+{
+	indexed_tlist *scan_itlist;
+
+	scan_itlist = build_tlist_index(plan->fdw_scan_tlist);
+
+	plan->scan.plan.targetlist = (List *)
+		fix_upper_expr(root,
+					   (Node *) plan->scan.plan.targetlist,
+					   scan_itlist,
+					   INDEX_VAR,
+					   rtoffset);
+	plan->scan.plan.qual = (List *)
+		fix_upper_expr(root,
+					   (Node *) plan->scan.plan.qual,
+					   scan_itlist,
+					   INDEX_VAR,
+					   rtoffset);
+	/* fdw_scan_tlist must NOT be transformed to reference itself */
+	plan->fdw_scan_tlist = fix_scan_list(root, plan->fdw_scan_tlist, rtoffset);
+	plan->fs_relids = offset_relid_set(plan->fs_relids, rtoffset);
+
+	pfree(scan_itlist);
+
+	return (Plan *) plan;
+}
+
+/*
+ * offset_relid_set
+ *		Apply rtoffset to the members of a Relids set
+ */
+static Relids
+offset_relid_set(Relids relids, int rtoffset)
+{
+	Relids		result = NULL;
+	Relids		tmprelids;
+	int			rtindex;
+
+	if (rtoffset == 0)
+		return relids;
+	tmprelids = bms_copy(relids);
+	while ((rtindex = bms_first_member(tmprelids)) >= 0)
+		result = bms_add_member(result, rtindex + rtoffset);
+	bms_free(tmprelids);
+	return result;
+}
+
 /*
  * set_subqueryscan_references
  *		Do set_plan_references processing on a SubqueryScan
@@ -27,6 +27,7 @@
 #include "optimizer/subselect.h"
 #include "optimizer/var.h"
 #include "parser/parse_relation.h"
+#include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -51,6 +52,13 @@ typedef struct finalize_primnode_context
 	Bitmapset  *paramids;		/* Non-local PARAM_EXEC paramids found */
 } finalize_primnode_context;
 
+typedef struct inline_cte_walker_context
+{
+	const char *ctename;		/* name and relative level of target CTE */
+	int			levelsup;
+	Query	   *ctequery;		/* query to substitute */
+} inline_cte_walker_context;
+
 
 static Node *build_subplan(PlannerInfo *root, Plan *plan, PlannerInfo *subroot,
 			  SubLinkType subLinkType, Node *testexpr,
@@ -59,6 +67,11 @@ static List *generate_subquery_params(PlannerInfo *root, List *tlist,
 						 List **paramIds);
 static List *generate_subquery_vars(PlannerInfo *root, List *tlist,
 					   Index varno);
+static bool not_in_is_antijoinable(Query *parse, SubLink *sublink,
+					   List *nonnullable_vars);
+static bool var_is_nonnullable(Query *query, Node *node,
+				   List *nonnullable_vars);
+static Relids get_outer_join_nullable_relids(Node *jtnode, bool nullable);
 static Node *convert_testexpr(PlannerInfo *root,
 				 Node *testexpr,
 				 List *subst_nodes);
@@ -67,6 +80,12 @@ static Node *convert_testexpr_mutator(Node *node,
 static bool subplan_is_hashable(Plan *plan);
 static bool testexpr_is_hashable(Node *testexpr);
 static bool hash_ok_operator(OpExpr *expr);
+static bool contain_dml(Node *node);
+static bool contain_dml_walker(Node *node, void *context);
+static bool contain_outer_selfref(Node *node);
+static bool contain_outer_selfref_walker(Node *node, Index *depth);
+static void inline_cte(PlannerInfo *root, CommonTableExpr *cte);
+static bool inline_cte_walker(Node *node, inline_cte_walker_context *context);
 static bool simplify_EXISTS_query(Query *query);
 static Query *convert_EXISTS_to_ANY(PlannerInfo *root, Query *subselect,
 					  Node **testexpr, List **paramIds);
@@ -973,10 +992,13 @@ hash_ok_operator(OpExpr *expr)
 /*
  * SS_process_ctes: process a query's WITH list
  *
- * We plan each interesting WITH item and convert it to an initplan.
+ * Consider each CTE in the WITH list and either ignore it (if it's an
+ * unreferenced SELECT), "inline" it to create a regular sub-SELECT-in-FROM,
+ * or convert it to an initplan.
+ *
  * A side effect is to fill in root->cte_plan_ids with a list that
  * parallels root->parse->cteList and provides the subplan ID for
- * each CTE's initplan.
+ * each CTE's initplan, or a dummy ID (-1) if we didn't make an initplan.
  */
 void
 SS_process_ctes(PlannerInfo *root)
@@ -1007,6 +1029,53 @@ SS_process_ctes(PlannerInfo *root)
 			continue;
 		}
 
+		/*
+		 * Consider inlining the CTE (creating RTE_SUBQUERY RTE(s)) instead of
+		 * implementing it as a separately-planned CTE.  That lets the planner
+		 * push quals down into it and use indexes on the tables it reads,
+		 * which the CTE scan's materialization would prevent.
+		 *
+		 * We cannot inline if any of these conditions hold:
+		 *
+		 * 1. The user said not to (the CTEMaterializeAlways option).
+		 *
+		 * 2. The CTE is recursive.
+		 *
+		 * 3. The CTE has side-effects; this includes either not being a plain
+		 * SELECT, or containing volatile functions.  Inlining might change
+		 * the side-effects, which would be bad.
+		 *
+		 * 4. The CTE is multiply-referenced and contains a self-reference to
+		 * a recursive CTE outside itself.  Inlining would result in multiple
+		 * recursive self-references, which we don't support.
+		 *
+		 * Otherwise, we have an option whether to inline or not.  That should
+		 * always be a win if there's just a single reference, but if the CTE
+		 * is multiply-referenced then it's unclear: inlining adds duplicate
+		 * computations, but the ability to absorb restrictions from the outer
+		 * query level could outweigh that.  We do not have nearly enough
+		 * information at this point to tell whether that's true, so we let
+		 * the user express a preference.  Our default behavior is to inline
+		 * only singly-referenced CTEs, but a CTE marked CTEMaterializeNever
+		 * will be inlined even if multiply referenced.
+		 */
+		if ((cte->ctematerialized == CTEMaterializeNever ||
+			 (cte->ctematerialized == CTEMaterializeDefault &&
+			  cte->cterefcount == 1)) &&
+			!cte->cterecursive &&
+			cmdType == CMD_SELECT &&
+			!contain_dml(cte->ctequery) &&
+			(cte->cterefcount <= 1 ||
+			 !contain_outer_selfref(cte->ctequery)) &&
+			!contain_volatile_functions_in_query((Query *) cte->ctequery,
+												 false))
+		{
+			inline_cte(root, cte);
+			/* Make a dummy entry in cte_plan_ids */
+			root->cte_plan_ids = lappend_int(root->cte_plan_ids, -1);
+			continue;
+		}
+
 		/*
 		 * Copy the source Query node.	Probably not necessary, but let's keep
 		 * this similar to make_subplan.
@@ -1091,6 +1160,342 @@ SS_process_ctes(PlannerInfo *root)
 	}
 }
 
+/*
+ * contain_dml: is any subquery not a plain SELECT?
+ *
+ * We reject SELECT FOR UPDATE/SHARE as well as INSERT etc.
+ */
+static bool
+contain_dml(Node *node)
+{
+	return contain_dml_walker(node, NULL);
+}
+
+static bool
+contain_dml_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Query))
+	{
+		Query	   *query = (Query *) node;
+
+		if (query->commandType != CMD_SELECT ||
+			query->rowMarks != NIL)
+			return true;
+
+		return query_tree_walker(query, contain_dml_walker, context, 0);
+	}
+	return expression_tree_walker(node, contain_dml_walker, context);
+}
+
+/*
+ * contain_outer_selfref: is there an external recursive self-reference?
+ */
+static bool
+contain_outer_selfref(Node *node)
+{
+	Index		depth = 0;
+
+	/*
+	 * We should be starting with a Query, so that depth will be 1 while
+	 * examining its immediate contents.
+	 */
+	Assert(IsA(node, Query));
+
+	return contain_outer_selfref_walker(node, &depth);
+}
+
+static bool
+contain_outer_selfref_walker(Node *node, Index *depth)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, RangeTblEntry))
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) node;
+
+		/*
+		 * Check for a self-reference to a CTE that's above the Query that our
+		 * search started at.
+		 */
+		if (rte->rtekind == RTE_CTE &&
+			rte->self_reference &&
+			rte->ctelevelsup >= *depth)
+			return true;
+		return false;			/* allow range_table_walker to continue */
+	}
+	if (IsA(node, Query))
+	{
+		/* Recurse into subquery, tracking nesting depth properly */
+		Query	   *query = (Query *) node;
+		bool		result;
+
+		(*depth)++;
+
+		result = query_tree_walker(query, contain_outer_selfref_walker,
+								   (void *) depth, QTW_EXAMINE_RTES);
+
+		(*depth)--;
+
+		return result;
+	}
+	return expression_tree_walker(node, contain_outer_selfref_walker,
+								  (void *) depth);
+}
+
+/*
+ * inline_cte: convert RTE_CTE references to given CTE into RTE_SUBQUERYs
+ */
+static void
+inline_cte(PlannerInfo *root, CommonTableExpr *cte)
+{
+	inline_cte_walker_context context;
+
+	context.ctename = cte->ctename;
+	/* Start at levelsup = -1 because we'll immediately increment it */
+	context.levelsup = -1;
+	context.ctequery = (Query *) cte->ctequery;
+
+	(void) inline_cte_walker((Node *) root->parse, &context);
+}
+
+static bool
+inline_cte_walker(Node *node, inline_cte_walker_context *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Query))
+	{
+		Query	   *query = (Query *) node;
+		ListCell   *lc;
+
+		context->levelsup++;
+
+		/*
+		 * Visit the contents of the query, including those of its RTEs,
+		 * before replacing any references in its own range table; the other
+		 * way round, we'd descend into the newly inlined CTE query, which we
+		 * don't want.
+		 */
+		(void) query_tree_walker(query, inline_cte_walker, context, 0);
+
+		foreach(lc, query->rtable)
+		{
+			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+
+			if (rte->rtekind == RTE_CTE &&
+				strcmp(rte->ctename, context->ctename) == 0 &&
+				rte->ctelevelsup == context->levelsup)
+			{
+				/*
+				 * Found a reference to replace.  Generate a copy of the CTE
+				 * query with appropriate level adjustment for outer
+				 * references (e.g., to other CTEs).
+				 */
+				Query	   *newquery = copyObject(context->ctequery);
+
+				if (context->levelsup > 0)
+					IncrementVarSublevelsUp((Node *) newquery,
+											context->levelsup, 1);
+
+				/*
+				 * Convert the RTE_CTE RTE into a RTE_SUBQUERY.
+				 *
+				 * Historically, a FOR UPDATE clause has been treated as
+				 * extending into views and subqueries, but not into CTEs.  We
+				 * preserve this distinction by not trying to push rowmarks
+				 * into the new subquery.
+				 */
+				rte->rtekind = RTE_SUBQUERY;
+				rte->subquery = newquery;
+				rte->security_barrier = false;
+
+				/* Zero out CTE-specific fields */
+				rte->ctename = NULL;
+				rte->ctelevelsup = 0;
+				rte->self_reference = false;
+				rte->ctecoltypes = NIL;
+				rte->ctecoltypmods = NIL;
+				rte->ctecolcollations = NIL;
+			}
+		}
+
+		context->levelsup--;
+
+		return false;
+	}
+
+	return expression_tree_walker(node, inline_cte_walker, context);
+}
+
+/*
+ * not_in_is_antijoinable: can "testexpr NOT IN (subselect)" be an anti-join?
+ *
+ * NOT IN yields NULL, not TRUE, when a lefthand value is NULL and the
+ * subquery returns any rows, or when nothing matches but some subquery
+ * output is NULL; an anti-join would return the row either way.  So every
+ * comparison in testexpr must be an equality operator, which gives NULL only
+ * for NULL inputs, between a lefthand Var and a subquery output column that
+ * are both known to be non-null.  Anything more complicated we don't try.
+ */
+static bool
+not_in_is_antijoinable(Query *parse, SubLink *sublink,
+					   List *nonnullable_vars)
+{
+	Query	   *subselect = (Query *) sublink->subselect;
+	List	   *sub_nonnullable_vars;
+	List	   *comparisons;
+	ListCell   *lc;
+
+	/* The output columns of a set operation aren't Vars of its rtable */
+	if (subselect->setOperations)
+		return false;
+
+	if (and_clause(sublink->testexpr))
+		comparisons = ((BoolExpr *) sublink->testexpr)->args;
+	else
+		comparisons = list_make1(sublink->testexpr);
+
+	sub_nonnullable_vars = find_nonnullable_vars(subselect->jointree->quals);
+
+	foreach(lc, comparisons)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Node	   *leftop;
+		Node	   *rightop;
+		Param	   *param;
+		TargetEntry *tle;
+
+		if (!is_opclause(opexpr) || list_length(opexpr->args) != 2)
+			return false;
+		leftop = (Node *) linitial(opexpr->args);
+		rightop = (Node *) lsecond(opexpr->args);
+
+		if (!op_strict(opexpr->opno) ||
+			!(op_mergejoinable(opexpr->opno, exprType(leftop)) ||
+			  op_hashjoinable(opexpr->opno, exprType(leftop))))
+			return false;
+
+		leftop = strip_implicit_coercions(leftop);
+		rightop = strip_implicit_coercions(rightop);
+
+		if (!var_is_nonnullable(parse, leftop, nonnullable_vars))
+			return false;
+
+		/* convert_testexpr will replace this Param by the output column */
+		if (!IsA(rightop, Param))
+			return false;
+		param = (Param *) rightop;
+		if (param->paramkind != PARAM_SUBLINK)
+			return false;
+		tle = get_tle_by_resno(subselect->targetList, param->paramid);
+		if (tle == NULL ||
+			!var_is_nonnullable(subselect,
+								strip_implicit_coercions((Node *) tle->expr),
+								sub_nonnullable_vars))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * var_is_nonnullable: is node a Var of the given query level that can't be
+ * NULL where quals forcing nonnullable_vars to be non-null are applied?
+ *
+ * That's the case if it's one of nonnullable_vars, or a NOT NULL column of
+ * a table that isn't on the nullable side of an outer join.
+ */
+static bool
+var_is_nonnullable(Query *query, Node *node, List *nonnullable_vars)
+{
+	Var		   *var = (Var *) node;
+	RangeTblEntry *rte;
+	ListCell   *lc;
+
+	if (!IsA(var, Var) || var->varlevelsup != 0)
+		return false;
+
+	foreach(lc, nonnullable_vars)
+	{
+		Var		   *nnvar = (Var *) lfirst(lc);
+
+		if (nnvar->varno == var->varno && nnvar->varattno == var->varattno)
+			return true;
+	}
+
+	/* Join alias Vars haven't been expanded yet, so only look at tables */
+	rte = rt_fetch(var->varno, query->rtable);
+	if (rte->rtekind != RTE_RELATION || var->varattno <= 0)
+		return false;
+	if (bms_is_member(var->varno,
+					  get_outer_join_nullable_relids((Node *) query->jointree,
+													 false)))
+		return false;
+
+	return get_attnotnull(rte->relid, var->varattno);
+}
+
+/*
+ * get_outer_join_nullable_relids: find the base rels in a jointree that are
+ * on the nullable side of some outer join, or all of them if "nullable"
+ */
+static Relids
+get_outer_join_nullable_relids(Node *jtnode, bool nullable)
+{
+	Relids		result = NULL;
+
+	if (jtnode == NULL)
+		return NULL;
+	if (IsA(jtnode, RangeTblRef))
+	{
+		if (nullable)
+			result = bms_make_singleton(((RangeTblRef *) jtnode)->rtindex);
+	}
+	else if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *l;
+
+		foreach(l, f->fromlist)
+			result = bms_join(result,
+							  get_outer_join_nullable_relids(lfirst(l),
+															 nullable));
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+		bool		left_nullable = nullable;
+		bool		right_nullable = nullable;
+
+		switch (j->jointype)
+		{
+			case JOIN_INNER:
+				break;
+			case JOIN_LEFT:
+			case JOIN_SEMI:
+			case JOIN_ANTI:
+				right_nullable = true;
+				break;
+			case JOIN_RIGHT:
+				left_nullable = true;
+				break;
+			default:
+				left_nullable = right_nullable = true;
+				break;
+		}
+		result = bms_join(get_outer_join_nullable_relids(j->larg,
+														 left_nullable),
+						  get_outer_join_nullable_relids(j->rarg,
+														 right_nullable));
+	}
+	else
+		elog(ERROR, "unrecognized node type: %d",
+			 (int) nodeTag(jtnode));
+	return result;
+}
+
 /*
  * convert_ANY_sublink_to_join: try to convert an ANY SubLink to a join
  *
@@ -1124,10 +1529,17 @@ SS_process_ctes(PlannerInfo *root)
  * Side effects of a successful conversion include adding the SubLink's
  * subselect to the query's rangetable, so that it can be referenced in
  * the JoinExpr's rarg.
+ *
+ * If under_not is true, the caller actually found NOT (ANY SubLink), that
+ * is NOT IN, so we need to build an anti-join; that's only possible if
+ * NULLs can't arise, see not_in_is_antijoinable.  nonnullable_vars lists
+ * the Vars that the qual containing the SubLink forces to be non-null;
+ * it's not looked at otherwise.
  */
 JoinExpr *
 convert_ANY_sublink_to_join(PlannerInfo *root, SubLink *sublink,
-							Relids available_rels)
+							bool under_not, Relids available_rels,
+							List *nonnullable_vars)
 {
 	JoinExpr   *result;
 	Query	   *parse = root->parse;
@@ -1169,6 +1581,11 @@ convert_ANY_sublink_to_join(PlannerInfo *root, SubLink *sublink,
 	if (contain_volatile_functions(sublink->testexpr))
 		return NULL;
 
+	/* NOT IN is only an anti-join if no NULLs can get involved */
+	if (under_not &&
+		!not_in_is_antijoinable(parse, sublink, nonnullable_vars))
+		return NULL;
+
 	/*
 	 * Okay, pull up the sub-select into upper range table.
 	 *
@@ -1206,7 +1623,7 @@ convert_ANY_sublink_to_join(PlannerInfo *root, SubLink *sublink,
 	 * And finally, build the JoinExpr node.
 	 */
 	result = makeNode(JoinExpr);
-	result->jointype = JOIN_SEMI;
+	result->jointype = under_not ? JOIN_ANTI : JOIN_SEMI;
 	result->isNatural = false;
 	result->larg = NULL;		/* caller must fill this in */
 	result->rarg = (Node *) rtr;
@@ -2169,6 +2586,8 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 			{
 				ListCell   *l;
 
+				PartitionPruneInfo *pinfo = ((Append *) plan)->part_prune_info;
+
 				foreach(l, ((Append *) plan)->appendplans)
 				{
 					context.paramids =
@@ -2178,6 +2597,8 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 													  valid_params,
 													  scan_params));
 				}
+				if (pinfo)
+					finalize_primnode((Node *) pinfo->exprs, &context);
 			}
 			break;
 
@@ -2185,6 +2606,8 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 			{
 				ListCell   *l;
 
+				PartitionPruneInfo *pinfo = ((MergeAppend *) plan)->part_prune_info;
+
 				foreach(l, ((MergeAppend *) plan)->mergeplans)
 				{
 					context.paramids =
@@ -2194,6 +2617,8 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 													  valid_params,
 													  scan_params));
 				}
+				if (pinfo)
+					finalize_primnode((Node *) pinfo->exprs, &context);
 			}
 			break;
 
@@ -58,7 +58,8 @@ typedef struct reduce_outer_joins_state
 static Node *pull_up_sublinks_jointree_recurse(PlannerInfo *root, Node *jtnode,
 								  Relids *relids);
 static Node *pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
-							  Relids available_rels, Node **jtlink);
+							  Relids available_rels,
+							  List *nonnullable_vars, Node **jtlink);
 static Node *pull_up_simple_subquery(PlannerInfo *root, Node *jtnode,
 						RangeTblEntry *rte,
 						JoinExpr *lowest_outer_join,
@@ -193,6 +194,7 @@ pull_up_sublinks_jointree_recurse(PlannerInfo *root, Node *jtnode,
 		jtlink = (Node *) newf;
 		/* Now process qual --- all children are available for use */
 		newf->quals = pull_up_sublinks_qual_recurse(root, f->quals, frelids,
+												find_nonnullable_vars(f->quals),
 													&jtlink);
 
 		/*
@@ -256,12 +258,14 @@ pull_up_sublinks_jointree_recurse(PlannerInfo *root, Node *jtnode,
 				j->quals = pull_up_sublinks_qual_recurse(root, j->quals,
 														 bms_union(leftrelids,
 																rightrelids),
+												find_nonnullable_vars(j->quals),
 														 &jtlink);
 				break;
 			case JOIN_LEFT:
 #ifdef NOT_USED					/* see XXX comment above */
 				j->quals = pull_up_sublinks_qual_recurse(root, j->quals,
 														 rightrelids,
+														 NIL,
 														 &j->rarg);
 #endif
 				break;
@@ -272,6 +276,7 @@ pull_up_sublinks_jointree_recurse(PlannerInfo *root, Node *jtnode,
 #ifdef NOT_USED					/* see XXX comment above */
 				j->quals = pull_up_sublinks_qual_recurse(root, j->quals,
 														 leftrelids,
+														 NIL,
 														 &j->larg);
 #endif
 				break;
@@ -307,10 +312,14 @@ pull_up_sublinks_jointree_recurse(PlannerInfo *root, Node *jtnode,
  * inserted.  If we find multiple pull-up-able SubLinks, they'll get stacked
  * there in the order we encounter them.  We rely on subsequent optimization
  * to rearrange the stack if appropriate.
+ *
+ * nonnullable_vars lists the Vars that the whole qual forces to be non-null,
+ * which may allow a NOT IN to be converted; NIL is always safe.
  */
 static Node *
 pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
-							  Relids available_rels, Node **jtlink)
+							  Relids available_rels,
+							  List *nonnullable_vars, Node **jtlink)
 {
 	if (node == NULL)
 		return NULL;
@@ -323,8 +332,8 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 		/* Is it a convertible ANY or EXISTS clause? */
 		if (sublink->subLinkType == ANY_SUBLINK)
 		{
-			j = convert_ANY_sublink_to_join(root, sublink,
-											available_rels);
+			j = convert_ANY_sublink_to_join(root, sublink, false,
+											available_rels, NIL);
 			if (j)
 			{
 				/* Yes; recursively process what we pulled up */
@@ -335,6 +344,7 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 				j->quals = pull_up_sublinks_qual_recurse(root,
 														 j->quals,
 														 child_rels,
+														 NIL,
 														 &j->rarg);
 				/* Now insert the new join node into the join tree */
 				j->larg = *jtlink;
@@ -357,6 +367,7 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 				j->quals = pull_up_sublinks_qual_recurse(root,
 														 j->quals,
 														 child_rels,
+														 NIL,
 														 &j->rarg);
 				/* Now insert the new join node into the join tree */
 				j->larg = *jtlink;
@@ -370,45 +381,51 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 	}
 	if (not_clause(node))
 	{
-		/* If the immediate argument of NOT is EXISTS, try to convert */
+		/* If the immediate argument of NOT is EXISTS or IN, try to convert */
 		SubLink    *sublink = (SubLink *) get_notclausearg((Expr *) node);
 		JoinExpr   *j;
 
 		if (sublink && IsA(sublink, SubLink))
 		{
 			if (sublink->subLinkType == EXISTS_SUBLINK)
-			{
 				j = convert_EXISTS_sublink_to_join(root, sublink, true,
 												   available_rels);
-				if (j)
-				{
-					/*
-					 * For the moment, refrain from recursing underneath NOT.
-					 * As in pull_up_sublinks_jointree_recurse, recursing here
-					 * would result in inserting a join underneath an ANTI
-					 * join with which it could not commute, and that could
-					 * easily lead to a worse plan than what we've
-					 * historically generated.
-					 */
+			else if (sublink->subLinkType == ANY_SUBLINK)
+				j = convert_ANY_sublink_to_join(root, sublink, true,
+												available_rels,
+												nonnullable_vars);
+			else
+				j = NULL;
+
+			if (j)
+			{
+				/*
+				 * For the moment, refrain from recursing underneath NOT.
+				 * As in pull_up_sublinks_jointree_recurse, recursing here
+				 * would result in inserting a join underneath an ANTI
+				 * join with which it could not commute, and that could
+				 * easily lead to a worse plan than what we've
+				 * historically generated.
+				 */
 #ifdef NOT_USED
-					/* Yes; recursively process what we pulled up */
-					Relids		child_rels;
-
-					j->rarg = pull_up_sublinks_jointree_recurse(root,
-																j->rarg,
-																&child_rels);
-					/* Any inserted joins get stacked onto j->rarg */
-					j->quals = pull_up_sublinks_qual_recurse(root,
-															 j->quals,
-															 child_rels,
-															 &j->rarg);
+				/* Yes; recursively process what we pulled up */
+				Relids		child_rels;
+
+				j->rarg = pull_up_sublinks_jointree_recurse(root,
+															j->rarg,
+															&child_rels);
+				/* Any inserted joins get stacked onto j->rarg */
+				j->quals = pull_up_sublinks_qual_recurse(root,
+														 j->quals,
+														 child_rels,
+														 NIL,
+														 &j->rarg);
 #endif
-					/* Now insert the new join node into the join tree */
-					j->larg = *jtlink;
-					*jtlink = (Node *) j;
-					/* and return NULL representing constant TRUE */
-					return NULL;
-				}
+				/* Now insert the new join node into the join tree */
+				j->larg = *jtlink;
+				*jtlink = (Node *) j;
+				/* and return NULL representing constant TRUE */
+				return NULL;
 			}
 		}
 		/* Else return it unmodified */
@@ -428,6 +445,7 @@ pull_up_sublinks_qual_recurse(PlannerInfo *root, Node *node,
 			newclause = pull_up_sublinks_qual_recurse(root,
 													  oldclause,
 													  available_rels,
+													  nonnullable_vars,
 													  jtlink);
 			if (newclause)
 				newclauses = lappend(newclauses, newclause);
@@ -31,22 +31,27 @@
 
 #include "access/heapam.h"
 #include "access/sysattr.h"
+#include "catalog/partition.h"
 #include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/planmain.h"
 #include "optimizer/planner.h"
 #include "optimizer/prep.h"
 #include "optimizer/tlist.h"
+#include "optimizer/var.h"
 #include "parser/parse_coerce.h"
 #include "parser/parsetree.h"
+#include "storage/lmgr.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
+#include "utils/syscache.h"
 
 
 static Plan *recurse_set_operations(Node *setOp, PlannerInfo *root,
@@ -92,6 +97,14 @@ static List *generate_append_tlist(List *colTypes, List *colCollations,
 static List *generate_setop_grouplist(SetOperationStmt *op, List *targetlist);
 static void expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte,
 						 Index rti);
+static List *prune_inheritance_children(PlannerInfo *root, Relation parentrel,
+						   Index rti, LOCKMODE lockmode);
+static void restrict_partition_range(PlannerInfo *root, Node *jtnode,
+						 Index rti, PartitionDesc pdesc,
+						 PartitionRange *range, bool *found);
+static void restrict_partition_range_qual(PlannerInfo *root, Node *qual,
+							  Index rti, PartitionDesc pdesc,
+							  PartitionRange *range, bool *found);
 static void make_inh_translation_list(Relation oldrelation,
 						  Relation newrelation,
 						  Index newvarno,
@@ -1259,16 +1272,31 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	else
 		lockmode = AccessShareLock;
 
-	/* Scan for all members of inheritance set, acquire needed locks */
-	inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
+	/*
+	 * Must open the parent relation to examine its tupdesc.  We need not lock
+	 * it; we assume the rewriter already did.
+	 */
+	oldrelation = heap_open(parentOID, NoLock);
+
+	/*
+	 * Scan for all members of inheritance set, acquire needed locks.  If the
+	 * parent's partition descriptor allows, we need only find the children
+	 * that the query's quals don't rule out, and needn't lock the others.
+	 */
+	inhOIDs = NIL;
+	if (constraint_exclusion != CONSTRAINT_EXCLUSION_OFF)
+		inhOIDs = prune_inheritance_children(root, oldrelation, rti, lockmode);
+	if (inhOIDs == NIL)
+		inhOIDs = find_all_inheritors(parentOID, lockmode, NULL);
 
 	/*
 	 * Check that there's at least one descendant, else treat as no-child
 	 * case.  This could happen despite above has_subclass() check, if table
-	 * once had a child but no longer does.
+	 * once had a child but no longer does, or if pruning excluded them all.
 	 */
 	if (list_length(inhOIDs) < 2)
 	{
+		heap_close(oldrelation, NoLock);
 		/* Clear flag before returning */
 		rte->inh = false;
 		return;
@@ -1282,12 +1310,6 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	if (oldrc)
 		oldrc->isParent = true;
 
-	/*
-	 * Must open the parent relation to examine its tupdesc.  We need not lock
-	 * it; we assume the rewriter already did.
-	 */
-	oldrelation = heap_open(parentOID, NoLock);
-
 	/* Scan the inheritance set and expand it */
 	appinfos = NIL;
 	foreach(l, inhOIDs)
@@ -1399,6 +1421,165 @@ expand_inherited_rtentry(PlannerInfo *root, RangeTblEntry *rte, Index rti)
 	root->append_rel_list = list_concat(root->append_rel_list, appinfos);
 }
 
+/*
+ * prune_inheritance_children
+ *	  Find the members of an inheritance set that the query's quals on the
+ *	  parent's partition key don't rule out, and lock them.
+ *
+ * The result, like find_all_inheritors', starts with the parent itself and
+ * goes on to list all descendants of the direct children that survive.
+ * NIL means we couldn't prune: the parent has no partition descriptor, or
+ * the query has no usable quals on its key.  This is just a quick form of
+ * constraint exclusion, which will still be applied to the survivors later.
+ */
+static List *
+prune_inheritance_children(PlannerInfo *root, Relation parentrel,
+						   Index rti, LOCKMODE lockmode)
+{
+	PartitionDesc pdesc;
+	PartitionRange range;
+	bool		found = false;
+	List	   *children;
+	List	   *result;
+	ListCell   *lc;
+
+	/*
+	 * Folding constants and looking up operators can process invalidations,
+	 * which would free the relcache's descriptor, so work with a copy.
+	 */
+	pdesc = RelationGetPartitionDesc(parentrel);
+	if (pdesc == NULL)
+		return NIL;
+	pdesc = copy_partition_desc(pdesc);
+
+	range.lower.infinite = true;
+	range.lower.inclusive = false;
+	range.upper.infinite = true;
+	range.upper.inclusive = false;
+	restrict_partition_range(root, (Node *) root->parse->jointree, rti,
+							 pdesc, &range, &found);
+	if (!found)
+		return NIL;
+
+	children = get_partitions_in_range(pdesc, &range);
+
+	result = list_make1_oid(RelationGetRelid(parentrel));
+	foreach(lc, children)
+	{
+		Oid			childOID = lfirst_oid(lc);
+
+		/* Lock it and check it's still there, as find_inheritance_children */
+		LockRelationOid(childOID, lockmode);
+		if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(childOID)))
+		{
+			UnlockRelationOid(childOID, lockmode);
+			continue;
+		}
+
+		/*
+		 * A child with children of its own brings in the lot, taking care
+		 * not to list any rel twice in case of multiple inheritance.
+		 */
+		if (has_subclass(childOID))
+			result = list_concat_unique_oid(result,
+							find_all_inheritors(childOID, lockmode, NULL));
+		else
+			result = list_append_unique_oid(result, childOID);
+	}
+
+	return result;
+}
+
+/*
+ * restrict_partition_range
+ *	  Narrow *range by the quals in a jointree that compare the partition key
+ *	  of relation rti to a constant, and set *found if there were any.
+ *
+ * Quals in WHERE and in inner join conditions filter every row of the rel
+ * that could reach the query's output, so long as they're strict (which
+ * partition_clause_strategy insists on); we don't look below outer joins,
+ * whose conditions don't.
+ */
+static void
+restrict_partition_range(PlannerInfo *root, Node *jtnode, Index rti,
+						 PartitionDesc pdesc, PartitionRange *range,
+						 bool *found)
+{
+	if (jtnode == NULL)
+		return;
+	if (IsA(jtnode, RangeTblRef))
+		return;
+	else if (IsA(jtnode, FromExpr))
+	{
+		FromExpr   *f = (FromExpr *) jtnode;
+		ListCell   *l;
+
+		foreach(l, f->fromlist)
+			restrict_partition_range(root, lfirst(l), rti, pdesc, range,
+									 found);
+		restrict_partition_range_qual(root, f->quals, rti, pdesc, range,
+									  found);
+	}
+	else if (IsA(jtnode, JoinExpr))
+	{
+		JoinExpr   *j = (JoinExpr *) jtnode;
+
+		if (j->jointype != JOIN_INNER)
+			return;
+		restrict_partition_range(root, j->larg, rti, pdesc, range, found);
+		restrict_partition_range(root, j->rarg, rti, pdesc, range, found);
+		restrict_partition_range_qual(root, j->quals, rti, pdesc, range,
+									  found);
+	}
+	else
+		elog(ERROR, "unrecognized node type: %d",
+			 (int) nodeTag(jtnode));
+}
+
+/*
+ * restrict_partition_range_qual
+ *	  Workhorse for restrict_partition_range: process one qual expression,
+ *	  which hasn't been through preprocess_expression yet.
+ */
+static void
+restrict_partition_range_qual(PlannerInfo *root, Node *qual, Index rti,
+							  PartitionDesc pdesc, PartitionRange *range,
+							  bool *found)
+{
+	Datum		value;
+	int			strategy;
+
+	if (qual == NULL)
+		return;
+
+	/* The quals aren't flattened yet, so recurse into ANDs */
+	if (and_clause(qual))
+	{
+		ListCell   *l;
+
+		foreach(l, ((BoolExpr *) qual)->args)
+			restrict_partition_range_qual(root, lfirst(l), rti, pdesc, range,
+										  found);
+		return;
+	}
+
+	/*
+	 * Nor have constants been folded; do that for any operator clause that
+	 * mentions the rel, a bit wastefully since it'll be done again later.
+	 * This also substitutes the values of parameters for a custom plan.
+	 */
+	if (!is_opclause(qual) || !bms_is_member(rti, pull_varnos(qual)))
+		return;
+	qual = eval_const_expressions(root, qual);
+
+	strategy = partition_clause_strategy(pdesc, (Expr *) qual, rti, &value);
+	if (strategy != 0)
+	{
+		partition_range_restrict(pdesc, range, strategy, value);
+		*found = true;
+	}
+}
+
 /*
  * make_inh_translation_list
  *	  Build the list of translations from parent Vars to child Vars for
@@ -43,6 +43,7 @@
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
@@ -84,6 +85,9 @@ typedef struct
 	char	   *prosrc;
 } inline_error_callback_arg;
 
+/* Hook for procedural languages to supply inlinable function bodies */
+inline_function_body_hook_type inline_function_body_hook = NULL;
+
 static bool contain_agg_clause_walker(Node *node, void *context);
 static bool count_agg_clauses_walker(Node *node,
 						 count_agg_clauses_context *context);
@@ -910,11 +914,43 @@ contain_volatile_functions(Node *clause)
 	return contain_volatile_functions_walker(clause, NULL);
 }
 
+/*
+ * contain_volatile_functions_in_query
+ *	  Like contain_volatile_functions, but for a whole Query, including its
+ *	  sub-selects, and optionally ignoring calls of nextval().
+ *
+ * Ignoring nextval() is meant for deciding whether rows produced by the
+ * query may be written out in batches rather than one at a time: a volatile
+ * function might look at the target table and notice the difference, but
+ * nextval() only touches its sequence, and is far too common in INSERT
+ * default expressions to be allowed to defeat the optimization.  Non-NULL
+ * walker context means we are working on behalf of this function, and
+ * points to the ignore_nextval flag.
+ */
+bool
+contain_volatile_functions_in_query(Query *query, bool ignore_nextval)
+{
+	return query_tree_walker(query, contain_volatile_functions_walker,
+							 (void *) &ignore_nextval, 0);
+}
+
 static bool
 contain_volatile_functions_walker(Node *node, void *context)
 {
 	if (node == NULL)
 		return false;
+	if (context != NULL)
+	{
+		if (IsA(node, Query))
+			return query_tree_walker((Query *) node,
+									 contain_volatile_functions_walker,
+									 context, 0);
+		if (*(bool *) context && IsA(node, FuncExpr) &&
+			((FuncExpr *) node)->funcid == F_NEXTVAL_OID)
+			return expression_tree_walker(node,
+										  contain_volatile_functions_walker,
+										  context);
+	}
 	if (IsA(node, FuncExpr))
 	{
 		FuncExpr   *expr = (FuncExpr *) node;
@@ -3900,6 +3936,10 @@ evaluate_function(Oid funcid, Oid result_type, int32 result_typmod,
  * doesn't work in the general case because it discards information such
  * as OUT-parameter declarations.
  *
+ * Functions in other languages can be inlined too, if a language has
+ * installed inline_function_body_hook and it can translate the function's
+ * body into the equivalent of a SQL-function body.
+ *
  * Returns a simplified expression if successful, or NULL if cannot
  * simplify the function.
  */
@@ -3929,14 +3969,16 @@ inline_function(Oid funcid, Oid result_type, Oid result_collid,
 	int			i;
 
 	/*
-	 * Forget it if the function is not SQL-language or has other showstopper
-	 * properties.	(The nargs check is just paranoia.)
+	 * Forget it if the function is not SQL-language (and there's no hook that
+	 * might be able to supply the body of a function in another language) or
+	 * has other showstopper properties.  (The nargs check is just paranoia.)
 	 */
-	if (funcform->prolang != SQLlanguageId ||
+	if ((funcform->prolang != SQLlanguageId &&
+		 inline_function_body_hook == NULL) ||
 		funcform->prosecdef ||
 		funcform->proretset ||
 		funcform->prorettype == RECORDOID ||
-		!heap_attisnull(func_tuple, Anum_pg_proc_proconfig) ||
+		!heap_attisnull(func_tuple, Anum_pg_proc_proconfig, NULL) ||
 		funcform->pronargs != list_length(args))
 		return NULL;
 
@@ -3963,26 +4005,11 @@ inline_function(Oid funcid, Oid result_type, Oid result_collid,
 								  ALLOCSET_DEFAULT_MAXSIZE);
 	oldcxt = MemoryContextSwitchTo(mycxt);
 
-	/* Fetch the function body */
-	tmp = SysCacheGetAttr(PROCOID,
-						  func_tuple,
-						  Anum_pg_proc_prosrc,
-						  &isNull);
-	if (isNull)
-		elog(ERROR, "null prosrc for function %u", funcid);
-	src = TextDatumGetCString(tmp);
-
 	/*
-	 * Setup error traceback support for ereport().  This is so that we can
-	 * finger the function that bad information came from.
+	 * The error context stack is restored from sqlerrcontext.previous on
+	 * exit, whether or not we push our own callback below.
 	 */
-	callback_arg.proname = NameStr(funcform->proname);
-	callback_arg.prosrc = src;
-
-	sqlerrcontext.callback = sql_inline_error_callback;
-	sqlerrcontext.arg = (void *) &callback_arg;
 	sqlerrcontext.previous = error_context_stack;
-	error_context_stack = &sqlerrcontext;
 
 	/*
 	 * Set up to handle parameters while parsing the function body.  We need a
@@ -4000,27 +4027,57 @@ inline_function(Oid funcid, Oid result_type, Oid result_collid,
 	fexpr->args = args;
 	fexpr->location = -1;
 
-	pinfo = prepare_sql_fn_parse_info(func_tuple,
-									  (Node *) fexpr,
-									  input_collid);
+	if (funcform->prolang == SQLlanguageId)
+	{
+		/* Fetch the function body */
+		tmp = SysCacheGetAttr(PROCOID,
+							  func_tuple,
+							  Anum_pg_proc_prosrc,
+							  &isNull);
+		if (isNull)
+			elog(ERROR, "null prosrc for function %u", funcid);
+		src = TextDatumGetCString(tmp);
 
-	/*
-	 * We just do parsing and parse analysis, not rewriting, because rewriting
-	 * will not affect table-free-SELECT-only queries, which is all that we
-	 * care about.	Also, we can punt as soon as we detect more than one
-	 * command in the function body.
-	 */
-	raw_parsetree_list = pg_parse_query(src);
-	if (list_length(raw_parsetree_list) != 1)
-		goto fail;
+		/*
+		 * Setup error traceback support for ereport().  This is so that we
+		 * can finger the function that bad information came from.
+		 */
+		callback_arg.proname = NameStr(funcform->proname);
+		callback_arg.prosrc = src;
+
+		sqlerrcontext.callback = sql_inline_error_callback;
+		sqlerrcontext.arg = (void *) &callback_arg;
+		error_context_stack = &sqlerrcontext;
+
+		pinfo = prepare_sql_fn_parse_info(func_tuple,
+										  (Node *) fexpr,
+										  input_collid);
+
+		/*
+		 * We just do parsing and parse analysis, not rewriting, because
+		 * rewriting will not affect table-free-SELECT-only queries, which is
+		 * all that we care about.  Also, we can punt as soon as we detect
+		 * more than one command in the function body.
+		 */
+		raw_parsetree_list = pg_parse_query(src);
+		if (list_length(raw_parsetree_list) != 1)
+			goto fail;
 
-	pstate = make_parsestate(NULL);
-	pstate->p_sourcetext = src;
-	sql_fn_parser_setup(pstate, pinfo);
+		pstate = make_parsestate(NULL);
+		pstate->p_sourcetext = src;
+		sql_fn_parser_setup(pstate, pinfo);
 
-	querytree = transformStmt(pstate, linitial(raw_parsetree_list));
+		querytree = transformStmt(pstate, linitial(raw_parsetree_list));
 
-	free_parsestate(pstate);
+		free_parsestate(pstate);
+	}
+	else
+	{
+		/* Let the language's hook produce the body, if it can */
+		querytree = (*inline_function_body_hook) (func_tuple, fexpr);
+		if (querytree == NULL)
+			goto fail;
+	}
 
 	/*
 	 * The single command must be a simple "SELECT expression".
@@ -4445,7 +4502,7 @@ inline_set_returning_function(PlannerInfo *root, RangeTblEntry *rte)
 		funcform->provolatile == PROVOLATILE_VOLATILE ||
 		funcform->prosecdef ||
 		!funcform->proretset ||
-		!heap_attisnull(func_tuple, Anum_pg_proc_proconfig))
+		!heap_attisnull(func_tuple, Anum_pg_proc_proconfig, NULL))
 	{
 		ReleaseSysCache(func_tuple);
 		return NULL;
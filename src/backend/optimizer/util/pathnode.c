@@ -24,13 +24,14 @@
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/tlist.h"
+#include "optimizer/var.h"
 #include "parser/parsetree.h"
 #include "utils/lsyscache.h"
 #include "utils/selfuncs.h"
+#include "utils/typcache.h"
 
 
 static List *translate_sub_tlist(List *tlist, int relid);
-static bool query_is_distinct_for(Query *query, List *colnos, List *opids);
 static Oid	distinct_col_search(int colno, List *colnos, List *opids);
 
 
@@ -831,6 +832,75 @@ create_material_path(RelOptInfo *rel, Path *subpath)
 	return pathnode;
 }
 
+/*
+ * create_memoize_path
+ *	  Creates a path corresponding to a Material plan that caches the results
+ *	  of the nestloop inner indexscan 'subpath' for each distinct set of
+ *	  values it uses from 'outerrel', returning the pathnode.
+ *
+ * Returns NULL if the indexscan uses outer values we could not hash.
+ */
+MaterialPath *
+create_memoize_path(PlannerInfo *root, RelOptInfo *rel, Path *subpath,
+					RelOptInfo *outerrel)
+{
+	MaterialPath *pathnode;
+	List	   *cache_keys = NIL;
+	ListCell   *lc;
+
+	if (!IsA(subpath, IndexPath) ||
+		!((IndexPath *) subpath)->isjoininner)
+		return NULL;
+
+	foreach(lc, ((IndexPath *) subpath)->indexclauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		List	   *vars;
+		ListCell   *lc2;
+
+		vars = pull_var_clause((Node *) rinfo->clause,
+							   PVC_REJECT_AGGREGATES,
+							   PVC_INCLUDE_PLACEHOLDERS);
+		foreach(lc2, vars)
+		{
+			Var		   *var = (Var *) lfirst(lc2);
+			TypeCacheEntry *typentry;
+
+			/* Punt on PlaceHolderVars; they're rare here anyway */
+			if (!IsA(var, Var))
+				return NULL;
+
+			/* The indexed relation's own columns aren't keys */
+			if (!bms_is_member(var->varno, outerrel->relids))
+				continue;
+
+			typentry = lookup_type_cache(var->vartype, TYPECACHE_EQ_OPR);
+			if (!OidIsValid(typentry->eq_opr) ||
+				!op_hashjoinable(typentry->eq_opr, var->vartype))
+				return NULL;
+
+			cache_keys = list_append_unique(cache_keys, var);
+		}
+	}
+
+	if (cache_keys == NIL)
+		return NULL;
+
+	pathnode = makeNode(MaterialPath);
+
+	pathnode->path.pathtype = T_Material;
+	pathnode->path.parent = rel;
+
+	pathnode->path.pathkeys = subpath->pathkeys;
+
+	pathnode->subpath = subpath;
+	pathnode->cache_keys = cache_keys;
+
+	cost_memoize(pathnode, root, subpath, outerrel->rows);
+
+	return pathnode;
+}
+
 /*
  * create_unique_path
  *	  Creates a path representing elimination of distinct rows from the
@@ -1225,7 +1295,7 @@ translate_sub_tlist(List *tlist, int relid)
  * should give trustworthy answers for all operators that we might need
  * to deal with here.)
  */
-static bool
+bool
 query_is_distinct_for(Query *query, List *colnos, List *opids)
 {
 	ListCell   *l;
@@ -1460,27 +1530,85 @@ create_foreignscan_path(PlannerInfo *root, RelOptInfo *rel)
 {
 	ForeignPath *pathnode = makeNode(ForeignPath);
 	RangeTblEntry *rte;
-	FdwRoutine *fdwroutine;
 	FdwPlan    *fdwplan;
 
 	pathnode->path.pathtype = T_ForeignScan;
 	pathnode->path.parent = rel;
-	pathnode->path.pathkeys = NIL;		/* result is always unordered */
-
-	/* Get FDW's callback info */
-	rte = planner_rt_fetch(rel->relid, root);
-	fdwroutine = GetFdwRoutineByRelId(rte->relid);
 
 	/* Let the FDW do its planning */
-	fdwplan = fdwroutine->PlanForeignScan(rte->relid, root, rel);
+	rte = planner_rt_fetch(rel->relid, root);
+	Assert(rel->fdwroutine != NULL);
+	fdwplan = rel->fdwroutine->PlanForeignScan(rte->relid, root, rel);
 	if (fdwplan == NULL || !IsA(fdwplan, FdwPlan))
 		elog(ERROR, "foreign-data wrapper PlanForeignScan function for relation %u did not return an FdwPlan struct",
 			 rte->relid);
 	pathnode->fdwplan = fdwplan;
+	pathnode->joinrestrictinfo = NIL;
+
+	/* use costs and sort order given by FDW */
+	pathnode->path.startup_cost = fdwplan->startup_cost;
+	pathnode->path.total_cost = fdwplan->total_cost;
+	pathnode->path.pathkeys = fdwplan->pathkeys;
+
+	return pathnode;
+}
+
+/*
+ * create_foreignjoin_path
+ *	  Creates a path corresponding to a join of foreign tables performed by
+ *	  their foreign server, returning the pathnode; or NULL if the FDW
+ *	  can't do this join.
+ *
+ * The arguments are as for add_paths_to_joinrel.
+ */
+ForeignPath *
+create_foreignjoin_path(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						RelOptInfo *outerrel,
+						RelOptInfo *innerrel,
+						JoinType jointype,
+						SpecialJoinInfo *sjinfo,
+						List *restrictlist)
+{
+	ForeignPath *pathnode;
+	FdwPlan    *fdwplan;
+	ListCell   *l;
+
+	Assert(joinrel->fdwroutine != NULL &&
+		   joinrel->fdwroutine->PlanForeignJoin != NULL);
+	fdwplan = joinrel->fdwroutine->PlanForeignJoin(root, joinrel,
+												   outerrel, innerrel,
+												   jointype, sjinfo,
+												   restrictlist);
+	if (fdwplan == NULL)
+		return NULL;
+	if (!IsA(fdwplan, FdwPlan))
+		elog(ERROR, "foreign-data wrapper PlanForeignJoin function did not return an FdwPlan struct");
+
+	/*
+	 * The ForeignScan node can check clauses that are applied after the
+	 * join, but the join clauses proper of an outer join have to be done
+	 * remotely.
+	 */
+	foreach(l, restrictlist)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(l);
+
+		if (!rinfo->is_pushed_down &&
+			!list_member_ptr(fdwplan->remote_conds, rinfo->clause))
+			elog(ERROR, "foreign-data wrapper PlanForeignJoin function did not enforce all join clauses");
+	}
+
+	pathnode = makeNode(ForeignPath);
+	pathnode->path.pathtype = T_ForeignScan;
+	pathnode->path.parent = joinrel;
+	pathnode->fdwplan = fdwplan;
+	pathnode->joinrestrictinfo = restrictlist;
 
-	/* use costs estimated by FDW */
+	/* use costs and sort order given by FDW */
 	pathnode->path.startup_cost = fdwplan->startup_cost;
 	pathnode->path.total_cost = fdwplan->total_cost;
+	pathnode->path.pathkeys = fdwplan->pathkeys;
 
 	return pathnode;
 }
@@ -1493,6 +1621,7 @@ create_foreignscan_path(PlannerInfo *root, RelOptInfo *rel)
  * 'joinrel' is the join relation.
  * 'jointype' is the type of join required
  * 'sjinfo' is extra info about the join for selectivity estimation
+ * 'inner_unique' is true if each outer tuple matches at most one inner tuple
  * 'outer_path' is the outer path
  * 'inner_path' is the inner path
  * 'restrict_clauses' are the RestrictInfo nodes to apply at the join
@@ -1505,6 +1634,7 @@ create_nestloop_path(PlannerInfo *root,
 					 RelOptInfo *joinrel,
 					 JoinType jointype,
 					 SpecialJoinInfo *sjinfo,
+					 bool inner_unique,
 					 Path *outer_path,
 					 Path *inner_path,
 					 List *restrict_clauses,
@@ -1515,6 +1645,7 @@ create_nestloop_path(PlannerInfo *root,
 	pathnode->path.pathtype = T_NestLoop;
 	pathnode->path.parent = joinrel;
 	pathnode->jointype = jointype;
+	pathnode->inner_unique = inner_unique;
 	pathnode->outerjoinpath = outer_path;
 	pathnode->innerjoinpath = inner_path;
 	pathnode->joinrestrictinfo = restrict_clauses;
@@ -1533,6 +1664,7 @@ create_nestloop_path(PlannerInfo *root,
  * 'joinrel' is the join relation
  * 'jointype' is the type of join required
  * 'sjinfo' is extra info about the join for selectivity estimation
+ * 'inner_unique' is true if each outer tuple matches at most one inner tuple
  * 'outer_path' is the outer path
  * 'inner_path' is the inner path
  * 'restrict_clauses' are the RestrictInfo nodes to apply at the join
@@ -1547,6 +1679,7 @@ create_mergejoin_path(PlannerInfo *root,
 					  RelOptInfo *joinrel,
 					  JoinType jointype,
 					  SpecialJoinInfo *sjinfo,
+					  bool inner_unique,
 					  Path *outer_path,
 					  Path *inner_path,
 					  List *restrict_clauses,
@@ -1571,6 +1704,7 @@ create_mergejoin_path(PlannerInfo *root,
 	pathnode->jpath.path.pathtype = T_MergeJoin;
 	pathnode->jpath.path.parent = joinrel;
 	pathnode->jpath.jointype = jointype;
+	pathnode->jpath.inner_unique = inner_unique;
 	pathnode->jpath.outerjoinpath = outer_path;
 	pathnode->jpath.innerjoinpath = inner_path;
 	pathnode->jpath.joinrestrictinfo = restrict_clauses;
@@ -1592,6 +1726,7 @@ create_mergejoin_path(PlannerInfo *root,
  * 'joinrel' is the join relation
  * 'jointype' is the type of join required
  * 'sjinfo' is extra info about the join for selectivity estimation
+ * 'inner_unique' is true if each outer tuple matches at most one inner tuple
  * 'outer_path' is the cheapest outer path
  * 'inner_path' is the cheapest inner path
  * 'restrict_clauses' are the RestrictInfo nodes to apply at the join
@@ -1603,6 +1738,7 @@ create_hashjoin_path(PlannerInfo *root,
 					 RelOptInfo *joinrel,
 					 JoinType jointype,
 					 SpecialJoinInfo *sjinfo,
+					 bool inner_unique,
 					 Path *outer_path,
 					 Path *inner_path,
 					 List *restrict_clauses,
@@ -1613,6 +1749,7 @@ create_hashjoin_path(PlannerInfo *root,
 	pathnode->jpath.path.pathtype = T_HashJoin;
 	pathnode->jpath.path.parent = joinrel;
 	pathnode->jpath.jointype = jointype;
+	pathnode->jpath.inner_unique = inner_unique;
 	pathnode->jpath.outerjoinpath = outer_path;
 	pathnode->jpath.innerjoinpath = inner_path;
 	pathnode->jpath.joinrestrictinfo = restrict_clauses;
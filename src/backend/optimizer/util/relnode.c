@@ -107,11 +107,15 @@ build_simple_rel(PlannerInfo *root, int relid, RelOptKind reloptkind)
 	rel->rtekind = rte->rtekind;
 	/* min_attr, max_attr, attr_needed, attr_widths are set below */
 	rel->indexlist = NIL;
+	rel->extstats = NIL;
 	rel->pages = 0;
 	rel->tuples = 0;
 	rel->allvisfrac = 0;
 	rel->subplan = NULL;
 	rel->subroot = NULL;
+	rel->serverid = InvalidOid;
+	rel->fdwroutine = NULL;
+	rel->fdw_private = NULL;
 	rel->baserestrictinfo = NIL;
 	rel->baserestrictcost.startup = 0;
 	rel->baserestrictcost.per_tuple = 0;
@@ -361,11 +365,15 @@ build_join_rel(PlannerInfo *root,
 	joinrel->attr_needed = NULL;
 	joinrel->attr_widths = NULL;
 	joinrel->indexlist = NIL;
+	joinrel->extstats = NIL;
 	joinrel->pages = 0;
 	joinrel->tuples = 0;
 	joinrel->allvisfrac = 0;
 	joinrel->subplan = NULL;
 	joinrel->subroot = NULL;
+	joinrel->serverid = InvalidOid;
+	joinrel->fdwroutine = NULL;
+	joinrel->fdw_private = NULL;
 	joinrel->baserestrictinfo = NIL;
 	joinrel->baserestrictcost.startup = 0;
 	joinrel->baserestrictcost.per_tuple = 0;
@@ -374,6 +382,18 @@ build_join_rel(PlannerInfo *root,
 	joinrel->index_outer_relids = NULL;
 	joinrel->index_inner_paths = NIL;
 
+	/*
+	 * A join of foreign tables that all belong to the same server might be
+	 * done by that server, so remember it.  (Any other pair of input rels
+	 * for this joinrel would give the same answer.)
+	 */
+	if (OidIsValid(outer_rel->serverid) &&
+		inner_rel->serverid == outer_rel->serverid)
+	{
+		joinrel->serverid = outer_rel->serverid;
+		joinrel->fdwroutine = outer_rel->fdwroutine;
+	}
+
 	/*
 	 * Create a new tlist containing just the vars that need to be output from
 	 * this join (ie, are needed for higher joinclauses or final output).
@@ -446,6 +466,49 @@ build_join_rel(PlannerInfo *root,
 	return joinrel;
 }
 
+/*
+ * build_child_join_rel
+ *	  Build the join of two appendrel members, for a partition-wise join
+ *	  of their parents (see try_partitionwise_join).
+ *
+ * The caller supplies the targetlist and restrictlist, which are those of
+ * 'parent_joinrel' translated to refer to the members.  The new rel is not
+ * entered in the query's joinrel list, since only the parent joinrel's
+ * paths ever refer to it.
+ */
+RelOptInfo *
+build_child_join_rel(PlannerInfo *root,
+					 RelOptInfo *parent_joinrel,
+					 RelOptInfo *outer_rel,
+					 RelOptInfo *inner_rel,
+					 List *reltargetlist,
+					 SpecialJoinInfo *sjinfo,
+					 List *restrictlist)
+{
+	RelOptInfo *joinrel;
+
+	joinrel = makeNode(RelOptInfo);
+	joinrel->reloptkind = RELOPT_JOINREL;
+	joinrel->relids = bms_union(outer_rel->relids, inner_rel->relids);
+	joinrel->rows = 0;
+	joinrel->width = parent_joinrel->width;
+	joinrel->reltargetlist = reltargetlist;
+	joinrel->pathlist = NIL;
+	joinrel->cheapest_startup_path = NULL;
+	joinrel->cheapest_total_path = NULL;
+	joinrel->cheapest_unique_path = NULL;
+	joinrel->relid = 0;			/* indicates not a baserel */
+	joinrel->rtekind = RTE_JOIN;
+	joinrel->baserestrictinfo = NIL;
+	joinrel->joininfo = NIL;
+	joinrel->has_eclass_joins = false;
+
+	set_joinrel_size_estimates(root, joinrel, outer_rel, inner_rel,
+							   sjinfo, restrictlist);
+
+	return joinrel;
+}
+
 /*
  * build_joinrel_tlist
  *	  Builds a join relation's target list from an input relation.
@@ -641,6 +641,11 @@ select_nonredundant_join_clauses(PlannerInfo *root,
 								 List *restrictinfo_list,
 								 Path *inner_path)
 {
+	/* A caching Material returns just what its indexscan does */
+	if (IsA(inner_path, MaterialPath) &&
+		((MaterialPath *) inner_path)->cache_keys != NIL)
+		inner_path = ((MaterialPath *) inner_path)->subpath;
+
 	if (IsA(inner_path, IndexPath))
 	{
 		/*
@@ -56,6 +56,8 @@ static Node *transformSetOperationTree(ParseState *pstate, SelectStmt *stmt,
 						  bool isTopLevel, List **targetlist);
 static void determineRecursiveColTypes(ParseState *pstate,
 						   Node *larg, List *nrtargetlist);
+static void setMatViewQuery(Query *qry);
+static bool query_contains_extern_params_walker(Node *node, void *context);
 static Query *transformUpdateStmt(ParseState *pstate, UpdateStmt *stmt);
 static List *transformReturningList(ParseState *pstate, List *returningList);
 static Query *transformDeclareCursorStmt(ParseState *pstate,
@@ -66,6 +68,10 @@ static void transformLockingClause(ParseState *pstate, Query *qry,
 					   LockingClause *lc, bool pushedDown);
 
 
+/* Hook for plugins to get control at end of parse analysis */
+post_parse_analyze_hook_type post_parse_analyze_hook = NULL;
+
+
 /*
  * parse_analyze
  *		Analyze a raw parse tree and transform it to Query form.
@@ -93,6 +99,9 @@ parse_analyze(Node *parseTree, const char *sourceText,
 
 	query = transformStmt(pstate, parseTree);
 
+	if (post_parse_analyze_hook)
+		(*post_parse_analyze_hook) (pstate, query);
+
 	free_parsestate(pstate);
 
 	return query;
@@ -123,6 +132,9 @@ parse_analyze_varparams(Node *parseTree, const char *sourceText,
 	/* make sure all is well with parameter types */
 	check_variable_parameters(pstate, query);
 
+	if (post_parse_analyze_hook)
+		(*post_parse_analyze_hook) (pstate, query);
+
 	free_parsestate(pstate);
 
 	return query;
@@ -186,6 +198,10 @@ transformStmt(ParseState *pstate, Node *parseTree)
 					result = transformSelectStmt(pstate, n);
 				else
 					result = transformSetOperationStmt(pstate, n);
+
+				if (result->intoClause != NULL &&
+					result->intoClause->relkind == RELKIND_MATVIEW)
+					setMatViewQuery(result);
 			}
 			break;
 
@@ -1864,6 +1880,79 @@ determineRecursiveColTypes(ParseState *pstate, Node *larg, List *nrtargetlist)
 }
 
 
+/*
+ * setMatViewQuery
+ *		Check the query of a CREATE MATERIALIZED VIEW and save a copy of it
+ *		in the IntoClause.
+ *
+ * The copy becomes the view's ON SELECT rule, from which REFRESH runs the
+ * query again, so it must be able to stand on its own.
+ */
+static void
+setMatViewQuery(Query *qry)
+{
+	IntoClause *into = qry->intoClause;
+	Query	   *viewQuery;
+
+	if (qry->hasModifyingCTE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialized views must not use data-modifying statements in WITH")));
+	if (query_contains_extern_params_walker((Node *) qry, NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialized views may not be defined using bound parameters")));
+
+	/*
+	 * transformStmt hasn't marked the query yet; REFRESH runs the copy as a
+	 * top-level query, so mark it the same way.
+	 */
+	viewQuery = (Query *) copyObject(qry);
+	viewQuery->intoClause = NULL;
+	viewQuery->querySource = QSRC_ORIGINAL;
+	viewQuery->canSetTag = true;
+
+	/*
+	 * The rule's targetlist must carry the view's column names; apply any
+	 * that were given explicitly.  Having too many of them is reported when
+	 * the view is created.
+	 */
+	if (into->colNames != NIL)
+	{
+		ListCell   *colname = list_head(into->colNames);
+		ListCell   *tl;
+
+		foreach(tl, viewQuery->targetList)
+		{
+			TargetEntry *tle = (TargetEntry *) lfirst(tl);
+
+			if (tle->resjunk)
+				continue;
+			tle->resname = pstrdup(strVal(lfirst(colname)));
+			colname = lnext(colname);
+			if (colname == NULL)
+				break;
+		}
+	}
+
+	into->viewQuery = (Node *) viewQuery;
+}
+
+static bool
+query_contains_extern_params_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+		return ((Param *) node)->paramkind == PARAM_EXTERN;
+	if (IsA(node, Query))
+		return query_tree_walker((Query *) node,
+								 query_contains_extern_params_walker,
+								 context, 0);
+	return expression_tree_walker(node, query_contains_extern_params_walker,
+								  context);
+}
+
 /*
  * transformUpdateStmt -
  *	  transforms an update statement
@@ -1108,8 +1108,9 @@ generateClonedIndexStmt(CreateStmtContext *cxt, Relation source_idx,
 	else
 		indexprs = NIL;
 
-	/* Build the list of IndexElem */
+	/* Build the lists of IndexElem */
 	index->indexParams = NIL;
+	index->indexIncludingParams = NIL;
 
 	indexpr_item = list_head(indexprs);
 	for (keyno = 0; keyno < idxrec->indnatts; keyno++)
@@ -1153,6 +1154,16 @@ generateClonedIndexStmt(CreateStmtContext *cxt, Relation source_idx,
 		/* Copy the original index column name */
 		iparam->indexcolname = pstrdup(NameStr(attrs[keyno]->attname));
 
+		/* INCLUDE columns have nothing more to copy */
+		if (keyno >= idxrec->indnkeyatts)
+		{
+			iparam->ordering = SORTBY_DEFAULT;
+			iparam->nulls_ordering = SORTBY_NULLS_DEFAULT;
+			index->indexIncludingParams =
+				lappend(index->indexIncludingParams, iparam);
+			continue;
+		}
+
 		/* Add the collation name, if non-default */
 		iparam->collation = get_collation(indcollation->values[keyno], keycoltype);
 
@@ -1531,6 +1542,14 @@ transformIndexConstraint(Constraint *constraint, CreateStmtContext *cxt)
 					 errdetail("Cannot create a primary key or unique constraint using such an index."),
 					 parser_errposition(cxt->pstate, constraint->location)));
 
+		/* Constraint syntax has no INCLUDE, so we couldn't dump it either */
+		if (index_form->indnkeyatts != index_form->indnatts)
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("index \"%s\" contains included columns", index_name),
+					 errdetail("Cannot create a primary key or unique constraint using such an index."),
+					 parser_errposition(cxt->pstate, constraint->location)));
+
 		/*
 		 * It's probably unsafe to change a deferred index to non-deferred. (A
 		 * non-constraint index couldn't be deferred anyway, so this case
@@ -1963,6 +1982,12 @@ transformRuleStmt(RuleStmt *stmt, const char *queryString,
 	 */
 	rel = heap_openrv(stmt->relation, AccessExclusiveLock);
 
+	/* A matview's only rule is the one holding its defining query */
+	if (rel->rd_rel->relkind == RELKIND_MATVIEW)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("rules on materialized views are not supported")));
+
 	/* Set up pstate */
 	pstate = make_parsestate(NULL);
 	pstate->p_sourcetext = queryString;
@@ -29,6 +29,9 @@
 #ifdef HAVE_KERNEL_OS_H
 #include <kernel/OS.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "miscadmin.h"
 #include "storage/ipc.h"
@@ -46,11 +49,35 @@ typedef int IpcMemoryId;		/* shared memory ID returned by shmget(2) */
 #define PG_SHMAT_FLAGS			0
 #endif
 
+/*
+ * Linux lets us ask for a SysV segment backed by huge pages.  The encoding
+ * of a non-default huge page size in the shmget flags is kernel ABI, but
+ * older C libraries don't define it.
+ */
+#if defined(SHM_HUGETLB) && !defined(SHM_HUGE_SHIFT)
+#define SHM_HUGE_SHIFT			26
+#endif
+
+/* Likewise for the mbind(2) policy we use for NUMA interleaving */
+#if defined(__linux__) && defined(SYS_mbind)
+#define PG_HAVE_MBIND
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE			3
+#endif
+#endif
+
+/* huge page size assumed if the kernel doesn't tell us otherwise */
+#define DEFAULT_HUGE_PAGE_SIZE	(2 * 1024 * 1024)
+
 
 unsigned long UsedShmemSegID = 0;
 void	   *UsedShmemSegAddr = NULL;
 
 static void *InternalIpcMemoryCreate(IpcMemoryKey memKey, Size size);
+#ifdef SHM_HUGETLB
+static Size GetHugePageSize(int *sizeflags);
+#endif
+static void InterleaveSharedMemory(void *memAddress, Size size);
 static void IpcMemoryDetach(int status, Datum shmaddr);
 static void IpcMemoryDelete(int status, Datum shmId);
 static PGShmemHeader *PGSharedMemoryAttach(IpcMemoryKey key,
@@ -72,10 +99,68 @@ static PGShmemHeader *PGSharedMemoryAttach(IpcMemoryKey key,
 static void *
 InternalIpcMemoryCreate(IpcMemoryKey memKey, Size size)
 {
-	IpcMemoryId shmid;
+	IpcMemoryId shmid = -1;
 	void	   *memAddress;
+	Size		allocsize = size;
+
+#ifdef SHM_HUGETLB
+	if (huge_pages != HUGE_PAGES_OFF)
+	{
+		int			sizeflags;
+		Size		hugepagesize = GetHugePageSize(&sizeflags);
 
-	shmid = shmget(memKey, size, IPC_CREAT | IPC_EXCL | IPCProtection);
+		/* a huge page segment must be a whole number of huge pages */
+		if (size % hugepagesize != 0)
+			allocsize = size + (hugepagesize - size % hugepagesize);
+
+		shmid = shmget(memKey, allocsize,
+					   IPC_CREAT | IPC_EXCL | IPCProtection |
+					   SHM_HUGETLB | sizeflags);
+
+		/*
+		 * A collision is reported below just as for a normal segment.  In
+		 * "try" mode, any other failure (most likely a lack of privilege, or
+		 * of free huge pages) makes us fall back to normal pages.
+		 */
+		if (shmid < 0 && huge_pages == HUGE_PAGES_TRY &&
+			errno != EEXIST && errno != EACCES
+#ifdef EIDRM
+			&& errno != EIDRM
+#endif
+			)
+		{
+			elog(DEBUG1, "shmget(key=%lu, size=%lu) with SHM_HUGETLB failed, huge pages disabled: %m",
+				 (unsigned long) memKey, (unsigned long) allocsize);
+			allocsize = size;
+			shmid = shmget(memKey, size, IPC_CREAT | IPC_EXCL | IPCProtection);
+		}
+		else if (shmid < 0 && huge_pages == HUGE_PAGES_ON &&
+				 errno != EEXIST && errno != EACCES
+#ifdef EIDRM
+				 && errno != EIDRM
+#endif
+			)
+			ereport(FATAL,
+					(errmsg("could not create shared memory segment with huge pages: %m"),
+					 errdetail("Failed system call was shmget(key=%lu, size=%lu, 0%o).",
+							   (unsigned long) memKey, (unsigned long) allocsize,
+							   IPC_CREAT | IPC_EXCL | IPCProtection | SHM_HUGETLB | sizeflags),
+					 (errno == ENOMEM) ?
+					 errhint("This error usually means that there are not enough huge pages "
+							 "reserved in the kernel (see vm.nr_hugepages).  You can reserve "
+							 "more, or set huge_pages to \"try\" or \"off\".") :
+					 errhint("The server user must be allowed to use huge pages "
+							 "(see vm.hugetlb_shm_group), or huge_pages must be set to "
+							 "\"try\" or \"off\".")));
+	}
+	else
+#else
+	if (huge_pages == HUGE_PAGES_ON)
+		ereport(FATAL,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("huge pages are not supported on this platform")));
+#endif
+		shmid = shmget(memKey, size, IPC_CREAT | IPC_EXCL | IPCProtection);
 
 	if (shmid < 0)
 	{
@@ -197,6 +282,10 @@ InternalIpcMemoryCreate(IpcMemoryKey memKey, Size size)
 	/* Register on-exit routine to detach new segment before deleting */
 	on_shmem_exit(IpcMemoryDetach, PointerGetDatum(memAddress));
 
+	/* The memory policy must be set before any page is touched */
+	if (numa_interleave)
+		InterleaveSharedMemory(memAddress, allocsize);
+
 	/*
 	 * Store shmem key and ID in data directory lockfile.  Format to try to
 	 * keep it the same length always (trailing junk in the lockfile won't
@@ -213,6 +302,124 @@ InternalIpcMemoryCreate(IpcMemoryKey memKey, Size size)
 	return memAddress;
 }
 
+#ifdef SHM_HUGETLB
+/*
+ * GetHugePageSize
+ *
+ * Return the size of the huge pages we will ask for, and set *sizeflags to
+ * the shmget flags that select it.  If huge_page_size is zero we use the
+ * kernel's default huge page size, as reported in /proc/meminfo.
+ */
+static Size
+GetHugePageSize(int *sizeflags)
+{
+	Size		result = DEFAULT_HUGE_PAGE_SIZE;
+	FILE	   *fp;
+
+	*sizeflags = 0;
+
+	if (huge_page_size != 0)
+	{
+		int			shift = 0;
+
+		result = (Size) huge_page_size * 1024;
+
+		/* the kernel wants the log2 of the page size */
+		while (((Size) 1 << shift) < result)
+			shift++;
+		if (((Size) 1 << shift) != result)
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("huge_page_size must be a power of 2")));
+		*sizeflags = shift << SHM_HUGE_SHIFT;
+		return result;
+	}
+
+	fp = fopen("/proc/meminfo", "r");
+	if (fp)
+	{
+		char		buf[128];
+		unsigned long sz;
+
+		while (fgets(buf, sizeof(buf), fp))
+		{
+			if (sscanf(buf, "Hugepagesize: %lu kB", &sz) == 1)
+			{
+				if (sz > 0)
+					result = (Size) sz * 1024;
+				break;
+			}
+		}
+		fclose(fp);
+	}
+
+	return result;
+}
+#endif   /* SHM_HUGETLB */
+
+/*
+ * InterleaveSharedMemory
+ *
+ * Ask the kernel to spread the pages of the segment round-robin over all
+ * NUMA nodes that have memory, so that the buffer pool doesn't all end up on
+ * the node the postmaster happened to run on.  (Nodes without memory are
+ * ignored by the kernel.)  Failure is not fatal; the server works fine
+ * without it, if perhaps more slowly.
+ */
+static void
+InterleaveSharedMemory(void *memAddress, Size size)
+{
+#ifdef PG_HAVE_MBIND
+	unsigned long nodemask[16];
+	unsigned long maxnode = 0;
+	FILE	   *fp;
+	int			lo,
+				hi;
+	char		sep;
+
+	memset(nodemask, 0, sizeof(nodemask));
+
+	/* the file holds a list of ranges of node numbers, such as "0-3,6" */
+	fp = fopen("/sys/devices/system/node/online", "r");
+	if (fp == NULL)
+	{
+		elog(WARNING, "could not determine NUMA nodes, shared memory not interleaved: %m");
+		return;
+	}
+	while (fscanf(fp, "%d", &lo) == 1)
+	{
+		hi = lo;
+		sep = fgetc(fp);
+		if (sep == '-')
+		{
+			if (fscanf(fp, "%d", &hi) != 1)
+				break;
+			sep = fgetc(fp);
+		}
+		for (; lo <= hi && lo >= 0 && lo < (int) (sizeof(nodemask) * 8); lo++)
+		{
+			nodemask[lo / (sizeof(unsigned long) * 8)] |=
+				1UL << (lo % (sizeof(unsigned long) * 8));
+			maxnode = lo + 1;
+		}
+		if (sep != ',')
+			break;
+	}
+	fclose(fp);
+
+	/* a single node has nothing to interleave with */
+	if (maxnode <= 1)
+		return;
+
+	/* mbind wants one more than the highest node number */
+	if (syscall(SYS_mbind, memAddress, (unsigned long) size, MPOL_INTERLEAVE,
+				nodemask, maxnode + 1, 0) != 0)
+		elog(WARNING, "could not interleave shared memory across NUMA nodes: %m");
+#else
+	elog(WARNING, "NUMA interleaving of shared memory is not supported on this platform");
+#endif
+}
+
 /****************************************************************************/
 /*	IpcMemoryDetach(status, shmaddr)	removes a shared memory segment		*/
 /*										from process' address spaceq		*/
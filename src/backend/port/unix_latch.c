@@ -48,6 +48,7 @@
 #endif
 
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "postmaster/postmaster.h"
 #include "storage/latch.h"
 #include "storage/shmem.h"
@@ -183,11 +184,25 @@ WaitLatch(volatile Latch *latch, int wakeEvents, long timeout)
 int
 WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 				  long timeout)
+{
+	return WaitLatchOrSockets(latch, wakeEvents, &sock,
+							  (sock == PGINVALID_SOCKET) ? 0 : 1, timeout);
+}
+
+/*
+ * Like WaitLatchOrSocket, but waits for the WL_SOCKET_* conditions on any
+ * of an array of up to MAX_WAIT_SOCKETS sockets.  The result doesn't say
+ * which socket became ready; the caller must check them all.
+ */
+int
+WaitLatchOrSockets(volatile Latch *latch, int wakeEvents,
+				   const pgsocket *socks, int nsocks, long timeout)
 {
 	int			result = 0;
 	int			rc;
+	int			i;
 #ifdef HAVE_POLL
-	struct pollfd pfds[3];
+	struct pollfd pfds[MAX_WAIT_SOCKETS + 2];
 	int			nfds;
 #else
 	struct timeval tv,
@@ -197,9 +212,13 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 	int			hifd;
 #endif
 
-	/* Ignore WL_SOCKET_* events if no valid socket is given */
-	if (sock == PGINVALID_SOCKET)
+	/* Ignore WL_SOCKET_* events if no sockets are given, and vice versa */
+	if (nsocks == 0)
 		wakeEvents &= ~(WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE);
+	if (!(wakeEvents & (WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE)))
+		nsocks = 0;
+
+	Assert(nsocks >= 0 && nsocks <= MAX_WAIT_SOCKETS);
 
 	Assert(wakeEvents != 0);	/* must have at least one wake event */
 
@@ -225,6 +244,7 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 	}
 
 	waiting = true;
+	pgstat_report_wait_start(WAIT_EVENT_LATCH);
 	do
 	{
 		/*
@@ -256,15 +276,18 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 		nfds = 0;
 		if (wakeEvents & (WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE))
 		{
-			/* socket, if used, is always in pfds[0] */
-			pfds[0].fd = sock;
-			pfds[0].events = 0;
-			if (wakeEvents & WL_SOCKET_READABLE)
-				pfds[0].events |= POLLIN;
-			if (wakeEvents & WL_SOCKET_WRITEABLE)
-				pfds[0].events |= POLLOUT;
-			pfds[0].revents = 0;
-			nfds++;
+			/* sockets, if used, are always in pfds[0 .. nsocks - 1] */
+			for (i = 0; i < nsocks; i++)
+			{
+				pfds[nfds].fd = socks[i];
+				pfds[nfds].events = 0;
+				if (wakeEvents & WL_SOCKET_READABLE)
+					pfds[nfds].events |= POLLIN;
+				if (wakeEvents & WL_SOCKET_WRITEABLE)
+					pfds[nfds].events |= POLLOUT;
+				pfds[nfds].revents = 0;
+				nfds++;
+			}
 		}
 
 		pfds[nfds].fd = selfpipe_readfd;
@@ -299,16 +322,19 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 			/* timeout exceeded */
 			result |= WL_TIMEOUT;
 		}
-		if ((wakeEvents & WL_SOCKET_READABLE) &&
-			(pfds[0].revents & POLLIN))
+		for (i = 0; i < nsocks; i++)
 		{
-			/* data available in socket */
-			result |= WL_SOCKET_READABLE;
-		}
-		if ((wakeEvents & WL_SOCKET_WRITEABLE) &&
-			(pfds[0].revents & POLLOUT))
-		{
-			result |= WL_SOCKET_WRITEABLE;
+			if ((wakeEvents & WL_SOCKET_READABLE) &&
+				(pfds[i].revents & POLLIN))
+			{
+				/* data available in socket */
+				result |= WL_SOCKET_READABLE;
+			}
+			if ((wakeEvents & WL_SOCKET_WRITEABLE) &&
+				(pfds[i].revents & POLLOUT))
+			{
+				result |= WL_SOCKET_WRITEABLE;
+			}
 		}
 		if ((wakeEvents & WL_POSTMASTER_DEATH) &&
 			(pfds[nfds - 1].revents & POLLIN))
@@ -331,18 +357,21 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 				hifd = postmaster_alive_fds[POSTMASTER_FD_WATCH];
 		}
 
-		if (wakeEvents & WL_SOCKET_READABLE)
+		for (i = 0; i < nsocks; i++)
 		{
-			FD_SET(sock, &input_mask);
-			if (sock > hifd)
-				hifd = sock;
-		}
+			if (wakeEvents & WL_SOCKET_READABLE)
+			{
+				FD_SET(socks[i], &input_mask);
+				if (socks[i] > hifd)
+					hifd = socks[i];
+			}
 
-		if (wakeEvents & WL_SOCKET_WRITEABLE)
-		{
-			FD_SET(sock, &output_mask);
-			if (sock > hifd)
-				hifd = sock;
+			if (wakeEvents & WL_SOCKET_WRITEABLE)
+			{
+				FD_SET(socks[i], &output_mask);
+				if (socks[i] > hifd)
+					hifd = socks[i];
+			}
 		}
 
 		/* Sleep */
@@ -363,14 +392,19 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 			/* timeout exceeded */
 			result |= WL_TIMEOUT;
 		}
-		if ((wakeEvents & WL_SOCKET_READABLE) && FD_ISSET(sock, &input_mask))
-		{
-			/* data available in socket */
-			result |= WL_SOCKET_READABLE;
-		}
-		if ((wakeEvents & WL_SOCKET_WRITEABLE) && FD_ISSET(sock, &output_mask))
+		for (i = 0; i < nsocks; i++)
 		{
-			result |= WL_SOCKET_WRITEABLE;
+			if ((wakeEvents & WL_SOCKET_READABLE) &&
+				FD_ISSET(socks[i], &input_mask))
+			{
+				/* data available in socket */
+				result |= WL_SOCKET_READABLE;
+			}
+			if ((wakeEvents & WL_SOCKET_WRITEABLE) &&
+				FD_ISSET(socks[i], &output_mask))
+			{
+				result |= WL_SOCKET_WRITEABLE;
+			}
 		}
 		if ((wakeEvents & WL_POSTMASTER_DEATH) &&
 			 FD_ISSET(postmaster_alive_fds[POSTMASTER_FD_WATCH], &input_mask))
@@ -380,6 +414,7 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 #endif /* HAVE_POLL */
 	} while (result == 0);
 	waiting = false;
+	pgstat_report_wait_end();
 
 	return result;
 }
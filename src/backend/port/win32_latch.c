@@ -24,6 +24,7 @@
 #include <unistd.h>
 
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "postmaster/postmaster.h"
 #include "storage/latch.h"
 #include "storage/shmem.h"
@@ -91,20 +92,32 @@ WaitLatch(volatile Latch *latch, int wakeEvents, long timeout)
 int
 WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 				  long timeout)
+{
+	return WaitLatchOrSockets(latch, wakeEvents, &sock,
+							  (sock == PGINVALID_SOCKET) ? 0 : 1, timeout);
+}
+
+int
+WaitLatchOrSockets(volatile Latch *latch, int wakeEvents,
+				   const pgsocket *socks, int nsocks, long timeout)
 {
 	DWORD		rc;
-	HANDLE		events[4];
+	HANDLE		events[MAX_WAIT_SOCKETS + 3];
 	HANDLE		latchevent;
-	HANDLE		sockevent = WSA_INVALID_EVENT;
+	HANDLE		sockevents[MAX_WAIT_SOCKETS];
 	int			numevents;
 	int			result = 0;
 	int			pmdeath_eventno = 0;
+	int			i;
 
-	/* Ignore WL_SOCKET_* events if no valid socket is given */
-	if (sock == PGINVALID_SOCKET)
+	/* Ignore WL_SOCKET_* events if no sockets are given, and vice versa */
+	if (nsocks == 0)
 		wakeEvents &= ~(WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE);
+	if (!(wakeEvents & (WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE)))
+		nsocks = 0;
 
 	Assert(wakeEvents != 0);	/* must have at least one wake event */
+	Assert(nsocks >= 0 && nsocks <= MAX_WAIT_SOCKETS);
 
 	if ((wakeEvents & WL_LATCH_SET) && latch->owner_pid != MyProcPid)
 		elog(ERROR, "cannot wait on a latch owned by another process");
@@ -121,8 +134,8 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 	events[0] = latchevent;
 	events[1] = pgwin32_signal_event;
 	numevents = 2;
-	if ((wakeEvents & WL_SOCKET_READABLE) ||
-		(wakeEvents & WL_SOCKET_WRITEABLE))
+	/* sockets, if used, are at event slots 2 .. nsocks + 1 */
+	for (i = 0; i < nsocks; i++)
 	{
 		int			flags = 0;
 
@@ -131,9 +144,9 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 		if (wakeEvents & WL_SOCKET_WRITEABLE)
 			flags |= FD_WRITE;
 
-		sockevent = WSACreateEvent();
-		WSAEventSelect(sock, sockevent, flags);
-		events[numevents++] = sockevent;
+		sockevents[i] = WSACreateEvent();
+		WSAEventSelect(socks[i], sockevents[i], flags);
+		events[numevents++] = sockevents[i];
 	}
 	if (wakeEvents & WL_POSTMASTER_DEATH)
 	{
@@ -141,6 +154,8 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 		events[numevents++] = PostmasterHandle;
 	}
 
+	pgstat_report_wait_start(WAIT_EVENT_LATCH);
+
 	do
 	{
 		/*
@@ -180,13 +195,13 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 			/* Postmaster died */
 			result |= WL_POSTMASTER_DEATH;
 		}
-		else if ((wakeEvents & (WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE)) &&
-				 rc == WAIT_OBJECT_0 + 2)	/* socket is at event slot 2 */
+		else if (rc >= WAIT_OBJECT_0 + 2 && rc < WAIT_OBJECT_0 + 2 + nsocks)
 		{
 			WSANETWORKEVENTS resEvents;
 
+			i = rc - (WAIT_OBJECT_0 + 2);
 			ZeroMemory(&resEvents, sizeof(resEvents));
-			if (WSAEnumNetworkEvents(sock, sockevent, &resEvents) == SOCKET_ERROR)
+			if (WSAEnumNetworkEvents(socks[i], sockevents[i], &resEvents) == SOCKET_ERROR)
 				ereport(FATAL,
 						(errmsg_internal("failed to enumerate network events: error code %lu", GetLastError())));
 
@@ -207,11 +222,13 @@ WaitLatchOrSocket(volatile Latch *latch, int wakeEvents, pgsocket sock,
 	}
 	while (result == 0);
 
-	/* Clean up the handle we created for the socket */
-	if (sockevent != WSA_INVALID_EVENT)
+	pgstat_report_wait_end();
+
+	/* Clean up the handles we created for the sockets */
+	for (i = 0; i < nsocks; i++)
 	{
-		WSAEventSelect(sock, sockevent, 0);
-		WSACloseEvent(sockevent);
+		WSAEventSelect(socks[i], sockevents[i], 0);
+		WSACloseEvent(sockevents[i]);
 	}
 
 	return result;
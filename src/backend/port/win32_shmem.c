@@ -131,6 +131,13 @@ PGSharedMemoryCreate(Size size, bool makePrivate, int port)
 	/* Room for a header? */
 	Assert(size > MAXALIGN(sizeof(PGShmemHeader)));
 
+	if (huge_pages == HUGE_PAGES_ON)
+		ereport(FATAL,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("huge pages are not supported on this platform")));
+	if (numa_interleave)
+		elog(WARNING, "NUMA interleaving of shared memory is not supported on this platform");
+
 	szShareMem = GetSharedMemName();
 
 	UsedShmemSegAddr = NULL;
@@ -109,6 +109,8 @@ int			autovacuum_max_workers;
 int			autovacuum_naptime;
 int			autovacuum_vac_thresh;
 double		autovacuum_vac_scale;
+int			autovacuum_vac_ins_thresh;
+double		autovacuum_vac_ins_scale;
 int			autovacuum_anl_thresh;
 double		autovacuum_anl_scale;
 int			autovacuum_freeze_max_age;
@@ -170,6 +172,13 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/* struct to keep track of how urgently a table needs work, in 1st pass */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	double		ac_score;		/* higher means more urgent */
+} av_candidate;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -180,6 +189,7 @@ typedef struct autovac_table
 	int			at_freeze_table_age;
 	int			at_vacuum_cost_delay;
 	int			at_vacuum_cost_limit;
+	bool		at_dobalance;
 	bool		at_wraparound;
 	char	   *at_relname;
 	char	   *at_nspname;
@@ -196,6 +206,7 @@ typedef struct autovac_table
  * wi_tableoid	OID of the table currently being vacuumed, if any
  * wi_proc		pointer to PGPROC of the running worker, NULL if not started
  * wi_launchtime Time at which this worker was launched
+ * wi_dobalance Whether this worker's cost limit is part of the global balance
  * wi_cost_*	Vacuum cost-based delay parameters current in this worker
  *
  * All fields are protected by AutovacuumLock, except for wi_tableoid which is
@@ -210,6 +221,7 @@ typedef struct WorkerInfoData
 	Oid			wi_tableoid;
 	PGPROC	   *wi_proc;
 	TimestampTz wi_launchtime;
+	bool		wi_dobalance;
 	int			wi_cost_delay;
 	int			wi_cost_limit;
 	int			wi_cost_limit_base;
@@ -279,6 +291,7 @@ static void launch_worker(TimestampTz now);
 static List *get_database_list(void);
 static void rebuild_database_list(Oid newdb);
 static int	db_comparator(const void *a, const void *b);
+static int	candidate_comparator(const void *a, const void *b);
 static void autovac_balance_cost(void);
 
 static void do_autovacuum(void);
@@ -289,7 +302,8 @@ static autovac_table *table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 						  Form_pg_class classForm,
 						  PgStat_StatTabEntry *tabentry,
-						  bool *dovacuum, bool *doanalyze, bool *wraparound);
+						  bool *dovacuum, bool *doanalyze, bool *wraparound,
+						  bool *forinserts, double *score);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 						  BufferAccessStrategy bstrategy);
@@ -1055,6 +1069,21 @@ db_comparator(const void *a, const void *b)
 		return (((const avl_dbase *) a)->adl_score < ((const avl_dbase *) b)->adl_score) ? 1 : -1;
 }
 
+/* qsort comparator for av_candidate, most urgent first */
+static int
+candidate_comparator(const void *a, const void *b)
+{
+	const av_candidate *ca = (const av_candidate *) a;
+	const av_candidate *cb = (const av_candidate *) b;
+
+	if (ca->ac_score != cb->ac_score)
+		return (ca->ac_score < cb->ac_score) ? 1 : -1;
+	/* break ties by OID, so that workers agree on the order */
+	if (ca->ac_relid != cb->ac_relid)
+		return (ca->ac_relid > cb->ac_relid) ? 1 : -1;
+	return 0;
+}
+
 /*
  * do_start_worker
  *
@@ -1615,7 +1644,7 @@ AutoVacWorkerMain(int argc, char *argv[])
 		char		dbname[NAMEDATALEN];
 
 		/*
-		 * Report autovac startup to the stats collector.  We deliberately do
+		 * Report autovac startup to the stats system.  We deliberately do
 		 * this before InitPostgres, so that the last_autovac_time will get
 		 * updated even if the connection attempt fails.  This is to prevent
 		 * autovac from getting "stuck" repeatedly selecting an unopenable
@@ -1683,6 +1712,7 @@ FreeWorkerInfo(int code, Datum arg)
 		MyWorkerInfo->wi_tableoid = InvalidOid;
 		MyWorkerInfo->wi_proc = NULL;
 		MyWorkerInfo->wi_launchtime = 0;
+		MyWorkerInfo->wi_dobalance = true;
 		MyWorkerInfo->wi_cost_delay = 0;
 		MyWorkerInfo->wi_cost_limit = 0;
 		MyWorkerInfo->wi_cost_limit_base = 0;
@@ -1729,6 +1759,9 @@ autovac_balance_cost(void)
 	 *
 	 * note: in cost_limit, zero also means use value from elsewhere, because
 	 * zero is not a valid value.
+	 *
+	 * Workers processing a table with cost settings of its own don't take
+	 * part: such a table has a budget of its own, on top of the global one.
 	 */
 	int			vac_cost_limit = (autovacuum_vac_cost_limit > 0 ?
 								autovacuum_vac_cost_limit : VacuumCostLimit);
@@ -1749,7 +1782,7 @@ autovac_balance_cost(void)
 									   offsetof(WorkerInfoData, wi_links));
 	while (worker)
 	{
-		if (worker->wi_proc != NULL &&
+		if (worker->wi_proc != NULL && worker->wi_dobalance &&
 			worker->wi_cost_limit_base > 0 && worker->wi_cost_delay > 0)
 			cost_total +=
 				(double) worker->wi_cost_limit_base / worker->wi_cost_delay;
@@ -1772,7 +1805,7 @@ autovac_balance_cost(void)
 									   offsetof(WorkerInfoData, wi_links));
 	while (worker)
 	{
-		if (worker->wi_proc != NULL &&
+		if (worker->wi_proc != NULL && worker->wi_dobalance &&
 			worker->wi_cost_limit_base > 0 && worker->wi_cost_delay > 0)
 		{
 			int			limit = (int)
@@ -1884,6 +1917,7 @@ do_autovacuum(void)
 	HeapTuple	tuple;
 	HeapScanDesc relScan;
 	Form_pg_database dbForm;
+	List	   *candidates = NIL;
 	List	   *table_oids = NIL;
 	HASHCTL		ctl;
 	HTAB	   *table_toast_map;
@@ -1916,7 +1950,7 @@ do_autovacuum(void)
 	StartTransactionCommand();
 
 	/*
-	 * Clean up any dead statistics collector entries for this DB. We always
+	 * Clean up any dead statistics entries for this DB. We always
 	 * want to do this exactly once per DB-processing cycle, even if we find
 	 * nothing worth vacuuming in the database.
 	 */
@@ -1980,13 +2014,11 @@ do_autovacuum(void)
 	 * We need to check TOAST tables separately because in cases with short,
 	 * wide tables there might be proportionally much more activity in the
 	 * TOAST table than in its parent.
+	 *
+	 * Materialized views are stored as heaps too, so they're processed along
+	 * with the plain tables.
 	 */
-	ScanKeyInit(&key,
-				Anum_pg_class_relkind,
-				BTEqualStrategyNumber, F_CHAREQ,
-				CharGetDatum(RELKIND_RELATION));
-
-	relScan = heap_beginscan(classRel, SnapshotNow, 1, &key);
+	relScan = heap_beginscan(classRel, SnapshotNow, 0, NULL);
 
 	/*
 	 * On the first pass, we collect main tables to vacuum, and also the main
@@ -2001,6 +2033,12 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		bool		forinserts;
+		double		score;
+
+		if (classForm->relkind != RELKIND_RELATION &&
+			classForm->relkind != RELKIND_MATVIEW)
+			continue;
 
 		relid = HeapTupleGetOid(tuple);
 
@@ -2011,7 +2049,8 @@ do_autovacuum(void)
 
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &forinserts, &score);
 
 		/*
 		 * Check if it is a temp table (presumably, of some other backend's).
@@ -2058,9 +2097,15 @@ do_autovacuum(void)
 		}
 		else
 		{
-			/* relations that need work are added to table_oids */
+			/* relations that need work are added to candidates */
 			if (dovacuum || doanalyze)
-				table_oids = lappend_oid(table_oids, relid);
+			{
+				av_candidate *cand = palloc(sizeof(av_candidate));
+
+				cand->ac_relid = relid;
+				cand->ac_score = score;
+				candidates = lappend(candidates, cand);
+			}
 
 			/*
 			 * Remember the association for the second pass.  Note: we must do
@@ -2110,6 +2155,8 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		bool		forinserts;
+		double		score;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
@@ -2139,16 +2186,48 @@ do_autovacuum(void)
 											 shared, dbentry);
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &forinserts, &score);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			av_candidate *cand = palloc(sizeof(av_candidate));
+
+			cand->ac_relid = relid;
+			cand->ac_score = score;
+			candidates = lappend(candidates, cand);
+		}
 	}
 
 	heap_endscan(relScan);
 	heap_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the tables in order of urgency, rather than in pg_class order,
+	 * so that the hottest tables and those nearest to wraparound don't wait
+	 * behind a long vacuum of some big table that barely qualified.
+	 */
+	if (candidates != NIL)
+	{
+		int			ncands = list_length(candidates);
+		av_candidate *cands;
+		int			i;
+
+		cands = palloc(ncands * sizeof(av_candidate));
+		i = 0;
+		foreach(cell, candidates)
+			cands[i++] = *(av_candidate *) lfirst(cell);
+
+		qsort(cands, ncands, sizeof(av_candidate), candidate_comparator);
+
+		for (i = 0; i < ncands; i++)
+			table_oids = lappend_oid(table_oids, cands[i].ac_relid);
+
+		pfree(cands);
+		list_free_deep(candidates);
+	}
+
 	/*
 	 * Create a buffer access strategy object for VACUUM to use.  We want to
 	 * use the same one across all the vacuum operations we perform, since the
@@ -2262,6 +2341,7 @@ do_autovacuum(void)
 		LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
 		/* advertise my cost delay parameters for the balancing algorithm */
+		MyWorkerInfo->wi_dobalance = tab->at_dobalance;
 		MyWorkerInfo->wi_cost_delay = tab->at_vacuum_cost_delay;
 		MyWorkerInfo->wi_cost_limit = tab->at_vacuum_cost_limit;
 		MyWorkerInfo->wi_cost_limit_base = tab->at_vacuum_cost_limit;
@@ -2393,6 +2473,7 @@ extract_autovac_opts(HeapTuple tup, TupleDesc pg_class_desc)
 	AutoVacOpts *av;
 
 	Assert(((Form_pg_class) GETSTRUCT(tup))->relkind == RELKIND_RELATION ||
+		   ((Form_pg_class) GETSTRUCT(tup))->relkind == RELKIND_MATVIEW ||
 		   ((Form_pg_class) GETSTRUCT(tup))->relkind == RELKIND_TOASTVALUE);
 
 	relopts = extractRelOptions(tup, pg_class_desc, InvalidOid);
@@ -2448,17 +2529,12 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 	bool		doanalyze;
 	autovac_table *tab = NULL;
 	PgStat_StatTabEntry *tabentry;
-	PgStat_StatDBEntry *shared;
-	PgStat_StatDBEntry *dbentry;
+	PgStat_StatTabEntry tabbuf;
 	bool		wraparound;
+	bool		forinserts;
+	double		score;
 	AutoVacOpts *avopts;
 
-	/* use fresh stats */
-	autovac_refresh_stats();
-
-	shared = pgstat_fetch_stat_dbentry(InvalidOid);
-	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
-
 	/* fetch the relation's relcache entry */
 	classTup = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(classTup))
@@ -2481,12 +2557,17 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 			avopts = &hentry->ar_reloptions;
 	}
 
-	/* fetch the pgstat table entry */
-	tabentry = get_pgstat_tabentry_relid(relid, classForm->relisshared,
-										 shared, dbentry);
+	/*
+	 * Fetch the current pgstat table entry.  We look at the shared entry
+	 * directly rather than building a whole new stats snapshot, since we
+	 * only need this one table.
+	 */
+	tabentry = pgstat_fetch_current_tabentry(relid, classForm->relisshared,
+											 &tabbuf);
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
-							  &dovacuum, &doanalyze, &wraparound);
+							  &dovacuum, &doanalyze, &wraparound,
+							  &forinserts, &score);
 
 	/* ignore ANALYZE for toast tables */
 	if (classForm->relkind == RELKIND_TOASTVALUE)
@@ -2521,9 +2602,16 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 			? autovacuum_vac_cost_limit
 			: VacuumCostLimit;
 
-		/* these do not have autovacuum-specific settings */
+		/*
+		 * These do not have autovacuum-specific settings.  A vacuum done only
+		 * because of inserts freezes everything it can, though: the pages it
+		 * visits are mostly new ones that nothing will touch again, and
+		 * freezing them now spares an anti-wraparound vacuum from dirtying
+		 * the whole table at once later.
+		 */
 		freeze_min_age = (avopts && avopts->freeze_min_age >= 0)
 			? avopts->freeze_min_age
+			: forinserts ? 0
 			: default_freeze_min_age;
 
 		freeze_table_age = (avopts && avopts->freeze_table_age >= 0)
@@ -2539,6 +2627,15 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 		tab->at_vacuum_cost_limit = vac_cost_limit;
 		tab->at_vacuum_cost_delay = vac_cost_delay;
 		tab->at_wraparound = wraparound;
+
+		/*
+		 * A table whose cost settings were set for it alone gets that budget
+		 * to itself, instead of a share of the global one; that way hot
+		 * tables can be given a dedicated budget.
+		 */
+		tab->at_dobalance = !(avopts &&
+							  (avopts->vacuum_cost_limit > 0 ||
+							   avopts->vacuum_cost_delay >= 0));
 		tab->at_relname = NULL;
 		tab->at_nspname = NULL;
 		tab->at_datname = NULL;
@@ -2554,7 +2651,8 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  *
  * Check whether a relation needs to be vacuumed or analyzed; return each into
  * "dovacuum" and "doanalyze", respectively.  Also return whether the vacuum is
- * being forced because of Xid wraparound.
+ * being forced because of Xid wraparound, whether it's needed only because
+ * of inserted tuples, and in "score" how urgent the work is.
  *
  * relopts is a pointer to the AutoVacOpts options (either for itself in the
  * case of a plain table, or for either itself or its parent table in the case
@@ -2566,24 +2664,37 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
  *
  * threshold = vac_base_thresh + vac_scale_factor * reltuples
  *
+ * It also needs to be vacuumed if the number of tuples inserted since the
+ * last vacuum exceeds a threshold calculated in the same fashion from
+ * vac_ins_base_thresh and vac_ins_scale_factor, unless vac_ins_base_thresh is
+ * -1.  That lets append-only tables get their pages marked all-visible, and
+ * frozen, a bit at a time.
+ *
  * For analyze, the analysis done is that the number of tuples inserted,
  * deleted and updated since the last analyze exceeds a threshold calculated
- * in the same fashion as above.  Note that the collector actually stores
+ * in the same fashion as above.  Note that the stats system actually stores
  * the number of tuples (both live and dead) that there were as of the last
  * analyze.  This is asymmetric to the VACUUM case.
  *
  * We also force vacuum if the table's relfrozenxid is more than freeze_max_age
  * transactions back.
  *
+ * The score is the largest of the ratios of dead tuples to the vacuum
+ * threshold, of inserted tuples to the insert threshold, of changed tuples to the analyze threshold, and of the age of
+ * relfrozenxid to freeze_max_age; it's above 1 exactly when there's work to
+ * do for that reason.
+ *
  * A table whose autovacuum_enabled option is false is
  * automatically skipped (unless we have to vacuum it due to freeze_max_age).
  * Thus autovacuum can be disabled for specific tables. Also, when the stats
- * collector does not have data about a table, it will be skipped.
+ * system does not have data about a table, it will be skipped.
  *
  * A table whose vac_base_thresh value is < 0 takes the base value from the
  * autovacuum_vacuum_threshold GUC variable.  Similarly, a vac_scale_factor
  * value < 0 is substituted with the value of
- * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze.
+ * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze, and for
+ * inserts, except that there -1 disables the threshold, so it's values < -1
+ * that mean to use autovacuum_vacuum_insert_threshold.
  */
 static void
 relation_needs_vacanalyze(Oid relid,
@@ -2593,7 +2704,9 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  bool *forinserts,
+						  double *score)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -2601,16 +2714,20 @@ relation_needs_vacanalyze(Oid relid,
 
 	/* constants from reloptions or GUC variables */
 	int			vac_base_thresh,
+				vac_ins_base_thresh,
 				anl_base_thresh;
 	float4		vac_scale_factor,
+				vac_ins_scale_factor,
 				anl_scale_factor;
 
 	/* thresholds calculated from above constants */
 	float4		vacthresh,
+				vacinsthresh,
 				anlthresh;
 
-	/* number of vacuum (resp. analyze) tuples at this time */
+	/* number of vacuum (resp. insert, analyze) tuples at this time */
 	float4		vactuples,
+				instuples,
 				anltuples;
 
 	/* freeze parameters */
@@ -2635,6 +2752,15 @@ relation_needs_vacanalyze(Oid relid,
 		? relopts->vacuum_threshold
 		: autovacuum_vac_thresh;
 
+	vac_ins_scale_factor = (relopts && relopts->vacuum_ins_scale_factor >= 0)
+		? relopts->vacuum_ins_scale_factor
+		: autovacuum_vac_ins_scale;
+
+	/* -1 disables insert vacuums, so only values below that are unset */
+	vac_ins_base_thresh = (relopts && relopts->vacuum_ins_threshold >= -1)
+		? relopts->vacuum_ins_threshold
+		: autovacuum_vac_ins_thresh;
+
 	anl_scale_factor = (relopts && relopts->analyze_scale_factor >= 0)
 		? relopts->analyze_scale_factor
 		: autovacuum_anl_scale;
@@ -2657,6 +2783,15 @@ relation_needs_vacanalyze(Oid relid,
 					TransactionIdPrecedes(classForm->relfrozenxid,
 										  xidForceLimit));
 	*wraparound = force_vacuum;
+	*forinserts = false;
+
+	*score = 0.0;
+	if (TransactionIdIsNormal(classForm->relfrozenxid))
+	{
+		int32		xidage = (int32) (recentXid - classForm->relfrozenxid);
+
+		*score = (double) Max(xidage, 0) / Max(freeze_max_age, 1);
+	}
 
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!force_vacuum && !av_enabled)
@@ -2670,9 +2805,11 @@ relation_needs_vacanalyze(Oid relid,
 	{
 		reltuples = classForm->reltuples;
 		vactuples = tabentry->n_dead_tuples;
+		instuples = tabentry->inserts_since_vacuum;
 		anltuples = tabentry->changes_since_analyze;
 
 		vacthresh = (float4) vac_base_thresh + vac_scale_factor * reltuples;
+		vacinsthresh = (float4) vac_ins_base_thresh + vac_ins_scale_factor * reltuples;
 		anlthresh = (float4) anl_base_thresh + anl_scale_factor * reltuples;
 
 		/*
@@ -2680,13 +2817,29 @@ relation_needs_vacanalyze(Oid relid,
 		 * reset, because if that happens, the last vacuum and analyze counts
 		 * will be reset too.
 		 */
-		elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), anl: %.0f (threshold %.0f)",
-			 NameStr(classForm->relname),
-			 vactuples, vacthresh, anltuples, anlthresh);
+		if (vac_ins_base_thresh >= 0)
+			elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), ins: %.0f (threshold %.0f), anl: %.0f (threshold %.0f)",
+				 NameStr(classForm->relname),
+				 vactuples, vacthresh, instuples, vacinsthresh,
+				 anltuples, anlthresh);
+		else
+			elog(DEBUG3, "%s: vac: %.0f (threshold %.0f), ins: (disabled), anl: %.0f (threshold %.0f)",
+				 NameStr(classForm->relname),
+				 vactuples, vacthresh, anltuples, anlthresh);
 
 		/* Determine if this table needs vacuum or analyze. */
 		*dovacuum = force_vacuum || (vactuples > vacthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		if (!*dovacuum && vac_ins_base_thresh >= 0 && instuples > vacinsthresh)
+			*dovacuum = *forinserts = true;
+
+		*score = Max(*score, vactuples / Max(vacthresh, 1.0));
+		if (vac_ins_base_thresh >= 0)
+			*score = Max(*score, instuples / Max(vacinsthresh, 1.0));
+		/* toast tables are never analyzed */
+		if (classForm->relkind != RELKIND_TOASTVALUE)
+			*score = Max(*score, anltuples / Max(anlthresh, 1.0));
 	}
 	else
 	{
@@ -2895,11 +3048,8 @@ AutoVacuumShmemInit(void)
  *
  * Cause the next pgstats read operation to obtain fresh data, but throttle
  * such refreshing in the autovacuum launcher.	This is mostly to avoid
- * rereading the pgstats files too many times in quick succession when there
- * are many databases.
- *
- * Note: we avoid throttling in the autovac worker, as it would be
- * counterproductive in the recheck logic.
+ * copying the shared statistics of all databases too many times in quick
+ * succession when there are many databases.
  */
 static void
 autovac_refresh_stats(void)
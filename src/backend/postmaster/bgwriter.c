@@ -51,6 +51,7 @@
 #include "storage/ipc.h"
 #include "storage/lwlock.h"
 #include "storage/pmsignal.h"
+#include "storage/proc.h"
 #include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "storage/spin.h"
@@ -64,6 +65,12 @@
  */
 int			BgWriterDelay = 200;
 
+/*
+ * Multiplier to apply to BgWriterDelay when we decide to hibernate.
+ * (Perhaps this needs to be configurable?)
+ */
+#define HIBERNATE_FACTOR			50
+
 /*
  * Flags set by interrupt handlers for later service in the main loop.
  */
@@ -77,13 +84,14 @@ static bool am_bg_writer = false;
 
 /* Prototypes for private functions */
 
-static void BgWriterNap(void);
+static void BgWriterNap(bool hibernate);
 
 /* Signal handlers */
 
 static void bg_quickdie(SIGNAL_ARGS);
 static void BgSigHupHandler(SIGNAL_ARGS);
 static void ReqShutdownHandler(SIGNAL_ARGS);
+static void bgwriter_sigusr1_handler(SIGNAL_ARGS);
 
 
 /*
@@ -113,9 +121,6 @@ BackgroundWriterMain(void)
 
 	/*
 	 * Properly accept or ignore signals the postmaster might send us
-	 *
-	 * SIGUSR1 is presently unused; keep it spare in case someday we want this
-	 * process to participate in ProcSignal signalling.
 	 */
 	pqsignal(SIGHUP, BgSigHupHandler);	/* set flag to read config file */
 	pqsignal(SIGINT, SIG_IGN);			/* as of 9.2 no longer requests checkpoint */
@@ -123,7 +128,7 @@ BackgroundWriterMain(void)
 	pqsignal(SIGQUIT, bg_quickdie);		/* hard crash time */
 	pqsignal(SIGALRM, SIG_IGN);
 	pqsignal(SIGPIPE, SIG_IGN);
-	pqsignal(SIGUSR1, SIG_IGN);			/* reserve for ProcSignal */
+	pqsignal(SIGUSR1, bgwriter_sigusr1_handler);
 	pqsignal(SIGUSR2, SIG_IGN);
 
 	/*
@@ -237,12 +242,10 @@ BackgroundWriterMain(void)
 	 */
 	for (;;)
 	{
-		/*
-		 * Emergency bailout if postmaster has died.  This is to avoid the
-		 * necessity for manual cleanup of all postmaster children.
-		 */
-		if (!PostmasterIsAlive())
-			exit(1);
+		bool		can_hibernate;
+
+		/* Clear any already-pending wakeups */
+		ResetLatch(&MyProc->procLatch);
 
 		if (got_SIGHUP)
 		{
@@ -264,50 +267,44 @@ BackgroundWriterMain(void)
 		/*
 		 * Do one cycle of dirty-buffer writing.
 		 */
-		BgBufferSync();
+		can_hibernate = BgBufferSync();
 
-		/* Nap for the configured time. */
-		BgWriterNap();
+		/* Nap for the configured time, or until woken. */
+		BgWriterNap(can_hibernate);
 	}
 }
 
 /*
- * BgWriterNap -- Nap for the configured time or until a signal is received.
+ * BgWriterNap -- Nap for the configured time or until woken up.
+ *
+ * We are woken early by signals, and by backends that find the freelists
+ * empty if BgBufferSync asked for that.  If hibernate is true, nobody has
+ * needed buffers lately, so we sleep for much longer than bgwriter_delay;
+ * the wakeup from the first backend to need a buffer ends the nap.
  */
 static void
-BgWriterNap(void)
+BgWriterNap(bool hibernate)
 {
-	long		udelay;
+	int			rc;
 
 	/*
 	 * Send off activity statistics to the stats collector
 	 */
 	pgstat_send_bgwriter();
 
-	/*
-	 * Nap for the configured time, or sleep for 10 seconds if there is no
-	 * bgwriter activity configured.
-	 *
-	 * On some platforms, signals won't interrupt the sleep.  To ensure we
-	 * respond reasonably promptly when someone signals us, break down the
-	 * sleep into 1-second increments, and check for interrupts after each
-	 * nap.
-	 */
-	if (bgwriter_lru_maxpages > 0)
-		udelay = BgWriterDelay * 1000L;
-	else
-		udelay = 10000000L;		/* Ten seconds */
+	if (got_SIGHUP || shutdown_requested)
+		return;
 
-	while (udelay > 999999L)
-	{
-		if (got_SIGHUP || shutdown_requested)
-			break;
-		pg_usleep(1000000L);
-		udelay -= 1000000L;
-	}
+	rc = WaitLatch(&MyProc->procLatch,
+				   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+				   hibernate ? BgWriterDelay * HIBERNATE_FACTOR : BgWriterDelay);
 
-	if (!(got_SIGHUP || shutdown_requested))
-		pg_usleep(udelay);
+	/*
+	 * Emergency bailout if postmaster has died.  This is to avoid the
+	 * necessity for manual cleanup of all postmaster children.
+	 */
+	if (rc & WL_POSTMASTER_DEATH)
+		exit(1);
 }
 
 /* --------------------------------
@@ -351,12 +348,35 @@ bg_quickdie(SIGNAL_ARGS)
 static void
 BgSigHupHandler(SIGNAL_ARGS)
 {
+	int			save_errno = errno;
+
 	got_SIGHUP = true;
+	if (MyProc)
+		SetLatch(&MyProc->procLatch);
+
+	errno = save_errno;
 }
 
 /* SIGTERM: set flag to shutdown and exit */
 static void
 ReqShutdownHandler(SIGNAL_ARGS)
 {
+	int			save_errno = errno;
+
 	shutdown_requested = true;
+	if (MyProc)
+		SetLatch(&MyProc->procLatch);
+
+	errno = save_errno;
+}
+
+/* SIGUSR1: used for latch wakeups */
+static void
+bgwriter_sigusr1_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	latch_sigusr1_handler();
+
+	errno = save_errno;
 }
@@ -133,6 +133,20 @@ typedef struct
 
 static BgWriterShmemStruct *BgWriterShmem;
 
+/*
+ * Hash table of the requests currently in the queue, used to drop
+ * duplicates as they are forwarded.  Its entries are just BgWriterRequests,
+ * and it is protected by BgWriterCommLock like the queue itself.
+ */
+static HTAB *BgWriterRequestHash;
+
+/*
+ * The checkpointer absorbs the queue early, without waiting for the next
+ * WRITES_PER_ABSORB writes or nap, once it becomes this full.
+ */
+#define FsyncQueueNearlyFull() \
+	(BgWriterShmem->num_requests >= BgWriterShmem->max_requests / 2)
+
 /* interval for calling AbsorbFsyncRequests in CheckpointWriteDelay */
 #define WRITES_PER_ABSORB		1000
 
@@ -170,7 +184,7 @@ static pg_time_t last_xlog_switch_time;
 static void CheckArchiveTimeout(void);
 static bool IsCheckpointOnSchedule(double progress);
 static bool ImmediateCheckpointRequested(void);
-static bool CompactCheckpointerRequestQueue(void);
+static void ResetRequestHash(void);
 
 /* Signal handlers */
 
@@ -672,12 +686,14 @@ CheckpointWriteDelay(int flags, double progress)
 		 */
 		pg_usleep(100000L);
 	}
-	else if (--absorb_counter <= 0)
+	else if (--absorb_counter <= 0 || FsyncQueueNearlyFull())
 	{
 		/*
 		 * Absorb pending fsync requests after each WRITES_PER_ABSORB write
-		 * operations even when we don't sleep, to prevent overflow of the
-		 * fsync request queue.
+		 * operations even when we don't sleep, or sooner if the queue is
+		 * filling up, to prevent overflow of the fsync request queue. (The
+		 * unlocked read of num_requests is OK; an occasional wrong answer
+		 * just moves the absorb a little.)
 		 */
 		AbsorbFsyncRequests();
 		absorb_counter = WRITES_PER_ABSORB;
@@ -831,11 +847,15 @@ BgWriterShmemSize(void)
 	Size		size;
 
 	/*
-	 * Currently, the size of the requests[] array is arbitrarily set equal to
-	 * NBuffers.  This may prove too large or small ...
+	 * The size of the requests[] array is set equal to NBuffers.  Since
+	 * duplicates are dropped on entry, the queue could only overflow if
+	 * backends had to write into that many distinct segments between two
+	 * absorbs, which does not happen in practice.
 	 */
 	size = offsetof(BgWriterShmemStruct, requests);
 	size = add_size(size, mul_size(NBuffers, sizeof(BgWriterRequest)));
+	size = add_size(size, hash_estimate_size(NBuffers,
+											 sizeof(BgWriterRequest)));
 
 	return size;
 }
@@ -848,12 +868,23 @@ void
 BgWriterShmemInit(void)
 {
 	bool		found;
+	HASHCTL		info;
 
 	BgWriterShmem = (BgWriterShmemStruct *)
 		ShmemInitStruct("Background Writer Data",
-						BgWriterShmemSize(),
+						offsetof(BgWriterShmemStruct, requests) +
+						NBuffers * sizeof(BgWriterRequest),
 						&found);
 
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(BgWriterRequest);
+	info.entrysize = sizeof(BgWriterRequest);
+	info.hash = tag_hash;
+	BgWriterRequestHash = ShmemInitHash("Background Writer Request Hash",
+										NBuffers, NBuffers,
+										&info,
+										HASH_ELEM | HASH_FUNCTION);
+
 	if (!found)
 	{
 		/* First time through, so initialize */
@@ -1024,21 +1055,25 @@ RequestCheckpoint(int flags)
  * use high values for special flags; that's all internal to md.c, which
  * see for details.)
  *
- * To avoid holding the lock for longer than necessary, we normally write
- * to the requests[] queue without checking for duplicates.  The bgwriter
- * will have to eliminate dups internally anyway.  However, if we discover
- * that the queue is full, we make a pass over the entire queue to compact
- * it.	This is somewhat expensive, but the alternative is for the backend
- * to perform its own fsync, which is far more expensive in practice.  It
- * is theoretically possible a backend fsync might still be necessary, if
- * the queue is full and contains no duplicate entries.  In that case, we
- * let the backend know by returning false.
+ * Duplicate requests are common, since every write to a segment produces
+ * one, so we look each request up in BgWriterRequestHash and drop it if an
+ * identical request is already queued.  That keeps the queue down to one
+ * entry per dirty segment, so in practice it never fills up and backends
+ * never have to perform their own fsyncs.  A FORGET_RELATION_FSYNC or
+ * FORGET_DATABASE_FSYNC request cancels the requests queued before it, so
+ * when one is queued we empty the hash table; a later request for the same
+ * segment is then queued again, rather than being lost.  It is still
+ * theoretically possible for the queue to be full, in which case we let the
+ * backend know by returning false, and it must do the fsync itself.
  */
 bool
 ForwardFsyncRequest(RelFileNodeBackend rnode, ForkNumber forknum,
 					BlockNumber segno)
 {
+	BgWriterRequest key;
 	BgWriterRequest *request;
+	bool		hashed = false;
+	bool		found;
 
 	if (!IsUnderPostmaster)
 		return false;			/* probably shouldn't even get here */
@@ -1046,6 +1081,12 @@ ForwardFsyncRequest(RelFileNodeBackend rnode, ForkNumber forknum,
 	if (am_checkpointer)
 		elog(ERROR, "ForwardFsyncRequest must not be called in bgwriter");
 
+	/* the hash key must not contain garbage padding */
+	MemSet(&key, 0, sizeof(key));
+	key.rnode = rnode;
+	key.forknum = forknum;
+	key.segno = segno;
+
 	LWLockAcquire(BgWriterCommLock, LW_EXCLUSIVE);
 
 	/* Count all backend writes regardless of if they fit in the queue */
@@ -1053,131 +1094,75 @@ ForwardFsyncRequest(RelFileNodeBackend rnode, ForkNumber forknum,
 
 	/*
 	 * If the background writer isn't running or the request queue is full,
-	 * the backend will have to perform its own fsync request.	But before
-	 * forcing that to happen, we can try to compact the background writer
-	 * request queue.
+	 * the backend will have to perform its own fsync request.
 	 */
-	if (BgWriterShmem->checkpointer_pid == 0 ||
-		(BgWriterShmem->num_requests >= BgWriterShmem->max_requests
-		 && !CompactCheckpointerRequestQueue()))
+	if (BgWriterShmem->checkpointer_pid == 0)
+	{
+		BgWriterShmem->num_backend_fsync++;
+		LWLockRelease(BgWriterCommLock);
+		return false;
+	}
+
+	if (segno == FORGET_RELATION_FSYNC || segno == FORGET_DATABASE_FSYNC)
+		ResetRequestHash();
+	else if (segno != UNLINK_RELATION_REQUEST)
+	{
+		/*
+		 * The hash table has room for as many entries as the queue, so
+		 * HASH_ENTER_NULL can only fail if the queue is full too.
+		 */
+		if (hash_search(BgWriterRequestHash, &key, HASH_ENTER_NULL,
+						&found) != NULL)
+		{
+			if (found)
+			{
+				/* already queued, nothing to do */
+				LWLockRelease(BgWriterCommLock);
+				return true;
+			}
+			hashed = true;
+		}
+	}
+
+	if (BgWriterShmem->num_requests >= BgWriterShmem->max_requests)
 	{
 		/*
 		 * Count the subset of writes where backends have to do their own
-		 * fsync
+		 * fsync.  Take our entry out of the hash table again, since it isn't
+		 * in the queue.
 		 */
+		if (hashed)
+			hash_search(BgWriterRequestHash, &key, HASH_REMOVE, NULL);
 		BgWriterShmem->num_backend_fsync++;
 		LWLockRelease(BgWriterCommLock);
 		return false;
 	}
 	request = &BgWriterShmem->requests[BgWriterShmem->num_requests++];
-	request->rnode = rnode;
-	request->forknum = forknum;
-	request->segno = segno;
+	*request = key;
 	LWLockRelease(BgWriterCommLock);
 	return true;
 }
 
 /*
- * CompactCheckpointerRequestQueue
- *		Remove duplicates from the request queue to avoid backend fsyncs.
- *
- * Although a full fsync request queue is not common, it can lead to severe
- * performance problems when it does happen.  So far, this situation has
- * only been observed to occur when the system is under heavy write load,
- * and especially during the "sync" phase of a checkpoint.	Without this
- * logic, each backend begins doing an fsync for every block written, which
- * gets very expensive and can slow down the whole system.
+ * ResetRequestHash
+ *		Remove all entries from BgWriterRequestHash.
  *
- * Trying to do this every time the queue is full could lose if there
- * aren't any removable entries.  But should be vanishingly rare in
- * practice: there's one queue entry per shared buffer.
+ * Caller must hold BgWriterCommLock in exclusive mode.
  */
-static bool
-CompactCheckpointerRequestQueue()
+static void
+ResetRequestHash(void)
 {
-	struct BgWriterSlotMapping
-	{
-		BgWriterRequest request;
-		int			slot;
-	};
-
-	int			n,
-				preserve_count;
-	int			num_skipped = 0;
-	HASHCTL		ctl;
-	HTAB	   *htab;
-	bool	   *skip_slot;
-
-	/* must hold BgWriterCommLock in exclusive mode */
-	Assert(LWLockHeldByMe(BgWriterCommLock));
-
-	/* Initialize temporary hash table */
-	MemSet(&ctl, 0, sizeof(ctl));
-	ctl.keysize = sizeof(BgWriterRequest);
-	ctl.entrysize = sizeof(struct BgWriterSlotMapping);
-	ctl.hash = tag_hash;
-	htab = hash_create("CompactBgwriterRequestQueue",
-					   BgWriterShmem->num_requests,
-					   &ctl,
-					   HASH_ELEM | HASH_FUNCTION);
-
-	/* Initialize skip_slot array */
-	skip_slot = palloc0(sizeof(bool) * BgWriterShmem->num_requests);
-
-	/*
-	 * The basic idea here is that a request can be skipped if it's followed
-	 * by a later, identical request.  It might seem more sensible to work
-	 * backwards from the end of the queue and check whether a request is
-	 * *preceded* by an earlier, identical request, in the hopes of doing less
-	 * copying.  But that might change the semantics, if there's an
-	 * intervening FORGET_RELATION_FSYNC or FORGET_DATABASE_FSYNC request, so
-	 * we do it this way.  It would be possible to be even smarter if we made
-	 * the code below understand the specific semantics of such requests (it
-	 * could blow away preceding entries that would end up being canceled
-	 * anyhow), but it's not clear that the extra complexity would buy us
-	 * anything.
-	 */
-	for (n = 0; n < BgWriterShmem->num_requests; ++n)
-	{
-		BgWriterRequest *request;
-		struct BgWriterSlotMapping *slotmap;
-		bool		found;
+	HASH_SEQ_STATUS status;
+	BgWriterRequest *entry;
 
-		request = &BgWriterShmem->requests[n];
-		slotmap = hash_search(htab, request, HASH_ENTER, &found);
-		if (found)
-		{
-			skip_slot[slotmap->slot] = true;
-			++num_skipped;
-		}
-		slotmap->slot = n;
-	}
-
-	/* Done with the hash table. */
-	hash_destroy(htab);
-
-	/* If no duplicates, we're out of luck. */
-	if (!num_skipped)
-	{
-		pfree(skip_slot);
-		return false;
-	}
+	Assert(LWLockHeldByMe(BgWriterCommLock));
 
-	/* We found some duplicates; remove them. */
-	for (n = 0, preserve_count = 0; n < BgWriterShmem->num_requests; ++n)
+	hash_seq_init(&status, BgWriterRequestHash);
+	while ((entry = (BgWriterRequest *) hash_seq_search(&status)) != NULL)
 	{
-		if (skip_slot[n])
-			continue;
-		BgWriterShmem->requests[preserve_count++] = BgWriterShmem->requests[n];
+		if (hash_search(BgWriterRequestHash, entry, HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "fsync request hash table corrupted");
 	}
-	ereport(DEBUG1,
-	   (errmsg("compacted fsync request queue from %d entries to %d entries",
-			   BgWriterShmem->num_requests, preserve_count)));
-	BgWriterShmem->num_requests = preserve_count;
-
-	/* Cleanup. */
-	pfree(skip_slot);
-	return true;
 }
 
 /*
@@ -1226,6 +1211,7 @@ AbsorbFsyncRequests(void)
 	{
 		requests = (BgWriterRequest *) palloc(n * sizeof(BgWriterRequest));
 		memcpy(requests, BgWriterShmem->requests, n * sizeof(BgWriterRequest));
+		ResetRequestHash();
 	}
 	BgWriterShmem->num_requests = 0;
 
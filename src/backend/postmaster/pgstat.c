@@ -1,10 +1,14 @@
 /* ----------
  * pgstat.c
  *
- *	All the statistics collector stuff hacked up in one big, ugly file.
+ *	All the statistics stuff hacked up in one big, ugly file.
  *
- *	TODO:	- Separate collector, postmaster and backend stuff
- *			  into different files.
+ *	Backends accumulate counts in local memory and periodically flush them
+ *	into hashtables in shared memory, which is where the statistics views
+ *	read them from.  The shared hashtables are only written to disk at
+ *	shutdown, and are loaded back in at the next clean startup.
+ *
+ *	TODO:	- Separate shared-memory and backend stuff into different files.
  *
  *			- Add some automatic call for pgstat vacuuming.
  *
@@ -22,18 +26,7 @@
 #include <fcntl.h>
 #include <sys/param.h>
 #include <sys/time.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <signal.h>
 #include <time.h>
-#ifdef HAVE_POLL_H
-#include <poll.h>
-#endif
-#ifdef HAVE_SYS_POLL_H
-#include <sys/poll.h>
-#endif
 
 #include "pgstat.h"
 
@@ -43,25 +36,20 @@
 #include "access/xact.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_proc.h"
-#include "libpq/ip.h"
 #include "libpq/libpq.h"
-#include "libpq/pqsignal.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "postmaster/autovacuum.h"
-#include "postmaster/fork_process.h"
-#include "postmaster/postmaster.h"
 #include "storage/backendid.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
-#include "storage/pg_shmem.h"
-#include "storage/pmsignal.h"
+#include "storage/lwlock.h"
 #include "storage/procsignal.h"
+#include "storage/shmem.h"
 #include "utils/ascii.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
-#include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/timestamp.h"
 #include "utils/tqual.h"
@@ -78,36 +66,20 @@
  * Timer definitions.
  * ----------
  */
-#define PGSTAT_STAT_INTERVAL	500		/* Minimum time between stats file
-										 * updates; in milliseconds. */
-
-#define PGSTAT_RETRY_DELAY		10		/* How long to wait between checks for
-										 * a new file; in milliseconds. */
-
-#define PGSTAT_MAX_WAIT_TIME	10000	/* Maximum time to wait for a stats
-										 * file update; in milliseconds. */
-
-#define PGSTAT_INQ_INTERVAL		640		/* How often to ping the collector for
-										 * a new file; in milliseconds. */
-
-#define PGSTAT_RESTART_INTERVAL 60		/* How often to attempt to restart a
-										 * failed statistics collector; in
-										 * seconds. */
-
-#define PGSTAT_SELECT_TIMEOUT	2		/* How often to check for postmaster
-										 * death; in seconds. */
-
-#define PGSTAT_POLL_LOOP_COUNT	(PGSTAT_MAX_WAIT_TIME / PGSTAT_RETRY_DELAY)
-#define PGSTAT_INQ_LOOP_COUNT	(PGSTAT_INQ_INTERVAL / PGSTAT_RETRY_DELAY)
+#define PGSTAT_STAT_INTERVAL	500		/* Minimum time between flushes of a
+										 * backend's counts to shared memory;
+										 * in milliseconds. */
 
 
 /* ----------
- * The initial size hints for the hash tables used in the collector.
+ * The initial size hints for the local snapshot hash tables, and the
+ * number of databases the shared database hash table is sized for.
  * ----------
  */
 #define PGSTAT_DB_HASH_SIZE		16
 #define PGSTAT_TAB_HASH_SIZE	512
 #define PGSTAT_FUNCTION_HASH_SIZE	512
+#define PGSTAT_SHMEM_DB_HASH_SIZE	64
 
 
 /* ----------
@@ -118,13 +90,7 @@ bool		pgstat_track_activities = false;
 bool		pgstat_track_counts = false;
 int			pgstat_track_functions = TRACK_FUNC_OFF;
 int			pgstat_track_activity_query_size = 1024;
-
-/* ----------
- * Built from GUC parameter
- * ----------
- */
-char	   *pgstat_stat_filename = NULL;
-char	   *pgstat_stat_tmpname = NULL;
+int			pgstat_max_objects = 10000;
 
 /*
  * BgWriter global statistics counters (unused in other processes).
@@ -134,20 +100,54 @@ char	   *pgstat_stat_tmpname = NULL;
 PgStat_MsgBgWriter BgWriterStats;
 
 /* ----------
- * Local data
+ * Shared statistics store
+ *
+ * The per-database entries, and the cluster-wide counters kept in
+ * PgStat_ShmemControl, are protected by PgStatDBLock.  Per-table and
+ * per-function entries live in two flat hash tables keyed by database and
+ * object OID.  Both are divided into NUM_PGSTAT_PARTITIONS partitions by
+ * hash code; a partition is protected by the FirstPgStatLock + partition
+ * LWLock, in either table.  PgStatDBLock is never acquired while holding a
+ * partition lock.
+ *
+ * The table and function hash tables are of fixed size (max_stats_objects
+ * entries each).  Counts for objects that don't fit are silently dropped.
  * ----------
  */
-NON_EXEC_STATIC pgsocket pgStatSock = PGINVALID_SOCKET;
+typedef struct PgStat_ShmemControl
+{
+	PgStat_GlobalStats globalStats;		/* cluster-wide counters */
+} PgStat_ShmemControl;
+
+typedef struct PgStat_ObjectKey
+{
+	Oid			databaseid;		/* InvalidOid for shared objects */
+	Oid			objectid;		/* table or function OID */
+} PgStat_ObjectKey;
 
-static struct sockaddr_storage pgStatAddr;
+typedef struct PgStat_SharedTabEntry
+{
+	PgStat_ObjectKey key;		/* hash key of entry - MUST BE FIRST */
+	PgStat_StatTabEntry stats;
+} PgStat_SharedTabEntry;
+
+typedef struct PgStat_SharedFuncEntry
+{
+	PgStat_ObjectKey key;		/* hash key of entry - MUST BE FIRST */
+	PgStat_StatFuncEntry stats;
+} PgStat_SharedFuncEntry;
 
-static time_t last_pgstat_start_time;
+#define PgStatPartitionLock(hashcode) \
+	((LWLockId) (FirstPgStatLock + ((hashcode) % NUM_PGSTAT_PARTITIONS)))
 
-static bool pgStatRunningInCollector = false;
+static PgStat_ShmemControl *pgStatShmem = NULL;
+static HTAB *pgStatSharedDBHash = NULL;
+static HTAB *pgStatSharedTabHash = NULL;
+static HTAB *pgStatSharedFuncHash = NULL;
 
 /*
  * Structures in which backends store per-table info that's waiting to be
- * sent to the collector.
+ * flushed to shared memory.
  *
  * NOTE: once allocated, TabStatusArray structures are never moved or deleted
  * for the life of the backend.  Also, we zero out the t_id fields of the
@@ -168,14 +168,14 @@ typedef struct TabStatusArray
 static TabStatusArray *pgStatTabList = NULL;
 
 /*
- * Backends store per-function info that's waiting to be sent to the collector
- * in this hash table (indexed by function OID).
+ * Backends store per-function info that's waiting to be flushed to shared
+ * memory in this hash table (indexed by function OID).
  */
 static HTAB *pgStatFunctions = NULL;
 
 /*
  * Indicates if backend has some function stats that it hasn't yet
- * sent to the collector.
+ * flushed to shared memory.
  */
 static bool have_function_stats = false;
 
@@ -197,6 +197,10 @@ static PgStat_SubXactStatus *pgStatXactStack = NULL;
 
 static int	pgStatXactCommit = 0;
 static int	pgStatXactRollback = 0;
+PgStat_Counter pgStatBlockReadTime = 0;
+PgStat_Counter pgStatBlockWriteTime = 0;
+int			pgStatSSLHandshakes = 0;
+int			pgStatSSLResumptions = 0;
 
 /* Record that's written to 2PC state file when pgstat state is persisted */
 typedef struct TwoPhasePgStatRecord
@@ -209,29 +213,20 @@ typedef struct TwoPhasePgStatRecord
 } TwoPhasePgStatRecord;
 
 /*
- * Info about current "snapshot" of stats file
+ * Info about current "snapshot" of the shared statistics
  */
 static MemoryContext pgStatLocalContext = NULL;
 static HTAB *pgStatDBHash = NULL;
+static bool pgStatObjectsRead = false;
 static PgBackendStatus *localBackendStatusTable = NULL;
 static int	localNumBackends = 0;
 
 /*
- * Cluster wide statistics, kept in the stats collector.
- * Contains statistics that are not collected per database
- * or per table.
+ * Snapshot copy of the cluster wide statistics.  Contains statistics that
+ * are not collected per database or per table.
  */
 static PgStat_GlobalStats globalStats;
 
-/* Last time the collector successfully wrote the stats file */
-static TimestampTz last_statwrite;
-
-/* Latest statistics request time from backends */
-static TimestampTz last_statrequest;
-
-static volatile bool need_exit = false;
-static volatile bool got_SIGHUP = false;
-
 /*
  * Total time charged to functions so far in the current backend.
  * We use this to help separate "self" and "other" time charges.
@@ -244,21 +239,18 @@ static instr_time total_func_time;
  * Local function forward declarations
  * ----------
  */
-#ifdef EXEC_BACKEND
-static pid_t pgstat_forkexec(void);
-#endif
-
-NON_EXEC_STATIC void PgstatCollectorMain(int argc, char *argv[]);
-static void pgstat_exit(SIGNAL_ARGS);
 static void pgstat_beshutdown_hook(int code, Datum arg);
-static void pgstat_sighup_handler(SIGNAL_ARGS);
 
 static PgStat_StatDBEntry *pgstat_get_db_entry(Oid databaseid, bool create);
-static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry,
-					 Oid tableoid, bool create);
-static void pgstat_write_statsfile(bool permanent);
-static HTAB *pgstat_read_statsfile(Oid onlydb, bool permanent);
-static void backend_read_statsfile(void);
+static void pgstat_ensure_db_entry(Oid databaseid);
+static void pgstat_report_table_full(void);
+static PgStat_StatTabEntry *pgstat_get_tab_entry(PgStat_ObjectKey *key,
+					 uint32 hashcode, bool create);
+static PgStat_StatFuncEntry *pgstat_get_func_entry(PgStat_ObjectKey *key,
+					  uint32 hashcode, bool create);
+static void pgstat_remove_db_objects(Oid databaseid);
+static void backend_read_stats(void);
+static void backend_read_db_objects(void);
 static void pgstat_read_current_status(void);
 
 static void pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg);
@@ -272,7 +264,6 @@ static void pgstat_setup_memcxt(void);
 static void pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype);
 static void pgstat_send(void *msg, int len);
 
-static void pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len);
 static void pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len);
 static void pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len);
 static void pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len);
@@ -286,6 +277,7 @@ static void pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len);
 static void pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len);
 static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
 static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
+static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
 
 
 /* ------------------------------------------------------------
@@ -294,371 +286,97 @@ static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int le
  */
 
 /* ----------
- * pgstat_init() -
+ * StatsShmemSize() -
  *
- *	Called from postmaster at startup. Create the resources required
- *	by the statistics collector process.  If unable to do so, do not
- *	fail --- better to let the postmaster start with stats collection
- *	disabled.
+ *	Report shared-memory space needed by CreateSharedStats.
  * ----------
  */
-void
-pgstat_init(void)
+Size
+StatsShmemSize(void)
 {
-	ACCEPT_TYPE_ARG3 alen;
-	struct addrinfo *addrs = NULL,
-			   *addr,
-				hints;
-	int			ret;
-	fd_set		rset;
-	struct timeval tv;
-	char		test_byte;
-	int			sel_res;
-	int			tries = 0;
-
-#define TESTBYTEVAL ((char) 199)
-
-	/*
-	 * Create the UDP socket for sending and receiving statistic messages
-	 */
-	hints.ai_flags = AI_PASSIVE;
-	hints.ai_family = PF_UNSPEC;
-	hints.ai_socktype = SOCK_DGRAM;
-	hints.ai_protocol = 0;
-	hints.ai_addrlen = 0;
-	hints.ai_addr = NULL;
-	hints.ai_canonname = NULL;
-	hints.ai_next = NULL;
-	ret = pg_getaddrinfo_all("localhost", NULL, &hints, &addrs);
-	if (ret || !addrs)
-	{
-		ereport(LOG,
-				(errmsg("could not resolve \"localhost\": %s",
-						gai_strerror(ret))));
-		goto startup_failed;
-	}
-
-	/*
-	 * On some platforms, pg_getaddrinfo_all() may return multiple addresses
-	 * only one of which will actually work (eg, both IPv6 and IPv4 addresses
-	 * when kernel will reject IPv6).  Worse, the failure may occur at the
-	 * bind() or perhaps even connect() stage.	So we must loop through the
-	 * results till we find a working combination. We will generate LOG
-	 * messages, but no error, for bogus combinations.
-	 */
-	for (addr = addrs; addr; addr = addr->ai_next)
-	{
-#ifdef HAVE_UNIX_SOCKETS
-		/* Ignore AF_UNIX sockets, if any are returned. */
-		if (addr->ai_family == AF_UNIX)
-			continue;
-#endif
-
-		if (++tries > 1)
-			ereport(LOG,
-			(errmsg("trying another address for the statistics collector")));
-
-		/*
-		 * Create the socket.
-		 */
-		if ((pgStatSock = socket(addr->ai_family, SOCK_DGRAM, 0)) == PGINVALID_SOCKET)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			errmsg("could not create socket for statistics collector: %m")));
-			continue;
-		}
-
-		/*
-		 * Bind it to a kernel assigned port on localhost and get the assigned
-		 * port via getsockname().
-		 */
-		if (bind(pgStatSock, addr->ai_addr, addr->ai_addrlen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			  errmsg("could not bind socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		alen = sizeof(pgStatAddr);
-		if (getsockname(pgStatSock, (struct sockaddr *) & pgStatAddr, &alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not get address of socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/*
-		 * Connect the socket to its own address.  This saves a few cycles by
-		 * not having to respecify the target address on every send. This also
-		 * provides a kernel-level check that only packets from this same
-		 * address will be received.
-		 */
-		if (connect(pgStatSock, (struct sockaddr *) & pgStatAddr, alen) < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-			errmsg("could not connect socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/*
-		 * Try to send and receive a one-byte test message on the socket. This
-		 * is to catch situations where the socket can be created but will not
-		 * actually pass data (for instance, because kernel packet filtering
-		 * rules prevent it).
-		 */
-		test_byte = TESTBYTEVAL;
-
-retry1:
-		if (send(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry1;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not send test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		/*
-		 * There could possibly be a little delay before the message can be
-		 * received.  We arbitrarily allow up to half a second before deciding
-		 * it's broken.
-		 */
-		for (;;)				/* need a loop to handle EINTR */
-		{
-			FD_ZERO(&rset);
-			FD_SET(pgStatSock, &rset);
-
-			tv.tv_sec = 0;
-			tv.tv_usec = 500000;
-			sel_res = select(pgStatSock + 1, &rset, NULL, NULL, &tv);
-			if (sel_res >= 0 || errno != EINTR)
-				break;
-		}
-		if (sel_res < 0)
-		{
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("select() failed in statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-		if (sel_res == 0 || !FD_ISSET(pgStatSock, &rset))
-		{
-			/*
-			 * This is the case we actually think is likely, so take pains to
-			 * give a specific message for it.
-			 *
-			 * errno will not be set meaningfully here, so don't use it.
-			 */
-			ereport(LOG,
-					(errcode(ERRCODE_CONNECTION_FAILURE),
-					 errmsg("test message did not get through on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
-
-		test_byte++;			/* just make sure variable is changed */
-
-retry2:
-		if (recv(pgStatSock, &test_byte, 1, 0) != 1)
-		{
-			if (errno == EINTR)
-				goto retry2;	/* if interrupted, just retry */
-			ereport(LOG,
-					(errcode_for_socket_access(),
-					 errmsg("could not receive test message on socket for statistics collector: %m")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	Size		size;
 
-		if (test_byte != TESTBYTEVAL)	/* strictly paranoia ... */
-		{
-			ereport(LOG,
-					(errcode(ERRCODE_INTERNAL_ERROR),
-					 errmsg("incorrect test message transmission on socket for statistics collector")));
-			closesocket(pgStatSock);
-			pgStatSock = PGINVALID_SOCKET;
-			continue;
-		}
+	size = MAXALIGN(sizeof(PgStat_ShmemControl));
+	size = add_size(size, hash_estimate_size(PGSTAT_SHMEM_DB_HASH_SIZE,
+											 sizeof(PgStat_StatDBEntry)));
+	size = add_size(size, hash_estimate_size(pgstat_max_objects,
+											 sizeof(PgStat_SharedTabEntry)));
+	size = add_size(size, hash_estimate_size(pgstat_max_objects,
+											 sizeof(PgStat_SharedFuncEntry)));
+	return size;
+}
 
-		/* If we get here, we have a working socket */
-		break;
-	}
+/* ----------
+ * CreateSharedStats() -
+ *
+ *	Create or attach to the shared statistics hash tables during
+ *	postmaster startup, or when a backend attaches (EXEC_BACKEND case).
+ * ----------
+ */
+void
+CreateSharedStats(void)
+{
+	HASHCTL		info;
+	bool		found;
 
-	/* Did we find a working address? */
-	if (!addr || pgStatSock == PGINVALID_SOCKET)
-		goto startup_failed;
+	pgStatShmem = (PgStat_ShmemControl *)
+		ShmemInitStruct("Statistics Control", sizeof(PgStat_ShmemControl),
+						&found);
 
-	/*
-	 * Set the socket to non-blocking IO.  This ensures that if the collector
-	 * falls behind, statistics messages will be discarded; backends won't
-	 * block waiting to send messages to the collector.
-	 */
-	if (!pg_set_noblock(pgStatSock))
+	if (!found)
 	{
-		ereport(LOG,
-				(errcode_for_socket_access(),
-				 errmsg("could not set statistics collector socket to nonblocking mode: %m")));
-		goto startup_failed;
+		MemSet(pgStatShmem, 0, sizeof(PgStat_ShmemControl));
+		pgStatShmem->globalStats.stat_reset_timestamp = GetCurrentTimestamp();
 	}
 
-	pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	return;
-
-startup_failed:
-	ereport(LOG,
-	  (errmsg("disabling statistics collector for lack of working socket")));
-
-	if (addrs)
-		pg_freeaddrinfo_all(hints.ai_family, addrs);
-
-	if (pgStatSock != PGINVALID_SOCKET)
-		closesocket(pgStatSock);
-	pgStatSock = PGINVALID_SOCKET;
-
 	/*
-	 * Adjust GUC variables to suppress useless activity, and for debugging
-	 * purposes (seeing track_counts off is a clue that we failed here). We
-	 * use PGC_S_OVERRIDE because there is no point in trying to turn it back
-	 * on from postgresql.conf without a restart.
+	 * The database table is small and rarely gets new entries, so it is not
+	 * partitioned.  Like the lock tables, it may grow into the slop space if
+	 * there are more databases than we sized it for.
 	 */
-	SetConfigOption("track_counts", "off", PGC_INTERNAL, PGC_S_OVERRIDE);
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(PgStat_StatDBEntry);
+	info.hash = oid_hash;
+	pgStatSharedDBHash = ShmemInitHash("Database Statistics",
+									   PGSTAT_SHMEM_DB_HASH_SIZE,
+									   PGSTAT_SHMEM_DB_HASH_SIZE,
+									   &info,
+									   HASH_ELEM | HASH_FUNCTION);
+
+	info.keysize = sizeof(PgStat_ObjectKey);
+	info.entrysize = sizeof(PgStat_SharedTabEntry);
+	info.hash = tag_hash;
+	info.num_partitions = NUM_PGSTAT_PARTITIONS;
+	pgStatSharedTabHash = ShmemInitHash("Table Statistics",
+										pgstat_max_objects,
+										pgstat_max_objects,
+										&info,
+										HASH_ELEM | HASH_FUNCTION |
+										HASH_PARTITION | HASH_FIXED_SIZE);
+
+	info.entrysize = sizeof(PgStat_SharedFuncEntry);
+	pgStatSharedFuncHash = ShmemInitHash("Function Statistics",
+										 pgstat_max_objects,
+										 pgstat_max_objects,
+										 &info,
+										 HASH_ELEM | HASH_FUNCTION |
+										 HASH_PARTITION | HASH_FIXED_SIZE);
 }
 
 /*
  * pgstat_reset_all() -
  *
- * Remove the stats file.  This is currently used only if WAL
- * recovery is needed after a crash.
+ * Remove the stats file.  This is currently used only if WAL recovery is
+ * needed after a crash.  The shared hash tables themselves have just been
+ * created afresh by the postmaster, so there is nothing to clear in them.
  */
 void
 pgstat_reset_all(void)
 {
-	unlink(pgstat_stat_filename);
 	unlink(PGSTAT_STAT_PERMANENT_FILENAME);
 }
 
-#ifdef EXEC_BACKEND
-
-/*
- * pgstat_forkexec() -
- *
- * Format up the arglist for, then fork and exec, statistics collector process
- */
-static pid_t
-pgstat_forkexec(void)
-{
-	char	   *av[10];
-	int			ac = 0;
-
-	av[ac++] = "postgres";
-	av[ac++] = "--forkcol";
-	av[ac++] = NULL;			/* filled in by postmaster_forkexec */
-
-	av[ac] = NULL;
-	Assert(ac < lengthof(av));
-
-	return postmaster_forkexec(ac, av);
-}
-#endif   /* EXEC_BACKEND */
-
-
-/*
- * pgstat_start() -
- *
- *	Called from postmaster at startup or after an existing collector
- *	died.  Attempt to fire up a fresh statistics collector.
- *
- *	Returns PID of child process, or 0 if fail.
- *
- *	Note: if fail, we will be called again from the postmaster main loop.
- */
-int
-pgstat_start(void)
-{
-	time_t		curtime;
-	pid_t		pgStatPid;
-
-	/*
-	 * Check that the socket is there, else pgstat_init failed and we can do
-	 * nothing useful.
-	 */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return 0;
-
-	/*
-	 * Do nothing if too soon since last collector start.  This is a safety
-	 * valve to protect against continuous respawn attempts if the collector
-	 * is dying immediately at launch.	Note that since we will be re-called
-	 * from the postmaster main loop, we will get another chance later.
-	 */
-	curtime = time(NULL);
-	if ((unsigned int) (curtime - last_pgstat_start_time) <
-		(unsigned int) PGSTAT_RESTART_INTERVAL)
-		return 0;
-	last_pgstat_start_time = curtime;
-
-	/*
-	 * Okay, fork off the collector.
-	 */
-#ifdef EXEC_BACKEND
-	switch ((pgStatPid = pgstat_forkexec()))
-#else
-	switch ((pgStatPid = fork_process()))
-#endif
-	{
-		case -1:
-			ereport(LOG,
-					(errmsg("could not fork statistics collector: %m")));
-			return 0;
-
-#ifndef EXEC_BACKEND
-		case 0:
-			/* in postmaster child ... */
-			/* Close the postmaster's sockets */
-			ClosePostmasterPorts(false);
-
-			/* Lose the postmaster's on-exit routines */
-			on_exit_reset();
-
-			/* Drop our connection to postmaster's shared memory, as well */
-			PGSharedMemoryDetach();
-
-			PgstatCollectorMain(0, NULL);
-			break;
-#endif
-
-		default:
-			return (int) pgStatPid;
-	}
-
-	/* shouldn't get here */
-	return 0;
-}
-
-void
-allow_immediate_pgstat_restart(void)
-{
-	last_pgstat_start_time = 0;
-}
-
 /* ------------------------------------------------------------
  * Public functions used by backends follow
  *------------------------------------------------------------
@@ -668,8 +386,8 @@ allow_immediate_pgstat_restart(void)
 /* ----------
  * pgstat_report_stat() -
  *
- *	Called from tcop/postgres.c to send the so far collected per-table
- *	and function usage statistics to the collector.  Note that this is
+ *	Called from tcop/postgres.c to flush the so far collected per-table
+ *	and function usage statistics to shared memory.  Note that this is
  *	called only when not within a transaction, so it is fair to use
  *	transaction stop time as an approximation of current time.
  * ----------
@@ -693,8 +411,9 @@ pgstat_report_stat(bool force)
 		return;
 
 	/*
-	 * Don't send a message unless it's been at least PGSTAT_STAT_INTERVAL
-	 * msec since we last sent one, or the caller wants to force stats out.
+	 * Don't flush unless it's been at least PGSTAT_STAT_INTERVAL msec since
+	 * we last did, or the caller wants to force stats out.  Batching the
+	 * counts keeps the traffic on the shared hash table locks down.
 	 */
 	now = GetCurrentTransactionStopTimestamp();
 	if (!force &&
@@ -702,6 +421,9 @@ pgstat_report_stat(bool force)
 		return;
 	last_report = now;
 
+	/* The LWLock statistics are kept separately, but go out as often */
+	LWLockFlushStats();
+
 	/*
 	 * Scan through the TabStatusArray struct(s) to find tables that actually
 	 * have counts, and build messages to send.  We have to separate shared
@@ -757,7 +479,9 @@ pgstat_report_stat(bool force)
 	 * xact commit/abort gets counted, even if no table stats to send.
 	 */
 	if (regular_msg.m_nentries > 0 ||
-		(force && (pgStatXactCommit > 0 || pgStatXactRollback > 0)))
+		(force && (pgStatXactCommit > 0 || pgStatXactRollback > 0 ||
+				   pgStatBlockReadTime > 0 || pgStatBlockWriteTime > 0 ||
+				   pgStatSSLHandshakes > 0)))
 		pgstat_send_tabstat(&regular_msg);
 	if (shared_msg.m_nentries > 0)
 		pgstat_send_tabstat(&shared_msg);
@@ -775,25 +499,33 @@ pgstat_send_tabstat(PgStat_MsgTabstat *tsmsg)
 	int			n;
 	int			len;
 
-	/* It's unlikely we'd get here with no socket, but maybe not impossible */
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	/*
-	 * Report accumulated xact commit/rollback whenever we send a normal
-	 * tabstat message
+	 * Report accumulated xact commit/rollback, I/O timings and SSL
+	 * handshakes whenever we send a normal tabstat message
 	 */
 	if (OidIsValid(tsmsg->m_databaseid))
 	{
 		tsmsg->m_xact_commit = pgStatXactCommit;
 		tsmsg->m_xact_rollback = pgStatXactRollback;
+		tsmsg->m_block_read_time = pgStatBlockReadTime;
+		tsmsg->m_block_write_time = pgStatBlockWriteTime;
+		tsmsg->m_ssl_handshakes = pgStatSSLHandshakes;
+		tsmsg->m_ssl_resumptions = pgStatSSLResumptions;
 		pgStatXactCommit = 0;
 		pgStatXactRollback = 0;
+		pgStatBlockReadTime = 0;
+		pgStatBlockWriteTime = 0;
+		pgStatSSLHandshakes = 0;
+		pgStatSSLResumptions = 0;
 	}
 	else
 	{
 		tsmsg->m_xact_commit = 0;
 		tsmsg->m_xact_rollback = 0;
+		tsmsg->m_block_read_time = 0;
+		tsmsg->m_block_write_time = 0;
+		tsmsg->m_ssl_handshakes = 0;
+		tsmsg->m_ssl_resumptions = 0;
 	}
 
 	n = tsmsg->m_nentries;
@@ -863,7 +595,7 @@ pgstat_send_funcstats(void)
 /* ----------
  * pgstat_vacuum_stat() -
  *
- *	Will tell the collector about objects he can get rid of.
+ *	Remove the statistics of objects that no longer exist.
  * ----------
  */
 void
@@ -878,14 +610,11 @@ pgstat_vacuum_stat(void)
 	PgStat_StatFuncEntry *funcentry;
 	int			len;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics, including our database's tables and functions.
 	 */
-	backend_read_statsfile();
+	backend_read_db_objects();
 
 	/*
 	 * Read pg_database and make a list of OIDs of all existing databases
@@ -893,8 +622,7 @@ pgstat_vacuum_stat(void)
 	htab = pgstat_collect_oids(DatabaseRelationId);
 
 	/*
-	 * Search the database hash table for dead databases and tell the
-	 * collector to drop them.
+	 * Search the database hash table for dead databases and drop them.
 	 */
 	hash_seq_init(&hstat, pgStatDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
@@ -1087,9 +815,7 @@ pgstat_collect_oids(Oid catalogid)
 /* ----------
  * pgstat_drop_database() -
  *
- *	Tell the collector that we just dropped a database.
- *	(If the message gets lost, we will still clean the dead DB eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Forget the statistics of a database we just dropped.
  * ----------
  */
 void
@@ -1097,9 +823,6 @@ pgstat_drop_database(Oid databaseid)
 {
 	PgStat_MsgDropdb msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DROPDB);
 	msg.m_databaseid = databaseid;
 	pgstat_send(&msg, sizeof(msg));
@@ -1109,9 +832,7 @@ pgstat_drop_database(Oid databaseid)
 /* ----------
  * pgstat_drop_relation() -
  *
- *	Tell the collector that we just dropped a relation.
- *	(If the message gets lost, we will still clean the dead entry eventually
- *	via future invocations of pgstat_vacuum_stat().)
+ *	Forget the statistics of a relation we just dropped.
  *
  *	Currently not used for lack of any good place to call it; we rely
  *	entirely on pgstat_vacuum_stat() to clean out stats for dead rels.
@@ -1124,9 +845,6 @@ pgstat_drop_relation(Oid relid)
 	PgStat_MsgTabpurge msg;
 	int			len;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	msg.m_tableid[0] = relid;
 	msg.m_nentries = 1;
 
@@ -1142,7 +860,7 @@ pgstat_drop_relation(Oid relid)
 /* ----------
  * pgstat_reset_counters() -
  *
- *	Tell the statistics collector to reset counters for our database.
+ *	Reset counters for our database.
  * ----------
  */
 void
@@ -1150,9 +868,6 @@ pgstat_reset_counters(void)
 {
 	PgStat_MsgResetcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	if (!superuser())
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
@@ -1166,7 +881,7 @@ pgstat_reset_counters(void)
 /* ----------
  * pgstat_reset_shared_counters() -
  *
- *	Tell the statistics collector to reset cluster-wide shared counters.
+ *	Reset cluster-wide shared counters.
  * ----------
  */
 void
@@ -1174,21 +889,24 @@ pgstat_reset_shared_counters(const char *target)
 {
 	PgStat_MsgResetsharedcounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	if (!superuser())
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
 				 errmsg("must be superuser to reset statistics counters")));
 
-	if (strcmp(target, "bgwriter") == 0)
-		msg.m_resettarget = RESET_BGWRITER;
-	else
+	if (strcmp(target, "lwlocks") == 0)
+	{
+		/* These live in shared memory of their own; just zero them */
+		LWLockResetStats();
+		return;
+	}
+
+	if (strcmp(target, "bgwriter") != 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"bgwriter\".")));
+				 errhint("Target must be \"bgwriter\" or \"lwlocks\".")));
+	msg.m_resettarget = RESET_BGWRITER;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -1197,7 +915,7 @@ pgstat_reset_shared_counters(const char *target)
 /* ----------
  * pgstat_reset_single_counter() -
  *
- *	Tell the statistics collector to reset a single counter.
+ *	Reset a single counter.
  * ----------
  */
 void
@@ -1205,9 +923,6 @@ pgstat_reset_single_counter(Oid objoid, PgStat_Single_Reset_Type type)
 {
 	PgStat_MsgResetsinglecounter msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	if (!superuser())
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
@@ -1234,9 +949,6 @@ pgstat_report_autovac(Oid dboid)
 {
 	PgStat_MsgAutovacStart msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_AUTOVAC_START);
 	msg.m_databaseid = dboid;
 	msg.m_start_time = GetCurrentTimestamp();
@@ -1248,7 +960,7 @@ pgstat_report_autovac(Oid dboid)
 /* ---------
  * pgstat_report_vacuum() -
  *
- *	Tell the collector about the table we just vacuumed.
+ *	Record the table we just vacuumed.
  * ---------
  */
 void
@@ -1256,7 +968,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared, PgStat_Counter tuples)
 {
 	PgStat_MsgVacuum msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_VACUUM);
@@ -1271,7 +983,7 @@ pgstat_report_vacuum(Oid tableoid, bool shared, PgStat_Counter tuples)
 /* --------
  * pgstat_report_analyze() -
  *
- *	Tell the collector about the table we just analyzed.
+ *	Record the table we just analyzed.
  * --------
  */
 void
@@ -1280,7 +992,7 @@ pgstat_report_analyze(Relation rel,
 {
 	PgStat_MsgAnalyze msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	/*
@@ -1288,9 +1000,9 @@ pgstat_report_analyze(Relation rel,
 	 * already inserted and/or deleted rows in the target table. ANALYZE will
 	 * have counted such rows as live or dead respectively. Because we will
 	 * report our counts of such rows at transaction end, we should subtract
-	 * off these counts from what we send to the collector now, else they'll
-	 * be double-counted after commit.	(This approach also ensures that the
-	 * collector ends up with the right numbers if we abort instead of
+	 * off these counts from what we store now, else they'll be
+	 * double-counted after commit.  (This approach also ensures that the
+	 * shared counts end up with the right numbers if we abort instead of
 	 * committing.)
 	 */
 	if (rel->pgstat_info != NULL)
@@ -1322,7 +1034,7 @@ pgstat_report_analyze(Relation rel,
 /* --------
  * pgstat_report_recovery_conflict() -
  *
- *	Tell the collector about a Hot Standby recovery conflict.
+ *	Record a Hot Standby recovery conflict.
  * --------
  */
 void
@@ -1330,7 +1042,7 @@ pgstat_report_recovery_conflict(int reason)
 {
 	PgStat_MsgRecoveryConflict msg;
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 		return;
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RECOVERYCONFLICT);
@@ -1339,42 +1051,26 @@ pgstat_report_recovery_conflict(int reason)
 	pgstat_send(&msg, sizeof(msg));
 }
 
-/* ----------
- * pgstat_ping() -
+/* --------
+ * pgstat_report_tempfile() -
  *
- *	Send some junk data to the collector to increase traffic.
- * ----------
+ *	Tell the collector about a temporary file.
+ * --------
  */
 void
-pgstat_ping(void)
+pgstat_report_tempfile(size_t filesize)
 {
-	PgStat_MsgDummy msg;
+	PgStat_MsgTempFile msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
+	if (!pgstat_track_counts)
 		return;
 
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_DUMMY);
-	pgstat_send(&msg, sizeof(msg));
-}
-
-/* ----------
- * pgstat_send_inquiry() -
- *
- *	Notify collector that we need fresh data.
- *	ts specifies the minimum acceptable timestamp for the stats file.
- * ----------
- */
-static void
-pgstat_send_inquiry(TimestampTz ts)
-{
-	PgStat_MsgInquiry msg;
-
-	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_INQUIRY);
-	msg.inquiry_time = ts;
+	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_TEMPFILE);
+	msg.m_databaseid = MyDatabaseId;
+	msg.m_filesize = filesize;
 	pgstat_send(&msg, sizeof(msg));
 }
 
-
 /*
  * Initialize function call usage data.
  * Called by the executor before invoking a function.
@@ -1525,7 +1221,7 @@ pgstat_initstats(Relation rel)
 		return;
 	}
 
-	if (pgStatSock == PGINVALID_SOCKET || !pgstat_track_counts)
+	if (!pgstat_track_counts)
 	{
 		/* We're not counting at all */
 		rel->pgstat_info = NULL;
@@ -1965,7 +1661,7 @@ AtPrepare_PgStat(void)
  *
  * All we need do here is unlink the transaction stats state from the
  * nontransactional state.	The nontransactional action counts will be
- * reported to the stats collector immediately, while the effects on live
+ * flushed to shared memory as usual, while the effects on live
  * and dead tuple counts are preserved in the 2PC state file.
  *
  * Note: AtEOXact_PgStat is not called during PREPARE.
@@ -2056,18 +1752,23 @@ pgstat_twophase_postabort(TransactionId xid, uint16 info,
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one database or NULL. NULL doesn't mean
- *	that the database doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the database doesn't exist, it just has no statistics yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatDBEntry *
 pgstat_fetch_stat_dbentry(Oid dbid)
 {
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics.  Callers asking for our own database or the shared
+	 * catalogs may want to look at the tables and functions, too.
 	 */
-	backend_read_statsfile();
+	if (OidIsValid(MyDatabaseId) &&
+		(dbid == MyDatabaseId || dbid == InvalidOid))
+		backend_read_db_objects();
+	else
+		backend_read_stats();
 
 	/*
 	 * Lookup the requested database; return NULL if not found
@@ -2083,8 +1784,8 @@ pgstat_fetch_stat_dbentry(Oid dbid)
  *
  *	Support function for the SQL-callable pgstat* functions. Returns
  *	the collected statistics for one table or NULL. NULL doesn't mean
- *	that the table doesn't exist, it is just not yet known by the
- *	collector, so the caller is better off to report ZERO instead.
+ *	that the table doesn't exist, it just has no statistics yet,
+ *	so the caller is better off to report ZERO instead.
  * ----------
  */
 PgStat_StatTabEntry *
@@ -2095,10 +1796,10 @@ pgstat_fetch_stat_tabentry(Oid relid)
 	PgStat_StatTabEntry *tabentry;
 
 	/*
-	 * If not done for this transaction, read the statistics collector stats
-	 * file into some hash tables.
+	 * If not done for this transaction, take a snapshot of the shared
+	 * statistics, including our database's tables.
 	 */
-	backend_read_statsfile();
+	backend_read_db_objects();
 
 	/*
 	 * Lookup our database, then look in its table hash table.
@@ -2136,6 +1837,39 @@ pgstat_fetch_stat_tabentry(Oid relid)
 }
 
 
+/* ----------
+ * pgstat_fetch_current_tabentry() -
+ *
+ *	Copy the current shared statistics of one table into *tabentry,
+ *	bypassing the snapshot.  Returns tabentry, or NULL if nothing is known
+ *	about the table.  This lets autovacuum recheck a table just before
+ *	processing it without taking a snapshot of the whole database.
+ * ----------
+ */
+PgStat_StatTabEntry *
+pgstat_fetch_current_tabentry(Oid relid, bool isshared,
+							  PgStat_StatTabEntry *tabentry)
+{
+	PgStat_ObjectKey key;
+	PgStat_StatTabEntry *shentry;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+
+	key.databaseid = isshared ? InvalidOid : MyDatabaseId;
+	key.objectid = relid;
+	hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+	partitionLock = PgStatPartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	shentry = pgstat_get_tab_entry(&key, hashcode, false);
+	if (shentry != NULL)
+		memcpy(tabentry, shentry, sizeof(PgStat_StatTabEntry));
+	LWLockRelease(partitionLock);
+
+	return shentry ? tabentry : NULL;
+}
+
+
 /* ----------
  * pgstat_fetch_stat_funcentry() -
  *
@@ -2149,8 +1883,8 @@ pgstat_fetch_stat_funcentry(Oid func_id)
 	PgStat_StatDBEntry *dbentry;
 	PgStat_StatFuncEntry *funcentry = NULL;
 
-	/* load the stats file if needed */
-	backend_read_statsfile();
+	/* take a snapshot of the stats if needed */
+	backend_read_db_objects();
 
 	/* Lookup our database, then find the requested function.  */
 	dbentry = pgstat_fetch_stat_dbentry(MyDatabaseId);
@@ -2213,7 +1947,7 @@ pgstat_fetch_stat_numbackends(void)
 PgStat_GlobalStats *
 pgstat_fetch_global(void)
 {
-	backend_read_statsfile();
+	backend_read_stats();
 
 	return &globalStats;
 }
@@ -2418,6 +2152,10 @@ pgstat_bestart(void)
 	beentry->st_waiting = false;
 	beentry->st_appname[0] = '\0';
 	beentry->st_activity[0] = '\0';
+	beentry->st_progress_command = PROGRESS_COMMAND_INVALID;
+	beentry->st_progress_command_target = InvalidOid;
+	MemSet((char *) beentry->st_progress_param, 0,
+		   sizeof(beentry->st_progress_param));
 	/* Also make sure the last byte in each string area is always 0 */
 	beentry->st_clienthostname[NAMEDATALEN - 1] = '\0';
 	beentry->st_appname[NAMEDATALEN - 1] = '\0';
@@ -2437,7 +2175,7 @@ pgstat_bestart(void)
 /*
  * Shut down a single backend's statistics reporting at process exit.
  *
- * Flush any remaining statistics counts out to the collector.
+ * Flush any remaining statistics counts out to shared memory.
  * Without this, operations triggered during backend exit (such as
  * temp table deletions) won't be counted.
  *
@@ -2450,7 +2188,7 @@ pgstat_beshutdown_hook(int code, Datum arg)
 
 	/*
 	 * If we got as far as discovering our own database ID, we can report what
-	 * we did to the collector.  Otherwise, we'd be sending an invalid
+	 * we did to shared memory.  Otherwise, we'd be storing an invalid
 	 * database ID, so forget it.  (This means that accesses to pg_database
 	 * during failed backend starts might never get counted.)
 	 */
@@ -2594,45 +2332,235 @@ pgstat_report_waiting(bool waiting)
 	beentry->st_waiting = waiting;
 }
 
-
 /* ----------
- * pgstat_read_current_status() -
+ * pgstat_progress_start_command() -
  *
- *	Copy the current contents of the PgBackendStatus array to local memory,
- *	if not already done in this transaction.
+ *	Called at the start of a long maintenance command, to advertise which
+ *	command we're running and on which relation, and reset the progress
+ *	counters.
  * ----------
  */
-static void
-pgstat_read_current_status(void)
+void
+pgstat_progress_start_command(ProgressCommandType cmdtype, Oid relid)
 {
-	volatile PgBackendStatus *beentry;
-	PgBackendStatus *localtable;
-	PgBackendStatus *localentry;
-	char	   *localappname,
-			   *localactivity;
-	int			i;
+	volatile PgBackendStatus *beentry = MyBEEntry;
 
-	Assert(!pgStatRunningInCollector);
-	if (localBackendStatusTable)
-		return;					/* already done */
+	if (!pgstat_track_activities || !beentry)
+		return;
 
-	pgstat_setup_memcxt();
+	beentry->st_changecount++;
+	beentry->st_progress_command = cmdtype;
+	beentry->st_progress_command_target = relid;
+	MemSet((char *) beentry->st_progress_param, 0,
+		   sizeof(beentry->st_progress_param));
+	beentry->st_changecount++;
+	Assert((beentry->st_changecount & 1) == 0);
+}
 
-	localtable = (PgBackendStatus *)
-		MemoryContextAlloc(pgStatLocalContext,
-						   sizeof(PgBackendStatus) * MaxBackends);
-	localappname = (char *)
-		MemoryContextAlloc(pgStatLocalContext,
-						   NAMEDATALEN * MaxBackends);
-	localactivity = (char *)
-		MemoryContextAlloc(pgStatLocalContext,
-						   pgstat_track_activity_query_size * MaxBackends);
-	localNumBackends = 0;
+/* ----------
+ * pgstat_progress_update_param() -
+ *
+ *	Set one of the progress counters of the current command.  Does nothing
+ *	if no command is being tracked, so callers needn't check.
+ * ----------
+ */
+void
+pgstat_progress_update_param(int index, int64 val)
+{
+	volatile PgBackendStatus *beentry = MyBEEntry;
 
-	beentry = BackendStatusArray;
-	localentry = localtable;
-	for (i = 1; i <= MaxBackends; i++)
-	{
+	Assert(index >= 0 && index < PGSTAT_NUM_PROGRESS_PARAM);
+
+	if (!beentry || beentry->st_progress_command == PROGRESS_COMMAND_INVALID)
+		return;
+
+	beentry->st_changecount++;
+	beentry->st_progress_param[index] = val;
+	beentry->st_changecount++;
+	Assert((beentry->st_changecount & 1) == 0);
+}
+
+/* ----------
+ * pgstat_progress_update_multi_param() -
+ *
+ *	Set several progress counters at once, so that readers never see some
+ *	of them updated and others not.
+ * ----------
+ */
+void
+pgstat_progress_update_multi_param(int nparam, const int *index,
+								   const int64 *val)
+{
+	volatile PgBackendStatus *beentry = MyBEEntry;
+	int			i;
+
+	if (!beentry || beentry->st_progress_command == PROGRESS_COMMAND_INVALID)
+		return;
+
+	beentry->st_changecount++;
+	for (i = 0; i < nparam; i++)
+	{
+		Assert(index[i] >= 0 && index[i] < PGSTAT_NUM_PROGRESS_PARAM);
+		beentry->st_progress_param[index[i]] = val[i];
+	}
+	beentry->st_changecount++;
+	Assert((beentry->st_changecount & 1) == 0);
+}
+
+/* ----------
+ * pgstat_progress_incr_param() -
+ *
+ *	Add to one of the progress counters of the current command.
+ * ----------
+ */
+void
+pgstat_progress_incr_param(int index, int64 incr)
+{
+	volatile PgBackendStatus *beentry = MyBEEntry;
+
+	Assert(index >= 0 && index < PGSTAT_NUM_PROGRESS_PARAM);
+
+	if (!beentry || beentry->st_progress_command == PROGRESS_COMMAND_INVALID)
+		return;
+
+	beentry->st_changecount++;
+	beentry->st_progress_param[index] += incr;
+	beentry->st_changecount++;
+	Assert((beentry->st_changecount & 1) == 0);
+}
+
+/* ----------
+ * pgstat_progress_end_command() -
+ *
+ *	Called when the command is done, or from transaction abort.
+ * ----------
+ */
+void
+pgstat_progress_end_command(void)
+{
+	volatile PgBackendStatus *beentry = MyBEEntry;
+
+	if (!beentry || beentry->st_progress_command == PROGRESS_COMMAND_INVALID)
+		return;
+
+	beentry->st_changecount++;
+	beentry->st_progress_command = PROGRESS_COMMAND_INVALID;
+	beentry->st_progress_command_target = InvalidOid;
+	beentry->st_changecount++;
+	Assert((beentry->st_changecount & 1) == 0);
+}
+
+/* ----------
+ * pgstat_get_wait_event_type() -
+ *
+ *	Return the name of the class of a wait event, or NULL if not waiting.
+ * ----------
+ */
+const char *
+pgstat_get_wait_event_type(uint32 wait_event_info)
+{
+	switch (wait_event_info & PG_WAIT_CLASS_MASK)
+	{
+		case PG_WAIT_LWLOCK:
+			return "LWLock";
+		case PG_WAIT_LOCK:
+			return "Lock";
+		case PG_WAIT_IO:
+			return "IO";
+		case PG_WAIT_CLIENT:
+			return "Client";
+		case PG_WAIT_LATCH:
+			return "Latch";
+	}
+	return NULL;
+}
+
+/* ----------
+ * pgstat_get_wait_event() -
+ *
+ *	Return the name of a wait event, or NULL if not waiting.
+ * ----------
+ */
+const char *
+pgstat_get_wait_event(uint32 wait_event_info)
+{
+	uint32		id = wait_event_info & PG_WAIT_ID_MASK;
+
+	switch (wait_event_info & PG_WAIT_CLASS_MASK)
+	{
+		case PG_WAIT_LWLOCK:
+			return GetLWLockIdentifier((LWLockId) id);
+		case PG_WAIT_LOCK:
+			if (id <= LOCKTAG_LAST_TYPE)
+				return LockTagTypeNames[id];
+			break;
+		case PG_WAIT_LATCH:
+			return "Latch";
+	}
+
+	switch (wait_event_info)
+	{
+		case WAIT_EVENT_DATA_FILE_READ:
+			return "DataFileRead";
+		case WAIT_EVENT_DATA_FILE_WRITE:
+			return "DataFileWrite";
+		case WAIT_EVENT_DATA_FILE_EXTEND:
+			return "DataFileExtend";
+		case WAIT_EVENT_DATA_FILE_SYNC:
+			return "DataFileSync";
+		case WAIT_EVENT_WAL_READ:
+			return "WALRead";
+		case WAIT_EVENT_WAL_WRITE:
+			return "WALWrite";
+		case WAIT_EVENT_WAL_SYNC:
+			return "WALSync";
+		case WAIT_EVENT_CLIENT_READ:
+			return "ClientRead";
+		case WAIT_EVENT_CLIENT_WRITE:
+			return "ClientWrite";
+	}
+
+	return wait_event_info != 0 ? "unknown" : NULL;
+}
+
+
+/* ----------
+ * pgstat_read_current_status() -
+ *
+ *	Copy the current contents of the PgBackendStatus array to local memory,
+ *	if not already done in this transaction.
+ * ----------
+ */
+static void
+pgstat_read_current_status(void)
+{
+	volatile PgBackendStatus *beentry;
+	PgBackendStatus *localtable;
+	PgBackendStatus *localentry;
+	char	   *localappname,
+			   *localactivity;
+	int			i;
+
+	if (localBackendStatusTable)
+		return;					/* already done */
+
+	pgstat_setup_memcxt();
+
+	localtable = (PgBackendStatus *)
+		MemoryContextAlloc(pgStatLocalContext,
+						   sizeof(PgBackendStatus) * MaxBackends);
+	localappname = (char *)
+		MemoryContextAlloc(pgStatLocalContext,
+						   NAMEDATALEN * MaxBackends);
+	localactivity = (char *)
+		MemoryContextAlloc(pgStatLocalContext,
+						   pgstat_track_activity_query_size * MaxBackends);
+	localNumBackends = 0;
+
+	beentry = BackendStatusArray;
+	localentry = localtable;
+	for (i = 1; i <= MaxBackends; i++)
+	{
 		/*
 		 * Follow the protocol of retrying if st_changecount changes while we
 		 * copy the entry, or if it's odd.  (The check for odd is needed to
@@ -2853,36 +2781,87 @@ pgstat_setheader(PgStat_MsgHdr *hdr, StatMsgType mtype)
 /* ----------
  * pgstat_send() -
  *
- *		Send out one statistics message to the collector
+ *		Apply one statistics message to the shared statistics store
  * ----------
  */
 static void
 pgstat_send(void *msg, int len)
 {
-	int			rc;
+	PgStat_MsgHdr *hdr = (PgStat_MsgHdr *) msg;
 
-	if (pgStatSock == PGINVALID_SOCKET)
-		return;
-
-	((PgStat_MsgHdr *) msg)->m_size = len;
+	hdr->m_size = len;
 
-	/* We'll retry after EINTR, but ignore all other failures */
-	do
+	switch (hdr->m_type)
 	{
-		rc = send(pgStatSock, msg, len, 0);
-	} while (rc < 0 && errno == EINTR);
-
-#ifdef USE_ASSERT_CHECKING
-	/* In debug builds, log send failures ... */
-	if (rc < 0)
-		elog(LOG, "could not send to statistics collector: %m");
-#endif
+		case PGSTAT_MTYPE_TABSTAT:
+			pgstat_recv_tabstat((PgStat_MsgTabstat *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_TABPURGE:
+			pgstat_recv_tabpurge((PgStat_MsgTabpurge *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_DROPDB:
+			pgstat_recv_dropdb((PgStat_MsgDropdb *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETCOUNTER:
+			pgstat_recv_resetcounter((PgStat_MsgResetcounter *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
+			pgstat_recv_resetsharedcounter((PgStat_MsgResetsharedcounter *) msg,
+										   len);
+			break;
+
+		case PGSTAT_MTYPE_RESETSINGLECOUNTER:
+			pgstat_recv_resetsinglecounter((PgStat_MsgResetsinglecounter *) msg,
+										   len);
+			break;
+
+		case PGSTAT_MTYPE_AUTOVAC_START:
+			pgstat_recv_autovac((PgStat_MsgAutovacStart *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_VACUUM:
+			pgstat_recv_vacuum((PgStat_MsgVacuum *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_ANALYZE:
+			pgstat_recv_analyze((PgStat_MsgAnalyze *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_BGWRITER:
+			pgstat_recv_bgwriter((PgStat_MsgBgWriter *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_FUNCSTAT:
+			pgstat_recv_funcstat((PgStat_MsgFuncstat *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_FUNCPURGE:
+			pgstat_recv_funcpurge((PgStat_MsgFuncpurge *) msg, len);
+			break;
+
+		case PGSTAT_MTYPE_RECOVERYCONFLICT:
+			pgstat_recv_recoveryconflict((PgStat_MsgRecoveryConflict *) msg,
+										 len);
+			break;
+
+		case PGSTAT_MTYPE_TEMPFILE:
+			pgstat_recv_tempfile((PgStat_MsgTempFile *) msg, len);
+			break;
+
+		default:
+			elog(ERROR, "unrecognized statistics message type: %d",
+				 (int) hdr->m_type);
+	}
 }
 
 /* ----------
  * pgstat_send_bgwriter() -
  *
- *		Send bgwriter statistics to the collector
+ *		Flush bgwriter statistics to shared memory
  * ----------
  */
 void
@@ -2893,8 +2872,7 @@ pgstat_send_bgwriter(void)
 
 	/*
 	 * This function can be called even if nothing at all has happened. In
-	 * this case, avoid sending a completely empty message to the stats
-	 * collector.
+	 * this case, avoid taking the lock for a completely empty message.
 	 */
 	if (memcmp(&BgWriterStats, &all_zeroes, sizeof(PgStat_MsgBgWriter)) == 0)
 		return;
@@ -2912,343 +2890,32 @@ pgstat_send_bgwriter(void)
 }
 
 
-/* ----------
- * PgstatCollectorMain() -
- *
- *	Start up the statistics collector process.	This is the body of the
- *	postmaster child process.
- *
- *	The argc/argv parameters are valid only in EXEC_BACKEND case.
- * ----------
- */
-NON_EXEC_STATIC void
-PgstatCollectorMain(int argc, char *argv[])
-{
-	int			len;
-	PgStat_Msg	msg;
-
-#ifndef WIN32
-#ifdef HAVE_POLL
-	struct pollfd input_fd;
-#else
-	struct timeval sel_timeout;
-	fd_set		rfds;
-#endif
-#endif
-
-	IsUnderPostmaster = true;	/* we are a postmaster subprocess now */
-
-	MyProcPid = getpid();		/* reset MyProcPid */
-
-	MyStartTime = time(NULL);	/* record Start Time for logging */
-
-	/*
-	 * If possible, make this process a group leader, so that the postmaster
-	 * can signal any child processes too.	(pgstat probably never has any
-	 * child processes, but for consistency we make all postmaster child
-	 * processes do this.)
-	 */
-#ifdef HAVE_SETSID
-	if (setsid() < 0)
-		elog(FATAL, "setsid() failed: %m");
-#endif
-
-	/*
-	 * Ignore all signals usually bound to some action in the postmaster,
-	 * except SIGQUIT.
-	 */
-	pqsignal(SIGHUP, pgstat_sighup_handler);
-	pqsignal(SIGINT, SIG_IGN);
-	pqsignal(SIGTERM, SIG_IGN);
-	pqsignal(SIGQUIT, pgstat_exit);
-	pqsignal(SIGALRM, SIG_IGN);
-	pqsignal(SIGPIPE, SIG_IGN);
-	pqsignal(SIGUSR1, SIG_IGN);
-	pqsignal(SIGUSR2, SIG_IGN);
-	pqsignal(SIGCHLD, SIG_DFL);
-	pqsignal(SIGTTIN, SIG_DFL);
-	pqsignal(SIGTTOU, SIG_DFL);
-	pqsignal(SIGCONT, SIG_DFL);
-	pqsignal(SIGWINCH, SIG_DFL);
-	PG_SETMASK(&UnBlockSig);
-
-	/*
-	 * Identify myself via ps
-	 */
-	init_ps_display("stats collector process", "", "", "");
-
-	/*
-	 * Arrange to write the initial status file right away
-	 */
-	last_statrequest = GetCurrentTimestamp();
-	last_statwrite = last_statrequest - 1;
-
-	/*
-	 * Read in an existing statistics stats file or initialize the stats to
-	 * zero.
-	 */
-	pgStatRunningInCollector = true;
-	pgStatDBHash = pgstat_read_statsfile(InvalidOid, true);
-
-	/*
-	 * Setup the descriptor set for select(2).	Since only one bit in the set
-	 * ever changes, we need not repeat FD_ZERO each time.
-	 */
-#if !defined(HAVE_POLL) && !defined(WIN32)
-	FD_ZERO(&rfds);
-#endif
-
-	/*
-	 * Loop to process messages until we get SIGQUIT or detect ungraceful
-	 * death of our parent postmaster.
-	 *
-	 * For performance reasons, we don't want to do a PostmasterIsAlive() test
-	 * after every message; instead, do it only when select()/poll() is
-	 * interrupted by timeout.	In essence, we'll stay alive as long as
-	 * backends keep sending us stuff often, even if the postmaster is gone.
-	 */
-	for (;;)
-	{
-		int			got_data;
-
-		/*
-		 * Quit if we get SIGQUIT from the postmaster.
-		 */
-		if (need_exit)
-			break;
-
-		/*
-		 * Reload configuration if we got SIGHUP from the postmaster.
-		 */
-		if (got_SIGHUP)
-		{
-			ProcessConfigFile(PGC_SIGHUP);
-			got_SIGHUP = false;
-		}
-
-		/*
-		 * Write the stats file if a new request has arrived that is not
-		 * satisfied by existing file.
-		 */
-		if (last_statwrite < last_statrequest)
-			pgstat_write_statsfile(false);
-
-		/*
-		 * Wait for a message to arrive; but not for more than
-		 * PGSTAT_SELECT_TIMEOUT seconds. (This determines how quickly we will
-		 * shut down after an ungraceful postmaster termination; so it needn't
-		 * be very fast.  However, on some systems SIGQUIT won't interrupt the
-		 * poll/select call, so this also limits speed of response to SIGQUIT,
-		 * which is more important.)
-		 *
-		 * We use poll(2) if available, otherwise select(2). Win32 has its own
-		 * implementation.
-		 */
-#ifndef WIN32
-#ifdef HAVE_POLL
-		input_fd.fd = pgStatSock;
-		input_fd.events = POLLIN | POLLERR;
-		input_fd.revents = 0;
-
-		if (poll(&input_fd, 1, PGSTAT_SELECT_TIMEOUT * 1000) < 0)
-		{
-			if (errno == EINTR)
-				continue;
-			ereport(ERROR,
-					(errcode_for_socket_access(),
-					 errmsg("poll() failed in statistics collector: %m")));
-		}
-
-		got_data = (input_fd.revents != 0);
-#else							/* !HAVE_POLL */
-
-		FD_SET(pgStatSock, &rfds);
-
-		/*
-		 * timeout struct is modified by select() on some operating systems,
-		 * so re-fill it each time.
-		 */
-		sel_timeout.tv_sec = PGSTAT_SELECT_TIMEOUT;
-		sel_timeout.tv_usec = 0;
-
-		if (select(pgStatSock + 1, &rfds, NULL, NULL, &sel_timeout) < 0)
-		{
-			if (errno == EINTR)
-				continue;
-			ereport(ERROR,
-					(errcode_for_socket_access(),
-					 errmsg("select() failed in statistics collector: %m")));
-		}
-
-		got_data = FD_ISSET(pgStatSock, &rfds);
-#endif   /* HAVE_POLL */
-#else							/* WIN32 */
-		got_data = pgwin32_waitforsinglesocket(pgStatSock, FD_READ,
-											   PGSTAT_SELECT_TIMEOUT * 1000);
-#endif
-
-		/*
-		 * If there is a message on the socket, read it and check for
-		 * validity.
-		 */
-		if (got_data)
-		{
-			len = recv(pgStatSock, (char *) &msg,
-					   sizeof(PgStat_Msg), 0);
-			if (len < 0)
-			{
-				if (errno == EINTR)
-					continue;
-				ereport(ERROR,
-						(errcode_for_socket_access(),
-						 errmsg("could not read statistics message: %m")));
-			}
-
-			/*
-			 * We ignore messages that are smaller than our common header
-			 */
-			if (len < sizeof(PgStat_MsgHdr))
-				continue;
-
-			/*
-			 * The received length must match the length in the header
-			 */
-			if (msg.msg_hdr.m_size != len)
-				continue;
-
-			/*
-			 * O.K. - we accept this message.  Process it.
-			 */
-			switch (msg.msg_hdr.m_type)
-			{
-				case PGSTAT_MTYPE_DUMMY:
-					break;
-
-				case PGSTAT_MTYPE_INQUIRY:
-					pgstat_recv_inquiry((PgStat_MsgInquiry *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TABSTAT:
-					pgstat_recv_tabstat((PgStat_MsgTabstat *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_TABPURGE:
-					pgstat_recv_tabpurge((PgStat_MsgTabpurge *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_DROPDB:
-					pgstat_recv_dropdb((PgStat_MsgDropdb *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_RESETCOUNTER:
-					pgstat_recv_resetcounter((PgStat_MsgResetcounter *) &msg,
-											 len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSHAREDCOUNTER:
-					pgstat_recv_resetsharedcounter(
-									   (PgStat_MsgResetsharedcounter *) &msg,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_RESETSINGLECOUNTER:
-					pgstat_recv_resetsinglecounter(
-									   (PgStat_MsgResetsinglecounter *) &msg,
-												   len);
-					break;
-
-				case PGSTAT_MTYPE_AUTOVAC_START:
-					pgstat_recv_autovac((PgStat_MsgAutovacStart *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_VACUUM:
-					pgstat_recv_vacuum((PgStat_MsgVacuum *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_ANALYZE:
-					pgstat_recv_analyze((PgStat_MsgAnalyze *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_BGWRITER:
-					pgstat_recv_bgwriter((PgStat_MsgBgWriter *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCSTAT:
-					pgstat_recv_funcstat((PgStat_MsgFuncstat *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_FUNCPURGE:
-					pgstat_recv_funcpurge((PgStat_MsgFuncpurge *) &msg, len);
-					break;
-
-				case PGSTAT_MTYPE_RECOVERYCONFLICT:
-					pgstat_recv_recoveryconflict((PgStat_MsgRecoveryConflict *) &msg, len);
-					break;
-
-				default:
-					break;
-			}
-		}
-		else
-		{
-			/*
-			 * We can only get here if the select/poll timeout elapsed. Check
-			 * for postmaster death.
-			 */
-			if (!PostmasterIsAlive())
-				break;
-		}
-	}							/* end of message-processing loop */
-
-	/*
-	 * Save the final stats to reuse at next startup.
-	 */
-	pgstat_write_statsfile(true);
-
-	exit(0);
-}
-
-
-/* SIGQUIT signal handler for collector process */
-static void
-pgstat_exit(SIGNAL_ARGS)
-{
-	need_exit = true;
-}
-
-/* SIGHUP handler for collector process */
-static void
-pgstat_sighup_handler(SIGNAL_ARGS)
-{
-	got_SIGHUP = true;
-}
-
-
 /*
- * Lookup the hash table entry for the specified database. If no hash
+ * Lookup the shared hash table entry for the specified database. If no hash
  * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Else, return NULL.  NULL is also returned if a new entry doesn't fit in
+ * shared memory.
+ *
+ * The caller must hold PgStatDBLock, exclusively if create is true.
  */
 static PgStat_StatDBEntry *
 pgstat_get_db_entry(Oid databaseid, bool create)
 {
 	PgStat_StatDBEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
+	HASHACTION	action = (create ? HASH_ENTER_NULL : HASH_FIND);
 
 	/* Lookup or create the hash table entry for this database */
-	result = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+	result = (PgStat_StatDBEntry *) hash_search(pgStatSharedDBHash,
 												&databaseid,
 												action, &found);
 
-	if (!create && !found)
+	if (result == NULL)
 		return NULL;
 
 	/* If not found, initialize the new one. */
 	if (!found)
 	{
-		HASHCTL		hash_ctl;
-
 		result->tables = NULL;
 		result->functions = NULL;
 		result->n_xact_commit = 0;
@@ -3266,54 +2933,93 @@ pgstat_get_db_entry(Oid databaseid, bool create)
 		result->n_conflict_snapshot = 0;
 		result->n_conflict_bufferpin = 0;
 		result->n_conflict_startup_deadlock = 0;
+		result->n_temp_files = 0;
+		result->n_temp_bytes = 0;
+		result->n_block_read_time = 0;
+		result->n_block_write_time = 0;
+		result->n_ssl_handshakes = 0;
+		result->n_ssl_resumptions = 0;
 
 		result->stat_reset_timestamp = GetCurrentTimestamp();
+	}
 
-		memset(&hash_ctl, 0, sizeof(hash_ctl));
-		hash_ctl.keysize = sizeof(Oid);
-		hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-		hash_ctl.hash = oid_hash;
-		result->tables = hash_create("Per-database table",
-									 PGSTAT_TAB_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_FUNCTION);
+	return result;
+}
 
-		hash_ctl.keysize = sizeof(Oid);
-		hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-		hash_ctl.hash = oid_hash;
-		result->functions = hash_create("Per-database function",
-										PGSTAT_FUNCTION_HASH_SIZE,
-										&hash_ctl,
-										HASH_ELEM | HASH_FUNCTION);
+/*
+ * Make sure the shared entry for the specified database exists, so that
+ * the database's table and function entries show up in snapshots.
+ */
+static void
+pgstat_ensure_db_entry(Oid databaseid)
+{
+	bool		found;
+
+	LWLockAcquire(PgStatDBLock, LW_SHARED);
+	found = (pgstat_get_db_entry(databaseid, false) != NULL);
+	LWLockRelease(PgStatDBLock);
+
+	if (!found)
+	{
+		LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+		(void) pgstat_get_db_entry(databaseid, true);
+		LWLockRelease(PgStatDBLock);
 	}
+}
 
-	return result;
+/*
+ * Complain, once per process, that a table or function entry didn't fit in
+ * the shared hash tables.
+ */
+static void
+pgstat_report_table_full(void)
+{
+	static bool reported = false;
+
+	if (!reported)
+	{
+		ereport(LOG,
+				(errmsg("shared statistics table is full, statistics of some objects will not be kept"),
+				 errhint("Consider increasing the configuration parameter \"max_stats_objects\".")));
+		reported = true;
+	}
 }
 
 
 /*
- * Lookup the hash table entry for the specified table. If no hash
+ * Lookup the shared hash table entry for the specified table. If no hash
  * table entry exists, initialize it, if the create parameter is true.
- * Else, return NULL.
+ * Else, return NULL.  NULL is also returned if a new entry doesn't fit.
+ *
+ * hashcode must be the hash value of the key, and the caller must hold the
+ * corresponding partition lock, exclusively if create is true.
  */
 static PgStat_StatTabEntry *
-pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
+pgstat_get_tab_entry(PgStat_ObjectKey *key, uint32 hashcode, bool create)
 {
+	PgStat_SharedTabEntry *shentry;
 	PgStat_StatTabEntry *result;
 	bool		found;
-	HASHACTION	action = (create ? HASH_ENTER : HASH_FIND);
+	HASHACTION	action = (create ? HASH_ENTER_NULL : HASH_FIND);
 
 	/* Lookup or create the hash table entry for this table */
-	result = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-												 &tableoid,
-												 action, &found);
+	shentry = (PgStat_SharedTabEntry *)
+		hash_search_with_hash_value(pgStatSharedTabHash, (void *) key,
+									hashcode, action, &found);
 
-	if (!create && !found)
+	if (shentry == NULL)
+	{
+		if (create)
+			pgstat_report_table_full();
 		return NULL;
+	}
+
+	result = &shentry->stats;
 
 	/* If not found, initialize the new one. */
 	if (!found)
 	{
+		result->tableid = key->objectid;
 		result->numscans = 0;
 		result->tuples_returned = 0;
 		result->tuples_fetched = 0;
@@ -3324,6 +3030,7 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 		result->n_live_tuples = 0;
 		result->n_dead_tuples = 0;
 		result->changes_since_analyze = 0;
+		result->inserts_since_vacuum = 0;
 		result->blocks_fetched = 0;
 		result->blocks_hit = 0;
 		result->vacuum_timestamp = 0;
@@ -3340,30 +3047,103 @@ pgstat_get_tab_entry(PgStat_StatDBEntry *dbentry, Oid tableoid, bool create)
 }
 
 
+/*
+ * Same as pgstat_get_tab_entry, for a function.
+ */
+static PgStat_StatFuncEntry *
+pgstat_get_func_entry(PgStat_ObjectKey *key, uint32 hashcode, bool create)
+{
+	PgStat_SharedFuncEntry *shentry;
+	PgStat_StatFuncEntry *result;
+	bool		found;
+	HASHACTION	action = (create ? HASH_ENTER_NULL : HASH_FIND);
+
+	shentry = (PgStat_SharedFuncEntry *)
+		hash_search_with_hash_value(pgStatSharedFuncHash, (void *) key,
+									hashcode, action, &found);
+
+	if (shentry == NULL)
+	{
+		if (create)
+			pgstat_report_table_full();
+		return NULL;
+	}
+
+	result = &shentry->stats;
+
+	if (!found)
+	{
+		result->functionid = key->objectid;
+		result->f_numcalls = 0;
+		result->f_time = 0;
+		result->f_time_self = 0;
+	}
+
+	return result;
+}
+
+
+/*
+ * Remove all table and function entries of the specified database from the
+ * shared hash tables.  This locks all the partitions, but it's only needed
+ * when a database is dropped or its counters are reset.
+ */
+static void
+pgstat_remove_db_objects(Oid databaseid)
+{
+	HASH_SEQ_STATUS hstat;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	int			i;
+
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(FirstPgStatLock + i, LW_EXCLUSIVE);
+
+	/* It's OK to remove the entry just returned by hash_seq_search */
+	hash_seq_init(&hstat, pgStatSharedTabHash);
+	while ((tabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		if (tabentry->key.databaseid == databaseid)
+			(void) hash_search(pgStatSharedTabHash, (void *) &tabentry->key,
+							   HASH_REMOVE, NULL);
+	}
+
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((funcentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		if (funcentry->key.databaseid == databaseid)
+			(void) hash_search(pgStatSharedFuncHash, (void *) &funcentry->key,
+							   HASH_REMOVE, NULL);
+	}
+
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(FirstPgStatLock + i);
+}
+
+
 /* ----------
  * pgstat_write_statsfile() -
  *
- *	Tell the news.
- *	If writing to the permanent file (happens when the collector is
- *	shutting down only), remove the temporary file so that backends
- *	starting up under a new postmaster can't read the old data before
- *	the new collector is ready.
+ *	Write the shared statistics out to the permanent stats file, so that
+ *	they survive a clean shutdown.  This is called once at the very end of
+ *	shutdown (see ShutdownXLOG), so we don't mind holding the locks while
+ *	doing file I/O.
  * ----------
  */
-static void
-pgstat_write_statsfile(bool permanent)
+void
+pgstat_write_statsfile(void)
 {
 	HASH_SEQ_STATUS hstat;
-	HASH_SEQ_STATUS tstat;
-	HASH_SEQ_STATUS fstat;
 	PgStat_StatDBEntry *dbentry;
-	PgStat_StatTabEntry *tabentry;
-	PgStat_StatFuncEntry *funcentry;
+	PgStat_SharedTabEntry *tabentry;
+	PgStat_SharedFuncEntry *funcentry;
+	PgStat_GlobalStats gstats;
 	FILE	   *fpout;
 	int32		format_id;
-	const char *tmpfile = permanent ? PGSTAT_STAT_PERMANENT_TMPFILE : pgstat_stat_tmpname;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	const char *tmpfile = PGSTAT_STAT_PERMANENT_TMPFILE;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 	int			rc;
+	int			i;
 
 	/*
 	 * Open the statistics temp file to write out the current values.
@@ -3378,11 +3158,6 @@ pgstat_write_statsfile(bool permanent)
 		return;
 	}
 
-	/*
-	 * Set the timestamp of the stats file.
-	 */
-	globalStats.stats_timestamp = GetCurrentTimestamp();
-
 	/*
 	 * Write the file header --- currently just a format ID.
 	 */
@@ -3390,55 +3165,56 @@ pgstat_write_statsfile(bool permanent)
 	rc = fwrite(&format_id, sizeof(format_id), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
+	LWLockAcquire(PgStatDBLock, LW_SHARED);
+
 	/*
-	 * Write global stats struct
+	 * Write global stats struct, with the timestamp of the stats file.
 	 */
-	rc = fwrite(&globalStats, sizeof(globalStats), 1, fpout);
+	memcpy(&gstats, &pgStatShmem->globalStats, sizeof(gstats));
+	gstats.stats_timestamp = GetCurrentTimestamp();
+	rc = fwrite(&gstats, sizeof(gstats), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
 	/*
-	 * Walk through the database table.
+	 * Walk through the database table.  We don't write the tables or
+	 * functions pointers, since they're of no use to any other process.
 	 */
-	hash_seq_init(&hstat, pgStatDBHash);
+	hash_seq_init(&hstat, pgStatSharedDBHash);
 	while ((dbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
 	{
-		/*
-		 * Write out the DB entry including the number of live backends. We
-		 * don't write the tables or functions pointers, since they're of no
-		 * use to any other process.
-		 */
 		fputc('D', fpout);
 		rc = fwrite(dbentry, offsetof(PgStat_StatDBEntry, tables), 1, fpout);
 		(void) rc;				/* we'll check for error with ferror */
+	}
 
-		/*
-		 * Walk through the database's access stats per table.
-		 */
-		hash_seq_init(&tstat, dbentry->tables);
-		while ((tabentry = (PgStat_StatTabEntry *) hash_seq_search(&tstat)) != NULL)
-		{
-			fputc('T', fpout);
-			rc = fwrite(tabentry, sizeof(PgStat_StatTabEntry), 1, fpout);
-			(void) rc;			/* we'll check for error with ferror */
-		}
+	LWLockRelease(PgStatDBLock);
 
-		/*
-		 * Walk through the database's function stats table.
-		 */
-		hash_seq_init(&fstat, dbentry->functions);
-		while ((funcentry = (PgStat_StatFuncEntry *) hash_seq_search(&fstat)) != NULL)
-		{
-			fputc('F', fpout);
-			rc = fwrite(funcentry, sizeof(PgStat_StatFuncEntry), 1, fpout);
-			(void) rc;			/* we'll check for error with ferror */
-		}
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(FirstPgStatLock + i, LW_SHARED);
 
-		/*
-		 * Mark the end of this DB
-		 */
-		fputc('d', fpout);
+	/*
+	 * Walk through the table and function stats.  Each entry is written
+	 * along with its hash key, which identifies the database it belongs to.
+	 */
+	hash_seq_init(&hstat, pgStatSharedTabHash);
+	while ((tabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		fputc('T', fpout);
+		rc = fwrite(tabentry, sizeof(PgStat_SharedTabEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
+	}
+
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((funcentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		fputc('F', fpout);
+		rc = fwrite(funcentry, sizeof(PgStat_SharedFuncEntry), 1, fpout);
+		(void) rc;				/* we'll check for error with ferror */
 	}
 
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(FirstPgStatLock + i);
+
 	/*
 	 * No more output to be done. Close the temp file and replace the old
 	 * pgstat.stat with it.  The ferror() check replaces testing for error
@@ -3471,111 +3247,47 @@ pgstat_write_statsfile(bool permanent)
 						tmpfile, statfile)));
 		unlink(tmpfile);
 	}
-	else
-	{
-		/*
-		 * Successful write, so update last_statwrite.
-		 */
-		last_statwrite = globalStats.stats_timestamp;
-
-		/*
-		 * If there is clock skew between backends and the collector, we could
-		 * receive a stats request time that's in the future.  If so, complain
-		 * and reset last_statrequest.	Resetting ensures that no inquiry
-		 * message can cause more than one stats file write to occur.
-		 */
-		if (last_statrequest > last_statwrite)
-		{
-			char	   *reqtime;
-			char	   *mytime;
-
-			/* Copy because timestamptz_to_str returns a static buffer */
-			reqtime = pstrdup(timestamptz_to_str(last_statrequest));
-			mytime = pstrdup(timestamptz_to_str(last_statwrite));
-			elog(LOG, "last_statrequest %s is later than collector's time %s",
-				 reqtime, mytime);
-			pfree(reqtime);
-			pfree(mytime);
-
-			last_statrequest = last_statwrite;
-		}
-	}
-
-	if (permanent)
-		unlink(pgstat_stat_filename);
 }
 
 
 /* ----------
  * pgstat_read_statsfile() -
  *
- *	Reads in an existing statistics collector file and initializes the
- *	databases' hash table (whose entries point to the tables' hash tables).
+ *	Reads in an existing permanent statistics file and loads its contents
+ *	into the shared hash tables.  This is called during a clean startup,
+ *	before anybody else looks at the statistics.  The file is removed
+ *	afterwards, so that its contents can't be loaded again after a crash.
  * ----------
  */
-static HTAB *
-pgstat_read_statsfile(Oid onlydb, bool permanent)
+void
+pgstat_read_statsfile(void)
 {
 	PgStat_StatDBEntry *dbentry;
 	PgStat_StatDBEntry dbbuf;
 	PgStat_StatTabEntry *tabentry;
-	PgStat_StatTabEntry tabbuf;
-	PgStat_StatFuncEntry funcbuf;
+	PgStat_SharedTabEntry tabbuf;
 	PgStat_StatFuncEntry *funcentry;
-	HASHCTL		hash_ctl;
-	HTAB	   *dbhash;
-	HTAB	   *tabhash = NULL;
-	HTAB	   *funchash = NULL;
+	PgStat_SharedFuncEntry funcbuf;
+	PgStat_GlobalStats gstats;
 	FILE	   *fpin;
 	int32		format_id;
-	bool		found;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
-
-	/*
-	 * The tables will live in pgStatLocalContext.
-	 */
-	pgstat_setup_memcxt();
-
-	/*
-	 * Create the DB hashtable
-	 */
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
-	hash_ctl.hash = oid_hash;
-	hash_ctl.hcxt = pgStatLocalContext;
-	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
-						 HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
-
-	/*
-	 * Clear out global statistics so they start from zero in case we can't
-	 * load an existing statsfile.
-	 */
-	memset(&globalStats, 0, sizeof(globalStats));
-
-	/*
-	 * Set the current timestamp (will be kept only in case we can't load an
-	 * existing statsfile.
-	 */
-	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
+	uint32		hashcode;
+	LWLockId	partitionLock;
+	const char *statfile = PGSTAT_STAT_PERMANENT_FILENAME;
 
 	/*
-	 * Try to open the status file. If it doesn't exist, the backends simply
-	 * return zero for anything and the collector simply starts from scratch
-	 * with empty counters.
-	 *
-	 * ENOENT is a possibility if the stats collector is not running or has
-	 * not yet written the stats file the first time.  Any other failure
-	 * condition is suspicious.
+	 * Try to open the status file. If it doesn't exist, we simply start from
+	 * scratch with empty counters.  Any failure other than ENOENT is
+	 * suspicious.
 	 */
 	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
 	{
 		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
+			ereport(LOG,
 					(errcode_for_file_access(),
 					 errmsg("could not open statistics file \"%s\": %m",
 							statfile)));
-		return dbhash;
+		return;
 	}
 
 	/*
@@ -3584,7 +3296,7 @@ pgstat_read_statsfile(Oid onlydb, bool permanent)
 	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id)
 		|| format_id != PGSTAT_FILE_FORMAT_ID)
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
+		ereport(LOG,
 				(errmsg("corrupted statistics file \"%s\"", statfile)));
 		goto done;
 	}
@@ -3592,16 +3304,20 @@ pgstat_read_statsfile(Oid onlydb, bool permanent)
 	/*
 	 * Read global stats struct
 	 */
-	if (fread(&globalStats, 1, sizeof(globalStats), fpin) != sizeof(globalStats))
+	if (fread(&gstats, 1, sizeof(gstats), fpin) != sizeof(gstats))
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
+		ereport(LOG,
 				(errmsg("corrupted statistics file \"%s\"", statfile)));
 		goto done;
 	}
 
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+	memcpy(&pgStatShmem->globalStats, &gstats, sizeof(gstats));
+	LWLockRelease(PgStatDBLock);
+
 	/*
-	 * We found an existing collector stats file. Read it and put all the
-	 * hashtable entries into place.
+	 * We found an existing stats file. Read it and put all the hashtable
+	 * entries into place.
 	 */
 	for (;;)
 	{
@@ -3609,150 +3325,74 @@ pgstat_read_statsfile(Oid onlydb, bool permanent)
 		{
 				/*
 				 * 'D'	A PgStat_StatDBEntry struct describing a database
-				 * follows. Subsequently, zero to many 'T' and 'F' entries
-				 * will follow until a 'd' is encountered.
-				 */
-			case 'D':
-				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
-						  fpin) != offsetof(PgStat_StatDBEntry, tables))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Add to the DB hash
-				 */
-				dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
-												  (void *) &dbbuf.databaseid,
-															 HASH_ENTER,
-															 &found);
-				if (found)
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				memcpy(dbentry, &dbbuf, sizeof(PgStat_StatDBEntry));
-				dbentry->tables = NULL;
-				dbentry->functions = NULL;
-
-				/*
-				 * Don't collect tables if not the requested DB (or the
-				 * shared-table info)
-				 */
-				if (onlydb != InvalidOid)
-				{
-					if (dbbuf.databaseid != onlydb &&
-						dbbuf.databaseid != InvalidOid)
-						break;
-				}
-
-				memset(&hash_ctl, 0, sizeof(hash_ctl));
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-				hash_ctl.hash = oid_hash;
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->tables = hash_create("Per-database table",
-											  PGSTAT_TAB_HASH_SIZE,
-											  &hash_ctl,
-								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
-
-				hash_ctl.keysize = sizeof(Oid);
-				hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-				hash_ctl.hash = oid_hash;
-				hash_ctl.hcxt = pgStatLocalContext;
-				dbentry->functions = hash_create("Per-database function",
-												 PGSTAT_FUNCTION_HASH_SIZE,
-												 &hash_ctl,
-								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
-
-				/*
-				 * Arrange that following records add entries to this
-				 * database's hash tables.
-				 */
-				tabhash = dbentry->tables;
-				funchash = dbentry->functions;
-				break;
-
-				/*
-				 * 'd'	End of this database.
-				 */
-			case 'd':
-				tabhash = NULL;
-				funchash = NULL;
-				break;
-
-				/*
-				 * 'T'	A PgStat_StatTabEntry follows.
-				 */
-			case 'T':
-				if (fread(&tabbuf, 1, sizeof(PgStat_StatTabEntry),
-						  fpin) != sizeof(PgStat_StatTabEntry))
-				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
-							(errmsg("corrupted statistics file \"%s\"",
-									statfile)));
-					goto done;
-				}
-
-				/*
-				 * Skip if table belongs to a not requested database.
+				 * follows.
 				 */
-				if (tabhash == NULL)
-					break;
-
-				tabentry = (PgStat_StatTabEntry *) hash_search(tabhash,
-													(void *) &tabbuf.tableid,
-														 HASH_ENTER, &found);
-
-				if (found)
+			case 'D':
+				if (fread(&dbbuf, 1, offsetof(PgStat_StatDBEntry, tables),
+						  fpin) != offsetof(PgStat_StatDBEntry, tables))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
+					ereport(LOG,
 							(errmsg("corrupted statistics file \"%s\"",
 									statfile)));
 					goto done;
 				}
 
-				memcpy(tabentry, &tabbuf, sizeof(tabbuf));
+				LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+				dbentry = pgstat_get_db_entry(dbbuf.databaseid, true);
+				if (dbentry != NULL)
+					memcpy(dbentry, &dbbuf,
+						   offsetof(PgStat_StatDBEntry, tables));
+				LWLockRelease(PgStatDBLock);
 				break;
 
 				/*
-				 * 'F'	A PgStat_StatFuncEntry follows.
+				 * 'T'	A PgStat_SharedTabEntry follows.
 				 */
-			case 'F':
-				if (fread(&funcbuf, 1, sizeof(PgStat_StatFuncEntry),
-						  fpin) != sizeof(PgStat_StatFuncEntry))
+			case 'T':
+				if (fread(&tabbuf, 1, sizeof(PgStat_SharedTabEntry),
+						  fpin) != sizeof(PgStat_SharedTabEntry))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
+					ereport(LOG,
 							(errmsg("corrupted statistics file \"%s\"",
 									statfile)));
 					goto done;
 				}
 
-				/*
-				 * Skip if function belongs to a not requested database.
-				 */
-				if (funchash == NULL)
-					break;
+				hashcode = get_hash_value(pgStatSharedTabHash,
+										  (void *) &tabbuf.key);
+				partitionLock = PgStatPartitionLock(hashcode);
 
-				funcentry = (PgStat_StatFuncEntry *) hash_search(funchash,
-												(void *) &funcbuf.functionid,
-														 HASH_ENTER, &found);
+				LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+				tabentry = pgstat_get_tab_entry(&tabbuf.key, hashcode, true);
+				if (tabentry != NULL)
+					memcpy(tabentry, &tabbuf.stats,
+						   sizeof(PgStat_StatTabEntry));
+				LWLockRelease(partitionLock);
+				break;
 
-				if (found)
+				/*
+				 * 'F'	A PgStat_SharedFuncEntry follows.
+				 */
+			case 'F':
+				if (fread(&funcbuf, 1, sizeof(PgStat_SharedFuncEntry),
+						  fpin) != sizeof(PgStat_SharedFuncEntry))
 				{
-					ereport(pgStatRunningInCollector ? LOG : WARNING,
+					ereport(LOG,
 							(errmsg("corrupted statistics file \"%s\"",
 									statfile)));
 					goto done;
 				}
 
-				memcpy(funcentry, &funcbuf, sizeof(funcbuf));
+				hashcode = get_hash_value(pgStatSharedFuncHash,
+										  (void *) &funcbuf.key);
+				partitionLock = PgStatPartitionLock(hashcode);
+
+				LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+				funcentry = pgstat_get_func_entry(&funcbuf.key, hashcode, true);
+				if (funcentry != NULL)
+					memcpy(funcentry, &funcbuf.stats,
+						   sizeof(PgStat_StatFuncEntry));
+				LWLockRelease(partitionLock);
 				break;
 
 				/*
@@ -3762,7 +3402,7 @@ pgstat_read_statsfile(Oid onlydb, bool permanent)
 				goto done;
 
 			default:
-				ereport(pgStatRunningInCollector ? LOG : WARNING,
+				ereport(LOG,
 						(errmsg("corrupted statistics file \"%s\"",
 								statfile)));
 				goto done;
@@ -3772,137 +3412,187 @@ pgstat_read_statsfile(Oid onlydb, bool permanent)
 done:
 	FreeFile(fpin);
 
-	if (permanent)
-		unlink(PGSTAT_STAT_PERMANENT_FILENAME);
-
-	return dbhash;
+	unlink(statfile);
 }
 
-/* ----------
- * pgstat_read_statsfile_timestamp() -
+
+/*
+ * If not already done, copy the shared statistics into some local hash
+ * tables.  The results will be kept until pgstat_clear_snapshot() is called
+ * (typically, at end of transaction).
  *
- *	Attempt to fetch the timestamp of an existing stats file.
- *	Returns TRUE if successful (timestamp is stored at *ts).
- * ----------
+ * Only the cluster-wide stats and the database entries are copied here.
+ * The table and function entries are copied separately, on demand, by
+ * backend_read_db_objects.
  */
-static bool
-pgstat_read_statsfile_timestamp(bool permanent, TimestampTz *ts)
+static void
+backend_read_stats(void)
 {
-	PgStat_GlobalStats myGlobalStats;
-	FILE	   *fpin;
-	int32		format_id;
-	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
+	HASHCTL		hash_ctl;
+	HASH_SEQ_STATUS hstat;
+	HTAB	   *dbhash;
+	PgStat_StatDBEntry *shdbentry;
+	PgStat_StatDBEntry *dbentry;
+
+	/* already done it? */
+	if (pgStatDBHash)
+		return;
 
 	/*
-	 * Try to open the status file.  As above, anything but ENOENT is worthy
-	 * of complaining about.
+	 * The tables will live in pgStatLocalContext.
 	 */
-	if ((fpin = AllocateFile(statfile, PG_BINARY_R)) == NULL)
-	{
-		if (errno != ENOENT)
-			ereport(pgStatRunningInCollector ? LOG : WARNING,
-					(errcode_for_file_access(),
-					 errmsg("could not open statistics file \"%s\": %m",
-							statfile)));
-		return false;
-	}
+	pgstat_setup_memcxt();
 
 	/*
-	 * Verify it's of the expected format.
+	 * Create the DB hashtable
 	 */
-	if (fread(&format_id, 1, sizeof(format_id), fpin) != sizeof(format_id)
-		|| format_id != PGSTAT_FILE_FORMAT_ID)
-	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
-	}
+	memset(&hash_ctl, 0, sizeof(hash_ctl));
+	hash_ctl.keysize = sizeof(Oid);
+	hash_ctl.entrysize = sizeof(PgStat_StatDBEntry);
+	hash_ctl.hash = oid_hash;
+	hash_ctl.hcxt = pgStatLocalContext;
+	dbhash = hash_create("Databases hash", PGSTAT_DB_HASH_SIZE, &hash_ctl,
+						 HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
 
 	/*
-	 * Read global stats struct
+	 * Copy the cluster-wide stats and the database entries.
 	 */
-	if (fread(&myGlobalStats, 1, sizeof(myGlobalStats), fpin) != sizeof(myGlobalStats))
+	LWLockAcquire(PgStatDBLock, LW_SHARED);
+
+	memcpy(&globalStats, &pgStatShmem->globalStats, sizeof(globalStats));
+
+	hash_seq_init(&hstat, pgStatSharedDBHash);
+	while ((shdbentry = (PgStat_StatDBEntry *) hash_seq_search(&hstat)) != NULL)
 	{
-		ereport(pgStatRunningInCollector ? LOG : WARNING,
-				(errmsg("corrupted statistics file \"%s\"", statfile)));
-		FreeFile(fpin);
-		return false;
+		dbentry = (PgStat_StatDBEntry *) hash_search(dbhash,
+											  (void *) &shdbentry->databaseid,
+													 HASH_ENTER, NULL);
+		memcpy(dbentry, shdbentry, sizeof(PgStat_StatDBEntry));
+		dbentry->tables = NULL;
+		dbentry->functions = NULL;
 	}
 
-	*ts = myGlobalStats.stats_timestamp;
+	LWLockRelease(PgStatDBLock);
 
-	FreeFile(fpin);
-	return true;
+	/* Only now is the snapshot complete */
+	pgStatDBHash = dbhash;
 }
 
+
 /*
- * If not already done, read the statistics collector stats file into
- * some hash tables.  The results will be kept until pgstat_clear_snapshot()
- * is called (typically, at end of transaction).
+ * If not already done, copy the table and function entries of our own
+ * database and of the shared catalogs into the snapshot.  Entries of other
+ * databases are never needed: the autovacuum launcher, which looks at all
+ * databases, only uses the database entries.
+ *
+ * Keeping this apart from backend_read_stats means that processes which
+ * only look at database-level stats don't have to copy the per-table data,
+ * which is most of the data on clusters with many tables.  The price is
+ * that the objects are copied a little later than the database entries,
+ * so they're not quite consistent with each other.
  */
 static void
-backend_read_statsfile(void)
+backend_read_db_objects(void)
 {
-	TimestampTz cur_ts;
-	TimestampTz min_ts;
-	int			count;
+	HASHCTL		hash_ctl;
+	HASH_SEQ_STATUS hstat;
+	Oid			dbids[2];
+	PgStat_StatDBEntry *dbentries[2];
+	int			ndbs;
+	PgStat_StatDBEntry *dbentry;
+	PgStat_SharedTabEntry *shtabentry;
+	PgStat_StatTabEntry *tabentry;
+	PgStat_SharedFuncEntry *shfuncentry;
+	PgStat_StatFuncEntry *funcentry;
+	int			i;
 
-	/* already read it? */
-	if (pgStatDBHash)
+	backend_read_stats();
+
+	/* already done it? */
+	if (pgStatObjectsRead)
 		return;
-	Assert(!pgStatRunningInCollector);
 
 	/*
-	 * We set the minimum acceptable timestamp to PGSTAT_STAT_INTERVAL msec
-	 * before now.	This indirectly ensures that the collector needn't write
-	 * the file more often than PGSTAT_STAT_INTERVAL.  In an autovacuum
-	 * worker, however, we want a lower delay to avoid using stale data, so we
-	 * use PGSTAT_RETRY_DELAY (since the number of worker is low, this
-	 * shouldn't be a problem).
-	 *
-	 * Note that we don't recompute min_ts after sleeping; so we might end up
-	 * accepting a file a bit older than PGSTAT_STAT_INTERVAL.	In practice
-	 * that shouldn't happen, though, as long as the sleep time is less than
-	 * PGSTAT_STAT_INTERVAL; and we don't want to lie to the collector about
-	 * what our cutoff time really is.
+	 * Set up the tables and functions hashes of the wanted databases.  If a
+	 * database has no entry, it has no tables or functions either.
 	 */
-	cur_ts = GetCurrentTimestamp();
-	if (IsAutoVacuumWorkerProcess())
-		min_ts = TimestampTzPlusMilliseconds(cur_ts, -PGSTAT_RETRY_DELAY);
-	else
-		min_ts = TimestampTzPlusMilliseconds(cur_ts, -PGSTAT_STAT_INTERVAL);
+	dbids[0] = InvalidOid;
+	dbids[1] = MyDatabaseId;
+	ndbs = OidIsValid(MyDatabaseId) ? 2 : 1;
+
+	for (i = 0; i < ndbs; i++)
+	{
+		dbentry = (PgStat_StatDBEntry *) hash_search(pgStatDBHash,
+													 (void *) &dbids[i],
+													 HASH_FIND, NULL);
+		dbentries[i] = dbentry;
+		if (dbentry == NULL)
+			continue;
+
+		memset(&hash_ctl, 0, sizeof(hash_ctl));
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
+		hash_ctl.hash = oid_hash;
+		hash_ctl.hcxt = pgStatLocalContext;
+		dbentry->tables = hash_create("Per-database table",
+									  PGSTAT_TAB_HASH_SIZE,
+									  &hash_ctl,
+								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+
+		hash_ctl.keysize = sizeof(Oid);
+		hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
+		hash_ctl.hash = oid_hash;
+		hash_ctl.hcxt = pgStatLocalContext;
+		dbentry->functions = hash_create("Per-database function",
+										 PGSTAT_FUNCTION_HASH_SIZE,
+										 &hash_ctl,
+								   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+	}
 
 	/*
-	 * Loop until fresh enough stats file is available or we ran out of time.
-	 * The stats inquiry message is sent repeatedly in case collector drops
-	 * it; but not every single time, as that just swamps the collector.
+	 * Now copy the table and function entries of those databases.
 	 */
-	for (count = 0; count < PGSTAT_POLL_LOOP_COUNT; count++)
-	{
-		TimestampTz file_ts = 0;
+	for (i = 0; i < NUM_PGSTAT_PARTITIONS; i++)
+		LWLockAcquire(FirstPgStatLock + i, LW_SHARED);
 
-		CHECK_FOR_INTERRUPTS();
+	hash_seq_init(&hstat, pgStatSharedTabHash);
+	while ((shtabentry = (PgStat_SharedTabEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		for (i = 0; i < ndbs; i++)
+		{
+			if (shtabentry->key.databaseid == dbids[i])
+				break;
+		}
+		if (i >= ndbs || dbentries[i] == NULL)
+			continue;
 
-		if (pgstat_read_statsfile_timestamp(false, &file_ts) &&
-			file_ts >= min_ts)
-			break;
+		tabentry = (PgStat_StatTabEntry *) hash_search(dbentries[i]->tables,
+										 (void *) &shtabentry->key.objectid,
+													   HASH_ENTER, NULL);
+		memcpy(tabentry, &shtabentry->stats, sizeof(PgStat_StatTabEntry));
+	}
 
-		/* Not there or too old, so kick the collector and wait a bit */
-		if ((count % PGSTAT_INQ_LOOP_COUNT) == 0)
-			pgstat_send_inquiry(min_ts);
+	hash_seq_init(&hstat, pgStatSharedFuncHash);
+	while ((shfuncentry = (PgStat_SharedFuncEntry *) hash_seq_search(&hstat)) != NULL)
+	{
+		for (i = 0; i < ndbs; i++)
+		{
+			if (shfuncentry->key.databaseid == dbids[i])
+				break;
+		}
+		if (i >= ndbs || dbentries[i] == NULL)
+			continue;
 
-		pg_usleep(PGSTAT_RETRY_DELAY * 1000L);
+		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentries[i]->functions,
+										(void *) &shfuncentry->key.objectid,
+														 HASH_ENTER, NULL);
+		memcpy(funcentry, &shfuncentry->stats, sizeof(PgStat_StatFuncEntry));
 	}
 
-	if (count >= PGSTAT_POLL_LOOP_COUNT)
-		elog(WARNING, "pgstat wait timeout");
+	for (i = NUM_PGSTAT_PARTITIONS; --i >= 0;)
+		LWLockRelease(FirstPgStatLock + i);
 
-	/* Autovacuum launcher wants stats about all databases */
-	if (IsAutoVacuumLauncherProcess())
-		pgStatDBHash = pgstat_read_statsfile(InvalidOid, false);
-	else
-		pgStatDBHash = pgstat_read_statsfile(MyDatabaseId, false);
+	pgStatObjectsRead = true;
 }
 
 
@@ -3944,25 +3634,12 @@ pgstat_clear_snapshot(void)
 	/* Reset variables */
 	pgStatLocalContext = NULL;
 	pgStatDBHash = NULL;
+	pgStatObjectsRead = false;
 	localBackendStatusTable = NULL;
 	localNumBackends = 0;
 }
 
 
-/* ----------
- * pgstat_recv_inquiry() -
- *
- *	Process stat inquiry requests.
- * ----------
- */
-static void
-pgstat_recv_inquiry(PgStat_MsgInquiry *msg, int len)
-{
-	if (msg->inquiry_time > last_statrequest)
-		last_statrequest = msg->inquiry_time;
-}
-
-
 /* ----------
  * pgstat_recv_tabstat() -
  *
@@ -3974,61 +3651,72 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_TableCounts dbcounts;
+	PgStat_ObjectKey key;
 	int			i;
-	bool		found;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	/*
+	 * Add up the per-table stats for the per-database entry, so that we only
+	 * need to visit that once.
+	 */
+	MemSet(&dbcounts, 0, sizeof(dbcounts));
+	for (i = 0; i < msg->m_nentries; i++)
+	{
+		PgStat_TableCounts *counts = &(msg->m_entry[i].t_counts);
+
+		dbcounts.t_tuples_returned += counts->t_tuples_returned;
+		dbcounts.t_tuples_fetched += counts->t_tuples_fetched;
+		dbcounts.t_tuples_inserted += counts->t_tuples_inserted;
+		dbcounts.t_tuples_updated += counts->t_tuples_updated;
+		dbcounts.t_tuples_deleted += counts->t_tuples_deleted;
+		dbcounts.t_blocks_fetched += counts->t_blocks_fetched;
+		dbcounts.t_blocks_hit += counts->t_blocks_hit;
+	}
 
 	/*
 	 * Update database-wide stats.
 	 */
-	dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
-	dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+	{
+		dbentry->n_xact_commit += (PgStat_Counter) (msg->m_xact_commit);
+		dbentry->n_xact_rollback += (PgStat_Counter) (msg->m_xact_rollback);
+		dbentry->n_block_read_time += msg->m_block_read_time;
+		dbentry->n_block_write_time += msg->m_block_write_time;
+		dbentry->n_ssl_handshakes += msg->m_ssl_handshakes;
+		dbentry->n_ssl_resumptions += msg->m_ssl_resumptions;
+		dbentry->n_tuples_returned += dbcounts.t_tuples_returned;
+		dbentry->n_tuples_fetched += dbcounts.t_tuples_fetched;
+		dbentry->n_tuples_inserted += dbcounts.t_tuples_inserted;
+		dbentry->n_tuples_updated += dbcounts.t_tuples_updated;
+		dbentry->n_tuples_deleted += dbcounts.t_tuples_deleted;
+		dbentry->n_blocks_fetched += dbcounts.t_blocks_fetched;
+		dbentry->n_blocks_hit += dbcounts.t_blocks_hit;
+	}
+
+	LWLockRelease(PgStatDBLock);
 
 	/*
 	 * Process all table entries in the message.
 	 */
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++)
 	{
 		PgStat_TableEntry *tabmsg = &(msg->m_entry[i]);
+		uint32		hashcode;
+		LWLockId	partitionLock;
 
-		tabentry = (PgStat_StatTabEntry *) hash_search(dbentry->tables,
-													(void *) &(tabmsg->t_id),
-													   HASH_ENTER, &found);
+		key.objectid = tabmsg->t_id;
+		hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
 
-		if (!found)
-		{
-			/*
-			 * If it's a new table entry, initialize counters to the values we
-			 * just got.
-			 */
-			tabentry->numscans = tabmsg->t_counts.t_numscans;
-			tabentry->tuples_returned = tabmsg->t_counts.t_tuples_returned;
-			tabentry->tuples_fetched = tabmsg->t_counts.t_tuples_fetched;
-			tabentry->tuples_inserted = tabmsg->t_counts.t_tuples_inserted;
-			tabentry->tuples_updated = tabmsg->t_counts.t_tuples_updated;
-			tabentry->tuples_deleted = tabmsg->t_counts.t_tuples_deleted;
-			tabentry->tuples_hot_updated = tabmsg->t_counts.t_tuples_hot_updated;
-			tabentry->n_live_tuples = tabmsg->t_counts.t_delta_live_tuples;
-			tabentry->n_dead_tuples = tabmsg->t_counts.t_delta_dead_tuples;
-			tabentry->changes_since_analyze = tabmsg->t_counts.t_changed_tuples;
-			tabentry->blocks_fetched = tabmsg->t_counts.t_blocks_fetched;
-			tabentry->blocks_hit = tabmsg->t_counts.t_blocks_hit;
-
-			tabentry->vacuum_timestamp = 0;
-			tabentry->vacuum_count = 0;
-			tabentry->autovac_vacuum_timestamp = 0;
-			tabentry->autovac_vacuum_count = 0;
-			tabentry->analyze_timestamp = 0;
-			tabentry->analyze_count = 0;
-			tabentry->autovac_analyze_timestamp = 0;
-			tabentry->autovac_analyze_count = 0;
-		}
-		else
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+		tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+		if (tabentry != NULL)
 		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
 			tabentry->numscans += tabmsg->t_counts.t_numscans;
 			tabentry->tuples_returned += tabmsg->t_counts.t_tuples_returned;
 			tabentry->tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
@@ -4039,25 +3727,17 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 			tabentry->n_live_tuples += tabmsg->t_counts.t_delta_live_tuples;
 			tabentry->n_dead_tuples += tabmsg->t_counts.t_delta_dead_tuples;
 			tabentry->changes_since_analyze += tabmsg->t_counts.t_changed_tuples;
+			tabentry->inserts_since_vacuum += tabmsg->t_counts.t_tuples_inserted;
 			tabentry->blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
 			tabentry->blocks_hit += tabmsg->t_counts.t_blocks_hit;
-		}
 
-		/* Clamp n_live_tuples in case of negative delta_live_tuples */
-		tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
-		/* Likewise for n_dead_tuples */
-		tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+			/* Clamp n_live_tuples in case of negative delta_live_tuples */
+			tabentry->n_live_tuples = Max(tabentry->n_live_tuples, 0);
+			/* Likewise for n_dead_tuples */
+			tabentry->n_dead_tuples = Max(tabentry->n_dead_tuples, 0);
+		}
 
-		/*
-		 * Add per-table stats to the per-database entry, too.
-		 */
-		dbentry->n_tuples_returned += tabmsg->t_counts.t_tuples_returned;
-		dbentry->n_tuples_fetched += tabmsg->t_counts.t_tuples_fetched;
-		dbentry->n_tuples_inserted += tabmsg->t_counts.t_tuples_inserted;
-		dbentry->n_tuples_updated += tabmsg->t_counts.t_tuples_updated;
-		dbentry->n_tuples_deleted += tabmsg->t_counts.t_tuples_deleted;
-		dbentry->n_blocks_fetched += tabmsg->t_counts.t_blocks_fetched;
-		dbentry->n_blocks_hit += tabmsg->t_counts.t_blocks_hit;
+		LWLockRelease(partitionLock);
 	}
 }
 
@@ -4071,26 +3751,28 @@ pgstat_recv_tabstat(PgStat_MsgTabstat *msg, int len)
 static void
 pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_ObjectKey key;
 	int			i;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->tables)
-		return;
-
 	/*
 	 * Process all table entries in the message.
 	 */
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++)
 	{
+		uint32		hashcode;
+		LWLockId	partitionLock;
+
+		key.objectid = msg->m_tableid[i];
+		hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
+
 		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->tables,
-						   (void *) &(msg->m_tableid[i]),
-						   HASH_REMOVE, NULL);
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		(void) hash_search_with_hash_value(pgStatSharedTabHash,
+										   (void *) &key, hashcode,
+										   HASH_REMOVE, NULL);
+		LWLockRelease(partitionLock);
 	}
 }
 
@@ -4104,30 +3786,17 @@ pgstat_recv_tabpurge(PgStat_MsgTabpurge *msg, int len)
 static void
 pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
-
 	/*
-	 * Lookup the database in the hashtable.
+	 * Remove the database entry, if any, and then all its tables and
+	 * functions.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+	(void) hash_search(pgStatSharedDBHash,
+					   (void *) &(msg->m_databaseid),
+					   HASH_REMOVE, NULL);
+	LWLockRelease(PgStatDBLock);
 
-	/*
-	 * If found, remove it.
-	 */
-	if (dbentry)
-	{
-		if (dbentry->tables != NULL)
-			hash_destroy(dbentry->tables);
-		if (dbentry->functions != NULL)
-			hash_destroy(dbentry->functions);
-
-		if (hash_search(pgStatDBHash,
-						(void *) &(dbentry->databaseid),
-						HASH_REMOVE, NULL) == NULL)
-			ereport(ERROR,
-					(errmsg("database hash table corrupted "
-							"during cleanup --- abort")));
-	}
+	pgstat_remove_db_objects(msg->m_databaseid);
 }
 
 
@@ -4140,31 +3809,23 @@ pgstat_recv_dropdb(PgStat_MsgDropdb *msg, int len)
 static void
 pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 {
-	HASHCTL		hash_ctl;
 	PgStat_StatDBEntry *dbentry;
 
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
 	/*
 	 * Lookup the database in the hashtable.  Nothing to do if not there.
 	 */
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
 
 	if (!dbentry)
+	{
+		LWLockRelease(PgStatDBLock);
 		return;
+	}
 
 	/*
-	 * We simply throw away all the database's table entries by recreating a
-	 * new hash table for them.
-	 */
-	if (dbentry->tables != NULL)
-		hash_destroy(dbentry->tables);
-	if (dbentry->functions != NULL)
-		hash_destroy(dbentry->functions);
-
-	dbentry->tables = NULL;
-	dbentry->functions = NULL;
-
-	/*
-	 * Reset database-level stats too.	This should match the initialization
+	 * Reset database-level stats.  This should match the initialization
 	 * code in pgstat_get_db_entry().
 	 */
 	dbentry->n_xact_commit = 0;
@@ -4177,25 +3838,21 @@ pgstat_recv_resetcounter(PgStat_MsgResetcounter *msg, int len)
 	dbentry->n_tuples_updated = 0;
 	dbentry->n_tuples_deleted = 0;
 	dbentry->last_autovac_time = 0;
+	dbentry->n_temp_files = 0;
+	dbentry->n_temp_bytes = 0;
+	dbentry->n_block_read_time = 0;
+	dbentry->n_block_write_time = 0;
+	dbentry->n_ssl_handshakes = 0;
+	dbentry->n_ssl_resumptions = 0;
 
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 
-	memset(&hash_ctl, 0, sizeof(hash_ctl));
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatTabEntry);
-	hash_ctl.hash = oid_hash;
-	dbentry->tables = hash_create("Per-database table",
-								  PGSTAT_TAB_HASH_SIZE,
-								  &hash_ctl,
-								  HASH_ELEM | HASH_FUNCTION);
+	LWLockRelease(PgStatDBLock);
 
-	hash_ctl.keysize = sizeof(Oid);
-	hash_ctl.entrysize = sizeof(PgStat_StatFuncEntry);
-	hash_ctl.hash = oid_hash;
-	dbentry->functions = hash_create("Per-database function",
-									 PGSTAT_FUNCTION_HASH_SIZE,
-									 &hash_ctl,
-									 HASH_ELEM | HASH_FUNCTION);
+	/*
+	 * We simply throw away all the database's table and function entries.
+	 */
+	pgstat_remove_db_objects(msg->m_databaseid);
 }
 
 /* ----------
@@ -4210,8 +3867,10 @@ pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 	if (msg->m_resettarget == RESET_BGWRITER)
 	{
 		/* Reset the global background writer statistics for the cluster. */
-		memset(&globalStats, 0, sizeof(globalStats));
-		globalStats.stat_reset_timestamp = GetCurrentTimestamp();
+		LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+		memset(&pgStatShmem->globalStats, 0, sizeof(PgStat_GlobalStats));
+		pgStatShmem->globalStats.stat_reset_timestamp = GetCurrentTimestamp();
+		LWLockRelease(PgStatDBLock);
 	}
 
 	/*
@@ -4230,22 +3889,43 @@ static void
 pgstat_recv_resetsinglecounter(PgStat_MsgResetsinglecounter *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
+	PgStat_ObjectKey key;
+	HTAB	   *htab;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
 
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
 
 	if (!dbentry)
+	{
+		LWLockRelease(PgStatDBLock);
 		return;
+	}
 
 	/* Set the reset timestamp for the whole database */
 	dbentry->stat_reset_timestamp = GetCurrentTimestamp();
 
-	/* Remove object if it exists, ignore it if not */
+	LWLockRelease(PgStatDBLock);
+
 	if (msg->m_resettype == RESET_TABLE)
-		(void) hash_search(dbentry->tables, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
+		htab = pgStatSharedTabHash;
 	else if (msg->m_resettype == RESET_FUNCTION)
-		(void) hash_search(dbentry->functions, (void *) &(msg->m_objectid),
-						   HASH_REMOVE, NULL);
+		htab = pgStatSharedFuncHash;
+	else
+		return;
+
+	/* Remove object if it exists, ignore it if not */
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_objectid;
+	hashcode = get_hash_value(htab, (void *) &key);
+	partitionLock = PgStatPartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	(void) hash_search_with_hash_value(htab, (void *) &key, hashcode,
+									   HASH_REMOVE, NULL);
+	LWLockRelease(partitionLock);
 }
 
 /* ----------
@@ -4262,9 +3942,13 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 	/*
 	 * Store the last autovacuum time in the database's hashtable entry.
 	 */
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry != NULL)
+		dbentry->last_autovac_time = msg->m_start_time;
 
-	dbentry->last_autovac_time = msg->m_start_time;
+	LWLockRelease(PgStatDBLock);
 }
 
 /* ----------
@@ -4276,30 +3960,45 @@ pgstat_recv_autovac(PgStat_MsgAutovacStart *msg, int len)
 static void
 pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_ObjectKey key;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+
+	pgstat_ensure_db_entry(msg->m_databaseid);
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
-
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_tableoid;
+	hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+	partitionLock = PgStatPartitionLock(hashcode);
 
-	tabentry->n_live_tuples = msg->m_tuples;
-	/* Resetting dead_tuples to 0 is an approximation ... */
-	tabentry->n_dead_tuples = 0;
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
 
-	if (msg->m_autovacuum)
+	tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+	if (tabentry != NULL)
 	{
-		tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->autovac_vacuum_count++;
-	}
-	else
-	{
-		tabentry->vacuum_timestamp = msg->m_vacuumtime;
-		tabentry->vacuum_count++;
+		tabentry->n_live_tuples = msg->m_tuples;
+		/* Resetting dead_tuples to 0 is an approximation ... */
+		tabentry->n_dead_tuples = 0;
+		/* ... and so is forgetting inserts made while VACUUM ran */
+		tabentry->inserts_since_vacuum = 0;
+
+		if (msg->m_autovacuum)
+		{
+			tabentry->autovac_vacuum_timestamp = msg->m_vacuumtime;
+			tabentry->autovac_vacuum_count++;
+		}
+		else
+		{
+			tabentry->vacuum_timestamp = msg->m_vacuumtime;
+			tabentry->vacuum_count++;
+		}
 	}
+
+	LWLockRelease(partitionLock);
 }
 
 /* ----------
@@ -4311,35 +4010,48 @@ pgstat_recv_vacuum(PgStat_MsgVacuum *msg, int len)
 static void
 pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatTabEntry *tabentry;
+	PgStat_ObjectKey key;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+
+	pgstat_ensure_db_entry(msg->m_databaseid);
 
 	/*
 	 * Store the data in the table's hashtable entry.
 	 */
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	key.databaseid = msg->m_databaseid;
+	key.objectid = msg->m_tableoid;
+	hashcode = get_hash_value(pgStatSharedTabHash, (void *) &key);
+	partitionLock = PgStatPartitionLock(hashcode);
 
-	tabentry = pgstat_get_tab_entry(dbentry, msg->m_tableoid, true);
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
 
-	tabentry->n_live_tuples = msg->m_live_tuples;
-	tabentry->n_dead_tuples = msg->m_dead_tuples;
+	tabentry = pgstat_get_tab_entry(&key, hashcode, true);
+	if (tabentry != NULL)
+	{
+		tabentry->n_live_tuples = msg->m_live_tuples;
+		tabentry->n_dead_tuples = msg->m_dead_tuples;
 
-	/*
-	 * We reset changes_since_analyze to zero, forgetting any changes that
-	 * occurred while the ANALYZE was in progress.
-	 */
-	tabentry->changes_since_analyze = 0;
+		/*
+		 * We reset changes_since_analyze to zero, forgetting any changes
+		 * that occurred while the ANALYZE was in progress.
+		 */
+		tabentry->changes_since_analyze = 0;
 
-	if (msg->m_autovacuum)
-	{
-		tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
-		tabentry->autovac_analyze_count++;
-	}
-	else
-	{
-		tabentry->analyze_timestamp = msg->m_analyzetime;
-		tabentry->analyze_count++;
+		if (msg->m_autovacuum)
+		{
+			tabentry->autovac_analyze_timestamp = msg->m_analyzetime;
+			tabentry->autovac_analyze_count++;
+		}
+		else
+		{
+			tabentry->analyze_timestamp = msg->m_analyzetime;
+			tabentry->analyze_count++;
+		}
 	}
+
+	LWLockRelease(partitionLock);
 }
 
 
@@ -4352,14 +4064,20 @@ pgstat_recv_analyze(PgStat_MsgAnalyze *msg, int len)
 static void
 pgstat_recv_bgwriter(PgStat_MsgBgWriter *msg, int len)
 {
-	globalStats.timed_checkpoints += msg->m_timed_checkpoints;
-	globalStats.requested_checkpoints += msg->m_requested_checkpoints;
-	globalStats.buf_written_checkpoints += msg->m_buf_written_checkpoints;
-	globalStats.buf_written_clean += msg->m_buf_written_clean;
-	globalStats.maxwritten_clean += msg->m_maxwritten_clean;
-	globalStats.buf_written_backend += msg->m_buf_written_backend;
-	globalStats.buf_fsync_backend += msg->m_buf_fsync_backend;
-	globalStats.buf_alloc += msg->m_buf_alloc;
+	PgStat_GlobalStats *gstats = &pgStatShmem->globalStats;
+
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
+	gstats->timed_checkpoints += msg->m_timed_checkpoints;
+	gstats->requested_checkpoints += msg->m_requested_checkpoints;
+	gstats->buf_written_checkpoints += msg->m_buf_written_checkpoints;
+	gstats->buf_written_clean += msg->m_buf_written_clean;
+	gstats->maxwritten_clean += msg->m_maxwritten_clean;
+	gstats->buf_written_backend += msg->m_buf_written_backend;
+	gstats->buf_fsync_backend += msg->m_buf_fsync_backend;
+	gstats->buf_alloc += msg->m_buf_alloc;
+
+	LWLockRelease(PgStatDBLock);
 }
 
 /* ----------
@@ -4373,7 +4091,14 @@ pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 {
 	PgStat_StatDBEntry *dbentry;
 
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
 	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry == NULL)
+	{
+		LWLockRelease(PgStatDBLock);
+		return;
+	}
 
 	switch (msg->m_reason)
 	{
@@ -4400,6 +4125,34 @@ pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len)
 			dbentry->n_conflict_startup_deadlock++;
 			break;
 	}
+
+	LWLockRelease(PgStatDBLock);
+}
+
+/* ----------
+ * pgstat_recv_tempfile() -
+ *
+ *	Process as TEMPFILE message.
+ * ----------
+ */
+static void
+pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
+{
+	PgStat_StatDBEntry *dbentry;
+
+	LWLockAcquire(PgStatDBLock, LW_EXCLUSIVE);
+
+	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	if (dbentry == NULL)
+	{
+		LWLockRelease(PgStatDBLock);
+		return;
+	}
+
+	dbentry->n_temp_bytes += msg->m_filesize;
+	dbentry->n_temp_files += 1;
+
+	LWLockRelease(PgStatDBLock);
 }
 
 /* ----------
@@ -4412,41 +4165,36 @@ static void
 pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 {
 	PgStat_FunctionEntry *funcmsg = &(msg->m_entry[0]);
-	PgStat_StatDBEntry *dbentry;
 	PgStat_StatFuncEntry *funcentry;
+	PgStat_ObjectKey key;
 	int			i;
-	bool		found;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, true);
+	pgstat_ensure_db_entry(msg->m_databaseid);
 
 	/*
 	 * Process all function entries in the message.
 	 */
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++, funcmsg++)
 	{
-		funcentry = (PgStat_StatFuncEntry *) hash_search(dbentry->functions,
-												   (void *) &(funcmsg->f_id),
-														 HASH_ENTER, &found);
+		uint32		hashcode;
+		LWLockId	partitionLock;
 
-		if (!found)
-		{
-			/*
-			 * If it's a new function entry, initialize counters to the values
-			 * we just got.
-			 */
-			funcentry->f_numcalls = funcmsg->f_numcalls;
-			funcentry->f_time = funcmsg->f_time;
-			funcentry->f_time_self = funcmsg->f_time_self;
-		}
-		else
+		key.objectid = funcmsg->f_id;
+		hashcode = get_hash_value(pgStatSharedFuncHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+
+		funcentry = pgstat_get_func_entry(&key, hashcode, true);
+		if (funcentry != NULL)
 		{
-			/*
-			 * Otherwise add the values to the existing entry.
-			 */
 			funcentry->f_numcalls += funcmsg->f_numcalls;
 			funcentry->f_time += funcmsg->f_time;
 			funcentry->f_time_self += funcmsg->f_time_self;
 		}
+
+		LWLockRelease(partitionLock);
 	}
 }
 
@@ -4459,25 +4207,27 @@ pgstat_recv_funcstat(PgStat_MsgFuncstat *msg, int len)
 static void
 pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len)
 {
-	PgStat_StatDBEntry *dbentry;
+	PgStat_ObjectKey key;
 	int			i;
 
-	dbentry = pgstat_get_db_entry(msg->m_databaseid, false);
-
-	/*
-	 * No need to purge if we don't even know the database.
-	 */
-	if (!dbentry || !dbentry->functions)
-		return;
-
 	/*
 	 * Process all function entries in the message.
 	 */
+	key.databaseid = msg->m_databaseid;
 	for (i = 0; i < msg->m_nentries; i++)
 	{
+		uint32		hashcode;
+		LWLockId	partitionLock;
+
+		key.objectid = msg->m_functionid[i];
+		hashcode = get_hash_value(pgStatSharedFuncHash, (void *) &key);
+		partitionLock = PgStatPartitionLock(hashcode);
+
 		/* Remove from hashtable if present; we don't care if it's not. */
-		(void) hash_search(dbentry->functions,
-						   (void *) &(msg->m_functionid[i]),
-						   HASH_REMOVE, NULL);
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		(void) hash_search_with_hash_value(pgStatSharedFuncHash,
+										   (void *) &key, hashcode,
+										   HASH_REMOVE, NULL);
+		LWLockRelease(partitionLock);
 	}
 }
@@ -103,9 +103,11 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/bgworker_internals.h"
 #include "postmaster/fork_process.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionproxy.h"
 #include "postmaster/syslogger.h"
 #include "replication/walsender.h"
 #include "storage/fd.h"
@@ -131,8 +133,10 @@
  * children we have and send them appropriate signals when necessary.
  *
  * "Special" children such as the startup, bgwriter and autovacuum launcher
- * tasks are not in this list.	Autovacuum worker and walsender processes are
- * in it. Also, "dead_end" children are in it: these are children launched just
+ * tasks are not in this list.	Autovacuum worker, background worker and
+ * walsender processes are in it.  (Background workers are also kept in
+ * BackgroundWorkerList, which remembers them while they aren't running.)
+ * Also, "dead_end" children are in it: these are children launched just
  * for the purpose of sending a friendly rejection message to a would-be
  * client.	We must track them because they are attached to shared memory,
  * but we know they will never become live backends.  dead_end children are
@@ -144,16 +148,36 @@ typedef struct bkend
 	long		cancel_key;		/* cancel key for cancels for this backend */
 	int			child_slot;		/* PMChildSlot for this backend, if any */
 	bool		is_autovacuum;	/* is it an autovacuum process? */
+	bool		is_bgworker;	/* is it a background worker? */
 	bool		dead_end;		/* is it going to send an error and quit? */
+	bool		prefork;		/* forked ahead of a connection it has not
+								 * been given yet? */
+	pgsocket	prefork_sock;	/* channel to pass it the connection, or
+								 * PGINVALID_SOCKET once closed */
 	Dlelem		elem;			/* list link in BackendList */
 } Backend;
 
 static Dllist *BackendList;
 
-#ifdef EXEC_BACKEND
+/*
+ * Copy of the backend list in shared memory.  Children use it to process
+ * cancel requests, since their own copy of BackendList may be out of date:
+ * it is not inherited at all by exec'd children, and backends forked ahead
+ * of their connection have been waiting since an earlier state of the list.
+ */
 static Backend *ShmemBackendArray;
+
+/*
+ * Backends can be forked ahead of their connection only if the client socket
+ * can be passed to them once it has been accepted.
+ */
+#if defined(HAVE_UNIX_SOCKETS) && !defined(EXEC_BACKEND)
+#define HAVE_PREFORK_BACKENDS 1
 #endif
 
+/* Number of backends in BackendList still waiting for a connection */
+static int	nPreforkedBackends = 0;
+
 /* The socket number we are listening for connections on */
 int			PostPortNumber;
 char	   *UnixSocketDir;
@@ -170,6 +194,13 @@ char	   *ListenAddresses;
  */
 int			ReservedBackends;
 
+/*
+ * PreforkBackends is the number of backends the postmaster keeps forked
+ * ahead of incoming connections, so that a new connection need not wait for
+ * fork().
+ */
+int			PreforkBackends = 0;
+
 /* The socket(s) we're listening to. */
 #define MAXLISTEN	64
 static pgsocket ListenSocket[MAXLISTEN];
@@ -213,7 +244,7 @@ static pid_t StartupPID = 0,
 			WalReceiverPID = 0,
 			AutoVacPID = 0,
 			PgArchPID = 0,
-			PgStatPID = 0,
+			SessionProxyPID = 0,
 			SysLoggerPID = 0;
 
 /* Startup/shutdown state */
@@ -302,6 +333,12 @@ static volatile sig_atomic_t start_autovac_launcher = false;
 /* the launcher needs to be signalled to communicate some condition */
 static volatile bool avlauncher_needs_signal = false;
 
+/*
+ * Time at which the soonest background worker waiting out its restart
+ * interval is due to be started again, or 0 if none is waiting.
+ */
+static time_t next_bgworker_start = 0;
+
 /*
  * State for assigning random salts and cancel keys.
  * Also, the global MyCancelKey passes the cancel key assigned to a given
@@ -365,12 +402,18 @@ static bool SignalSomeChildren(int signal, int targets);
 #define BACKEND_TYPE_NORMAL		0x0001	/* normal backend */
 #define BACKEND_TYPE_AUTOVAC	0x0002	/* autovacuum worker process */
 #define BACKEND_TYPE_WALSND		0x0004	/* walsender process */
-#define BACKEND_TYPE_ALL		0x0007	/* OR of all the above */
+#define BACKEND_TYPE_BGWORKER	0x0008	/* background worker process */
+#define BACKEND_TYPE_ALL		0x000F	/* OR of all the above */
 
 static int	CountChildren(int target);
 static bool CreateOptsFile(int argc, char *argv[], char *fullprogname);
 static pid_t StartChildProcess(AuxProcType type);
 static void StartAutovacuumWorker(void);
+static void MaybeStartBackgroundWorkers(void);
+static bool StartOneBackgroundWorker(RegisteredBgWorker *rw);
+static bool BackgroundWorkerShouldStartNow(BgWorkerStartTime start_time);
+static bool CleanupBackgroundWorker(int pid, int exitstatus);
+static void NotifyBackgroundWorkerRequester(RegisteredBgWorker *rw);
 static void InitPostmasterDeathWatchHandle(void);
 
 #ifdef EXEC_BACKEND
@@ -390,6 +433,7 @@ typedef struct
 #endif
 
 static pid_t backend_forkexec(Port *port);
+static pid_t bgworker_forkexec(int shmem_slot);
 static pid_t internal_forkexec(int argc, char *argv[], Port *port);
 
 /* Type for a socket that can be inherited to a client process */
@@ -432,7 +476,6 @@ typedef struct
 	PGPROC	   *AuxiliaryProcs;
 	PGPROC	   *PreparedXactProcs;
 	PMSignalData *PMSignalState;
-	InheritableSocket pgStatSock;
 	pid_t		PostmasterPid;
 	TimestampTz PgStartTime;
 	TimestampTz PgReloadTime;
@@ -461,9 +504,19 @@ static bool save_backend_variables(BackendParameters *param, Port *port,
 					   HANDLE childProcess, pid_t childPid);
 #endif
 
+#endif   /* EXEC_BACKEND */
+
 static void ShmemBackendArrayAdd(Backend *bn);
 static void ShmemBackendArrayRemove(Backend *bn);
-#endif   /* EXEC_BACKEND */
+
+#ifdef HAVE_PREFORK_BACKENDS
+static void StartPreforkedBackends(void);
+static bool StartPreforkedBackend(void);
+static void PreforkedBackendMain(pgsocket sock);
+static bool HandOffToPreforkedBackend(Port *port);
+#endif
+static void ClosePreforkChannel(Backend *bp);
+static void RetirePreforkedBackends(void);
 
 #define StartupDataBase()		StartChildProcess(StartupProcess)
 #define StartBackgroundWriter() StartChildProcess(BgWriterProcess)
@@ -760,10 +813,10 @@ PostmasterMain(int argc, char *argv[])
 	}
 	if (XLogArchiveMode && wal_level == WAL_LEVEL_MINIMAL)
 		ereport(ERROR,
-				(errmsg("WAL archival (archive_mode=on) requires wal_level \"archive\" or \"hot_standby\"")));
+				(errmsg("WAL archival (archive_mode=on) requires wal_level \"archive\", \"hot_standby\" or \"logical\"")));
 	if (max_wal_senders > 0 && wal_level == WAL_LEVEL_MINIMAL)
 		ereport(ERROR,
-				(errmsg("WAL streaming (max_wal_senders > 0) requires wal_level \"archive\" or \"hot_standby\"")));
+				(errmsg("WAL streaming (max_wal_senders > 0) requires wal_level \"archive\", \"hot_standby\" or \"logical\"")));
 
 	/*
 	 * Other one-time internal sanity checks can go here, if they are fast.
@@ -1031,8 +1084,8 @@ PostmasterMain(int argc, char *argv[])
 	 * CAUTION: when changing this list, check for side-effects on the signal
 	 * handling setup of child processes.  See tcop/postgres.c,
 	 * bootstrap/bootstrap.c, postmaster/bgwriter.c, postmaster/walwriter.c,
-	 * postmaster/autovacuum.c, postmaster/pgarch.c, postmaster/pgstat.c,
-	 * postmaster/syslogger.c and postmaster/checkpointer.c
+	 * postmaster/autovacuum.c, postmaster/pgarch.c, postmaster/syslogger.c
+	 * and postmaster/checkpointer.c
 	 */
 	pqinitmask();
 	PG_SETMASK(&BlockSig);
@@ -1054,6 +1107,12 @@ PostmasterMain(int argc, char *argv[])
 	pqsignal(SIGXFSZ, SIG_IGN); /* ignored */
 #endif
 
+	/*
+	 * Set up the channel through which backends hand sessions over to the
+	 * session proxy; it must be inherited by all of them.
+	 */
+	SessionProxyInit();
+
 	/*
 	 * If enabled, start up syslogger collection subprocess
 	 */
@@ -1068,12 +1127,6 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	whereToSendOutput = DestNone;
 
-	/*
-	 * Initialize stats collection subsystem (this does NOT start the
-	 * collector process!)
-	 */
-	pgstat_init();
-
 	/*
 	 * Initialize the autovacuum subsystem (again, no process start yet)
 	 */
@@ -1307,6 +1360,14 @@ ServerLoop(void)
 			timeout.tv_sec = 60;
 			timeout.tv_usec = 0;
 
+			/* Wake up in time to restart a background worker, though */
+			if (next_bgworker_start != 0)
+			{
+				time_t		wait = next_bgworker_start - time(NULL);
+
+				timeout.tv_sec = Min(Max(wait, 0), 60);
+			}
+
 			selres = select(nSockets, &rmask, NULL, NULL, &timeout);
 		}
 
@@ -1404,9 +1465,19 @@ ServerLoop(void)
 		if (XLogArchivingActive() && PgArchPID == 0 && pmState == PM_RUN)
 			PgArchPID = pgarch_start();
 
-		/* If we have lost the stats collector, try to start a new one */
-		if (PgStatPID == 0 && pmState == PM_RUN)
-			PgStatPID = pgstat_start();
+		/* If we have lost the session proxy, try to start a new one */
+		if (SessionPoolSize > 0 && SessionProxyPID == 0 &&
+			(pmState == PM_RUN || pmState == PM_HOT_STANDBY))
+			SessionProxyPID = StartSessionProxy();
+
+#ifdef HAVE_PREFORK_BACKENDS
+		/* Replace the pre-forked backends that connections have used up */
+		if (nPreforkedBackends < PreforkBackends)
+			StartPreforkedBackends();
+#endif
+
+		/* Start background workers that are due */
+		MaybeStartBackgroundWorkers();
 
 		/* If we need to signal the autovacuum launcher, do so now */
 		if (avlauncher_needs_signal)
@@ -1640,6 +1711,21 @@ retry1:
 							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 							 errmsg("invalid value for boolean option \"replication\"")));
 			}
+			else if (strcmp(nameptr, "compression") == 0)
+			{
+				char	   *endptr;
+				long		level = strtol(valptr, &endptr, 10);
+
+				if (*valptr == '\0' || *endptr != '\0' ||
+					level < 0 || level > 9)
+					ereport(FATAL,
+							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							 errmsg("invalid value for option \"compression\": \"%s\"",
+									valptr)));
+#ifdef HAVE_LIBZ
+				port->compression = Min((int) level, max_compression_level);
+#endif
+			}
 			else
 			{
 				/* Assume it's a generic GUC option */
@@ -1659,6 +1745,18 @@ retry1:
 			ereport(FATAL,
 					(errcode(ERRCODE_PROTOCOL_VIOLATION),
 					 errmsg("invalid startup packet layout: expected terminator as last byte")));
+
+		/*
+		 * If the client asked for compression and we allow it, say so with a
+		 * CompressionAck message.  That is the last thing sent uncompressed;
+		 * if we don't send it, the client carries on without compression.
+		 */
+		if (port->compression > 0)
+		{
+			pq_putmessage('z', "zlib", 5);
+			pq_flush();
+			pq_startcompression(port->compression);
+		}
 	}
 	else
 	{
@@ -1783,30 +1881,19 @@ processCancelRequest(Port *port, void *pkt)
 	int			backendPID;
 	long		cancelAuthCode;
 	Backend    *bp;
-
-#ifndef EXEC_BACKEND
-	Dlelem	   *curr;
-#else
 	int			i;
-#endif
 
 	backendPID = (int) ntohl(canc->backendPID);
 	cancelAuthCode = (long) ntohl(canc->cancelAuthCode);
 
 	/*
-	 * See if we have a matching backend.  In the EXEC_BACKEND case, we can no
-	 * longer access the postmaster's own backend list, and must rely on the
-	 * duplicate array in shared memory.
+	 * See if we have a matching backend.  Our own copy of the postmaster's
+	 * backend list may be stale or missing, so we must rely on the duplicate
+	 * array in shared memory.
 	 */
-#ifndef EXEC_BACKEND
-	for (curr = DLGetHead(BackendList); curr; curr = DLGetSucc(curr))
-	{
-		bp = (Backend *) DLE_VAL(curr);
-#else
 	for (i = MaxLivePostmasterChildren() - 1; i >= 0; i--)
 	{
 		bp = (Backend *) &ShmemBackendArray[i];
-#endif
 		if (bp->pid == backendPID)
 		{
 			if (bp->cancel_key == cancelAuthCode)
@@ -1994,6 +2081,24 @@ ClosePostmasterPorts(bool am_syslogger)
 		}
 	}
 
+#ifdef HAVE_PREFORK_BACKENDS
+	/* Close the channels to the pre-forked backends */
+	{
+		Dlelem	   *curr;
+
+		for (curr = DLGetHead(BackendList); curr; curr = DLGetSucc(curr))
+		{
+			Backend    *bp = (Backend *) DLE_VAL(curr);
+
+			if (bp->prefork_sock != PGINVALID_SOCKET)
+			{
+				closesocket(bp->prefork_sock);
+				bp->prefork_sock = PGINVALID_SOCKET;
+			}
+		}
+	}
+#endif
+
 	/* If using syslogger, close the read side of the pipe */
 	if (!am_syslogger)
 	{
@@ -2064,10 +2169,10 @@ SIGHUP_handler(SIGNAL_ARGS)
 			signal_child(AutoVacPID, SIGHUP);
 		if (PgArchPID != 0)
 			signal_child(PgArchPID, SIGHUP);
+		if (SessionProxyPID != 0)
+			signal_child(SessionProxyPID, SIGHUP);
 		if (SysLoggerPID != 0)
 			signal_child(SysLoggerPID, SIGHUP);
-		if (PgStatPID != 0)
-			signal_child(PgStatPID, SIGHUP);
 
 		/* Reload authentication config files too */
 		if (!load_hba())
@@ -2076,6 +2181,11 @@ SIGHUP_handler(SIGNAL_ARGS)
 
 		load_ident();
 
+		/*
+		 * Pre-forked backends hold the old configuration; replace them.
+		 */
+		RetirePreforkedBackends();
+
 #ifdef EXEC_BACKEND
 		/* Update the starting-point file for future children */
 		write_nondefault_variables(PGC_SIGHUP);
@@ -2120,8 +2230,12 @@ pmdie(SIGNAL_ARGS)
 			if (pmState == PM_RUN || pmState == PM_RECOVERY ||
 				pmState == PM_HOT_STANDBY || pmState == PM_STARTUP)
 			{
-				/* autovacuum workers are told to shut down immediately */
-				SignalSomeChildren(SIGTERM, BACKEND_TYPE_AUTOVAC);
+				/*
+				 * autovacuum workers and background workers are told to shut
+				 * down immediately
+				 */
+				SignalSomeChildren(SIGTERM,
+								 BACKEND_TYPE_AUTOVAC | BACKEND_TYPE_BGWORKER);
 				/* and the autovac launcher too */
 				if (AutoVacPID != 0)
 					signal_child(AutoVacPID, SIGTERM);
@@ -2130,6 +2244,11 @@ pmdie(SIGNAL_ARGS)
 					signal_child(WalWriterPID, SIGTERM);
 				if (BgWriterPID != 0)
 					signal_child(BgWriterPID, SIGTERM);
+				/* the session proxy keeps serving its remaining clients */
+				if (SessionProxyPID != 0)
+					signal_child(SessionProxyPID, SIGTERM);
+				/* backends still waiting for a connection won't get one */
+				RetirePreforkedBackends();
 
 				/*
 				 * If we're in recovery, we can't kill the startup process
@@ -2185,15 +2304,19 @@ pmdie(SIGNAL_ARGS)
 			{
 				ereport(LOG,
 						(errmsg("aborting any active transactions")));
-				/* shut down all backends and autovac workers */
+				/* shut down all backends, autovac and background workers */
 				SignalSomeChildren(SIGTERM,
-								 BACKEND_TYPE_NORMAL | BACKEND_TYPE_AUTOVAC);
+								 BACKEND_TYPE_NORMAL | BACKEND_TYPE_AUTOVAC |
+								 BACKEND_TYPE_BGWORKER);
 				/* and the autovac launcher too */
 				if (AutoVacPID != 0)
 					signal_child(AutoVacPID, SIGTERM);
 				/* and the walwriter too */
 				if (WalWriterPID != 0)
 					signal_child(WalWriterPID, SIGTERM);
+				/* and the session proxy, whose backends are all going */
+				if (SessionProxyPID != 0)
+					signal_child(SessionProxyPID, SIGTERM);
 				pmState = PM_WAIT_BACKENDS;
 			}
 
@@ -2229,8 +2352,8 @@ pmdie(SIGNAL_ARGS)
 				signal_child(AutoVacPID, SIGQUIT);
 			if (PgArchPID != 0)
 				signal_child(PgArchPID, SIGQUIT);
-			if (PgStatPID != 0)
-				signal_child(PgStatPID, SIGQUIT);
+			if (SessionProxyPID != 0)
+				signal_child(SessionProxyPID, SIGQUIT);
 			ExitPostmaster(0);
 			break;
 	}
@@ -2370,8 +2493,8 @@ reaper(SIGNAL_ARGS)
 				AutoVacPID = StartAutoVacLauncher();
 			if (XLogArchivingActive() && PgArchPID == 0)
 				PgArchPID = pgarch_start();
-			if (PgStatPID == 0)
-				PgStatPID = pgstat_start();
+			if (SessionPoolSize > 0 && SessionProxyPID == 0)
+				SessionProxyPID = StartSessionProxy();
 
 			/* at this point we are really open for business */
 			ereport(LOG,
@@ -2420,6 +2543,13 @@ reaper(SIGNAL_ARGS)
 				if (PgArchPID != 0)
 					signal_child(PgArchPID, SIGUSR2);
 
+				/*
+				 * No backend is left to hand a session over, so the session
+				 * proxy can go.
+				 */
+				if (SessionProxyPID != 0)
+					signal_child(SessionProxyPID, SIGUSR2);
+
 				/*
 				 * Waken walsenders for the last time. No regular backends
 				 * should be around anymore.
@@ -2427,13 +2557,6 @@ reaper(SIGNAL_ARGS)
 				SignalChildren(SIGUSR2);
 
 				pmState = PM_SHUTDOWN_2;
-
-				/*
-				 * We can also shut down the stats collector now; there's
-				 * nothing left for it to do.
-				 */
-				if (PgStatPID != 0)
-					signal_child(PgStatPID, SIGQUIT);
 			}
 			else
 			{
@@ -2510,18 +2633,20 @@ reaper(SIGNAL_ARGS)
 		}
 
 		/*
-		 * Was it the statistics collector?  If so, just try to start a new
-		 * one; no need to force reset of the rest of the system.  (If fail,
-		 * we'll try again in future cycles of the main loop.)
+		 * Was it the session proxy?  If so, just try to start a new one; the
+		 * sessions it served are lost anyway, and it isn't connected to
+		 * shared memory.  (If fail, we'll try again in future cycles of the
+		 * main loop.)  Don't restart it if we are shutting down.
 		 */
-		if (pid == PgStatPID)
+		if (pid == SessionProxyPID)
 		{
-			PgStatPID = 0;
+			SessionProxyPID = 0;
 			if (!EXIT_STATUS_0(exitstatus))
-				LogChildExit(LOG, _("statistics collector process"),
+				LogChildExit(LOG, _("session proxy process"),
 							 pid, exitstatus);
-			if (pmState == PM_RUN)
-				PgStatPID = pgstat_start();
+			if (SessionPoolSize > 0 &&
+				(pmState == PM_RUN || pmState == PM_HOT_STANDBY))
+				SessionProxyPID = StartSessionProxy();
 			continue;
 		}
 
@@ -2537,6 +2662,10 @@ reaper(SIGNAL_ARGS)
 			continue;
 		}
 
+		/* Was it a background worker? */
+		if (CleanupBackgroundWorker(pid, exitstatus))
+			continue;
+
 		/*
 		 * Else do standard backend child cleanup.
 		 */
@@ -2549,6 +2678,9 @@ reaper(SIGNAL_ARGS)
 	 */
 	PostmasterStateMachine();
 
+	/* The new state may let background workers start, or start again */
+	MaybeStartBackgroundWorkers();
+
 	/* Done with signal handler */
 	PG_SETMASK(&UnBlockSig);
 
@@ -2614,9 +2746,10 @@ CleanupBackend(int pid,
 					HandleChildCrash(pid, exitstatus, _("server process"));
 					return;
 				}
-#ifdef EXEC_BACKEND
-				ShmemBackendArrayRemove(bp);
-#endif
+				if (!bp->prefork)
+					ShmemBackendArrayRemove(bp);
+				else if (bp->prefork_sock != PGINVALID_SOCKET)
+					ClosePreforkChannel(bp);
 			}
 			DLRemove(curr);
 			free(bp);
@@ -2627,7 +2760,7 @@ CleanupBackend(int pid,
 
 /*
  * HandleChildCrash -- cleanup after failed backend, bgwriter, checkpointer,
- * walwriter or autovacuum.
+ * walwriter, autovacuum or background worker.
  *
  * The objectives here are to clean up our local state about the child
  * process, and to signal all other remaining children to quickdie.
@@ -2663,9 +2796,10 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 			if (!bp->dead_end)
 			{
 				(void) ReleasePostmasterChildSlot(bp->child_slot);
-#ifdef EXEC_BACKEND
-				ShmemBackendArrayRemove(bp);
-#endif
+				if (!bp->prefork)
+					ShmemBackendArrayRemove(bp);
+				else if (bp->prefork_sock != PGINVALID_SOCKET)
+					ClosePreforkChannel(bp);
 			}
 			DLRemove(curr);
 			free(bp);
@@ -2784,19 +2918,16 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 	}
 
 	/*
-	 * Force a power-cycle of the pgstat process too.  (This isn't absolutely
-	 * necessary, but it seems like a good idea for robustness, and it
-	 * simplifies the state-machine logic in the case where a shutdown request
-	 * arrives during crash processing.)
+	 * Likewise for the session proxy; the pooled sessions are lost with
+	 * their backends anyway.
 	 */
-	if (PgStatPID != 0 && !FatalError)
+	if (SessionProxyPID != 0 && !FatalError)
 	{
 		ereport(DEBUG2,
 				(errmsg_internal("sending %s to process %d",
 								 "SIGQUIT",
-								 (int) PgStatPID)));
-		signal_child(PgStatPID, SIGQUIT);
-		allow_immediate_pgstat_restart();
+								 (int) SessionProxyPID)));
+		signal_child(SessionProxyPID, SIGQUIT);
 	}
 
 	/* We do NOT restart the syslogger */
@@ -2928,8 +3059,8 @@ PostmasterStateMachine(void)
 	{
 		/*
 		 * PM_WAIT_BACKENDS state ends when we have no regular backends
-		 * (including autovac workers) and no walwriter, autovac launcher
-		 * or bgwriter.  If we are doing crash recovery then we expect the
+		 * (including autovac and background workers) and no walwriter,
+		 * autovac launcher or bgwriter.  If we are doing crash recovery then we expect the
 		 * checkpointer to exit as well, otherwise not.
 		 * The archiver, stats, and syslogger processes
 		 * are disregarded since they are not connected to shared memory; we
@@ -2937,7 +3068,8 @@ PostmasterStateMachine(void)
 		 * disregarded, they will be terminated later after writing the
 		 * checkpoint record, like the archiver process.
 		 */
-		if (CountChildren(BACKEND_TYPE_NORMAL | BACKEND_TYPE_AUTOVAC) == 0 &&
+		if (CountChildren(BACKEND_TYPE_NORMAL | BACKEND_TYPE_AUTOVAC |
+						  BACKEND_TYPE_BGWORKER) == 0 &&
 			StartupPID == 0 &&
 			WalReceiverPID == 0 &&
 			BgWriterPID == 0 &&
@@ -2986,12 +3118,12 @@ PostmasterStateMachine(void)
 					FatalError = true;
 					pmState = PM_WAIT_DEAD_END;
 
-					/* Kill the walsenders, archiver and stats collector too */
+					/* Kill the walsenders, archiver and session proxy too */
 					SignalChildren(SIGQUIT);
 					if (PgArchPID != 0)
 						signal_child(PgArchPID, SIGQUIT);
-					if (PgStatPID != 0)
-						signal_child(PgStatPID, SIGQUIT);
+					if (SessionProxyPID != 0)
+						signal_child(SessionProxyPID, SIGQUIT);
 				}
 			}
 		}
@@ -3002,13 +3134,14 @@ PostmasterStateMachine(void)
 		/*
 		 * PM_SHUTDOWN_2 state ends when there's no other children than
 		 * dead_end children left. There shouldn't be any regular backends
-		 * left by now anyway; what we're really waiting for is walsenders and
-		 * archiver.
+		 * left by now anyway; what we're really waiting for is walsenders,
+		 * archiver and session proxy.
 		 *
 		 * Walreceiver should normally be dead by now, but not when a fast
 		 * shutdown is performed during recovery.
 		 */
-		if (PgArchPID == 0 && CountChildren(BACKEND_TYPE_ALL) == 0 &&
+		if (PgArchPID == 0 && SessionProxyPID == 0 &&
+			CountChildren(BACKEND_TYPE_ALL) == 0 &&
 			WalReceiverPID == 0)
 		{
 			pmState = PM_WAIT_DEAD_END;
@@ -3019,19 +3152,18 @@ PostmasterStateMachine(void)
 	{
 		/*
 		 * PM_WAIT_DEAD_END state ends when the BackendList is entirely empty
-		 * (ie, no dead_end children remain), and the archiver and stats
-		 * collector are gone too.
+		 * (ie, no dead_end children remain), and the archiver is gone too.
 		 *
-		 * The reason we wait for those two is to protect them against a new
+		 * The reason we wait for the archiver is to protect it against a new
 		 * postmaster starting conflicting subprocesses; this isn't an
 		 * ironclad protection, but it at least helps in the
-		 * shutdown-and-immediately-restart scenario.  Note that they have
-		 * already been sent appropriate shutdown signals, either during a
+		 * shutdown-and-immediately-restart scenario.  Note that it has
+		 * already been sent an appropriate shutdown signal, either during a
 		 * normal state transition leading up to PM_WAIT_DEAD_END, or during
 		 * FatalError processing.
 		 */
-		if (DLGetHead(BackendList) == NULL &&
-			PgArchPID == 0 && PgStatPID == 0)
+		if (DLGetHead(BackendList) == NULL && PgArchPID == 0 &&
+			SessionProxyPID == 0)
 		{
 			/* These other guys should be dead already */
 			Assert(StartupPID == 0);
@@ -3102,6 +3234,9 @@ PostmasterStateMachine(void)
 		ereport(LOG,
 				(errmsg("all server processes terminated; reinitializing")));
 
+		/* allow background workers to immediately restart */
+		ResetBackgroundWorkerCrashTimes();
+
 		shmem_exit(1);
 		reset_shared(PostPortNumber);
 
@@ -3176,6 +3311,8 @@ SignalSomeChildren(int signal, int target)
 
 			if (bp->is_autovacuum)
 				child = BACKEND_TYPE_AUTOVAC;
+			else if (bp->is_bgworker)
+				child = BACKEND_TYPE_BGWORKER;
 			else if (IsPostmasterChildWalSender(bp->child_slot))
 				child = BACKEND_TYPE_WALSND;
 			else
@@ -3206,6 +3343,12 @@ BackendStartup(Port *port)
 	Backend    *bn;				/* for backend cleanup */
 	pid_t		pid;
 
+#ifdef HAVE_PREFORK_BACKENDS
+	/* If a backend has been forked ahead of time, it takes the connection */
+	if (nPreforkedBackends > 0 && HandOffToPreforkedBackend(port))
+		return STATUS_OK;
+#endif
+
 	/*
 	 * Create backend data structure.  Better before the fork() so we can
 	 * handle failure cleanly.
@@ -3231,6 +3374,8 @@ BackendStartup(Port *port)
 	port->canAcceptConnections = canAcceptConnections();
 	bn->dead_end = (port->canAcceptConnections != CAC_OK &&
 					port->canAcceptConnections != CAC_WAITBACKUP);
+	bn->prefork = false;
+	bn->prefork_sock = PGINVALID_SOCKET;
 
 	/*
 	 * Unless it's a dead_end child, assign it a child slot number
@@ -3299,12 +3444,11 @@ BackendStartup(Port *port)
 	 */
 	bn->pid = pid;
 	bn->is_autovacuum = false;
+	bn->is_bgworker = false;
 	DLInitElem(&bn->elem, bn);
 	DLAddHead(BackendList, &bn->elem);
-#ifdef EXEC_BACKEND
 	if (!bn->dead_end)
 		ShmemBackendArrayAdd(bn);
-#endif
 
 	return STATUS_OK;
 }
@@ -3340,6 +3484,333 @@ report_fork_failure_to_client(Port *port, int errnum)
 }
 
 
+#ifdef HAVE_PREFORK_BACKENDS
+
+/*
+ * What the postmaster sends a pre-forked backend along with the client socket
+ */
+typedef struct
+{
+	Port		port;			/* as set up by ConnCreate() */
+	long		cancel_key;		/* cancel key for this backend */
+} PreforkHandoff;
+
+/*
+ * StartPreforkedBackends -- top up the backends forked ahead of connections
+ */
+static void
+StartPreforkedBackends(void)
+{
+	while (nPreforkedBackends < PreforkBackends &&
+		   canAcceptConnections() == CAC_OK)
+	{
+		if (!StartPreforkedBackend())
+			break;
+	}
+}
+
+/*
+ * StartPreforkedBackend -- fork a backend ahead of its connection
+ *
+ * returns: false if the fork failed.
+ *
+ * Note: if you change this code, also consider BackendStartup.
+ */
+static bool
+StartPreforkedBackend(void)
+{
+	Backend    *bn;
+	pgsocket	channel[2];
+	pid_t		pid;
+
+	bn = (Backend *) malloc(sizeof(Backend));
+	if (!bn)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return false;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for pre-forked backend: %m")));
+		free(bn);
+		return false;
+	}
+
+	/* The cancel key is computed when the connection is handed over */
+	bn->cancel_key = 0;
+	bn->dead_end = false;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+
+	pid = fork_process();
+	if (pid == 0)				/* child */
+	{
+		free(bn);
+		closesocket(channel[0]);
+
+		IsUnderPostmaster = true;		/* we are a postmaster subprocess now */
+
+		MyProcPid = getpid();	/* reset MyProcPid */
+
+		MyStartTime = time(NULL);
+
+		/* We don't want the postmaster's proc_exit() handlers */
+		on_exit_reset();
+
+		/* Close the postmaster's sockets */
+		ClosePostmasterPorts(false);
+
+		/* Wait for a connection, then run the backend */
+		PreforkedBackendMain(channel[1]);
+	}
+
+	closesocket(channel[1]);
+
+	if (pid < 0)
+	{
+		/* in parent, fork failed */
+		int			save_errno = errno;
+
+		(void) ReleasePostmasterChildSlot(bn->child_slot);
+		closesocket(channel[0]);
+		free(bn);
+		errno = save_errno;
+		ereport(LOG,
+				(errmsg("could not fork new process for connection: %m")));
+		return false;
+	}
+
+	/* in parent, successful fork */
+	ereport(DEBUG2,
+			(errmsg_internal("forked new backend ahead of connection, pid=%d",
+							 (int) pid)));
+
+	bn->pid = pid;
+	bn->is_autovacuum = false;
+	bn->is_bgworker = false;
+	bn->prefork = true;
+	bn->prefork_sock = channel[0];
+	DLInitElem(&bn->elem, bn);
+	DLAddHead(BackendList, &bn->elem);
+	nPreforkedBackends++;
+
+	return true;
+}
+
+/*
+ * PreforkedBackendMain -- wait in a pre-forked backend for its connection
+ *
+ * The postmaster passes the client socket over the channel, along with the
+ * Port it set up when accepting the connection; we then carry on exactly as
+ * a backend forked by BackendStartup.  If the postmaster closes the channel
+ * instead, it no longer needs us and we exit.
+ *
+ * returns: nothing.
+ */
+static void
+PreforkedBackendMain(pgsocket sock)
+{
+	PreforkHandoff handoff;
+	pgsocket	client = PGINVALID_SOCKET;
+	size_t		received = 0;
+	Port	   *port;
+
+	/* As while collecting the startup packet, exit at once on shutdown */
+	pqsignal(SIGTERM, startup_die);
+	pqsignal(SIGQUIT, startup_die);
+	PG_SETMASK(&StartupBlockSig);
+
+	while (received < sizeof(handoff))
+	{
+		struct msghdr msg;
+		struct iovec iov;
+		union
+		{
+			struct cmsghdr hdr;
+			char		data[CMSG_SPACE(sizeof(pgsocket))];
+		}			cmsgbuf;
+		struct cmsghdr *cmsg;
+		ssize_t		rc;
+
+		memset(&msg, 0, sizeof(msg));
+		iov.iov_base = (char *) &handoff + received;
+		iov.iov_len = sizeof(handoff) - received;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = &cmsgbuf;
+		msg.msg_controllen = sizeof(cmsgbuf);
+
+		rc = recvmsg(sock, &msg, 0);
+		if (rc < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not receive connection from postmaster: %m")));
+		}
+		if (rc == 0)
+			proc_exit(0);
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+			 cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET &&
+				cmsg->cmsg_type == SCM_RIGHTS)
+				memcpy(&client, CMSG_DATA(cmsg), sizeof(pgsocket));
+		}
+		received += rc;
+	}
+
+	if (client == PGINVALID_SOCKET)
+		elog(FATAL, "no client socket received from postmaster");
+
+	closesocket(sock);
+	PG_SETMASK(&BlockSig);
+
+	/* Pointers in the postmaster's Port are of no use to us */
+	if (!(port = (Port *) malloc(sizeof(Port))))
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+	memcpy(port, &handoff.port, sizeof(Port));
+	port->sock = client;
+#if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
+	port->gss = (pg_gssinfo *) calloc(1, sizeof(pg_gssinfo));
+	if (!port->gss)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+#endif
+
+	MyCancelKey = handoff.cancel_key;
+
+	/* Perform additional initialization and collect startup packet */
+	BackendInitialize(port);
+
+	/* And run the backend */
+	proc_exit(BackendRun(port));
+}
+
+/*
+ * HandOffToPreforkedBackend -- pass a new connection to a pre-forked backend
+ *
+ * returns: false if no pre-forked backend took the connection, in which case
+ * the caller forks a backend for it as usual.  That is also how connections
+ * that will only get an error message are dealt with.
+ */
+static bool
+HandOffToPreforkedBackend(Port *port)
+{
+	CAC_state	cac = canAcceptConnections();
+	Dlelem	   *curr;
+
+	if (cac != CAC_OK && cac != CAC_WAITBACKUP)
+		return false;
+
+	for (curr = DLGetHead(BackendList); curr; curr = DLGetSucc(curr))
+	{
+		Backend    *bp = (Backend *) DLE_VAL(curr);
+		PreforkHandoff handoff;
+		struct msghdr msg;
+		struct iovec iov;
+		union
+		{
+			struct cmsghdr hdr;
+			char		data[CMSG_SPACE(sizeof(pgsocket))];
+		}			cmsgbuf;
+		struct cmsghdr *cmsg;
+		ssize_t		rc;
+
+		if (bp->prefork_sock == PGINVALID_SOCKET)
+			continue;
+
+		memcpy(&handoff.port, port, sizeof(Port));
+		handoff.port.canAcceptConnections = cac;
+		handoff.cancel_key = PostmasterRandom();
+
+		memset(&msg, 0, sizeof(msg));
+		iov.iov_base = (char *) &handoff;
+		iov.iov_len = sizeof(handoff);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = &cmsgbuf;
+		msg.msg_controllen = CMSG_SPACE(sizeof(pgsocket));
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(pgsocket));
+		memcpy(CMSG_DATA(cmsg), &port->sock, sizeof(pgsocket));
+
+		do
+		{
+			rc = sendmsg(bp->prefork_sock, &msg, 0);
+		} while (rc < 0 && errno == EINTR);
+
+		/* Either way, this backend won't be offered another connection */
+		ClosePreforkChannel(bp);
+
+		if (rc != sizeof(handoff))
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not pass connection to server process %d: %m",
+							(int) bp->pid)));
+			continue;
+		}
+
+		ereport(DEBUG2,
+				(errmsg_internal("passed connection to pre-forked backend, pid=%d socket=%d",
+								 (int) bp->pid, (int) port->sock)));
+
+		bp->cancel_key = handoff.cancel_key;
+		bp->prefork = false;
+		ShmemBackendArrayAdd(bp);
+		return true;
+	}
+
+	return false;
+}
+#endif   /* HAVE_PREFORK_BACKENDS */
+
+/*
+ * ClosePreforkChannel -- close the postmaster's end of a pre-forked backend's
+ *		channel.  A backend still waiting on it exits.
+ */
+static void
+ClosePreforkChannel(Backend *bp)
+{
+	closesocket(bp->prefork_sock);
+	bp->prefork_sock = PGINVALID_SOCKET;
+	nPreforkedBackends--;
+}
+
+/*
+ * RetirePreforkedBackends -- make the pre-forked backends still waiting for
+ *		a connection exit.  ServerLoop starts new ones as needed.
+ */
+static void
+RetirePreforkedBackends(void)
+{
+	Dlelem	   *curr;
+
+	if (nPreforkedBackends == 0)
+		return;
+
+	for (curr = DLGetHead(BackendList); curr; curr = DLGetSucc(curr))
+	{
+		Backend    *bp = (Backend *) DLE_VAL(curr);
+
+		if (bp->prefork_sock != PGINVALID_SOCKET)
+			ClosePreforkChannel(bp);
+	}
+}
+
+
 /*
  * BackendInitialize -- initialize an interactive (postmaster-child)
  *				backend process, and collect the client's startup packet.
@@ -3637,6 +4108,32 @@ backend_forkexec(Port *port)
 	return internal_forkexec(ac, av, port);
 }
 
+/*
+ * bgworker_forkexec -- fork/exec off a background worker process
+ *
+ * The child finds its worker by the number of its slot in shared memory.
+ *
+ * returns the pid of the fork/exec'd process, or -1 on failure
+ */
+static pid_t
+bgworker_forkexec(int shmem_slot)
+{
+	char	   *av[10];
+	int			ac = 0;
+	char		forkav[MAXPGPATH];
+
+	snprintf(forkav, MAXPGPATH, "--forkbgworker=%d", shmem_slot);
+
+	av[ac++] = "postgres";
+	av[ac++] = forkav;
+	av[ac++] = NULL;			/* filled in by postmaster_forkexec */
+	av[ac] = NULL;
+
+	Assert(ac < lengthof(av));
+
+	return postmaster_forkexec(ac, av);
+}
+
 #ifndef WIN32
 
 /*
@@ -3995,7 +4492,8 @@ SubPostmasterMain(int argc, char *argv[])
 	if (strcmp(argv[1], "--forkbackend") == 0 ||
 		strcmp(argv[1], "--forkavlauncher") == 0 ||
 		strcmp(argv[1], "--forkavworker") == 0 ||
-		strcmp(argv[1], "--forkboot") == 0)
+		strcmp(argv[1], "--forkboot") == 0 ||
+		strncmp(argv[1], "--forkbgworker=", 15) == 0)
 		PGSharedMemoryReAttach();
 
 	/* autovacuum needs this set before calling InitProcess */
@@ -4003,6 +4501,9 @@ SubPostmasterMain(int argc, char *argv[])
 		AutovacuumLauncherIAm();
 	if (strcmp(argv[1], "--forkavworker") == 0)
 		AutovacuumWorkerIAm();
+	/* and so do background workers */
+	if (strncmp(argv[1], "--forkbgworker=", 15) == 0)
+		IsBackgroundWorker = true;
 
 	/*
 	 * Start our win32 signal implementation. This has to be done after we
@@ -4133,24 +4634,34 @@ SubPostmasterMain(int argc, char *argv[])
 		AutoVacWorkerMain(argc - 2, argv + 2);
 		proc_exit(0);
 	}
-	if (strcmp(argv[1], "--forkarch") == 0)
+	if (strncmp(argv[1], "--forkbgworker=", 15) == 0)
 	{
+		int			shmem_slot;
+
 		/* Close the postmaster's sockets */
 		ClosePostmasterPorts(false);
 
-		/* Do not want to attach to shared memory */
+		/* Restore basic shared memory pointers */
+		InitShmemAccess(UsedShmemSegAddr);
 
-		PgArchiverMain(argc, argv);
-		proc_exit(0);
+		/* Need a PGPROC to run CreateSharedMemoryAndSemaphores */
+		InitProcess();
+
+		/* Attach process to shared data structures */
+		CreateSharedMemoryAndSemaphores(false, 0);
+
+		shmem_slot = atoi(argv[1] + 15);
+		MyBgworkerEntry = BackgroundWorkerEntry(shmem_slot);
+		StartBackgroundWorker();
 	}
-	if (strcmp(argv[1], "--forkcol") == 0)
+	if (strcmp(argv[1], "--forkarch") == 0)
 	{
 		/* Close the postmaster's sockets */
 		ClosePostmasterPorts(false);
 
 		/* Do not want to attach to shared memory */
 
-		PgstatCollectorMain(argc, argv);
+		PgArchiverMain(argc, argv);
 		proc_exit(0);
 	}
 	if (strcmp(argv[1], "--forklog") == 0)
@@ -4225,12 +4736,6 @@ sigusr1_handler(SIGNAL_ARGS)
 	if (CheckPostmasterSignal(PMSIGNAL_BEGIN_HOT_STANDBY) &&
 		pmState == PM_RECOVERY)
 	{
-		/*
-		 * Likewise, start other special children as needed.
-		 */
-		Assert(PgStatPID == 0);
-		PgStatPID = pgstat_start();
-
 		ereport(LOG,
 		(errmsg("database system is ready to accept read only connections")));
 
@@ -4290,6 +4795,16 @@ sigusr1_handler(SIGNAL_ARGS)
 		PostmasterStateMachine();
 	}
 
+	/* Process background worker state changes */
+	if (CheckPostmasterSignal(PMSIGNAL_BACKGROUND_WORKER_CHANGE))
+		BackgroundWorkerStateChange();
+
+	/*
+	 * Start background workers that were just registered, or that may start
+	 * in the state we just entered.
+	 */
+	MaybeStartBackgroundWorkers();
+
 	if (CheckPromoteSignal() && StartupPID != 0 &&
 		(pmState == PM_STARTUP || pmState == PM_RECOVERY ||
 		 pmState == PM_HOT_STANDBY || pmState == PM_WAIT_READONLY))
@@ -4417,6 +4932,8 @@ CountChildren(int target)
 
 			if (bp->is_autovacuum)
 				child = BACKEND_TYPE_AUTOVAC;
+			else if (bp->is_bgworker)
+				child = BACKEND_TYPE_BGWORKER;
 			else if (IsPostmasterChildWalSender(bp->child_slot))
 				child = BACKEND_TYPE_WALSND;
 			else
@@ -4575,17 +5092,18 @@ StartAutovacuumWorker(void)
 
 			/* Autovac workers are not dead_end and need a child slot */
 			bn->dead_end = false;
+			bn->prefork = false;
+			bn->prefork_sock = PGINVALID_SOCKET;
 			bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
 
 			bn->pid = StartAutoVacWorker();
 			if (bn->pid > 0)
 			{
 				bn->is_autovacuum = true;
+				bn->is_bgworker = false;
 				DLInitElem(&bn->elem, bn);
 				DLAddHead(BackendList, &bn->elem);
-#ifdef EXEC_BACKEND
 				ShmemBackendArrayAdd(bn);
-#endif
 				/* all OK */
 				return;
 			}
@@ -4619,6 +5137,322 @@ StartAutovacuumWorker(void)
 	}
 }
 
+/*
+ * MaybeStartBackgroundWorkers
+ *		Start the background workers that are due to start
+ *
+ * A worker is due when the postmaster has reached the state the worker
+ * asked to be started in, and it either has never run or has waited out its
+ * restart interval since it last exited.  Workers that are not to be
+ * started again are forgotten here.  We also remember when the next worker
+ * that is waiting out its restart interval is due, so that ServerLoop wakes
+ * up in time to start it.
+ */
+static void
+MaybeStartBackgroundWorkers(void)
+{
+	RegisteredBgWorker *rw;
+	RegisteredBgWorker *next;
+	time_t		now = 0;
+
+	next_bgworker_start = 0;
+
+	/* no workers may be started during a crash or shutdown */
+	if (FatalError || Shutdown > NoShutdown)
+		return;
+
+	for (rw = BackgroundWorkerList; rw != NULL; rw = next)
+	{
+		next = rw->rw_next;
+
+		/* already running? */
+		if (rw->rw_pid != 0)
+			continue;
+
+		/* if marked for death, clean up and remove from list */
+		if (rw->rw_terminate)
+		{
+			NotifyBackgroundWorkerRequester(rw);
+			ForgetBackgroundWorker(rw);
+			continue;
+		}
+
+		/*
+		 * If this worker has exited abnormally before, check whether its
+		 * restart interval has passed; a worker that doesn't want to be
+		 * restarted is forgotten instead.
+		 */
+		if (rw->rw_crashed_at != 0)
+		{
+			if (rw->rw_worker.bgw_restart_time == BGW_NEVER_RESTART)
+			{
+				NotifyBackgroundWorkerRequester(rw);
+				ForgetBackgroundWorker(rw);
+				continue;
+			}
+
+			if (now == 0)
+				now = time(NULL);
+			if (now - rw->rw_crashed_at < rw->rw_worker.bgw_restart_time)
+			{
+				time_t		due = rw->rw_crashed_at +
+				rw->rw_worker.bgw_restart_time;
+
+				if (next_bgworker_start == 0 || due < next_bgworker_start)
+					next_bgworker_start = due;
+				continue;
+			}
+		}
+
+		if (BackgroundWorkerShouldStartNow(rw->rw_worker.bgw_start_time))
+		{
+			rw->rw_crashed_at = 0;
+
+			/*
+			 * If the fork failed, try again after the restart interval;
+			 * StartOneBackgroundWorker has set rw_crashed_at.
+			 */
+			if (!StartOneBackgroundWorker(rw) &&
+				rw->rw_worker.bgw_restart_time != BGW_NEVER_RESTART)
+			{
+				time_t		due = rw->rw_crashed_at +
+				rw->rw_worker.bgw_restart_time;
+
+				if (next_bgworker_start == 0 || due < next_bgworker_start)
+					next_bgworker_start = due;
+			}
+		}
+	}
+}
+
+/*
+ * BackgroundWorkerShouldStartNow
+ *		Does the postmaster state allow starting a worker that asked to be
+ *		started at start_time?
+ */
+static bool
+BackgroundWorkerShouldStartNow(BgWorkerStartTime start_time)
+{
+	switch (pmState)
+	{
+		case PM_NO_CHILDREN:
+		case PM_WAIT_DEAD_END:
+		case PM_SHUTDOWN_2:
+		case PM_SHUTDOWN:
+		case PM_WAIT_BACKENDS:
+		case PM_WAIT_READONLY:
+		case PM_WAIT_BACKUP:
+			break;
+
+		case PM_RUN:
+			if (start_time == BgWorkerStart_RecoveryFinished)
+				return true;
+			/* fall through */
+
+		case PM_HOT_STANDBY:
+			if (start_time == BgWorkerStart_ConsistentState)
+				return true;
+			/* fall through */
+
+		case PM_RECOVERY:
+		case PM_STARTUP:
+		case PM_INIT:
+			if (start_time == BgWorkerStart_PostmasterStart)
+				return true;
+			/* fall through */
+	}
+
+	return false;
+}
+
+/*
+ * StartOneBackgroundWorker
+ *		Fork a background worker process
+ *
+ * Like autovacuum workers, background workers get an entry in BackendList
+ * and a PMChildSlot, so that they're signalled and counted along with the
+ * other children that may be attached to shared memory.
+ *
+ * Returns true on success, false on failure.  On failure, rw_crashed_at is
+ * set, so that we try again after the worker's restart interval.
+ *
+ * Note: if you change this code, also consider StartAutovacuumWorker.
+ */
+static bool
+StartOneBackgroundWorker(RegisteredBgWorker *rw)
+{
+	Backend    *bn;
+	pid_t		worker_pid;
+
+	bn = (Backend *) malloc(sizeof(Backend));
+	if (!bn)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		rw->rw_crashed_at = time(NULL);
+		return false;
+	}
+
+	/*
+	 * Compute the cancel key that will be assigned to this process; as for
+	 * autovacuum workers, it just has to be unguessable.
+	 */
+	MyCancelKey = PostmasterRandom();
+	bn->cancel_key = MyCancelKey;
+
+	bn->dead_end = false;
+	bn->prefork = false;
+	bn->prefork_sock = PGINVALID_SOCKET;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+
+	ereport(DEBUG1,
+			(errmsg("starting background worker process \"%s\"",
+					rw->rw_worker.bgw_name)));
+
+#ifdef EXEC_BACKEND
+	switch ((worker_pid = bgworker_forkexec(rw->rw_shmem_slot)))
+#else
+	switch ((worker_pid = fork_process()))
+#endif
+	{
+		case -1:
+			ereport(LOG,
+					(errmsg("could not fork worker process: %m")));
+			(void) ReleasePostmasterChildSlot(bn->child_slot);
+			free(bn);
+			rw->rw_crashed_at = time(NULL);
+			return false;
+
+#ifndef EXEC_BACKEND
+		case 0:
+			/* in postmaster child ... */
+			/* Close the postmaster's sockets */
+			ClosePostmasterPorts(false);
+
+			/* Lose the postmaster's on-exit routines */
+			on_exit_reset();
+
+			/* Do NOT release postmaster's working memory context */
+
+			MyBgworkerEntry = &rw->rw_worker;
+			StartBackgroundWorker();
+			break;
+#endif
+		default:
+			rw->rw_pid = worker_pid;
+			bn->pid = worker_pid;
+			bn->is_autovacuum = false;
+			bn->is_bgworker = true;
+			DLInitElem(&bn->elem, bn);
+			DLAddHead(BackendList, &bn->elem);
+			ShmemBackendArrayAdd(bn);
+
+			ReportBackgroundWorkerPID(rw);
+			NotifyBackgroundWorkerRequester(rw);
+			return true;
+	}
+
+	/* shouldn't get here */
+	return false;
+}
+
+/*
+ * CleanupBackgroundWorker
+ *		If pid is that of a background worker, clean up after it
+ *
+ * Returns true if it was a background worker, false otherwise.
+ *
+ * Exit status 0 means the worker is done, and it is forgotten; exit status
+ * 1 means it wants to be restarted after its restart interval.  Any other
+ * exit of a worker attached to shared memory is a crash.
+ */
+static bool
+CleanupBackgroundWorker(int pid, int exitstatus)
+{
+	char		namebuf[MAXPGPATH];
+	RegisteredBgWorker *rw;
+
+	for (rw = BackgroundWorkerList; rw != NULL; rw = rw->rw_next)
+	{
+		if (rw->rw_pid == pid)
+			break;
+	}
+	if (rw == NULL)
+		return false;
+
+	snprintf(namebuf, MAXPGPATH, "%s: %s", _("worker process"),
+			 rw->rw_worker.bgw_name);
+
+	rw->rw_pid = 0;
+	if (EXIT_STATUS_0(exitstatus) && !FatalError)
+	{
+		rw->rw_crashed_at = 0;
+		rw->rw_terminate = true;
+	}
+	else
+		rw->rw_crashed_at = time(NULL);
+	ReportBackgroundWorkerPID(rw);
+	NotifyBackgroundWorkerRequester(rw);
+
+	/*
+	 * A worker that isn't attached to shared memory can't have corrupted
+	 * it, however it exited; just log that.
+	 */
+	if (!(rw->rw_worker.bgw_flags & BGWORKER_SHMEM_ACCESS) &&
+		!EXIT_STATUS_0(exitstatus) && !EXIT_STATUS_1(exitstatus))
+	{
+		LogChildExit(LOG, namebuf, pid, exitstatus);
+		exitstatus = 0;
+	}
+
+	if (!EXIT_STATUS_0(exitstatus) && !EXIT_STATUS_1(exitstatus))
+	{
+		HandleChildCrash(pid, exitstatus, namebuf);
+		return true;
+	}
+
+	if (!EXIT_STATUS_0(exitstatus))
+		LogChildExit(LOG, namebuf, pid, exitstatus);
+
+	/* Remove its BackendList entry as for any backend */
+	CleanupBackend(pid, exitstatus);
+
+	return true;
+}
+
+/*
+ * NotifyBackgroundWorkerRequester
+ *		Tell the backend that registered a worker, if it asked to be told,
+ *		that the worker has started or stopped.
+ *
+ * The PID comes from shared memory, so make sure it really is one of our
+ * backends before we signal it.
+ */
+static void
+NotifyBackgroundWorkerRequester(RegisteredBgWorker *rw)
+{
+	pid_t		notify_pid = rw->rw_worker.bgw_notify_pid;
+	Dlelem	   *curr;
+
+	if (notify_pid == 0)
+		return;
+
+	for (curr = DLGetHead(BackendList); curr; curr = DLGetSucc(curr))
+	{
+		Backend    *bp = (Backend *) DLE_VAL(curr);
+
+		if (bp->pid == notify_pid && !bp->dead_end && !bp->prefork)
+		{
+			kill(notify_pid, SIGUSR1);
+			return;
+		}
+	}
+
+	/* the requester is gone; don't bother looking for it again */
+	rw->rw_worker.bgw_notify_pid = 0;
+}
+
 /*
  * Create the opts file
  */
@@ -4655,7 +5489,7 @@ CreateOptsFile(int argc, char *argv[], char *fullprogname)
  * MaxLivePostmasterChildren
  *
  * This reports the number of entries needed in per-child-process arrays
- * (the PMChildFlags array, and if EXEC_BACKEND the ShmemBackendArray).
+ * (the PMChildFlags array and the ShmemBackendArray).
  * These arrays include regular backends, autovac workers and walsenders,
  * but not special children nor dead_end children.	This allows the arrays
  * to have a fixed maximum size, to wit the same too-many-children limit
@@ -4680,7 +5514,6 @@ extern LWLock *LWLockArray;
 extern slock_t *ProcStructLock;
 extern PGPROC *AuxiliaryProcs;
 extern PMSignalData *PMSignalState;
-extern pgsocket pgStatSock;
 
 #ifndef WIN32
 #define write_inheritable_socket(dest, src, childpid) ((*(dest) = (src)), true)
@@ -4727,8 +5560,6 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->AuxiliaryProcs = AuxiliaryProcs;
 	param->PreparedXactProcs = PreparedXactProcs;
 	param->PMSignalState = PMSignalState;
-	if (!write_inheritable_socket(&param->pgStatSock, pgStatSock, childPid))
-		return false;
 
 	param->PostmasterPid = PostmasterPid;
 	param->PgStartTime = PgStartTime;
@@ -4951,7 +5782,6 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	AuxiliaryProcs = param->AuxiliaryProcs;
 	PreparedXactProcs = param->PreparedXactProcs;
 	PMSignalState = param->PMSignalState;
-	read_inheritable_socket(&pgStatSock, &param->pgStatSock);
 
 	PostmasterPid = param->PostmasterPid;
 	PgStartTime = param->PgStartTime;
@@ -4976,6 +5806,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 
 	strlcpy(ExtraOptions, param->ExtraOptions, MAXPGPATH);
 }
+#endif   /* EXEC_BACKEND */
 
 
 Size
@@ -5013,7 +5844,6 @@ ShmemBackendArrayRemove(Backend *bn)
 	/* Mark the slot as empty */
 	ShmemBackendArray[i].pid = 0;
 }
-#endif   /* EXEC_BACKEND */
 
 
 #ifdef WIN32
@@ -0,0 +1,1686 @@
+/*-------------------------------------------------------------------------
+ *
+ * sessionproxy.c
+ *
+ *	PostgreSQL session proxy
+ *
+ *	The session proxy lets many client sessions share a bounded pool of
+ *	backends, so that thousands of mostly-idle connections don't need as
+ *	many server processes.
+ *
+ *	A client connects to the postmaster and gets a new backend as usual,
+ *	which authenticates it and completes the startup handshake.  If session
+ *	pooling is enabled, the backend then hands the client's socket over to
+ *	the proxy, passing it through a datagram socket that the postmaster
+ *	shares with all its children, together with one end of a new socket pair
+ *	through which the proxy can talk to the backend itself.  The proxy adds
+ *	the backend to the pool of backends for the same database, user and
+ *	startup options, unless that pool is full, in which case the backend is
+ *	told to exit.
+ *
+ *	From then on, whenever a client sends a message, the proxy attaches an
+ *	idle backend of the client's pool to it and relays traffic both ways,
+ *	until every request the client sent has been answered and the backend
+ *	reports that it is idle outside a transaction block; the backend then
+ *	goes back to the pool.  Sessions are thus multiplexed at transaction
+ *	boundaries.  The proxy prefers to give a client the backend it used
+ *	last.  A backend that served another session last is first reset with
+ *	DISCARD ALL and pg_advisory_unlock_all(), so no session sees the state
+ *	that another one created outside transaction blocks (SET, prepared
+ *	statements, temporary tables, LISTEN, advisory locks, ...); but that
+ *	state may then be missing in the next transaction, so sessions relying
+ *	on it must leave session_pooling off.
+ *
+ *	The proxy is not connected to shared memory.  When it dies, the clients
+ *	it was serving lose their connections, and the pooled backends exit.
+ *	At shutdown, the proxy is sent SIGTERM along with the backends; it then
+ *	keeps serving its clients as long as their pools have backends, and
+ *	closes the backends that no client needs anymore.  It is told to exit
+ *	with SIGUSR2 once all backends are gone, so that no handoff can be lost.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/sessionproxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+#ifdef HAVE_SYS_POLL_H
+#include <sys/poll.h>
+#endif
+
+#include "libpq/libpq.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "nodes/pg_list.h"
+#include "postmaster/fork_process.h"
+#include "postmaster/postmaster.h"
+#include "postmaster/sessionproxy.h"
+#include "storage/ipc.h"
+#include "storage/pg_shmem.h"
+#include "storage/pmsignal.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/ps_status.h"
+
+
+/* GUC options */
+int			SessionPoolSize = 0;
+bool		SessionPooling = false;
+
+#ifdef HAVE_SESSION_PROXY
+
+#define PROXY_RESTART_INTERVAL 10		/* How often to attempt to restart a
+										 * failed proxy; in seconds. */
+#define HANDOFF_SEND_TIMEOUT 5	/* How long a backend waits for room in the
+								 * handoff channel; in seconds. */
+#define HANDOFF_MAX_SIZE 32768	/* Maximum size of a handoff message */
+#define PROXY_BUFFER_SIZE 65536 /* Size of the proxy's read buffer */
+#define PROXY_POLL_TIMEOUT 1000 /* Main loop poll timeout; in msec */
+
+/*
+ * The handoff channel is a datagram socket pair created by the postmaster.
+ * The proxy receives handoff messages on the first socket, and backends send
+ * them on the second one.
+ */
+static pgsocket HandoffChannel[2] = {PGINVALID_SOCKET, PGINVALID_SOCKET};
+
+/*
+ * A handoff message consists of this header, followed by the pool key and
+ * by any client input the backend had already received.  It carries the
+ * client's socket and the proxy's end of the new backend connection.
+ */
+typedef struct SessionHandoff
+{
+	int32		pid;			/* PID of the backend handing over */
+	int32		keylen;			/* length of the pool key */
+	int32		inputlen;		/* length of pending client input */
+} SessionHandoff;
+
+typedef struct ProxyPool ProxyPool;
+typedef struct ProxyChannel ProxyChannel;
+
+/*
+ * A connection of the proxy, either to a client or to a backend.
+ *
+ * For each one we follow the framing of the messages read from it, which is
+ * how we find session boundaries.  Data read from a channel is written to
+ * its peer right away; whatever can't be written yet is queued in the peer's
+ * output buffer, and we don't read more until that buffer has been drained.
+ */
+struct ProxyChannel
+{
+	pgsocket	sock;
+	bool		is_backend;		/* backend or client connection? */
+	bool		dead;			/* closed, to be freed */
+	bool		closing;		/* client has sent Terminate */
+	bool		waiting;		/* client is waiting for a backend */
+	ProxyPool  *pool;
+	ProxyChannel *peer;			/* attached backend or client, if any */
+	ProxyChannel *next;			/* link in the pool's idle or waiting list */
+
+	/* framing of the messages read from sock */
+	char		hdr[5];			/* message type and length */
+	int			hdr_len;		/* bytes of hdr received, 0 between messages */
+	uint32		remaining;		/* bytes of message body still to come */
+
+	/* output waiting to be written to sock */
+	char	   *outbuf;
+	int			outstart;
+	int			outlen;
+
+	/* backend only: state of the session being served */
+	int			pid;			/* backend PID */
+	int			pending;		/* requests not answered by ReadyForQuery */
+	bool		unsynced;		/* extended-query messages not yet synced */
+	char		txn_status;		/* status from the last ReadyForQuery */
+	int			resetting;		/* reset queries not answered yet */
+	uint32		last_session;	/* session_id of the client served last */
+
+	/* client only */
+	uint32		session_id;		/* identifies the client's session */
+	int			last_pid;		/* PID of the backend used last */
+	char	   *early_input;	/* input the backend had already received */
+	int			early_len;
+};
+
+/*
+ * A pool of backends, shared by the clients having the same key: database,
+ * user and startup options.
+ */
+struct ProxyPool
+{
+	ProxyPool  *next;
+	char	   *key;
+	int			keylen;
+	int			nbackends;		/* backends of this pool, busy or idle */
+	int			nclients;		/* clients of this pool */
+	ProxyChannel *idle;			/* idle backends */
+	ProxyChannel *waiting_head; /* FIFO of clients waiting for a backend */
+	ProxyChannel *waiting_tail;
+};
+
+static time_t last_proxy_start_time;
+
+/*
+ * Flags set by interrupt handlers for later service in the main loop.
+ */
+static volatile sig_atomic_t got_SIGHUP = false;
+static volatile sig_atomic_t got_SIGTERM = false;
+static volatile sig_atomic_t ready_to_stop = false;
+
+/* Proxy state */
+static bool draining = false;
+static ProxyChannel **channels = NULL;
+static int	nchannels = 0;
+static int	maxchannels = 0;
+static ProxyPool *pools = NULL;
+static uint32 next_session_id = 1;
+static char proxy_buffer[PROXY_BUFFER_SIZE];
+static char handoff_buffer[HANDOFF_MAX_SIZE];
+
+static void SessionProxyMain(void);
+static void proxy_exit(SIGNAL_ARGS);
+static void ProxySigHupHandler(SIGNAL_ARGS);
+static void ProxySigTermHandler(SIGNAL_ARGS);
+static void ProxySigUsr2Handler(SIGNAL_ARGS);
+static void proxy_MainLoop(void);
+static void proxy_accept_handoffs(void);
+static void proxy_adopt_session(SessionHandoff *hdr, const char *key,
+					const char *input, pgsocket clientsock,
+					pgsocket backendsock);
+static ProxyPool *proxy_get_pool(const char *key, int keylen);
+static ProxyChannel *proxy_new_channel(pgsocket sock, bool is_backend,
+				  ProxyPool *pool);
+static bool proxy_wants_read(ProxyChannel *ch);
+static void proxy_read(ProxyChannel *ch);
+static int	proxy_scan(ProxyChannel *ch, const char *data, int len,
+		   int *start);
+static void proxy_client_message(ProxyChannel *client, char msgtype);
+static void proxy_send(ProxyChannel *ch, const char *data, int len);
+static void proxy_flush(ProxyChannel *ch);
+static bool proxy_session_idle(ProxyChannel *backend);
+static void proxy_attach(ProxyChannel *client);
+static void proxy_connect(ProxyChannel *client, ProxyChannel *backend);
+static void proxy_reset_backend(ProxyChannel *backend);
+static void proxy_release(ProxyChannel *backend);
+static void proxy_backend_idle(ProxyChannel *backend);
+static void proxy_drop(ProxyChannel *ch);
+static void proxy_drop_client(ProxyChannel *client);
+static void proxy_drop_backend(ProxyChannel *backend, bool terminate);
+static void proxy_fail_client(ProxyChannel *client, int sqlerrcode,
+				  const char *message);
+static void proxy_close_channel(ProxyChannel *ch);
+static void proxy_sweep(void);
+#endif   /* HAVE_SESSION_PROXY */
+
+
+/* ------------------------------------------------------------
+ * Public functions called from postmaster follow
+ * ------------------------------------------------------------
+ */
+
+/*
+ * SessionProxyInit
+ *
+ *	Called from postmaster at startup, before any child is forked, to create
+ *	the channel through which backends hand their sessions over to the proxy.
+ */
+void
+SessionProxyInit(void)
+{
+	if (SessionPoolSize <= 0)
+		return;
+
+#ifdef HAVE_SESSION_PROXY
+	{
+		struct timeval tv;
+
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, HandoffChannel) < 0)
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not create session handoff channel: %m")));
+
+		/*
+		 * Don't let backends hang if the proxy doesn't keep up; they will
+		 * just go on serving their client themselves.
+		 */
+		tv.tv_sec = HANDOFF_SEND_TIMEOUT;
+		tv.tv_usec = 0;
+		if (setsockopt(HandoffChannel[1], SOL_SOCKET, SO_SNDTIMEO,
+					   (char *) &tv, sizeof(tv)) < 0)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("setsockopt(SO_SNDTIMEO) failed: %m")));
+	}
+#else
+	ereport(LOG,
+			(errmsg("session pooling is not supported on this platform")));
+#endif
+}
+
+/*
+ * StartSessionProxy
+ *
+ *	Called from postmaster at startup or after an existing proxy died.
+ *	Attempt to fire up a fresh session proxy process.
+ *
+ *	Returns PID of child process, or 0 if fail.
+ *
+ *	Note: if fail, we will be called again from the postmaster main loop.
+ */
+int
+StartSessionProxy(void)
+{
+#ifdef HAVE_SESSION_PROXY
+	time_t		curtime;
+	pid_t		proxyPid;
+
+	/*
+	 * Do nothing if session pooling is off, or couldn't be set up
+	 */
+	if (SessionPoolSize <= 0 || HandoffChannel[0] == PGINVALID_SOCKET)
+		return 0;
+
+	/*
+	 * Do nothing if too soon since last proxy start.  This is a safety valve
+	 * to protect against continuous respawn attempts if the proxy is dying
+	 * immediately at launch.
+	 */
+	curtime = time(NULL);
+	if ((unsigned int) (curtime - last_proxy_start_time) <
+		(unsigned int) PROXY_RESTART_INTERVAL)
+		return 0;
+	last_proxy_start_time = curtime;
+
+	switch ((proxyPid = fork_process()))
+	{
+		case -1:
+			ereport(LOG,
+					(errmsg("could not fork session proxy: %m")));
+			return 0;
+
+		case 0:
+			/* in postmaster child ... */
+			/* Close the postmaster's sockets */
+			ClosePostmasterPorts(false);
+
+			/* Lose the postmaster's on-exit routines */
+			on_exit_reset();
+
+			/* Drop our connection to postmaster's shared memory, as well */
+			PGSharedMemoryDetach();
+
+			SessionProxyMain();
+			break;
+
+		default:
+			return (int) proxyPid;
+	}
+#endif   /* HAVE_SESSION_PROXY */
+
+	/* shouldn't get here */
+	return 0;
+}
+
+
+/* ------------------------------------------------------------
+ * Public functions called from backends follow
+ * ------------------------------------------------------------
+ */
+
+/*
+ * SessionIsPoolable
+ *
+ *	Should the session of this backend be handed over to the session proxy,
+ *	once startup is complete?
+ */
+bool
+SessionIsPoolable(void)
+{
+#ifdef HAVE_SESSION_PROXY
+	if (SessionPoolSize <= 0 || !SessionPooling ||
+		HandoffChannel[1] == PGINVALID_SOCKET)
+		return false;
+
+	/* The proxy relies on the framing of protocol 3.0 messages */
+	if (whereToSendOutput != DestRemote || MyProcPort == NULL ||
+		PG_PROTOCOL_MAJOR(FrontendProtocol) < 3)
+		return false;
+
+#ifdef USE_SSL
+	/* The SSL state of the connection can't be handed over */
+	if (MyProcPort->ssl != NULL)
+		return false;
+#endif
+
+	/* Nor can the state of a compressed stream */
+	if (MyProcPort->compression > 0)
+		return false;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * SessionProxyHandoff
+ *
+ *	Hand the client connection over to the session proxy, and continue as a
+ *	pooled backend talking to the proxy.  Must be called when the client is
+ *	waiting for a response to ReadyForQuery, with all output flushed.
+ *
+ *	Returns true if the session was handed over.  Otherwise, we just go on
+ *	serving the client.
+ */
+bool
+SessionProxyHandoff(void)
+{
+#ifdef HAVE_SESSION_PROXY
+	SessionHandoff hdr;
+	StringInfoData buf;
+	const char *input;
+	int			inputlen;
+	ListCell   *lc;
+	pgsocket	pair[2];
+	int			fds[2];
+	struct msghdr msg;
+	struct iovec iov;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(sizeof(fds))];
+	}			cmsgbuf;
+	struct cmsghdr *cmsg;
+
+	if (pq_is_send_pending())
+		return false;
+
+	/*
+	 * Build the handoff message.  The pool key is made of everything from
+	 * the startup packet that may affect the session's initial state.
+	 */
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, (char *) &hdr, sizeof(hdr));
+	appendStringInfoString(&buf, MyProcPort->database_name);
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoString(&buf, MyProcPort->user_name);
+	appendStringInfoChar(&buf, '\0');
+	if (MyProcPort->cmdline_options)
+		appendStringInfoString(&buf, MyProcPort->cmdline_options);
+	appendStringInfoChar(&buf, '\0');
+	foreach(lc, MyProcPort->guc_options)
+	{
+		appendStringInfoString(&buf, (char *) lfirst(lc));
+		appendStringInfoChar(&buf, '\0');
+	}
+	hdr.pid = MyProcPid;
+	hdr.keylen = buf.len - sizeof(hdr);
+	inputlen = pq_peekbufferedinput(&input);
+	hdr.inputlen = inputlen;
+	appendBinaryStringInfo(&buf, input, inputlen);
+	memcpy(buf.data, &hdr, sizeof(hdr));
+
+	if (buf.len > HANDOFF_MAX_SIZE)
+	{
+		pfree(buf.data);
+		return false;
+	}
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for session handoff: %m")));
+		pfree(buf.data);
+		return false;
+	}
+
+	/* Send it, along with the client's socket and the proxy's end */
+	fds[0] = MyProcPort->sock;
+	fds[1] = pair[0];
+
+	MemSet(&msg, 0, sizeof(msg));
+	iov.iov_base = buf.data;
+	iov.iov_len = buf.len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cmsgbuf.buf;
+	msg.msg_controllen = sizeof(cmsgbuf.buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	if (sendmsg(HandoffChannel[1], &msg, 0) != buf.len)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not hand session over to session proxy: %m")));
+		closesocket(pair[0]);
+		closesocket(pair[1]);
+		pfree(buf.data);
+		return false;
+	}
+	pfree(buf.data);
+
+	/*
+	 * The proxy owns the client connection now, and the buffered input went
+	 * with it.  From now on, our client is the proxy, on a local socket.
+	 */
+	closesocket(pair[0]);
+	closesocket(MyProcPort->sock);
+	MyProcPort->sock = pair[1];
+	MyProcPort->noblock = false;
+	MyProcPort->laddr.addr.ss_family = AF_UNIX;
+	MyProcPort->raddr.addr.ss_family = AF_UNIX;
+	if (inputlen > 0)
+		(void) pq_discardbytes(inputlen);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+#ifdef HAVE_SESSION_PROXY
+
+/* ------------------------------------------------------------
+ * Local functions called by the session proxy follow
+ * ------------------------------------------------------------
+ */
+
+/*
+ * SessionProxyMain
+ *
+ *	Main entry point for the session proxy process.
+ */
+static void
+SessionProxyMain(void)
+{
+	IsUnderPostmaster = true;	/* we are a postmaster subprocess now */
+
+	MyProcPid = getpid();		/* reset MyProcPid */
+
+	MyStartTime = time(NULL);	/* record Start Time for logging */
+
+	/*
+	 * If possible, make this process a group leader, so that the postmaster
+	 * can signal any child processes too.
+	 */
+#ifdef HAVE_SETSID
+	if (setsid() < 0)
+		elog(FATAL, "setsid() failed: %m");
+#endif
+
+	/*
+	 * Ignore all signals usually bound to some action in the postmaster,
+	 * except for SIGHUP, SIGTERM, SIGUSR2 and SIGQUIT.
+	 */
+	pqsignal(SIGHUP, ProxySigHupHandler);
+	pqsignal(SIGINT, SIG_IGN);
+	pqsignal(SIGTERM, ProxySigTermHandler);
+	pqsignal(SIGQUIT, proxy_exit);
+	pqsignal(SIGALRM, SIG_IGN);
+	pqsignal(SIGPIPE, SIG_IGN);
+	pqsignal(SIGUSR1, SIG_IGN);
+	pqsignal(SIGUSR2, ProxySigUsr2Handler);
+	pqsignal(SIGCHLD, SIG_DFL);
+	pqsignal(SIGTTIN, SIG_DFL);
+	pqsignal(SIGTTOU, SIG_DFL);
+	pqsignal(SIGCONT, SIG_DFL);
+	pqsignal(SIGWINCH, SIG_DFL);
+	PG_SETMASK(&UnBlockSig);
+
+	/*
+	 * Identify myself via ps
+	 */
+	init_ps_display("session proxy process", "", "", "");
+
+	/* We only receive handoffs; backends keep the sending end */
+	closesocket(HandoffChannel[1]);
+	HandoffChannel[1] = PGINVALID_SOCKET;
+	if (!pg_set_noblock(HandoffChannel[0]))
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg("could not set session handoff channel to nonblocking mode: %m")));
+
+	proxy_MainLoop();
+
+	exit(0);
+}
+
+/* SIGQUIT signal handler for session proxy process */
+static void
+proxy_exit(SIGNAL_ARGS)
+{
+	/* SIGQUIT means curl up and die ... */
+	exit(1);
+}
+
+/* SIGHUP signal handler for session proxy process */
+static void
+ProxySigHupHandler(SIGNAL_ARGS)
+{
+	/* set flag to re-read config file at next convenient time */
+	got_SIGHUP = true;
+}
+
+/* SIGTERM signal handler for session proxy process */
+static void
+ProxySigTermHandler(SIGNAL_ARGS)
+{
+	/*
+	 * The postmaster is shutting down.  Keep serving the clients we have as
+	 * long as their pools have backends, then exit.
+	 */
+	got_SIGTERM = true;
+}
+
+/* SIGUSR2 signal handler for session proxy process */
+static void
+ProxySigUsr2Handler(SIGNAL_ARGS)
+{
+	/* All backends are gone; time to go */
+	ready_to_stop = true;
+}
+
+/*
+ * proxy_MainLoop
+ *
+ * Wait for traffic on the handoff channel and on all the connections of the
+ * proxy, and handle it.
+ */
+static void
+proxy_MainLoop(void)
+{
+	struct pollfd *pfds = NULL;
+	int			maxpfds = 0;
+
+	for (;;)
+	{
+		int			npfds;
+		int			nscan;
+		int			rc;
+		int			i;
+
+		/* Check for config update */
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		if (got_SIGTERM && !draining)
+		{
+			draining = true;
+			ereport(DEBUG1,
+					(errmsg("session proxy shutting down")));
+		}
+
+		/*
+		 * Emergency bailout if postmaster has died.  This is to avoid the
+		 * necessity for manual cleanup of all postmaster children.
+		 */
+		if (!PostmasterIsAlive())
+			exit(1);
+
+		if (ready_to_stop)
+			break;
+
+		proxy_sweep();
+
+		/* Build the poll set: the handoff channel, then every connection */
+		if (maxpfds < nchannels + 1)
+		{
+			maxpfds = Max(nchannels + 1, 2 * maxpfds);
+			if (pfds)
+				pfree(pfds);
+			pfds = (struct pollfd *)
+				MemoryContextAlloc(TopMemoryContext,
+								   maxpfds * sizeof(struct pollfd));
+		}
+		pfds[0].fd = HandoffChannel[0];
+		pfds[0].events = POLLIN;
+		pfds[0].revents = 0;
+		npfds = 1;
+		for (i = 0; i < nchannels; i++)
+		{
+			ProxyChannel *ch = channels[i];
+
+			pfds[npfds].fd = ch->sock;
+			pfds[npfds].events = 0;
+			if (proxy_wants_read(ch))
+				pfds[npfds].events |= POLLIN;
+			if (ch->outlen > 0)
+				pfds[npfds].events |= POLLOUT;
+			pfds[npfds].revents = 0;
+			npfds++;
+		}
+
+		rc = poll(pfds, npfds, PROXY_POLL_TIMEOUT);
+		if (rc < 0)
+		{
+			if (errno != EINTR)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("poll() failed in session proxy: %m")));
+			continue;
+		}
+		if (rc == 0)
+			continue;
+
+		/*
+		 * Handle the events.  Channels created meanwhile are added at the end
+		 * of the array, and channels are only removed by proxy_sweep(), so
+		 * the poll set stays in step with the array.
+		 */
+		nscan = npfds - 1;
+		for (i = 0; i < nscan; i++)
+		{
+			ProxyChannel *ch = channels[i];
+			short		revents = pfds[i + 1].revents;
+
+			if (ch->dead || revents == 0)
+				continue;
+
+			if (revents & POLLOUT)
+			{
+				proxy_flush(ch);
+				if (ch->dead)
+					continue;
+			}
+
+			if ((revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+				continue;
+
+			/* A client sending a new request needs a backend first */
+			if (!ch->is_backend && ch->peer == NULL)
+			{
+				if (ch->waiting)
+				{
+					/* can't read its request yet, but it may have gone away */
+					if (revents & (POLLHUP | POLLERR))
+						proxy_drop_client(ch);
+					continue;
+				}
+				proxy_attach(ch);
+				if (ch->dead || ch->peer == NULL)
+					continue;
+			}
+
+			if (proxy_wants_read(ch))
+				proxy_read(ch);
+			else if (revents & (POLLHUP | POLLERR))
+				proxy_drop(ch);
+		}
+
+		if (pfds[0].revents & POLLIN)
+			proxy_accept_handoffs();
+	}
+}
+
+/*
+ * proxy_accept_handoffs
+ *
+ * Adopt the sessions that backends have handed over to us.
+ */
+static void
+proxy_accept_handoffs(void)
+{
+	for (;;)
+	{
+		SessionHandoff hdr;
+		struct msghdr msg;
+		struct iovec iov;
+		union
+		{
+			struct cmsghdr hdr;
+			char		buf[CMSG_SPACE(2 * sizeof(int))];
+		}			cmsgbuf;
+		struct cmsghdr *cmsg;
+		int			fds[2];
+		int			nfds = 0;
+		ssize_t		len;
+		int			i;
+
+		MemSet(&msg, 0, sizeof(msg));
+		iov.iov_base = handoff_buffer;
+		iov.iov_len = sizeof(handoff_buffer);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgbuf.buf;
+		msg.msg_controllen = sizeof(cmsgbuf.buf);
+
+		len = recvmsg(HandoffChannel[0], &msg, 0);
+		if (len < 0)
+		{
+			if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("could not receive session handoff: %m")));
+			return;
+		}
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+			 cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			int		   *cfds;
+			int			ncfds;
+
+			if (cmsg->cmsg_level != SOL_SOCKET ||
+				cmsg->cmsg_type != SCM_RIGHTS)
+				continue;
+			cfds = (int *) CMSG_DATA(cmsg);
+			ncfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for (i = 0; i < ncfds; i++)
+			{
+				if (nfds < 2)
+					fds[nfds++] = cfds[i];
+				else
+					closesocket(cfds[i]);
+			}
+		}
+
+		if (len >= sizeof(hdr))
+			memcpy(&hdr, handoff_buffer, sizeof(hdr));
+		if (nfds != 2 || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+			len < sizeof(hdr) || hdr.keylen < 0 || hdr.inputlen < 0 ||
+			len != sizeof(hdr) + hdr.keylen + hdr.inputlen)
+		{
+			ereport(LOG,
+					(errmsg("invalid session handoff message")));
+			for (i = 0; i < nfds; i++)
+				closesocket(fds[i]);
+			continue;
+		}
+
+		proxy_adopt_session(&hdr,
+							handoff_buffer + sizeof(hdr),
+							handoff_buffer + sizeof(hdr) + hdr.keylen,
+							fds[0], fds[1]);
+	}
+}
+
+/*
+ * proxy_adopt_session
+ *
+ * Take charge of a client, and of the backend that served it so far if
+ * its pool has room for it.
+ */
+static void
+proxy_adopt_session(SessionHandoff *hdr, const char *key, const char *input,
+					pgsocket clientsock, pgsocket backendsock)
+{
+	ProxyPool  *pool;
+	ProxyChannel *client;
+
+	if (!pg_set_noblock(clientsock) || !pg_set_noblock(backendsock))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+		closesocket(clientsock);
+		closesocket(backendsock);
+		return;
+	}
+
+	pool = proxy_get_pool(key, hdr->keylen);
+	client = proxy_new_channel(clientsock, false, pool);
+	client->session_id = next_session_id++;
+	if (next_session_id == 0)
+		next_session_id = 1;
+	pool->nclients++;
+	if (hdr->inputlen > 0)
+	{
+		client->early_input = MemoryContextAlloc(TopMemoryContext,
+												 hdr->inputlen);
+		memcpy(client->early_input, input, hdr->inputlen);
+		client->early_len = hdr->inputlen;
+	}
+
+	if (pool->nbackends < SessionPoolSize)
+	{
+		ProxyChannel *backend;
+
+		backend = proxy_new_channel(backendsock, true, pool);
+		backend->pid = hdr->pid;
+		backend->txn_status = 'I';
+		backend->last_session = client->session_id;
+		pool->nbackends++;
+		client->last_pid = hdr->pid;
+
+		/* If the client has a request already, the backend is for it */
+		if (client->early_len > 0)
+		{
+			backend->next = pool->idle;
+			pool->idle = backend;
+		}
+		else
+			proxy_backend_idle(backend);
+	}
+	else
+	{
+		/* Pool is full; tell the backend to exit */
+		static const char terminate[5] = {'X', 0, 0, 0, 4};
+
+		(void) send(backendsock, terminate, sizeof(terminate), 0);
+		closesocket(backendsock);
+	}
+
+	if (client->early_len > 0)
+		proxy_attach(client);
+}
+
+/*
+ * proxy_get_pool
+ *
+ * Find the pool having the given key, creating it if needed.
+ */
+static ProxyPool *
+proxy_get_pool(const char *key, int keylen)
+{
+	ProxyPool  *pool;
+
+	for (pool = pools; pool != NULL; pool = pool->next)
+	{
+		if (pool->keylen == keylen && memcmp(pool->key, key, keylen) == 0)
+			return pool;
+	}
+
+	pool = (ProxyPool *) MemoryContextAllocZero(TopMemoryContext,
+												sizeof(ProxyPool));
+	pool->key = MemoryContextAlloc(TopMemoryContext, Max(keylen, 1));
+	memcpy(pool->key, key, keylen);
+	pool->keylen = keylen;
+	pool->next = pools;
+	pools = pool;
+	return pool;
+}
+
+/*
+ * proxy_new_channel
+ *
+ * Register a new connection of the proxy.
+ */
+static ProxyChannel *
+proxy_new_channel(pgsocket sock, bool is_backend, ProxyPool *pool)
+{
+	ProxyChannel *ch;
+
+	if (nchannels >= maxchannels)
+	{
+		maxchannels = Max(64, 2 * maxchannels);
+		if (channels)
+			channels = (ProxyChannel **)
+				repalloc(channels, maxchannels * sizeof(ProxyChannel *));
+		else
+			channels = (ProxyChannel **)
+				MemoryContextAlloc(TopMemoryContext,
+								   maxchannels * sizeof(ProxyChannel *));
+	}
+
+	ch = (ProxyChannel *) MemoryContextAllocZero(TopMemoryContext,
+												 sizeof(ProxyChannel));
+	ch->sock = sock;
+	ch->is_backend = is_backend;
+	ch->pool = pool;
+	channels[nchannels++] = ch;
+	return ch;
+}
+
+/*
+ * proxy_wants_read
+ *
+ * Should we read from this connection now?
+ */
+static bool
+proxy_wants_read(ProxyChannel *ch)
+{
+	if (ch->dead || ch->closing)
+		return false;
+
+	/* don't read more than its peer can take */
+	if (ch->peer)
+		return ch->peer->outlen == 0;
+
+	/*
+	 * Idle backends are read from to notice their exit; what they may send
+	 * meanwhile has nobody to go to.  Clients without a backend are waited
+	 * on until they send a request, unless they are queued already.
+	 */
+	return ch->is_backend || !ch->waiting;
+}
+
+/*
+ * proxy_read
+ *
+ * Read from a connection, and pass the data on to its peer.
+ */
+static void
+proxy_read(ProxyChannel *ch)
+{
+	ProxyChannel *backend;
+	int			len;
+	int			start;
+	int			fwd;
+
+	len = recv(ch->sock, proxy_buffer, sizeof(proxy_buffer), 0);
+	if (len < 0 &&
+		(errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+		return;
+	if (len <= 0)
+	{
+		/* connection closed or broken */
+		proxy_drop(ch);
+		return;
+	}
+
+	fwd = proxy_scan(ch, proxy_buffer, len, &start);
+	if (fwd < 0)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid message framing on pooled session")));
+		proxy_drop(ch);
+		return;
+	}
+
+	if (ch->peer && fwd > start)
+		proxy_send(ch->peer, proxy_buffer + start, fwd - start);
+	if (ch->dead)
+		return;
+
+	if (ch->closing)
+	{
+		proxy_drop_client(ch);
+		return;
+	}
+
+	/* If the session has reached a transaction boundary, free the backend */
+	backend = ch->is_backend ? ch : ch->peer;
+	if (backend && backend->peer && proxy_session_idle(backend))
+		proxy_release(backend);
+}
+
+/*
+ * proxy_scan
+ *
+ * Follow the framing of the messages read from a connection, keeping track
+ * of the state of the session it is part of.  The bytes to pass on to the
+ * peer are those from *start up to the return value: everything, except that
+ * a client's Terminate message and a backend's answers to our own reset
+ * queries are swallowed.  Returns -1 if the framing is broken.
+ */
+static int
+proxy_scan(ProxyChannel *ch, const char *data, int len, int *start)
+{
+	int			pos = 0;
+
+	*start = 0;
+
+	while (pos < len)
+	{
+		if (ch->hdr_len < sizeof(ch->hdr))
+		{
+			/* Message type, or part of the message length */
+			if (ch->hdr_len == 0 && !ch->is_backend)
+			{
+				if (data[pos] == 'X')
+				{
+					/* Terminate: the client is leaving */
+					ch->closing = true;
+					return pos;
+				}
+				proxy_client_message(ch, data[pos]);
+			}
+			ch->hdr[ch->hdr_len++] = data[pos++];
+			if (ch->hdr_len == sizeof(ch->hdr))
+			{
+				uint32		msglen;
+
+				memcpy(&msglen, ch->hdr + 1, 4);
+				msglen = ntohl(msglen);
+				if (msglen < 4)
+					return -1;
+				ch->remaining = msglen - 4;
+				if (ch->remaining == 0)
+					ch->hdr_len = 0;
+			}
+		}
+		else
+		{
+			/* Message body */
+			uint32		amount = Min((uint32) (len - pos), ch->remaining);
+
+			/* ReadyForQuery carries the transaction status */
+			if (ch->is_backend && ch->hdr[0] == 'Z' && amount > 0)
+				ch->txn_status = data[pos];
+			pos += amount;
+			ch->remaining -= amount;
+			if (ch->remaining == 0)
+			{
+				ch->hdr_len = 0;
+				if (ch->is_backend && ch->hdr[0] == 'Z')
+				{
+					if (ch->resetting > 0)
+					{
+						/* the reset queries' answers end here */
+						ch->resetting--;
+						*start = pos;
+					}
+					else if (ch->pending > 0)
+						ch->pending--;
+				}
+			}
+		}
+	}
+
+	/* Still answering the reset queries? */
+	if (ch->is_backend && ch->resetting > 0)
+		*start = len;
+
+	return len;
+}
+
+/*
+ * proxy_client_message
+ *
+ * Account for a message sent by a client to its backend.
+ */
+static void
+proxy_client_message(ProxyChannel *client, char msgtype)
+{
+	ProxyChannel *backend = client->peer;
+
+	if (backend == NULL)
+		return;
+
+	switch (msgtype)
+	{
+		case 'Q':				/* Query */
+		case 'F':				/* FunctionCall */
+			/* answered by ReadyForQuery */
+			backend->pending++;
+			break;
+		case 'S':				/* Sync */
+			/* answered by ReadyForQuery, completing extended messages */
+			backend->pending++;
+			backend->unsynced = false;
+			break;
+		case 'd':				/* CopyData */
+		case 'c':				/* CopyDone */
+		case 'f':				/* CopyFail */
+			/* part of a COPY started by an earlier request */
+			break;
+		default:
+			/* Parse, Bind, Execute, ...: only completed by a Sync */
+			backend->unsynced = true;
+			break;
+	}
+}
+
+/*
+ * proxy_send
+ *
+ * Write data to a connection, queueing what can't be written right away.
+ */
+static void
+proxy_send(ProxyChannel *ch, const char *data, int len)
+{
+	if (ch->outlen == 0)
+	{
+		while (len > 0)
+		{
+			int			n = send(ch->sock, data, len, 0);
+
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					break;
+				proxy_drop(ch);
+				return;
+			}
+			data += n;
+			len -= n;
+		}
+		if (len == 0)
+			return;
+	}
+
+	/* Queue the rest */
+	if (ch->outbuf == NULL)
+	{
+		ch->outbuf = MemoryContextAlloc(TopMemoryContext, len);
+		memcpy(ch->outbuf, data, len);
+		ch->outstart = 0;
+		ch->outlen = len;
+	}
+	else
+	{
+		char	   *buf = MemoryContextAlloc(TopMemoryContext,
+											 ch->outlen + len);
+
+		memcpy(buf, ch->outbuf + ch->outstart, ch->outlen);
+		memcpy(buf + ch->outlen, data, len);
+		pfree(ch->outbuf);
+		ch->outbuf = buf;
+		ch->outstart = 0;
+		ch->outlen += len;
+	}
+}
+
+/*
+ * proxy_flush
+ *
+ * Write queued data to a connection that has become writable.
+ */
+static void
+proxy_flush(ProxyChannel *ch)
+{
+	while (ch->outlen > 0)
+	{
+		int			n = send(ch->sock, ch->outbuf + ch->outstart,
+							 ch->outlen, 0);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			proxy_drop(ch);
+			return;
+		}
+		ch->outstart += n;
+		ch->outlen -= n;
+	}
+
+	pfree(ch->outbuf);
+	ch->outbuf = NULL;
+	ch->outstart = 0;
+
+	/* A backend may have been waiting for its client's last bytes */
+	if (ch->is_backend && ch->peer && proxy_session_idle(ch))
+		proxy_release(ch);
+}
+
+/*
+ * proxy_session_idle
+ *
+ * Is the session being served by this backend at a transaction boundary,
+ * so that the backend can serve another client?
+ */
+static bool
+proxy_session_idle(ProxyChannel *backend)
+{
+	ProxyChannel *client = backend->peer;
+
+	return backend->pending == 0 && !backend->unsynced &&
+		backend->txn_status == 'I' &&
+		backend->hdr_len == 0 && backend->outlen == 0 &&
+		(client == NULL || client->hdr_len == 0);
+}
+
+/*
+ * proxy_attach
+ *
+ * Find a backend for a client that has a request to send, or queue the
+ * client until a backend becomes free.
+ */
+static void
+proxy_attach(ProxyChannel *client)
+{
+	ProxyPool  *pool = client->pool;
+	ProxyChannel **link;
+	ProxyChannel **found = NULL;
+
+	/* Prefer the backend the client used last */
+	for (link = &pool->idle; *link != NULL; link = &(*link)->next)
+	{
+		if ((*link)->hdr_len != 0)
+			continue;			/* in the middle of an unsolicited message */
+		if (found == NULL || (*link)->pid == client->last_pid)
+			found = link;
+		if ((*link)->pid == client->last_pid)
+			break;
+	}
+
+	if (found == NULL)
+	{
+		if (pool->nbackends == 0)
+		{
+			proxy_fail_client(client, ERRCODE_CONNECTION_FAILURE,
+							  _("no server process is available for the pooled session"));
+			return;
+		}
+		client->waiting = true;
+		client->next = NULL;
+		if (pool->waiting_tail)
+			pool->waiting_tail->next = client;
+		else
+			pool->waiting_head = client;
+		pool->waiting_tail = client;
+		return;
+	}
+
+	{
+		ProxyChannel *backend = *found;
+
+		*found = backend->next;
+		backend->next = NULL;
+		proxy_connect(client, backend);
+	}
+}
+
+/*
+ * proxy_connect
+ *
+ * Let a backend serve a client.
+ */
+static void
+proxy_connect(ProxyChannel *client, ProxyChannel *backend)
+{
+	client->peer = backend;
+	client->last_pid = backend->pid;
+	backend->peer = client;
+	backend->pending = 0;
+	backend->unsynced = false;
+
+	/* Don't let the session see what another one left behind */
+	if (backend->last_session != client->session_id)
+	{
+		backend->last_session = client->session_id;
+		proxy_reset_backend(backend);
+		if (backend->dead)
+			return;
+	}
+
+	/* Pass on what the backend that handed the session over had received */
+	if (client->early_input)
+	{
+		char	   *input = client->early_input;
+		int			len = client->early_len;
+		int			start;
+		int			fwd;
+
+		client->early_input = NULL;
+		client->early_len = 0;
+		fwd = proxy_scan(client, input, len, &start);
+		if (fwd < 0)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("invalid message framing on pooled session")));
+			proxy_drop_client(client);
+		}
+		else if (fwd > 0)
+			proxy_send(backend, input, fwd);
+		pfree(input);
+
+		if (!client->dead && client->closing)
+			proxy_drop_client(client);
+	}
+}
+
+/*
+ * proxy_reset_backend
+ *
+ * Send a backend the queries that discard the state a session may have left
+ * in it: what DISCARD ALL covers (settings, prepared statements, cursors,
+ * temporary tables, LISTEN registrations), plus session-level advisory
+ * locks.  They are sent ahead of the new session's requests, and their
+ * answers are swallowed by proxy_scan(), also if the backend has gone back
+ * to the pool meanwhile because the client left without sending anything.
+ * DISCARD ALL can't be combined with another statement in one query string,
+ * so these are two queries.
+ */
+static void
+proxy_reset_backend(ProxyChannel *backend)
+{
+	static const char *const reset_queries[] = {
+		"DISCARD ALL",
+		"SELECT pg_catalog.pg_advisory_unlock_all()"
+	};
+	StringInfoData buf;
+	int			i;
+
+	initStringInfo(&buf);
+	for (i = 0; i < lengthof(reset_queries); i++)
+	{
+		uint32		msglen = htonl(4 + strlen(reset_queries[i]) + 1);
+
+		appendStringInfoChar(&buf, 'Q');
+		appendBinaryStringInfo(&buf, (char *) &msglen, 4);
+		appendStringInfoString(&buf, reset_queries[i]);
+		appendStringInfoChar(&buf, '\0');
+	}
+	backend->resetting += lengthof(reset_queries);
+	proxy_send(backend, buf.data, buf.len);
+	pfree(buf.data);
+}
+
+/*
+ * proxy_release
+ *
+ * Detach a backend from its client, at a transaction boundary.
+ */
+static void
+proxy_release(ProxyChannel *backend)
+{
+	ProxyChannel *client = backend->peer;
+
+	client->peer = NULL;
+	backend->peer = NULL;
+	proxy_backend_idle(backend);
+}
+
+/*
+ * proxy_backend_idle
+ *
+ * Give a free backend to the next waiting client, or put it in the idle list
+ * of its pool.
+ */
+static void
+proxy_backend_idle(ProxyChannel *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	if (draining && pool->nclients == 0)
+	{
+		proxy_drop_backend(backend, true);
+		return;
+	}
+
+	if (pool->waiting_head)
+	{
+		ProxyChannel *client = pool->waiting_head;
+
+		pool->waiting_head = client->next;
+		if (pool->waiting_head == NULL)
+			pool->waiting_tail = NULL;
+		client->next = NULL;
+		client->waiting = false;
+		proxy_connect(client, backend);
+		return;
+	}
+
+	backend->next = pool->idle;
+	pool->idle = backend;
+}
+
+/*
+ * proxy_drop
+ *
+ * Close a connection that was closed or broken by the other side.
+ */
+static void
+proxy_drop(ProxyChannel *ch)
+{
+	if (ch->is_backend)
+		proxy_drop_backend(ch, false);
+	else
+		proxy_drop_client(ch);
+}
+
+/*
+ * proxy_drop_client
+ *
+ * Close a client connection.  Its backend goes back to the pool if it is at
+ * a transaction boundary; otherwise it has to go, too.
+ */
+static void
+proxy_drop_client(ProxyChannel *client)
+{
+	ProxyPool  *pool = client->pool;
+
+	if (client->dead)
+		return;
+
+	pool->nclients--;
+
+	if (client->waiting)
+	{
+		ProxyChannel **link;
+		ProxyChannel *prev = NULL;
+
+		for (link = &pool->waiting_head; *link != NULL; link = &(*link)->next)
+		{
+			if (*link == client)
+			{
+				*link = client->next;
+				break;
+			}
+			prev = *link;
+		}
+		if (pool->waiting_tail == client)
+			pool->waiting_tail = prev;
+		client->waiting = false;
+	}
+
+	proxy_close_channel(client);
+
+	if (client->peer)
+	{
+		ProxyChannel *backend = client->peer;
+		bool		idle = proxy_session_idle(backend);
+
+		client->peer = NULL;
+		backend->peer = NULL;
+		if (idle)
+			proxy_backend_idle(backend);
+		else
+			proxy_drop_backend(backend, false);
+	}
+}
+
+/*
+ * proxy_drop_backend
+ *
+ * Close a backend connection, which makes the backend exit.  If terminate is
+ * true, the backend is idle and is told to exit properly.  A client it was
+ * serving loses its connection.
+ */
+static void
+proxy_drop_backend(ProxyChannel *backend, bool terminate)
+{
+	ProxyPool  *pool = backend->pool;
+
+	if (backend->dead)
+		return;
+
+	pool->nbackends--;
+
+	if (backend->peer == NULL)
+	{
+		ProxyChannel **link;
+
+		for (link = &pool->idle; *link != NULL; link = &(*link)->next)
+		{
+			if (*link == backend)
+			{
+				*link = backend->next;
+				break;
+			}
+		}
+	}
+
+	if (terminate && backend->outlen == 0)
+	{
+		static const char terminate_msg[5] = {'X', 0, 0, 0, 4};
+
+		(void) send(backend->sock, terminate_msg, sizeof(terminate_msg), 0);
+	}
+	proxy_close_channel(backend);
+
+	if (backend->peer)
+	{
+		ProxyChannel *client = backend->peer;
+
+		client->peer = NULL;
+		backend->peer = NULL;
+		proxy_drop_client(client);
+	}
+}
+
+/*
+ * proxy_fail_client
+ *
+ * Send a client waiting for a backend a FATAL error, and close it.
+ */
+static void
+proxy_fail_client(ProxyChannel *client, int sqlerrcode, const char *message)
+{
+	StringInfoData buf;
+	uint32		msglen;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, 'E');
+	appendBinaryStringInfo(&buf, "\0\0\0\0", 4);
+	appendStringInfoChar(&buf, PG_DIAG_SEVERITY);
+	appendStringInfoString(&buf, "FATAL");
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_SQLSTATE);
+	appendStringInfoString(&buf, unpack_sql_state(sqlerrcode));
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_MESSAGE_PRIMARY);
+	appendStringInfoString(&buf, message);
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, '\0');
+	msglen = htonl(buf.len - 1);
+	memcpy(buf.data + 1, &msglen, 4);
+
+	/* best effort; proxy_close_channel() makes a last attempt to write */
+	proxy_send(client, buf.data, buf.len);
+	pfree(buf.data);
+
+	proxy_drop_client(client);
+}
+
+/*
+ * proxy_close_channel
+ *
+ * Close the socket of a connection, after a last attempt to write what is
+ * queued for it.  The channel itself is freed by proxy_sweep().
+ */
+static void
+proxy_close_channel(ProxyChannel *ch)
+{
+	if (ch->dead)
+		return;
+
+	if (ch->outlen > 0)
+		(void) send(ch->sock, ch->outbuf + ch->outstart, ch->outlen, 0);
+
+	/*
+	 * Swallow whatever the peer sent that we have not read: closing a socket
+	 * with unread input resets the connection, and the reset can overtake
+	 * the error message we just queued.
+	 */
+	for (;;)
+	{
+		char		junk[1024];
+
+		if (recv(ch->sock, junk, sizeof(junk), 0) <= 0)
+			break;
+	}
+	closesocket(ch->sock);
+	ch->sock = PGINVALID_SOCKET;
+	ch->dead = true;
+	ch->closing = false;
+}
+
+/*
+ * proxy_sweep
+ *
+ * Periodic housekeeping: fail the clients that no backend can serve anymore,
+ * and free closed connections and unused pools.  While shutting down, also
+ * close the backends that no client needs anymore.
+ */
+static void
+proxy_sweep(void)
+{
+	ProxyPool **link;
+	int			i;
+	int			j;
+
+	for (i = 0; i < nchannels; i++)
+	{
+		ProxyChannel *ch = channels[i];
+
+		if (ch->dead || ch->is_backend || ch->peer != NULL ||
+			ch->pool->nbackends > 0)
+			continue;
+		if (draining)
+			proxy_fail_client(ch, ERRCODE_ADMIN_SHUTDOWN,
+							  _("terminating connection due to administrator command"));
+		else if (ch->waiting)
+			proxy_fail_client(ch, ERRCODE_CONNECTION_FAILURE,
+							  _("no server process is available for the pooled session"));
+	}
+
+	if (draining)
+	{
+		ProxyPool  *pool;
+
+		for (pool = pools; pool != NULL; pool = pool->next)
+		{
+			while (pool->nclients == 0 && pool->idle != NULL)
+				proxy_drop_backend(pool->idle, true);
+		}
+	}
+
+	for (i = 0, j = 0; i < nchannels; i++)
+	{
+		ProxyChannel *ch = channels[i];
+
+		if (ch->dead)
+		{
+			if (ch->outbuf)
+				pfree(ch->outbuf);
+			if (ch->early_input)
+				pfree(ch->early_input);
+			pfree(ch);
+		}
+		else
+			channels[j++] = ch;
+	}
+	nchannels = j;
+
+	link = &pools;
+	while (*link != NULL)
+	{
+		ProxyPool  *pool = *link;
+
+		if (pool->nclients == 0 && pool->nbackends == 0)
+		{
+			*link = pool->next;
+			pfree(pool->key);
+			pfree(pool);
+		}
+		else
+			link = &pool->next;
+	}
+}
+
+#endif   /* HAVE_SESSION_PROXY */
@@ -17,7 +17,9 @@
 #include <unistd.h>
 #include <time.h>
 
+#include "access/hash.h"
 #include "access/xlog_internal.h"		/* for pg_start/stop_backup */
+#include "catalog/catalog.h"
 #include "catalog/pg_type.h"
 #include "lib/stringinfo.h"
 #include "libpq/libpq.h"
@@ -26,6 +28,7 @@
 #include "replication/basebackup.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
+#include "storage/bufpage.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/builtins.h"
@@ -40,12 +43,18 @@ typedef struct
 	bool		fastcheckpoint;
 	bool		nowait;
 	bool		includewal;
+	XLogRecPtr	incremental;	/* send only blocks changed since this */
+	int			shard;			/* send only files of this shard... */
+	int			nshards;		/* ...out of this many (0 = all files) */
 } basebackup_options;
 
 
 static int64 sendDir(char *path, int basepathlen, bool sizeonly);
 static void sendFile(char *readfilename, char *tarfilename,
 		 struct stat * statbuf);
+static void sendIncrementalFile(char *readfilename, char *tarfilename,
+					struct stat * statbuf);
+static bool is_relation_main_fork(const char *path);
 static void sendFileWithContent(const char *filename, const char *content);
 static void _tarWriteHeader(const char *filename, const char *linktarget,
 				struct stat * statbuf);
@@ -53,7 +62,13 @@ static void send_int8_string(StringInfoData *buf, int64 intval);
 static void SendBackupHeader(List *tablespaces);
 static void base_backup_cleanup(int code, Datum arg);
 static void perform_base_backup(basebackup_options *opt, DIR *tblspcdir);
-static void parse_basebackup_options(List *options, basebackup_options *opt);
+static void perform_start_backup(basebackup_options *opt, DIR *tblspcdir);
+static void perform_send_files(basebackup_options *opt, DIR *tblspcdir);
+static void perform_stop_backup(basebackup_options *opt);
+static List *collect_tablespaces(DIR *tblspcdir, bool sizes);
+static void backup_session_cleanup(int code, Datum arg);
+static void parse_basebackup_options(BaseBackupKind kind, List *options,
+						 basebackup_options *opt);
 static void SendXlogRecPtrResult(XLogRecPtr ptr);
 
 /*
@@ -70,6 +85,22 @@ typedef struct
 	int64		size;
 } tablespaceinfo;
 
+/*
+ * Which files and blocks sendDir() sends, set from the options of the
+ * current command.
+ */
+static XLogRecPtr incremental_lsn;	/* if valid, send changed blocks only */
+static int	backup_shard;
+static int	backup_nshards;
+
+/*
+ * backup_label contents of the backup begun by START_BACKUP in this session,
+ * or NULL if none is in progress.  Kept in TopMemoryContext until
+ * STOP_BACKUP, or aborted by backup_session_cleanup() when the session ends.
+ */
+static char *session_labelfile = NULL;
+static bool session_cleanup_registered = false;
+
 
 /*
  * Called when ERROR or FATAL happens in perform_base_backup() after
@@ -81,6 +112,86 @@ base_backup_cleanup(int code, Datum arg)
 	do_pg_abort_backup();
 }
 
+/*
+ * Called at backend exit, to end a backup begun by START_BACKUP that was
+ * never stopped.
+ */
+static void
+backup_session_cleanup(int code, Datum arg)
+{
+	if (session_labelfile != NULL)
+	{
+		session_labelfile = NULL;
+		do_pg_abort_backup();
+	}
+}
+
+/*
+ * Build a list of all the tablespaces, with the main data directory last.
+ * If 'sizes' is true, also compute how much each one is going to send.
+ */
+static List *
+collect_tablespaces(DIR *tblspcdir, bool sizes)
+{
+	List	   *tablespaces = NIL;
+	struct dirent *de;
+	tablespaceinfo *ti;
+
+	while ((de = ReadDir(tblspcdir, "pg_tblspc")) != NULL)
+	{
+		char		fullpath[MAXPGPATH];
+		char		linkpath[MAXPGPATH];
+		int			rllen;
+
+		/* Skip special stuff */
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(fullpath, sizeof(fullpath), "pg_tblspc/%s", de->d_name);
+
+#if defined(HAVE_READLINK) || defined(WIN32)
+		rllen = readlink(fullpath, linkpath, sizeof(linkpath));
+		if (rllen < 0)
+		{
+			ereport(WARNING,
+					(errmsg("could not read symbolic link \"%s\": %m",
+							fullpath)));
+			continue;
+		}
+		else if (rllen >= sizeof(linkpath))
+		{
+			ereport(WARNING,
+					(errmsg("symbolic link \"%s\" target is too long",
+							fullpath)));
+			continue;
+		}
+		linkpath[rllen] = '\0';
+
+		ti = palloc(sizeof(tablespaceinfo));
+		ti->oid = pstrdup(de->d_name);
+		ti->path = pstrdup(linkpath);
+		ti->size = sizes ? sendDir(linkpath, strlen(linkpath), true) : -1;
+		tablespaces = lappend(tablespaces, ti);
+#else
+		/*
+		 * If the platform does not have symbolic links, it should not be
+		 * possible to have tablespaces - clearly somebody else created
+		 * them. Warn about it and ignore.
+		 */
+		ereport(WARNING,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("tablespaces are not supported on this platform")));
+#endif
+	}
+
+	/* Add a node for the base directory at the end */
+	ti = palloc0(sizeof(tablespaceinfo));
+	ti->size = sizes ? sendDir(".", 1, true) : -1;
+	tablespaces = lappend(tablespaces, ti);
+
+	return tablespaces;
+}
+
 /*
  * Actually do a base backup for the specified tablespaces.
  *
@@ -99,63 +210,11 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 
 	PG_ENSURE_ERROR_CLEANUP(base_backup_cleanup, (Datum) 0);
 	{
-		List	   *tablespaces = NIL;
+		List	   *tablespaces;
 		ListCell   *lc;
-		struct dirent *de;
-		tablespaceinfo *ti;
 
 		/* Collect information about all tablespaces */
-		while ((de = ReadDir(tblspcdir, "pg_tblspc")) != NULL)
-		{
-			char		fullpath[MAXPGPATH];
-			char		linkpath[MAXPGPATH];
-			int			rllen;
-
-			/* Skip special stuff */
-			if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
-				continue;
-
-			snprintf(fullpath, sizeof(fullpath), "pg_tblspc/%s", de->d_name);
-
-#if defined(HAVE_READLINK) || defined(WIN32)
-			rllen = readlink(fullpath, linkpath, sizeof(linkpath));
-			if (rllen < 0)
-			{
-				ereport(WARNING,
-						(errmsg("could not read symbolic link \"%s\": %m",
-								fullpath)));
-				continue;
-			}
-			else if (rllen >= sizeof(linkpath))
-			{
-				ereport(WARNING,
-						(errmsg("symbolic link \"%s\" target is too long",
-								fullpath)));
-				continue;
-			}
-			linkpath[rllen] = '\0';
-
-			ti = palloc(sizeof(tablespaceinfo));
-			ti->oid = pstrdup(de->d_name);
-			ti->path = pstrdup(linkpath);
-			ti->size = opt->progress ? sendDir(linkpath, strlen(linkpath), true) : -1;
-			tablespaces = lappend(tablespaces, ti);
-#else
-			/*
-			 * If the platform does not have symbolic links, it should not be
-			 * possible to have tablespaces - clearly somebody else created
-			 * them. Warn about it and ignore.
-			 */
-			ereport(WARNING,
-					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-					 errmsg("tablespaces are not supported on this platform")));
-#endif
-		}
-
-		/* Add a node for the base directory at the end */
-		ti = palloc0(sizeof(tablespaceinfo));
-		ti->size = opt->progress ? sendDir(".", 1, true) : -1;
-		tablespaces = lappend(tablespaces, ti);
+		tablespaces = collect_tablespaces(tblspcdir, opt->progress);
 
 		/* Send tablespace header */
 		SendBackupHeader(tablespaces);
@@ -274,23 +333,176 @@ perform_base_backup(basebackup_options *opt, DIR *tblspcdir)
 	SendXlogRecPtrResult(endptr);
 }
 
+/*
+ * START_BACKUP: put the system into backup mode, and leave it there until
+ * STOP_BACKUP is issued on this connection.  The files are fetched in the
+ * meantime with SEND_FILES, typically over several other connections.
+ */
+static void
+perform_start_backup(basebackup_options *opt, DIR *tblspcdir)
+{
+	XLogRecPtr	startptr;
+	char	   *labelfile;
+
+	if (session_labelfile != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a backup is already in progress in this session")));
+
+	if (!session_cleanup_registered)
+	{
+		on_shmem_exit(backup_session_cleanup, (Datum) 0);
+		session_cleanup_registered = true;
+	}
+
+	startptr = do_pg_start_backup(opt->label, opt->fastcheckpoint, &labelfile);
+	session_labelfile = MemoryContextStrdup(TopMemoryContext, labelfile);
+
+	SendXlogRecPtrResult(startptr);
+	SendBackupHeader(collect_tablespaces(tblspcdir, opt->progress));
+}
+
+/*
+ * SEND_FILES: send the tablespaces like BASE_BACKUP does, but only the share
+ * of the files selected by the SHARD option, and without backup_label or
+ * any WAL.  Directory and symbolic link entries are sent by shard 0 alone.
+ *
+ * This doesn't check that a backup is in progress; it's up to the client to
+ * bracket it with START_BACKUP and STOP_BACKUP on another connection.
+ */
+static void
+perform_send_files(basebackup_options *opt, DIR *tblspcdir)
+{
+	List	   *tablespaces;
+	ListCell   *lc;
+
+	tablespaces = collect_tablespaces(tblspcdir, opt->progress);
+	SendBackupHeader(tablespaces);
+
+	foreach(lc, tablespaces)
+	{
+		tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
+		StringInfoData buf;
+
+		/* Send CopyOutResponse message */
+		pq_beginmessage(&buf, 'H');
+		pq_sendbyte(&buf, 0);		/* overall format */
+		pq_sendint(&buf, 0, 2);		/* natts */
+		pq_endmessage(&buf);
+
+		sendDir(ti->path == NULL ? "." : ti->path,
+				ti->path == NULL ? 1 : strlen(ti->path),
+				false);
+
+		pq_putemptymessage('c');	/* CopyDone */
+	}
+}
+
+/*
+ * STOP_BACKUP: end the backup begun by START_BACKUP, sending back the end
+ * location and the backup_label file to be stored with the backup.
+ */
+static void
+perform_stop_backup(basebackup_options *opt)
+{
+	char	   *labelfile = session_labelfile;
+	XLogRecPtr	endptr;
+	StringInfoData buf;
+	char		str[MAXFNAMELEN];
+
+	if (labelfile == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("no backup is in progress in this session"),
+				 errhint("Use START_BACKUP first.")));
+
+	/* From here on, it's do_pg_stop_backup's job to clean up */
+	session_labelfile = NULL;
+	endptr = do_pg_stop_backup(labelfile, !opt->nowait);
+
+	snprintf(str, sizeof(str), "%X/%X", endptr.xlogid, endptr.xrecoff);
+
+	pq_beginmessage(&buf, 'T'); /* RowDescription */
+	pq_sendint(&buf, 2, 2);		/* 2 fields */
+
+	pq_sendstring(&buf, "recptr");
+	pq_sendint(&buf, 0, 4);		/* table oid */
+	pq_sendint(&buf, 0, 2);		/* attnum */
+	pq_sendint(&buf, TEXTOID, 4);		/* type oid */
+	pq_sendint(&buf, -1, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+
+	pq_sendstring(&buf, "backup_label");
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_sendint(&buf, TEXTOID, 4);
+	pq_sendint(&buf, -1, 2);
+	pq_sendint(&buf, 0, 4);
+	pq_sendint(&buf, 0, 2);
+	pq_endmessage(&buf);
+
+	/* Data row */
+	pq_beginmessage(&buf, 'D');
+	pq_sendint(&buf, 2, 2);		/* number of columns */
+	pq_sendint(&buf, strlen(str), 4);	/* length */
+	pq_sendbytes(&buf, str, strlen(str));
+	pq_sendint(&buf, strlen(labelfile), 4);
+	pq_sendbytes(&buf, labelfile, strlen(labelfile));
+	pq_endmessage(&buf);
+
+	/* Send a CommandComplete message */
+	pq_puttextmessage('C', "SELECT");
+
+	pfree(labelfile);
+}
+
 /*
  * Parse the base backup options passed down by the parser
  */
 static void
-parse_basebackup_options(List *options, basebackup_options *opt)
+parse_basebackup_options(BaseBackupKind kind, List *options,
+						 basebackup_options *opt)
 {
+	static const char *const cmdnames[] = {
+		"BASE_BACKUP", "START_BACKUP", "SEND_FILES", "STOP_BACKUP"
+	};
 	ListCell   *lopt;
 	bool		o_label = false;
 	bool		o_progress = false;
 	bool		o_fast = false;
 	bool		o_nowait = false;
 	bool		o_wal = false;
+	bool		o_incremental = false;
+	bool		o_shard = false;
 
 	MemSet(opt, 0, sizeof(*opt));
 	foreach(lopt, options)
 	{
 		DefElem    *defel = (DefElem *) lfirst(lopt);
+		bool		valid;
+
+		/* Which options go with which command */
+		if (strcmp(defel->defname, "label") == 0 ||
+			strcmp(defel->defname, "fast") == 0)
+			valid = (kind == BASE_BACKUP_FULL || kind == BASE_BACKUP_START);
+		else if (strcmp(defel->defname, "progress") == 0)
+			valid = (kind != BASE_BACKUP_STOP);
+		else if (strcmp(defel->defname, "nowait") == 0)
+			valid = (kind == BASE_BACKUP_FULL || kind == BASE_BACKUP_STOP);
+		else if (strcmp(defel->defname, "wal") == 0)
+			valid = (kind == BASE_BACKUP_FULL);
+		else if (strcmp(defel->defname, "incremental") == 0)
+			valid = (kind == BASE_BACKUP_FULL || kind == BASE_BACKUP_SEND_FILES);
+		else if (strcmp(defel->defname, "shard") == 0)
+			valid = (kind == BASE_BACKUP_SEND_FILES);
+		else
+			valid = true;		/* complain below */
+		if (!valid)
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("option \"%s\" is not valid for %s",
+							defel->defname, cmdnames[kind])));
 
 		if (strcmp(defel->defname, "label") == 0)
 		{
@@ -337,6 +549,39 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 			opt->includewal = true;
 			o_wal = true;
 		}
+		else if (strcmp(defel->defname, "incremental") == 0)
+		{
+			if (o_incremental)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			if (sscanf(strVal(defel->arg), "%X/%X",
+					   &opt->incremental.xlogid,
+					   &opt->incremental.xrecoff) != 2 ||
+				XLogRecPtrIsInvalid(opt->incremental))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid incremental backup location \"%s\"",
+								strVal(defel->arg))));
+			o_incremental = true;
+		}
+		else if (strcmp(defel->defname, "shard") == 0)
+		{
+			List	   *args = (List *) defel->arg;
+
+			if (o_shard)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->shard = intVal(linitial(args));
+			opt->nshards = intVal(lsecond(args));
+			if (opt->nshards < 1 || opt->shard >= opt->nshards)
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("invalid shard %d of %d",
+								opt->shard, opt->nshards)));
+			o_shard = true;
+		}
 		else
 			elog(ERROR, "option \"%s\" not recognized",
 				 defel->defname);
@@ -347,7 +592,8 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 
 
 /*
- * SendBaseBackup() - send a complete base backup.
+ * SendBaseBackup() - send a complete base backup, or execute one step of a
+ * backup split up with START_BACKUP, SEND_FILES and STOP_BACKUP.
  *
  * The function will put the system into backup mode like pg_start_backup()
  * does, so that the backup is consistent even though we read directly from
@@ -366,7 +612,11 @@ SendBaseBackup(BaseBackupCmd *cmd)
 				(errcode(ERRCODE_CANNOT_CONNECT_NOW),
 				 errmsg("recovery is still in progress, can't accept WAL streaming connections for backup")));
 
-	parse_basebackup_options(cmd->options, &opt);
+	parse_basebackup_options(cmd->kind, cmd->options, &opt);
+
+	incremental_lsn = opt.incremental;
+	backup_shard = opt.shard;
+	backup_nshards = opt.nshards;
 
 	backup_context = AllocSetContextCreate(CurrentMemoryContext,
 										   "Streaming base backup context",
@@ -381,8 +631,13 @@ SendBaseBackup(BaseBackupCmd *cmd)
 	{
 		char		activitymsg[50];
 
-		snprintf(activitymsg, sizeof(activitymsg), "sending backup \"%s\"",
-				 opt.label);
+		if (cmd->kind == BASE_BACKUP_SEND_FILES && opt.nshards > 0)
+			snprintf(activitymsg, sizeof(activitymsg),
+					 "sending backup files, shard %d of %d",
+					 opt.shard, opt.nshards);
+		else
+			snprintf(activitymsg, sizeof(activitymsg), "sending backup \"%s\"",
+					 opt.label);
 		set_ps_display(activitymsg, false);
 	}
 
@@ -392,7 +647,21 @@ SendBaseBackup(BaseBackupCmd *cmd)
 		ereport(ERROR,
 				(errmsg("could not open directory \"%s\": %m", "pg_tblspc")));
 
-	perform_base_backup(&opt, dir);
+	switch (cmd->kind)
+	{
+		case BASE_BACKUP_FULL:
+			perform_base_backup(&opt, dir);
+			break;
+		case BASE_BACKUP_START:
+			perform_start_backup(&opt, dir);
+			break;
+		case BASE_BACKUP_SEND_FILES:
+			perform_send_files(&opt, dir);
+			break;
+		case BASE_BACKUP_STOP:
+			perform_stop_backup(&opt);
+			break;
+	}
 
 	FreeDir(dir);
 
@@ -571,6 +840,10 @@ sendDir(char *path, int basepathlen, bool sizeonly)
 	char		pathbuf[MAXPGPATH];
 	struct stat statbuf;
 	int64		size = 0;
+	bool		send_entries;
+
+	/* When the files are sharded, the first shard sends all the rest */
+	send_entries = (backup_nshards == 0 || backup_shard == 0);
 
 	dir = AllocateDir(path);
 	while ((de = ReadDir(dir, path)) != NULL)
@@ -628,6 +901,8 @@ sendDir(char *path, int basepathlen, bool sizeonly)
 		 */
 		if (strcmp(pathbuf, "./pg_xlog") == 0)
 		{
+			if (!send_entries)
+				continue;
 			if (!sizeonly)
 			{
 				/* If pg_xlog is a symlink, write it as a directory anyway */
@@ -668,6 +943,8 @@ sendDir(char *path, int basepathlen, bool sizeonly)
 								pathbuf)));
 			linkpath[rllen] = '\0';
 
+			if (!send_entries)
+				continue;
 			if (!sizeonly)
 				_tarWriteHeader(pathbuf + basepathlen + 1, linkpath, &statbuf);
 			size += 512;		/* Size of the header just added */
@@ -689,19 +966,42 @@ sendDir(char *path, int basepathlen, bool sizeonly)
 			 * Store a directory entry in the tar file so we can get the
 			 * permissions right.
 			 */
-			if (!sizeonly)
-				_tarWriteHeader(pathbuf + basepathlen + 1, NULL, &statbuf);
-			size += 512;		/* Size of the header just added */
+			if (send_entries)
+			{
+				if (!sizeonly)
+					_tarWriteHeader(pathbuf + basepathlen + 1, NULL, &statbuf);
+				size += 512;	/* Size of the header just added */
+			}
 
 			/* call ourselves recursively for a directory */
 			size += sendDir(pathbuf, basepathlen, sizeonly);
 		}
 		else if (S_ISREG(statbuf.st_mode))
 		{
-			/* Add size, rounded up to 512byte block */
+			char	   *tarfilename = pathbuf + basepathlen + 1;
+
+			/* Leave the file to its shard, if we're sharding */
+			if (backup_nshards > 0 &&
+				DatumGetUInt32(hash_any((unsigned char *) tarfilename,
+										strlen(tarfilename))) %
+				backup_nshards != backup_shard)
+				continue;
+
+			/*
+			 * Add size, rounded up to 512byte block.  For an incremental
+			 * backup this overestimates, but we can't tell how much of a
+			 * file has changed without reading it.
+			 */
 			size += ((statbuf.st_size + 511) & ~511);
 			if (!sizeonly)
-				sendFile(pathbuf, pathbuf + basepathlen + 1, &statbuf);
+			{
+				if (!XLogRecPtrIsInvalid(incremental_lsn) &&
+					statbuf.st_size % BLCKSZ == 0 &&
+					is_relation_main_fork(tarfilename))
+					sendIncrementalFile(pathbuf, tarfilename, &statbuf);
+				else
+					sendFile(pathbuf, tarfilename, &statbuf);
+			}
 			size += 512;		/* Size of the header of the file */
 		}
 		else
@@ -827,6 +1127,137 @@ sendFile(char *readfilename, char *tarfilename, struct stat * statbuf)
 	FreeFile(fp);
 }
 
+/*
+ * Is this path, relative to the data directory or a tablespace directory,
+ * a segment of the main fork of a relation?
+ *
+ * Only those are sent incrementally.  The free space map is not WAL-logged
+ * and visibility map bits are cleared without updating the page LSN, so the
+ * LSN of their pages can't be trusted to tell whether they have changed.
+ */
+static bool
+is_relation_main_fork(const char *path)
+{
+	const char *fname;
+
+	if (strncmp(path, "base/", 5) != 0 &&
+		strncmp(path, "global/", 7) != 0 &&
+		strncmp(path, TABLESPACE_VERSION_DIRECTORY "/",
+				strlen(TABLESPACE_VERSION_DIRECTORY) + 1) != 0)
+		return false;
+
+	fname = last_dir_separator(path) + 1;
+
+	/* <relfilenode>[.<segment>] */
+	if (!isdigit((unsigned char) *fname))
+		return false;
+	while (isdigit((unsigned char) *fname))
+		fname++;
+	if (*fname == '.')
+	{
+		fname++;
+		if (!isdigit((unsigned char) *fname))
+			return false;
+		while (isdigit((unsigned char) *fname))
+			fname++;
+	}
+	return (*fname == '\0');
+}
+
+/*
+ * Send a relation file incrementally: in place of the file, send a member
+ * with the INCREMENTAL_FILE_SUFFIX appended to its name, holding only the
+ * blocks whose LSN is at or past incremental_lsn.  See basebackup.h for the
+ * format.
+ *
+ * Anything that changes a block after our backup started is replayed from
+ * the WAL following it, full-page images included, so skipping a block on
+ * the strength of its LSN is as safe as copying a torn block is in a full
+ * backup.
+ */
+static void
+sendIncrementalFile(char *readfilename, char *tarfilename,
+					struct stat * statbuf)
+{
+	FILE	   *fp;
+	char	   *page;
+	BlockNumber *changed;
+	IncrementalFileHeader hdr;
+	BlockNumber blkno;
+	uint32		i;
+	char		incrname[MAXPGPATH];
+	struct stat incrstat;
+	pgoff_t		len;
+	size_t		pad;
+
+	fp = AllocateFile(readfilename, "rb");
+	if (fp == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", readfilename)));
+
+	hdr.magic = INCREMENTAL_FILE_MAGIC;
+	hdr.nblocks = statbuf->st_size / BLCKSZ;
+	hdr.nchanged = 0;
+
+	changed = palloc(Max(hdr.nblocks, 1) * sizeof(BlockNumber));
+	page = palloc(BLCKSZ);
+
+	/*
+	 * First pass: find the changed blocks.  A new (all-zeroes) page has no
+	 * LSN to go by, so include it, and likewise any block we can't read
+	 * because the file was truncated meanwhile.
+	 */
+	for (blkno = 0; blkno < hdr.nblocks; blkno++)
+	{
+		if (fread(page, 1, BLCKSZ, fp) != BLCKSZ ||
+			PageIsNew(page) ||
+			!XLByteLT(PageGetLSN(page), incremental_lsn))
+			changed[hdr.nchanged++] = blkno;
+	}
+
+	snprintf(incrname, sizeof(incrname), "%s%s",
+			 tarfilename, INCREMENTAL_FILE_SUFFIX);
+	memcpy(&incrstat, statbuf, sizeof(incrstat));
+	incrstat.st_size = sizeof(hdr) + hdr.nchanged * sizeof(BlockNumber) +
+		(pgoff_t) hdr.nchanged * BLCKSZ;
+	_tarWriteHeader(incrname, NULL, &incrstat);
+
+	if (pq_putmessage('d', (char *) &hdr, sizeof(hdr)) ||
+		(hdr.nchanged > 0 &&
+		 pq_putmessage('d', (char *) changed,
+					   hdr.nchanged * sizeof(BlockNumber))))
+		ereport(ERROR,
+				(errmsg("base backup could not send data, aborting backup")));
+	len = sizeof(hdr) + hdr.nchanged * sizeof(BlockNumber);
+
+	/* Second pass: send them */
+	for (i = 0; i < hdr.nchanged; i++)
+	{
+		/* As in sendFile, send zeros for whatever was truncated away */
+		if (fseeko(fp, (pgoff_t) changed[i] * BLCKSZ, SEEK_SET) != 0 ||
+			fread(page, 1, BLCKSZ, fp) != BLCKSZ)
+			MemSet(page, 0, BLCKSZ);
+
+		if (pq_putmessage('d', page, BLCKSZ))
+			ereport(ERROR,
+				   (errmsg("base backup could not send data, aborting backup")));
+		len += BLCKSZ;
+	}
+
+	/* Pad to 512 byte boundary, per tar format requirements */
+	pad = ((len + 511) & ~511) - len;
+	if (pad > 0)
+	{
+		MemSet(page, 0, pad);
+		pq_putmessage('d', page, pad);
+	}
+
+	FreeFile(fp);
+	pfree(changed);
+	pfree(page);
+}
+
 
 static void
 _tarWriteHeader(const char *filename, const char *linktarget,
@@ -22,8 +22,11 @@
 #include "libpq-fe.h"
 #include "access/xlog.h"
 #include "miscadmin.h"
+#include "replication/walprotocol.h"
 #include "replication/walreceiver.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/pg_lzcompress.h"
 
 #ifdef HAVE_POLL_H
 #include <poll.h>
@@ -45,6 +48,9 @@ static PGconn *streamConn = NULL;
 /* Buffer for currently read records */
 static char *recvBuf = NULL;
 
+/* Buffer that compressed WAL data messages are expanded into */
+static char *decompressBuf = NULL;
+
 /* Prototypes for interface functions */
 static bool libpqrcv_connect(char *conninfo, XLogRecPtr startpoint);
 static bool libpqrcv_receive(int timeout, unsigned char *type,
@@ -155,8 +161,9 @@ libpqrcv_connect(char *conninfo, XLogRecPtr startpoint)
 	ThisTimeLineID = primary_tli;
 
 	/* Start streaming from the point requested by startup process */
-	snprintf(cmd, sizeof(cmd), "START_REPLICATION %X/%X",
-			 startpoint.xlogid, startpoint.xrecoff);
+	snprintf(cmd, sizeof(cmd), "START_REPLICATION %X/%X%s",
+			 startpoint.xlogid, startpoint.xrecoff,
+			 wal_receiver_compression ? " COMPRESS" : "");
 	res = libpqrcv_PQexec(cmd);
 	if (PQresultStatus(res) != PGRES_COPY_BOTH)
 	{
@@ -334,6 +341,9 @@ libpqrcv_disconnect(void)
  *	 False if no data was available within timeout, or wait was interrupted
  *	 by signal.
  *
+ * Compressed WAL data messages ('z') are expanded here and handed to the
+ * caller as ordinary 'w' messages.
+ *
  * The buffer returned is only valid until the next call of this function or
  * libpq_connect/disconnect.
  *
@@ -398,6 +408,32 @@ libpqrcv_receive(int timeout, unsigned char *type, char **buffer, int *len)
 	*buffer = recvBuf + sizeof(*type);
 	*len = rawlen - sizeof(*type);
 
+	if (*type == 'z')
+	{
+		PGLZ_Header *lzdata;
+
+		lzdata = (PGLZ_Header *) (*buffer + sizeof(WalDataMessageHeader));
+		if (*len < sizeof(WalDataMessageHeader) + sizeof(PGLZ_Header) ||
+			VARSIZE(lzdata) != *len - sizeof(WalDataMessageHeader) ||
+			PGLZ_RAW_SIZE(lzdata) <= 0 ||
+			PGLZ_RAW_SIZE(lzdata) > MAX_SEND_SIZE)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg_internal("invalid compressed WAL message received from primary")));
+
+		if (decompressBuf == NULL)
+			decompressBuf = MemoryContextAlloc(TopMemoryContext,
+											   sizeof(WalDataMessageHeader) +
+											   MAX_SEND_SIZE);
+
+		memcpy(decompressBuf, *buffer, sizeof(WalDataMessageHeader));
+		pglz_decompress(lzdata, decompressBuf + sizeof(WalDataMessageHeader));
+
+		*type = 'w';
+		*buffer = decompressBuf;
+		*len = sizeof(WalDataMessageHeader) + PGLZ_RAW_SIZE(lzdata);
+	}
+
 	return true;
 }
 
@@ -0,0 +1,1341 @@
+/*-------------------------------------------------------------------------
+ *
+ * logical.c
+ *	  Logical decoding of WAL into a stream of row changes.
+ *
+ * With wal_level = logical, every insert, update and delete of a user table
+ * is accompanied in WAL by an XLOG_HEAP2_LOGICAL record carrying the
+ * relation's OID and the complete old and new tuples (see log_heap_logical
+ * in heapam.c).  The functions here read WAL from a given location, collect
+ * those records per transaction until the transaction's commit record is
+ * seen, and then pass the changes, in WAL order, to an output plugin that
+ * turns them into text.  Changes of transactions that abort are thrown away.
+ *
+ * Decoding happens in a regular backend, through the SQL functions at the
+ * bottom of this file, because turning a tuple into column values requires
+ * the catalogs of the tuple's database; that is also why only changes of
+ * the current database are decoded.  Tuples are interpreted using the
+ * current definition of their table, not the definition at the time the
+ * change was made, so changes must be consumed before an ALTER TABLE that
+ * changes the stored representation of a column.
+ *
+ * Resuming is the client's business: each row returned carries the end
+ * location of its transaction's commit record, and the location at which
+ * reading must restart so as not to miss any transaction that was still in
+ * progress at that point.  Nothing on the server keeps WAL around for a
+ * decoding client, so wal_keep_segments must be large enough to cover the
+ * distance between the restart location and the current insert location.
+ *
+ * Portions Copyright (c) 2012, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup.h"
+#include "access/transam.h"
+#include "access/tuptoaster.h"
+#include "access/xact.h"
+#include "access/xlog_internal.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_control.h"
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "lib/dllist.h"
+#include "miscadmin.h"
+#include "replication/logical.h"
+#include "replication/walsender_private.h"
+#include "storage/lock.h"
+#include "storage/procarray.h"
+#include "storage/standby.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/tuplestore.h"
+
+
+/*
+ * State of the sequential WAL reader.
+ *
+ * Records are read with walsender's XLogRead, never past readLimit (the
+ * flush location when decoding started), and we stop at the first record
+ * that starts at or after stopAt.  Unlike ReadRecord, we don't check record
+ * CRCs: the WAL has already been flushed by this server, which is the same
+ * assumption walsender makes when it ships it.
+ */
+typedef struct LogicalReader
+{
+	XLogRecPtr	ReadRecPtr;		/* start of last record read */
+	XLogRecPtr	EndRecPtr;		/* end+1 of last record read */
+	XLogRecPtr	stopAt;			/* don't return records starting here */
+	XLogRecPtr	readLimit;		/* don't read WAL at or beyond this */
+	bool		first;			/* no record read yet? */
+
+	char	   *pageBuf;		/* currently loaded page */
+	XLogRecPtr	pagePtr;		/* its start location */
+	uint32		pageLen;		/* valid bytes in pageBuf, 0 if none */
+
+	char	   *recordBuf;		/* reassembled current record */
+	uint32		recordBufSize;
+} LogicalReader;
+
+/*
+ * A buffered change, owned by the transaction that made it
+ */
+typedef struct BufferedChange
+{
+	XLogRecPtr	lsn;
+	Oid			relid;
+	LogicalChangeAction action;
+	HeapTuple	oldtuple;
+	HeapTuple	newtuple;
+} BufferedChange;
+
+/*
+ * Changes of one (sub)transaction that hasn't committed or aborted yet.
+ * Subtransactions get entries of their own, and are merged into their
+ * top-level transaction when the commit record names them.
+ */
+typedef struct ReorderTXN
+{
+	TransactionId xid;			/* hash key --- must be first */
+	XLogRecPtr	first_lsn;		/* location of its first change */
+	MemoryContext context;		/* holds the changes */
+	List	   *changes;		/* BufferedChanges, in WAL order */
+	Dlelem		elem;			/* link in txns_by_lsn */
+} ReorderTXN;
+
+/*
+ * A TOAST value being collected from the chunk inserts that precede the
+ * insert or update of the row that references it.
+ */
+typedef struct ToastValueKey
+{
+	Oid			toastrelid;
+	Oid			valueid;
+} ToastValueKey;
+
+typedef struct ToastValueEntry
+{
+	ToastValueKey key;			/* hash key --- must be first */
+	int32		nextseq;		/* chunk_seq we expect next */
+	StringInfoData data;		/* chunks collected so far */
+} ToastValueEntry;
+
+/*
+ * Everything one call of pg_logical_changes works with
+ */
+typedef struct LogicalDecoder
+{
+	LogicalReader reader;
+
+	HTAB	   *txns;			/* ReorderTXNs by xid */
+	Dllist		txns_by_lsn;	/* the same, ordered by first_lsn */
+
+	MemoryContext context;		/* long-lived decoder state */
+	MemoryContext change_context;		/* reset after each change */
+	MemoryContext toast_context;	/* holds toast_values */
+	HTAB	   *toast_values;	/* ToastValueEntries, or NULL */
+
+	XLogRecPtr	after;			/* emit only commits ending after this */
+
+	OutputPluginCallbacks callbacks;
+	LogicalDecodingContext plugin_ctx;
+	StringInfoData out;
+
+	/* where decoded rows go */
+	Tuplestorestate *tupstore;
+	TupleDesc	tupdesc;
+	XLogRecPtr	commit_end;		/* location column of current rows */
+	XLogRecPtr	restart;		/* restart_location column */
+	TransactionId commit_xid;	/* xid column */
+} LogicalDecoder;
+
+static bool LogicalReadPage(LogicalReader *reader, XLogRecPtr ptr);
+static XLogRecord *LogicalReadRecord(LogicalReader *reader);
+static void DecodeRecord(LogicalDecoder *decoder, XLogRecord *record);
+static void DecodeChange(LogicalDecoder *decoder, XLogRecord *record);
+static HeapTuple DecodeTuple(char **data, Oid relid, MemoryContext cxt);
+static ReorderTXN *ReorderTXNLookup(LogicalDecoder *decoder,
+				 TransactionId xid, bool create);
+static void ReorderTXNForget(LogicalDecoder *decoder, ReorderTXN *txn);
+static void DecodeCommit(LogicalDecoder *decoder, TransactionId xid,
+			 TimestampTz commit_time,
+			 TransactionId *subxacts, int nsubxacts);
+static void DecodeAbort(LogicalDecoder *decoder, TransactionId xid,
+			TransactionId *subxacts, int nsubxacts);
+static void DecodePruneRunning(LogicalDecoder *decoder,
+				   TransactionId oldestRunningXid);
+static void ApplyChange(LogicalDecoder *decoder, BufferedChange *bchange);
+static void StashToastChunk(LogicalDecoder *decoder, Relation toastrel,
+				HeapTuple tuple);
+static HeapTuple ReassembleToast(LogicalDecoder *decoder, Relation relation,
+				HeapTuple tuple);
+static void EmitOutput(LogicalDecoder *decoder);
+static void CheckLogicalDecodingRequirements(void);
+static XLogRecPtr ParseLocation(const char *str);
+static text *LocationGetText(XLogRecPtr location);
+static int	change_lsn_cmp(const void *a, const void *b);
+
+static void text_begin(LogicalDecodingContext *ctx, TransactionId xid,
+		   TimestampTz commit_time);
+static void text_change(LogicalDecodingContext *ctx, Relation relation,
+			LogicalChange *change);
+static void text_commit(LogicalDecodingContext *ctx, TransactionId xid,
+			XLogRecPtr commit_lsn, TimestampTz commit_time);
+static void text_tuple(StringInfo out, TupleDesc desc, HeapTuple tuple);
+
+
+/* ----------------------------------------------------------------
+ *		Reading WAL
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Make the WAL page containing ptr the current page of the reader.
+ *
+ * Returns false if the page, or at least its header, lies beyond the read
+ * limit.  The page may be only partially valid; pageLen says how much.
+ */
+static bool
+LogicalReadPage(LogicalReader *reader, XLogRecPtr ptr)
+{
+	XLogRecPtr	pagePtr = ptr;
+	XLogPageHeader hdr = (XLogPageHeader) reader->pageBuf;
+	uint32		len = XLOG_BLCKSZ;
+
+	pagePtr.xrecoff -= ptr.xrecoff % XLOG_BLCKSZ;
+
+	if (reader->pageLen > 0 && XLByteEQ(pagePtr, reader->pagePtr))
+		return true;
+	reader->pageLen = 0;
+
+	if (!XLByteLT(pagePtr, reader->readLimit))
+		return false;
+	if (pagePtr.xlogid == reader->readLimit.xlogid &&
+		reader->readLimit.xrecoff - pagePtr.xrecoff < XLOG_BLCKSZ)
+		len = reader->readLimit.xrecoff - pagePtr.xrecoff;
+	if (len < SizeOfXLogShortPHD)
+		return false;
+
+	XLogRead(reader->pageBuf, pagePtr, len);
+
+	if (hdr->xlp_magic != XLOG_PAGE_MAGIC ||
+		!XLByteEQ(hdr->xlp_pageaddr, pagePtr))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid WAL page header at %X/%X",
+						pagePtr.xlogid, pagePtr.xrecoff)));
+	if (XLogPageHeaderSize(hdr) > len)
+		return false;
+
+	reader->pagePtr = pagePtr;
+	reader->pageLen = len;
+	return true;
+}
+
+/*
+ * Read the record following the last one returned.  The first call reads
+ * the record at EndRecPtr, which must be the start of a record (or of the
+ * page or segment the record is on).
+ *
+ * Returns NULL when the next record starts at or after stopAt, or isn't
+ * completely before readLimit.  Errors out on anything that doesn't look
+ * like a valid record.
+ */
+static XLogRecord *
+LogicalReadRecord(LogicalReader *reader)
+{
+	XLogRecPtr	RecPtr = reader->EndRecPtr;
+	XLogRecPtr	EndPtr;
+	XLogPageHeader hdr;
+	XLogRecord *record;
+	uint32		pageHeaderSize;
+	uint32		targetRecOff;
+	uint32		total_len;
+	uint32		len;
+
+	/* A record header is never split across pages */
+	if (XLOG_BLCKSZ - RecPtr.xrecoff % XLOG_BLCKSZ < SizeOfXLogRecord)
+		NextLogPage(RecPtr);
+	if (RecPtr.xrecoff >= XLogFileSize)
+	{
+		RecPtr.xlogid++;
+		RecPtr.xrecoff = 0;
+	}
+
+	if (!XLByteLT(RecPtr, reader->stopAt) ||
+		!LogicalReadPage(reader, RecPtr))
+		return NULL;
+
+	hdr = (XLogPageHeader) reader->pageBuf;
+	pageHeaderSize = XLogPageHeaderSize(hdr);
+	targetRecOff = RecPtr.xrecoff % XLOG_BLCKSZ;
+	if (targetRecOff == 0)
+	{
+		/* skip over the page header */
+		RecPtr.xrecoff += pageHeaderSize;
+		targetRecOff = pageHeaderSize;
+		if (!XLByteLT(RecPtr, reader->stopAt))
+			return NULL;
+	}
+	else if (targetRecOff < pageHeaderSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("WAL location %X/%X is within a page header",
+						RecPtr.xlogid, RecPtr.xrecoff)));
+	if ((hdr->xlp_info & XLP_FIRST_IS_CONTRECORD) &&
+		targetRecOff == pageHeaderSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("WAL location %X/%X is in the middle of a record",
+						RecPtr.xlogid, RecPtr.xrecoff)));
+
+	if (targetRecOff + SizeOfXLogRecord > reader->pageLen)
+		return NULL;
+	record = (XLogRecord *) (reader->pageBuf + targetRecOff);
+
+	/* The same sanity checks as ReadRecord */
+	if (record->xl_rmid == RM_XLOG_ID && record->xl_info == XLOG_SWITCH)
+	{
+		if (record->xl_len != 0)
+			goto invalid;
+	}
+	else if (record->xl_len == 0)
+		goto invalid;
+	if (record->xl_tot_len < SizeOfXLogRecord + record->xl_len ||
+		record->xl_tot_len > SizeOfXLogRecord + record->xl_len +
+		XLR_MAX_BKP_BLOCKS * (sizeof(BkpBlock) + BLCKSZ))
+		goto invalid;
+	if (record->xl_rmid > RM_MAX_ID)
+		goto invalid;
+	if (reader->first ?
+		!XLByteLT(record->xl_prev, RecPtr) :
+		!XLByteEQ(record->xl_prev, reader->ReadRecPtr))
+		goto invalid;
+
+	total_len = record->xl_tot_len;
+	if (total_len > reader->recordBufSize)
+	{
+		uint32		newSize = Max(total_len, 4 * XLOG_BLCKSZ);
+
+		reader->recordBuf = repalloc(reader->recordBuf, newSize);
+		reader->recordBufSize = newSize;
+	}
+
+	len = XLOG_BLCKSZ - targetRecOff;
+	if (total_len <= len)
+	{
+		/* Record is entirely on this page */
+		if (targetRecOff + total_len > reader->pageLen)
+			return NULL;
+		memcpy(reader->recordBuf, record, total_len);
+		EndPtr = RecPtr;
+		EndPtr.xrecoff += MAXALIGN(total_len);
+	}
+	else
+	{
+		/* Collect the continuation data from the following pages */
+		XLogRecPtr	pagePtr = reader->pagePtr;
+		char	   *buffer = reader->recordBuf;
+		uint32		gotlen = len;
+		XLogContRecord *contrecord;
+
+		if (reader->pageLen < XLOG_BLCKSZ)
+			return NULL;
+		memcpy(buffer, record, len);
+		buffer += len;
+
+		for (;;)
+		{
+			pagePtr.xrecoff += XLOG_BLCKSZ;
+			if (pagePtr.xrecoff >= XLogFileSize)
+			{
+				pagePtr.xlogid++;
+				pagePtr.xrecoff = 0;
+			}
+			if (!LogicalReadPage(reader, pagePtr))
+				return NULL;
+
+			hdr = (XLogPageHeader) reader->pageBuf;
+			if (!(hdr->xlp_info & XLP_FIRST_IS_CONTRECORD))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("there is no contrecord flag in WAL page %X/%X",
+								pagePtr.xlogid, pagePtr.xrecoff)));
+			pageHeaderSize = XLogPageHeaderSize(hdr);
+			if (pageHeaderSize + SizeOfXLogContRecord > reader->pageLen)
+				return NULL;
+			contrecord = (XLogContRecord *) (reader->pageBuf + pageHeaderSize);
+			if (contrecord->xl_rem_len == 0 ||
+				total_len != contrecord->xl_rem_len + gotlen)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("invalid contrecord length %u in WAL page %X/%X",
+								contrecord->xl_rem_len,
+								pagePtr.xlogid, pagePtr.xrecoff)));
+
+			len = XLOG_BLCKSZ - pageHeaderSize - SizeOfXLogContRecord;
+			if (contrecord->xl_rem_len > len)
+			{
+				if (reader->pageLen < XLOG_BLCKSZ)
+					return NULL;
+				memcpy(buffer, (char *) contrecord + SizeOfXLogContRecord, len);
+				gotlen += len;
+				buffer += len;
+				continue;
+			}
+
+			if (pageHeaderSize + SizeOfXLogContRecord +
+				contrecord->xl_rem_len > reader->pageLen)
+				return NULL;
+			memcpy(buffer, (char *) contrecord + SizeOfXLogContRecord,
+				   contrecord->xl_rem_len);
+			EndPtr = pagePtr;
+			EndPtr.xrecoff += pageHeaderSize +
+				MAXALIGN(SizeOfXLogContRecord + contrecord->xl_rem_len);
+			break;
+		}
+	}
+
+	record = (XLogRecord *) reader->recordBuf;
+
+	/* The rest of the segment after an XLOG_SWITCH record is unused */
+	if (record->xl_rmid == RM_XLOG_ID && record->xl_info == XLOG_SWITCH)
+	{
+		EndPtr.xrecoff += XLogSegSize - 1;
+		EndPtr.xrecoff -= EndPtr.xrecoff % XLogSegSize;
+		if (EndPtr.xrecoff >= XLogFileSize)
+		{
+			EndPtr.xlogid++;
+			EndPtr.xrecoff = 0;
+		}
+	}
+
+	reader->ReadRecPtr = RecPtr;
+	reader->EndRecPtr = EndPtr;
+	reader->first = false;
+	return record;
+
+invalid:
+	ereport(ERROR,
+			(errcode(ERRCODE_DATA_CORRUPTED),
+			 errmsg("invalid WAL record at %X/%X",
+					RecPtr.xlogid, RecPtr.xrecoff),
+			 reader->first ?
+			 errhint("Decoding must start at a location returned by pg_logical_start_point or pg_logical_changes.") : 0));
+	return NULL;				/* keep compiler quiet */
+}
+
+
+/* ----------------------------------------------------------------
+ *		Collecting changes
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Look at one WAL record, and buffer, emit or discard changes accordingly
+ */
+static void
+DecodeRecord(LogicalDecoder *decoder, XLogRecord *record)
+{
+	uint8		info = record->xl_info & ~XLR_INFO_MASK;
+
+	switch (record->xl_rmid)
+	{
+		case RM_HEAP2_ID:
+			if ((info & XLOG_HEAP_OPMASK) == XLOG_HEAP2_LOGICAL)
+				DecodeChange(decoder, record);
+			break;
+
+		case RM_XACT_ID:
+			if (info == XLOG_XACT_COMMIT_COMPACT)
+			{
+				xl_xact_commit_compact *xlrec =
+				(xl_xact_commit_compact *) XLogRecGetData(record);
+
+				DecodeCommit(decoder, record->xl_xid, xlrec->xact_time,
+							 xlrec->subxacts, xlrec->nsubxacts);
+			}
+			else if (info == XLOG_XACT_COMMIT)
+			{
+				xl_xact_commit *xlrec =
+				(xl_xact_commit *) XLogRecGetData(record);
+
+				DecodeCommit(decoder, record->xl_xid, xlrec->xact_time,
+							 (TransactionId *) &(xlrec->xnodes[xlrec->nrels]),
+							 xlrec->nsubxacts);
+			}
+			else if (info == XLOG_XACT_COMMIT_PREPARED)
+			{
+				xl_xact_commit_prepared *xlrec =
+				(xl_xact_commit_prepared *) XLogRecGetData(record);
+
+				DecodeCommit(decoder, xlrec->xid, xlrec->crec.xact_time,
+							 (TransactionId *) &(xlrec->crec.xnodes[xlrec->crec.nrels]),
+							 xlrec->crec.nsubxacts);
+			}
+			else if (info == XLOG_XACT_ABORT)
+			{
+				xl_xact_abort *xlrec =
+				(xl_xact_abort *) XLogRecGetData(record);
+
+				DecodeAbort(decoder, record->xl_xid,
+							(TransactionId *) &(xlrec->xnodes[xlrec->nrels]),
+							xlrec->nsubxacts);
+			}
+			else if (info == XLOG_XACT_ABORT_PREPARED)
+			{
+				xl_xact_abort_prepared *xlrec =
+				(xl_xact_abort_prepared *) XLogRecGetData(record);
+
+				DecodeAbort(decoder, xlrec->xid,
+							(TransactionId *) &(xlrec->arec.xnodes[xlrec->arec.nrels]),
+							xlrec->arec.nsubxacts);
+			}
+			break;
+
+		case RM_STANDBY_ID:
+			if (info == XLOG_RUNNING_XACTS)
+			{
+				xl_running_xacts *xlrec =
+				(xl_running_xacts *) XLogRecGetData(record);
+
+				DecodePruneRunning(decoder, xlrec->oldestRunningXid);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * Buffer the change in an XLOG_HEAP2_LOGICAL record
+ */
+static void
+DecodeChange(LogicalDecoder *decoder, XLogRecord *record)
+{
+	xl_heap_logical *xlrec = (xl_heap_logical *) XLogRecGetData(record);
+	char	   *data = (char *) xlrec + SizeOfHeapLogical;
+	ReorderTXN *txn;
+	BufferedChange *bchange;
+	MemoryContext oldcxt;
+
+	if (xlrec->dbNode != MyDatabaseId)
+		return;
+
+	txn = ReorderTXNLookup(decoder, record->xl_xid, true);
+	if (txn->changes == NIL)
+		txn->first_lsn = decoder->reader.ReadRecPtr;
+
+	oldcxt = MemoryContextSwitchTo(txn->context);
+
+	bchange = (BufferedChange *) palloc0(sizeof(BufferedChange));
+	bchange->lsn = decoder->reader.ReadRecPtr;
+	bchange->relid = xlrec->relid;
+	switch (xlrec->action)
+	{
+		case XLH_LOGICAL_INSERT:
+			bchange->action = LOGICAL_CHANGE_INSERT;
+			break;
+		case XLH_LOGICAL_UPDATE:
+			bchange->action = LOGICAL_CHANGE_UPDATE;
+			break;
+		case XLH_LOGICAL_DELETE:
+			bchange->action = LOGICAL_CHANGE_DELETE;
+			break;
+		default:
+			elog(ERROR, "unrecognized logical change action: %d",
+				 (int) xlrec->action);
+	}
+	if (xlrec->flags & XLH_LOGICAL_HAS_OLD)
+		bchange->oldtuple = DecodeTuple(&data, xlrec->relid, txn->context);
+	if (xlrec->flags & XLH_LOGICAL_HAS_NEW)
+		bchange->newtuple = DecodeTuple(&data, xlrec->relid, txn->context);
+
+	txn->changes = lappend(txn->changes, bchange);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Rebuild a HeapTuple from an xl_heap_logical_tuple, and advance *data past
+ * it.  System columns other than t_tableOid are not logged and come back
+ * zeroed.
+ */
+static HeapTuple
+DecodeTuple(char **data, Oid relid, MemoryContext cxt)
+{
+	xl_heap_logical_tuple xlhdr;
+	HeapTuple	tuple;
+	uint32		len;
+
+	/* the record data isn't aligned */
+	memcpy(&xlhdr, *data, SizeOfHeapLogicalTuple);
+	*data += SizeOfHeapLogicalTuple;
+
+	len = offsetof(HeapTupleHeaderData, t_bits) + xlhdr.datalen;
+	tuple = (HeapTuple) MemoryContextAllocZero(cxt, HEAPTUPLESIZE + len);
+	tuple->t_len = len;
+	ItemPointerSetInvalid(&tuple->t_self);
+	tuple->t_tableOid = relid;
+	tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+	tuple->t_data->t_infomask2 = xlhdr.t_infomask2;
+	tuple->t_data->t_infomask = xlhdr.t_infomask;
+	tuple->t_data->t_hoff = xlhdr.t_hoff;
+	memcpy((char *) tuple->t_data + offsetof(HeapTupleHeaderData, t_bits),
+		   *data, xlhdr.datalen);
+	*data += xlhdr.datalen;
+
+	return tuple;
+}
+
+/*
+ * Find the entry of a (sub)transaction, optionally creating it
+ */
+static ReorderTXN *
+ReorderTXNLookup(LogicalDecoder *decoder, TransactionId xid, bool create)
+{
+	ReorderTXN *txn;
+	bool		found;
+
+	txn = (ReorderTXN *) hash_search(decoder->txns, &xid,
+									 create ? HASH_ENTER : HASH_FIND,
+									 &found);
+	if (txn == NULL || found)
+		return txn;
+
+	txn->changes = NIL;
+	/* nothing in it is freed before the whole transaction is */
+	txn->context = BumpContextCreate(decoder->context,
+									 "logical decoding transaction",
+									 ALLOCSET_DEFAULT_INITSIZE,
+									 ALLOCSET_DEFAULT_MAXSIZE);
+	DLInitElem(&txn->elem, txn);
+	DLAddTail(&decoder->txns_by_lsn, &txn->elem);
+	return txn;
+}
+
+/*
+ * Throw away a (sub)transaction and its changes
+ */
+static void
+ReorderTXNForget(LogicalDecoder *decoder, ReorderTXN *txn)
+{
+	TransactionId xid = txn->xid;
+
+	DLRemove(&txn->elem);
+	MemoryContextDelete(txn->context);
+	hash_search(decoder->txns, &xid, HASH_REMOVE, NULL);
+}
+
+/*
+ * A transaction committed: emit its changes and those of its committed
+ * subtransactions, in WAL order, unless the commit precedes the point the
+ * client has already consumed.
+ */
+static void
+DecodeCommit(LogicalDecoder *decoder, TransactionId xid,
+			 TimestampTz commit_time,
+			 TransactionId *subxacts, int nsubxacts)
+{
+	ReorderTXN **parts;
+	int			nparts = 0;
+	List	   *changes = NIL;
+	Dlelem	   *head;
+	int			i;
+
+	parts = (ReorderTXN **) palloc((nsubxacts + 1) * sizeof(ReorderTXN *));
+	if ((parts[nparts] = ReorderTXNLookup(decoder, xid, false)) != NULL)
+		nparts++;
+	for (i = 0; i < nsubxacts; i++)
+	{
+		if ((parts[nparts] = ReorderTXNLookup(decoder, subxacts[i], false)) != NULL)
+			nparts++;
+	}
+
+	/*
+	 * Unlink the parts first, so that the restart location reflects the
+	 * transactions that are still open after this one.
+	 */
+	for (i = 0; i < nparts; i++)
+	{
+		DLRemove(&parts[i]->elem);
+		changes = list_concat(changes, list_copy(parts[i]->changes));
+	}
+
+	head = DLGetHead(&decoder->txns_by_lsn);
+	if (head != NULL)
+		decoder->restart = ((ReorderTXN *) DLE_VAL(head))->first_lsn;
+	else
+		decoder->restart = decoder->reader.EndRecPtr;
+
+	if (changes != NIL && XLByteLT(decoder->after, decoder->reader.EndRecPtr))
+	{
+		BufferedChange **sorted;
+		int			nchanges = list_length(changes);
+		ListCell   *lc;
+		MemoryContext oldcxt;
+
+		sorted = (BufferedChange **) palloc(nchanges * sizeof(BufferedChange *));
+		i = 0;
+		foreach(lc, changes)
+			sorted[i++] = (BufferedChange *) lfirst(lc);
+		if (nparts > 1)
+			qsort(sorted, nchanges, sizeof(BufferedChange *), change_lsn_cmp);
+
+		decoder->commit_end = decoder->reader.EndRecPtr;
+		decoder->commit_xid = xid;
+
+		if (decoder->callbacks.begin_cb)
+		{
+			oldcxt = MemoryContextSwitchTo(decoder->change_context);
+			decoder->callbacks.begin_cb(&decoder->plugin_ctx, xid, commit_time);
+			MemoryContextSwitchTo(oldcxt);
+			EmitOutput(decoder);
+		}
+
+		for (i = 0; i < nchanges; i++)
+			ApplyChange(decoder, sorted[i]);
+		MemoryContextReset(decoder->toast_context);
+		decoder->toast_values = NULL;
+
+		if (decoder->callbacks.commit_cb)
+		{
+			oldcxt = MemoryContextSwitchTo(decoder->change_context);
+			decoder->callbacks.commit_cb(&decoder->plugin_ctx, xid,
+										 decoder->reader.EndRecPtr,
+										 commit_time);
+			MemoryContextSwitchTo(oldcxt);
+			EmitOutput(decoder);
+		}
+
+		pfree(sorted);
+	}
+
+	list_free(changes);
+	for (i = 0; i < nparts; i++)
+	{
+		TransactionId partxid = parts[i]->xid;
+
+		MemoryContextDelete(parts[i]->context);
+		hash_search(decoder->txns, &partxid, HASH_REMOVE, NULL);
+	}
+	pfree(parts);
+}
+
+/*
+ * A transaction, or some of its subtransactions, aborted
+ */
+static void
+DecodeAbort(LogicalDecoder *decoder, TransactionId xid,
+			TransactionId *subxacts, int nsubxacts)
+{
+	ReorderTXN *txn;
+	int			i;
+
+	if ((txn = ReorderTXNLookup(decoder, xid, false)) != NULL)
+		ReorderTXNForget(decoder, txn);
+	for (i = 0; i < nsubxacts; i++)
+	{
+		if ((txn = ReorderTXNLookup(decoder, subxacts[i], false)) != NULL)
+			ReorderTXNForget(decoder, txn);
+	}
+}
+
+/*
+ * A transaction that is older than every running transaction, but hasn't
+ * committed or aborted, was lost in a crash.  Forget about it.
+ */
+static void
+DecodePruneRunning(LogicalDecoder *decoder, TransactionId oldestRunningXid)
+{
+	Dlelem	   *elem = DLGetHead(&decoder->txns_by_lsn);
+
+	while (elem != NULL)
+	{
+		ReorderTXN *txn = (ReorderTXN *) DLE_VAL(elem);
+
+		elem = DLGetSucc(elem);
+		if (TransactionIdPrecedes(txn->xid, oldestRunningXid))
+			ReorderTXNForget(decoder, txn);
+	}
+}
+
+static int
+change_lsn_cmp(const void *a, const void *b)
+{
+	BufferedChange *ca = *(BufferedChange *const *) a;
+	BufferedChange *cb = *(BufferedChange *const *) b;
+
+	if (XLByteLT(ca->lsn, cb->lsn))
+		return -1;
+	if (XLByteLT(cb->lsn, ca->lsn))
+		return 1;
+	return 0;
+}
+
+
+/* ----------------------------------------------------------------
+ *		Handing changes to the output plugin
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Pass one change of a committed transaction to the output plugin.
+ *
+ * Chunk inserts into TOAST tables aren't passed on; they're collected so
+ * that the row referencing the value can be handed over complete.
+ */
+static void
+ApplyChange(LogicalDecoder *decoder, BufferedChange *bchange)
+{
+	Relation	relation;
+	LogicalChange change;
+	MemoryContext oldcxt;
+
+	/* The table may have been dropped since */
+	relation = try_relation_open(bchange->relid, AccessShareLock);
+	if (relation == NULL)
+		return;
+
+	if (relation->rd_rel->relkind == RELKIND_TOASTVALUE)
+	{
+		if (bchange->action == LOGICAL_CHANGE_INSERT)
+			StashToastChunk(decoder, relation, bchange->newtuple);
+		relation_close(relation, AccessShareLock);
+		return;
+	}
+
+	oldcxt = MemoryContextSwitchTo(decoder->change_context);
+
+	change.action = bchange->action;
+	change.lsn = bchange->lsn;
+	change.oldtuple = bchange->oldtuple;
+	change.newtuple = bchange->newtuple;
+	if (change.newtuple != NULL && decoder->toast_values != NULL &&
+		HeapTupleHasExternal(change.newtuple))
+		change.newtuple = ReassembleToast(decoder, relation, change.newtuple);
+
+	decoder->callbacks.change_cb(&decoder->plugin_ctx, relation, &change);
+
+	MemoryContextSwitchTo(oldcxt);
+	EmitOutput(decoder);
+
+	relation_close(relation, AccessShareLock);
+
+	/* The values collected belonged to this row */
+	if (decoder->toast_values != NULL)
+	{
+		MemoryContextReset(decoder->toast_context);
+		decoder->toast_values = NULL;
+	}
+}
+
+/*
+ * Remember one chunk of a TOAST value
+ */
+static void
+StashToastChunk(LogicalDecoder *decoder, Relation toastrel, HeapTuple tuple)
+{
+	Datum		values[3];
+	bool		isnull[3];
+	ToastValueKey key;
+	ToastValueEntry *entry;
+	bool		found;
+	struct varlena *chunk;
+	MemoryContext oldcxt;
+
+	if (RelationGetDescr(toastrel)->natts != 3)
+		return;
+	heap_deform_tuple(tuple, RelationGetDescr(toastrel), values, isnull);
+	if (isnull[0] || isnull[1] || isnull[2])
+		return;
+
+	oldcxt = MemoryContextSwitchTo(decoder->toast_context);
+
+	if (decoder->toast_values == NULL)
+	{
+		HASHCTL		ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ToastValueKey);
+		ctl.entrysize = sizeof(ToastValueEntry);
+		ctl.hash = tag_hash;
+		ctl.hcxt = decoder->toast_context;
+		decoder->toast_values = hash_create("logical decoding TOAST values",
+											32, &ctl,
+									   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+	}
+
+	key.toastrelid = RelationGetRelid(toastrel);
+	key.valueid = DatumGetObjectId(values[0]);
+	entry = (ToastValueEntry *) hash_search(decoder->toast_values, &key,
+											HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->nextseq = 0;
+		initStringInfo(&entry->data);
+	}
+
+	/* A chunk out of sequence means we can't trust this value */
+	chunk = (struct varlena *) DatumGetPointer(values[2]);
+	if (entry->nextseq < 0 || DatumGetInt32(values[1]) != entry->nextseq ||
+		(VARATT_IS_EXTENDED(chunk) && !VARATT_IS_SHORT(chunk)))
+		entry->nextseq = -1;
+	else
+	{
+		appendBinaryStringInfo(&entry->data, VARDATA_ANY(chunk),
+							   VARSIZE_ANY_EXHDR(chunk));
+		entry->nextseq++;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Replace the external TOAST pointers in a tuple by the values collected
+ * from the preceding chunk inserts, where we have them.
+ */
+static HeapTuple
+ReassembleToast(LogicalDecoder *decoder, Relation relation, HeapTuple tuple)
+{
+	TupleDesc	desc = RelationGetDescr(relation);
+	Datum	   *values;
+	bool	   *isnull;
+	HeapTuple	result;
+	int			i;
+
+	values = (Datum *) palloc(desc->natts * sizeof(Datum));
+	isnull = (bool *) palloc(desc->natts * sizeof(bool));
+	heap_deform_tuple(tuple, desc, values, isnull);
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		struct varlena *attr;
+		struct varatt_external toast_pointer;
+		ToastValueKey key;
+		ToastValueEntry *entry;
+		struct varlena *value;
+
+		if (isnull[i] || desc->attrs[i]->attlen != -1)
+			continue;
+		attr = (struct varlena *) DatumGetPointer(values[i]);
+		if (!VARATT_IS_EXTERNAL(attr))
+			continue;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+		key.toastrelid = toast_pointer.va_toastrelid;
+		key.valueid = toast_pointer.va_valueid;
+		entry = (ToastValueEntry *) hash_search(decoder->toast_values, &key,
+												HASH_FIND, NULL);
+		if (entry == NULL || entry->nextseq < 0 ||
+			entry->data.len != toast_pointer.va_extsize)
+			continue;
+
+		value = (struct varlena *) palloc(toast_pointer.va_extsize + VARHDRSZ);
+		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+			SET_VARSIZE_COMPRESSED(value, toast_pointer.va_extsize + VARHDRSZ);
+		else
+			SET_VARSIZE(value, toast_pointer.va_extsize + VARHDRSZ);
+		memcpy(VARDATA(value), entry->data.data, toast_pointer.va_extsize);
+		values[i] = PointerGetDatum(value);
+	}
+
+	result = heap_form_tuple(desc, values, isnull);
+	result->t_tableOid = tuple->t_tableOid;
+	return result;
+}
+
+/*
+ * Turn whatever the plugin produced into an output row
+ */
+static void
+EmitOutput(LogicalDecoder *decoder)
+{
+	Datum		values[4];
+	bool		nulls[4];
+
+	if (decoder->out.len > 0)
+	{
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = PointerGetDatum(LocationGetText(decoder->commit_end));
+		values[1] = PointerGetDatum(LocationGetText(decoder->restart));
+		values[2] = TransactionIdGetDatum(decoder->commit_xid);
+		values[3] = PointerGetDatum(cstring_to_text_with_len(decoder->out.data,
+														 decoder->out.len));
+		tuplestore_putvalues(decoder->tupstore, decoder->tupdesc,
+							 values, nulls);
+		resetStringInfo(&decoder->out);
+	}
+	MemoryContextReset(decoder->change_context);
+}
+
+
+/* ----------------------------------------------------------------
+ *		Builtin text output
+ * ----------------------------------------------------------------
+ */
+
+static void
+text_begin(LogicalDecodingContext *ctx, TransactionId xid,
+		   TimestampTz commit_time)
+{
+	appendStringInfo(ctx->out, "BEGIN %u", xid);
+}
+
+static void
+text_change(LogicalDecodingContext *ctx, Relation relation,
+			LogicalChange *change)
+{
+	TupleDesc	desc = RelationGetDescr(relation);
+
+	appendStringInfo(ctx->out, "table %s: ",
+				quote_qualified_identifier(get_namespace_name(RelationGetNamespace(relation)),
+										   RelationGetRelationName(relation)));
+	switch (change->action)
+	{
+		case LOGICAL_CHANGE_INSERT:
+			appendStringInfoString(ctx->out, "INSERT:");
+			text_tuple(ctx->out, desc, change->newtuple);
+			break;
+		case LOGICAL_CHANGE_UPDATE:
+			appendStringInfoString(ctx->out, "UPDATE: old-tuple:");
+			text_tuple(ctx->out, desc, change->oldtuple);
+			appendStringInfoString(ctx->out, " new-tuple:");
+			text_tuple(ctx->out, desc, change->newtuple);
+			break;
+		case LOGICAL_CHANGE_DELETE:
+			appendStringInfoString(ctx->out, "DELETE:");
+			text_tuple(ctx->out, desc, change->oldtuple);
+			break;
+	}
+}
+
+static void
+text_commit(LogicalDecodingContext *ctx, TransactionId xid,
+			XLogRecPtr commit_lsn, TimestampTz commit_time)
+{
+	appendStringInfo(ctx->out, "COMMIT %u", xid);
+}
+
+/*
+ * Append " name[type]:value" for each live column of the tuple
+ */
+static void
+text_tuple(StringInfo out, TupleDesc desc, HeapTuple tuple)
+{
+	int			natt;
+
+	for (natt = 0; natt < desc->natts; natt++)
+	{
+		Form_pg_attribute attr = desc->attrs[natt];
+		Datum		origval;
+		bool		isnull;
+		Oid			typoutput;
+		bool		typisvarlena;
+		char	   *outputstr;
+
+		if (attr->attisdropped)
+			continue;
+
+		appendStringInfo(out, " %s[%s]:",
+						 quote_identifier(NameStr(attr->attname)),
+						 format_type_be(attr->atttypid));
+
+		origval = heap_getattr(tuple, natt + 1, desc, &isnull);
+		if (isnull)
+		{
+			appendStringInfoString(out, "null");
+			continue;
+		}
+		if (attr->attlen == -1 &&
+			VARATT_IS_EXTERNAL(DatumGetPointer(origval)))
+		{
+			appendStringInfoString(out, "unchanged-toast-datum");
+			continue;
+		}
+
+		getTypeOutputInfo(attr->atttypid, &typoutput, &typisvarlena);
+		outputstr = OidOutputFunctionCall(typoutput, origval);
+
+		switch (attr->atttypid)
+		{
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case OIDOID:
+			case FLOAT4OID:
+			case FLOAT8OID:
+			case NUMERICOID:
+				appendStringInfoString(out, outputstr);
+				break;
+			case BOOLOID:
+				appendStringInfoString(out,
+									   strcmp(outputstr, "t") == 0 ? "true" : "false");
+				break;
+			default:
+				appendStringInfoString(out, quote_literal_cstr(outputstr));
+				break;
+		}
+	}
+}
+
+
+/* ----------------------------------------------------------------
+ *		SQL-callable functions
+ * ----------------------------------------------------------------
+ */
+
+static XLogRecPtr
+ParseLocation(const char *str)
+{
+	XLogRecPtr	location;
+
+	if (sscanf(str, "%X/%X", &location.xlogid, &location.xrecoff) != 2)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("could not parse WAL location \"%s\"", str)));
+	return location;
+}
+
+static text *
+LocationGetText(XLogRecPtr location)
+{
+	char		buf[MAXFNAMELEN];
+
+	snprintf(buf, sizeof(buf), "%X/%X", location.xlogid, location.xrecoff);
+	return cstring_to_text(buf);
+}
+
+static void
+CheckLogicalDecodingRequirements(void)
+{
+	if (!superuser() && !is_authenticated_user_replication_role())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+			 errmsg("must be superuser or replication role to use logical decoding")));
+
+	if (RecoveryInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("recovery is in progress"),
+				 errhint("Logical decoding cannot be used during recovery.")));
+
+	if (!XLogLogicalInfoActive())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("WAL level not sufficient for logical decoding"),
+				 errhint("wal_level must be set to \"logical\" at server start.")));
+}
+
+/*
+ * pg_logical_start_point: find a location from which decoding can begin
+ *
+ * Returns a restart location, from which WAL must be read, and a start
+ * location: every transaction whose commit ends after the start location
+ * is decoded completely when reading from the restart location.  We get
+ * there by waiting for all transactions of the current database that are
+ * running at the restart location to finish.
+ */
+Datum
+pg_logical_start_point(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[2];
+	bool		nulls[2];
+	XLogRecPtr	restart;
+	XLogRecPtr	start;
+	VirtualTransactionId *vxids;
+	int			nvxids;
+	int			i;
+
+	CheckLogicalDecodingRequirements();
+
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+		ereport(ERROR,
+				(errcode(ERRCODE_ACTIVE_SQL_TRANSACTION),
+				 errmsg("cannot find a logical decoding start point in a transaction that has made changes")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	restart = GetXLogInsertRecPtr();
+
+	vxids = GetCurrentVirtualXIDs(InvalidTransactionId, false, false, 0,
+								  &nvxids);
+	for (i = 0; i < nvxids; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+		(void) VirtualXactLock(vxids[i], true);
+	}
+
+	start = GetXLogInsertRecPtr();
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = PointerGetDatum(LocationGetText(restart));
+	values[1] = PointerGetDatum(LocationGetText(start));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
+/*
+ * pg_logical_changes: decode the transactions committed in a range of WAL
+ *
+ * WAL is read from restart_from up to upto (or the current flush location),
+ * and the changes of every transaction of the current database whose commit
+ * ends after 'after' are returned, one row per line of plugin output.  A
+ * NULL plugin selects the builtin text output.
+ */
+Datum
+pg_logical_changes(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	LogicalDecoder decoder;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	XLogRecPtr	flushptr;
+	XLogRecord *record;
+	HASHCTL		ctl;
+
+	CheckLogicalDecodingRequirements();
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("restart and after locations must not be null")));
+
+	MemSet(&decoder, 0, sizeof(decoder));
+
+	/* build tuplestore in query context */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+	if (get_call_result_type(fcinfo, NULL, &decoder.tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	decoder.tupdesc = CreateTupleDescCopy(decoder.tupdesc);
+	decoder.tupstore =
+		tuplestore_begin_heap(rsinfo->allowedModes & SFRM_Materialize_Random,
+							  false, work_mem);
+	MemoryContextSwitchTo(oldcontext);
+
+	decoder.context = AllocSetContextCreate(CurrentMemoryContext,
+											"logical decoding",
+											ALLOCSET_DEFAULT_MINSIZE,
+											ALLOCSET_DEFAULT_INITSIZE,
+											ALLOCSET_DEFAULT_MAXSIZE);
+	decoder.change_context = AllocSetContextCreate(decoder.context,
+												   "logical decoding change",
+												   ALLOCSET_DEFAULT_MINSIZE,
+												   ALLOCSET_DEFAULT_INITSIZE,
+												   ALLOCSET_DEFAULT_MAXSIZE);
+	decoder.toast_context = AllocSetContextCreate(decoder.context,
+												  "logical decoding TOAST",
+												  ALLOCSET_DEFAULT_MINSIZE,
+												  ALLOCSET_DEFAULT_INITSIZE,
+												  ALLOCSET_DEFAULT_MAXSIZE);
+	oldcontext = MemoryContextSwitchTo(decoder.context);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(TransactionId);
+	ctl.entrysize = sizeof(ReorderTXN);
+	ctl.hash = oid_hash;
+	ctl.hcxt = decoder.context;
+	decoder.txns = hash_create("logical decoding transactions", 64, &ctl,
+							   HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+	DLInitList(&decoder.txns_by_lsn);
+
+	decoder.reader.EndRecPtr = ParseLocation(text_to_cstring(PG_GETARG_TEXT_PP(0)));
+	decoder.after = ParseLocation(text_to_cstring(PG_GETARG_TEXT_PP(1)));
+	flushptr = GetFlushRecPtr();
+	decoder.reader.readLimit = flushptr;
+	decoder.reader.stopAt = flushptr;
+	if (!PG_ARGISNULL(2))
+	{
+		XLogRecPtr	upto = ParseLocation(text_to_cstring(PG_GETARG_TEXT_PP(2)));
+
+		if (XLByteLT(upto, flushptr))
+			decoder.reader.stopAt = upto;
+	}
+	decoder.reader.first = true;
+	decoder.reader.pageBuf = palloc(XLOG_BLCKSZ);
+	decoder.reader.recordBufSize = 4 * XLOG_BLCKSZ;
+	decoder.reader.recordBuf = palloc(decoder.reader.recordBufSize);
+
+	/* Set up the output plugin */
+	initStringInfo(&decoder.out);
+	decoder.plugin_ctx.out = &decoder.out;
+	if (PG_ARGISNULL(3))
+	{
+		decoder.callbacks.begin_cb = text_begin;
+		decoder.callbacks.change_cb = text_change;
+		decoder.callbacks.commit_cb = text_commit;
+	}
+	else
+	{
+		char	   *plugin = text_to_cstring(PG_GETARG_TEXT_PP(3));
+		LogicalOutputPluginInit plugin_init;
+
+		plugin_init = (LogicalOutputPluginInit)
+			load_external_function(plugin, "_PG_output_plugin_init",
+								   true, NULL);
+		plugin_init(&decoder.callbacks);
+		if (decoder.callbacks.change_cb == NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("output plugin \"%s\" did not register a change callback",
+							plugin)));
+	}
+
+	decoder.restart = decoder.reader.EndRecPtr;
+	if (decoder.callbacks.startup_cb)
+	{
+		MemoryContextSwitchTo(decoder.change_context);
+		decoder.callbacks.startup_cb(&decoder.plugin_ctx);
+		MemoryContextSwitchTo(decoder.context);
+		EmitOutput(&decoder);
+	}
+
+	while ((record = LogicalReadRecord(&decoder.reader)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+		DecodeRecord(&decoder, record);
+	}
+
+	if (decoder.callbacks.shutdown_cb)
+	{
+		MemoryContextSwitchTo(decoder.change_context);
+		decoder.callbacks.shutdown_cb(&decoder.plugin_ctx);
+		MemoryContextSwitchTo(decoder.context);
+		EmitOutput(&decoder);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextDelete(decoder.context);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(decoder.tupstore);
+
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = decoder.tupstore;
+	rsinfo->setDesc = decoder.tupdesc;
+
+	return (Datum) 0;
+}
@@ -56,6 +56,7 @@ Node *replication_parse_result;
 %union {
 		char					*str;
 		bool					boolval;
+		uint32					uintval;
 
 		XLogRecPtr				recptr;
 		Node					*node;
@@ -65,22 +66,32 @@ Node *replication_parse_result;
 
 /* Non-keyword tokens */
 %token <str> SCONST
+%token <uintval> UCONST
 %token <recptr> RECPTR
 
 /* Keyword tokens. */
 %token K_BASE_BACKUP
+%token K_COMPRESS
 %token K_IDENTIFY_SYSTEM
+%token K_INCREMENTAL
 %token K_LABEL
 %token K_PROGRESS
 %token K_FAST
 %token K_NOWAIT
+%token K_OF
+%token K_SEND_FILES
+%token K_SHARD
 %token K_WAL
+%token K_START_BACKUP
 %token K_START_REPLICATION
+%token K_STOP_BACKUP
 
 %type <node>	command
-%type <node>	base_backup start_replication identify_system
+%type <node>	base_backup start_backup send_files stop_backup
+%type <node>	start_replication identify_system
 %type <list>	base_backup_opt_list
 %type <defelt>	base_backup_opt
+%type <boolval>	opt_compress
 %%
 
 firstcmd: command opt_semicolon
@@ -96,6 +107,9 @@ opt_semicolon:	';'
 command:
 			identify_system
 			| base_backup
+			| start_backup
+			| send_files
+			| stop_backup
 			| start_replication
 			;
 
@@ -111,11 +125,52 @@ identify_system:
 
 /*
  * BASE_BACKUP [LABEL '<label>'] [PROGRESS] [FAST] [WAL] [NOWAIT]
+ *		[INCREMENTAL '<lsn>']
  */
 base_backup:
 			K_BASE_BACKUP base_backup_opt_list
 				{
 					BaseBackupCmd *cmd = (BaseBackupCmd *) makeNode(BaseBackupCmd);
+					cmd->kind = BASE_BACKUP_FULL;
+					cmd->options = $2;
+					$$ = (Node *) cmd;
+				}
+			;
+
+/*
+ * START_BACKUP [LABEL '<label>'] [PROGRESS] [FAST]
+ */
+start_backup:
+			K_START_BACKUP base_backup_opt_list
+				{
+					BaseBackupCmd *cmd = (BaseBackupCmd *) makeNode(BaseBackupCmd);
+					cmd->kind = BASE_BACKUP_START;
+					cmd->options = $2;
+					$$ = (Node *) cmd;
+				}
+			;
+
+/*
+ * SEND_FILES [PROGRESS] [SHARD n OF m] [INCREMENTAL '<lsn>']
+ */
+send_files:
+			K_SEND_FILES base_backup_opt_list
+				{
+					BaseBackupCmd *cmd = (BaseBackupCmd *) makeNode(BaseBackupCmd);
+					cmd->kind = BASE_BACKUP_SEND_FILES;
+					cmd->options = $2;
+					$$ = (Node *) cmd;
+				}
+			;
+
+/*
+ * STOP_BACKUP [NOWAIT]
+ */
+stop_backup:
+			K_STOP_BACKUP base_backup_opt_list
+				{
+					BaseBackupCmd *cmd = (BaseBackupCmd *) makeNode(BaseBackupCmd);
+					cmd->kind = BASE_BACKUP_STOP;
 					cmd->options = $2;
 					$$ = (Node *) cmd;
 				}
@@ -150,22 +205,39 @@ base_backup_opt:
 				  $$ = makeDefElem("nowait",
 						   (Node *)makeInteger(TRUE));
 				}
+			| K_INCREMENTAL SCONST
+				{
+				  $$ = makeDefElem("incremental",
+						   (Node *)makeString($2));
+				}
+			| K_SHARD UCONST K_OF UCONST
+				{
+				  $$ = makeDefElem("shard",
+						   (Node *)list_make2(makeInteger($2),
+											  makeInteger($4)));
+				}
 			;
 
 /*
- * START_REPLICATION %X/%X
+ * START_REPLICATION %X/%X [COMPRESS]
  */
 start_replication:
-			K_START_REPLICATION RECPTR
+			K_START_REPLICATION RECPTR opt_compress
 				{
 					StartReplicationCmd *cmd;
 
 					cmd = makeNode(StartReplicationCmd);
 					cmd->startpoint = $2;
+					cmd->compress = $3;
 
 					$$ = (Node *) cmd;
 				}
 			;
+
+opt_compress:
+			K_COMPRESS					{ $$ = true; }
+			| /* EMPTY */				{ $$ = false; }
+			;
 %%
 
 #include "repl_scanner.c"
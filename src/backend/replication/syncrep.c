@@ -28,11 +28,16 @@
  * single ordered queue of waiting backends, so that we can avoid
  * searching the through all waiters each time we receive a reply.
  *
- * In 9.1 we support only a single synchronous standby, chosen from a
- * priority list of synchronous_standby_names. Before it can become the
- * synchronous standby it must have caught up with the primary; that may
- * take some time. Once caught up, the current highest priority standby
- * will release waiters from the queue.
+ * synchronous_standby_names lists the potential synchronous standbys and
+ * says how many of them must confirm a commit.  With the priority method
+ * ("FIRST n (list)", or just a list, which means FIRST 1) we wait for the n
+ * connected standbys that appear earliest in the list; with the quorum
+ * method ("ANY n (list)") we wait for any n of the listed standbys, so that
+ * commit latency follows the fastest n rather than a fixed set.  Before it
+ * can take part, a standby must have caught up with the primary; that may
+ * take some time.  Each reply from a participating standby recomputes the
+ * location that enough standbys have flushed, and releases the waiters up
+ * to there.
  *
  * Portions Copyright (c) 2010-2012, PostgreSQL Global Development Group
  *
@@ -43,6 +48,8 @@
  */
 #include "postgres.h"
 
+#include <ctype.h>
+#include <limits.h>
 #include <unistd.h>
 
 #include "access/xact.h"
@@ -59,6 +66,9 @@
 /* User-settable parameters for sync rep */
 char	   *SyncRepStandbyNames;
 
+/* Parsed form of the above, set by assign_synchronous_standby_names */
+SyncRepConfigData *SyncRepConfig = NULL;
+
 #define SyncStandbysDefined() \
 	(SyncRepStandbyNames != NULL && SyncRepStandbyNames[0] != '\0')
 
@@ -71,6 +81,8 @@ static void SyncRepQueueInsert(void);
 static void SyncRepCancelWait(void);
 
 static int	SyncRepGetStandbyPriority(void);
+static bool SyncRepGetSyncRecPtr(XLogRecPtr *flushPtr, bool *am_sync);
+static int	cmp_lsn_desc(const void *a, const void *b);
 
 #ifdef USE_ASSERT_CHECKING
 static bool SyncRepQueueIsOrderedByLSN(void);
@@ -357,20 +369,17 @@ SyncRepInitConfig(void)
 }
 
 /*
- * Update the LSNs on each queue based upon our latest state. This
- * implements a simple policy of first-valid-standby-releases-waiter.
- *
- * Other policies are possible, which would change what we do here and what
- * perhaps also which information we store as well.
+ * Update the LSNs on each queue based upon our latest state, and release
+ * the waiters that enough synchronous standbys have now confirmed.
  */
 void
 SyncRepReleaseWaiters(void)
 {
 	volatile WalSndCtlData *walsndctl = WalSndCtl;
-	volatile WalSnd *syncWalSnd = NULL;
+	XLogRecPtr	syncflush;
+	bool		got_recptr;
+	bool		am_sync;
 	int			numprocs = 0;
-	int			priority = 0;
-	int			i;
 
 	/*
 	 * If this WALSender is serving a standby that is not on the list of
@@ -378,75 +387,219 @@ SyncRepReleaseWaiters(void)
 	 * up or still running base backup, then leave quickly also.
 	 */
 	if (MyWalSnd->sync_standby_priority == 0 ||
-		MyWalSnd->state < WALSNDSTATE_STREAMING)
+		MyWalSnd->state < WALSNDSTATE_STREAMING ||
+		SyncRepConfig == NULL)
 		return;
 
 	/*
-	 * We're a potential sync standby. Release waiters if we are the highest
-	 * priority standby. If there are multiple standbys with same priorities
-	 * then we use the first mentioned standby. If you change this, also
-	 * change pg_stat_get_wal_senders().
-	 */
-	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
-
-	for (i = 0; i < max_wal_senders; i++)
-	{
-		/* use volatile pointer to prevent code rearrangement */
-		volatile WalSnd *walsnd = &walsndctl->walsnds[i];
-
-		if (walsnd->pid != 0 &&
-			walsnd->sync_standby_priority > 0 &&
-			(priority == 0 ||
-			 priority > walsnd->sync_standby_priority))
-		{
-			priority = walsnd->sync_standby_priority;
-			syncWalSnd = walsnd;
-		}
-	}
-
-	/*
-	 * We should have found ourselves at least.
-	 */
-	Assert(syncWalSnd);
-
-	/*
-	 * If we aren't managing the highest priority standby then just leave.
+	 * Fast path: a reply confirming nothing beyond what has already been
+	 * released can't release anyone else either, whatever the method,
+	 * because the released location only depends on our flush location
+	 * through the minimum or the n'th largest of the standbys' locations.
+	 * Most replies are like that when several standbys are streaming, so
+	 * check it with a shared lock, to avoid serializing the walsenders.
 	 */
-	if (syncWalSnd != MyWalSnd)
+	LWLockAcquire(SyncRepLock, LW_SHARED);
+	if (XLByteLE(MyWalSnd->flush, walsndctl->lsn))
 	{
 		LWLockRelease(SyncRepLock);
-		announce_next_takeover = true;
 		return;
 	}
+	LWLockRelease(SyncRepLock);
+
+	LWLockAcquire(SyncRepLock, LW_EXCLUSIVE);
+
+	got_recptr = SyncRepGetSyncRecPtr(&syncflush, &am_sync);
 
-	if (XLByteLT(walsndctl->lsn, MyWalSnd->flush))
+	if (got_recptr && XLByteLT(walsndctl->lsn, syncflush))
 	{
 		/*
 		 * Set the lsn first so that when we wake backends they will release
 		 * up to this location.
 		 */
-		walsndctl->lsn = MyWalSnd->flush;
+		walsndctl->lsn = syncflush;
 		numprocs = SyncRepWakeQueue(false);
 	}
 
 	LWLockRelease(SyncRepLock);
 
+	/*
+	 * If we aren't one of the standbys whose confirmation counts, or not
+	 * enough of them are connected, then just leave.
+	 */
+	if (!am_sync || !got_recptr)
+	{
+		announce_next_takeover = true;
+		return;
+	}
+
 	elog(DEBUG3, "released %d procs up to %X/%X",
 		 numprocs,
-		 MyWalSnd->flush.xlogid,
-		 MyWalSnd->flush.xrecoff);
+		 syncflush.xlogid,
+		 syncflush.xrecoff);
 
 	/*
-	 * If we are managing the highest priority standby, though we weren't
-	 * prior to this, then announce we are now the sync standby.
+	 * If we are a synchronous standby, though we weren't prior to this, then
+	 * announce it.
 	 */
 	if (announce_next_takeover)
 	{
 		announce_next_takeover = false;
-		ereport(LOG,
-				(errmsg("standby \"%s\" is now the synchronous standby with priority %u",
-						application_name, MyWalSnd->sync_standby_priority)));
+		if (SyncRepConfig->syncrep_method == SYNC_REP_PRIORITY)
+			ereport(LOG,
+					(errmsg("standby \"%s\" is now a synchronous standby with priority %u",
+							application_name, MyWalSnd->sync_standby_priority)));
+		else
+			ereport(LOG,
+					(errmsg("standby \"%s\" is now a candidate for quorum synchronous standby",
+							application_name)));
+	}
+}
+
+/*
+ * Compute the location up to which enough synchronous standbys have
+ * flushed WAL to release waiters.  Returns false if fewer standbys than
+ * required are streaming.  *am_sync is set to whether our standby is one of
+ * those whose confirmation counts.
+ *
+ * With the priority method that location is the minimum flush location of
+ * the chosen standbys; with the quorum method it is the num_sync'th largest
+ * flush location of all the candidates.
+ *
+ * Must hold SyncRepLock.
+ */
+static bool
+SyncRepGetSyncRecPtr(XLogRecPtr *flushPtr, bool *am_sync)
+{
+	int		   *standbys;
+	XLogRecPtr *flushes;
+	int			nstandbys;
+	int			i;
+
+	*am_sync = false;
+
+	standbys = (int *) palloc(max_wal_senders * sizeof(int));
+	flushes = (XLogRecPtr *) palloc(max_wal_senders * sizeof(XLogRecPtr));
+
+	nstandbys = SyncRepGetSyncStandbys(standbys);
+	for (i = 0; i < nstandbys; i++)
+	{
+		/* use volatile pointer to prevent code rearrangement */
+		volatile WalSnd *walsnd = &WalSndCtl->walsnds[standbys[i]];
+
+		if (walsnd == MyWalSnd)
+			*am_sync = true;
+
+		SpinLockAcquire(&walsnd->mutex);
+		flushes[i] = walsnd->flush;
+		SpinLockRelease(&walsnd->mutex);
+	}
+
+	if (nstandbys < SyncRepConfig->num_sync)
+	{
+		pfree(standbys);
+		pfree(flushes);
+		return false;
+	}
+
+	if (SyncRepConfig->syncrep_method == SYNC_REP_PRIORITY)
+	{
+		*flushPtr = flushes[0];
+		for (i = 1; i < nstandbys; i++)
+		{
+			if (XLByteLT(flushes[i], *flushPtr))
+				*flushPtr = flushes[i];
+		}
+	}
+	else
+	{
+		qsort(flushes, nstandbys, sizeof(XLogRecPtr), cmp_lsn_desc);
+		*flushPtr = flushes[SyncRepConfig->num_sync - 1];
+	}
+
+	pfree(standbys);
+	pfree(flushes);
+	return true;
+}
+
+/*
+ * Return the walsnds[] indexes of the standbys whose confirmation counts
+ * towards releasing waiters: with the priority method, the (up to) num_sync
+ * streaming standbys of highest priority, the first mentioned winning ties;
+ * with the quorum method, every streaming standby on the list.  standbys[]
+ * must have room for max_wal_senders entries.  pg_stat_get_wal_senders
+ * uses this too, to tell which standbys are synchronous.
+ *
+ * Must hold SyncRepLock.
+ */
+int
+SyncRepGetSyncStandbys(int *standbys)
+{
+	volatile WalSndCtlData *walsndctl = WalSndCtl;
+	int			ncandidates = 0;
+	int			i;
+
+	if (SyncRepConfig == NULL)
+		return 0;
+
+	for (i = 0; i < max_wal_senders; i++)
+	{
+		/* use volatile pointer to prevent code rearrangement */
+		volatile WalSnd *walsnd = &walsndctl->walsnds[i];
+
+		if (walsnd->pid != 0 &&
+			walsnd->sync_standby_priority > 0 &&
+			walsnd->state == WALSNDSTATE_STREAMING)
+			standbys[ncandidates++] = i;
 	}
+
+	if (SyncRepConfig->syncrep_method == SYNC_REP_PRIORITY)
+	{
+		int			nchosen;
+
+		/*
+		 * Move the num_sync best candidates to the front, by selection; the
+		 * lists involved are tiny.  Ties go to the lower index, which is the
+		 * order the candidates were found in.
+		 */
+		for (nchosen = 0;
+			 nchosen < ncandidates && nchosen < SyncRepConfig->num_sync;
+			 nchosen++)
+		{
+			int			best = nchosen;
+			int			j;
+			int			tmp;
+
+			for (j = nchosen + 1; j < ncandidates; j++)
+			{
+				if (walsndctl->walsnds[standbys[j]].sync_standby_priority <
+					walsndctl->walsnds[standbys[best]].sync_standby_priority ||
+					(walsndctl->walsnds[standbys[j]].sync_standby_priority ==
+					 walsndctl->walsnds[standbys[best]].sync_standby_priority &&
+					 standbys[j] < standbys[best]))
+					best = j;
+			}
+			tmp = standbys[nchosen];
+			standbys[nchosen] = standbys[best];
+			standbys[best] = tmp;
+		}
+		ncandidates = nchosen;
+	}
+
+	return ncandidates;
+}
+
+static int
+cmp_lsn_desc(const void *a, const void *b)
+{
+	XLogRecPtr	lsn1 = *((const XLogRecPtr *) a);
+	XLogRecPtr	lsn2 = *((const XLogRecPtr *) b);
+
+	if (XLByteLT(lsn1, lsn2))
+		return 1;
+	if (XLByteLT(lsn2, lsn1))
+		return -1;
+	return 0;
 }
 
 /*
@@ -460,50 +613,26 @@ SyncRepReleaseWaiters(void)
 static int
 SyncRepGetStandbyPriority(void)
 {
-	char	   *rawstring;
-	List	   *elemlist;
-	ListCell   *l;
-	int			priority = 0;
-	bool		found = false;
+	const char *standby_name;
+	int			priority;
 
 	/*
 	 * Since synchronous cascade replication is not allowed, we always
 	 * set the priority of cascading walsender to zero.
 	 */
-	if (am_cascading_walsender)
-		return 0;
-
-	/* Need a modifiable copy of string */
-	rawstring = pstrdup(SyncRepStandbyNames);
-
-	/* Parse string into list of identifiers */
-	if (!SplitIdentifierString(rawstring, ',', &elemlist))
-	{
-		/* syntax error in list */
-		pfree(rawstring);
-		list_free(elemlist);
-		/* GUC machinery will have already complained - no need to do again */
+	if (am_cascading_walsender || SyncRepConfig == NULL)
 		return 0;
-	}
 
-	foreach(l, elemlist)
+	standby_name = SyncRepConfig->member_names;
+	for (priority = 1; priority <= SyncRepConfig->nmembers; priority++)
 	{
-		char	   *standby_name = (char *) lfirst(l);
-
-		priority++;
-
 		if (pg_strcasecmp(standby_name, application_name) == 0 ||
 			pg_strcasecmp(standby_name, "*") == 0)
-		{
-			found = true;
-			break;
-		}
+			return priority;
+		standby_name += strlen(standby_name) + 1;
 	}
 
-	pfree(rawstring);
-	list_free(elemlist);
-
-	return (found ? priority : 0);
+	return 0;
 }
 
 /*
@@ -643,17 +772,89 @@ SyncRepQueueIsOrderedByLSN(void)
  * ===========================================================
  */
 
+/*
+ * synchronous_standby_names is one of
+ *		standby_name [, ...]
+ *		[FIRST] num_sync ( standby_name [, ...] )
+ *		ANY num_sync ( standby_name [, ...] )
+ * The first form is the same as FIRST 1 (...).
+ */
 bool
 check_synchronous_standby_names(char **newval, void **extra, GucSource source)
 {
 	char	   *rawstring;
+	char	   *list;
+	char	   *p;
 	List	   *elemlist;
+	ListCell   *l;
+	int			num_sync = 1;
+	uint8		syncrep_method = SYNC_REP_PRIORITY;
+	SyncRepConfigData *config;
+	int			size;
+	char	   *ptr;
 
 	/* Need a modifiable copy of string */
 	rawstring = pstrdup(*newval);
+	list = rawstring;
+
+	p = rawstring;
+	while (isspace((unsigned char) *p))
+		p++;
+	if (pg_strncasecmp(p, "ANY", 3) == 0 &&
+		(isspace((unsigned char) p[3]) || isdigit((unsigned char) p[3])))
+	{
+		syncrep_method = SYNC_REP_QUORUM;
+		p += 3;
+	}
+	else if (pg_strncasecmp(p, "FIRST", 5) == 0 &&
+			 (isspace((unsigned char) p[5]) || isdigit((unsigned char) p[5])))
+		p += 5;
+	else if (!isdigit((unsigned char) *p))
+		p = NULL;				/* plain list */
+
+	if (p != NULL)
+	{
+		char	   *endptr;
+		char	   *close;
+		long		val;
+
+		while (isspace((unsigned char) *p))
+			p++;
+		errno = 0;
+		val = strtol(p, &endptr, 10);
+		if (endptr == p || errno != 0 || val <= 0 || val > INT_MAX)
+		{
+			GUC_check_errdetail("The number of synchronous standbys must be a positive integer.");
+			pfree(rawstring);
+			return false;
+		}
+		num_sync = (int) val;
+
+		p = endptr;
+		while (isspace((unsigned char) *p))
+			p++;
+		close = strrchr(p, ')');
+		if (*p != '(' || close == NULL)
+		{
+			GUC_check_errdetail("The list of standby names must be in parentheses.");
+			pfree(rawstring);
+			return false;
+		}
+		for (endptr = close + 1; *endptr; endptr++)
+		{
+			if (!isspace((unsigned char) *endptr))
+			{
+				GUC_check_errdetail("Unexpected text after the list of standby names.");
+				pfree(rawstring);
+				return false;
+			}
+		}
+		*close = '\0';
+		list = p + 1;
+	}
 
 	/* Parse string into list of identifiers */
-	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	if (!SplitIdentifierString(list, ',', &elemlist))
 	{
 		/* syntax error in list */
 		GUC_check_errdetail("List syntax is invalid.");
@@ -662,6 +863,15 @@ check_synchronous_standby_names(char **newval, void **extra, GucSource source)
 		return false;
 	}
 
+	if ((p != NULL || elemlist != NIL) && num_sync > list_length(elemlist))
+	{
+		GUC_check_errdetail("The number of synchronous standbys (%d) must not exceed the number of standby names (%d).",
+							num_sync, list_length(elemlist));
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
 	/*
 	 * Any additional validation of standby names should go here.
 	 *
@@ -670,8 +880,38 @@ check_synchronous_standby_names(char **newval, void **extra, GucSource source)
 	 * yet correctly set.
 	 */
 
+	size = offsetof(SyncRepConfigData, member_names);
+	foreach(l, elemlist)
+		size += strlen((char *) lfirst(l)) + 1;
+
+	config = (SyncRepConfigData *) malloc(size);
+	if (config == NULL)
+	{
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+	config->config_size = size;
+	config->num_sync = num_sync;
+	config->syncrep_method = syncrep_method;
+	config->nmembers = list_length(elemlist);
+	ptr = config->member_names;
+	foreach(l, elemlist)
+	{
+		strcpy(ptr, (char *) lfirst(l));
+		ptr += strlen(ptr) + 1;
+	}
+
+	*extra = (void *) config;
+
 	pfree(rawstring);
 	list_free(elemlist);
 
 	return true;
 }
+
+void
+assign_synchronous_standby_names(const char *newval, void *extra)
+{
+	SyncRepConfig = (SyncRepConfigData *) extra;
+}
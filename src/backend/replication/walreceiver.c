@@ -58,6 +58,7 @@ bool		am_walreceiver;
 /* GUC variable */
 int			wal_receiver_status_interval;
 bool		hot_standby_feedback;
+bool		wal_receiver_compression;
 
 /* libpqreceiver hooks to these when loaded */
 walrcv_connect_type walrcv_connect = NULL;
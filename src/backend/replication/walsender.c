@@ -46,6 +46,7 @@
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
 #include "nodes/replnodes.h"
+#include "pgstat.h"
 #include "replication/basebackup.h"
 #include "replication/syncrep.h"
 #include "replication/walprotocol.h"
@@ -61,6 +62,7 @@
 #include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
+#include "utils/pg_lzcompress.h"
 #include "utils/ps_status.h"
 #include "utils/resowner.h"
 #include "utils/timestamp.h"
@@ -96,6 +98,25 @@ static uint32 sendOff = 0;
  */
 static XLogRecPtr sentPtr = {0, 0};
 
+/*
+ * Did the standby ask for compressed WAL data messages?  If so,
+ * compress_message is the work area they are built in.
+ */
+static bool sendCompressed = false;
+static char *compress_message = NULL;
+
+/*
+ * How many bytes of WAL we queue in the libpq output buffer before trying
+ * to flush it.  This starts at one message's worth and adapts to the link:
+ * it grows while each batch goes out in a single non-blocking flush (the
+ * socket could have taken more), and shrinks when the flush leaves data
+ * behind.  On a long, fat link that keeps the kernel send buffer full
+ * between our wakeups rather than refilling it 128kB at a time.
+ */
+#define MAX_SEND_WINDOW		(MAX_SEND_SIZE * 16)
+
+static Size sendWindow = MAX_SEND_SIZE;
+
 /*
  * Buffer for processing reply messages.
  */
@@ -124,7 +145,7 @@ static int	WalSndLoop(void);
 static void InitWalSnd(void);
 static void WalSndHandshake(void);
 static void WalSndKill(int code, Datum arg);
-static void XLogSend(char *msgbuf, bool *caughtup);
+static Size XLogSend(char *msgbuf, bool *caughtup);
 static void IdentifySystem(void);
 static void StartReplication(StartReplicationCmd *cmd);
 static void ProcessStandbyMessage(void);
@@ -431,6 +452,7 @@ StartReplication(StartReplicationCmd *cmd)
 	 * be shipped from that position
 	 */
 	sentPtr = cmd->startpoint;
+	sendCompressed = cmd->compress;
 }
 
 /*
@@ -712,6 +734,7 @@ WalSndLoop(void)
 {
 	char	   *output_message;
 	bool		caughtup = false;
+	Size		batchbytes;
 
 	/*
 	 * Allocate buffer that will be used for each output message.  We do this
@@ -719,6 +742,9 @@ WalSndLoop(void)
 	 * enough for maximum-sized messages.
 	 */
 	output_message = palloc(1 + sizeof(WalDataMessageHeader) + MAX_SEND_SIZE);
+	if (sendCompressed)
+		compress_message = palloc(1 + sizeof(WalDataMessageHeader) +
+								  PGLZ_MAX_OUTPUT(MAX_SEND_SIZE));
 
 	/*
 	 * Allocate buffer that will be used for processing reply messages.  As
@@ -765,12 +791,18 @@ WalSndLoop(void)
 
 		/*
 		 * If we don't have any pending data in the output buffer, try to send
-		 * some more.  If there is some, we don't bother to call XLogSend
-		 * again until we've flushed it ... but we'd better assume we are not
-		 * caught up.
+		 * some more, up to the current send window.  If there is some, we
+		 * don't bother to call XLogSend again until we've flushed it ... but
+		 * we'd better assume we are not caught up.
 		 */
+		batchbytes = 0;
 		if (!pq_is_send_pending())
-			XLogSend(output_message, &caughtup);
+		{
+			do
+			{
+				batchbytes += XLogSend(output_message, &caughtup);
+			} while (!caughtup && batchbytes < sendWindow);
+		}
 		else
 			caughtup = false;
 
@@ -778,6 +810,18 @@ WalSndLoop(void)
 		if (pq_flush_if_writable() != 0)
 			break;
 
+		/*
+		 * Adjust the send window if we filled it.  A batch cut short by
+		 * running out of WAL tells us nothing about the link.
+		 */
+		if (batchbytes >= sendWindow)
+		{
+			if (!pq_is_send_pending())
+				sendWindow = Min(sendWindow * 2, MAX_SEND_WINDOW);
+			else
+				sendWindow = Max(sendWindow / 2, MAX_SEND_SIZE);
+		}
+
 		/* If nothing remains to be sent right now ... */
 		if (caughtup && !pq_is_send_pending())
 		{
@@ -957,8 +1001,8 @@ WalSndKill(int code, Datum arg)
 /*
  * Read 'count' bytes from WAL into 'buf', starting at location 'startptr'
  *
- * XXX probably this should be improved to suck data directly from the
- * WAL buffers when possible.
+ * Whatever is still in the WAL buffers is copied from there; only the rest
+ * is read from the segment files.
  *
  * Will open, and keep open, one WAL segment stored in the global file
  * descriptor sendFile. This means if XLogRead is used once, there will
@@ -976,6 +1020,24 @@ XLogRead(char *buf, XLogRecPtr startptr, Size count)
 	uint32		log;
 	uint32		seg;
 
+	/*
+	 * Recent WAL is usually still in the WAL buffers.  Copying it from there
+	 * saves a read() per standby, and means walsenders that keep up don't
+	 * touch the segment files at all.  A cascading walsender has nothing
+	 * there; the WAL it sends was written by the walreceiver.
+	 */
+	if (!am_cascading_walsender)
+	{
+		Size		nfrombuf;
+
+		nfrombuf = XLogReadFromBuffers(buf, startptr, count);
+		if (nfrombuf == count)
+			return;
+		buf += nfrombuf;
+		XLByteAdvance(startptr, nfrombuf);
+		count -= nfrombuf;
+	}
+
 retry:
 	p = buf;
 	recptr = startptr;
@@ -1044,7 +1106,9 @@ retry:
 		else
 			segbytes = nbytes;
 
+		pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
 		readbytes = read(sendFile, p, segbytes);
+		pgstat_report_wait_end();
 		if (readbytes <= 0)
 			ereport(ERROR,
 					(errcode_for_file_access(),
@@ -1118,10 +1182,13 @@ retry:
  * It must be of size 1 + sizeof(WalDataMessageHeader) + MAX_SEND_SIZE.
  *
  * If there is no unsent WAL remaining, *caughtup is set to true, otherwise
- * *caughtup is set to false.
+ * *caughtup is set to false.  Returns the number of bytes of WAL queued.
+ *
+ * If the standby asked for compression, the slice is sent as a 'z' message
+ * whenever pglz can shrink it; otherwise it goes out as plain 'w'.
 
  */
-static void
+static Size
 XLogSend(char *msgbuf, bool *caughtup)
 {
 	XLogRecPtr	SendRqstPtr;
@@ -1129,6 +1196,7 @@ XLogSend(char *msgbuf, bool *caughtup)
 	XLogRecPtr	endptr;
 	Size		nbytes;
 	WalDataMessageHeader msghdr;
+	PGLZ_Header *lzdata;
 
 	/*
 	 * Attempt to send all data that's already been written out and fsync'd to
@@ -1144,7 +1212,7 @@ XLogSend(char *msgbuf, bool *caughtup)
 	if (XLByteLE(SendRqstPtr, sentPtr))
 	{
 		*caughtup = true;
-		return;
+		return 0;
 	}
 
 	/*
@@ -1206,6 +1274,22 @@ XLogSend(char *msgbuf, bool *caughtup)
 	 */
 	XLogRead(msgbuf + 1 + sizeof(WalDataMessageHeader), startptr, nbytes);
 
+	/*
+	 * Compress the slice into the second work area if the standby wants
+	 * that.  pglz gives up on data it can't shrink, in which case we just
+	 * send it as it is.
+	 */
+	lzdata = NULL;
+	if (sendCompressed)
+	{
+		lzdata = (PGLZ_Header *) (compress_message + 1 + sizeof(WalDataMessageHeader));
+		if (pglz_compress(msgbuf + 1 + sizeof(WalDataMessageHeader), nbytes,
+						  lzdata, PGLZ_strategy_default))
+			compress_message[0] = 'z';
+		else
+			lzdata = NULL;
+	}
+
 	/*
 	 * We fill the message header last so that the send timestamp is taken as
 	 * late as possible.
@@ -1214,9 +1298,17 @@ XLogSend(char *msgbuf, bool *caughtup)
 	msghdr.walEnd = SendRqstPtr;
 	msghdr.sendTime = GetCurrentTimestamp();
 
-	memcpy(msgbuf + 1, &msghdr, sizeof(WalDataMessageHeader));
-
-	pq_putmessage_noblock('d', msgbuf, 1 + sizeof(WalDataMessageHeader) + nbytes);
+	if (lzdata != NULL)
+	{
+		memcpy(compress_message + 1, &msghdr, sizeof(WalDataMessageHeader));
+		pq_putmessage_noblock('d', compress_message,
+							  1 + sizeof(WalDataMessageHeader) + VARSIZE(lzdata));
+	}
+	else
+	{
+		memcpy(msgbuf + 1, &msghdr, sizeof(WalDataMessageHeader));
+		pq_putmessage_noblock('d', msgbuf, 1 + sizeof(WalDataMessageHeader) + nbytes);
+	}
 
 	sentPtr = endptr;
 
@@ -1240,7 +1332,7 @@ XLogSend(char *msgbuf, bool *caughtup)
 		set_ps_display(activitymsg, false);
 	}
 
-	return;
+	return nbytes;
 }
 
 /*
@@ -1480,8 +1572,10 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 	MemoryContext per_query_ctx;
 	MemoryContext oldcontext;
 	int		   *sync_priority;
-	int			priority = 0;
-	int			sync_standby = -1;
+	bool	   *is_sync;
+	int		   *sync_standbys;
+	int			nsync;
+	bool		quorum;
 	int			i;
 
 	/* check to see if caller supports us returning a tuplestore */
@@ -1511,30 +1605,26 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 
 	/*
 	 * Get the priorities of sync standbys all in one go, to minimise lock
-	 * acquisitions and to allow us to evaluate who is the current sync
-	 * standby. This code must match the code in SyncRepReleaseWaiters().
+	 * acquisitions and to allow us to evaluate who are the current sync
+	 * standbys.  SyncRepGetSyncStandbys() makes the same choice as
+	 * SyncRepReleaseWaiters().
 	 */
 	sync_priority = palloc(sizeof(int) * max_wal_senders);
+	is_sync = palloc0(sizeof(bool) * max_wal_senders);
+	sync_standbys = palloc(sizeof(int) * max_wal_senders);
 	LWLockAcquire(SyncRepLock, LW_SHARED);
 	for (i = 0; i < max_wal_senders; i++)
 	{
 		/* use volatile pointer to prevent code rearrangement */
 		volatile WalSnd *walsnd = &WalSndCtl->walsnds[i];
 
-		if (walsnd->pid != 0)
-		{
-			sync_priority[i] = walsnd->sync_standby_priority;
-
-			if (walsnd->state == WALSNDSTATE_STREAMING &&
-				walsnd->sync_standby_priority > 0 &&
-				(priority == 0 ||
-				 priority > walsnd->sync_standby_priority))
-			{
-				priority = walsnd->sync_standby_priority;
-				sync_standby = i;
-			}
-		}
+		sync_priority[i] = walsnd->sync_standby_priority;
 	}
+	nsync = SyncRepGetSyncStandbys(sync_standbys);
+	for (i = 0; i < nsync; i++)
+		is_sync[sync_standbys[i]] = true;
+	quorum = (SyncRepConfig != NULL &&
+			  SyncRepConfig->syncrep_method == SYNC_REP_QUORUM);
 	LWLockRelease(SyncRepLock);
 
 	for (i = 0; i < max_wal_senders; i++)
@@ -1606,7 +1696,9 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 			 */
 			if (sync_priority[i] == 0)
 				values[7] = CStringGetTextDatum("async");
-			else if (i == sync_standby)
+			else if (quorum)
+				values[7] = CStringGetTextDatum("quorum");
+			else if (is_sync[i])
 				values[7] = CStringGetTextDatum("sync");
 			else
 				values[7] = CStringGetTextDatum("potential");
@@ -1615,6 +1707,8 @@ pg_stat_get_wal_senders(PG_FUNCTION_ARGS)
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
 	}
 	pfree(sync_priority);
+	pfree(is_sync);
+	pfree(sync_standbys);
 
 	/* clean up and return the tuplestore */
 	tuplestore_donestoring(tupstore);
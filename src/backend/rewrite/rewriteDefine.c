@@ -254,7 +254,8 @@ DefineQueryRewrite(char *rulename,
 	 * Verify relation is of a type that rules can sensibly be applied to.
 	 */
 	if (event_relation->rd_rel->relkind != RELKIND_RELATION &&
-		event_relation->rd_rel->relkind != RELKIND_VIEW)
+		event_relation->rd_rel->relkind != RELKIND_VIEW &&
+		event_relation->rd_rel->relkind != RELKIND_MATVIEW)
 		ereport(ERROR,
 				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
 				 errmsg("\"%s\" is not a table or view",
@@ -399,7 +400,8 @@ DefineQueryRewrite(char *rulename,
 		}
 
 		/*
-		 * Are we converting a relation to a view?
+		 * Are we converting a relation to a view?  (A materialized view keeps
+		 * its storage; its ON SELECT rule just records the defining query.)
 		 *
 		 * If so, check that the relation is empty because the storage for the
 		 * relation is going to be deleted.  Also insist that the rel not have
@@ -409,7 +411,8 @@ DefineQueryRewrite(char *rulename,
 		 * business of converting relations to views is just a kluge to allow
 		 * loading ancient pg_dump files.)
 		 */
-		if (event_relation->rd_rel->relkind != RELKIND_VIEW)
+		if (event_relation->rd_rel->relkind != RELKIND_VIEW &&
+			event_relation->rd_rel->relkind != RELKIND_MATVIEW)
 		{
 			HeapScanDesc scanDesc;
 
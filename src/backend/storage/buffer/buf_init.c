@@ -14,13 +14,18 @@
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "storage/bufmgr.h"
 #include "storage/buf_internals.h"
 
 
 BufferDesc *BufferDescriptors;
 char	   *BufferBlocks;
+CkptSortItem *CkptBufferIds;
 int32	   *PrivateRefCount;
+int			NumBufferPartitions = 0;
+
+static void SetNumBufferPartitions(void);
 
 
 /*
@@ -73,20 +78,35 @@ void
 InitBufferPool(void)
 {
 	bool		foundBufs,
-				foundDescs;
+				foundDescs,
+				foundCkpt;
+
+	SetNumBufferPartitions();
 
 	BufferDescriptors = (BufferDesc *)
 		ShmemInitStruct("Buffer Descriptors",
 						NBuffers * sizeof(BufferDesc), &foundDescs);
 
+	/* Align the pages for direct I/O; see PG_IO_ALIGN_SIZE */
 	BufferBlocks = (char *)
-		ShmemInitStruct("Buffer Blocks",
-						NBuffers * (Size) BLCKSZ, &foundBufs);
+		TYPEALIGN(PG_IO_ALIGN_SIZE,
+				  ShmemInitStruct("Buffer Blocks",
+								  NBuffers * (Size) BLCKSZ + PG_IO_ALIGN_SIZE,
+								  &foundBufs));
+
+	/*
+	 * The checkpointer's sort array is used only by the checkpointer, but it
+	 * lives in shared memory so that we never fail to allocate it in the
+	 * middle of a checkpoint.
+	 */
+	CkptBufferIds = (CkptSortItem *)
+		ShmemInitStruct("Checkpoint BufferIds",
+						NBuffers * sizeof(CkptSortItem), &foundCkpt);
 
-	if (foundDescs || foundBufs)
+	if (foundDescs || foundBufs || foundCkpt)
 	{
-		/* both should be present or neither */
-		Assert(foundDescs && foundBufs);
+		/* all should be present or neither */
+		Assert(foundDescs && foundBufs && foundCkpt);
 		/* note: this path is only taken in EXEC_BACKEND case */
 	}
 	else
@@ -112,8 +132,10 @@ InitBufferPool(void)
 			buf->buf_id = i;
 
 			/*
-			 * Initially link all the buffers together as unused. Subsequent
-			 * management of this list is done by freelist.c.
+			 * Initially link all the buffers together as unused.
+			 * StrategyInitialize() splits this list into the freelist
+			 * partitions, and subsequent management of the lists is done by
+			 * freelist.c.
 			 */
 			buf->freeNext = i + 1;
 
@@ -165,14 +187,46 @@ BufferShmemSize(void)
 {
 	Size		size = 0;
 
+	SetNumBufferPartitions();
+
 	/* size of buffer descriptors */
 	size = add_size(size, mul_size(NBuffers, sizeof(BufferDesc)));
 
-	/* size of data pages */
+	/* size of data pages, plus alignment padding */
 	size = add_size(size, mul_size(NBuffers, BLCKSZ));
+	size = add_size(size, PG_IO_ALIGN_SIZE);
+
+	/* size of checkpoint sort array in bufmgr.c */
+	size = add_size(size, mul_size(NBuffers, sizeof(CkptSortItem)));
 
 	/* size of stuff controlled by freelist.c */
 	size = add_size(size, StrategyShmemSize());
 
 	return size;
 }
+
+/*
+ * SetNumBufferPartitions
+ *
+ * Choose the number of buffer mapping partitions.  More partitions mean
+ * less contention on the mapping locks when many backends look up buffers
+ * concurrently, so we scale the number with the number of backends that
+ * could be doing that; but there's no point in having many more partitions
+ * than there are buffers to spread across them, so we also require at
+ * least 256 buffers per partition beyond the historical minimum of 16.
+ *
+ * The result depends only on GUCs that can't change after startup, so every
+ * process computes the same value.
+ */
+static void
+SetNumBufferPartitions(void)
+{
+	int			nparts = 16;
+
+	while (nparts < MAX_BUFFER_PARTITIONS &&
+		   nparts < MaxBackends / 2 &&
+		   nparts * 256 < NBuffers)
+		nparts <<= 1;
+
+	NumBufferPartitions = nparts;
+}
@@ -5,7 +5,7 @@
  *
  * Note: the routines in this file do no locking of their own.	The caller
  * must hold a suitable lock on the appropriate BufMappingLock, as specified
- * in the comments.  We can't do the locking inside these functions because
+ * in the comments, except for BufTableLookupOptimistic.  We can't do the locking inside these functions because
  * in most cases the caller needs to adjust the buffer header contents
  * before the lock is released (see notes in README).
  *
@@ -60,7 +60,7 @@ InitBufTable(int size)
 	info.keysize = sizeof(BufferTag);
 	info.entrysize = sizeof(BufferLookupEnt);
 	info.hash = tag_hash;
-	info.num_partitions = NUM_BUFFER_PARTITIONS;
+	info.num_partitions = NumBufferPartitions;
 
 	SharedBufHash = ShmemInitHash("Shared Buffer Lookup Table",
 								  size, size,
@@ -107,6 +107,46 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	return result->id;
 }
 
+/*
+ * BufTableLookupOptimistic
+ *		Like BufTableLookup, but without holding the partition lock
+ *
+ * The result is only a hint: the entry we find may be concurrently deleted
+ * or reused for a different tag, so the caller must pin the buffer and then
+ * check that its tag still matches before trusting it.  Returns -1 if
+ * nothing plausible was found, in which case the caller should retry with
+ * the lock held.
+ *
+ * This is safe because the buffer lookup table is partitioned, and so is
+ * never expanded: its directory and buckets stay where they are.  Entries
+ * are only relinked with single pointer stores, and freed entries keep
+ * pointing at other entries, so a concurrent walk always ends at the end
+ * of some chain.
+ */
+int
+BufTableLookupOptimistic(BufferTag *tagPtr, uint32 hashcode)
+{
+	BufferLookupEnt *result;
+	int			buf_id;
+
+	result = (BufferLookupEnt *)
+		hash_search_with_hash_value(SharedBufHash,
+									(void *) tagPtr,
+									hashcode,
+									HASH_FIND,
+									NULL);
+
+	if (!result)
+		return -1;
+
+	/* the entry might be in the middle of being filled in */
+	buf_id = *((volatile int *) &result->id);
+	if (buf_id < 0 || buf_id >= NBuffers)
+		return -1;
+
+	return buf_id;
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
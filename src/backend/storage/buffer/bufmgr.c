@@ -41,6 +41,7 @@
 #include "postmaster/bgwriter.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
@@ -58,6 +59,19 @@
 #define LocalBufHdrGetBlock(bufHdr) \
 	LocalBufferBlockPointers[-((bufHdr)->buf_id + 2)]
 
+/*
+ * When dropping the buffers of relations totalling fewer blocks than this,
+ * look each block up in the buffer mapping table instead of scanning the
+ * whole buffer pool.
+ */
+#define BUF_DROP_FULL_SCAN_THRESHOLD	((BlockNumber) (NBuffers / 32))
+
+/*
+ * When dropping the buffers of more relations than this in one scan, sort
+ * them and use binary search to check each buffer.
+ */
+#define DROP_RELS_BSEARCH_THRESHOLD		20
+
 /* Bits in SyncOneBuffer's return value */
 #define BUF_WRITTEN				0x01
 #define BUF_REUSABLE			0x02
@@ -67,6 +81,8 @@
 bool		zero_damaged_pages = false;
 int			bgwriter_lru_maxpages = 100;
 double		bgwriter_lru_multiplier = 2.0;
+bool		track_io_timing = false;
+bool		defer_hint_bit_writes = true;
 
 /*
  * How many buffers PrefetchBuffer callers should try to stay ahead of their
@@ -75,9 +91,19 @@ double		bgwriter_lru_multiplier = 2.0;
  */
 int			target_prefetch_pages = 0;
 
-/* local state for StartBufferIO and related functions */
-static volatile BufferDesc *InProgressBuf = NULL;
-static bool IsForInput;
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * Normally a backend has at most one buffer I/O in progress, but
+ * ReadBufferAhead starts input on a run of buffers before reading them all
+ * with one smgrreadv call; allocating a victim for the next buffer of the
+ * run may then need one more for writing out a dirty page.
+ */
+#define MAX_IN_PROGRESS_IO	(MAX_BUFFER_READAHEAD + 1)
+
+static volatile BufferDesc *InProgressBufs[MAX_IN_PROGRESS_IO];
+static bool InProgressForInput[MAX_IN_PROGRESS_IO];
+static int	NumInProgressBufs = 0;
 
 /* local state for LockBufferForCleanup */
 static volatile BufferDesc *PinCountWaitBuf = NULL;
@@ -106,6 +132,14 @@ static volatile BufferDesc *BufferAlloc(SMgrRelation smgr,
 			bool *foundPtr);
 static void FlushBuffer(volatile BufferDesc *buf, SMgrRelation reln);
 static void AtProcExit_Buffers(int code, Datum arg);
+static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
+							  ForkNumber forkNum, BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock);
+static int	rnode_comparator(const void *p1, const void *p2);
+#ifdef USE_PREFETCH
+static void PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum);
+#endif
 
 
 /*
@@ -138,44 +172,312 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 		LocalPrefetchBuffer(reln->rd_smgr, forkNum, blockNum);
 	}
 	else
+		PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
+#endif   /* USE_PREFETCH */
+}
+
+/*
+ * PrefetchBufferWithoutRelcache -- like PrefetchBuffer, but doesn't require
+ *		a relcache entry for the relation.
+ *
+ * As with ReadBufferWithoutRelcache, this may only be used on permanent
+ * relations; it's meant for XLOG replay.
+ */
+void
+PrefetchBufferWithoutRelcache(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	SMgrRelation smgr = smgropen(rnode, InvalidBackendId);
+
+	PrefetchSharedBuffer(smgr, forkNum, blockNum);
+#endif   /* USE_PREFETCH */
+}
+
+#ifdef USE_PREFETCH
+/*
+ * PrefetchSharedBuffer -- guts of PrefetchBuffer for relations that use
+ *		shared buffers
+ */
+static void
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	LWLockId	newPartitionLock;		/* buffer partition lock for it */
+	int			buf_id;
+
+	Assert(BlockNumberIsValid(blockNum));
+
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node,
+				   forkNum, blockNum);
+
+	/* determine its hash code and partition lock ID */
+	newHash = BufTableHashCode(&newTag);
+	newPartitionLock = BufMappingPartitionLock(newHash);
+
+	/* see if the block is in the buffer pool already */
+	LWLockAcquire(newPartitionLock, LW_SHARED);
+	buf_id = BufTableLookup(&newTag, newHash);
+	LWLockRelease(newPartitionLock);
+
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really ideal:
+	 * the block might be just about to be evicted, which would be stupid
+	 * since we know we are going to need it soon.  But the only easy answer
+	 * is to bump the usage_count, which does not seem like a great solution:
+	 * when the caller does ultimately touch the block, usage_count would get
+	 * bumped again, resulting in too much favoritism for blocks that are
+	 * involved in a prefetch sequence. A real fix would involve some
+	 * additional per-buffer state, and it's not clear that there's enough of
+	 * a problem to justify that.
+	 */
+}
+#endif   /* USE_PREFETCH */
+
+/*
+ * ReadStreamCreate -- set up read-ahead for a scan
+ *
+ * size is the maximum number of upcoming blocks the caller will queue at a
+ * time.  Of those, up to distance are kept prefetched ahead of the block the
+ * scan is currently reading; callers normally pass target_prefetch_pages.
+ * The stream is allocated in the current memory context.
+ */
+ReadStream *
+ReadStreamCreate(Relation reln, ForkNumber forkNum, int size, int distance)
+{
+	ReadStream *stream;
+
+	Assert(size > 0 && distance > 0);
+
+	stream = (ReadStream *) palloc(offsetof(ReadStream, queue) +
+								   size * sizeof(BlockNumber));
+	stream->rel = reln;
+	stream->forkNum = forkNum;
+	stream->distance = Min(distance, size);
+	stream->size = size;
+	stream->strategy = NULL;
+	ReadStreamReset(stream);
+
+	return stream;
+}
+
+/*
+ * Read ahead the first "limit" queued blocks into shared buffers, for use
+ * when direct I/O leaves nothing for PrefetchBuffer's hints to act on.
+ * Runs of consecutive blocks are read with one call each; a lone block
+ * gains nothing from being read early with synchronous I/O, so it is left
+ * for the scan to read itself.
+ */
+static void
+ReadStreamReadAhead(ReadStream *stream, int limit)
+{
+	int			i = 0;
+
+	while (i < limit)
 	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLockId	newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
+		BlockNumber first = stream->queue[(stream->head + i) % stream->size];
+		int			n = 1;
 
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
+		while (i + n < limit && n < MAX_BUFFER_READAHEAD &&
+			   stream->queue[(stream->head + i + n) % stream->size] == first + n)
+			n++;
 
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
+		if (n > 1)
+			ReadBufferAhead(stream->rel, stream->forkNum, first, n,
+							stream->strategy);
+		i += n;
+	}
 
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
+	stream->nprefetched = limit;
+}
 
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
+/*
+ * Prefetch queued blocks until "distance" of them are in flight.
+ */
+static void
+ReadStreamIssue(ReadStream *stream)
+{
+	int			limit = Min(stream->nqueued, stream->distance);
 
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
+	/*
+	 * With direct I/O, wait until the previous batch has been consumed and a
+	 * full window is queued, then read the window ahead in one go; doing it
+	 * a block at a time would leave nothing to coalesce.
+	 */
+	if (direct_io & DIRECT_IO_DATA)
+	{
+		if (stream->nprefetched == 0 && limit == stream->distance)
+			ReadStreamReadAhead(stream, limit);
+		return;
 	}
-#endif   /* USE_PREFETCH */
+
+	while (stream->nprefetched < limit)
+	{
+		int			pos = (stream->head + stream->nprefetched) % stream->size;
+
+		PrefetchBuffer(stream->rel, stream->forkNum, stream->queue[pos]);
+		stream->nprefetched++;
+	}
+}
+
+/*
+ * ReadStreamQueue -- add a block to the end of a read stream's queue
+ *
+ * Returns false, without queuing anything, if the queue is full; the caller
+ * should try again after the scan has moved on.  A block equal to the last
+ * one queued is absorbed, since the scan will read it only once.
+ */
+bool
+ReadStreamQueue(ReadStream *stream, BlockNumber blockNum)
+{
+	if (stream->nqueued > 0)
+	{
+		int			last = (stream->head + stream->nqueued - 1) % stream->size;
+
+		if (stream->queue[last] == blockNum)
+			return true;
+	}
+
+	if (stream->nqueued >= stream->size)
+		return false;
+
+	stream->queue[(stream->head + stream->nqueued) % stream->size] = blockNum;
+	stream->nqueued++;
+
+	ReadStreamIssue(stream);
+
+	return true;
+}
+
+/*
+ * ReadStreamConsume -- report that the scan is about to read a block
+ *
+ * If it's the block at the head of the queue, it is removed from the queue
+ * and the next queued block gets prefetched in its place.  Reads of blocks
+ * the stream wasn't told about, or repeated reads, are simply ignored.
+ */
+void
+ReadStreamConsume(ReadStream *stream, BlockNumber blockNum)
+{
+	if (stream->nqueued == 0 || stream->queue[stream->head] != blockNum)
+		return;
+
+	stream->head = (stream->head + 1) % stream->size;
+	stream->nqueued--;
+	if (stream->nprefetched > 0)
+		stream->nprefetched--;
+
+	ReadStreamIssue(stream);
 }
 
+/*
+ * ReadStreamReset -- forget all queued blocks
+ */
+void
+ReadStreamReset(ReadStream *stream)
+{
+	stream->head = 0;
+	stream->nqueued = 0;
+	stream->nprefetched = 0;
+}
+
+/*
+ * ReadStreamFree -- release a read stream
+ */
+void
+ReadStreamFree(ReadStream *stream)
+{
+	pfree(stream);
+}
+
+
+/*
+ * ReadBufferAhead -- read a run of blocks into shared buffers
+ *
+ * Those of blocks blockNum .. blockNum + nblocks - 1 that are not in shared
+ * buffers already are read in, each run of consecutive missing blocks with
+ * a single smgrreadv, and left unpinned for the caller to ReadBuffer soon.
+ * This is userspace read-ahead for direct I/O, where the kernel does none.
+ * nblocks is capped at MAX_BUFFER_READAHEAD; all the blocks must exist.
+ *
+ * Pages with invalid headers are left invalid rather than reported here, so
+ * the subsequent ReadBuffer retries them and complains in the usual way.
+ * Relations using local buffers are not read ahead.
+ */
+void
+ReadBufferAhead(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+				int nblocks, BufferAccessStrategy strategy)
+{
+	volatile BufferDesc *run[MAX_BUFFER_READAHEAD];
+	char	   *pages[MAX_BUFFER_READAHEAD];
+	BlockNumber runstart = InvalidBlockNumber;
+	int			nrun = 0;
+	int			i;
+
+	if (RelationUsesLocalBuffers(reln))
+		return;
+
+	RelationOpenSmgr(reln);
+
+	nblocks = Min(nblocks, MAX_BUFFER_READAHEAD);
+
+	/*
+	 * Allocate buffers in ascending block order.  Each missing block's
+	 * buffer comes back from BufferAlloc pinned with input I/O started; a
+	 * block that's already present ends the current run.  Since everyone
+	 * starts I/O in ascending order here, waiting in BufferAlloc for another
+	 * backend's I/O on a later block cannot deadlock.
+	 */
+	for (i = 0; i <= nblocks; i++)
+	{
+		volatile BufferDesc *bufHdr = NULL;
+		bool		found = true;
+		int			j;
+
+		if (i < nblocks)
+		{
+			ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+			bufHdr = BufferAlloc(reln->rd_smgr, reln->rd_rel->relpersistence,
+								 forkNum, blockNum + i, strategy, &found);
+			if (!found)
+			{
+				if (nrun == 0)
+					runstart = blockNum + i;
+				run[nrun++] = bufHdr;
+				continue;
+			}
+		}
+
+		/* Block present, or end of range: read in the pending run */
+		if (nrun > 0)
+		{
+			for (j = 0; j < nrun; j++)
+				pages[j] = (char *) BufHdrGetBlock(run[j]);
+
+			smgrreadv(reln->rd_smgr, forkNum, runstart, pages, nrun);
+			pgBufferUsage.shared_blks_read += nrun;
+
+			for (j = 0; j < nrun; j++)
+			{
+				bool		valid = PageHeaderIsValid((PageHeader) pages[j]);
+
+				TerminateBufferIO(run[j], false, valid ? BM_VALID : 0);
+				UnpinBuffer(run[j], true);
+			}
+			nrun = 0;
+		}
+
+		if (bufHdr != NULL)
+			ReleaseBuffer(BufferDescriptorGetBuffer(bufHdr));
+	}
+}
 
 /*
  * ReadBuffer -- a shorthand for ReadBufferExtended, for reading from main
@@ -437,8 +739,22 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			MemSet((char *) bufBlock, 0, BLCKSZ);
 		else
 		{
+			instr_time	io_start,
+						io_time;
+
+			if (track_io_timing)
+				INSTR_TIME_SET_CURRENT(io_start);
+
 			smgrread(smgr, forkNum, blockNum, (char *) bufBlock);
 
+			if (track_io_timing)
+			{
+				INSTR_TIME_SET_CURRENT(io_time);
+				INSTR_TIME_SUBTRACT(io_time, io_start);
+				pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+				INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+			}
+
 			/* check for garbage data */
 			if (!PageHeaderIsValid((PageHeader) bufBlock))
 			{
@@ -530,23 +846,54 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
+	/*
+	 * See if the block is in the buffer pool already.  First try without
+	 * the mapping lock: if the lookup finds a buffer, pin it and check that
+	 * it still holds our page.  Once the buffer is pinned, its tag can't
+	 * change under us, so if it matches we have the same guarantees as if
+	 * we had pinned it while holding the mapping lock.  This keeps lookups
+	 * of hot pages from bouncing the partition lock's cache line between
+	 * CPUs.  If the optimistic lookup fails, retry the normal way.
+	 */
+	buf = NULL;
+	buf_id = BufTableLookupOptimistic(&newTag, newHash);
 	if (buf_id >= 0)
 	{
-		/*
-		 * Found it.  Now, pin the buffer so no one can steal it from the
-		 * buffer pool, and check to see if the correct data has been loaded
-		 * into the buffer.
-		 */
 		buf = &BufferDescriptors[buf_id];
 
 		valid = PinBuffer(buf, strategy);
 
+		if (!(BUFFERTAGS_EQUAL(buf->tag, newTag) &&
+			  (buf->flags & BM_TAG_VALID)))
+		{
+			/* lost a race with someone recycling the buffer */
+			UnpinBuffer(buf, true);
+			buf = NULL;
+		}
+	}
+
+	if (buf == NULL)
+	{
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		if (buf_id >= 0)
+		{
+			/*
+			 * Found it.  Now, pin the buffer so no one can steal it from the
+			 * buffer pool, and check to see if the correct data has been
+			 * loaded into the buffer.
+			 */
+			buf = &BufferDescriptors[buf_id];
+
+			valid = PinBuffer(buf, strategy);
+		}
+
 		/* Can release the mapping lock as soon as we've pinned it */
 		LWLockRelease(newPartitionLock);
+	}
 
+	if (buf != NULL)
+	{
 		*foundPtr = TRUE;
 
 		if (!valid)
@@ -573,22 +920,17 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	/*
 	 * Didn't find it in the buffer pool.  We'll have to initialize a new
-	 * buffer.	Remember to unlock the mapping lock while doing the work.
+	 * buffer.
 	 */
-	LWLockRelease(newPartitionLock);
 
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
 	{
-		bool		lock_held;
-
 		/*
 		 * Select a victim buffer.	The buffer is returned with its header
-		 * spinlock still held!  Also (in most cases) the BufFreelistLock is
-		 * still held, since it would be bad to hold the spinlock while
-		 * possibly waking up other processes.
+		 * spinlock still held!
 		 */
-		buf = StrategyGetBuffer(strategy, &lock_held);
+		buf = StrategyGetBuffer(strategy);
 
 		Assert(buf->refcount == 0);
 
@@ -598,10 +940,6 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		/* Pin the buffer and then release the buffer spinlock */
 		PinBuffer_Locked(buf);
 
-		/* Now it's safe to release the freelist lock */
-		if (lock_held)
-			LWLockRelease(BufFreelistLock);
-
 		/*
 		 * If the buffer was dirty, try to write it out.  There is a race
 		 * condition here, in that someone might dirty it after we released it
@@ -609,7 +947,24 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * won't prevent hint-bit updates).  We will recheck the dirty bit
 		 * after re-locking the buffer header.
 		 */
-		if (oldFlags & BM_DIRTY)
+		if ((oldFlags & (BM_DIRTY | BM_HINT_ONLY)) == (BM_DIRTY | BM_HINT_ONLY))
+		{
+			/*
+			 * The only changes are hint bits, which can be set again by the
+			 * next reader, so don't make this backend pay for a write; see
+			 * SetBufferCommitInfoNeedsSave.  We hold a pin, so nobody can be
+			 * in the middle of a real change without our noticing below
+			 * that the buffer is pinned twice or dirty again.
+			 */
+			LockBufHdr(buf);
+			if (buf->flags & BM_HINT_ONLY)
+			{
+				buf->flags &= ~(BM_DIRTY | BM_JUST_DIRTIED |
+								BM_CHECKPOINT_NEEDED | BM_HINT_ONLY);
+			}
+			UnlockBufHdr(buf);
+		}
+		else if (oldFlags & BM_DIRTY)
 		{
 			/*
 			 * We need a share-lock on the buffer contents to write it out
@@ -804,7 +1159,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 * 1 so that the buffer can survive one clock-sweep pass.)
 	 */
 	buf->tag = newTag;
-	buf->flags &= ~(BM_VALID | BM_DIRTY | BM_JUST_DIRTIED | BM_CHECKPOINT_NEEDED | BM_IO_ERROR | BM_PERMANENT);
+	buf->flags &= ~(BM_VALID | BM_DIRTY | BM_JUST_DIRTIED | BM_CHECKPOINT_NEEDED | BM_IO_ERROR | BM_PERMANENT | BM_HINT_ONLY);
 	if (relpersistence == RELPERSISTENCE_PERMANENT)
 		buf->flags |= BM_TAG_VALID | BM_PERMANENT;
 	else
@@ -984,6 +1339,7 @@ MarkBufferDirty(Buffer buffer)
 	}
 
 	bufHdr->flags |= (BM_DIRTY | BM_JUST_DIRTIED);
+	bufHdr->flags &= ~BM_HINT_ONLY;
 
 	UnlockBufHdr(bufHdr);
 }
@@ -1165,6 +1521,40 @@ UnpinBuffer(volatile BufferDesc *buf, bool fixOwner)
 	}
 }
 
+/*
+ * Per-tablespace state used by BufferSync to balance writes
+ */
+typedef struct CkptTsStatus
+{
+	Oid			tsId;
+	int			index;			/* next item of CkptBufferIds to process */
+	int			num_to_scan;	/* number of items in this tablespace */
+	int			num_scanned;	/* number of those processed so far */
+	double		progress;		/* how far along we are, scaled ... */
+	double		progress_slice; /* ... so that one item costs this much */
+} CkptTsStatus;
+
+/*
+ * qsort comparator for CkptSortItems: order by tablespace, relation, fork
+ * and block
+ */
+static int
+ckpt_buforder_comparator(const void *pa, const void *pb)
+{
+	const CkptSortItem *a = (const CkptSortItem *) pa;
+	const CkptSortItem *b = (const CkptSortItem *) pb;
+
+	if (a->tsId != b->tsId)
+		return (a->tsId < b->tsId) ? -1 : 1;
+	if (a->relNode != b->relNode)
+		return (a->relNode < b->relNode) ? -1 : 1;
+	if (a->forkNum != b->forkNum)
+		return (a->forkNum < b->forkNum) ? -1 : 1;
+	if (a->blockNum != b->blockNum)
+		return (a->blockNum < b->blockNum) ? -1 : 1;
+	return 0;
+}
+
 /*
  * BufferSync -- Write out all dirty buffers in the pool.
  *
@@ -1173,14 +1563,25 @@ UnpinBuffer(volatile BufferDesc *buf, bool fixOwner)
  * is set, we disable delays between writes; if CHECKPOINT_IS_SHUTDOWN is
  * set, we write even unlogged buffers, which are otherwise skipped.  The
  * remaining flags currently have no effect here.
+ *
+ * The buffers are written in file and block order rather than in the order
+ * they happen to appear in the buffer pool, so that the kernel sees mostly
+ * sequential writes it can merge, and has less scattered dirty data to
+ * flush when the checkpoint fsyncs the files.  Writes to different
+ * tablespaces are interleaved in proportion to the number of buffers each
+ * has to write, so that no tablespace sits idle while another does all the
+ * work.
  */
 static void
 BufferSync(int flags)
 {
 	int			buf_id;
-	int			num_to_scan;
 	int			num_to_write;
+	int			num_processed;
 	int			num_written;
+	int			num_spaces;
+	int			i;
+	CkptTsStatus *per_ts_stat;
 	int			mask = BM_DIRTY;
 
 	/* Make sure we can handle the pin inside SyncOneBuffer */
@@ -1196,7 +1597,8 @@ BufferSync(int flags)
 	/*
 	 * Loop over all buffers, and mark the ones that need to be written with
 	 * BM_CHECKPOINT_NEEDED.  Count them as we go (num_to_write), so that we
-	 * can estimate how much work needs to be done.
+	 * can estimate how much work needs to be done, and remember their
+	 * identity in CkptBufferIds so that we can sort them.
 	 *
 	 * This allows us to write only those pages that were dirty when the
 	 * checkpoint began, and not those that get dirtied while it proceeds.
@@ -1222,8 +1624,15 @@ BufferSync(int flags)
 
 		if ((bufHdr->flags & mask) == mask)
 		{
+			CkptSortItem *item = &CkptBufferIds[num_to_write++];
+
 			bufHdr->flags |= BM_CHECKPOINT_NEEDED;
-			num_to_write++;
+
+			item->buf_id = buf_id;
+			item->tsId = bufHdr->tag.rnode.spcNode;
+			item->relNode = bufHdr->tag.rnode.relNode;
+			item->forkNum = bufHdr->tag.forkNum;
+			item->blockNum = bufHdr->tag.blockNum;
 		}
 
 		UnlockBufHdr(bufHdr);
@@ -1235,19 +1644,74 @@ BufferSync(int flags)
 	TRACE_POSTGRESQL_BUFFER_SYNC_START(NBuffers, num_to_write);
 
 	/*
-	 * Loop over all buffers again, and write the ones (still) marked with
-	 * BM_CHECKPOINT_NEEDED.  In this loop, we start at the clock sweep point
-	 * since we might as well dump soon-to-be-recycled buffers first.
+	 * Sort the buffers to be written.  We do this outside of any lock; the
+	 * buffers might be written or even replaced meanwhile, which is harmless
+	 * as explained below.
+	 */
+	qsort(CkptBufferIds, num_to_write, sizeof(CkptSortItem),
+		  ckpt_buforder_comparator);
+
+	/*
+	 * Set up the per-tablespace state.  Each tablespace's buffers form a
+	 * contiguous run of the sorted array.  There are rarely more than a
+	 * handful of tablespaces, so a simple array is good enough.
+	 */
+	num_spaces = 0;
+	for (i = 0; i < num_to_write; i++)
+	{
+		if (i == 0 || CkptBufferIds[i].tsId != CkptBufferIds[i - 1].tsId)
+			num_spaces++;
+	}
+
+	per_ts_stat = (CkptTsStatus *) palloc(num_spaces * sizeof(CkptTsStatus));
+	num_spaces = 0;
+	for (i = 0; i < num_to_write; i++)
+	{
+		if (i == 0 || CkptBufferIds[i].tsId != CkptBufferIds[i - 1].tsId)
+		{
+			CkptTsStatus *ts_stat = &per_ts_stat[num_spaces++];
+
+			ts_stat->tsId = CkptBufferIds[i].tsId;
+			ts_stat->index = i;
+			ts_stat->num_to_scan = 0;
+			ts_stat->num_scanned = 0;
+			ts_stat->progress = 0;
+		}
+		per_ts_stat[num_spaces - 1].num_to_scan++;
+	}
+
+	/*
+	 * Processing one buffer of a tablespace advances that tablespace's
+	 * progress by num_to_write / num_to_scan, so that all tablespaces reach
+	 * num_to_write at the same time.
+	 */
+	for (i = 0; i < num_spaces; i++)
+		per_ts_stat[i].progress_slice =
+			(double) num_to_write / (double) per_ts_stat[i].num_to_scan;
+
+	/*
+	 * Write the buffers that are (still) marked with BM_CHECKPOINT_NEEDED,
+	 * each time taking the next one from the tablespace that is furthest
+	 * behind.
 	 *
 	 * Note that we don't read the buffer alloc count here --- that should be
 	 * left untouched till the next BgBufferSync() call.
 	 */
-	buf_id = StrategySyncStart(NULL, NULL);
-	num_to_scan = NBuffers;
+	num_processed = 0;
 	num_written = 0;
-	while (num_to_scan-- > 0)
+	while (num_spaces > 0)
 	{
-		volatile BufferDesc *bufHdr = &BufferDescriptors[buf_id];
+		CkptTsStatus *ts_stat = &per_ts_stat[0];
+		volatile BufferDesc *bufHdr;
+
+		for (i = 1; i < num_spaces; i++)
+		{
+			if (per_ts_stat[i].progress < ts_stat->progress)
+				ts_stat = &per_ts_stat[i];
+		}
+
+		buf_id = CkptBufferIds[ts_stat->index].buf_id;
+		bufHdr = &BufferDescriptors[buf_id];
 
 		/*
 		 * We don't need to acquire the lock here, because we're only looking
@@ -1268,32 +1732,32 @@ BufferSync(int flags)
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				BgWriterStats.m_buf_written_checkpoints++;
 				num_written++;
-
-				/*
-				 * We know there are at most num_to_write buffers with
-				 * BM_CHECKPOINT_NEEDED set; so we can stop scanning if
-				 * num_written reaches num_to_write.
-				 *
-				 * Note that num_written doesn't include buffers written by
-				 * other backends, or by the bgwriter cleaning scan. That
-				 * means that the estimate of how much progress we've made is
-				 * conservative, and also that this test will often fail to
-				 * trigger.  But it seems worth making anyway.
-				 */
-				if (num_written >= num_to_write)
-					break;
-
-				/*
-				 * Sleep to throttle our I/O rate.
-				 */
-				CheckpointWriteDelay(flags, (double) num_written / num_to_write);
 			}
 		}
 
-		if (++buf_id >= NBuffers)
-			buf_id = 0;
+		/*
+		 * Measure progress independently of whether we wrote the buffer
+		 * ourselves; buffers written by other backends or the bgwriter
+		 * cleaning scan count as done too.
+		 */
+		num_processed++;
+
+		ts_stat->progress += ts_stat->progress_slice;
+		ts_stat->num_scanned++;
+		ts_stat->index++;
+
+		/* Remove the tablespace once all of its buffers are processed */
+		if (ts_stat->num_scanned == ts_stat->num_to_scan)
+			*ts_stat = per_ts_stat[--num_spaces];
+
+		/*
+		 * Sleep to throttle our I/O rate.
+		 */
+		CheckpointWriteDelay(flags, (double) num_processed / num_to_write);
 	}
 
+	pfree(per_ts_stat);
+
 	/*
 	 * Update checkpoint statistics. As noted above, this doesn't include
 	 * buffers written by other backends or bgwriter scan.
@@ -1306,9 +1770,20 @@ BufferSync(int flags)
 /*
  * BgBufferSync -- Write out some dirty buffers in the pool.
  *
- * This is called periodically by the background writer process.
+ * This is called periodically by the background writer process.  Besides
+ * writing dirty buffers ahead of the clock sweep, it puts the reusable
+ * buffers it finds there on the freelist, so that backends can take them
+ * without running the clock sweep themselves.  If it did so, it also asks
+ * to be woken when the freelists next run dry, so that it can refill them
+ * before its regular delay is up.
+ *
+ * Returns true if it's appropriate for the bgwriter process to go into
+ * low-power hibernation mode.  (This happens if the strategy clock sweep
+ * has been "lapped" and no buffer allocations have occurred recently, or if
+ * the bgwriter has been effectively disabled by setting
+ * bgwriter_lru_maxpages to 0.)
  */
-void
+bool
 BgBufferSync(void)
 {
 	/* info obtained from freelist.c */
@@ -1346,8 +1821,12 @@ BgBufferSync(void)
 	/* Variables for the scanning loop proper */
 	int			num_to_scan;
 	int			num_written;
+	int			num_freelisted;
 	int			reusable_buffers;
 
+	/* Variables for final decisions */
+	bool		sweep_idle;
+
 	/*
 	 * Find out where the freelist clock sweep currently is, and how many
 	 * buffer allocations have happened since our last call.
@@ -1365,7 +1844,7 @@ BgBufferSync(void)
 	if (bgwriter_lru_maxpages <= 0)
 	{
 		saved_info_valid = false;
-		return;
+		return true;
 	}
 
 	/*
@@ -1441,6 +1920,9 @@ BgBufferSync(void)
 		bufs_to_lap = NBuffers;
 	}
 
+	/* Note whether anyone has needed a buffer since last time */
+	sweep_idle = (strategy_delta == 0 && recent_alloc == 0);
+
 	/* Update saved info for next time */
 	prev_strategy_buf_id = strategy_buf_id;
 	prev_strategy_passes = strategy_passes;
@@ -1525,12 +2007,14 @@ BgBufferSync(void)
 
 	num_to_scan = bufs_to_lap;
 	num_written = 0;
+	num_freelisted = 0;
 	reusable_buffers = reusable_buffers_est;
 
 	/* Execute the LRU scan */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			buffer_state = SyncOneBuffer(next_to_clean, true);
+		int			buf_id = next_to_clean;
+		int			buffer_state = SyncOneBuffer(buf_id, true);
 
 		if (++next_to_clean >= NBuffers)
 		{
@@ -1539,6 +2023,17 @@ BgBufferSync(void)
 		}
 		num_to_scan--;
 
+		/*
+		 * A reusable buffer (which includes any we just wrote) goes on the
+		 * freelist.  It keeps its contents, so if someone uses it before it
+		 * is handed out, StrategyGetBuffer will just discard it.
+		 */
+		if (buffer_state & BUF_REUSABLE)
+		{
+			StrategyFreeBuffer(&BufferDescriptors[buf_id]);
+			num_freelisted++;
+		}
+
 		if (buffer_state & BUF_WRITTEN)
 		{
 			reusable_buffers++;
@@ -1584,6 +2079,20 @@ BgBufferSync(void)
 			 recent_alloc, strategy_delta, scans_per_alloc, smoothed_density);
 #endif
 	}
+
+	/*
+	 * If we fed the freelists, or have nothing to do at all, ask to be woken
+	 * when the freelists run dry.  In the first case that lets us refill
+	 * them promptly under a burst of allocations; in the second, it lets us
+	 * hibernate without falling behind when allocations resume.  If we
+	 * found nothing to put on the freelists, waking early would be useless:
+	 * everything ahead of the clock sweep is in use.
+	 */
+	if (num_freelisted > 0 || (sweep_idle && num_to_scan == 0))
+		StrategyNotifyBgWriter(&MyProc->procLatch);
+
+	/* Return true if OK to hibernate */
+	return (sweep_idle && num_to_scan == 0);
 }
 
 /*
@@ -1860,6 +2369,8 @@ FlushBuffer(volatile BufferDesc *buf, SMgrRelation reln)
 {
 	XLogRecPtr	recptr;
 	ErrorContextCallback errcontext;
+	instr_time	io_start,
+				io_time;
 
 	/*
 	 * Acquire the buffer's io_in_progress lock.  If StartBufferIO returns
@@ -1907,12 +2418,23 @@ FlushBuffer(volatile BufferDesc *buf, SMgrRelation reln)
 	buf->flags &= ~BM_JUST_DIRTIED;
 	UnlockBufHdr(buf);
 
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
 	smgrwrite(reln,
 			  buf->tag.forkNum,
 			  buf->tag.blockNum,
 			  (char *) BufHdrGetBlock(buf),
 			  false);
 
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
 	pgBufferUsage.shared_blks_written++;
 
 	/*
@@ -1993,29 +2515,58 @@ BufferIsPermanent(Buffer buffer)
  *		that no other process could be trying to load more pages of the
  *		relation into buffers.
  *
- *		XXX currently it sequentially searches the buffer pool, should be
- *		changed to more clever ways of searching.  However, this routine
- *		is used only in code paths that aren't very performance-critical,
- *		and we shouldn't slow down the hot paths to make it faster ...
+ *		nForkBlock is the current size of the fork, or InvalidBlockNumber if
+ *		the caller doesn't know it.  If it is known and only a few blocks
+ *		are to be dropped, we look them up in the buffer mapping table;
+ *		otherwise we have to search the whole buffer pool.
  * --------------------------------------------------------------------
  */
 void
 DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
-					   BlockNumber firstDelBlock)
+					   BlockNumber nForkBlock, BlockNumber firstDelBlock)
 {
 	int			i;
 
 	if (rnode.backend != InvalidBackendId)
 	{
 		if (rnode.backend == MyBackendId)
-			DropRelFileNodeLocalBuffers(rnode.node, forkNum, firstDelBlock);
+			DropRelFileNodeLocalBuffers(rnode.node, forkNum, nForkBlock,
+										firstDelBlock);
 		return;
 	}
 
+	if (nForkBlock != InvalidBlockNumber)
+	{
+		if (nForkBlock <= firstDelBlock)
+			return;				/* nothing to drop */
+		if (nForkBlock - firstDelBlock < BUF_DROP_FULL_SCAN_THRESHOLD)
+		{
+			FindAndDropRelFileNodeBuffers(rnode.node, forkNum, nForkBlock,
+										  firstDelBlock);
+			return;
+		}
+	}
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		volatile BufferDesc *bufHdr = &BufferDescriptors[i];
 
+		/*
+		 * We can make this a tad faster by prechecking the buffer tag before
+		 * we attempt to lock the buffer; this saves a lot of lock
+		 * acquisitions in typical cases.  It should be safe because the
+		 * caller must have AccessExclusiveLock on the relation, or some other
+		 * reason to be certain that no one is loading new pages of the rel
+		 * into the buffer pool.  (Otherwise we might well miss such pages
+		 * entirely.)  Therefore, while the tag might be changing while we
+		 * look at it, it can't be changing *to* a value we care about, only
+		 * *away* from such a value.  So false negatives are impossible, and
+		 * false positives are safe because we'll recheck after getting the
+		 * buffer lock.
+		 */
+		if (!RelFileNodeEquals(bufHdr->tag.rnode, rnode.node))
+			continue;
+
 		LockBufHdr(bufHdr);
 		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode.node) &&
 			bufHdr->tag.forkNum == forkNum &&
@@ -2026,6 +2577,255 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
 	}
 }
 
+/* ---------------------------------------------------------------------
+ *		DropRelFileNodesAllBuffers
+ *
+ *		This function removes from the buffer pool all the pages of all
+ *		forks of the specified relations.  It's equivalent to calling
+ *		DropRelFileNodeBuffers once per fork per relation with
+ *		firstDelBlock = 0, but a commit that drops many relations needs only
+ *		a single pass over the buffer pool.
+ *
+ *		nblocks, if not NULL, holds the size of each fork of each relation,
+ *		MAX_FORKNUM + 1 entries per relation.  If the relations are small
+ *		enough in total, we look up their blocks in the buffer mapping table
+ *		instead of scanning the buffer pool at all.
+ * --------------------------------------------------------------------
+ */
+void
+DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, BlockNumber *nblocks,
+						   int nnodes)
+{
+	int			i,
+				n = 0;
+	RelFileNode *nodes;
+	BlockNumber *node_blocks = NULL;
+	bool		use_bsearch;
+
+	if (nnodes == 0)
+		return;
+
+	nodes = palloc(sizeof(RelFileNode) * nnodes);	/* non-local relations */
+	if (nblocks)
+		node_blocks = palloc(sizeof(BlockNumber) * nnodes * (MAX_FORKNUM + 1));
+
+	/* If it's a local relation, it's localbuf.c's problem. */
+	for (i = 0; i < nnodes; i++)
+	{
+		if (rnodes[i].backend != InvalidBackendId)
+		{
+			if (rnodes[i].backend == MyBackendId)
+			{
+				ForkNumber	fork;
+
+				for (fork = 0; fork <= MAX_FORKNUM; fork++)
+				{
+					BlockNumber nForkBlock = InvalidBlockNumber;
+
+					if (nblocks)
+						nForkBlock = nblocks[i * (MAX_FORKNUM + 1) + fork];
+					DropRelFileNodeLocalBuffers(rnodes[i].node, fork,
+												nForkBlock, 0);
+				}
+			}
+		}
+		else
+		{
+			if (nblocks)
+				memcpy(&node_blocks[n * (MAX_FORKNUM + 1)],
+					   &nblocks[i * (MAX_FORKNUM + 1)],
+					   sizeof(BlockNumber) * (MAX_FORKNUM + 1));
+			nodes[n++] = rnodes[i].node;
+		}
+	}
+
+	/*
+	 * If there are no non-local relations, then we're done. Release the
+	 * memory and return.
+	 */
+	if (n == 0)
+		goto done;
+
+	/*
+	 * If we know the sizes of the relations and they are small in total,
+	 * look up each of their blocks.
+	 */
+	if (node_blocks)
+	{
+		BlockNumber total = 0;
+
+		for (i = 0; i < n * (MAX_FORKNUM + 1); i++)
+		{
+			total += node_blocks[i];
+			if (total >= BUF_DROP_FULL_SCAN_THRESHOLD)
+				break;
+		}
+
+		if (total < BUF_DROP_FULL_SCAN_THRESHOLD)
+		{
+			for (i = 0; i < n; i++)
+			{
+				ForkNumber	fork;
+
+				for (fork = 0; fork <= MAX_FORKNUM; fork++)
+					FindAndDropRelFileNodeBuffers(nodes[i], fork,
+									node_blocks[i * (MAX_FORKNUM + 1) + fork],
+												  0);
+			}
+			goto done;
+		}
+	}
+
+	/*
+	 * For low number of relations to drop just use a simple walk through, to
+	 * save the bsearch overhead.  The threshold to use is rather a guess
+	 * than an exactly determined value, as it depends on many factors (CPU
+	 * and RAM speeds, amount of shared buffers etc.).
+	 */
+	use_bsearch = n > DROP_RELS_BSEARCH_THRESHOLD;
+
+	/* sort the list of rnodes if necessary */
+	if (use_bsearch)
+		qsort(nodes, n, sizeof(RelFileNode), rnode_comparator);
+
+	for (i = 0; i < NBuffers; i++)
+	{
+		RelFileNode *rnode = NULL;
+		volatile BufferDesc *bufHdr = &BufferDescriptors[i];
+
+		/*
+		 * As in DropRelFileNodeBuffers, an unlocked precheck should be safe
+		 * and saves some cycles.
+		 */
+		if (!use_bsearch)
+		{
+			int			j;
+
+			for (j = 0; j < n; j++)
+			{
+				if (RelFileNodeEquals(bufHdr->tag.rnode, nodes[j]))
+				{
+					rnode = &nodes[j];
+					break;
+				}
+			}
+		}
+		else
+		{
+			RelFileNode tag = bufHdr->tag.rnode;
+
+			rnode = bsearch((const void *) &tag,
+							nodes, n, sizeof(RelFileNode),
+							rnode_comparator);
+		}
+
+		/* buffer doesn't belong to any of the given relfilenodes; skip it */
+		if (rnode == NULL)
+			continue;
+
+		LockBufHdr(bufHdr);
+		if (RelFileNodeEquals(bufHdr->tag.rnode, (*rnode)))
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr);
+	}
+
+done:
+	pfree(nodes);
+	if (node_blocks)
+		pfree(node_blocks);
+}
+
+/* ---------------------------------------------------------------------
+ *		FindAndDropRelFileNodeBuffers
+ *
+ *		This function performs a lookup in the buffer mapping table and
+ *		removes from the buffer pool the pages of the specified relation
+ *		fork that have block numbers >= firstDelBlock and < nForkBlock.
+ *		It is the caller's job to make sure that no such page can be
+ *		outside that range. (One that is not yet valid may be: a failed
+ *		relation extension leaves behind an invalid buffer for a block
+ *		beyond the end of the file.  Such a buffer is harmless, since any
+ *		later use of the block will have to read it in, or initialize it,
+ *		anyway.)
+ * --------------------------------------------------------------------
+ */
+static void
+FindAndDropRelFileNodeBuffers(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber nForkBlock,
+							  BlockNumber firstDelBlock)
+{
+	BlockNumber curBlock;
+
+	for (curBlock = firstDelBlock; curBlock < nForkBlock; curBlock++)
+	{
+		BufferTag	bufTag;			/* identity of requested block */
+		uint32		bufHash;		/* hash value for tag */
+		LWLockId	bufPartitionLock;		/* buffer partition lock for it */
+		int			buf_id;
+		volatile BufferDesc *bufHdr;
+
+		/* create a tag so we can lookup the buffer */
+		INIT_BUFFERTAG(bufTag, rnode, forkNum, curBlock);
+
+		/* determine its hash code and partition lock ID */
+		bufHash = BufTableHashCode(&bufTag);
+		bufPartitionLock = BufMappingPartitionLock(bufHash);
+
+		/* Check that it is in the buffer pool. If not, do nothing. */
+		LWLockAcquire(bufPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&bufTag, bufHash);
+		LWLockRelease(bufPartitionLock);
+
+		if (buf_id < 0)
+			continue;
+
+		bufHdr = &BufferDescriptors[buf_id];
+
+		/*
+		 * We need to lock the buffer header and recheck if the buffer is
+		 * still associated with the same block because the buffer could be
+		 * evicted by some other backend loading blocks for a different
+		 * relation after we release lock on the BufMapping table.
+		 */
+		LockBufHdr(bufHdr);
+
+		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+			bufHdr->tag.forkNum == forkNum &&
+			bufHdr->tag.blockNum >= firstDelBlock)
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr);
+	}
+}
+
+/*
+ * RelFileNode qsort/bsearch comparator; see RelFileNodeEquals.
+ */
+static int
+rnode_comparator(const void *p1, const void *p2)
+{
+	RelFileNode n1 = *(RelFileNode *) p1;
+	RelFileNode n2 = *(RelFileNode *) p2;
+
+	if (n1.relNode < n2.relNode)
+		return -1;
+	else if (n1.relNode > n2.relNode)
+		return 1;
+
+	if (n1.dbNode < n2.dbNode)
+		return -1;
+	else if (n1.dbNode > n2.dbNode)
+		return 1;
+
+	if (n1.spcNode < n2.spcNode)
+		return -1;
+	else if (n1.spcNode > n2.spcNode)
+		return 1;
+	else
+		return 0;
+}
+
 /* ---------------------------------------------------------------------
  *		DropDatabaseBuffers
  *
@@ -2051,6 +2851,14 @@ DropDatabaseBuffers(Oid dbid)
 	for (i = 0; i < NBuffers; i++)
 	{
 		bufHdr = &BufferDescriptors[i];
+
+		/*
+		 * As in DropRelFileNodeBuffers, an unlocked precheck should be safe
+		 * and saves some cycles.
+		 */
+		if (bufHdr->tag.rnode.dbNode != dbid)
+			continue;
+
 		LockBufHdr(bufHdr);
 		if (bufHdr->tag.rnode.dbNode == dbid)
 			InvalidateBuffer(bufHdr);	/* releases spinlock */
@@ -2308,6 +3116,15 @@ IncrBufferRefCount(Buffer buffer)
  * update could be redone by someone else just as easily.  Therefore, no WAL
  * log record need be generated, whereas calls to MarkBufferDirty really ought
  * to be associated with a WAL-entry-creating action.
+ *
+ * For the same reason, if defer_hint_bit_writes is on and the buffer wasn't
+ * already dirty, we mark it BM_HINT_ONLY: checkpoints and the background
+ * writer still write it out, but a backend that wants to evict it just
+ * forgets the hints instead of writing the page.  Otherwise the first scan
+ * of a freshly loaded table would write all of it, from whichever session
+ * happened to read it first.  Any later MarkBufferDirty clears the flag.
+ * So this must not be used for PD_ALL_VISIBLE either: losing that flag
+ * while the visibility map bit stays set would be a real inconsistency.
  */
 void
 SetBufferCommitInfoNeedsSave(Buffer buffer)
@@ -2348,6 +3165,8 @@ SetBufferCommitInfoNeedsSave(Buffer buffer)
 			VacuumPageDirty++;
 			if (VacuumCostActive)
 				VacuumCostBalance += VacuumCostPageDirty;
+			if (defer_hint_bit_writes)
+				bufHdr->flags |= BM_HINT_ONLY;
 		}
 		bufHdr->flags |= (BM_DIRTY | BM_JUST_DIRTIED);
 		UnlockBufHdr(bufHdr);
@@ -2585,6 +3404,53 @@ ConditionalLockBufferForCleanup(Buffer buffer)
 	return false;
 }
 
+/*
+ * IsBufferCleanupOK - as above, but we already have the lock
+ *
+ * Check whether it's OK to perform cleanup on a buffer we've already
+ * locked.  If we observe that the pin count is 1, our exclusive lock
+ * happens to be a cleanup lock, and we can proceed with anything that
+ * would have been allowable had we sought a cleanup lock originally.
+ */
+bool
+IsBufferCleanupOK(Buffer buffer)
+{
+	volatile BufferDesc *bufHdr;
+
+	Assert(BufferIsValid(buffer));
+
+	if (BufferIsLocal(buffer))
+	{
+		/* There should be exactly one pin */
+		if (LocalRefCount[-buffer - 1] != 1)
+			return false;
+		/* Nobody else to wait for */
+		return true;
+	}
+
+	/* There should be exactly one local pin */
+	if (PrivateRefCount[buffer - 1] != 1)
+		return false;
+
+	bufHdr = &BufferDescriptors[buffer - 1];
+
+	/* caller must hold exclusive lock on buffer */
+	Assert(LWLockHeldByMe(bufHdr->content_lock));
+
+	LockBufHdr(bufHdr);
+
+	Assert(bufHdr->refcount > 0);
+	if (bufHdr->refcount == 1)
+	{
+		/* pincount is OK. */
+		UnlockBufHdr(bufHdr);
+		return true;
+	}
+
+	UnlockBufHdr(bufHdr);
+	return false;
+}
+
 
 /*
  *	Functions for buffer I/O handling
@@ -2648,7 +3514,7 @@ WaitIO(volatile BufferDesc *buf)
 static bool
 StartBufferIO(volatile BufferDesc *buf, bool forInput)
 {
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs < MAX_IN_PROGRESS_IO);
 
 	for (;;)
 	{
@@ -2688,8 +3554,9 @@ StartBufferIO(volatile BufferDesc *buf, bool forInput)
 
 	UnlockBufHdr(buf);
 
-	InProgressBuf = buf;
-	IsForInput = forInput;
+	InProgressBufs[NumInProgressBufs] = buf;
+	InProgressForInput[NumInProgressBufs] = forInput;
+	NumInProgressBufs++;
 
 	return true;
 }
@@ -2715,19 +3582,29 @@ static void
 TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
 				  int set_flag_bits)
 {
-	Assert(buf == InProgressBuf);
+	int			i;
+
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
 
 	LockBufHdr(buf);
 
 	Assert(buf->flags & BM_IO_IN_PROGRESS);
 	buf->flags &= ~(BM_IO_IN_PROGRESS | BM_IO_ERROR);
 	if (clear_dirty && !(buf->flags & BM_JUST_DIRTIED))
-		buf->flags &= ~(BM_DIRTY | BM_CHECKPOINT_NEEDED);
+		buf->flags &= ~(BM_DIRTY | BM_CHECKPOINT_NEEDED | BM_HINT_ONLY);
 	buf->flags |= set_flag_bits;
 
 	UnlockBufHdr(buf);
 
-	InProgressBuf = NULL;
+	/* forget it; order of the remaining entries doesn't matter */
+	NumInProgressBufs--;
+	InProgressBufs[i] = InProgressBufs[NumInProgressBufs];
+	InProgressForInput[i] = InProgressForInput[NumInProgressBufs];
 
 	LWLockRelease(buf->io_in_progress_lock);
 }
@@ -2736,7 +3613,7 @@ TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
  * AbortBufferIO: Clean up any active buffer I/O after an error.
  *
  *	All LWLocks we might have held have been released,
- *	but we haven't yet released buffer pins, so the buffer is still pinned.
+ *	but we haven't yet released buffer pins, so the buffers are still pinned.
  *
  *	If I/O was in progress, we always set BM_IO_ERROR, even though it's
  *	possible the error condition wasn't related to the I/O.
@@ -2744,10 +3621,11 @@ TerminateBufferIO(volatile BufferDesc *buf, bool clear_dirty,
 void
 AbortBufferIO(void)
 {
-	volatile BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		volatile BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
+		bool		forInput = InProgressForInput[NumInProgressBufs - 1];
+
 		/*
 		 * Since LWLockReleaseAll has already been called, we're not holding
 		 * the buffer's io_in_progress_lock. We have to re-acquire it so that
@@ -2758,7 +3636,7 @@ AbortBufferIO(void)
 
 		LockBufHdr(buf);
 		Assert(buf->flags & BM_IO_IN_PROGRESS);
-		if (IsForInput)
+		if (forInput)
 		{
 			Assert(!(buf->flags & BM_DIRTY));
 			/* We'd better not think buffer is valid yet */
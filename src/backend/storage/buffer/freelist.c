@@ -15,17 +15,28 @@
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 
 
 /*
- * The shared freelist control information.
+ * The buffer freelist is split into NUM_BUFFER_FREELISTS partitions, each
+ * protected by its own spinlock, so that backends putting buffers on or
+ * taking them off the freelist don't all serialize on one lock.  A buffer
+ * is always returned to the partition given by its buf_id, but a backend
+ * looking for a free buffer will take one from any partition.
+ *
+ * Each partition is padded to a cache line, to avoid false sharing.
  */
+#define NUM_BUFFER_FREELISTS		4
+#define BUFFER_FREELIST_PADDED_SIZE	64
+
+#define BufferFreelistForBuffer(buf_id) ((buf_id) % NUM_BUFFER_FREELISTS)
+
 typedef struct
 {
-	/* Clock sweep hand: index of next buffer to consider grabbing */
-	int			nextVictimBuffer;
+	slock_t		mutex;			/* protects the fields below */
 
 	int			firstFreeBuffer;	/* Head of list of unused buffers */
 	int			lastFreeBuffer; /* Tail of list of unused buffers */
@@ -35,12 +46,47 @@ typedef struct
 	 * when the list is empty)
 	 */
 
+	/*
+	 * Buffers allocated since last reset by backends that started their
+	 * search in this partition.  Should be wide enough that it can't
+	 * overflow during a single bgwriter cycle.
+	 */
+	uint32		numBufferAllocs;
+} BufferFreelist;
+
+typedef union BufferFreelistPadded
+{
+	BufferFreelist freelist;
+	char		pad[BUFFER_FREELIST_PADDED_SIZE];
+} BufferFreelistPadded;
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/*
+	 * Spinlock protecting the clock sweep hand.  It is held only while
+	 * advancing the hand by one buffer, never while examining a buffer.
+	 */
+	slock_t		victimbuf_lck;
+
+	/* Clock sweep hand: index of next buffer to consider grabbing */
+	int			nextVictimBuffer;
+
 	/*
 	 * Statistics.	These counters should be wide enough that they can't
 	 * overflow during a single bgwriter cycle.
 	 */
 	uint32		completePasses; /* Complete cycles of the clock sweep */
-	uint32		numBufferAllocs;	/* Buffers allocated since last reset */
+
+	/*
+	 * Latch to set when the freelists run dry, or NULL if the bgwriter
+	 * doesn't want to be woken.  Protected by victimbuf_lck.
+	 */
+	Latch	   *bgwriterLatch;
+
+	BufferFreelistPadded freelists[NUM_BUFFER_FREELISTS];
 } BufferStrategyControl;
 
 /* Pointers to shared state */
@@ -86,6 +132,31 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
 				volatile BufferDesc *buf);
 
 
+/*
+ * ClockSweepTick - Helper routine for StrategyGetBuffer()
+ *
+ * Move the clock hand one buffer ahead of its current position and return
+ * the id of the buffer now under the hand.
+ */
+static int
+ClockSweepTick(void)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile BufferStrategyControl *sc = StrategyControl;
+	int			victim;
+
+	SpinLockAcquire(&sc->victimbuf_lck);
+	victim = sc->nextVictimBuffer;
+	if (++sc->nextVictimBuffer >= NBuffers)
+	{
+		sc->nextVictimBuffer = 0;
+		sc->completePasses++;
+	}
+	SpinLockRelease(&sc->victimbuf_lck);
+
+	return victim;
+}
+
 /*
  * StrategyGetBuffer
  *
@@ -96,87 +167,124 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
  *	strategy is a BufferAccessStrategy object, or NULL for default strategy.
  *
  *	To ensure that no one else can pin the buffer before we do, we must
- *	return the buffer with the buffer header spinlock still held.  If
- *	*lock_held is set on exit, we have returned with the BufFreelistLock
- *	still held, as well; the caller must release that lock once the spinlock
- *	is dropped.  We do it that way because releasing the BufFreelistLock
- *	might awaken other processes, and it would be bad to do the associated
- *	kernel calls while holding the buffer header spinlock.
+ *	return the buffer with the buffer header spinlock still held.  No other
+ *	lock is held on return.
  */
 volatile BufferDesc *
-StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
+StrategyGetBuffer(BufferAccessStrategy strategy)
 {
 	volatile BufferDesc *buf;
+	volatile BufferFreelist *freelist;
+	int			startlist;
+	int			i;
 	int			trycounter;
 
 	/*
 	 * If given a strategy object, see whether it can select a buffer. We
-	 * assume strategy objects don't need the BufFreelistLock.
+	 * assume strategy objects don't need any shared lock.
 	 */
 	if (strategy != NULL)
 	{
 		buf = GetBufferFromRing(strategy);
 		if (buf != NULL)
-		{
-			*lock_held = false;
 			return buf;
-		}
 	}
 
-	/* Nope, so lock the freelist */
-	*lock_held = true;
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
+	/*
+	 * Start searching the freelists at a partition chosen by our PID, so
+	 * that concurrent backends tend to use different partitions.
+	 */
+	startlist = MyProcPid % NUM_BUFFER_FREELISTS;
 
 	/*
 	 * We count buffer allocation requests so that the bgwriter can estimate
 	 * the rate of buffer consumption.	Note that buffers recycled by a
 	 * strategy object are intentionally not counted here.
 	 */
-	StrategyControl->numBufferAllocs++;
+	freelist = &StrategyControl->freelists[startlist].freelist;
+	SpinLockAcquire(&freelist->mutex);
+	freelist->numBufferAllocs++;
+	SpinLockRelease(&freelist->mutex);
 
 	/*
-	 * Try to get a buffer from the freelist.  Note that the freeNext fields
-	 * are considered to be protected by the BufFreelistLock not the
+	 * Try to get a buffer from the freelists.  Note that the freeNext fields
+	 * are considered to be protected by the freelist's spinlock not the
 	 * individual buffer spinlocks, so it's OK to manipulate them without
-	 * holding the spinlock.
+	 * holding the buffer spinlock.  We never hold both spinlocks at once.
+	 *
+	 * The freelists are normally empty once the system has been running a
+	 * while, so first check without taking the spinlock.  That's racy, but
+	 * the worst that can happen is that we miss a buffer that was just put
+	 * on a list, or take the lock for nothing.
 	 */
-	while (StrategyControl->firstFreeBuffer >= 0)
+	for (i = 0; i < NUM_BUFFER_FREELISTS; i++)
 	{
-		buf = &BufferDescriptors[StrategyControl->firstFreeBuffer];
-		Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
-
-		/* Unconditionally remove buffer from freelist */
-		StrategyControl->firstFreeBuffer = buf->freeNext;
-		buf->freeNext = FREENEXT_NOT_IN_LIST;
+		freelist = &StrategyControl->freelists[(startlist + i) % NUM_BUFFER_FREELISTS].freelist;
 
-		/*
-		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
-		 * it; discard it and retry.  (This can only happen if VACUUM put a
-		 * valid buffer in the freelist and then someone else used it before
-		 * we got to it.  It's probably impossible altogether as of 8.3, but
-		 * we'd better check anyway.)
-		 */
-		LockBufHdr(buf);
-		if (buf->refcount == 0 && buf->usage_count == 0)
+		while (freelist->firstFreeBuffer >= 0)
 		{
-			if (strategy != NULL)
-				AddBufferToRing(strategy, buf);
-			return buf;
+			SpinLockAcquire(&freelist->mutex);
+
+			if (freelist->firstFreeBuffer < 0)
+			{
+				SpinLockRelease(&freelist->mutex);
+				break;
+			}
+
+			buf = &BufferDescriptors[freelist->firstFreeBuffer];
+			Assert(buf->freeNext != FREENEXT_NOT_IN_LIST);
+
+			/* Unconditionally remove buffer from freelist */
+			freelist->firstFreeBuffer = buf->freeNext;
+			buf->freeNext = FREENEXT_NOT_IN_LIST;
+
+			SpinLockRelease(&freelist->mutex);
+
+			/*
+			 * If the buffer is pinned or has a nonzero usage_count, we cannot
+			 * use it; discard it and retry.  (This can only happen if VACUUM
+			 * put a valid buffer in the freelist and then someone else used
+			 * it before we got to it.  It's probably impossible altogether as
+			 * of 8.3, but we'd better check anyway.)
+			 */
+			LockBufHdr(buf);
+			if (buf->refcount == 0 && buf->usage_count == 0)
+			{
+				if (strategy != NULL)
+					AddBufferToRing(strategy, buf);
+				return buf;
+			}
+			UnlockBufHdr(buf);
 		}
-		UnlockBufHdr(buf);
 	}
 
-	/* Nothing on the freelist, so run the "clock sweep" algorithm */
+	/*
+	 * Nothing on the freelists.  If the bgwriter is waiting to be told about
+	 * that, wake it up so that it can put more clean buffers there while we
+	 * run the clock sweep ourselves.  The unlocked check is fine, because a
+	 * missed wakeup only means the bgwriter sleeps out its normal delay.
+	 * We clear the latch pointer so that other backends don't keep setting
+	 * it until the bgwriter asks again.
+	 */
+	if (StrategyControl->bgwriterLatch != NULL)
+	{
+		volatile BufferStrategyControl *sc = StrategyControl;
+		Latch	   *bgwriterLatch;
+
+		SpinLockAcquire(&sc->victimbuf_lck);
+		bgwriterLatch = sc->bgwriterLatch;
+		sc->bgwriterLatch = NULL;
+		SpinLockRelease(&sc->victimbuf_lck);
+
+		if (bgwriterLatch)
+			SetLatch(bgwriterLatch);
+	}
+
+	/* Run the "clock sweep" algorithm */
 	trycounter = NBuffers;
 	for (;;)
 	{
-		buf = &BufferDescriptors[StrategyControl->nextVictimBuffer];
-
-		if (++StrategyControl->nextVictimBuffer >= NBuffers)
-		{
-			StrategyControl->nextVictimBuffer = 0;
-			StrategyControl->completePasses++;
-		}
+		buf = &BufferDescriptors[ClockSweepTick()];
 
 		/*
 		 * If the buffer is pinned or has a nonzero usage_count, we cannot use
@@ -223,7 +331,11 @@ StrategyGetBuffer(BufferAccessStrategy strategy, bool *lock_held)
 void
 StrategyFreeBuffer(volatile BufferDesc *buf)
 {
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
+	volatile BufferFreelist *freelist;
+
+	freelist = &StrategyControl->freelists[BufferFreelistForBuffer(buf->buf_id)].freelist;
+
+	SpinLockAcquire(&freelist->mutex);
 
 	/*
 	 * It is possible that we are told to put something in the freelist that
@@ -231,13 +343,13 @@ StrategyFreeBuffer(volatile BufferDesc *buf)
 	 */
 	if (buf->freeNext == FREENEXT_NOT_IN_LIST)
 	{
-		buf->freeNext = StrategyControl->firstFreeBuffer;
+		buf->freeNext = freelist->firstFreeBuffer;
 		if (buf->freeNext < 0)
-			StrategyControl->lastFreeBuffer = buf->buf_id;
-		StrategyControl->firstFreeBuffer = buf->buf_id;
+			freelist->lastFreeBuffer = buf->buf_id;
+		freelist->firstFreeBuffer = buf->buf_id;
 	}
 
-	LWLockRelease(BufFreelistLock);
+	SpinLockRelease(&freelist->mutex);
 }
 
 /*
@@ -254,21 +366,52 @@ StrategyFreeBuffer(volatile BufferDesc *buf)
 int
 StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
 {
+	/* use volatile pointer to prevent code rearrangement */
+	volatile BufferStrategyControl *sc = StrategyControl;
 	int			result;
 
-	LWLockAcquire(BufFreelistLock, LW_EXCLUSIVE);
-	result = StrategyControl->nextVictimBuffer;
+	SpinLockAcquire(&sc->victimbuf_lck);
+	result = sc->nextVictimBuffer;
 	if (complete_passes)
-		*complete_passes = StrategyControl->completePasses;
+		*complete_passes = sc->completePasses;
+	SpinLockRelease(&sc->victimbuf_lck);
+
 	if (num_buf_alloc)
 	{
-		*num_buf_alloc = StrategyControl->numBufferAllocs;
-		StrategyControl->numBufferAllocs = 0;
+		int			i;
+
+		*num_buf_alloc = 0;
+		for (i = 0; i < NUM_BUFFER_FREELISTS; i++)
+		{
+			volatile BufferFreelist *freelist = &sc->freelists[i].freelist;
+
+			SpinLockAcquire(&freelist->mutex);
+			*num_buf_alloc += freelist->numBufferAllocs;
+			freelist->numBufferAllocs = 0;
+			SpinLockRelease(&freelist->mutex);
+		}
 	}
-	LWLockRelease(BufFreelistLock);
 	return result;
 }
 
+/*
+ * StrategyNotifyBgWriter -- set or clear allocation notification latch
+ *
+ * If bgwriterLatch isn't NULL, the next backend that finds the freelists
+ * empty will set that latch.  Pass NULL to clear the pending notification
+ * before it happens.
+ */
+void
+StrategyNotifyBgWriter(Latch *bgwriterLatch)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile BufferStrategyControl *sc = StrategyControl;
+
+	SpinLockAcquire(&sc->victimbuf_lck);
+	sc->bgwriterLatch = bgwriterLatch;
+	SpinLockRelease(&sc->victimbuf_lck);
+}
+
 
 /*
  * StrategyShmemSize
@@ -284,7 +427,7 @@ StrategyShmemSize(void)
 	Size		size = 0;
 
 	/* size of lookup hash table ... see comment in StrategyInitialize */
-	size = add_size(size, BufTableShmemSize(NBuffers + NUM_BUFFER_PARTITIONS));
+	size = add_size(size, BufTableShmemSize(NBuffers + NumBufferPartitions));
 
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
@@ -303,6 +446,7 @@ void
 StrategyInitialize(bool init)
 {
 	bool		found;
+	int			i;
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
@@ -312,9 +456,9 @@ StrategyInitialize(bool init)
 	 * usage is of course NBuffers entries, but BufferAlloc() tries to insert
 	 * a new entry before deleting the old.  In principle this could be
 	 * happening in each partition concurrently, so we could need as many as
-	 * NBuffers + NUM_BUFFER_PARTITIONS entries.
+	 * NBuffers + NumBufferPartitions entries.
 	 */
-	InitBufTable(NBuffers + NUM_BUFFER_PARTITIONS);
+	InitBufTable(NBuffers + NumBufferPartitions);
 
 	/*
 	 * Get or create the shared strategy control block
@@ -332,18 +476,43 @@ StrategyInitialize(bool init)
 		Assert(init);
 
 		/*
-		 * Grab the whole linked list of free buffers for our strategy. We
-		 * assume it was previously set up by InitBufferPool().
+		 * Distribute the free buffers over the freelist partitions.  Buffer
+		 * i goes to partition BufferFreelistForBuffer(i), in ascending
+		 * order within each partition.  This replaces the single list that
+		 * InitBufferPool() set up.
 		 */
-		StrategyControl->firstFreeBuffer = 0;
-		StrategyControl->lastFreeBuffer = NBuffers - 1;
+		for (i = 0; i < NUM_BUFFER_FREELISTS; i++)
+		{
+			BufferFreelist *freelist = &StrategyControl->freelists[i].freelist;
+
+			SpinLockInit(&freelist->mutex);
+			freelist->firstFreeBuffer = -1;
+			freelist->lastFreeBuffer = -1;
+			freelist->numBufferAllocs = 0;
+		}
+		for (i = 0; i < NBuffers; i++)
+		{
+			BufferFreelist *freelist;
+			volatile BufferDesc *buf = &BufferDescriptors[i];
+
+			freelist = &StrategyControl->freelists[BufferFreelistForBuffer(i)].freelist;
+			buf->freeNext = FREENEXT_END_OF_LIST;
+			if (freelist->firstFreeBuffer < 0)
+				freelist->firstFreeBuffer = i;
+			else
+				BufferDescriptors[freelist->lastFreeBuffer].freeNext = i;
+			freelist->lastFreeBuffer = i;
+		}
 
 		/* Initialize the clock sweep pointer */
+		SpinLockInit(&StrategyControl->victimbuf_lck);
 		StrategyControl->nextVictimBuffer = 0;
 
 		/* Clear statistics */
 		StrategyControl->completePasses = 0;
-		StrategyControl->numBufferAllocs = 0;
+
+		/* No pending notification */
+		StrategyControl->bgwriterLatch = NULL;
 	}
 	else
 		Assert(!init);
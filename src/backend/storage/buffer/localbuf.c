@@ -37,6 +37,12 @@ typedef struct
 #define LocalBufHdrGetBlock(bufHdr) \
 	LocalBufferBlockPointers[-((bufHdr)->buf_id + 2)]
 
+/*
+ * When dropping fewer than this many blocks of a relation whose size we
+ * know, look them up one by one rather than scanning all the local buffers.
+ */
+#define LOCALBUF_DROP_FULL_SCAN_THRESHOLD	((BlockNumber) (NLocBuffer / 32))
+
 int			NLocBuffer = 0;		/* until buffers are initialized */
 
 BufferDesc *LocalBufferDescriptors = NULL;
@@ -49,6 +55,8 @@ static HTAB *LocalBufHash = NULL;
 
 
 static void InitLocalBuffers(void);
+static void EnlargeLocalBuffers(void);
+static void InvalidateLocalBuffer(int b);
 static Block GetLocalBufferStorage(void);
 
 
@@ -114,6 +122,9 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 	/* Initialize local buffers if first request in this session */
 	if (LocalBufHash == NULL)
 		InitLocalBuffers();
+	/* ... or add buffers if temp_buffers has been raised since */
+	else if (NLocBuffer < num_temp_buffers)
+		EnlargeLocalBuffers();
 
 	/* See if the desired buffer already exists */
 	hresult = (LocalBufferLookupEnt *)
@@ -288,44 +299,87 @@ MarkLocalBufferDirty(Buffer buffer)
  *		out first.	Therefore, this is NOT rollback-able, and so should be
  *		used only with extreme caution!
  *
+ *		nForkBlock is the current size of the fork, or InvalidBlockNumber if
+ *		the caller doesn't know it.  If it is known and only a few blocks
+ *		are to be dropped, we look them up in the hash table instead of
+ *		scanning all the local buffers, which makes dropping many small
+ *		temporary tables cheap even with a large temp_buffers.
+ *
  *		See DropRelFileNodeBuffers in bufmgr.c for more notes.
  */
 void
 DropRelFileNodeLocalBuffers(RelFileNode rnode, ForkNumber forkNum,
-							BlockNumber firstDelBlock)
+							BlockNumber nForkBlock, BlockNumber firstDelBlock)
 {
 	int			i;
 
+	/* Nothing to do if we have no local buffers yet */
+	if (LocalBufHash == NULL)
+		return;
+
+	if (nForkBlock != InvalidBlockNumber)
+	{
+		if (nForkBlock <= firstDelBlock)
+			return;				/* nothing to drop */
+		if (nForkBlock - firstDelBlock < LOCALBUF_DROP_FULL_SCAN_THRESHOLD)
+		{
+			BlockNumber blkno;
+
+			for (blkno = firstDelBlock; blkno < nForkBlock; blkno++)
+			{
+				BufferTag	tag;
+				LocalBufferLookupEnt *hresult;
+
+				INIT_BUFFERTAG(tag, rnode, forkNum, blkno);
+				hresult = (LocalBufferLookupEnt *)
+					hash_search(LocalBufHash, (void *) &tag, HASH_FIND, NULL);
+				if (hresult)
+					InvalidateLocalBuffer(hresult->id);
+			}
+			return;
+		}
+	}
+
 	for (i = 0; i < NLocBuffer; i++)
 	{
 		BufferDesc *bufHdr = &LocalBufferDescriptors[i];
-		LocalBufferLookupEnt *hresult;
 
 		if ((bufHdr->flags & BM_TAG_VALID) &&
 			RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
 			bufHdr->tag.forkNum == forkNum &&
 			bufHdr->tag.blockNum >= firstDelBlock)
-		{
-			if (LocalRefCount[i] != 0)
-				elog(ERROR, "block %u of %s is still referenced (local %u)",
-					 bufHdr->tag.blockNum,
-					 relpathbackend(bufHdr->tag.rnode, MyBackendId,
-									bufHdr->tag.forkNum),
-					 LocalRefCount[i]);
-			/* Remove entry from hashtable */
-			hresult = (LocalBufferLookupEnt *)
-				hash_search(LocalBufHash, (void *) &bufHdr->tag,
-							HASH_REMOVE, NULL);
-			if (!hresult)		/* shouldn't happen */
-				elog(ERROR, "local buffer hash table corrupted");
-			/* Mark buffer invalid */
-			CLEAR_BUFFERTAG(bufHdr->tag);
-			bufHdr->flags = 0;
-			bufHdr->usage_count = 0;
-		}
+			InvalidateLocalBuffer(i);
 	}
 }
 
+/*
+ * InvalidateLocalBuffer -- drop the page in a local buffer, without
+ *		writing it out, for DropRelFileNodeLocalBuffers
+ */
+static void
+InvalidateLocalBuffer(int b)
+{
+	BufferDesc *bufHdr = &LocalBufferDescriptors[b];
+	LocalBufferLookupEnt *hresult;
+
+	if (LocalRefCount[b] != 0)
+		elog(ERROR, "block %u of %s is still referenced (local %u)",
+			 bufHdr->tag.blockNum,
+			 relpathbackend(bufHdr->tag.rnode, MyBackendId,
+							bufHdr->tag.forkNum),
+			 LocalRefCount[b]);
+	/* Remove entry from hashtable */
+	hresult = (LocalBufferLookupEnt *)
+		hash_search(LocalBufHash, (void *) &bufHdr->tag,
+					HASH_REMOVE, NULL);
+	if (!hresult)				/* shouldn't happen */
+		elog(ERROR, "local buffer hash table corrupted");
+	/* Mark buffer invalid */
+	CLEAR_BUFFERTAG(bufHdr->tag);
+	bufHdr->flags = 0;
+	bufHdr->usage_count = 0;
+}
+
 /*
  * InitLocalBuffers -
  *	  init the local buffer cache. Since most queries (esp. multi-user ones)
@@ -382,6 +436,60 @@ InitLocalBuffers(void)
 	NLocBuffer = nbufs;
 }
 
+/*
+ * EnlargeLocalBuffers -
+ *	  add buffer headers to the local buffer cache, after temp_buffers has
+ *	  been raised.  As in InitLocalBuffers, memory for the buffers themselves
+ *	  is allocated when they are first used.
+ *
+ * This moves the buffer headers, so the caller mustn't hold on to pointers
+ * to any of them.  Buffer numbers, and pointers to the pages, don't change.
+ */
+static void
+EnlargeLocalBuffers(void)
+{
+	int			nbufs = num_temp_buffers;
+	BufferDesc *descs;
+	Block	   *blocks;
+	int32	   *refcounts;
+	int			i;
+
+	Assert(nbufs > NLocBuffer);
+
+	/*
+	 * Install each array as soon as it has been enlarged, so that nothing is
+	 * lost if enlarging the next one fails; NLocBuffer is advanced only once
+	 * all of them have room.
+	 */
+	descs = (BufferDesc *) realloc(LocalBufferDescriptors,
+								   nbufs * sizeof(BufferDesc));
+	if (descs)
+		LocalBufferDescriptors = descs;
+	blocks = (Block *) realloc(LocalBufferBlockPointers,
+							   nbufs * sizeof(Block));
+	if (blocks)
+		LocalBufferBlockPointers = blocks;
+	refcounts = (int32 *) realloc(LocalRefCount, nbufs * sizeof(int32));
+	if (refcounts)
+		LocalRefCount = refcounts;
+	if (!descs || !blocks || !refcounts)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+
+	/* Zero the new entries, and number the new buffers as InitLocalBuffers */
+	MemSet(&LocalBufferDescriptors[NLocBuffer], 0,
+		   (nbufs - NLocBuffer) * sizeof(BufferDesc));
+	MemSet(&LocalBufferBlockPointers[NLocBuffer], 0,
+		   (nbufs - NLocBuffer) * sizeof(Block));
+	MemSet(&LocalRefCount[NLocBuffer], 0,
+		   (nbufs - NLocBuffer) * sizeof(int32));
+	for (i = NLocBuffer; i < nbufs; i++)
+		LocalBufferDescriptors[i].buf_id = -i - 2;
+
+	NLocBuffer = nbufs;
+}
+
 /*
  * GetLocalBufferStorage - allocate memory for a local buffer
  *
@@ -389,7 +497,7 @@ InitLocalBuffers(void)
  * so that the memory manager doesn't see a whole lot of relatively small
  * requests.  Since we'll never give back a local buffer once it's created
  * within a particular process, no point in burdening memmgr with separately
- * managed chunks.
+ * managed chunks.  (NLocBuffer may grow later on, but never shrinks.)
  */
 static Block
 GetLocalBufferStorage(void)
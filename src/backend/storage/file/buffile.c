@@ -38,6 +38,8 @@
 #include "storage/fd.h"
 #include "storage/buffile.h"
 #include "storage/buf_internals.h"
+#include "utils/memutils.h"
+#include "utils/pg_lzcompress.h"
 
 /*
  * We break BufFiles into gigabyte-sized segments, regardless of RELSEG_SIZE.
@@ -47,6 +49,23 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/* GUC variable */
+bool		temp_file_compression = false;
+
+/*
+ * A compressed BufFile is written as a series of chunks, one per buffer
+ * dump.  Each chunk is an int32 length word followed by that many bytes of
+ * pglz output, or, if the length word is negative, by -length bytes of
+ * uncompressed data because the buffer didn't compress.  Chunks may cross
+ * segment boundaries.
+ *
+ * All compressed BufFiles share one scratch buffer for the pglz output,
+ * since we never compress or decompress more than one chunk at a time.
+ */
+#define BUFFILE_COMPRESS_BUFSIZE	PGLZ_MAX_OUTPUT(BLCKSZ)
+
+static char *compress_buffer = NULL;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -66,11 +85,14 @@ struct BufFile
 
 	bool		isTemp;			/* can only add files if this is TRUE */
 	bool		isInterXact;	/* keep open over transactions? */
+	bool		compressed;		/* are buffers compressed on disk? */
 	bool		dirty;			/* does buffer need to be written? */
 
 	/*
 	 * "current pos" is position of start of buffer within the logical file.
 	 * Position as seen by user of BufFile is (curFile, curOffset + pos).
+	 * In a compressed file, (curFile, curOffset) is instead the physical
+	 * position of the next chunk to read or write.
 	 */
 	int			curFile;		/* file index (0..n) part of current pos */
 	off_t		curOffset;		/* offset part of current pos */
@@ -83,6 +105,10 @@ static BufFile *makeBufFile(File firstfile);
 static void extendBufFile(BufFile *file);
 static void BufFileLoadBuffer(BufFile *file);
 static void BufFileDumpBuffer(BufFile *file);
+static void BufFileLoadCompressed(BufFile *file);
+static void BufFileDumpCompressed(BufFile *file);
+static int	BufFileReadPhysical(BufFile *file, char *ptr, int size);
+static bool BufFileWritePhysical(BufFile *file, char *ptr, int size);
 static int	BufFileFlush(BufFile *file);
 
 
@@ -102,6 +128,7 @@ makeBufFile(File firstfile)
 	file->offsets[0] = 0L;
 	file->isTemp = false;
 	file->isInterXact = false;
+	file->compressed = false;
 	file->dirty = false;
 	file->curFile = 0;
 	file->curOffset = 0L;
@@ -122,6 +149,7 @@ extendBufFile(BufFile *file)
 	Assert(file->isTemp);
 	pfile = OpenTemporaryFile(file->isInterXact);
 	Assert(pfile >= 0);
+	pgBufferUsage.temp_files++;
 
 	file->files = (File *) repalloc(file->files,
 									(file->numFiles + 1) * sizeof(File));
@@ -151,6 +179,7 @@ BufFileCreateTemp(bool interXact)
 
 	pfile = OpenTemporaryFile(interXact);
 	Assert(pfile >= 0);
+	pgBufferUsage.temp_files++;
 
 	file = makeBufFile(pfile);
 	file->isTemp = true;
@@ -159,6 +188,30 @@ BufFileCreateTemp(bool interXact)
 	return file;
 }
 
+/*
+ * Create a BufFile for a new temporary file whose buffers are compressed
+ * with pglz as they are written out.
+ *
+ * The file must be written from start to end, and can then only be rewound
+ * with BufFileSeek(file, 0, 0L, SEEK_SET) and read sequentially, since
+ * logical positions no longer map to physical ones.  This suits hash join
+ * batch files, but not tuplestores or logical tape sets.
+ */
+BufFile *
+BufFileCreateCompressedTemp(bool interXact)
+{
+	BufFile    *file;
+
+	if (compress_buffer == NULL)
+		compress_buffer = MemoryContextAlloc(TopMemoryContext,
+											 BUFFILE_COMPRESS_BUFSIZE);
+
+	file = BufFileCreateTemp(interXact);
+	file->compressed = true;
+
+	return file;
+}
+
 #ifdef NOT_USED
 /*
  * Create a BufFile and attach it to an already-opened virtual File.
@@ -207,6 +260,12 @@ BufFileLoadBuffer(BufFile *file)
 {
 	File		thisfile;
 
+	if (file->compressed)
+	{
+		BufFileLoadCompressed(file);
+		return;
+	}
+
 	/*
 	 * Advance to next component file if necessary and possible.
 	 *
@@ -253,16 +312,189 @@ BufFileLoadBuffer(BufFile *file)
  */
 static void
 BufFileDumpBuffer(BufFile *file)
+{
+	if (file->compressed)
+	{
+		BufFileDumpCompressed(file);
+		return;
+	}
+
+	if (!BufFileWritePhysical(file, file->buffer, file->nbytes))
+		return;					/* failed to write */
+	file->dirty = false;
+
+	pgBufferUsage.temp_blks_written++;
+
+	/*
+	 * At this point, curOffset has been advanced to the end of the buffer,
+	 * ie, its original value + nbytes.  We need to make it point to the
+	 * logical file position, ie, original value + pos, in case that is less
+	 * (as could happen due to a small backwards seek in a dirty buffer!)
+	 */
+	file->curOffset -= (file->nbytes - file->pos);
+	if (file->curOffset < 0)	/* handle possible segment crossing */
+	{
+		file->curFile--;
+		Assert(file->curFile >= 0);
+		file->curOffset += MAX_PHYSICAL_FILESIZE;
+	}
+
+	/*
+	 * Now we can set the buffer empty without changing the logical position
+	 */
+	file->pos = 0;
+	file->nbytes = 0;
+}
+
+/*
+ * BufFileLoadCompressed
+ *
+ * BufFileLoadBuffer for a compressed file: read the chunk at curOffset and
+ * decompress it into the buffer, advancing curOffset past it.
+ * On exit, nbytes is number of bytes loaded, zero at end of file.
+ */
+static void
+BufFileLoadCompressed(BufFile *file)
+{
+	int32		len;
+
+	if (BufFileReadPhysical(file, (char *) &len, sizeof(len)) != sizeof(len))
+		return;					/* end of file */
+
+	if (len < 0)
+	{
+		/* stored uncompressed */
+		if (-len > BLCKSZ)
+			elog(ERROR, "invalid chunk length %d in compressed temporary file",
+				 (int) len);
+		if (BufFileReadPhysical(file, file->buffer, -len) != -len)
+			return;
+		file->nbytes = -len;
+	}
+	else
+	{
+		PGLZ_Header *cbuf = (PGLZ_Header *) compress_buffer;
+
+		if (len < (int32) sizeof(PGLZ_Header) ||
+			len > (int32) BUFFILE_COMPRESS_BUFSIZE)
+			elog(ERROR, "invalid chunk length %d in compressed temporary file",
+				 (int) len);
+		if (BufFileReadPhysical(file, compress_buffer, len) != len)
+			return;
+		if (PGLZ_RAW_SIZE(cbuf) > BLCKSZ)
+			elog(ERROR, "invalid chunk length %d in compressed temporary file",
+				 (int) PGLZ_RAW_SIZE(cbuf));
+		pglz_decompress(cbuf, file->buffer);
+		file->nbytes = PGLZ_RAW_SIZE(cbuf);
+	}
+
+	pgBufferUsage.temp_blks_read++;
+}
+
+/*
+ * BufFileDumpCompressed
+ *
+ * BufFileDumpBuffer for a compressed file: write the buffer as one chunk at
+ * curOffset.  Since data is only ever appended to a compressed file, the
+ * buffer is always written in full, and is empty on exit.
+ */
+static void
+BufFileDumpCompressed(BufFile *file)
+{
+	PGLZ_Header *cbuf = (PGLZ_Header *) compress_buffer;
+	char	   *data;
+	int32		len;
+
+	if (pglz_compress(file->buffer, file->nbytes, cbuf,
+					  PGLZ_strategy_default))
+	{
+		data = compress_buffer;
+		len = VARSIZE(cbuf);
+		if (!BufFileWritePhysical(file, (char *) &len, sizeof(len)))
+			return;
+	}
+	else
+	{
+		int32		rawlen = -file->nbytes;
+
+		data = file->buffer;
+		len = file->nbytes;
+		if (!BufFileWritePhysical(file, (char *) &rawlen, sizeof(rawlen)))
+			return;
+	}
+	if (!BufFileWritePhysical(file, data, len))
+		return;
+
+	file->dirty = false;
+	file->pos = 0;
+	file->nbytes = 0;
+
+	pgBufferUsage.temp_blks_written++;
+}
+
+/*
+ * BufFileReadPhysical
+ *
+ * Read up to size bytes at (curFile, curOffset), crossing segment
+ * boundaries as needed, and advance curOffset past them.  Returns the
+ * number of bytes read.  Only compressed files read this way.
+ */
+static int
+BufFileReadPhysical(BufFile *file, char *ptr, int size)
+{
+	int			nread = 0;
+
+	while (nread < size)
+	{
+		File		thisfile;
+		int			bytestoread = size - nread;
+		off_t		availbytes;
+
+		if (file->curOffset >= MAX_PHYSICAL_FILESIZE)
+		{
+			if (file->curFile + 1 >= file->numFiles)
+				break;
+			file->curFile++;
+			file->curOffset = 0L;
+		}
+		availbytes = MAX_PHYSICAL_FILESIZE - file->curOffset;
+		if ((off_t) bytestoread > availbytes)
+			bytestoread = (int) availbytes;
+
+		thisfile = file->files[file->curFile];
+		if (file->curOffset != file->offsets[file->curFile])
+		{
+			if (FileSeek(thisfile, file->curOffset, SEEK_SET) != file->curOffset)
+				break;			/* seek failed, read nothing more */
+			file->offsets[file->curFile] = file->curOffset;
+		}
+		bytestoread = FileRead(thisfile, ptr + nread, bytestoread);
+		if (bytestoread <= 0)
+			break;
+		file->offsets[file->curFile] += bytestoread;
+		file->curOffset += bytestoread;
+		nread += bytestoread;
+	}
+
+	return nread;
+}
+
+/*
+ * BufFileWritePhysical
+ *
+ * Write size bytes at (curFile, curOffset) and advance curOffset past them.
+ * Unlike BufFileLoadBuffer, we must write everything even if it crosses a
+ * component-file boundary; so we need a loop.  Returns false if the write
+ * failed.
+ */
+static bool
+BufFileWritePhysical(BufFile *file, char *ptr, int size)
 {
 	int			wpos = 0;
 	int			bytestowrite;
 	File		thisfile;
 
-	/*
-	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
-	 * crosses a component-file boundary; so we need a loop.
-	 */
-	while (wpos < file->nbytes)
+	while (wpos < size)
 	{
 		/*
 		 * Advance to next component file if necessary and possible.
@@ -279,7 +511,7 @@ BufFileDumpBuffer(BufFile *file)
 		 * Enforce per-file size limit only for temp files, else just try to
 		 * write as much as asked...
 		 */
-		bytestowrite = file->nbytes - wpos;
+		bytestowrite = size - wpos;
 		if (file->isTemp)
 		{
 			off_t		availbytes = MAX_PHYSICAL_FILESIZE - file->curOffset;
@@ -295,39 +527,18 @@ BufFileDumpBuffer(BufFile *file)
 		if (file->curOffset != file->offsets[file->curFile])
 		{
 			if (FileSeek(thisfile, file->curOffset, SEEK_SET) != file->curOffset)
-				return;			/* seek failed, give up */
+				return false;	/* seek failed, give up */
 			file->offsets[file->curFile] = file->curOffset;
 		}
-		bytestowrite = FileWrite(thisfile, file->buffer + wpos, bytestowrite);
+		bytestowrite = FileWrite(thisfile, ptr + wpos, bytestowrite);
 		if (bytestowrite <= 0)
-			return;				/* failed to write */
+			return false;		/* failed to write */
 		file->offsets[file->curFile] += bytestowrite;
 		file->curOffset += bytestowrite;
 		wpos += bytestowrite;
-
-		pgBufferUsage.temp_blks_written++;
 	}
-	file->dirty = false;
 
-	/*
-	 * At this point, curOffset has been advanced to the end of the buffer,
-	 * ie, its original value + nbytes.  We need to make it point to the
-	 * logical file position, ie, original value + pos, in case that is less
-	 * (as could happen due to a small backwards seek in a dirty buffer!)
-	 */
-	file->curOffset -= (file->nbytes - file->pos);
-	if (file->curOffset < 0)	/* handle possible segment crossing */
-	{
-		file->curFile--;
-		Assert(file->curFile >= 0);
-		file->curOffset += MAX_PHYSICAL_FILESIZE;
-	}
-
-	/*
-	 * Now we can set the buffer empty without changing the logical position
-	 */
-	file->pos = 0;
-	file->nbytes = 0;
+	return true;
 }
 
 /*
@@ -353,7 +564,8 @@ BufFileRead(BufFile *file, void *ptr, size_t size)
 		if (file->pos >= file->nbytes)
 		{
 			/* Try to load more data into buffer. */
-			file->curOffset += file->pos;
+			if (!file->compressed)
+				file->curOffset += file->pos;
 			file->pos = 0;
 			file->nbytes = 0;
 			BufFileLoadBuffer(file);
@@ -402,6 +614,7 @@ BufFileWrite(BufFile *file, void *ptr, size_t size)
 			else
 			{
 				/* Hmm, went directly from reading to writing? */
+				Assert(!file->compressed);
 				file->curOffset += file->pos;
 				file->pos = 0;
 				file->nbytes = 0;
@@ -461,6 +674,20 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 	int			newFile;
 	off_t		newOffset;
 
+	/* A compressed file can only be rewound */
+	if (file->compressed)
+	{
+		if (whence != SEEK_SET || fileno != 0 || offset != 0)
+			elog(ERROR, "cannot seek in a compressed temporary file");
+		if (BufFileFlush(file) != 0)
+			return EOF;
+		file->curFile = 0;
+		file->curOffset = 0L;
+		file->pos = 0;
+		file->nbytes = 0;
+		return 0;
+	}
+
 	switch (whence)
 	{
 		case SEEK_SET:
@@ -544,6 +771,8 @@ BufFileSeek(BufFile *file, int fileno, off_t offset, int whence)
 void
 BufFileTell(BufFile *file, int *fileno, off_t *offset)
 {
+	if (file->compressed)
+		elog(ERROR, "cannot tell position in a compressed temporary file");
 	*fileno = file->curFile;
 	*offset = file->curOffset + file->pos;
 }
@@ -568,6 +797,27 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlock --- block-oriented prefetch
+ *
+ * Ask the kernel to start reading the n'th BLCKSZ-sized block of the file,
+ * which the caller expects to read soon.  The logical position is not
+ * moved.  Blocks not yet written out are silently ignored.
+ */
+void
+BufFilePrefetchBlock(BufFile *file, long blknum)
+{
+#ifdef USE_PREFETCH
+	int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+
+	Assert(!file->compressed);
+	if (blknum >= 0 && fileno < file->numFiles)
+		(void) FilePrefetch(file->files[fileno],
+							(off_t) (blknum % BUFFILE_SEG_SIZE) * BLCKSZ,
+							BLCKSZ);
+#endif   /* USE_PREFETCH */
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
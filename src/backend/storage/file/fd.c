@@ -53,6 +53,7 @@
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/pg_tablespace.h"
+#include "pgstat.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
@@ -91,6 +92,12 @@
  */
 int			max_files_per_process = 1000;
 
+/*
+ * GUC parameter: DIRECT_IO_* bits saying which files bypass the kernel's
+ * page cache.  Callers opening such files add PG_O_DIRECT themselves.
+ */
+int			direct_io = 0;
+
 /*
  * Maximum number of file descriptors to open for either VFD entries or
  * AllocateFile/AllocateDir operations.  This is initialized to a conservative
@@ -157,6 +164,13 @@ static Size SizeVfdCache = 0;
  */
 static int	nfile = 0;
 
+/*
+ * Counts of files closed to stay under max_safe_fds, and of those reopened
+ * on their next use; see GetVfdCacheStats.
+ */
+static int64 vfd_evictions = 0;
+static int64 vfd_reopens = 0;
+
 /* True if there are files to close/delete at end of transaction */
 static bool have_pending_fd_cleanup = false;
 
@@ -412,6 +426,31 @@ count_usable_fds(int max_to_probe, int *usable_fds, int *already_open)
 #endif   /* RLIMIT_NOFILE */
 	if (getrlimit_status != 0)
 		ereport(WARNING, (errmsg("getrlimit failed: %m")));
+
+	/*
+	 * If the soft limit is lower than we are asked to probe for, raise it
+	 * as far as the hard limit allows.  The default soft limit on many
+	 * systems is far below both the hard limit and what a database with
+	 * many relations needs to avoid closing and reopening files all the
+	 * time.  Child processes inherit the raised limit.
+	 */
+	if (getrlimit_status == 0 && rlim.rlim_cur != RLIM_INFINITY &&
+		rlim.rlim_cur < (rlim_t) max_to_probe)
+	{
+		struct rlimit newlim = rlim;
+
+		newlim.rlim_cur = (rlim_t) max_to_probe;
+		if (rlim.rlim_max != RLIM_INFINITY && newlim.rlim_cur > rlim.rlim_max)
+			newlim.rlim_cur = rlim.rlim_max;
+#ifdef RLIMIT_NOFILE
+		if (newlim.rlim_cur > rlim.rlim_cur &&
+			setrlimit(RLIMIT_NOFILE, &newlim) == 0)
+#else
+		if (newlim.rlim_cur > rlim.rlim_cur &&
+			setrlimit(RLIMIT_OFILE, &newlim) == 0)
+#endif
+			rlim = newlim;
+	}
 #endif   /* HAVE_GETRLIMIT */
 
 	/* dup until failure or probe limit reached */
@@ -467,6 +506,18 @@ count_usable_fds(int max_to_probe, int *usable_fds, int *already_open)
 	*already_open = highestfd + 1 - used;
 }
 
+/*
+ * GetVfdCacheStats
+ *		Report how often this backend has had to close a virtual file to
+ *		stay within max_safe_fds, and to reopen one on its next use.
+ */
+void
+GetVfdCacheStats(int64 *evictions, int64 *reopens)
+{
+	*evictions = vfd_evictions;
+	*reopens = vfd_reopens;
+}
+
 /*
  * set_max_safe_fds
  *		Determine number of filedescriptors that fd.c is allowed to use
@@ -609,9 +660,16 @@ LruDelete(File file)
 	/* delete the vfd record from the LRU ring */
 	Delete(file);
 
-	/* save the seek position */
-	vfdP->seekPos = lseek(vfdP->fd, (off_t) 0, SEEK_CUR);
-	Assert(vfdP->seekPos != (off_t) -1);
+	/*
+	 * Save the seek position.  We normally know it already, since every
+	 * read, write and seek keeps seekPos up to date, so only ask the kernel
+	 * if an earlier failure left it unknown.
+	 */
+	if (vfdP->seekPos == FileUnknownPos)
+	{
+		vfdP->seekPos = lseek(vfdP->fd, (off_t) 0, SEEK_CUR);
+		Assert(vfdP->seekPos != (off_t) -1);
+	}
 
 	/* close the file */
 	if (close(vfdP->fd))
@@ -679,6 +737,7 @@ LruInsert(File file)
 		{
 			DO_DB(elog(LOG, "RE_OPEN SUCCESS"));
 			++nfile;
+			vfd_reopens++;
 		}
 
 		/* seek to the right position */
@@ -713,6 +772,7 @@ ReleaseLruFile(void)
 		 */
 		Assert(VfdCache[0].lruMoreRecently != 0);
 		LruDelete(VfdCache[0].lruMoreRecently);
+		vfd_evictions++;
 		return true;			/* freed a file */
 	}
 	return false;				/* no files available to free */
@@ -1084,10 +1144,14 @@ FileClose(File file)
 	}
 
 	/*
-	 * Delete the file if it was temporary, and make a log entry if wanted
+	 * Delete the file if it was temporary, count it in the statistics, and
+	 * make a log entry if wanted
 	 */
 	if (vfdP->fdstate & FD_TEMPORARY)
 	{
+		struct stat filestats;
+		int			stat_errno;
+
 		/*
 		 * If we get an error, as could happen within the ereport/elog calls,
 		 * we'll come right back here during transaction abort.  Reset the
@@ -1101,23 +1165,22 @@ FileClose(File file)
 		temporary_files_size -= vfdP->fileSize;
 		vfdP->fileSize = 0;
 
-		if (log_temp_files >= 0)
-		{
-			struct stat filestats;
-			int			stat_errno;
+		/* first try the stat() */
+		if (stat(vfdP->fileName, &filestats))
+			stat_errno = errno;
+		else
+			stat_errno = 0;
 
-			/* first try the stat() */
-			if (stat(vfdP->fileName, &filestats))
-				stat_errno = errno;
-			else
-				stat_errno = 0;
+		/* in any case do the unlink */
+		if (unlink(vfdP->fileName))
+			elog(LOG, "could not unlink file \"%s\": %m", vfdP->fileName);
 
-			/* in any case do the unlink */
-			if (unlink(vfdP->fileName))
-				elog(LOG, "could not unlink file \"%s\": %m", vfdP->fileName);
+		/* and last report the stat results */
+		if (stat_errno == 0)
+		{
+			pgstat_report_tempfile(filestats.st_size);
 
-			/* and last report the stat results */
-			if (stat_errno == 0)
+			if (log_temp_files >= 0)
 			{
 				if ((filestats.st_size / 1024) >= log_temp_files)
 					ereport(LOG,
@@ -1125,17 +1188,11 @@ FileClose(File file)
 									vfdP->fileName,
 									(unsigned long) filestats.st_size)));
 			}
-			else
-			{
-				errno = stat_errno;
-				elog(LOG, "could not stat file \"%s\": %m", vfdP->fileName);
-			}
 		}
 		else
 		{
-			/* easy case, just do the unlink */
-			if (unlink(vfdP->fileName))
-				elog(LOG, "could not unlink file \"%s\": %m", vfdP->fileName);
+			errno = stat_errno;
+			elog(LOG, "could not stat file \"%s\": %m", vfdP->fileName);
 		}
 	}
 
@@ -1335,6 +1392,181 @@ retry:
 	return returnCode;
 }
 
+#ifdef WIN32
+/*
+ * Emulate readv(2) and writev(2) with a loop of plain reads/writes.  This
+ * loses the syscall saving, but keeps FileReadV/FileWriteV callers portable.
+ */
+static int
+pg_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	int			total = 0;
+	int			i;
+
+	for (i = 0; i < iovcnt; i++)
+	{
+		int			nread = read(fd, iov[i].iov_base, iov[i].iov_len);
+
+		if (nread < 0)
+			return (total > 0) ? total : -1;
+		total += nread;
+		if (nread < (int) iov[i].iov_len)
+			break;
+	}
+	return total;
+}
+
+static int
+pg_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	int			total = 0;
+	int			i;
+
+	for (i = 0; i < iovcnt; i++)
+	{
+		int			nwritten = write(fd, iov[i].iov_base, iov[i].iov_len);
+
+		if (nwritten < 0)
+			return (total > 0) ? total : -1;
+		total += nwritten;
+		if (nwritten < (int) iov[i].iov_len)
+			break;
+	}
+	return total;
+}
+#else
+#define pg_readv(fd, iov, iovcnt)	readv(fd, iov, iovcnt)
+#define pg_writev(fd, iov, iovcnt)	writev(fd, iov, iovcnt)
+#endif
+
+/*
+ * FileReadV - read into several buffers with one system call
+ *
+ * Behaves like FileRead applied to the concatenation of the iovec buffers,
+ * starting at the current seek position.  A short read is possible at EOF.
+ */
+int
+FileReadV(File file, const struct iovec *iov, int iovcnt)
+{
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+	Assert(iovcnt > 0 && iovcnt <= PG_IOV_MAX);
+
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) VfdCache[file].seekPos,
+			   iovcnt));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	returnCode = pg_readv(VfdCache[file].fd, iov, iovcnt);
+
+	if (returnCode >= 0)
+		VfdCache[file].seekPos += returnCode;
+	else
+	{
+		/*
+		 * See comments in FileRead()
+		 */
+#ifdef WIN32
+		DWORD		error = GetLastError();
+
+		switch (error)
+		{
+			case ERROR_NO_SYSTEM_RESOURCES:
+				pg_usleep(1000L);
+				errno = EINTR;
+				break;
+			default:
+				_dosmaperr(error);
+				break;
+		}
+#endif
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+
+		/* Trouble, so assume we don't know the file position anymore */
+		VfdCache[file].seekPos = FileUnknownPos;
+	}
+
+	return returnCode;
+}
+
+/*
+ * FileWriteV - write several buffers with one system call
+ *
+ * Behaves like FileWrite applied to the concatenation of the iovec buffers.
+ * This is meant for relation data files; it does not enforce
+ * temp_file_limit, so it must not be used on temporary files.
+ */
+int
+FileWriteV(File file, const struct iovec *iov, int iovcnt)
+{
+	int			returnCode;
+	int			amount = 0;
+	int			i;
+
+	Assert(FileIsValid(file));
+	Assert(iovcnt > 0 && iovcnt <= PG_IOV_MAX);
+	Assert(!(VfdCache[file].fdstate & FD_TEMPORARY));
+
+	DO_DB(elog(LOG, "FileWriteV: %d (%s) " INT64_FORMAT " %d",
+			   file, VfdCache[file].fileName,
+			   (int64) VfdCache[file].seekPos,
+			   iovcnt));
+
+	for (i = 0; i < iovcnt; i++)
+		amount += iov[i].iov_len;
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	errno = 0;
+	returnCode = pg_writev(VfdCache[file].fd, iov, iovcnt);
+
+	/* if write didn't set errno, assume problem is no disk space */
+	if (returnCode != amount && errno == 0)
+		errno = ENOSPC;
+
+	if (returnCode >= 0)
+		VfdCache[file].seekPos += returnCode;
+	else
+	{
+		/*
+		 * See comments in FileRead()
+		 */
+#ifdef WIN32
+		DWORD		error = GetLastError();
+
+		switch (error)
+		{
+			case ERROR_NO_SYSTEM_RESOURCES:
+				pg_usleep(1000L);
+				errno = EINTR;
+				break;
+			default:
+				_dosmaperr(error);
+				break;
+		}
+#endif
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+
+		/* Trouble, so assume we don't know the file position anymore */
+		VfdCache[file].seekPos = FileUnknownPos;
+	}
+
+	return returnCode;
+}
+
 int
 FileSync(File file)
 {
@@ -0,0 +1,499 @@
+/*-------------------------------------------------------------------------
+ *
+ * dsm.c
+ *	  manage dynamic shared memory segments
+ *
+ * The main shared memory segment is sized once at postmaster start, so it
+ * can't hold data whose size isn't known until a query runs, such as the
+ * state that cooperating processes exchange during a parallel operation.
+ * This module lets any backend create additional segments at runtime, and
+ * pass a handle to other processes so that they can attach to them.
+ *
+ * The segments are SysV shared memory segments created with IPC_PRIVATE,
+ * and the handle is the segment's ID.  A control array in the main shared
+ * memory segment keeps a reference count for every segment; the segment is
+ * removed when the last process detaches from it.  A process detaches from
+ * all of its segments when it exits.  If a backend crashes, the postmaster
+ * removes all the segments in the control array when it reinitializes
+ * shared memory, and again when it shuts down.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/ipc/dsm.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/file.h>
+#ifdef HAVE_SYS_IPC_H
+#include <sys/ipc.h>
+#endif
+#ifdef HAVE_SYS_SHM_H
+#include <sys/shm.h>
+#endif
+
+#include "miscadmin.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/memutils.h"
+
+
+#define IPCProtection	(0600)	/* access/modify by user only */
+
+/* Room for this many segments besides two for every backend */
+#define PG_DYNSHMEM_FIXED_SLOTS			64
+#define PG_DYNSHMEM_SLOTS_PER_BACKEND	2
+
+/* Backend-local list of callbacks to run when detaching a segment */
+typedef struct dsm_callback_item
+{
+	on_dsm_detach_callback function;
+	Datum		arg;
+	struct dsm_callback_item *next;
+} dsm_callback_item;
+
+/* Backend-local state for a segment this process has mapped */
+struct dsm_segment
+{
+	dsm_segment *next;			/* next segment mapped by this process */
+	dsm_handle	handle;			/* segment identifier */
+	uint32		control_slot;	/* slot in the control array */
+	void	   *mapped_address;	/* where it's mapped in this process */
+	Size		mapped_size;	/* size of the mapping */
+	dsm_callback_item *callbacks;	/* run when detaching, latest first */
+};
+
+/* Shared-memory state for a segment; refcnt 0 means the slot is free */
+typedef struct dsm_control_item
+{
+	dsm_handle	handle;
+	uint32		refcnt;			/* number of processes attached */
+} dsm_control_item;
+
+/* Layout of the control array, protected by DynamicSharedMemoryControlLock */
+typedef struct dsm_control_header
+{
+	uint32		nitems;			/* slots in use or used before */
+	uint32		maxitems;		/* total number of slots */
+	dsm_control_item item[1];	/* VARIABLE LENGTH ARRAY */
+} dsm_control_header;
+
+static dsm_control_header *dsm_control = NULL;
+
+/* Segments mapped by this process */
+static dsm_segment *dsm_segment_list = NULL;
+static bool dsm_exit_callback_registered = false;
+
+static uint32 dsm_control_maxitems(void);
+static dsm_segment *dsm_create_descriptor(void);
+static void dsm_remove_segment(dsm_handle handle);
+static void dsm_postmaster_shutdown(int code, Datum arg);
+static void dsm_backend_shutdown(int code, Datum arg);
+
+
+static uint32
+dsm_control_maxitems(void)
+{
+	return PG_DYNSHMEM_FIXED_SLOTS +
+		PG_DYNSHMEM_SLOTS_PER_BACKEND * MaxBackends;
+}
+
+/*
+ * DsmShmemSize
+ *		Compute space needed for the dynamic shared memory control array
+ */
+Size
+DsmShmemSize(void)
+{
+	Size		size;
+
+	size = offsetof(dsm_control_header, item);
+	size = add_size(size, mul_size(dsm_control_maxitems(),
+								   sizeof(dsm_control_item)));
+	return size;
+}
+
+/*
+ * DsmShmemInit
+ *		Allocate and initialize the control array
+ *
+ * In the postmaster, or a standalone backend, this also arranges for any
+ * segments left over when shared memory is reinitialized or the server
+ * shuts down to be removed.
+ */
+void
+DsmShmemInit(void)
+{
+	bool		found;
+
+	dsm_control = (dsm_control_header *)
+		ShmemInitStruct("Dynamic Shared Memory Control", DsmShmemSize(),
+						&found);
+
+	if (!IsUnderPostmaster)
+	{
+		Assert(!found);
+		dsm_control->nitems = 0;
+		dsm_control->maxitems = dsm_control_maxitems();
+		on_shmem_exit(dsm_postmaster_shutdown, (Datum) 0);
+	}
+}
+
+/*
+ * dsm_create
+ *		Create a new dynamic shared memory segment of the given size
+ *
+ * The segment is mapped into this process, and the new mapping is returned.
+ * Other processes can attach to it using the handle returned by
+ * dsm_segment_handle.  The segment's contents are zeroed.
+ */
+dsm_segment *
+dsm_create(Size size)
+{
+#ifdef HAVE_SYS_SHM_H
+	dsm_segment *seg;
+	int			shmid;
+	void	   *address;
+	uint32		i;
+	uint32		nitems;
+
+	/* Allocate local state first, so that we can't fail after shmget */
+	seg = dsm_create_descriptor();
+
+	shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | IPC_EXCL | IPCProtection);
+	if (shmid < 0)
+	{
+		pfree(seg);
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create dynamic shared memory segment: %m"),
+				 errdetail("Failed system call was shmget(key=%lu, size=%lu, 0%o).",
+						   (unsigned long) IPC_PRIVATE, (unsigned long) size,
+						   IPC_CREAT | IPC_EXCL | IPCProtection),
+				 (errno == ENOMEM || errno == ENOSPC || errno == EINVAL) ?
+				 errhint("The kernel's limits on SysV shared memory (SHMMAX, "
+						 "SHMALL or SHMMNI) may be too low.") : 0));
+	}
+
+	address = shmat(shmid, NULL, 0);
+	if (address == (void *) -1)
+	{
+		int			save_errno = errno;
+
+		shmctl(shmid, IPC_RMID, NULL);
+		pfree(seg);
+		errno = save_errno;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not attach to dynamic shared memory segment: %m")));
+	}
+
+	/* Enter the segment into the control array */
+	LWLockAcquire(DynamicSharedMemoryControlLock, LW_EXCLUSIVE);
+	nitems = dsm_control->nitems;
+	for (i = 0; i < nitems; i++)
+	{
+		if (dsm_control->item[i].refcnt == 0)
+			break;
+	}
+	if (i == nitems)
+	{
+		if (nitems >= dsm_control->maxitems)
+		{
+			LWLockRelease(DynamicSharedMemoryControlLock);
+			shmdt(address);
+			shmctl(shmid, IPC_RMID, NULL);
+			pfree(seg);
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("too many dynamic shared memory segments")));
+		}
+		dsm_control->nitems++;
+	}
+	dsm_control->item[i].handle = (dsm_handle) shmid;
+	dsm_control->item[i].refcnt = 1;
+	LWLockRelease(DynamicSharedMemoryControlLock);
+
+	seg->handle = (dsm_handle) shmid;
+	seg->control_slot = i;
+	seg->mapped_address = address;
+	seg->mapped_size = size;
+
+	seg->next = dsm_segment_list;
+	dsm_segment_list = seg;
+
+	return seg;
+#else
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("dynamic shared memory is not supported on this platform")));
+	return NULL;				/* keep compiler quiet */
+#endif
+}
+
+/*
+ * dsm_attach
+ *		Attach to the segment with the given handle
+ *
+ * Returns NULL if the segment doesn't exist any more, which can happen if
+ * every process that was attached to it has detached already.
+ */
+dsm_segment *
+dsm_attach(dsm_handle h)
+{
+#ifdef HAVE_SYS_SHM_H
+	dsm_segment *seg;
+	dsm_segment *other;
+	struct shmid_ds shmStat;
+	void	   *address;
+	uint32		i;
+	uint32		nitems;
+
+	/* Attaching twice would confuse the reference count */
+	for (other = dsm_segment_list; other != NULL; other = other->next)
+	{
+		if (other->handle == h)
+			elog(ERROR, "can't attach the same dynamic shared memory segment more than once");
+	}
+
+	seg = dsm_create_descriptor();
+
+	/*
+	 * Take a reference first, so that the segment can't be removed while we
+	 * map it.
+	 */
+	LWLockAcquire(DynamicSharedMemoryControlLock, LW_EXCLUSIVE);
+	nitems = dsm_control->nitems;
+	for (i = 0; i < nitems; i++)
+	{
+		if (dsm_control->item[i].refcnt > 0 &&
+			dsm_control->item[i].handle == h)
+		{
+			dsm_control->item[i].refcnt++;
+			break;
+		}
+	}
+	LWLockRelease(DynamicSharedMemoryControlLock);
+
+	if (i == nitems)
+	{
+		pfree(seg);
+		return NULL;
+	}
+
+	seg->handle = h;
+	seg->control_slot = i;
+	seg->next = dsm_segment_list;
+	dsm_segment_list = seg;
+
+	/* If we fail from here on, dsm_detach gives the reference back */
+	address = shmat((int) h, NULL, 0);
+	if (address == (void *) -1)
+	{
+		int			save_errno = errno;
+
+		dsm_detach(seg);
+		errno = save_errno;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not attach to dynamic shared memory segment: %m")));
+	}
+	seg->mapped_address = address;
+
+	if (shmctl((int) h, IPC_STAT, &shmStat) < 0)
+	{
+		int			save_errno = errno;
+
+		dsm_detach(seg);
+		errno = save_errno;
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat dynamic shared memory segment: %m")));
+	}
+	seg->mapped_size = shmStat.shm_segsz;
+
+	return seg;
+#else
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("dynamic shared memory is not supported on this platform")));
+	return NULL;				/* keep compiler quiet */
+#endif
+}
+
+/*
+ * dsm_detach
+ *		Detach from a segment, removing it if no other process is attached
+ *
+ * The on_dsm_detach callbacks run first, latest registered first, while the
+ * segment is still mapped.
+ */
+void
+dsm_detach(dsm_segment *seg)
+{
+	dsm_segment **prev;
+	bool		remove = false;
+
+	while (seg->callbacks != NULL)
+	{
+		dsm_callback_item *cb = seg->callbacks;
+
+		/* unlink first, so that an error doesn't run it again */
+		seg->callbacks = cb->next;
+		(*cb->function) (seg, cb->arg);
+		pfree(cb);
+	}
+
+#ifdef HAVE_SYS_SHM_H
+	if (seg->mapped_address != NULL)
+	{
+		if (shmdt(seg->mapped_address) < 0)
+			elog(LOG, "shmdt(%p) failed: %m", seg->mapped_address);
+		seg->mapped_address = NULL;
+		seg->mapped_size = 0;
+	}
+#endif
+
+	LWLockAcquire(DynamicSharedMemoryControlLock, LW_EXCLUSIVE);
+	Assert(dsm_control->item[seg->control_slot].handle == seg->handle);
+	Assert(dsm_control->item[seg->control_slot].refcnt > 0);
+	if (--dsm_control->item[seg->control_slot].refcnt == 0)
+		remove = true;
+	LWLockRelease(DynamicSharedMemoryControlLock);
+
+	if (remove)
+		dsm_remove_segment(seg->handle);
+
+	for (prev = &dsm_segment_list; *prev != NULL; prev = &(*prev)->next)
+	{
+		if (*prev == seg)
+		{
+			*prev = seg->next;
+			break;
+		}
+	}
+	pfree(seg);
+}
+
+/*
+ * dsm_segment_address
+ *		Get the address at which the segment is mapped in this process
+ */
+void *
+dsm_segment_address(dsm_segment *seg)
+{
+	return seg->mapped_address;
+}
+
+/*
+ * dsm_segment_map_length
+ *		Get the size of the segment's mapping
+ */
+Size
+dsm_segment_map_length(dsm_segment *seg)
+{
+	return seg->mapped_size;
+}
+
+/*
+ * dsm_segment_handle
+ *		Get the handle other processes can use to attach to the segment
+ */
+dsm_handle
+dsm_segment_handle(dsm_segment *seg)
+{
+	return seg->handle;
+}
+
+/*
+ * on_dsm_detach
+ *		Register a function to be called when this process detaches from
+ *		the segment, whether by dsm_detach or at exit
+ */
+void
+on_dsm_detach(dsm_segment *seg, on_dsm_detach_callback function, Datum arg)
+{
+	dsm_callback_item *cb;
+
+	cb = MemoryContextAlloc(TopMemoryContext, sizeof(dsm_callback_item));
+	cb->function = function;
+	cb->arg = arg;
+	cb->next = seg->callbacks;
+	seg->callbacks = cb;
+}
+
+/*
+ * Allocate the local state for a new mapping.  Mappings aren't tied to a
+ * transaction, so this lives in TopMemoryContext.
+ */
+static dsm_segment *
+dsm_create_descriptor(void)
+{
+	dsm_segment *seg;
+
+	if (!dsm_exit_callback_registered)
+	{
+		on_shmem_exit(dsm_backend_shutdown, (Datum) 0);
+		dsm_exit_callback_registered = true;
+	}
+
+	seg = MemoryContextAllocZero(TopMemoryContext, sizeof(dsm_segment));
+	return seg;
+}
+
+/*
+ * Remove a segment from the system.  Processes still attached to it keep
+ * their mapping; no new process can attach.
+ */
+static void
+dsm_remove_segment(dsm_handle handle)
+{
+#ifdef HAVE_SYS_SHM_H
+	if (shmctl((int) handle, IPC_RMID, NULL) < 0)
+		elog(LOG, "shmctl(%d, %d, 0) failed: %m", (int) handle, IPC_RMID);
+#endif
+}
+
+/*
+ * on_shmem_exit callback for the postmaster: remove any segments that
+ * backends left behind, which can only happen if one of them crashed.
+ */
+static void
+dsm_postmaster_shutdown(int code, Datum arg)
+{
+	uint32		nitems;
+	uint32		i;
+
+	/* The control array might have been clobbered by the crash */
+	nitems = dsm_control->nitems;
+	if (nitems > dsm_control->maxitems)
+		nitems = dsm_control->maxitems;
+
+	for (i = 0; i < nitems; i++)
+	{
+		if (dsm_control->item[i].refcnt == 0)
+			continue;
+		elog(DEBUG2, "removing dynamic shared memory segment %u",
+			 dsm_control->item[i].handle);
+		dsm_remove_segment(dsm_control->item[i].handle);
+		dsm_control->item[i].refcnt = 0;
+	}
+	dsm_control->nitems = 0;
+}
+
+/*
+ * on_shmem_exit callback for other processes: detach from every segment
+ * still mapped.
+ */
+static void
+dsm_backend_shutdown(int code, Datum arg)
+{
+	while (dsm_segment_list != NULL)
+		dsm_detach(dsm_segment_list);
+}
@@ -24,11 +24,13 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
@@ -37,6 +39,8 @@
 #include "storage/procsignal.h"
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
+#include "utils/catcache.h"
+#include "utils/plancache.h"
 
 
 shmem_startup_hook_type shmem_startup_hook = NULL;
@@ -116,19 +120,22 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		size = add_size(size, LWLockShmemSize());
 		size = add_size(size, ProcArrayShmemSize());
 		size = add_size(size, BackendStatusShmemSize());
+		size = add_size(size, StatsShmemSize());
 		size = add_size(size, SInvalShmemSize());
 		size = add_size(size, PMSignalShmemSize());
 		size = add_size(size, ProcSignalShmemSize());
 		size = add_size(size, BgWriterShmemSize());
 		size = add_size(size, AutoVacuumShmemSize());
+		size = add_size(size, BackgroundWorkerShmemSize());
 		size = add_size(size, WalSndShmemSize());
 		size = add_size(size, WalRcvShmemSize());
 		size = add_size(size, BTreeShmemSize());
 		size = add_size(size, SyncScanShmemSize());
 		size = add_size(size, AsyncShmemSize());
-#ifdef EXEC_BACKEND
+		size = add_size(size, PlanCacheShmemSize());
+		size = add_size(size, SharedCatCacheShmemSize());
+		size = add_size(size, DsmShmemSize());
 		size = add_size(size, ShmemBackendArraySize());
-#endif
 
 		/* freeze the addin request size and include it */
 		addin_request_allowed = false;
@@ -212,6 +219,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		InitProcGlobal();
 	CreateSharedProcArray();
 	CreateSharedBackendStatus();
+	CreateSharedStats();
 	TwoPhaseShmemInit();
 
 	/*
@@ -226,6 +234,7 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	ProcSignalShmemInit();
 	BgWriterShmemInit();
 	AutoVacuumShmemInit();
+	BackgroundWorkerShmemInit();
 	WalSndShmemInit();
 	WalRcvShmemInit();
 
@@ -235,15 +244,15 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	BTreeShmemInit();
 	SyncScanShmemInit();
 	AsyncShmemInit();
-
-#ifdef EXEC_BACKEND
+	PlanCacheShmemInit();
+	SharedCatCacheShmemInit();
+	DsmShmemInit();
 
 	/*
-	 * Alloc the win32 shared backend array
+	 * Alloc the shared backend array
 	 */
 	if (!IsUnderPostmaster)
 		ShmemBackendArrayAllocation();
-#endif
 
 	/*
 	 * Now give loadable modules a chance to set up their shmem allocations
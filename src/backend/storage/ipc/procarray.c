@@ -55,6 +55,7 @@
 #include "storage/spin.h"
 #include "utils/builtins.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
 
 
 /* Our shared memory area */
@@ -81,6 +82,20 @@ typedef struct ProcArrayStruct
 	 */
 	TransactionId lastOverflowedXid;
 
+	/*
+	 * The XIDs of the last hot standby snapshot, as a dense array in
+	 * KnownAssignedXidsSnapshot[], so that other backends can copy them
+	 * instead of scanning KnownAssignedXids again.  The copy is valid while
+	 * xactCompletionCount equals cachedSnapshotCompletionCount (0 if none).
+	 * These fields are protected by known_assigned_xids_lck; see
+	 * KnownAssignedXidsGetSnapshot.
+	 */
+	uint64		cachedSnapshotCompletionCount;
+	bool		cachedSnapshotBuilding;		/* someone is filling the copy */
+	int			cachedSnapshotCount;		/* # of XIDs in the copy */
+	TransactionId cachedSnapshotXmin;
+	bool		cachedSnapshotOverflowed;
+
 	/*
 	 * We declare pgprocnos[] as 1 entry because C wants a fixed-size array, but
 	 * actually it is maxProcs entries long.
@@ -98,6 +113,7 @@ static PGXACT *allPgXact;
  */
 static TransactionId *KnownAssignedXids;
 static bool *KnownAssignedXidsValid;
+static TransactionId *KnownAssignedXidsSnapshot;
 static TransactionId latestObservedXid = InvalidTransactionId;
 
 /*
@@ -144,8 +160,20 @@ static void DisplayXidCache(void);
 #define xc_slow_answer_inc()		((void) 0)
 #endif   /* XIDCACHE_DEBUG */
 
+/*
+ * Reasons for calling KnownAssignedXidsCompress, which decide how eagerly
+ * it compresses; see there.
+ */
+typedef enum KAXCompressReason
+{
+	KAX_NO_SPACE,				/* need to free up space at array end */
+	KAX_PRUNE,					/* we just pruned old entries */
+	KAX_TRANSACTION_END,		/* we just removed the XIDs of a transaction */
+	KAX_STARTUP_PROCESS_IDLE	/* startup process is about to sleep */
+} KAXCompressReason;
+
 /* Primitives for KnownAssignedXids array handling for standby */
-static void KnownAssignedXidsCompress(bool force);
+static void KnownAssignedXidsCompress(KAXCompressReason reason, bool haveLock);
 static void KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
 					 bool exclusive_lock);
 static bool KnownAssignedXidsSearch(TransactionId xid, bool remove);
@@ -158,6 +186,10 @@ static int	KnownAssignedXidsGet(TransactionId *xarray, TransactionId xmax);
 static int KnownAssignedXidsGetAndSetXmin(TransactionId *xarray,
 							   TransactionId *xmin,
 							   TransactionId xmax);
+static int KnownAssignedXidsGetSnapshot(TransactionId *xarray,
+							 TransactionId *xmin,
+							 TransactionId xmax,
+							 bool *overflowed);
 static TransactionId KnownAssignedXidsGetOldestXmin(void);
 static void KnownAssignedXidsDisplay(int trace_level);
 
@@ -198,6 +230,9 @@ ProcArrayShmemSize(void)
 								 TOTAL_MAX_CACHED_SUBXIDS));
 		size = add_size(size,
 						mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS));
+		size = add_size(size,
+						mul_size(sizeof(TransactionId),
+								 TOTAL_MAX_CACHED_SUBXIDS));
 	}
 
 	return size;
@@ -232,6 +267,11 @@ CreateSharedProcArray(void)
 		procArray->headKnownAssignedXids = 0;
 		SpinLockInit(&procArray->known_assigned_xids_lck);
 		procArray->lastOverflowedXid = InvalidTransactionId;
+		procArray->cachedSnapshotCompletionCount = 0;
+		procArray->cachedSnapshotBuilding = false;
+
+		/* 0 is reserved to mean "never computed" in snapshots */
+		ShmemVariableCache->xactCompletionCount = 1;
 	}
 
 	allProcs = ProcGlobal->allProcs;
@@ -249,6 +289,11 @@ CreateSharedProcArray(void)
 			ShmemInitStruct("KnownAssignedXidsValid",
 							mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS),
 							&found);
+		KnownAssignedXidsSnapshot = (TransactionId *)
+			ShmemInitStruct("KnownAssignedXidsSnapshot",
+							mul_size(sizeof(TransactionId),
+									 TOTAL_MAX_CACHED_SUBXIDS),
+							&found);
 	}
 }
 
@@ -335,6 +380,9 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
+
+		/* Invalidate cached snapshots */
+		ShmemVariableCache->xactCompletionCount++;
 	}
 	else
 	{
@@ -410,6 +458,9 @@ ProcArrayEndTransaction(PGPROC *proc, TransactionId latestXid)
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
 
+		/* Invalidate cached snapshots */
+		ShmemVariableCache->xactCompletionCount++;
+
 		LWLockRelease(ProcArrayLock);
 	}
 	else
@@ -448,11 +499,15 @@ ProcArrayClearTransaction(PGPROC *proc)
 	PGXACT *pgxact = &allPgXact[proc->pgprocno];
 
 	/*
-	 * We can skip locking ProcArrayLock here, because this action does not
-	 * actually change anyone's view of the set of running XIDs: our entry is
-	 * duplicate with the gxact that has already been inserted into the
-	 * ProcArray.
+	 * This action does not actually change anyone's view of the set of
+	 * running XIDs: our entry is duplicate with the gxact that has already
+	 * been inserted into the ProcArray.  But GetSnapshotData leaves our own
+	 * XID out of our snapshots, so a snapshot we computed earlier must not
+	 * be reused once the XID belongs to the gxact instead.  Take the lock to
+	 * bump the completion count for that.
 	 */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+
 	pgxact->xid = InvalidTransactionId;
 	proc->lxid = InvalidLocalTransactionId;
 	pgxact->xmin = InvalidTransactionId;
@@ -465,6 +520,10 @@ ProcArrayClearTransaction(PGPROC *proc)
 	/* Clear the subtransaction-XID cache too */
 	pgxact->nxids = 0;
 	pgxact->overflowed = false;
+
+	ShmemVariableCache->xactCompletionCount++;
+
+	LWLockRelease(ProcArrayLock);
 }
 
 /*
@@ -669,6 +728,9 @@ ProcArrayApplyRecoveryInfo(RunningTransactions running)
 	Assert(TransactionIdIsNormal(ShmemVariableCache->latestCompletedXid));
 	Assert(TransactionIdIsValid(ShmemVariableCache->nextXid));
 
+	/* Invalidate cached snapshots */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 
 	KnownAssignedXidsDisplay(trace_recovery(DEBUG3));
@@ -737,6 +799,9 @@ ProcArrayApplyXidAssignment(TransactionId topxid,
 	if (TransactionIdPrecedes(procArray->lastOverflowedXid, max_xid))
 		procArray->lastOverflowedXid = max_xid;
 
+	/* Invalidate cached snapshots, which may now have overflowed */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -1197,6 +1262,42 @@ GetMaxSnapshotSubxidCount(void)
 	return TOTAL_MAX_CACHED_SUBXIDS;
 }
 
+/*
+ * GetSnapshotDataReuse -- helper for GetSnapshotData
+ *
+ * The XID arrays of a snapshot only change when a transaction that has an
+ * XID completes: XIDs assigned later are >= xmax, and are left out of the
+ * snapshot anyway.  Each such event bumps xactCompletionCount, so if the
+ * counter still has the value it had when the given snapshot was computed,
+ * computing it again would produce the same contents.  In that case, just
+ * advertise our xmin, if not already done, and return TRUE.
+ *
+ * Caller must hold ProcArrayLock.
+ */
+static bool
+GetSnapshotDataReuse(Snapshot snapshot)
+{
+	if (snapshot->snapXactCompletionCount == 0 ||
+		snapshot->snapXactCompletionCount !=
+		ShmemVariableCache->xactCompletionCount)
+		return false;
+
+	/* A snapshot computed during recovery has a different layout */
+	if (snapshot->takenDuringRecovery != RecoveryInProgress())
+		return false;
+
+	/*
+	 * With no transactions completed since, every XID that was running when
+	 * the snapshot was computed is still running, so nobody can have
+	 * computed an OldestXmin beyond the snapshot's xmin.  That makes it safe
+	 * to advertise it as our xmin, just as if we had computed it afresh.
+	 */
+	if (!TransactionIdIsValid(MyPgXact->xmin))
+		MyPgXact->xmin = TransactionXmin = snapshot->xmin;
+
+	return true;
+}
+
 /*
  * GetSnapshotData -- returns information about running transactions.
  *
@@ -1226,6 +1327,14 @@ GetMaxSnapshotSubxidCount(void)
  *		RecentGlobalXmin: the global xmin (oldest TransactionXmin across all
  *			running transactions, except those running LAZY VACUUM).  This is
  *			the same computation done by GetOldestXmin(true, true).
+ *			It is not recomputed when a snapshot is reused (see below).
+ *
+ * If no transaction has completed since the arrays of the passed-in snapshot
+ * were filled in, they are reused as is, instead of scanning the procarray
+ * again; see GetSnapshotDataReuse.  That saves a lot of work in read-mostly
+ * workloads with many connections.  In hot standby, the XIDs are moreover
+ * shared between backends until the startup process replays the next
+ * transaction end; see KnownAssignedXidsGetSnapshot.
  *
  * Note: this function should probably not be called with an argument that's
  * not statically allocated (see xip allocation below).
@@ -1282,6 +1391,24 @@ GetSnapshotData(Snapshot snapshot)
 	 */
 	LWLockAcquire(ProcArrayLock, LW_SHARED);
 
+	if (GetSnapshotDataReuse(snapshot))
+	{
+		LWLockRelease(ProcArrayLock);
+
+		/*
+		 * RecentGlobalXmin is left alone.  The value computed along with the
+		 * snapshot is perhaps older than necessary now, but still valid.
+		 */
+		RecentXmin = snapshot->xmin;
+
+		snapshot->curcid = GetCurrentCommandId(false);
+		snapshot->active_count = 0;
+		snapshot->regd_count = 0;
+		snapshot->copied = false;
+
+		return snapshot;
+	}
+
 	/* xmax is always latestCompletedXid + 1 */
 	xmax = ShmemVariableCache->latestCompletedXid;
 	Assert(TransactionIdIsNormal(xmax));
@@ -1412,15 +1539,15 @@ GetSnapshotData(Snapshot snapshot)
 		 * depending upon when the snapshot was taken, or change normal
 		 * snapshot processing so it matches.
 		 */
-		subcount = KnownAssignedXidsGetAndSetXmin(snapshot->subxip, &xmin,
-												  xmax);
-
-		if (TransactionIdPrecedesOrEquals(xmin, procArray->lastOverflowedXid))
-			suboverflowed = true;
+		subcount = KnownAssignedXidsGetSnapshot(snapshot->subxip, &xmin,
+												xmax, &suboverflowed);
 	}
 
 	if (!TransactionIdIsValid(MyPgXact->xmin))
 		MyPgXact->xmin = TransactionXmin = xmin;
+
+	snapshot->snapXactCompletionCount = ShmemVariableCache->xactCompletionCount;
+
 	LWLockRelease(ProcArrayLock);
 
 	/*
@@ -1741,7 +1868,7 @@ GetOldestActiveTransactionId(void)
  * the result is somewhat indeterminate, but we don't really care.  Even in
  * a multiprocessor with delayed writes to shared memory, it should be certain
  * that setting of inCommit will propagate to shared memory when the backend
- * takes the WALInsertLock, so we cannot fail to see an xact as inCommit if
+ * takes a WAL insertion lock, so we cannot fail to see an xact as inCommit if
  * it's already inserted its commit record.  Whether it takes a little while
  * for clearing of inCommit to propagate is unimportant for correctness.
  */
@@ -2467,6 +2594,9 @@ XidCacheRemoveRunningXids(TransactionId xid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
 
+	/* Invalidate cached snapshots */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -2643,9 +2773,23 @@ ExpireTreeKnownAssignedTransactionIds(TransactionId xid, int nsubxids,
 							  max_xid))
 		ShmemVariableCache->latestCompletedXid = max_xid;
 
+	/* ... and invalidate cached snapshots */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
+/*
+ * KnownAssignedTransactionIdsIdleMaintenance
+ *		Opportunistically do maintenance work when the startup process
+ *		is about to go idle.
+ */
+void
+KnownAssignedTransactionIdsIdleMaintenance(void)
+{
+	KnownAssignedXidsCompress(KAX_STARTUP_PROCESS_IDLE, false);
+}
+
 /*
  * ExpireAllKnownAssignedTransactionIds
  *		Remove all entries in KnownAssignedXids
@@ -2655,6 +2799,7 @@ ExpireAllKnownAssignedTransactionIds(void)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(InvalidTransactionId);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -2667,6 +2812,7 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
 {
 	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
 	KnownAssignedXidsRemovePreceding(xid);
+	ShmemVariableCache->xactCompletionCount++;
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -2696,6 +2842,8 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
  *
  * It's cheap to maintain the sortedness during insertions, since new known
  * XIDs are always reported in XID order; we just append them at the right.
+ * The array itself is sized for the worst case, though, and in most cases
+ * only a small fraction of it contains valid entries at any instant.
  *
  * To keep individual deletions cheap, we need to allow gaps in the array.
  * This is implemented by marking array elements as valid or invalid using
@@ -2704,7 +2852,10 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
  * XID entry itself.  This preserves the property that the XID entries are
  * sorted, so we can do binary searches easily.  Periodically we compress
  * out the unused entries; that's much cheaper than having to compress the
- * array immediately on every deletion.
+ * array immediately on every deletion.  Compression is O(S) and holds
+ * exclusive lock in the startup process, which is what limits the replay
+ * rate, so we avoid doing it at every transaction end; see
+ * KnownAssignedXidsCompress.
  *
  * The actually valid items in KnownAssignedXids[] and KnownAssignedXidsValid[]
  * are those with indexes tail <= i < head; items outside this subscript range
@@ -2712,8 +2863,7 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
  * force compression of unused entries rather than wrapping around, since
  * allowing wraparound would greatly complicate the search logic.  We maintain
  * an explicit tail pointer so that pruning of old XIDs can be done without
- * immediately moving the array contents.  In most cases only a small fraction
- * of the array contains valid entries at any instant.
+ * immediately moving the array contents.
  *
  * Although only the startup process can ever change the KnownAssignedXids
  * data structure, we still need interlocking so that standby backends will
@@ -2742,7 +2892,9 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
  *		must happen)
  *	* Compressing the array is O(S) and requires exclusive lock
  *	* Removing an XID is O(logS) and requires exclusive lock
- *	* Taking a snapshot is O(S) and requires shared lock
+ *	* Taking a snapshot is O(S) and requires shared lock, but only the
+ *		first snapshot after a transaction ends; later ones copy the N XIDs
+ *		from the dense KnownAssignedXidsSnapshot array
  *	* Checking for an XID is O(logS) and requires shared lock
  *
  * In comparison, using a hash table for KnownAssignedXids would mean that
@@ -2752,21 +2904,32 @@ ExpireOldKnownAssignedTransactionIds(TransactionId xid)
  * so there is an optimal point for any workload mix. We use a heuristic to
  * decide when to compress the array, though trimming also helps reduce
  * frequency of compressing. The heuristic requires us to track the number of
- * currently valid XIDs in the array.
+ * currently valid XIDs in the array.  Since the O(S) scan is done at most
+ * once per transaction end however many backends take snapshots, we can
+ * afford a looser heuristic than we could if each of them scanned.
  */
 
 
+/*
+ * Consider compressing only every KAX_COMPRESS_FREQUENCY transaction ends,
+ * and when idle at most every KAX_COMPRESS_IDLE_INTERVAL milliseconds.
+ */
+#define KAX_COMPRESS_FREQUENCY		128
+#define KAX_COMPRESS_IDLE_INTERVAL	1000
+
 /*
  * Compress KnownAssignedXids by shifting valid data down to the start of the
  * array, removing any gaps.
  *
- * A compression step is forced if "force" is true, otherwise we do it
- * only if a heuristic indicates it's a good time to do it.
+ * A compression step is forced if "reason" is KAX_NO_SPACE, otherwise we do
+ * it only if a heuristic indicates it's a good time to do it.
  *
- * Caller must hold ProcArrayLock in exclusive mode.
+ * Caller must hold ProcArrayLock in exclusive mode if haveLock is true; else
+ * we take it ourselves if we decide to compress.  Only the startup process
+ * calls this, so the head and tail pointers can't change under us.
  */
 static void
-KnownAssignedXidsCompress(bool force)
+KnownAssignedXidsCompress(KAXCompressReason reason, bool haveLock)
 {
 	/* use volatile pointer to prevent code rearrangement */
 	volatile ProcArrayStruct *pArray = procArray;
@@ -2775,29 +2938,59 @@ KnownAssignedXidsCompress(bool force)
 	int			compress_index;
 	int			i;
 
-	/* no spinlock required since we hold ProcArrayLock exclusively */
+	/* no spinlock required since only we ever change the pointers */
 	head = pArray->headKnownAssignedXids;
 	tail = pArray->tailKnownAssignedXids;
 
-	if (!force)
+	if (reason != KAX_NO_SPACE)
 	{
 		/*
 		 * If we can choose how much to compress, use a heuristic to avoid
 		 * compressing too often or not often enough.
 		 *
 		 * Heuristic is if we have a large enough current spread and less than
-		 * 50% of the elements are currently in use, then compress. This
-		 * should ensure we compress fairly infrequently. We could compress
-		 * less often though the virtual array would spread out more and
-		 * snapshots would become more expensive.
+		 * 50% of the elements are currently in use, then compress.  Removing
+		 * the XIDs of a transaction is the common case, and happens at the
+		 * rate the master commits, so we only apply the heuristic every
+		 * KAX_COMPRESS_FREQUENCY transaction ends.  When the startup process
+		 * is about to sleep anyway, any gap is worth compressing out, but not
+		 * more often than every KAX_COMPRESS_IDLE_INTERVAL.
 		 */
 		int			nelements = head - tail;
 
-		if (nelements < 4 * PROCARRAY_MAXPROCS ||
-			nelements < 2 * pArray->numKnownAssignedXids)
+		if (nelements == pArray->numKnownAssignedXids)
 			return;
+
+		if (reason == KAX_STARTUP_PROCESS_IDLE)
+		{
+			static TimestampTz lastCompressTs = 0;
+			TimestampTz now = GetCurrentTimestamp();
+
+			if (!TimestampDifferenceExceeds(lastCompressTs, now,
+											KAX_COMPRESS_IDLE_INTERVAL))
+				return;
+			lastCompressTs = now;
+		}
+		else
+		{
+			if (reason == KAX_TRANSACTION_END)
+			{
+				static int	transactionEndsCounter = 0;
+
+				if (++transactionEndsCounter < KAX_COMPRESS_FREQUENCY)
+					return;
+				transactionEndsCounter = 0;
+			}
+
+			if (nelements < 4 * PROCARRAY_MAXPROCS ||
+				nelements < 2 * pArray->numKnownAssignedXids)
+				return;
+		}
 	}
 
+	if (!haveLock)
+		LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+
 	/*
 	 * We compress the array by reading the valid values from tail to head,
 	 * re-aligning data to 0th element.
@@ -2815,6 +3008,9 @@ KnownAssignedXidsCompress(bool force)
 
 	pArray->tailKnownAssignedXids = 0;
 	pArray->headKnownAssignedXids = compress_index;
+
+	if (!haveLock)
+		LWLockRelease(ProcArrayLock);
 }
 
 /*
@@ -2887,18 +3083,12 @@ KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
 	 */
 	if (head + nxids > pArray->maxKnownAssignedXids)
 	{
-		/* must hold lock to compress */
-		if (!exclusive_lock)
-			LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
-
-		KnownAssignedXidsCompress(true);
+		/* this takes the lock if we don't hold it already */
+		KnownAssignedXidsCompress(KAX_NO_SPACE, exclusive_lock);
 
 		head = pArray->headKnownAssignedXids;
 		/* note: we no longer care about the tail pointer */
 
-		if (!exclusive_lock)
-			LWLockRelease(ProcArrayLock);
-
 		/*
 		 * If it still won't fit then we're out of memory
 		 */
@@ -3093,7 +3283,7 @@ KnownAssignedXidsRemoveTree(TransactionId xid, int nsubxids,
 		KnownAssignedXidsRemove(subxids[i]);
 
 	/* Opportunistically compress the array */
-	KnownAssignedXidsCompress(false);
+	KnownAssignedXidsCompress(KAX_TRANSACTION_END, true);
 }
 
 /*
@@ -3169,7 +3359,7 @@ KnownAssignedXidsRemovePreceding(TransactionId removeXid)
 	}
 
 	/* Opportunistically compress the array */
-	KnownAssignedXidsCompress(false);
+	KnownAssignedXidsCompress(KAX_PRUNE, true);
 }
 
 /*
@@ -3251,6 +3441,75 @@ KnownAssignedXidsGetAndSetXmin(TransactionId *xarray, TransactionId *xmin,
 	return count;
 }
 
+/*
+ * KnownAssignedXidsGetSnapshot - as KnownAssignedXidsGetAndSetXmin, and
+ * also set *overflowed if the XIDs might not include all subtransactions.
+ *
+ * The result depends only on the array contents below xmax and on
+ * lastOverflowedXid, which change only along with xactCompletionCount.
+ * So the first backend to get here for a given value of the counter keeps
+ * a dense copy of its result, and the others simply copy that, avoiding
+ * the scan over the gaps of the array.  Backends that arrive while the
+ * copy is being made scan the array themselves, rather than wait.
+ *
+ * Caller must hold ProcArrayLock in (at least) shared mode.  That keeps
+ * xactCompletionCount from changing until we're done, which is what makes
+ * it safe to read and write the copy without holding the spinlock.
+ */
+static int
+KnownAssignedXidsGetSnapshot(TransactionId *xarray, TransactionId *xmin,
+							 TransactionId xmax, bool *overflowed)
+{
+	/* use volatile pointer to prevent code rearrangement */
+	volatile ProcArrayStruct *pArray = procArray;
+	uint64		completionCount = ShmemVariableCache->xactCompletionCount;
+	TransactionId snapXmin = xmax;
+	bool		cached;
+	bool		build;
+	int			count;
+
+	SpinLockAcquire(&pArray->known_assigned_xids_lck);
+	cached = (pArray->cachedSnapshotCompletionCount == completionCount);
+	build = (!cached && !pArray->cachedSnapshotBuilding);
+	if (build)
+		pArray->cachedSnapshotBuilding = true;
+	SpinLockRelease(&pArray->known_assigned_xids_lck);
+
+	if (cached)
+	{
+		count = pArray->cachedSnapshotCount;
+		memcpy(xarray, KnownAssignedXidsSnapshot,
+			   count * sizeof(TransactionId));
+		snapXmin = pArray->cachedSnapshotXmin;
+		*overflowed = pArray->cachedSnapshotOverflowed;
+	}
+	else
+	{
+		count = KnownAssignedXidsGetAndSetXmin(xarray, &snapXmin, xmax);
+		*overflowed = TransactionIdPrecedesOrEquals(snapXmin,
+													pArray->lastOverflowedXid);
+
+		if (build)
+		{
+			memcpy(KnownAssignedXidsSnapshot, xarray,
+				   count * sizeof(TransactionId));
+			pArray->cachedSnapshotCount = count;
+			pArray->cachedSnapshotXmin = snapXmin;
+			pArray->cachedSnapshotOverflowed = *overflowed;
+
+			SpinLockAcquire(&pArray->known_assigned_xids_lck);
+			pArray->cachedSnapshotCompletionCount = completionCount;
+			pArray->cachedSnapshotBuilding = false;
+			SpinLockRelease(&pArray->known_assigned_xids_lck);
+		}
+	}
+
+	if (TransactionIdPrecedes(snapXmin, *xmin))
+		*xmin = snapXmin;
+
+	return count;
+}
+
 /*
  * Get oldest XID in the KnownAssignedXids array, or InvalidTransactionId
  * if nothing there.
@@ -0,0 +1,900 @@
+/*-------------------------------------------------------------------------
+ *
+ * shm_mq.c
+ *	  single-reader, single-writer shared memory message queue
+ *
+ * Both the sender and the receiver must have a PGPROC; their respective
+ * process latches are used for synchronization.  Only the sender may send,
+ * and only the receiver may receive.  This is intended to allow a user
+ * backend to communicate with worker backends that it has registered.
+ *
+ * A message is a length word followed by the message data, both padded to
+ * a multiple of MAXIMUM_ALIGNOF.  A message larger than the ring is sent in
+ * pieces, the sender waiting for the receiver to make room.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/ipc/shm_mq.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "postmaster/bgworker.h"
+#include "storage/shm_mq.h"
+#include "storage/spin.h"
+
+/*
+ * This structure represents the actual queue, stored in shared memory.
+ *
+ * Some notes on synchronization:
+ *
+ * mq_receiver and mq_bytes_read can only be changed by the receiver; and
+ * mq_sender and mq_bytes_written can only be changed by the sender.  However,
+ * all of them are protected by mq_mutex, as is mq_detached, which either
+ * party may set.
+ *
+ * mq_ring_size and mq_ring_offset never change after initialization, and
+ * can therefore be read without the lock.
+ *
+ * The sender only writes into the part of the ring the receiver has
+ * finished with, and the receiver only reads the part the sender has
+ * finished writing; acquiring and releasing mq_mutex orders the accesses to
+ * the ring data with respect to the updates of the byte counts.
+ */
+struct shm_mq
+{
+	slock_t		mq_mutex;
+	PGPROC	   *mq_receiver;
+	PGPROC	   *mq_sender;
+	uint64		mq_bytes_read;
+	uint64		mq_bytes_written;
+	Size		mq_ring_size;
+	bool		mq_detached;
+	uint8		mq_ring_offset;
+	char		mq_ring[1];		/* VARIABLE LENGTH ARRAY */
+};
+
+/*
+ * This structure is a backend-private handle for access to a queue.
+ *
+ * mqh_queue is a pointer to the queue we've attached, and mqh_segment is
+ * a pointer to the dynamic shared memory segment that contains it, if any.
+ *
+ * If this queue is intended to connect the current process with a background
+ * worker that started it, the user can pass a pointer to the worker handle
+ * to shm_mq_attach(), and we'll store it in mqh_handle.  The point of this
+ * is to allow us to stop waiting if the worker exits before attaching.
+ *
+ * mqh_buffer holds a message that is copied out of the ring because it
+ * wrapped around the end of the ring or was bigger than the ring.
+ *
+ * mqh_partial_bytes, mqh_expected_bytes, and mqh_length_word_complete are
+ * used to track the state of a non-blocking send or receive that has not
+ * finished yet; the caller must repeat the call with the same arguments.
+ * The length word is always sent and received whole.
+ *
+ * mqh_consume_pending is the space taken up by a message returned in place
+ * in the ring, which we give back to the sender at the next receive.
+ */
+struct shm_mq_handle
+{
+	shm_mq	   *mqh_queue;
+	dsm_segment *mqh_segment;
+	BackgroundWorkerHandle *mqh_handle;
+	char	   *mqh_buffer;
+	Size		mqh_buflen;
+	Size		mqh_consume_pending;
+	Size		mqh_partial_bytes;
+	Size		mqh_expected_bytes;
+	bool		mqh_length_word_complete;
+	bool		mqh_counterparty_attached;
+	MemoryContext mqh_context;
+};
+
+static shm_mq_result shm_mq_send_bytes(shm_mq_handle *mq, Size nbytes,
+				  void *data, bool nowait, Size *bytes_written);
+static shm_mq_result shm_mq_receive_bytes(shm_mq *mq, Size bytes_needed,
+					 bool nowait, Size *nbytesp, void **datap);
+static bool shm_mq_counterparty_gone(volatile shm_mq *mq,
+						 BackgroundWorkerHandle *handle);
+static uint64 shm_mq_get_bytes_read(volatile shm_mq *mq, bool *detached);
+static uint64 shm_mq_get_bytes_written(volatile shm_mq *mq, bool *detached);
+static void shm_mq_inc_bytes_read(volatile shm_mq *mq, Size n);
+static void shm_mq_inc_bytes_written(volatile shm_mq *mq, Size n);
+static shm_mq_result shm_mq_notify_receiver(volatile shm_mq *mq);
+static void shm_mq_detach_callback(dsm_segment *seg, Datum arg);
+
+/* Minimum queue size is enough for header and at least one chunk of data. */
+const Size	shm_mq_minimum_size =
+MAXALIGN(offsetof(shm_mq, mq_ring)) + MAXIMUM_ALIGNOF;
+
+#define MQH_INITIAL_BUFSIZE				8192
+
+/*
+ * Initialize a new shared message queue.
+ */
+shm_mq *
+shm_mq_create(void *address, Size size)
+{
+	shm_mq	   *mq = address;
+	Size		data_offset = MAXALIGN(offsetof(shm_mq, mq_ring));
+
+	/* If the size isn't MAXALIGN'd, just discard the odd bytes. */
+	size = MAXALIGN_DOWN(size);
+
+	/* Queue size must be large enough to hold some data. */
+	Assert(size > data_offset);
+
+	/* Initialize queue header. */
+	SpinLockInit(&mq->mq_mutex);
+	mq->mq_receiver = NULL;
+	mq->mq_sender = NULL;
+	mq->mq_bytes_read = 0;
+	mq->mq_bytes_written = 0;
+	mq->mq_ring_size = size - data_offset;
+	mq->mq_detached = false;
+	mq->mq_ring_offset = data_offset - offsetof(shm_mq, mq_ring);
+
+	return mq;
+}
+
+/*
+ * Set the identity of the process that will receive from a shared message
+ * queue.
+ */
+void
+shm_mq_set_receiver(shm_mq *mq, PGPROC *proc)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *sender;
+
+	SpinLockAcquire(&vmq->mq_mutex);
+	Assert(vmq->mq_receiver == NULL);
+	vmq->mq_receiver = proc;
+	sender = vmq->mq_sender;
+	SpinLockRelease(&vmq->mq_mutex);
+
+	if (sender != NULL)
+		SetLatch(&sender->procLatch);
+}
+
+/*
+ * Set the identity of the process that will send to a shared message queue.
+ */
+void
+shm_mq_set_sender(shm_mq *mq, PGPROC *proc)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *receiver;
+
+	SpinLockAcquire(&vmq->mq_mutex);
+	Assert(vmq->mq_sender == NULL);
+	vmq->mq_sender = proc;
+	receiver = vmq->mq_receiver;
+	SpinLockRelease(&vmq->mq_mutex);
+
+	if (receiver != NULL)
+		SetLatch(&receiver->procLatch);
+}
+
+/*
+ * Get the configured receiver.
+ */
+PGPROC *
+shm_mq_get_receiver(shm_mq *mq)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *receiver;
+
+	SpinLockAcquire(&vmq->mq_mutex);
+	receiver = vmq->mq_receiver;
+	SpinLockRelease(&vmq->mq_mutex);
+
+	return receiver;
+}
+
+/*
+ * Get the configured sender.
+ */
+PGPROC *
+shm_mq_get_sender(shm_mq *mq)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *sender;
+
+	SpinLockAcquire(&vmq->mq_mutex);
+	sender = vmq->mq_sender;
+	SpinLockRelease(&vmq->mq_mutex);
+
+	return sender;
+}
+
+/*
+ * Attach to a shared message queue so we can send or receive messages.
+ *
+ * The memory context in effect at the time this function is called should
+ * be one which will last for at least as long as the message queue itself.
+ *
+ * If seg != NULL, the queue will be automatically detached when that dynamic
+ * shared memory segment is detached.
+ *
+ * If handle != NULL, the queue can be read or written even before the
+ * other process has attached.  We'll wait for it to do so if needed.  The
+ * handle must be for a background worker initialized with bgw_notify_pid
+ * equal to our PID.
+ */
+shm_mq_handle *
+shm_mq_attach(shm_mq *mq, dsm_segment *seg, BackgroundWorkerHandle *handle)
+{
+	shm_mq_handle *mqh = palloc(sizeof(shm_mq_handle));
+
+	Assert(mq->mq_receiver == MyProc || mq->mq_sender == MyProc);
+	mqh->mqh_queue = mq;
+	mqh->mqh_segment = seg;
+	mqh->mqh_handle = handle;
+	mqh->mqh_buffer = NULL;
+	mqh->mqh_buflen = 0;
+	mqh->mqh_consume_pending = 0;
+	mqh->mqh_partial_bytes = 0;
+	mqh->mqh_expected_bytes = 0;
+	mqh->mqh_length_word_complete = false;
+	mqh->mqh_counterparty_attached = false;
+	mqh->mqh_context = CurrentMemoryContext;
+
+	if (seg != NULL)
+		on_dsm_detach(seg, shm_mq_detach_callback, PointerGetDatum(mq));
+
+	return mqh;
+}
+
+/*
+ * Write a message into a shared message queue.
+ *
+ * When nowait = false, we'll wait on our process latch when the ring buffer
+ * fills up, and then continue writing once the receiver has drained some
+ * data.  The process latch is reset after each wait.
+ *
+ * When nowait = true, we do not manipulate the state of the process latch;
+ * instead, if the buffer becomes full, we return SHM_MQ_WOULD_BLOCK.  In
+ * this case, the caller should call this function again, with the same
+ * arguments, each time the process latch is set.
+ */
+shm_mq_result
+shm_mq_send(shm_mq_handle *mqh, Size nbytes, void *data, bool nowait)
+{
+	shm_mq_result res;
+	shm_mq	   *mq = mqh->mqh_queue;
+	Size		bytes_written;
+
+	Assert(mq->mq_sender == MyProc);
+
+	/*
+	 * Write the message length into the buffer.  Free space in the ring
+	 * always comes in multiples of MAXIMUM_ALIGNOF, so the length word is
+	 * written all at once or not at all.
+	 */
+	if (!mqh->mqh_length_word_complete)
+	{
+		res = shm_mq_send_bytes(mqh, sizeof(Size), &nbytes, nowait,
+								&bytes_written);
+		if (res != SHM_MQ_SUCCESS)
+			return res;
+		Assert(bytes_written == sizeof(Size));
+		mqh->mqh_partial_bytes = 0;
+		mqh->mqh_length_word_complete = true;
+	}
+
+	/* Write the actual data bytes into the buffer. */
+	Assert(mqh->mqh_partial_bytes <= nbytes);
+	res = shm_mq_send_bytes(mqh, nbytes - mqh->mqh_partial_bytes,
+							((char *) data) + mqh->mqh_partial_bytes,
+							nowait, &bytes_written);
+	if (res == SHM_MQ_WOULD_BLOCK)
+		mqh->mqh_partial_bytes += bytes_written;
+	else
+	{
+		mqh->mqh_partial_bytes = 0;
+		mqh->mqh_length_word_complete = false;
+	}
+	if (res != SHM_MQ_SUCCESS)
+		return res;
+
+	/* Notify receiver of the newly-written data, and return. */
+	return shm_mq_notify_receiver(mq);
+}
+
+/*
+ * Receive a message from a shared message queue.
+ *
+ * We set *nbytesp to the message length and *datap to point to the message
+ * payload.  If the entire message exists in the queue as a single,
+ * contiguous chunk, *datap will point directly into shared memory; otherwise,
+ * it will point to a temporary buffer.  This mostly avoids data copying in
+ * the hoped-for case where messages are short compared to the buffer size,
+ * while still allowing longer messages.  In either case, the return value
+ * remains valid until the next receive operation is performed on the queue.
+ *
+ * When nowait = false, we'll wait on our process latch when the ring buffer
+ * is empty and we have not yet received a full message.  The sender will
+ * set our process latch after more data has been written, and we'll resume
+ * processing.  Each call will therefore return a complete message
+ * (unless the sender detaches the queue).
+ *
+ * When nowait = true, we do not manipulate the state of the process latch;
+ * instead, whenever the buffer is empty and we need to read from it, we
+ * return SHM_MQ_WOULD_BLOCK.  In this case, the caller should call this
+ * function again after the process latch has been set.
+ */
+shm_mq_result
+shm_mq_receive(shm_mq_handle *mqh, Size *nbytesp, void **datap, bool nowait)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+	shm_mq_result res;
+	Size		rb = 0;
+	Size		nbytes;
+	void	   *rawdata;
+
+	Assert(mq->mq_receiver == MyProc);
+
+	/* We can't receive data until the sender has attached. */
+	if (!mqh->mqh_counterparty_attached)
+	{
+		if (nowait)
+		{
+			if (shm_mq_get_sender(mq) == NULL)
+			{
+				if (shm_mq_counterparty_gone(mq, mqh->mqh_handle))
+					return SHM_MQ_DETACHED;
+				return SHM_MQ_WOULD_BLOCK;
+			}
+		}
+		else if (shm_mq_wait_for_attach(mqh) != SHM_MQ_SUCCESS)
+			return SHM_MQ_DETACHED;
+		mqh->mqh_counterparty_attached = true;
+	}
+
+	/* Consume any zero-copy data from previous receive operation. */
+	if (mqh->mqh_consume_pending > 0)
+	{
+		shm_mq_inc_bytes_read(mq, mqh->mqh_consume_pending);
+		mqh->mqh_consume_pending = 0;
+	}
+
+	/*
+	 * Read the length word, unless a previous nowait call got that far.  The
+	 * length word is never split across the end of the ring, since every
+	 * write starts at a multiple of MAXIMUM_ALIGNOF.
+	 */
+	if (!mqh->mqh_length_word_complete)
+	{
+		res = shm_mq_receive_bytes(mq, sizeof(Size), nowait, &rb, &rawdata);
+		if (res != SHM_MQ_SUCCESS)
+			return res;
+		Assert(rb >= sizeof(Size));
+		nbytes = *(Size *) rawdata;
+
+		/* If we've already got the whole message, we're done. */
+		if (rb >= MAXALIGN(sizeof(Size)) + nbytes)
+		{
+			/*
+			 * Technically, we could consume the message length information
+			 * at this point, but the extra write to shared memory wouldn't
+			 * be free and in most cases we would reap no benefit.
+			 */
+			mqh->mqh_consume_pending = MAXALIGN(sizeof(Size)) + MAXALIGN(nbytes);
+			*nbytesp = nbytes;
+			*datap = ((char *) rawdata) + MAXALIGN(sizeof(Size));
+			return SHM_MQ_SUCCESS;
+		}
+
+		/*
+		 * We don't have the whole message, but we at least have the whole
+		 * length word.
+		 */
+		mqh->mqh_expected_bytes = nbytes;
+		mqh->mqh_length_word_complete = true;
+		mqh->mqh_partial_bytes = 0;
+		shm_mq_inc_bytes_read(mq, MAXALIGN(sizeof(Size)));
+	}
+	nbytes = mqh->mqh_expected_bytes;
+
+	if (mqh->mqh_partial_bytes == 0)
+	{
+		/*
+		 * Try to obtain the whole message in a single chunk.  If this works,
+		 * we need not copy the data and can return a pointer directly into
+		 * shared memory.
+		 */
+		res = shm_mq_receive_bytes(mq, nbytes, nowait, &rb, &rawdata);
+		if (res != SHM_MQ_SUCCESS)
+			return res;
+		if (rb >= nbytes)
+		{
+			mqh->mqh_length_word_complete = false;
+			mqh->mqh_consume_pending = MAXALIGN(nbytes);
+			*nbytesp = nbytes;
+			*datap = rawdata;
+			return SHM_MQ_SUCCESS;
+		}
+
+		/*
+		 * The message has wrapped the buffer.  We'll need to copy it in order
+		 * to return it to the client in one chunk.  First, make sure we have
+		 * a large enough buffer available.
+		 */
+		if (mqh->mqh_buflen < nbytes)
+		{
+			Size		newbuflen = Max(mqh->mqh_buflen, MQH_INITIAL_BUFSIZE);
+
+			while (newbuflen < nbytes)
+				newbuflen *= 2;
+
+			if (mqh->mqh_buffer != NULL)
+			{
+				pfree(mqh->mqh_buffer);
+				mqh->mqh_buffer = NULL;
+				mqh->mqh_buflen = 0;
+			}
+			mqh->mqh_buffer = MemoryContextAlloc(mqh->mqh_context, newbuflen);
+			mqh->mqh_buflen = newbuflen;
+		}
+	}
+
+	else
+	{
+		/* Resuming a copy that a nowait call left unfinished. */
+		rb = 0;
+	}
+
+	/* Loop until we've copied the entire message. */
+	for (;;)
+	{
+		Size		still_needed;
+
+		if (rb > 0)
+		{
+			/* Copy as much as we can. */
+			Assert(mqh->mqh_partial_bytes + rb <= nbytes);
+			memcpy(&mqh->mqh_buffer[mqh->mqh_partial_bytes], rawdata, rb);
+			mqh->mqh_partial_bytes += rb;
+
+			/*
+			 * Update count of bytes read, with alignment padding.  Note that
+			 * this will never actually insert any padding except at the end
+			 * of a message, because the buffer size is a multiple of
+			 * MAXIMUM_ALIGNOF, and each read and write is as well.
+			 */
+			Assert(mqh->mqh_partial_bytes == nbytes || rb == MAXALIGN(rb));
+			shm_mq_inc_bytes_read(mq, MAXALIGN(rb));
+		}
+
+		/* If we got all the data, exit the loop. */
+		if (mqh->mqh_partial_bytes >= nbytes)
+			break;
+
+		/* Wait for some more data. */
+		still_needed = nbytes - mqh->mqh_partial_bytes;
+		res = shm_mq_receive_bytes(mq, still_needed, nowait, &rb, &rawdata);
+		if (res != SHM_MQ_SUCCESS)
+			return res;
+		if (rb > still_needed)
+			rb = still_needed;
+	}
+
+	/* Return the complete message, and reset for next message. */
+	*nbytesp = nbytes;
+	*datap = mqh->mqh_buffer;
+	mqh->mqh_length_word_complete = false;
+	mqh->mqh_partial_bytes = 0;
+	return SHM_MQ_SUCCESS;
+}
+
+/*
+ * Wait for the other process that's supposed to use this queue to attach
+ * to it.
+ *
+ * The return value is SHM_MQ_DETACHED if the worker has already detached or
+ * if it dies; it is SHM_MQ_SUCCESS if we detect that the worker has attached.
+ * Note that we will only be able to detect that the worker has died before
+ * attaching if a background worker handle was passed to shm_mq_attach().
+ */
+shm_mq_result
+shm_mq_wait_for_attach(shm_mq_handle *mqh)
+{
+	volatile shm_mq *mq = mqh->mqh_queue;
+	PGPROC	   *victim;
+	bool		detached;
+
+	for (;;)
+	{
+		SpinLockAcquire(&mq->mq_mutex);
+		detached = mq->mq_detached;
+		if (mq->mq_receiver == MyProc)
+			victim = mq->mq_sender;
+		else
+		{
+			Assert(mq->mq_sender == MyProc);
+			victim = mq->mq_receiver;
+		}
+		SpinLockRelease(&mq->mq_mutex);
+
+		if (detached)
+			return SHM_MQ_DETACHED;
+		if (victim != NULL)
+		{
+			mqh->mqh_counterparty_attached = true;
+			return SHM_MQ_SUCCESS;
+		}
+		if (shm_mq_counterparty_gone(mq, mqh->mqh_handle))
+			return SHM_MQ_DETACHED;
+
+		/* Wait to be signalled. */
+		WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+
+		/* An interrupt may have occurred while we were waiting. */
+		CHECK_FOR_INTERRUPTS();
+
+		/* Reset the latch so we don't spin. */
+		ResetLatch(&MyProc->procLatch);
+	}
+}
+
+/*
+ * Detach a shared message queue.
+ *
+ * The purpose of this function is to make sure that the process
+ * with which we're communicating doesn't block forever waiting for us to
+ * fill or drain the queue once we've lost interest.  When the sender
+ * detaches, the receiver can read any messages remaining in the queue;
+ * further reads will return SHM_MQ_DETACHED.  If the receiver detaches,
+ * further attempts to send messages will likewise return SHM_MQ_DETACHED.
+ */
+void
+shm_mq_detach(shm_mq *mq)
+{
+	volatile shm_mq *vmq = mq;
+	PGPROC	   *victim;
+
+	SpinLockAcquire(&vmq->mq_mutex);
+	if (vmq->mq_sender == MyProc)
+		victim = vmq->mq_receiver;
+	else
+	{
+		Assert(vmq->mq_receiver == MyProc);
+		victim = vmq->mq_sender;
+	}
+	vmq->mq_detached = true;
+	SpinLockRelease(&vmq->mq_mutex);
+
+	if (victim != NULL)
+		SetLatch(&victim->procLatch);
+}
+
+/*
+ * Write bytes into a shared message queue.
+ */
+static shm_mq_result
+shm_mq_send_bytes(shm_mq_handle *mqh, Size nbytes, void *data, bool nowait,
+				  Size *bytes_written)
+{
+	shm_mq	   *mq = mqh->mqh_queue;
+	Size		sent = 0;
+	uint64		used;
+	Size		ringsize = mq->mq_ring_size;
+	Size		available;
+
+	while (sent < nbytes)
+	{
+		bool		detached;
+		uint64		rb;
+
+		/* Compute number of ring buffer bytes used and available. */
+		rb = shm_mq_get_bytes_read(mq, &detached);
+		Assert(mq->mq_bytes_written >= rb);
+		used = mq->mq_bytes_written - rb;
+		Assert(used <= ringsize);
+		available = Min(ringsize - used, nbytes - sent);
+
+		/* Bail out if the queue has been detached. */
+		if (detached)
+		{
+			*bytes_written = sent;
+			return SHM_MQ_DETACHED;
+		}
+
+		if (available == 0)
+		{
+			shm_mq_result res;
+
+			/*
+			 * The queue is full, so if the receiver isn't yet known to be
+			 * attached, we must wait for that to happen.
+			 */
+			if (!mqh->mqh_counterparty_attached)
+			{
+				if (nowait)
+				{
+					if (shm_mq_get_receiver(mq) == NULL)
+					{
+						if (shm_mq_counterparty_gone(mq, mqh->mqh_handle))
+						{
+							*bytes_written = sent;
+							return SHM_MQ_DETACHED;
+						}
+						*bytes_written = sent;
+						return SHM_MQ_WOULD_BLOCK;
+					}
+				}
+				else if (shm_mq_wait_for_attach(mqh) != SHM_MQ_SUCCESS)
+				{
+					*bytes_written = sent;
+					return SHM_MQ_DETACHED;
+				}
+				mqh->mqh_counterparty_attached = true;
+			}
+
+			/* Let the receiver know that we need them to read some data. */
+			res = shm_mq_notify_receiver(mq);
+			if (res != SHM_MQ_SUCCESS)
+			{
+				*bytes_written = sent;
+				return res;
+			}
+
+			/* Skip manipulation of our latch if nowait = true. */
+			if (nowait)
+			{
+				*bytes_written = sent;
+				return SHM_MQ_WOULD_BLOCK;
+			}
+
+			/*
+			 * Wait for our latch to be set.  It might already be set for some
+			 * unrelated reason, but that'll just result in one extra trip
+			 * through the loop.  It's worth it to avoid resetting the latch
+			 * at top of loop, because setting an already-set latch is much
+			 * cheaper than setting one that has been reset.
+			 */
+			WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+
+			/* An interrupt may have occurred while we were waiting. */
+			CHECK_FOR_INTERRUPTS();
+
+			/* Reset the latch so we don't spin. */
+			ResetLatch(&MyProc->procLatch);
+		}
+		else
+		{
+			Size		offset = mq->mq_bytes_written % (uint64) ringsize;
+			Size		sendnow = Min(available, ringsize - offset);
+
+			/* Write as much data as we can via a single memcpy(). */
+			memcpy(&mq->mq_ring[mq->mq_ring_offset + offset],
+				   (char *) data + sent, sendnow);
+			sent += sendnow;
+
+			/*
+			 * Update count of bytes written, with alignment padding.  Note
+			 * that this will never actually insert any padding except at the
+			 * end of a run of bytes, because the buffer size is a multiple of
+			 * MAXIMUM_ALIGNOF, and each read is as well.
+			 */
+			Assert(sent == nbytes || sendnow == MAXALIGN(sendnow));
+			shm_mq_inc_bytes_written(mq, MAXALIGN(sendnow));
+
+			/*
+			 * For efficiency, we don't set the reader's latch here.  We'll do
+			 * that only when the buffer fills up or after writing an entire
+			 * message.
+			 */
+		}
+	}
+
+	*bytes_written = sent;
+	return SHM_MQ_SUCCESS;
+}
+
+/*
+ * Wait until at least *nbytesp bytes are available to be read from the
+ * shared message queue, or until the buffer wraps around.  If the queue is
+ * detached, returns SHM_MQ_DETACHED.  If nowait is specified and a wait
+ * would be required, returns SHM_MQ_WOULD_BLOCK.  Otherwise, *datap is set
+ * to the location at which data bytes can be read, *nbytesp is set to the
+ * number of bytes which can be read at that address, and the return value
+ * is SHM_MQ_SUCCESS.
+ */
+static shm_mq_result
+shm_mq_receive_bytes(shm_mq *mq, Size bytes_needed, bool nowait,
+					 Size *nbytesp, void **datap)
+{
+	Size		ringsize = mq->mq_ring_size;
+	uint64		used;
+
+	for (;;)
+	{
+		Size		offset;
+		bool		detached;
+
+		/* Get bytes written, so we can compute what's available to read. */
+		used = shm_mq_get_bytes_written(mq, &detached) - mq->mq_bytes_read;
+		Assert(used <= ringsize);
+		offset = mq->mq_bytes_read % (uint64) ringsize;
+
+		/* If we have enough data or buffer has wrapped, we're done. */
+		if (used >= bytes_needed || offset + used >= ringsize)
+		{
+			*nbytesp = Min(used, ringsize - offset);
+			*datap = &mq->mq_ring[mq->mq_ring_offset + offset];
+			return SHM_MQ_SUCCESS;
+		}
+
+		/*
+		 * Fall out before waiting if the queue has been detached.
+		 *
+		 * Note that we don't check for this until *after* considering whether
+		 * the data already available is enough, since the receiver can
+		 * finish receiving a message stored in the buffer even after the
+		 * sender has detached.
+		 */
+		if (detached)
+			return SHM_MQ_DETACHED;
+
+		/* Skip manipulation of our latch if nowait = true. */
+		if (nowait)
+			return SHM_MQ_WOULD_BLOCK;
+
+		/*
+		 * Wait for our latch to be set.  It might already be set for some
+		 * unrelated reason, but that'll just result in one extra trip through
+		 * the loop.  It's worth it to avoid resetting the latch at top of
+		 * loop, because setting an already-set latch is much cheaper than
+		 * setting one that has been reset.
+		 */
+		WaitLatch(&MyProc->procLatch, WL_LATCH_SET, 0);
+
+		/* An interrupt may have occurred while we were waiting. */
+		CHECK_FOR_INTERRUPTS();
+
+		/* Reset the latch so we don't spin. */
+		ResetLatch(&MyProc->procLatch);
+	}
+}
+
+/*
+ * Has the other process that was to attach to the queue failed to start,
+ * or exited, without attaching?  We can only tell if we were given its
+ * background worker handle.
+ */
+static bool
+shm_mq_counterparty_gone(volatile shm_mq *mq, BackgroundWorkerHandle *handle)
+{
+	bool		detached;
+	pid_t		pid;
+
+	/* Acquire the lock just long enough to check the pointer. */
+	SpinLockAcquire(&mq->mq_mutex);
+	detached = mq->mq_detached;
+	SpinLockRelease(&mq->mq_mutex);
+
+	/* If the queue has been detached, counterparty is definitely gone. */
+	if (detached)
+		return true;
+
+	/* If there's a handle, check worker status. */
+	if (handle != NULL)
+	{
+		BgwHandleStatus status;
+
+		/* Check for unexpected worker death. */
+		status = GetBackgroundWorkerPid(handle, &pid);
+		if (status != BGWH_STARTED && status != BGWH_NOT_YET_STARTED)
+		{
+			/* Mark it detached, just to make it official. */
+			SpinLockAcquire(&mq->mq_mutex);
+			mq->mq_detached = true;
+			SpinLockRelease(&mq->mq_mutex);
+			return true;
+		}
+	}
+
+	/* Counterparty is not definitively gone. */
+	return false;
+}
+
+/*
+ * Get the number of bytes read.  The receiver need not use this to access
+ * the count of bytes read, but the sender must.
+ */
+static uint64
+shm_mq_get_bytes_read(volatile shm_mq *mq, bool *detached)
+{
+	uint64		v;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	v = mq->mq_bytes_read;
+	*detached = mq->mq_detached;
+	SpinLockRelease(&mq->mq_mutex);
+
+	return v;
+}
+
+/*
+ * Increment the number of bytes read.
+ */
+static void
+shm_mq_inc_bytes_read(volatile shm_mq *mq, Size n)
+{
+	PGPROC	   *sender;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	mq->mq_bytes_read += n;
+	sender = mq->mq_sender;
+	SpinLockRelease(&mq->mq_mutex);
+
+	/* We shouldn't have any bytes to read without a sender. */
+	Assert(sender != NULL);
+	SetLatch(&sender->procLatch);
+}
+
+/*
+ * Get the number of bytes written.  The sender need not use this to access
+ * the count of bytes written, but the receiver must.
+ */
+static uint64
+shm_mq_get_bytes_written(volatile shm_mq *mq, bool *detached)
+{
+	uint64		v;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	v = mq->mq_bytes_written;
+	*detached = mq->mq_detached;
+	SpinLockRelease(&mq->mq_mutex);
+
+	return v;
+}
+
+/*
+ * Increment the number of bytes written.
+ */
+static void
+shm_mq_inc_bytes_written(volatile shm_mq *mq, Size n)
+{
+	SpinLockAcquire(&mq->mq_mutex);
+	mq->mq_bytes_written += n;
+	SpinLockRelease(&mq->mq_mutex);
+}
+
+/*
+ * Set receiver's latch, unless queue is detached.
+ */
+static shm_mq_result
+shm_mq_notify_receiver(volatile shm_mq *mq)
+{
+	PGPROC	   *receiver;
+	bool		detached;
+
+	SpinLockAcquire(&mq->mq_mutex);
+	detached = mq->mq_detached;
+	receiver = mq->mq_receiver;
+	SpinLockRelease(&mq->mq_mutex);
+
+	if (detached)
+		return SHM_MQ_DETACHED;
+	if (receiver)
+		SetLatch(&receiver->procLatch);
+	return SHM_MQ_SUCCESS;
+}
+
+/* Shim for on_dsm_detach callback. */
+static void
+shm_mq_detach_callback(dsm_segment *seg, Datum arg)
+{
+	shm_mq	   *mq = (shm_mq *) DatumGetPointer(arg);
+
+	shm_mq_detach(mq);
+}
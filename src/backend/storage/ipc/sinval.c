@@ -19,6 +19,7 @@
 #include "miscadmin.h"
 #include "storage/ipc.h"
 #include "storage/sinvaladt.h"
+#include "utils/catcache.h"
 #include "utils/inval.h"
 
 
@@ -54,6 +55,27 @@ static void ProcessCatchupEvent(void);
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	int			i;
+
+	/*
+	 * Remove the shared catcache's copies of the invalidated tuples.  Our
+	 * callers send messages only once the changes are visible to others,
+	 * which is what makes the shared catcache's stale-entry checks work.
+	 */
+	if (shared_catcache_entries > 0)
+	{
+		for (i = 0; i < n; i++)
+		{
+			const SharedInvalidationMessage *msg = &msgs[i];
+
+			if (msg->id >= 0)
+				SharedCatCacheInvalidate(msg->cc.dbId, msg->cc.id,
+										 msg->cc.hashValue);
+			else if (msg->id == SHAREDINVALCATALOG_ID)
+				SharedCatCacheFlush();
+		}
+	}
+
 	SIInsertDataEntries(msgs, n);
 }
 
@@ -93,6 +93,20 @@
  * read maxMsgNum if you are not holding SInvalWriteLock, and you need the
  * spinlock to write maxMsgNum unless you are holding both locks.)
  *
+ * Most messages concern a single database: catcache, relcache and relmap
+ * invalidations carry the OID of the database they apply to (or zero for
+ * shared catalogs), and smgr invalidations of temporary relations matter
+ * only to the backend that owns the relation.  A backend connected to one
+ * database ignores the rest, so we don't bother it with them.  Writers set
+ * hasMessages only for backends that might want what was written, and
+ * SICleanupQueue advances a lagging backend's nextMsgNum past messages it
+ * doesn't want, rather than signaling or resetting it.  That way heavy DDL
+ * traffic in one database (temp table churn, for instance) does not drive
+ * backends of other databases into catchup processing or cache resets.
+ * A backend's interest is judged from its PGPROC's databaseId, which is
+ * set once the backend has chosen a database; before that (and in
+ * processes that never pick one) it gets everything.
+ *
  * Note: since maxMsgNum is an int and hence presumably atomically readable/
  * writable, the spinlock might seem unnecessary.  The reason it is needed
  * is to provide a memory barrier: we need to be sure that messages written
@@ -199,6 +213,84 @@ static LocalTransactionId nextLocalTransactionId;
 static void CleanupInvalidationState(int status, Datum arg);
 
 
+/* The backend owning the relation of an smgr message, as in inval.c */
+#define SIMessageBackend(msg) \
+	((BackendId) (((msg)->sm.backend_hi << 16) | (int) (msg)->sm.backend_lo))
+
+/*
+ * SIMessageDatabase
+ *		The database whose backends are interested in a message, or
+ *		InvalidOid if all backends are
+ */
+static inline Oid
+SIMessageDatabase(const SharedInvalidationMessage *msg)
+{
+	if (msg->id >= 0)
+		return msg->cc.dbId;
+	switch (msg->id)
+	{
+		case SHAREDINVALCATALOG_ID:
+			return msg->cat.dbId;
+		case SHAREDINVALRELCACHE_ID:
+			return msg->rc.dbId;
+		case SHAREDINVALRELMAP_ID:
+			return msg->rm.dbId;
+		case SHAREDINVALSMGR_ID:
+			/*
+			 * Any backend may have a permanent relation of any database open
+			 * at the smgr level, to write out dirty buffers; but only the
+			 * owner ever opens a temporary relation.
+			 */
+			if (SIMessageBackend(msg) != InvalidBackendId)
+				return msg->sm.rnode.dbNode;
+			return InvalidOid;
+		default:
+			return InvalidOid;
+	}
+}
+
+/*
+ * SIMessageIsWanted
+ *		Might the given backend need to process a message?
+ *
+ * dbId is the backend's PGPROC->databaseId.  This must agree with what
+ * LocalExecuteInvalidationMessage ignores.
+ */
+static inline bool
+SIMessageIsWanted(const SharedInvalidationMessage *msg, Oid dbId,
+				  BackendId backendId)
+{
+	Oid			msgDbId;
+
+	if (!OidIsValid(dbId))
+		return true;
+	msgDbId = SIMessageDatabase(msg);
+	if (OidIsValid(msgDbId) && msgDbId != dbId)
+		return false;
+	if (msg->id == SHAREDINVALSMGR_ID)
+	{
+		BackendId	backend = SIMessageBackend(msg);
+
+		if (backend != InvalidBackendId && backend != backendId)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * SIStateDatabase
+ *		The database a ProcState's backend is connected to, if any
+ */
+static inline Oid
+SIStateDatabase(ProcState *stateP)
+{
+	/* fetch just once; the backend may be setting it concurrently */
+	volatile PGPROC *proc = stateP->proc;
+
+	return proc ? proc->databaseId : InvalidOid;
+}
+
+
 /*
  * SInvalShmemSize --- return shared-memory space needed
  */
@@ -424,6 +516,18 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		int			numMsgs;
 		int			max;
 		int			i;
+		Oid			batchDbId;
+
+		/*
+		 * Find out whether this batch concerns only one database, so that we
+		 * need not wake up the backends of other databases.
+		 */
+		batchDbId = SIMessageDatabase(&data[0]);
+		for (i = 1; i < nthistime && OidIsValid(batchDbId); i++)
+		{
+			if (SIMessageDatabase(&data[i]) != batchDbId)
+				batchDbId = InvalidOid;
+		}
 
 		n -= nthistime;
 
@@ -468,14 +572,22 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 
 		/*
 		 * Now that the maxMsgNum change is globally visible, we give
-		 * everyone a swift kick to make sure they read the newly added
-		 * messages.  Releasing SInvalWriteLock will enforce a full memory
-		 * barrier, so these (unlocked) changes will be committed to memory
-		 * before we exit the function.
+		 * everyone who might be interested a swift kick to make sure they
+		 * read the newly added messages.  Releasing SInvalWriteLock will
+		 * enforce a full memory barrier, so these (unlocked) changes will be
+		 * committed to memory before we exit the function.
 		 */
 		for (i = 0; i < segP->lastBackend; i++)
 		{
 			ProcState  *stateP = &segP->procState[i];
+			Oid			dbId;
+
+			if (OidIsValid(batchDbId))
+			{
+				dbId = SIStateDatabase(stateP);
+				if (OidIsValid(dbId) && dbId != batchDbId)
+					continue;
+			}
 			stateP->hasMessages = true;
 		}
 
@@ -584,7 +696,11 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		SharedInvalidationMessage *msg;
+
+		msg = &segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		if (SIMessageIsWanted(msg, MyDatabaseId, MyBackendId))
+			data[n++] = *msg;
 		stateP->nextMsgNum++;
 	}
 
@@ -656,6 +772,27 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 		if (stateP->procPid == 0 || stateP->resetState || stateP->sendOnly)
 			continue;
 
+		/*
+		 * A backend that has fallen behind may just be one of another
+		 * database, which wasn't told about messages it doesn't want.  Skip
+		 * it past those, which we are allowed to do since we hold
+		 * SInvalReadLock exclusively.  (Checking only backends that are far
+		 * behind keeps this from adding much to the time we hold the lock.)
+		 */
+		if (n < minsig || n < lowbound)
+		{
+			Oid			dbId = SIStateDatabase(stateP);
+
+			if (OidIsValid(dbId))
+			{
+				while (n < segP->maxMsgNum &&
+					   !SIMessageIsWanted(&segP->buffer[n % MAXNUMMESSAGES],
+										  dbId, i + 1))
+					n++;
+				stateP->nextMsgNum = n;
+			}
+		}
+
 		/*
 		 * If we must free some space and this backend is preventing it, force
 		 * him into reset state and then ignore until he catches up.
@@ -663,6 +800,7 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 		if (n < lowbound)
 		{
 			stateP->resetState = true;
+			stateP->hasMessages = true;
 			/* no point in signaling him ... */
 			continue;
 		}
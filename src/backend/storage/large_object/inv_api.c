@@ -59,6 +59,16 @@
 static Relation lo_heap_r = NULL;
 static Relation lo_index_r = NULL;
 
+/*
+ * inv_write collects this many brand-new pages before inserting them all at
+ * once with heap_multi_insert, so that a long sequential write such as an
+ * lo_import fills each heap page with one WAL record instead of several.
+ */
+#define LO_INSERT_BATCH		32
+
+static void inv_insert_pages(CatalogIndexState indstate, HeapTuple *tuples,
+				 int ntuples);
+
 
 /*
  * Open pg_largeobject and its index, if not already done in current xact
@@ -324,10 +334,10 @@ inv_drop(Oid lobjId)
  * NOTE: LOs can contain gaps, just like Unix files.  We actually return
  * the offset of the last byte + 1.
  */
-static uint32
+static uint64
 inv_getsize(LargeObjectDesc *obj_desc)
 {
-	uint32		lastbyte = 0;
+	uint64		lastbyte = 0;
 	ScanKeyData skey[1];
 	SysScanDesc sd;
 	HeapTuple	tuple;
@@ -368,7 +378,7 @@ inv_getsize(LargeObjectDesc *obj_desc)
 				heap_tuple_untoast_attr((struct varlena *) datafield);
 			pfreeit = true;
 		}
-		lastbyte = data->pageno * LOBLKSIZE + getbytealen(datafield);
+		lastbyte = (uint64) data->pageno * LOBLKSIZE + getbytealen(datafield);
 		if (pfreeit)
 			pfree(datafield);
 	}
@@ -378,39 +388,49 @@ inv_getsize(LargeObjectDesc *obj_desc)
 	return lastbyte;
 }
 
-int
-inv_seek(LargeObjectDesc *obj_desc, int offset, int whence)
+int64
+inv_seek(LargeObjectDesc *obj_desc, int64 offset, int whence)
 {
+	int64		newoffset;
+
 	Assert(PointerIsValid(obj_desc));
 
+	/*
+	 * Note: overflow in the additions is possible, but since we will reject
+	 * negative results, we don't need any extra test for that.
+	 */
 	switch (whence)
 	{
 		case SEEK_SET:
-			if (offset < 0)
-				elog(ERROR, "invalid seek offset: %d", offset);
-			obj_desc->offset = offset;
+			newoffset = offset;
 			break;
 		case SEEK_CUR:
-			if (offset < 0 && obj_desc->offset < ((uint32) (-offset)))
-				elog(ERROR, "invalid seek offset: %d", offset);
-			obj_desc->offset += offset;
+			newoffset = obj_desc->offset + offset;
 			break;
 		case SEEK_END:
-			{
-				uint32		size = inv_getsize(obj_desc);
-
-				if (offset < 0 && size < ((uint32) (-offset)))
-					elog(ERROR, "invalid seek offset: %d", offset);
-				obj_desc->offset = size + offset;
-			}
+			newoffset = inv_getsize(obj_desc) + offset;
 			break;
 		default:
 			elog(ERROR, "invalid whence: %d", whence);
+			newoffset = 0;		/* keep compiler quiet */
+			break;
 	}
-	return obj_desc->offset;
+
+	/*
+	 * use errmsg_internal here because we don't want to expose INT64_FORMAT
+	 * in translatable strings; doing better is not worth the trouble
+	 */
+	if (newoffset < 0 || newoffset > MAX_LARGE_OBJECT_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg_internal("invalid large object seek target: " INT64_FORMAT,
+								 newoffset)));
+
+	obj_desc->offset = newoffset;
+	return newoffset;
 }
 
-int
+int64
 inv_tell(LargeObjectDesc *obj_desc)
 {
 	Assert(PointerIsValid(obj_desc));
@@ -426,7 +446,7 @@ inv_read(LargeObjectDesc *obj_desc, char *buf, int nbytes)
 	int			off;
 	int			len;
 	int32		pageno = (int32) (obj_desc->offset / LOBLKSIZE);
-	uint32		pageoff;
+	int64		pageoff;
 	ScanKeyData skey[2];
 	SysScanDesc sd;
 	HeapTuple	tuple;
@@ -437,6 +457,10 @@ inv_read(LargeObjectDesc *obj_desc, char *buf, int nbytes)
 	if (nbytes <= 0)
 		return 0;
 
+	/* nothing can be stored at or beyond the maximum size */
+	if (obj_desc->offset >= MAX_LARGE_OBJECT_SIZE)
+		return 0;
+
 	open_lo_relation();
 
 	ScanKeyInit(&skey[0],
@@ -467,11 +491,12 @@ inv_read(LargeObjectDesc *obj_desc, char *buf, int nbytes)
 		 * there may be missing pages if the LO contains unwritten "holes". We
 		 * want missing sections to read out as zeroes.
 		 */
-		pageoff = ((uint32) data->pageno) * LOBLKSIZE;
+		pageoff = ((int64) data->pageno) * LOBLKSIZE;
 		if (pageoff > obj_desc->offset)
 		{
-			n = pageoff - obj_desc->offset;
-			n = (n <= (nbytes - nread)) ? n : (nbytes - nread);
+			int64		holelen = pageoff - obj_desc->offset;
+
+			n = (holelen <= (nbytes - nread)) ? (int) holelen : (nbytes - nread);
 			MemSet(buf + nread, 0, n);
 			nread += n;
 			obj_desc->offset += n;
@@ -540,6 +565,8 @@ inv_write(LargeObjectDesc *obj_desc, const char *buf, int nbytes)
 	bool		nulls[Natts_pg_largeobject];
 	bool		replace[Natts_pg_largeobject];
 	CatalogIndexState indstate;
+	HeapTuple	newtups[LO_INSERT_BATCH];
+	int			nnewtups = 0;
 
 	Assert(PointerIsValid(obj_desc));
 	Assert(buf != NULL);
@@ -560,6 +587,13 @@ inv_write(LargeObjectDesc *obj_desc, const char *buf, int nbytes)
 	if (nbytes <= 0)
 		return 0;
 
+	/* this addition can't overflow because nbytes is only int32 */
+	if ((nbytes + obj_desc->offset) > MAX_LARGE_OBJECT_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid large object write request size: %d",
+						nbytes)));
+
 	open_lo_relation();
 
 	indstate = CatalogOpenIndexes(lo_heap_r);
@@ -689,21 +723,27 @@ inv_write(LargeObjectDesc *obj_desc, const char *buf, int nbytes)
 			SET_VARSIZE(&workbuf.hdr, len + VARHDRSZ);
 
 			/*
-			 * Form and insert updated tuple
+			 * Form the new tuple, and queue it for insertion
 			 */
 			memset(values, 0, sizeof(values));
 			memset(nulls, false, sizeof(nulls));
 			values[Anum_pg_largeobject_loid - 1] = ObjectIdGetDatum(obj_desc->id);
 			values[Anum_pg_largeobject_pageno - 1] = Int32GetDatum(pageno);
 			values[Anum_pg_largeobject_data - 1] = PointerGetDatum(&workbuf);
-			newtup = heap_form_tuple(lo_heap_r->rd_att, values, nulls);
-			simple_heap_insert(lo_heap_r, newtup);
-			CatalogIndexInsert(indstate, newtup);
-			heap_freetuple(newtup);
+			newtups[nnewtups++] = heap_form_tuple(lo_heap_r->rd_att,
+												  values, nulls);
+			if (nnewtups == LO_INSERT_BATCH)
+			{
+				inv_insert_pages(indstate, newtups, nnewtups);
+				nnewtups = 0;
+			}
 		}
 		pageno++;
 	}
 
+	if (nnewtups > 0)
+		inv_insert_pages(indstate, newtups, nnewtups);
+
 	systable_endscan_ordered(sd);
 
 	CatalogCloseIndexes(indstate);
@@ -717,8 +757,26 @@ inv_write(LargeObjectDesc *obj_desc, const char *buf, int nbytes)
 	return nwritten;
 }
 
+/*
+ * Insert brand-new pages of a large object, and make index entries for them
+ */
+static void
+inv_insert_pages(CatalogIndexState indstate, HeapTuple *tuples, int ntuples)
+{
+	int			i;
+
+	heap_multi_insert(lo_heap_r, tuples, ntuples, GetCurrentCommandId(true),
+					  0, NULL);
+
+	for (i = 0; i < ntuples; i++)
+	{
+		CatalogIndexInsert(indstate, tuples[i]);
+		heap_freetuple(tuples[i]);
+	}
+}
+
 void
-inv_truncate(LargeObjectDesc *obj_desc, int len)
+inv_truncate(LargeObjectDesc *obj_desc, int64 len)
 {
 	int32		pageno = (int32) (len / LOBLKSIZE);
 	int			off;
@@ -815,7 +873,7 @@ inv_truncate(LargeObjectDesc *obj_desc, int len)
 		/*
 		 * Fill any hole
 		 */
-		off = len % LOBLKSIZE;
+		off = (int) (len % LOBLKSIZE);
 		if (off > pagelen)
 			MemSet(workb + pagelen, 0, off - pagelen);
 
@@ -854,7 +912,7 @@ inv_truncate(LargeObjectDesc *obj_desc, int len)
 		 *
 		 * Fill the hole up to the truncation point
 		 */
-		off = len % LOBLKSIZE;
+		off = (int) (len % LOBLKSIZE);
 		if (off > 0)
 			MemSet(workb, 0, off);
 
@@ -114,31 +114,52 @@ static const char *const lock_mode_names[] =
 	"AccessExclusiveLock"
 };
 
+/* Number of partitions of the shared lock tables; see SetNumLockPartitions */
+int			NumLockPartitions = 0;
+
+/*
+ * Number of groups of fast-path lock slots each backend has; see
+ * assign_max_locks_per_xact.
+ */
+int			FastPathLockGroupsPerBackend = 0;
+
 /*
- * Count of the number of fast path lock slots we believe to be used.  This
- * might be higher than the real number if another backend has transferred
- * our locks to the primary lock table, but it can never be lower than the
- * real value, since only we can acquire locks on our own behalf.
+ * Count of the number of fast path lock slots we believe to be used in each
+ * group.  This might be higher than the real number if another backend has
+ * transferred our locks to the primary lock table, but it can never be lower
+ * than the real value, since only we can acquire locks on our own behalf.
  */
-static int			FastPathLocalUseCount = 0;
+static int	FastPathLocalUseCounts[FP_LOCK_GROUPS_PER_BACKEND_MAX];
 
-/* Macros for manipulating proc->fpLockBits */
+/*
+ * Macros for manipulating proc->fpLockBits.  Slot numbers run over all the
+ * groups; each group's lock bits are kept in one uint64.
+ */
 #define FAST_PATH_BITS_PER_SLOT			3
 #define FAST_PATH_LOCKNUMBER_OFFSET		1
 #define FAST_PATH_MASK					((1 << FAST_PATH_BITS_PER_SLOT) - 1)
+#define FAST_PATH_GROUP(n)		((n) / FP_LOCK_SLOTS_PER_GROUP)
+#define FAST_PATH_INDEX(n)		((n) % FP_LOCK_SLOTS_PER_GROUP)
+#define FAST_PATH_SLOT(group, index) \
+	(AssertMacro((uint32) (group) < (uint32) FastPathLockGroupsPerBackend), \
+	 AssertMacro((index) < FP_LOCK_SLOTS_PER_GROUP), \
+	 ((group) * FP_LOCK_SLOTS_PER_GROUP + (index)))
+#define FAST_PATH_REL_GROUP(relid) \
+	((uint32) (((uint64) (relid) * 49157) & (FastPathLockGroupsPerBackend - 1)))
+#define FAST_PATH_BITS(proc, n)	((proc)->fpLockBits[FAST_PATH_GROUP(n)])
 #define FAST_PATH_GET_BITS(proc, n) \
-	(((proc)->fpLockBits >> (FAST_PATH_BITS_PER_SLOT * n)) & FAST_PATH_MASK)
+	((FAST_PATH_BITS(proc, n) >> (FAST_PATH_BITS_PER_SLOT * FAST_PATH_INDEX(n))) & FAST_PATH_MASK)
 #define FAST_PATH_BIT_POSITION(n, l) \
 	(AssertMacro((l) >= FAST_PATH_LOCKNUMBER_OFFSET), \
 	 AssertMacro((l) < FAST_PATH_BITS_PER_SLOT+FAST_PATH_LOCKNUMBER_OFFSET), \
-	 AssertMacro((n) < FP_LOCK_SLOTS_PER_BACKEND), \
-	 ((l) - FAST_PATH_LOCKNUMBER_OFFSET + FAST_PATH_BITS_PER_SLOT * (n)))
+	 AssertMacro((n) < FastPathLockSlotsPerBackend()), \
+	 ((l) - FAST_PATH_LOCKNUMBER_OFFSET + FAST_PATH_BITS_PER_SLOT * FAST_PATH_INDEX(n)))
 #define FAST_PATH_SET_LOCKMODE(proc, n, l) \
-	 (proc)->fpLockBits |= UINT64CONST(1) << FAST_PATH_BIT_POSITION(n, l)
+	 FAST_PATH_BITS(proc, n) |= UINT64CONST(1) << FAST_PATH_BIT_POSITION(n, l)
 #define FAST_PATH_CLEAR_LOCKMODE(proc, n, l) \
-	 (proc)->fpLockBits &= ~(UINT64CONST(1) << FAST_PATH_BIT_POSITION(n, l))
+	 FAST_PATH_BITS(proc, n) &= ~(UINT64CONST(1) << FAST_PATH_BIT_POSITION(n, l))
 #define FAST_PATH_CHECK_LOCKMODE(proc, n, l) \
-	 ((proc)->fpLockBits & (UINT64CONST(1) << FAST_PATH_BIT_POSITION(n, l)))
+	 (FAST_PATH_BITS(proc, n) & (UINT64CONST(1) << FAST_PATH_BIT_POSITION(n, l)))
 
 /*
  * The fast-path lock mechanism is concerned only with relation locks on
@@ -162,6 +183,7 @@ static bool FastPathUnGrantRelationLock(Oid relid, LOCKMODE lockmode);
 static bool FastPathTransferRelationLocks(LockMethod lockMethodTable,
 					  const LOCKTAG *locktag, uint32 hashcode);
 static PROCLOCK *FastPathGetRelationLockEntry(LOCALLOCK *locallock);
+static void SetNumLockPartitions(void);
 static void VirtualXactLockTableCleanup(void);
 
 /*
@@ -371,6 +393,8 @@ InitLocks(void)
 				max_table_size;
 	bool		found;
 
+	SetNumLockPartitions();
+
 	/*
 	 * Compute init/max size to request for lock hashtables.  Note these
 	 * calculations must agree with LockShmemSize!
@@ -386,7 +410,7 @@ InitLocks(void)
 	info.keysize = sizeof(LOCKTAG);
 	info.entrysize = sizeof(LOCK);
 	info.hash = tag_hash;
-	info.num_partitions = NUM_LOCK_PARTITIONS;
+	info.num_partitions = NumLockPartitions;
 	hash_flags = (HASH_ELEM | HASH_FUNCTION | HASH_PARTITION);
 
 	LockMethodLockHash = ShmemInitHash("LOCK hash",
@@ -406,7 +430,7 @@ InitLocks(void)
 	info.keysize = sizeof(PROCLOCKTAG);
 	info.entrysize = sizeof(PROCLOCK);
 	info.hash = proclock_hash;
-	info.num_partitions = NUM_LOCK_PARTITIONS;
+	info.num_partitions = NumLockPartitions;
 	hash_flags = (HASH_ELEM | HASH_FUNCTION | HASH_PARTITION);
 
 	LockMethodProcLockHash = ShmemInitHash("PROCLOCK hash",
@@ -506,7 +530,7 @@ proclock_hash(const void *key, Size keysize)
 	 * intermediate variable to suppress cast-pointer-to-int warnings.
 	 */
 	procptr = PointerGetDatum(proclocktag->myProc);
-	lockhash ^= ((uint32) procptr) << LOG2_NUM_LOCK_PARTITIONS;
+	lockhash ^= ((uint32) procptr) << LOG2_MAX_LOCK_PARTITIONS;
 
 	return lockhash;
 }
@@ -527,7 +551,7 @@ ProcLockHashCode(const PROCLOCKTAG *proclocktag, uint32 hashcode)
 	 * This must match proclock_hash()!
 	 */
 	procptr = PointerGetDatum(proclocktag->myProc);
-	lockhash ^= ((uint32) procptr) << LOG2_NUM_LOCK_PARTITIONS;
+	lockhash ^= ((uint32) procptr) << LOG2_MAX_LOCK_PARTITIONS;
 
 	return lockhash;
 }
@@ -713,7 +737,8 @@ LockAcquireExtended(const LOCKTAG *locktag,
 		 * that case either.
 		 */
 		if (FastPathWeakMode(lockmode)
-			&& FastPathLocalUseCount < FP_LOCK_SLOTS_PER_BACKEND)
+			&& FastPathLocalUseCounts[FAST_PATH_REL_GROUP(locktag->locktag_field2)] <
+			FP_LOCK_SLOTS_PER_GROUP)
 		{
 			bool	acquired;
 
@@ -1397,6 +1422,7 @@ WaitOnLock(LOCALLOCK *locallock, ResourceOwner owner)
 		new_status[len] = '\0'; /* truncate off " waiting" */
 	}
 	pgstat_report_waiting(true);
+	pgstat_report_wait_start(PG_WAIT_LOCK | locallock->tag.lock.locktag_type);
 
 	awaitedLock = locallock;
 	awaitedOwner = owner;
@@ -1445,6 +1471,7 @@ WaitOnLock(LOCALLOCK *locallock, ResourceOwner owner)
 
 		/* Report change to non-waiting status */
 		pgstat_report_waiting(false);
+		pgstat_report_wait_end();
 		if (update_process_title)
 		{
 			set_ps_display(new_status, false);
@@ -1460,6 +1487,7 @@ WaitOnLock(LOCALLOCK *locallock, ResourceOwner owner)
 
 	/* Report change to non-waiting status */
 	pgstat_report_waiting(false);
+	pgstat_report_wait_end();
 	if (update_process_title)
 	{
 		set_ps_display(new_status, false);
@@ -1632,7 +1660,7 @@ LockRelease(const LOCKTAG *locktag, LOCKMODE lockmode, bool sessionLock)
 
 	/* Locks that participate in the fast path require special handling. */
 	if (FastPathTag(locktag) && FastPathWeakMode(lockmode)
-		&& FastPathLocalUseCount > 0)
+		&& FastPathLocalUseCounts[FAST_PATH_REL_GROUP(locktag->locktag_field2)] > 0)
 	{
 		bool	released;
 
@@ -1910,7 +1938,7 @@ LockReleaseAll(LOCKMETHODID lockmethodid, bool allLocks)
 	/*
 	 * Now, scan each lock partition separately.
 	 */
-	for (partition = 0; partition < NUM_LOCK_PARTITIONS; partition++)
+	for (partition = 0; partition < NumLockPartitions; partition++)
 	{
 		LWLockId	partitionLock = FirstLockMgrLock + partition;
 		SHM_QUEUE  *procLocks = &(MyProc->myProcLocks[partition]);
@@ -2132,12 +2160,15 @@ LockReassignCurrentOwner(void)
 static bool
 FastPathGrantRelationLock(Oid relid, LOCKMODE lockmode)
 {
-	uint32		f;
-	uint32		unused_slot = FP_LOCK_SLOTS_PER_BACKEND;
+	uint32		i;
+	uint32		group = FAST_PATH_REL_GROUP(relid);
+	uint32		unused_slot = FastPathLockSlotsPerBackend();
 
 	/* Scan for existing entry for this relid, remembering empty slot. */
-	for (f = 0; f < FP_LOCK_SLOTS_PER_BACKEND; f++)
+	for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
 	{
+		uint32		f = FAST_PATH_SLOT(group, i);
+
 		if (FAST_PATH_GET_BITS(MyProc, f) == 0)
 			unused_slot = f;
 		else if (MyProc->fpRelId[f] == relid)
@@ -2149,11 +2180,11 @@ FastPathGrantRelationLock(Oid relid, LOCKMODE lockmode)
 	}
 
 	/* If no existing entry, use any empty slot. */
-	if (unused_slot < FP_LOCK_SLOTS_PER_BACKEND)
+	if (unused_slot < FastPathLockSlotsPerBackend())
 	{
 		MyProc->fpRelId[unused_slot] = relid;
 		FAST_PATH_SET_LOCKMODE(MyProc, unused_slot, lockmode);
-		++FastPathLocalUseCount;
+		++FastPathLocalUseCounts[group];
 		return true;
 	}
 
@@ -2169,12 +2200,15 @@ FastPathGrantRelationLock(Oid relid, LOCKMODE lockmode)
 static bool
 FastPathUnGrantRelationLock(Oid relid, LOCKMODE lockmode)
 {
-	uint32		f;
+	uint32		i;
+	uint32		group = FAST_PATH_REL_GROUP(relid);
 	bool		result = false;
 
-	FastPathLocalUseCount = 0;
-	for (f = 0; f < FP_LOCK_SLOTS_PER_BACKEND; f++)
+	FastPathLocalUseCounts[group] = 0;
+	for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
 	{
+		uint32		f = FAST_PATH_SLOT(group, i);
+
 		if (MyProc->fpRelId[f] == relid
 			&& FAST_PATH_CHECK_LOCKMODE(MyProc, f, lockmode))
 		{
@@ -2183,7 +2217,7 @@ FastPathUnGrantRelationLock(Oid relid, LOCKMODE lockmode)
 			result = true;
 		}
 		if (FAST_PATH_GET_BITS(MyProc, f) != 0)
-			++FastPathLocalUseCount;
+			++FastPathLocalUseCounts[group];
 	}
 	return result;
 }
@@ -2199,6 +2233,7 @@ FastPathTransferRelationLocks(LockMethod lockMethodTable, const LOCKTAG *locktag
 {
 	LWLockId		partitionLock = LockHashPartitionLock(hashcode);
 	Oid				relid = locktag->locktag_field2;
+	uint32			group = FAST_PATH_REL_GROUP(relid);
 	uint32			i;
 
 	/*
@@ -2210,7 +2245,7 @@ FastPathTransferRelationLocks(LockMethod lockMethodTable, const LOCKTAG *locktag
 	for (i = 0; i < ProcGlobal->allProcCount; i++)
 	{
 		PGPROC	   *proc = &ProcGlobal->allProcs[i];
-		uint32		f;
+		uint32		j;
 
 		LWLockAcquire(proc->backendLock, LW_EXCLUSIVE);
 
@@ -2235,8 +2270,9 @@ FastPathTransferRelationLocks(LockMethod lockMethodTable, const LOCKTAG *locktag
 			continue;
 		}
 
-		for (f = 0; f < FP_LOCK_SLOTS_PER_BACKEND; f++)
+		for (j = 0; j < FP_LOCK_SLOTS_PER_GROUP; j++)
 		{
+			uint32		f = FAST_PATH_SLOT(group, j);
 			uint32		lockmode;
 
 			/* Look for an allocated slot matching the given relid. */
@@ -2283,12 +2319,14 @@ FastPathGetRelationLockEntry(LOCALLOCK *locallock)
 	PROCLOCK	   *proclock = NULL;
 	LWLockId		partitionLock = LockHashPartitionLock(locallock->hashcode);
 	Oid				relid = locktag->locktag_field2;
-	uint32			f;
+	uint32			group = FAST_PATH_REL_GROUP(relid);
+	uint32			i;
 
 	LWLockAcquire(MyProc->backendLock, LW_EXCLUSIVE);
 
-	for (f = 0; f < FP_LOCK_SLOTS_PER_BACKEND; f++)
+	for (i = 0; i < FP_LOCK_SLOTS_PER_GROUP; i++)
 	{
+		uint32		f = FAST_PATH_SLOT(group, i);
 		uint32		lockmode;
 
 		/* Look for an allocated slot matching the given relid. */
@@ -2422,6 +2460,7 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode)
 	{
 		int			i;
 		Oid			relid = locktag->locktag_field2;
+		uint32		group = FAST_PATH_REL_GROUP(relid);
 		VirtualTransactionId	vxid;
 
 		/*
@@ -2437,7 +2476,7 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode)
 		for (i = 0; i < ProcGlobal->allProcCount; i++)
 		{
 			PGPROC	   *proc = &ProcGlobal->allProcs[i];
-			uint32		f;
+			uint32		j;
 
 			/* A backend never blocks itself */
 			if (proc == MyProc)
@@ -2459,8 +2498,9 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode)
 				continue;
 			}
 
-			for (f = 0; f < FP_LOCK_SLOTS_PER_BACKEND; f++)
+			for (j = 0; j < FP_LOCK_SLOTS_PER_GROUP; j++)
 			{
+				uint32		f = FAST_PATH_SLOT(group, j);
 				uint32		lockmask;
 
 				/* Look for an allocated slot matching the given relid. */
@@ -2572,6 +2612,50 @@ GetLockConflicts(const LOCKTAG *locktag, LOCKMODE lockmode)
 	return vxids;
 }
 
+/*
+ * LockWaiterCount
+ *
+ * Return the number of backends that currently hold or are waiting for the
+ * specified lock.  Only the shared lock table is consulted, so fast-path
+ * locks are not counted; that is fine for the lock types this is used for,
+ * which are never taken via the fast path.
+ *
+ * As with GetLockConflicts, the result may be stale by the time it's
+ * returned; callers should use it only as a hint.
+ */
+int
+LockWaiterCount(const LOCKTAG *locktag)
+{
+	LOCKMETHODID lockmethodid = locktag->locktag_lockmethodid;
+	LOCK	   *lock;
+	bool		found;
+	uint32		hashcode;
+	LWLockId	partitionLock;
+	int			waiters = 0;
+
+	if (lockmethodid <= 0 || lockmethodid >= lengthof(LockMethods))
+		elog(ERROR, "unrecognized lock method: %d", lockmethodid);
+
+	hashcode = LockTagHashCode(locktag);
+	partitionLock = LockHashPartitionLock(hashcode);
+	LWLockAcquire(partitionLock, LW_SHARED);
+
+	lock = (LOCK *) hash_search_with_hash_value(LockMethodLockHash,
+												(const void *) locktag,
+												hashcode,
+												HASH_FIND,
+												&found);
+	if (found)
+	{
+		Assert(lock != NULL);
+		waiters = lock->nRequested;
+	}
+
+	LWLockRelease(partitionLock);
+
+	return waiters;
+}
+
 /*
  * Find a lock in the shared lock table and release it.  It is the caller's
  * responsibility to verify that this is a sane thing to do.  (For example, it
@@ -2825,7 +2909,7 @@ PostPrepare_Locks(TransactionId xid)
 	/*
 	 * Now, scan each lock partition separately.
 	 */
-	for (partition = 0; partition < NUM_LOCK_PARTITIONS; partition++)
+	for (partition = 0; partition < NumLockPartitions; partition++)
 	{
 		LWLockId	partitionLock = FirstLockMgrLock + partition;
 		SHM_QUEUE  *procLocks = &(MyProc->myProcLocks[partition]);
@@ -2945,6 +3029,50 @@ PostPrepare_Locks(TransactionId xid)
 }
 
 
+/*
+ * SetNumLockPartitions
+ *		Choose the number of lock table partitions.
+ *
+ * Contention on the partition locks grows with the number of backends that
+ * can take locks in the main table at once, so scale the number of
+ * partitions with MaxBackends, starting from the historical 16.  The
+ * result depends only on GUCs that can't change after startup, so every
+ * process computes the same value.
+ */
+static void
+SetNumLockPartitions(void)
+{
+	int			nparts = 16;
+
+	while (nparts < MAX_LOCK_PARTITIONS && nparts < MaxBackends / 4)
+		nparts <<= 1;
+
+	NumLockPartitions = nparts;
+}
+
+/*
+ * assign_max_locks_per_xact
+ *		GUC assign hook for max_locks_per_transaction.
+ *
+ * Backends that lock many relations at once (queries over many partitions,
+ * say) are the ones that raise max_locks_per_transaction, and they are
+ * also the ones that overflow the fast-path slots, so we size the latter
+ * from the former: enough groups to hold max_locks_per_transaction locks,
+ * rounded up to a power of 2 so that FAST_PATH_REL_GROUP can mask.  The
+ * setting is PGC_POSTMASTER, so every process computes the same value
+ * before anything is allocated in shared memory.
+ */
+void
+assign_max_locks_per_xact(int newval, void *extra)
+{
+	int			groups = 1;
+
+	while (groups < FP_LOCK_GROUPS_PER_BACKEND_MAX &&
+		   groups * FP_LOCK_SLOTS_PER_GROUP < newval)
+		groups *= 2;
+	FastPathLockGroupsPerBackend = groups;
+}
+
 /*
  * Estimate shared-memory space used for lock tables
  */
@@ -2954,6 +3082,8 @@ LockShmemSize(void)
 	Size		size = 0;
 	long		max_table_size;
 
+	SetNumLockPartitions();
+
 	/* lock hash table */
 	max_table_size = NLOCKENTS();
 	size = add_size(size, hash_estimate_size(max_table_size, sizeof(LOCK)));
@@ -3017,7 +3147,7 @@ GetLockStatusData(void)
 
 		LWLockAcquire(proc->backendLock, LW_SHARED);
 
-		for (f = 0; f < FP_LOCK_SLOTS_PER_BACKEND; ++f)
+		for (f = 0; f < FastPathLockSlotsPerBackend(); ++f)
 		{
 			LockInstanceData   *instance;
 			uint32		lockbits = FAST_PATH_GET_BITS(proc, f);
@@ -3089,7 +3219,7 @@ GetLockStatusData(void)
 	 *
 	 * Must grab LWLocks in partition-number order to avoid LWLock deadlock.
 	 */
-	for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+	for (i = 0; i < NumLockPartitions; i++)
 		LWLockAcquire(FirstLockMgrLock + i, LW_SHARED);
 
 	/* Now we can safely count the number of proclocks */
@@ -3131,7 +3261,7 @@ GetLockStatusData(void)
 	 * until it can get all the locks it needs. (2) This avoids O(N^2)
 	 * behavior inside LWLockRelease.
 	 */
-	for (i = NUM_LOCK_PARTITIONS; --i >= 0;)
+	for (i = NumLockPartitions; --i >= 0;)
 		LWLockRelease(FirstLockMgrLock + i);
 
 	Assert(el == data->nelements);
@@ -3158,7 +3288,7 @@ GetRunningTransactionLocks(int *nlocks)
 	 *
 	 * Must grab LWLocks in partition-number order to avoid LWLock deadlock.
 	 */
-	for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+	for (i = 0; i < NumLockPartitions; i++)
 		LWLockAcquire(FirstLockMgrLock + i, LW_SHARED);
 
 	/* Now scan the tables to copy the data */
@@ -3206,7 +3336,7 @@ GetRunningTransactionLocks(int *nlocks)
 	 * until it can get all the locks it needs. (2) This avoids O(N^2)
 	 * behavior inside LWLockRelease.
 	 */
-	for (i = NUM_LOCK_PARTITIONS; --i >= 0;)
+	for (i = NumLockPartitions; --i >= 0;)
 		LWLockRelease(FirstLockMgrLock + i);
 
 	*nlocks = index;
@@ -3242,7 +3372,7 @@ DumpLocks(PGPROC *proc)
 	if (proc->waitLock)
 		LOCK_PRINT("DumpLocks: waiting on", proc->waitLock, 0);
 
-	for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+	for (i = 0; i < NumLockPartitions; i++)
 	{
 		procLocks = &(proc->myProcLocks[i]);
 
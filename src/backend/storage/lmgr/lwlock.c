@@ -25,24 +25,58 @@
 #include "access/multixact.h"
 #include "access/subtrans.h"
 #include "commands/async.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "pgstat.h"
+#include "storage/barrier.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/spin.h"
+#include "utils/builtins.h"
+#include "utils/tuplestore.h"
 
 
 /* We use the ShmemLock spinlock to protect LWLockAssign */
 extern slock_t *ShmemLock;
 
 
+/*
+ * The lock's state word.  The low 24 bits count shared holders (the
+ * max_connections limit in guc.c keeps that well below 2^24), the next bit
+ * marks an exclusive holder, and the high bits are flags:
+ *
+ * LW_FLAG_HAS_WAITERS is set when the wait queue is nonempty; releasers
+ * only need to look at the queue if it's set.
+ *
+ * LW_FLAG_RELEASE_OK is cleared when a releaser has awakened a waiter that
+ * will retry acquiring the lock, and set again once that waiter has run.
+ * This prevents a stampede of wakeups while the first one hasn't had a
+ * chance to take the lock.
+ *
+ * Acquiring and releasing the lock manipulates the state word with atomic
+ * compare-and-swap and fetch-and-add operations, so uncontended (and, in
+ * particular, purely shared) traffic never touches the spinlock.  The
+ * spinlock only protects the wait queue, and is taken only when we need to
+ * sleep or to wake somebody up.
+ */
+#define LW_FLAG_HAS_WAITERS		((uint32) 1 << 30)
+#define LW_FLAG_RELEASE_OK		((uint32) 1 << 29)
+
+#define LW_VAL_EXCLUSIVE		((uint32) 1 << 24)
+#define LW_VAL_SHARED			1
+
+#define LW_LOCK_MASK			((uint32) ((1 << 25) - 1))
+#define LW_SHARED_MASK			((uint32) ((1 << 24) - 1))
+
 typedef struct LWLock
 {
-	slock_t		mutex;			/* Protects LWLock and queue of PGPROCs */
-	bool		releaseOK;		/* T if ok to release waiters */
-	char		exclusive;		/* # of exclusive holders (0 or 1) */
-	int			shared;			/* # of shared holders (0..MaxBackends) */
+	slock_t		mutex;			/* Protects queue of PGPROCs */
+#ifndef HAVE_GCC_INT_ATOMICS
+	slock_t		state_mutex;	/* Emulates atomic operations on state */
+#endif
+	uint32		state;			/* holders and flags, see above */
 	PGPROC	   *head;			/* head of list of waiting PGPROCs */
 	PGPROC	   *tail;			/* tail of list of waiting PGPROCs */
 	/* tail is undefined when head is NULL */
@@ -68,6 +102,94 @@ typedef union LWLockPadded
 	char		pad[LWLOCK_PADDED_SIZE];
 } LWLockPadded;
 
+/*
+ * Atomic operations on the lock's state word.
+ *
+ * We rely on the GCC __sync builtins where configure found them; they act as
+ * full memory barriers, which is what lock acquisition and release need.
+ * Elsewhere, emulate them with an extra per-lock spinlock.  That is no faster
+ * than the old scheme of protecting everything with one spinlock, but it
+ * keeps the rest of the code identical on all platforms.
+ */
+#ifdef HAVE_GCC_INT_ATOMICS
+
+/*
+ * If the state word equals *expected, replace it with newval and return true.
+ * Otherwise store the current value into *expected and return false.
+ */
+static inline bool
+LWLockStateCAS(volatile LWLock *lock, uint32 *expected, uint32 newval)
+{
+	uint32		current;
+
+	current = __sync_val_compare_and_swap(&lock->state, *expected, newval);
+	if (current == *expected)
+		return true;
+	*expected = current;
+	return false;
+}
+
+#define LWLockStateFetchSub(lock, val) \
+	__sync_fetch_and_sub(&(lock)->state, (val))
+#define LWLockStateFetchOr(lock, bits) \
+	__sync_fetch_and_or(&(lock)->state, (bits))
+#define LWLockStateFetchAnd(lock, bits) \
+	__sync_fetch_and_and(&(lock)->state, (bits))
+
+#else							/* !HAVE_GCC_INT_ATOMICS */
+
+static bool
+LWLockStateCAS(volatile LWLock *lock, uint32 *expected, uint32 newval)
+{
+	bool		ret;
+
+	SpinLockAcquire(&lock->state_mutex);
+	ret = (lock->state == *expected);
+	if (ret)
+		lock->state = newval;
+	else
+		*expected = lock->state;
+	SpinLockRelease(&lock->state_mutex);
+	return ret;
+}
+
+static uint32
+LWLockStateFetchSub(volatile LWLock *lock, uint32 val)
+{
+	uint32		oldstate;
+
+	SpinLockAcquire(&lock->state_mutex);
+	oldstate = lock->state;
+	lock->state = oldstate - val;
+	SpinLockRelease(&lock->state_mutex);
+	return oldstate;
+}
+
+static uint32
+LWLockStateFetchOr(volatile LWLock *lock, uint32 bits)
+{
+	uint32		oldstate;
+
+	SpinLockAcquire(&lock->state_mutex);
+	oldstate = lock->state;
+	lock->state = oldstate | bits;
+	SpinLockRelease(&lock->state_mutex);
+	return oldstate;
+}
+
+static uint32
+LWLockStateFetchAnd(volatile LWLock *lock, uint32 bits)
+{
+	uint32		oldstate;
+
+	SpinLockAcquire(&lock->state_mutex);
+	oldstate = lock->state;
+	lock->state = oldstate & bits;
+	SpinLockRelease(&lock->state_mutex);
+	return oldstate;
+}
+#endif   /* HAVE_GCC_INT_ATOMICS */
+
 /*
  * This points to the array of LWLocks in shared memory.  Backends inherit
  * the pointer by fork from the postmaster (except in the EXEC_BACKEND case,
@@ -90,6 +212,39 @@ static LWLockId held_lwlocks[MAX_SIMUL_LWLOCKS];
 static int	lock_addin_request = 0;
 static bool lock_addin_request_allowed = true;
 
+/*
+ * Cumulative statistics on LWLock usage, shown in pg_stat_lwlocks.  Each
+ * individually named lock has an entry of its own; each group of partition
+ * locks shares one, and so do all the dynamically assigned locks (see
+ * LWLockGroup).
+ *
+ * To keep this cheap enough to be always on, a backend counts in local
+ * memory, and only adds its counts to the shared totals every
+ * LWLOCK_STATS_FLUSH_INTERVAL acquisitions, when it goes idle, and when it
+ * exits.  The shared totals live just after the LWLock array.
+ */
+#define NUM_LWLOCK_GROUPS	(FirstBufMappingLock + 7)
+
+#define LWLOCK_STATS_FLUSH_INTERVAL 4096
+
+typedef struct LWLockGroupStats
+{
+	uint64		acquire_count;	/* attempts to acquire */
+	uint64		contended_count;	/* times we had to sleep */
+	uint64		spin_count;		/* lost races to update the lock state */
+	uint64		wait_time;		/* time spent sleeping, in microseconds */
+} LWLockGroupStats;
+
+typedef struct LWLockSharedStats
+{
+	slock_t		mutex;			/* protects the totals */
+	LWLockGroupStats groups[NUM_LWLOCK_GROUPS];
+} LWLockSharedStats;
+
+static LWLockGroupStats LocalLWLockStats[NUM_LWLOCK_GROUPS];
+static int	lwlock_stats_pending = 0;
+static int	lwlock_stats_for_pid = 0;
+
 #ifdef LWLOCK_STATS
 static int	counts_for_pid = 0;
 static int *sh_acquire_counts;
@@ -97,6 +252,11 @@ static int *ex_acquire_counts;
 static int *block_counts;
 #endif
 
+static bool LWLockAcquireCommon(LWLockId lockid, LWLockMode mode,
+					uint64 *valptr, uint64 val);
+static LWLockGroupStats *LWLockCountAcquire(LWLockId lockid);
+static void LWLockStatsShutdown(int code, Datum arg);
+
 #ifdef LOCK_DEBUG
 bool		Trace_lwlocks = false;
 
@@ -104,10 +264,16 @@ inline static void
 PRINT_LWDEBUG(const char *where, LWLockId lockid, const volatile LWLock *lock)
 {
 	if (Trace_lwlocks)
-		elog(LOG, "%s(%d): excl %d shared %d head %p rOK %d",
+	{
+		uint32		state = lock->state;
+
+		elog(LOG, "%s(%d): excl %d shared %u head %p waiters %d rOK %d",
 			 where, (int) lockid,
-			 (int) lock->exclusive, lock->shared, lock->head,
-			 (int) lock->releaseOK);
+			 (state & LW_VAL_EXCLUSIVE) != 0, state & LW_SHARED_MASK,
+			 lock->head,
+			 (state & LW_FLAG_HAS_WAITERS) != 0,
+			 (state & LW_FLAG_RELEASE_OK) != 0);
+	}
 }
 
 inline static void
@@ -145,6 +311,112 @@ print_lwlock_stats(int code, Datum arg)
 }
 #endif   /* LWLOCK_STATS */
 
+/* Names of the individual LWLocks; this must match enum LWLockId! */
+static const char *const LWLockNames[] = {
+	"BufFreelistLockPlaceholder",	/* formerly BufFreelistLock, see lwlock.h */
+	"ShmemIndexLock",
+	"OidGenLock",
+	"XidGenLock",
+	"ProcArrayLock",
+	"SInvalReadLock",
+	"SInvalWriteLock",
+	"WALBufMappingLock",
+	"WALWriteLock",
+	"ControlFileLock",
+	"CheckpointLock",
+	"CLogControlLock",
+	"SubtransControlLock",
+	"MultiXactGenLock",
+	"MultiXactOffsetControlLock",
+	"MultiXactMemberControlLock",
+	"RelCacheInitLock",
+	"BgWriterCommLock",
+	"TwoPhaseStateLock",
+	"TablespaceCreateLock",
+	"BtreeVacuumLock",
+	"AddinShmemInitLock",
+	"AutovacuumLock",
+	"AutovacuumScheduleLock",
+	"SyncScanLock",
+	"RelationMappingLock",
+	"AsyncCtlLock",
+	"AsyncQueueLock",
+	"SerializableXactHashLock",
+	"SerializableFinishedListLock",
+	"SerializablePredicateLockListLock",
+	"OldSerXidLock",
+	"SyncRepLock",
+	"PgStatDBLock",
+	"PlanCacheStatsLock"
+};
+
+/* Names of the groups of partitioned and dynamically assigned LWLocks */
+static const char *const LWLockGroupNames[] = {
+	"BufMappingLock",
+	"LockMgrLock",
+	"PredicateLockMgrLock",
+	"WALInsertLock",
+	"PgStatLock",
+	"SharedCatCacheLock",
+	"DynamicLWLock"
+};
+
+/*
+ * The wait event id for waiting on an LWLock.  Partitioned locks report
+ * their own id, and share a name; all the dynamically assigned ones (for
+ * buffers, SLRUs and the like) report NumFixedLWLocks, so that the id fits
+ * in a wait event whatever the number of locks.
+ */
+#define LWLockWaitEventId(lockid) \
+	((lockid) < NumFixedLWLocks ? (uint32) (lockid) : (uint32) NumFixedLWLocks)
+
+/*
+ * LWLockGroup - the statistics group of an LWLock
+ *
+ * Individual locks are their own group, numbered like the lock; the groups
+ * of partitioned locks, and the dynamically assigned locks, follow.
+ */
+static inline int
+LWLockGroup(LWLockId lockid)
+{
+	if (lockid < FirstBufMappingLock)
+		return lockid;
+	if (lockid < FirstLockMgrLock)
+		return FirstBufMappingLock;
+	if (lockid < FirstPredicateLockMgrLock)
+		return FirstBufMappingLock + 1;
+	if (lockid < FirstWALInsertLock)
+		return FirstBufMappingLock + 2;
+	if (lockid < FirstPgStatLock)
+		return FirstBufMappingLock + 3;
+	if (lockid < FirstSharedCatCacheLock)
+		return FirstBufMappingLock + 4;
+	if (lockid < NumFixedLWLocks)
+		return FirstBufMappingLock + 5;
+	return FirstBufMappingLock + 6;
+}
+
+static const char *
+LWLockGroupName(int group)
+{
+	Assert(lengthof(LWLockNames) == FirstBufMappingLock);
+	Assert(lengthof(LWLockGroupNames) == NUM_LWLOCK_GROUPS - FirstBufMappingLock);
+
+	if (group < FirstBufMappingLock)
+		return LWLockNames[group];
+	return LWLockGroupNames[group - FirstBufMappingLock];
+}
+
+/*
+ * Return the name of an LWLock, or of the group it belongs to, for display
+ * in pg_stat_activity.
+ */
+const char *
+GetLWLockIdentifier(LWLockId lockid)
+{
+	return LWLockGroupName(LWLockGroup(lockid));
+}
+
 
 /*
  * Compute number of LWLocks to allocate.
@@ -174,10 +446,11 @@ NumLWLocks(void)
 	numLocks += CLOGShmemBuffers();
 
 	/* subtrans.c needs one per SubTrans buffer */
-	numLocks += NUM_SUBTRANS_BUFFERS;
+	numLocks += SUBTRANSShmemBuffers();
 
 	/* multixact.c needs two SLRU areas */
-	numLocks += NUM_MXACTOFFSET_BUFFERS + NUM_MXACTMEMBER_BUFFERS;
+	numLocks += MultiXactOffsetShmemBuffers();
+	numLocks += MultiXactMemberShmemBuffers();
 
 	/* async.c needs one per Async buffer */
 	numLocks += NUM_ASYNC_BUFFERS;
@@ -232,6 +505,9 @@ LWLockShmemSize(void)
 	/* Space for dynamic allocation counter, plus room for alignment. */
 	size = add_size(size, 2 * sizeof(int) + LWLOCK_PADDED_SIZE);
 
+	/* Space for the statistics, after the array */
+	size = add_size(size, sizeof(LWLockSharedStats));
+
 	return size;
 }
 
@@ -246,6 +522,7 @@ CreateLWLocks(void)
 	Size		spaceLocks = LWLockShmemSize();
 	LWLockPadded *lock;
 	int		   *LWLockCounter;
+	LWLockSharedStats *stats;
 	char	   *ptr;
 	int			id;
 
@@ -266,9 +543,10 @@ CreateLWLocks(void)
 	for (id = 0, lock = LWLockArray; id < numLocks; id++, lock++)
 	{
 		SpinLockInit(&lock->lock.mutex);
-		lock->lock.releaseOK = true;
-		lock->lock.exclusive = 0;
-		lock->lock.shared = 0;
+#ifndef HAVE_GCC_INT_ATOMICS
+		SpinLockInit(&lock->lock.state_mutex);
+#endif
+		lock->lock.state = LW_FLAG_RELEASE_OK;
 		lock->lock.head = NULL;
 		lock->lock.tail = NULL;
 	}
@@ -280,6 +558,184 @@ CreateLWLocks(void)
 	LWLockCounter = (int *) ((char *) LWLockArray - 2 * sizeof(int));
 	LWLockCounter[0] = (int) NumFixedLWLocks;
 	LWLockCounter[1] = numLocks;
+
+	/* Initialize the statistics, which are stored just after the last one */
+	stats = (LWLockSharedStats *) (LWLockArray + numLocks);
+	SpinLockInit(&stats->mutex);
+	MemSet(stats->groups, 0, sizeof(stats->groups));
+}
+
+/*
+ * Get the shared LWLock statistics, or NULL if the locks aren't set up yet.
+ */
+static volatile LWLockSharedStats *
+LWLockGetSharedStats(void)
+{
+	int		   *LWLockCounter;
+
+	if (LWLockArray == NULL)
+		return NULL;
+	LWLockCounter = (int *) ((char *) LWLockArray - 2 * sizeof(int));
+	return (LWLockSharedStats *) (LWLockArray + LWLockCounter[1]);
+}
+
+/*
+ * LWLockCountAcquire - count an attempt to acquire an LWLock
+ *
+ * Returns the local statistics entry for the lock, for the caller to count
+ * any spins and sleeps in.
+ */
+static LWLockGroupStats *
+LWLockCountAcquire(LWLockId lockid)
+{
+	LWLockGroupStats *stats;
+
+	/* Set up local count state first time through in a given process */
+	if (lwlock_stats_for_pid != MyProcPid)
+	{
+		MemSet(LocalLWLockStats, 0, sizeof(LocalLWLockStats));
+		lwlock_stats_pending = 0;
+		lwlock_stats_for_pid = MyProcPid;
+		if (IsUnderPostmaster)
+			on_shmem_exit(LWLockStatsShutdown, 0);
+	}
+
+	stats = &LocalLWLockStats[LWLockGroup(lockid)];
+	stats->acquire_count++;
+
+	if (++lwlock_stats_pending >= LWLOCK_STATS_FLUSH_INTERVAL)
+		LWLockFlushStats();
+
+	return stats;
+}
+
+/*
+ * LWLockFlushStats - add this backend's LWLock statistics to the totals
+ *
+ * Besides being called every so many acquisitions, this is called by
+ * pgstat_report_stat when the backend goes idle.
+ */
+void
+LWLockFlushStats(void)
+{
+	volatile LWLockSharedStats *shared = LWLockGetSharedStats();
+	int			i;
+
+	if (shared == NULL || lwlock_stats_for_pid != MyProcPid)
+		return;
+
+	SpinLockAcquire(&shared->mutex);
+	for (i = 0; i < NUM_LWLOCK_GROUPS; i++)
+	{
+		LWLockGroupStats *local = &LocalLWLockStats[i];
+
+		if (local->acquire_count == 0 && local->contended_count == 0)
+			continue;
+		shared->groups[i].acquire_count += local->acquire_count;
+		shared->groups[i].contended_count += local->contended_count;
+		shared->groups[i].spin_count += local->spin_count;
+		shared->groups[i].wait_time += local->wait_time;
+	}
+	SpinLockRelease(&shared->mutex);
+
+	MemSet(LocalLWLockStats, 0, sizeof(LocalLWLockStats));
+	lwlock_stats_pending = 0;
+}
+
+/*
+ * Flush the statistics at process exit.
+ */
+static void
+LWLockStatsShutdown(int code, Datum arg)
+{
+	LWLockFlushStats();
+}
+
+/*
+ * LWLockResetStats - zero the shared LWLock statistics
+ */
+void
+LWLockResetStats(void)
+{
+	volatile LWLockSharedStats *shared = LWLockGetSharedStats();
+
+	SpinLockAcquire(&shared->mutex);
+	MemSet((char *) shared->groups, 0, sizeof(shared->groups));
+	SpinLockRelease(&shared->mutex);
+}
+
+/*
+ * pg_stat_get_lwlocks - SQL-callable function to show LWLock statistics
+ *
+ * The counts of other backends show up after at most
+ * LWLOCK_STATS_FLUSH_INTERVAL acquisitions, or once they go idle; our own
+ * are flushed first.
+ */
+Datum
+pg_stat_get_lwlocks(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	volatile LWLockSharedStats *shared = LWLockGetSharedStats();
+	LWLockGroupStats groups[NUM_LWLOCK_GROUPS];
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Take a consistent copy of the totals */
+	LWLockFlushStats();
+	SpinLockAcquire(&shared->mutex);
+	memcpy(groups, (char *) shared->groups, sizeof(groups));
+	SpinLockRelease(&shared->mutex);
+
+	for (i = 0; i < NUM_LWLOCK_GROUPS; i++)
+	{
+		Datum		values[5];
+		bool		nulls[5];
+
+		if (i == BufFreelistLockPlaceholder)
+			continue;
+
+		MemSet(nulls, 0, sizeof(nulls));
+		values[0] = CStringGetTextDatum(LWLockGroupName(i));
+		values[1] = Int64GetDatum((int64) groups[i].acquire_count);
+		values[2] = Int64GetDatum((int64) groups[i].contended_count);
+		values[3] = Int64GetDatum((int64) groups[i].spin_count);
+		values[4] = Float8GetDatum((double) groups[i].wait_time / 1000.0);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
 }
 
 
@@ -313,173 +769,430 @@ LWLockAssign(void)
 
 
 /*
- * LWLockAcquire - acquire a lightweight lock in the specified mode
- *
- * If the lock is not available, sleep until it is.
+ * LWLockAttemptLock - try to grab the lock in the given mode
  *
- * Side effect: cancel/die interrupts are held off until lock release.
+ * This never blocks; it's the caller's job to queue up and sleep if the
+ * lock isn't free.  Returns TRUE if the lock is held by somebody else and we
+ * must wait, FALSE if we got it.  Races lost to other backends updating the
+ * lock state are counted in *stats.
  */
-void
-LWLockAcquire(LWLockId lockid, LWLockMode mode)
+static bool
+LWLockAttemptLock(volatile LWLock *lock, LWLockMode mode,
+				  LWLockGroupStats *stats)
 {
-	volatile LWLock *lock = &(LWLockArray[lockid].lock);
-	PGPROC	   *proc = MyProc;
-	bool		retry = false;
-	int			extraWaits = 0;
-
-	PRINT_LWDEBUG("LWLockAcquire", lockid, lock);
-
-#ifdef LWLOCK_STATS
-	/* Set up local count state first time through in a given process */
-	if (counts_for_pid != MyProcPid)
-	{
-		int		   *LWLockCounter = (int *) ((char *) LWLockArray - 2 * sizeof(int));
-		int			numLocks = LWLockCounter[1];
-
-		sh_acquire_counts = calloc(numLocks, sizeof(int));
-		ex_acquire_counts = calloc(numLocks, sizeof(int));
-		block_counts = calloc(numLocks, sizeof(int));
-		counts_for_pid = MyProcPid;
-		on_shmem_exit(print_lwlock_stats, 0);
-	}
-	/* Count lock acquisition attempts */
-	if (mode == LW_EXCLUSIVE)
-		ex_acquire_counts[lockid]++;
-	else
-		sh_acquire_counts[lockid]++;
-#endif   /* LWLOCK_STATS */
-
-	/*
-	 * We can't wait if we haven't got a PGPROC.  This should only occur
-	 * during bootstrap or shared memory initialization.  Put an Assert here
-	 * to catch unsafe coding practices.
-	 */
-	Assert(!(proc == NULL && IsUnderPostmaster));
-
-	/* Ensure we will have room to remember the lock */
-	if (num_held_lwlocks >= MAX_SIMUL_LWLOCKS)
-		elog(ERROR, "too many LWLocks taken");
-
-	/*
-	 * Lock out cancel/die interrupts until we exit the code section protected
-	 * by the LWLock.  This ensures that interrupts will not interfere with
-	 * manipulations of data structures in shared memory.
-	 */
-	HOLD_INTERRUPTS();
+	uint32		oldstate = lock->state;
 
-	/*
-	 * Loop here to try to acquire lock after each time we are signaled by
-	 * LWLockRelease.
-	 *
-	 * NOTE: it might seem better to have LWLockRelease actually grant us the
-	 * lock, rather than retrying and possibly having to go back to sleep. But
-	 * in practice that is no good because it means a process swap for every
-	 * lock acquisition when two or more processes are contending for the same
-	 * lock.  Since LWLocks are normally used to protect not-very-long
-	 * sections of computation, a process needs to be able to acquire and
-	 * release the same lock many times during a single CPU time slice, even
-	 * in the presence of contention.  The efficiency of being able to do that
-	 * outweighs the inefficiency of sometimes wasting a process dispatch
-	 * cycle because the lock is not free when a released waiter finally gets
-	 * to run.	See pgsql-hackers archives for 29-Dec-01.
-	 */
 	for (;;)
 	{
-		bool		mustwait;
-
-		/* Acquire mutex.  Time spent holding mutex should be short! */
-		SpinLockAcquire(&lock->mutex);
+		uint32		newstate = oldstate;
 
-		/* If retrying, allow LWLockRelease to release waiters again */
-		if (retry)
-			lock->releaseOK = true;
-
-		/* If I can get the lock, do so quickly. */
 		if (mode == LW_EXCLUSIVE)
 		{
-			if (lock->exclusive == 0 && lock->shared == 0)
-			{
-				lock->exclusive++;
-				mustwait = false;
-			}
-			else
-				mustwait = true;
+			if ((oldstate & LW_LOCK_MASK) != 0)
+				return true;
+			newstate += LW_VAL_EXCLUSIVE;
 		}
 		else
 		{
-			if (lock->exclusive == 0)
-			{
-				lock->shared++;
-				mustwait = false;
-			}
-			else
-				mustwait = true;
+			if ((oldstate & LW_VAL_EXCLUSIVE) != 0)
+				return true;
+			newstate += LW_VAL_SHARED;
 		}
 
-		if (!mustwait)
-			break;				/* got the lock */
+		/* On failure, oldstate now holds the current value; try again */
+		if (LWLockStateCAS(lock, &oldstate, newstate))
+			return false;
+		stats->spin_count++;
+	}
+}
 
-		/*
-		 * Add myself to wait queue.
-		 *
-		 * If we don't have a PGPROC structure, there's no way to wait. This
-		 * should never occur, since MyProc should only be null during shared
-		 * memory initialization.
-		 */
-		if (proc == NULL)
-			elog(PANIC, "cannot wait without a PGPROC structure");
+/*
+ * LWLockQueueSelf - add myself to the lock's wait queue
+ *
+ * Setting LW_FLAG_HAS_WAITERS is a full memory barrier, so a releaser that
+ * decrements the state after this point is certain to see the flag and wake
+ * us.  The caller must therefore retry LWLockAttemptLock once more after
+ * queueing, and not sleep unless that fails too.
+ *
+ * LW_WAIT_UNTIL_FREE waiters go to the front of the queue, everyone else to
+ * the back.
+ */
+static void
+LWLockQueueSelf(volatile LWLock *lock, LWLockMode mode)
+{
+	PGPROC	   *proc = MyProc;
+
+	/*
+	 * If we don't have a PGPROC structure, there's no way to wait. This
+	 * should never occur, since MyProc should only be null during shared
+	 * memory initialization.
+	 */
+	if (proc == NULL)
+		elog(PANIC, "cannot wait without a PGPROC structure");
+
+	/* Acquire mutex.  Time spent holding mutex should be short! */
+	SpinLockAcquire(&lock->mutex);
 
-		proc->lwWaiting = true;
-		proc->lwExclusive = (mode == LW_EXCLUSIVE);
+	LWLockStateFetchOr(lock, LW_FLAG_HAS_WAITERS);
+
+	proc->lwWaiting = true;
+	proc->lwWaitMode = mode;
+	if (mode == LW_WAIT_UNTIL_FREE)
+	{
+		proc->lwWaitLink = lock->head;
+		if (lock->head == NULL)
+			lock->tail = proc;
+		lock->head = proc;
+	}
+	else
+	{
 		proc->lwWaitLink = NULL;
 		if (lock->head == NULL)
 			lock->head = proc;
 		else
 			lock->tail->lwWaitLink = proc;
 		lock->tail = proc;
+	}
 
-		/* Can release the mutex now */
-		SpinLockRelease(&lock->mutex);
-
-		/*
-		 * Wait until awakened.
-		 *
-		 * Since we share the process wait semaphore with the regular lock
-		 * manager and ProcWaitForSignal, and we may need to acquire an LWLock
-		 * while one of those is pending, it is possible that we get awakened
-		 * for a reason other than being signaled by LWLockRelease. If so,
-		 * loop back and wait again.  Once we've gotten the LWLock,
-		 * re-increment the sema by the number of additional signals received,
-		 * so that the lock manager or signal manager will see the received
-		 * signal when it next waits.
-		 */
-		LOG_LWDEBUG("LWLockAcquire", lockid, "waiting");
+	SpinLockRelease(&lock->mutex);
+}
 
-#ifdef LWLOCK_STATS
-		block_counts[lockid]++;
-#endif
+/*
+ * LWLockDequeueSelf - remove myself from the wait queue again
+ *
+ * Used when LWLockAttemptLock succeeds after we had already queued up.  A
+ * releaser may have removed us from the queue in the meantime, in which case
+ * a wakeup is on its way and we must absorb it before returning.
+ */
+static void
+LWLockDequeueSelf(volatile LWLock *lock)
+{
+	PGPROC	   *proc = MyProc;
+	PGPROC	   *prev = NULL;
+	PGPROC	   *cur;
+	bool		found = false;
 
-		TRACE_POSTGRESQL_LWLOCK_WAIT_START(lockid, mode);
+	SpinLockAcquire(&lock->mutex);
 
-		for (;;)
+	for (cur = lock->head; cur != NULL; prev = cur, cur = cur->lwWaitLink)
+	{
+		if (cur == proc)
 		{
-			/* "false" means cannot accept cancel/die interrupt here. */
-			PGSemaphoreLock(&proc->sem, false);
-			if (!proc->lwWaiting)
-				break;
-			extraWaits++;
+			if (prev == NULL)
+				lock->head = cur->lwWaitLink;
+			else
+				prev->lwWaitLink = cur->lwWaitLink;
+			if (lock->tail == cur)
+				lock->tail = prev;
+			found = true;
+			break;
+		}
+	}
+
+	if (lock->head == NULL)
+		LWLockStateFetchAnd(lock, ~LW_FLAG_HAS_WAITERS);
+
+	SpinLockRelease(&lock->mutex);
+
+	if (found)
+	{
+		proc->lwWaitLink = NULL;
+		proc->lwWaiting = false;
+	}
+	else
+	{
+		int			extraWaits = 0;
+
+		/*
+		 * Whoever dequeued us cleared releaseOK on the expectation that we'd
+		 * retry; we won't, so set it again.  Then wait for the wakeup, and
+		 * fix the semaphore count for any others absorbed while doing so.
+		 */
+		LWLockStateFetchOr(lock, LW_FLAG_RELEASE_OK);
+
+		for (;;)
+		{
+			/* "false" means cannot accept cancel/die interrupt here. */
+			PGSemaphoreLock(&proc->sem, false);
+			if (!proc->lwWaiting)
+				break;
+			extraWaits++;
 		}
 
-		TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(lockid, mode);
+		while (extraWaits-- > 0)
+			PGSemaphoreUnlock(&proc->sem);
+	}
+}
+
+/*
+ * LWLockWakeup - wake the waiters entitled to run after the lock is freed
+ *
+ * First wake up any backends that just want to be woken up when the lock
+ * becomes free, without acquiring it; those are at the front of the queue.
+ * Then, if the next waiter wants exclusive lock, awaken him only, otherwise
+ * awaken as many waiters as want shared access.
+ */
+static void
+LWLockWakeup(volatile LWLock *lock, LWLockId lockid)
+{
+	PGPROC	   *head;
+	PGPROC	   *last = NULL;
+	PGPROC	   *proc;
+	bool		releaseOK = true;
+	bool		wokeLocker = false;
+
+	/* Acquire mutex.  Time spent holding mutex should be short! */
+	SpinLockAcquire(&lock->mutex);
+
+	head = lock->head;
+	for (proc = head; proc != NULL; proc = proc->lwWaitLink)
+	{
+		if (proc->lwWaitMode == LW_EXCLUSIVE && wokeLocker)
+			break;
+		last = proc;
+		if (proc->lwWaitMode != LW_WAIT_UNTIL_FREE)
+		{
+			/*
+			 * Prevent additional wakeups until retryer gets to run. Backends
+			 * that are just waiting for the lock to become free don't retry
+			 * automatically.
+			 */
+			releaseOK = false;
+			wokeLocker = true;
+			if (proc->lwWaitMode == LW_EXCLUSIVE)
+				break;
+		}
+	}
+
+	/* last is now the last PGPROC to be released */
+	if (last != NULL)
+	{
+		lock->head = last->lwWaitLink;
+		last->lwWaitLink = NULL;
+	}
+	else
+		head = NULL;
+
+	if (lock->head == NULL)
+		LWLockStateFetchAnd(lock, ~LW_FLAG_HAS_WAITERS);
+	if (releaseOK)
+		LWLockStateFetchOr(lock, LW_FLAG_RELEASE_OK);
+	else
+		LWLockStateFetchAnd(lock, ~LW_FLAG_RELEASE_OK);
+
+	/* We are done updating the queue. */
+	SpinLockRelease(&lock->mutex);
+
+	/*
+	 * Awaken any waiters I removed from the queue.  Make sure the link is
+	 * cleared before the waiter can see lwWaiting go false, since it may
+	 * queue itself again straight away.
+	 */
+	while (head != NULL)
+	{
+		LOG_LWDEBUG("LWLockRelease", lockid, "release waiter");
+		proc = head;
+		head = proc->lwWaitLink;
+		proc->lwWaitLink = NULL;
+		pg_write_barrier();
+		proc->lwWaiting = false;
+		PGSemaphoreUnlock(&proc->sem);
+	}
+}
+
+/*
+ * LWLockSleep - sleep on my semaphore until a releaser dequeues and wakes me
+ *
+ * Since we share the process wait semaphore with the regular lock manager
+ * and ProcWaitForSignal, and we may need to acquire an LWLock while one of
+ * those is pending, it is possible that we get awakened for a reason other
+ * than being signaled by LWLockRelease.  If so, loop back and wait again.
+ * The number of additional signals received is added to *extraWaits; the
+ * caller must re-increment the sema by that much once it's done, so that the
+ * lock manager or signal manager will see the received signal when it next
+ * waits.
+ */
+static void
+LWLockSleep(LWLockId lockid, LWLockMode mode, int *extraWaits)
+{
+	PGPROC	   *proc = MyProc;
+	uint32		outer_wait_event = proc->wait_event_info;
+	LWLockGroupStats *stats = &LocalLWLockStats[LWLockGroup(lockid)];
+	instr_time	start_time;
+	instr_time	wait_time;
+
+#ifdef LWLOCK_STATS
+	block_counts[lockid]++;
+#endif
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	TRACE_POSTGRESQL_LWLOCK_WAIT_START(lockid, mode);
+	pgstat_report_wait_start(PG_WAIT_LWLOCK | LWLockWaitEventId(lockid));
+
+	for (;;)
+	{
+		/* "false" means cannot accept cancel/die interrupt here. */
+		PGSemaphoreLock(&proc->sem, false);
+		if (!proc->lwWaiting)
+			break;
+		(*extraWaits)++;
+	}
+
+	/* We may have been waiting for a heavyweight lock, say, meanwhile */
+	pgstat_report_wait_start(outer_wait_event);
+	TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(lockid, mode);
+
+	INSTR_TIME_SET_CURRENT(wait_time);
+	INSTR_TIME_SUBTRACT(wait_time, start_time);
+	stats->contended_count++;
+	stats->wait_time += INSTR_TIME_GET_MICROSEC(wait_time);
+}
+
+
+/*
+ * LWLockAcquire - acquire a lightweight lock in the specified mode
+ *
+ * If the lock is not available, sleep until it is.
+ *
+ * Side effect: cancel/die interrupts are held off until lock release.
+ */
+void
+LWLockAcquire(LWLockId lockid, LWLockMode mode)
+{
+	(void) LWLockAcquireCommon(lockid, mode, NULL, 0);
+}
+
+/*
+ * LWLockAcquireWithVar - like LWLockAcquire, but also sets *valptr = val
+ *
+ * The lock is always acquired in exclusive mode with this function.  The
+ * variable is set just after the lock is taken.  Note that a concurrent
+ * LWLockWaitForVar() may see the lock as taken before the new value has
+ * been stored, and then gets the value left behind by the previous holder;
+ * callers must be prepared to cope with that.
+ *
+ * Returns TRUE if the lock was available immediately, FALSE if we had to
+ * sleep.
+ */
+bool
+LWLockAcquireWithVar(LWLockId lockid, uint64 *valptr, uint64 val)
+{
+	return LWLockAcquireCommon(lockid, LW_EXCLUSIVE, valptr, val);
+}
+
+/* internal function to implement LWLockAcquire and LWLockAcquireWithVar */
+static bool
+LWLockAcquireCommon(LWLockId lockid, LWLockMode mode, uint64 *valptr,
+					uint64 val)
+{
+	volatile LWLock *lock = &(LWLockArray[lockid].lock);
+	PGPROC	   *proc = MyProc;
+	bool		result = true;
+	int			extraWaits = 0;
+	LWLockGroupStats *stats;
+
+	PRINT_LWDEBUG("LWLockAcquire", lockid, lock);
+
+	stats = LWLockCountAcquire(lockid);
+
+#ifdef LWLOCK_STATS
+	/* Set up local count state first time through in a given process */
+	if (counts_for_pid != MyProcPid)
+	{
+		int		   *LWLockCounter = (int *) ((char *) LWLockArray - 2 * sizeof(int));
+		int			numLocks = LWLockCounter[1];
+
+		sh_acquire_counts = calloc(numLocks, sizeof(int));
+		ex_acquire_counts = calloc(numLocks, sizeof(int));
+		block_counts = calloc(numLocks, sizeof(int));
+		counts_for_pid = MyProcPid;
+		on_shmem_exit(print_lwlock_stats, 0);
+	}
+	/* Count lock acquisition attempts */
+	if (mode == LW_EXCLUSIVE)
+		ex_acquire_counts[lockid]++;
+	else
+		sh_acquire_counts[lockid]++;
+#endif   /* LWLOCK_STATS */
+
+	/*
+	 * We can't wait if we haven't got a PGPROC.  This should only occur
+	 * during bootstrap or shared memory initialization.  Put an Assert here
+	 * to catch unsafe coding practices.
+	 */
+	Assert(!(proc == NULL && IsUnderPostmaster));
+
+	/* Ensure we will have room to remember the lock */
+	if (num_held_lwlocks >= MAX_SIMUL_LWLOCKS)
+		elog(ERROR, "too many LWLocks taken");
+
+	/*
+	 * Lock out cancel/die interrupts until we exit the code section protected
+	 * by the LWLock.  This ensures that interrupts will not interfere with
+	 * manipulations of data structures in shared memory.
+	 */
+	HOLD_INTERRUPTS();
+
+	/*
+	 * Loop here to try to acquire lock after each time we are signaled by
+	 * LWLockRelease.
+	 *
+	 * NOTE: it might seem better to have LWLockRelease actually grant us the
+	 * lock, rather than retrying and possibly having to go back to sleep. But
+	 * in practice that is no good because it means a process swap for every
+	 * lock acquisition when two or more processes are contending for the same
+	 * lock.  Since LWLocks are normally used to protect not-very-long
+	 * sections of computation, a process needs to be able to acquire and
+	 * release the same lock many times during a single CPU time slice, even
+	 * in the presence of contention.  The efficiency of being able to do that
+	 * outweighs the inefficiency of sometimes wasting a process dispatch
+	 * cycle because the lock is not free when a released waiter finally gets
+	 * to run.	See pgsql-hackers archives for 29-Dec-01.
+	 */
+	for (;;)
+	{
+		/* If I can get the lock, do so quickly. */
+		if (!LWLockAttemptLock(lock, mode, stats))
+			break;				/* got the lock */
+
+		/*
+		 * Add myself to wait queue, then check once more: the lock may have
+		 * been released before the releaser could see us in the queue.
+		 */
+		LWLockQueueSelf(lock, mode);
+
+		if (!LWLockAttemptLock(lock, mode, stats))
+		{
+			LWLockDequeueSelf(lock);
+			break;				/* got the lock */
+		}
+
+		/* Wait until awakened. */
+		LOG_LWDEBUG("LWLockAcquire", lockid, "waiting");
+
+		LWLockSleep(lockid, mode, &extraWaits);
 
 		LOG_LWDEBUG("LWLockAcquire", lockid, "awakened");
 
+		/* Retrying, allow LWLockRelease to release waiters again. */
+		LWLockStateFetchOr(lock, LW_FLAG_RELEASE_OK);
+
 		/* Now loop back and try to acquire lock again. */
-		retry = true;
+		result = false;
 	}
 
-	/* We are done updating shared state of the lock itself. */
-	SpinLockRelease(&lock->mutex);
+	/*
+	 * If there's a variable associated with this lock, initialize it.  We
+	 * set it while holding the mutex, which LWLockWaitForVar also takes to
+	 * read it.
+	 */
+	if (valptr)
+	{
+		SpinLockAcquire(&lock->mutex);
+		*((volatile uint64 *) valptr) = val;
+		SpinLockRelease(&lock->mutex);
+	}
 
 	TRACE_POSTGRESQL_LWLOCK_ACQUIRE(lockid, mode);
 
@@ -491,6 +1204,8 @@ LWLockAcquire(LWLockId lockid, LWLockMode mode)
 	 */
 	while (extraWaits-- > 0)
 		PGSemaphoreUnlock(&proc->sem);
+
+	return result;
 }
 
 /*
@@ -505,9 +1220,12 @@ LWLockConditionalAcquire(LWLockId lockid, LWLockMode mode)
 {
 	volatile LWLock *lock = &(LWLockArray[lockid].lock);
 	bool		mustwait;
+	LWLockGroupStats *stats;
 
 	PRINT_LWDEBUG("LWLockConditionalAcquire", lockid, lock);
 
+	stats = LWLockCountAcquire(lockid);
+
 	/* Ensure we will have room to remember the lock */
 	if (num_held_lwlocks >= MAX_SIMUL_LWLOCKS)
 		elog(ERROR, "too many LWLocks taken");
@@ -519,60 +1237,351 @@ LWLockConditionalAcquire(LWLockId lockid, LWLockMode mode)
 	 */
 	HOLD_INTERRUPTS();
 
-	/* Acquire mutex.  Time spent holding mutex should be short! */
-	SpinLockAcquire(&lock->mutex);
-
 	/* If I can get the lock, do so quickly. */
-	if (mode == LW_EXCLUSIVE)
+	mustwait = LWLockAttemptLock(lock, mode, stats);
+
+	if (mustwait)
 	{
-		if (lock->exclusive == 0 && lock->shared == 0)
-		{
-			lock->exclusive++;
-			mustwait = false;
-		}
-		else
-			mustwait = true;
+		/* Failed to get lock, so release interrupt holdoff */
+		RESUME_INTERRUPTS();
+		LOG_LWDEBUG("LWLockConditionalAcquire", lockid, "failed");
+		TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE_FAIL(lockid, mode);
+	}
+	else
+	{
+		/* Add lock to list of locks held by this backend */
+		held_lwlocks[num_held_lwlocks++] = lockid;
+		TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE(lockid, mode);
 	}
+
+	return !mustwait;
+}
+
+/*
+ * LWLockAcquireOrWait - Acquire lock, or wait until it's free
+ *
+ * The semantics of this function are a bit funky.  If the lock is currently
+ * free, it is acquired in the given mode, and the function returns true.  If
+ * the lock isn't immediately free, the function waits until it is released
+ * and returns false, but does not acquire the lock.
+ *
+ * This is currently used for WALWriteLock: when a backend flushes the WAL,
+ * holding WALWriteLock, it can flush the commit records of many other
+ * backends as a side-effect.  Those other backends need to wait until the
+ * flush finishes, but don't need to acquire the lock anymore.  They can just
+ * wake up, observe that their records have already been flushed, and return.
+ */
+bool
+LWLockAcquireOrWait(LWLockId lockid, LWLockMode mode)
+{
+	volatile LWLock *lock = &(LWLockArray[lockid].lock);
+	PGPROC	   *proc = MyProc;
+	bool		mustwait;
+	int			extraWaits = 0;
+	LWLockGroupStats *stats;
+
+	PRINT_LWDEBUG("LWLockAcquireOrWait", lockid, lock);
+
+	stats = LWLockCountAcquire(lockid);
+
+#ifdef LWLOCK_STATS
+	/* Set up local count state first time through in a given process */
+	if (counts_for_pid != MyProcPid)
+	{
+		int		   *LWLockCounter = (int *) ((char *) LWLockArray - 2 * sizeof(int));
+		int			numLocks = LWLockCounter[1];
+
+		sh_acquire_counts = calloc(numLocks, sizeof(int));
+		ex_acquire_counts = calloc(numLocks, sizeof(int));
+		block_counts = calloc(numLocks, sizeof(int));
+		counts_for_pid = MyProcPid;
+		on_shmem_exit(print_lwlock_stats, 0);
+	}
+	/* Count lock acquisition attempts */
+	if (mode == LW_EXCLUSIVE)
+		ex_acquire_counts[lockid]++;
 	else
+		sh_acquire_counts[lockid]++;
+#endif   /* LWLOCK_STATS */
+
+	/* Ensure we will have room to remember the lock */
+	if (num_held_lwlocks >= MAX_SIMUL_LWLOCKS)
+		elog(ERROR, "too many LWLocks taken");
+
+	/*
+	 * Lock out cancel/die interrupts until we exit the code section protected
+	 * by the LWLock.  This ensures that interrupts will not interfere with
+	 * manipulations of data structures in shared memory.
+	 */
+	HOLD_INTERRUPTS();
+
+	/* If I can get the lock, do so quickly. */
+	mustwait = LWLockAttemptLock(lock, mode, stats);
+
+	if (mustwait)
 	{
-		if (lock->exclusive == 0)
+		/*
+		 * Add myself to wait queue, then check once more: the lock may have
+		 * been released before the releaser could see us in the queue.
+		 */
+		LWLockQueueSelf(lock, LW_WAIT_UNTIL_FREE);
+
+		mustwait = LWLockAttemptLock(lock, mode, stats);
+
+		if (mustwait)
 		{
-			lock->shared++;
-			mustwait = false;
+			/*
+			 * Wait until awakened.  Like in LWLockAcquire, be prepared for
+			 * bogus wakeups, because we share the semaphore with
+			 * ProcWaitForSignal.
+			 */
+			LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "waiting");
+
+			LWLockSleep(lockid, mode, &extraWaits);
+
+			LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "awakened");
 		}
 		else
-			mustwait = true;
+		{
+			/* Got the lock on the second try after all; undo queueing */
+			LWLockDequeueSelf(lock);
+		}
 	}
 
-	/* We are done updating shared state of the lock itself. */
-	SpinLockRelease(&lock->mutex);
+	/*
+	 * Fix the process wait semaphore's count for any absorbed wakeups.
+	 */
+	while (extraWaits-- > 0)
+		PGSemaphoreUnlock(&proc->sem);
 
 	if (mustwait)
 	{
 		/* Failed to get lock, so release interrupt holdoff */
 		RESUME_INTERRUPTS();
-		LOG_LWDEBUG("LWLockConditionalAcquire", lockid, "failed");
-		TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE_FAIL(lockid, mode);
+		LOG_LWDEBUG("LWLockAcquireOrWait", lockid, "failed");
+		TRACE_POSTGRESQL_LWLOCK_WAIT_UNTIL_FREE_FAIL(lockid, mode);
 	}
 	else
 	{
 		/* Add lock to list of locks held by this backend */
 		held_lwlocks[num_held_lwlocks++] = lockid;
-		TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE(lockid, mode);
+		TRACE_POSTGRESQL_LWLOCK_WAIT_UNTIL_FREE(lockid, mode);
 	}
 
 	return !mustwait;
 }
 
 /*
- * LWLockRelease - release a previously acquired lock
+ * LWLockConflictsWithVar - helper for LWLockWaitForVar
+ *
+ * Returns TRUE if the lock is held exclusively and *valptr still equals
+ * oldval, ie. if we need to keep waiting.  Otherwise sets *result to tell
+ * whether the lock was free, and if it isn't, stores the new value of the
+ * variable in *newval.
+ */
+static bool
+LWLockConflictsWithVar(volatile LWLock *lock, uint64 *valptr, uint64 oldval,
+					   uint64 *newval, bool *result)
+{
+	uint64		value;
+
+	/*
+	 * Test first to see if the lock is free right now.
+	 *
+	 * XXX: the caller uses a spinlock before this, so we don't need a memory
+	 * barrier here as far as the current usage is concerned.  But that might
+	 * not be safe in general.
+	 */
+	if ((lock->state & LW_VAL_EXCLUSIVE) == 0)
+	{
+		*result = true;
+		return false;
+	}
+
+	*result = false;
+
+	/*
+	 * Read the value under the mutex, which is also held by anyone setting
+	 * it, so that we don't see a torn 64-bit value.
+	 */
+	SpinLockAcquire(&lock->mutex);
+	value = *((volatile uint64 *) valptr);
+	SpinLockRelease(&lock->mutex);
+
+	if (value != oldval)
+	{
+		*newval = value;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * LWLockWaitForVar - Wait until lock is free, or a variable is updated.
+ *
+ * If the lock is held and *valptr equals oldval, waits until the lock is
+ * either freed, or the lock holder updates *valptr by calling
+ * LWLockUpdateVar.  If the lock is free on exit (immediately or after
+ * waiting), returns TRUE.  If the lock is still held, but *valptr no longer
+ * matches oldval, returns FALSE and sets *newval to the current value in
+ * *valptr.
+ *
+ * Note: this function ignores shared lock holders; if the lock is held
+ * in shared mode, returns 'true'.
+ */
+bool
+LWLockWaitForVar(LWLockId lockid, uint64 *valptr, uint64 oldval,
+				 uint64 *newval)
+{
+	volatile LWLock *lock = &(LWLockArray[lockid].lock);
+	PGPROC	   *proc = MyProc;
+	int			extraWaits = 0;
+	bool		result = false;
+
+	PRINT_LWDEBUG("LWLockWaitForVar", lockid, lock);
+
+	/* Quick test first to see if we need to wait at all. */
+	if (!LWLockConflictsWithVar(lock, valptr, oldval, newval, &result))
+		return result;
+
+	/*
+	 * Lock out cancel/die interrupts while we sleep on the lock.  There is
+	 * no cleanup mechanism to remove us from the wait queue if we got
+	 * interrupted.
+	 */
+	HOLD_INTERRUPTS();
+
+	/*
+	 * Loop here to check the lock's status after each time we are signaled.
+	 */
+	for (;;)
+	{
+		/* Add myself to wait queue. */
+		LWLockQueueSelf(lock, LW_WAIT_UNTIL_FREE);
+
+		/*
+		 * Make sure the holder's release will wake us even if a previous
+		 * releaser is still waiting for its wakee to run.
+		 */
+		LWLockStateFetchOr(lock, LW_FLAG_RELEASE_OK);
+
+		/*
+		 * The lock may have been released, or the value updated, before we
+		 * were in the queue to be woken, so check again.
+		 */
+		if (!LWLockConflictsWithVar(lock, valptr, oldval, newval, &result))
+		{
+			LWLockDequeueSelf(lock);
+			break;				/* the lock was free or value didn't match */
+		}
+
+		/*
+		 * Wait until awakened, either by LWLockRelease or LWLockUpdateVar.
+		 */
+		LOG_LWDEBUG("LWLockWaitForVar", lockid, "waiting");
+
+		LWLockSleep(lockid, LW_EXCLUSIVE, &extraWaits);
+
+		LOG_LWDEBUG("LWLockWaitForVar", lockid, "awakened");
+
+		/* Now loop back and check the status of the lock again. */
+		if (!LWLockConflictsWithVar(lock, valptr, oldval, newval, &result))
+			break;
+	}
+
+	/*
+	 * Fix the process wait semaphore's count for any absorbed wakeups.
+	 */
+	while (extraWaits-- > 0)
+		PGSemaphoreUnlock(&proc->sem);
+
+	/*
+	 * Now okay to allow cancel/die interrupts.
+	 */
+	RESUME_INTERRUPTS();
+
+	return result;
+}
+
+
+/*
+ * LWLockUpdateVar - Update a variable and wake up waiters atomically
+ *
+ * Sets *valptr to 'val', and wakes up all processes waiting for us with
+ * LWLockWaitForVar().  Setting the value and waking up the processes happen
+ * atomically so that any process calling LWLockWaitForVar() on the same lock
+ * is guaranteed to see the new value, and act accordingly.
+ *
+ * The caller must be holding the lock in exclusive mode.
  */
 void
-LWLockRelease(LWLockId lockid)
+LWLockUpdateVar(LWLockId lockid, uint64 *valptr, uint64 val)
 {
 	volatile LWLock *lock = &(LWLockArray[lockid].lock);
+	volatile uint64 *valp = valptr;
 	PGPROC	   *head;
 	PGPROC	   *proc;
+	PGPROC	   *next;
+
+	/* Acquire mutex.  Time spent holding mutex should be short! */
+	SpinLockAcquire(&lock->mutex);
+
+	/* we should hold the lock */
+	Assert(lock->state & LW_VAL_EXCLUSIVE);
+
+	/* Update the lock's value */
+	*valp = val;
+
+	/*
+	 * See if there are any waiters that need to be woken up.  They are all
+	 * at the front of the queue, since LWLockQueueSelf puts LW_WAIT_UNTIL_FREE
+	 * waiters there.
+	 */
+	head = lock->head;
+	if (head != NULL && head->lwWaitMode == LW_WAIT_UNTIL_FREE)
+	{
+		proc = head;
+		while (proc->lwWaitLink != NULL &&
+			   proc->lwWaitLink->lwWaitMode == LW_WAIT_UNTIL_FREE)
+			proc = proc->lwWaitLink;
+
+		/* proc is now the last PGPROC to be released */
+		lock->head = proc->lwWaitLink;
+		proc->lwWaitLink = NULL;
+
+		if (lock->head == NULL)
+			LWLockStateFetchAnd(lock, ~LW_FLAG_HAS_WAITERS);
+	}
+	else
+		head = NULL;
+
+	/* We are done updating the queue. */
+	SpinLockRelease(&lock->mutex);
+
+	/*
+	 * Awaken any waiters I removed from the queue.
+	 */
+	for (proc = head; proc != NULL; proc = next)
+	{
+		next = proc->lwWaitLink;
+		proc->lwWaitLink = NULL;
+		pg_write_barrier();
+		proc->lwWaiting = false;
+		PGSemaphoreUnlock(&proc->sem);
+	}
+}
+
+
+/*
+ * LWLockRelease - release a previously acquired lock
+ */
+void
+LWLockRelease(LWLockId lockid)
+{
+	volatile LWLock *lock = &(LWLockArray[lockid].lock);
+	uint32		oldstate;
+	uint32		newstate;
 	int			i;
 
 	PRINT_LWDEBUG("LWLockRelease", lockid, lock);
@@ -592,16 +1601,20 @@ LWLockRelease(LWLockId lockid)
 	for (; i < num_held_lwlocks; i++)
 		held_lwlocks[i] = held_lwlocks[i + 1];
 
-	/* Acquire mutex.  Time spent holding mutex should be short! */
-	SpinLockAcquire(&lock->mutex);
-
-	/* Release my hold on lock */
-	if (lock->exclusive > 0)
-		lock->exclusive--;
+	/*
+	 * Release my hold on lock.  We don't remember which mode we hold it in,
+	 * but if the exclusive bit is set it can only be us that holds it.
+	 */
+	if (lock->state & LW_VAL_EXCLUSIVE)
+	{
+		oldstate = LWLockStateFetchSub(lock, LW_VAL_EXCLUSIVE);
+		newstate = oldstate - LW_VAL_EXCLUSIVE;
+	}
 	else
 	{
-		Assert(lock->shared > 0);
-		lock->shared--;
+		Assert((lock->state & LW_SHARED_MASK) > 0);
+		oldstate = LWLockStateFetchSub(lock, LW_VAL_SHARED);
+		newstate = oldstate - LW_VAL_SHARED;
 	}
 
 	/*
@@ -610,54 +1623,13 @@ LWLockRelease(LWLockId lockid)
 	 * if someone has already awakened waiters that haven't yet acquired the
 	 * lock.
 	 */
-	head = lock->head;
-	if (head != NULL)
-	{
-		if (lock->exclusive == 0 && lock->shared == 0 && lock->releaseOK)
-		{
-			/*
-			 * Remove the to-be-awakened PGPROCs from the queue.  If the front
-			 * waiter wants exclusive lock, awaken him only. Otherwise awaken
-			 * as many waiters as want shared access.
-			 */
-			proc = head;
-			if (!proc->lwExclusive)
-			{
-				while (proc->lwWaitLink != NULL &&
-					   !proc->lwWaitLink->lwExclusive)
-					proc = proc->lwWaitLink;
-			}
-			/* proc is now the last PGPROC to be released */
-			lock->head = proc->lwWaitLink;
-			proc->lwWaitLink = NULL;
-			/* prevent additional wakeups until retryer gets to run */
-			lock->releaseOK = false;
-		}
-		else
-		{
-			/* lock is still held, can't awaken anything */
-			head = NULL;
-		}
-	}
-
-	/* We are done updating shared state of the lock itself. */
-	SpinLockRelease(&lock->mutex);
+	if ((newstate & LW_LOCK_MASK) == 0 &&
+		(newstate & (LW_FLAG_HAS_WAITERS | LW_FLAG_RELEASE_OK)) ==
+		(LW_FLAG_HAS_WAITERS | LW_FLAG_RELEASE_OK))
+		LWLockWakeup(lock, lockid);
 
 	TRACE_POSTGRESQL_LWLOCK_RELEASE(lockid);
 
-	/*
-	 * Awaken any waiters I removed from the queue.
-	 */
-	while (head != NULL)
-	{
-		LOG_LWDEBUG("LWLockRelease", lockid, "release waiter");
-		proc = head;
-		head = proc->lwWaitLink;
-		proc->lwWaitLink = NULL;
-		proc->lwWaiting = false;
-		PGSemaphoreUnlock(&proc->sem);
-	}
-
 	/*
 	 * Now okay to allow cancel/die interrupts.
 	 */
@@ -3493,6 +3493,7 @@ ClearOldPredicateLocks(void)
 {
 	SERIALIZABLEXACT *finishedSxact;
 	PREDICATELOCK *predlock;
+	SerCommitSeqNo canPartialClearThrough;
 
 	/*
 	 * Loop through finished transactions. They are in commit order, so we can
@@ -3542,10 +3543,15 @@ ClearOldPredicateLocks(void)
 		}
 		finishedSxact = nextSxact;
 	}
+	canPartialClearThrough = PredXact->CanPartialClearThrough;
 	LWLockRelease(SerializableXactHashLock);
 
 	/*
 	 * Loop through predicate locks on dummy transaction for summarized data.
+	 *
+	 * CanPartialClearThrough only ever advances, so the value we just read
+	 * is good enough to decide which of these locks can go; there's no need
+	 * to take SerializableXactHashLock again for each of them.
 	 */
 	LWLockAcquire(SerializablePredicateLockListLock, LW_SHARED);
 	predlock = (PREDICATELOCK *)
@@ -3562,11 +3568,9 @@ ClearOldPredicateLocks(void)
 						 &predlock->xactLink,
 						 offsetof(PREDICATELOCK, xactLink));
 
-		LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 		Assert(predlock->commitSeqNo != 0);
 		Assert(predlock->commitSeqNo != InvalidSerCommitSeqNo);
-		canDoPartialCleanup = (predlock->commitSeqNo <= PredXact->CanPartialClearThrough);
-		LWLockRelease(SerializableXactHashLock);
+		canDoPartialCleanup = (predlock->commitSeqNo <= canPartialClearThrough);
 
 		/*
 		 * If this lock originally belonged to an old enough transaction, we
@@ -4039,6 +4043,7 @@ CheckTargetForConflictsIn(PREDICATELOCKTARGETTAG *targettag)
 	PREDICATELOCK *predlock;
 	PREDICATELOCK *mypredlock = NULL;
 	PREDICATELOCKTAG mypredlocktag;
+	bool		haveXactLock = false;
 
 	Assert(MySerializableXact != InvalidSerializableXact);
 
@@ -4062,12 +4067,16 @@ CheckTargetForConflictsIn(PREDICATELOCKTARGETTAG *targettag)
 	/*
 	 * Each lock for an overlapping transaction represents a conflict: a
 	 * rw-dependency in to this transaction.
+	 *
+	 * The lock list itself is protected by the partition lock; we only need
+	 * SerializableXactHashLock to look at the other transactions, so don't
+	 * take it until we find a lock that isn't ours.  Very often the only
+	 * lock on a tuple we're writing is our own SIREAD lock from reading it.
 	 */
 	predlock = (PREDICATELOCK *)
 		SHMQueueNext(&(target->predicateLocks),
 					 &(target->predicateLocks),
 					 offsetof(PREDICATELOCK, targetLink));
-	LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 	while (predlock)
 	{
 		SHM_QUEUE  *predlocktargetlink;
@@ -4100,35 +4109,45 @@ CheckTargetForConflictsIn(PREDICATELOCKTARGETTAG *targettag)
 				mypredlocktag = predlock->tag;
 			}
 		}
-		else if (!SxactIsDoomed(sxact)
-				 && (!SxactIsCommitted(sxact)
-					 || TransactionIdPrecedes(GetTransactionSnapshot()->xmin,
-											  sxact->finishedBefore))
-				 && !RWConflictExists(sxact, MySerializableXact))
+		else
 		{
-			LWLockRelease(SerializableXactHashLock);
-			LWLockAcquire(SerializableXactHashLock, LW_EXCLUSIVE);
+			if (!haveXactLock)
+			{
+				LWLockAcquire(SerializableXactHashLock, LW_SHARED);
+				haveXactLock = true;
+			}
 
-			/*
-			 * Re-check after getting exclusive lock because the other
-			 * transaction may have flagged a conflict.
-			 */
 			if (!SxactIsDoomed(sxact)
 				&& (!SxactIsCommitted(sxact)
 					|| TransactionIdPrecedes(GetTransactionSnapshot()->xmin,
 											 sxact->finishedBefore))
 				&& !RWConflictExists(sxact, MySerializableXact))
 			{
-				FlagRWConflict(sxact, MySerializableXact);
-			}
+				LWLockRelease(SerializableXactHashLock);
+				LWLockAcquire(SerializableXactHashLock, LW_EXCLUSIVE);
 
-			LWLockRelease(SerializableXactHashLock);
-			LWLockAcquire(SerializableXactHashLock, LW_SHARED);
+				/*
+				 * Re-check after getting exclusive lock because the other
+				 * transaction may have flagged a conflict.
+				 */
+				if (!SxactIsDoomed(sxact)
+					&& (!SxactIsCommitted(sxact)
+						|| TransactionIdPrecedes(GetTransactionSnapshot()->xmin,
+												 sxact->finishedBefore))
+					&& !RWConflictExists(sxact, MySerializableXact))
+				{
+					FlagRWConflict(sxact, MySerializableXact);
+				}
+
+				LWLockRelease(SerializableXactHashLock);
+				LWLockAcquire(SerializableXactHashLock, LW_SHARED);
+			}
 		}
 
 		predlock = nextpredlock;
 	}
-	LWLockRelease(SerializableXactHashLock);
+	if (haveXactLock)
+		LWLockRelease(SerializableXactHashLock);
 	LWLockRelease(partitionLock);
 
 	/*
@@ -122,6 +122,12 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(NUM_AUXILIARY_PROCS, sizeof(PGXACT)));
 	size = add_size(size, mul_size(max_prepared_xacts, sizeof(PGXACT)));
 
+	/* Fast-path lock arrays */
+	size = add_size(size, mul_size(add_size(add_size(MaxBackends,
+													 NUM_AUXILIARY_PROCS),
+											max_prepared_xacts),
+								   FastPathLockShmemSizePerProc()));
+
 	return size;
 }
 
@@ -151,8 +157,8 @@ ProcGlobalSemas(void)
  *	  running out when trying to start another backend is a common failure.
  *	  So, now we grab enough semaphores to support the desired max number
  *	  of backends immediately at initialization --- if the sysadmin has set
- *	  MaxConnections or autovacuum_max_workers higher than his kernel will
- *	  support, he'll find out sooner rather than later.
+ *	  MaxConnections, autovacuum_max_workers or max_worker_processes higher
+ *	  than his kernel will support, he'll find out sooner rather than later.
  *
  *	  Another reason for creating semaphores here is that the semaphore
  *	  implementation typically requires us to create semaphores in the
@@ -167,6 +173,7 @@ InitProcGlobal(void)
 {
 	PGPROC	   *procs;
 	PGXACT	   *pgxacts;
+	char	   *fpPtr;
 	int			i,
 				j;
 	bool		found;
@@ -183,20 +190,23 @@ InitProcGlobal(void)
 	ProcGlobal->spins_per_delay = DEFAULT_SPINS_PER_DELAY;
 	ProcGlobal->freeProcs = NULL;
 	ProcGlobal->autovacFreeProcs = NULL;
+	ProcGlobal->bgworkerFreeProcs = NULL;
 	ProcGlobal->startupProc = NULL;
 	ProcGlobal->startupProcPid = 0;
 	ProcGlobal->startupBufferPinWaitBufId = -1;
+	SpinLockInit(&ProcGlobal->clogGroupLock);
+	ProcGlobal->clogGroupFirst = INVALID_PGPROCNO;
 
 	/*
 	 * Create and initialize all the PGPROC structures we'll need (except for
 	 * those used for 2PC, which are embedded within a GlobalTransactionData
 	 * struct).
 	 *
-	 * There are four separate consumers of PGPROC structures: (1) normal
+	 * There are five separate consumers of PGPROC structures: (1) normal
 	 * backends, (2) autovacuum workers and the autovacuum launcher, (3)
-	 * auxiliary processes, and (4) prepared transactions.  Each PGPROC
-	 * structure is dedicated to exactly one of these purposes, and they do
-	 * not move between groups.
+	 * background workers, (4) auxiliary processes, and (5) prepared
+	 * transactions.  Each PGPROC structure is dedicated to exactly one of
+	 * these purposes, and they do not move between groups.
 	 */
 	procs = (PGPROC *) ShmemAlloc(TotalProcs * sizeof(PGPROC));
 	ProcGlobal->allProcs = procs;
@@ -219,10 +229,26 @@ InitProcGlobal(void)
 	MemSet(pgxacts, 0, TotalProcs * sizeof(PGXACT));
 	ProcGlobal->allPgXact = pgxacts;
 
+	/*
+	 * The fast-path lock arrays are sized at startup, so they can't be part
+	 * of PGPROC itself; carve them out of one more block.
+	 */
+	fpPtr = (char *) ShmemAlloc(TotalProcs * FastPathLockShmemSizePerProc());
+	if (!fpPtr)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of shared memory")));
+	MemSet(fpPtr, 0, TotalProcs * FastPathLockShmemSizePerProc());
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		fpPtr += MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64));
+		procs[i].fpRelId = (Oid *) fpPtr;
+		fpPtr += MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid));
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and backendLock. Prepared
 		 * xact dummy PGPROCs don't need these though - they're never
@@ -235,14 +261,17 @@ InitProcGlobal(void)
 			procs[i].backendLock = LWLockAssign();
 		}
 		procs[i].pgprocno = i;
+		procs[i].clogGroupMember = false;
+		procs[i].clogGroupNext = INVALID_PGPROCNO;
 
 		/*
-		 * Newly created PGPROCs for normal backends or for autovacuum must
-		 * be queued up on the appropriate free list.  Because there can only
-		 * ever be a small, fixed number of auxiliary processes, no free
-		 * list is used in that case; InitAuxiliaryProcess() instead uses a
-		 * linear search.  PGPROCs for prepared transactions are added to a
-		 * free list by TwoPhaseShmemInit().
+		 * Newly created PGPROCs for normal backends, autovacuum or
+		 * background workers must be queued up on the appropriate free list.
+		 * Because there can only ever be a small, fixed number of auxiliary
+		 * processes, no free list is used in that case;
+		 * InitAuxiliaryProcess() instead uses a linear search.  PGPROCs for
+		 * prepared transactions are added to a free list by
+		 * TwoPhaseShmemInit().
 		 */
 		if (i < MaxConnections)
 		{
@@ -250,15 +279,21 @@ InitProcGlobal(void)
 			procs[i].links.next = (SHM_QUEUE *) ProcGlobal->freeProcs;
 			ProcGlobal->freeProcs = &procs[i];
 		}
-		else if (i < MaxBackends)
+		else if (i < MaxConnections + autovacuum_max_workers + 1)
 		{
 			/* PGPROC for AV launcher/worker, add to autovacFreeProcs list */
 			procs[i].links.next = (SHM_QUEUE *) ProcGlobal->autovacFreeProcs;
 			ProcGlobal->autovacFreeProcs = &procs[i];
 		}
+		else if (i < MaxBackends)
+		{
+			/* PGPROC for bgworker, add to bgworkerFreeProcs list */
+			procs[i].links.next = (SHM_QUEUE *) ProcGlobal->bgworkerFreeProcs;
+			ProcGlobal->bgworkerFreeProcs = &procs[i];
+		}
 
 		/* Initialize myProcLocks[] shared memory queues. */
-		for (j = 0; j < NUM_LOCK_PARTITIONS; j++)
+		for (j = 0; j < MAX_LOCK_PARTITIONS; j++)
 			SHMQueueInit(&(procs[i].myProcLocks[j]));
 	}
 
@@ -306,6 +341,8 @@ InitProcess(void)
 
 	if (IsAnyAutoVacuumProcess())
 		MyProc = procglobal->autovacFreeProcs;
+	else if (IsBackgroundWorker)
+		MyProc = procglobal->bgworkerFreeProcs;
 	else
 		MyProc = procglobal->freeProcs;
 
@@ -313,6 +350,8 @@ InitProcess(void)
 	{
 		if (IsAnyAutoVacuumProcess())
 			procglobal->autovacFreeProcs = (PGPROC *) MyProc->links.next;
+		else if (IsBackgroundWorker)
+			procglobal->bgworkerFreeProcs = (PGPROC *) MyProc->links.next;
 		else
 			procglobal->freeProcs = (PGPROC *) MyProc->links.next;
 		SpinLockRelease(ProcStructLock);
@@ -361,8 +400,9 @@ InitProcess(void)
 	if (IsAutoVacuumWorkerProcess())
 		MyPgXact->vacuumFlags |= PROC_IS_AUTOVACUUM;
 	MyProc->lwWaiting = false;
-	MyProc->lwExclusive = false;
+	MyProc->lwWaitMode = 0;
 	MyProc->lwWaitLink = NULL;
+	MyProc->wait_event_info = 0;
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
 #ifdef USE_ASSERT_CHECKING
@@ -371,7 +411,7 @@ InitProcess(void)
 		int i;
 
 		/* Last process should have released all locks. */
-		for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+		for (i = 0; i < NumLockPartitions; i++)
 			Assert(SHMQueueEmpty(&(MyProc->myProcLocks[i])));
 	}
 #endif
@@ -383,6 +423,10 @@ InitProcess(void)
 	MyProc->syncRepState = SYNC_REP_NOT_WAITING;
 	SHMQueueElemInit(&(MyProc->syncRepLinks));
 
+	/* Initialize fields for group clog update */
+	MyProc->clogGroupMember = false;
+	Assert(MyProc->clogGroupNext == INVALID_PGPROCNO);
+
 	/*
 	 * Acquire ownership of the PGPROC's latch, so that we can use WaitLatch.
 	 * Note that there's no particular need to do ResetLatch here.
@@ -516,8 +560,9 @@ InitAuxiliaryProcess(void)
 	MyPgXact->inCommit = false;
 	MyPgXact->vacuumFlags = 0;
 	MyProc->lwWaiting = false;
-	MyProc->lwExclusive = false;
+	MyProc->lwWaitMode = 0;
 	MyProc->lwWaitLink = NULL;
+	MyProc->wait_event_info = 0;
 	MyProc->waitLock = NULL;
 	MyProc->waitProcLock = NULL;
 #ifdef USE_ASSERT_CHECKING
@@ -526,7 +571,7 @@ InitAuxiliaryProcess(void)
 		int i;
 
 		/* Last process should have released all locks. */
-		for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+		for (i = 0; i < NumLockPartitions; i++)
 			Assert(SHMQueueEmpty(&(MyProc->myProcLocks[i])));
 	}
 #endif
@@ -748,7 +793,7 @@ ProcKill(int code, Datum arg)
 		int i;
 
 		/* Last process should have released all locks. */
-		for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+		for (i = 0; i < NumLockPartitions; i++)
 			Assert(SHMQueueEmpty(&(MyProc->myProcLocks[i])));
 	}
 #endif
@@ -771,6 +816,11 @@ ProcKill(int code, Datum arg)
 		MyProc->links.next = (SHM_QUEUE *) procglobal->autovacFreeProcs;
 		procglobal->autovacFreeProcs = MyProc;
 	}
+	else if (IsBackgroundWorker)
+	{
+		MyProc->links.next = (SHM_QUEUE *) procglobal->bgworkerFreeProcs;
+		procglobal->bgworkerFreeProcs = MyProc;
+	}
 	else
 	{
 		MyProc->links.next = (SHM_QUEUE *) procglobal->freeProcs;
@@ -1354,7 +1404,7 @@ CheckDeadLock(void)
 	 * section, so that this routine cannot be interrupted by cancel/die
 	 * interrupts.
 	 */
-	for (i = 0; i < NUM_LOCK_PARTITIONS; i++)
+	for (i = 0; i < NumLockPartitions; i++)
 		LWLockAcquire(FirstLockMgrLock + i, LW_EXCLUSIVE);
 
 	/*
@@ -1436,7 +1486,7 @@ CheckDeadLock(void)
 	 * behavior inside LWLockRelease.
 	 */
 check_done:
-	for (i = NUM_LOCK_PARTITIONS; --i >= 0;)
+	for (i = NumLockPartitions; --i >= 0;)
 		LWLockRelease(FirstLockMgrLock + i);
 }
 
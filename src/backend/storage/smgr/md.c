@@ -19,6 +19,7 @@
 #include <sys/file.h>
 
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "portability/instr_time.h"
@@ -35,17 +36,6 @@
 /* interval for calling AbsorbFsyncRequests in mdsync */
 #define FSYNCS_PER_ABSORB		10
 
-/*
- * Special values for the segno arg to RememberFsyncRequest.
- *
- * Note that CompactcheckpointerRequestQueue assumes that it's OK to remove an
- * fsync request from the queue if an identical, subsequent request is found.
- * See comments there before making changes here.
- */
-#define FORGET_RELATION_FSYNC	(InvalidBlockNumber)
-#define FORGET_DATABASE_FSYNC	(InvalidBlockNumber-1)
-#define UNLINK_RELATION_REQUEST (InvalidBlockNumber-2)
-
 /*
  * On Windows, we have to interpret EACCES as possibly meaning the same as
  * ENOENT, because if a file is unlinked-but-not-yet-gone on that platform,
@@ -109,6 +99,26 @@ typedef struct _MdfdVec
 
 static MemoryContext MdCxt;		/* context for all md.c allocations */
 
+/*
+ * Relation files are opened with O_DIRECT if direct_io says so.  Temporary
+ * relations are left out: they live in local buffers, which aren't aligned
+ * for direct I/O, and they are private to one backend anyway.
+ */
+#define MdUseDirectIO(reln) \
+	((direct_io & DIRECT_IO_DATA) != 0 && !SmgrIsTemp(reln))
+#define MdDirectFlag(reln)	(MdUseDirectIO(reln) ? PG_O_DIRECT : 0)
+
+/*
+ * Shared buffers are suitably aligned for direct I/O, but pages in private
+ * memory usually aren't; those are staged through this bounce buffer of
+ * PG_IOV_MAX blocks, allocated on first use.
+ */
+#define MdNeedsBounce(reln, buffer) \
+	(MdUseDirectIO(reln) && \
+	 (buffer) != (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, (buffer)))
+
+static char *MdBounceBuffer = NULL;
+
 
 /*
  * In some contexts (currently, standalone backends and the checkpointer process)
@@ -174,6 +184,7 @@ static MdfdVec *_mdfd_openseg(SMgrRelation reln, ForkNumber forkno,
 			  BlockNumber segno, int oflags);
 static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forkno,
 			 BlockNumber blkno, bool skipFsync, ExtensionBehavior behavior);
+static char *md_bounce_buffer(void);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 		   MdfdVec *seg);
 
@@ -263,7 +274,8 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY, 0600);
+	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY |
+						  MdDirectFlag(reln), 0600);
 
 	if (fd < 0)
 	{
@@ -276,7 +288,8 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 		 * already, even if isRedo is not set.	(See also mdopen)
 		 */
 		if (isRedo || IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY, 0600);
+			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY | MdDirectFlag(reln),
+								  0600);
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -474,7 +487,14 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ)) != BLCKSZ)
+	if (MdNeedsBounce(reln, buffer))
+		buffer = memcpy(md_bounce_buffer(), buffer, BLCKSZ);
+
+	pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_EXTEND);
+	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ);
+	pgstat_report_wait_end();
+
+	if (nbytes != BLCKSZ)
 	{
 		if (nbytes < 0)
 			ereport(ERROR,
@@ -520,7 +540,8 @@ mdopen(SMgrRelation reln, ForkNumber forknum, ExtensionBehavior behavior)
 
 	path = relpath(reln->smgr_rnode, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY, 0600);
+	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY | MdDirectFlag(reln),
+						  0600);
 
 	if (fd < 0)
 	{
@@ -531,7 +552,8 @@ mdopen(SMgrRelation reln, ForkNumber forknum, ExtensionBehavior behavior)
 		 * substitute for mdcreate() in bootstrap mode only. (See mdcreate)
 		 */
 		if (IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY, 0600);
+			fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY |
+								  MdDirectFlag(reln), 0600);
 		if (fd < 0)
 		{
 			if (behavior == EXTENSION_RETURN_NULL &&
@@ -598,7 +620,18 @@ mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
 	off_t		seekpos;
 	MdfdVec    *v;
 
-	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
+	/* With direct I/O, the kernel's page cache would never be used */
+	if (MdUseDirectIO(reln))
+		return;
+
+	/*
+	 * A prefetch is only a hint, so don't complain if the file or segment
+	 * doesn't exist.  That can legitimately happen when WAL replay looks
+	 * ahead at records for relations that aren't created yet.
+	 */
+	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_RETURN_NULL);
+	if (v == NULL)
+		return;
 
 	seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
 
@@ -638,7 +671,15 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ);
+	pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_READ);
+	if (MdNeedsBounce(reln, buffer))
+	{
+		nbytes = FileRead(v->mdfd_vfd, md_bounce_buffer(), BLCKSZ);
+		memcpy(buffer, md_bounce_buffer(), BLCKSZ);
+	}
+	else
+		nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ);
+	pgstat_report_wait_end();
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
@@ -713,7 +754,14 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ);
+	pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_WRITE);
+	if (MdNeedsBounce(reln, buffer))
+		nbytes = FileWrite(v->mdfd_vfd,
+						   memcpy(md_bounce_buffer(), buffer, BLCKSZ),
+						   BLCKSZ);
+	else
+		nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ);
+	pgstat_report_wait_end();
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -744,6 +792,260 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdreadv() -- Read nblocks consecutive blocks, starting at blocknum, into
+ *				 the supplied buffers.
+ *
+ *		Equivalent to calling mdread() for each block, but each run of blocks
+ *		within one segment file is transferred with a single readv() of up to
+ *		PG_IOV_MAX blocks.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, BlockNumber nblocks)
+{
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		off_t		seekpos;
+		int			nbytes;
+		int			nchunk;
+		int			i;
+		bool		bounce;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		/* Don't cross a segment boundary, or overrun the iovec array */
+		nchunk = Min(nblocks, PG_IOV_MAX);
+		nchunk = Min(nchunk,
+					 RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		bounce = false;
+		for (i = 0; i < nchunk; i++)
+		{
+			iov[i].iov_base = buffers[i];
+			iov[i].iov_len = BLCKSZ;
+			if (MdNeedsBounce(reln, buffers[i]))
+				bounce = true;
+		}
+		if (bounce)
+		{
+			for (i = 0; i < nchunk; i++)
+				iov[i].iov_base = md_bounce_buffer() + i * BLCKSZ;
+		}
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_READ);
+		nbytes = FileReadV(v->mdfd_vfd, iov, nchunk);
+		pgstat_report_wait_end();
+
+		if (bounce)
+		{
+			for (i = 0; i < nchunk; i++)
+				memcpy(buffers[i], iov[i].iov_base, BLCKSZ);
+		}
+
+		if (nbytes != nchunk * BLCKSZ)
+		{
+			BlockNumber badblock;
+			int			badbytes;
+
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+								blocknum, blocknum + nchunk - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			/*
+			 * Short read: see mdread().  Blocks wholly read are fine; the
+			 * rest are zeroed if that's allowed, else we complain about the
+			 * first one that came up short.
+			 */
+			badblock = nbytes / BLCKSZ;
+			badbytes = nbytes % BLCKSZ;
+
+			if (zero_damaged_pages || InRecovery)
+			{
+				for (i = badblock; i < nchunk; i++)
+					MemSet(buffers[i], 0, BLCKSZ);
+			}
+			else
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("could not read block %u in file \"%s\": read only %d of %d bytes",
+								blocknum + badblock,
+								FilePathName(v->mdfd_vfd),
+								badbytes, BLCKSZ)));
+		}
+
+		blocknum += nchunk;
+		buffers += nchunk;
+		nblocks -= nchunk;
+	}
+}
+
+/*
+ * Return the direct I/O bounce buffer, allocating it if need be.
+ */
+static char *
+md_bounce_buffer(void)
+{
+	if (MdBounceBuffer == NULL)
+	{
+		char	   *raw;
+
+		raw = MemoryContextAlloc(MdCxt,
+								 PG_IOV_MAX * BLCKSZ + PG_IO_ALIGN_SIZE);
+		MdBounceBuffer = (char *) TYPEALIGN(PG_IO_ALIGN_SIZE, raw);
+	}
+	return MdBounceBuffer;
+}
+
+/*
+ * Workhorse for mdwritev() and mdextendv(): write nblocks consecutive
+ * blocks, one writev() per segment-sized chunk of at most PG_IOV_MAX blocks.
+ */
+static void
+mdwritev_internal(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+				  char **buffers, BlockNumber nblocks, bool skipFsync,
+				  bool extend)
+{
+	while (nblocks > 0)
+	{
+		struct iovec iov[PG_IOV_MAX];
+		off_t		seekpos;
+		int			nbytes;
+		int			nchunk;
+		int			i;
+		bool		bounce;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+						 extend ? EXTENSION_CREATE : EXTENSION_FAIL);
+
+		seekpos = (off_t) BLCKSZ *(blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		/* Don't cross a segment boundary, or overrun the iovec array */
+		nchunk = Min(nblocks, PG_IOV_MAX);
+		nchunk = Min(nchunk,
+					 RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		bounce = false;
+		for (i = 0; i < nchunk; i++)
+		{
+			iov[i].iov_base = buffers[i];
+			iov[i].iov_len = BLCKSZ;
+			if (MdNeedsBounce(reln, buffers[i]))
+				bounce = true;
+		}
+		if (bounce)
+		{
+			for (i = 0; i < nchunk; i++)
+				iov[i].iov_base = memcpy(md_bounce_buffer() + i * BLCKSZ,
+										 buffers[i], BLCKSZ);
+		}
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		pgstat_report_wait_start(extend ? WAIT_EVENT_DATA_FILE_EXTEND :
+								 WAIT_EVENT_DATA_FILE_WRITE);
+		nbytes = FileWriteV(v->mdfd_vfd, iov, nchunk);
+		pgstat_report_wait_end();
+
+		if (nbytes != nchunk * BLCKSZ)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write blocks %u..%u in file \"%s\": %m",
+								blocknum, blocknum + nchunk - 1,
+								FilePathName(v->mdfd_vfd)),
+						 errhint("Check free disk space.")));
+			/* short write: complain appropriately */
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not write blocks %u..%u in file \"%s\": wrote only %d of %d bytes",
+							blocknum, blocknum + nchunk - 1,
+							FilePathName(v->mdfd_vfd),
+							nbytes, nchunk * BLCKSZ),
+					 errhint("Check free disk space.")));
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(!extend ||
+			   _mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		blocknum += nchunk;
+		buffers += nchunk;
+		nblocks -= nchunk;
+	}
+}
+
+/*
+ *	mdwritev() -- Write nblocks consecutive existing blocks, starting at
+ *				  blocknum, from the supplied buffers.
+ *
+ *		Equivalent to calling mdwrite() for each block.
+ */
+void
+mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		 char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum + nblocks <= mdnblocks(reln, forknum));
+#endif
+
+	mdwritev_internal(reln, forknum, blocknum, buffers, nblocks, skipFsync,
+					  false);
+}
+
+/*
+ *	mdextendv() -- Add nblocks consecutive blocks, starting at blocknum, to
+ *				   the specified relation.
+ *
+ *		Equivalent to calling mdextend() for each block.
+ */
+void
+mdextendv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum >= mdnblocks(reln, forknum));
+#endif
+
+	/* See mdextend(); no block may end up numbered InvalidBlockNumber */
+	if (nblocks > InvalidBlockNumber - blocknum)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	mdwritev_internal(reln, forknum, blocknum, buffers, nblocks, skipFsync,
+					  true);
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -921,7 +1223,13 @@ mdimmedsync(SMgrRelation reln, ForkNumber forknum)
 
 	while (v != NULL)
 	{
-		if (FileSync(v->mdfd_vfd) < 0)
+		int			rc;
+
+		pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_SYNC);
+		rc = FileSync(v->mdfd_vfd);
+		pgstat_report_wait_end();
+
+		if (rc < 0)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
@@ -1265,6 +1573,8 @@ mdpostckpt(void)
 static void
 register_dirty_segment(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 {
+	int			rc;
+
 	if (pendingOpsTable)
 	{
 		/* push it into local pending-ops table */
@@ -1278,7 +1588,11 @@ register_dirty_segment(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 		ereport(DEBUG1,
 				(errmsg("could not forward fsync request because request queue is full")));
 
-		if (FileSync(seg->mdfd_vfd) < 0)
+		pgstat_report_wait_start(WAIT_EVENT_DATA_FILE_SYNC);
+		rc = FileSync(seg->mdfd_vfd);
+		pgstat_report_wait_end();
+
+		if (rc < 0)
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("could not fsync file \"%s\": %m",
@@ -1558,7 +1872,9 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags, 0600);
+	fd = PathNameOpenFile(fullpath,
+						  O_RDWR | PG_BINARY | MdDirectFlag(reln) | oflags,
+						  0600);
 
 	pfree(fullpath);
 
@@ -1614,6 +1930,8 @@ _mdfd_getseg(SMgrRelation reln, ForkNumber forknum, BlockNumber blkno,
 			 * replaying WAL data that has a write into a high-numbered
 			 * segment of a relation that was later deleted.  We want to go
 			 * ahead and create the segments so we can finish out the replay.
+			 * That doesn't apply to callers that asked for NULL instead,
+			 * such as prefetches.
 			 *
 			 * We have to maintain the invariant that segments before the last
 			 * active segment are of size RELSEG_SIZE; therefore, pad them out
@@ -1621,7 +1939,8 @@ _mdfd_getseg(SMgrRelation reln, ForkNumber forknum, BlockNumber blkno,
 			 * extending the relation discontiguously, but that can happen in
 			 * hash indexes.)
 			 */
-			if (behavior == EXTENSION_CREATE || InRecovery)
+			if (behavior == EXTENSION_CREATE ||
+				(InRecovery && behavior != EXTENSION_RETURN_NULL))
 			{
 				if (_mdnblocks(reln, forknum, v) < RELSEG_SIZE)
 				{
@@ -53,6 +53,15 @@ typedef struct f_smgr
 										  BlockNumber blocknum, char *buffer);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 						 BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_extendv) (SMgrRelation reln, ForkNumber forknum,
+									 BlockNumber blocknum, char **buffers,
+									 BlockNumber nblocks, bool skipFsync);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+								   BlockNumber blocknum, char **buffers,
+								   BlockNumber nblocks);
+	void		(*smgr_writev) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, char **buffers,
+									BlockNumber nblocks, bool skipFsync);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
 	void		(*smgr_truncate) (SMgrRelation reln, ForkNumber forknum,
 											  BlockNumber nblocks);
@@ -66,7 +75,8 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdnblocks, mdtruncate, mdimmedsync,
+		mdprefetch, mdread, mdwrite, mdextendv, mdreadv, mdwritev,
+		mdnblocks, mdtruncate, mdimmedsync,
 		mdpreckpt, mdsync, mdpostckpt
 	}
 };
@@ -351,7 +361,7 @@ smgrdounlink(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	 * Get rid of any remaining buffers for the relation.  bufmgr will just
 	 * drop them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(rnode, forknum, 0);
+	DropRelFileNodeBuffers(rnode, forknum, InvalidBlockNumber, 0);
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -380,6 +390,103 @@ smgrdounlink(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	(*(smgrsw[which].smgr_unlink)) (rnode, forknum, isRedo);
 }
 
+/*
+ *	smgrdounlinkall() -- Immediately unlink all forks of all given relations
+ *
+ *		All forks of all given relations are removed from the store.  This
+ *		should not be used during transactional operations, since it can't be
+ *		undone.
+ *
+ *		This is equivalent to calling smgrdounlink for each fork of each
+ *		relation, but the buffers of all of them are dropped in a single
+ *		pass over the buffer pool, or by looking up their blocks if they are
+ *		small enough.
+ *
+ *		If isRedo is true, it is okay for the underlying files to be gone
+ *		already.
+ */
+void
+smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
+{
+	int			i;
+	RelFileNodeBackend *rnodes;
+	BlockNumber *nblocks = NULL;
+	ForkNumber	forknum;
+
+	if (nrels == 0)
+		return;
+
+	/*
+	 * create an array which contains all relations to be dropped, and close
+	 * each relation's forks at the smgr level while at it.  Except in redo,
+	 * where the files might be gone already, also note the size of each
+	 * fork; a fork that doesn't exist can't have any buffers either.
+	 */
+	rnodes = palloc(sizeof(RelFileNodeBackend) * nrels);
+	if (!isRedo)
+		nblocks = palloc(sizeof(BlockNumber) * nrels * (MAX_FORKNUM + 1));
+	for (i = 0; i < nrels; i++)
+	{
+		RelFileNodeBackend rnode = rels[i]->smgr_rnode;
+		int			which = rels[i]->smgr_which;
+
+		rnodes[i] = rnode;
+
+		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
+			if (nblocks)
+				nblocks[i * (MAX_FORKNUM + 1) + forknum] =
+					smgrexists(rels[i], forknum) ?
+					smgrnblocks(rels[i], forknum) : 0;
+
+			/* Close the forks at smgr level */
+			(*(smgrsw[which].smgr_close)) (rels[i], forknum);
+		}
+	}
+
+	/*
+	 * Get rid of any remaining buffers for the relations.  bufmgr will just
+	 * drop them without bothering to write the contents.
+	 */
+	DropRelFileNodesAllBuffers(rnodes, nblocks, nrels);
+
+	/*
+	 * It'd be nice to tell the stats collector to forget them immediately,
+	 * too. But we can't because we don't know the OIDs.
+	 */
+
+	/*
+	 * Send a shared-inval message to force other backends to close any
+	 * dangling smgr references they may have for these rels.  We should do
+	 * this before starting the actual unlinking, in case we fail partway
+	 * through that step.  Note that the sinval messages will eventually come
+	 * back to this backend, too, and thereby provide a backstop that we
+	 * closed our own smgr rel.
+	 */
+	for (i = 0; i < nrels; i++)
+		CacheInvalidateSmgr(rnodes[i]);
+
+	/*
+	 * Delete the physical file(s).
+	 *
+	 * Note: smgr_unlink must treat deletion failure as a WARNING, not an
+	 * ERROR, because we've already decided to commit or abort the current
+	 * xact.
+	 */
+
+	for (i = 0; i < nrels; i++)
+	{
+		int			which = rels[i]->smgr_which;
+
+		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+			(*(smgrsw[which].smgr_unlink)) (rnodes[i], forknum, isRedo);
+	}
+
+	pfree(rnodes);
+	if (nblocks)
+		pfree(nblocks);
+}
+
 /*
  *	smgrextend() -- Add a new block to a file.
  *
@@ -444,6 +551,50 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 											  buffer, skipFsync);
 }
 
+/*
+ *	smgrextendv() -- Add nblocks consecutive new blocks to a file.
+ *
+ *		Same as calling smgrextend() for blocknum, blocknum + 1, ... with
+ *		buffers[0], buffers[1], ..., but lets the storage manager coalesce
+ *		the writes into fewer, larger I/O requests.
+ */
+void
+smgrextendv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	(*(smgrsw[reln->smgr_which].smgr_extendv)) (reln, forknum, blocknum,
+												buffers, nblocks, skipFsync);
+}
+
+/*
+ *	smgrreadv() -- read nblocks consecutive blocks of a relation into the
+ *				   supplied buffers.
+ *
+ *		Same as calling smgrread() for each block, but with fewer, larger
+ *		I/O requests.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, BlockNumber nblocks)
+{
+	(*(smgrsw[reln->smgr_which].smgr_readv)) (reln, forknum, blocknum,
+											  buffers, nblocks);
+}
+
+/*
+ *	smgrwritev() -- Write out nblocks consecutive existing blocks.
+ *
+ *		Same as calling smgrwrite() for each block, but with fewer, larger
+ *		I/O requests.
+ */
+void
+smgrwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   char **buffers, BlockNumber nblocks, bool skipFsync)
+{
+	(*(smgrsw[reln->smgr_which].smgr_writev)) (reln, forknum, blocknum,
+											   buffers, nblocks, skipFsync);
+}
+
 /*
  *	smgrnblocks() -- Calculate the number of blocks in the
  *					 supplied relation.
@@ -465,9 +616,12 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 {
 	/*
 	 * Get rid of any buffers for the about-to-be-deleted blocks. bufmgr will
-	 * just drop them without bothering to write the contents.
+	 * just drop them without bothering to write the contents.  Telling it
+	 * the current size lets it look up the doomed blocks individually when
+	 * there are only a few of them.
 	 */
-	DropRelFileNodeBuffers(reln->smgr_rnode, forknum, nblocks);
+	DropRelFileNodeBuffers(reln->smgr_rnode, forknum,
+						   smgrnblocks(reln, forknum), nblocks);
 
 	/*
 	 * Send a shared-inval message to force other backends to close any smgr
@@ -31,8 +31,10 @@
 #include "access/printtup.h"
 #include "access/xact.h"
 #include "commands/copy.h"
+#include "commands/matview.h"
 #include "executor/executor.h"
 #include "executor/functions.h"
+#include "executor/tqueue.h"
 #include "executor/tstoreReceiver.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
@@ -125,6 +127,12 @@ CreateDestReceiver(CommandDest dest)
 
 		case DestSQLFunction:
 			return CreateSQLFunctionDestReceiver();
+
+		case DestTupleQueue:
+			return CreateTupleQueueDestReceiver();
+
+		case DestTransientRel:
+			return CreateTransientRelDestReceiver(InvalidOid);
 	}
 
 	/* should never get here */
@@ -157,6 +165,8 @@ EndCommand(const char *commandTag, CommandDest dest)
 		case DestIntoRel:
 		case DestCopyOut:
 		case DestSQLFunction:
+		case DestTupleQueue:
+		case DestTransientRel:
 			break;
 	}
 }
@@ -198,6 +208,8 @@ NullCommand(CommandDest dest)
 		case DestIntoRel:
 		case DestCopyOut:
 		case DestSQLFunction:
+		case DestTupleQueue:
+		case DestTransientRel:
 			break;
 	}
 }
@@ -241,6 +253,8 @@ ReadyForQuery(CommandDest dest)
 		case DestIntoRel:
 		case DestCopyOut:
 		case DestSQLFunction:
+		case DestTupleQueue:
+		case DestTransientRel:
 			break;
 	}
 }
@@ -57,6 +57,7 @@
 #include "parser/parser.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionproxy.h"
 #include "replication/walsender.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/bufmgr.h"
@@ -202,6 +203,7 @@ static bool IsTransactionExitStmtList(List *parseTrees);
 static bool IsTransactionStmtList(List *parseTrees);
 static void drop_unnamed_stmt(void);
 static void SigHupHandler(SIGNAL_ARGS);
+static void ProcessLogMemoryContextInterrupt(void);
 static void log_disconnections(int code, Datum arg);
 
 
@@ -626,6 +628,9 @@ pg_analyze_and_rewrite_params(Node *parsetree,
 
 	query = transformStmt(pstate, parsetree);
 
+	if (post_parse_analyze_hook)
+		(*post_parse_analyze_hook) (pstate, query);
+
 	free_parsestate(pstate);
 
 	if (log_parser_stats)
@@ -2653,6 +2658,57 @@ SigHupHandler(SIGNAL_ARGS)
 	errno = save_errno;
 }
 
+/*
+ * HandleLogMemoryContextInterrupt: out-of-line portion of the handling of
+ * a request to log our memory contexts, following receipt of SIGUSR1.
+ * pg_log_backend_memory_contexts() sends these.
+ *
+ * Normally this just sets a flag for ProcessInterrupts().  An idle
+ * backend won't get there until the client sends its next command, though,
+ * so if we're waiting for one, we log right away.  Unlike die() and
+ * StatementCancelHandler(), we will return to the interrupted read, so we
+ * must leave the notify and catchup interrupts enabled; instead we clear
+ * ImmediateInterruptOK meanwhile, so that no other handler services its
+ * interrupt in the middle of our logging.
+ */
+void
+HandleLogMemoryContextInterrupt(void)
+{
+	int			save_errno = errno;
+
+	/* Don't joggle the elbow of proc_exit */
+	if (!proc_exit_inprogress)
+	{
+		InterruptPending = true;
+		LogMemoryContextPending = true;
+
+		if (ImmediateInterruptOK && InterruptHoldoffCount == 0 &&
+			CritSectionCount == 0 && DoingCommandRead)
+		{
+			ImmediateInterruptOK = false;
+			ProcessLogMemoryContextInterrupt();
+			ImmediateInterruptOK = true;
+		}
+	}
+
+	errno = save_errno;
+}
+
+/*
+ * ProcessLogMemoryContextInterrupt: write our memory context statistics
+ * to the server log, as requested by HandleLogMemoryContextInterrupt().
+ */
+static void
+ProcessLogMemoryContextInterrupt(void)
+{
+	LogMemoryContextPending = false;
+
+	ereport(LOG,
+			(errhidestmt(true),
+			 errmsg("logging memory contexts of PID %d", MyProcPid)));
+	MemoryContextLogStats(TopMemoryContext);
+}
+
 /*
  * RecoveryConflictInterrupt: out-of-line portion of recovery conflict
  * handling following receipt of SIGUSR1. Designed to be similar to die()
@@ -2796,6 +2852,8 @@ ProcessInterrupts(void)
 	if (InterruptHoldoffCount != 0 || CritSectionCount != 0)
 		return;
 	InterruptPending = false;
+	if (LogMemoryContextPending)
+		ProcessLogMemoryContextInterrupt();
 	if (ProcDiePending)
 	{
 		ProcDiePending = false;
@@ -3422,6 +3480,7 @@ PostgresMain(int argc, char *argv[], const char *username)
 	StringInfoData input_message;
 	sigjmp_buf	local_sigjmp_buf;
 	volatile bool send_ready_for_query = true;
+	volatile bool pool_session = false;
 
 	/*
 	 * Initialize globals (already done if under postmaster, but not if
@@ -3643,7 +3702,15 @@ PostgresMain(int argc, char *argv[], const char *username)
 	process_local_preload_libraries();
 
 	/*
-	 * Send this backend's cancellation info to the frontend.
+	 * Once the startup handshake is over, the session may be handed over to
+	 * the session proxy, to share backends with other sessions.
+	 */
+	pool_session = SessionIsPoolable();
+
+	/*
+	 * Send this backend's cancellation info to the frontend.  A pooled
+	 * session isn't tied to this backend, so it gets a key that matches no
+	 * backend at all.
 	 */
 	if (whereToSendOutput == DestRemote &&
 		PG_PROTOCOL_MAJOR(FrontendProtocol) >= 2)
@@ -3651,8 +3718,8 @@ PostgresMain(int argc, char *argv[], const char *username)
 		StringInfoData buf;
 
 		pq_beginmessage(&buf, 'K');
-		pq_sendint(&buf, (int32) MyProcPid, sizeof(int32));
-		pq_sendint(&buf, (int32) MyCancelKey, sizeof(int32));
+		pq_sendint(&buf, pool_session ? 0 : (int32) MyProcPid, sizeof(int32));
+		pq_sendint(&buf, pool_session ? 0 : (int32) MyCancelKey, sizeof(int32));
 		pq_endmessage(&buf);
 		/* Need not flush since ReadyForQuery will do it. */
 	}
@@ -3829,6 +3896,16 @@ PostgresMain(int argc, char *argv[], const char *username)
 
 			ReadyForQuery(whereToSendOutput);
 			send_ready_for_query = false;
+
+			/*
+			 * The client now waits for its first request to be read; that
+			 * is when the proxy can take the session over.
+			 */
+			if (pool_session)
+			{
+				pool_session = false;
+				(void) SessionProxyHandoff();
+			}
 		}
 
 		/*
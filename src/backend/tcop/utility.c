@@ -35,6 +35,7 @@
 #include "commands/explain.h"
 #include "commands/extension.h"
 #include "commands/lockcmds.h"
+#include "commands/matview.h"
 #include "commands/portalcmds.h"
 #include "commands/prepare.h"
 #include "commands/proclang.h"
@@ -205,6 +206,7 @@ check_xact_readonly(Node *parsetree)
 		case T_CreateRangeStmt:
 		case T_AlterEnumStmt:
 		case T_ViewStmt:
+		case T_RefreshMatViewStmt:
 		case T_DropStmt:
 		case T_DropdbStmt:
 		case T_DropTableSpaceStmt:
@@ -634,6 +636,7 @@ standard_ProcessUtility(Node *parsetree,
 				case OBJECT_TABLE:
 				case OBJECT_SEQUENCE:
 				case OBJECT_VIEW:
+				case OBJECT_MATVIEW:
 				case OBJECT_INDEX:
 				case OBJECT_FOREIGN_TABLE:
 					RemoveRelations((DropStmt *) parsetree);
@@ -915,6 +918,7 @@ standard_ProcessUtility(Node *parsetree,
 							stmt->accessMethod, /* am name */
 							stmt->tableSpace,
 							stmt->indexParams,	/* parameters */
+							stmt->indexIncludingParams,
 							(Expr *) stmt->whereClause,
 							stmt->options,
 							stmt->excludeOpNames,
@@ -1121,19 +1125,29 @@ standard_ProcessUtility(Node *parsetree,
 							  (RecoveryInProgress() ? 0 : CHECKPOINT_FORCE));
 			break;
 
+		case T_RefreshMatViewStmt:
+			ExecRefreshMatView((RefreshMatViewStmt *) parsetree,
+							   queryString, params, completionTag);
+			break;
+
 		case T_ReindexStmt:
 			{
 				ReindexStmt *stmt = (ReindexStmt *) parsetree;
 
 				/* we choose to allow this during "read only" transactions */
 				PreventCommandDuringRecovery("REINDEX");
+				/* Like CREATE INDEX CONCURRENTLY, this commits internally */
+				if (stmt->concurrent)
+					PreventTransactionChain(isTopLevel,
+											"REINDEX CONCURRENTLY");
+
 				switch (stmt->kind)
 				{
 					case OBJECT_INDEX:
-						ReindexIndex(stmt->relation);
+						ReindexIndex(stmt->relation, stmt->concurrent);
 						break;
 					case OBJECT_TABLE:
-						ReindexTable(stmt->relation);
+						ReindexTable(stmt->relation, stmt->concurrent);
 						break;
 					case OBJECT_DATABASE:
 
@@ -1643,6 +1657,9 @@ CreateCommandTag(Node *parsetree)
 				case OBJECT_VIEW:
 					tag = "DROP VIEW";
 					break;
+				case OBJECT_MATVIEW:
+					tag = "DROP MATERIALIZED VIEW";
+					break;
 				case OBJECT_INDEX:
 					tag = "DROP INDEX";
 					break;
@@ -1983,6 +2000,10 @@ CreateCommandTag(Node *parsetree)
 			tag = "CHECKPOINT";
 			break;
 
+		case T_RefreshMatViewStmt:
+			tag = "REFRESH MATERIALIZED VIEW";
+			break;
+
 		case T_ReindexStmt:
 			tag = "REINDEX";
 			break;
@@ -2053,6 +2074,9 @@ CreateCommandTag(Node *parsetree)
 							Assert(IsA(stmt->utilityStmt, DeclareCursorStmt));
 							tag = "DECLARE CURSOR";
 						}
+						else if (stmt->intoClause != NULL &&
+								 stmt->intoClause->relkind == RELKIND_MATVIEW)
+							tag = "CREATE MATERIALIZED VIEW";
 						else if (stmt->intoClause != NULL)
 							tag = "SELECT INTO";
 						else if (stmt->rowMarks != NIL)
@@ -2103,6 +2127,9 @@ CreateCommandTag(Node *parsetree)
 							Assert(IsA(stmt->utilityStmt, DeclareCursorStmt));
 							tag = "DECLARE CURSOR";
 						}
+						else if (stmt->intoClause != NULL &&
+								 stmt->intoClause->relkind == RELKIND_MATVIEW)
+							tag = "CREATE MATERIALIZED VIEW";
 						else if (stmt->intoClause != NULL)
 							tag = "SELECT INTO";
 						else if (stmt->rowMarks != NIL)
@@ -2482,6 +2509,10 @@ GetCommandLogLevel(Node *parsetree)
 			lev = LOGSTMT_ALL;
 			break;
 
+		case T_RefreshMatViewStmt:
+			lev = LOGSTMT_DDL;
+			break;
+
 		case T_ReindexStmt:
 			lev = LOGSTMT_ALL;	/* should this be DDL? */
 			break;
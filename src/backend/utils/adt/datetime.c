@@ -44,8 +44,11 @@ static int DecodeDate(char *str, int fmask, int *tmask, bool *is2digits,
 		   struct pg_tm * tm);
 static int ValidateDate(int fmask, bool isjulian, bool is2digits, bool bc,
 			 struct pg_tm * tm);
+static bool ParseFixedDigits(const char **cp, int ndigits, int *val);
+#ifndef HAVE_INT64_TIMESTAMP
 static void TrimTrailingZeros(char *str);
-static void AppendSeconds(char *cp, int sec, fsec_t fsec,
+#endif
+static char *AppendSeconds(char *cp, int sec, fsec_t fsec,
 			  int precision, bool fillzeros);
 static void AdjustFractSeconds(double frac, struct pg_tm * tm, fsec_t *fsec,
 				   int scale);
@@ -404,6 +407,8 @@ GetCurrentTimeUsec(struct pg_tm * tm, fsec_t *fsec, int *tzp)
 }
 
 
+#ifndef HAVE_INT64_TIMESTAMP
+
 /* TrimTrailingZeros()
  * ... resulting from printing numbers with full precision.
  *
@@ -422,16 +427,37 @@ TrimTrailingZeros(char *str)
 		*(str + len) = '\0';
 	}
 }
+#endif
 
 /*
  * Append sections and fractional seconds (if any) at *cp.
  * precision is the max number of fraction digits, fillzeros says to
  * pad to two integral-seconds digits.
  * Note that any sign is stripped from the input seconds values.
+ *
+ * Returns a pointer to the terminating NUL, so that callers building up a
+ * string can carry on from there.
  */
-static void
+static char *
 AppendSeconds(char *cp, int sec, fsec_t fsec, int precision, bool fillzeros)
 {
+#ifdef HAVE_INT64_TIMESTAMP
+	if (fillzeros)
+		cp = pg_ltostr_zeropad(cp, abs(sec), 2);
+	else
+		cp = pg_ltostr(cp, abs(sec));
+
+	if (fsec != 0)
+	{
+		*cp++ = '.';
+		cp = pg_ltostr_zeropad(cp, (int32) Abs(fsec), precision);
+		/* trim trailing zeros; there's a nonzero digit, so we stop at it */
+		while (cp[-1] == '0')
+			cp--;
+	}
+	*cp = '\0';
+	return cp;
+#else
 	if (fsec == 0)
 	{
 		if (fillzeros)
@@ -441,23 +467,18 @@ AppendSeconds(char *cp, int sec, fsec_t fsec, int precision, bool fillzeros)
 	}
 	else
 	{
-#ifdef HAVE_INT64_TIMESTAMP
-		if (fillzeros)
-			sprintf(cp, "%02d.%0*d", abs(sec), precision, (int) Abs(fsec));
-		else
-			sprintf(cp, "%d.%0*d", abs(sec), precision, (int) Abs(fsec));
-#else
 		if (fillzeros)
 			sprintf(cp, "%0*.*f", precision + 3, precision, fabs(sec + fsec));
 		else
 			sprintf(cp, "%.*f", precision, fabs(sec + fsec));
-#endif
 		TrimTrailingZeros(cp);
 	}
+	return cp + strlen(cp);
+#endif
 }
 
 /* Variant of above that's specialized to timestamp case */
-static void
+static char *
 AppendTimestampSeconds(char *cp, struct pg_tm * tm, fsec_t fsec)
 {
 	/*
@@ -468,7 +489,7 @@ AppendTimestampSeconds(char *cp, struct pg_tm * tm, fsec_t fsec)
 	if (tm->tm_year <= 0)
 		fsec = 0;
 #endif
-	AppendSeconds(cp, tm->tm_sec, fsec, MAX_TIMESTAMP_PRECISION, true);
+	return AppendSeconds(cp, tm->tm_sec, fsec, MAX_TIMESTAMP_PRECISION, true);
 }
 
 /*
@@ -1414,6 +1435,150 @@ DecodeDateTime(char **field, int *ftype, int nf,
 }
 
 
+/*
+ * Parse exactly ndigits decimal digits at *cp into *val, and advance *cp
+ * past them.  Returns false, leaving *cp alone, if they aren't all digits.
+ */
+static bool
+ParseFixedDigits(const char **cp, int ndigits, int *val)
+{
+	const char *p = *cp;
+	int			result = 0;
+
+	while (ndigits-- > 0)
+	{
+		if (!isdigit((unsigned char) *p))
+			return false;
+		result = result * 10 + (*p++ - '0');
+	}
+	*cp = p;
+	*val = result;
+	return true;
+}
+
+/* DecodeISODateTime()
+ * Fast path for date/time input in the ISO 8601 form
+ *	yyyy-mm-dd[ hh:mm[:ss[.ffffff]][+-hh[:mm]]]
+ * that the ISO DateStyle produces, and that dumped data is therefore full of.
+ * The date and time may also be separated by 'T'.
+ *
+ * If the whole of str is in that form, with in-range fields, fills in *tm,
+ * *fsec and *tzp just as ParseDateTime() and DecodeDateTime() would, and
+ * returns true.  Otherwise returns false, and the caller should take the
+ * general route, which also takes care of reporting any error.  As for
+ * DecodeDateTime(), tzp may be NULL if the caller doesn't want a time zone,
+ * and the session time zone applies if the string has none.
+ */
+bool
+DecodeISODateTime(const char *str, struct pg_tm * tm, fsec_t *fsec, int *tzp)
+{
+	const char *cp = str;
+	bool		have_tz = false;
+	int			tz = 0;
+
+	tm->tm_hour = 0;
+	tm->tm_min = 0;
+	tm->tm_sec = 0;
+	*fsec = 0;
+	tm->tm_isdst = -1;
+
+	if (!ParseFixedDigits(&cp, 4, &tm->tm_year) || *cp++ != '-' ||
+		!ParseFixedDigits(&cp, 2, &tm->tm_mon) || *cp++ != '-' ||
+		!ParseFixedDigits(&cp, 2, &tm->tm_mday))
+		return false;
+
+	if (*cp == ' ' || *cp == 'T')
+	{
+		cp++;
+		if (!ParseFixedDigits(&cp, 2, &tm->tm_hour) || *cp++ != ':' ||
+			!ParseFixedDigits(&cp, 2, &tm->tm_min))
+			return false;
+
+		if (*cp == ':')
+		{
+			cp++;
+			if (!ParseFixedDigits(&cp, 2, &tm->tm_sec))
+				return false;
+
+			if (*cp == '.')
+			{
+				int			ndigits = 0;
+				int			frac = 0;
+				int			scale = 1;
+
+				cp++;
+				while (isdigit((unsigned char) *cp))
+				{
+					/* leave rounding of longer fractions to the general path */
+					if (++ndigits > 6)
+						return false;
+					frac = frac * 10 + (*cp++ - '0');
+					scale *= 10;
+				}
+				if (ndigits == 0)
+					return false;
+#ifdef HAVE_INT64_TIMESTAMP
+				*fsec = frac * (USECS_PER_SEC / scale);
+#else
+				*fsec = (double) frac / scale;
+#endif
+			}
+		}
+
+		if (*cp == '+' || *cp == '-')
+		{
+			char		sign = *cp++;
+			int			tzhour;
+			int			tzmin = 0;
+
+			if (!ParseFixedDigits(&cp, 2, &tzhour))
+				return false;
+			if (*cp == ':')
+			{
+				cp++;
+				if (!ParseFixedDigits(&cp, 2, &tzmin))
+					return false;
+			}
+			/* same limits as DecodeTimezone */
+			if (tzhour > 14 || tzmin >= MINS_PER_HOUR)
+				return false;
+
+			/* TZ is negated compared to the displayed sign */
+			tz = (tzhour * MINS_PER_HOUR + tzmin) * SECS_PER_MINUTE;
+			if (sign == '+')
+				tz = -tz;
+			have_tz = true;
+		}
+	}
+
+	if (*cp != '\0')
+		return false;
+
+	/*
+	 * Anything out of range, as well as the special cases of year 0 and
+	 * 24:00:00, goes the general way.
+	 */
+	if (tm->tm_year < 1 ||
+		tm->tm_mon < 1 || tm->tm_mon > MONTHS_PER_YEAR ||
+		tm->tm_mday < 1 ||
+		tm->tm_mday > day_tab[isleap(tm->tm_year)][tm->tm_mon - 1] ||
+		tm->tm_hour >= HOURS_PER_DAY ||
+		tm->tm_min >= MINS_PER_HOUR ||
+		tm->tm_sec >= SECS_PER_MINUTE)
+		return false;
+
+	if (tzp != NULL)
+	{
+		if (have_tz)
+			*tzp = tz;
+		else
+			*tzp = DetermineTimeZoneOffset(tm, session_timezone);
+	}
+
+	return true;
+}
+
+
 /* DetermineTimeZoneOffset()
  *
  * Given a struct pg_tm in which tm_year, tm_mon, tm_mday, tm_hour, tm_min, and
@@ -3609,12 +3774,18 @@ EncodeTimezone(char *str, int tz, int style)
 	/* TZ is negated compared to sign we wish to display ... */
 	*str++ = (tz <= 0 ? '+' : '-');
 
+	str = pg_ltostr_zeropad(str, hour, 2);
+	if (sec != 0 || min != 0 || style == USE_XSD_DATES)
+	{
+		*str++ = ':';
+		str = pg_ltostr_zeropad(str, min, 2);
+	}
 	if (sec != 0)
-		sprintf(str, "%02d:%02d:%02d", hour, min, sec);
-	else if (min != 0 || style == USE_XSD_DATES)
-		sprintf(str, "%02d:%02d", hour, min);
-	else
-		sprintf(str, "%02d", hour);
+	{
+		*str++ = ':';
+		str = pg_ltostr_zeropad(str, sec, 2);
+	}
+	*str = '\0';
 }
 
 /* EncodeDateOnly()
@@ -3630,12 +3801,18 @@ EncodeDateOnly(struct pg_tm * tm, int style, char *str)
 		case USE_ISO_DATES:
 		case USE_XSD_DATES:
 			/* compatible with ISO date formats */
-			if (tm->tm_year > 0)
-				sprintf(str, "%04d-%02d-%02d",
-						tm->tm_year, tm->tm_mon, tm->tm_mday);
-			else
-				sprintf(str, "%04d-%02d-%02d %s",
-						-(tm->tm_year - 1), tm->tm_mon, tm->tm_mday, "BC");
+			str = pg_ltostr_zeropad(str,
+						(tm->tm_year > 0) ? tm->tm_year : -(tm->tm_year - 1), 4);
+			*str++ = '-';
+			str = pg_ltostr_zeropad(str, tm->tm_mon, 2);
+			*str++ = '-';
+			str = pg_ltostr_zeropad(str, tm->tm_mday, 2);
+			if (tm->tm_year <= 0)
+			{
+				memcpy(str, " BC", 3);
+				str += 3;
+			}
+			*str = '\0';
 			break;
 
 		case USE_SQL_DATES:
@@ -3681,10 +3858,11 @@ EncodeDateOnly(struct pg_tm * tm, int style, char *str)
 void
 EncodeTimeOnly(struct pg_tm * tm, fsec_t fsec, int *tzp, int style, char *str)
 {
-	sprintf(str, "%02d:%02d:", tm->tm_hour, tm->tm_min);
-	str += strlen(str);
-
-	AppendSeconds(str, tm->tm_sec, fsec, MAX_TIME_PRECISION, true);
+	str = pg_ltostr_zeropad(str, tm->tm_hour, 2);
+	*str++ = ':';
+	str = pg_ltostr_zeropad(str, tm->tm_min, 2);
+	*str++ = ':';
+	str = AppendSeconds(str, tm->tm_sec, fsec, MAX_TIME_PRECISION, true);
 
 	if (tzp != NULL)
 		EncodeTimezone(str, *tzp, style);
@@ -3714,18 +3892,23 @@ EncodeDateTime(struct pg_tm * tm, fsec_t fsec, int *tzp, char **tzn, int style,
 	{
 		case USE_ISO_DATES:
 		case USE_XSD_DATES:
-			/* Compatible with ISO-8601 date formats */
-
-			if (style == USE_ISO_DATES)
-				sprintf(str, "%04d-%02d-%02d %02d:%02d:",
-						(tm->tm_year > 0) ? tm->tm_year : -(tm->tm_year - 1),
-						tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min);
-			else
-				sprintf(str, "%04d-%02d-%02dT%02d:%02d:",
-						(tm->tm_year > 0) ? tm->tm_year : -(tm->tm_year - 1),
-						tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min);
-
-			AppendTimestampSeconds(str + strlen(str), tm, fsec);
+			/*
+			 * Compatible with ISO-8601 date formats.  This is the default
+			 * style and what pg_dump uses, so build it up piecewise rather
+			 * than through sprintf().
+			 */
+			str = pg_ltostr_zeropad(str,
+						(tm->tm_year > 0) ? tm->tm_year : -(tm->tm_year - 1), 4);
+			*str++ = '-';
+			str = pg_ltostr_zeropad(str, tm->tm_mon, 2);
+			*str++ = '-';
+			str = pg_ltostr_zeropad(str, tm->tm_mday, 2);
+			*str++ = (style == USE_ISO_DATES) ? ' ' : 'T';
+			str = pg_ltostr_zeropad(str, tm->tm_hour, 2);
+			*str++ = ':';
+			str = pg_ltostr_zeropad(str, tm->tm_min, 2);
+			*str++ = ':';
+			str = AppendTimestampSeconds(str, tm, fsec);
 
 			/*
 			 * tzp == NULL indicates that we don't want *any* time zone info
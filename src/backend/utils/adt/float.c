@@ -70,6 +70,7 @@ int			extra_float_digits = 0;		/* Added to DBL_DIG or FLT_DIG */
 
 static int	float4_cmp_internal(float4 a, float4 b);
 static int	float8_cmp_internal(float8 a, float8 b);
+static bool float_fast_strtod(char *num, double *result, char **endptr);
 
 #ifndef HAVE_CBRT
 /*
@@ -175,6 +176,123 @@ is_infinite(double val)
 }
 
 
+/*
+ * Powers of ten that are exact in a double, for float_fast_strtod
+ */
+static const double exact_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * float_fast_strtod - strtod() for the simple inputs that are most common
+ *
+ * If num is a plain decimal number of at most 15 significant digits, with a
+ * power of ten of at most 22 either way, the digits and the power of ten are
+ * both exact in a double, and a single multiplication or division gives the
+ * correctly rounded result, just as strtod() would return but much faster.
+ * In that case store the value in *result, set *endptr past the number and
+ * return true.  For anything else, including all syntax errors, return
+ * false and leave it to strtod().  The number must be followed by
+ * whitespace or the end of the string, so that we never mistake the start
+ * of something strtod() understands for a complete number.
+ *
+ * This relies on the arithmetic being done in double precision, not in the
+ * x87 FPU's extended precision, which would round twice.
+ */
+static bool
+float_fast_strtod(char *num, double *result, char **endptr)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	char	   *p = num;
+	bool		negative = false;
+	bool		have_digits = false;
+	uint64		mantissa = 0;
+	int			ndigits = 0;
+	int			exp10 = 0;
+	double		val;
+
+	if (*p == '-')
+	{
+		negative = true;
+		p++;
+	}
+	else if (*p == '+')
+		p++;
+
+	/* digits before and after the decimal point */
+	for (; isdigit((unsigned char) *p); p++)
+	{
+		have_digits = true;
+		if (mantissa == 0 && *p == '0')
+			continue;			/* leading zero */
+		if (++ndigits > 15)
+			return false;
+		mantissa = mantissa * 10 + (*p - '0');
+	}
+	if (*p == '.')
+	{
+		for (p++; isdigit((unsigned char) *p); p++)
+		{
+			have_digits = true;
+			exp10--;
+			if (mantissa == 0 && *p == '0')
+				continue;
+			if (++ndigits > 15)
+				return false;
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+	}
+	if (!have_digits)
+		return false;
+
+	if (*p == 'e' || *p == 'E')
+	{
+		bool		exp_negative = false;
+		int			exp_value = 0;
+		int			exp_digits = 0;
+
+		p++;
+		if (*p == '-')
+		{
+			exp_negative = true;
+			p++;
+		}
+		else if (*p == '+')
+			p++;
+		for (; isdigit((unsigned char) *p); p++)
+		{
+			if (++exp_digits > 4)
+				return false;
+			exp_value = exp_value * 10 + (*p - '0');
+		}
+		if (exp_digits == 0)
+			return false;
+		exp10 += exp_negative ? -exp_value : exp_value;
+	}
+
+	if (*p != '\0' && !isspace((unsigned char) *p))
+		return false;
+
+	val = (double) mantissa;
+	if (mantissa != 0)
+	{
+		if (exp10 > 22 || exp10 < -22)
+			return false;
+		if (exp10 >= 0)
+			val *= exact_pow10[exp10];
+		else
+			val /= exact_pow10[-exp10];
+	}
+
+	*result = negative ? -val : val;
+	*endptr = p;
+	return true;
+#else
+	return false;
+#endif
+}
+
 /*
  *		float4in		- converts "num" to float
  *						  restricted syntax:
@@ -212,7 +330,8 @@ float4in(PG_FUNCTION_ARGS)
 		num++;
 
 	errno = 0;
-	val = strtod(num, &endptr);
+	if (!float_fast_strtod(num, &val, &endptr))
+		val = strtod(num, &endptr);
 
 	/* did we not see anything that looks like a double? */
 	if (endptr == num || errno != 0)
@@ -330,6 +449,12 @@ float4out(PG_FUNCTION_ARGS)
 			strcpy(ascii, "-Infinity");
 			break;
 		default:
+			if (extra_float_digits > 0)
+			{
+				/* the shortest string that reads back exactly */
+				float_to_shortest_decimal_buf(num, ascii);
+			}
+			else
 			{
 				int			ndig = FLT_DIG + extra_float_digits;
 
@@ -405,7 +530,8 @@ float8in(PG_FUNCTION_ARGS)
 		num++;
 
 	errno = 0;
-	val = strtod(num, &endptr);
+	if (!float_fast_strtod(num, &val, &endptr))
+		val = strtod(num, &endptr);
 
 	/* did we not see anything that looks like a double? */
 	if (endptr == num || errno != 0)
@@ -519,6 +645,12 @@ float8out(PG_FUNCTION_ARGS)
 			strcpy(ascii, "-Infinity");
 			break;
 		default:
+			if (extra_float_digits > 0)
+			{
+				/* the shortest string that reads back exactly */
+				double_to_shortest_decimal_buf(num, ascii);
+			}
+			else
 			{
 				int			ndig = DBL_DIG + extra_float_digits;
 
@@ -1051,21 +1183,12 @@ btfloat8cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(float8_cmp_internal(arg1, arg2));
 }
 
-static int
-btfloat8fastcmp(Datum x, Datum y, SortSupport ssup)
-{
-	float8		arg1 = DatumGetFloat8(x);
-	float8		arg2 = DatumGetFloat8(y);
-
-	return float8_cmp_internal(arg1, arg2);
-}
-
 Datum
 btfloat8sortsupport(PG_FUNCTION_ARGS)
 {
 	SortSupport	ssup = (SortSupport) PG_GETARG_POINTER(0);
 
-	ssup->comparator = btfloat8fastcmp;
+	ssup->comparator = ssup_datum_float8_cmp;
 	PG_RETURN_VOID();
 }
 
@@ -1832,6 +1955,62 @@ float8_accum(PG_FUNCTION_ARGS)
 	}
 }
 
+/*
+ * Merge two transition states of the same aggregate.  Every element of the
+ * float8 accumulator arrays is either the count N or a plain sum, so
+ * combining two of them is just elementwise addition.  This serves both
+ * float8_combine (3-element arrays) and float8_regr_combine (6 elements).
+ */
+static ArrayType *
+float8_combine_arrays(FunctionCallInfo fcinfo, const char *caller, int n)
+{
+	ArrayType  *transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	float8	   *transvalues1;
+	float8	   *transvalues2;
+	float8		newvalues[6];
+	int			i;
+
+	Assert(n <= lengthof(newvalues));
+
+	transvalues1 = check_float8_array(transarray1, caller, n);
+	transvalues2 = check_float8_array(transarray2, caller, n);
+
+	for (i = 0; i < n; i++)
+	{
+		newvalues[i] = transvalues1[i] + transvalues2[i];
+		CHECKFLOATVAL(newvalues[i],
+					  isinf(transvalues1[i]) || isinf(transvalues2[i]), true);
+	}
+
+	/*
+	 * As in the transition functions, scribble on the first input if we're
+	 * invoked as an aggregate, else build a new array.
+	 */
+	if (AggCheckCallContext(fcinfo, NULL))
+	{
+		memcpy(transvalues1, newvalues, n * sizeof(float8));
+		return transarray1;
+	}
+	else
+	{
+		Datum		transdatums[6];
+
+		for (i = 0; i < n; i++)
+			transdatums[i] = Float8GetDatumFast(newvalues[i]);
+
+		return construct_array(transdatums, n,
+							   FLOAT8OID,
+							   sizeof(float8), FLOAT8PASSBYVAL, 'd');
+	}
+}
+
+Datum
+float8_combine(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_ARRAYTYPE_P(float8_combine_arrays(fcinfo, "float8_combine", 3));
+}
+
 Datum
 float4_accum(PG_FUNCTION_ARGS)
 {
@@ -2108,6 +2287,13 @@ float8_regr_accum(PG_FUNCTION_ARGS)
 	}
 }
 
+Datum
+float8_regr_combine(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_ARRAYTYPE_P(float8_combine_arrays(fcinfo,
+												"float8_regr_combine", 6));
+}
+
 Datum
 float8_regr_sxx(PG_FUNCTION_ARGS)
 {
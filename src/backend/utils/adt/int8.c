@@ -721,6 +721,34 @@ int8inc_float8_float8(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Inverse transition functions of COUNT(*) and COUNT(any), used by moving
+ * window aggregates.  The count can't go below zero, since only rows that
+ * were counted are removed again.
+ */
+Datum
+int8dec(PG_FUNCTION_ARGS)
+{
+#ifndef USE_FLOAT8_BYVAL		/* controls int8 too */
+	if (AggCheckCallContext(fcinfo, NULL))
+	{
+		int64	   *arg = (int64 *) PG_GETARG_POINTER(0);
+
+		*arg -= 1;
+		PG_RETURN_POINTER(arg);
+	}
+	else
+#endif
+		PG_RETURN_INT64(PG_GETARG_INT64(0) - 1);
+}
+
+Datum
+int8dec_any(PG_FUNCTION_ARGS)
+{
+	return int8dec(fcinfo);
+}
+
+
 Datum
 int8larger(PG_FUNCTION_ARGS)
 {
@@ -145,10 +145,73 @@ SB_lower_char(unsigned char c, pg_locale_t locale, bool locale_is_c)
 
 #include "like_match.c"
 
+/*
+ * Find the longest run of literal bytes that follows a '%' in a LIKE pattern.
+ *
+ * Every byte of a LIKE pattern other than the wildcards and the escape
+ * character must appear verbatim in a matching string, so any such run must
+ * occur somewhere in the string.  We only bother with runs after the first
+ * '%', since those are the ones that make MatchText backtrack; a literal
+ * prefix is rejected cheaply by MatchText itself.  For simplicity an escape
+ * ends the current run.  Returns the run length, or 0 if there is none (or
+ * the pattern is malformed, in which case we let MatchText complain).
+ */
+static int
+like_required_literal(char *p, int plen, char **lit)
+{
+	bool		seen_percent = false;
+	int			best_len = 0;
+	int			run_len = 0;
+	int			i;
+
+	for (i = 0; i < plen; i++)
+	{
+		if (p[i] == '\\' || p[i] == '%' || p[i] == '_')
+		{
+			if (run_len > best_len)
+			{
+				best_len = run_len;
+				*lit = p + i - run_len;
+			}
+			run_len = 0;
+
+			if (p[i] == '%')
+				seen_percent = true;
+			else if (p[i] == '\\')
+			{
+				if (i + 1 >= plen)
+					return 0;
+				i++;
+			}
+		}
+		else if (seen_percent)
+			run_len++;
+	}
+	if (run_len > best_len)
+	{
+		best_len = run_len;
+		*lit = p + plen - run_len;
+	}
+
+	return best_len;
+}
+
 /* Generic for all cases not requiring inline case-folding */
 static inline int
 GenericMatchText(char *s, int slen, char *p, int plen)
 {
+	char	   *lit;
+	int			litlen;
+
+	/*
+	 * A string lacking one of the pattern's literal runs cannot match; check
+	 * that with a fast bytewise search before doing the full match, which
+	 * can be expensive for patterns like '%foo%bar%'.
+	 */
+	litlen = like_required_literal(p, plen, &lit);
+	if (litlen > 0 && !varstr_contains(s, slen, lit, litlen))
+		return LIKE_FALSE;
+
 	if (pg_database_encoding_max_length() == 1)
 		return SB_MatchText(s, slen, p, plen, 0, true);
 	else if (GetDatabaseEncoding() == PG_UTF8)
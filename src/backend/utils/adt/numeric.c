@@ -34,6 +34,7 @@
 #include "utils/builtins.h"
 #include "utils/int8.h"
 #include "utils/numeric.h"
+#include "utils/sortsupport.h"
 
 /* ----------
  * Uncomment the following to enable compilation of dump_numeric()
@@ -1294,6 +1295,154 @@ numeric_cmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Sort support for numeric.
+ *
+ * Where int64 is passed by value we offer abbreviated keys: an int64 holding
+ * a 7-bit exponent code (weight + 64) above the first four base-NBASE digits
+ * of the absolute value, 14 bits each, negated for negative values.  Zero
+ * maps to 0 and NaN to the largest int64, which sorts it after everything
+ * else as cmp_numerics does.  Weights outside -63..62 are clamped to codes
+ * 0 and 127 with no digits, which keeps the keys ordered, if not very
+ * informative, for such extreme values.
+ */
+#if defined(USE_FLOAT8_BYVAL) && NBASE == 10000
+
+typedef struct
+{
+	bool		have_prev;
+	uint32		prev_hash;
+	int64		prev_abbrev;
+	int			ndistinct_pairs;
+	int			nambiguous_pairs;
+} NumericSortSupport;
+
+#define NUMERIC_ABBREV_NAN		INT64CONST(0x7FFFFFFFFFFFFFFF)
+#endif
+
+static int
+numeric_fast_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	Numeric		num1 = DatumGetNumeric(x);
+	Numeric		num2 = DatumGetNumeric(y);
+	int			result;
+
+	result = cmp_numerics(num1, num2);
+
+	/* we can't afford to leak memory here */
+	if (PointerGetDatum(num1) != x)
+		pfree(num1);
+	if (PointerGetDatum(num2) != y)
+		pfree(num2);
+
+	return result;
+}
+
+#if defined(USE_FLOAT8_BYVAL) && NBASE == 10000
+
+static int
+numeric_abbrev_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		a = DatumGetInt64(x);
+	int64		b = DatumGetInt64(y);
+
+	if (a > b)
+		return 1;
+	else if (a == b)
+		return 0;
+	else
+		return -1;
+}
+
+static Datum
+numeric_abbrev_convert(Datum original, SortSupport ssup)
+{
+	NumericSortSupport *nss = (NumericSortSupport *) ssup->ssup_extra;
+	Numeric		num = DatumGetNumeric(original);
+	int64		res;
+	uint32		hash;
+
+	if (NUMERIC_IS_NAN(num))
+		res = NUMERIC_ABBREV_NAN;
+	else if (NUMERIC_NDIGITS(num) == 0)
+		res = 0;
+	else
+	{
+		NumericDigit *digits = NUMERIC_DIGITS(num);
+		int			ndigits = NUMERIC_NDIGITS(num);
+		int			weight = NUMERIC_WEIGHT(num);
+		int			i;
+
+		if (weight > 62)
+			res = (int64) 127 << 56;
+		else if (weight < -63)
+			res = 0;
+		else
+		{
+			res = (int64) (weight + 64);
+			for (i = 0; i < 4; i++)
+			{
+				res <<= 14;
+				if (i < ndigits)
+					res |= digits[i];
+			}
+		}
+
+		if (NUMERIC_SIGN(num) == NUMERIC_NEG)
+			res = -res;
+	}
+
+	/* compare with the previous value, for the abort test */
+	hash = DatumGetUInt32(DirectFunctionCall1(hash_numeric,
+											  NumericGetDatum(num)));
+	if (nss->have_prev && hash != nss->prev_hash)
+	{
+		nss->ndistinct_pairs++;
+		if (res == nss->prev_abbrev)
+			nss->nambiguous_pairs++;
+	}
+	nss->have_prev = true;
+	nss->prev_hash = hash;
+	nss->prev_abbrev = res;
+
+	if (PointerGetDatum(num) != original)
+		pfree(num);
+
+	return Int64GetDatum(res);
+}
+
+static bool
+numeric_abbrev_abort(int memtupcount, SortSupport ssup)
+{
+	NumericSortSupport *nss = (NumericSortSupport *) ssup->ssup_extra;
+
+	/* same rule as for text: give up if over 5% of differing pairs tie */
+	return nss->nambiguous_pairs > nss->ndistinct_pairs / 20;
+}
+#endif   /* USE_FLOAT8_BYVAL && NBASE == 10000 */
+
+Datum
+numeric_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = numeric_fast_cmp;
+
+#if defined(USE_FLOAT8_BYVAL) && NBASE == 10000
+	if (ssup->abbreviate)
+	{
+		ssup->ssup_extra = MemoryContextAllocZero(ssup->ssup_cxt,
+												  sizeof(NumericSortSupport));
+		ssup->abbrev_full_comparator = numeric_fast_cmp;
+		ssup->comparator = numeric_abbrev_cmp;
+		ssup->abbrev_converter = numeric_abbrev_convert;
+		ssup->abbrev_abort = numeric_abbrev_abort;
+	}
+#endif
+
+	PG_RETURN_VOID();
+}
+
 
 Datum
 numeric_eq(PG_FUNCTION_ARGS)
@@ -2481,8 +2630,9 @@ numeric_float4(PG_FUNCTION_ARGS)
  *
  * Aggregate functions
  *
- * The transition datatype for all these aggregates is a 3-element array
- * of Numeric, holding the values N, sum(X), sum(X*X) in that order.
+ * The transition datatype for the variance and stddev aggregates is a
+ * 3-element array of Numeric, holding the values N, sum(X), sum(X*X) in that
+ * order.  sum() and avg() use the NumericAggState struct below instead.
  *
  * We represent N as a numeric mainly to avoid having to build a special
  * datatype; it's unlikely it'd overflow an int4, but ...
@@ -2529,37 +2679,287 @@ do_numeric_accum(ArrayType *transarray, Numeric newval)
 }
 
 /*
- * Improve avg performance by not caclulating sum(X*X).
+ * sum() and avg() of numeric and int8 don't need sum(X*X), and are common
+ * enough to deserve a leaner transition state: an internal-type struct that
+ * lives in the aggregate's memory context, so that each input doesn't cost a
+ * freshly palloc'd Numeric for the running sum.
+ *
+ * Most inputs of those aggregates are small values with few fractional
+ * digits (int8 columns, money amounts), so we additionally keep a pending
+ * sum in an int64, counted in units of NBASE^-pendingFrac.  Inputs with at
+ * most NUMERIC_AGG_MAX_FRAC fractional NBASE digits and less than
+ * 10^NUMERIC_AGG_MAX_DECIMALS in those units are added there without any
+ * NumericVar arithmetic; the pending sum is folded into sumX only when it
+ * would overflow, or when an input needs a finer scale.
  */
-static ArrayType *
-do_numeric_avg_accum(ArrayType *transarray, Numeric newval)
+#define NUMERIC_AGG_MAX_FRAC		(8 / DEC_DIGITS)
+#define NUMERIC_AGG_MAX_DECIMALS	16
+#define NUMERIC_AGG_MAX_DIGITS		(NUMERIC_AGG_MAX_DECIMALS / DEC_DIGITS)
+#define NUMERIC_AGG_INT64_MAX		INT64CONST(0x7FFFFFFFFFFFFFFF)
+
+typedef struct NumericAggState
 {
-	Datum	   *transdatums;
-	int			ndatums;
-	Datum		N,
-				sumX;
-	ArrayType  *result;
+	MemoryContext agg_context;	/* context the state lives in */
+	int64		N;				/* count of non-NaN inputs */
+	int64		NaNcount;		/* count of NaN inputs */
+	int			maxScale;		/* largest dscale among the inputs */
+	int64		maxScaleCount;	/* number of inputs with that dscale */
+	NumericVar	sumX;			/* sum of inputs, less pendingSum */
+	int64		pendingSum;		/* sum of fast-path inputs, not yet in sumX */
+	int			pendingFrac;	/* fractional NBASE digits of pendingSum */
+} NumericAggState;
+
+static NumericAggState *
+makeNumericAggState(FunctionCallInfo fcinfo)
+{
+	NumericAggState *state;
+	MemoryContext agg_context;
 
-	/* We assume the input is array of numeric */
-	deconstruct_array(transarray,
-					  NUMERICOID, -1, false, 'i',
-					  &transdatums, NULL, &ndatums);
-	if (ndatums != 2)
-		elog(ERROR, "expected 2-element numeric array");
-	N = transdatums[0];
-	sumX = transdatums[1];
+	if (!AggCheckCallContext(fcinfo, &agg_context))
+		elog(ERROR, "aggregate function called in non-aggregate context");
 
-	N = DirectFunctionCall1(numeric_inc, N);
-	sumX = DirectFunctionCall2(numeric_add, sumX,
-							   NumericGetDatum(newval));
+	state = (NumericAggState *) MemoryContextAllocZero(agg_context,
+													sizeof(NumericAggState));
+	state->agg_context = agg_context;
+	state->sumX.sign = NUMERIC_POS;
 
-	transdatums[0] = N;
-	transdatums[1] = sumX;
+	return state;
+}
 
-	result = construct_array(transdatums, 2,
-							 NUMERICOID, -1, false, 'i');
+/*
+ * Make a NumericVar for the int64 "val" counted in units of NBASE^-frac.
+ * The digit buffer is allocated in the current memory context.
+ */
+static void
+scaled_int8_to_numericvar(int64 val, int frac, NumericVar *var)
+{
+	int8_to_numericvar(val, var);
+	var->weight -= frac;
+	var->dscale = frac * DEC_DIGITS;
+}
 
-	return result;
+/* Move the pending sum into sumX */
+static void
+numeric_agg_flush_pending(NumericAggState *state)
+{
+	MemoryContext old_context;
+	NumericVar	pending;
+
+	if (state->pendingSum == 0)
+		return;
+
+	old_context = MemoryContextSwitchTo(state->agg_context);
+
+	init_var(&pending);
+	scaled_int8_to_numericvar(state->pendingSum, state->pendingFrac, &pending);
+	add_var(&state->sumX, &pending, &state->sumX);
+	free_var(&pending);
+
+	MemoryContextSwitchTo(old_context);
+
+	state->pendingSum = 0;
+}
+
+/*
+ * Try to add "val", counted in units of NBASE^-frac, to the pending sum.
+ * Returns false if it can't be represented at the pending sum's scale.
+ */
+static bool
+numeric_agg_add_pending(NumericAggState *state, int64 val, int frac)
+{
+	/* move to a finer scale if needed; only an empty sum can be rescaled */
+	if (frac > state->pendingFrac)
+	{
+		numeric_agg_flush_pending(state);
+		state->pendingFrac = frac;
+	}
+	for (; frac < state->pendingFrac; frac++)
+	{
+		if (val > NUMERIC_AGG_INT64_MAX / NBASE ||
+			val < -(NUMERIC_AGG_INT64_MAX / NBASE))
+			return false;
+		val *= NBASE;
+	}
+
+	if ((val > 0 && state->pendingSum > NUMERIC_AGG_INT64_MAX - val) ||
+		(val < 0 && state->pendingSum < -NUMERIC_AGG_INT64_MAX - val))
+		numeric_agg_flush_pending(state);
+
+	state->pendingSum += val;
+	return true;
+}
+
+/*
+ * Convert a small Numeric to an int64 counted in units of NBASE^-*frac,
+ * reading its digits in place.  Returns false if it doesn't qualify for
+ * the fast path.
+ */
+static bool
+numeric_to_scaled_int8(Numeric num, int64 *result, int *frac)
+{
+	int			ndigits = NUMERIC_NDIGITS(num);
+	int			weight = NUMERIC_WEIGHT(num);
+	NumericDigit *digits = NUMERIC_DIGITS(num);
+	int64		val = 0;
+	int			i;
+
+	*frac = Max(ndigits - weight - 1, 0);
+	if (*frac > NUMERIC_AGG_MAX_FRAC ||
+		weight + 1 + *frac > NUMERIC_AGG_MAX_DIGITS)
+		return false;
+
+	for (i = 0; i < ndigits; i++)
+		val = val * NBASE + digits[i];
+	/* trailing zero digits of an integer aren't stored */
+	for (i = ndigits; i < weight + 1; i++)
+		val *= NBASE;
+
+	*result = (NUMERIC_SIGN(num) == NUMERIC_NEG) ? -val : val;
+	return true;
+}
+
+static void
+do_numeric_sum_accum(NumericAggState *state, Numeric newval)
+{
+	int64		val;
+	int			frac;
+
+	if (NUMERIC_IS_NAN(newval))
+	{
+		state->NaNcount++;
+		return;
+	}
+
+	state->N++;
+	if (NUMERIC_DSCALE(newval) > state->maxScale)
+	{
+		state->maxScale = NUMERIC_DSCALE(newval);
+		state->maxScaleCount = 1;
+	}
+	else if (NUMERIC_DSCALE(newval) == state->maxScale)
+		state->maxScaleCount++;
+
+	if (!numeric_to_scaled_int8(newval, &val, &frac) ||
+		!numeric_agg_add_pending(state, val, frac))
+	{
+		MemoryContext old_context;
+		NumericVar	X;
+
+		/* add_var only reads its inputs, so use the datum's digits as is */
+		X.ndigits = NUMERIC_NDIGITS(newval);
+		X.weight = NUMERIC_WEIGHT(newval);
+		X.sign = NUMERIC_SIGN(newval);
+		X.dscale = NUMERIC_DSCALE(newval);
+		X.buf = NULL;
+		X.digits = NUMERIC_DIGITS(newval);
+
+		old_context = MemoryContextSwitchTo(state->agg_context);
+		add_var(&state->sumX, &X, &state->sumX);
+		MemoryContextSwitchTo(old_context);
+	}
+}
+
+/*
+ * Remove a value added by do_numeric_sum_accum, for the inverse transition
+ * function of moving window aggregates.  Returns false if that can't be
+ * done: once the last input of the largest dscale is gone we no longer know
+ * the dscale of the result.
+ */
+static bool
+do_numeric_sum_discard(NumericAggState *state, Numeric newval)
+{
+	int64		val;
+	int			frac;
+
+	if (NUMERIC_IS_NAN(newval))
+	{
+		state->NaNcount--;
+		return true;
+	}
+
+	if (NUMERIC_DSCALE(newval) == state->maxScale &&
+		--state->maxScaleCount == 0 && state->maxScale > 0)
+		return false;
+
+	state->N--;
+
+	if (!numeric_to_scaled_int8(newval, &val, &frac) ||
+		!numeric_agg_add_pending(state, -val, frac))
+	{
+		MemoryContext old_context;
+		NumericVar	X;
+
+		X.ndigits = NUMERIC_NDIGITS(newval);
+		X.weight = NUMERIC_WEIGHT(newval);
+		X.sign = NUMERIC_SIGN(newval);
+		X.dscale = NUMERIC_DSCALE(newval);
+		X.buf = NULL;
+		X.digits = NUMERIC_DIGITS(newval);
+
+		old_context = MemoryContextSwitchTo(state->agg_context);
+		sub_var(&state->sumX, &X, &state->sumX);
+		MemoryContextSwitchTo(old_context);
+	}
+
+	return true;
+}
+
+static void
+do_int8_sum_accum(NumericAggState *state, int64 newval)
+{
+	state->N++;
+
+	if (!numeric_agg_add_pending(state, newval, 0))
+	{
+		MemoryContext old_context;
+		NumericVar	X;
+
+		old_context = MemoryContextSwitchTo(state->agg_context);
+		init_var(&X);
+		int8_to_numericvar(newval, &X);
+		add_var(&state->sumX, &X, &state->sumX);
+		free_var(&X);
+		MemoryContextSwitchTo(old_context);
+	}
+}
+
+static void
+do_int8_sum_discard(NumericAggState *state, int64 newval)
+{
+	state->N--;
+
+	/* the most negative int64 can't be negated */
+	if (newval == -NUMERIC_AGG_INT64_MAX - 1 ||
+		!numeric_agg_add_pending(state, -newval, 0))
+	{
+		MemoryContext old_context;
+		NumericVar	X;
+
+		old_context = MemoryContextSwitchTo(state->agg_context);
+		init_var(&X);
+		int8_to_numericvar(newval, &X);
+		sub_var(&state->sumX, &X, &state->sumX);
+		free_var(&X);
+		MemoryContextSwitchTo(old_context);
+	}
+}
+
+/*
+ * Compute the total in *result, without modifying the state: window
+ * aggregates may call the final function repeatedly.
+ */
+static void
+numeric_agg_get_sum(NumericAggState *state, NumericVar *result)
+{
+	NumericVar	pending;
+
+	init_var(&pending);
+	scaled_int8_to_numericvar(state->pendingSum, state->pendingFrac, &pending);
+	add_var(&state->sumX, &pending, result);
+	free_var(&pending);
+
+	/* the pending sum's scale may be finer than any input's */
+	result->dscale = state->maxScale;
 }
 
 Datum
@@ -2577,10 +2977,130 @@ numeric_accum(PG_FUNCTION_ARGS)
 Datum
 numeric_avg_accum(PG_FUNCTION_ARGS)
 {
-	ArrayType  *transarray = PG_GETARG_ARRAYTYPE_P(0);
-	Numeric		newval = PG_GETARG_NUMERIC(1);
+	NumericAggState *state;
+
+	state = PG_ARGISNULL(0) ? NULL : (NumericAggState *) PG_GETARG_POINTER(0);
+
+	if (!PG_ARGISNULL(1))
+	{
+		if (state == NULL)
+			state = makeNumericAggState(fcinfo);
+		do_numeric_sum_accum(state, PG_GETARG_NUMERIC(1));
+	}
+
+	if (state == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Inverse transition function of numeric sum() and avg(), used by moving
+ * window aggregates.  Returning NULL tells the executor to recompute the
+ * state from scratch.
+ */
+Datum
+numeric_avg_accum_inv(PG_FUNCTION_ARGS)
+{
+	NumericAggState *state;
+
+	state = PG_ARGISNULL(0) ? NULL : (NumericAggState *) PG_GETARG_POINTER(0);
+
+	/* Should not get here with no state */
+	if (state == NULL)
+		elog(ERROR, "numeric_avg_accum_inv called with NULL state");
+
+	if (!PG_ARGISNULL(1) &&
+		!do_numeric_sum_discard(state, PG_GETARG_NUMERIC(1)))
+		PG_RETURN_NULL();
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Combine two states built by numeric_avg_accum or int8_avg_accum.
+ */
+Datum
+numeric_avg_combine(PG_FUNCTION_ARGS)
+{
+	NumericAggState *state1;
+	NumericAggState *state2;
+	MemoryContext old_context;
+
+	state1 = PG_ARGISNULL(0) ? NULL : (NumericAggState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (NumericAggState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+	if (state1 == NULL)
+		state1 = makeNumericAggState(fcinfo);
+
+	state1->N += state2->N;
+	state1->NaNcount += state2->NaNcount;
+	if (state2->maxScale > state1->maxScale)
+	{
+		state1->maxScale = state2->maxScale;
+		state1->maxScaleCount = state2->maxScaleCount;
+	}
+	else if (state2->maxScale == state1->maxScale)
+		state1->maxScaleCount += state2->maxScaleCount;
+
+	old_context = MemoryContextSwitchTo(state1->agg_context);
+	add_var(&state1->sumX, &state2->sumX, &state1->sumX);
+	MemoryContextSwitchTo(old_context);
+
+	if (!numeric_agg_add_pending(state1, state2->pendingSum,
+								 state2->pendingFrac))
+	{
+		numeric_agg_flush_pending(state1);
+		state1->pendingSum = state2->pendingSum;
+		state1->pendingFrac = state2->pendingFrac;
+		numeric_agg_flush_pending(state1);
+	}
 
-	PG_RETURN_ARRAYTYPE_P(do_numeric_avg_accum(transarray, newval));
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * Combine two transition states built by the array-based Numeric
+ * accumulators, including the integer ones below.  The states are arrays of
+ * N, sum(X) and sum(X*X), all plain sums, so combining is elementwise
+ * addition.
+ */
+Datum
+numeric_combine(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	Datum	   *transdatums1;
+	Datum	   *transdatums2;
+	int			ndatums1;
+	int			ndatums2;
+	int			i;
+	ArrayType  *result;
+
+	/* We assume the inputs are arrays of numeric */
+	deconstruct_array(transarray1,
+					  NUMERICOID, -1, false, 'i',
+					  &transdatums1, NULL, &ndatums1);
+	deconstruct_array(transarray2,
+					  NUMERICOID, -1, false, 'i',
+					  &transdatums2, NULL, &ndatums2);
+	if (ndatums1 != ndatums2 || ndatums1 < 2 || ndatums1 > 3)
+		elog(ERROR, "expected matching 2- or 3-element numeric arrays");
+
+	for (i = 0; i < ndatums1; i++)
+		transdatums1[i] = DirectFunctionCall2(numeric_add,
+											  transdatums1[i],
+											  transdatums2[i]);
+
+	result = construct_array(transdatums1, ndatums1,
+							 NUMERICOID, -1, false, 'i');
+
+	PG_RETURN_ARRAYTYPE_P(result);
 }
 
 /*
@@ -2634,42 +3154,92 @@ int8_accum(PG_FUNCTION_ARGS)
 Datum
 int8_avg_accum(PG_FUNCTION_ARGS)
 {
-	ArrayType  *transarray = PG_GETARG_ARRAYTYPE_P(0);
-	Datum		newval8 = PG_GETARG_DATUM(1);
-	Numeric		newval;
+	NumericAggState *state;
 
-	newval = DatumGetNumeric(DirectFunctionCall1(int8_numeric, newval8));
+	state = PG_ARGISNULL(0) ? NULL : (NumericAggState *) PG_GETARG_POINTER(0);
+
+	if (!PG_ARGISNULL(1))
+	{
+		if (state == NULL)
+			state = makeNumericAggState(fcinfo);
+		do_int8_sum_accum(state, PG_GETARG_INT64(1));
+	}
 
-	PG_RETURN_ARRAYTYPE_P(do_numeric_avg_accum(transarray, newval));
+	if (state == NULL)
+		PG_RETURN_NULL();
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * Inverse transition function of int8 sum() and avg().
+ */
+Datum
+int8_avg_accum_inv(PG_FUNCTION_ARGS)
+{
+	NumericAggState *state;
+
+	state = PG_ARGISNULL(0) ? NULL : (NumericAggState *) PG_GETARG_POINTER(0);
+
+	/* Should not get here with no state */
+	if (state == NULL)
+		elog(ERROR, "int8_avg_accum_inv called with NULL state");
+
+	if (!PG_ARGISNULL(1))
+		do_int8_sum_discard(state, PG_GETARG_INT64(1));
+
+	PG_RETURN_POINTER(state);
 }
 
 
 Datum
 numeric_avg(PG_FUNCTION_ARGS)
 {
-	ArrayType  *transarray = PG_GETARG_ARRAYTYPE_P(0);
-	Datum	   *transdatums;
-	int			ndatums;
-	Numeric		N,
-				sumX;
+	NumericAggState *state;
+	NumericVar	sumX;
+	Datum		sumd;
+	Datum		countd;
 
-	/* We assume the input is array of numeric */
-	deconstruct_array(transarray,
-					  NUMERICOID, -1, false, 'i',
-					  &transdatums, NULL, &ndatums);
-	if (ndatums != 2)
-		elog(ERROR, "expected 2-element numeric array");
-	N = DatumGetNumeric(transdatums[0]);
-	sumX = DatumGetNumeric(transdatums[1]);
+	state = PG_ARGISNULL(0) ? NULL : (NumericAggState *) PG_GETARG_POINTER(0);
 
 	/* SQL92 defines AVG of no values to be NULL */
-	/* N is zero iff no digits (cf. numeric_uminus) */
-	if (NUMERIC_NDIGITS(N) == 0)
+	if (state == NULL || (state->N + state->NaNcount) == 0)
 		PG_RETURN_NULL();
 
-	PG_RETURN_DATUM(DirectFunctionCall2(numeric_div,
-										NumericGetDatum(sumX),
-										NumericGetDatum(N)));
+	if (state->NaNcount > 0)
+		PG_RETURN_NUMERIC(make_result(&const_nan));
+
+	init_var(&sumX);
+	numeric_agg_get_sum(state, &sumX);
+	sumd = NumericGetDatum(make_result(&sumX));
+	free_var(&sumX);
+
+	countd = DirectFunctionCall1(int8_numeric, Int64GetDatumFast(state->N));
+
+	PG_RETURN_DATUM(DirectFunctionCall2(numeric_div, sumd, countd));
+}
+
+Datum
+numeric_sum(PG_FUNCTION_ARGS)
+{
+	NumericAggState *state;
+	NumericVar	sumX;
+	Numeric		result;
+
+	state = PG_ARGISNULL(0) ? NULL : (NumericAggState *) PG_GETARG_POINTER(0);
+
+	/* SQL92 defines SUM of no values to be NULL */
+	if (state == NULL || (state->N + state->NaNcount) == 0)
+		PG_RETURN_NULL();
+
+	if (state->NaNcount > 0)
+		PG_RETURN_NUMERIC(make_result(&const_nan));
+
+	init_var(&sumX);
+	numeric_agg_get_sum(state, &sumX);
+	result = make_result(&sumX);
+	free_var(&sumX);
+
+	PG_RETURN_NUMERIC(result);
 }
 
 /*
@@ -2952,6 +3522,27 @@ int4_sum(PG_FUNCTION_ARGS)
 	}
 }
 
+/*
+ * Inverse transition functions of int2 and int4 sum(), used by moving
+ * window aggregates.  The executor calls them only with a non-null state
+ * and input.
+ */
+Datum
+int2_sum_inv(PG_FUNCTION_ARGS)
+{
+	int64		oldsum = PG_GETARG_INT64(0);
+
+	PG_RETURN_INT64(oldsum - (int64) PG_GETARG_INT16(1));
+}
+
+Datum
+int4_sum_inv(PG_FUNCTION_ARGS)
+{
+	int64		oldsum = PG_GETARG_INT64(0);
+
+	PG_RETURN_INT64(oldsum - (int64) PG_GETARG_INT32(1));
+}
+
 Datum
 int8_sum(PG_FUNCTION_ARGS)
 {
@@ -3055,6 +3646,89 @@ int4_avg_accum(PG_FUNCTION_ARGS)
 	PG_RETURN_ARRAYTYPE_P(transarray);
 }
 
+/*
+ * Inverse transition functions of int2_avg_accum/int4_avg_accum.
+ */
+Datum
+int2_avg_accum_inv(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray;
+	int16		newval = PG_GETARG_INT16(1);
+	Int8TransTypeData *transdata;
+
+	/* same in-place trick as in int2_avg_accum */
+	if (AggCheckCallContext(fcinfo, NULL))
+		transarray = PG_GETARG_ARRAYTYPE_P(0);
+	else
+		transarray = PG_GETARG_ARRAYTYPE_P_COPY(0);
+
+	if (ARR_HASNULL(transarray) ||
+		ARR_SIZE(transarray) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData))
+		elog(ERROR, "expected 2-element int8 array");
+
+	transdata = (Int8TransTypeData *) ARR_DATA_PTR(transarray);
+	transdata->count--;
+	transdata->sum -= newval;
+
+	PG_RETURN_ARRAYTYPE_P(transarray);
+}
+
+Datum
+int4_avg_accum_inv(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray;
+	int32		newval = PG_GETARG_INT32(1);
+	Int8TransTypeData *transdata;
+
+	/* same in-place trick as in int4_avg_accum */
+	if (AggCheckCallContext(fcinfo, NULL))
+		transarray = PG_GETARG_ARRAYTYPE_P(0);
+	else
+		transarray = PG_GETARG_ARRAYTYPE_P_COPY(0);
+
+	if (ARR_HASNULL(transarray) ||
+		ARR_SIZE(transarray) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData))
+		elog(ERROR, "expected 2-element int8 array");
+
+	transdata = (Int8TransTypeData *) ARR_DATA_PTR(transarray);
+	transdata->count--;
+	transdata->sum -= newval;
+
+	PG_RETURN_ARRAYTYPE_P(transarray);
+}
+
+/*
+ * Combine two states built by int2_avg_accum/int4_avg_accum.
+ */
+Datum
+int4_avg_combine(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray1;
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	Int8TransTypeData *transdata1;
+	Int8TransTypeData *transdata2;
+
+	/* same in-place trick as in int4_avg_accum */
+	if (AggCheckCallContext(fcinfo, NULL))
+		transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	else
+		transarray1 = PG_GETARG_ARRAYTYPE_P_COPY(0);
+
+	if (ARR_HASNULL(transarray1) ||
+		ARR_SIZE(transarray1) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData) ||
+		ARR_HASNULL(transarray2) ||
+		ARR_SIZE(transarray2) != ARR_OVERHEAD_NONULLS(1) + sizeof(Int8TransTypeData))
+		elog(ERROR, "expected 2-element int8 array");
+
+	transdata1 = (Int8TransTypeData *) ARR_DATA_PTR(transarray1);
+	transdata2 = (Int8TransTypeData *) ARR_DATA_PTR(transarray2);
+
+	transdata1->count += transdata2->count;
+	transdata1->sum += transdata2->sum;
+
+	PG_RETURN_ARRAYTYPE_P(transarray1);
+}
+
 Datum
 int8_avg(PG_FUNCTION_ARGS)
 {
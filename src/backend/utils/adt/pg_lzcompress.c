@@ -176,6 +176,10 @@
 #include "utils/pg_lzcompress.h"
 
 
+static void pglz_decompress_internal(const PGLZ_Header *source, char *dest,
+						 int32 rawlen, bool check_complete);
+
+
 /* ----------
  * Local definitions
  * ----------
@@ -646,6 +650,64 @@ pglz_compress(const char *source, int32 slen, PGLZ_Header *dest,
  */
 void
 pglz_decompress(const PGLZ_Header *source, char *dest)
+{
+	pglz_decompress_internal(source, dest, source->rawsize, true);
+}
+
+
+/* ----------
+ * pglz_decompress_prefix -
+ *
+ *		Decompresses only the first rawlen bytes of source into dest, which
+ *		must have room for that many.  rawlen must not exceed the raw size
+ *		recorded in source.  The compressed data in source may be truncated,
+ *		as long as at least pglz_maximum_compressed_size(rawlen, ...) bytes
+ *		of it are present; VARSIZE(source) gives the amount present.
+ * ----------
+ */
+void
+pglz_decompress_prefix(const PGLZ_Header *source, char *dest, int32 rawlen)
+{
+	Assert(rawlen <= source->rawsize);
+	pglz_decompress_internal(source, dest, rawlen, rawlen == source->rawsize);
+}
+
+
+/* ----------
+ * pglz_maximum_compressed_size -
+ *
+ *		Returns how many bytes of compressed data (not counting the
+ *		PGLZ_Header) can be needed to decompress the first rawlen bytes of a
+ *		datum whose compressed data is total_compressed_size bytes long.
+ *
+ *		In the worst case every output byte is a literal, costing one input
+ *		byte plus one control bit; a tag that straddles the boundary can
+ *		need two more bytes than that.
+ * ----------
+ */
+int32
+pglz_maximum_compressed_size(int32 rawlen, int32 total_compressed_size)
+{
+	int64		compressed_size;
+
+	compressed_size = ((int64) rawlen * 9 + 7) / 8 + 2;
+
+	return (int32) Min(compressed_size, (int64) total_compressed_size);
+}
+
+
+/* ----------
+ * pglz_decompress_internal -
+ *
+ *		Decompress rawlen bytes of source into dest.  If check_complete is
+ *		true, rawlen is the full raw size, and all of source must be used
+ *		up exactly; otherwise we stop as soon as rawlen bytes are out, and
+ *		source may stop early.
+ * ----------
+ */
+static void
+pglz_decompress_internal(const PGLZ_Header *source, char *dest, int32 rawlen,
+						 bool check_complete)
 {
 	const unsigned char *sp;
 	const unsigned char *srcend;
@@ -655,7 +717,7 @@ pglz_decompress(const PGLZ_Header *source, char *dest)
 	sp = ((const unsigned char *) source) + sizeof(PGLZ_Header);
 	srcend = ((const unsigned char *) source) + VARSIZE(source);
 	dp = (unsigned char *) dest;
-	destend = dp + source->rawsize;
+	destend = dp + rawlen;
 
 	while (sp < srcend && dp < destend)
 	{
@@ -680,11 +742,29 @@ pglz_decompress(const PGLZ_Header *source, char *dest)
 				int32		len;
 				int32		off;
 
+				/* A truncated input can end in the middle of a tag */
+				if (!check_complete && sp + 2 > srcend)
+				{
+					sp = srcend;
+					break;
+				}
+
 				len = (sp[0] & 0x0f) + 3;
 				off = ((sp[0] & 0xf0) << 4) | sp[1];
 				sp += 2;
 				if (len == 18)
+				{
+					if (!check_complete && sp >= srcend)
+						break;
 					len += *sp++;
+				}
+
+				/*
+				 * When decompressing just a prefix, the match may run past
+				 * the part we want; copy only what fits.
+				 */
+				if (!check_complete && dp + len > destend)
+					len = destend - dp;
 
 				/*
 				 * Check for output buffer overrun, to ensure we don't clobber
@@ -733,7 +813,7 @@ pglz_decompress(const PGLZ_Header *source, char *dest)
 	/*
 	 * Check we decompressed the right amount.
 	 */
-	if (dp != destend || sp != srcend)
+	if (dp != destend || (check_complete && sp != srcend))
 		elog(ERROR, "compressed data is corrupt");
 
 	/*
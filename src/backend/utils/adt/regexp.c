@@ -29,6 +29,7 @@
  */
 #include "postgres.h"
 
+#include "access/hash.h"
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "regex/regex.h"
@@ -97,6 +98,9 @@ typedef struct cached_re_str
 	int			cre_pat_len;	/* length of original RE, in bytes */
 	int			cre_flags;		/* compile flags: extended,icase etc */
 	Oid			cre_collation;	/* collation to use */
+	uint32		cre_hash;		/* hash of cre_pat */
+	int			cre_must_off;	/* offset of required literal in cre_pat */
+	int			cre_must_len;	/* its length in bytes, or 0 if none */
 	regex_t		cre_re;			/* the compiled regular expression */
 } cached_re_str;
 
@@ -105,6 +109,10 @@ static cached_re_str re_array[MAX_CACHED_RES];	/* cached re's */
 
 
 /* Local functions */
+static cached_re_str *RE_compile_and_cache_entry(text *text_re, int cflags,
+						   Oid collation);
+static void RE_find_required_literal(char *pat, int pat_len, int cflags,
+						 int *must_off, int *must_len);
 static regexp_matches_ctx *setup_regexp_matches(text *orig_str, text *pattern,
 					 text *flags,
 					 Oid collation,
@@ -130,9 +138,22 @@ static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
  */
 static regex_t *
 RE_compile_and_cache(text *text_re, int cflags, Oid collation)
+{
+	return &RE_compile_and_cache_entry(text_re, cflags, collation)->cre_re;
+}
+
+/*
+ * RE_compile_and_cache_entry - workhorse for RE_compile_and_cache
+ *
+ * Same as above, but returns the whole cache entry, which is valid only
+ * until the next call.
+ */
+static cached_re_str *
+RE_compile_and_cache_entry(text *text_re, int cflags, Oid collation)
 {
 	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
 	char	   *text_re_val = VARDATA_ANY(text_re);
+	uint32		text_re_hash;
 	pg_wchar   *pattern;
 	int			pattern_len;
 	int			i;
@@ -140,6 +161,9 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	cached_re_str re_temp;
 	char		errMsg[100];
 
+	text_re_hash = DatumGetUInt32(hash_any((unsigned char *) text_re_val,
+										   text_re_len));
+
 	/*
 	 * Look for a match among previously compiled REs.	Since the data
 	 * structure is self-organizing with most-used entries at the front, our
@@ -147,7 +171,8 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	 */
 	for (i = 0; i < num_res; i++)
 	{
-		if (re_array[i].cre_pat_len == text_re_len &&
+		if (re_array[i].cre_hash == text_re_hash &&
+			re_array[i].cre_pat_len == text_re_len &&
 			re_array[i].cre_flags == cflags &&
 			re_array[i].cre_collation == collation &&
 			memcmp(re_array[i].cre_pat, text_re_val, text_re_len) == 0)
@@ -162,7 +187,7 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 				re_array[0] = re_temp;
 			}
 
-			return &re_array[0].cre_re;
+			return &re_array[0];
 		}
 	}
 
@@ -213,6 +238,11 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	re_temp.cre_pat_len = text_re_len;
 	re_temp.cre_flags = cflags;
 	re_temp.cre_collation = collation;
+	re_temp.cre_hash = text_re_hash;
+
+	/* Since the pattern compiled, it is safe to scan it for a literal */
+	RE_find_required_literal(re_temp.cre_pat, text_re_len, cflags,
+							 &re_temp.cre_must_off, &re_temp.cre_must_len);
 
 	/*
 	 * Okay, we have a valid new item in re_temp; insert it into the storage
@@ -232,7 +262,181 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	re_array[0] = re_temp;
 	num_res++;
 
-	return &re_array[0].cre_re;
+	return &re_array[0];
+}
+
+/*
+ * RE_find_required_literal - find a literal string every match must contain
+ *
+ *	pat, pat_len --- the pattern, in the database encoding; it must be known
+ *		to compile successfully
+ *	cflags --- compile options for the pattern
+ *	must_off, must_len --- output: location of the literal within pat;
+ *		*must_len is set to zero if we found nothing useful
+ *
+ * Any string matched by the RE must contain the returned byte sequence, so a
+ * data string that lacks it can be rejected without running the regex
+ * engine.  We only need to be conservative, not thorough: we look at the
+ * top level of plain AREs (and at quoted patterns, which are all literal),
+ * and keep the longest run of ordinary characters that is not broken by an
+ * escape, a bracket expression, a group or a quantifier.  A top-level
+ * alternation, case-insensitive or expanded syntax, or embedded options make
+ * us give up entirely.
+ */
+static void
+RE_find_required_literal(char *pat, int pat_len, int cflags,
+						 int *must_off, int *must_len)
+{
+	int			depth = 0;
+	int			run_start = 0;
+	int			run_len = 0;
+	int			last_start = 0;
+	int			i = 0;
+
+	*must_off = 0;
+	*must_len = 0;
+
+	if (cflags & (REG_ICASE | REG_EXPANDED))
+		return;
+
+	if (cflags & REG_QUOTE)
+	{
+		*must_len = pat_len;
+		return;
+	}
+
+	if ((cflags & REG_ADVANCED) != REG_ADVANCED)
+		return;
+
+	/* directors and embedded options could change the rules */
+	if (pat_len >= 2 &&
+		((pat[0] == '*' && pat[1] == '*') || (pat[0] == '(' && pat[1] == '?')))
+		return;
+
+#define RE_IS_ASCII_ALNUM(c) \
+	(((c) >= '0' && (c) <= '9') || ((c) >= 'A' && (c) <= 'Z') || \
+	 ((c) >= 'a' && (c) <= 'z'))
+#define END_RUN() \
+	do { \
+		if (run_len > *must_len) \
+		{ \
+			*must_off = run_start; \
+			*must_len = run_len; \
+		} \
+		run_len = 0; \
+	} while (0)
+
+	while (i < pat_len)
+	{
+		char		c = pat[i];
+
+		switch (c)
+		{
+			case '\\':
+				/* an escape; skip it, including any alphanumeric argument */
+				END_RUN();
+				i++;
+				if (i < pat_len)
+				{
+					if (RE_IS_ASCII_ALNUM(pat[i]))
+					{
+						while (i < pat_len && RE_IS_ASCII_ALNUM(pat[i]))
+							i++;
+					}
+					else
+						i += pg_mblen(pat + i);
+				}
+				continue;
+
+			case '[':
+				/* a bracket expression; find its end */
+				END_RUN();
+				i++;
+				if (i < pat_len && pat[i] == '^')
+					i++;
+				if (i < pat_len && pat[i] == ']')
+					i++;
+				while (i < pat_len && pat[i] != ']')
+				{
+					if (pat[i] == '[' && i + 1 < pat_len &&
+						(pat[i + 1] == ':' || pat[i + 1] == '.' ||
+						 pat[i + 1] == '='))
+					{
+						char		delim = pat[i + 1];
+
+						i += 2;
+						while (i + 1 < pat_len &&
+							   !(pat[i] == delim && pat[i + 1] == ']'))
+							i++;
+						i += 2;
+					}
+					else
+						i += pg_mblen(pat + i);
+				}
+				i++;
+				continue;
+
+			case '(':
+				END_RUN();
+				depth++;
+				break;
+
+			case ')':
+				END_RUN();
+				depth--;
+				break;
+
+			case '|':
+				if (depth == 0)
+				{
+					*must_len = 0;
+					return;
+				}
+				break;
+
+			case '*':
+			case '?':
+			case '{':
+				/* the preceding character becomes optional */
+				if (run_len > 0)
+					run_len = last_start - run_start;
+				END_RUN();
+				if (c == '{')
+				{
+					/* skip the repetition bounds */
+					while (i < pat_len && pat[i] != '}')
+						i++;
+				}
+				break;
+
+			case '+':
+				/* the preceding character is still required once */
+				END_RUN();
+				break;
+
+			case '.':
+			case '^':
+			case '$':
+				END_RUN();
+				break;
+
+			default:
+				if (depth == 0)
+				{
+					if (run_len == 0)
+						run_start = i;
+					last_start = i;
+					run_len = i + pg_mblen(pat + i) - run_start;
+				}
+				i += pg_mblen(pat + i);
+				continue;
+		}
+		i++;
+	}
+	END_RUN();
+
+#undef RE_IS_ASCII_ALNUM
+#undef END_RUN
 }
 
 /*
@@ -330,12 +534,24 @@ RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 					   int cflags, Oid collation,
 					   int nmatch, regmatch_t *pmatch)
 {
-	regex_t    *re;
+	cached_re_str *cre;
 
 	/* Compile RE */
-	re = RE_compile_and_cache(text_re, cflags, collation);
+	cre = RE_compile_and_cache_entry(text_re, cflags, collation);
+
+	/*
+	 * If the RE requires a literal string, check for it in the raw data
+	 * first.  This rejects most non-matching strings without the expense of
+	 * converting the data to pg_wchar and running the regex engine.  A
+	 * byte-level search is safe in any server encoding, since a match would
+	 * necessarily contain the literal's bytes.
+	 */
+	if (cre->cre_must_len > 0 &&
+		!varstr_contains(dat, dat_len,
+						 cre->cre_pat + cre->cre_must_off, cre->cre_must_len))
+		return false;
 
-	return RE_execute(re, dat, dat_len, nmatch, pmatch);
+	return RE_execute(&cre->cre_re, dat, dat_len, nmatch, pmatch);
 }
 
 
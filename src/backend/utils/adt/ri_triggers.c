@@ -42,7 +42,9 @@
 #include "parser/parse_coerce.h"
 #include "parser/parse_relation.h"
 #include "miscadmin.h"
+#include "storage/proc.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
@@ -61,6 +63,8 @@
 #define RI_MAX_NUMKEYS					INDEX_MAX_KEYS
 
 #define RI_INIT_QUERYHASHSIZE			128
+#define RI_INIT_CHECKEDKEYSIZE			256
+#define RI_MAX_CHECKEDKEYS				8192
 
 #define RI_KEYS_ALL_NULL				0
 #define RI_KEYS_SOME_NULL				1
@@ -173,9 +177,35 @@ typedef struct RI_CompareHashEntry
 	bool		valid;			/* successfully initialized? */
 	FmgrInfo	eq_opr_finfo;	/* call info for equality fn */
 	FmgrInfo	cast_func_finfo;	/* in case we must coerce input */
+	FmgrInfo	hash_func_finfo;	/* hash fn compatible with eq_opr, if any */
 } RI_CompareHashEntry;
 
 
+/* ----------
+ * RI_CheckedKey
+ *
+ *	The key identifying an FK value already found to have a PK match
+ * ----------
+ */
+typedef struct RI_CheckedKey
+{
+	Oid			constr_id;		/* OID of pg_constraint entry */
+	uint32		hashvalue;		/* combined hash of the FK key values */
+} RI_CheckedKey;
+
+
+/* ----------
+ * RI_CheckedKeyEntry
+ * ----------
+ */
+typedef struct RI_CheckedKeyEntry
+{
+	RI_CheckedKey key;
+	bool		valid;			/* values[] hold a verified key? */
+	Datum		values[RI_MAX_NUMKEYS];		/* the FK key values */
+} RI_CheckedKeyEntry;
+
+
 /* ----------
  * Local data
  * ----------
@@ -183,6 +213,22 @@ typedef struct RI_CompareHashEntry
 static HTAB *ri_query_cache = NULL;
 static HTAB *ri_compare_cache = NULL;
 
+/*
+ * FK key values that RI_FKey_check has verified in the current
+ * subtransaction.  The matching PK rows are share-locked by us, so nobody
+ * else can remove them, and a repeated key can skip the lookup.  When we
+ * change or delete PK rows ourselves, the PK-side triggers forget the keys
+ * of their constraint, and TRUNCATE forgets them all, since a referencing
+ * row inserted afterwards must not find its key here.  Since row locks
+ * taken in a subtransaction go away if it aborts, the cache is also
+ * forgotten whenever the current (sub)transaction changes.
+ */
+static HTAB *ri_checked_keys = NULL;
+static MemoryContext ri_checked_keys_cxt = NULL;
+static long ri_checked_keys_count = 0;
+static LocalTransactionId ri_checked_keys_lxid = InvalidLocalTransactionId;
+static SubTransactionId ri_checked_keys_subid = InvalidSubTransactionId;
+
 
 /* ----------
  * Local function prototypes
@@ -222,6 +268,13 @@ static void ri_InitHashTables(void);
 static SPIPlanPtr ri_FetchPreparedPlan(RI_QueryKey *key);
 static void ri_HashPreparedPlan(RI_QueryKey *key, SPIPlanPtr plan);
 static RI_CompareHashEntry *ri_HashCompareOp(Oid eq_opr, Oid typeid);
+static bool ri_HashCheckedKey(const RI_ConstraintInfo *riinfo,
+				  Relation fk_rel, HeapTuple row, uint32 *hashvalue);
+static bool ri_CheckedKeyKnown(const RI_ConstraintInfo *riinfo,
+				   Relation fk_rel, HeapTuple row, uint32 hashvalue);
+static void ri_ForgetCheckedKeys(Oid constr_id);
+static void ri_RememberCheckedKey(const RI_ConstraintInfo *riinfo,
+					  Relation fk_rel, HeapTuple row, uint32 hashvalue);
 
 static void ri_CheckTrigger(FunctionCallInfo fcinfo, const char *funcname,
 				int tgkind);
@@ -261,6 +314,8 @@ RI_FKey_check(PG_FUNCTION_ARGS)
 	Buffer		new_row_buf;
 	RI_QueryKey qkey;
 	SPIPlanPtr	qplan;
+	bool		hashable;
+	uint32		hashvalue;
 	int			i;
 
 	/*
@@ -446,6 +501,17 @@ RI_FKey_check(PG_FUNCTION_ARGS)
 			break;
 	}
 
+	/*
+	 * Bulk loads typically reference the same PK rows over and over; don't
+	 * look up a key again if we already verified it.
+	 */
+	hashable = ri_HashCheckedKey(&riinfo, fk_rel, new_row, &hashvalue);
+	if (hashable && ri_CheckedKeyKnown(&riinfo, fk_rel, new_row, hashvalue))
+	{
+		heap_close(pk_rel, RowShareLock);
+		return PointerGetDatum(NULL);
+	}
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed");
 
@@ -507,6 +573,10 @@ RI_FKey_check(PG_FUNCTION_ARGS)
 	if (SPI_finish() != SPI_OK_FINISH)
 		elog(ERROR, "SPI_finish failed");
 
+	/* The key exists (or we'd have errored out), so remember it */
+	if (hashable)
+		ri_RememberCheckedKey(&riinfo, fk_rel, new_row, hashvalue);
+
 	heap_close(pk_rel, RowShareLock);
 
 	return PointerGetDatum(NULL);
@@ -702,6 +772,12 @@ RI_FKey_noaction_del(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -879,6 +955,12 @@ RI_FKey_noaction_upd(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -1064,6 +1146,12 @@ RI_FKey_cascade_del(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -1228,6 +1316,12 @@ RI_FKey_cascade_upd(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -1421,6 +1515,12 @@ RI_FKey_restrict_del(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -1593,6 +1693,12 @@ RI_FKey_restrict_upd(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -1768,6 +1874,12 @@ RI_FKey_setnull_del(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -1941,6 +2053,12 @@ RI_FKey_setnull_upd(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -2154,6 +2272,12 @@ RI_FKey_setdefault_del(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -2337,6 +2461,12 @@ RI_FKey_setdefault_upd(PG_FUNCTION_ARGS)
 	ri_FetchConstraintInfo(&riinfo,
 						   trigdata->tg_trigger, trigdata->tg_relation, true);
 
+	/*
+	 * The PK row is changing or going away, so keys verified against it
+	 * must be looked up again.
+	 */
+	ri_ForgetCheckedKeys(riinfo.constraint_id);
+
 	/*
 	 * Nothing to do if no column names to compare given
 	 */
@@ -4011,6 +4141,7 @@ ri_HashCompareOp(Oid eq_opr, Oid typeid)
 		Oid			lefttype,
 					righttype,
 					castfunc;
+		RegProcedure hashfunc;
 		CoercionPathType pathtype;
 
 		/* We always need to know how to call the equality operator */
@@ -4059,6 +4190,13 @@ ri_HashCompareOp(Oid eq_opr, Oid typeid)
 						  TopMemoryContext);
 		else
 			entry->cast_func_finfo.fn_oid = InvalidOid;
+
+		/* Remember a matching hash function too, if the operator has one */
+		if (get_op_hash_functions(eq_opr, &hashfunc, NULL))
+			fmgr_info_cxt(hashfunc, &entry->hash_func_finfo,
+						  TopMemoryContext);
+		else
+			entry->hash_func_finfo.fn_oid = InvalidOid;
 		entry->valid = true;
 	}
 
@@ -4066,6 +4204,233 @@ ri_HashCompareOp(Oid eq_opr, Oid typeid)
 }
 
 
+/* ----------
+ * ri_HashCheckedKey -
+ *
+ *	Compute the hash of the FK key of a row for the checked-key cache.
+ *	Returns false if some key column has no hash function compatible with
+ *	its equality operator, in which case the key can't be cached.
+ *
+ *	NB: we have already checked that no key column is null.
+ * ----------
+ */
+static bool
+ri_HashCheckedKey(const RI_ConstraintInfo *riinfo,
+				  Relation fk_rel, HeapTuple row, uint32 *hashvalue)
+{
+	TupleDesc	tupdesc = RelationGetDescr(fk_rel);
+	uint32		result = 0;
+	int			i;
+
+	for (i = 0; i < riinfo->nkeys; i++)
+	{
+		RI_CompareHashEntry *entry;
+		Datum		value;
+		bool		isnull;
+
+		entry = ri_HashCompareOp(riinfo->ff_eq_oprs[i],
+								 RIAttType(fk_rel, riinfo->fk_attnums[i]));
+		if (!OidIsValid(entry->hash_func_finfo.fn_oid))
+			return false;
+
+		value = heap_getattr(row, riinfo->fk_attnums[i], tupdesc, &isnull);
+		Assert(!isnull);
+		if (OidIsValid(entry->cast_func_finfo.fn_oid))
+			value = FunctionCall3(&entry->cast_func_finfo,
+								  value,
+								  Int32GetDatum(-1),	/* typmod */
+								  BoolGetDatum(false)); /* implicit coercion */
+
+		/* rotate the previous bits and mix in this column's hash */
+		result = (result << 1) | ((result & 0x80000000) ? 1 : 0);
+		result ^= DatumGetUInt32(FunctionCall1(&entry->hash_func_finfo,
+											   value));
+	}
+
+	*hashvalue = result;
+	return true;
+}
+
+/* ----------
+ * ri_CheckedKeyKnown -
+ *
+ *	Has the FK key of the row already been verified for this constraint in
+ *	the current subtransaction?  Throws the cache away first if it was
+ *	filled by some other (sub)transaction.
+ * ----------
+ */
+static bool
+ri_CheckedKeyKnown(const RI_ConstraintInfo *riinfo,
+				   Relation fk_rel, HeapTuple row, uint32 hashvalue)
+{
+	TupleDesc	tupdesc = RelationGetDescr(fk_rel);
+	RI_CheckedKey key;
+	RI_CheckedKeyEntry *entry;
+	int			i;
+
+	if (ri_checked_keys == NULL)
+		return false;
+
+	if (ri_checked_keys_lxid != MyProc->lxid ||
+		ri_checked_keys_subid != GetCurrentSubTransactionId())
+	{
+		MemoryContextReset(ri_checked_keys_cxt);
+		ri_checked_keys = NULL;
+		return false;
+	}
+
+	key.constr_id = riinfo->constraint_id;
+	key.hashvalue = hashvalue;
+	entry = (RI_CheckedKeyEntry *) hash_search(ri_checked_keys,
+											   (void *) &key,
+											   HASH_FIND, NULL);
+	if (entry == NULL || !entry->valid)
+		return false;
+
+	/* Make sure it's really the same key, not just a hash collision */
+	for (i = 0; i < riinfo->nkeys; i++)
+	{
+		Datum		value;
+		bool		isnull;
+
+		value = heap_getattr(row, riinfo->fk_attnums[i], tupdesc, &isnull);
+		if (!ri_AttributesEqual(riinfo->ff_eq_oprs[i],
+								RIAttType(fk_rel, riinfo->fk_attnums[i]),
+								entry->values[i], value))
+			return false;
+	}
+
+	return true;
+}
+
+/* ----------
+ * ri_ForgetCheckedKeys -
+ *
+ *	Remove the keys verified for a constraint from the cache.  The memory of
+ *	their values is only given back when the cache is reset.
+ * ----------
+ */
+static void
+ri_ForgetCheckedKeys(Oid constr_id)
+{
+	HASH_SEQ_STATUS status;
+	RI_CheckedKeyEntry *entry;
+
+	if (ri_checked_keys == NULL)
+		return;
+
+	hash_seq_init(&status, ri_checked_keys);
+	while ((entry = (RI_CheckedKeyEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.constr_id == constr_id &&
+			hash_search(ri_checked_keys, (void *) &entry->key,
+						HASH_REMOVE, NULL) == NULL)
+			elog(ERROR, "hash table corrupted");
+	}
+}
+
+/* ----------
+ * RI_ForgetAllCheckedKeys -
+ *
+ *	Empty the cache of verified keys, for TRUNCATE, which removes PK rows
+ *	without firing the PK-side triggers.
+ * ----------
+ */
+void
+RI_ForgetAllCheckedKeys(void)
+{
+	if (ri_checked_keys == NULL)
+		return;
+
+	MemoryContextReset(ri_checked_keys_cxt);
+	ri_checked_keys = NULL;
+}
+
+/* ----------
+ * ri_RememberCheckedKey -
+ *
+ *	Enter the FK key of a row that was just verified into the cache,
+ *	replacing any other key with the same hash value.
+ * ----------
+ */
+static void
+ri_RememberCheckedKey(const RI_ConstraintInfo *riinfo,
+					  Relation fk_rel, HeapTuple row, uint32 hashvalue)
+{
+	TupleDesc	tupdesc = RelationGetDescr(fk_rel);
+	RI_CheckedKey key;
+	RI_CheckedKeyEntry *entry;
+	MemoryContext oldcxt;
+	int			i;
+
+	if (ri_checked_keys_cxt == NULL)
+		ri_checked_keys_cxt = AllocSetContextCreate(TopMemoryContext,
+													"RI checked keys",
+													ALLOCSET_DEFAULT_MINSIZE,
+													ALLOCSET_DEFAULT_INITSIZE,
+													ALLOCSET_DEFAULT_MAXSIZE);
+
+	/*
+	 * Start over if the cache belongs to another (sub)transaction, or if it
+	 * has grown too big; the keys of a large load needn't all fit.
+	 */
+	if (ri_checked_keys != NULL &&
+		(ri_checked_keys_lxid != MyProc->lxid ||
+		 ri_checked_keys_subid != GetCurrentSubTransactionId() ||
+		 ri_checked_keys_count >= RI_MAX_CHECKEDKEYS))
+	{
+		MemoryContextReset(ri_checked_keys_cxt);
+		ri_checked_keys = NULL;
+	}
+
+	if (ri_checked_keys == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(RI_CheckedKey);
+		ctl.entrysize = sizeof(RI_CheckedKeyEntry);
+		ctl.hash = tag_hash;
+		ctl.hcxt = ri_checked_keys_cxt;
+		ri_checked_keys = hash_create("RI checked keys",
+									  RI_INIT_CHECKEDKEYSIZE, &ctl,
+									  HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+		ri_checked_keys_count = 0;
+		ri_checked_keys_lxid = MyProc->lxid;
+		ri_checked_keys_subid = GetCurrentSubTransactionId();
+	}
+
+	key.constr_id = riinfo->constraint_id;
+	key.hashvalue = hashvalue;
+	entry = (RI_CheckedKeyEntry *) hash_search(ri_checked_keys,
+											   (void *) &key,
+											   HASH_ENTER, NULL);
+	entry->valid = false;
+
+	/*
+	 * Copy the values into the cache's context.  Varlena values are
+	 * detoasted, so that we don't depend on the row's TOAST data.
+	 */
+	oldcxt = MemoryContextSwitchTo(ri_checked_keys_cxt);
+	for (i = 0; i < riinfo->nkeys; i++)
+	{
+		Form_pg_attribute att = tupdesc->attrs[riinfo->fk_attnums[i] - 1];
+		Datum		value;
+		bool		isnull;
+
+		value = heap_getattr(row, riinfo->fk_attnums[i], tupdesc, &isnull);
+		if (att->attlen == -1)
+			entry->values[i] = PointerGetDatum(PG_DETOAST_DATUM_COPY(value));
+		else
+			entry->values[i] = datumCopy(value, att->attbyval, att->attlen);
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	entry->valid = true;
+	ri_checked_keys_count++;
+}
+
+
 /*
  * Given a trigger function OID, determine whether it is an RI trigger,
  * and if so whether it is attached to PK or FK relation.
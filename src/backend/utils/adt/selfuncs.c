@@ -91,7 +91,9 @@
 #include <ctype.h>
 #include <math.h>
 
+#include "access/brin.h"
 #include "access/gin.h"
+#include "access/nbtree.h"
 #include "access/sysattr.h"
 #include "catalog/index.h"
 #include "catalog/pg_collation.h"
@@ -177,6 +179,8 @@ static bool get_actual_variable_range(PlannerInfo *root,
 						  VariableStatData *vardata,
 						  Oid sortop,
 						  Datum *min, Datum *max);
+static bool estimate_group_ndistinct(RelOptInfo *rel, List *relvarinfos,
+						 double *reldistinct, double *relmaxndistinct);
 static RelOptInfo *find_join_input_rel(PlannerInfo *root, Relids relids);
 static Selectivity prefix_selectivity(PlannerInfo *root,
 				   VariableStatData *vardata,
@@ -3009,6 +3013,87 @@ add_unique_group_var(PlannerInfo *root, List *varinfos,
 	return varinfos;
 }
 
+/*
+ * estimate_group_ndistinct
+ *		Helper for estimate_num_groups: apply column group statistics.
+ *
+ * relvarinfos are the GroupVarInfos of one rel.  If the rel has statistics
+ * for a group of columns all of which are among the Vars, pick the largest
+ * such group, and recompute *reldistinct and *relmaxndistinct using its
+ * number of distinct combinations in place of its columns' own numbers.
+ * Returns true if the group covers all the Vars, so that the result is
+ * based on the data rather than guesswork about correlation.
+ */
+static bool
+estimate_group_ndistinct(RelOptInfo *rel, List *relvarinfos,
+						 double *reldistinct, double *relmaxndistinct)
+{
+	Bitmapset  *attnums = NULL;
+	ExtStatistics *best = NULL;
+	double		ndistinct;
+	int			ncovered = 0;
+	ListCell   *lc;
+	int			i;
+
+	foreach(lc, relvarinfos)
+	{
+		GroupVarInfo *varinfo = (GroupVarInfo *) lfirst(lc);
+		Var		   *var = (Var *) varinfo->var;
+
+		if (IsA(var, Var) && var->varno == rel->relid && var->varattno > 0)
+			attnums = bms_add_member(attnums, var->varattno);
+	}
+
+	foreach(lc, rel->extstats)
+	{
+		ExtStatistics *stat = (ExtStatistics *) lfirst(lc);
+
+		if (stat->ndistinct == 0 || (best && stat->nkeys <= best->nkeys))
+			continue;
+		for (i = 0; i < stat->nkeys; i++)
+		{
+			if (!bms_is_member(stat->keys[i], attnums))
+				break;
+		}
+		if (i == stat->nkeys)
+			best = stat;
+	}
+	bms_free(attnums);
+
+	if (best == NULL)
+		return false;
+
+	ndistinct = best->ndistinct;
+	if (ndistinct < 0)
+		ndistinct = -ndistinct * rel->tuples;
+	*reldistinct = *relmaxndistinct = ndistinct;
+
+	foreach(lc, relvarinfos)
+	{
+		GroupVarInfo *varinfo = (GroupVarInfo *) lfirst(lc);
+		Var		   *var = (Var *) varinfo->var;
+
+		if (IsA(var, Var) && var->varno == rel->relid)
+		{
+			for (i = 0; i < best->nkeys; i++)
+			{
+				if (best->keys[i] == var->varattno)
+					break;
+			}
+			if (i < best->nkeys)
+			{
+				ncovered++;
+				continue;
+			}
+		}
+		*reldistinct *= varinfo->ndistinct;
+		if (*relmaxndistinct < varinfo->ndistinct)
+			*relmaxndistinct = varinfo->ndistinct;
+	}
+
+	return ncovered == list_length(relvarinfos);
+}
+
 /*
  * estimate_num_groups		- Estimate number of groups in a grouped query
  *
@@ -3027,9 +3112,9 @@ add_unique_group_var(PlannerInfo *root, List *varinfos,
  *	input_rows - number of rows estimated to arrive at the group/unique
  *		filter step
  *
- * Given the lack of any cross-correlation statistics in the system, it's
- * impossible to do anything really trustworthy with GROUP BY conditions
- * involving multiple Vars.  We should however avoid assuming the worst
+ * Unless there are statistics for a group of the columns involved (see
+ * step 4), it's impossible to do anything really trustworthy with GROUP BY
+ * conditions involving multiple Vars.  We should however avoid assuming the worst
  * case (all possible cross-product terms actually appear as groups) since
  * very often the grouped-by Vars are highly correlated.  Our current approach
  * is as follows:
@@ -3061,7 +3146,11 @@ add_unique_group_var(PlannerInfo *root, List *varinfos,
  *		the initial product is probably too high (it's the worst case) but
  *		clamping to a fraction of the rel's rows seems to be a helpful
  *		heuristic for not letting the estimate get out of hand.  (The factor
- *		of 10 is derived from pre-Postgres-7.4 practice.)  Multiplying
+ *		of 10 is derived from pre-Postgres-7.4 practice.)  However, if the
+ *		rel has statistics for a group of its columns that are among the
+ *		Vars, the group's number of distinct combinations replaces the
+ *		product of those Vars' numbers; and if that accounts for all the
+ *		Vars, we don't need the fudge factor.  Multiplying
  *		by the restriction selectivity is effectively assuming that the
  *		restriction clauses are independent of the grouping, which is a crummy
  *		assumption, but it's hard to do better.
@@ -3183,6 +3272,8 @@ estimate_num_groups(PlannerInfo *root, List *groupExprs, double input_rows)
 		double		reldistinct = varinfo1->ndistinct;
 		double		relmaxndistinct = reldistinct;
 		int			relvarcount = 1;
+		bool		relknown = false;
+		List	   *relvarinfos = list_make1(varinfo1);
 		List	   *newvarinfos = NIL;
 
 		/*
@@ -3195,6 +3286,7 @@ estimate_num_groups(PlannerInfo *root, List *groupExprs, double input_rows)
 
 			if (varinfo2->rel == varinfo1->rel)
 			{
+				relvarinfos = lappend(relvarinfos, varinfo2);
 				reldistinct *= varinfo2->ndistinct;
 				if (relmaxndistinct < varinfo2->ndistinct)
 					relmaxndistinct = varinfo2->ndistinct;
@@ -3207,6 +3299,13 @@ estimate_num_groups(PlannerInfo *root, List *groupExprs, double input_rows)
 			}
 		}
 
+		/* Use column group statistics if we have them */
+		if (relvarcount > 1 && rel->extstats != NIL)
+			relknown = estimate_group_ndistinct(rel, relvarinfos,
+												&reldistinct,
+												&relmaxndistinct);
+		list_free(relvarinfos);
+
 		/*
 		 * Sanity check --- don't divide by zero if empty relation.
 		 */
@@ -3222,7 +3321,7 @@ estimate_num_groups(PlannerInfo *root, List *groupExprs, double input_rows)
 			 */
 			double		clamp = rel->tuples;
 
-			if (relvarcount > 1)
+			if (relvarcount > 1 && !relknown)
 			{
 				clamp *= 0.1;
 				if (clamp < relmaxndistinct)
@@ -4265,7 +4364,7 @@ examine_variable(PlannerInfo *root, Node *node, int varRelid,
 						 * should match has_unique_index().
 						 */
 						if (index->unique &&
-							index->ncolumns == 1 &&
+							index->nkeycolumns == 1 &&
 							(index->indpred == NIL || index->predOK))
 							vardata->isunique = true;
 
@@ -6229,6 +6328,127 @@ genericcostestimate(PlannerInfo *root,
 }
 
 
+/*
+ * Estimate the correlation between index order and heap order, from the
+ * statistics for the index's leading column.  Returns 0 if unknown.
+ *
+ * The index's first opfamily must provide a "<" operator as strategy 1.
+ */
+static double
+index_first_column_correlation(PlannerInfo *root, IndexOptInfo *index)
+{
+	Oid			relid;
+	AttrNumber	colnum;
+	VariableStatData vardata;
+	double		indexCorrelation = 0.0;
+
+	/*
+	 * If we can get an estimate of the first column's ordering correlation C
+	 * from pg_statistic, estimate the index correlation as C for a
+	 * single-column index, or C * 0.75 for multiple columns. (The idea here
+	 * is that multiple columns dilute the importance of the first column's
+	 * ordering, but don't negate it entirely.  Before 8.0 we divided the
+	 * correlation by the number of columns, but that seems too strong.)
+	 */
+	MemSet(&vardata, 0, sizeof(vardata));
+
+	if (index->indexkeys[0] != 0)
+	{
+		/* Simple variable --- look to stats for the underlying table */
+		RangeTblEntry *rte = planner_rt_fetch(index->rel->relid, root);
+
+		Assert(rte->rtekind == RTE_RELATION);
+		relid = rte->relid;
+		Assert(relid != InvalidOid);
+		colnum = index->indexkeys[0];
+
+		if (get_relation_stats_hook &&
+			(*get_relation_stats_hook) (root, rte, colnum, &vardata))
+		{
+			/*
+			 * The hook took control of acquiring a stats tuple.  If it did
+			 * supply a tuple, it'd better have supplied a freefunc.
+			 */
+			if (HeapTupleIsValid(vardata.statsTuple) &&
+				!vardata.freefunc)
+				elog(ERROR, "no function provided to release variable stats with");
+		}
+		else
+		{
+			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
+												 ObjectIdGetDatum(relid),
+												 Int16GetDatum(colnum),
+												 BoolGetDatum(rte->inh));
+			vardata.freefunc = ReleaseSysCache;
+		}
+	}
+	else
+	{
+		/* Expression --- maybe there are stats for the index itself */
+		relid = index->indexoid;
+		colnum = 1;
+
+		if (get_index_stats_hook &&
+			(*get_index_stats_hook) (root, relid, colnum, &vardata))
+		{
+			/*
+			 * The hook took control of acquiring a stats tuple.  If it did
+			 * supply a tuple, it'd better have supplied a freefunc.
+			 */
+			if (HeapTupleIsValid(vardata.statsTuple) &&
+				!vardata.freefunc)
+				elog(ERROR, "no function provided to release variable stats with");
+		}
+		else
+		{
+			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
+												 ObjectIdGetDatum(relid),
+												 Int16GetDatum(colnum),
+												 BoolGetDatum(false));
+			vardata.freefunc = ReleaseSysCache;
+		}
+	}
+
+	if (HeapTupleIsValid(vardata.statsTuple))
+	{
+		Oid			sortop;
+		float4	   *numbers;
+		int			nnumbers;
+
+		sortop = get_opfamily_member(index->opfamily[0],
+									 index->opcintype[0],
+									 index->opcintype[0],
+									 BTLessStrategyNumber);
+		if (OidIsValid(sortop) &&
+			get_attstatsslot(vardata.statsTuple, InvalidOid, 0,
+							 STATISTIC_KIND_CORRELATION,
+							 sortop,
+							 NULL,
+							 NULL, NULL,
+							 &numbers, &nnumbers))
+		{
+			double		varCorrelation;
+
+			Assert(nnumbers == 1);
+			varCorrelation = numbers[0];
+
+			if (index->reverse_sort && index->reverse_sort[0])
+				varCorrelation = -varCorrelation;
+
+			if (index->nkeycolumns > 1)
+				indexCorrelation = varCorrelation * 0.75;
+			else
+				indexCorrelation = varCorrelation;
+
+			free_attstatsslot(InvalidOid, NULL, 0, numbers, nnumbers);
+		}
+	}
+
+	ReleaseVariableStats(vardata);
+
+	return indexCorrelation;
+}
+
 Datum
 btcostestimate(PG_FUNCTION_ARGS)
 {
@@ -6240,9 +6460,6 @@ btcostestimate(PG_FUNCTION_ARGS)
 	Selectivity *indexSelectivity = (Selectivity *) PG_GETARG_POINTER(5);
 	double	   *indexCorrelation = (double *) PG_GETARG_POINTER(6);
 	IndexOptInfo *index = path->indexinfo;
-	Oid			relid;
-	AttrNumber	colnum;
-	VariableStatData vardata;
 	double		numIndexTuples;
 	List	   *indexBoundQuals;
 	int			indexcol;
@@ -6250,6 +6467,7 @@ btcostestimate(PG_FUNCTION_ARGS)
 	bool		found_saop;
 	bool		found_is_null_op;
 	double		num_sa_scans;
+	double		num_skip_scans;
 	ListCell   *lcc,
 			   *lci;
 
@@ -6380,6 +6598,55 @@ btcostestimate(PG_FUNCTION_ARGS)
 		indexBoundQuals = lappend(indexBoundQuals, rinfo);
 	}
 
+	/*
+	 * If there are no quals on the first index column but some on the
+	 * second, the executor may run the scan as a skip scan: one primitive
+	 * scan per distinct value of the first column, within which the second
+	 * column's quals act as boundary quals.  It does that only when the first
+	 * column has few enough distinct values (see _bt_preprocess_skip_key),
+	 * so make the same check here and then charge for the extra descents.
+	 */
+	num_skip_scans = 0;
+	if (indexBoundQuals == NIL &&
+		index->nkeycolumns >= 2 &&
+		index->indexkeys[0] != 0)
+	{
+		List	   *skipQuals = NIL;
+		bool		skippable = true;
+
+		forboth(lcc, path->indexquals, lci, path->indexqualcols)
+		{
+			RestrictInfo *rinfo = (RestrictInfo *) lfirst(lcc);
+
+			/* the executor doesn't combine skipping with array keys */
+			if (IsA(rinfo->clause, ScalarArrayOpExpr))
+			{
+				skippable = false;
+				break;
+			}
+			if (lfirst_int(lci) == 1 && !IsA(rinfo->clause, RowCompareExpr))
+				skipQuals = lappend(skipQuals, rinfo);
+		}
+
+		if (skippable && skipQuals != NIL)
+		{
+			TargetEntry *tle = (TargetEntry *) linitial(index->indextlist);
+			VariableStatData skipdata;
+			double		ndistinct;
+			bool		isdefault;
+
+			examine_variable(root, (Node *) tle->expr, 0, &skipdata);
+			ndistinct = get_variable_numdistinct(&skipdata, &isdefault);
+			ReleaseVariableStats(skipdata);
+
+			if (!isdefault && BTSkipScanWorthwhile(ndistinct, index->pages))
+			{
+				indexBoundQuals = skipQuals;
+				num_skip_scans = ndistinct;
+			}
+		}
+	}
+
 	/*
 	 * If index is unique and we found an '=' clause for each column, we can
 	 * just assume numIndexTuples = 1 and skip the expensive
@@ -6387,7 +6654,7 @@ btcostestimate(PG_FUNCTION_ARGS)
 	 * NullTest invalidates that theory, even though it sets eqQualHere.
 	 */
 	if (index->unique &&
-		indexcol == index->ncolumns - 1 &&
+		indexcol == index->nkeycolumns - 1 &&
 		eqQualHere &&
 		!found_saop &&
 		!found_is_null_op)
@@ -6416,108 +6683,21 @@ btcostestimate(PG_FUNCTION_ARGS)
 						indexSelectivity, indexCorrelation);
 
 	/*
-	 * If we can get an estimate of the first column's ordering correlation C
-	 * from pg_statistic, estimate the index correlation as C for a
-	 * single-column index, or C * 0.75 for multiple columns. (The idea here
-	 * is that multiple columns dilute the importance of the first column's
-	 * ordering, but don't negate it entirely.  Before 8.0 we divided the
-	 * correlation by the number of columns, but that seems too strong.)
+	 * For a skip scan, numIndexTuples counted the tuples visited by all the
+	 * primitive scans together.  Add one random page fetch per primitive scan
+	 * for the descent that positions it.
 	 */
-	MemSet(&vardata, 0, sizeof(vardata));
-
-	if (index->indexkeys[0] != 0)
-	{
-		/* Simple variable --- look to stats for the underlying table */
-		RangeTblEntry *rte = planner_rt_fetch(index->rel->relid, root);
-
-		Assert(rte->rtekind == RTE_RELATION);
-		relid = rte->relid;
-		Assert(relid != InvalidOid);
-		colnum = index->indexkeys[0];
-
-		if (get_relation_stats_hook &&
-			(*get_relation_stats_hook) (root, rte, colnum, &vardata))
-		{
-			/*
-			 * The hook took control of acquiring a stats tuple.  If it did
-			 * supply a tuple, it'd better have supplied a freefunc.
-			 */
-			if (HeapTupleIsValid(vardata.statsTuple) &&
-				!vardata.freefunc)
-				elog(ERROR, "no function provided to release variable stats with");
-		}
-		else
-		{
-			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
-												 ObjectIdGetDatum(relid),
-												 Int16GetDatum(colnum),
-												 BoolGetDatum(rte->inh));
-			vardata.freefunc = ReleaseSysCache;
-		}
-	}
-	else
-	{
-		/* Expression --- maybe there are stats for the index itself */
-		relid = index->indexoid;
-		colnum = 1;
-
-		if (get_index_stats_hook &&
-			(*get_index_stats_hook) (root, relid, colnum, &vardata))
-		{
-			/*
-			 * The hook took control of acquiring a stats tuple.  If it did
-			 * supply a tuple, it'd better have supplied a freefunc.
-			 */
-			if (HeapTupleIsValid(vardata.statsTuple) &&
-				!vardata.freefunc)
-				elog(ERROR, "no function provided to release variable stats with");
-		}
-		else
-		{
-			vardata.statsTuple = SearchSysCache3(STATRELATTINH,
-												 ObjectIdGetDatum(relid),
-												 Int16GetDatum(colnum),
-												 BoolGetDatum(false));
-			vardata.freefunc = ReleaseSysCache;
-		}
-	}
-
-	if (HeapTupleIsValid(vardata.statsTuple))
+	if (num_skip_scans > 0)
 	{
-		Oid			sortop;
-		float4	   *numbers;
-		int			nnumbers;
-
-		sortop = get_opfamily_member(index->opfamily[0],
-									 index->opcintype[0],
-									 index->opcintype[0],
-									 BTLessStrategyNumber);
-		if (OidIsValid(sortop) &&
-			get_attstatsslot(vardata.statsTuple, InvalidOid, 0,
-							 STATISTIC_KIND_CORRELATION,
-							 sortop,
-							 NULL,
-							 NULL, NULL,
-							 &numbers, &nnumbers))
-		{
-			double		varCorrelation;
-
-			Assert(nnumbers == 1);
-			varCorrelation = numbers[0];
-
-			if (index->reverse_sort[0])
-				varCorrelation = -varCorrelation;
-
-			if (index->ncolumns > 1)
-				*indexCorrelation = varCorrelation * 0.75;
-			else
-				*indexCorrelation = varCorrelation;
+		double		spc_random_page_cost;
 
-			free_attstatsslot(InvalidOid, NULL, 0, numbers, nnumbers);
-		}
+		get_tablespace_page_costs(index->reltablespace,
+								  &spc_random_page_cost,
+								  NULL);
+		*indexTotalCost += num_skip_scans * spc_random_page_cost;
 	}
 
-	ReleaseVariableStats(vardata);
+	*indexCorrelation = index_first_column_correlation(root, index);
 
 	PG_RETURN_VOID();
 }
@@ -6576,6 +6756,65 @@ spgcostestimate(PG_FUNCTION_ARGS)
 	PG_RETURN_VOID();
 }
 
+/*
+ * BRIN indexes are read in their entirety by every scan, and return whole
+ * block ranges.  The fraction of the heap visited depends on how well the
+ * column's values follow the physical order of the table: with perfect
+ * correlation only the ranges actually holding matches are read (plus one
+ * range of slop at either end), with none at all every range qualifies.
+ */
+Datum
+brincostestimate(PG_FUNCTION_ARGS)
+{
+	PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+	IndexPath  *path = (IndexPath *) PG_GETARG_POINTER(1);
+	RelOptInfo *outer_rel = (RelOptInfo *) PG_GETARG_POINTER(2);
+	Cost	   *indexStartupCost = (Cost *) PG_GETARG_POINTER(3);
+	Cost	   *indexTotalCost = (Cost *) PG_GETARG_POINTER(4);
+	Selectivity *indexSelectivity = (Selectivity *) PG_GETARG_POINTER(5);
+	double	   *indexCorrelation = (double *) PG_GETARG_POINTER(6);
+	IndexOptInfo *index = path->indexinfo;
+	Relation	indexRel;
+	BlockNumber pagesPerRange;
+	double		heapPages;
+	double		numRanges;
+	double		correlation;
+	double		spc_seq_page_cost;
+	Selectivity selec;
+
+	genericcostestimate(root, path, outer_rel, 0.0,
+						indexStartupCost, indexTotalCost,
+						indexSelectivity, indexCorrelation);
+
+	/* the range size is kept in the metapage */
+	indexRel = index_open(index->indexoid, AccessShareLock);
+	pagesPerRange = brin_getdesc(indexRel)->pagesPerRange;
+	index_close(indexRel, AccessShareLock);
+
+	heapPages = Max(index->rel->pages, 1);
+	numRanges = ceil(heapPages / pagesPerRange);
+
+	correlation = index_first_column_correlation(root, index);
+
+	selec = *indexSelectivity;
+	selec += (1.0 - fabs(correlation)) * (1.0 - selec);
+	selec += 2.0 * pagesPerRange / heapPages;
+	*indexSelectivity = Min(selec, 1.0);
+	*indexCorrelation = correlation;
+
+	/* the whole index is read sequentially, and every range is checked */
+	get_tablespace_page_costs(index->reltablespace,
+							  NULL,
+							  &spc_seq_page_cost);
+
+	*indexStartupCost = 0;
+	*indexTotalCost = index->pages * spc_seq_page_cost +
+		numRanges * (cpu_index_tuple_cost +
+					 list_length(path->indexquals) * cpu_operator_cost);
+
+	PG_RETURN_VOID();
+}
+
 
 /*
  * Support routines for gincostestimate
@@ -6596,7 +6835,7 @@ find_index_column(Node *op, IndexOptInfo *index)
 {
 	int			i;
 
-	for (i = 0; i < index->ncolumns; i++)
+	for (i = 0; i < index->nkeycolumns; i++)
 	{
 		if (match_index_to_operand(op, i, index))
 			return i;
@@ -0,0 +1,1308 @@
+/*-------------------------------------------------------------------------
+ *
+ * shortest_dec.c
+ *	  Shortest decimal representations of float4 and float8 values.
+ *
+ * float4out and float8out use these functions to print the shortest string
+ * of decimal digits that reads back as exactly the same value, rather than
+ * asking printf() for a fixed number of digits, which gives either a
+ * rounded value or needlessly long output, and is slow besides.
+ *
+ * The digits are found with the Ryu algorithm, described in Ulf Adams,
+ * "Ryu: Fast Float-to-String Conversion", PLDI 2018.  A binary floating
+ * point value m * 2^e is correctly represented by any decimal number
+ * closer to it than to its neighbours.  Ryu computes the bounds of that
+ * interval, scaled by a power of ten, with 128-bit fixed-point arithmetic
+ * (64-bit for float4) against tables of powers of five, and then removes
+ * decimal digits for as long as the bounds still differ.  The tables below
+ * are computed by the formulas given with each of them.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/adt/shortest_dec.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "utils/builtins.h"
+
+
+#define DOUBLE_MANTISSA_BITS	52
+#define DOUBLE_EXPONENT_BITS	11
+#define DOUBLE_BIAS				1023
+
+#define FLOAT_MANTISSA_BITS		23
+#define FLOAT_EXPONENT_BITS		8
+#define FLOAT_BIAS				127
+
+/*
+ * DOUBLE_POW5_INV_SPLIT[i] is floor(2^(pow5bits(i) - 1 + 122) / 5^i) + 1,
+ * and DOUBLE_POW5_SPLIT[i] is 5^i scaled to have exactly 121 bits, both as
+ * 128-bit numbers split into {low, high} halves.  FLOAT_POW5_INV_SPLIT and
+ * FLOAT_POW5_SPLIT are the same with 59 and 61 bits, in 64-bit numbers.
+ */
+#define DOUBLE_POW5_INV_BITCOUNT	122
+#define DOUBLE_POW5_BITCOUNT		121
+#define FLOAT_POW5_INV_BITCOUNT		59
+#define FLOAT_POW5_BITCOUNT			61
+
+static const uint64 DOUBLE_POW5_INV_SPLIT[292][2] = {
+	{UINT64CONST(0x0000000000000001), UINT64CONST(0x0400000000000000)},
+	{UINT64CONST(0x3333333333333334), UINT64CONST(0x0333333333333333)},
+	{UINT64CONST(0x28f5c28f5c28f5c3), UINT64CONST(0x028f5c28f5c28f5c)},
+	{UINT64CONST(0xed916872b020c49c), UINT64CONST(0x020c49ba5e353f7c)},
+	{UINT64CONST(0xaf4f0d844d013a93), UINT64CONST(0x0346dc5d63886594)},
+	{UINT64CONST(0x8c3f3e0370cdc876), UINT64CONST(0x029f16b11c6d1e10)},
+	{UINT64CONST(0xd698fe69270b06c5), UINT64CONST(0x0218def416bdb1a6)},
+	{UINT64CONST(0xf0f4ca41d811a46e), UINT64CONST(0x035afe535795e90a)},
+	{UINT64CONST(0xf3f70834acdae9f1), UINT64CONST(0x02af31dc4611873b)},
+	{UINT64CONST(0x5cc5a02a23e254c1), UINT64CONST(0x0225c17d04dad296)},
+	{UINT64CONST(0xfad5cd10396a2135), UINT64CONST(0x036f9bfb3af7b756)},
+	{UINT64CONST(0xfbde3da69454e75e), UINT64CONST(0x02bfaffc2f2c92ab)},
+	{UINT64CONST(0x2fe4fe1edd10b918), UINT64CONST(0x0232f33025bd4223)},
+	{UINT64CONST(0x4ca19697c81ac1bf), UINT64CONST(0x0384b84d092ed038)},
+	{UINT64CONST(0x3d4e1213067bce33), UINT64CONST(0x02d09370d4257360)},
+	{UINT64CONST(0x643e74dc052fd829), UINT64CONST(0x024075f3dceac2b3)},
+	{UINT64CONST(0x6d30baf9a1e626a7), UINT64CONST(0x039a5652fb113785)},
+	{UINT64CONST(0x2426fbfae7eb5220), UINT64CONST(0x02e1dea8c8da92d1)},
+	{UINT64CONST(0x1cebfcc8b9890e80), UINT64CONST(0x024e4bba3a487574)},
+	{UINT64CONST(0x94acc7a78f41b0cc), UINT64CONST(0x03b07929f6da5586)},
+	{UINT64CONST(0xaa23d2ec729af3d7), UINT64CONST(0x02f394219248446b)},
+	{UINT64CONST(0xbb4fdbf05baf2979), UINT64CONST(0x025c768141d369ef)},
+	{UINT64CONST(0xc54c931a2c4b758d), UINT64CONST(0x03c7240202ebdcb2)},
+	{UINT64CONST(0x9dd6dc14f03c5e0b), UINT64CONST(0x0305b66802564a28)},
+	{UINT64CONST(0x4b1249aa59c9e4d6), UINT64CONST(0x026af8533511d4ed)},
+	{UINT64CONST(0x44ea0f76f60fd489), UINT64CONST(0x03de5a1ebb4fbb15)},
+	{UINT64CONST(0x6a54d92bf80caa07), UINT64CONST(0x0318481895d96277)},
+	{UINT64CONST(0x21dd7a89933d54d2), UINT64CONST(0x0279d346de4781f9)},
+	{UINT64CONST(0x362f2a75b8622150), UINT64CONST(0x03f61ed7ca0c0328)},
+	{UINT64CONST(0xf825bb91604e810d), UINT64CONST(0x032b4bdfd4d668ec)},
+	{UINT64CONST(0xc684960de6a5340b), UINT64CONST(0x0289097fdd7853f0)},
+	{UINT64CONST(0xd203ab3e521dc33c), UINT64CONST(0x02073accb12d0ff3)},
+	{UINT64CONST(0xe99f7863b696052c), UINT64CONST(0x033ec47ab514e652)},
+	{UINT64CONST(0x87b2c6b62bab3757), UINT64CONST(0x02989d2ef743eb75)},
+	{UINT64CONST(0xd2f56bc4efbc2c45), UINT64CONST(0x0213b0f25f69892a)},
+	{UINT64CONST(0x1e55793b192d13a2), UINT64CONST(0x0352b4b6ff0f41de)},
+	{UINT64CONST(0x4b77942f475742e8), UINT64CONST(0x02a8909265a5ce4b)},
+	{UINT64CONST(0xd5f9435905df68ba), UINT64CONST(0x022073a8515171d5)},
+	{UINT64CONST(0x565b9ef4d6324129), UINT64CONST(0x03671f73b54f1c89)},
+	{UINT64CONST(0xdeafb25d78283421), UINT64CONST(0x02b8e5f62aa5b06d)},
+	{UINT64CONST(0x188c8eb12cecf681), UINT64CONST(0x022d84c4eeeaf38b)},
+	{UINT64CONST(0x8dadb11b7b14bd9b), UINT64CONST(0x037c07a17e44b8de)},
+	{UINT64CONST(0x7157c0e2c8dd647c), UINT64CONST(0x02c99fb46503c718)},
+	{UINT64CONST(0x8ddfcd823a4ab6ca), UINT64CONST(0x023ae629ea696c13)},
+	{UINT64CONST(0x1632e269f6ddf142), UINT64CONST(0x0391704310a8acec)},
+	{UINT64CONST(0x44f581ee5f17f435), UINT64CONST(0x02dac035a6ed5723)},
+	{UINT64CONST(0x372ace584c1329c4), UINT64CONST(0x024899c4858aac1c)},
+	{UINT64CONST(0xbeaae3c079b842d3), UINT64CONST(0x03a75c6da27779c6)},
+	{UINT64CONST(0x6555830061603576), UINT64CONST(0x02ec49f14ec5fb05)},
+	{UINT64CONST(0xb7779c004de6912b), UINT64CONST(0x0256a18dd89e626a)},
+	{UINT64CONST(0xf258f99a163db512), UINT64CONST(0x03bdcf495a9703dd)},
+	{UINT64CONST(0x5b7a614811caf741), UINT64CONST(0x02fe3f6de212697e)},
+	{UINT64CONST(0xaf951aa00e3bf901), UINT64CONST(0x0264ff8b1b41edfe)},
+	{UINT64CONST(0x7f54f7667d2cc19b), UINT64CONST(0x03d4cc11c5364997)},
+	{UINT64CONST(0x32aa5f8530f09ae3), UINT64CONST(0x0310a3416a91d479)},
+	{UINT64CONST(0xf55519375a5a1582), UINT64CONST(0x0273b5cdeedb1060)},
+	{UINT64CONST(0xbbbb5b8bc3c3559d), UINT64CONST(0x03ec56164af81a34)},
+	{UINT64CONST(0x2fc916096969114a), UINT64CONST(0x03237811d593482a)},
+	{UINT64CONST(0x596dab3ababa743c), UINT64CONST(0x0282c674aadc39bb)},
+	{UINT64CONST(0x478aef622efb9030), UINT64CONST(0x0202385d557cfafc)},
+	{UINT64CONST(0xd8de4bd04b2c19e6), UINT64CONST(0x0336c0955594c4c6)},
+	{UINT64CONST(0xad7ea30d08f014b8), UINT64CONST(0x029233aaaadd6a38)},
+	{UINT64CONST(0x24654f3da0c01093), UINT64CONST(0x020e8fbbbbe454fa)},
+	{UINT64CONST(0x3a3bb1fc346680eb), UINT64CONST(0x034a7f92c63a2190)},
+	{UINT64CONST(0x94fc8e635d1ecd89), UINT64CONST(0x02a1ffa89e94e7a6)},
+	{UINT64CONST(0xaa63a51c4a7f0ad4), UINT64CONST(0x021b32ed4baa52eb)},
+	{UINT64CONST(0xdd6c3b607731aaed), UINT64CONST(0x035eb7e212aa1e45)},
+	{UINT64CONST(0x1789c919f8f488bd), UINT64CONST(0x02b22cb4dbbb4b6b)},
+	{UINT64CONST(0xac6e3a7b2d906d64), UINT64CONST(0x022823c3e2fc3c55)},
+	{UINT64CONST(0x13e390c515b3e23a), UINT64CONST(0x03736c6c9e606089)},
+	{UINT64CONST(0xdcb60d6a77c31b62), UINT64CONST(0x02c2bd23b1e6b3a0)},
+	{UINT64CONST(0x7d5e7121f968e2b5), UINT64CONST(0x0235641c8e52294d)},
+	{UINT64CONST(0xc8971b698f0e3787), UINT64CONST(0x0388a02db0837548)},
+	{UINT64CONST(0xa078e2bad8d82c6c), UINT64CONST(0x02d3b357c0692aa0)},
+	{UINT64CONST(0xe6c71bc8ad79bd24), UINT64CONST(0x0242f5dfcd20eee6)},
+	{UINT64CONST(0x0ad82c7448c2c839), UINT64CONST(0x039e5632e1ce4b0b)},
+	{UINT64CONST(0x3be023903a356cfa), UINT64CONST(0x02e511c24e3ea26f)},
+	{UINT64CONST(0x2fe682d9c82abd95), UINT64CONST(0x0250db01d8321b8c)},
+	{UINT64CONST(0x4ca4048fa6aac8ee), UINT64CONST(0x03b4919c8d1cf8e0)},
+	{UINT64CONST(0x3d5003a61eef0725), UINT64CONST(0x02f6dae3a4172d80)},
+	{UINT64CONST(0x9773361e7f259f51), UINT64CONST(0x025f1582e9ac2466)},
+	{UINT64CONST(0x8beb89ca6508fee8), UINT64CONST(0x03cb559e42ad070a)},
+	{UINT64CONST(0x6fefa16eb73a6586), UINT64CONST(0x0309114b688a6c08)},
+	{UINT64CONST(0xf3261abef8fb846b), UINT64CONST(0x026da76f86d52339)},
+	{UINT64CONST(0x51d691318e5f3a45), UINT64CONST(0x03e2a57f3e21d1f6)},
+	{UINT64CONST(0x0e4540f471e5c837), UINT64CONST(0x031bb798fe8174c5)},
+	{UINT64CONST(0xd8376729f4b7d360), UINT64CONST(0x027c92e0cb9ac3d0)},
+	{UINT64CONST(0xf38bd84321261eff), UINT64CONST(0x03fa849adf5e061a)},
+	{UINT64CONST(0x293cad0280eb4bff), UINT64CONST(0x032ed07be5e4d1af)},
+	{UINT64CONST(0xedca240200bc3ccc), UINT64CONST(0x028bd9fcb7ea4158)},
+	{UINT64CONST(0xbe3b50019a3030a4), UINT64CONST(0x02097b309321cde0)},
+	{UINT64CONST(0xc9f88002904d1a9f), UINT64CONST(0x03425eb41e9c7c9a)},
+	{UINT64CONST(0x3b2d3335403daee6), UINT64CONST(0x029b7ef67ee396e2)},
+	{UINT64CONST(0x95bdc291003158b8), UINT64CONST(0x0215ff2b98b6124e)},
+	{UINT64CONST(0x892f9db4cd1bc126), UINT64CONST(0x035665128df01d4a)},
+	{UINT64CONST(0x07594af70a7c9a85), UINT64CONST(0x02ab840ed7f34aa2)},
+	{UINT64CONST(0x6c476f2c0863aed1), UINT64CONST(0x0222d00bdff5d54e)},
+	{UINT64CONST(0x13a57eacda3917b4), UINT64CONST(0x036ae67966562217)},
+	{UINT64CONST(0x0fb7988a482dac90), UINT64CONST(0x02bbeb9451de81ac)},
+	{UINT64CONST(0xd95fad3b6cf156da), UINT64CONST(0x022fefa9db1867bc)},
+	{UINT64CONST(0xf565e1f8ae4ef15c), UINT64CONST(0x037fe5dc91c0a5fa)},
+	{UINT64CONST(0x911e4e608b725ab0), UINT64CONST(0x02ccb7e3a7cd5195)},
+	{UINT64CONST(0xda7ea51a0928488d), UINT64CONST(0x023d5fe9530aa7aa)},
+	{UINT64CONST(0xf7310829a8407415), UINT64CONST(0x039566421e7772aa)},
+	{UINT64CONST(0x2c2739baed005cde), UINT64CONST(0x02ddeb68185f8eef)},
+	{UINT64CONST(0xbcec2e2f24004a4b), UINT64CONST(0x024b22b9ad193f25)},
+	{UINT64CONST(0x94ad16b1d333aa11), UINT64CONST(0x03ab6ac2ae8ecb6f)},
+	{UINT64CONST(0xaa241227dc2954db), UINT64CONST(0x02ef889bbed8a2bf)},
+	{UINT64CONST(0x54e9a81fe35443e2), UINT64CONST(0x02593a163246e899)},
+	{UINT64CONST(0x2175d9cc9eed396a), UINT64CONST(0x03c1f689ea0b0dc2)},
+	{UINT64CONST(0xe7917b0a18bdc788), UINT64CONST(0x03019207ee6f3e34)},
+	{UINT64CONST(0xb9412f3b46fe393a), UINT64CONST(0x0267a8065858fe90)},
+	{UINT64CONST(0xf535185ed7fd285c), UINT64CONST(0x03d90cd6f3c1974d)},
+	{UINT64CONST(0xc42a79e57997537d), UINT64CONST(0x03140a458fce12a4)},
+	{UINT64CONST(0x03552e512e12a931), UINT64CONST(0x02766e9e0ca4dbb7)},
+	{UINT64CONST(0x9eeeb081e3510eb4), UINT64CONST(0x03f0b0fce107c5f1)},
+	{UINT64CONST(0x4bf226ce4f740bc3), UINT64CONST(0x0326f3fd80d304c1)},
+	{UINT64CONST(0xa3281f0b72c33c9c), UINT64CONST(0x02858ffe00a8d09a)},
+	{UINT64CONST(0x1c2018d5f568fd4a), UINT64CONST(0x020473319a20a6e2)},
+	{UINT64CONST(0xf9ccf48988a7fba9), UINT64CONST(0x033a51e8f69aa49c)},
+	{UINT64CONST(0xfb0a5d3ad3b99621), UINT64CONST(0x02950e53f87bb6e3)},
+	{UINT64CONST(0x2f3b7dc8a96144e7), UINT64CONST(0x0210d8432d2fc583)},
+	{UINT64CONST(0xe52bfc7442353b0c), UINT64CONST(0x034e26d1e1e608d1)},
+	{UINT64CONST(0xb756639034f76270), UINT64CONST(0x02a4ebdb1b1e6d74)},
+	{UINT64CONST(0x2c451c735d92b526), UINT64CONST(0x021d897c15b1f12a)},
+	{UINT64CONST(0x13a1c71efc1deea3), UINT64CONST(0x0362759355e981dd)},
+	{UINT64CONST(0x761b05b2634b2550), UINT64CONST(0x02b52adc44bace4a)},
+	{UINT64CONST(0x91af37c1e908eaa6), UINT64CONST(0x022a88b036fbd83b)},
+	{UINT64CONST(0x82b1f2cfdb417770), UINT64CONST(0x03774119f192f392)},
+	{UINT64CONST(0xcef4c23fe29ac5f3), UINT64CONST(0x02c5cdae5adbf60e)},
+	{UINT64CONST(0x3f2a34ffe87bd190), UINT64CONST(0x0237d7beaf165e72)},
+	{UINT64CONST(0x984387ffda5fb5b2), UINT64CONST(0x038c8c644b56fd83)},
+	{UINT64CONST(0xe0360666484c915b), UINT64CONST(0x02d6d6b6a2abfe02)},
+	{UINT64CONST(0x802b3851d3707449), UINT64CONST(0x024578921bbccb35)},
+	{UINT64CONST(0x99dec082ebe72075), UINT64CONST(0x03a25a835f947855)},
+	{UINT64CONST(0xae4bcd358985b391), UINT64CONST(0x02e8486919439377)},
+	{UINT64CONST(0xbea30a913ad15c74), UINT64CONST(0x02536d20e102dc5f)},
+	{UINT64CONST(0xfdd1aa81f7b560b9), UINT64CONST(0x03b8ae9b019e2d65)},
+	{UINT64CONST(0x97daeece5fc44d61), UINT64CONST(0x02fa2548ce182451)},
+	{UINT64CONST(0xdfe258a51969d781), UINT64CONST(0x0261b76d71ace9da)},
+	{UINT64CONST(0x996a276e8f0fbf34), UINT64CONST(0x03cf8be24f7b0fc4)},
+	{UINT64CONST(0xe121b9253f3fcc2a), UINT64CONST(0x030c6fe83f95a636)},
+	{UINT64CONST(0xb41afa8432997022), UINT64CONST(0x02705986994484f8)},
+	{UINT64CONST(0xecf7f739ea8f19cf), UINT64CONST(0x03e6f5a4286da18d)},
+	{UINT64CONST(0x23f99294bba5ae40), UINT64CONST(0x031f2ae9b9f14e0b)},
+	{UINT64CONST(0x4ffadbaa2fb7be99), UINT64CONST(0x027f5587c7f43e6f)},
+	{UINT64CONST(0x7ff7c5dd1925fdc2), UINT64CONST(0x03feef3fa6539718)},
+	{UINT64CONST(0xccc637e4141e649b), UINT64CONST(0x033258ffb842df46)},
+	{UINT64CONST(0xd704f983434b83af), UINT64CONST(0x028ead9960357f6b)},
+	{UINT64CONST(0x126a6135cf6f9c8c), UINT64CONST(0x020bbe144cf79923)},
+	{UINT64CONST(0x83dd685618b29414), UINT64CONST(0x0345fced47f28e9e)},
+	{UINT64CONST(0x9cb12044e08edcdd), UINT64CONST(0x029e63f1065ba54b)},
+	{UINT64CONST(0x16f419d0b3a57d7d), UINT64CONST(0x02184ff405161dd6)},
+	{UINT64CONST(0x8b20294dec3bfbfb), UINT64CONST(0x035a19866e89c956)},
+	{UINT64CONST(0x3c19baa4bcfcc996), UINT64CONST(0x02ae7ad1f207d445)},
+	{UINT64CONST(0xc9ae2eea30ca3adf), UINT64CONST(0x02252f0e5b39769d)},
+	{UINT64CONST(0x0f7d17dd1add2afd), UINT64CONST(0x036eb1b091f58a96)},
+	{UINT64CONST(0x3f97464a7be42264), UINT64CONST(0x02bef48d41913bab)},
+	{UINT64CONST(0xcc790508631ce850), UINT64CONST(0x02325d3dce0dc955)},
+	{UINT64CONST(0xe0c1a1a704fb0d4d), UINT64CONST(0x0383c862e3494222)},
+	{UINT64CONST(0x4d67b4859d95a43e), UINT64CONST(0x02cfd3824f6dce82)},
+	{UINT64CONST(0x711fc39e17aae9cb), UINT64CONST(0x023fdc683f8b0b9b)},
+	{UINT64CONST(0xe832d2968c44a945), UINT64CONST(0x039960a6cc11ac2b)},
+	{UINT64CONST(0xecf575453d03ba9e), UINT64CONST(0x02e11a1f09a7bcef)},
+	{UINT64CONST(0x572ac4376402fbb1), UINT64CONST(0x024dae7f3aec9726)},
+	{UINT64CONST(0x58446d256cd192b5), UINT64CONST(0x03af7d985e47583d)},
+	{UINT64CONST(0x79d0575123dadbc4), UINT64CONST(0x02f2cae04b6c4697)},
+	{UINT64CONST(0x94a6ac40e97be303), UINT64CONST(0x025bd5803c569edf)},
+	{UINT64CONST(0x8771139b0f2c9e6c), UINT64CONST(0x03c62266c6f0fe32)},
+	{UINT64CONST(0x9f8da948d8f07ebd), UINT64CONST(0x0304e85238c0cb5b)},
+	{UINT64CONST(0xe60aedd3e0c06564), UINT64CONST(0x026a5374fa33d5e2)},
+	{UINT64CONST(0xa344afb9679a3bd2), UINT64CONST(0x03dd5254c3862304)},
+	{UINT64CONST(0xe903bfc78614fca8), UINT64CONST(0x031775109c6b4f36)},
+	{UINT64CONST(0xba6966393810ca20), UINT64CONST(0x02792a73b055d8f8)},
+	{UINT64CONST(0x2a423d2859b4769a), UINT64CONST(0x03f510b91a22f4c1)},
+	{UINT64CONST(0xee9b642047c39215), UINT64CONST(0x032a73c7481bf700)},
+	{UINT64CONST(0xbee2b680396941aa), UINT64CONST(0x02885c9f6ce32c00)},
+	{UINT64CONST(0xff1bc53361210155), UINT64CONST(0x0206b07f8a4f5666)},
+	{UINT64CONST(0x31c6085235019bbb), UINT64CONST(0x033de73276e5570b)},
+	{UINT64CONST(0x27d1a041c4014963), UINT64CONST(0x0297ec285f1ddf3c)},
+	{UINT64CONST(0xeca7b367d0010782), UINT64CONST(0x021323537f4b18fc)},
+	{UINT64CONST(0xadd91f0c8001a59d), UINT64CONST(0x0351d21f3211c194)},
+	{UINT64CONST(0xf17a7f3d3334847e), UINT64CONST(0x02a7db4c280e3476)},
+	{UINT64CONST(0x279532975c2a0398), UINT64CONST(0x021fe2a3533e905f)},
+	{UINT64CONST(0xd8eeb75893766c26), UINT64CONST(0x0366376bb8641a31)},
+	{UINT64CONST(0x7a5892ad42c52352), UINT64CONST(0x02b82c562d1ce1c1)},
+	{UINT64CONST(0xfb7a0ef102374f75), UINT64CONST(0x022cf044f0e3e7cd)},
+	{UINT64CONST(0xc59017e8038bb254), UINT64CONST(0x037b1a07e7d30c7c)},
+	{UINT64CONST(0x37a67986693c8eaa), UINT64CONST(0x02c8e19feca8d6ca)},
+	{UINT64CONST(0xf951fad1edca0bbb), UINT64CONST(0x023a4e198a20abd4)},
+	{UINT64CONST(0x28832ae97c76792b), UINT64CONST(0x03907cf5a9cddfbb)},
+	{UINT64CONST(0x2068ef21305ec756), UINT64CONST(0x02d9fd9154a4b2fc)},
+	{UINT64CONST(0x19ed8c1a8d189f78), UINT64CONST(0x0247fe0ddd508f30)},
+	{UINT64CONST(0x5caf4690e1c0ff26), UINT64CONST(0x03a66349621a7eb3)},
+	{UINT64CONST(0x4a25d20d81673285), UINT64CONST(0x02eb82a11b48655c)},
+	{UINT64CONST(0x3b5174d79ab8f537), UINT64CONST(0x0256021a7c39eab0)},
+	{UINT64CONST(0x921bee25c45b21f1), UINT64CONST(0x03bcd02a605caab3)},
+	{UINT64CONST(0xdb498b5169e2818e), UINT64CONST(0x02fd735519e3bbc2)},
+	{UINT64CONST(0x15d46f7454b53472), UINT64CONST(0x02645c4414b62fcf)},
+	{UINT64CONST(0xefba4bed545520b6), UINT64CONST(0x03d3c6d35456b2e4)},
+	{UINT64CONST(0xf2fb6ff110441a2b), UINT64CONST(0x030fd242a9def583)},
+	{UINT64CONST(0x8f2f8cc0d9d014ef), UINT64CONST(0x02730e9bbb18c469)},
+	{UINT64CONST(0xb1e5ae015c80217f), UINT64CONST(0x03eb4a92c4f46d75)},
+	{UINT64CONST(0xc1848b344a001acc), UINT64CONST(0x0322a20f03f6bdf7)},
+	{UINT64CONST(0xce03a2903b3348a3), UINT64CONST(0x02821b3f365efe5f)},
+	{UINT64CONST(0xd802e873628f6d4f), UINT64CONST(0x0201af65c518cb7f)},
+	{UINT64CONST(0x599e40b89db2487f), UINT64CONST(0x0335e56fa1c14599)},
+	{UINT64CONST(0xe14b66fa17c1d399), UINT64CONST(0x029184594e3437ad)},
+	{UINT64CONST(0x81091f2e7967dc7a), UINT64CONST(0x020e037aa4f692f1)},
+	{UINT64CONST(0x9b41cb7d8f0c93f6), UINT64CONST(0x03499f2aa18a84b5)},
+	{UINT64CONST(0xaf67d5fe0c0a0ff8), UINT64CONST(0x02a14c221ad536f7)},
+	{UINT64CONST(0xf2b977fe70080cc7), UINT64CONST(0x021aa34e7bddc592)},
+	{UINT64CONST(0x1df58cca4cd9ae0b), UINT64CONST(0x035dd2172c9608eb)},
+	{UINT64CONST(0xe4c470a1d7148b3c), UINT64CONST(0x02b174df56de6d88)},
+	{UINT64CONST(0x83d05a1b1276d5ca), UINT64CONST(0x022790b2abe5246d)},
+	{UINT64CONST(0x9fb3c35e83f1560f), UINT64CONST(0x0372811ddfd50715)},
+	{UINT64CONST(0xb2f635e5365aab3f), UINT64CONST(0x02c200e4b310d277)},
+	{UINT64CONST(0xf591c4b75eaeef66), UINT64CONST(0x0234cd83c273db92)},
+	{UINT64CONST(0xef4fa125644b18a3), UINT64CONST(0x0387af39371fc5b7)},
+	{UINT64CONST(0x8c3fb41de9d5ad4f), UINT64CONST(0x02d2f2942c196af9)},
+	{UINT64CONST(0x3cffc34b2177bdd9), UINT64CONST(0x02425ba9bce12261)},
+	{UINT64CONST(0x94cc6bab68bf9628), UINT64CONST(0x039d5f75fb01d09b)},
+	{UINT64CONST(0x10a38955ed6611b9), UINT64CONST(0x02e44c5e6267da16)},
+	{UINT64CONST(0xda1c6dde5784dafb), UINT64CONST(0x02503d184eb97b44)},
+	{UINT64CONST(0xf693e2fd58d49191), UINT64CONST(0x03b394f3b128c53a)},
+	{UINT64CONST(0xc5431bfde0aa0e0e), UINT64CONST(0x02f610c2f4209dc8)},
+	{UINT64CONST(0x6a9c1664b3bb3e72), UINT64CONST(0x025e73cf29b3b16d)},
+	{UINT64CONST(0x10f9bd6dec5eca4f), UINT64CONST(0x03ca52e50f85e8af)},
+	{UINT64CONST(0xda616457f04bd50c), UINT64CONST(0x03084250d937ed58)},
+	{UINT64CONST(0xe1e783798d09773d), UINT64CONST(0x026d01da475ff113)},
+	{UINT64CONST(0x030c058f480f252e), UINT64CONST(0x03e19c9072331b53)},
+	{UINT64CONST(0x68d66ad906728425), UINT64CONST(0x031ae3a6c1c27c42)},
+	{UINT64CONST(0x8711ef14052869b7), UINT64CONST(0x027be952349b969b)},
+	{UINT64CONST(0x0b4fe4ecd50d75f2), UINT64CONST(0x03f97550542c242c)},
+	{UINT64CONST(0xa2a650bd773df7f5), UINT64CONST(0x032df7737689b689)},
+	{UINT64CONST(0xb551da312c31932a), UINT64CONST(0x028b2c5c5ed49207)},
+	{UINT64CONST(0x5ddb14f4235adc22), UINT64CONST(0x0208f049e576db39)},
+	{UINT64CONST(0x2fc4ee536bc49369), UINT64CONST(0x034180763bf15ec2)},
+	{UINT64CONST(0xbfd0bea92303a921), UINT64CONST(0x029acd2b63277f01)},
+	{UINT64CONST(0x9973cbba8269541a), UINT64CONST(0x021570ef8285ff34)},
+	{UINT64CONST(0x5bec792a6a42202a), UINT64CONST(0x0355817f373ccb87)},
+	{UINT64CONST(0xe3239421ee9b4cef), UINT64CONST(0x02aacdff5f63d605)},
+	{UINT64CONST(0xb5b6101b25490a59), UINT64CONST(0x02223e65e5e97804)},
+	{UINT64CONST(0x22bce691d541aa27), UINT64CONST(0x0369fd6fd64259a1)},
+	{UINT64CONST(0xb563eba7ddce21b9), UINT64CONST(0x02bb31264501e14d)},
+	{UINT64CONST(0xf78322ecb171b494), UINT64CONST(0x022f5a850401810a)},
+	{UINT64CONST(0x259e9e47824f8753), UINT64CONST(0x037ef73b399c01ab)},
+	{UINT64CONST(0x1e187e9f9b72d2a9), UINT64CONST(0x02cbf8fc2e1667bc)},
+	{UINT64CONST(0x4b46cbb2e2c24221), UINT64CONST(0x023cc73024deb963)},
+	{UINT64CONST(0x120adf849e039d01), UINT64CONST(0x039471e6a1645bd2)},
+	{UINT64CONST(0xdb3be603b19c7d9a), UINT64CONST(0x02dd27ebb4504974)},
+	{UINT64CONST(0x7c2feb3627b0647c), UINT64CONST(0x024a865629d9d45d)},
+	{UINT64CONST(0x2d197856a5e7072c), UINT64CONST(0x03aa7089dc8fba2f)},
+	{UINT64CONST(0x8a7ac6abb7ec05bd), UINT64CONST(0x02eec06e4a0c94f2)},
+	{UINT64CONST(0xd52f05562cbcd164), UINT64CONST(0x025899f1d4d6dd8e)},
+	{UINT64CONST(0x21e4d556adfae8a0), UINT64CONST(0x03c0f64fbaf1627e)},
+	{UINT64CONST(0xe7ea444557fbed4d), UINT64CONST(0x0300c50c958de864)},
+	{UINT64CONST(0xecbb69d1132ff10a), UINT64CONST(0x0267040a113e5383)},
+	{UINT64CONST(0xadf8a94e851981aa), UINT64CONST(0x03d8067681fd526c)},
+	{UINT64CONST(0x8b2d543ed0e13488), UINT64CONST(0x0313385ece6441f0)},
+	{UINT64CONST(0xd5bddcff0d80f6d3), UINT64CONST(0x0275c6b23eb69b26)},
+	{UINT64CONST(0x892fc7fe7c018aeb), UINT64CONST(0x03efa45064575ea4)},
+	{UINT64CONST(0x3a8c9ffec99ad589), UINT64CONST(0x03261d0d1d12b21d)},
+	{UINT64CONST(0xc8707fff07af113b), UINT64CONST(0x0284e40a7da88e7d)},
+	{UINT64CONST(0x39f39998d2f2742f), UINT64CONST(0x0203e9a1fe2071fe)},
+	{UINT64CONST(0x8fec28f484b7204b), UINT64CONST(0x033975cffd00b663)},
+	{UINT64CONST(0xd989ba5d36f8e6a2), UINT64CONST(0x02945e3ffd9a2b82)},
+	{UINT64CONST(0x47a161e42bfa521c), UINT64CONST(0x02104b66647b5602)},
+	{UINT64CONST(0x0c35696d132a1cf9), UINT64CONST(0x034d4570a0c5566a)},
+	{UINT64CONST(0x09c454574288172d), UINT64CONST(0x02a4378d4d6aab88)},
+	{UINT64CONST(0xa169dd129ba0128b), UINT64CONST(0x021cf93dd7888939)},
+	{UINT64CONST(0x0242fb50f9001dab), UINT64CONST(0x03618ec958da7529)},
+	{UINT64CONST(0x9b68c90d940017bc), UINT64CONST(0x02b4723aad7b90ed)},
+	{UINT64CONST(0x4920a0d7a999ac96), UINT64CONST(0x0229f4fbbdfc73f1)},
+	{UINT64CONST(0x750101590f5c4757), UINT64CONST(0x037654c5fcc71fe8)},
+	{UINT64CONST(0x2a6734473f7d05df), UINT64CONST(0x02c5109e63d27fed)},
+	{UINT64CONST(0xeeb8f69f65fd9e4c), UINT64CONST(0x0237407eb641fff0)},
+	{UINT64CONST(0xe45b24323cc8fd46), UINT64CONST(0x038b9a6456cfffe7)},
+	{UINT64CONST(0xb6af502830a0ca9f), UINT64CONST(0x02d6151d123fffec)},
+	{UINT64CONST(0xf88c402026e7087f), UINT64CONST(0x0244ddb0db666656)},
+	{UINT64CONST(0x2746cd003e3e73fe), UINT64CONST(0x03a162b4923d708b)},
+	{UINT64CONST(0x1f6bd73364fec332), UINT64CONST(0x02e7822a0e978d3c)},
+	{UINT64CONST(0xe5efdf5c50cbcf5b), UINT64CONST(0x0252ce880bac70fc)},
+	{UINT64CONST(0x3cb2fefa1adfb22b), UINT64CONST(0x03b7b0d9ac471b2e)},
+	{UINT64CONST(0x308f3261af195b56), UINT64CONST(0x02f95a47bd05af58)},
+	{UINT64CONST(0x5a0c284e25ade2ab), UINT64CONST(0x0261150630d15913)},
+	{UINT64CONST(0x29ad0d49d5e30445), UINT64CONST(0x03ce8809e7b55b52)},
+	{UINT64CONST(0x548a7107de4f369d), UINT64CONST(0x030ba007ec9115db)},
+	{UINT64CONST(0xdd3b8d9fe50c2bb1), UINT64CONST(0x026fb3398a0dab15)},
+	{UINT64CONST(0x952c15cca1ad12b5), UINT64CONST(0x03e5eb8f434911bc)},
+	{UINT64CONST(0x775677d6e7bda891), UINT64CONST(0x031e560c35d40e30)},
+	{UINT64CONST(0xc5dec645863153a7), UINT64CONST(0x027eab3cf7dcd826)}
+};
+
+static const uint64 DOUBLE_POW5_SPLIT[326][2] = {
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x0100000000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x0140000000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x0190000000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01f4000000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x0138800000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x0186a00000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01e8480000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01312d0000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x017d784000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01dcd65000000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x012a05f200000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x0174876e80000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01d1a94a20000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x012309ce54000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x016bcc41e9000000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01c6bf5263400000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x011c37937e080000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x016345785d8a0000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01bc16d674ec8000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01158e460913d000)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x015af1d78b58c400)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01b1ae4d6e2ef500)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x010f0cf064dd5920)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x0152d02c7e14af68)},
+	{UINT64CONST(0x0000000000000000), UINT64CONST(0x01a784379d99db42)},
+	{UINT64CONST(0x4000000000000000), UINT64CONST(0x0108b2a2c2802909)},
+	{UINT64CONST(0x9000000000000000), UINT64CONST(0x014adf4b7320334b)},
+	{UINT64CONST(0x7400000000000000), UINT64CONST(0x019d971e4fe8401e)},
+	{UINT64CONST(0x0880000000000000), UINT64CONST(0x01027e72f1f12813)},
+	{UINT64CONST(0xcaa0000000000000), UINT64CONST(0x01431e0fae6d7217)},
+	{UINT64CONST(0xbd48000000000000), UINT64CONST(0x0193e5939a08ce9d)},
+	{UINT64CONST(0x2c9a000000000000), UINT64CONST(0x01f8def8808b0245)},
+	{UINT64CONST(0x3be0400000000000), UINT64CONST(0x013b8b5b5056e16b)},
+	{UINT64CONST(0x0ad8500000000000), UINT64CONST(0x018a6e32246c99c6)},
+	{UINT64CONST(0x8d8e640000000000), UINT64CONST(0x01ed09bead87c037)},
+	{UINT64CONST(0xb878fe8000000000), UINT64CONST(0x013426172c74d822)},
+	{UINT64CONST(0x66973e2000000000), UINT64CONST(0x01812f9cf7920e2b)},
+	{UINT64CONST(0x403d0da800000000), UINT64CONST(0x01e17b84357691b6)},
+	{UINT64CONST(0xe826288900000000), UINT64CONST(0x012ced32a16a1b11)},
+	{UINT64CONST(0x622fb2ab40000000), UINT64CONST(0x0178287f49c4a1d6)},
+	{UINT64CONST(0xfabb9f5610000000), UINT64CONST(0x01d6329f1c35ca4b)},
+	{UINT64CONST(0x7cb54395ca000000), UINT64CONST(0x0125dfa371a19e6f)},
+	{UINT64CONST(0x5be2947b3c800000), UINT64CONST(0x016f578c4e0a060b)},
+	{UINT64CONST(0x32db399a0ba00000), UINT64CONST(0x01cb2d6f618c878e)},
+	{UINT64CONST(0xdfc9040047440000), UINT64CONST(0x011efc659cf7d4b8)},
+	{UINT64CONST(0x17bb450059150000), UINT64CONST(0x0166bb7f0435c9e7)},
+	{UINT64CONST(0xddaa16406f5a4000), UINT64CONST(0x01c06a5ec5433c60)},
+	{UINT64CONST(0x8a8a4de845986800), UINT64CONST(0x0118427b3b4a05bc)},
+	{UINT64CONST(0xad2ce16256fe8200), UINT64CONST(0x015e531a0a1c872b)},
+	{UINT64CONST(0x987819baecbe2280), UINT64CONST(0x01b5e7e08ca3a8f6)},
+	{UINT64CONST(0x1f4b1014d3f6d590), UINT64CONST(0x0111b0ec57e6499a)},
+	{UINT64CONST(0xa71dd41a08f48af4), UINT64CONST(0x01561d276ddfdc00)},
+	{UINT64CONST(0xd0e549208b31adb1), UINT64CONST(0x01aba4714957d300)},
+	{UINT64CONST(0x828f4db456ff0c8e), UINT64CONST(0x010b46c6cdd6e3e0)},
+	{UINT64CONST(0xa33321216cbecfb2), UINT64CONST(0x014e1878814c9cd8)},
+	{UINT64CONST(0xcbffe969c7ee839e), UINT64CONST(0x01a19e96a19fc40e)},
+	{UINT64CONST(0x3f7ff1e21cf51243), UINT64CONST(0x0105031e2503da89)},
+	{UINT64CONST(0x8f5fee5aa43256d4), UINT64CONST(0x014643e5ae44d12b)},
+	{UINT64CONST(0x7337e9f14d3eec89), UINT64CONST(0x0197d4df19d60576)},
+	{UINT64CONST(0x1005e46da08ea7ab), UINT64CONST(0x01fdca16e04b86d4)},
+	{UINT64CONST(0x8a03aec4845928cb), UINT64CONST(0x013e9e4e4c2f3444)},
+	{UINT64CONST(0xac849a75a56f72fd), UINT64CONST(0x018e45e1df3b0155)},
+	{UINT64CONST(0x17a5c1130ecb4fbd), UINT64CONST(0x01f1d75a5709c1ab)},
+	{UINT64CONST(0xeec798abe93f11d6), UINT64CONST(0x013726987666190a)},
+	{UINT64CONST(0xaa797ed6e38ed64b), UINT64CONST(0x0184f03e93ff9f4d)},
+	{UINT64CONST(0x1517de8c9c728bde), UINT64CONST(0x01e62c4e38ff8721)},
+	{UINT64CONST(0xad2eeb17e1c7976b), UINT64CONST(0x012fdbb0e39fb474)},
+	{UINT64CONST(0xd87aa5ddda397d46), UINT64CONST(0x017bd29d1c87a191)},
+	{UINT64CONST(0x4e994f5550c7dc97), UINT64CONST(0x01dac74463a989f6)},
+	{UINT64CONST(0xf11fd195527ce9de), UINT64CONST(0x0128bc8abe49f639)},
+	{UINT64CONST(0x6d67c5faa71c2456), UINT64CONST(0x0172ebad6ddc73c8)},
+	{UINT64CONST(0x88c1b77950e32d6c), UINT64CONST(0x01cfa698c95390ba)},
+	{UINT64CONST(0x957912abd28dfc63), UINT64CONST(0x0121c81f7dd43a74)},
+	{UINT64CONST(0xbad75756c7317b7c), UINT64CONST(0x016a3a275d494911)},
+	{UINT64CONST(0x298d2d2c78fdda5b), UINT64CONST(0x01c4c8b1349b9b56)},
+	{UINT64CONST(0xd9f83c3bcb9ea879), UINT64CONST(0x011afd6ec0e14115)},
+	{UINT64CONST(0x50764b4abe865297), UINT64CONST(0x0161bcca7119915b)},
+	{UINT64CONST(0x2493de1d6e27e73d), UINT64CONST(0x01ba2bfd0d5ff5b2)},
+	{UINT64CONST(0x56dc6ad264d8f086), UINT64CONST(0x01145b7e285bf98f)},
+	{UINT64CONST(0x2c938586fe0f2ca8), UINT64CONST(0x0159725db272f7f3)},
+	{UINT64CONST(0xf7b866e8bd92f7d2), UINT64CONST(0x01afcef51f0fb5ef)},
+	{UINT64CONST(0xfad34051767bdae3), UINT64CONST(0x010de1593369d1b5)},
+	{UINT64CONST(0x79881065d41ad19c), UINT64CONST(0x015159af80444623)},
+	{UINT64CONST(0x57ea147f49218603), UINT64CONST(0x01a5b01b605557ac)},
+	{UINT64CONST(0xb6f24ccf8db4f3c1), UINT64CONST(0x01078e111c3556cb)},
+	{UINT64CONST(0xa4aee003712230b2), UINT64CONST(0x014971956342ac7e)},
+	{UINT64CONST(0x4dda98044d6abcdf), UINT64CONST(0x019bcdfabc13579e)},
+	{UINT64CONST(0xf0a89f02b062b60b), UINT64CONST(0x010160bcb58c16c2)},
+	{UINT64CONST(0xacd2c6c35c7b638e), UINT64CONST(0x0141b8ebe2ef1c73)},
+	{UINT64CONST(0x98077874339a3c71), UINT64CONST(0x01922726dbaae390)},
+	{UINT64CONST(0xbe0956914080cb8e), UINT64CONST(0x01f6b0f092959c74)},
+	{UINT64CONST(0xf6c5d61ac8507f38), UINT64CONST(0x013a2e965b9d81c8)},
+	{UINT64CONST(0x34774ba17a649f07), UINT64CONST(0x0188ba3bf284e23b)},
+	{UINT64CONST(0x01951e89d8fdc6c8), UINT64CONST(0x01eae8caef261aca)},
+	{UINT64CONST(0x40fd3316279e9c3d), UINT64CONST(0x0132d17ed577d0be)},
+	{UINT64CONST(0xd13c7fdbb186434c), UINT64CONST(0x017f85de8ad5c4ed)},
+	{UINT64CONST(0x458b9fd29de7d420), UINT64CONST(0x01df67562d8b3629)},
+	{UINT64CONST(0xcb7743e3a2b0e494), UINT64CONST(0x012ba095dc7701d9)},
+	{UINT64CONST(0x3e5514dc8b5d1db9), UINT64CONST(0x017688bb5394c250)},
+	{UINT64CONST(0x4dea5a13ae346527), UINT64CONST(0x01d42aea2879f2e4)},
+	{UINT64CONST(0xb0b2784c4ce0bf38), UINT64CONST(0x01249ad2594c37ce)},
+	{UINT64CONST(0x5cdf165f6018ef06), UINT64CONST(0x016dc186ef9f45c2)},
+	{UINT64CONST(0xf416dbf7381f2ac8), UINT64CONST(0x01c931e8ab871732)},
+	{UINT64CONST(0xd88e497a83137abd), UINT64CONST(0x011dbf316b346e7f)},
+	{UINT64CONST(0xceb1dbd923d8596c), UINT64CONST(0x01652efdc6018a1f)},
+	{UINT64CONST(0xc25e52cf6cce6fc7), UINT64CONST(0x01be7abd3781eca7)},
+	{UINT64CONST(0xd97af3c1a40105dc), UINT64CONST(0x01170cb642b133e8)},
+	{UINT64CONST(0x0fd9b0b20d014754), UINT64CONST(0x015ccfe3d35d80e3)},
+	{UINT64CONST(0xd3d01cde90419929), UINT64CONST(0x01b403dcc834e11b)},
+	{UINT64CONST(0x6462120b1a28ffb9), UINT64CONST(0x01108269fd210cb1)},
+	{UINT64CONST(0xbd7a968de0b33fa8), UINT64CONST(0x0154a3047c694fdd)},
+	{UINT64CONST(0x2cd93c3158e00f92), UINT64CONST(0x01a9cbc59b83a3d5)},
+	{UINT64CONST(0x3c07c59ed78c09bb), UINT64CONST(0x010a1f5b81324665)},
+	{UINT64CONST(0x8b09b7068d6f0c2a), UINT64CONST(0x014ca732617ed7fe)},
+	{UINT64CONST(0x2dcc24c830cacf34), UINT64CONST(0x019fd0fef9de8dfe)},
+	{UINT64CONST(0xdc9f96fd1e7ec180), UINT64CONST(0x0103e29f5c2b18be)},
+	{UINT64CONST(0x93c77cbc661e71e1), UINT64CONST(0x0144db473335deee)},
+	{UINT64CONST(0x38b95beb7fa60e59), UINT64CONST(0x01961219000356aa)},
+	{UINT64CONST(0xc6e7b2e65f8f91ef), UINT64CONST(0x01fb969f40042c54)},
+	{UINT64CONST(0xfc50cfcffbb9bb35), UINT64CONST(0x013d3e2388029bb4)},
+	{UINT64CONST(0x3b6503c3faa82a03), UINT64CONST(0x018c8dac6a0342a2)},
+	{UINT64CONST(0xca3e44b4f9523484), UINT64CONST(0x01efb1178484134a)},
+	{UINT64CONST(0xbe66eaf11bd360d2), UINT64CONST(0x0135ceaeb2d28c0e)},
+	{UINT64CONST(0x6e00a5ad62c83907), UINT64CONST(0x0183425a5f872f12)},
+	{UINT64CONST(0x0980cf18bb7a4749), UINT64CONST(0x01e412f0f768fad7)},
+	{UINT64CONST(0x65f0816f752c6c8d), UINT64CONST(0x012e8bd69aa19cc6)},
+	{UINT64CONST(0xff6ca1cb527787b1), UINT64CONST(0x017a2ecc414a03f7)},
+	{UINT64CONST(0xff47ca3e2715699d), UINT64CONST(0x01d8ba7f519c84f5)},
+	{UINT64CONST(0xbf8cde66d86d6202), UINT64CONST(0x0127748f9301d319)},
+	{UINT64CONST(0x2f7016008e88ba83), UINT64CONST(0x017151b377c247e0)},
+	{UINT64CONST(0x3b4c1b80b22ae923), UINT64CONST(0x01cda62055b2d9d8)},
+	{UINT64CONST(0x250f91306f5ad1b6), UINT64CONST(0x012087d4358fc827)},
+	{UINT64CONST(0xee53757c8b318623), UINT64CONST(0x0168a9c942f3ba30)},
+	{UINT64CONST(0x29e852dbadfde7ac), UINT64CONST(0x01c2d43b93b0a8bd)},
+	{UINT64CONST(0x3a3133c94cbeb0cc), UINT64CONST(0x0119c4a53c4e6976)},
+	{UINT64CONST(0xc8bd80bb9fee5cff), UINT64CONST(0x016035ce8b6203d3)},
+	{UINT64CONST(0xbaece0ea87e9f43e), UINT64CONST(0x01b843422e3a84c8)},
+	{UINT64CONST(0x74d40c9294f238a7), UINT64CONST(0x01132a095ce492fd)},
+	{UINT64CONST(0xd2090fb73a2ec6d1), UINT64CONST(0x0157f48bb41db7bc)},
+	{UINT64CONST(0x068b53a508ba7885), UINT64CONST(0x01adf1aea12525ac)},
+	{UINT64CONST(0x8417144725748b53), UINT64CONST(0x010cb70d24b7378b)},
+	{UINT64CONST(0x651cd958eed1ae28), UINT64CONST(0x014fe4d06de5056e)},
+	{UINT64CONST(0xfe640faf2a8619b2), UINT64CONST(0x01a3de04895e46c9)},
+	{UINT64CONST(0x3efe89cd7a93d00f), UINT64CONST(0x01066ac2d5daec3e)},
+	{UINT64CONST(0xcebe2c40d938c413), UINT64CONST(0x014805738b51a74d)},
+	{UINT64CONST(0x426db7510f86f518), UINT64CONST(0x019a06d06e261121)},
+	{UINT64CONST(0xc9849292a9b4592f), UINT64CONST(0x0100444244d7cab4)},
+	{UINT64CONST(0xfbe5b73754216f7a), UINT64CONST(0x01405552d60dbd61)},
+	{UINT64CONST(0x7adf25052929cb59), UINT64CONST(0x01906aa78b912cba)},
+	{UINT64CONST(0x1996ee4673743e2f), UINT64CONST(0x01f485516e7577e9)},
+	{UINT64CONST(0xaffe54ec0828a6dd), UINT64CONST(0x0138d352e5096af1)},
+	{UINT64CONST(0x1bfdea270a32d095), UINT64CONST(0x018708279e4bc5ae)},
+	{UINT64CONST(0xa2fd64b0ccbf84ba), UINT64CONST(0x01e8ca3185deb719)},
+	{UINT64CONST(0x05de5eee7ff7b2f4), UINT64CONST(0x01317e5ef3ab3270)},
+	{UINT64CONST(0x0755f6aa1ff59fb1), UINT64CONST(0x017dddf6b095ff0c)},
+	{UINT64CONST(0x092b7454a7f3079e), UINT64CONST(0x01dd55745cbb7ecf)},
+	{UINT64CONST(0x65bb28b4e8f7e4c3), UINT64CONST(0x012a5568b9f52f41)},
+	{UINT64CONST(0xbf29f2e22335ddf3), UINT64CONST(0x0174eac2e8727b11)},
+	{UINT64CONST(0x2ef46f9aac035570), UINT64CONST(0x01d22573a28f19d6)},
+	{UINT64CONST(0xdd58c5c0ab821566), UINT64CONST(0x0123576845997025)},
+	{UINT64CONST(0x54aef730d6629ac0), UINT64CONST(0x016c2d4256ffcc2f)},
+	{UINT64CONST(0x29dab4fd0bfb4170), UINT64CONST(0x01c73892ecbfbf3b)},
+	{UINT64CONST(0xfa28b11e277d08e6), UINT64CONST(0x011c835bd3f7d784)},
+	{UINT64CONST(0x38b2dd65b15c4b1f), UINT64CONST(0x0163a432c8f5cd66)},
+	{UINT64CONST(0xc6df94bf1db35de7), UINT64CONST(0x01bc8d3f7b3340bf)},
+	{UINT64CONST(0xdc4bbcf772901ab0), UINT64CONST(0x0115d847ad000877)},
+	{UINT64CONST(0xd35eac354f34215c), UINT64CONST(0x015b4e5998400a95)},
+	{UINT64CONST(0x48365742a30129b4), UINT64CONST(0x01b221effe500d3b)},
+	{UINT64CONST(0x0d21f689a5e0ba10), UINT64CONST(0x010f5535fef20845)},
+	{UINT64CONST(0x506a742c0f58e894), UINT64CONST(0x01532a837eae8a56)},
+	{UINT64CONST(0xe4851137132f22b9), UINT64CONST(0x01a7f5245e5a2ceb)},
+	{UINT64CONST(0x6ed32ac26bfd75b4), UINT64CONST(0x0108f936baf85c13)},
+	{UINT64CONST(0x4a87f57306fcd321), UINT64CONST(0x014b378469b67318)},
+	{UINT64CONST(0x5d29f2cfc8bc07e9), UINT64CONST(0x019e056584240fde)},
+	{UINT64CONST(0xfa3a37c1dd7584f1), UINT64CONST(0x0102c35f729689ea)},
+	{UINT64CONST(0xb8c8c5b254d2e62e), UINT64CONST(0x014374374f3c2c65)},
+	{UINT64CONST(0x26faf71eea079fb9), UINT64CONST(0x01945145230b377f)},
+	{UINT64CONST(0xf0b9b4e6a48987a8), UINT64CONST(0x01f965966bce055e)},
+	{UINT64CONST(0x5674111026d5f4c9), UINT64CONST(0x013bdf7e0360c35b)},
+	{UINT64CONST(0x2c111554308b71fb), UINT64CONST(0x018ad75d8438f432)},
+	{UINT64CONST(0xb7155aa93cae4e7a), UINT64CONST(0x01ed8d34e547313e)},
+	{UINT64CONST(0x326d58a9c5ecf10c), UINT64CONST(0x013478410f4c7ec7)},
+	{UINT64CONST(0xff08aed437682d4f), UINT64CONST(0x01819651531f9e78)},
+	{UINT64CONST(0x3ecada89454238a3), UINT64CONST(0x01e1fbe5a7e78617)},
+	{UINT64CONST(0x873ec895cb496366), UINT64CONST(0x012d3d6f88f0b3ce)},
+	{UINT64CONST(0x290e7abb3e1bbc3f), UINT64CONST(0x01788ccb6b2ce0c2)},
+	{UINT64CONST(0xb352196a0da2ab4f), UINT64CONST(0x01d6affe45f818f2)},
+	{UINT64CONST(0xb0134fe24885ab11), UINT64CONST(0x01262dfeebbb0f97)},
+	{UINT64CONST(0x9c1823dadaa715d6), UINT64CONST(0x016fb97ea6a9d37d)},
+	{UINT64CONST(0x031e2cd19150db4b), UINT64CONST(0x01cba7de5054485d)},
+	{UINT64CONST(0x21f2dc02fad2890f), UINT64CONST(0x011f48eaf234ad3a)},
+	{UINT64CONST(0xaa6f9303b9872b53), UINT64CONST(0x01671b25aec1d888)},
+	{UINT64CONST(0xd50b77c4a7e8f628), UINT64CONST(0x01c0e1ef1a724eaa)},
+	{UINT64CONST(0xc5272adae8f199d9), UINT64CONST(0x01188d357087712a)},
+	{UINT64CONST(0x7670f591a32e004f), UINT64CONST(0x015eb082cca94d75)},
+	{UINT64CONST(0xd40d32f60bf98063), UINT64CONST(0x01b65ca37fd3a0d2)},
+	{UINT64CONST(0xc4883fd9c77bf03e), UINT64CONST(0x0111f9e62fe44483)},
+	{UINT64CONST(0xb5aa4fd0395aec4d), UINT64CONST(0x0156785fbbdd55a4)},
+	{UINT64CONST(0xe314e3c447b1a760), UINT64CONST(0x01ac1677aad4ab0d)},
+	{UINT64CONST(0xaded0e5aaccf089c), UINT64CONST(0x010b8e0acac4eae8)},
+	{UINT64CONST(0xd96851f15802cac3), UINT64CONST(0x014e718d7d7625a2)},
+	{UINT64CONST(0x8fc2666dae037d74), UINT64CONST(0x01a20df0dcd3af0b)},
+	{UINT64CONST(0x39d980048cc22e68), UINT64CONST(0x010548b68a044d67)},
+	{UINT64CONST(0x084fe005aff2ba03), UINT64CONST(0x01469ae42c8560c1)},
+	{UINT64CONST(0x4a63d8071bef6883), UINT64CONST(0x0198419d37a6b8f1)},
+	{UINT64CONST(0x9cfcce08e2eb42a4), UINT64CONST(0x01fe52048590672d)},
+	{UINT64CONST(0x821e00c58dd309a7), UINT64CONST(0x013ef342d37a407c)},
+	{UINT64CONST(0xa2a580f6f147cc10), UINT64CONST(0x018eb0138858d09b)},
+	{UINT64CONST(0x8b4ee134ad99bf15), UINT64CONST(0x01f25c186a6f04c2)},
+	{UINT64CONST(0x97114cc0ec80176d), UINT64CONST(0x0137798f428562f9)},
+	{UINT64CONST(0xfcd59ff127a01d48), UINT64CONST(0x018557f31326bbb7)},
+	{UINT64CONST(0xfc0b07ed7188249a), UINT64CONST(0x01e6adefd7f06aa5)},
+	{UINT64CONST(0xbd86e4f466f516e0), UINT64CONST(0x01302cb5e6f642a7)},
+	{UINT64CONST(0xace89e3180b25c98), UINT64CONST(0x017c37e360b3d351)},
+	{UINT64CONST(0x1822c5bde0def3be), UINT64CONST(0x01db45dc38e0c826)},
+	{UINT64CONST(0xcf15bb96ac8b5857), UINT64CONST(0x01290ba9a38c7d17)},
+	{UINT64CONST(0xc2db2a7c57ae2e6d), UINT64CONST(0x01734e940c6f9c5d)},
+	{UINT64CONST(0x3391f51b6d99ba08), UINT64CONST(0x01d022390f8b8375)},
+	{UINT64CONST(0x403b393124801445), UINT64CONST(0x01221563a9b73229)},
+	{UINT64CONST(0x904a077d6da01956), UINT64CONST(0x016a9abc9424feb3)},
+	{UINT64CONST(0x745c895cc9081fac), UINT64CONST(0x01c5416bb92e3e60)},
+	{UINT64CONST(0x48b9d5d9fda513cb), UINT64CONST(0x011b48e353bce6fc)},
+	{UINT64CONST(0x5ae84b507d0e58be), UINT64CONST(0x01621b1c28ac20bb)},
+	{UINT64CONST(0x31a25e249c51eeee), UINT64CONST(0x01baa1e332d728ea)},
+	{UINT64CONST(0x5f057ad6e1b33554), UINT64CONST(0x0114a52dffc67992)},
+	{UINT64CONST(0xf6c6d98c9a2002aa), UINT64CONST(0x0159ce797fb817f6)},
+	{UINT64CONST(0xb4788fefc0a80354), UINT64CONST(0x01b04217dfa61df4)},
+	{UINT64CONST(0xf0cb59f5d8690214), UINT64CONST(0x010e294eebc7d2b8)},
+	{UINT64CONST(0x2cfe30734e83429a), UINT64CONST(0x0151b3a2a6b9c767)},
+	{UINT64CONST(0xf83dbc9022241340), UINT64CONST(0x01a6208b50683940)},
+	{UINT64CONST(0x9b2695da15568c08), UINT64CONST(0x0107d457124123c8)},
+	{UINT64CONST(0xc1f03b509aac2f0a), UINT64CONST(0x0149c96cd6d16cba)},
+	{UINT64CONST(0x726c4a24c1573acd), UINT64CONST(0x019c3bc80c85c7e9)},
+	{UINT64CONST(0xe783ae56f8d684c0), UINT64CONST(0x0101a55d07d39cf1)},
+	{UINT64CONST(0x616499ecb70c25f0), UINT64CONST(0x01420eb449c8842e)},
+	{UINT64CONST(0xf9bdc067e4cf2f6c), UINT64CONST(0x019292615c3aa539)},
+	{UINT64CONST(0x782d3081de02fb47), UINT64CONST(0x01f736f9b3494e88)},
+	{UINT64CONST(0x4b1c3e512ac1dd0c), UINT64CONST(0x013a825c100dd115)},
+	{UINT64CONST(0x9de34de57572544f), UINT64CONST(0x018922f31411455a)},
+	{UINT64CONST(0x455c215ed2cee963), UINT64CONST(0x01eb6bafd91596b1)},
+	{UINT64CONST(0xcb5994db43c151de), UINT64CONST(0x0133234de7ad7e2e)},
+	{UINT64CONST(0x7e2ffa1214b1a655), UINT64CONST(0x017fec216198ddba)},
+	{UINT64CONST(0x1dbbf89699de0feb), UINT64CONST(0x01dfe729b9ff1529)},
+	{UINT64CONST(0xb2957b5e202ac9f3), UINT64CONST(0x012bf07a143f6d39)},
+	{UINT64CONST(0x1f3ada35a8357c6f), UINT64CONST(0x0176ec98994f4888)},
+	{UINT64CONST(0x270990c31242db8b), UINT64CONST(0x01d4a7bebfa31aaa)},
+	{UINT64CONST(0x5865fa79eb69c937), UINT64CONST(0x0124e8d737c5f0aa)},
+	{UINT64CONST(0xee7f791866443b85), UINT64CONST(0x016e230d05b76cd4)},
+	{UINT64CONST(0x2a1f575e7fd54a66), UINT64CONST(0x01c9abd04725480a)},
+	{UINT64CONST(0x5a53969b0fe54e80), UINT64CONST(0x011e0b622c774d06)},
+	{UINT64CONST(0xf0e87c41d3dea220), UINT64CONST(0x01658e3ab7952047)},
+	{UINT64CONST(0xed229b5248d64aa8), UINT64CONST(0x01bef1c9657a6859)},
+	{UINT64CONST(0x3435a1136d85eea9), UINT64CONST(0x0117571ddf6c8138)},
+	{UINT64CONST(0x4143095848e76a53), UINT64CONST(0x015d2ce55747a186)},
+	{UINT64CONST(0xd193cbae5b2144e8), UINT64CONST(0x01b4781ead1989e7)},
+	{UINT64CONST(0xe2fc5f4cf8f4cb11), UINT64CONST(0x0110cb132c2ff630)},
+	{UINT64CONST(0x1bbb77203731fdd5), UINT64CONST(0x0154fdd7f73bf3bd)},
+	{UINT64CONST(0x62aa54e844fe7d4a), UINT64CONST(0x01aa3d4df50af0ac)},
+	{UINT64CONST(0xbdaa75112b1f0e4e), UINT64CONST(0x010a6650b926d66b)},
+	{UINT64CONST(0xad15125575e6d1e2), UINT64CONST(0x014cffe4e7708c06)},
+	{UINT64CONST(0x585a56ead360865b), UINT64CONST(0x01a03fde214caf08)},
+	{UINT64CONST(0x37387652c41c53f8), UINT64CONST(0x010427ead4cfed65)},
+	{UINT64CONST(0x850693e7752368f7), UINT64CONST(0x014531e58a03e8be)},
+	{UINT64CONST(0x264838e1526c4334), UINT64CONST(0x01967e5eec84e2ee)},
+	{UINT64CONST(0xafda4719a7075402), UINT64CONST(0x01fc1df6a7a61ba9)},
+	{UINT64CONST(0x0de86c7008649481), UINT64CONST(0x013d92ba28c7d14a)},
+	{UINT64CONST(0x9162878c0a7db9a1), UINT64CONST(0x018cf768b2f9c59c)},
+	{UINT64CONST(0xb5bb296f0d1d280a), UINT64CONST(0x01f03542dfb83703)},
+	{UINT64CONST(0x5194f9e568323906), UINT64CONST(0x01362149cbd32262)},
+	{UINT64CONST(0xe5fa385ec23ec747), UINT64CONST(0x0183a99c3ec7eafa)},
+	{UINT64CONST(0x9f78c67672ce7919), UINT64CONST(0x01e494034e79e5b9)},
+	{UINT64CONST(0x03ab7c0a07c10bb0), UINT64CONST(0x012edc82110c2f94)},
+	{UINT64CONST(0x04965b0c89b14e9c), UINT64CONST(0x017a93a2954f3b79)},
+	{UINT64CONST(0x45bbf1cfac1da243), UINT64CONST(0x01d9388b3aa30a57)},
+	{UINT64CONST(0x8b957721cb92856a), UINT64CONST(0x0127c35704a5e676)},
+	{UINT64CONST(0x2e7ad4ea3e7726c4), UINT64CONST(0x0171b42cc5cf6014)},
+	{UINT64CONST(0x3a198a24ce14f075), UINT64CONST(0x01ce2137f7433819)},
+	{UINT64CONST(0xc44ff65700cd1649), UINT64CONST(0x0120d4c2fa8a030f)},
+	{UINT64CONST(0xb563f3ecc1005bdb), UINT64CONST(0x016909f3b92c83d3)},
+	{UINT64CONST(0xa2bcf0e7f14072d2), UINT64CONST(0x01c34c70a777a4c8)},
+	{UINT64CONST(0x65b61690f6c847c3), UINT64CONST(0x011a0fc668aac6fd)},
+	{UINT64CONST(0xbf239c35347a59b4), UINT64CONST(0x016093b802d578bc)},
+	{UINT64CONST(0xeeec83428198f021), UINT64CONST(0x01b8b8a6038ad6eb)},
+	{UINT64CONST(0x7553d20990ff9615), UINT64CONST(0x01137367c236c653)},
+	{UINT64CONST(0x52a8c68bf53f7b9a), UINT64CONST(0x01585041b2c477e8)},
+	{UINT64CONST(0x6752f82ef28f5a81), UINT64CONST(0x01ae64521f7595e2)},
+	{UINT64CONST(0x8093db1d57999890), UINT64CONST(0x010cfeb353a97dad)},
+	{UINT64CONST(0xe0b8d1e4ad7ffeb4), UINT64CONST(0x01503e602893dd18)},
+	{UINT64CONST(0x18e7065dd8dffe62), UINT64CONST(0x01a44df832b8d45f)},
+	{UINT64CONST(0x6f9063faa78bfefd), UINT64CONST(0x0106b0bb1fb384bb)},
+	{UINT64CONST(0x4b747cf9516efebc), UINT64CONST(0x01485ce9e7a065ea)},
+	{UINT64CONST(0xde519c37a5cabe6b), UINT64CONST(0x019a742461887f64)},
+	{UINT64CONST(0x0af301a2c79eb703), UINT64CONST(0x01008896bcf54f9f)},
+	{UINT64CONST(0xcdafc20b798664c4), UINT64CONST(0x0140aabc6c32a386)},
+	{UINT64CONST(0x811bb28e57e7fdf5), UINT64CONST(0x0190d56b873f4c68)},
+	{UINT64CONST(0xa1629f31ede1fd72), UINT64CONST(0x01f50ac6690f1f82)},
+	{UINT64CONST(0xa4dda37f34ad3e67), UINT64CONST(0x013926bc01a973b1)},
+	{UINT64CONST(0x0e150c5f01d88e01), UINT64CONST(0x0187706b0213d09e)},
+	{UINT64CONST(0x919a4f76c24eb181), UINT64CONST(0x01e94c85c298c4c5)},
+	{UINT64CONST(0x7b0071aa39712ef1), UINT64CONST(0x0131cfd3999f7afb)},
+	{UINT64CONST(0x59c08e14c7cd7aad), UINT64CONST(0x017e43c8800759ba)},
+	{UINT64CONST(0xf030b199f9c0d958), UINT64CONST(0x01ddd4baa0093028)},
+	{UINT64CONST(0x961e6f003c1887d7), UINT64CONST(0x012aa4f4a405be19)},
+	{UINT64CONST(0xfba60ac04b1ea9cd), UINT64CONST(0x01754e31cd072d9f)},
+	{UINT64CONST(0xfa8f8d705de65440), UINT64CONST(0x01d2a1be4048f907)},
+	{UINT64CONST(0xfc99b8663aaff4a8), UINT64CONST(0x0123a516e82d9ba4)},
+	{UINT64CONST(0x3bc0267fc95bf1d2), UINT64CONST(0x016c8e5ca239028e)},
+	{UINT64CONST(0xcab0301fbbb2ee47), UINT64CONST(0x01c7b1f3cac74331)},
+	{UINT64CONST(0x1eae1e13d54fd4ec), UINT64CONST(0x011ccf385ebc89ff)},
+	{UINT64CONST(0xe659a598caa3ca27), UINT64CONST(0x01640306766bac7e)},
+	{UINT64CONST(0x9ff00efefd4cbcb1), UINT64CONST(0x01bd03c81406979e)},
+	{UINT64CONST(0x23f6095f5e4ff5ef), UINT64CONST(0x0116225d0c841ec3)},
+	{UINT64CONST(0xecf38bb735e3f36a), UINT64CONST(0x015baaf44fa52673)},
+	{UINT64CONST(0xe8306ea5035cf045), UINT64CONST(0x01b295b1638e7010)},
+	{UINT64CONST(0x911e4527221a162b), UINT64CONST(0x010f9d8ede39060a)},
+	{UINT64CONST(0x3565d670eaa09bb6), UINT64CONST(0x015384f295c7478d)},
+	{UINT64CONST(0x82bf4c0d2548c2a3), UINT64CONST(0x01a8662f3b391970)},
+	{UINT64CONST(0x51b78f88374d79a6), UINT64CONST(0x01093fdd8503afe6)},
+	{UINT64CONST(0xe625736a4520d810), UINT64CONST(0x014b8fd4e6449bdf)},
+	{UINT64CONST(0xdfaed044d6690e14), UINT64CONST(0x019e73ca1fd5c2d7)},
+	{UINT64CONST(0xebcd422b0601a8cc), UINT64CONST(0x0103085e53e599c6)},
+	{UINT64CONST(0xa6c092b5c78212ff), UINT64CONST(0x0143ca75e8df0038)},
+	{UINT64CONST(0xd070b763396297bf), UINT64CONST(0x0194bd136316c046)},
+	{UINT64CONST(0x848ce53c07bb3daf), UINT64CONST(0x01f9ec583bdc7058)},
+	{UINT64CONST(0x52d80f4584d5068d), UINT64CONST(0x013c33b72569c637)},
+	{UINT64CONST(0x278e1316e60a4831), UINT64CONST(0x018b40a4eec437c5)}
+};
+
+static const uint64 FLOAT_POW5_INV_SPLIT[31] = {
+	UINT64CONST(0x0800000000000001), UINT64CONST(0x0666666666666667),
+	UINT64CONST(0x051eb851eb851eb9), UINT64CONST(0x04189374bc6a7efa),
+	UINT64CONST(0x068db8bac710cb2a), UINT64CONST(0x053e2d6238da3c22),
+	UINT64CONST(0x0431bde82d7b634e), UINT64CONST(0x06b5fca6af2bd216),
+	UINT64CONST(0x055e63b88c230e78), UINT64CONST(0x044b82fa09b5a52d),
+	UINT64CONST(0x06df37f675ef6eae), UINT64CONST(0x057f5ff85e592558),
+	UINT64CONST(0x0465e6604b7a8447), UINT64CONST(0x0709709a125da071),
+	UINT64CONST(0x05a126e1a84ae6c1), UINT64CONST(0x0480ebe7b9d58567),
+	UINT64CONST(0x0734aca5f6226f0b), UINT64CONST(0x05c3bd5191b525a3),
+	UINT64CONST(0x049c97747490eae9), UINT64CONST(0x0760f253edb4ab0e),
+	UINT64CONST(0x05e72843249088d8), UINT64CONST(0x04b8ed0283a6d3e0),
+	UINT64CONST(0x078e480405d7b966), UINT64CONST(0x060b6cd004ac9452),
+	UINT64CONST(0x04d5f0a66a23a9db), UINT64CONST(0x07bcb43d769f762b),
+	UINT64CONST(0x063090312bb2c4ef), UINT64CONST(0x04f3a68dbc8f03f3),
+	UINT64CONST(0x07ec3daf94180651), UINT64CONST(0x065697bfa9acd1da),
+	UINT64CONST(0x051212ffbaf0a7e2)
+};
+
+static const uint64 FLOAT_POW5_SPLIT[47] = {
+	UINT64CONST(0x1000000000000000), UINT64CONST(0x1400000000000000),
+	UINT64CONST(0x1900000000000000), UINT64CONST(0x1f40000000000000),
+	UINT64CONST(0x1388000000000000), UINT64CONST(0x186a000000000000),
+	UINT64CONST(0x1e84800000000000), UINT64CONST(0x1312d00000000000),
+	UINT64CONST(0x17d7840000000000), UINT64CONST(0x1dcd650000000000),
+	UINT64CONST(0x12a05f2000000000), UINT64CONST(0x174876e800000000),
+	UINT64CONST(0x1d1a94a200000000), UINT64CONST(0x12309ce540000000),
+	UINT64CONST(0x16bcc41e90000000), UINT64CONST(0x1c6bf52634000000),
+	UINT64CONST(0x11c37937e0800000), UINT64CONST(0x16345785d8a00000),
+	UINT64CONST(0x1bc16d674ec80000), UINT64CONST(0x1158e460913d0000),
+	UINT64CONST(0x15af1d78b58c4000), UINT64CONST(0x1b1ae4d6e2ef5000),
+	UINT64CONST(0x10f0cf064dd59200), UINT64CONST(0x152d02c7e14af680),
+	UINT64CONST(0x1a784379d99db420), UINT64CONST(0x108b2a2c28029094),
+	UINT64CONST(0x14adf4b7320334b9), UINT64CONST(0x19d971e4fe8401e7),
+	UINT64CONST(0x1027e72f1f128130), UINT64CONST(0x1431e0fae6d7217c),
+	UINT64CONST(0x193e5939a08ce9db), UINT64CONST(0x1f8def8808b02452),
+	UINT64CONST(0x13b8b5b5056e16b3), UINT64CONST(0x18a6e32246c99c60),
+	UINT64CONST(0x1ed09bead87c0378), UINT64CONST(0x13426172c74d822b),
+	UINT64CONST(0x1812f9cf7920e2b6), UINT64CONST(0x1e17b84357691b64),
+	UINT64CONST(0x12ced32a16a1b11e), UINT64CONST(0x178287f49c4a1d66),
+	UINT64CONST(0x1d6329f1c35ca4bf), UINT64CONST(0x125dfa371a19e6f7),
+	UINT64CONST(0x16f578c4e0a060b5), UINT64CONST(0x1cb2d6f618c878e3),
+	UINT64CONST(0x11efc659cf7d4b8d), UINT64CONST(0x166bb7f0435c9e71),
+	UINT64CONST(0x1c06a5ec5433c60d)
+};
+
+/*
+ * Returns ceil(log2(5^e)), or 1 for e = 0; that is, the number of bits in
+ * 5^e.  Valid for 0 <= e <= 3528.
+ */
+static int32
+pow5bits(int32 e)
+{
+	return (int32) (((uint32) e * 1217359) >> 19) + 1;
+}
+
+/* Returns floor(log10(2^e)), for 0 <= e <= 1650 */
+static uint32
+log10Pow2(int32 e)
+{
+	return ((uint32) e * 78913) >> 18;
+}
+
+/* Returns floor(log10(5^e)), for 0 <= e <= 2620 */
+static uint32
+log10Pow5(int32 e)
+{
+	return ((uint32) e * 732923) >> 20;
+}
+
+static uint32
+pow5Factor(uint64 value)
+{
+	uint32		count = 0;
+
+	for (;;)
+	{
+		uint64		q = value / 5;
+
+		if (value != q * 5)
+			break;
+		value = q;
+		count++;
+	}
+	return count;
+}
+
+/* Is value divisible by 5^p? */
+static bool
+multipleOfPowerOf5(uint64 value, uint32 p)
+{
+	return pow5Factor(value) >= p;
+}
+
+/* Is value divisible by 2^p? */
+static bool
+multipleOfPowerOf2(uint64 value, uint32 p)
+{
+	return (value & ((UINT64CONST(1) << p) - 1)) == 0;
+}
+
+#if !defined(__SIZEOF_INT128__)
+/*
+ * Returns the 128-bit product a * b, as the low half and *productHi.
+ */
+static uint64
+umul128(uint64 a, uint64 b, uint64 *productHi)
+{
+	uint64		aLo = a & 0xFFFFFFFF;
+	uint64		aHi = a >> 32;
+	uint64		bLo = b & 0xFFFFFFFF;
+	uint64		bHi = b >> 32;
+	uint64		b00 = aLo * bLo;
+	uint64		b01 = aLo * bHi;
+	uint64		b10 = aHi * bLo;
+	uint64		b11 = aHi * bHi;
+	uint64		mid1 = b10 + (b00 >> 32);
+	uint64		mid2 = b01 + (mid1 & 0xFFFFFFFF);
+
+	*productHi = b11 + (mid1 >> 32) + (mid2 >> 32);
+	return (mid2 << 32) | (b00 & 0xFFFFFFFF);
+}
+#endif
+
+/*
+ * Returns (m * mul) >> j, where mul is a 128-bit number split into {low,
+ * high} halves, m has at most 55 bits, and 64 < j < 128.
+ */
+static uint64
+mulShift64(uint64 m, const uint64 *mul, int32 j)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 b0 = (unsigned __int128) m * mul[0];
+	unsigned __int128 b2 = (unsigned __int128) m * mul[1];
+
+	return (uint64) (((b0 >> 64) + b2) >> (j - 64));
+#else
+	uint64		high0;
+	uint64		high1;
+	uint64		low1;
+	uint64		sum;
+	int32		dist = j - 64;
+
+	(void) umul128(m, mul[0], &high0);
+	low1 = umul128(m, mul[1], &high1);
+	sum = high0 + low1;
+	if (sum < high0)
+		high1++;				/* carry */
+
+	Assert(dist > 0 && dist < 64);
+	return (high1 << (64 - dist)) | (sum >> dist);
+#endif
+}
+
+/*
+ * Returns (m * factor) >> shift, for 32 < shift, where factor has at most
+ * 64 bits.
+ */
+static uint32
+mulShift32(uint32 m, uint64 factor, int32 shift)
+{
+	uint64		bits0 = (uint64) m * (factor & 0xFFFFFFFF);
+	uint64		bits1 = (uint64) m * (factor >> 32);
+	uint64		sum = (bits0 >> 32) + bits1;
+
+	Assert(shift > 32);
+	return (uint32) (sum >> (shift - 32));
+}
+
+/*
+ * Find the shortest decimal representation of the finite, nonzero float8
+ * whose IEEE mantissa and exponent fields are given.  On return, the value
+ * is *digits * 10^*exponent.
+ */
+static void
+d2d(uint64 ieeeMantissa, uint32 ieeeExponent,
+	uint64 *digits, int32 *exponent)
+{
+	int32		e2;
+	uint64		m2;
+	bool		acceptBounds;
+	uint64		mv;
+	uint32		mmShift;
+	uint64		vr,
+				vp,
+				vm;
+	int32		e10;
+	bool		vmIsTrailingZeros = false;
+	bool		vrIsTrailingZeros = false;
+	int32		removed = 0;
+	uint32		lastRemovedDigit = 0;
+	uint64		output;
+
+	if (ieeeExponent == 0)
+	{
+		/* subnormal; subtract 2 so that the bounds are integers */
+		e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+		m2 = ieeeMantissa;
+	}
+	else
+	{
+		e2 = (int32) ieeeExponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+		m2 = (UINT64CONST(1) << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+	}
+
+	/*
+	 * Step 2: the value is mv * 2^e2, and the numbers between mm * 2^e2 and
+	 * mp * 2^e2 round to it; the bounds themselves do too, if m2 is even.
+	 * The lower bound is closer if the mantissa is a power of two.
+	 */
+	acceptBounds = (m2 & 1) == 0;
+	mv = 4 * m2;
+	mmShift = (ieeeMantissa != 0 || ieeeExponent <= 1) ? 1 : 0;
+
+	/* Step 3: convert to a decimal power base, rounding towards zero */
+	if (e2 >= 0)
+	{
+		uint32		q = log10Pow2(e2) - (e2 > 3 ? 1 : 0);
+		int32		k = DOUBLE_POW5_INV_BITCOUNT + pow5bits((int32) q) - 1;
+		int32		i = -e2 + (int32) q + k;
+
+		e10 = (int32) q;
+		vr = mulShift64(mv, DOUBLE_POW5_INV_SPLIT[q], i);
+		vp = mulShift64(mv + 2, DOUBLE_POW5_INV_SPLIT[q], i);
+		vm = mulShift64(mv - 1 - mmShift, DOUBLE_POW5_INV_SPLIT[q], i);
+
+		if (q <= 21)
+		{
+			/*
+			 * The division by 5^q above may have been exact.  Only one of
+			 * mp, mv and mm can be a multiple of 5, if any.
+			 */
+			if (mv % 5 == 0)
+				vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+			else if (acceptBounds)
+				vmIsTrailingZeros = multipleOfPowerOf5(mv - 1 - mmShift, q);
+			else
+				vp -= multipleOfPowerOf5(mv + 2, q) ? 1 : 0;
+		}
+	}
+	else
+	{
+		uint32		q = log10Pow5(-e2) - (-e2 > 1 ? 1 : 0);
+		int32		i = -e2 - (int32) q;
+		int32		k = pow5bits(i) - DOUBLE_POW5_BITCOUNT;
+		int32		j = (int32) q - k;
+
+		e10 = (int32) q + e2;
+		vr = mulShift64(mv, DOUBLE_POW5_SPLIT[i], j);
+		vp = mulShift64(mv + 2, DOUBLE_POW5_SPLIT[i], j);
+		vm = mulShift64(mv - 1 - mmShift, DOUBLE_POW5_SPLIT[i], j);
+
+		if (q <= 1)
+		{
+			/*
+			 * {vr,vp,vm} is trailing zeros if {mv,mp,mm} has at least q
+			 * trailing 0 bits.  mv = 4 * m2, so it always has at least two;
+			 * mm = mv - 1 - mmShift has one iff mmShift is 1; and mp = mv + 2
+			 * has at least one.
+			 */
+			vrIsTrailingZeros = true;
+			if (acceptBounds)
+				vmIsTrailingZeros = (mmShift == 1);
+			else
+				vp--;
+		}
+		else if (q < 63)
+			vrIsTrailingZeros = multipleOfPowerOf2(mv, q);
+	}
+
+	/*
+	 * Step 4: remove digits while the bounds still differ, and round what's
+	 * left of vr.
+	 */
+	if (vmIsTrailingZeros || vrIsTrailingZeros)
+	{
+		/* general case, which is rare */
+		while (vp / 10 > vm / 10)
+		{
+			vmIsTrailingZeros &= (vm % 10 == 0);
+			vrIsTrailingZeros &= (lastRemovedDigit == 0);
+			lastRemovedDigit = (uint32) (vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		if (vmIsTrailingZeros)
+		{
+			while (vm % 10 == 0)
+			{
+				vrIsTrailingZeros &= (lastRemovedDigit == 0);
+				lastRemovedDigit = (uint32) (vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+		/* round half to even if the exact value ends in 50..0 */
+		if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+			lastRemovedDigit = 4;
+		/* take vr + 1 if vr is outside the bounds or we need to round up */
+		output = vr +
+			(((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) ||
+			  lastRemovedDigit >= 5) ? 1 : 0);
+	}
+	else
+	{
+		/* common case */
+		while (vp / 10 > vm / 10)
+		{
+			lastRemovedDigit = (uint32) (vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		output = vr + ((vr == vm || lastRemovedDigit >= 5) ? 1 : 0);
+	}
+
+	*digits = output;
+	*exponent = e10 + removed;
+}
+
+/*
+ * As d2d, for float4.  Here 64-bit arithmetic is enough.
+ */
+static void
+f2d(uint32 ieeeMantissa, uint32 ieeeExponent,
+	uint32 *digits, int32 *exponent)
+{
+	int32		e2;
+	uint32		m2;
+	bool		acceptBounds;
+	uint32		mv,
+				mp,
+				mm;
+	uint32		mmShift;
+	uint32		vr,
+				vp,
+				vm;
+	int32		e10;
+	bool		vmIsTrailingZeros = false;
+	bool		vrIsTrailingZeros = false;
+	uint32		lastRemovedDigit = 0;
+	int32		removed = 0;
+	uint32		output;
+
+	if (ieeeExponent == 0)
+	{
+		e2 = 1 - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+		m2 = ieeeMantissa;
+	}
+	else
+	{
+		e2 = (int32) ieeeExponent - FLOAT_BIAS - FLOAT_MANTISSA_BITS - 2;
+		m2 = ((uint32) 1 << FLOAT_MANTISSA_BITS) | ieeeMantissa;
+	}
+
+	/* Step 2: determine the interval of valid decimal representations */
+	acceptBounds = (m2 & 1) == 0;
+	mv = 4 * m2;
+	mp = 4 * m2 + 2;
+	mmShift = (ieeeMantissa != 0 || ieeeExponent <= 1) ? 1 : 0;
+	mm = 4 * m2 - 1 - mmShift;
+
+	/* Step 3: convert to a decimal power base */
+	if (e2 >= 0)
+	{
+		uint32		q = log10Pow2(e2);
+		int32		k = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32) q) - 1;
+		int32		i = -e2 + (int32) q + k;
+
+		e10 = (int32) q;
+		vr = mulShift32(mv, FLOAT_POW5_INV_SPLIT[q], i);
+		vp = mulShift32(mp, FLOAT_POW5_INV_SPLIT[q], i);
+		vm = mulShift32(mm, FLOAT_POW5_INV_SPLIT[q], i);
+
+		if (q != 0 && (vp - 1) / 10 <= vm / 10)
+		{
+			/*
+			 * We need to know one removed digit even if we are not going to
+			 * loop below.
+			 */
+			int32		l = FLOAT_POW5_INV_BITCOUNT + pow5bits((int32) (q - 1)) - 1;
+
+			lastRemovedDigit = mulShift32(mv, FLOAT_POW5_INV_SPLIT[q - 1],
+										  -e2 + (int32) q - 1 + l) % 10;
+		}
+		if (q <= 9)
+		{
+			/* only one of mp, mv and mm can be a multiple of 5, if any */
+			if (mv % 5 == 0)
+				vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+			else if (acceptBounds)
+				vmIsTrailingZeros = multipleOfPowerOf5(mm, q);
+			else
+				vp -= multipleOfPowerOf5(mp, q) ? 1 : 0;
+		}
+	}
+	else
+	{
+		uint32		q = log10Pow5(-e2);
+		int32		i = -e2 - (int32) q;
+		int32		k = pow5bits(i) - FLOAT_POW5_BITCOUNT;
+		int32		j = (int32) q - k;
+
+		e10 = (int32) q + e2;
+		vr = mulShift32(mv, FLOAT_POW5_SPLIT[i], j);
+		vp = mulShift32(mp, FLOAT_POW5_SPLIT[i], j);
+		vm = mulShift32(mm, FLOAT_POW5_SPLIT[i], j);
+
+		if (q != 0 && (vp - 1) / 10 <= vm / 10)
+		{
+			j = (int32) q - 1 - (pow5bits(i + 1) - FLOAT_POW5_BITCOUNT);
+			lastRemovedDigit = mulShift32(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10;
+		}
+		if (q <= 1)
+		{
+			/* see d2d */
+			vrIsTrailingZeros = true;
+			if (acceptBounds)
+				vmIsTrailingZeros = (mmShift == 1);
+			else
+				vp--;
+		}
+		else if (q < 31)
+			vrIsTrailingZeros = multipleOfPowerOf2(mv, q - 1);
+	}
+
+	/* Step 4: find the shortest decimal representation in the interval */
+	if (vmIsTrailingZeros || vrIsTrailingZeros)
+	{
+		while (vp / 10 > vm / 10)
+		{
+			vmIsTrailingZeros &= (vm % 10 == 0);
+			vrIsTrailingZeros &= (lastRemovedDigit == 0);
+			lastRemovedDigit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		if (vmIsTrailingZeros)
+		{
+			while (vm % 10 == 0)
+			{
+				vrIsTrailingZeros &= (lastRemovedDigit == 0);
+				lastRemovedDigit = vr % 10;
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+		if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+			lastRemovedDigit = 4;
+		output = vr +
+			(((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) ||
+			  lastRemovedDigit >= 5) ? 1 : 0);
+	}
+	else
+	{
+		while (vp / 10 > vm / 10)
+		{
+			lastRemovedDigit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		output = vr + ((vr == vm || lastRemovedDigit >= 5) ? 1 : 0);
+	}
+
+	*digits = output;
+	*exponent = e10 + removed;
+}
+
+/*
+ * Print digits * 10^exponent into result, the way printf's %g would print
+ * it with enough precision: in fixed notation if the decimal exponent is
+ * at least -4 and less than sci_limit, else in scientific notation.
+ * Returns the length of the string.
+ */
+static int
+format_decimal(bool negative, uint64 digits, int32 exponent,
+			   int sci_limit, char *result)
+{
+	char		buf[24];
+	int			olength = 0;
+	int32		e;
+	int			i;
+	char	   *p = result;
+
+	/* digits, least significant first */
+	do
+	{
+		buf[olength++] = (char) ('0' + digits % 10);
+		digits /= 10;
+	} while (digits != 0);
+
+	/* exponent of the first digit */
+	e = exponent + olength - 1;
+
+	if (negative)
+		*p++ = '-';
+
+	if (e < -4 || e >= sci_limit)
+	{
+		*p++ = buf[olength - 1];
+		if (olength > 1)
+		{
+			*p++ = '.';
+			for (i = olength - 2; i >= 0; i--)
+				*p++ = buf[i];
+		}
+		*p++ = 'e';
+		if (e < 0)
+		{
+			*p++ = '-';
+			e = -e;
+		}
+		else
+			*p++ = '+';
+		if (e >= 100)
+		{
+			*p++ = (char) ('0' + e / 100);
+			e %= 100;
+		}
+		*p++ = (char) ('0' + e / 10);
+		*p++ = (char) ('0' + e % 10);
+	}
+	else if (e < 0)
+	{
+		*p++ = '0';
+		*p++ = '.';
+		for (i = -1; i > e; i--)
+			*p++ = '0';
+		for (i = olength - 1; i >= 0; i--)
+			*p++ = buf[i];
+	}
+	else
+	{
+		for (i = olength - 1; i >= 0; i--)
+		{
+			*p++ = buf[i];
+			if (i == olength - 1 - e && i > 0)
+				*p++ = '.';
+		}
+		/* trailing zeros of an integer */
+		for (i = olength - 1; i < e; i++)
+			*p++ = '0';
+	}
+
+	*p = '\0';
+	return (int) (p - result);
+}
+
+/*
+ * double_to_shortest_decimal_buf
+ *
+ * Print the shortest decimal string that reads back as exactly f into
+ * result, which must have room for DOUBLE_SHORTEST_DECIMAL_LEN bytes, and
+ * return its length.  f must be finite.
+ */
+int
+double_to_shortest_decimal_buf(double f, char *result)
+{
+	union
+	{
+		double		f;
+		uint64		bits;
+	}			u;
+	bool		negative;
+	uint64		ieeeMantissa;
+	uint32		ieeeExponent;
+	uint64		digits;
+	int32		exponent;
+
+	Assert(!isnan(f) && !isinf(f));
+
+	u.f = f;
+	negative = (u.bits >> (DOUBLE_MANTISSA_BITS + DOUBLE_EXPONENT_BITS)) != 0;
+	ieeeMantissa = u.bits & ((UINT64CONST(1) << DOUBLE_MANTISSA_BITS) - 1);
+	ieeeExponent = (uint32) ((u.bits >> DOUBLE_MANTISSA_BITS) &
+							 ((1 << DOUBLE_EXPONENT_BITS) - 1));
+
+	if (ieeeExponent == 0 && ieeeMantissa == 0)
+		return format_decimal(negative, 0, 0, DBL_DIG, result);
+
+	d2d(ieeeMantissa, ieeeExponent, &digits, &exponent);
+	return format_decimal(negative, digits, exponent, DBL_DIG, result);
+}
+
+/*
+ * float_to_shortest_decimal_buf
+ *
+ * As above, for float4.  result must have room for
+ * FLOAT_SHORTEST_DECIMAL_LEN bytes.
+ */
+int
+float_to_shortest_decimal_buf(float f, char *result)
+{
+	union
+	{
+		float		f;
+		uint32		bits;
+	}			u;
+	bool		negative;
+	uint32		ieeeMantissa;
+	uint32		ieeeExponent;
+	uint32		digits;
+	int32		exponent;
+
+	Assert(!isnan(f) && !isinf(f));
+
+	u.f = f;
+	negative = (u.bits >> (FLOAT_MANTISSA_BITS + FLOAT_EXPONENT_BITS)) != 0;
+	ieeeMantissa = u.bits & (((uint32) 1 << FLOAT_MANTISSA_BITS) - 1);
+	ieeeExponent = (u.bits >> FLOAT_MANTISSA_BITS) &
+		((1 << FLOAT_EXPONENT_BITS) - 1);
+
+	if (ieeeExponent == 0 && ieeeMantissa == 0)
+		return format_decimal(negative, 0, 0, FLT_DIG, result);
+
+	f2d(ieeeMantissa, ieeeExponent, &digits, &exponent);
+	return format_decimal(negative, digits, exponent, FLT_DIG, result);
+}
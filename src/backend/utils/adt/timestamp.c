@@ -155,12 +155,18 @@ timestamp_in(PG_FUNCTION_ARGS)
 	int			ftype[MAXDATEFIELDS];
 	char		workbuf[MAXDATELEN + MAXDATEFIELDS];
 
-	dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
-						  field, ftype, MAXDATEFIELDS, &nf);
-	if (dterr == 0)
-		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
-	if (dterr != 0)
-		DateTimeParseError(dterr, str, "timestamp");
+	/* Try the common ISO format first, then the general parser */
+	if (DecodeISODateTime(str, tm, &fsec, NULL))
+		dtype = DTK_DATE;
+	else
+	{
+		dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
+							  field, ftype, MAXDATEFIELDS, &nf);
+		if (dterr == 0)
+			dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+		if (dterr != 0)
+			DateTimeParseError(dterr, str, "timestamp");
+	}
 
 	switch (dtype)
 	{
@@ -419,12 +425,18 @@ timestamptz_in(PG_FUNCTION_ARGS)
 	int			ftype[MAXDATEFIELDS];
 	char		workbuf[MAXDATELEN + MAXDATEFIELDS];
 
-	dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
-						  field, ftype, MAXDATEFIELDS, &nf);
-	if (dterr == 0)
-		dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
-	if (dterr != 0)
-		DateTimeParseError(dterr, str, "timestamp with time zone");
+	/* Try the common ISO format first, then the general parser */
+	if (DecodeISODateTime(str, tm, &fsec, &tz))
+		dtype = DTK_DATE;
+	else
+	{
+		dterr = ParseDateTime(str, workbuf, sizeof(workbuf),
+							  field, ftype, MAXDATEFIELDS, &nf);
+		if (dterr == 0)
+			dterr = DecodeDateTime(field, ftype, nf, &dtype, tm, &fsec, &tz);
+		if (dterr != 0)
+			DateTimeParseError(dterr, str, "timestamp with time zone");
+	}
 
 	switch (dtype)
 	{
@@ -1831,6 +1843,7 @@ timestamp_cmp(PG_FUNCTION_ARGS)
 }
 
 /* note: this is used for timestamptz also */
+#ifndef HAVE_INT64_TIMESTAMP
 static int
 timestamp_fastcmp(Datum x, Datum y, SortSupport ssup)
 {
@@ -1839,13 +1852,18 @@ timestamp_fastcmp(Datum x, Datum y, SortSupport ssup)
 
 	return timestamp_cmp_internal(a, b);
 }
+#endif
 
 Datum
 timestamp_sortsupport(PG_FUNCTION_ARGS)
 {
 	SortSupport	ssup = (SortSupport) PG_GETARG_POINTER(0);
 
+#ifdef HAVE_INT64_TIMESTAMP
+	ssup->comparator = ssup_datum_int64_cmp;
+#else
 	ssup->comparator = timestamp_fastcmp;
+#endif
 	PG_RETURN_VOID();
 }
 
@@ -2976,6 +2994,97 @@ interval_accum(PG_FUNCTION_ARGS)
 	PG_RETURN_ARRAYTYPE_P(result);
 }
 
+/*
+ * Inverse of interval_accum, used by moving window aggregates.
+ */
+Datum
+interval_accum_inv(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray = PG_GETARG_ARRAYTYPE_P(0);
+	Interval   *newval = PG_GETARG_INTERVAL_P(1);
+	Datum	   *transdatums;
+	int			ndatums;
+	Interval	sumX,
+				N;
+	Interval   *newsum;
+	ArrayType  *result;
+
+	deconstruct_array(transarray,
+					  INTERVALOID, sizeof(Interval), false, 'd',
+					  &transdatums, NULL, &ndatums);
+	if (ndatums != 2)
+		elog(ERROR, "expected 2-element interval array");
+
+	/* see interval_accum for why we memcpy */
+	memcpy((void *) &sumX, DatumGetPointer(transdatums[0]), sizeof(Interval));
+	memcpy((void *) &N, DatumGetPointer(transdatums[1]), sizeof(Interval));
+
+	newsum = DatumGetIntervalP(DirectFunctionCall2(interval_mi,
+												   IntervalPGetDatum(&sumX),
+												 IntervalPGetDatum(newval)));
+	N.time -= 1;
+
+	transdatums[0] = IntervalPGetDatum(newsum);
+	transdatums[1] = IntervalPGetDatum(&N);
+
+	result = construct_array(transdatums, 2,
+							 INTERVALOID, sizeof(Interval), false, 'd');
+
+	PG_RETURN_ARRAYTYPE_P(result);
+}
+
+/*
+ * Combine two interval_accum states: both the sum and the count (kept in
+ * the time field of the second element) simply add up.
+ */
+Datum
+interval_combine(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	Datum	   *transdatums1;
+	Datum	   *transdatums2;
+	int			ndatums1;
+	int			ndatums2;
+	Interval	sum1,
+				N1,
+				sum2,
+				N2;
+	Interval   *newsum;
+	Interval   *newN;
+	ArrayType  *result;
+
+	deconstruct_array(transarray1,
+					  INTERVALOID, sizeof(Interval), false, 'd',
+					  &transdatums1, NULL, &ndatums1);
+	deconstruct_array(transarray2,
+					  INTERVALOID, sizeof(Interval), false, 'd',
+					  &transdatums2, NULL, &ndatums2);
+	if (ndatums1 != 2 || ndatums2 != 2)
+		elog(ERROR, "expected 2-element interval array");
+
+	/* see interval_accum for why we memcpy */
+	memcpy((void *) &sum1, DatumGetPointer(transdatums1[0]), sizeof(Interval));
+	memcpy((void *) &N1, DatumGetPointer(transdatums1[1]), sizeof(Interval));
+	memcpy((void *) &sum2, DatumGetPointer(transdatums2[0]), sizeof(Interval));
+	memcpy((void *) &N2, DatumGetPointer(transdatums2[1]), sizeof(Interval));
+
+	newsum = DatumGetIntervalP(DirectFunctionCall2(interval_pl,
+												   IntervalPGetDatum(&sum1),
+												   IntervalPGetDatum(&sum2)));
+	newN = DatumGetIntervalP(DirectFunctionCall2(interval_pl,
+												 IntervalPGetDatum(&N1),
+												 IntervalPGetDatum(&N2)));
+
+	transdatums1[0] = IntervalPGetDatum(newsum);
+	transdatums1[1] = IntervalPGetDatum(newN);
+
+	result = construct_array(transdatums1, 2,
+							 INTERVALOID, sizeof(Interval), false, 'd');
+
+	PG_RETURN_ARRAYTYPE_P(result);
+}
+
 Datum
 interval_avg(PG_FUNCTION_ARGS)
 {
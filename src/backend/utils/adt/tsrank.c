@@ -33,8 +33,28 @@ static float weights[] = {0.1f, 0.2f, 0.4f, 1.0f};
 #define RANK_NORM_RDIVRPLUS1	0x20
 #define DEF_NORM_METHOD			RANK_NO_NORM
 
-static float calc_rank_or(float *w, TSVector t, TSQuery q);
-static float calc_rank_and(float *w, TSVector t, TSQuery q);
+/*
+ * Per-query state for the ranking functions.  A ranking query evaluates the
+ * same tsquery against many documents, so everything that depends only on
+ * the query is computed once and kept in fn_extra, to be reused for as long
+ * as the query doesn't change.
+ */
+typedef struct
+{
+	TSQuery		query;			/* copy of the query this state is for */
+	QueryOperand **operands;	/* sorted, de-duplicated operands of query */
+	int			noperands;
+
+	/*
+	 * For each QI_VAL item of the query, all the QI_VAL items having the same
+	 * operand (including itself); NULL for operators.
+	 */
+	QueryItem ***equivs;
+	int16	   *nequivs;
+} RankQueryState;
+
+static float calc_rank_or(float *w, TSVector t, RankQueryState *qs);
+static float calc_rank_and(float *w, TSVector t, RankQueryState *qs);
 
 /*
  * Returns a weight of a word collocation
@@ -202,7 +222,7 @@ static WordEntryPosVector POSNULL = {
 };
 
 static float
-calc_rank_and(float *w, TSVector t, TSQuery q)
+calc_rank_and(float *w, TSVector t, RankQueryState *qs)
 {
 	WordEntryPosVector **pos;
 	int			i,
@@ -218,16 +238,13 @@ calc_rank_and(float *w, TSVector t, TSQuery q)
 				dist,
 				nitem;
 	float		res = -1.0;
-	QueryOperand **item;
-	int			size = q->size;
+	TSQuery		q = qs->query;
+	QueryOperand **item = qs->operands;
+	int			size = qs->noperands;
 
-	item = SortAndUniqItems(q, &size);
 	if (size < 2)
-	{
-		pfree(item);
-		return calc_rank_or(w, t, q);
-	}
-	pos = (WordEntryPosVector **) palloc0(sizeof(WordEntryPosVector *) * q->size);
+		return calc_rank_or(w, t, qs);
+	pos = (WordEntryPosVector **) palloc0(sizeof(WordEntryPosVector *) * size);
 	WEP_SETPOS(POSNULL.pos[0], MAXENTRYPOS - 1);
 
 	for (i = 0; i < size; i++)
@@ -273,12 +290,11 @@ calc_rank_and(float *w, TSVector t, TSQuery q)
 		}
 	}
 	pfree(pos);
-	pfree(item);
 	return res;
 }
 
 static float
-calc_rank_or(float *w, TSVector t, TSQuery q)
+calc_rank_or(float *w, TSVector t, RankQueryState *qs)
 {
 	WordEntry  *entry,
 			   *firstentry;
@@ -288,10 +304,9 @@ calc_rank_or(float *w, TSVector t, TSQuery q)
 				i,
 				nitem;
 	float		res = 0.0;
-	QueryOperand **item;
-	int			size = q->size;
-
-	item = SortAndUniqItems(q, &size);
+	TSQuery		q = qs->query;
+	QueryOperand **item = qs->operands;
+	int			size = qs->noperands;
 
 	for (i = 0; i < size; i++)
 	{
@@ -342,23 +357,96 @@ calc_rank_or(float *w, TSVector t, TSQuery q)
 	}
 	if (size > 0)
 		res = res / size;
-	pfree(item);
 	return res;
 }
 
+/*
+ * Return the RankQueryState for the query, reusing the one left in fn_extra
+ * by the previous call if it was for an identical query.
+ */
+static RankQueryState *
+getRankQueryState(FunctionCallInfo fcinfo, TSQuery query)
+{
+	RankQueryState *qs = (RankQueryState *) fcinfo->flinfo->fn_extra;
+	MemoryContext oldcxt;
+	QueryItem  *item;
+	char	   *operand;
+	int			i,
+				k;
+
+	if (qs != NULL &&
+		VARSIZE(qs->query) == VARSIZE(query) &&
+		memcmp(qs->query, query, VARSIZE(query)) == 0)
+		return qs;
+
+	oldcxt = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+
+	if (qs == NULL)
+	{
+		qs = (RankQueryState *) palloc(sizeof(RankQueryState));
+		fcinfo->flinfo->fn_extra = (void *) qs;
+	}
+	else
+	{
+		for (i = 0; i < qs->query->size; i++)
+		{
+			if (qs->equivs[i])
+				pfree(qs->equivs[i]);
+		}
+		pfree(qs->equivs);
+		pfree(qs->nequivs);
+		pfree(qs->operands);
+		pfree(qs->query);
+	}
+
+	qs->query = (TSQuery) palloc(VARSIZE(query));
+	memcpy(qs->query, query, VARSIZE(query));
+
+	qs->noperands = qs->query->size;
+	qs->operands = SortAndUniqItems(qs->query, &qs->noperands);
+
+	item = GETQUERY(qs->query);
+	operand = GETOPERAND(qs->query);
+	qs->equivs = (QueryItem ***) palloc0(sizeof(QueryItem **) * Max(qs->query->size, 1));
+	qs->nequivs = (int16 *) palloc0(sizeof(int16) * Max(qs->query->size, 1));
+
+	for (i = 0; i < qs->query->size; i++)
+	{
+		QueryOperand *iptr = &item[i].qoperand;
+
+		if (item[i].type != QI_VAL)
+			continue;
+
+		qs->equivs[i] = (QueryItem **) palloc(sizeof(QueryItem *) * qs->query->size);
+		for (k = 0; k < qs->query->size; k++)
+		{
+			QueryOperand *kptr = &item[k].qoperand;
+
+			if (k == i ||
+				(item[k].type == QI_VAL &&
+				 compareQueryOperand(&kptr, &iptr, operand) == 0))
+				qs->equivs[i][qs->nequivs[i]++] = item + k;
+		}
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return qs;
+}
+
 static float
-calc_rank(float *w, TSVector t, TSQuery q, int4 method)
+calc_rank(float *w, TSVector t, RankQueryState *qs, int4 method)
 {
-	QueryItem  *item = GETQUERY(q);
+	QueryItem  *item = GETQUERY(qs->query);
 	float		res = 0.0;
 	int			len;
 
-	if (!t->size || !q->size)
+	if (!t->size || !qs->query->size)
 		return 0.0;
 
 	/* XXX: What about NOT? */
 	res = (item->type == QI_OPR && item->qoperator.oper == OP_AND) ?
-		calc_rank_and(w, t, q) : calc_rank_or(w, t, q);
+		calc_rank_and(w, t, qs) : calc_rank_or(w, t, qs);
 
 	if (res < 0)
 		res = 1e-20f;
@@ -434,7 +522,8 @@ ts_rank_wttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(3);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, method);
+	res = calc_rank(getWeights(win), txt,
+					getRankQueryState(fcinfo, query), method);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -450,7 +539,8 @@ ts_rank_wtt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(2);
 	float		res;
 
-	res = calc_rank(getWeights(win), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(getWeights(win), txt,
+					getRankQueryState(fcinfo, query), DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -466,7 +556,8 @@ ts_rank_ttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(2);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, method);
+	res = calc_rank(getWeights(NULL), txt,
+					getRankQueryState(fcinfo, query), method);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -480,7 +571,8 @@ ts_rank_tt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(1);
 	float		res;
 
-	res = calc_rank(getWeights(NULL), txt, query, DEF_NORM_METHOD);
+	res = calc_rank(getWeights(NULL), txt,
+					getRankQueryState(fcinfo, query), DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -615,7 +707,8 @@ Cover(DocRepresentation *doc, int len, QueryRepresentation *qr, Extention *ext)
 }
 
 static DocRepresentation *
-get_docrep(TSVector txt, QueryRepresentation *qr, int *doclen)
+get_docrep(TSVector txt, QueryRepresentation *qr, RankQueryState *qs,
+		   int *doclen)
 {
 	QueryItem  *item = GETQUERY(qr->query);
 	WordEntry  *entry,
@@ -628,10 +721,8 @@ get_docrep(TSVector txt, QueryRepresentation *qr, int *doclen)
 	int			len = qr->query->size * 4,
 				cur = 0;
 	DocRepresentation *doc;
-	char	   *operand;
 
 	doc = (DocRepresentation *) palloc(sizeof(DocRepresentation) * len);
-	operand = GETOPERAND(qr->query);
 
 	for (i = 0; i < qr->query->size; i++)
 	{
@@ -674,27 +765,12 @@ get_docrep(TSVector txt, QueryRepresentation *qr, int *doclen)
 				{
 					int			k;
 
-					doc[cur].nitem = 0;
-					doc[cur].item = (QueryItem **) palloc(sizeof(QueryItem *) * qr->query->size);
-
-					for (k = 0; k < qr->query->size; k++)
-					{
-						QueryOperand *kptr = &item[k].qoperand;
-						QueryOperand *iptr = &item[i].qoperand;
+					/* all the query items matching this word */
+					doc[cur].nitem = qs->nequivs[i];
+					doc[cur].item = qs->equivs[i];
 
-						if (k == i ||
-							(item[k].type == QI_VAL &&
-							 compareQueryOperand(&kptr, &iptr, operand) == 0))
-						{
-							/*
-							 * if k == i, we've already checked above that
-							 * it's type == Q_VAL
-							 */
-							doc[cur].item[doc[cur].nitem] = item + k;
-							doc[cur].nitem++;
-							QR_SET_OPERAND_EXISTS(qr, item + k);
-						}
-					}
+					for (k = 0; k < doc[cur].nitem; k++)
+						QR_SET_OPERAND_EXISTS(qr, doc[cur].item[k]);
 				}
 				else
 				{
@@ -723,7 +799,7 @@ get_docrep(TSVector txt, QueryRepresentation *qr, int *doclen)
 }
 
 static float4
-calc_rank_cd(float4 *arrdata, TSVector txt, TSQuery query, int method)
+calc_rank_cd(float4 *arrdata, TSVector txt, RankQueryState *qs, int method)
 {
 	DocRepresentation *doc;
 	int			len,
@@ -749,10 +825,10 @@ calc_rank_cd(float4 *arrdata, TSVector txt, TSQuery query, int method)
 		invws[i] = 1.0 / invws[i];
 	}
 
-	qr.query = query;
-	qr.operandexist = (bool *) palloc0(sizeof(bool) * query->size);
+	qr.query = qs->query;
+	qr.operandexist = (bool *) palloc0(sizeof(bool) * qs->query->size);
 
-	doc = get_docrep(txt, &qr, &doclen);
+	doc = get_docrep(txt, &qr, qs, &doclen);
 	if (!doc)
 	{
 		pfree(qr.operandexist);
@@ -833,7 +909,8 @@ ts_rankcd_wttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(3);
 	float		res;
 
-	res = calc_rank_cd(getWeights(win), txt, query, method);
+	res = calc_rank_cd(getWeights(win), txt,
+					   getRankQueryState(fcinfo, query), method);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -849,7 +926,8 @@ ts_rankcd_wtt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(2);
 	float		res;
 
-	res = calc_rank_cd(getWeights(win), txt, query, DEF_NORM_METHOD);
+	res = calc_rank_cd(getWeights(win), txt,
+					   getRankQueryState(fcinfo, query), DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(win, 0);
 	PG_FREE_IF_COPY(txt, 1);
@@ -865,7 +943,8 @@ ts_rankcd_ttf(PG_FUNCTION_ARGS)
 	int			method = PG_GETARG_INT32(2);
 	float		res;
 
-	res = calc_rank_cd(getWeights(NULL), txt, query, method);
+	res = calc_rank_cd(getWeights(NULL), txt,
+					   getRankQueryState(fcinfo, query), method);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -879,7 +958,8 @@ ts_rankcd_tt(PG_FUNCTION_ARGS)
 	TSQuery		query = PG_GETARG_TSQUERY(1);
 	float		res;
 
-	res = calc_rank_cd(getWeights(NULL), txt, query, DEF_NORM_METHOD);
+	res = calc_rank_cd(getWeights(NULL), txt,
+					   getRankQueryState(fcinfo, query), DEF_NORM_METHOD);
 
 	PG_FREE_IF_COPY(txt, 0);
 	PG_FREE_IF_COPY(query, 1);
@@ -17,6 +17,7 @@
 #include <ctype.h>
 #include <limits.h>
 
+#include "access/hash.h"
 #include "access/tuptoaster.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
@@ -29,6 +30,7 @@
 #include "utils/bytea.h"
 #include "utils/lsyscache.h"
 #include "utils/pg_locale.h"
+#include "utils/sortsupport.h"
 
 
 /* GUC variable */
@@ -1314,6 +1316,35 @@ text_position_cleanup(TextPositionState *state)
 	}
 }
 
+/* varstr_contains()
+ * Does the byte string needle occur anywhere in haystack?
+ * This is a plain bytewise search with no notion of character boundaries, so
+ * in multibyte encodings a hit does not imply a character-aligned match; it
+ * is meant for cheaply ruling out strings that cannot match a pattern.
+ */
+bool
+varstr_contains(char *haystack, int hlen, char *needle, int nlen)
+{
+	char	   *hptr = haystack;
+	char	   *hend = haystack + hlen - nlen;
+
+	if (nlen <= 0)
+		return true;
+
+	/* memchr() finds candidate positions, memcmp() confirms them */
+	while (hptr <= hend)
+	{
+		hptr = memchr(hptr, (unsigned char) needle[0], hend - hptr + 1);
+		if (hptr == NULL)
+			return false;
+		if (memcmp(hptr + 1, needle + 1, nlen - 1) == 0)
+			return true;
+		hptr++;
+	}
+
+	return false;
+}
+
 /* varstr_cmp()
  * Comparison function for text strings with given lengths.
  * Includes locale support, but must copy strings to temporary memory
@@ -1666,6 +1697,199 @@ bttextcmp(PG_FUNCTION_ARGS)
 	PG_RETURN_INT32(result);
 }
 
+/*
+ * Sort support for text.
+ *
+ * Besides skipping the fmgr overhead of bttextcmp, we offer abbreviated keys
+ * when sorting in the C collation: the first sizeof(Datum) bytes of the
+ * string, packed so that comparing the Datums as unsigned integers orders
+ * them as memcmp() would the bytes.  The abbreviated keys thus never
+ * contradict the full comparison; where they're equal, we fall back to it.
+ *
+ * If TRUST_STRXFRM is defined, the database's default collation is
+ * abbreviated too, using the leading bytes of the strings' strxfrm() images.
+ * That relies on the images comparing as strcoll() does the strings, which
+ * too many C libraries get wrong to do by default.  Other collations would
+ * need strxfrm_l(), so they never get abbreviation.
+ *
+ * Strings that agree in their first few bytes (URLs with a common prefix,
+ * say) gain nothing from this, so the abort test watches how often
+ * abbreviated keys fail to tell apart values that do differ.
+ */
+typedef struct
+{
+	bool		collate_c;
+	char	   *buf;			/* NUL-terminated copy of the string */
+	int			buflen;
+	char	   *xfrmbuf;		/* its strxfrm() image */
+	int			xfrmbuflen;
+	/* state for the abort test */
+	bool		have_prev;
+	uint32		prev_hash;
+	Datum		prev_abbrev;
+	int			ndistinct_pairs;
+	int			nambiguous_pairs;
+} TextSortSupport;
+
+static int
+bttextfastcmp(Datum x, Datum y, SortSupport ssup)
+{
+	text	   *arg1 = DatumGetTextPP(x);
+	text	   *arg2 = DatumGetTextPP(y);
+	int			result;
+
+	result = text_cmp(arg1, arg2, ssup->ssup_collation);
+
+	/* we can't afford to leak memory here */
+	if (PointerGetDatum(arg1) != x)
+		pfree(arg1);
+	if (PointerGetDatum(arg2) != y)
+		pfree(arg2);
+
+	return result;
+}
+
+static int
+bttextabbrevcmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x > y)
+		return 1;
+	else if (x == y)
+		return 0;
+	else
+		return -1;
+}
+
+static Datum
+bttextabbrevconvert(Datum original, SortSupport ssup)
+{
+	TextSortSupport *tss = (TextSortSupport *) ssup->ssup_extra;
+	text	   *arg = DatumGetTextPP(original);
+	char	   *str = VARDATA_ANY(arg);
+	int			len = VARSIZE_ANY_EXHDR(arg);
+	char	   *key;
+	Size		keylen;
+	Datum		res = 0;
+	uint32		hash;
+	int			i;
+
+	if (tss->collate_c)
+	{
+		key = str;
+		keylen = len;
+	}
+	else
+	{
+		if (len >= tss->buflen)
+		{
+			pfree(tss->buf);
+			tss->buflen = Max(len + 1, tss->buflen * 2);
+			tss->buf = MemoryContextAlloc(ssup->ssup_cxt, tss->buflen);
+		}
+		memcpy(tss->buf, str, len);
+		tss->buf[len] = '\0';
+
+		for (;;)
+		{
+			keylen = strxfrm(tss->xfrmbuf, tss->buf, tss->xfrmbuflen);
+			if (keylen < (Size) tss->xfrmbuflen)
+				break;
+			/* the contents of xfrmbuf are unspecified; grow it and retry */
+			pfree(tss->xfrmbuf);
+			tss->xfrmbuflen = Max(keylen + 1, tss->xfrmbuflen * 2);
+			tss->xfrmbuf = MemoryContextAlloc(ssup->ssup_cxt,
+											  tss->xfrmbuflen);
+		}
+		key = tss->xfrmbuf;
+	}
+
+	/* pack the leading bytes, most significant first, zero-padded */
+	for (i = 0; i < sizeof(Datum); i++)
+	{
+		res <<= 8;
+		if (i < keylen)
+			res |= (unsigned char) key[i];
+	}
+
+	/* compare with the previous value, for the abort test */
+	hash = DatumGetUInt32(hash_any((unsigned char *) str, len));
+	if (tss->have_prev && hash != tss->prev_hash)
+	{
+		tss->ndistinct_pairs++;
+		if (res == tss->prev_abbrev)
+			tss->nambiguous_pairs++;
+	}
+	tss->have_prev = true;
+	tss->prev_hash = hash;
+	tss->prev_abbrev = res;
+
+	if (PointerGetDatum(arg) != original)
+		pfree(arg);
+
+	return res;
+}
+
+static bool
+bttextabbrevabort(int memtupcount, SortSupport ssup)
+{
+	TextSortSupport *tss = (TextSortSupport *) ssup->ssup_extra;
+
+	/*
+	 * Give up if more than one in twenty pairs of differing neighbours got
+	 * the same abbreviated key.  If nothing differed at all, every comparison
+	 * will end in the full comparator whatever we do, so we might as well
+	 * carry on.
+	 */
+	return tss->nambiguous_pairs > tss->ndistinct_pairs / 20;
+}
+
+Datum
+bttextsortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+	Oid			collid = ssup->ssup_collation;
+	TextSortSupport *tss;
+	MemoryContext oldcontext;
+
+	ssup->comparator = bttextfastcmp;
+
+	if (!ssup->abbreviate)
+		PG_RETURN_VOID();
+
+	/* collation must be resolved, and let varstr_cmp complain if not */
+	if (!OidIsValid(collid))
+		PG_RETURN_VOID();
+#if !defined(TRUST_STRXFRM) || defined(WIN32)
+	/* strxfrm() can't be trusted, and doesn't work on UTF-8 on Windows */
+	if (!lc_collate_is_c(collid))
+		PG_RETURN_VOID();
+#endif
+	if (!lc_collate_is_c(collid) && collid != DEFAULT_COLLATION_OID)
+		PG_RETURN_VOID();
+
+	oldcontext = MemoryContextSwitchTo(ssup->ssup_cxt);
+
+	tss = (TextSortSupport *) palloc0(sizeof(TextSortSupport));
+	tss->collate_c = lc_collate_is_c(collid);
+	if (!tss->collate_c)
+	{
+		tss->buflen = 1024;
+		tss->buf = palloc(tss->buflen);
+		tss->xfrmbuflen = 1024;
+		tss->xfrmbuf = palloc(tss->xfrmbuflen);
+	}
+	ssup->ssup_extra = tss;
+
+	ssup->abbrev_full_comparator = bttextfastcmp;
+	ssup->comparator = bttextabbrevcmp;
+	ssup->abbrev_converter = bttextabbrevconvert;
+	ssup->abbrev_abort = bttextabbrevabort;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	PG_RETURN_VOID();
+}
+
 
 Datum
 text_larger(PG_FUNCTION_ARGS)
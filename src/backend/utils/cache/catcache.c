@@ -71,6 +71,9 @@
 /* Cache management header --- pointer is NULL until created */
 static CatCacheHeader *CacheHdr = NULL;
 
+/* GUC parameter: limit on CacheHdr->ch_ntup, or 0 for no limit */
+int			max_catcache_entries = 0;
+
 
 static uint32 CatalogCacheComputeHashValue(CatCache *cache, int nkeys,
 							 ScanKey cur_skey);
@@ -82,6 +85,7 @@ static void CatCachePrintStats(int code, Datum arg);
 #endif
 static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
+static void CatCacheEvict(void);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 						uint32 hashValue, Index hashIndex,
@@ -368,8 +372,9 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	DLRemove(&ct->cache_elem);
+	DLRemove(&ct->lru_elem);
 
 	/* free associated tuple data */
 	if (ct->tuple.t_data != NULL)
@@ -420,6 +425,82 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	pfree(cl);
 }
 
+/*
+ *		CatCacheEvict
+ *
+ * Remove least recently used entries until there is room for one more
+ * entry under max_catcache_entries.
+ *
+ * Entries that are referenced, directly or through their CatCList, cannot
+ * be removed.  Since they are in use they have in effect been used
+ * recently, so we move them to the front of the LRU list, which keeps
+ * later calls from scanning past them again.  We look at each entry at
+ * most once, so if too many entries are in use we stay over the limit.
+ */
+static void
+CatCacheEvict(void)
+{
+	Dlelem	   *elt;
+	Dlelem	   *prevelt;
+	int			nvisit = CacheHdr->ch_ntup;
+
+	for (elt = DLGetTail(&CacheHdr->ch_lrulist);
+		 elt != NULL && nvisit-- > 0 &&
+		 CacheHdr->ch_ntup >= max_catcache_entries;
+		 elt = prevelt)
+	{
+		CatCTup    *ct = (CatCTup *) DLE_VAL(elt);
+
+		prevelt = DLGetPred(elt);
+
+		if (ct->refcount > 0 ||
+			(ct->c_list && ct->c_list->refcount > 0))
+		{
+			DLMoveToFront(elt);
+			continue;
+		}
+
+		CACHE2_elog(DEBUG2, "CatCacheEvict(%s): evicting entry",
+					ct->my_cache->cc_relname);
+
+		if (ct->c_list)
+		{
+			/*
+			 * This removes the whole list, and possibly other members of it
+			 * too, so prevelt may be gone; start again from the tail.
+			 */
+			CatCacheRemoveCTup(ct->my_cache, ct);
+			prevelt = DLGetTail(&CacheHdr->ch_lrulist);
+		}
+		else
+			CatCacheRemoveCTup(ct->my_cache, ct);
+
+		CacheHdr->ch_evictions++;
+	}
+}
+
+/*
+ *		CatalogCacheGetStats
+ *
+ * Report the number of entries in all the catcaches, and the hit, miss
+ * and eviction counts since backend start.
+ */
+void
+CatalogCacheGetStats(int64 *entries, int64 *hits, int64 *misses,
+					 int64 *evictions)
+{
+	if (CacheHdr == NULL)
+	{
+		*entries = *hits = *misses = *evictions = 0;
+		return;
+	}
+
+	*entries = CacheHdr->ch_ntup;
+	*hits = CacheHdr->ch_hits;
+	*misses = CacheHdr->ch_misses;
+	*evictions = CacheHdr->ch_evictions;
+}
+
 
 /*
  *	CatalogCacheIdInvalidate
@@ -762,6 +843,10 @@ InitCatCache(int id,
 		CacheHdr = (CatCacheHeader *) palloc(sizeof(CatCacheHeader));
 		CacheHdr->ch_caches = NULL;
 		CacheHdr->ch_ntup = 0;
+		DLInitList(&CacheHdr->ch_lrulist);
+		CacheHdr->ch_hits = 0;
+		CacheHdr->ch_misses = 0;
+		CacheHdr->ch_evictions = 0;
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1065,6 +1150,8 @@ SearchCatCache(CatCache *cache,
 	Relation	relation;
 	SysScanDesc scandesc;
 	HeapTuple	ntp;
+	bool		useShared;
+	uint32		generation = 0;
 
 	/*
 	 * one-time startup overhead for each cache
@@ -1123,9 +1210,12 @@ SearchCatCache(CatCache *cache,
 		 * We found a match in the cache.  Move it to the front of the list
 		 * for its hashbucket, in order to speed subsequent searches.  (The
 		 * most frequently accessed elements in any hashbucket will tend to be
-		 * near the front of the hashbucket's list.)
+		 * near the front of the hashbucket's list.)  Also mark it most
+		 * recently used.
 		 */
 		DLMoveToFront(&ct->cache_elem);
+		DLMoveToFront(&ct->lru_elem);
+		CacheHdr->ch_hits++;
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1174,6 +1264,34 @@ SearchCatCache(CatCache *cache,
 	 * This case is rare enough that it's not worth expending extra cycles to
 	 * detect.
 	 */
+	CacheHdr->ch_misses++;
+
+	/*
+	 * Another backend may have read the tuple already; if so, copy it from
+	 * the shared catcache rather than searching the catalog.
+	 */
+	useShared = SharedCatCacheUsable(cache);
+	if (useShared)
+	{
+		ntp = SharedCatCacheLookup(cache, hashValue, cur_skey, &generation);
+		if (ntp != NULL)
+		{
+			ct = CatalogCacheCreateEntry(cache, ntp,
+										 hashValue, hashIndex,
+										 false);
+			heap_freetuple(ntp);
+			/* immediately set the refcount to 1 */
+			ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+			ct->refcount++;
+			ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+			CACHE2_elog(DEBUG2, "SearchCatCache(%s): found in shared cache",
+						cache->cc_relname);
+
+			return &ct->tuple;
+		}
+	}
+
 	relation = heap_open(cache->cc_reloid, AccessShareLock);
 
 	scandesc = systable_beginscan(relation,
@@ -1201,6 +1319,10 @@ SearchCatCache(CatCache *cache,
 
 	heap_close(relation, AccessShareLock);
 
+	/* share the tuple (which is now flattened) with other backends */
+	if (ct != NULL && useShared)
+		SharedCatCacheInsert(cache, hashValue, &ct->tuple, generation);
+
 	/*
 	 * If tuple was not found, we need to build a negative cache entry
 	 * containing a fake tuple.  The fake tuple has the correct key columns,
@@ -1377,6 +1499,7 @@ SearchCatCacheList(CatCache *cache,
 		 * individually.)
 		 */
 		DLMoveToFront(&cl->cache_elem);
+		CacheHdr->ch_hits++;
 
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
@@ -1403,6 +1526,8 @@ SearchCatCacheList(CatCache *cache,
 	 * block to ensure we can undo those refcounts if we get an error before
 	 * we finish constructing the CatCList.
 	 */
+	CacheHdr->ch_misses++;
+
 	ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
 
 	ctlist = NIL;
@@ -1468,6 +1593,8 @@ SearchCatCacheList(CatCache *cache,
 											 hashValue, hashIndex,
 											 false);
 			}
+			else
+				DLMoveToFront(&ct->lru_elem);
 
 			/* Careful here: add entry to ctlist, then bump its refcount */
 			/* This way leaves state correct if lappend runs out of memory */
@@ -1595,6 +1722,11 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 	HeapTuple	dtp;
 	MemoryContext oldcxt;
 
+	/* Make room for the new entry, if the caches are limited in size */
+	if (max_catcache_entries > 0 &&
+		CacheHdr->ch_ntup >= max_catcache_entries)
+		CatCacheEvict();
+
 	/*
 	 * If there are any out-of-line toasted fields in the tuple, expand them
 	 * in-line.  This saves cycles during later use of the catcache entry,
@@ -1625,6 +1757,7 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 	ct->ct_magic = CT_MAGIC;
 	ct->my_cache = cache;
 	DLInitElem(&ct->cache_elem, (void *) ct);
+	DLInitElem(&ct->lru_elem, (void *) ct);
 	ct->c_list = NULL;
 	ct->refcount = 0;			/* for the moment */
 	ct->dead = false;
@@ -1632,6 +1765,7 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
 	ct->hash_value = hashValue;
 
 	DLAddHead(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	DLAddHead(&CacheHdr->ch_lrulist, &ct->lru_elem);
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
@@ -168,6 +168,13 @@ static SharedInvalidationMessage *SharedInvalidMessagesArray;
 static int	numSharedInvalidMessagesArray;
 static int	maxSharedInvalidMessagesArray;
 
+/*
+ * Has the current top-level transaction registered any invalidations?  If
+ * so it may have changed catalog tuples, and must not use the shared
+ * catcache (see sharedcatcache.c) until it ends.
+ */
+static bool transHasInvalidations = false;
+
 
 /*
  * Dynamically-registered callback functions.  Current implementation
@@ -425,6 +432,7 @@ RegisterCatcacheInvalidation(int cacheId,
 {
 	AddCatcacheInvalidationMessage(&transInvalInfo->CurrentCmdInvalidMsgs,
 								   cacheId, hashValue, dbId);
+	transHasInvalidations = true;
 }
 
 /*
@@ -437,6 +445,7 @@ RegisterCatalogInvalidation(Oid dbId, Oid catId)
 {
 	AddCatalogInvalidationMessage(&transInvalInfo->CurrentCmdInvalidMsgs,
 								  dbId, catId);
+	transHasInvalidations = true;
 }
 
 /*
@@ -449,6 +458,7 @@ RegisterRelcacheInvalidation(Oid dbId, Oid relId)
 {
 	AddRelcacheInvalidationMessage(&transInvalInfo->CurrentCmdInvalidMsgs,
 								   dbId, relId);
+	transHasInvalidations = true;
 
 	/*
 	 * Most of the time, relcache invalidation is associated with system
@@ -864,6 +874,20 @@ AtEOXact_Inval(bool isCommit)
 
 	/* Need not free anything explicitly */
 	transInvalInfo = NULL;
+	transHasInvalidations = false;
+}
+
+/*
+ * TransactionHasPendingInvalidations
+ *		Has the current transaction queued any invalidation messages?
+ *
+ * Messages queued by an aborted subtransaction still count; this only
+ * errs on the side of caution.
+ */
+bool
+TransactionHasPendingInvalidations(void)
+{
+	return transHasInvalidations;
 }
 
 /*
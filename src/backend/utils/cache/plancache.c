@@ -9,7 +9,11 @@
  * changes in the objects they depend on.
  *
  * The logic for choosing generic or custom plans is in choose_custom_plan,
- * which see for comments.
+ * which see for comments.  Optionally, the cost statistics it is based on
+ * are shared between backends through a table in shared memory, so that a
+ * session preparing a statement that others have already run needn't
+ * learn all over again which kind of plan suits it.  Plans themselves are
+ * never shared; each backend still plans and validates its own.
  *
  * Cache invalidation is driven off sinval events.  Any CachedPlanSource
  * that matches the event is marked invalid, as is its generic CachedPlan
@@ -47,18 +51,24 @@
 
 #include <limits.h>
 
+#include "access/hash.h"
 #include "access/transam.h"
 #include "catalog/namespace.h"
 #include "executor/executor.h"
 #include "executor/spi.h"
+#include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/cost.h"
 #include "optimizer/planmain.h"
 #include "optimizer/prep.h"
 #include "parser/analyze.h"
 #include "parser/parsetree.h"
 #include "storage/lmgr.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
+#include "utils/hsearch.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
@@ -73,14 +83,43 @@
  */
 static CachedPlanSource *first_saved_plan = NULL;
 
+/* GUC parameter: size of the shared plan statistics table, 0 to disable */
+int			plan_cache_shared_stats = 0;
+
+/*
+ * An entry in the shared plan statistics table.  Statements are identified
+ * by a hash of their source text, and a hash of everything else that goes
+ * into parsing it the same way: parameter types and search_path.  A hash
+ * collision can only lead to a poor choice between a generic and a custom
+ * plan, which the backend will correct as it gathers costs of its own.
+ */
+typedef struct PlanStatsKey
+{
+	Oid			dbid;
+	uint32		query_hash;
+	uint32		context_hash;
+} PlanStatsKey;
+
+typedef struct PlanStatsEntry
+{
+	PlanStatsKey key;			/* hash key of entry - MUST BE FIRST */
+	double		generic_cost;
+	double		total_custom_cost;
+	int			num_custom_plans;
+} PlanStatsEntry;
+
+static HTAB *SharedPlanStats = NULL;
+
 static void ReleaseGenericPlan(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource);
 static bool CheckCachedPlan(CachedPlanSource *plansource);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams);
+static void GetSharedPlanStats(CachedPlanSource *plansource);
+static void PutSharedPlanStats(CachedPlanSource *plansource);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
-static double cached_plan_cost(CachedPlan *plan);
+static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static void AcquireExecutorLocks(List *stmt_list, bool acquire);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
@@ -188,6 +227,7 @@ CreateCachedPlan(Node *raw_parse_tree,
 	plansource->generic_cost = -1;
 	plansource->total_custom_cost = 0;
 	plansource->num_custom_plans = 0;
+	plansource->shared_stats_checked = false;
 
 	MemoryContextSwitchTo(oldcxt);
 
@@ -879,9 +919,13 @@ choose_custom_plan(CachedPlanSource *plansource, ParamListInfo boundParams)
 
 /*
  * cached_plan_cost: calculate estimated cost of a plan
+ *
+ * If include_planner is true, also include the estimated cost of making the
+ * plan.  That's charged to custom plans, which are made afresh for every
+ * execution, but not to a generic plan, which is made once and reused.
  */
 static double
-cached_plan_cost(CachedPlan *plan)
+cached_plan_cost(CachedPlan *plan, bool include_planner)
 {
 	double		result = 0;
 	ListCell   *lc;
@@ -894,11 +938,192 @@ cached_plan_cost(CachedPlan *plan)
 			continue;			/* Ignore utility statements */
 
 		result += plannedstmt->planTree->total_cost;
+
+		if (include_planner)
+		{
+			/*
+			 * Planning effort grows with the number of relations to join,
+			 * so estimate it as that times a factor chosen to make a plan
+			 * of a simple query worth a couple of thousand operators.  This
+			 * is only a rough measure, but without it a custom plan whose
+			 * runtime cost is barely lower always wins, however often we
+			 * pay for planning it.
+			 */
+			int			nrelations = list_length(plannedstmt->rtable);
+
+			result += 1000.0 * cpu_operator_cost * (nrelations + 1);
+		}
 	}
 
 	return result;
 }
 
+/*
+ * PlanCacheShmemSize
+ *		Compute space needed for the shared plan statistics table
+ */
+Size
+PlanCacheShmemSize(void)
+{
+	if (plan_cache_shared_stats <= 0)
+		return 0;
+	return hash_estimate_size(plan_cache_shared_stats, sizeof(PlanStatsEntry));
+}
+
+/*
+ * PlanCacheShmemInit
+ *		Create or attach to the shared plan statistics table
+ */
+void
+PlanCacheShmemInit(void)
+{
+	HASHCTL		info;
+
+	if (plan_cache_shared_stats <= 0)
+		return;
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(PlanStatsKey);
+	info.entrysize = sizeof(PlanStatsEntry);
+	info.hash = tag_hash;
+	SharedPlanStats = ShmemInitHash("Shared Plan Statistics",
+									plan_cache_shared_stats,
+									plan_cache_shared_stats,
+									&info,
+									HASH_ELEM | HASH_FUNCTION);
+}
+
+/*
+ * Compute the shared plan statistics key for a plan source.
+ */
+static void
+plan_stats_key(CachedPlanSource *plansource, PlanStatsKey *key)
+{
+	uint32		h = 0;
+
+	MemSet(key, 0, sizeof(PlanStatsKey));
+	key->dbid = MyDatabaseId;
+	key->query_hash =
+		DatumGetUInt32(hash_any((unsigned char *) plansource->query_string,
+								strlen(plansource->query_string)));
+
+	if (plansource->num_params > 0)
+		h = DatumGetUInt32(hash_any((unsigned char *) plansource->param_types,
+									plansource->num_params * sizeof(Oid)));
+	if (plansource->search_path != NULL)
+	{
+		OverrideSearchPath *path = plansource->search_path;
+		ListCell   *lc;
+
+		foreach(lc, path->schemas)
+			h = ((h << 1) | (h >> 31)) ^ lfirst_oid(lc);
+		h = ((h << 2) | (h >> 30)) ^
+			(path->addCatalog ? 1 : 0) ^ (path->addTemp ? 2 : 0);
+	}
+	key->context_hash = h;
+}
+
+/*
+ * Should the given plan source take part in sharing plan statistics?
+ *
+ * Only saved plan sources are reused, so only they benefit; and only
+ * statements with parameters choose between generic and custom plans,
+ * unless the caller has forced the choice.
+ */
+static bool
+plan_stats_shareable(CachedPlanSource *plansource)
+{
+	return (SharedPlanStats != NULL &&
+			plansource->is_saved &&
+			(plansource->num_params > 0 || plansource->parserSetup != NULL) &&
+			(plansource->cursor_options &
+			 (CURSOR_OPT_GENERIC_PLAN | CURSOR_OPT_CUSTOM_PLAN)) == 0);
+}
+
+/*
+ * Initialize a plan source's cost statistics from the shared table, if
+ * another backend has stored some for the same statement.
+ */
+static void
+GetSharedPlanStats(CachedPlanSource *plansource)
+{
+	PlanStatsKey key;
+	PlanStatsEntry *entry;
+
+	if (!plansource->is_saved)
+		return;					/* maybe once it is saved */
+	plansource->shared_stats_checked = true;
+
+	/* Don't overwrite what we've learned ourselves */
+	if (!plan_stats_shareable(plansource) ||
+		plansource->num_custom_plans > 0 || plansource->generic_cost >= 0)
+		return;
+
+	plan_stats_key(plansource, &key);
+
+	LWLockAcquire(PlanCacheStatsLock, LW_SHARED);
+	entry = (PlanStatsEntry *) hash_search(SharedPlanStats, &key,
+										   HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		plansource->generic_cost = entry->generic_cost;
+		plansource->total_custom_cost = entry->total_custom_cost;
+		plansource->num_custom_plans = entry->num_custom_plans;
+	}
+	LWLockRelease(PlanCacheStatsLock);
+}
+
+/*
+ * Store a plan source's cost statistics in the shared table, after it has
+ * been planned.  Entries are never removed; once the table is full, new
+ * statements just aren't shared.
+ */
+static void
+PutSharedPlanStats(CachedPlanSource *plansource)
+{
+	PlanStatsKey key;
+	PlanStatsEntry *entry;
+	bool		found;
+
+	if (!plan_stats_shareable(plansource))
+		return;
+
+	plan_stats_key(plansource, &key);
+
+	LWLockAcquire(PlanCacheStatsLock, LW_EXCLUSIVE);
+	entry = (PlanStatsEntry *) hash_search(SharedPlanStats, &key,
+										   HASH_FIND, NULL);
+	if (entry == NULL &&
+		hash_get_num_entries(SharedPlanStats) < plan_cache_shared_stats)
+	{
+		entry = (PlanStatsEntry *) hash_search(SharedPlanStats, &key,
+											   HASH_ENTER_NULL, &found);
+		if (entry != NULL)
+		{
+			entry->generic_cost = -1;
+			entry->total_custom_cost = 0;
+			entry->num_custom_plans = 0;
+		}
+	}
+
+	if (entry != NULL)
+	{
+		/*
+		 * Keep whichever custom plan history is longer; a backend that
+		 * started from the shared entry has seen all of it and more.  A
+		 * generic plan cost is always the most recent one.
+		 */
+		if (plansource->num_custom_plans >= entry->num_custom_plans)
+		{
+			entry->total_custom_cost = plansource->total_custom_cost;
+			entry->num_custom_plans = plansource->num_custom_plans;
+		}
+		if (plansource->generic_cost >= 0)
+			entry->generic_cost = plansource->generic_cost;
+	}
+	LWLockRelease(PlanCacheStatsLock);
+}
+
 /*
  * GetCachedPlan: get a cached plan from a CachedPlanSource.
  *
@@ -935,6 +1160,10 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	/* Make sure the querytree list is valid and we have parse-time locks */
 	qlist = RevalidateCachedQuery(plansource);
 
+	/* Start from what other backends know about this statement, if anything */
+	if (!plansource->shared_stats_checked)
+		GetSharedPlanStats(plansource);
+
 	/* Decide whether to use a custom plan */
 	customplan = choose_custom_plan(plansource, boundParams);
 
@@ -969,7 +1198,8 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 									   MemoryContextGetParent(plansource->context));
 			}
 			/* Update generic_cost whenever we make a new generic plan */
-			plansource->generic_cost = cached_plan_cost(plan);
+			plansource->generic_cost = cached_plan_cost(plan, false);
+			PutSharedPlanStats(plansource);
 
 			/*
 			 * If, based on the now-known value of generic_cost, we'd not have
@@ -998,8 +1228,9 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 		/* Accumulate total costs of custom plans, but 'ware overflow */
 		if (plansource->num_custom_plans < INT_MAX)
 		{
-			plansource->total_custom_cost += cached_plan_cost(plan);
+			plansource->total_custom_cost += cached_plan_cost(plan, true);
 			plansource->num_custom_plans++;
+			PutSharedPlanStats(plansource);
 		}
 	}
 
@@ -1161,6 +1392,7 @@ CopyCachedPlan(CachedPlanSource *plansource)
 	newsource->generic_cost = plansource->generic_cost;
 	newsource->total_custom_cost = plansource->total_custom_cost;
 	newsource->num_custom_plans = plansource->num_custom_plans;
+	newsource->shared_stats_checked = plansource->shared_stats_checked;
 
 	MemoryContextSwitchTo(oldcxt);
 
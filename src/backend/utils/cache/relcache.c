@@ -38,6 +38,7 @@
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
+#include "catalog/partition.h"
 #include "catalog/pg_amproc.h"
 #include "catalog/pg_attrdef.h"
 #include "catalog/pg_authid.h"
@@ -48,6 +49,7 @@
 #include "catalog/pg_opclass.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_rewrite.h"
+#include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_tablespace.h"
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
@@ -64,6 +66,7 @@
 #include "storage/smgr.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
@@ -107,6 +110,21 @@ typedef struct relidcacheent
 
 static HTAB *RelationIdCache;
 
+/*
+ * All the entries of RelationIdCache are also kept in this list, in LRU
+ * order, most recently used first.  When max_relcache_entries is exceeded,
+ * unreferenced entries are evicted starting from the tail.
+ */
+static Dllist RelationLRUList;
+
+/* GUC parameter: limit on the number of relcache entries, or 0 for none */
+int			max_relcache_entries = 0;
+
+/* Statistics for RelationCacheGetStats */
+static int64 relcacheHits = 0;
+static int64 relcacheMisses = 0;
+static int64 relcacheEvictions = 0;
+
 /*
  * This flag is false until we have prepared the critical relcache entries
  * that are needed to do indexscans on the tables read by relcache building.
@@ -151,7 +169,15 @@ do { \
 										   (void *) &(RELATION->rd_id), \
 										   HASH_ENTER, &found); \
 	/* used to give notice if found -- now just keep quiet */ \
+	if (found && idhentry->reldesc != (RELATION) && \
+		DLGetListHdr(&idhentry->reldesc->rd_lruelem) != NULL) \
+		DLRemove(&idhentry->reldesc->rd_lruelem); \
 	idhentry->reldesc = RELATION; \
+	if (DLGetListHdr(&(RELATION)->rd_lruelem) == NULL) \
+	{ \
+		DLInitElem(&(RELATION)->rd_lruelem, (RELATION)); \
+		DLAddHead(&RelationLRUList, &(RELATION)->rd_lruelem); \
+	} \
 } while(0)
 
 #define RelationIdCacheLookup(ID, RELATION) \
@@ -174,6 +200,8 @@ do { \
 										   HASH_REMOVE, NULL); \
 	if (idhentry == NULL) \
 		elog(WARNING, "trying to delete a rd_id reldesc that does not exist"); \
+	if (DLGetListHdr(&(RELATION)->rd_lruelem) != NULL) \
+		DLRemove(&(RELATION)->rd_lruelem); \
 } while(0)
 
 
@@ -203,6 +231,7 @@ static void RelationClearRelation(Relation relation, bool rebuild);
 
 static void RelationReloadIndexInfo(Relation relation);
 static void RelationFlushRelation(Relation relation);
+static void RelationCacheEvict(void);
 static bool load_relcache_init_file(bool shared);
 static void write_relcache_init_file(bool shared);
 static void write_item(const void *data, Size len, FILE *fp);
@@ -375,6 +404,7 @@ RelationParseRelOptions(Relation relation, HeapTuple tuple)
 		case RELKIND_TOASTVALUE:
 		case RELKIND_INDEX:
 		case RELKIND_VIEW:
+		case RELKIND_MATVIEW:
 			break;
 		default:
 			return;
@@ -421,6 +451,7 @@ RelationBuildTupleDesc(Relation relation)
 	int			need;
 	TupleConstr *constr;
 	AttrDefault *attrdef = NULL;
+	AttrMissing *attrmiss = NULL;
 	int			ndef = 0;
 
 	/* copy some fields from pg_class row to rd_att */
@@ -493,6 +524,43 @@ RelationBuildTupleDesc(Relation relation)
 			attrdef[ndef].adbin = NULL;
 			ndef++;
 		}
+
+		/* Likewise for the value of the attribute in older tuples */
+		if (attp->atthasmissing)
+		{
+			Datum		missingval;
+			bool		missingNull;
+
+			missingval = heap_getattr(pg_attribute_tuple,
+									  Anum_pg_attribute_attmissingval,
+									  pg_attribute_desc->rd_att,
+									  &missingNull);
+			if (!missingNull)
+			{
+				MemoryContext oldcxt;
+				Datum		value;
+				bool		isnull;
+				int			one = 1;
+
+				if (attrmiss == NULL)
+					attrmiss = (AttrMissing *)
+						MemoryContextAllocZero(CacheMemoryContext,
+											   relation->rd_rel->relnatts *
+											   sizeof(AttrMissing));
+
+				value = array_ref(DatumGetArrayTypeP(missingval),
+								  1, &one, -1,
+								  attp->attlen, attp->attbyval,
+								  attp->attalign, &isnull);
+				Assert(!isnull);
+
+				oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+				attrmiss[attp->attnum - 1].am_present = true;
+				attrmiss[attp->attnum - 1].am_value =
+					datumCopy(value, attp->attbyval, attp->attlen);
+				MemoryContextSwitchTo(oldcxt);
+			}
+		}
 		need--;
 		if (need == 0)
 			break;
@@ -533,9 +601,11 @@ RelationBuildTupleDesc(Relation relation)
 	/*
 	 * Set up constraint/default info
 	 */
-	if (constr->has_not_null || ndef > 0 || relation->rd_rel->relchecks)
+	if (constr->has_not_null || ndef > 0 || attrmiss ||
+		relation->rd_rel->relchecks)
 	{
 		relation->rd_att->constr = constr;
+		constr->missing = attrmiss;
 
 		if (ndef > 0)			/* DEFAULTs */
 		{
@@ -1095,11 +1165,12 @@ RelationInitIndexAccessInfo(Relation relation)
 	/*
 	 * Fill the support procedure OID array, as well as the info about
 	 * opfamilies and opclass input types.	(aminfo and supportinfo are left
-	 * as zeroes, and are filled on-the-fly when used)
+	 * as zeroes, and are filled on-the-fly when used)  INCLUDE columns have
+	 * no opclass, so their entries stay zero.
 	 */
 	IndexSupportInitialize(indclass, relation->rd_support,
 						   relation->rd_opfamily, relation->rd_opcintype,
-						   amsupport, natts);
+						   amsupport, relation->rd_index->indnkeyatts);
 
 	/*
 	 * Similarly extract indoption and copy it to the cache entry
@@ -1543,6 +1614,8 @@ RelationIdGetRelation(Oid relationId)
 
 	if (RelationIsValid(rd))
 	{
+		relcacheHits++;
+		DLMoveToFront(&rd->rd_lruelem);
 		RelationIncrementReferenceCount(rd);
 		/* revalidate cache entry if necessary */
 		if (!rd->rd_isvalid)
@@ -1562,14 +1635,86 @@ RelationIdGetRelation(Oid relationId)
 
 	/*
 	 * no reldesc in the cache, so have RelationBuildDesc() build one and add
-	 * it.
+	 * it; first make room for it, if the cache is limited in size.
 	 */
+	relcacheMisses++;
+	if (max_relcache_entries > 0 &&
+		hash_get_num_entries(RelationIdCache) >= max_relcache_entries)
+		RelationCacheEvict();
+
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
 		RelationIncrementReferenceCount(rd);
 	return rd;
 }
 
+/*
+ * RelationCacheEvict
+ *
+ *		Remove least recently used entries until there is room for one more
+ *		entry under max_relcache_entries.
+ *
+ * Only entries that a cache flush would destroy too are candidates: those
+ * with zero refcount that are neither nailed nor carry state of the current
+ * transaction.  Anyone holding a pointer to such an entry must already be
+ * prepared for it to disappear at the next invalidation.  Entries we have
+ * to skip are moved to the front of the list, so that later calls do not
+ * scan past them again; each entry is looked at most once, so if too many
+ * are in use we stay over the limit.
+ *
+ * Until the critical relcache entries are built, the startup code walks the
+ * hashtable while building entries, so we leave the cache alone then.
+ */
+static void
+RelationCacheEvict(void)
+{
+	Dlelem	   *elt;
+	Dlelem	   *prevelt;
+	long		nvisit;
+
+	if (!criticalRelcachesBuilt || IsBootstrapProcessingMode())
+		return;
+
+	nvisit = hash_get_num_entries(RelationIdCache);
+	for (elt = DLGetTail(&RelationLRUList);
+		 elt != NULL && nvisit-- > 0 &&
+		 hash_get_num_entries(RelationIdCache) >= max_relcache_entries;
+		 elt = prevelt)
+	{
+		Relation	relation = (Relation) DLE_VAL(elt);
+
+		prevelt = DLGetPred(elt);
+
+		if (!RelationHasReferenceCountZero(relation) ||
+			relation->rd_isnailed ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+		{
+			DLMoveToFront(elt);
+			continue;
+		}
+
+		RelationClearRelation(relation, false);
+		relcacheEvictions++;
+	}
+}
+
+/*
+ * RelationCacheGetStats
+ *
+ *		Report the number of relcache entries, and the hit, miss and
+ *		eviction counts of RelationIdGetRelation since backend start.
+ */
+void
+RelationCacheGetStats(int64 *entries, int64 *hits, int64 *misses,
+					  int64 *evictions)
+{
+	*entries = RelationIdCache ? hash_get_num_entries(RelationIdCache) : 0;
+	*hits = relcacheHits;
+	*misses = relcacheMisses;
+	*evictions = relcacheEvictions;
+}
+
 /* ----------------------------------------------------------------
  *				cache invalidation support routines
  * ----------------------------------------------------------------
@@ -1773,6 +1918,7 @@ RelationDestroyRelation(Relation relation)
 		FreeTupleDesc(relation->rd_att);
 	list_free(relation->rd_indexlist);
 	bms_free(relation->rd_indexattr);
+	list_free_deep(relation->rd_extstats);
 	FreeTriggerDesc(relation->trigdesc);
 	if (relation->rd_options)
 		pfree(relation->rd_options);
@@ -1784,6 +1930,8 @@ RelationDestroyRelation(Relation relation)
 		MemoryContextDelete(relation->rd_indexcxt);
 	if (relation->rd_rulescxt)
 		MemoryContextDelete(relation->rd_rulescxt);
+	if (relation->rd_partcxt)
+		MemoryContextDelete(relation->rd_partcxt);
 	pfree(relation);
 }
 
@@ -1963,6 +2111,8 @@ RelationClearRelation(Relation relation, bool rebuild)
 		SWAPFIELD(SMgrRelation, rd_smgr);
 		/* rd_refcnt must be preserved */
 		SWAPFIELD(int, rd_refcnt);
+		/* so must the LRU list links, which point at the old entry */
+		SWAPFIELD(Dlelem, rd_lruelem);
 		/* isnailed shouldn't change */
 		Assert(newrel->rd_isnailed == relation->rd_isnailed);
 		/* creation sub-XIDs must be preserved */
@@ -2732,6 +2882,7 @@ RelationCacheInitialize(void)
 	ctl.hash = oid_hash;
 	RelationIdCache = hash_create("Relcache by OID", INITRELCACHESIZE,
 								  &ctl, HASH_ELEM | HASH_FUNCTION);
+	DLInitList(&RelationLRUList);
 
 	/*
 	 * relation mapper needs to be initialized too
@@ -3360,7 +3511,7 @@ RelationGetIndexList(Relation relation)
 			index->indisunique && index->indimmediate &&
 			index->indkey.values[0] == ObjectIdAttributeNumber &&
 			index->indclass.values[0] == OID_BTREE_OPS_OID &&
-			heap_attisnull(htup, Anum_pg_index_indpred))
+			heap_attisnull(htup, Anum_pg_index_indpred, NULL))
 			oidIndex = index->indexrelid;
 	}
 
@@ -3501,7 +3652,7 @@ RelationGetIndexExpressions(Relation relation)
 
 	/* Quick exit if there is nothing to do. */
 	if (relation->rd_indextuple == NULL ||
-		heap_attisnull(relation->rd_indextuple, Anum_pg_index_indexprs))
+		heap_attisnull(relation->rd_indextuple, Anum_pg_index_indexprs, NULL))
 		return NIL;
 
 	/*
@@ -3568,7 +3719,7 @@ RelationGetIndexPredicate(Relation relation)
 
 	/* Quick exit if there is nothing to do. */
 	if (relation->rd_indextuple == NULL ||
-		heap_attisnull(relation->rd_indextuple, Anum_pg_index_indpred))
+		heap_attisnull(relation->rd_indextuple, Anum_pg_index_indpred, NULL))
 		return NIL;
 
 	/*
@@ -3707,6 +3858,105 @@ RelationGetIndexAttrBitmap(Relation relation)
 	return indexattrs;
 }
 
+/*
+ * RelationGetExtStatistics -- get the statistics for a table's column groups
+ *
+ * The result is a list of ExtStatistics, one per pg_statistic_ext row for
+ * the relation.  Unlike RelationGetIndexList, the list is not a copy: it
+ * lives in the relcache entry and goes away at the next invalidation of it,
+ * so callers that need it for longer must copy what they want.
+ */
+List *
+RelationGetExtStatistics(Relation relation)
+{
+	Relation	sd;
+	SysScanDesc scan;
+	ScanKeyData skey;
+	HeapTuple	htup;
+	List	   *result = NIL;
+	MemoryContext oldcxt;
+
+	/* Quick exit if we already computed the list. */
+	if (relation->rd_extstatvalid)
+		return relation->rd_extstats;
+
+	ScanKeyInit(&skey,
+				Anum_pg_statistic_ext_starelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(RelationGetRelid(relation)));
+
+	sd = heap_open(StatisticExtRelationId, AccessShareLock);
+	scan = systable_beginscan(sd, StatisticExtRelidIndexId, true,
+							  SnapshotNow, 1, &skey);
+
+	while (HeapTupleIsValid(htup = systable_getnext(scan)))
+	{
+		Form_pg_statistic_ext form = (Form_pg_statistic_ext) GETSTRUCT(htup);
+		ExtStatistics *stat;
+		Datum		datum;
+		bool		isnull;
+
+		if (form->stakeys.dim1 < STATISTIC_EXT_MIN_COLUMNS ||
+			form->stakeys.dim1 > STATISTIC_EXT_MAX_COLUMNS)
+			elog(ERROR, "invalid pg_statistic_ext entry for relation %u",
+				 RelationGetRelid(relation));
+
+		stat = (ExtStatistics *) MemoryContextAllocZero(CacheMemoryContext,
+													  sizeof(ExtStatistics));
+		stat->nkeys = form->stakeys.dim1;
+		memcpy(stat->keys, form->stakeys.values, stat->nkeys * sizeof(int2));
+		stat->ndistinct = form->stadistinct;
+
+		datum = heap_getattr(htup, Anum_pg_statistic_ext_stadependencies,
+							 RelationGetDescr(sd), &isnull);
+		if (!isnull)
+		{
+			ArrayType  *arr = DatumGetArrayTypeP(datum);
+
+			if (ARR_NDIM(arr) != 1 ||
+				ARR_DIMS(arr)[0] != stat->nkeys * stat->nkeys ||
+				ARR_HASNULL(arr) ||
+				ARR_ELEMTYPE(arr) != FLOAT4OID)
+				elog(ERROR, "stadependencies is not a 1-D float4 array of the right size");
+			memcpy(stat->dependencies, ARR_DATA_PTR(arr),
+				   stat->nkeys * stat->nkeys * sizeof(float4));
+			stat->has_dependencies = true;
+		}
+
+		oldcxt = MemoryContextSwitchTo(CacheMemoryContext);
+		result = lappend(result, stat);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	systable_endscan(scan);
+	heap_close(sd, AccessShareLock);
+
+	relation->rd_extstats = result;
+	relation->rd_extstatvalid = true;
+
+	return result;
+}
+
+/*
+ * RelationGetPartitionDesc -- get the partition descriptor of a parent table
+ *
+ * The result is NULL if the table has no children, or they aren't laid out
+ * in ranges of a key column; see catalog/partition.c.  Like the result of
+ * RelationGetExtStatistics, it goes away at the next invalidation of the
+ * relcache entry, which acquiring a lock can cause.
+ */
+PartitionDesc
+RelationGetPartitionDesc(Relation relation)
+{
+	if (!relation->rd_partdescvalid)
+	{
+		RelationBuildPartitionDesc(relation);
+		relation->rd_partdescvalid = true;
+	}
+
+	return relation->rd_partdesc;
+}
+
 /*
  * RelationGetExclusionInfo -- get info about index's exclusion constraint
  *
@@ -4161,6 +4411,7 @@ load_relcache_init_file(bool shared)
 		 * Reset transient-state fields in the relcache entry
 		 */
 		rel->rd_smgr = NULL;
+		DLInitElem(&rel->rd_lruelem, rel);
 		if (rel->rd_isnailed)
 			rel->rd_refcnt = 1;
 		else
@@ -4169,9 +4420,15 @@ load_relcache_init_file(bool shared)
 		rel->rd_indexlist = NIL;
 		rel->rd_indexattr = NULL;
 		rel->rd_oidindex = InvalidOid;
+		rel->rd_extstatvalid = false;
+		rel->rd_extstats = NIL;
+		rel->rd_partdescvalid = false;
+		rel->rd_partdesc = NULL;
+		rel->rd_partcxt = NULL;
 		rel->rd_createSubid = InvalidSubTransactionId;
 		rel->rd_newRelfilenodeSubid = InvalidSubTransactionId;
 		rel->rd_amcache = NULL;
+		rel->rd_tableam = NULL;
 		MemSet(&rel->pgstat_info, 0, sizeof(rel->pgstat_info));
 
 		/*
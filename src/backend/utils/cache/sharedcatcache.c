@@ -0,0 +1,390 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Shared-memory cache of system catalog tuples.
+ *
+ * Each backend's catcaches start out empty, so the first queries of a new
+ * session spend much of their time reading the catalogs.  When
+ * shared_catcache_entries is set, catcache misses are first looked up in
+ * this cache, which holds copies of catalog tuples that other backends
+ * have read, so that a new session mostly copies tuples from shared memory
+ * instead of scanning catalog indexes.
+ *
+ * The cache is a set-associative table: a tuple's database, cache ID and
+ * hash value select a bucket of SHARED_CATCACHE_WAYS slots, and within a
+ * bucket slots are replaced by a clock sweep.  Tuples longer than
+ * SHARED_CATCACHE_TUPLE_SIZE are not shared.  Only positive entries are
+ * shared; negative entries and CatCLists stay backend-local.
+ *
+ * Entries are removed when the invalidation messages for them are sent,
+ * in SendSharedInvalidMessages, which happens only after the changes they
+ * describe have become visible; so any catalog scan that starts later
+ * sees the new tuple.  A scan that started earlier may have read the old
+ * one and still try to enter it, so every removal also advances its
+ * bucket's generation count, and an insertion is refused unless the
+ * generation is the same as when the lookup that preceded the scan found
+ * nothing.  A backend whose own transaction has changed the catalogs
+ * bypasses the cache until the transaction ends, since it must see its
+ * own uncommitted changes, and so does a backend in recovery, where the
+ * invalidations are sent by the startup process without any coordination
+ * with the catcache misses of other backends.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/valid.h"
+#include "access/xlog.h"
+#include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/catcache.h"
+#include "utils/hashutils.h"
+#include "utils/inval.h"
+
+
+/* number of slots in each bucket */
+#define SHARED_CATCACHE_WAYS		4
+
+/* longest tuple stored */
+#define SHARED_CATCACHE_TUPLE_SIZE	512
+
+typedef struct SharedCatCacheSlot
+{
+	Oid			dbId;			/* database, or InvalidOid if shared catalog */
+	int			cacheId;		/* catcache ID, or -1 if slot is unused */
+	uint32		hashValue;		/* hash value of the tuple's keys */
+	bool		recent;			/* used since the last clock sweep? */
+	uint32		len;			/* length of the tuple */
+	ItemPointerData self;		/* the tuple's TID */
+	Oid			tableOid;		/* the catalog it came from */
+	union
+	{
+		HeapTupleHeaderData hdr;	/* the tuple itself */
+		double		force_align_d;
+		char		data[SHARED_CATCACHE_TUPLE_SIZE];
+	}			tuple;
+} SharedCatCacheSlot;
+
+typedef struct SharedCatCacheBucket
+{
+	uint32		generation;		/* advanced by each removal */
+	int			nextvictim;		/* clock hand */
+	SharedCatCacheSlot slots[SHARED_CATCACHE_WAYS];
+} SharedCatCacheBucket;
+
+/* GUC parameter */
+int			shared_catcache_entries = 0;
+
+/* The buckets, or NULL when the cache is disabled */
+static SharedCatCacheBucket *SharedCatCache = NULL;
+static int	SharedCatCacheNumBuckets = 0;
+
+#define SharedCatCachePartitionLock(bucketno) \
+	((LWLockId) (FirstSharedCatCacheLock + \
+				 ((bucketno) % NUM_SHARED_CATCACHE_PARTITIONS)))
+
+
+/*
+ * Pick the bucket for a tuple.
+ */
+static inline int
+shared_catcache_bucket(Oid dbId, int cacheId, uint32 hashValue)
+{
+	uint32		h;
+
+	h = murmurhash32(hashValue ^ murmurhash32(dbId ^ ((uint32) cacheId << 24)));
+	return (int) (h % (uint32) SharedCatCacheNumBuckets);
+}
+
+/*
+ * The database that the tuples of a catcache belong to.
+ */
+static inline Oid
+shared_catcache_dbid(CatCache *cache)
+{
+	return cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+}
+
+/*
+ * SharedCatCacheShmemSize
+ *		Compute space needed for the shared catalog cache
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	int			nbuckets;
+
+	if (shared_catcache_entries <= 0)
+		return 0;
+	nbuckets = (shared_catcache_entries + SHARED_CATCACHE_WAYS - 1) /
+		SHARED_CATCACHE_WAYS;
+	return mul_size(nbuckets, sizeof(SharedCatCacheBucket));
+}
+
+/*
+ * SharedCatCacheShmemInit
+ *		Create or attach to the shared catalog cache
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	bool		found;
+
+	if (shared_catcache_entries <= 0)
+		return;
+
+	SharedCatCacheNumBuckets = (shared_catcache_entries +
+								SHARED_CATCACHE_WAYS - 1) /
+		SHARED_CATCACHE_WAYS;
+	SharedCatCache = (SharedCatCacheBucket *)
+		ShmemInitStruct("Shared Catalog Cache",
+						SharedCatCacheShmemSize(),
+						&found);
+
+	if (!found)
+	{
+		int			i;
+		int			j;
+
+		for (i = 0; i < SharedCatCacheNumBuckets; i++)
+		{
+			SharedCatCacheBucket *bucket = &SharedCatCache[i];
+
+			bucket->generation = 0;
+			bucket->nextvictim = 0;
+			for (j = 0; j < SHARED_CATCACHE_WAYS; j++)
+				bucket->slots[j].cacheId = -1;
+		}
+	}
+}
+
+/*
+ * SharedCatCacheUsable
+ *		Should misses in the given catcache consult the shared cache?
+ */
+bool
+SharedCatCacheUsable(CatCache *cache)
+{
+	if (SharedCatCache == NULL)
+		return false;
+	if (IsBootstrapProcessingMode() || RecoveryInProgress())
+		return false;
+	/* the tuples of database-local catalogs are known by database */
+	if (!cache->cc_relisshared && !OidIsValid(MyDatabaseId))
+		return false;
+	/* we must see our own uncommitted catalog changes */
+	if (TransactionHasPendingInvalidations())
+		return false;
+	return true;
+}
+
+/*
+ * SharedCatCacheLookup
+ *		Look for a tuple matching the given keys
+ *
+ * Returns a palloc'd copy of the tuple, or NULL if it is not cached.  In
+ * the latter case *generation is set to the generation to pass to
+ * SharedCatCacheInsert if the caller goes on to read the tuple from the
+ * catalog.
+ */
+HeapTuple
+SharedCatCacheLookup(CatCache *cache, uint32 hashValue, ScanKey cur_skey,
+					 uint32 *generation)
+{
+	Oid			dbId = shared_catcache_dbid(cache);
+	int			bucketno = shared_catcache_bucket(dbId, cache->id, hashValue);
+	SharedCatCacheBucket *bucket = &SharedCatCache[bucketno];
+	HeapTuple	result = NULL;
+	int			i;
+
+	LWLockAcquire(SharedCatCachePartitionLock(bucketno), LW_SHARED);
+
+	for (i = 0; i < SHARED_CATCACHE_WAYS; i++)
+	{
+		SharedCatCacheSlot *slot = &bucket->slots[i];
+		HeapTupleData tuple;
+		bool		res;
+
+		if (slot->cacheId != cache->id ||
+			slot->hashValue != hashValue ||
+			slot->dbId != dbId)
+			continue;
+
+		tuple.t_len = slot->len;
+		tuple.t_self = slot->self;
+		tuple.t_tableOid = slot->tableOid;
+		tuple.t_data = &slot->tuple.hdr;
+
+		HeapKeyTest(&tuple,
+					cache->cc_tupdesc,
+					cache->cc_nkeys,
+					cur_skey,
+					res);
+		if (!res)
+			continue;
+
+		/*
+		 * Setting the flag with only a shared lock is a benign race: at
+		 * worst a concurrent sweep clears it just after we set it.
+		 */
+		slot->recent = true;
+		result = heap_copytuple(&tuple);
+		break;
+	}
+
+	*generation = bucket->generation;
+
+	LWLockRelease(SharedCatCachePartitionLock(bucketno));
+
+	return result;
+}
+
+/*
+ * SharedCatCacheInsert
+ *		Enter a tuple just read from the catalog into the shared cache
+ *
+ * generation is what SharedCatCacheLookup returned before the catalog was
+ * read; if the bucket has had removals since, the tuple may be stale and
+ * is not entered.
+ */
+void
+SharedCatCacheInsert(CatCache *cache, uint32 hashValue, HeapTuple tuple,
+					 uint32 generation)
+{
+	Oid			dbId = shared_catcache_dbid(cache);
+	int			bucketno;
+	SharedCatCacheBucket *bucket;
+	SharedCatCacheSlot *slot = NULL;
+	int			i;
+
+	if (tuple->t_len > SHARED_CATCACHE_TUPLE_SIZE)
+		return;
+
+	bucketno = shared_catcache_bucket(dbId, cache->id, hashValue);
+	bucket = &SharedCatCache[bucketno];
+
+	LWLockAcquire(SharedCatCachePartitionLock(bucketno), LW_EXCLUSIVE);
+
+	if (bucket->generation != generation)
+	{
+		LWLockRelease(SharedCatCachePartitionLock(bucketno));
+		return;
+	}
+
+	/*
+	 * Replace an entry for the same keys, which another backend may have
+	 * entered meanwhile; else take a free slot; else sweep for a victim.
+	 * Two different keys with the same hash value also end up in the same
+	 * slot, which only costs the loser a miss.
+	 */
+	for (i = 0; i < SHARED_CATCACHE_WAYS; i++)
+	{
+		SharedCatCacheSlot *s = &bucket->slots[i];
+
+		if (s->cacheId == cache->id &&
+			s->hashValue == hashValue &&
+			s->dbId == dbId)
+		{
+			slot = s;
+			break;
+		}
+		if (s->cacheId < 0 && slot == NULL)
+			slot = s;
+	}
+	while (slot == NULL)
+	{
+		SharedCatCacheSlot *s = &bucket->slots[bucket->nextvictim];
+
+		bucket->nextvictim = (bucket->nextvictim + 1) % SHARED_CATCACHE_WAYS;
+		if (s->recent)
+			s->recent = false;
+		else
+			slot = s;
+	}
+
+	slot->dbId = dbId;
+	slot->cacheId = cache->id;
+	slot->hashValue = hashValue;
+	slot->recent = false;
+	slot->len = tuple->t_len;
+	slot->self = tuple->t_self;
+	slot->tableOid = tuple->t_tableOid;
+	memcpy(slot->tuple.data, tuple->t_data, tuple->t_len);
+
+	LWLockRelease(SharedCatCachePartitionLock(bucketno));
+}
+
+/*
+ * SharedCatCacheInvalidate
+ *		Remove the entries for a catcache invalidation message
+ */
+void
+SharedCatCacheInvalidate(Oid dbId, int cacheId, uint32 hashValue)
+{
+	int			bucketno;
+	SharedCatCacheBucket *bucket;
+	int			i;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	bucketno = shared_catcache_bucket(dbId, cacheId, hashValue);
+	bucket = &SharedCatCache[bucketno];
+
+	LWLockAcquire(SharedCatCachePartitionLock(bucketno), LW_EXCLUSIVE);
+
+	bucket->generation++;
+	for (i = 0; i < SHARED_CATCACHE_WAYS; i++)
+	{
+		SharedCatCacheSlot *slot = &bucket->slots[i];
+
+		if (slot->cacheId == cacheId &&
+			slot->hashValue == hashValue &&
+			slot->dbId == dbId)
+			slot->cacheId = -1;
+	}
+
+	LWLockRelease(SharedCatCachePartitionLock(bucketno));
+}
+
+/*
+ * SharedCatCacheFlush
+ *		Remove all entries
+ *
+ * This is used when a whole catalog is invalidated, which happens rarely
+ * enough that it's not worth working out which entries came from it, and
+ * when a database is dropped, so that a later database that happens to get
+ * the same OID doesn't find its entries.
+ */
+void
+SharedCatCacheFlush(void)
+{
+	int			i;
+	int			j;
+
+	if (SharedCatCache == NULL)
+		return;
+
+	for (i = 0; i < NUM_SHARED_CATCACHE_PARTITIONS; i++)
+		LWLockAcquire(FirstSharedCatCacheLock + i, LW_EXCLUSIVE);
+
+	for (i = 0; i < SharedCatCacheNumBuckets; i++)
+	{
+		SharedCatCacheBucket *bucket = &SharedCatCache[i];
+
+		bucket->generation++;
+		for (j = 0; j < SHARED_CATCACHE_WAYS; j++)
+			bucket->slots[j].cacheId = -1;
+	}
+
+	for (i = NUM_SHARED_CATCACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(FirstSharedCatCacheLock + i);
+}
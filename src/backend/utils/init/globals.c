@@ -29,6 +29,7 @@ ProtocolVersion FrontendProtocol;
 volatile bool InterruptPending = false;
 volatile bool QueryCancelPending = false;
 volatile bool ProcDiePending = false;
+volatile bool LogMemoryContextPending = false;
 volatile bool ClientConnectionLost = false;
 volatile bool ImmediateInterruptOK = false;
 volatile uint32 InterruptHoldoffCount = 0;
@@ -81,11 +82,14 @@ pid_t		PostmasterPid = 0;
  * regular backends.  These should be set correctly as early as possible
  * in the execution of a process, so that error handling will do the right
  * things if an error should occur during process initialization.
+ * IsBackgroundWorker is true in background worker processes registered by
+ * loadable modules (see postmaster/bgworker.h).
  *
  * These are initialized for the bootstrap/standalone case.
  */
 bool		IsPostmasterEnvironment = false;
 bool		IsUnderPostmaster = false;
+bool		IsBackgroundWorker = false;
 bool		IsBinaryUpgrade = false;
 
 bool		ExitOnAnyError = false;
@@ -103,12 +107,13 @@ int			maintenance_work_mem = 16384;
 
 /*
  * Primary determinants of sizes of shared-memory structures.  MaxBackends is
- * MaxConnections + autovacuum_max_workers + 1 (it is computed by the GUC
- * assign hooks for those variables):
+ * MaxConnections + autovacuum_max_workers + 1 + max_worker_processes (it is
+ * computed by the GUC assign hooks for those variables):
  */
 int			NBuffers = 1000;
 int			MaxBackends = 100;
 int			MaxConnections = 90;
+int			max_worker_processes = 8;
 
 int			VacuumCostPageHit = 1;		/* GUC parameters for vacuum */
 int			VacuumCostPageMiss = 10;
@@ -124,6 +129,7 @@ int			VacuumCostBalance = 0;		/* working state for vacuum */
 bool		VacuumCostActive = false;
 
 int			GinFuzzySearchLimit = 0;
+int			GinPendingListLimit = 4096;
 
 /*
  * Hook on object accesses.  This is intended as infrastructure for security
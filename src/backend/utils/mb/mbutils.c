@@ -594,6 +594,14 @@ pg_any_to_server(const char *s, int len, int encoding)
 		return (char *) s;
 	}
 
+	/*
+	 * Plain ASCII is the same in the server encoding as in any ASCII-safe
+	 * encoding, so if that's all we have, which is common enough, we can
+	 * skip calling the conversion function and copying the string.
+	 */
+	if (PG_VALID_BE_ENCODING(encoding) && pg_ascii_prefix_len(s, len) == len)
+		return (char *) s;
+
 	if (ClientEncoding->encoding == encoding)
 		return perform_default_encoding_conversion(s, len, true);
 	else
@@ -710,6 +718,28 @@ pg_encoding_mb2wchar_with_len(int encoding,
 	return (*pg_wchar_table[encoding].mb2wchar_with_len) ((const unsigned char *) from, to, len);
 }
 
+/* convert a wchar string to a multibyte */
+int
+pg_wchar2mb(const pg_wchar *from, char *to)
+{
+	return (*pg_wchar_table[DatabaseEncoding->encoding].wchar2mb_with_len) (from, (unsigned char *) to, pg_wchar_strlen(from));
+}
+
+/* convert a wchar string to a multibyte with a limited length */
+int
+pg_wchar2mb_with_len(const pg_wchar *from, char *to, int len)
+{
+	return (*pg_wchar_table[DatabaseEncoding->encoding].wchar2mb_with_len) (from, (unsigned char *) to, len);
+}
+
+/* same, with any encoding */
+int
+pg_encoding_wchar2mb_with_len(int encoding,
+							  const pg_wchar *from, char *to, int len)
+{
+	return (*pg_wchar_table[encoding].wchar2mb_with_len) (from, (unsigned char *) to, len);
+}
+
 /* returns the byte length of a multibyte character */
 int
 pg_mblen(const char *mbstr)
@@ -26,19 +26,27 @@
 #include <syslog.h>
 #endif
 
+#include "access/clog.h"
+#include "access/genam.h"
 #include "access/gin.h"
+#include "access/multixact.h"
+#include "access/nbtree.h"
+#include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
 #include "access/xact.h"
+#include "access/xlogutils.h"
 #include "catalog/namespace.h"
 #include "commands/async.h"
 #include "commands/prepare.h"
+#include "commands/sequence.h"
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "commands/trigger.h"
 #include "funcapi.h"
 #include "libpq/auth.h"
 #include "libpq/be-fsstubs.h"
+#include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "optimizer/cost.h"
@@ -53,19 +61,23 @@
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionproxy.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
 #include "replication/syncrep.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/standby.h"
 #include "storage/fd.h"
+#include "storage/pg_shmem.h"
 #include "storage/predicate.h"
 #include "tcop/tcopprot.h"
 #include "tsearch/ts_cache.h"
 #include "utils/builtins.h"
 #include "utils/bytea.h"
+#include "utils/catcache.h"
 #include "utils/guc_tables.h"
 #include "utils/memutils.h"
 #include "utils/pg_locale.h"
@@ -92,21 +104,14 @@
 #define CONFIG_EXEC_PARAMS_NEW "global/config_exec_params.new"
 #endif
 
-/* upper limit for GUC variables measured in kilobytes of memory */
-/* note that various places assume the byte size fits in a "long" variable */
-#if SIZEOF_SIZE_T > 4 && SIZEOF_LONG > 4
-#define MAX_KILOBYTES	INT_MAX
-#else
-#define MAX_KILOBYTES	(INT_MAX / 1024)
-#endif
-
 /*
  * Note: MAX_BACKENDS is limited to 2^23-1 because inval.c stores the
  * backend ID as a 3-byte signed integer.  Even if that limitation were
  * removed, we still could not exceed INT_MAX/4 because some places compute
  * 4*MaxBackends without any overflow check.  This is rechecked in
  * check_maxconnections, since MaxBackends is computed as MaxConnections
- * plus autovacuum_max_workers plus one (for the autovacuum launcher).
+ * plus autovacuum_max_workers plus one (for the autovacuum launcher) plus
+ * max_worker_processes.
  */
 #define MAX_BACKENDS	0x7fffff
 
@@ -125,14 +130,16 @@
 
 /* XXX these should appear in other modules' header files */
 extern bool Log_disconnections;
-extern int	CommitDelay;
-extern int	CommitSiblings;
 extern char *default_tablespace;
 extern char *temp_tablespaces;
 extern bool synchronize_seqscans;
 extern bool fullPageWrites;
 extern int	ssl_renegotiation_limit;
 extern char *SSLCipherSuites;
+extern char *SSLECDHCurve;
+extern bool SSLPreferServerCiphers;
+extern bool SSLSessionTickets;
+extern int	SSLSessionTimeout;
 
 #ifdef TRACE_SORT
 extern bool trace_sort;
@@ -181,6 +188,7 @@ static bool check_temp_buffers(int *newval, void **extra, GucSource source);
 static bool check_phony_autocommit(bool *newval, void **extra, GucSource source);
 static bool check_debug_assertions(bool *newval, void **extra, GucSource source);
 static bool check_bonjour(bool *newval, void **extra, GucSource source);
+static bool check_direct_io(int *newval, void **extra, GucSource source);
 static bool check_ssl(bool *newval, void **extra, GucSource source);
 static bool check_stage_log_stats(bool *newval, void **extra, GucSource source);
 static bool check_log_stats(bool *newval, void **extra, GucSource source);
@@ -199,9 +207,10 @@ static bool check_maxconnections(int *newval, void **extra, GucSource source);
 static void assign_maxconnections(int newval, void *extra);
 static bool check_autovacuum_max_workers(int *newval, void **extra, GucSource source);
 static void assign_autovacuum_max_workers(int newval, void *extra);
+static bool check_max_worker_processes(int *newval, void **extra, GucSource source);
+static void assign_max_worker_processes(int newval, void *extra);
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static void assign_effective_io_concurrency(int newval, void *extra);
-static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
 static void assign_application_name(const char *newval, void *extra);
 static const char *show_unix_socket_permissions(void);
@@ -386,6 +395,31 @@ static const struct config_enum_entry synchronous_commit_options[] = {
 	{NULL, 0, false}
 };
 
+/*
+ * Although only "on", "off", and "try" are documented, we
+ * accept all the likely variants of "on" and "off".
+ */
+static const struct config_enum_entry huge_pages_options[] = {
+	{"off", HUGE_PAGES_OFF, false},
+	{"on", HUGE_PAGES_ON, false},
+	{"try", HUGE_PAGES_TRY, false},
+	{"true", HUGE_PAGES_ON, true},
+	{"false", HUGE_PAGES_OFF, true},
+	{"yes", HUGE_PAGES_ON, true},
+	{"no", HUGE_PAGES_OFF, true},
+	{"1", HUGE_PAGES_ON, true},
+	{"0", HUGE_PAGES_OFF, true},
+	{NULL, 0, false}
+};
+
+static const struct config_enum_entry direct_io_options[] = {
+	{"off", 0, false},
+	{"data", DIRECT_IO_DATA, false},
+	{"wal", DIRECT_IO_WAL, false},
+	{"all", DIRECT_IO_DATA | DIRECT_IO_WAL, false},
+	{NULL, 0, false}
+};
+
 /*
  * Options for enum values stored in other modules
  */
@@ -431,14 +465,16 @@ int			temp_file_limit = -1;
 
 int			num_temp_buffers = 1024;
 
+int			huge_pages = HUGE_PAGES_TRY;
+int			huge_page_size = 0;
+bool		numa_interleave = false;
+
 char	   *data_directory;
 char	   *ConfigFileName;
 char	   *HbaFileName;
 char	   *IdentFileName;
 char	   *external_pid_file;
 
-char	   *pgstat_temp_directory;
-
 char	   *application_name;
 
 int			tcp_keepalives_idle;
@@ -737,6 +773,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_memoize", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of caching the results of nested-loop inner index scans."),
+			NULL
+		},
+		&enable_memoize,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_nestloop", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of nested-loop join plans."),
@@ -764,6 +809,24 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_incrementalsort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of incremental sort steps."),
+			NULL
+		},
+		&enable_incrementalsort,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_partitionwise_join", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of partition-wise join plans."),
+			NULL
+		},
+		&enable_partitionwise_join,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -794,6 +857,15 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		check_bonjour, NULL, NULL
 	},
+	{
+		{"session_pooling", PGC_BACKEND, CONN_AUTH_SETTINGS,
+			gettext_noop("Lets the session share backends with other sessions through the session proxy."),
+			gettext_noop("Only effective if session_pool_size is greater than zero.")
+		},
+		&SessionPooling,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"ssl", PGC_POSTMASTER, CONN_AUTH_SECURITY,
 			gettext_noop("Enables SSL connections."),
@@ -803,6 +875,24 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		check_ssl, NULL, NULL
 	},
+	{
+		{"ssl_prefer_server_ciphers", PGC_POSTMASTER, CONN_AUTH_SECURITY,
+			gettext_noop("Give priority to server ciphersuite order."),
+			NULL
+		},
+		&SSLPreferServerCiphers,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"ssl_session_tickets", PGC_POSTMASTER, CONN_AUTH_SECURITY,
+			gettext_noop("Lets SSL clients resume earlier sessions with session tickets."),
+			NULL
+		},
+		&SSLSessionTickets,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"fsync", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Forces synchronization of updates to disk."),
@@ -842,6 +932,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Compresses full-page writes written to WAL."),
+			NULL
+		},
+		&wal_compression,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"log_checkpoints", PGC_SIGHUP, LOGGING_WHAT,
 			gettext_noop("Logs each checkpoint."),
@@ -1017,6 +1116,33 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"defer_hint_bit_writes", PGC_USERSET, RESOURCES_BGWRITER,
+			gettext_noop("Leaves writing out pages changed only by hint bits to the background writer and checkpoints."),
+			gettext_noop("Server processes evicting such a page discard the hint bits instead of writing it.")
+		},
+		&defer_hint_bit_writes,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"temp_file_compression", PGC_USERSET, RESOURCES_DISK,
+			gettext_noop("Compresses the temporary files of hash join batches."),
+			NULL
+		},
+		&temp_file_compression,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"track_io_timing", PGC_SUSET, STATS_COLLECTOR,
+			gettext_noop("Collects timing statistics for database I/O activity."),
+			NULL
+		},
+		&track_io_timing,
+		false,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"update_process_title", PGC_SUSET, STATS_COLLECTOR,
@@ -1394,6 +1520,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"wal_receiver_compression", PGC_SIGHUP, REPLICATION_STANDBY,
+			gettext_noop("Asks the primary to compress the WAL it streams to this standby."),
+			gettext_noop("Takes effect the next time the WAL receiver connects.")
+		},
+		&wal_receiver_compression,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"allow_system_table_mods", PGC_POSTMASTER, DEVELOPER_OPTIONS,
 			gettext_noop("Allows modifications of the structure of system tables."),
@@ -1428,6 +1564,16 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"numa_interleave", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Interleaves shared memory across NUMA nodes."),
+			NULL
+		},
+		&numa_interleave,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"quote_all_identifiers", PGC_USERSET, COMPAT_OPTIONS_PREVIOUS,
 			gettext_noop("When generating SQL fragments, quote all identifiers."),
@@ -1502,6 +1648,17 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"join_search_limit", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the FROM-list size beyond which join orders "
+						 "are searched a few items at a time."),
+			gettext_noop("Larger joins are planned by repeatedly finding the "
+						 "best join of this many items. Zero disables this.")
+		},
+		&join_search_limit,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -1604,6 +1761,26 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"prefork_backends", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of server processes forked ahead of incoming connections."),
+			NULL
+		},
+		&PreforkBackends,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"session_pool_size", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the maximum number of backends shared by the pooled sessions of each database, user and set of startup options."),
+			gettext_noop("Zero disables session pooling.")
+		},
+		&SessionPoolSize,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We sometimes multiply the number of shared buffers by two without
 	 * checking for overflow, so we mustn't allow more than INT_MAX / 2.
@@ -1619,6 +1796,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"huge_page_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("The size of huge page that should be requested."),
+			gettext_noop("Zero means the kernel's default huge page size."),
+			GUC_UNIT_KB
+		},
+		&huge_page_size,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"temp_buffers", PGC_USERSET, RESOURCES_MEM,
 			gettext_noop("Sets the maximum number of temporary buffers used by each session."),
@@ -1693,6 +1881,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"client_send_buffer_size", PGC_SIGHUP, RESOURCES_MEM,
+			gettext_noop("Sets the size of the buffer for data sent to each client."),
+			gettext_noop("Data at least this large is sent without going through the buffer."),
+			GUC_UNIT_KB
+		},
+		&client_send_buffer_size,
+		64, 8, 65536,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -1709,6 +1908,78 @@ static struct config_int ConfigureNamesInt[] =
 		check_max_stack_depth, assign_max_stack_depth, NULL
 	},
 
+	{
+		{"max_catcache_entries", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum number of entries in the system catalog caches of a session."),
+			gettext_noop("Least recently used entries are evicted beyond this. "
+						 "Zero means no limit.")
+		},
+		&max_catcache_entries,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_relcache_entries", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum number of entries in the relation cache of a session."),
+			gettext_noop("Least recently used entries are evicted beyond this. "
+						 "Zero means no limit.")
+		},
+		&max_relcache_entries,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"shared_catcache_entries", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of system catalog rows cached in shared memory for all sessions."),
+			gettext_noop("Zero disables the shared catalog cache.")
+		},
+		&shared_catcache_entries,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"clog_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of shared memory buffers for the transaction status log."),
+			gettext_noop("Zero means to size it according to shared_buffers.")
+		},
+		&clog_buffers,
+		0, 0, 131072,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"subtrans_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of shared memory buffers for the subtransaction log."),
+			gettext_noop("Zero means to size it according to shared_buffers.")
+		},
+		&subtrans_buffers,
+		0, 0, 131072,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"multixact_offset_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of shared memory buffers for multixact offsets."),
+			gettext_noop("Zero means to size it according to shared_buffers.")
+		},
+		&multixact_offset_buffers,
+		0, 0, 131072,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"multixact_member_buffers", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the number of shared memory buffers for multixact members."),
+			gettext_noop("Zero means to size it according to shared_buffers.")
+		},
+		&multixact_member_buffers,
+		0, 0, 131072,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"temp_file_limit", PGC_SUSET, RESOURCES_DISK,
 			gettext_noop("Limits the total size of all temp files used by each session."),
@@ -1815,6 +2086,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"plan_cache_shared_stats", PGC_POSTMASTER, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of prepared statements whose plan choice statistics are shared between sessions."),
+			gettext_noop("Zero disables sharing.")
+		},
+		&plan_cache_shared_stats,
+		0, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 #ifdef LOCK_DEBUG
 	{
 		{"trace_lock_oidmin", PGC_SUSET, DEVELOPER_OPTIONS,
@@ -1838,6 +2119,17 @@ static struct config_int ConfigureNamesInt[] =
 	},
 #endif
 
+	{
+		{"btree_build_partitions", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Sets the number of parts a B-tree index build divides its table into."),
+			gettext_noop("Each part is scanned and sorted separately, and the results are merged."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&btree_build_partitions,
+		1, 1, 64,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"statement_timeout", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets the maximum allowed duration of any statement."),
@@ -1849,6 +2141,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_sequence_cache", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the maximum number of sequence values a session fetches at a time."),
+			gettext_noop("Sessions that call nextval() often fetch more values at a time, "
+						 "up to this number, than the sequence's CACHE setting.")
+		},
+		&max_sequence_cache,
+		1, 1, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"vacuum_freeze_min_age", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Minimum age at which VACUUM should freeze a table row."),
@@ -1891,7 +2194,7 @@ static struct config_int ConfigureNamesInt[] =
 		},
 		&max_locks_per_xact,
 		64, 10, INT_MAX,
-		NULL, NULL, NULL
+		NULL, assign_max_locks_per_xact, NULL
 	},
 
 	{
@@ -2045,7 +2348,9 @@ static struct config_int ConfigureNamesInt[] =
 			gettext_noop("Sets the number of digits displayed for floating-point values."),
 			gettext_noop("This affects real, double precision, and geometric data types. "
 			 "The parameter value is added to the standard number of digits "
-						 "(FLT_DIG or DBL_DIG as appropriate).")
+						 "(FLT_DIG or DBL_DIG as appropriate).  For real and double "
+						 "precision, any value greater than zero selects the shortest "
+						 "exact output instead.")
 		},
 		&extra_float_digits,
 		0, -15, 3,
@@ -2117,6 +2422,56 @@ static struct config_int ConfigureNamesInt[] =
 		check_effective_io_concurrency, assign_effective_io_concurrency, NULL
 	},
 
+	{
+		{"index_prefetch_distance",
+#ifdef USE_PREFETCH
+			PGC_USERSET,
+#else
+			PGC_INTERNAL,
+#endif
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets how many heap blocks ahead of an index scan to prefetch."),
+			gettext_noop("-1 means use the prefetch distance derived from effective_io_concurrency.")
+		},
+		&index_prefetch_distance,
+#ifdef USE_PREFETCH
+		-1, -1, 1000,
+#else
+		0, 0, 0,
+#endif
+		NULL, NULL, NULL
+	},
+
+	{
+		/* see max_connections */
+		{"max_worker_processes",
+			PGC_POSTMASTER,
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Maximum number of concurrent background worker processes."),
+			NULL
+		},
+		&max_worker_processes,
+		8, 0, MAX_BACKENDS,
+		check_max_worker_processes, assign_max_worker_processes, NULL
+	},
+
+	{
+		{"recovery_prefetch_distance",
+#ifdef USE_PREFETCH
+			PGC_SIGHUP,
+#else
+			PGC_INTERNAL,
+#endif
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets how far ahead in the WAL recovery looks for pages to prefetch."),
+			gettext_noop("Zero disables prefetching during recovery."),
+			GUC_UNIT_KB
+		},
+		&recovery_prefetch_distance,
+		0, 0, 1024 * 1024,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_rotation_age", PGC_SIGHUP, LOGGING_WHERE,
 			gettext_noop("Automatic log file rotation will occur after N minutes."),
@@ -2237,6 +2592,15 @@ static struct config_int ConfigureNamesInt[] =
 		50, 0, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"autovacuum_vacuum_insert_threshold", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Minimum number of tuple inserts prior to vacuum, or -1 to disable insert vacuums."),
+			NULL
+		},
+		&autovacuum_vac_ins_thresh,
+		1000, -1, INT_MAX,
+		NULL, NULL, NULL
+	},
 	{
 		{"autovacuum_analyze_threshold", PGC_SIGHUP, AUTOVACUUM,
 			gettext_noop("Minimum number of tuple inserts, updates or deletes prior to analyze."),
@@ -2301,6 +2665,27 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"ssl_session_timeout", PGC_POSTMASTER, CONN_AUTH_SECURITY,
+			gettext_noop("Sets how long an SSL session can be resumed after it started."),
+			NULL,
+			GUC_UNIT_S
+		},
+		&SSLSessionTimeout,
+		300, 1, 86400,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"max_compression_level", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the highest compression level clients may request."),
+			gettext_noop("Zero refuses to compress client connections.")
+		},
+		&max_compression_level,
+		6, 0, 9,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"tcp_keepalives_count", PGC_USERSET, CLIENT_CONN_OTHER,
 			gettext_noop("Maximum number of TCP keepalive retransmits."),
@@ -2324,6 +2709,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gin_pending_list_limit", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Sets the maximum size of the pending list for GIN index."),
+			NULL,
+			GUC_UNIT_KB
+		},
+		&GinPendingListLimit,
+		4096, 64, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"effective_cache_size", PGC_USERSET, QUERY_TUNING_COST,
 			gettext_noop("Sets the planner's assumption about the size of the disk cache."),
@@ -2370,6 +2766,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_stats_objects", PGC_POSTMASTER, STATS_COLLECTOR,
+			gettext_noop("Sets the maximum number of tables and functions tracked by the statistics system."),
+			gettext_noop("Each of the shared table and function statistics "
+						 "tables is sized for this many objects.")
+		},
+		&pgstat_max_objects,
+		10000, 100, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	/* End-of-list marker */
 	{
 		{NULL, 0, 0, NULL, NULL}, NULL, 0, 0, 0, NULL, NULL, NULL
@@ -2491,6 +2898,15 @@ static struct config_real ConfigureNamesReal[] =
 		0.2, 0.0, 100.0,
 		NULL, NULL, NULL
 	},
+	{
+		{"autovacuum_vacuum_insert_scale_factor", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Number of tuple inserts prior to vacuum as a fraction of reltuples."),
+			NULL
+		},
+		&autovacuum_vac_ins_scale,
+		0.2, 0.0, 100.0,
+		NULL, NULL, NULL
+	},
 	{
 		{"autovacuum_analyze_scale_factor", PGC_SIGHUP, AUTOVACUUM,
 			gettext_noop("Number of tuple inserts, updates or deletes prior to analyze as a fraction of reltuples."),
@@ -2960,26 +3376,15 @@ static struct config_string ConfigureNamesString[] =
 		check_canonical_path, NULL, NULL
 	},
 
-	{
-		{"stats_temp_directory", PGC_SIGHUP, STATS_COLLECTOR,
-			gettext_noop("Writes temporary statistics files to the specified directory."),
-			NULL,
-			GUC_SUPERUSER_ONLY
-		},
-		&pgstat_temp_directory,
-		"pg_stat_tmp",
-		check_canonical_path, assign_pgstat_temp_directory, NULL
-	},
-
 	{
 		{"synchronous_standby_names", PGC_SIGHUP, REPLICATION_MASTER,
-			gettext_noop("List of names of potential synchronous standbys."),
+			gettext_noop("Number and names of potential synchronous standbys."),
 			NULL,
 			GUC_LIST_INPUT
 		},
 		&SyncRepStandbyNames,
 		"",
-		check_synchronous_standby_names, NULL, NULL
+		check_synchronous_standby_names, assign_synchronous_standby_names, NULL
 	},
 
 	{
@@ -3000,7 +3405,22 @@ static struct config_string ConfigureNamesString[] =
 		},
 		&SSLCipherSuites,
 #ifdef USE_SSL
-		"ALL:!ADH:!LOW:!EXP:!MD5:@STRENGTH",
+		"HIGH:MEDIUM:+3DES:!aNULL",
+#else
+		"none",
+#endif
+		NULL, NULL, NULL
+	},
+
+	{
+		{"ssl_ecdh_curve", PGC_POSTMASTER, CONN_AUTH_SECURITY,
+			gettext_noop("Sets the curve to use for ECDH."),
+			NULL,
+			GUC_SUPERUSER_ONLY
+		},
+		&SSLECDHCurve,
+#ifdef USE_SSL
+		"prime256v1",
 #else
 		"none",
 #endif
@@ -3223,6 +3643,26 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"huge_pages", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Use of huge pages for shared memory."),
+			NULL
+		},
+		&huge_pages,
+		HUGE_PAGES_TRY, huge_pages_options,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"direct_io", PGC_POSTMASTER, RESOURCES_DISK,
+			gettext_noop("Selects which files are accessed with direct I/O, bypassing the kernel's page cache."),
+			NULL
+		},
+		&direct_io,
+		0, direct_io_options,
+		check_direct_io, NULL, NULL
+	},
+
 	{
 		{"xmloption", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets whether XML data in implicit parsing and serialization "
@@ -8325,11 +8765,12 @@ static bool
 check_temp_buffers(int *newval, void **extra, GucSource source)
 {
 	/*
-	 * Once local buffers have been initialized, it's too late to change this.
+	 * Once local buffers have been initialized, they can be added to, but
+	 * not taken away.
 	 */
-	if (NLocBuffer && NLocBuffer != *newval)
+	if (NLocBuffer && NLocBuffer > *newval)
 	{
-		GUC_check_errdetail("\"temp_buffers\" cannot be changed after any temporary tables have been accessed in the session.");
+		GUC_check_errdetail("\"temp_buffers\" cannot be reduced after any temporary tables have been accessed in the session.");
 		return false;
 	}
 	return true;
@@ -8373,6 +8814,17 @@ check_bonjour(bool *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_direct_io(int *newval, void **extra, GucSource source)
+{
+	if (*newval != 0 && PG_O_DIRECT == 0)
+	{
+		GUC_check_errdetail("Direct I/O is not supported on this platform.");
+		return false;
+	}
+	return true;
+}
+
 static bool
 check_ssl(bool *newval, void **extra, GucSource source)
 {
@@ -8554,7 +9006,8 @@ show_tcp_keepalives_count(void)
 static bool
 check_maxconnections(int *newval, void **extra, GucSource source)
 {
-	if (*newval + autovacuum_max_workers + 1 > MAX_BACKENDS)
+	if (*newval + autovacuum_max_workers + 1 +
+		max_worker_processes > MAX_BACKENDS)
 		return false;
 	return true;
 }
@@ -8562,13 +9015,14 @@ check_maxconnections(int *newval, void **extra, GucSource source)
 static void
 assign_maxconnections(int newval, void *extra)
 {
-	MaxBackends = newval + autovacuum_max_workers + 1;
+	MaxBackends = newval + autovacuum_max_workers + 1 +
+		max_worker_processes;
 }
 
 static bool
 check_autovacuum_max_workers(int *newval, void **extra, GucSource source)
 {
-	if (MaxConnections + *newval + 1 > MAX_BACKENDS)
+	if (MaxConnections + *newval + 1 + max_worker_processes > MAX_BACKENDS)
 		return false;
 	return true;
 }
@@ -8576,7 +9030,21 @@ check_autovacuum_max_workers(int *newval, void **extra, GucSource source)
 static void
 assign_autovacuum_max_workers(int newval, void *extra)
 {
-	MaxBackends = MaxConnections + newval + 1;
+	MaxBackends = MaxConnections + newval + 1 + max_worker_processes;
+}
+
+static bool
+check_max_worker_processes(int *newval, void **extra, GucSource source)
+{
+	if (MaxConnections + autovacuum_max_workers + 1 + *newval > MAX_BACKENDS)
+		return false;
+	return true;
+}
+
+static void
+assign_max_worker_processes(int newval, void *extra)
+{
+	MaxBackends = MaxConnections + autovacuum_max_workers + 1 + newval;
 }
 
 static bool
@@ -8647,26 +9115,6 @@ assign_effective_io_concurrency(int newval, void *extra)
 #endif   /* USE_PREFETCH */
 }
 
-static void
-assign_pgstat_temp_directory(const char *newval, void *extra)
-{
-	/* check_canonical_path already canonicalized newval for us */
-	char	   *tname;
-	char	   *fname;
-
-	tname = guc_malloc(ERROR, strlen(newval) + 12);		/* /pgstat.tmp */
-	sprintf(tname, "%s/pgstat.tmp", newval);
-	fname = guc_malloc(ERROR, strlen(newval) + 13);		/* /pgstat.stat */
-	sprintf(fname, "%s/pgstat.stat", newval);
-
-	if (pgstat_stat_tmpname)
-		free(pgstat_stat_tmpname);
-	pgstat_stat_tmpname = tname;
-	if (pgstat_stat_filename)
-		free(pgstat_stat_filename);
-	pgstat_stat_filename = fname;
-}
-
 static bool
 check_application_name(char **newval, void **extra, GucSource source)
 {
@@ -0,0 +1,472 @@
+/*-------------------------------------------------------------------------
+ *
+ * bump.c
+ *	  Bump allocator definitions.
+ *
+ * A bump context carves each request off the end of its current block, and
+ * gets all its memory back only when it is reset or deleted.  It suits
+ * contexts whose contents are built up and then thrown away all at once:
+ * compared with an AllocSet, it does not round requests up to a power of 2
+ * and keeps no freelists, so it packs chunks densely and allocates quickly.
+ *
+ * pfree() on a chunk of a bump context is an error.  repalloc() works, but
+ * a chunk that grows out of its space is copied, and the old copy's space
+ * is not reused until the context is reset.
+ *
+ * Each chunk still has the standard chunk header, because mcxt.c finds a
+ * chunk's context through it.
+ *
+ *
+ *	About MEMORY_CONTEXT_CHECKING:
+ *
+ *	As in aset.c, a 0x7E byte is stored just beyond the requested space
+ *	whenever alignment leaves room for it, and verified when the context is
+ *	checked.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/bump.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "utils/memutils.h"
+
+
+/*
+ * Requests bigger than 1/BUMP_CHUNK_FRACTION of maxBlockSize get a block of
+ * their own, so as not to waste the rest of the current block.
+ */
+#define BUMP_CHUNK_FRACTION 8
+
+typedef struct BumpBlockData *BumpBlock;		/* forward reference */
+
+/*
+ * BumpContext is a MemoryContext that never frees individual chunks.
+ */
+typedef struct BumpContext
+{
+	MemoryContextData header;	/* Standard memory-context fields */
+	/* Info about storage allocated in this context: */
+	BumpBlock	blocks;			/* head of list of blocks in this set */
+	/* Allocation parameters for this context: */
+	Size		initBlockSize;	/* initial block size */
+	Size		maxBlockSize;	/* maximum block size */
+	Size		nextBlockSize;	/* next block size to allocate */
+	Size		chunkLimit;		/* largest chunk put into a shared block */
+} BumpContext;
+
+typedef BumpContext *Bump;
+
+/*
+ * BumpIsValid
+ *		True iff bump is valid bump context.
+ */
+#define BumpIsValid(bump) PointerIsValid(bump)
+
+/*
+ * BumpBlock
+ *		The header of a block of chunks.  Chunks are laid out back to back
+ *		from the end of the header up to freeptr.
+ */
+typedef struct BumpBlockData
+{
+	BumpBlock	next;			/* next block in the context's list */
+	char	   *freeptr;		/* start of free space in this block */
+	char	   *endptr;			/* end of space in this block */
+} BumpBlockData;
+
+#define BUMP_BLOCKHDRSZ		MAXALIGN(sizeof(BumpBlockData))
+#define BUMP_CHUNKHDRSZ		STANDARDCHUNKHEADERSIZE
+
+#define BumpChunkGetPointer(chk) \
+	((void *) (((char *) (chk)) + BUMP_CHUNKHDRSZ))
+#define BumpPointerGetChunk(ptr) \
+	((StandardChunkHeader *) (((char *) (ptr)) - BUMP_CHUNKHDRSZ))
+
+/*
+ * These functions implement the MemoryContext API for Bump contexts.
+ */
+static void *BumpAlloc(MemoryContext context, Size size);
+static void BumpFree(MemoryContext context, void *pointer);
+static void *BumpRealloc(MemoryContext context, void *pointer, Size size);
+static void BumpInit(MemoryContext context);
+static void BumpReset(MemoryContext context);
+static void BumpDelete(MemoryContext context);
+static Size BumpGetChunkSpace(MemoryContext context, void *pointer);
+static bool BumpIsEmpty(MemoryContext context);
+static void BumpStats(MemoryContext context,
+		  MemoryContextCounters *totals);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+static void BumpCheck(MemoryContext context);
+#endif
+
+/*
+ * This is the virtual function table for Bump contexts.
+ */
+static MemoryContextMethods BumpMethods = {
+	BumpAlloc,
+	BumpFree,
+	BumpRealloc,
+	BumpInit,
+	BumpReset,
+	BumpDelete,
+	BumpGetChunkSpace,
+	BumpIsEmpty,
+	BumpStats
+#ifdef MEMORY_CONTEXT_CHECKING
+	,BumpCheck
+#endif
+};
+
+
+/*
+ * Public routines
+ */
+
+
+/*
+ * BumpContextCreate
+ *		Create a new bump context.
+ *
+ * parent: parent context, or NULL if top-level context
+ * name: name of context (for debugging --- string will be copied)
+ * initBlockSize: initial allocation block size
+ * maxBlockSize: maximum allocation block size
+ *
+ * As in an AllocSet, each block is twice the size of the one before, up to
+ * maxBlockSize.  The ALLOCSET_DEFAULT_* and ALLOCSET_SMALL_* block sizes are
+ * suitable here too.
+ */
+MemoryContext
+BumpContextCreate(MemoryContext parent,
+				  const char *name,
+				  Size initBlockSize,
+				  Size maxBlockSize)
+{
+	Bump		bump;
+
+	/* Do the type-independent part of context creation */
+	bump = (Bump) MemoryContextCreate(T_BumpContext,
+									  sizeof(BumpContext),
+									  &BumpMethods,
+									  parent,
+									  name);
+
+	/*
+	 * Make sure alloc parameters are reasonable, and save them.
+	 */
+	initBlockSize = MAXALIGN(initBlockSize);
+	if (initBlockSize < 1024)
+		initBlockSize = 1024;
+	maxBlockSize = MAXALIGN(maxBlockSize);
+	if (maxBlockSize < initBlockSize)
+		maxBlockSize = initBlockSize;
+	bump->initBlockSize = initBlockSize;
+	bump->maxBlockSize = maxBlockSize;
+	bump->nextBlockSize = initBlockSize;
+	bump->chunkLimit = maxBlockSize / BUMP_CHUNK_FRACTION;
+
+	return (MemoryContext) bump;
+}
+
+/*
+ * BumpInit
+ *		Context-type-specific initialization routine.
+ *
+ * Since MemoryContextCreate already zeroed the context node, there is
+ * nothing to do here.
+ */
+static void
+BumpInit(MemoryContext context)
+{
+}
+
+/*
+ * BumpReset
+ *		Frees all memory which is allocated in the given context.
+ */
+static void
+BumpReset(MemoryContext context)
+{
+	Bump		bump = (Bump) context;
+	BumpBlock	block = bump->blocks;
+
+	AssertArg(BumpIsValid(bump));
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Check for corruption before freeing */
+	BumpCheck(context);
+#endif
+
+	while (block != NULL)
+	{
+		BumpBlock	next = block->next;
+
+#ifdef CLOBBER_FREED_MEMORY
+		/* Wipe freed memory for debugging purposes */
+		memset(block, 0x7F, block->freeptr - ((char *) block));
+#endif
+		free(block);
+		block = next;
+	}
+	bump->blocks = NULL;
+
+	/* Reset block size allocation sequence, too */
+	bump->nextBlockSize = bump->initBlockSize;
+}
+
+/*
+ * BumpDelete
+ *		Frees all memory which is allocated in the given context,
+ *		in preparation for deletion of the context.
+ */
+static void
+BumpDelete(MemoryContext context)
+{
+	/* Blocks are all we have, so this is the same as a reset */
+	BumpReset(context);
+}
+
+/*
+ * BumpAlloc
+ *		Returns pointer to allocated memory of given size; memory is added
+ *		to the context.
+ */
+static void *
+BumpAlloc(MemoryContext context, Size size)
+{
+	Bump		bump = (Bump) context;
+	BumpBlock	block;
+	StandardChunkHeader *chunk;
+	Size		chunk_size = MAXALIGN(size);
+
+	AssertArg(BumpIsValid(bump));
+
+	block = bump->blocks;
+
+	if (chunk_size > bump->chunkLimit)
+	{
+		/*
+		 * Big request: give it a block of its own, and stick that underneath
+		 * the active block so we don't lose the space remaining therein.
+		 */
+		Size		blksize = chunk_size + BUMP_BLOCKHDRSZ + BUMP_CHUNKHDRSZ;
+
+		block = (BumpBlock) malloc(blksize);
+		if (block == NULL)
+		{
+			MemoryContextStats(TopMemoryContext);
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed on request of size %lu.",
+							   (unsigned long) size)));
+		}
+		block->freeptr = ((char *) block) + BUMP_BLOCKHDRSZ;
+		block->endptr = ((char *) block) + blksize;
+		if (bump->blocks != NULL)
+		{
+			block->next = bump->blocks->next;
+			bump->blocks->next = block;
+		}
+		else
+		{
+			block->next = NULL;
+			bump->blocks = block;
+		}
+	}
+	else if (block == NULL ||
+			 (Size) (block->endptr - block->freeptr) < chunk_size + BUMP_CHUNKHDRSZ)
+	{
+		/*
+		 * The active block is full (or there is none), so start a new one.
+		 * Whatever remains of the old block is wasted.
+		 */
+		Size		blksize = bump->nextBlockSize;
+		Size		required_size = chunk_size + BUMP_BLOCKHDRSZ + BUMP_CHUNKHDRSZ;
+
+		bump->nextBlockSize <<= 1;
+		if (bump->nextBlockSize > bump->maxBlockSize)
+			bump->nextBlockSize = bump->maxBlockSize;
+
+		/* chunkLimit guarantees this is only needed for tiny maxBlockSize */
+		while (blksize < required_size)
+			blksize <<= 1;
+
+		block = (BumpBlock) malloc(blksize);
+		if (block == NULL)
+		{
+			MemoryContextStats(TopMemoryContext);
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed on request of size %lu.",
+							   (unsigned long) size)));
+		}
+		block->freeptr = ((char *) block) + BUMP_BLOCKHDRSZ;
+		block->endptr = ((char *) block) + blksize;
+		block->next = bump->blocks;
+		bump->blocks = block;
+	}
+
+	chunk = (StandardChunkHeader *) block->freeptr;
+	block->freeptr += chunk_size + BUMP_CHUNKHDRSZ;
+	Assert(block->freeptr <= block->endptr);
+
+	chunk->context = context;
+	chunk->size = chunk_size;
+#ifdef MEMORY_CONTEXT_CHECKING
+	chunk->requested_size = size;
+	/* set mark to catch clobber of "unused" space */
+	if (size < chunk_size)
+		((char *) BumpChunkGetPointer(chunk))[size] = 0x7E;
+#endif
+
+	return BumpChunkGetPointer(chunk);
+}
+
+/*
+ * BumpFree
+ *		Not supported: memory comes back only when the context is reset.
+ */
+static void
+BumpFree(MemoryContext context, void *pointer)
+{
+	elog(ERROR, "pfree is not supported by bump memory context \"%s\"",
+		 context->name);
+}
+
+/*
+ * BumpRealloc
+ *		Returns new pointer to allocated memory of given size; this memory
+ *		is added to the context.  The old chunk's space, if it is not reused,
+ *		is not recovered until the context is reset.
+ */
+static void *
+BumpRealloc(MemoryContext context, void *pointer, Size size)
+{
+	StandardChunkHeader *chunk = BumpPointerGetChunk(pointer);
+	Size		oldsize = chunk->size;
+	void	   *newPointer;
+
+	if (oldsize >= size)
+	{
+#ifdef MEMORY_CONTEXT_CHECKING
+		chunk->requested_size = size;
+		/* set mark to catch clobber of "unused" space */
+		if (size < oldsize)
+			((char *) pointer)[size] = 0x7E;
+#endif
+		return pointer;
+	}
+
+	newPointer = BumpAlloc(context, size);
+	memcpy(newPointer, pointer, oldsize);
+	return newPointer;
+}
+
+/*
+ * BumpGetChunkSpace
+ *		Given a currently-allocated chunk, determine the total space
+ *		it occupies (including all memory-allocation overhead).
+ */
+static Size
+BumpGetChunkSpace(MemoryContext context, void *pointer)
+{
+	StandardChunkHeader *chunk = BumpPointerGetChunk(pointer);
+
+	return chunk->size + BUMP_CHUNKHDRSZ;
+}
+
+/*
+ * BumpIsEmpty
+ *		Is a bump context empty of any allocated space?
+ */
+static bool
+BumpIsEmpty(MemoryContext context)
+{
+	Bump		bump = (Bump) context;
+
+	return bump->blocks == NULL;
+}
+
+/*
+ * BumpStats
+ *		Compute stats about memory consumption of a bump context, adding
+ *		them to *totals.  Freed chunks are never reused, so there are no
+ *		free chunks to count.
+ */
+static void
+BumpStats(MemoryContext context, MemoryContextCounters *totals)
+{
+	Bump		bump = (Bump) context;
+	BumpBlock	block;
+
+	for (block = bump->blocks; block != NULL; block = block->next)
+	{
+		totals->nblocks++;
+		totals->totalspace += block->endptr - ((char *) block);
+		totals->freespace += block->endptr - block->freeptr;
+	}
+}
+
+
+#ifdef MEMORY_CONTEXT_CHECKING
+
+/*
+ * BumpCheck
+ *		Walk through chunks and check consistency of memory.
+ *
+ * NOTE: report errors as WARNING, *not* ERROR or FATAL.  Otherwise you'll
+ * find yourself in an infinite loop when trouble occurs, because this
+ * routine will be entered again when elog cleanup tries to release memory!
+ */
+static void
+BumpCheck(MemoryContext context)
+{
+	Bump		bump = (Bump) context;
+	char	   *name = bump->header.name;
+	BumpBlock	block;
+
+	for (block = bump->blocks; block != NULL; block = block->next)
+	{
+		char	   *bpoz = ((char *) block) + BUMP_BLOCKHDRSZ;
+
+		if (bpoz == block->freeptr)
+			elog(WARNING, "problem in bump context %s: empty block %p",
+				 name, block);
+
+		while (bpoz < block->freeptr)
+		{
+			StandardChunkHeader *chunk = (StandardChunkHeader *) bpoz;
+			Size		chsize = chunk->size;
+			Size		dsize = chunk->requested_size;
+
+			if (chunk->context != context)
+				elog(WARNING, "problem in bump context %s: bogus context link in block %p, chunk %p",
+					 name, block, chunk);
+			if (dsize > chsize)
+				elog(WARNING, "problem in bump context %s: req size > alloc size for chunk %p in block %p",
+					 name, chunk, block);
+			if (dsize < chsize &&
+				((char *) BumpChunkGetPointer(chunk))[dsize] != 0x7E)
+				elog(WARNING, "problem in bump context %s: detected write past chunk end in block %p, chunk %p",
+					 name, block, chunk);
+
+			bpoz += BUMP_CHUNKHDRSZ + chsize;
+		}
+
+		if (bpoz != block->freeptr)
+			elog(WARNING, "problem in bump context %s: found inconsistent memory block %p",
+				 name, block);
+	}
+}
+
+#endif   /* MEMORY_CONTEXT_CHECKING */
@@ -49,7 +49,10 @@ MemoryContext CurTransactionContext = NULL;
 /* This is a transient link to the active portal's memory context: */
 MemoryContext PortalContext = NULL;
 
-static void MemoryContextStatsInternal(MemoryContext context, int level);
+static void MemoryContextStatsInternal(MemoryContext context, int level,
+						   bool to_log, MemoryContextCounters *totals);
+static void MemoryContextStatsPrint(MemoryContext context, int level,
+						bool to_log, MemoryContextCounters *counters);
 
 
 /*****************************************************************************
@@ -373,29 +376,127 @@ MemoryContextIsEmpty(MemoryContext context)
 	return (*context->methods->is_empty) (context);
 }
 
+/*
+ * MemoryContextGetCounters
+ *		Compute the memory consumption of the given context alone, not
+ *		counting its children.
+ */
+void
+MemoryContextGetCounters(MemoryContext context, MemoryContextCounters *counters)
+{
+	AssertArg(MemoryContextIsValid(context));
+
+	memset(counters, 0, sizeof(MemoryContextCounters));
+	(*context->methods->stats) (context, counters);
+}
+
 /*
  * MemoryContextStats
  *		Print statistics about the named context and all its descendants.
  *
  * This is just a debugging utility, so it's not fancy.  The statistics
- * are merely sent to stderr.
+ * are merely sent to stderr.  Since this is called when we've run out of
+ * memory, it mustn't allocate any.
  */
 void
 MemoryContextStats(MemoryContext context)
 {
-	MemoryContextStatsInternal(context, 0);
+	MemoryContextCounters grand_totals;
+
+	memset(&grand_totals, 0, sizeof(grand_totals));
+	MemoryContextStatsInternal(context, 0, false, &grand_totals);
+
+	fprintf(stderr,
+			"Grand total: %lu bytes in %lu blocks; %lu free (%lu chunks); %lu used\n",
+			(unsigned long) grand_totals.totalspace,
+			(unsigned long) grand_totals.nblocks,
+			(unsigned long) grand_totals.freespace,
+			(unsigned long) grand_totals.freechunks,
+			(unsigned long) (grand_totals.totalspace - grand_totals.freespace));
+}
+
+/*
+ * MemoryContextLogStats
+ *		Like MemoryContextStats, but write the statistics to the server log,
+ *		one message per context.
+ *
+ * This is what pg_log_backend_memory_contexts() makes another backend do.
+ * The messages are not sent to the client.
+ */
+void
+MemoryContextLogStats(MemoryContext context)
+{
+	MemoryContextCounters grand_totals;
+
+	memset(&grand_totals, 0, sizeof(grand_totals));
+	MemoryContextStatsInternal(context, 0, true, &grand_totals);
+
+	ereport(LOG,
+			(errhidestmt(true),
+			 errmsg_internal("Grand total: %lu bytes in %lu blocks; %lu free (%lu chunks); %lu used",
+							 (unsigned long) grand_totals.totalspace,
+							 (unsigned long) grand_totals.nblocks,
+							 (unsigned long) grand_totals.freespace,
+							 (unsigned long) grand_totals.freechunks,
+							 (unsigned long) (grand_totals.totalspace - grand_totals.freespace))));
 }
 
 static void
-MemoryContextStatsInternal(MemoryContext context, int level)
+MemoryContextStatsInternal(MemoryContext context, int level,
+						   bool to_log, MemoryContextCounters *totals)
 {
+	MemoryContextCounters counters;
 	MemoryContext child;
 
-	AssertArg(MemoryContextIsValid(context));
+	MemoryContextGetCounters(context, &counters);
+	MemoryContextStatsPrint(context, level, to_log, &counters);
+
+	totals->nblocks += counters.nblocks;
+	totals->freechunks += counters.freechunks;
+	totals->totalspace += counters.totalspace;
+	totals->freespace += counters.freespace;
 
-	(*context->methods->stats) (context, level);
 	for (child = context->firstchild; child != NULL; child = child->nextchild)
-		MemoryContextStatsInternal(child, level + 1);
+		MemoryContextStatsInternal(child, level + 1, to_log, totals);
+}
+
+/*
+ * MemoryContextStatsPrint
+ *		Print the statistics of one context, indented according to its
+ *		depth in the tree.
+ */
+static void
+MemoryContextStatsPrint(MemoryContext context, int level,
+						bool to_log, MemoryContextCounters *counters)
+{
+	if (to_log)
+	{
+		ereport(LOG,
+				(errhidestmt(true),
+				 errmsg_internal("level: %d; %s: %lu total in %lu blocks; %lu free (%lu chunks); %lu used",
+								 level, context->name,
+								 (unsigned long) counters->totalspace,
+								 (unsigned long) counters->nblocks,
+								 (unsigned long) counters->freespace,
+								 (unsigned long) counters->freechunks,
+								 (unsigned long) (counters->totalspace - counters->freespace))));
+	}
+	else
+	{
+		int			i;
+
+		for (i = 0; i < level; i++)
+			fprintf(stderr, "  ");
+
+		fprintf(stderr,
+				"%s: %lu total in %lu blocks; %lu free (%lu chunks); %lu used\n",
+				context->name,
+				(unsigned long) counters->totalspace,
+				(unsigned long) counters->nblocks,
+				(unsigned long) counters->freespace,
+				(unsigned long) counters->freechunks,
+				(unsigned long) (counters->totalspace - counters->freespace));
+	}
 }
 
 /*
@@ -0,0 +1,599 @@
+/*-------------------------------------------------------------------------
+ *
+ * slab.c
+ *	  Slab allocator definitions.
+ *
+ * A slab context hands out chunks of a single fixed size, which is chosen
+ * when the context is created.  It suits code that allocates and frees large
+ * numbers of objects of the same type in no particular order: unlike an
+ * AllocSet, it does not round requests up to a power of 2, so there is no
+ * wasted space at the end of each chunk, and a block is returned to malloc()
+ * as soon as the last chunk in it has been freed, rather than its chunks
+ * lingering on a freelist until the whole context is reset.
+ *
+ * Each block holds a fixed number of chunks.  Freed chunks are kept on a
+ * freelist of their own block, threaded through the chunks' data areas, and
+ * chunks never used since the block was malloc'd are carved off its end.
+ * The context keeps its blocks in a list in which all the blocks that have
+ * free chunks come before all the ones that are full, so both allocation and
+ * freeing are O(1).
+ *
+ * Every chunk starts with a pointer to its block, followed by the standard
+ * chunk header that mcxt.c expects to find just before any allocated
+ * pointer.
+ *
+ *
+ *	About CLOBBER_FREED_MEMORY:
+ *
+ *	If this symbol is defined, all freed memory is overwritten with 0x7F's.
+ *	This is useful for catching places that reference already-freed memory.
+ *
+ *	About MEMORY_CONTEXT_CHECKING:
+ *
+ *	A request smaller than the context's chunk size gets a 0x7E byte just
+ *	beyond the requested space, which is verified when the chunk is freed,
+ *	as in aset.c.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/slab.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "utils/memutils.h"
+
+
+typedef struct SlabBlockData *SlabBlock;		/* forward reference */
+
+/*
+ * SlabContext is a MemoryContext handing out chunks of one size.
+ *
+ * Note: freeing the last active chunk frees the last block too, so a slab
+ * with no blocks is empty even if it has not been reset.
+ */
+typedef struct SlabContext
+{
+	MemoryContextData header;	/* Standard memory-context fields */
+	/* Allocation parameters for this context: */
+	Size		chunkSize;		/* usable size of each chunk */
+	Size		fullChunkSize;	/* chunkSize plus all chunk overhead */
+	Size		blockSize;		/* size of each malloc'd block */
+	int			chunksPerBlock; /* number of chunks in each block */
+	/* Blocks with free chunks first, full ones last: */
+	SlabBlock	head;
+	SlabBlock	tail;
+} SlabContext;
+
+typedef SlabContext *Slab;
+
+/*
+ * SlabIsValid
+ *		True iff slab is valid slab context.
+ */
+#define SlabIsValid(slab) PointerIsValid(slab)
+
+/*
+ * SlabBlock
+ *		The header of a block of chunks.
+ */
+typedef struct SlabBlockData
+{
+	Slab		slab;			/* slab that owns this block */
+	SlabBlock	prev;			/* neighbours in the slab's block list */
+	SlabBlock	next;
+	int			nfree;			/* number of free chunks, used or not */
+	char	   *freelist;		/* chain of freed chunks */
+	char	   *unused;			/* first never-used chunk */
+	char	   *endptr;			/* end of space in this block */
+} SlabBlockData;
+
+#define SLAB_BLOCKHDRSZ		MAXALIGN(sizeof(SlabBlockData))
+#define SLAB_BLOCKPTRSZ		MAXALIGN(sizeof(SlabBlock))
+#define SLAB_CHUNKHDRSZ		(SLAB_BLOCKPTRSZ + STANDARDCHUNKHEADERSIZE)
+
+/*
+ * A chunk is addressed by its start, where its block pointer sits.  A free
+ * chunk's next-free link is kept in its data area.
+ */
+#define SlabChunkGetBlock(chk)	(*(SlabBlock *) (chk))
+#define SlabChunkGetHeader(chk) \
+	((StandardChunkHeader *) ((chk) + SLAB_BLOCKPTRSZ))
+#define SlabChunkGetPointer(chk)	((void *) ((chk) + SLAB_CHUNKHDRSZ))
+#define SlabPointerGetChunk(ptr)	(((char *) (ptr)) - SLAB_CHUNKHDRSZ)
+#define SlabChunkNextFree(chk)	(*(char **) SlabChunkGetPointer(chk))
+
+/*
+ * These functions implement the MemoryContext API for Slab contexts.
+ */
+static void *SlabAlloc(MemoryContext context, Size size);
+static void SlabFree(MemoryContext context, void *pointer);
+static void *SlabRealloc(MemoryContext context, void *pointer, Size size);
+static void SlabInit(MemoryContext context);
+static void SlabReset(MemoryContext context);
+static void SlabDelete(MemoryContext context);
+static Size SlabGetChunkSpace(MemoryContext context, void *pointer);
+static bool SlabIsEmpty(MemoryContext context);
+static void SlabStats(MemoryContext context,
+		  MemoryContextCounters *totals);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+static void SlabCheck(MemoryContext context);
+#endif
+
+/*
+ * This is the virtual function table for Slab contexts.
+ */
+static MemoryContextMethods SlabMethods = {
+	SlabAlloc,
+	SlabFree,
+	SlabRealloc,
+	SlabInit,
+	SlabReset,
+	SlabDelete,
+	SlabGetChunkSpace,
+	SlabIsEmpty,
+	SlabStats
+#ifdef MEMORY_CONTEXT_CHECKING
+	,SlabCheck
+#endif
+};
+
+
+/*
+ * Unlink a block from its slab's block list.
+ */
+static void
+slab_unlink_block(Slab slab, SlabBlock block)
+{
+	if (block->prev)
+		block->prev->next = block->next;
+	else
+		slab->head = block->next;
+	if (block->next)
+		block->next->prev = block->prev;
+	else
+		slab->tail = block->prev;
+}
+
+/*
+ * Put a block at the front of the list, among the blocks with free chunks.
+ */
+static void
+slab_push_head(Slab slab, SlabBlock block)
+{
+	block->prev = NULL;
+	block->next = slab->head;
+	if (slab->head)
+		slab->head->prev = block;
+	else
+		slab->tail = block;
+	slab->head = block;
+}
+
+/*
+ * Put a block at the end of the list, among the full blocks.
+ */
+static void
+slab_push_tail(Slab slab, SlabBlock block)
+{
+	block->next = NULL;
+	block->prev = slab->tail;
+	if (slab->tail)
+		slab->tail->next = block;
+	else
+		slab->head = block;
+	slab->tail = block;
+}
+
+
+/*
+ * Public routines
+ */
+
+
+/*
+ * SlabContextCreate
+ *		Create a new slab context.
+ *
+ * parent: parent context, or NULL if top-level context
+ * name: name of context (for debugging --- string will be copied)
+ * blockSize: size of the blocks to malloc
+ * chunkSize: the largest request the context will satisfy
+ *
+ * The block size is raised if need be so that a block holds at least one
+ * chunk; it should normally be big enough to hold many.
+ */
+MemoryContext
+SlabContextCreate(MemoryContext parent,
+				  const char *name,
+				  Size blockSize,
+				  Size chunkSize)
+{
+	Slab		slab;
+	Size		fullChunkSize;
+
+	/* make sure a free chunk can hold its freelist link */
+	chunkSize = MAXALIGN(Max(chunkSize, sizeof(char *)));
+	if (!AllocSizeIsValid(chunkSize))
+		elog(ERROR, "invalid slab chunk size %lu", (unsigned long) chunkSize);
+	fullChunkSize = chunkSize + SLAB_CHUNKHDRSZ;
+	blockSize = Max(MAXALIGN(blockSize), SLAB_BLOCKHDRSZ + fullChunkSize);
+
+	/* Do the type-independent part of context creation */
+	slab = (Slab) MemoryContextCreate(T_SlabContext,
+									  sizeof(SlabContext),
+									  &SlabMethods,
+									  parent,
+									  name);
+
+	slab->chunkSize = chunkSize;
+	slab->fullChunkSize = fullChunkSize;
+	slab->blockSize = blockSize;
+	slab->chunksPerBlock = (blockSize - SLAB_BLOCKHDRSZ) / fullChunkSize;
+	slab->head = NULL;
+	slab->tail = NULL;
+
+	return (MemoryContext) slab;
+}
+
+/*
+ * SlabInit
+ *		Context-type-specific initialization routine.
+ *
+ * This is called by MemoryContextCreate() after setting up the
+ * generic MemoryContext fields and before linking the new context
+ * into the context tree.  We must do whatever is needed to make the
+ * new context minimally valid for deletion.  We must *not* risk
+ * failure --- thus, for example, allocating more memory is not cool.
+ * (SlabContextCreate can allocate memory when it gets control
+ * back, however.)
+ */
+static void
+SlabInit(MemoryContext context)
+{
+	/*
+	 * Since MemoryContextCreate already zeroed the context node, we don't
+	 * have to do anything here: it's already OK.
+	 */
+}
+
+/*
+ * SlabReset
+ *		Frees all memory which is allocated in the given slab.
+ */
+static void
+SlabReset(MemoryContext context)
+{
+	Slab		slab = (Slab) context;
+	SlabBlock	block = slab->head;
+
+	AssertArg(SlabIsValid(slab));
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	/* Check for corruption and leaks before freeing */
+	SlabCheck(context);
+#endif
+
+	while (block != NULL)
+	{
+		SlabBlock	next = block->next;
+
+#ifdef CLOBBER_FREED_MEMORY
+		/* Wipe freed memory for debugging purposes */
+		memset(block, 0x7F, slab->blockSize);
+#endif
+		free(block);
+		block = next;
+	}
+	slab->head = NULL;
+	slab->tail = NULL;
+}
+
+/*
+ * SlabDelete
+ *		Frees all memory which is allocated in the given slab,
+ *		in preparation for deletion of the slab.
+ *
+ * Unlike SlabReset, this *must* free all resources of the slab.
+ * But note we are not responsible for deleting the context node itself.
+ */
+static void
+SlabDelete(MemoryContext context)
+{
+	/* Blocks are all we have, so this is the same as a reset */
+	SlabReset(context);
+}
+
+/*
+ * SlabAlloc
+ *		Returns pointer to allocated memory of given size; memory is added
+ *		to the slab.
+ *
+ * A request larger than the slab's chunk size is an error.
+ */
+static void *
+SlabAlloc(MemoryContext context, Size size)
+{
+	Slab		slab = (Slab) context;
+	SlabBlock	block;
+	char	   *chunk;
+	StandardChunkHeader *header;
+
+	AssertArg(SlabIsValid(slab));
+
+	if (size > slab->chunkSize)
+		elog(ERROR, "request of size %lu exceeds chunk size %lu of slab context \"%s\"",
+			 (unsigned long) size, (unsigned long) slab->chunkSize,
+			 slab->header.name);
+
+	/*
+	 * The block at the head of the list has a free chunk if any block does;
+	 * otherwise, make a new one.
+	 */
+	block = slab->head;
+	if (block == NULL || block->nfree == 0)
+	{
+		block = (SlabBlock) malloc(slab->blockSize);
+		if (block == NULL)
+		{
+			MemoryContextStats(TopMemoryContext);
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed on request of size %lu.",
+							   (unsigned long) size)));
+		}
+		block->slab = slab;
+		block->nfree = slab->chunksPerBlock;
+		block->freelist = NULL;
+		block->unused = ((char *) block) + SLAB_BLOCKHDRSZ;
+		block->endptr = block->unused +
+			slab->chunksPerBlock * slab->fullChunkSize;
+		slab_push_head(slab, block);
+	}
+
+	/* Prefer a recycled chunk; else carve a fresh one off the block */
+	if (block->freelist != NULL)
+	{
+		chunk = block->freelist;
+		block->freelist = SlabChunkNextFree(chunk);
+	}
+	else
+	{
+		Assert(block->unused < block->endptr);
+		chunk = block->unused;
+		block->unused += slab->fullChunkSize;
+		SlabChunkGetBlock(chunk) = block;
+	}
+	block->nfree--;
+
+	/* A block that just became full goes to the back of the list */
+	if (block->nfree == 0 && block != slab->tail)
+	{
+		slab_unlink_block(slab, block);
+		slab_push_tail(slab, block);
+	}
+
+	header = SlabChunkGetHeader(chunk);
+	header->context = context;
+	header->size = slab->chunkSize;
+#ifdef MEMORY_CONTEXT_CHECKING
+	header->requested_size = size;
+	/* set mark to catch clobber of "unused" space */
+	if (size < slab->chunkSize)
+		((char *) SlabChunkGetPointer(chunk))[size] = 0x7E;
+#endif
+
+	return SlabChunkGetPointer(chunk);
+}
+
+/*
+ * SlabFree
+ *		Frees allocated memory; memory is removed from the slab.
+ */
+static void
+SlabFree(MemoryContext context, void *pointer)
+{
+	Slab		slab = (Slab) context;
+	char	   *chunk = SlabPointerGetChunk(pointer);
+	SlabBlock	block = SlabChunkGetBlock(chunk);
+
+	Assert(block->slab == slab);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	{
+		StandardChunkHeader *header = SlabChunkGetHeader(chunk);
+
+		/* Test for someone scribbling on unused space in chunk */
+		if (header->requested_size < slab->chunkSize)
+			if (((char *) pointer)[header->requested_size] != 0x7E)
+				elog(WARNING, "detected write past chunk end in %s %p",
+					 slab->header.name, chunk);
+		/* Reset requested_size to 0 in chunks that are on freelist */
+		header->requested_size = 0;
+	}
+#endif
+
+#ifdef CLOBBER_FREED_MEMORY
+	/* Wipe freed memory for debugging purposes */
+	memset(pointer, 0x7F, slab->chunkSize);
+#endif
+
+	block->nfree++;
+
+	/*
+	 * Once all its chunks are free, give the block back to malloc().
+	 */
+	if (block->nfree == slab->chunksPerBlock)
+	{
+		slab_unlink_block(slab, block);
+#ifdef CLOBBER_FREED_MEMORY
+		memset(block, 0x7F, slab->blockSize);
+#endif
+		free(block);
+		return;
+	}
+
+	SlabChunkNextFree(chunk) = block->freelist;
+	block->freelist = chunk;
+
+	/* A block that was full now has room, so move it forward */
+	if (block->nfree == 1 && block != slab->head)
+	{
+		slab_unlink_block(slab, block);
+		slab_push_head(slab, block);
+	}
+}
+
+/*
+ * SlabRealloc
+ *		Returns the same chunk if the new size still fits in it; a slab
+ *		cannot hand out anything bigger.
+ */
+static void *
+SlabRealloc(MemoryContext context, void *pointer, Size size)
+{
+	Slab		slab = (Slab) context;
+
+	if (size > slab->chunkSize)
+		elog(ERROR, "request of size %lu exceeds chunk size %lu of slab context \"%s\"",
+			 (unsigned long) size, (unsigned long) slab->chunkSize,
+			 slab->header.name);
+
+#ifdef MEMORY_CONTEXT_CHECKING
+	{
+		StandardChunkHeader *header =
+			SlabChunkGetHeader(SlabPointerGetChunk(pointer));
+
+		header->requested_size = size;
+		if (size < slab->chunkSize)
+			((char *) pointer)[size] = 0x7E;
+	}
+#endif
+
+	return pointer;
+}
+
+/*
+ * SlabGetChunkSpace
+ *		Given a currently-allocated chunk, determine the total space
+ *		it occupies (including all memory-allocation overhead).
+ */
+static Size
+SlabGetChunkSpace(MemoryContext context, void *pointer)
+{
+	Slab		slab = (Slab) context;
+
+	return slab->fullChunkSize;
+}
+
+/*
+ * SlabIsEmpty
+ *		Is a slab empty of any allocated space?
+ */
+static bool
+SlabIsEmpty(MemoryContext context)
+{
+	Slab		slab = (Slab) context;
+
+	return slab->head == NULL;
+}
+
+/*
+ * SlabStats
+ *		Compute stats about memory consumption of a slab, adding them to
+ *		*totals.
+ */
+static void
+SlabStats(MemoryContext context, MemoryContextCounters *totals)
+{
+	Slab		slab = (Slab) context;
+	SlabBlock	block;
+
+	for (block = slab->head; block != NULL; block = block->next)
+	{
+		totals->nblocks++;
+		totals->freechunks += block->nfree;
+		totals->totalspace += slab->blockSize;
+		totals->freespace += block->nfree * slab->fullChunkSize;
+	}
+}
+
+
+#ifdef MEMORY_CONTEXT_CHECKING
+
+/*
+ * SlabCheck
+ *		Walk through blocks and check consistency of memory.
+ *
+ * NOTE: report errors as WARNING, *not* ERROR or FATAL.  Otherwise you'll
+ * find yourself in an infinite loop when trouble occurs, because this
+ * routine will be entered again when elog cleanup tries to release memory!
+ */
+static void
+SlabCheck(MemoryContext context)
+{
+	Slab		slab = (Slab) context;
+	char	   *name = slab->header.name;
+	SlabBlock	block;
+	bool		seenfull = false;
+
+	for (block = slab->head; block != NULL; block = block->next)
+	{
+		char	   *chunk;
+		int			nfree;
+
+		if (block->slab != slab)
+			elog(WARNING, "problem in slab %s: bogus slab link in block %p",
+				 name, block);
+
+		/* blocks with free chunks must all precede the full ones */
+		if (block->nfree == 0)
+			seenfull = true;
+		else if (seenfull)
+			elog(WARNING, "problem in slab %s: block %p with free chunks follows a full block",
+				 name, block);
+
+		nfree = (block->endptr - block->unused) / slab->fullChunkSize;
+		for (chunk = block->freelist; chunk != NULL;
+			 chunk = SlabChunkNextFree(chunk))
+			nfree++;
+		if (nfree != block->nfree)
+			elog(WARNING, "problem in slab %s: found inconsistent memory block %p",
+				 name, block);
+
+		/*
+		 * Check the allocated chunks.  Chunks on the freelist have their
+		 * requested_size zeroed.
+		 */
+		for (chunk = ((char *) block) + SLAB_BLOCKHDRSZ;
+			 chunk < block->unused;
+			 chunk += slab->fullChunkSize)
+		{
+			StandardChunkHeader *header = SlabChunkGetHeader(chunk);
+			Size		dsize = header->requested_size;
+
+			if (SlabChunkGetBlock(chunk) != block)
+				elog(WARNING, "problem in slab %s: bogus block link in block %p, chunk %p",
+					 name, block, chunk);
+			if (dsize > slab->chunkSize)
+				elog(WARNING, "problem in slab %s: req size > alloc size for chunk %p in block %p",
+					 name, chunk, block);
+			if (dsize > 0 && header->context != context)
+				elog(WARNING, "problem in slab %s: bogus context link in block %p, chunk %p",
+					 name, block, chunk);
+			if (dsize > 0 && dsize < slab->chunkSize &&
+				((char *) SlabChunkGetPointer(chunk))[dsize] != 0x7E)
+				elog(WARNING, "problem in slab %s: detected write past chunk end in block %p, chunk %p",
+					 name, block, chunk);
+		}
+	}
+}
+
+#endif   /* MEMORY_CONTEXT_CHECKING */
@@ -20,7 +20,7 @@
  */
 #include "postgres.h"
 
-#include "access/hash.h"
+#include "storage/bufmgr.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "utils/memutils.h"
@@ -99,6 +99,20 @@ typedef struct ResourceReleaseCallbackItem
 
 static ResourceReleaseCallbackItem *ResourceRelease_callbacks = NULL;
 
+/*
+ * Deleted ResourceOwners are kept on a short freelist, linked through their
+ * nextchild fields, and recycled by ResourceOwnerCreate.  Subtransactions
+ * (for instance a PL/pgSQL exception block entered once per row) create and
+ * delete owners at a high rate, and most of them need the same few small
+ * resource arrays each time, so we keep arrays that haven't grown past their
+ * initial size along with the owner.
+ */
+#define MAX_FREE_RESOURCE_OWNERS	8
+#define RESARRAY_INIT_SIZE			16
+
+static ResourceOwner FreeResourceOwners = NULL;
+static int	nFreeResourceOwners = 0;
+
 
 /* Internal routines */
 static void ResourceOwnerReleaseInternal(ResourceOwner owner,
@@ -129,8 +143,16 @@ ResourceOwnerCreate(ResourceOwner parent, const char *name)
 {
 	ResourceOwner owner;
 
-	owner = (ResourceOwner) MemoryContextAllocZero(TopMemoryContext,
-												   sizeof(ResourceOwnerData));
+	if (FreeResourceOwners != NULL)
+	{
+		owner = FreeResourceOwners;
+		FreeResourceOwners = owner->nextchild;
+		nFreeResourceOwners--;
+		owner->nextchild = NULL;
+	}
+	else
+		owner = (ResourceOwner) MemoryContextAllocZero(TopMemoryContext,
+													sizeof(ResourceOwnerData));
 	owner->name = name;
 
 	if (parent)
@@ -331,9 +353,6 @@ ResourceOwnerReleaseInternal(ResourceOwner owner,
 				PrintFileLeakWarning(owner->files[owner->nfiles - 1]);
 			FileClose(owner->files[owner->nfiles - 1]);
 		}
-
-		/* Clean up index scans too */
-		ReleaseResources_hash();
 	}
 
 	/* Let add-on modules get a chance too */
@@ -379,7 +398,37 @@ ResourceOwnerDelete(ResourceOwner owner)
 	 */
 	ResourceOwnerNewParent(owner, NULL);
 
-	/* And free the object. */
+	/* If there's room on the freelist, keep the object for reuse. */
+	if (nFreeResourceOwners < MAX_FREE_RESOURCE_OWNERS)
+	{
+#define TRIM_RESARRAY(array, max) \
+		do { \
+			if ((array) != NULL && (max) > RESARRAY_INIT_SIZE) \
+			{ \
+				pfree(array); \
+				(array) = NULL; \
+				(max) = 0; \
+			} \
+		} while (0)
+
+		TRIM_RESARRAY(owner->buffers, owner->maxbuffers);
+		TRIM_RESARRAY(owner->catrefs, owner->maxcatrefs);
+		TRIM_RESARRAY(owner->catlistrefs, owner->maxcatlistrefs);
+		TRIM_RESARRAY(owner->relrefs, owner->maxrelrefs);
+		TRIM_RESARRAY(owner->planrefs, owner->maxplanrefs);
+		TRIM_RESARRAY(owner->tupdescs, owner->maxtupdescs);
+		TRIM_RESARRAY(owner->snapshots, owner->maxsnapshots);
+		TRIM_RESARRAY(owner->files, owner->maxfiles);
+#undef TRIM_RESARRAY
+
+		owner->name = NULL;
+		owner->nextchild = FreeResourceOwners;
+		FreeResourceOwners = owner;
+		nFreeResourceOwners++;
+		return;
+	}
+
+	/* Otherwise free the object. */
 	if (owner->buffers)
 		pfree(owner->buffers);
 	if (owner->catrefs)
@@ -517,7 +566,7 @@ ResourceOwnerEnlargeBuffers(ResourceOwner owner)
 
 	if (owner->buffers == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->buffers = (Buffer *)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(Buffer));
 		owner->maxbuffers = newmax;
@@ -605,7 +654,7 @@ ResourceOwnerEnlargeCatCacheRefs(ResourceOwner owner)
 
 	if (owner->catrefs == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->catrefs = (HeapTuple *)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(HeapTuple));
 		owner->maxcatrefs = newmax;
@@ -676,7 +725,7 @@ ResourceOwnerEnlargeCatCacheListRefs(ResourceOwner owner)
 
 	if (owner->catlistrefs == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->catlistrefs = (CatCList **)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(CatCList *));
 		owner->maxcatlistrefs = newmax;
@@ -747,7 +796,7 @@ ResourceOwnerEnlargeRelationRefs(ResourceOwner owner)
 
 	if (owner->relrefs == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->relrefs = (Relation *)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(Relation));
 		owner->maxrelrefs = newmax;
@@ -828,7 +877,7 @@ ResourceOwnerEnlargePlanCacheRefs(ResourceOwner owner)
 
 	if (owner->planrefs == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->planrefs = (CachedPlan **)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(CachedPlan *));
 		owner->maxplanrefs = newmax;
@@ -908,7 +957,7 @@ ResourceOwnerEnlargeTupleDescs(ResourceOwner owner)
 
 	if (owner->tupdescs == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->tupdescs = (TupleDesc *)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(TupleDesc));
 		owner->maxtupdescs = newmax;
@@ -990,7 +1039,7 @@ ResourceOwnerEnlargeSnapshots(ResourceOwner owner)
 
 	if (owner->snapshots == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->snapshots = (Snapshot *)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(Snapshot));
 		owner->maxsnapshots = newmax;
@@ -1073,7 +1122,7 @@ ResourceOwnerEnlargeFiles(ResourceOwner owner)
 
 	if (owner->files == NULL)
 	{
-		newmax = 16;
+		newmax = RESARRAY_INIT_SIZE;
 		owner->files = (File *)
 			MemoryContextAlloc(TopMemoryContext, newmax * sizeof(File));
 		owner->maxfiles = newmax;
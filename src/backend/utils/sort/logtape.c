@@ -78,6 +78,7 @@
 #include "postgres.h"
 
 #include "storage/buffile.h"
+#include "storage/bufmgr.h"
 #include "utils/logtape.h"
 
 /*
@@ -191,6 +192,7 @@ static long ltsRecallNextBlockNum(LogicalTapeSet *lts,
 static long ltsRecallPrevBlockNum(LogicalTapeSet *lts,
 					  IndirectBlock *indirect);
 static void ltsDumpBuffer(LogicalTapeSet *lts, LogicalTape *lt);
+static void ltsPrefetch(LogicalTapeSet *lts, LogicalTape *lt);
 
 
 /*
@@ -233,6 +235,45 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 						blocknum)));
 }
 
+/*
+ * Prefetch the data blocks a reader of the tape is about to need.
+ *
+ * Tapes are read sequentially, but their blocks are scattered over the
+ * file once merge passes recycle space, so the kernel's read-ahead doesn't
+ * help.  Instead, we tell it about the next target_prefetch_pages blocks
+ * recorded in the tape's lowest indirect block, just after reading a data
+ * block.  Once the window is established, only its last block is new; we
+ * don't bother to look ahead across indirect blocks, so the window starts
+ * over at the beginning of each.
+ */
+static void
+ltsPrefetch(LogicalTapeSet *lts, LogicalTape *lt)
+{
+#ifdef USE_PREFETCH
+	IndirectBlock *indirect = lt->indirect;
+	int			first;
+	int			last;
+	int			i;
+
+	if (target_prefetch_pages <= 0 || indirect == NULL)
+		return;
+
+	last = indirect->nextSlot + target_prefetch_pages - 1;
+	if (indirect->nextSlot <= 1)
+		first = indirect->nextSlot;
+	else
+		first = last;
+
+	for (i = indirect->nextSlot; i <= last && i < BLOCKS_PER_INDIR_BLOCK; i++)
+	{
+		if (indirect->ptrs[i] == -1L)
+			break;
+		if (i >= first)
+			BufFilePrefetchBlock(lts->pfile, indirect->ptrs[i]);
+	}
+#endif   /* USE_PREFETCH */
+}
+
 /*
  * qsort comparator for sorting freeBlocks[] into decreasing order.
  */
@@ -727,6 +768,7 @@ LogicalTapeRewind(LogicalTapeSet *lts, int tapenum, bool forWrite)
 				ltsReleaseBlock(lts, datablocknum);
 			lt->nbytes = (lt->curBlockNumber < lt->numFullBlocks) ?
 				BLCKSZ : lt->lastBlockBytes;
+			ltsPrefetch(lts, lt);
 		}
 	}
 	else
@@ -800,6 +842,7 @@ LogicalTapeRead(LogicalTapeSet *lts, int tapenum,
 				BLCKSZ : lt->lastBlockBytes;
 			if (lt->nbytes <= 0)
 				break;			/* EOF (possible here?) */
+			ltsPrefetch(lts, lt);
 		}
 
 		nthistime = lt->nbytes - lt->pos;
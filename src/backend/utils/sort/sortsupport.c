@@ -15,8 +15,13 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
+#include "access/gist.h"
+#include "catalog/pg_am.h"
 #include "fmgr.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
 #include "utils/sortsupport.h"
 
 
@@ -71,6 +76,43 @@ ApplySortComparator(Datum datum1, bool isNull1,
 	return compare;
 }
 
+/*
+ * Like ApplySortComparator, but for comparing the original values when the
+ * abbreviated keys are equal.
+ */
+int
+ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup)
+{
+	int			compare;
+
+	if (isNull1)
+	{
+		if (isNull2)
+			compare = 0;		/* NULL "=" NULL */
+		else if (ssup->ssup_nulls_first)
+			compare = -1;		/* NULL "<" NOT_NULL */
+		else
+			compare = 1;		/* NULL ">" NOT_NULL */
+	}
+	else if (isNull2)
+	{
+		if (ssup->ssup_nulls_first)
+			compare = 1;		/* NOT_NULL ">" NULL */
+		else
+			compare = -1;		/* NOT_NULL "<" NULL */
+	}
+	else
+	{
+		compare = (*ssup->abbrev_full_comparator) (datum1, datum2, ssup);
+		if (ssup->ssup_reverse)
+			compare = -compare;
+	}
+
+	return compare;
+}
+
 #endif   /* ! USE_INLINE */
 
 /*
@@ -158,3 +200,84 @@ PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup)
 		PrepareSortSupportComparisonShim(sortFunction, ssup);
 	}
 }
+
+/*
+ * Fill in SortSupport given a GiST index relation
+ *
+ * Caller must previously have zeroed the SortSupportData structure and then
+ * filled in ssup_cxt, ssup_attno, ssup_collation, and ssup_nulls_first.
+ * This will fill in the comparator function pointer, using the
+ * GIST_SORTSUPPORT_PROC of the column's opclass, which must exist.
+ */
+void
+PrepareSortSupportFromGistIndexRel(Relation indexRel, SortSupport ssup)
+{
+	Oid			opfamily = indexRel->rd_opfamily[ssup->ssup_attno - 1];
+	Oid			opcintype = indexRel->rd_opcintype[ssup->ssup_attno - 1];
+	Oid			sortSupportFunction;
+
+	Assert(ssup->comparator == NULL);
+
+	if (indexRel->rd_rel->relam != GIST_AM_OID)
+		elog(ERROR, "unexpected non-gist AM: %u", indexRel->rd_rel->relam);
+
+	sortSupportFunction = get_opfamily_proc(opfamily, opcintype, opcintype,
+											GIST_SORTSUPPORT_PROC);
+	if (!OidIsValid(sortSupportFunction))
+		elog(ERROR, "missing support function %d(%u,%u) in opfamily %u",
+			 GIST_SORTSUPPORT_PROC, opcintype, opcintype, opfamily);
+
+	OidFunctionCall1(sortSupportFunction, PointerGetDatum(ssup));
+	Assert(ssup->comparator != NULL);
+}
+
+
+/*
+ * Comparators for int4, int8 and float8 representations.  The float8 one
+ * sorts NaNs after everything else, as float8_cmp_internal does.
+ */
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		a = DatumGetInt32(x);
+	int32		b = DatumGetInt32(y);
+
+	if (a > b)
+		return 1;
+	else if (a == b)
+		return 0;
+	else
+		return -1;
+}
+
+int
+ssup_datum_int64_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		a = DatumGetInt64(x);
+	int64		b = DatumGetInt64(y);
+
+	if (a > b)
+		return 1;
+	else if (a == b)
+		return 0;
+	else
+		return -1;
+}
+
+int
+ssup_datum_float8_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	float8		a = DatumGetFloat8(x);
+	float8		b = DatumGetFloat8(y);
+
+	if (isnan(a))
+		return isnan(b) ? 0 : 1;
+	else if (isnan(b))
+		return -1;
+	else if (a > b)
+		return 1;
+	else if (a < b)
+		return -1;
+	else
+		return 0;
+}
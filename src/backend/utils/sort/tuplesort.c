@@ -11,24 +11,20 @@
  * algorithm.
  *
  * See Knuth, volume 3, for more than you want to know about the external
- * sorting algorithm.  We divide the input into sorted runs using replacement
- * selection, in the form of a priority tree implemented as a heap
- * (essentially his Algorithm 5.2.3H), then merge the runs using polyphase
+ * sorting algorithm.  We divide the input into sorted runs by quicksorting
+ * workMem's worth of tuples at a time, then merge the runs using polyphase
  * merge, Knuth's Algorithm 5.4.2D.  The logical "tapes" used by Algorithm D
  * are implemented by logtape.c, which avoids space wastage by recycling
  * disk space as soon as each block is read from its "tape".
  *
- * We do not form the initial runs using Knuth's recommended replacement
- * selection data structure (Algorithm 5.4.1R), because it uses a fixed
- * number of records in memory at all times.  Since we are dealing with
- * tuples that may vary considerably in size, we want to be able to vary
- * the number of records kept in memory to ensure full utilization of the
- * allowed sort memory space.  So, we keep the tuples in a variable-size
- * heap, with the next record to go out at the top of the heap.  Like
- * Algorithm 5.4.1R, each record is stored with the run number that it
- * must go into, and we use (run number, key) as the ordering key for the
- * heap.  When the run number at the top of the heap changes, we know that
- * no more records of the prior run are left in the heap.
+ * We used to form the initial runs by replacement selection, keeping the
+ * tuples in a heap ordered by (run number, key) so that on random input the
+ * runs came out about twice as long as workMem.  But every tuple then costs
+ * a sift through a heap the size of workMem, and once workMem is much larger
+ * than the CPU caches nearly every step of that is a cache miss; quicksort
+ * works on a contiguous and shrinking range of memtuples[] and is much
+ * faster.  Longer runs would only save merge work, and with the merge orders
+ * that a large workMem allows, a single merge pass almost always suffices.
  *
  * The approximate amount of memory allowed for any one sort operation
  * is specified in kilobytes by the caller (most pass work_mem).  Initially,
@@ -36,13 +32,10 @@
  * we haven't exceeded workMem.  If we reach the end of the input without
  * exceeding workMem, we sort the array using qsort() and subsequently return
  * tuples just by scanning the tuple array sequentially.  If we do exceed
- * workMem, we construct a heap using Algorithm H and begin to emit tuples
- * into sorted runs in temporary tapes, emitting just enough tuples at each
- * step to get back within the workMem limit.  Whenever the run number at
- * the top of the heap changes, we begin a new run with a new output tape
- * (selected per Algorithm D).	After the end of the input is reached,
- * we dump out remaining tuples in memory into a final run (or two),
- * then merge the runs using Algorithm D.
+ * workMem, we qsort the array, write it all out as a sorted run on a tape
+ * (selected per Algorithm D), and start filling the array again.  After the
+ * end of the input is reached, whatever is left in memory becomes the final
+ * run, and we merge the runs using Algorithm D.
  *
  * When merging runs, we use a heap containing just the frontmost tuple from
  * each source run; we repeatedly output the smallest tuple and insert the
@@ -99,7 +92,9 @@
 #include "postgres.h"
 
 #include <limits.h>
+#include <math.h>
 
+#include "access/gin_private.h"
 #include "access/nbtree.h"
 #include "catalog/index.h"
 #include "commands/tablespace.h"
@@ -151,11 +146,10 @@ bool		optimize_bounded_sort = true;
  * then datum1 points to a separately palloc'd data value that is also pointed
  * to by the "tuple" pointer; otherwise "tuple" is NULL.
  *
- * While building initial runs, tupindex holds the tuple's run number.  During
- * merge passes, we re-use it to hold the input tape number that each tuple in
- * the heap was read from, or to hold the index of the next tuple pre-read
- * from the same tape in the case of pre-read entries.	tupindex goes unused
- * if the sort occurs entirely in memory.
+ * During merge passes, tupindex holds the input tape number that each tuple
+ * in the heap was read from, or the index of the next tuple pre-read from
+ * the same tape in the case of pre-read entries.  tupindex goes unused while
+ * building initial runs, and if the sort occurs entirely in memory.
  */
 typedef struct
 {
@@ -177,7 +171,8 @@ typedef enum
 	TSS_BUILDRUNS,				/* Loading tuples; writing to tape */
 	TSS_SORTEDINMEM,			/* Sort completed entirely in memory */
 	TSS_SORTEDONTAPE,			/* Sort completed, final run is on tape */
-	TSS_FINALMERGE				/* Performing final merge on-the-fly */
+	TSS_FINALMERGE,				/* Performing final merge on-the-fly */
+	TSS_MERGEINPUTS				/* Merging other sorts' output on-the-fly */
 } TupSortStatus;
 
 /*
@@ -190,8 +185,14 @@ typedef enum
  *
  * MERGE_BUFFER_SIZE is how much data we'd like to read from each input
  * tape during a preread cycle (see discussion at top of file).
+ *
+ * MAXORDER caps the merge order however much memory we have.  Past a few
+ * hundred inputs the merge heap no longer fits in cache, and each input's
+ * share of preread memory gets no bigger; with runs as large as such a
+ * workMem implies, more inputs would hardly ever save a merge pass anyway.
  */
 #define MINORDER		6		/* minimum merge order */
+#define MAXORDER		500		/* maximum merge order */
 #define TAPE_BUFFER_OVERHEAD		(BLCKSZ * 3)
 #define MERGE_BUFFER_SIZE			(BLCKSZ * 32)
 
@@ -263,20 +264,21 @@ struct Tuplesortstate
 	/*
 	 * This array holds the tuples now in sort memory.	If we are in state
 	 * INITIAL, the tuples are in no particular order; if we are in state
-	 * SORTEDINMEM, the tuples are in final sorted order; in states BUILDRUNS
-	 * and FINALMERGE, the tuples are organized in "heap" order per Algorithm
-	 * H.  (Note that memtupcount only counts the tuples that are part of the
-	 * heap --- during merge passes, memtuples[] entries beyond tapeRange are
-	 * never in the heap and are used to hold pre-read tuples.)  In state
-	 * SORTEDONTAPE, the array is not used.
+	 * SORTEDINMEM, the tuples are in final sorted order; in state BUILDRUNS,
+	 * they are the unsorted tuples of the run being collected; in states
+	 * BOUNDED and FINALMERGE, the tuples are organized in "heap" order per
+	 * Algorithm H.  (Note that memtupcount only counts the tuples that are
+	 * part of the heap --- during merge passes, memtuples[] entries beyond
+	 * tapeRange are never in the heap and are used to hold pre-read tuples.)
+	 * In state SORTEDONTAPE, the array is not used.
 	 */
 	SortTuple  *memtuples;		/* array of SortTuple structs */
 	int			memtupcount;	/* number of tuples currently present */
 	int			memtupsize;		/* allocated length of memtuples array */
 
 	/*
-	 * While building initial runs, this is the current output run number
-	 * (starting at 0).  Afterwards, it is the number of initial runs we made.
+	 * While building initial runs, this is the number of runs written so
+	 * far.  Afterwards, it is the number of initial runs we made.
 	 */
 	int			currentRun;
 
@@ -335,6 +337,14 @@ struct Tuplesortstate
 	int			markpos_offset; /* saved "current", or offset in tape block */
 	bool		markpos_eof;	/* saved "eof_reached" */
 
+	/*
+	 * If the sort is by a single key, held in datum1 (as in a MinimalTuple
+	 * sort on one column, or a Datum sort), this points to its SortSupport
+	 * data; otherwise it's NULL.  That lets sort_memtuples use a sort
+	 * routine specialized for the key's comparator.
+	 */
+	SortSupport onlyKey;
+
 	/*
 	 * These variables are specific to the MinimalTuple case; they are set by
 	 * tuplesort_begin_heap and used only by the MinimalTuple routines.
@@ -342,6 +352,13 @@ struct Tuplesortstate
 	TupleDesc	tupDesc;
 	SortSupport	sortKeys;		/* array of length nKeys */
 
+	/*
+	 * If sortKeys[0] uses abbreviated keys, datum1 of each SortTuple holds
+	 * the abbreviated key rather than the value itself.  abbrevNext is the
+	 * tuple count at which we'll next ask whether to give up on them.
+	 */
+	int			abbrevNext;
+
 	/*
 	 * These variables are specific to the CLUSTER case; they are set by
 	 * tuplesort_begin_cluster.  Note CLUSTER also uses tupDesc and
@@ -363,6 +380,19 @@ struct Tuplesortstate
 	/* These are specific to the index_hash subcase: */
 	uint32		hash_mask;		/* mask for sortable part of hash code */
 
+	/* These are specific to the index_gin subcase: */
+	GinState   *ginstate;		/* describes the index's keys */
+
+	/*
+	 * These are used only in state MERGEINPUTS, in which we return the
+	 * merged output of other sorts that have already been performed.  The
+	 * heap in memtuples[] holds the next tuple from each input, and its
+	 * tupindex is the input's number.
+	 */
+	Tuplesortstate **mergeinputs;	/* array of length nmergeinputs */
+	bool	   *mergeinputfree; /* must caller pfree tuples from input? */
+	int			nmergeinputs;
+
 	/*
 	 * These variables are specific to the Datum case; they are set by
 	 * tuplesort_begin_datum and used only by the DatumTuple routines.
@@ -454,8 +484,13 @@ static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple,
 					  int tupleindex, bool checkIndex);
 static void tuplesort_heap_siftup(Tuplesortstate *state, bool checkIndex);
+static bool mergeinput_next(Tuplesortstate *state, int srcInput,
+				SortTuple *stup);
 static unsigned int getlen(Tuplesortstate *state, int tapenum, bool eofOK);
 static void markrunend(Tuplesortstate *state, int tapenum);
+static void sort_memtuples(Tuplesortstate *state);
+static bool consider_abort_abbrev(Tuplesortstate *state);
+static void stop_abbrev(Tuplesortstate *state);
 static int comparetup_heap(const SortTuple *a, const SortTuple *b,
 				Tuplesortstate *state);
 static void copytup_heap(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -473,6 +508,8 @@ static void readtup_cluster(Tuplesortstate *state, SortTuple *stup,
 				int tapenum, unsigned int len);
 static int comparetup_index_btree(const SortTuple *a, const SortTuple *b,
 					   Tuplesortstate *state);
+static int comparetup_index_gist(const SortTuple *a, const SortTuple *b,
+					  Tuplesortstate *state);
 static int comparetup_index_hash(const SortTuple *a, const SortTuple *b,
 					  Tuplesortstate *state);
 static void copytup_index(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -481,7 +518,15 @@ static void writetup_index(Tuplesortstate *state, int tapenum,
 static void readtup_index(Tuplesortstate *state, SortTuple *stup,
 			  int tapenum, unsigned int len);
 static void reversedirection_index_btree(Tuplesortstate *state);
+static void reversedirection_index_gist(Tuplesortstate *state);
 static void reversedirection_index_hash(Tuplesortstate *state);
+static int comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state);
+static void copytup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  void *tup);
+static void readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  int tapenum, unsigned int len);
+static void reversedirection_index_gin(Tuplesortstate *state);
 static int comparetup_datum(const SortTuple *a, const SortTuple *b,
 				 Tuplesortstate *state);
 static void copytup_datum(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -627,10 +672,17 @@ tuplesort_begin_heap(TupleDesc tupDesc,
 		sortKey->ssup_collation = sortCollations[i];
 		sortKey->ssup_nulls_first = nullsFirstFlags[i];
 		sortKey->ssup_attno = attNums[i];
+		/* Only the leading key is kept in datum1, so can be abbreviated */
+		sortKey->abbreviate = (i == 0);
 
 		PrepareSortSupportFromOrderingOp(sortOperators[i], sortKey);
 	}
 
+	state->abbrevNext = 10000;
+
+	if (nkeys == 1)
+		state->onlyKey = state->sortKeys;
+
 	MemoryContextSwitchTo(oldcontext);
 
 	return state;
@@ -652,11 +704,11 @@ tuplesort_begin_cluster(TupleDesc tupDesc,
 	if (trace_sort)
 		elog(LOG,
 			 "begin tuple sort: nkeys = %d, workMem = %d, randomAccess = %c",
-			 RelationGetNumberOfAttributes(indexRel),
+			 IndexRelationGetNumberOfKeyAttributes(indexRel),
 			 workMem, randomAccess ? 't' : 'f');
 #endif
 
-	state->nKeys = RelationGetNumberOfAttributes(indexRel);
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
 
 	TRACE_POSTGRESQL_SORT_START(CLUSTER_SORT,
 								false,	/* no unique check */
@@ -715,7 +767,7 @@ tuplesort_begin_index_btree(Relation indexRel,
 			 workMem, randomAccess ? 't' : 'f');
 #endif
 
-	state->nKeys = RelationGetNumberOfAttributes(indexRel);
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
 
 	TRACE_POSTGRESQL_SORT_START(INDEX_SORT,
 								enforceUnique,
@@ -738,6 +790,129 @@ tuplesort_begin_index_btree(Relation indexRel,
 	return state;
 }
 
+/*
+ * Begin a sort that merges the output of ninputs btree index sorts, all on
+ * indexRel and all already performed.  This lets an index build divide its
+ * input into parts that are sorted separately, then read the whole lot back
+ * in one stream.  Uniqueness is checked across the inputs if enforceUnique
+ * is set; within each input, it is up to the input's own sort.
+ *
+ * The inputs must not be ended until this sort is.  The returned sort needs
+ * no tuplesort_performsort call (though one is harmless), and supports only
+ * forward reading, with tuplesort_getindextuple.
+ */
+Tuplesortstate *
+tuplesort_begin_index_merge(Relation indexRel, bool enforceUnique,
+							Tuplesortstate **inputs, int ninputs)
+{
+	Tuplesortstate *state = tuplesort_begin_common(work_mem, false);
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index merge: unique = %c, inputs = %d",
+			 enforceUnique ? 't' : 'f', ninputs);
+#endif
+
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
+
+	state->comparetup = comparetup_index_btree;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index;
+	state->readtup = readtup_index;
+	state->reversedirection = reversedirection_index_btree;
+
+	state->indexRel = indexRel;
+	state->indexScanKey = _bt_mkscankey_nodata(indexRel);
+	state->enforceUnique = enforceUnique;
+
+	/* the initial memtuples[] array is far bigger than any sane ninputs */
+	Assert(ninputs > 0 && ninputs <= state->memtupsize);
+
+	state->mergeinputs = (Tuplesortstate **)
+		palloc(ninputs * sizeof(Tuplesortstate *));
+	memcpy(state->mergeinputs, inputs, ninputs * sizeof(Tuplesortstate *));
+	state->mergeinputfree = (bool *) palloc0(ninputs * sizeof(bool));
+	state->nmergeinputs = ninputs;
+
+	/* Load the first tuple of each input into the heap */
+	for (i = 0; i < ninputs; i++)
+	{
+		SortTuple	stup;
+
+		if (mergeinput_next(state, i, &stup))
+			tuplesort_heap_insert(state, &stup, i, false);
+	}
+
+	state->status = TSS_MERGEINPUTS;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+/*
+ * Begin a sort of GiST index tuples, ordered by the sort support functions
+ * of the index columns' opclasses, which must all have one.
+ */
+Tuplesortstate *
+tuplesort_begin_index_gist(Relation indexRel,
+						   int workMem, bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, randomAccess);
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = RelationGetNumberOfAttributes(indexRel);
+
+	TRACE_POSTGRESQL_SORT_START(INDEX_SORT,
+								false,	/* no unique check */
+								state->nKeys,
+								workMem,
+								randomAccess);
+
+	state->comparetup = comparetup_index_gist;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index;
+	state->readtup = readtup_index;
+	state->reversedirection = reversedirection_index_gist;
+
+	state->indexRel = indexRel;
+
+	/* Prepare SortSupport data for each column */
+	state->sortKeys = (SortSupport) palloc0(state->nKeys *
+											sizeof(SortSupportData));
+
+	for (i = 0; i < state->nKeys; i++)
+	{
+		SortSupport	sortKey = state->sortKeys + i;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = indexRel->rd_indcollation[i];
+		sortKey->ssup_nulls_first = false;
+		sortKey->ssup_attno = i + 1;
+
+		PrepareSortSupportFromGistIndexRel(indexRel, sortKey);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_index_hash(Relation indexRel,
 						   uint32 hash_mask,
@@ -773,6 +948,50 @@ tuplesort_begin_index_hash(Relation indexRel,
 	return state;
 }
 
+/*
+ * Begin a sort of GIN leaf tuples, as made by GinFormTuple with a non-empty
+ * posting list, ordered by key and then by the first item of the posting
+ * list; see ginCompareBuildTuples.  The sort does not copy ginstate, which
+ * must live as long as the sort does.
+ */
+Tuplesortstate *
+tuplesort_begin_index_gin(Relation indexRel, GinState *ginstate,
+						  int workMem, bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, randomAccess);
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(state->sortcontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = 1;			/* the key and TID count as one sort column */
+
+	TRACE_POSTGRESQL_SORT_START(INDEX_SORT,
+								false,	/* no unique check */
+								state->nKeys,
+								workMem,
+								randomAccess);
+
+	state->comparetup = comparetup_index_gin;
+	state->copytup = copytup_index_gin;
+	state->writetup = writetup_index;
+	state->readtup = readtup_index_gin;
+	state->reversedirection = reversedirection_index_gin;
+
+	state->indexRel = indexRel;
+	state->ginstate = ginstate;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 					  bool nullsFirstFlag,
@@ -817,6 +1036,8 @@ tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 
 	PrepareSortSupportFromOrderingOp(sortOperator, state->datumKey);
 
+	state->onlyKey = state->datumKey;
+
 	/* lookup necessary attributes of the datum type */
 	get_typlenbyval(datumType, &typlen, &typbyval);
 	state->datumTypeLen = typlen;
@@ -1169,26 +1390,15 @@ puttuple_common(Tuplesortstate *state, SortTuple *tuple)
 		case TSS_BUILDRUNS:
 
 			/*
-			 * Insert the tuple into the heap, with run number currentRun if
-			 * it can go into the current run, else run number currentRun+1.
-			 * The tuple can go into the current run if it is >= the first
-			 * not-yet-output tuple.  (Actually, it could go into the current
-			 * run if it is >= the most recently output tuple ... but that
-			 * would require keeping around the tuple we last output, and it's
-			 * simplest to let writetup free each tuple as soon as it's
-			 * written.)
-			 *
-			 * Note there will always be at least one tuple in the heap at
-			 * this point; see dumptuples.
+			 * Save the tuple into the unsorted array of the next run.  There
+			 * is always room for it, since dumptuples empties the array
+			 * whenever it fills up.
 			 */
-			Assert(state->memtupcount > 0);
-			if (COMPARETUP(state, tuple, &state->memtuples[0]) >= 0)
-				tuplesort_heap_insert(state, tuple, state->currentRun, true);
-			else
-				tuplesort_heap_insert(state, tuple, state->currentRun + 1, true);
+			Assert(state->memtupcount < state->memtupsize);
+			state->memtuples[state->memtupcount++] = *tuple;
 
 			/*
-			 * If we are over the memory limit, dump tuples till we're under.
+			 * If we are out of memory or array slots, write out the run.
 			 */
 			dumptuples(state, false);
 			break;
@@ -1221,12 +1431,7 @@ tuplesort_performsort(Tuplesortstate *state)
 			 * We were able to accumulate all the tuples within the allowed
 			 * amount of memory.  Just qsort 'em and we're done.
 			 */
-			if (state->memtupcount > 1)
-				qsort_arg((void *) state->memtuples,
-						  state->memtupcount,
-						  sizeof(SortTuple),
-						  (qsort_arg_comparator) state->comparetup,
-						  (void *) state);
+			sort_memtuples(state);
 			state->current = 0;
 			state->eof_reached = false;
 			state->markpos_offset = 0;
@@ -1265,6 +1470,10 @@ tuplesort_performsort(Tuplesortstate *state)
 			state->markpos_eof = false;
 			break;
 
+		case TSS_MERGEINPUTS:
+			/* nothing to do; the inputs have been sorted already */
+			break;
+
 		default:
 			elog(ERROR, "invalid tuplesort state");
 			break;
@@ -1481,12 +1690,49 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 			}
 			return false;
 
+		case TSS_MERGEINPUTS:
+			Assert(forward);
+			if (state->memtupcount > 0)
+			{
+				int			srcInput = state->memtuples[0].tupindex;
+				SortTuple	newtup;
+
+				*stup = state->memtuples[0];
+				*should_free = state->mergeinputfree[srcInput];
+				tuplesort_heap_siftup(state, false);
+				if (mergeinput_next(state, srcInput, &newtup))
+					tuplesort_heap_insert(state, &newtup, srcInput, false);
+				return true;
+			}
+			*should_free = false;
+			return false;
+
 		default:
 			elog(ERROR, "invalid tuplesort state");
 			return false;		/* keep compiler quiet */
 	}
 }
 
+/*
+ * Fetch the next tuple of input number srcInput of a MERGEINPUTS sort.
+ * The tuple is read in the input's own memory context, just as if its
+ * owner had called tuplesort_getindextuple on it.
+ */
+static bool
+mergeinput_next(Tuplesortstate *state, int srcInput, SortTuple *stup)
+{
+	Tuplesortstate *input = state->mergeinputs[srcInput];
+	MemoryContext oldcontext = MemoryContextSwitchTo(input->sortcontext);
+	bool		found;
+
+	found = tuplesort_gettuple_common(input, true, stup,
+									  &state->mergeinputfree[srcInput]);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return found;
+}
+
 /*
  * Fetch the next tuple in either forward or back direction.
  * If successful, put tuple in slot and return TRUE; else, clear the slot
@@ -1622,6 +1868,8 @@ tuplesort_merge_order(long allowedMem)
 
 	/* Even in minimum memory, use at least a MINORDER merge */
 	mOrder = Max(mOrder, MINORDER);
+	/* ... but no more than MAXORDER however much memory we have */
+	mOrder = Min(mOrder, MAXORDER);
 
 	return mOrder;
 }
@@ -1635,7 +1883,6 @@ static void
 inittapes(Tuplesortstate *state)
 {
 	int			maxTapes,
-				ntuples,
 				j;
 	long		tapeSpace;
 
@@ -1692,25 +1939,7 @@ inittapes(Tuplesortstate *state)
 	state->tp_dummy = (int *) palloc0(maxTapes * sizeof(int));
 	state->tp_tapenum = (int *) palloc0(maxTapes * sizeof(int));
 
-	/*
-	 * Convert the unsorted contents of memtuples[] into a heap. Each tuple is
-	 * marked as belonging to run number zero.
-	 *
-	 * NOTE: we pass false for checkIndex since there's no point in comparing
-	 * indexes in this step, even though we do intend the indexes to be part
-	 * of the sort key...
-	 */
-	ntuples = state->memtupcount;
-	state->memtupcount = 0;		/* make the heap empty */
-	for (j = 0; j < ntuples; j++)
-	{
-		/* Must copy source tuple to avoid possible overwrite */
-		SortTuple	stup = state->memtuples[j];
-
-		tuplesort_heap_insert(state, &stup, 0, false);
-	}
-	Assert(state->memtupcount == ntuples);
-
+	/* The unsorted contents of memtuples[] will become the first run */
 	state->currentRun = 0;
 
 	/*
@@ -1785,9 +2014,15 @@ mergeruns(Tuplesortstate *state)
 	Assert(state->memtupcount == 0);
 
 	/*
-	 * If we produced only one initial run (quite likely if the total data
-	 * volume is between 1X and 2X workMem), we can just use that tape as the
-	 * finished output, rather than doing a useless merge.	(This obvious
+	 * Tuples read back from tape carry their original leading key values,
+	 * not abbreviated ones, so merging has to compare those.
+	 */
+	if (state->sortKeys != NULL && state->sortKeys->abbrev_converter)
+		stop_abbrev(state);
+
+	/*
+	 * If we produced only one initial run, we can just use that tape as the
+	 * finished output, rather than doing a useless merge.  (This obvious
 	 * optimization is not in Knuth's algorithm.)
 	 */
 	if (state->currentRun == 1)
@@ -1799,6 +2034,18 @@ mergeruns(Tuplesortstate *state)
 		return;
 	}
 
+	/*
+	 * If there were fewer runs than input tapes, the tapes that never got a
+	 * run will never be read or written, so the buffer space inittapes set
+	 * aside for them (if it did; the test here must match its test) can go
+	 * to prereading from the others instead.
+	 */
+	if (state->currentRun < state->tapeRange &&
+		state->maxTapes * TAPE_BUFFER_OVERHEAD +
+		GetMemoryChunkSpace(state->memtuples) < state->allowedMem)
+		FREEMEM(state, (state->tapeRange - state->currentRun) *
+				TAPE_BUFFER_OVERHEAD);
+
 	/* End of step D2: rewind all output tapes to prepare for merging */
 	for (tapenum = 0; tapenum < state->tapeRange; tapenum++)
 		LogicalTapeRewind(state->tapeset, tapenum, false);
@@ -2152,67 +2399,51 @@ mergeprereadone(Tuplesortstate *state, int srcTape)
 }
 
 /*
- * dumptuples - remove tuples from heap and write to tape
+ * dumptuples - sort the tuples in memory and write them out as a run
  *
  * This is used during initial-run building, but not during merging.
  *
- * When alltuples = false, dump only enough tuples to get under the
- * availMem limit (and leave at least one tuple in the heap in any case,
- * since puttuple assumes it always has a tuple to compare to).  We also
- * insist there be at least one free slot in the memtuples[] array.
- *
- * When alltuples = true, dump everything currently in memory.
- * (This case is only used at end of input data.)
+ * When alltuples = false, do nothing unless we are out of memory or out
+ * of memtuples[] slots; then write out everything, and select the tape
+ * for the next run.
  *
- * If we empty the heap, close out the current run and return (this should
- * only happen at end of input data).  If we see that the tuple run number
- * at the top of the heap has changed, start a new run.
+ * When alltuples = true, write out everything currently in memory as the
+ * final run.  (This case is only used at end of input data.)  That run may
+ * be empty, if the input happened to end just after a run was written;
+ * the merge copes with empty runs, and that's simpler than taking back the
+ * selectnewtape call that was made for it.
  */
 static void
 dumptuples(Tuplesortstate *state, bool alltuples)
 {
-	while (alltuples ||
-		   (LACKMEM(state) && state->memtupcount > 1) ||
-		   state->memtupcount >= state->memtupsize)
-	{
-		/*
-		 * Dump the heap's frontmost entry, and sift up to remove it from the
-		 * heap.
-		 */
-		Assert(state->memtupcount > 0);
+	int			i;
+
+	if (!alltuples && state->memtupcount < state->memtupsize &&
+		!LACKMEM(state))
+		return;
+
+	sort_memtuples(state);
+
+	for (i = 0; i < state->memtupcount; i++)
 		WRITETUP(state, state->tp_tapenum[state->destTape],
-				 &state->memtuples[0]);
-		tuplesort_heap_siftup(state, true);
+				 &state->memtuples[i]);
+	state->memtupcount = 0;
 
-		/*
-		 * If the heap is empty *or* top run number has changed, we've
-		 * finished the current run.
-		 */
-		if (state->memtupcount == 0 ||
-			state->currentRun != state->memtuples[0].tupindex)
-		{
-			markrunend(state, state->tp_tapenum[state->destTape]);
-			state->currentRun++;
-			state->tp_runs[state->destTape]++;
-			state->tp_dummy[state->destTape]--; /* per Alg D step D2 */
+	markrunend(state, state->tp_tapenum[state->destTape]);
+	state->currentRun++;
+	state->tp_runs[state->destTape]++;
+	state->tp_dummy[state->destTape]--; /* per Alg D step D2 */
 
 #ifdef TRACE_SORT
-			if (trace_sort)
-				elog(LOG, "finished writing%s run %d to tape %d: %s",
-					 (state->memtupcount == 0) ? " final" : "",
-					 state->currentRun, state->destTape,
-					 pg_rusage_show(&state->ru_start));
+	if (trace_sort)
+		elog(LOG, "finished writing%s run %d to tape %d: %s",
+			 alltuples ? " final" : "",
+			 state->currentRun, state->destTape,
+			 pg_rusage_show(&state->ru_start));
 #endif
 
-			/*
-			 * Done if heap is empty, else prepare for new run.
-			 */
-			if (state->memtupcount == 0)
-				break;
-			Assert(state->currentRun == state->memtuples[0].tupindex);
-			selectnewtape(state);
-		}
-	}
+	if (!alltuples)
+		selectnewtape(state);
 }
 
 /*
@@ -2578,6 +2809,189 @@ markrunend(Tuplesortstate *state, int tapenum)
 	LogicalTapeWrite(state->tapeset, tapenum, (void *) &len, sizeof(len));
 }
 
+/*
+ * Single-key comparisons with the comparator inlined, for the specialized
+ * sort routines below.  Like ApplySortComparator, but with the comparator
+ * known in advance.
+ */
+static inline int
+qsort_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int32		x,
+				y;
+	int			compare;
+
+	if (a->isnull1 || b->isnull1)
+		return ApplySortComparator(a->datum1, a->isnull1,
+								   b->datum1, b->isnull1,
+								   state->onlyKey);
+	x = DatumGetInt32(a->datum1);
+	y = DatumGetInt32(b->datum1);
+	compare = (x > y) ? 1 : ((x < y) ? -1 : 0);
+	return state->onlyKey->ssup_reverse ? -compare : compare;
+}
+
+static inline int
+qsort_int64_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int64		x,
+				y;
+	int			compare;
+
+	if (a->isnull1 || b->isnull1)
+		return ApplySortComparator(a->datum1, a->isnull1,
+								   b->datum1, b->isnull1,
+								   state->onlyKey);
+	x = DatumGetInt64(a->datum1);
+	y = DatumGetInt64(b->datum1);
+	compare = (x > y) ? 1 : ((x < y) ? -1 : 0);
+	return state->onlyKey->ssup_reverse ? -compare : compare;
+}
+
+static inline int
+qsort_float8_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	float8		x,
+				y;
+	int			compare;
+
+	if (a->isnull1 || b->isnull1)
+		return ApplySortComparator(a->datum1, a->isnull1,
+								   b->datum1, b->isnull1,
+								   state->onlyKey);
+	x = DatumGetFloat8(a->datum1);
+	y = DatumGetFloat8(b->datum1);
+	/* NaNs sort after everything else, as in ssup_datum_float8_cmp */
+	if (isnan(x))
+		compare = isnan(y) ? 0 : 1;
+	else if (isnan(y))
+		compare = -1;
+	else
+		compare = (x > y) ? 1 : ((x < y) ? -1 : 0);
+	return state->onlyKey->ssup_reverse ? -compare : compare;
+}
+
+#define ST_SORT qsort_tuple_int32
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_int32_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#include "lib/sort_template.h"
+
+#define ST_SORT qsort_tuple_int64
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_int64_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#include "lib/sort_template.h"
+
+#define ST_SORT qsort_tuple_float8
+#define ST_ELEMENT_TYPE SortTuple
+#define ST_COMPARE(a, b, state) qsort_float8_compare(a, b, state)
+#define ST_COMPARE_ARG_TYPE Tuplesortstate
+#include "lib/sort_template.h"
+
+/*
+ * sort_memtuples - quicksort the tuples in memtuples[]
+ *
+ * If the sort is on a single key whose comparator is one of the standard
+ * ones from sortsupport.h, we use a sort routine with the comparison
+ * inlined; otherwise qsort_arg with the comparetup routine.
+ */
+static void
+sort_memtuples(Tuplesortstate *state)
+{
+	SortSupport onlyKey = state->onlyKey;
+
+	if (state->memtupcount <= 1)
+		return;
+
+	if (onlyKey != NULL && onlyKey->abbrev_converter == NULL)
+	{
+		if (onlyKey->comparator == ssup_datum_int32_cmp)
+		{
+			qsort_tuple_int32(state->memtuples, state->memtupcount, state);
+			return;
+		}
+		if (onlyKey->comparator == ssup_datum_int64_cmp)
+		{
+			qsort_tuple_int64(state->memtuples, state->memtupcount, state);
+			return;
+		}
+		if (onlyKey->comparator == ssup_datum_float8_cmp)
+		{
+			qsort_tuple_float8(state->memtuples, state->memtupcount, state);
+			return;
+		}
+	}
+
+	qsort_arg((void *) state->memtuples,
+			  state->memtupcount,
+			  sizeof(SortTuple),
+			  (qsort_arg_comparator) state->comparetup,
+			  (void *) state);
+}
+
+/*
+ * consider_abort_abbrev - should we give up on abbreviated keys?
+ *
+ * Called as each tuple is added while the leading key is being abbreviated.
+ * Every so often (with the interval doubling each time, to bound the
+ * overhead) the opclass gets to judge from the keys seen so far whether
+ * the abbreviations are paying for themselves.  If they aren't, we go back
+ * to sorting by the values themselves, and return TRUE.
+ */
+static bool
+consider_abort_abbrev(Tuplesortstate *state)
+{
+	SortSupport sortKey = state->sortKeys;
+
+	Assert(sortKey->abbrev_converter != NULL);
+
+	/* Only worth asking while we're still collecting the first run */
+	if (state->status != TSS_INITIAL ||
+		state->memtupcount < state->abbrevNext)
+		return false;
+
+	state->abbrevNext *= 2;
+
+	if (!sortKey->abbrev_abort(state->memtupcount, sortKey))
+		return false;
+
+	stop_abbrev(state);
+	return true;
+}
+
+/*
+ * stop_abbrev - go back to sorting the leading key by its values
+ *
+ * Any tuples already in memory get their datum1 recomputed from the tuple
+ * itself.  The sort order is unchanged, since abbreviated comparisons with
+ * their tie-breaks order tuples just as the full comparator does, so this
+ * is safe even while memtuples is a heap.
+ */
+static void
+stop_abbrev(Tuplesortstate *state)
+{
+	SortSupport sortKey = state->sortKeys;
+	int			i;
+
+	sortKey->comparator = sortKey->abbrev_full_comparator;
+	sortKey->abbrev_converter = NULL;
+	sortKey->abbrev_abort = NULL;
+	sortKey->abbrev_full_comparator = NULL;
+
+	for (i = 0; i < state->memtupcount; i++)
+	{
+		SortTuple  *stup = &state->memtuples[i];
+		HeapTupleData htup;
+
+		htup.t_len = ((MinimalTuple) stup->tuple)->t_len + MINIMAL_TUPLE_OFFSET;
+		htup.t_data = (HeapTupleHeader) ((char *) stup->tuple -
+										 MINIMAL_TUPLE_OFFSET);
+		stup->datum1 = heap_getattr(&htup, sortKey->ssup_attno,
+									state->tupDesc, &stup->isnull1);
+	}
+}
+
 
 /*
  * Inline-able copy of FunctionCall2Coll() to save some cycles in sorting.
@@ -2676,6 +3090,26 @@ comparetup_heap(const SortTuple *a, const SortTuple *b, Tuplesortstate *state)
 	rtup.t_len = ((MinimalTuple) b->tuple)->t_len + MINIMAL_TUPLE_OFFSET;
 	rtup.t_data = (HeapTupleHeader) ((char *) b->tuple - MINIMAL_TUPLE_OFFSET);
 	tupDesc = state->tupDesc;
+
+	/* Equal abbreviated keys don't mean equal values; compare those */
+	if (sortKey->abbrev_converter)
+	{
+		AttrNumber	attno = sortKey->ssup_attno;
+		Datum		datum1,
+					datum2;
+		bool		isnull1,
+					isnull2;
+
+		datum1 = heap_getattr(&ltup, attno, tupDesc, &isnull1);
+		datum2 = heap_getattr(&rtup, attno, tupDesc, &isnull2);
+
+		compare = ApplySortAbbrevFullComparator(datum1, isnull1,
+												datum2, isnull2,
+												sortKey);
+		if (compare != 0)
+			return compare;
+	}
+
 	sortKey++;
 	for (nkey = 1; nkey < state->nKeys; nkey++, sortKey++)
 	{
@@ -2720,6 +3154,12 @@ copytup_heap(Tuplesortstate *state, SortTuple *stup, void *tup)
 								state->sortKeys[0].ssup_attno,
 								state->tupDesc,
 								&stup->isnull1);
+
+	/* replace it with its abbreviated key, if we're still using those */
+	if (state->sortKeys[0].abbrev_converter && !stup->isnull1 &&
+		!consider_abort_abbrev(state))
+		stup->datum1 = state->sortKeys[0].abbrev_converter(stup->datum1,
+														   state->sortKeys);
 }
 
 static void
@@ -2971,8 +3411,8 @@ readtup_cluster(Tuplesortstate *state, SortTuple *stup,
 /*
  * Routines specialized for IndexTuple case
  *
- * The btree and hash cases require separate comparison functions, but the
- * IndexTuple representation is the same so the copy/write/read support
+ * The btree, GiST and hash cases require separate comparison functions, but
+ * the IndexTuple representation is the same so the copy/write/read support
  * functions can be shared.
  */
 
@@ -3092,6 +3532,52 @@ comparetup_index_btree(const SortTuple *a, const SortTuple *b,
 	return 0;
 }
 
+static int
+comparetup_index_gist(const SortTuple *a, const SortTuple *b,
+					  Tuplesortstate *state)
+{
+	SortSupport sortKey = state->sortKeys;
+	IndexTuple	tuple1;
+	IndexTuple	tuple2;
+	TupleDesc	tupDes;
+	int			nkey;
+	int32		compare;
+
+	/* Allow interrupting long sorts */
+	CHECK_FOR_INTERRUPTS();
+
+	/* Compare the leading sort key */
+	compare = ApplySortComparator(a->datum1, a->isnull1,
+								  b->datum1, b->isnull1,
+								  sortKey);
+	if (compare != 0)
+		return compare;
+
+	/* Compare additional sort keys */
+	tuple1 = (IndexTuple) a->tuple;
+	tuple2 = (IndexTuple) b->tuple;
+	tupDes = RelationGetDescr(state->indexRel);
+	sortKey++;
+	for (nkey = 2; nkey <= state->nKeys; nkey++, sortKey++)
+	{
+		Datum		datum1,
+					datum2;
+		bool		isnull1,
+					isnull2;
+
+		datum1 = index_getattr(tuple1, nkey, tupDes, &isnull1);
+		datum2 = index_getattr(tuple2, nkey, tupDes, &isnull2);
+
+		compare = ApplySortComparator(datum1, isnull1,
+									  datum2, isnull2,
+									  sortKey);
+		if (compare != 0)
+			return compare;		/* done when we find unequal attributes */
+	}
+
+	return 0;
+}
+
 static int
 comparetup_index_hash(const SortTuple *a, const SortTuple *b,
 					  Tuplesortstate *state)
@@ -3216,6 +3702,19 @@ reversedirection_index_btree(Tuplesortstate *state)
 	}
 }
 
+static void
+reversedirection_index_gist(Tuplesortstate *state)
+{
+	SortSupport	sortKey = state->sortKeys;
+	int			nkey;
+
+	for (nkey = 0; nkey < state->nKeys; nkey++, sortKey++)
+	{
+		sortKey->ssup_reverse = !sortKey->ssup_reverse;
+		sortKey->ssup_nulls_first = !sortKey->ssup_nulls_first;
+	}
+}
+
 static void
 reversedirection_index_hash(Tuplesortstate *state)
 {
@@ -3223,6 +3722,65 @@ reversedirection_index_hash(Tuplesortstate *state)
 	elog(ERROR, "reversedirection_index_hash is not implemented");
 }
 
+/*
+ * Routines specialized for GIN leaf tuples.  Their columns depend on which
+ * index column the key belongs to, so datum1 isn't used; writetup_index
+ * serves for writing them out.
+ */
+
+static int
+comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state)
+{
+	/* Allow interrupting long sorts */
+	CHECK_FOR_INTERRUPTS();
+
+	return ginCompareBuildTuples(state->ginstate,
+								 (IndexTuple) a->tuple,
+								 (IndexTuple) b->tuple);
+}
+
+static void
+copytup_index_gin(Tuplesortstate *state, SortTuple *stup, void *tup)
+{
+	IndexTuple	tuple = (IndexTuple) tup;
+	unsigned int tuplen = IndexTupleSize(tuple);
+	IndexTuple	newtuple;
+
+	/* copy the tuple into sort storage */
+	newtuple = (IndexTuple) palloc(tuplen);
+	memcpy(newtuple, tuple, tuplen);
+	USEMEM(state, GetMemoryChunkSpace(newtuple));
+	stup->tuple = (void *) newtuple;
+	stup->datum1 = (Datum) 0;
+	stup->isnull1 = true;
+}
+
+static void
+readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  int tapenum, unsigned int len)
+{
+	unsigned int tuplen = len - sizeof(unsigned int);
+	IndexTuple	tuple = (IndexTuple) palloc(tuplen);
+
+	USEMEM(state, GetMemoryChunkSpace(tuple));
+	LogicalTapeReadExact(state->tapeset, tapenum,
+						 tuple, tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeReadExact(state->tapeset, tapenum,
+							 &tuplen, sizeof(tuplen));
+	stup->tuple = (void *) tuple;
+	stup->datum1 = (Datum) 0;
+	stup->isnull1 = true;
+}
+
+static void
+reversedirection_index_gin(Tuplesortstate *state)
+{
+	/* We don't support reversing direction in a GIN index sort */
+	elog(ERROR, "reversedirection_index_gin is not implemented");
+}
+
 
 /*
  * Routines specialized for DatumTuple case
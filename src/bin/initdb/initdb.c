@@ -2539,8 +2539,7 @@ main(int argc, char *argv[])
 		"pg_multixact/offsets",
 		"base",
 		"base/1",
-		"pg_tblspc",
-		"pg_stat_tmp"
+		"pg_tblspc"
 	};
 
 	progname = get_progname(argv[0]);
@@ -19,9 +19,12 @@
 #define FRONTEND 1
 #include "postgres.h"
 #include "libpq-fe.h"
+#include "pqexpbuffer.h"
 
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -32,6 +35,7 @@
 
 #include "getopt_long.h"
 
+#include "replication/basebackup.h"
 #include "receivelog.h"
 #include "streamutil.h"
 
@@ -47,6 +51,8 @@ bool		includewal = false;
 bool		streamwal = false;
 bool		fastcheckpoint = false;
 int			standby_message_timeout = 10;		/* 10 sec = default */
+int			jobs = 1;
+char	   *incremental = NULL;
 
 /* Progress counters */
 static uint64 totalsize;
@@ -76,6 +82,16 @@ static void progress_report(int tablespacenum, const char *filename);
 
 static void ReceiveTarFile(PGconn *conn, PGresult *res, int rownum);
 static void ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum);
+static void close_unpacked_file(FILE *file, const char *filename);
+static void apply_incremental_file(const char *incrpath);
+static void AppendQuotedOption(PQExpBuffer buf, const char *option,
+				   const char *value);
+#ifndef WIN32
+static void ReceiveShards(void);
+static int	ReceiveShard(int shard);
+#endif
+static void WaitForLogStreamer(char *xlogend);
+static void WriteBackupLabel(const char *contents);
 static void BaseBackup(void);
 
 static bool segment_callback(XLogRecPtr segendpos, uint32 timeline);
@@ -106,12 +122,16 @@ usage(void)
 	printf(_("\nOptions controlling the output:\n"));
 	printf(_("  -D, --pgdata=DIRECTORY   receive base backup into directory\n"));
 	printf(_("  -F, --format=p|t         output format (plain (default), tar)\n"));
+	printf(_("  -i, --incremental=LOCATION\n"
+			 "                           update an earlier backup in the directory,\n"
+			 "                           sending only blocks changed since LOCATION\n"));
 	printf(_("  -x, --xlog=fetch|stream  include required WAL files in backup\n"));
 	printf(_("  -z, --gzip               compress tar output\n"));
 	printf(_("  -Z, --compress=0-9       compress tar output with given compression level\n"));
 	printf(_("\nGeneral options:\n"));
 	printf(_("  -c, --checkpoint=fast|spread\n"
 		   "                           set fast or spread checkpointing\n"));
+	printf(_("  -j, --jobs=NUM           use this many parallel connections to copy files\n"));
 	printf(_("  -l, --label=LABEL        set backup label\n"));
 	printf(_("  -P, --progress           show progress information\n"));
 	printf(_("  -v, --verbose            output verbose messages\n"));
@@ -353,8 +373,11 @@ verify_dir_is_empty_or_create(char *dirname)
 		case 2:
 
 			/*
-			 * Exists, not empty
+			 * Exists, not empty.  That's expected for an incremental backup,
+			 * which updates the earlier backup in place.
 			 */
+			if (incremental != NULL)
+				return;
 			fprintf(stderr,
 					_("%s: directory \"%s\" exists but is not empty\n"),
 					progname, dirname);
@@ -772,9 +795,12 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 						/*
 						 * When streaming WAL, pg_xlog will have been created
 						 * by the wal receiver process, so just ignore failure
-						 * on that.
+						 * on that.  Directories can also exist already when
+						 * updating an earlier backup, or when another job
+						 * needed them first.
 						 */
-						if (!streamwal || strcmp(filename + strlen(filename) - 8, "/pg_xlog") != 0)
+						if ((!streamwal || strcmp(filename + strlen(filename) - 8, "/pg_xlog") != 0) &&
+							!(errno == EEXIST && (incremental != NULL || jobs > 1)))
 						{
 							fprintf(stderr,
 							_("%s: could not create directory \"%s\": %s\n"),
@@ -794,7 +820,8 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 					 * Symbolic link
 					 */
 					filename[strlen(filename) - 1] = '\0';		/* Remove trailing slash */
-					if (symlink(&copybuf[157], filename) != 0)
+					if (symlink(&copybuf[157], filename) != 0 &&
+						!(errno == EEXIST && incremental != NULL))
 					{
 						fprintf(stderr,
 								_("%s: could not create symbolic link from \"%s\" to \"%s\": %s\n"),
@@ -815,6 +842,19 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 			 * regular file
 			 */
 			file = fopen(filename, "wb");
+			if (!file && errno == ENOENT && jobs > 1)
+			{
+				/*
+				 * The job sending the directory entries hasn't got this far
+				 * yet; create the directory ourselves.
+				 */
+				char		dirname[MAXPGPATH];
+
+				strcpy(dirname, filename);
+				get_parent_directory(dirname);
+				if (pg_mkdir_p(dirname, S_IRWXU) == 0)
+					file = fopen(filename, "wb");
+			}
 			if (!file)
 			{
 				fprintf(stderr, _("%s: could not create file \"%s\": %s\n"),
@@ -833,7 +873,7 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 				/*
 				 * Done with this file, next one will be a new tar header
 				 */
-				fclose(file);
+				close_unpacked_file(file, filename);
 				file = NULL;
 				continue;
 			}
@@ -849,7 +889,7 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 				 * Received the padding block for this file, ignore it and
 				 * close the file, then move on to the next tar header.
 				 */
-				fclose(file);
+				close_unpacked_file(file, filename);
 				file = NULL;
 				totaldone += r;
 				continue;
@@ -873,7 +913,7 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 				 * expected. Close the file and move on to the next tar
 				 * header.
 				 */
-				fclose(file);
+				close_unpacked_file(file, filename);
 				file = NULL;
 				continue;
 			}
@@ -890,6 +930,404 @@ ReceiveAndUnpackTarFile(PGconn *conn, PGresult *res, int rownum)
 		PQfreemem(copybuf);
 }
 
+/*
+ * Close a file unpacked by ReceiveAndUnpackTarFile.  If it's the incremental
+ * version of a relation file, apply it to the file from the earlier backup.
+ */
+static void
+close_unpacked_file(FILE *file, const char *filename)
+{
+	size_t		len = strlen(filename);
+	size_t		suffixlen = strlen(INCREMENTAL_FILE_SUFFIX);
+
+	if (fclose(file) != 0)
+	{
+		fprintf(stderr, _("%s: could not close file \"%s\": %s\n"),
+				progname, filename, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	if (incremental != NULL && len > suffixlen &&
+		strcmp(filename + len - suffixlen, INCREMENTAL_FILE_SUFFIX) == 0)
+		apply_incremental_file(filename);
+}
+
+/*
+ * Write the blocks in an incremental file (see replication/basebackup.h)
+ * into the file it is for, truncate that to its new length, and remove the
+ * incremental file.
+ *
+ * Blocks that weren't sent must be present in the earlier backup already.
+ * They wouldn't be if the file was copied into place rather than written
+ * block by block since then, which is what CREATE DATABASE does, and the
+ * result would be a corrupt backup; so check and give up in that case.
+ */
+static void
+apply_incremental_file(const char *incrpath)
+{
+	char		path[MAXPGPATH];
+	FILE	   *in;
+	int			fd;
+	IncrementalFileHeader hdr;
+	uint32	   *blocks;
+	char		page[BLCKSZ];
+	struct stat st;
+	uint32		oldnblocks;
+	uint32		nbeyond;
+	uint32		i;
+
+	strlcpy(path, incrpath, strlen(incrpath) - strlen(INCREMENTAL_FILE_SUFFIX) + 1);
+
+	in = fopen(incrpath, PG_BINARY_R);
+	if (in == NULL)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, incrpath, strerror(errno));
+		disconnect_and_exit(1);
+	}
+	if (fread(&hdr, sizeof(hdr), 1, in) != 1 ||
+		hdr.magic != INCREMENTAL_FILE_MAGIC)
+	{
+		fprintf(stderr, _("%s: invalid incremental file \"%s\"\n"),
+				progname, incrpath);
+		disconnect_and_exit(1);
+	}
+	blocks = xmalloc0(Max(hdr.nchanged, 1) * sizeof(uint32));
+	if (hdr.nchanged > 0 &&
+		fread(blocks, sizeof(uint32), hdr.nchanged, in) != hdr.nchanged)
+	{
+		fprintf(stderr, _("%s: invalid incremental file \"%s\"\n"),
+				progname, incrpath);
+		disconnect_and_exit(1);
+	}
+
+	fd = open(path, O_RDWR | O_CREAT | PG_BINARY, S_IRUSR | S_IWUSR);
+	if (fd < 0 || fstat(fd, &st) != 0)
+	{
+		fprintf(stderr, _("%s: could not open file \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	/* Any blocks past the end of the old file must all have been sent */
+	oldnblocks = st.st_size / BLCKSZ;
+	nbeyond = 0;
+	for (i = 0; i < hdr.nchanged; i++)
+		if (blocks[i] >= oldnblocks)
+			nbeyond++;
+	if (hdr.nblocks > oldnblocks && nbeyond != hdr.nblocks - oldnblocks)
+	{
+		fprintf(stderr, _("%s: file \"%s\" is missing from the earlier backup, or too short\n"),
+				progname, path);
+		fprintf(stderr, _("%s: take a full backup instead\n"), progname);
+		disconnect_and_exit(1);
+	}
+
+	for (i = 0; i < hdr.nchanged; i++)
+	{
+		if (fread(page, BLCKSZ, 1, in) != 1)
+		{
+			fprintf(stderr, _("%s: invalid incremental file \"%s\"\n"),
+					progname, incrpath);
+			disconnect_and_exit(1);
+		}
+		if (lseek(fd, (off_t) blocks[i] * BLCKSZ, SEEK_SET) < 0 ||
+			write(fd, page, BLCKSZ) != BLCKSZ)
+		{
+			fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
+					progname, path, strerror(errno));
+			disconnect_and_exit(1);
+		}
+	}
+
+	if (ftruncate(fd, (off_t) hdr.nblocks * BLCKSZ) != 0)
+	{
+		fprintf(stderr, _("%s: could not truncate file \"%s\": %s\n"),
+				progname, path, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	close(fd);
+	fclose(in);
+	free(blocks);
+
+	if (unlink(incrpath) != 0)
+	{
+		fprintf(stderr, _("%s: could not remove file \"%s\": %s\n"),
+				progname, incrpath, strerror(errno));
+		disconnect_and_exit(1);
+	}
+}
+
+#ifndef WIN32
+/*
+ * Receive the files over 'jobs' connections in parallel, one child process
+ * per connection, while our own connection holds the backup open.  Each
+ * child asks for one shard of the files with SEND_FILES.
+ */
+static void
+ReceiveShards(void)
+{
+	pid_t	   *workers;
+	int			nrunning = 0;
+	bool		failed = false;
+	int			i;
+
+	workers = xmalloc0(jobs * sizeof(pid_t));
+	for (i = 0; i < jobs; i++)
+	{
+		workers[i] = fork();
+		if (workers[i] == 0)
+		{
+			/* in child process */
+			exit(ReceiveShard(i));
+		}
+		else if (workers[i] < 0)
+		{
+			fprintf(stderr, _("%s: could not create background process: %s\n"),
+					progname, strerror(errno));
+			failed = true;
+			break;
+		}
+		nrunning++;
+	}
+
+	/* Wait for them all, and stop the rest if one fails */
+	while (nrunning > 0)
+	{
+		int			status;
+		pid_t		r;
+
+		r = waitpid(-1, &status, 0);
+		if (r == -1)
+		{
+			fprintf(stderr, _("%s: could not wait for child process: %s\n"),
+					progname, strerror(errno));
+			disconnect_and_exit(1);
+		}
+		for (i = 0; i < jobs; i++)
+			if (workers[i] == r)
+				break;
+		if (i == jobs)
+		{
+			/* Not one of ours, so it must be the WAL streamer */
+			fprintf(stderr, _("%s: background WAL receiver exited prematurely\n"),
+					progname);
+			for (i = 0; i < jobs; i++)
+				if (workers[i] > 0)
+					kill(workers[i], SIGTERM);
+			disconnect_and_exit(1);
+		}
+		workers[i] = 0;
+		nrunning--;
+
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			if (!failed)
+			{
+				fprintf(stderr, _("%s: job %d failed\n"), progname, i);
+				for (i = 0; i < jobs; i++)
+					if (workers[i] > 0)
+						kill(workers[i], SIGTERM);
+			}
+			failed = true;
+		}
+	}
+
+	free(workers);
+	if (failed)
+		disconnect_and_exit(1);
+}
+
+/*
+ * Body of a child process started by ReceiveShards.  It uses a connection
+ * of its own, and must leave the parent's alone.
+ */
+static int
+ReceiveShard(int shard)
+{
+	PGresult   *res;
+	PQExpBuffer cmd;
+	int			i;
+
+	conn = GetConnection();
+
+	cmd = createPQExpBuffer();
+	appendPQExpBuffer(cmd, "SEND_FILES SHARD %d OF %d", shard, jobs);
+	if (incremental)
+		AppendQuotedOption(cmd, "INCREMENTAL", incremental);
+	if (PQsendQuery(conn, cmd->data) == 0)
+	{
+		fprintf(stderr, _("%s: could not send base backup command: %s"),
+				progname, PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	destroyPQExpBuffer(cmd);
+
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+	{
+		fprintf(stderr, _("%s: could not get backup header: %s"),
+				progname, PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	for (i = 0; i < PQntuples(res); i++)
+		ReceiveAndUnpackTarFile(conn, res, i);
+	PQclear(res);
+
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		fprintf(stderr, _("%s: final receive failed: %s"),
+				progname, PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	PQclear(res);
+
+	PQfinish(conn);
+	return 0;
+}
+#endif   /* WIN32 */
+
+/*
+ * Tell the background WAL receiver, if any, where the backup ended, and
+ * wait for it to stream everything up to there.
+ */
+static void
+WaitForLogStreamer(char *xlogend)
+{
+#ifndef WIN32
+	int			status;
+	int			r;
+#else
+	DWORD       status;
+#endif
+
+	if (bgchild <= 0)
+		return;
+
+	if (verbose)
+		fprintf(stderr, _("%s: waiting for background process to finish streaming...\n"), progname);
+
+#ifndef WIN32
+	if (pipewrite(bgpipe[1], xlogend, strlen(xlogend)) != strlen(xlogend))
+	{
+		fprintf(stderr, _("%s: could not send command to background pipe: %s\n"),
+				progname, strerror(errno));
+		disconnect_and_exit(1);
+	}
+
+	/* Just wait for the background process to exit */
+	r = waitpid(bgchild, &status, 0);
+	if (r == -1)
+	{
+		fprintf(stderr, _("%s: could not wait for child process: %s\n"),
+				progname, strerror(errno));
+		disconnect_and_exit(1);
+	}
+	if (r != bgchild)
+	{
+		fprintf(stderr, _("%s: child %i died, expected %i\n"),
+				progname, r, bgchild);
+		disconnect_and_exit(1);
+	}
+	if (!WIFEXITED(status))
+	{
+		fprintf(stderr, _("%s: child process did not exit normally\n"),
+				progname);
+		disconnect_and_exit(1);
+	}
+	if (WEXITSTATUS(status) != 0)
+	{
+		fprintf(stderr, _("%s: child process exited with error %i\n"),
+				progname, WEXITSTATUS(status));
+		disconnect_and_exit(1);
+	}
+	/* Exited normally, we're happy! */
+#else							/* WIN32 */
+
+	/*
+	 * On Windows, since we are in the same process, we can just store the
+	 * value directly in the variable, and then set the flag that says
+	 * it's there.
+	 */
+	if (sscanf(xlogend, "%X/%X", &xlogendptr.xlogid, &xlogendptr.xrecoff) != 2)
+	{
+		fprintf(stderr, _("%s: could not parse xlog end position \"%s\"\n"),
+				progname, xlogend);
+		exit(1);
+	}
+	InterlockedIncrement(&has_xlogendptr);
+
+	/* First wait for the thread to exit */
+	if (WaitForSingleObjectEx((HANDLE) bgchild, INFINITE, FALSE) != WAIT_OBJECT_0)
+	{
+		_dosmaperr(GetLastError());
+		fprintf(stderr, _("%s: could not wait for child thread: %s\n"),
+				progname, strerror(errno));
+		disconnect_and_exit(1);
+	}
+	if (GetExitCodeThread((HANDLE) bgchild, &status) == 0)
+	{
+		_dosmaperr(GetLastError());
+		fprintf(stderr, _("%s: could not get child thread exit status: %s\n"),
+				progname, strerror(errno));
+		disconnect_and_exit(1);
+	}
+	if (status != 0)
+	{
+		fprintf(stderr, _("%s: child thread exited with error %u\n"),
+				progname, (unsigned int) status);
+		disconnect_and_exit(1);
+	}
+	/* Exited normally, we're happy */
+#endif
+}
+
+/*
+ * Write the backup_label file returned by STOP_BACKUP into the backup.
+ */
+static void
+WriteBackupLabel(const char *contents)
+{
+	char		filename[MAXPGPATH];
+	FILE	   *file;
+
+	snprintf(filename, sizeof(filename), "%s/backup_label", basedir);
+	file = fopen(filename, "w");
+	if (file == NULL ||
+		fwrite(contents, strlen(contents), 1, file) != 1 ||
+		fclose(file) != 0)
+	{
+		fprintf(stderr, _("%s: could not write to file \"%s\": %s\n"),
+				progname, filename, strerror(errno));
+		disconnect_and_exit(1);
+	}
+}
+
+
+/*
+ * Append an option with a quoted string value to a replication command,
+ * escaping the value for the connection.
+ */
+static void
+AppendQuotedOption(PQExpBuffer buf, const char *option, const char *value)
+{
+	size_t		len = strlen(value);
+	char	   *escaped = xmalloc0(len * 2 + 1);
+	int			error;
+
+	PQescapeStringConn(conn, escaped, value, len, &error);
+	if (error)
+	{
+		fprintf(stderr, _("%s: could not escape %s value \"%s\": %s"),
+				progname, option, value, PQerrorMessage(conn));
+		disconnect_and_exit(1);
+	}
+	appendPQExpBuffer(buf, " %s '%s'", option, escaped);
+	free(escaped);
+}
+
 
 static void
 BaseBackup(void)
@@ -897,8 +1335,7 @@ BaseBackup(void)
 	PGresult   *res;
 	char	   *sysidentifier;
 	uint32		timeline;
-	char		current_path[MAXPGPATH];
-	char		escaped_label[MAXPGPATH];
+	PQExpBuffer cmd;
 	int			i;
 	char		xlogstart[64];
 	char		xlogend[64];
@@ -929,22 +1366,40 @@ BaseBackup(void)
 	PQclear(res);
 
 	/*
-	 * Start the actual backup
+	 * Start the actual backup.  With parallel jobs, the files are fetched on
+	 * separate connections between START_BACKUP and STOP_BACKUP on this one.
 	 */
-	PQescapeStringConn(conn, escaped_label, label, sizeof(escaped_label), &i);
-	snprintf(current_path, sizeof(current_path), "BASE_BACKUP LABEL '%s' %s %s %s %s",
-			 escaped_label,
-			 showprogress ? "PROGRESS" : "",
-			 includewal && !streamwal ? "WAL" : "",
-			 fastcheckpoint ? "FAST" : "",
-			 includewal ? "NOWAIT" : "");
+	cmd = createPQExpBuffer();
+	if (jobs > 1)
+	{
+		appendPQExpBufferStr(cmd, "START_BACKUP");
+		AppendQuotedOption(cmd, "LABEL", label);
+		if (fastcheckpoint)
+			appendPQExpBufferStr(cmd, " FAST");
+	}
+	else
+	{
+		appendPQExpBufferStr(cmd, "BASE_BACKUP");
+		AppendQuotedOption(cmd, "LABEL", label);
+		if (showprogress)
+			appendPQExpBufferStr(cmd, " PROGRESS");
+		if (includewal && !streamwal)
+			appendPQExpBufferStr(cmd, " WAL");
+		if (fastcheckpoint)
+			appendPQExpBufferStr(cmd, " FAST");
+		if (includewal)
+			appendPQExpBufferStr(cmd, " NOWAIT");
+		if (incremental)
+			AppendQuotedOption(cmd, "INCREMENTAL", incremental);
+	}
 
-	if (PQsendQuery(conn, current_path) == 0)
+	if (PQsendQuery(conn, cmd->data) == 0)
 	{
 		fprintf(stderr, _("%s: could not send base backup command: %s"),
 				progname, PQerrorMessage(conn));
 		disconnect_and_exit(1);
 	}
+	destroyPQExpBuffer(cmd);
 
 	/*
 	 * Get the starting xlog position
@@ -1028,6 +1483,69 @@ BaseBackup(void)
 	/*
 	 * Start receiving chunks
 	 */
+	if (jobs > 1)
+	{
+#ifndef WIN32
+		PQclear(res);
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		{
+			fprintf(stderr, _("%s: could not start base backup: %s"),
+					progname, PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		PQclear(res);
+		res = PQgetResult(conn);	/* NULL, no more results */
+
+		if (verbose)
+			fprintf(stderr, _("%s: receiving files in %d parallel jobs\n"),
+					progname, jobs);
+		ReceiveShards();
+
+		/*
+		 * Like START_BACKUP, this returns a row and then completes a second
+		 * time, so PQexec() would only give us the empty last result.
+		 */
+		if (PQsendQuery(conn,
+				  includewal ? "STOP_BACKUP NOWAIT" : "STOP_BACKUP") == 0)
+		{
+			fprintf(stderr, _("%s: could not send base backup command: %s"),
+					progname, PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK ||
+			PQntuples(res) != 1 || PQnfields(res) != 2)
+		{
+			fprintf(stderr, _("%s: could not stop base backup: %s"),
+					progname, PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		strcpy(xlogend, PQgetvalue(res, 0, 0));
+		if (verbose && includewal)
+			fprintf(stderr, "xlog end point: %s\n", xlogend);
+		WriteBackupLabel(PQgetvalue(res, 0, 1));
+		PQclear(res);
+
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		{
+			fprintf(stderr, _("%s: could not stop base backup: %s"),
+					progname, PQerrorMessage(conn));
+			disconnect_and_exit(1);
+		}
+		PQclear(res);
+		res = PQgetResult(conn);	/* NULL, no more results */
+
+		WaitForLogStreamer(xlogend);
+		PQfinish(conn);
+
+		if (verbose)
+			fprintf(stderr, "%s: base backup completed\n", progname);
+		return;
+#endif
+	}
+
 	for (i = 0; i < PQntuples(res); i++)
 	{
 		if (format == 't')
@@ -1072,92 +1590,7 @@ BaseBackup(void)
 		disconnect_and_exit(1);
 	}
 
-	if (bgchild > 0)
-	{
-#ifndef WIN32
-		int			status;
-		int			r;
-#else
-		DWORD       status;
-#endif
-
-		if (verbose)
-			fprintf(stderr, _("%s: waiting for background process to finish streaming...\n"), progname);
-
-#ifndef WIN32
-		if (pipewrite(bgpipe[1], xlogend, strlen(xlogend)) != strlen(xlogend))
-		{
-			fprintf(stderr, _("%s: could not send command to background pipe: %s\n"),
-					progname, strerror(errno));
-			disconnect_and_exit(1);
-		}
-
-		/* Just wait for the background process to exit */
-		r = waitpid(bgchild, &status, 0);
-		if (r == -1)
-		{
-			fprintf(stderr, _("%s: could not wait for child process: %s\n"),
-					progname, strerror(errno));
-			disconnect_and_exit(1);
-		}
-		if (r != bgchild)
-		{
-			fprintf(stderr, _("%s: child %i died, expected %i\n"),
-					progname, r, bgchild);
-			disconnect_and_exit(1);
-		}
-		if (!WIFEXITED(status))
-		{
-			fprintf(stderr, _("%s: child process did not exit normally\n"),
-					progname);
-			disconnect_and_exit(1);
-		}
-		if (WEXITSTATUS(status) != 0)
-		{
-			fprintf(stderr, _("%s: child process exited with error %i\n"),
-					progname, WEXITSTATUS(status));
-			disconnect_and_exit(1);
-		}
-		/* Exited normally, we're happy! */
-#else							/* WIN32 */
-
-		/*
-		 * On Windows, since we are in the same process, we can just store the
-		 * value directly in the variable, and then set the flag that says
-		 * it's there.
-		 */
-		if (sscanf(xlogend, "%X/%X", &xlogendptr.xlogid, &xlogendptr.xrecoff) != 2)
-		{
-			fprintf(stderr, _("%s: could not parse xlog end position \"%s\"\n"),
-					progname, xlogend);
-			exit(1);
-		}
-		InterlockedIncrement(&has_xlogendptr);
-
-		/* First wait for the thread to exit */
-		if (WaitForSingleObjectEx((HANDLE) bgchild, INFINITE, FALSE) != WAIT_OBJECT_0)
-		{
-			_dosmaperr(GetLastError());
-			fprintf(stderr, _("%s: could not wait for child thread: %s\n"),
-					progname, strerror(errno));
-			disconnect_and_exit(1);
-		}
-		if (GetExitCodeThread((HANDLE) bgchild, &status) == 0)
-		{
-			_dosmaperr(GetLastError());
-			fprintf(stderr, _("%s: could not get child thread exit status: %s\n"),
-					progname, strerror(errno));
-			disconnect_and_exit(1);
-		}
-		if (status != 0)
-		{
-			fprintf(stderr, _("%s: child thread exited with error %u\n"),
-					progname, (unsigned int) status);
-			disconnect_and_exit(1);
-		}
-		/* Exited normally, we're happy */
-#endif
-	}
+	WaitForLogStreamer(xlogend);
 
 	/*
 	 * End of copy data. Final result is already checked inside the loop.
@@ -1179,6 +1612,8 @@ main(int argc, char **argv)
 		{"format", required_argument, NULL, 'F'},
 		{"checkpoint", required_argument, NULL, 'c'},
 		{"xlog", required_argument, NULL, 'x'},
+		{"incremental", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"gzip", no_argument, NULL, 'z'},
 		{"compress", required_argument, NULL, 'Z'},
 		{"label", required_argument, NULL, 'l'},
@@ -1214,7 +1649,7 @@ main(int argc, char **argv)
 		}
 	}
 
-	while ((c = getopt_long(argc, argv, "D:F:x:l:zZ:c:h:p:U:s:wWvP",
+	while ((c = getopt_long(argc, argv, "D:F:x:i:j:l:zZ:c:h:p:U:s:wWvP",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -1249,6 +1684,29 @@ main(int argc, char **argv)
 					exit(1);
 				}
 				break;
+			case 'i':
+				{
+					uint32		xlogid,
+								xrecoff;
+
+					if (sscanf(optarg, "%X/%X", &xlogid, &xrecoff) != 2)
+					{
+						fprintf(stderr, _("%s: invalid incremental backup location \"%s\"\n"),
+								progname, optarg);
+						exit(1);
+					}
+					incremental = xstrdup(optarg);
+				}
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				if (jobs < 1)
+				{
+					fprintf(stderr, _("%s: invalid number of parallel jobs \"%s\"\n"),
+							progname, optarg);
+					exit(1);
+				}
+				break;
 			case 'l':
 				label = xstrdup(optarg);
 				break;
@@ -1368,6 +1826,46 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (format != 'p' && (jobs > 1 || incremental != NULL))
+	{
+		fprintf(stderr,
+				_("%s: parallel and incremental backups can only be taken in plain mode\n"),
+				progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	if (jobs > 1 && includewal && !streamwal)
+	{
+		fprintf(stderr,
+				_("%s: parallel backups can only include WAL by streaming it\n"),
+				progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+	if (jobs > 1 && showprogress)
+	{
+		fprintf(stderr,
+				_("%s: progress reporting is not supported for parallel backups\n"),
+				progname);
+		fprintf(stderr, _("Try \"%s --help\" for more information.\n"),
+				progname);
+		exit(1);
+	}
+
+#ifdef WIN32
+	if (jobs > 1)
+	{
+		fprintf(stderr,
+				_("%s: parallel backups are not supported on this platform\n"),
+				progname);
+		exit(1);
+	}
+#endif
+
 #ifndef HAVE_LIBZ
 	if (compresslevel != 0)
 	{
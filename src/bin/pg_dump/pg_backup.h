@@ -77,6 +77,14 @@ typedef enum
 	DUMP_UNSECTIONED = 0xff
 } DumpSections;
 
+struct _Archive;
+
+/*
+ * Called in each worker process of a parallel dump, to make the
+ * connection the process's data dumpers will use.
+ */
+typedef void (*SetupWorkerPtr) (struct _Archive *AH);
+
 /*
  *	We may want to have some more user-readable data, but in the mean
  *	time this gives us some abstraction and type checking.
@@ -98,6 +106,10 @@ typedef struct _Archive
 	bool		exit_on_error;	/* whether to exit on SQL errors... */
 	int			n_errors;		/* number of errors (if no die) */
 
+	/* parallel dump of table data (directory format only) */
+	int			numWorkers;		/* max number of concurrent worker processes */
+	SetupWorkerPtr setupWorker; /* connects each worker to the database */
+
 	/* The rest is private */
 } Archive;
 
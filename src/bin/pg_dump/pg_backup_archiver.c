@@ -159,6 +159,12 @@ static void inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te);
 static ArchiveHandle *CloneArchive(ArchiveHandle *AH);
 static void DeCloneArchive(ArchiveHandle *AH);
 
+static void WriteDataChunksForTocEntry(ArchiveHandle *AH, TocEntry *te);
+static void WriteDataChunksParallel(ArchiveHandle *AH);
+#ifndef WIN32
+static void parallel_dump(RestoreArgs *args);
+#endif
+
 
 /*
  *	Wrapper functions.
@@ -2038,46 +2044,212 @@ void
 WriteDataChunks(ArchiveHandle *AH)
 {
 	TocEntry   *te;
-	StartDataPtr startPtr;
-	EndDataPtr	endPtr;
+
+	if (AH->public.numWorkers > 1)
+	{
+		WriteDataChunksParallel(AH);
+		return;
+	}
 
 	for (te = AH->toc->next; te != AH->toc; te = te->next)
 	{
 		if (te->dataDumper != NULL)
+			WriteDataChunksForTocEntry(AH, te);
+	}
+}
+
+/*
+ * Run the data dumper of one TOC entry, wrapped in the format's start and
+ * end calls.
+ */
+static void
+WriteDataChunksForTocEntry(ArchiveHandle *AH, TocEntry *te)
+{
+	StartDataPtr startPtr;
+	EndDataPtr	endPtr;
+
+	AH->currToc = te;
+
+	if (strcmp(te->desc, "BLOBS") == 0)
+	{
+		startPtr = AH->StartBlobsPtr;
+		endPtr = AH->EndBlobsPtr;
+	}
+	else
+	{
+		startPtr = AH->StartDataPtr;
+		endPtr = AH->EndDataPtr;
+	}
+
+	if (startPtr != NULL)
+		(*startPtr) (AH, te);
+
+	/*
+	 * The user-provided DataDumper routine needs to call AH->WriteData
+	 */
+	(*te->dataDumper) ((Archive *) AH, te->dataDumperArg);
+
+	if (endPtr != NULL)
+		(*endPtr) (AH, te);
+	AH->currToc = NULL;
+}
+
+/*
+ * Parallel version of WriteDataChunks.
+ *
+ * Each TOC entry with data is dumped by a worker child of its own, at most
+ * numWorkers of them at a time, much as parallel restore does it.  The
+ * worker connects through the setupWorker callback, which is expected to
+ * give it the same snapshot as the parent's.  This only works for formats
+ * that write every entry's data to a separate file (that is, directory
+ * format), and only on platforms where we can fork: our data dumpers keep
+ * their connection in a global variable, so threads can't be used.
+ */
+static void
+WriteDataChunksParallel(ArchiveHandle *AH)
+{
+#ifndef WIN32
+	int			n_slots = AH->public.numWorkers;
+	ParallelSlot *slots;
+	TocEntry   *te;
+	int			next_slot;
+	int			work_status;
+	thandle		ret_child;
+	int			i;
+
+	if (AH->format != archDirectory || AH->public.setupWorker == NULL)
+		die_horribly(AH, modulename,
+					 "parallel dump is only supported by the directory format\n");
+
+	slots = (ParallelSlot *) pg_calloc(sizeof(ParallelSlot), n_slots);
+
+	te = AH->toc->next;
+	for (;;)
+	{
+		/* find the next entry that has something to dump */
+		while (te != AH->toc && te->dataDumper == NULL)
+			te = te->next;
+
+		if (te != AH->toc &&
+			(next_slot = get_next_slot(slots, n_slots)) != NO_SLOT)
 		{
-			AH->currToc = te;
-			/* printf("Writing data for %d (%x)\n", te->id, te); */
+			RestoreArgs *args;
+			thandle		child;
+
+			ahlog(AH, 1, "launching worker for %s %s\n", te->desc, te->tag);
 
-			if (strcmp(te->desc, "BLOBS") == 0)
+			args = pg_malloc(sizeof(RestoreArgs));
+			args->AH = AH;
+			args->te = te;
+
+			/* Ensure stdio state is quiesced before forking */
+			fflush(NULL);
+
+			child = fork();
+			if (child == 0)
 			{
-				startPtr = AH->StartBlobsPtr;
-				endPtr = AH->EndBlobsPtr;
+				/* in child process */
+				parallel_dump(args);
+				die_horribly(AH, modulename,
+							 "parallel_dump should not return\n");
 			}
-			else
+			else if (child < 0)
+				die_horribly(AH, modulename,
+							 "could not create worker process: %s\n",
+							 strerror(errno));
+
+			slots[next_slot].child_id = child;
+			slots[next_slot].args = args;
+			te = te->next;
+			continue;
+		}
+
+		/* no more work to hand out, or no free slot: wait for a worker */
+		if (!work_in_progress(slots, n_slots))
+			break;
+
+		ret_child = reap_child(slots, n_slots, &work_status);
+		if (!WIFEXITED(work_status))
+			die_horribly(AH, modulename, "worker process crashed: status %d\n",
+						 work_status);
+		if (WEXITSTATUS(work_status) != 0)
+			die_horribly(AH, modulename, "worker process failed: exit code %d\n",
+						 WEXITSTATUS(work_status));
+
+		for (i = 0; i < n_slots; i++)
+		{
+			if (slots[i].child_id == ret_child)
 			{
-				startPtr = AH->StartDataPtr;
-				endPtr = AH->EndDataPtr;
+				slots[i].child_id = 0;
+				free(slots[i].args);
+				slots[i].args = NULL;
+				break;
 			}
+		}
+		if (i == n_slots)
+			die_horribly(AH, modulename,
+						 "could not find slot of finished worker\n");
+	}
 
-			if (startPtr != NULL)
-				(*startPtr) (AH, te);
+	free(slots);
+#else
+	die_horribly(AH, modulename,
+				 "parallel dump is not supported on this platform\n");
+#endif
+}
 
-			/*
-			 * printf("Dumper arg for %d is %x\n", te->id, te->dataDumperArg);
-			 */
+#ifndef WIN32
+/*
+ * Dump the data of a single TOC item in a worker child process
+ */
+static void
+parallel_dump(RestoreArgs *args)
+{
+	ArchiveHandle *AH = args->AH;
+	TocEntry   *te = args->te;
 
-			/*
-			 * The user-provided DataDumper routine needs to call
-			 * AH->WriteData
-			 */
-			(*te->dataDumper) ((Archive *) AH, te->dataDumperArg);
+	/*
+	 * The parent's connection is ours too, since we were forked, but it
+	 * belongs to the parent's session: forget about it rather than close
+	 * it, and make our own.
+	 */
+	AH->connection = NULL;
+	(*AH->public.setupWorker) ((Archive *) AH);
 
-			if (endPtr != NULL)
-				(*endPtr) (AH, te);
-			AH->currToc = NULL;
-		}
+	/*
+	 * The parent has held ACCESS SHARE lock on every table since before it
+	 * took its snapshot, but if anyone has queued for a conflicting lock
+	 * since then, our own request for the same lock would wait behind
+	 * them, and they behind the parent.  So fail instead of deadlocking.
+	 */
+	if (strcmp(te->desc, "TABLE DATA") == 0)
+	{
+		PQExpBuffer query = createPQExpBuffer();
+		PGresult   *res;
+
+		appendPQExpBuffer(query, "LOCK TABLE %s", fmtId(te->namespace));
+		appendPQExpBuffer(query, ".%s IN ACCESS SHARE MODE NOWAIT",
+						  fmtId(te->tag));
+		res = PQexec(AH->connection, query->data);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			die_horribly(AH, modulename,
+						 "could not obtain lock on table \"%s\": %s"
+						 "This usually means that someone requested an ACCESS EXCLUSIVE lock "
+						 "on the table after the pg_dump parent process had already acquired "
+						 "its ACCESS SHARE lock.\n",
+						 te->tag, PQerrorMessage(AH->connection));
+		PQclear(res);
+		destroyPQExpBuffer(query);
 	}
+
+	WriteDataChunksForTocEntry(AH, te);
+
+	PQfinish(AH->connection);
+	AH->connection = NULL;
+
+	exit(0);
 }
+#endif
 
 void
 WriteToc(ArchiveHandle *AH)
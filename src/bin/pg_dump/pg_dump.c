@@ -143,8 +143,23 @@ static int	no_security_labels = 0;
 static int	no_unlogged_table_data = 0;
 static int	serializable_deferrable = 0;
 
+/*
+ * Connection parameters remembered for parallel dump workers, which open
+ * their own connections and import the snapshot exported by the master.
+ */
+static const char *conn_dbname = NULL;
+static const char *conn_pghost = NULL;
+static const char *conn_pgport = NULL;
+static const char *conn_username = NULL;
+static enum trivalue conn_prompt_password = TRI_DEFAULT;
+static const char *conn_dumpencoding = NULL;
+static const char *conn_use_role = NULL;
+static char *dump_snapshot_id = NULL;
+
 
 static void help(const char *progname);
+static void setup_connection(const char *dumpencoding, const char *use_role);
+static void setupDumpWorker(Archive *AH);
 static ArchiveFormat parseArchiveFormat(const char *format, ArchiveMode *mode);
 static void expand_schema_name_patterns(SimpleStringList *patterns,
 							SimpleOidList *oids);
@@ -152,6 +167,7 @@ static void expand_table_name_patterns(SimpleStringList *patterns,
 						   SimpleOidList *oids);
 static NamespaceInfo *findNamespace(Oid nsoid, Oid objoid);
 static void dumpTableData(Archive *fout, TableDataInfo *tdinfo);
+static void refreshMatViewData(Archive *fout, TableDataInfo *tdinfo);
 static void guessConstraintInheritance(TableInfo *tblinfo, int numTables);
 static void dumpComment(Archive *fout, const char *target,
 			const char *namespace, const char *owner,
@@ -215,6 +231,9 @@ static void getDomainConstraints(TypeInfo *tyinfo);
 static void getTableData(TableInfo *tblinfo, int numTables, bool oids);
 static void makeTableDataInfo(TableInfo *tbinfo, bool oids);
 static void getTableDataFKConstraints(void);
+static void buildMatViewRefreshDependencies(void);
+static void addMatViewRefreshDependencies(TableDataInfo *tdinfo,
+							  DumpableObject *dobj, DumpableObject *skip);
 static char *format_function_arguments(FuncInfo *finfo, char *funcargs);
 static char *format_function_arguments_old(FuncInfo *finfo, int nallargs,
 							  char **allargtypes,
@@ -262,7 +281,6 @@ main(int argc, char **argv)
 	const char *pgport = NULL;
 	const char *username = NULL;
 	const char *dumpencoding = NULL;
-	const char *std_strings;
 	bool		oids = false;
 	TableInfo  *tblinfo;
 	int			numTables;
@@ -271,6 +289,7 @@ main(int argc, char **argv)
 	int			i;
 	enum trivalue prompt_password = TRI_DEFAULT;
 	int			compressLevel = -1;
+	int			numWorkers = 1;
 	int			plainText = 0;
 	int			outputClean = 0;
 	int			outputCreateDB = 0;
@@ -297,6 +316,7 @@ main(int argc, char **argv)
 		{"format", required_argument, NULL, 'F'},
 		{"host", required_argument, NULL, 'h'},
 		{"ignore-version", no_argument, NULL, 'i'},
+		{"jobs", 1, NULL, 'j'},
 		{"no-reconnect", no_argument, NULL, 'R'},
 		{"oids", no_argument, NULL, 'o'},
 		{"no-owner", no_argument, NULL, 'O'},
@@ -373,7 +393,7 @@ main(int argc, char **argv)
 		}
 	}
 
-	while ((c = getopt_long(argc, argv, "abcCE:f:F:h:in:N:oOp:RsS:t:T:U:vwWxZ:",
+	while ((c = getopt_long(argc, argv, "abcCE:f:F:h:ij:n:N:oOp:RsS:t:T:U:vwWxZ:",
 							long_options, &optindex)) != -1)
 	{
 		switch (c)
@@ -414,6 +434,10 @@ main(int argc, char **argv)
 				/* ignored, deprecated option */
 				break;
 
+			case 'j':			/* number of dump jobs */
+				numWorkers = atoi(optarg);
+				break;
+
 			case 'n':			/* include schema(s) */
 				simple_string_list_append(&schema_include_patterns, optarg);
 				include_everything = false;
@@ -562,6 +586,27 @@ main(int argc, char **argv)
 	/* Identify archive format to emit */
 	archiveFormat = parseArchiveFormat(format, &archiveMode);
 
+	if (numWorkers < 1)
+	{
+		write_msg(NULL, "invalid number of parallel jobs\n");
+		exit(1);
+	}
+
+	/* Only the directory format can be written by several processes */
+	if (numWorkers > 1 && archiveFormat != archDirectory)
+	{
+		write_msg(NULL, "parallel backup only supported by the directory format\n");
+		exit(1);
+	}
+
+#ifdef WIN32
+	if (numWorkers > 1)
+	{
+		write_msg(NULL, "parallel backup is not supported on this platform\n");
+		exit(1);
+	}
+#endif
+
 	/* archiveFormat specific setup */
 	if (archiveFormat == archNull)
 		plainText = 1;
@@ -608,71 +653,16 @@ main(int argc, char **argv)
 	g_conn = ConnectDatabase(g_fout, dbname, pghost, pgport,
 							 username, prompt_password);
 
-	/* Set the client encoding if requested */
-	if (dumpencoding)
-	{
-		if (PQsetClientEncoding(g_conn, dumpencoding) < 0)
-		{
-			write_msg(NULL, "invalid client encoding \"%s\" specified\n",
-					  dumpencoding);
-			exit(1);
-		}
-	}
-
-	/*
-	 * Get the active encoding and the standard_conforming_strings setting, so
-	 * we know how to escape strings.
-	 */
-	g_fout->encoding = PQclientEncoding(g_conn);
+	/* Set up the session the way we need it */
+	setup_connection(dumpencoding, use_role);
 
-	std_strings = PQparameterStatus(g_conn, "standard_conforming_strings");
-	g_fout->std_strings = (std_strings && strcmp(std_strings, "on") == 0);
-
-	/* Set the role if requested */
-	if (use_role && g_fout->remoteVersion >= 80100)
+	/* Parallel workers rely on snapshot export, new in 9.2 */
+	if (numWorkers > 1 && g_fout->remoteVersion < 90200)
 	{
-		PQExpBuffer query = createPQExpBuffer();
-
-		appendPQExpBuffer(query, "SET ROLE %s", fmtId(use_role));
-		do_sql_command(g_conn, query->data);
-		destroyPQExpBuffer(query);
+		write_msg(NULL, "parallel backup requires a server of version 9.2 or later\n");
+		exit(1);
 	}
 
-	/* Set the datestyle to ISO to ensure the dump's portability */
-	do_sql_command(g_conn, "SET DATESTYLE = ISO");
-
-	/* Likewise, avoid using sql_standard intervalstyle */
-	if (g_fout->remoteVersion >= 80400)
-		do_sql_command(g_conn, "SET INTERVALSTYLE = POSTGRES");
-
-	/*
-	 * If supported, set extra_float_digits so that we can dump float data
-	 * exactly (given correctly implemented float I/O code, anyway)
-	 */
-	if (g_fout->remoteVersion >= 90000)
-		do_sql_command(g_conn, "SET extra_float_digits TO 3");
-	else if (g_fout->remoteVersion >= 70400)
-		do_sql_command(g_conn, "SET extra_float_digits TO 2");
-
-	/*
-	 * If synchronized scanning is supported, disable it, to prevent
-	 * unpredictable changes in row ordering across a dump and reload.
-	 */
-	if (g_fout->remoteVersion >= 80300)
-		do_sql_command(g_conn, "SET synchronize_seqscans TO off");
-
-	/*
-	 * Disable timeouts if supported.
-	 */
-	if (g_fout->remoteVersion >= 70300)
-		do_sql_command(g_conn, "SET statement_timeout = 0");
-
-	/*
-	 * Quote all identifiers, if requested.
-	 */
-	if (quote_all_identifiers && g_fout->remoteVersion >= 90100)
-		do_sql_command(g_conn, "SET quote_all_identifiers = true");
-
 	/*
 	 * Disable security label support if server version < v9.1.x (prevents
 	 * access to nonexistent pg_seclabel catalog)
@@ -697,6 +687,32 @@ main(int argc, char **argv)
 	else
 		do_sql_command(g_conn, "SET TRANSACTION ISOLATION LEVEL SERIALIZABLE");
 
+	/*
+	 * For a parallel dump, export our snapshot so that the workers see
+	 * exactly the same data, and remember how to connect them.
+	 */
+	if (numWorkers > 1)
+	{
+		PGresult   *res;
+
+		res = PQexec(g_conn, "SELECT pg_catalog.pg_export_snapshot()");
+		check_sql_result(res, g_conn, "SELECT pg_catalog.pg_export_snapshot()",
+						 PGRES_TUPLES_OK);
+		dump_snapshot_id = strdup(PQgetvalue(res, 0, 0));
+		PQclear(res);
+
+		conn_dbname = dbname;
+		conn_pghost = pghost;
+		conn_pgport = pgport;
+		conn_username = username;
+		conn_prompt_password = prompt_password;
+		conn_dumpencoding = dumpencoding;
+		conn_use_role = use_role;
+
+		g_fout->numWorkers = numWorkers;
+		g_fout->setupWorker = setupDumpWorker;
+	}
+
 	/* Select the appropriate subquery to convert user IDs to names */
 	if (g_fout->remoteVersion >= 80100)
 		username_subquery = "SELECT rolname FROM pg_catalog.pg_roles WHERE oid =";
@@ -781,6 +797,9 @@ main(int argc, char **argv)
 	 */
 	getDependencies();
 
+	if (!schemaOnly)
+		buildMatViewRefreshDependencies();
+
 	/*
 	 * Sort the objects into a safe dump order (no forward references).
 	 *
@@ -851,6 +870,113 @@ main(int argc, char **argv)
 }
 
 
+/*
+ * Set up the session of g_conn for dumping: client encoding and role as
+ * requested, and the settings that make the output portable.  This is done
+ * for the main connection and for that of each parallel dump worker.
+ */
+static void
+setup_connection(const char *dumpencoding, const char *use_role)
+{
+	const char *std_strings;
+
+	/* Set the client encoding if requested */
+	if (dumpencoding)
+	{
+		if (PQsetClientEncoding(g_conn, dumpencoding) < 0)
+		{
+			write_msg(NULL, "invalid client encoding \"%s\" specified\n",
+					  dumpencoding);
+			exit(1);
+		}
+	}
+
+	/*
+	 * Get the active encoding and the standard_conforming_strings setting, so
+	 * we know how to escape strings.
+	 */
+	g_fout->encoding = PQclientEncoding(g_conn);
+
+	std_strings = PQparameterStatus(g_conn, "standard_conforming_strings");
+	g_fout->std_strings = (std_strings && strcmp(std_strings, "on") == 0);
+
+	/* Set the role if requested */
+	if (use_role && g_fout->remoteVersion >= 80100)
+	{
+		PQExpBuffer query = createPQExpBuffer();
+
+		appendPQExpBuffer(query, "SET ROLE %s", fmtId(use_role));
+		do_sql_command(g_conn, query->data);
+		destroyPQExpBuffer(query);
+	}
+
+	/* Set the datestyle to ISO to ensure the dump's portability */
+	do_sql_command(g_conn, "SET DATESTYLE = ISO");
+
+	/* Likewise, avoid using sql_standard intervalstyle */
+	if (g_fout->remoteVersion >= 80400)
+		do_sql_command(g_conn, "SET INTERVALSTYLE = POSTGRES");
+
+	/*
+	 * If supported, set extra_float_digits so that we can dump float data
+	 * exactly (given correctly implemented float I/O code, anyway)
+	 */
+	if (g_fout->remoteVersion >= 90000)
+		do_sql_command(g_conn, "SET extra_float_digits TO 3");
+	else if (g_fout->remoteVersion >= 70400)
+		do_sql_command(g_conn, "SET extra_float_digits TO 2");
+
+	/*
+	 * If synchronized scanning is supported, disable it, to prevent
+	 * unpredictable changes in row ordering across a dump and reload.
+	 */
+	if (g_fout->remoteVersion >= 80300)
+		do_sql_command(g_conn, "SET synchronize_seqscans TO off");
+
+	/*
+	 * Disable timeouts if supported.
+	 */
+	if (g_fout->remoteVersion >= 70300)
+		do_sql_command(g_conn, "SET statement_timeout = 0");
+
+	/*
+	 * Quote all identifiers, if requested.
+	 */
+	if (quote_all_identifiers && g_fout->remoteVersion >= 90100)
+		do_sql_command(g_conn, "SET quote_all_identifiers = true");
+}
+
+/*
+ * Prepare a freshly forked parallel dump worker: open its own connection,
+ * set it up like the master's and adopt the master's snapshot, so that the
+ * table data it dumps is consistent with everything else in the archive.
+ */
+static void
+setupDumpWorker(Archive *AH)
+{
+	PQExpBuffer query = createPQExpBuffer();
+
+	g_conn = ConnectDatabase(AH, conn_dbname, conn_pghost, conn_pgport,
+							 conn_username, conn_prompt_password);
+	setup_connection(conn_dumpencoding, conn_use_role);
+
+	/*
+	 * A snapshot can't be imported into a serializable transaction unless
+	 * the exporting one is serializable too, and the master's DEFERRABLE
+	 * wait already guarantees that its snapshot is safe; so workers always
+	 * use repeatable read.
+	 */
+	do_sql_command(g_conn, "BEGIN");
+	do_sql_command(g_conn, "SET TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+
+	appendPQExpBuffer(query, "SET TRANSACTION SNAPSHOT ");
+	appendStringLiteralConn(query, dump_snapshot_id, g_conn);
+	do_sql_command(g_conn, query->data);
+
+	destroyPQExpBuffer(query);
+}
+
+
 static void
 help(const char *progname)
 {
@@ -863,6 +989,7 @@ help(const char *progname)
 	printf(_("  -F, --format=c|d|t|p        output file format (custom, directory, tar,\n"
 			 "                              plain text (default))\n"));
 	printf(_("  -v, --verbose               verbose mode\n"));
+	printf(_("  -j, --jobs=NUM              use this many parallel jobs to dump\n"));
 	printf(_("  -Z, --compress=0-9          compression level for compressed formats\n"));
 	printf(_("  --lock-wait-timeout=TIMEOUT fail after waiting TIMEOUT for a table lock\n"));
 	printf(_("  --help                      show this help, then exit\n"));
@@ -1047,9 +1174,9 @@ expand_table_name_patterns(SimpleStringList *patterns, SimpleOidList *oids)
 						  "SELECT c.oid"
 						  "\nFROM pg_catalog.pg_class c"
 		"\n     LEFT JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
-						  "\nWHERE c.relkind in ('%c', '%c', '%c', '%c')\n",
+						  "\nWHERE c.relkind in ('%c', '%c', '%c', '%c', '%c')\n",
 						  RELKIND_RELATION, RELKIND_SEQUENCE, RELKIND_VIEW,
-						  RELKIND_FOREIGN_TABLE);
+						  RELKIND_MATVIEW, RELKIND_FOREIGN_TABLE);
 		processSQLNamePattern(g_conn, query, cell->val, true, false,
 							  "n.nspname", "c.relname", NULL,
 							  "pg_catalog.pg_table_is_visible(c.oid)");
@@ -1605,6 +1732,35 @@ dumpTableData(Archive *fout, TableDataInfo *tdinfo)
 	destroyPQExpBuffer(copyBuf);
 }
 
+/*
+ * refreshMatViewData -
+ *	  load the data for one materialized view
+ *
+ * Rather than dumping the contents, we emit a REFRESH to regenerate them
+ * once the tables it reads from have been restored.
+ */
+static void
+refreshMatViewData(Archive *fout, TableDataInfo *tdinfo)
+{
+	TableInfo  *tbinfo = tdinfo->tdtable;
+	PQExpBuffer q;
+
+	q = createPQExpBuffer();
+
+	appendPQExpBuffer(q, "REFRESH MATERIALIZED VIEW %s;\n",
+					  fmtId(tbinfo->dobj.name));
+
+	ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
+				 tbinfo->dobj.name, tbinfo->dobj.namespace->dobj.name,
+				 NULL, tbinfo->rolname,
+				 false, "MATERIALIZED VIEW DATA", SECTION_POST_DATA,
+				 q->data, "", NULL,
+				 tdinfo->dobj.dependencies, tdinfo->dobj.nDeps,
+				 NULL, NULL);
+
+	destroyPQExpBuffer(q);
+}
+
 /*
  * getTableData -
  *	  set up dumpable objects representing the contents of tables
@@ -1645,7 +1801,11 @@ makeTableDataInfo(TableInfo *tbinfo, bool oids)
 
 	tdinfo = (TableDataInfo *) pg_malloc(sizeof(TableDataInfo));
 
-	tdinfo->dobj.objType = DO_TABLE_DATA;
+	/* A materialized view's data is regenerated rather than dumped */
+	if (tbinfo->relkind == RELKIND_MATVIEW)
+		tdinfo->dobj.objType = DO_REFRESH_MATVIEW;
+	else
+		tdinfo->dobj.objType = DO_TABLE_DATA;
 
 	/*
 	 * Note: use tableoid 0 so that this object won't be mistaken for
@@ -1712,6 +1872,81 @@ getTableDataFKConstraints(void)
 	free(dobjs);
 }
 
+/*
+ * buildMatViewRefreshDependencies -
+ *	  add dump-order dependencies between materialized view refreshes
+ *
+ * A materialized view that reads from another one (directly, or through
+ * plain views) must be refreshed after it, or it would see no data.  The
+ * dependency of each matview on the relations it reads is recorded against
+ * its ON SELECT rule, so follow that, and the rules of any views on the way.
+ */
+static void
+buildMatViewRefreshDependencies(void)
+{
+	DumpableObject **dobjs;
+	int			numObjs;
+	int			i;
+
+	getDumpableObjects(&dobjs, &numObjs);
+	for (i = 0; i < numObjs; i++)
+	{
+		if (dobjs[i]->objType == DO_REFRESH_MATVIEW)
+		{
+			TableDataInfo *tdinfo = (TableDataInfo *) dobjs[i];
+
+			addMatViewRefreshDependencies(tdinfo, &tdinfo->tdtable->dobj,
+										  NULL);
+		}
+	}
+	free(dobjs);
+}
+
+/*
+ * Recursive workhorse for buildMatViewRefreshDependencies: scan the
+ * dependencies of dobj, ignoring skip (the table a rule belongs to, which
+ * depends on the rule in turn).
+ */
+static void
+addMatViewRefreshDependencies(TableDataInfo *tdinfo, DumpableObject *dobj,
+							  DumpableObject *skip)
+{
+	int			i;
+
+	for (i = 0; i < dobj->nDeps; i++)
+	{
+		DumpableObject *refobj = findObjectByDumpId(dobj->dependencies[i]);
+
+		if (refobj == NULL || refobj == skip)
+			continue;
+
+		if (refobj->objType == DO_RULE)
+		{
+			RuleInfo   *rinfo = (RuleInfo *) refobj;
+
+			if (rinfo->ruletable == NULL ||
+				&rinfo->ruletable->dobj != dobj)
+				continue;		/* only the rule of the object at hand */
+			addMatViewRefreshDependencies(tdinfo, refobj, dobj);
+		}
+		else if (refobj->objType == DO_TABLE)
+		{
+			TableInfo  *reftbl = (TableInfo *) refobj;
+
+			if (reftbl == tdinfo->tdtable)
+				continue;
+			if (reftbl->relkind == RELKIND_MATVIEW)
+			{
+				if (reftbl->dataObj != NULL)
+					addObjectDependency(&tdinfo->dobj,
+										reftbl->dataObj->dobj.dumpId);
+			}
+			else if (reftbl->relkind == RELKIND_VIEW)
+				addMatViewRefreshDependencies(tdinfo, refobj, NULL);
+		}
+	}
+}
+
 
 /*
  * guessConstraintInheritance:
@@ -1743,9 +1978,10 @@ guessConstraintInheritance(TableInfo *tblinfo, int numTables)
 		TableInfo **parents;
 		TableInfo  *parent;
 
-		/* Sequences and views never have parents */
+		/* Sequences, views, and matviews never have parents */
 		if (tbinfo->relkind == RELKIND_SEQUENCE ||
-			tbinfo->relkind == RELKIND_VIEW)
+			tbinfo->relkind == RELKIND_VIEW ||
+			tbinfo->relkind == RELKIND_MATVIEW)
 			continue;
 
 		/* Don't bother computing anything for non-target tables, either */
@@ -3981,13 +4217,13 @@ getTables(int *numTables)
 						  "d.objsubid = 0 AND "
 						  "d.refclassid = c.tableoid AND d.deptype = 'a') "
 					   "LEFT JOIN pg_class tc ON (c.reltoastrelid = tc.oid) "
-						  "WHERE c.relkind in ('%c', '%c', '%c', '%c', '%c') "
+						  "WHERE c.relkind in ('%c', '%c', '%c', '%c', '%c', '%c') "
 						  "ORDER BY c.oid",
 						  username_subquery,
 						  RELKIND_SEQUENCE,
 						  RELKIND_RELATION, RELKIND_SEQUENCE,
 						  RELKIND_VIEW, RELKIND_COMPOSITE_TYPE,
-						  RELKIND_FOREIGN_TABLE);
+						  RELKIND_MATVIEW, RELKIND_FOREIGN_TABLE);
 	}
 	else if (g_fout->remoteVersion >= 90000)
 	{
@@ -4515,8 +4751,9 @@ getIndexes(TableInfo tblinfo[], int numTables)
 	{
 		TableInfo  *tbinfo = &tblinfo[i];
 
-		/* Only plain tables have indexes */
-		if (tbinfo->relkind != RELKIND_RELATION || !tbinfo->hasindex)
+		/* Only plain tables and materialized views have indexes */
+		if ((tbinfo->relkind != RELKIND_RELATION &&
+			 tbinfo->relkind != RELKIND_MATVIEW) || !tbinfo->hasindex)
 			continue;
 
 		/* Ignore indexes of tables not to be dumped */
@@ -5106,12 +5343,13 @@ getRules(int *numRules)
 		if (ruleinfo[i].ruletable)
 		{
 			/*
-			 * If the table is a view, force its ON SELECT rule to be sorted
-			 * before the view itself --- this ensures that any dependencies
-			 * for the rule affect the table's positioning. Other rules are
-			 * forced to appear after their table.
+			 * If the table is a view or materialized view, force its ON SELECT
+			 * rule to be sorted before the view itself --- this ensures that
+			 * any dependencies for the rule affect the table's positioning.
+			 * Other rules are forced to appear after their table.
 			 */
-			if (ruleinfo[i].ruletable->relkind == RELKIND_VIEW &&
+			if ((ruleinfo[i].ruletable->relkind == RELKIND_VIEW ||
+				 ruleinfo[i].ruletable->relkind == RELKIND_MATVIEW) &&
 				ruleinfo[i].ev_type == '1' && ruleinfo[i].is_instead)
 			{
 				addObjectDependency(&ruleinfo[i].ruletable->dobj,
@@ -5680,6 +5918,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 	int			i_attoptions;
 	int			i_attcollation;
 	int			i_attfdwoptions;
+	int			i_attmissingval;
 	PGresult   *res;
 	int			ntups;
 	bool		hasdefaults;
@@ -5720,7 +5959,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 		if (g_fout->remoteVersion >= 90200)
 		{
 			/*
-			 * attfdwoptions is new in 9.2.
+			 * attfdwoptions and attmissingval are new in 9.2.
 			 */
 			appendPQExpBuffer(q, "SELECT a.attnum, a.attname, a.atttypmod, "
 							  "a.attstattarget, a.attstorage, t.typstorage, "
@@ -5734,7 +5973,9 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 							  "SELECT pg_catalog.quote_ident(option_name) || "
 							  "' ' || pg_catalog.quote_literal(option_value) "
 							  "FROM pg_catalog.pg_options_to_table(attfdwoptions)"
-							  "), E',\n    ') AS attfdwoptions "
+							  "), E',\n    ') AS attfdwoptions, "
+							  "CASE WHEN a.atthasmissing AND NOT a.attisdropped "
+							  "THEN a.attmissingval ELSE NULL END AS attmissingval "
 			 "FROM pg_catalog.pg_attribute a LEFT JOIN pg_catalog.pg_type t "
 							  "ON a.atttypid = t.oid "
 							  "WHERE a.attrelid = '%u'::pg_catalog.oid "
@@ -5758,7 +5999,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 						"array_to_string(a.attoptions, ', ') AS attoptions, "
 							  "CASE WHEN a.attcollation <> t.typcollation "
 							"THEN a.attcollation ELSE 0 END AS attcollation, "
-							  "NULL AS attfdwoptions "
+							  "NULL AS attfdwoptions, NULL AS attmissingval "
 			 "FROM pg_catalog.pg_attribute a LEFT JOIN pg_catalog.pg_type t "
 							  "ON a.atttypid = t.oid "
 							  "WHERE a.attrelid = '%u'::pg_catalog.oid "
@@ -5776,7 +6017,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 				  "pg_catalog.format_type(t.oid,a.atttypmod) AS atttypname, "
 						"array_to_string(a.attoptions, ', ') AS attoptions, "
 							  "0 AS attcollation, "
-							  "NULL AS attfdwoptions "
+							  "NULL AS attfdwoptions, NULL AS attmissingval "
 			 "FROM pg_catalog.pg_attribute a LEFT JOIN pg_catalog.pg_type t "
 							  "ON a.atttypid = t.oid "
 							  "WHERE a.attrelid = '%u'::pg_catalog.oid "
@@ -5793,7 +6034,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 							  "a.attlen, a.attalign, a.attislocal, "
 				  "pg_catalog.format_type(t.oid,a.atttypmod) AS atttypname, "
 							  "'' AS attoptions, 0 AS attcollation, "
-							  "NULL AS attfdwoptions "
+							  "NULL AS attfdwoptions, NULL AS attmissingval "
 			 "FROM pg_catalog.pg_attribute a LEFT JOIN pg_catalog.pg_type t "
 							  "ON a.atttypid = t.oid "
 							  "WHERE a.attrelid = '%u'::pg_catalog.oid "
@@ -5815,7 +6056,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 							  "a.attalign, false AS attislocal, "
 							  "format_type(t.oid,a.atttypmod) AS atttypname, "
 							  "'' AS attoptions, 0 AS attcollation, "
-							  "NULL AS attfdwoptions "
+							  "NULL AS attfdwoptions, NULL AS attmissingval "
 							  "FROM pg_attribute a LEFT JOIN pg_type t "
 							  "ON a.atttypid = t.oid "
 							  "WHERE a.attrelid = '%u'::oid "
@@ -5834,7 +6075,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 							  "false AS attislocal, "
 							  "(SELECT typname FROM pg_type WHERE oid = atttypid) AS atttypname, "
 							  "'' AS attoptions, 0 AS attcollation, "
-							  "NULL AS attfdwoptions "
+							  "NULL AS attfdwoptions, NULL AS attmissingval "
 							  "FROM pg_attribute a "
 							  "WHERE attrelid = '%u'::oid "
 							  "AND attnum > 0::int2 "
@@ -5863,6 +6104,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 		i_attoptions = PQfnumber(res, "attoptions");
 		i_attcollation = PQfnumber(res, "attcollation");
 		i_attfdwoptions = PQfnumber(res, "attfdwoptions");
+		i_attmissingval = PQfnumber(res, "attmissingval");
 
 		tbinfo->numatts = ntups;
 		tbinfo->attnames = (char **) pg_malloc(ntups * sizeof(char *));
@@ -5880,6 +6122,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 		tbinfo->attoptions = (char **) pg_malloc(ntups * sizeof(char *));
 		tbinfo->attcollation = (Oid *) pg_malloc(ntups * sizeof(Oid));
 		tbinfo->attfdwoptions = (char **) pg_malloc(ntups * sizeof(char *));
+		tbinfo->attmissingval = (char **) pg_malloc(ntups * sizeof(char *));
 		tbinfo->inhAttrs = (bool *) pg_malloc(ntups * sizeof(bool));
 		tbinfo->inhAttrDef = (bool *) pg_malloc(ntups * sizeof(bool));
 		tbinfo->inhNotNull = (bool *) pg_malloc(ntups * sizeof(bool));
@@ -5907,6 +6150,7 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 			tbinfo->attoptions[j] = pg_strdup(PQgetvalue(res, j, i_attoptions));
 			tbinfo->attcollation[j] = atooid(PQgetvalue(res, j, i_attcollation));
 			tbinfo->attfdwoptions[j] = pg_strdup(PQgetvalue(res, j, i_attfdwoptions));
+			tbinfo->attmissingval[j] = pg_strdup(PQgetvalue(res, j, i_attmissingval));
 			tbinfo->attrdefs[j] = NULL; /* fix below */
 			if (PQgetvalue(res, j, i_atthasdef)[0] == 't')
 				hasdefaults = true;
@@ -5918,6 +6162,34 @@ getTableAttrs(TableInfo *tblinfo, int numTables)
 
 		PQclear(res);
 
+		/*
+		 * Get the column groups that have extended statistics
+		 */
+		tbinfo->numextstats = 0;
+		tbinfo->extstats = NULL;
+		if (g_fout->remoteVersion >= 90200 &&
+			tbinfo->relkind == RELKIND_RELATION)
+		{
+			resetPQExpBuffer(q);
+			appendPQExpBuffer(q, "SELECT stakeys "
+							  "FROM pg_catalog.pg_statistic_ext "
+							  "WHERE starelid = '%u'::pg_catalog.oid "
+							  "ORDER BY stakeys::pg_catalog.text",
+							  tbinfo->dobj.catId.oid);
+
+			res = PQexec(g_conn, q->data);
+			check_sql_result(res, g_conn, q->data, PGRES_TUPLES_OK);
+
+			ntups = PQntuples(res);
+			tbinfo->numextstats = ntups;
+			if (ntups > 0)
+				tbinfo->extstats = (char **) pg_malloc(ntups * sizeof(char *));
+			for (j = 0; j < ntups; j++)
+				tbinfo->extstats[j] = pg_strdup(PQgetvalue(res, j, 0));
+
+			PQclear(res);
+		}
+
 		/*
 		 * Get info about column defaults
 		 */
@@ -7157,6 +7429,9 @@ dumpDumpableObject(Archive *fout, DumpableObject *dobj)
 		case DO_RULE:
 			skip = !(dumpSections & DUMP_POST_DATA);
 			break;
+		case DO_REFRESH_MATVIEW:
+			skip = !(dumpSections & DUMP_POST_DATA);
+			break;
 		case DO_TABLE_DATA:
 			skip = !(dumpSections & DUMP_DATA);
 			break;
@@ -7267,6 +7542,9 @@ dumpDumpableObject(Archive *fout, DumpableObject *dobj)
 						 dobj->dependencies, dobj->nDeps,
 						 dumpBlobs, NULL);
 			break;
+		case DO_REFRESH_MATVIEW:
+			refreshMatViewData(fout, (TableDataInfo *) dobj);
+			break;
 	}
 }
 
@@ -10953,12 +11231,16 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	int			ntups;
 	int			i_aggtransfn;
 	int			i_aggfinalfn;
+	int			i_aggcombinefn;
+	int			i_agginvtransfn;
 	int			i_aggsortop;
 	int			i_aggtranstype;
 	int			i_agginitval;
 	int			i_convertok;
 	const char *aggtransfn;
 	const char *aggfinalfn;
+	const char *aggcombinefn;
+	const char *agginvtransfn;
 	const char *aggsortop;
 	const char *aggtranstype;
 	const char *agginitval;
@@ -10978,10 +11260,25 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	selectSourceSchema(agginfo->aggfn.dobj.namespace->dobj.name);
 
 	/* Get aggregate-specific details */
-	if (g_fout->remoteVersion >= 80100)
+	if (g_fout->remoteVersion >= 90200)
+	{
+		appendPQExpBuffer(query, "SELECT aggtransfn, "
+						  "aggfinalfn, aggcombinefn, agginvtransfn, "
+						  "aggtranstype::pg_catalog.regtype, "
+						  "aggsortop::pg_catalog.regoperator, "
+						  "agginitval, "
+						  "'t'::boolean AS convertok "
+					  "FROM pg_catalog.pg_aggregate a, pg_catalog.pg_proc p "
+						  "WHERE a.aggfnoid = p.oid "
+						  "AND p.oid = '%u'::pg_catalog.oid",
+						  agginfo->aggfn.dobj.catId.oid);
+	}
+	else if (g_fout->remoteVersion >= 80100)
 	{
 		appendPQExpBuffer(query, "SELECT aggtransfn, "
-						  "aggfinalfn, aggtranstype::pg_catalog.regtype, "
+						  "aggfinalfn, '-' AS aggcombinefn, "
+						  "'-' AS agginvtransfn, "
+						  "aggtranstype::pg_catalog.regtype, "
 						  "aggsortop::pg_catalog.regoperator, "
 						  "agginitval, "
 						  "'t'::boolean AS convertok "
@@ -10993,7 +11290,9 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	else if (g_fout->remoteVersion >= 70300)
 	{
 		appendPQExpBuffer(query, "SELECT aggtransfn, "
-						  "aggfinalfn, aggtranstype::pg_catalog.regtype, "
+						  "aggfinalfn, '-' AS aggcombinefn, "
+						  "'-' AS agginvtransfn, "
+						  "aggtranstype::pg_catalog.regtype, "
 						  "0 AS aggsortop, "
 						  "agginitval, "
 						  "'t'::boolean AS convertok "
@@ -11005,6 +11304,7 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	else if (g_fout->remoteVersion >= 70100)
 	{
 		appendPQExpBuffer(query, "SELECT aggtransfn, aggfinalfn, "
+						  "'-' AS aggcombinefn, '-' AS agginvtransfn, "
 						  "format_type(aggtranstype, NULL) AS aggtranstype, "
 						  "0 AS aggsortop, "
 						  "agginitval, "
@@ -11016,7 +11316,8 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 	else
 	{
 		appendPQExpBuffer(query, "SELECT aggtransfn1 AS aggtransfn, "
-						  "aggfinalfn, "
+						  "aggfinalfn, '-' AS aggcombinefn, "
+						  "'-' AS agginvtransfn, "
 						  "(SELECT typname FROM pg_type WHERE oid = aggtranstype1) AS aggtranstype, "
 						  "0 AS aggsortop, "
 						  "agginitval1 AS agginitval, "
@@ -11042,6 +11343,8 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 
 	i_aggtransfn = PQfnumber(res, "aggtransfn");
 	i_aggfinalfn = PQfnumber(res, "aggfinalfn");
+	i_aggcombinefn = PQfnumber(res, "aggcombinefn");
+	i_agginvtransfn = PQfnumber(res, "agginvtransfn");
 	i_aggsortop = PQfnumber(res, "aggsortop");
 	i_aggtranstype = PQfnumber(res, "aggtranstype");
 	i_agginitval = PQfnumber(res, "agginitval");
@@ -11049,6 +11352,8 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 
 	aggtransfn = PQgetvalue(res, 0, i_aggtransfn);
 	aggfinalfn = PQgetvalue(res, 0, i_aggfinalfn);
+	aggcombinefn = PQgetvalue(res, 0, i_aggcombinefn);
+	agginvtransfn = PQgetvalue(res, 0, i_agginvtransfn);
 	aggsortop = PQgetvalue(res, 0, i_aggsortop);
 	aggtranstype = PQgetvalue(res, 0, i_aggtranstype);
 	agginitval = PQgetvalue(res, 0, i_agginitval);
@@ -11099,6 +11404,18 @@ dumpAgg(Archive *fout, AggInfo *agginfo)
 						  aggfinalfn);
 	}
 
+	if (strcmp(aggcombinefn, "-") != 0)
+	{
+		appendPQExpBuffer(details, ",\n    COMBINEFUNC = %s",
+						  aggcombinefn);
+	}
+
+	if (strcmp(agginvtransfn, "-") != 0)
+	{
+		appendPQExpBuffer(details, ",\n    INVFUNC = %s",
+						  agginvtransfn);
+	}
+
 	aggsortop = convertOperatorReference(aggsortop);
 	if (aggsortop)
 	{
@@ -12356,11 +12673,15 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 												tbinfo->dobj.catId.oid);
 
 	/* Is it a table or a view? */
-	if (tbinfo->relkind == RELKIND_VIEW)
+	if (tbinfo->relkind == RELKIND_VIEW ||
+		tbinfo->relkind == RELKIND_MATVIEW)
 	{
 		char	   *viewdef;
 
-		reltypename = "VIEW";
+		if (tbinfo->relkind == RELKIND_MATVIEW)
+			reltypename = "MATERIALIZED VIEW";
+		else
+			reltypename = "VIEW";
 
 		/* Fetch the view definition */
 		if (g_fout->remoteVersion >= 70300)
@@ -12405,7 +12726,7 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 		 * DROP must be fully qualified in case same name appears in
 		 * pg_catalog
 		 */
-		appendPQExpBuffer(delq, "DROP VIEW %s.",
+		appendPQExpBuffer(delq, "DROP %s %s.", reltypename,
 						  fmtId(tbinfo->dobj.namespace->dobj.name));
 		appendPQExpBuffer(delq, "%s;\n",
 						  fmtId(tbinfo->dobj.name));
@@ -12413,12 +12734,28 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 		if (binary_upgrade)
 			binary_upgrade_set_pg_class_oids(q, tbinfo->dobj.catId.oid, false);
 
-		appendPQExpBuffer(q, "CREATE VIEW %s", fmtId(tbinfo->dobj.name));
+		appendPQExpBuffer(q, "CREATE %s %s", reltypename,
+						  fmtId(tbinfo->dobj.name));
 		if (tbinfo->reloptions && strlen(tbinfo->reloptions) > 0)
 			appendPQExpBuffer(q, " WITH (%s)", tbinfo->reloptions);
-		appendPQExpBuffer(q, " AS\n    %s\n", viewdef);
+		if (tbinfo->relkind == RELKIND_MATVIEW)
+		{
+			/*
+			 * The data is loaded by a separate REFRESH once everything it
+			 * depends on has been restored; strip the definition's trailing
+			 * semicolon so we can say so.
+			 */
+			size_t		len = strlen(viewdef);
+
+			while (len > 0 && viewdef[len - 1] == ';')
+				len--;
+			appendPQExpBuffer(q, " AS\n    %.*s\n  WITH NO DATA;\n",
+							  (int) len, viewdef);
+		}
+		else
+			appendPQExpBuffer(q, " AS\n    %s\n", viewdef);
 
-		appendPQExpBuffer(labelq, "VIEW %s",
+		appendPQExpBuffer(labelq, "%s %s", reltypename,
 						  fmtId(tbinfo->dobj.name));
 
 		PQclear(res);
@@ -12719,6 +13056,23 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 					appendStringLiteralAH(q, fmtId(tbinfo->dobj.name), fout);
 					appendPQExpBuffer(q, "::pg_catalog.regclass;\n");
 				}
+
+				/*
+				 * The rows stored before a column was added with a default
+				 * don't contain it, so the column's missing value must come
+				 * along with them.
+				 */
+				if (tbinfo->attmissingval[j][0] != '\0')
+				{
+					appendPQExpBuffer(q, "\n-- For binary upgrade, set missing value.\n");
+					appendPQExpBuffer(q, "SELECT binary_upgrade.set_missing_value(");
+					appendStringLiteralAH(q, fmtId(tbinfo->dobj.name), fout);
+					appendPQExpBuffer(q, "::pg_catalog.regclass, ");
+					appendStringLiteralAH(q, tbinfo->attnames[j], fout);
+					appendPQExpBuffer(q, ", ");
+					appendStringLiteralAH(q, tbinfo->attmissingval[j], fout);
+					appendPQExpBuffer(q, ");\n");
+				}
 			}
 
 			for (k = 0; k < tbinfo->ncheck; k++)
@@ -12872,6 +13226,40 @@ dumpTableSchema(Archive *fout, TableInfo *tbinfo)
 								  tbinfo->attfdwoptions[j]);
 			}
 		}
+
+		/*
+		 * Dump the column groups to collect statistics on.  stakeys is an
+		 * int2vector, so it comes to us as a space-separated list of column
+		 * numbers.
+		 */
+		for (j = 0; j < tbinfo->numextstats; j++)
+		{
+			char	   *keys = tbinfo->extstats[j];
+			bool		first = true;
+
+			appendPQExpBuffer(q, "ALTER TABLE ONLY %s ",
+							  fmtId(tbinfo->dobj.name));
+			appendPQExpBuffer(q, "ADD STATISTICS (");
+			for (;;)
+			{
+				char	   *endptr;
+				long		attnum = strtol(keys, &endptr, 10);
+
+				if (endptr == keys)
+					break;
+				keys = endptr;
+				if (attnum < 1 || attnum > tbinfo->numatts)
+				{
+					write_msg(NULL, "invalid column number %ld in extended statistics of table \"%s\"\n",
+							  attnum, tbinfo->dobj.name);
+					exit_nicely();
+				}
+				appendPQExpBuffer(q, "%s%s", first ? "" : ", ",
+								  fmtId(tbinfo->attnames[attnum - 1]));
+				first = false;
+			}
+			appendPQExpBuffer(q, ");\n");
+		}
 	}
 
 	if (binary_upgrade)
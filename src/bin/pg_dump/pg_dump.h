@@ -118,7 +118,8 @@ typedef enum
 	DO_DEFAULT_ACL,
 	DO_BLOB,
 	DO_BLOB_DATA,
-	DO_COLLATION
+	DO_COLLATION,
+	DO_REFRESH_MATVIEW
 } DumpableObjectType;
 
 typedef struct _dumpableObject
@@ -278,6 +279,9 @@ typedef struct _tableInfo
 	char	  **attoptions;		/* per-attribute options */
 	Oid		   *attcollation;	/* per-attribute collation selection */
 	char	  **attfdwoptions;	/* per-attribute fdw options */
+	char	  **attmissingval;	/* per-attribute missing values, or "" */
+	int			numextstats;	/* number of column groups with statistics */
+	char	  **extstats;		/* their pg_statistic_ext.stakeys, as text */
 
 	/*
 	 * Note: we need to store per-attribute notnull, default, and constraint
@@ -296,7 +300,8 @@ typedef struct _tableInfo
 	 */
 	int			numParents;		/* number of (immediate) parent tables */
 	struct _tableInfo **parents;	/* TableInfos of immediate parents */
-	struct _tableDataInfo *dataObj;		/* TableDataInfo, if dumping its data */
+	struct _tableDataInfo *dataObj;		/* TableDataInfo, if dumping its data
+										 * (or refreshing a matview) */
 } TableInfo;
 
 typedef struct _attrDefInfo
@@ -59,7 +59,8 @@ static const int oldObjectTypePriority[] =
 	17,							/* DO_DEFAULT_ACL */
 	9,							/* DO_BLOB */
 	11,							/* DO_BLOB_DATA */
-	2							/* DO_COLLATION */
+	2,							/* DO_COLLATION */
+	18							/* DO_REFRESH_MATVIEW */
 };
 
 /*
@@ -98,7 +99,8 @@ static const int newObjectTypePriority[] =
 	29,							/* DO_DEFAULT_ACL */
 	21,							/* DO_BLOB */
 	23,							/* DO_BLOB_DATA */
-	3							/* DO_COLLATION */
+	3,							/* DO_COLLATION */
+	30							/* DO_REFRESH_MATVIEW */
 };
 
 
@@ -1132,6 +1134,11 @@ describeDumpableObject(DumpableObject *obj, char *buf, int bufsize)
 					 "TABLE DATA %s  (ID %d OID %u)",
 					 obj->name, obj->dumpId, obj->catId.oid);
 			return;
+		case DO_REFRESH_MATVIEW:
+			snprintf(buf, bufsize,
+					 "REFRESH MATERIALIZED VIEW %s  (ID %d OID %u)",
+					 obj->name, obj->dumpId, obj->catId.oid);
+			return;
 		case DO_DUMMY_TYPE:
 			snprintf(buf, bufsize,
 					 "DUMMY TYPE %s  (ID %d OID %u)",
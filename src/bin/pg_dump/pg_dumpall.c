@@ -501,8 +501,13 @@ main(int argc, char *argv[])
 				dumpTablespaces(conn);
 		}
 
-		/* Dump CREATE DATABASE commands */
-		if (!globals_only && !roles_only && !tablespaces_only)
+		/*
+		 * Dump CREATE DATABASE commands.  pg_upgrade dumps each database's
+		 * contents with pg_dump, so in binary-upgrade mode --globals-only
+		 * includes the databases themselves.
+		 */
+		if (!roles_only && !tablespaces_only &&
+			(!globals_only || binary_upgrade))
 			dumpCreateDB(conn);
 
 		/* Dump role/database settings */
@@ -26,6 +26,9 @@ static void ResetCancelConn(void);
 
 static PGcancel *volatile cancelConn = NULL;
 
+/* Set when the user has asked to interrupt us */
+volatile bool CancelRequested = false;
+
 #ifdef WIN32
 static CRITICAL_SECTION cancelConnLock;
 #endif
@@ -315,6 +318,23 @@ pg_strdup(const char *string)
 	return tmp;
 }
 
+/*
+ * "Safe" wrapper around malloc().  Pulled from psql/common.c
+ */
+void *
+pg_malloc(size_t size)
+{
+	void	   *tmp;
+
+	tmp = malloc(size);
+	if (!tmp)
+	{
+		fprintf(stderr, _("out of memory\n"));
+		exit(EXIT_FAILURE);
+	}
+	return tmp;
+}
+
 /*
  * Check yes/no answer in a localized way.	1=yes, 0=no, -1=neither.
  */
@@ -427,6 +447,8 @@ handle_sigint(SIGNAL_ARGS)
 	int			save_errno = errno;
 	char		errbuf[256];
 
+	CancelRequested = true;
+
 	/* Send QueryCancel if we are processing a database query */
 	if (cancelConn != NULL)
 	{
@@ -459,6 +481,8 @@ consoleHandler(DWORD dwCtrlType)
 	if (dwCtrlType == CTRL_C_EVENT ||
 		dwCtrlType == CTRL_BREAK_EVENT)
 	{
+		CancelRequested = true;
+
 		/* Send QueryCancel if we are processing a database query */
 		EnterCriticalSection(&cancelConnLock);
 		if (cancelConn != NULL)
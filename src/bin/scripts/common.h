@@ -22,6 +22,8 @@ enum trivalue
 
 typedef void (*help_handler) (const char *progname);
 
+extern volatile bool CancelRequested;
+
 extern const char *get_user_name(const char *progname);
 
 extern void handle_help_version_opts(int argc, char *argv[],
@@ -51,5 +53,6 @@ extern bool yesno_prompt(const char *question);
 extern void setup_cancel_handler(void);
 
 extern char *pg_strdup(const char *string);
+extern void *pg_malloc(size_t size);
 
 #endif   /* COMMON_H */
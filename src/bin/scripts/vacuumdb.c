@@ -11,20 +11,35 @@
  */
 
 #include "postgres_fe.h"
+
+#ifdef HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+
 #include "common.h"
 
 
 static void vacuum_one_database(const char *dbname, bool full, bool verbose,
 					bool and_analyze, bool analyze_only, bool freeze,
-					const char *table, const char *host, const char *port,
+					const char *table, int jobs,
+					const char *host, const char *port,
 					const char *username, enum trivalue prompt_password,
 					const char *progname, bool echo);
 static void vacuum_all_databases(bool full, bool verbose, bool and_analyze,
-					 bool analyze_only, bool freeze,
+					 bool analyze_only, bool freeze, int jobs,
 					 const char *maintenance_db,
 					 const char *host, const char *port,
 					 const char *username, enum trivalue prompt_password,
 					 const char *progname, bool echo, bool quiet);
+static void vacuum_tables_parallel(PGconn *conn, const char *command,
+					   const char *dbname, int jobs,
+					   const char *host, const char *port,
+					   const char *username,
+					   enum trivalue prompt_password,
+					   const char *progname, bool echo);
+static int	wait_for_idle_connection(PGconn **conns, const char **running,
+						 int nconns, const char *dbname,
+						 const char *progname);
 
 static void help(const char *progname);
 
@@ -48,6 +63,7 @@ main(int argc, char *argv[])
 		{"table", required_argument, NULL, 't'},
 		{"full", no_argument, NULL, 'f'},
 		{"verbose", no_argument, NULL, 'v'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"maintenance-db", required_argument, NULL, 2},
 		{NULL, 0, NULL, 0}
 	};
@@ -71,13 +87,14 @@ main(int argc, char *argv[])
 	char	   *table = NULL;
 	bool		full = false;
 	bool		verbose = false;
+	int			jobs = 1;
 
 	progname = get_progname(argv[0]);
 	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pgscripts"));
 
 	handle_help_version_opts(argc, argv, "vacuumdb", help);
 
-	while ((c = getopt_long(argc, argv, "h:p:U:wWeqd:zZFat:fv", long_options, &optindex)) != -1)
+	while ((c = getopt_long(argc, argv, "h:p:U:wWeqd:zZFat:fvj:", long_options, &optindex)) != -1)
 	{
 		switch (c)
 		{
@@ -126,6 +143,15 @@ main(int argc, char *argv[])
 			case 'v':
 				verbose = true;
 				break;
+			case 'j':
+				jobs = atoi(optarg);
+				if (jobs < 1 || jobs >= FD_SETSIZE)
+				{
+					fprintf(stderr, _("%s: number of parallel jobs must be between 1 and %d\n"),
+							progname, FD_SETSIZE - 1);
+					exit(1);
+				}
+				break;
 			case 2:
 				maintenance_db = optarg;
 				break;
@@ -184,7 +210,7 @@ main(int argc, char *argv[])
 		}
 
 		vacuum_all_databases(full, verbose, and_analyze, analyze_only, freeze,
-							 maintenance_db, host, port, username,
+							 jobs, maintenance_db, host, port, username,
 							 prompt_password, progname, echo, quiet);
 	}
 	else
@@ -200,7 +226,7 @@ main(int argc, char *argv[])
 		}
 
 		vacuum_one_database(dbname, full, verbose, and_analyze, analyze_only,
-							freeze, table,
+							freeze, table, jobs,
 							host, port, username, prompt_password,
 							progname, echo);
 	}
@@ -212,7 +238,7 @@ main(int argc, char *argv[])
 static void
 vacuum_one_database(const char *dbname, bool full, bool verbose, bool and_analyze,
 					bool analyze_only, bool freeze, const char *table,
-					const char *host, const char *port,
+					int jobs, const char *host, const char *port,
 					const char *username, enum trivalue prompt_password,
 					const char *progname, bool echo)
 {
@@ -275,6 +301,18 @@ vacuum_one_database(const char *dbname, bool full, bool verbose, bool and_analyz
 				appendPQExpBuffer(&sql, " ANALYZE");
 		}
 	}
+
+	/* With several jobs, issue the command for each table separately */
+	if (jobs > 1 && !table)
+	{
+		vacuum_tables_parallel(conn, sql.data, dbname, jobs,
+							   host, port, username, prompt_password,
+							   progname, echo);
+		PQfinish(conn);
+		termPQExpBuffer(&sql);
+		return;
+	}
+
 	if (table)
 		appendPQExpBuffer(&sql, " %s", table);
 	appendPQExpBuffer(&sql, ";\n");
@@ -297,7 +335,7 @@ vacuum_one_database(const char *dbname, bool full, bool verbose, bool and_analyz
 
 static void
 vacuum_all_databases(bool full, bool verbose, bool and_analyze, bool analyze_only,
-					 bool freeze, const char *maintenance_db,
+					 bool freeze, int jobs, const char *maintenance_db,
 					 const char *host, const char *port,
 					 const char *username, enum trivalue prompt_password,
 					 const char *progname, bool echo, bool quiet)
@@ -322,14 +360,193 @@ vacuum_all_databases(bool full, bool verbose, bool and_analyze, bool analyze_onl
 		}
 
 		vacuum_one_database(dbname, full, verbose, and_analyze, analyze_only,
-						 freeze, NULL, host, port, username, prompt_password,
-							progname, echo);
+							freeze, NULL, jobs, host, port, username,
+							prompt_password, progname, echo);
 	}
 
 	PQclear(result);
 }
 
 
+/*
+ * Run command on each table of the database, on up to jobs connections at
+ * a time.  The largest tables go first, so that a big table doesn't end up
+ * being processed alone at the end.  conn is used as one of the
+ * connections.
+ */
+static void
+vacuum_tables_parallel(PGconn *conn, const char *command,
+					   const char *dbname, int jobs,
+					   const char *host, const char *port,
+					   const char *username,
+					   enum trivalue prompt_password,
+					   const char *progname, bool echo)
+{
+	PGresult   *tables;
+	PGconn	  **conns;
+	const char **running;
+	PQExpBufferData sql;
+	int			ntables;
+	int			next = 0;
+	int			nrunning = 0;
+	int			i;
+
+	tables = executeQuery(conn,
+						  "SELECT pg_catalog.quote_ident(n.nspname) || '.' || "
+						  "pg_catalog.quote_ident(c.relname) "
+						  "FROM pg_catalog.pg_class c "
+						  "JOIN pg_catalog.pg_namespace n "
+						  "ON c.relnamespace = n.oid "
+						  "WHERE c.relkind = 'r' "
+						  "AND n.nspname !~ '^pg_temp_' "
+						  "ORDER BY c.relpages DESC;",
+						  progname, echo);
+	ntables = PQntuples(tables);
+	if (jobs > ntables)
+		jobs = ntables;
+
+	conns = (PGconn **) pg_malloc(jobs * sizeof(PGconn *));
+	running = (const char **) pg_malloc(jobs * sizeof(char *));
+	conns[0] = conn;
+	for (i = 1; i < jobs; i++)
+		conns[i] = connectDatabase(dbname, host, port, username,
+								   prompt_password, progname, false);
+	for (i = 0; i < jobs; i++)
+		running[i] = NULL;
+
+	initPQExpBuffer(&sql);
+
+	while (next < ntables || nrunning > 0)
+	{
+		/* Hand out tables to the idle connections */
+		for (i = 0; i < jobs && next < ntables; i++)
+		{
+			if (running[i] != NULL)
+				continue;
+
+			running[i] = PQgetvalue(tables, next++, 0);
+
+			resetPQExpBuffer(&sql);
+			appendPQExpBuffer(&sql, "%s %s;", command, running[i]);
+			if (echo)
+				printf("%s\n", sql.data);
+
+			if (!PQsendQuery(conns[i], sql.data))
+			{
+				fprintf(stderr, _("%s: vacuuming of table \"%s\" in database \"%s\" failed: %s"),
+						progname, running[i], dbname,
+						PQerrorMessage(conns[i]));
+				exit(1);
+			}
+			nrunning++;
+		}
+
+		/* Wait for one of them to finish, and check how it went */
+		i = wait_for_idle_connection(conns, running, jobs, dbname, progname);
+		running[i] = NULL;
+		nrunning--;
+	}
+
+	termPQExpBuffer(&sql);
+	for (i = 1; i < jobs; i++)
+		PQfinish(conns[i]);
+	free(conns);
+	free(running);
+	PQclear(tables);
+}
+
+/*
+ * Wait until one of the busy connections has finished its command, and
+ * return its index.  Exits if the command failed, or if the user has asked
+ * to cancel.
+ */
+static int
+wait_for_idle_connection(PGconn **conns, const char **running, int nconns,
+						 const char *dbname, const char *progname)
+{
+	for (;;)
+	{
+		fd_set		input_mask;
+		int			maxfd = -1;
+		int			i;
+
+		FD_ZERO(&input_mask);
+		for (i = 0; i < nconns; i++)
+		{
+			int			sock;
+
+			if (running[i] == NULL)
+				continue;
+
+			sock = PQsocket(conns[i]);
+			FD_SET(sock, &input_mask);
+			if (sock > maxfd)
+				maxfd = sock;
+		}
+
+		if (select(maxfd + 1, &input_mask, NULL, NULL, NULL) < 0 &&
+			errno != EINTR)
+		{
+			fprintf(stderr, _("%s: select() failed: %s\n"),
+					progname, strerror(errno));
+			exit(1);
+		}
+
+		if (CancelRequested)
+		{
+			char		errbuf[256];
+
+			for (i = 0; i < nconns; i++)
+			{
+				PGcancel   *cancel;
+
+				if (running[i] == NULL)
+					continue;
+				cancel = PQgetCancel(conns[i]);
+				if (cancel != NULL)
+				{
+					(void) PQcancel(cancel, errbuf, sizeof(errbuf));
+					PQfreeCancel(cancel);
+				}
+			}
+			fprintf(stderr, _("%s: cancelled\n"), progname);
+			exit(1);
+		}
+
+		for (i = 0; i < nconns; i++)
+		{
+			PGresult   *res;
+			bool		failed = false;
+
+			if (running[i] == NULL)
+				continue;
+
+			if (!PQconsumeInput(conns[i]))
+				failed = true;
+			else if (PQisBusy(conns[i]))
+				continue;
+
+			while ((res = PQgetResult(conns[i])) != NULL)
+			{
+				if (PQresultStatus(res) != PGRES_COMMAND_OK)
+					failed = true;
+				PQclear(res);
+			}
+
+			if (failed)
+			{
+				fprintf(stderr, _("%s: vacuuming of table \"%s\" in database \"%s\" failed: %s"),
+						progname, running[i], dbname,
+						PQerrorMessage(conns[i]));
+				exit(1);
+			}
+
+			return i;
+		}
+	}
+}
+
+
 static void
 help(const char *progname)
 {
@@ -342,6 +559,7 @@ help(const char *progname)
 	printf(_("  -e, --echo                      show the commands being sent to the server\n"));
 	printf(_("  -f, --full                      do full vacuuming\n"));
 	printf(_("  -F, --freeze                    freeze row transaction information\n"));
+	printf(_("  -j, --jobs=NUM                  use this many concurrent connections to vacuum\n"));
 	printf(_("  -q, --quiet                     don't write any messages\n"));
 	printf(_("  -t, --table='TABLE[(COLUMNS)]'  vacuum specific table only\n"));
 	printf(_("  -v, --verbose                   write a lot of output\n"));
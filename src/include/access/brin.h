@@ -0,0 +1,159 @@
+/*-------------------------------------------------------------------------
+ *
+ * brin.h
+ *	  Public header file for the BRIN (block range) index access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/brin.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BRIN_H
+#define BRIN_H
+
+#include "access/xlog.h"
+#include "fmgr.h"
+#include "storage/block.h"
+#include "storage/off.h"
+#include "storage/relfilenode.h"
+#include "utils/relcache.h"
+
+
+/* reloption parameters */
+#define BRIN_DEFAULT_PAGES_PER_RANGE	128
+#define BRIN_MAX_PAGES_PER_RANGE		131072
+
+/* BRIN opclass support function numbers */
+#define BRIN_CMP_PROC					1
+#define BRINNProc						1
+
+/* BRIN strategy numbers, same as btree's */
+#define BRINLessStrategyNumber			1
+#define BRINLessEqualStrategyNumber		2
+#define BRINEqualStrategyNumber			3
+#define BRINGreaterEqualStrategyNumber	4
+#define BRINGreaterStrategyNumber		5
+#define BRINNStrategies					5
+
+/*
+ * Storage type for BRIN's reloptions
+ */
+typedef struct BrinOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			pagesPerRange;	/* number of heap pages per summary */
+} BrinOptions;
+
+#define BrinGetPagesPerRange(relation) \
+	((relation)->rd_options ? \
+	 ((BrinOptions *) (relation)->rd_options)->pagesPerRange : \
+	 BRIN_DEFAULT_PAGES_PER_RANGE)
+
+/*
+ * Page layout
+ *
+ * Block 0 is a metapage.  Every other block is an array of fixed-size
+ * summary slots, one per range of pagesPerRange heap blocks; the slot of
+ * heap range r is found by arithmetic alone, so there is no need for a
+ * separate mapping structure.  Summary pages have no line pointers, and the
+ * slots start immediately after the (maxaligned) page header.
+ *
+ * Each slot begins with a validity byte and one flag byte per index column,
+ * followed by the minimum and maximum value of each column, aligned as the
+ * column's type requires.
+ */
+#define BRIN_METAPAGE_BLKNO		0
+#define BRIN_MAGIC_NUMBER		0xA8109CFA
+#define BRIN_VERSION			1
+
+typedef struct BrinMetaPageData
+{
+	uint32		brinMagic;
+	uint32		brinVersion;
+	BlockNumber pagesPerRange;	/* heap pages summarized per slot */
+	uint32		summarySize;	/* bytes per summary slot */
+	uint32		summariesPerPage;		/* slots per summary page */
+} BrinMetaPageData;
+
+#define BrinPageGetMeta(page) \
+	((BrinMetaPageData *) PageGetContents(page))
+
+#define BRIN_SUMMARY_START		MAXALIGN(SizeOfPageHeaderData)
+
+/* flag bits in a summary slot */
+#define BRIN_SUMMARY_VALID		0x01	/* slot byte 0: range is summarized */
+#define BRIN_COL_HASNULLS		0x01	/* some value in range is NULL */
+#define BRIN_COL_HASVALUES		0x02	/* min/max below are meaningful */
+
+/*
+ * Per-column layout and comparison info, cached in the relcache entry
+ */
+typedef struct BrinColumn
+{
+	int16		typlen;
+	bool		typbyval;
+	uint16		minOffset;		/* offset of min value within a slot */
+	uint16		maxOffset;		/* offset of max value within a slot */
+	FmgrInfo   *cmpProc;		/* btree-style three-way comparison */
+	Oid			collation;
+} BrinColumn;
+
+typedef struct BrinDesc
+{
+	int			natts;
+	BlockNumber pagesPerRange;
+	uint32		summarySize;
+	uint32		summariesPerPage;
+	BrinColumn	columns[1];		/* VARIABLE LENGTH ARRAY */
+} BrinDesc;
+
+/* Summary slot location for a given heap block */
+#define BrinRangeOfBlock(desc, heapBlk) \
+	((heapBlk) / (desc)->pagesPerRange)
+#define BrinSummaryBlock(desc, range) \
+	((BlockNumber) (1 + (range) / (desc)->summariesPerPage))
+#define BrinSummaryOffset(desc, range) \
+	(BRIN_SUMMARY_START + ((range) % (desc)->summariesPerPage) * (desc)->summarySize)
+
+/*
+ * XLOG records for BRIN operations
+ *
+ * New index pages are logged with log_newpage, so the only record type of
+ * our own is the in-place update of one summary slot.
+ */
+#define XLOG_BRIN_UPDATE		0x10
+
+typedef struct xl_brin_update
+{
+	RelFileNode node;
+	BlockNumber blkno;			/* summary page */
+	uint16		offset;			/* byte offset of the slot in that page */
+	uint16		len;			/* length of slot image that follows */
+	/* SLOT IMAGE FOLLOWS AT END OF STRUCT */
+} xl_brin_update;
+
+#define SizeOfBrinUpdate	(offsetof(xl_brin_update, len) + sizeof(uint16))
+
+/* brin.c */
+extern BrinDesc *brin_getdesc(Relation index);
+extern Datum brinbuild(PG_FUNCTION_ARGS);
+extern Datum brinbuildempty(PG_FUNCTION_ARGS);
+extern Datum brininsert(PG_FUNCTION_ARGS);
+extern Datum brinbeginscan(PG_FUNCTION_ARGS);
+extern Datum brinrescan(PG_FUNCTION_ARGS);
+extern Datum brinendscan(PG_FUNCTION_ARGS);
+extern Datum brinmarkpos(PG_FUNCTION_ARGS);
+extern Datum brinrestrpos(PG_FUNCTION_ARGS);
+extern Datum bringetbitmap(PG_FUNCTION_ARGS);
+extern Datum brinbulkdelete(PG_FUNCTION_ARGS);
+extern Datum brinvacuumcleanup(PG_FUNCTION_ARGS);
+extern Datum brinoptions(PG_FUNCTION_ARGS);
+
+/* brin_xlog.c */
+extern void brin_redo(XLogRecPtr lsn, XLogRecord *record);
+extern void brin_desc(StringInfo buf, uint8 xl_info, char *rec);
+
+#endif   /* BRIN_H */
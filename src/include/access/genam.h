@@ -112,6 +112,12 @@ typedef enum IndexUniqueCheck
 } IndexUniqueCheck;
 
 
+/*
+ * How many heap blocks ahead of an index scan to prefetch, for index AMs
+ * that support it; -1 means use effective_io_concurrency's setting.
+ */
+extern int	index_prefetch_distance;
+
 /*
  * generalized index_ interface routines (in indexam.c)
  */
@@ -129,7 +135,8 @@ extern bool index_insert(Relation indexRelation,
 			 Datum *values, bool *isnull,
 			 ItemPointer heap_t_ctid,
 			 Relation heapRelation,
-			 IndexUniqueCheck checkUnique);
+			 IndexUniqueCheck checkUnique,
+			 bool indexUnchanged);
 
 extern IndexScanDesc index_beginscan(Relation heapRelation,
 				Relation indexRelation,
@@ -46,8 +46,9 @@ typedef struct GinStatsData
 	int32		ginVersion;
 } GinStatsData;
 
-/* GUC parameter */
+/* GUC parameters */
 extern PGDLLIMPORT int GinFuzzySearchLimit;
+extern PGDLLIMPORT int GinPendingListLimit;
 
 /* ginutil.c */
 extern void ginGetStats(Relation index, GinStatsData *stats);
@@ -56,6 +57,7 @@ extern void ginUpdateStats(Relation index, const GinStatsData *stats);
 /* ginxlog.c */
 extern void gin_redo(XLogRecPtr lsn, XLogRecord *record);
 extern void gin_desc(StringInfo buf, uint8 xl_info, char *rec);
+extern void gin_prefetch(XLogRecord *record, char *data, uint32 len);
 extern void gin_xlog_startup(void);
 extern void gin_xlog_cleanup(void);
 extern bool gin_safe_restartpoint(void);
@@ -211,9 +211,15 @@ typedef signed char GinNullCategory;
 #define GinSetPostingTree(itup, blkno)	( GinSetNPosting((itup),GIN_TREE_POSTING), ItemPointerSetBlockNumber(&(itup)->t_tid, blkno) )
 #define GinGetPostingTree(itup) GinItemPointerGetBlockNumber(&(itup)->t_tid)
 
-#define GinGetPostingOffset(itup)	GinItemPointerGetBlockNumber(&(itup)->t_tid)
+/*
+ * The high bit of the posting-list offset is set if the posting list is
+ * compressed (see ginpostinglist.c); use ginReadTuple() to read it either way
+ */
+#define GIN_ITUP_COMPRESSED		(1U << 31)
+#define GinGetPostingOffset(itup)	(GinItemPointerGetBlockNumber(&(itup)->t_tid) & (~GIN_ITUP_COMPRESSED))
 #define GinSetPostingOffset(itup,n) ItemPointerSetBlockNumber(&(itup)->t_tid,n)
-#define GinGetPosting(itup)			((ItemPointer) ((char*)(itup) + GinGetPostingOffset(itup)))
+#define GinItupIsCompressed(itup)	((GinItemPointerGetBlockNumber(&(itup)->t_tid) & GIN_ITUP_COMPRESSED) != 0)
+#define GinGetPosting(itup)			((Pointer) ((char*)(itup) + GinGetPostingOffset(itup)))
 
 #define GinMaxItemSize \
 	MAXALIGN_DOWN(((BLCKSZ - SizeOfPageHeaderData - \
@@ -262,12 +268,19 @@ typedef struct GinOptions
 {
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
 	bool		useFastUpdate;	/* use fast updates? */
+	int			pendingListLimit;	/* max. size of pending list in kB, or
+									 * -1 to use gin_pending_list_limit */
 } GinOptions;
 
 #define GIN_DEFAULT_USE_FASTUPDATE	true
 #define GinGetUseFastUpdate(relation) \
 	((relation)->rd_options ? \
 	 ((GinOptions *) (relation)->rd_options)->useFastUpdate : GIN_DEFAULT_USE_FASTUPDATE)
+#define GinGetPendingListLimit(relation) \
+	((relation)->rd_options && \
+	 ((GinOptions *) (relation)->rd_options)->pendingListLimit != -1 ? \
+	 ((GinOptions *) (relation)->rd_options)->pendingListLimit : \
+	 GinPendingListLimit)
 
 
 /* Macros for buffer lock/unlock operations */
@@ -456,6 +469,8 @@ extern void ginEntryInsert(GinState *ginstate,
 			   OffsetNumber attnum, Datum key, GinNullCategory category,
 			   ItemPointerData *items, uint32 nitem,
 			   GinStatsData *buildStats);
+extern int ginCompareBuildTuples(GinState *ginstate,
+					  IndexTuple a, IndexTuple b);
 
 /* ginbtree.c */
 
@@ -522,7 +537,6 @@ extern void ginFindParents(GinBtree btree, GinBtreeStack *stack, BlockNumber roo
 extern IndexTuple GinFormTuple(GinState *ginstate,
 			 OffsetNumber attnum, Datum key, GinNullCategory category,
 			 ItemPointerData *ipd, uint32 nipd, bool errorTooBig);
-extern void GinShortenTuple(IndexTuple itup, uint32 nipd);
 extern void ginPrepareEntryScan(GinBtree btree, OffsetNumber attnum,
 					Datum key, GinNullCategory category,
 					GinState *ginstate);
@@ -553,6 +567,15 @@ extern Buffer ginScanBeginPostingTree(GinPostingTreeScan *gdi);
 extern void ginDataFillRoot(GinBtree btree, Buffer root, Buffer lbuf, Buffer rbuf);
 extern void ginPrepareDataScan(GinBtree btree, Relation index);
 
+/* ginpostinglist.c */
+extern Size ginCompressedPostingListSize(ItemPointerData *ipd, uint32 nipd);
+extern Size ginCompressPostingList(ItemPointerData *ipd, uint32 nipd,
+					   char *dst);
+extern void ginDecompressPostingList(char *src, uint32 nipd,
+						 ItemPointerData *dst);
+extern ItemPointerData *ginReadTuple(IndexTuple itup, uint32 *nitems);
+extern void ginReadTupleFirstItem(IndexTuple itup, ItemPointer first);
+
 /* ginscan.c */
 
 /*
@@ -587,6 +610,13 @@ typedef struct GinScanKeyData
 	/* array of check flags, reported to consistentFn */
 	bool	   *entryRes;
 
+	/*
+	 * entryRequired[i] is TRUE if the consistentFn can't succeed unless the
+	 * i'th entry is present, so that this key can't match any TID that entry
+	 * hasn't reached yet.  Set up by startScanKey() in ginget.c.
+	 */
+	bool	   *entryRequired;
+
 	/* other data needed for calling consistentFn */
 	Datum		query;
 	/* NB: these three arrays have only nuserentries elements! */
@@ -621,8 +651,9 @@ typedef struct GinScanEntryData
 	int32		searchMode;
 	OffsetNumber attnum;
 
-	/* Current page in posting tree */
+	/* Current page in posting tree, and the tree's root */
 	Buffer		buffer;
+	BlockNumber postingRoot;
 
 	/* current ItemPointer to heap */
 	ItemPointerData curItem;
@@ -721,7 +752,7 @@ extern void ginHeapTupleFastCollect(GinState *ginstate,
 						GinTupleCollector *collector,
 						OffsetNumber attnum, Datum value, bool isNull,
 						ItemPointer ht_ctid);
-extern void ginInsertCleanup(GinState *ginstate,
+extern void ginInsertCleanup(GinState *ginstate, bool full_clean,
 				 bool vac_delay, IndexBulkDeleteResult *stats);
 
 #endif   /* GIN_PRIVATE_H */
@@ -32,37 +32,64 @@
  */
 typedef uint32 Bucket;
 
+#define InvalidBucket	((Bucket) 0xFFFFFFFF)
+
 #define BUCKET_TO_BLKNO(metap,B) \
 		((BlockNumber) ((B) + ((B) ? (metap)->hashm_spares[_hash_log2((B)+1)-1] : 0)) + 1)
 
 /*
  * Special space for hash index pages.
  *
- * hasho_flag tells us which type of page we're looking at.  For
- * example, knowing overflow pages from bucket pages is necessary
- * information when you're deleting tuples from a page. If all the
- * tuples are deleted from an overflow page, the overflow is made
- * available to other buckets by calling _hash_freeovflpage(). If all
- * the tuples are deleted from a bucket page, no additional action is
- * necessary.
+ * hasho_flag's LH_PAGE_TYPE bits tell us which type of page we're looking at.
+ * Additional bits in the flag word are used for more transient purposes.
+ *
+ * To test a page's type, do (hasho_flag & LH_PAGE_TYPE) == LH_xxx_PAGE.
+ * However, we ensure that each used page type has a distinct bit so that
+ * we can OR together page types for uses such as the allowable-page-types
+ * argument of _hash_checkpage().
+ *
+ * The LH_BUCKET_BEING_SPLIT, LH_BUCKET_BEING_POPULATED and
+ * LH_BUCKET_NEEDS_SPLIT_CLEANUP flags are only ever set on primary bucket
+ * pages; see the README for how an interrupted split is finished later.
  */
 #define LH_UNUSED_PAGE			(0)
 #define LH_OVERFLOW_PAGE		(1 << 0)
 #define LH_BUCKET_PAGE			(1 << 1)
 #define LH_BITMAP_PAGE			(1 << 2)
 #define LH_META_PAGE			(1 << 3)
+#define LH_BUCKET_BEING_POPULATED	(1 << 4)
+#define LH_BUCKET_BEING_SPLIT	(1 << 5)
+#define LH_BUCKET_NEEDS_SPLIT_CLEANUP	(1 << 6)
 
+#define LH_PAGE_TYPE \
+	(LH_OVERFLOW_PAGE | LH_BUCKET_PAGE | LH_BITMAP_PAGE | LH_META_PAGE)
+
+/*
+ * In an overflow page, hasho_prevblkno stores the block number of the previous
+ * page in the bucket chain; in a bucket page, hasho_prevblkno stores the
+ * hashm_maxbucket value as of the last time the bucket was split, or
+ * else as of the time the bucket was created.  The latter convention is used
+ * to determine whether a cached copy of the metapage is too stale to be used
+ * without needing to lock or pin the metapage.
+ *
+ * hasho_nextblkno is always the block number of the next page in the
+ * bucket chain, or InvalidBlockNumber if there are no more such pages.
+ */
 typedef struct HashPageOpaqueData
 {
-	BlockNumber hasho_prevblkno;	/* previous ovfl (or bucket) blkno */
-	BlockNumber hasho_nextblkno;	/* next ovfl blkno */
+	BlockNumber hasho_prevblkno;	/* see above */
+	BlockNumber hasho_nextblkno;	/* see above */
 	Bucket		hasho_bucket;	/* bucket number this pg belongs to */
-	uint16		hasho_flag;		/* page type code, see above */
+	uint16		hasho_flag;		/* page type code + flag bits, see above */
 	uint16		hasho_page_id;	/* for identification of hash indexes */
 } HashPageOpaqueData;
 
 typedef HashPageOpaqueData *HashPageOpaque;
 
+#define H_NEEDS_SPLIT_CLEANUP(opaque)	((opaque)->hasho_flag & LH_BUCKET_NEEDS_SPLIT_CLEANUP)
+#define H_BUCKET_BEING_SPLIT(opaque)	((opaque)->hasho_flag & LH_BUCKET_BEING_SPLIT)
+#define H_BUCKET_BEING_POPULATED(opaque)	((opaque)->hasho_flag & LH_BUCKET_BEING_POPULATED)
+
 /*
  * The page ID is for the convenience of pg_filedump and similar utilities,
  * which otherwise would have a hard time telling pages of different index
@@ -80,17 +107,18 @@ typedef struct HashScanOpaqueData
 	uint32		hashso_sk_hash;
 
 	/*
-	 * By definition, a hash scan should be examining only one bucket. We
-	 * record the bucket number here as soon as it is known.
+	 * We keep a pin on the primary page of the bucket being scanned for the
+	 * whole duration of the scan; that pin is what keeps a concurrent split,
+	 * squeeze or split cleanup out of the bucket (see README).
 	 */
-	Bucket		hashso_bucket;
-	bool		hashso_bucket_valid;
+	Buffer		hashso_bucket_buf;
 
 	/*
-	 * If we have a share lock on the bucket, we record it here.  When
-	 * hashso_bucket_blkno is zero, we have no such lock.
+	 * If the bucket being scanned was still being populated by a split when
+	 * the scan started, we also scan the bucket it is being split from, and
+	 * keep a pin on that bucket's primary page here.
 	 */
-	BlockNumber hashso_bucket_blkno;
+	Buffer		hashso_split_bucket_buf;
 
 	/*
 	 * We also want to remember which buffer we're currently examining in the
@@ -105,6 +133,15 @@ typedef struct HashScanOpaqueData
 
 	/* Current position of the scan, as a heap TID */
 	ItemPointerData hashso_heappos;
+
+	/* Whether scan starts on bucket being populated due to split */
+	bool		hashso_buc_populated;
+
+	/*
+	 * Whether scanning bucket being split?  The value of this parameter is
+	 * referred only when hashso_buc_populated is true.
+	 */
+	bool		hashso_buc_split;
 } HashScanOpaqueData;
 
 typedef HashScanOpaqueData *HashScanOpaque;
@@ -116,7 +153,7 @@ typedef HashScanOpaqueData *HashScanOpaque;
 #define HASH_METAPAGE	0		/* metapage is always block 0 */
 
 #define HASH_MAGIC		0x6440640
-#define HASH_VERSION	2		/* 2 signifies only hash key value is stored */
+#define HASH_VERSION	3		/* 3 signifies WAL-logged, incrementally split */
 
 /*
  * Spares[] holds the number of overflow pages currently allocated at or
@@ -166,6 +203,13 @@ typedef struct HashMetaPageData
 
 typedef HashMetaPageData *HashMetaPage;
 
+/*
+ * Index tuples copied into a new bucket by a split that has not finished yet
+ * carry this bit, so that scans of the new bucket can skip them and read the
+ * originals in the old bucket instead.
+ */
+#define INDEX_MOVED_BY_SPLIT_MASK	INDEX_AM_RESERVED_BIT
+
 /*
  * Maximum size of a hash index item (it's okay to have only one per page)
  */
@@ -223,9 +267,6 @@ typedef HashMetaPageData *HashMetaPage;
 #define HASH_WRITE		BUFFER_LOCK_EXCLUSIVE
 #define HASH_NOLOCK		(-1)
 
-#define HASH_SHARE		ShareLock
-#define HASH_EXCLUSIVE	ExclusiveLock
-
 /*
  *	Strategy number. There's only one valid strategy for hashing: equality.
  */
@@ -239,6 +280,201 @@ typedef HashMetaPageData *HashMetaPage;
  */
 #define HASHPROC		1
 
+/*
+ * XLOG records for hash operations
+ *
+ * The metapage, the initial bucket pages and bitmap page of a new index, and
+ * the pages of a new bucket filled by a split are logged as full page images
+ * with log_newpage().  Everything else is logged with one of the records
+ * below.  Each record names at most XLR_MAX_BKP_BLOCKS pages, registered in
+ * the order given; the redo routine depends on that order to find the
+ * backup blocks.
+ */
+#define XLOG_HASH_INSERT		0x10	/* add index tuple without split */
+#define XLOG_HASH_ADD_OVFL_PAGE	0x20	/* add overflow page */
+#define XLOG_HASH_SPLIT_ALLOCATE_PAGE	0x30	/* allocate new page for split */
+#define XLOG_HASH_SPLIT_COMPLETE	0x40	/* completion of split operation */
+#define XLOG_HASH_MOVE_PAGE_CONTENTS	0x50	/* squeeze: move tuples */
+#define XLOG_HASH_SQUEEZE_PAGE	0x60	/* squeeze: unlink an overflow page */
+#define XLOG_HASH_DELETE		0x70	/* delete index tuples from a page */
+#define XLOG_HASH_SPLIT_CLEANUP 0x80	/* clear split-cleanup flag in primary
+										 * bucket page after deleting tuples
+										 * that are moved due to split	*/
+#define XLOG_HASH_UPDATE_META_PAGE	0x90	/* update meta page after vacuum */
+
+/*
+ * This is what we need to know about a simple (without split) insert.
+ *
+ * Pages: the target page, then the metapage.  The index tuple follows the
+ * struct, and is omitted if the target page is backed up.
+ */
+typedef struct xl_hash_insert
+{
+	RelFileNode node;
+	BlockNumber blkno;
+	OffsetNumber offnum;
+	/* INDEX TUPLE FOLLOWS AT END OF STRUCT */
+} xl_hash_insert;
+
+#define SizeOfHashInsert	(offsetof(xl_hash_insert, offnum) + sizeof(OffsetNumber))
+
+/*
+ * This is what we need to know about the addition of an overflow page.
+ *
+ * Pages: the page it is chained after, then the bitmap page whose bit was
+ * set (only when a free page was reused), then the metapage.  The new
+ * overflow page and any newly created bitmap page are not registered: redo
+ * reinitializes them from the record.
+ */
+typedef struct xl_hash_add_ovfl_page
+{
+	RelFileNode node;
+	BlockNumber ovflblkno;		/* the new overflow page */
+	BlockNumber prevblkno;		/* the page it is chained after */
+	Bucket		bucket;			/* bucket both pages belong to */
+	BlockNumber mapblkno;		/* bitmap page marking a reused page, or
+								 * InvalidBlockNumber */
+	uint32		bitmap_page_bit;	/* bit set in mapblkno */
+	BlockNumber newmapblkno;	/* newly added bitmap page, or
+								 * InvalidBlockNumber */
+	uint16		bmsize;			/* hashm_bmsize, to init newmapblkno */
+	uint32		firstfree;		/* new hashm_firstfree */
+	uint32		spares;			/* new hashm_spares[hashm_ovflpoint] */
+} xl_hash_add_ovfl_page;
+
+#define SizeOfHashAddOvflPage	(offsetof(xl_hash_add_ovfl_page, spares) + sizeof(uint32))
+
+/*
+ * This is what we need to know about allocating a page for split.
+ *
+ * Pages: the old bucket's primary page, then the metapage.  The new
+ * bucket's primary page is not registered: redo reinitializes it from the
+ * record.  Redo takes a cleanup lock on the old primary page, just as the
+ * split did.
+ */
+typedef struct xl_hash_split_allocate_page
+{
+	RelFileNode node;
+	BlockNumber oblkno;			/* primary page of the bucket being split */
+	BlockNumber nblkno;			/* primary page of the new bucket */
+	Bucket		new_bucket;
+	uint32		maxbucket;		/* new hashm_maxbucket */
+	uint32		highmask;		/* new hashm_highmask */
+	uint32		lowmask;		/* new hashm_lowmask */
+	uint32		ovflpoint;		/* new hashm_ovflpoint */
+	uint32		spares;			/* new hashm_spares[ovflpoint] */
+} xl_hash_split_allocate_page;
+
+#define SizeOfHashSplitAllocPage	(offsetof(xl_hash_split_allocate_page, spares) + sizeof(uint32))
+
+/*
+ * This is what we need to know about completing the split operation.
+ *
+ * Pages: the old bucket's primary page, then the new bucket's.
+ */
+typedef struct xl_hash_split_complete
+{
+	RelFileNode node;
+	BlockNumber oblkno;
+	BlockNumber nblkno;
+	uint16		old_bucket_flag;
+	uint16		new_bucket_flag;
+} xl_hash_split_complete;
+
+#define SizeOfHashSplitComplete (offsetof(xl_hash_split_complete, new_bucket_flag) + sizeof(uint16))
+
+/*
+ * This is what we need to know about moving tuples from one page of a bucket
+ * to an earlier one while squeezing it.
+ *
+ * Pages: the page receiving the tuples, then the page they are taken from.
+ * The offsets the tuples were added at and the tuples themselves follow the
+ * struct, then the offsets deleted from the source page; each part is
+ * omitted if its page is backed up.  Redo takes a cleanup lock on the
+ * bucket's primary page first, just as the squeeze itself held one.
+ */
+typedef struct xl_hash_move_page_contents
+{
+	RelFileNode node;
+	BlockNumber bucketblkno;	/* primary page of the bucket */
+	BlockNumber wblkno;			/* page receiving the tuples */
+	BlockNumber rblkno;			/* page giving them up */
+	uint16		ntups;
+	/* TARGET OFFSETS AND TUPLES, THEN SOURCE OFFSETS, FOLLOW AT END */
+} xl_hash_move_page_contents;
+
+#define SizeOfHashMovePageContents	(offsetof(xl_hash_move_page_contents, ntups) + sizeof(uint16))
+
+/*
+ * This is what we need to know about unlinking an emptied overflow page
+ * from its bucket and marking it free.
+ *
+ * Pages: the previous page in the chain, the next one (if any), the bitmap
+ * page, then the metapage (only if hashm_firstfree changes).  The freed page
+ * is not registered: redo reinitializes it as an unused page.  Redo takes a
+ * cleanup lock on the bucket's primary page first.
+ */
+typedef struct xl_hash_squeeze_page
+{
+	RelFileNode node;
+	BlockNumber bucketblkno;	/* primary page of the bucket */
+	BlockNumber ovflblkno;		/* page being freed */
+	BlockNumber prevblkno;
+	BlockNumber nextblkno;		/* or InvalidBlockNumber */
+	BlockNumber mapblkno;
+	uint32		bitmapbit;		/* bit to clear in mapblkno */
+	bool		update_firstfree;
+	uint32		firstfree;		/* new hashm_firstfree, if updated */
+} xl_hash_squeeze_page;
+
+#define SizeOfHashSqueezePage	(offsetof(xl_hash_squeeze_page, firstfree) + sizeof(uint32))
+
+/*
+ * This is what we need to know about the deletion of index tuples from a
+ * page, by VACUUM or by split cleanup.
+ *
+ * Pages: the target page.  The deleted offsets follow the struct, and are
+ * omitted if the page is backed up.  Redo takes a cleanup lock on the
+ * bucket's primary page first.
+ */
+typedef struct xl_hash_delete
+{
+	RelFileNode node;
+	BlockNumber bucketblkno;	/* primary page of the bucket */
+	BlockNumber blkno;			/* page the tuples are deleted from */
+	/* TARGET OFFSET NUMBERS FOLLOW AT THE END */
+} xl_hash_delete;
+
+#define SizeOfHashDelete	(offsetof(xl_hash_delete, blkno) + sizeof(BlockNumber))
+
+/*
+ * This is what we need to know about clearing the split-cleanup flag once
+ * the tuples copied out by a split have been removed from the old bucket.
+ *
+ * Pages: the old bucket's primary page.
+ */
+typedef struct xl_hash_split_cleanup
+{
+	RelFileNode node;
+	BlockNumber blkno;
+} xl_hash_split_cleanup;
+
+#define SizeOfHashSplitCleanup	(offsetof(xl_hash_split_cleanup, blkno) + sizeof(BlockNumber))
+
+/*
+ * This is what we need for updating the tuple count in the metapage at the
+ * end of VACUUM.
+ *
+ * Pages: the metapage.
+ */
+typedef struct xl_hash_update_meta_page
+{
+	RelFileNode node;
+	double		ntuples;
+} xl_hash_update_meta_page;
+
+#define SizeOfHashUpdateMetaPage	(offsetof(xl_hash_update_meta_page, ntuples) + sizeof(double))
+
 
 /* public routines */
 
@@ -256,6 +492,14 @@ extern Datum hashbulkdelete(PG_FUNCTION_ARGS);
 extern Datum hashvacuumcleanup(PG_FUNCTION_ARGS);
 extern Datum hashoptions(PG_FUNCTION_ARGS);
 
+extern void hashbucketcleanup(Relation rel, Bucket cur_bucket,
+				  Buffer bucket_buf, BlockNumber bucket_blkno,
+				  BufferAccessStrategy bstrategy,
+				  uint32 maxbucket, uint32 highmask, uint32 lowmask,
+				  double *tuples_removed, double *num_index_tuples,
+				  bool split_cleanup,
+				  IndexBulkDeleteCallback callback, void *callback_state);
+
 /*
  * Datatype-specific hash functions in hashfunc.c.
  *
@@ -287,24 +531,34 @@ extern Datum hash_uint32(uint32 k);
 extern void _hash_doinsert(Relation rel, IndexTuple itup);
 extern OffsetNumber _hash_pgaddtup(Relation rel, Buffer buf,
 			   Size itemsize, IndexTuple itup);
+extern void _hash_pgaddmultitup(Relation rel, Buffer buf, IndexTuple *itups,
+					OffsetNumber *itup_offsets, uint16 nitups);
 
 /* hashovfl.c */
-extern Buffer _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf);
-extern BlockNumber _hash_freeovflpage(Relation rel, Buffer ovflbuf,
+extern Buffer _hash_addovflpage(Relation rel, Buffer metabuf, Buffer buf,
+				  bool retain_pin);
+extern BlockNumber _hash_freeovflpage(Relation rel, Buffer bucketbuf,
+				   Buffer ovflbuf, Buffer wbuf,
 				   BufferAccessStrategy bstrategy);
-extern void _hash_initbitmap(Relation rel, HashMetaPage metap,
-				 BlockNumber blkno, ForkNumber forkNum);
+extern void _hash_initbitmapbuffer(Buffer buf, uint16 bmsize, bool initpage);
 extern void _hash_squeezebucket(Relation rel,
 					Bucket bucket, BlockNumber bucket_blkno,
+					Buffer bucket_buf,
 					BufferAccessStrategy bstrategy);
 
 /* hashpage.c */
-extern void _hash_getlock(Relation rel, BlockNumber whichlock, int access);
-extern bool _hash_try_getlock(Relation rel, BlockNumber whichlock, int access);
-extern void _hash_droplock(Relation rel, BlockNumber whichlock, int access);
 extern Buffer _hash_getbuf(Relation rel, BlockNumber blkno,
 			 int access, int flags);
+extern Buffer _hash_getbuf_with_condlock_cleanup(Relation rel,
+								   BlockNumber blkno, int flags);
+extern HashMetaPage _hash_getcachedmetap(Relation rel, Buffer *metabuf,
+					 bool force_refresh);
+extern Buffer _hash_getbucketbuf_from_hashkey(Relation rel, uint32 hashkey,
+								int access,
+								HashMetaPage *cachedmetap);
 extern Buffer _hash_getinitbuf(Relation rel, BlockNumber blkno);
+extern void _hash_initbuf(Buffer buf, uint32 max_bucket, uint32 num_bucket,
+			  uint32 flag, bool initpage);
 extern Buffer _hash_getnewbuf(Relation rel, BlockNumber blkno,
 				ForkNumber forkNum);
 extern Buffer _hash_getbuf_with_strategy(Relation rel, BlockNumber blkno,
@@ -312,19 +566,14 @@ extern Buffer _hash_getbuf_with_strategy(Relation rel, BlockNumber blkno,
 						   BufferAccessStrategy bstrategy);
 extern void _hash_relbuf(Relation rel, Buffer buf);
 extern void _hash_dropbuf(Relation rel, Buffer buf);
-extern void _hash_wrtbuf(Relation rel, Buffer buf);
-extern void _hash_chgbufaccess(Relation rel, Buffer buf, int from_access,
-				   int to_access);
+extern void _hash_dropscanbuf(Relation rel, HashScanOpaque so);
 extern uint32 _hash_metapinit(Relation rel, double num_tuples,
 				ForkNumber forkNum);
 extern void _hash_pageinit(Page page, Size size);
 extern void _hash_expandtable(Relation rel, Buffer metabuf);
-
-/* hashscan.c */
-extern void _hash_regscan(IndexScanDesc scan);
-extern void _hash_dropscan(IndexScanDesc scan);
-extern bool _hash_has_active_scan(Relation rel, Bucket bucket);
-extern void ReleaseResources_hash(void);
+extern void _hash_finish_split(Relation rel, Buffer metabuf, Buffer obuf,
+				   Bucket obucket, uint32 maxbucket, uint32 highmask,
+				   uint32 lowmask);
 
 /* hashsearch.c */
 extern bool _hash_next(IndexScanDesc scan, ScanDirection dir);
@@ -352,8 +601,15 @@ extern IndexTuple _hash_form_tuple(Relation index,
 				 Datum *values, bool *isnull);
 extern OffsetNumber _hash_binsearch(Page page, uint32 hash_value);
 extern OffsetNumber _hash_binsearch_last(Page page, uint32 hash_value);
-
-/* hash.c */
+extern BlockNumber _hash_get_oldblock_from_newbucket(Relation rel,
+								  Bucket new_bucket);
+extern BlockNumber _hash_get_newblock_from_oldbucket(Relation rel,
+								  Bucket old_bucket);
+extern Bucket _hash_get_newbucket_from_oldbucket(Relation rel,
+								   Bucket old_bucket, uint32 lowmask,
+								   uint32 maxbucket);
+
+/* hashxlog.c */
 extern void hash_redo(XLogRecPtr lsn, XLogRecord *record);
 extern void hash_desc(StringInfo buf, uint8 xl_info, char *rec);
 
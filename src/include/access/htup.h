@@ -609,6 +609,7 @@ typedef HeapTupleData *HeapTuple;
 #define XLOG_HEAP2_CLEANUP_INFO 0x30
 #define XLOG_HEAP2_VISIBLE		0x40
 #define XLOG_HEAP2_MULTI_INSERT	0x50
+#define XLOG_HEAP2_LOGICAL		0x60
 
 /*
  * All what we need to find changed tuple
@@ -692,6 +693,47 @@ typedef struct xl_multi_insert_tuple
 
 #define SizeOfMultiInsertTuple	(offsetof(xl_multi_insert_tuple, t_hoff) + sizeof(uint8))
 
+/*
+ * Row change for logical decoding.  With wal_level = logical this is logged
+ * next to the regular insert, update or delete record of a user table, and
+ * carries what a decoder needs that those records lack: the relation's OID
+ * rather than its relfilenode, the old tuple of an UPDATE or DELETE, and the
+ * new tuple even when a full-page image made the regular record omit it.
+ * Redo ignores it.
+ *
+ * The old tuple (if XLH_LOGICAL_HAS_OLD) and then the new tuple (if
+ * XLH_LOGICAL_HAS_NEW) follow, each as an xl_heap_logical_tuple followed by
+ * its data.  Neither is aligned.
+ */
+#define XLH_LOGICAL_INSERT		'I'
+#define XLH_LOGICAL_UPDATE		'U'
+#define XLH_LOGICAL_DELETE		'D'
+
+#define XLH_LOGICAL_HAS_OLD		0x01
+#define XLH_LOGICAL_HAS_NEW		0x02
+
+typedef struct xl_heap_logical
+{
+	Oid			dbNode;			/* database of the relation */
+	Oid			relid;			/* pg_class OID of the relation */
+	char		action;			/* XLH_LOGICAL_INSERT etc */
+	uint8		flags;			/* XLH_LOGICAL_HAS_OLD etc */
+	/* TUPLES FOLLOW AT END OF STRUCT */
+} xl_heap_logical;
+
+#define SizeOfHeapLogical	(offsetof(xl_heap_logical, flags) + sizeof(uint8))
+
+typedef struct xl_heap_logical_tuple
+{
+	uint32		datalen;		/* size of tuple data that follows */
+	uint16		t_infomask2;
+	uint16		t_infomask;
+	uint8		t_hoff;
+	/* TUPLE DATA FOLLOWS AT END OF STRUCT */
+} xl_heap_logical_tuple;
+
+#define SizeOfHeapLogicalTuple	(offsetof(xl_heap_logical_tuple, t_hoff) + sizeof(uint8))
+
 /* This is what we need to know about update|hot_update */
 typedef struct xl_heap_update
 {
@@ -759,9 +801,10 @@ typedef struct xl_heap_lock
 	TransactionId locking_xid;	/* might be a MultiXactId not xid */
 	bool		xid_is_mxact;	/* is it? */
 	bool		shared_lock;	/* shared or exclusive row lock? */
+	bool		all_frozen_cleared;		/* VM all-frozen bit was cleared */
 } xl_heap_lock;
 
-#define SizeOfHeapLock	(offsetof(xl_heap_lock, shared_lock) + sizeof(bool))
+#define SizeOfHeapLock	(offsetof(xl_heap_lock, all_frozen_cleared) + sizeof(bool))
 
 /* This is what we need to know about in-place update */
 typedef struct xl_heap_inplace
@@ -788,9 +831,10 @@ typedef struct xl_heap_visible
 {
 	RelFileNode node;
 	BlockNumber block;
+	uint8		flags;			/* VISIBILITYMAP_* bits being set */
 } xl_heap_visible;
 
-#define SizeOfHeapVisible (offsetof(xl_heap_visible, block) + sizeof(BlockNumber))
+#define SizeOfHeapVisible (offsetof(xl_heap_visible, flags) + sizeof(uint8))
 
 extern void HeapTupleHeaderAdvanceLatestRemovedXid(HeapTupleHeader tuple,
 									   TransactionId *latestRemovedXid);
@@ -863,6 +907,8 @@ extern Datum fastgetattr(HeapTuple tup, int attnum, TupleDesc tupleDesc,
  *
  *		If the field in question has a NULL value, we return a zero Datum
  *		and set *isnull == true.  Otherwise, we set *isnull == false.
+ *		A tuple stored before the attribute was added to its relation
+ *		yields the attribute's missing value, if any (see getmissingattr).
  *
  *		<tup> is the pointer to the heap tuple.  <attnum> is the attribute
  *		number of the column (field) caller wants.	<tupleDesc> is a
@@ -874,10 +920,7 @@ extern Datum fastgetattr(HeapTuple tup, int attnum, TupleDesc tupleDesc,
 		((attnum) > 0) ? \
 		( \
 			((attnum) > (int) HeapTupleHeaderGetNatts((tup)->t_data)) ? \
-			( \
-				(*(isnull) = true), \
-				(Datum)NULL \
-			) \
+				getmissingattr((tupleDesc), (attnum), (isnull)) \
 			: \
 				fastgetattr((tup), (attnum), (tupleDesc), (isnull)) \
 		) \
@@ -885,6 +928,15 @@ extern Datum fastgetattr(HeapTuple tup, int attnum, TupleDesc tupleDesc,
 			heap_getsysattr((tup), (attnum), (tupleDesc), (isnull)) \
 	)
 
+/*
+ * Does the tuple lack some attributes of tupleDesc that have missing values,
+ * so that heap_expand_tuple is needed to give it all of its columns?
+ */
+#define HeapTupleNeedsExpansion(tup, tupleDesc) \
+	((tupleDesc)->constr != NULL && \
+	 (tupleDesc)->constr->missing != NULL && \
+	 HeapTupleHeaderGetNatts((tup)->t_data) < (tupleDesc)->natts)
+
 /* prototypes for functions in common/heaptuple.c */
 extern Size heap_compute_data_size(TupleDesc tupleDesc,
 					   Datum *values, bool *isnull);
@@ -892,13 +944,15 @@ extern void heap_fill_tuple(TupleDesc tupleDesc,
 				Datum *values, bool *isnull,
 				char *data, Size data_size,
 				uint16 *infomask, bits8 *bit);
-extern bool heap_attisnull(HeapTuple tup, int attnum);
+extern Datum getmissingattr(TupleDesc tupleDesc, int attnum, bool *isnull);
+extern bool heap_attisnull(HeapTuple tup, int attnum, TupleDesc tupleDesc);
 extern Datum nocachegetattr(HeapTuple tup, int attnum,
 			   TupleDesc att);
 extern Datum heap_getsysattr(HeapTuple tup, int attnum, TupleDesc tupleDesc,
 				bool *isnull);
 extern HeapTuple heap_copytuple(HeapTuple tuple);
 extern void heap_copytuple_with_tuple(HeapTuple src, HeapTuple dest);
+extern HeapTuple heap_expand_tuple(HeapTuple sourceTuple, TupleDesc tupleDesc);
 extern HeapTuple heap_form_tuple(TupleDesc tupleDescriptor,
 				Datum *values, bool *isnull);
 extern HeapTuple heap_modify_tuple(HeapTuple tuple,
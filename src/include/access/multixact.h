@@ -18,9 +18,9 @@
 
 #define MultiXactIdIsValid(multi) ((multi) != InvalidMultiXactId)
 
-/* Number of SLRU buffers to use for multixact */
-#define NUM_MXACTOFFSET_BUFFERS		8
-#define NUM_MXACTMEMBER_BUFFERS		16
+/* GUC parameters: numbers of SLRU buffers to use for multixact */
+extern int	multixact_offset_buffers;
+extern int	multixact_member_buffers;
 
 /* ----------------
  *		multixact-related XLOG entries
@@ -55,6 +55,8 @@ extern void AtEOXact_MultiXact(void);
 extern void AtPrepare_MultiXact(void);
 extern void PostPrepare_MultiXact(TransactionId xid);
 
+extern Size MultiXactOffsetShmemBuffers(void);
+extern Size MultiXactMemberShmemBuffers(void);
 extern Size MultiXactShmemSize(void);
 extern void MultiXactShmemInit(void);
 extern void BootStrapMultiXact(void);
@@ -119,6 +119,105 @@ typedef struct BTMetaPageData
 				   MAXALIGN(SizeOfPageHeaderData + 3*sizeof(ItemIdData)) - \
 				   MAXALIGN(sizeof(BTPageOpaqueData))) / 3)
 
+/*
+ * Alternative uses of t_tid: posting list tuples and truncated pivots
+ *
+ * On the leaf pages of a non-unique index, a run of tuples whose keys are
+ * binary-identical can be merged into a single "posting list" tuple: the
+ * key, followed by a sorted array of the heap TIDs of all the merged tuples.
+ * Since its t_tid no longer points at a heap tuple, we use it to store the
+ * byte offset of the TID array (in the block number) and the number of TIDs
+ * (in the offset number).  Everything before that offset is laid out exactly
+ * like a plain leaf tuple, so code that only looks at the key columns need
+ * not care which kind of tuple it has.
+ *
+ * High keys, and the downlinks on non-leaf pages that are copied from them,
+ * may be "truncated": they carry only the leading key columns that are
+ * needed to separate the two pages of a split (see _bt_truncate).  The
+ * columns that were cut off are treated as minus infinity by _bt_compare.
+ * The number of columns kept is stored in the offset number of t_tid; the
+ * block number remains free for the downlink.
+ *
+ * Both kinds of tuple are marked by BT_ALT_TID in t_info; BT_IS_POSTING in
+ * the offset number tells them apart.  High keys and tuples on non-leaf
+ * pages are never posting tuples, and leaf data tuples are never truncated.
+ * A tuple without BT_ALT_TID has all of the index's columns, and t_tid is
+ * either a heap TID (leaf page) or downlink block plus P_HIKEY (non-leaf).
+ */
+#define BT_ALT_TID		INDEX_AM_RESERVED_BIT
+#define BT_IS_POSTING	0x2000
+#define BT_OFFSET_MASK	0x0FFF
+
+#define BTreeTupleIsPosting(itup) \
+	(((itup)->t_info & BT_ALT_TID) != 0 && \
+	 ((itup)->t_tid.ip_posid & BT_IS_POSTING) != 0)
+#define BTreeTupleIsTruncated(itup) \
+	(((itup)->t_info & BT_ALT_TID) != 0 && \
+	 ((itup)->t_tid.ip_posid & BT_IS_POSTING) == 0)
+#define BTreeTupleGetNPosting(itup) \
+	((int) ((itup)->t_tid.ip_posid & BT_OFFSET_MASK))
+#define BTreeTupleGetPostingOffset(itup) \
+	((Size) BlockIdGetBlockNumber(&(itup)->t_tid.ip_blkid))
+#define BTreeTupleGetPostingN(itup, n) \
+	((ItemPointer) ((char *) (itup) + BTreeTupleGetPostingOffset(itup)) + (n))
+#define BTreeTupleSetPosting(itup, offset, n) \
+	do { \
+		(itup)->t_info |= BT_ALT_TID; \
+		BlockIdSet(&(itup)->t_tid.ip_blkid, (offset)); \
+		(itup)->t_tid.ip_posid = (n) | BT_IS_POSTING; \
+	} while (0)
+
+/*
+ * Number of key columns present; works for any tuple.  INCLUDE columns are
+ * not counted: they're never compared, and pivot tuples never have them.
+ */
+#define BTreeTupleGetNAtts(itup, rel) \
+	(BTreeTupleIsTruncated(itup) ? \
+	 (int) ((itup)->t_tid.ip_posid & BT_OFFSET_MASK) : \
+	 IndexRelationGetNumberOfKeyAttributes(rel))
+#define BTreeTupleSetNAtts(itup, n) \
+	do { \
+		(itup)->t_info |= BT_ALT_TID; \
+		(itup)->t_tid.ip_posid = (n); \
+	} while (0)
+
+/* Downlink of a non-leaf tuple; the setter preserves a truncated count */
+#define BTreeInnerTupleGetDownLink(itup) \
+	BlockIdGetBlockNumber(&(itup)->t_tid.ip_blkid)
+#define BTreeInnerTupleSetDownLink(itup, blkno) \
+	do { \
+		if (BTreeTupleIsTruncated(itup)) \
+			BlockIdSet(&(itup)->t_tid.ip_blkid, (blkno)); \
+		else \
+			ItemPointerSet(&(itup)->t_tid, (blkno), P_HIKEY); \
+	} while (0)
+
+/* These work for both plain and posting tuples */
+#define BTreeTupleGetNHeapTids(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetNPosting(itup) : 1)
+#define BTreeTupleGetHeapTid(itup, n) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPostingN(itup, n) : &(itup)->t_tid)
+#define BTreeTupleGetKeySize(itup) \
+	(BTreeTupleIsPosting(itup) ? BTreeTupleGetPostingOffset(itup) : \
+	 IndexTupleSize(itup))
+
+/*
+ * We limit posting tuples to half the maximum item size, so that a page
+ * holding a few of them can still be split reasonably evenly.
+ */
+#define BTMaxPostingSize(page) \
+	MAXALIGN_DOWN(Min(BTMaxItemSize(page) / 2, INDEX_SIZE_MASK))
+
+/*
+ * MaxTIDsPerBTreePage is an upper bound on the number of heap TIDs that can
+ * be stored on one leaf page, counting each TID of a posting tuple.  It is
+ * larger than MaxIndexTuplesPerPage, and is what scan-side arrays indexed by
+ * heap TID must be sized with.
+ */
+#define MaxTIDsPerBTreePage \
+	((int) ((BLCKSZ - SizeOfPageHeaderData - sizeof(BTPageOpaqueData)) / \
+			sizeof(ItemPointerData)))
+
 /*
  * The leaf-page fillfactor defaults to 90% but is user-adjustable.
  * For pages above the leaf level, we use a fixed 70% fillfactor.
@@ -147,13 +246,16 @@ typedef struct BTMetaPageData
  *	are unique, not in ALL INDEX. So, we can use the t_tid
  *	as unique identifier for a given index tuple (logical position
  *	within a level). - vadim 04/09/97
+ *
+ *	Since the offset number of a truncated pivot's t_tid holds its column
+ *	count, BTEntrySame looks only at the downlink block.
  */
 #define BTTidSame(i1, i2)	\
 	( (i1).ip_blkid.bi_hi == (i2).ip_blkid.bi_hi && \
 	  (i1).ip_blkid.bi_lo == (i2).ip_blkid.bi_lo && \
 	  (i1).ip_posid == (i2).ip_posid )
 #define BTEntrySame(i1, i2) \
-	BTTidSame((i1)->t_tid, (i2)->t_tid)
+	(BTreeInnerTupleGetDownLink(i1) == BTreeInnerTupleGetDownLink(i2))
 
 
 /*
@@ -224,6 +326,8 @@ typedef struct BTMetaPageData
 										 * vacuum */
 #define XLOG_BTREE_REUSE_PAGE	0xD0	/* old page is about to be reused from
 										 * FSM */
+#define XLOG_BTREE_DEDUP		0xE0	/* merge duplicates on a leaf page
+										 * into posting tuples */
 
 /*
  * All that we need to find changed index tuple
@@ -291,10 +395,10 @@ typedef struct xl_btree_split
 	 * than BlockNumber for alignment reasons: SizeOfBtreeSplit is only 16-bit
 	 * aligned.)
 	 *
-	 * If level > 0, an IndexTuple representing the HIKEY of the left page
-	 * follows.  We don't need this on leaf pages, because it's the same as
-	 * the leftmost key in the new right page.	Also, it's suppressed if
-	 * XLogInsert chooses to store the left page's whole page image.
+	 * Next is an IndexTuple representing the HIKEY of the left page.  (On
+	 * leaf pages this can't be derived from the right page, because it may
+	 * have been truncated.)  It's suppressed if XLogInsert chooses to store
+	 * the left page's whole page image.
 	 *
 	 * In the _L variants, next are OffsetNumber newitemoff and the new item.
 	 * (In the _R variants, the new item is one of the right page's tuples.)
@@ -340,7 +444,9 @@ typedef struct xl_btree_reuse_page
 /*
  * This is what we need to know about vacuum of individual leaf index tuples.
  * The WAL record can represent deletion of any number of index tuples on a
- * single index page when executed by VACUUM.
+ * single index page when executed by VACUUM.  It can also replace posting
+ * tuples that lost only some of their heap TIDs with smaller versions of
+ * themselves; updates are applied before deletions.
  *
  * The correctness requirement for applying these changes during recovery is
  * that we must do one of these two things for every block in the index:
@@ -363,11 +469,28 @@ typedef struct xl_btree_vacuum
 	RelFileNode node;
 	BlockNumber block;
 	BlockNumber lastBlockVacuumed;
+	uint16		ndeleted;
+	uint16		nupdated;
 
-	/* TARGET OFFSET NUMBERS FOLLOW */
+	/*
+	 * DELETED TARGET OFFSET NUMBERS FOLLOW, THEN UPDATED TARGET OFFSET
+	 * NUMBERS, THEN THE REPLACEMENT TUPLES FOR THE UPDATED TARGETS
+	 */
 } xl_btree_vacuum;
 
-#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, lastBlockVacuumed) + sizeof(BlockNumber))
+#define SizeOfBtreeVacuum	(offsetof(xl_btree_vacuum, nupdated) + sizeof(uint16))
+
+/*
+ * This is what we need to know about deduplication of a leaf page.  Redo
+ * simply repeats the pass, which depends on nothing but the page contents.
+ */
+typedef struct xl_btree_dedup
+{
+	RelFileNode node;
+	BlockNumber block;
+} xl_btree_dedup;
+
+#define SizeOfBtreeDedup	(offsetof(xl_btree_dedup, block) + sizeof(BlockNumber))
 
 /*
  * This is what we need to know about deletion of a btree page.  The target
@@ -481,7 +604,8 @@ typedef BTStackData *BTStack;
  * If we are doing an index-only scan, we save the entire IndexTuple for each
  * matched item, otherwise only its heap TID and offset.  The IndexTuples go
  * into a separate workspace array; each BTScanPosItem stores its tuple's
- * offset within that array.
+ * offset within that array.  A posting tuple yields one BTScanPosItem per
+ * heap TID, all sharing the same indexOffset and tupleOffset.
  */
 
 typedef struct BTScanPosItem	/* what we remember about each match */
@@ -523,7 +647,7 @@ typedef struct BTScanPosData
 	int			lastItem;		/* last valid index in items[] */
 	int			itemIndex;		/* current index in items[] */
 
-	BTScanPosItem items[MaxIndexTuplesPerPage]; /* MUST BE LAST */
+	BTScanPosItem items[MaxTIDsPerBTreePage]; /* MUST BE LAST */
 } BTScanPosData;
 
 typedef BTScanPosData *BTScanPos;
@@ -553,6 +677,16 @@ typedef struct BTScanOpaqueData
 	BTArrayKeyInfo *arrayKeys;	/* info about each equality-type array key */
 	MemoryContext arrayContext;	/* scan-lifespan context for array data */
 
+	/* workspace for skip scans; skipKeyData is also kept in arrayContext */
+	bool		skipScan;		/* iterating over leading-column values? */
+	bool		skipHaveValue;	/* skipKeyData[0] holds a current value */
+	ScanKey		skipKeyData;	/* leading-column "=" key + input keys */
+	bool		skipAttByVal;	/* typbyval of leading index column */
+	int16		skipAttLen;		/* typlen of leading index column */
+	bool		markSkipValid;	/* markSkipValue/markSkipIsNull are valid */
+	bool		markSkipIsNull;	/* leading-column value at marked position */
+	Datum		markSkipValue;
+
 	/* info about killed items if any (killedItems is NULL if never used) */
 	int		   *killedItems;	/* currPos.items indexes of killed items */
 	int			numKilled;		/* number of currently stored items */
@@ -592,6 +726,19 @@ typedef BTScanOpaqueData *BTScanOpaque;
 #define SK_BT_DESC			(INDOPTION_DESC << SK_BT_INDOPTION_SHIFT)
 #define SK_BT_NULLS_FIRST	(INDOPTION_NULLS_FIRST << SK_BT_INDOPTION_SHIFT)
 
+/*
+ * A scan with quals on the second index column but none on the first can
+ * be run as a "skip scan": one primitive scan per distinct leading-column
+ * value, each with an implicit "=" key on that value.  That costs a couple
+ * of tree descents per distinct value, so it only pays off when each value
+ * covers several leaf pages.  This macro is shared by the runtime check in
+ * nbtutils.c and by btcostestimate.
+ */
+#define BT_SKIP_PAGES_PER_VALUE		4
+#define BTSkipScanWorthwhile(ndistinct, npages) \
+	((ndistinct) >= 1.0 && \
+	 (ndistinct) * BT_SKIP_PAGES_PER_VALUE <= (double) (npages))
+
 /*
  * prototypes for functions in nbtree.c (external entry points for btree)
  */
@@ -614,7 +761,8 @@ extern Datum btoptions(PG_FUNCTION_ARGS);
  * prototypes for functions in nbtinsert.c
  */
 extern bool _bt_doinsert(Relation rel, IndexTuple itup,
-			 IndexUniqueCheck checkUnique, Relation heapRel);
+			 IndexUniqueCheck checkUnique, bool indexUnchanged,
+			 Relation heapRel);
 extern Buffer _bt_getstackbuf(Relation rel, BTStack stack, int access);
 extern void _bt_insert_parent(Relation rel, Buffer buf, Buffer rbuf,
 				  BTStack stack, bool is_root, bool is_only);
@@ -635,7 +783,9 @@ extern bool _bt_page_recyclable(Page page);
 extern void _bt_delitems_delete(Relation rel, Buffer buf,
 					OffsetNumber *itemnos, int nitems, Relation heapRel);
 extern void _bt_delitems_vacuum(Relation rel, Buffer buf,
-		   OffsetNumber *itemnos, int nitems, BlockNumber lastBlockVacuumed);
+					OffsetNumber *itemnos, int nitems,
+					OffsetNumber *updatenos, IndexTuple *updated, int nupdated,
+					BlockNumber lastBlockVacuumed);
 extern int	_bt_pagedel(Relation rel, Buffer buf, BTStack stack);
 
 /*
@@ -653,6 +803,7 @@ extern int32 _bt_compare(Relation rel, int keysz, ScanKey scankey,
 extern bool _bt_first(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_next(IndexScanDesc scan, ScanDirection dir);
 extern Buffer _bt_get_endpoint(Relation rel, uint32 level, bool rightmost);
+extern bool _bt_skip_advance(IndexScanDesc scan, ScanDirection dir);
 
 /*
  * prototypes for functions in nbtutils.c
@@ -664,6 +815,10 @@ extern void _bt_freestack(BTStack stack);
 extern void _bt_preprocess_array_keys(IndexScanDesc scan);
 extern void _bt_start_array_keys(IndexScanDesc scan, ScanDirection dir);
 extern bool _bt_advance_array_keys(IndexScanDesc scan, ScanDirection dir);
+extern void _bt_preprocess_skip_key(IndexScanDesc scan);
+extern void _bt_set_skip_value(IndexScanDesc scan, Datum value, bool isnull);
+extern void _bt_mark_skip_value(IndexScanDesc scan);
+extern void _bt_restore_skip_value(IndexScanDesc scan);
 extern void _bt_preprocess_keys(IndexScanDesc scan);
 extern IndexTuple _bt_checkkeys(IndexScanDesc scan,
 			  Page page, OffsetNumber offnum,
@@ -675,13 +830,25 @@ extern void _bt_end_vacuum(Relation rel);
 extern void _bt_end_vacuum_callback(int code, Datum arg);
 extern Size BTreeShmemSize(void);
 extern void BTreeShmemInit(void);
+extern bool _bt_dedup_same_key(IndexTuple itup1, IndexTuple itup2);
+extern Size _bt_posting_size(IndexTuple base, int nhtids);
+extern IndexTuple _bt_form_posting(IndexTuple base, ItemPointer htids,
+				 int nhtids);
+extern IndexTuple _bt_form_plain(IndexTuple itup);
+extern IndexTuple _bt_truncate(Relation rel, IndexTuple lastleft,
+			 IndexTuple firstright);
+extern Page _bt_dedup_build(Page page);
 
 /*
  * prototypes for functions in nbtsort.c
  */
 typedef struct BTSpool BTSpool; /* opaque type known only within nbtsort.c */
 
-extern BTSpool *_bt_spoolinit(Relation index, bool isunique, bool isdead);
+extern int	btree_build_partitions;
+
+extern BTSpool *_bt_spoolinit(Relation index, bool isunique, bool isdead,
+			  int nparts);
+extern BTSpool *_bt_spoolmerge(BTSpool **parts, int nparts);
 extern void _bt_spooldestroy(BTSpool *btspool);
 extern void _bt_spool(IndexTuple itup, BTSpool *btspool);
 extern void _bt_leafbuild(BTSpool *btspool, BTSpool *spool2);
@@ -691,6 +858,7 @@ extern void _bt_leafbuild(BTSpool *btspool, BTSpool *spool2);
  */
 extern void btree_redo(XLogRecPtr lsn, XLogRecord *record);
 extern void btree_desc(StringInfo buf, uint8 xl_info, char *rec);
+extern void btree_prefetch(XLogRecord *record, char *data, uint32 len);
 extern void btree_xlog_startup(void);
 extern void btree_xlog_cleanup(void);
 extern bool btree_safe_restartpoint(void);
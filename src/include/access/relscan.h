@@ -18,8 +18,27 @@
 #include "access/heapam.h"
 #include "access/itup.h"
 #include "access/tupdesc.h"
+#include "storage/bufmgr.h"
+#include "storage/spin.h"
 
 
+/*
+ * Shared state for a heap scan whose pages are divided up among several
+ * cooperating backends.  The struct must live in memory that all of them
+ * can see; each participant then starts its own scan with
+ * heap_beginscan_parallel() and claims chunks of consecutive blocks from
+ * here as it goes, so that every block is read by exactly one of them.
+ */
+typedef struct ParallelHeapScanDescData
+{
+	Oid			phs_relid;		/* OID of relation to scan */
+	BlockNumber phs_nblocks;	/* # blocks in relation at start of scan */
+	BlockNumber phs_startblock; /* starting block number */
+	bool		phs_syncscan;	/* report location to syncscan logic? */
+	slock_t		phs_mutex;		/* protects phs_nallocated */
+	BlockNumber phs_nallocated; /* # of blocks handed out so far */
+}	ParallelHeapScanDescData;
+
 typedef struct HeapScanDescData
 {
 	/* scan parameters */
@@ -33,8 +52,10 @@ typedef struct HeapScanDescData
 	bool		rs_allow_sync;	/* allow or disallow use of syncscan */
 
 	/* state set up at initscan time */
-	BlockNumber rs_nblocks;		/* number of blocks to scan */
+	BlockNumber rs_nblocks;		/* total number of blocks in rel */
 	BlockNumber rs_startblock;	/* block # to start at */
+	BlockNumber rs_numblocks;	/* max number of blocks to scan */
+	/* rs_numblocks is usually InvalidBlockNumber, meaning "scan whole rel" */
 	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
 	bool		rs_syncscan;	/* report location to syncscan logic? */
 
@@ -46,6 +67,16 @@ typedef struct HeapScanDescData
 	/* NB: if rs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
 	ItemPointerData rs_mctid;	/* marked scan position, if any */
 
+	/* these fields only used when the scan is shared with other backends */
+	ParallelHeapScanDesc rs_parallel;	/* shared allocator state, or NULL */
+	BlockNumber rs_pnext;		/* next position in our claimed chunk */
+	BlockNumber rs_pend;		/* end of our claimed chunk */
+
+	/* read-ahead state; rs_readstream is NULL if we don't prefetch */
+	ReadStream *rs_readstream;	/* queue of upcoming blocks */
+	BlockNumber rs_prefetch_next;	/* next block to queue */
+	BlockNumber rs_prefetch_left;	/* # of blocks still to queue */
+
 	/* these fields only used in page-at-a-time mode and for bitmap scans */
 	int			rs_cindex;		/* current tuple's index in vistuples */
 	int			rs_mindex;		/* marked tuple's saved index */
@@ -91,6 +122,13 @@ typedef struct IndexScanDescData
 
 	/* state data for traversing HOT chains in index_getnext */
 	bool		xs_continue_hot;	/* T if must keep walking HOT chain */
+
+	/*
+	 * Read-ahead of heap blocks.  An index AM that knows which TIDs it will
+	 * return next may set this up and queue their heap blocks; see
+	 * index_fetch_heap.  NULL if not used.
+	 */
+	ReadStream *xs_readstream;
 }	IndexScanDescData;
 
 /* Struct for heap-or-index scans of system tables */
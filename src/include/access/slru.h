@@ -36,6 +36,14 @@
  */
 #define SLRU_PAGES_PER_SEGMENT	32
 
+/*
+ * A page can only be kept in one bank of buffer slots, chosen by its page
+ * number, so that looking it up and choosing a victim to evict don't have
+ * to go through all the slots.  This is the largest number of slots per
+ * bank.
+ */
+#define SLRU_BANK_SIZE	16
+
 /*
  * Page status codes.  Note that these do not include the "dirty" bit.
  * page_dirty can be TRUE only in the VALID or WRITE_IN_PROGRESS states;
@@ -60,6 +68,9 @@ typedef struct SlruSharedData
 	/* Number of buffers managed by this SLRU structure */
 	int			num_slots;
 
+	/* Number of banks the buffers are divided into */
+	int			num_banks;
+
 	/*
 	 * Arrays holding info for each buffer slot.  Page number is undefined
 	 * when status is EMPTY, as is page_lru_count.
@@ -99,6 +110,14 @@ typedef struct SlruSharedData
 	 * the latest page.
 	 */
 	int			latest_page_number;
+
+	/*
+	 * Statistics.  Hits found under a shared control lock are counted
+	 * without an exclusive lock, so a few may get lost.
+	 */
+	int64		stat_hits;		/* lookups that found the page in a buffer */
+	int64		stat_reads;		/* pages read in from disk */
+	int64		stat_writes;	/* pages written out */
 } SlruSharedData;
 
 typedef SlruSharedData *SlruShared;
@@ -150,6 +169,9 @@ typedef bool (*SlruScanCallback) (SlruCtl ctl, char *filename, int segpage,
 					 void *data);
 extern bool SlruScanDirectory(SlruCtl ctl, SlruScanCallback callback, void *data);
 
+extern bool SlruGetStats(int index, const char **name, int *nslots,
+			 int64 *hits, int64 *reads, int64 *writes);
+
 /* SlruScanDirectory public callbacks */
 extern bool SlruScanDirCbReportPresence(SlruCtl ctl, char *filename,
 							int segpage, void *data);
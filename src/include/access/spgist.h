@@ -130,6 +130,8 @@ typedef struct spgInnerConsistentIn
 {
 	StrategyNumber strategy;	/* operator strategy number */
 	Datum		query;			/* operator's RHS value */
+	ScanKey		orderbys;		/* ordering operators, for an ordered scan */
+	int			norderbys;		/* number of ordering operators, or 0 */
 
 	Datum		reconstructedValue;		/* value reconstructed at parent */
 	int			level;			/* current level (counting from zero) */
@@ -149,6 +151,7 @@ typedef struct spgInnerConsistentOut
 	int		   *nodeNumbers;	/* their indexes in the node array */
 	int		   *levelAdds;		/* increment level by this much for each */
 	Datum	   *reconstructedValues;	/* associated reconstructed values */
+	double	  **distances;		/* associated distances, if norderbys > 0 */
 } spgInnerConsistentOut;
 
 /*
@@ -158,6 +161,8 @@ typedef struct spgLeafConsistentIn
 {
 	StrategyNumber strategy;	/* operator strategy number */
 	Datum		query;			/* operator's RHS value */
+	ScanKey		orderbys;		/* ordering operators, for an ordered scan */
+	int			norderbys;		/* number of ordering operators, or 0 */
 
 	Datum		reconstructedValue;		/* value reconstructed at parent */
 	int			level;			/* current level (counting from zero) */
@@ -170,6 +175,7 @@ typedef struct spgLeafConsistentOut
 {
 	Datum		leafValue;		/* reconstructed original data, if any */
 	bool		recheck;		/* set true if operator must be rechecked */
+	double	   *distances;		/* distances, if norderbys > 0 */
 } spgLeafConsistentOut;
 
 
@@ -17,6 +17,7 @@
 #include "access/itup.h"
 #include "access/spgist.h"
 #include "nodes/tidbitmap.h"
+#include "utils/rbtree.h"
 #include "utils/rel.h"
 
 
@@ -118,6 +119,24 @@ typedef struct SpGistState
 	bool		isBuild;		/* true if doing index build */
 } SpGistState;
 
+/*
+ * In an ordered (nearest-neighbor) scan, the unvisited items are kept in an
+ * RBTree ordered by distance, as for GiST.  Each SpGistSearchTreeItem holds
+ * all the unvisited items at the same distances, chained together; matched
+ * heap tuples come first in the chain, then inner nodes in LIFO order, so
+ * that ties are resolved depth-first.  The chained items are ScanStackEntrys,
+ * which are private to spgscan.c.
+ */
+typedef struct SpGistSearchTreeItem
+{
+	RBNode		rbnode;			/* this is an RBTree item */
+	struct ScanStackEntry *head;	/* first chain member */
+	struct ScanStackEntry *lastHeap;	/* last heap-tuple member, if any */
+	double		distances[1];	/* array with numberOfOrderBys entries */
+} SpGistSearchTreeItem;
+
+#define SGSTIHDRSZ offsetof(SpGistSearchTreeItem, distances)
+
 /*
  * Private state of an index scan
  */
@@ -133,6 +152,15 @@ typedef struct SpGistScanOpaqueData
 	/* Stack of yet-to-be-visited pages */
 	List	   *scanStack;		/* List of ScanStackEntrys */
 
+	/* These fields are only used in ordered scans: */
+	int			numberOfOrderBys;	/* number of ordering operators */
+	ScanKey		orderByData;	/* array of ordering op descriptors */
+	RBTree	   *queue;			/* queue of unvisited items */
+	MemoryContext queueCxt;		/* context holding the queue */
+	SpGistSearchTreeItem *curTreeItem;	/* current queue item, if any */
+	SpGistSearchTreeItem *tmpTreeItem;	/* workspace to pass to rb_insert */
+	double	   *distances;		/* workspace for computed distances */
+
 	/* These fields are only used in amgetbitmap scans: */
 	TIDBitmap  *tbm;			/* bitmap being filled */
 	int64		ntids;			/* number of TIDs passed to bitmap */
@@ -0,0 +1,174 @@
+/*-------------------------------------------------------------------------
+ *
+ * tableam.h
+ *	  API for table access methods
+ *
+ * A table access method decides how the rows of a table are stored.  The
+ * executor, COPY, VACUUM, ANALYZE and the planner reach a table's rows
+ * through the TableAmRoutine of its relation, rather than calling heapam.c
+ * directly, so that an extension can store some tables its own way.
+ * Tuples are passed in and out in TupleTableSlots.
+ *
+ * Copyright (c) 2012, PostgreSQL Global Development Group
+ *
+ * src/include/access/tableam.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TABLEAM_H
+#define TABLEAM_H
+
+#include "access/heapam.h"
+#include "executor/tuptable.h"
+#include "foreign/fdwapi.h"
+#include "nodes/parsenodes.h"
+#include "storage/buf.h"
+
+
+struct TableAmRoutine;
+
+/*
+ * Scan descriptor for a scan through a table access method.  Access methods
+ * embed this as the first field of their own scan state.
+ */
+typedef struct TableScanDescData
+{
+	Relation	rs_rd;			/* relation being scanned */
+	const struct TableAmRoutine *rs_tableam;	/* its access method */
+} TableScanDescData;
+
+typedef TableScanDescData *TableScanDesc;
+
+
+/*
+ * Callback function signatures --- see tableam.sgml for more info.
+ */
+
+typedef TableScanDesc (*BeginTableScan_function) (Relation rel,
+															Snapshot snapshot,
+															  int nkeys,
+															  ScanKey key);
+
+typedef bool (*IterateTableScan_function) (TableScanDesc scan,
+													ScanDirection direction,
+													   TupleTableSlot *slot);
+
+typedef void (*ReScanTable_function) (TableScanDesc scan, ScanKey key);
+
+typedef void (*EndTableScan_function) (TableScanDesc scan);
+
+typedef void (*MarkTableScanPos_function) (TableScanDesc scan);
+
+typedef void (*RestoreTableScanPos_function) (TableScanDesc scan);
+
+typedef bool (*FetchTableRow_function) (Relation rel,
+													ItemPointer tid,
+													Snapshot snapshot,
+													TupleTableSlot *slot);
+
+typedef Oid (*InsertTableRow_function) (Relation rel,
+													TupleTableSlot *slot,
+													CommandId cid,
+													int options,
+												  BulkInsertState bistate);
+
+typedef void (*MultiInsertTableRows_function) (Relation rel,
+														   HeapTuple *tuples,
+														   int ntuples,
+														   CommandId cid,
+														   int options,
+												  BulkInsertState bistate);
+
+typedef HTSU_Result (*DeleteTableRow_function) (Relation rel,
+															ItemPointer tid,
+															ItemPointer ctid,
+											   TransactionId *update_xmax,
+															CommandId cid,
+														 Snapshot crosscheck,
+															bool wait);
+
+typedef HTSU_Result (*UpdateTableRow_function) (Relation rel,
+														   ItemPointer otid,
+													   TupleTableSlot *slot,
+															ItemPointer ctid,
+											   TransactionId *update_xmax,
+															CommandId cid,
+														 Snapshot crosscheck,
+															bool wait,
+													  bool *update_indexes);
+
+typedef void (*FinishBulkInsert_function) (Relation rel, int options);
+
+typedef void (*VacuumTable_function) (Relation rel,
+												  VacuumStmt *vacstmt,
+										   BufferAccessStrategy bstrategy);
+
+typedef bool (*AnalyzeTable_function) (Relation rel,
+												   AcquireSampleRowsFunc *func,
+												   BlockNumber *totalpages);
+
+typedef void (*EstimateTableSize_function) (Relation rel,
+														int32 *attr_widths,
+														BlockNumber *pages,
+														double *tuples,
+														double *allvisfrac);
+
+
+/*
+ * TableAmRoutine is the struct of callbacks a table access method provides.
+ * The struct is never modified, so an access method can return a pointer
+ * to a static const one.
+ *
+ * Rows are identified by ItemPointers, which need not be physical
+ * addresses, but must be unique and stable until the row is updated or
+ * deleted, since ctid, TID scans and triggers rely on them.  Indexes,
+ * table rewrites and row locks work on heap pages, so tables of other
+ * access methods can't have them (see RelationIsHeap).
+ */
+typedef struct TableAmRoutine
+{
+	NodeTag		type;
+
+	/* Sequential scans */
+	BeginTableScan_function BeginTableScan;
+	IterateTableScan_function IterateTableScan;
+	ReScanTable_function ReScanTable;
+	EndTableScan_function EndTableScan;
+	MarkTableScanPos_function MarkTableScanPos;
+	RestoreTableScanPos_function RestoreTableScanPos;
+
+	/* Fetching a row by its ItemPointer */
+	FetchTableRow_function FetchTableRow;
+
+	/* Modifications; options are the HEAP_INSERT_* flags */
+	InsertTableRow_function InsertTableRow;
+	MultiInsertTableRows_function MultiInsertTableRows;
+	DeleteTableRow_function DeleteTableRow;
+	UpdateTableRow_function UpdateTableRow;
+	FinishBulkInsert_function FinishBulkInsert;
+
+	/* Maintenance, and planner support; these may be NULL */
+	VacuumTable_function VacuumTable;
+	AnalyzeTable_function AnalyzeTable;
+	EstimateTableSize_function EstimateTableSize;
+} TableAmRoutine;
+
+
+/*
+ * Hook for extensions to choose the access method of a table.  It's called
+ * once per relcache entry of a plain table; returning NULL means the table
+ * is a heap.
+ */
+typedef const TableAmRoutine *(*table_am_lookup_hook_type) (Relation rel);
+
+extern PGDLLIMPORT table_am_lookup_hook_type table_am_lookup_hook;
+
+/* in access/table/tableam.c */
+extern const TableAmRoutine *GetTableAmRoutine(Relation rel);
+extern bool RelationIsHeap(Relation rel);
+extern void CheckTableIsHeap(Relation rel, const char *what);
+
+/* in access/heap/heapam_handler.c */
+extern const TableAmRoutine *GetHeapamTableAmRoutine(void);
+
+#endif   /* TABLEAM_H */
@@ -123,6 +123,13 @@ typedef struct VariableCacheData
 	 */
 	TransactionId latestCompletedXid;	/* newest XID that has committed or
 										 * aborted */
+
+	/*
+	 * Bumped whenever a transaction with an XID completes, or anything else
+	 * happens that could change the result of GetSnapshotData.  A snapshot
+	 * computed when this had the same value as now can be reused as is.
+	 */
+	uint64		xactCompletionCount;
 } VariableCacheData;
 
 typedef VariableCacheData *VariableCache;
@@ -33,11 +33,22 @@ typedef struct constrCheck
 	bool		cconly;			/* this is a non-inheritable constraint */
 } ConstrCheck;
 
+/*
+ * Value of an attribute in tuples that were stored before the attribute was
+ * added to the relation, and so don't contain it (see heap_getattr).
+ */
+typedef struct attrMissing
+{
+	bool		am_present;		/* true if this attribute has a missing value */
+	Datum		am_value;		/* the value, if am_present */
+} AttrMissing;
+
 /* This structure contains constraints of a tuple */
 typedef struct tupleConstr
 {
 	AttrDefault *defval;		/* array */
 	ConstrCheck *check;			/* array */
+	AttrMissing *missing;		/* array of natts entries, or NULL if none */
 	uint16		num_defval;
 	uint16		num_check;
 	bool		has_not_null;
@@ -67,6 +78,11 @@ typedef struct tupleConstr
  * context and go away when the context is freed.  We set the tdrefcount
  * field of such a descriptor to -1, while reference-counted descriptors
  * always have tdrefcount >= 0.
+ *
+ * tddeform caches a compact copy of the per-attribute information needed to
+ * deform tuples of this descriptor; see TupleDescGetDeformInfo.  It is built
+ * on first use, so the attribute rows must not change after tuples have been
+ * deformed with the descriptor (the same is already true of attcacheoff).
  */
 typedef struct tupleDesc
 {
@@ -78,8 +94,39 @@ typedef struct tupleDesc
 	int32		tdtypmod;		/* typmod for tuple type */
 	bool		tdhasoid;		/* tuple has oid attribute in its header */
 	int			tdrefcount;		/* reference count, or -1 if not counting */
+	struct TupleDeformInfo *tddeform;	/* deforming info, or NULL if not
+										 * built yet */
 }	*TupleDesc;
 
+/*
+ * Per-attribute information used by the tuple deforming routines.  This is
+ * kept densely packed, so that the deforming loops touch one small array
+ * rather than chasing a pointer to each pg_attribute row, and the alignment
+ * is stored as a byte count so no attalign character needs decoding.
+ *
+ * cacheoff is the attribute's offset in the tuple data if it can be known
+ * without looking at the data, which is true as long as no earlier attribute
+ * is null or variable-width; otherwise it is -1.  Only a leading run of the
+ * attributes can have a cacheoff, and ncached is its length.
+ */
+typedef struct TupleDeformAttr
+{
+	int32		cacheoff;		/* fixed offset in tuple data, or -1 */
+	int16		attlen;			/* as in pg_attribute */
+	uint8		alignby;		/* required alignment, in bytes */
+	bool		attbyval;		/* as in pg_attribute */
+} TupleDeformAttr;
+
+typedef struct TupleDeformInfo
+{
+	int			ncached;		/* number of leading attrs with a cacheoff */
+	TupleDeformAttr attrs[1];	/* VARIABLE LENGTH ARRAY, natts entries */
+} TupleDeformInfo;
+
+#define TupleDescGetDeformInfo(tupdesc) \
+	((tupdesc)->tddeform != NULL ? (tupdesc)->tddeform : \
+	 BuildTupleDescDeformInfo(tupdesc))
+
 
 extern TupleDesc CreateTemplateTupleDesc(int natts, bool hasoid);
 
@@ -92,6 +139,8 @@ extern TupleDesc CreateTupleDescCopyConstr(TupleDesc tupdesc);
 
 extern void FreeTupleDesc(TupleDesc tupdesc);
 
+extern TupleDeformInfo *BuildTupleDescDeformInfo(TupleDesc tupdesc);
+
 extern void IncrTupleDescRefCount(TupleDesc tupdesc);
 extern void DecrTupleDescRefCount(TupleDesc tupdesc);
 
@@ -36,6 +36,11 @@
  * Note that we don't attempt to align either the BkpBlock struct or the
  * block's data.  So, the struct must be copied to aligned local storage
  * before use.
+ *
+ * If wal_compression is on, the block data (with the hole already removed)
+ * may further be stored as a pglz-compressed datum, PGLZ_Header included.
+ * In that case compressed_length > 0 gives the number of bytes following
+ * the BkpBlock struct, and the CRC covers those compressed bytes.
  */
 typedef struct BkpBlock
 {
@@ -44,6 +49,7 @@ typedef struct BkpBlock
 	BlockNumber block;			/* block number */
 	uint16		hole_offset;	/* number of bytes before "hole" */
 	uint16		hole_length;	/* number of bytes in "hole" */
+	uint16		compressed_length;		/* length of compressed data, or 0 */
 
 	/* ACTUAL BLOCK DATA FOLLOWS AT END OF STRUCT */
 } BkpBlock;
@@ -71,7 +77,7 @@ typedef struct XLogContRecord
 /*
  * Each page of XLOG file has a header like this:
  */
-#define XLOG_PAGE_MAGIC 0xD069	/* can be used as WAL version indicator */
+#define XLOG_PAGE_MAGIC 0xD070	/* can be used as WAL version indicator */
 
 typedef struct XLogPageHeaderData
 {
@@ -244,6 +250,9 @@ typedef XLogLongPageHeaderData *XLogLongPageHeader;
  * Method table for resource managers.
  *
  * RmgrTable[] is indexed by RmgrId values (see rmgr.h).
+ *
+ * rm_prefetch, if not NULL, is called for records that recovery looks ahead
+ * at, with as much of the rmgr data as is at hand; see XLogPrefetchBlock.
  */
 typedef struct RmgrData
 {
@@ -253,6 +262,7 @@ typedef struct RmgrData
 	void		(*rm_startup) (void);
 	void		(*rm_cleanup) (void);
 	bool		(*rm_safe_restartpoint) (void);
+	void		(*rm_prefetch) (XLogRecord *rptr, char *data, uint32 len);
 } RmgrData;
 
 extern const RmgrData RmgrTable[];
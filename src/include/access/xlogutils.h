@@ -11,6 +11,7 @@
 #ifndef XLOG_UTILS_H
 #define XLOG_UTILS_H
 
+#include "access/xlogdefs.h"
 #include "storage/bufmgr.h"
 
 
@@ -29,4 +30,11 @@ extern Buffer XLogReadBufferExtended(RelFileNode rnode, ForkNumber forknum,
 extern Relation CreateFakeRelcacheEntry(RelFileNode rnode);
 extern void FreeFakeRelcacheEntry(Relation fakerel);
 
+extern int	recovery_prefetch_distance;
+
+extern void XLogPrefetch(XLogRecPtr replayRecPtr, XLogRecPtr replayEndPtr,
+			 XLogRecPtr limitPtr, TimeLineID tli);
+extern void XLogPrefetchBlock(RelFileNode node, ForkNumber forknum,
+				  BlockNumber blkno);
+
 #endif
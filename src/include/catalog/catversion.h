@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	201112241
+#define CATALOG_VERSION_NO	201201025
 
 #endif
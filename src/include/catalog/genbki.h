@@ -39,4 +39,14 @@
 typedef int aclitem;
 typedef int pg_node_tree;
 
+/*
+ * The CATALOG definition has to refer to the type of columns such as
+ * pg_statistic.stavaluesN as "anyarray" so that bootstrap mode recognizes
+ * it.  There is no real typedef for that, however.  Since the fields are
+ * potentially-null and therefore can't be accessed directly from C code,
+ * there is no particular need for the C struct definition to show a valid
+ * field type --- instead we just make it int.
+ */
+typedef int anyarray;
+
 #endif   /* GENBKI_H */
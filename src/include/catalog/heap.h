@@ -96,6 +96,9 @@ extern List *AddRelationNewConstraints(Relation rel,
 						  bool is_only);
 
 extern void StoreAttrDefault(Relation rel, AttrNumber attnum, Node *expr);
+extern void StoreAttrMissingVal(Relation rel, AttrNumber attnum,
+					Datum missingval);
+extern void RelationClearMissing(Relation rel);
 
 extern Node *cookDefault(ParseState *pstate,
 			Node *raw_default,
@@ -110,6 +113,7 @@ extern void RemoveAttrDefault(Oid relid, AttrNumber attnum,
 				  DropBehavior behavior, bool complain);
 extern void RemoveAttrDefaultById(Oid attrdefId);
 extern void RemoveStatistics(Oid relid, AttrNumber attnum);
+extern void RemoveExtStatistics(Oid relid, AttrNumber attnum);
 
 extern Form_pg_attribute SystemAttributeDefinition(AttrNumber attno,
 						  bool relhasoids);
@@ -0,0 +1,99 @@
+/*-------------------------------------------------------------------------
+ *
+ * partition.h
+ *	  Range bounds of the children of an inheritance parent, as derived
+ *	  from the children's CHECK constraints.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/partition.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "fmgr.h"
+#include "nodes/primnodes.h"
+#include "utils/relcache.h"
+
+
+/*
+ * One end of a range of partition key values.  An infinite bound has no
+ * value; otherwise the range includes or excludes the value itself
+ * according to 'inclusive'.
+ */
+typedef struct PartitionBound
+{
+	Datum		value;
+	bool		infinite;
+	bool		inclusive;
+} PartitionBound;
+
+typedef struct PartitionRange
+{
+	PartitionBound lower;
+	PartitionBound upper;
+} PartitionRange;
+
+/*
+ * The partition descriptor of an inheritance parent.
+ *
+ * A direct child whose CHECK constraints confine the key column to a range,
+ * using the column type's default btree operators against constants, is
+ * "bounded"; the bounded children are kept sorted by range, and their
+ * ranges never overlap, so the children matching a range of key values
+ * can be found by binary search.  Any other children are "unbounded" and
+ * can never be excluded.  The key is the column bounded in the most
+ * children.  A parent none of whose children is bounded, or whose bounded
+ * children's ranges overlap, has no descriptor at all.
+ *
+ * The parent is "empty" if a CHECK constraint of its own (normally one added
+ * with ALTER TABLE ONLY ... ADD CHECK (false)) forbids it to hold any rows,
+ * so that all the rows are found in the children.
+ *
+ * The descriptor lives in its own context in the parent's relcache entry,
+ * and goes away at any invalidation of the entry; callers that might process
+ * invalidations while they use it (by taking a lock, say, or looking up a
+ * catalog entry) should work with a copy_partition_desc.
+ * It does not change when grandchildren come and go, since the ranges of
+ * inherited constraints apply to them too; caller must expand the
+ * surviving children further itself.
+ */
+typedef struct PartitionDescData
+{
+	AttrNumber	keyattno;		/* key column in the parent */
+	Oid			keytype;		/* its type */
+	Oid			keycoll;		/* its collation */
+	Oid			opfamily;		/* btree opfamily of the bound operators */
+	Oid			opcintype;		/* input type of its default opclass */
+	int16		keytyplen;
+	bool		keytypbyval;
+	FmgrInfo	cmpfn;			/* opfamily's comparison support function */
+	int			nbounded;
+	Oid		   *boundedoids;	/* bounded children, in range order */
+	PartitionRange *ranges;		/* and their ranges */
+	int			nunbounded;
+	Oid		   *unboundedoids;	/* all other children */
+	bool		parentempty;	/* can the parent itself hold no rows? */
+} PartitionDescData;
+
+typedef PartitionDescData *PartitionDesc;
+
+extern void RelationBuildPartitionDesc(Relation rel);
+extern PartitionDesc copy_partition_desc(PartitionDesc pdesc);
+extern int partition_clause_match(PartitionDesc pdesc, Expr *clause,
+					   Index varno, Expr **other);
+extern int partition_clause_strategy(PartitionDesc pdesc, Expr *clause,
+						  Index varno, Datum *value);
+extern void partition_range_restrict(PartitionDesc pdesc, PartitionRange *range,
+						 int strategy, Datum value);
+extern List *get_partitions_in_range(PartitionDesc pdesc, PartitionRange *range);
+extern Oid *get_partitions_excluded_by_range(PartitionDesc pdesc,
+								 PartitionRange *range, int *nexcluded);
+extern bool partition_bounds_equal(PartitionDesc pdesc1, PartitionDesc pdesc2);
+extern void CacheInvalidatePartitionParents(Oid relid);
+
+#endif   /* PARTITION_H */
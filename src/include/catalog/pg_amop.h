@@ -743,6 +743,7 @@ DATA(insert (	4015   600 600 5 s	508 4000 0 ));
 DATA(insert (	4015   600 600 10 s 509 4000 0 ));
 DATA(insert (	4015   600 600 6 s	510 4000 0 ));
 DATA(insert (	4015   600 603 8 s	511 4000 0 ));
+DATA(insert (	4015   600 600 15 o 517 4000 1970 ));
 
 /*
  * SP-GiST kd_point_ops
@@ -753,6 +754,7 @@ DATA(insert (	4016   600 600 5 s	508 4000 0 ));
 DATA(insert (	4016   600 600 10 s 509 4000 0 ));
 DATA(insert (	4016   600 600 6 s	510 4000 0 ));
 DATA(insert (	4016   600 603 8 s	511 4000 0 ));
+DATA(insert (	4016   600 600 15 o 517 4000 1970 ));
 
 /*
  * SP-GiST text_ops
@@ -767,4 +769,94 @@ DATA(insert (	4017   25 25 12 s	665 4000 0 ));
 DATA(insert (	4017   25 25 14 s	667 4000 0 ));
 DATA(insert (	4017   25 25 15 s	666 4000 0 ));
 
+/*
+ * BRIN int2_minmax_ops
+ */
+DATA(insert (	3165   21 21 1 s	95	3580 0 ));
+DATA(insert (	3165   21 21 2 s	522	3580 0 ));
+DATA(insert (	3165   21 21 3 s	94	3580 0 ));
+DATA(insert (	3165   21 21 4 s	524	3580 0 ));
+DATA(insert (	3165   21 21 5 s	520	3580 0 ));
+
+/*
+ * BRIN int4_minmax_ops
+ */
+DATA(insert (	3166   23 23 1 s	97	3580 0 ));
+DATA(insert (	3166   23 23 2 s	523	3580 0 ));
+DATA(insert (	3166   23 23 3 s	96	3580 0 ));
+DATA(insert (	3166   23 23 4 s	525	3580 0 ));
+DATA(insert (	3166   23 23 5 s	521	3580 0 ));
+
+/*
+ * BRIN int8_minmax_ops
+ */
+DATA(insert (	3167   20 20 1 s	412	3580 0 ));
+DATA(insert (	3167   20 20 2 s	414	3580 0 ));
+DATA(insert (	3167   20 20 3 s	410	3580 0 ));
+DATA(insert (	3167   20 20 4 s	415	3580 0 ));
+DATA(insert (	3167   20 20 5 s	413	3580 0 ));
+
+/*
+ * BRIN float4_minmax_ops
+ */
+DATA(insert (	3168   700 700 1 s	622	3580 0 ));
+DATA(insert (	3168   700 700 2 s	624	3580 0 ));
+DATA(insert (	3168   700 700 3 s	620	3580 0 ));
+DATA(insert (	3168   700 700 4 s	625	3580 0 ));
+DATA(insert (	3168   700 700 5 s	623	3580 0 ));
+
+/*
+ * BRIN float8_minmax_ops
+ */
+DATA(insert (	3169   701 701 1 s	672	3580 0 ));
+DATA(insert (	3169   701 701 2 s	673	3580 0 ));
+DATA(insert (	3169   701 701 3 s	670	3580 0 ));
+DATA(insert (	3169   701 701 4 s	675	3580 0 ));
+DATA(insert (	3169   701 701 5 s	674	3580 0 ));
+
+/*
+ * BRIN oid_minmax_ops
+ */
+DATA(insert (	3170   26 26 1 s	609	3580 0 ));
+DATA(insert (	3170   26 26 2 s	611	3580 0 ));
+DATA(insert (	3170   26 26 3 s	607	3580 0 ));
+DATA(insert (	3170   26 26 4 s	612	3580 0 ));
+DATA(insert (	3170   26 26 5 s	610	3580 0 ));
+
+/*
+ * BRIN date_minmax_ops
+ */
+DATA(insert (	3171   1082 1082 1 s	1095	3580 0 ));
+DATA(insert (	3171   1082 1082 2 s	1096	3580 0 ));
+DATA(insert (	3171   1082 1082 3 s	1093	3580 0 ));
+DATA(insert (	3171   1082 1082 4 s	1098	3580 0 ));
+DATA(insert (	3171   1082 1082 5 s	1097	3580 0 ));
+
+/*
+ * BRIN time_minmax_ops
+ */
+DATA(insert (	3172   1083 1083 1 s	1110	3580 0 ));
+DATA(insert (	3172   1083 1083 2 s	1111	3580 0 ));
+DATA(insert (	3172   1083 1083 3 s	1108	3580 0 ));
+DATA(insert (	3172   1083 1083 4 s	1113	3580 0 ));
+DATA(insert (	3172   1083 1083 5 s	1112	3580 0 ));
+
+/*
+ * BRIN timestamp_minmax_ops
+ */
+DATA(insert (	3173   1114 1114 1 s	2062	3580 0 ));
+DATA(insert (	3173   1114 1114 2 s	2063	3580 0 ));
+DATA(insert (	3173   1114 1114 3 s	2060	3580 0 ));
+DATA(insert (	3173   1114 1114 4 s	2065	3580 0 ));
+DATA(insert (	3173   1114 1114 5 s	2064	3580 0 ));
+
+/*
+ * BRIN timestamptz_minmax_ops
+ */
+DATA(insert (	3174   1184 1184 1 s	1322	3580 0 ));
+DATA(insert (	3174   1184 1184 2 s	1323	3580 0 ));
+DATA(insert (	3174   1184 1184 3 s	1320	3580 0 ));
+DATA(insert (	3174   1184 1184 4 s	1325	3580 0 ));
+DATA(insert (	3174   1184 1184 5 s	1324	3580 0 ));
+
 #endif   /* PG_AMOP_H */
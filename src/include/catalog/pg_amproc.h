@@ -118,11 +118,13 @@ DATA(insert (	1984   829 829 1 836 ));
 DATA(insert (	1986   19 19 1 359 ));
 DATA(insert (	1986   19 19 2 3135 ));
 DATA(insert (	1988   1700 1700 1 1769 ));
+DATA(insert (	1988   1700 1700 2 3182 ));
 DATA(insert (	1989   26 26 1 356 ));
 DATA(insert (	1989   26 26 2 3134 ));
 DATA(insert (	1991   30 30 1 404 ));
 DATA(insert (	2994   2249 2249 1 2987 ));
 DATA(insert (	1994   25 25 1 360 ));
+DATA(insert (	1994   25 25 2 3181 ));
 DATA(insert (	1996   1083 1083 1 1107 ));
 DATA(insert (	2000   1266 1266 1 1358 ));
 DATA(insert (	2002   1562 1562 1 1672 ));
@@ -180,6 +182,7 @@ DATA(insert (	2593   603 603 4 2580 ));
 DATA(insert (	2593   603 603 5 2581 ));
 DATA(insert (	2593   603 603 6 2582 ));
 DATA(insert (	2593   603 603 7 2584 ));
+DATA(insert (	2593   603 603 10 2580 ));
 DATA(insert (	2594   604 604 1 2585 ));
 DATA(insert (	2594   604 604 2 2583 ));
 DATA(insert (	2594   604 604 3 2586 ));
@@ -216,6 +219,8 @@ DATA(insert (	1029   600 600 5 2581 ));
 DATA(insert (	1029   600 600 6 2582 ));
 DATA(insert (	1029   600 600 7 2584 ));
 DATA(insert (	1029   600 600 8 3064 ));
+DATA(insert (	1029   600 600 9 3187 ));
+DATA(insert (	1029   600 600 10 3190 ));
 
 
 /* gin */
@@ -355,6 +360,8 @@ DATA(insert (	3919   3831 3831 4 3878 ));
 DATA(insert (	3919   3831 3831 5 3879 ));
 DATA(insert (	3919   3831 3831 6 3880 ));
 DATA(insert (	3919   3831 3831 7 3881 ));
+DATA(insert (	3919   3831 3831 9 3188 ));
+DATA(insert (	3919   3831 3831 10 3878 ));
 
 
 /* sp-gist */
@@ -374,4 +381,16 @@ DATA(insert (	4017   25 25 3 4029 ));
 DATA(insert (	4017   25 25 4 4030 ));
 DATA(insert (	4017   25 25 5 4031 ));
 
+/* brin */
+DATA(insert (	3165   21 21 1 350 ));
+DATA(insert (	3166   23 23 1 351 ));
+DATA(insert (	3167   20 20 1 842 ));
+DATA(insert (	3168   700 700 1 354 ));
+DATA(insert (	3169   701 701 1 355 ));
+DATA(insert (	3170   26 26 1 356 ));
+DATA(insert (	3171   1082 1082 1 1092 ));
+DATA(insert (	3172   1083 1083 1 1107 ));
+DATA(insert (	3173   1114 1114 1 2045 ));
+DATA(insert (	3174   1184 1184 1 1314 ));
+
 #endif   /* PG_AMPROC_H */
@@ -227,4 +227,16 @@ DATA(insert (	4000	quad_point_ops		PGNSP PGUID 4015  600 t 0 ));
 DATA(insert (	4000	kd_point_ops		PGNSP PGUID 4016  600 f 0 ));
 DATA(insert (	4000	text_ops			PGNSP PGUID 4017  25 t 0 ));
 
+/* BRIN minmax opclasses */
+DATA(insert (	3580	int2_minmax_ops			PGNSP PGUID 3165  21 t 0 ));
+DATA(insert (	3580	int4_minmax_ops			PGNSP PGUID 3166  23 t 0 ));
+DATA(insert (	3580	int8_minmax_ops			PGNSP PGUID 3167  20 t 0 ));
+DATA(insert (	3580	float4_minmax_ops		PGNSP PGUID 3168  700 t 0 ));
+DATA(insert (	3580	float8_minmax_ops		PGNSP PGUID 3169  701 t 0 ));
+DATA(insert (	3580	oid_minmax_ops			PGNSP PGUID 3170  26 t 0 ));
+DATA(insert (	3580	date_minmax_ops			PGNSP PGUID 3171  1082 t 0 ));
+DATA(insert (	3580	time_minmax_ops			PGNSP PGUID 3172  1083 t 0 ));
+DATA(insert (	3580	timestamp_minmax_ops	PGNSP PGUID 3173  1114 t 0 ));
+DATA(insert (	3580	timestamptz_minmax_ops	PGNSP PGUID 3174  1184 t 0 ));
+
 #endif   /* PG_OPCLASS_H */
@@ -1660,6 +1660,10 @@ DATA(insert OID = 2992 (  "<="	   PGNSP PGUID b f f 2249 2249 16 2993 2991 recor
 DESCR("less than or equal");
 DATA(insert OID = 2993 (  ">="	   PGNSP PGUID b f f 2249 2249 16 2992 2990 record_ge scalargtsel scalargtjoinsel ));
 DESCR("greater than or equal");
+DATA(insert OID = 3211 (  "*="	   PGNSP PGUID b f f 2249 2249 16 3211 3212 record_image_eq eqsel eqjoinsel ));
+DESCR("identical");
+DATA(insert OID = 3212 (  "*<>"	   PGNSP PGUID b f f 2249 2249 16 3212 3211 record_image_ne neqsel neqjoinsel ));
+DESCR("not identical");
 
 /* generic range type operators */
 DATA(insert OID = 3882 (  "="	   PGNSP PGUID b t t 3831 3831 16 3882 3883 range_eq eqsel eqjoinsel ));
@@ -145,5 +145,15 @@ DATA(insert OID = 3919 (	783		range_ops		PGNSP PGUID ));
 DATA(insert OID = 4015 (	4000	quad_point_ops	PGNSP PGUID ));
 DATA(insert OID = 4016 (	4000	kd_point_ops	PGNSP PGUID ));
 DATA(insert OID = 4017 (	4000	text_ops		PGNSP PGUID ));
+DATA(insert OID = 3165 (	3580	int2_minmax_ops			PGNSP PGUID ));
+DATA(insert OID = 3166 (	3580	int4_minmax_ops			PGNSP PGUID ));
+DATA(insert OID = 3167 (	3580	int8_minmax_ops			PGNSP PGUID ));
+DATA(insert OID = 3168 (	3580	float4_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 3169 (	3580	float8_minmax_ops		PGNSP PGUID ));
+DATA(insert OID = 3170 (	3580	oid_minmax_ops			PGNSP PGUID ));
+DATA(insert OID = 3171 (	3580	date_minmax_ops			PGNSP PGUID ));
+DATA(insert OID = 3172 (	3580	time_minmax_ops			PGNSP PGUID ));
+DATA(insert OID = 3173 (	3580	timestamp_minmax_ops	PGNSP PGUID ));
+DATA(insert OID = 3174 (	3580	timestamptz_minmax_ops	PGNSP PGUID ));
 
 #endif   /* PG_OPFAMILY_H */
@@ -21,16 +21,6 @@
 
 #include "catalog/genbki.h"
 
-/*
- * The CATALOG definition has to refer to the type of stavaluesN as
- * "anyarray" so that bootstrap mode recognizes it.  There is no real
- * typedef for that, however.  Since the fields are potentially-null and
- * therefore can't be accessed directly from C code, there is no particular
- * need for the C struct definition to show a valid field type --- instead
- * we just make it int.
- */
-#define anyarray int
-
 /* ----------------
  *		pg_statistic definition.  cpp turns this into
  *		typedef struct FormData_pg_statistic
@@ -129,8 +119,6 @@ CATALOG(pg_statistic,2619) BKI_WITHOUT_OIDS
 
 #define STATISTIC_NUM_SLOTS  4
 
-#undef anyarray
-
 
 /* ----------------
  *		Form_pg_statistic corresponds to a pointer to a tuple with
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_statistic_ext.h
+ *	  definition of the system "extended statistic" relation
+ *	  (pg_statistic_ext) along with the relation's initial contents.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/pg_statistic_ext.h
+ *
+ * NOTES
+ *	  the genbki.pl script reads this file and generates .bki
+ *	  information from the DATA() statements.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_STATISTIC_EXT_H
+#define PG_STATISTIC_EXT_H
+
+#include "catalog/genbki.h"
+
+/* ----------------
+ *		pg_statistic_ext definition.  cpp turns this into
+ *		typedef struct FormData_pg_statistic_ext
+ *
+ * Each row describes a group of columns of one table over which ANALYZE
+ * gathers statistics about the columns' joint distribution.  The row is
+ * created by ALTER TABLE ... ADD STATISTICS, and its statistical fields are
+ * filled in by each subsequent ANALYZE.
+ * ----------------
+ */
+#define StatisticExtRelationId	3179
+
+CATALOG(pg_statistic_ext,3179) BKI_WITHOUT_OIDS
+{
+	Oid			starelid;		/* relation containing the columns */
+
+	/*
+	 * stadistinct is the number of distinct combinations of values of the
+	 * columns, with the same interpretation as pg_statistic.stadistinct: 0
+	 * means not yet computed, a negative value is the negative of a
+	 * multiplier for the number of rows.  NULLs count as ordinary values.
+	 */
+	float4		stadistinct;
+
+	/* VARIABLE LENGTH FIELDS: */
+	int2vector	stakeys;		/* column numbers, in ascending order */
+
+	/*
+	 * stadependencies is a square matrix, stored by rows, of the degree to
+	 * which each column functionally determines each other one: element
+	 * [i * n + j] is the fraction of rows for which the value of column
+	 * stakeys[i] determines the value of column stakeys[j].  NULL until the
+	 * first ANALYZE.
+	 */
+	float4		stadependencies[1];
+} FormData_pg_statistic_ext;
+
+/* ----------------
+ *		Form_pg_statistic_ext corresponds to a pointer to a tuple with
+ *		the format of pg_statistic_ext relation.
+ * ----------------
+ */
+typedef FormData_pg_statistic_ext *Form_pg_statistic_ext;
+
+/* ----------------
+ *		compiler constants for pg_statistic_ext
+ * ----------------
+ */
+#define Natts_pg_statistic_ext					4
+#define Anum_pg_statistic_ext_starelid			1
+#define Anum_pg_statistic_ext_stadistinct		2
+#define Anum_pg_statistic_ext_stakeys			3
+#define Anum_pg_statistic_ext_stadependencies	4
+
+/* limits on the number of columns in one group */
+#define STATISTIC_EXT_MIN_COLUMNS	2
+#define STATISTIC_EXT_MAX_COLUMNS	8
+
+#endif   /* PG_STATISTIC_EXT_H */
@@ -27,6 +27,7 @@ extern Oid DefineIndex(RangeVar *heapRelation,
 			char *accessMethodName,
 			char *tableSpaceName,
 			List *attributeList,
+			List *includeList,
 			Expr *predicate,
 			List *options,
 			List *exclusionOpNames,
@@ -40,8 +41,8 @@ extern Oid DefineIndex(RangeVar *heapRelation,
 			bool skip_build,
 			bool quiet,
 			bool concurrent);
-extern void ReindexIndex(RangeVar *indexRelation);
-extern void ReindexTable(RangeVar *relation);
+extern void ReindexIndex(RangeVar *indexRelation, bool concurrent);
+extern void ReindexTable(RangeVar *relation, bool concurrent);
 extern void ReindexDatabase(const char *databaseName,
 				bool do_system, bool do_user);
 extern char *makeObjectName(const char *name1, const char *name2,
@@ -56,6 +57,7 @@ extern bool CheckIndexCompatible(Oid oldId,
 					 RangeVar *heapRelation,
 					 char *accessMethodName,
 					 List *attributeList,
+					 List *includeList,
 					 List *exclusionOpNames);
 extern Oid	GetDefaultOpClass(Oid type_id, Oid am_id);
 
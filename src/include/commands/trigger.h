@@ -36,6 +36,8 @@ typedef struct TriggerData
 	Trigger    *tg_trigger;
 	Buffer		tg_trigtuplebuf;
 	Buffer		tg_newtuplebuf;
+	Tuplestorestate *tg_oldtable;	/* OLD TABLE transition relation, if any */
+	Tuplestorestate *tg_newtable;	/* NEW TABLE transition relation, if any */
 } TriggerData;
 
 /*
@@ -187,6 +189,8 @@ extern void AfterTriggerEndSubXact(bool isCommit);
 extern void AfterTriggerSetState(ConstraintsSetStmt *stmt);
 extern bool AfterTriggerPendingOnRel(Oid relid);
 
+extern Datum pg_transition_table(PG_FUNCTION_ARGS);
+
 
 /*
  * in utils/adt/ri_triggers.c
@@ -197,6 +201,7 @@ extern bool RI_FKey_keyequal_upd_fk(Trigger *trigger, Relation fk_rel,
 						HeapTuple old_row, HeapTuple new_row);
 extern bool RI_Initial_Check(Trigger *trigger,
 				 Relation fk_rel, Relation pk_rel);
+extern void RI_ForgetAllCheckedKeys(void);
 
 /* result values for RI_FKey_trigger_type: */
 #define RI_TRIGGER_PK	1		/* is a trigger on the PK relation */
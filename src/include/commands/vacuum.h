@@ -121,9 +121,9 @@ typedef struct VacAttrStats
 	 * looked at by type-specific functions.
 	 */
 	int			tupattnum;		/* attribute number within tuples */
-	HeapTuple  *rows;			/* access info for std fetch function */
+	HeapTuple  *rows;			/* the sample rows */
 	TupleDesc	tupDesc;
-	Datum	   *exprvals;		/* access info for index fetch function */
+	Datum	   *exprvals;		/* access info for fetch function */
 	bool	   *exprnulls;
 	int			rowstride;
 } VacAttrStats;
@@ -164,8 +164,15 @@ extern void vacuum_delay_point(void);
 extern void lazy_vacuum_rel(Relation onerel, VacuumStmt *vacstmt,
 				BufferAccessStrategy bstrategy);
 
+/* in commands/vacuumcompact.c */
+extern bool compact_rel(Oid relid, VacuumStmt *vacstmt,
+			BufferAccessStrategy bstrategy);
+
 /* in commands/analyze.c */
 extern void analyze_rel(Oid relid, VacuumStmt *vacstmt,
 			BufferAccessStrategy bstrategy);
+extern double anl_random_fract(void);
+extern double anl_init_selection_state(int n);
+extern double anl_get_next_S(double t, int n, double *stateptr);
 
 #endif   /* VACUUM_H */
@@ -17,5 +17,7 @@
 #include "nodes/parsenodes.h"
 
 extern void DefineView(ViewStmt *stmt, const char *queryString);
+extern void StoreViewQuery(Oid viewOid, Query *viewParse, bool replace);
+extern bool isViewOnTempTable(Query *viewParse);
 
 #endif   /* VIEW_H */
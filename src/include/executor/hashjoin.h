@@ -102,6 +102,30 @@ typedef struct HashSkewBucket
 #define SKEW_WORK_MEM_PERCENT  2
 #define SKEW_MIN_OUTER_FRACTION  0.01
 
+/*
+ * To reduce palloc overhead, the HashJoinTuples for the current batch are
+ * packed in 32kB buffers instead of pallocing each tuple individually.
+ * Besides saving the per-chunk header and power-of-2 rounding of each
+ * palloc, this lets ExecHashIncreaseNumBatches walk the tuples
+ * sequentially in memory rather than chasing bucket chains.
+ */
+typedef struct HashMemoryChunkData
+{
+	int			ntuples;		/* number of tuples stored in this chunk */
+	size_t		maxlen;			/* size of the buffer holding the tuples */
+	size_t		used;			/* number of buffer bytes already used */
+
+	struct HashMemoryChunkData *next;	/* pointer to the next chunk (linked
+										 * list) */
+
+	char		data[1];		/* buffer allocated at the end */
+}	HashMemoryChunkData;
+
+typedef struct HashMemoryChunkData *HashMemoryChunk;
+
+#define HASH_CHUNK_SIZE			(32 * 1024L)
+#define HASH_CHUNK_THRESHOLD	(HASH_CHUNK_SIZE / 4)
+
 
 typedef struct HashJoinTableData
 {
@@ -157,6 +181,19 @@ typedef struct HashJoinTableData
 
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
+
+	/* used for dense allocation of tuples (into linked chunks) */
+	HashMemoryChunk chunks;		/* one list for the whole batch */
+
+	/*
+	 * Bloom filter over the hash values of all inner tuples (in any batch),
+	 * used to throw away outer tuples that can't have a match before probing
+	 * or saving them to a batch file.  NULL if not in use.  bloomShift is 32
+	 * minus log2 of the filter's size in bits.  It lives in hashCxt.
+	 */
+	uint32	   *bloomFilter;
+	uint32		bloomMask;		/* size of filter in bits, minus 1 */
+	int			bloomShift;
 }	HashJoinTableData;
 
 #endif   /* HASHJOIN_H */
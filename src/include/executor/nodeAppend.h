@@ -20,5 +20,8 @@ extern AppendState *ExecInitAppend(Append *node, EState *estate, int eflags);
 extern TupleTableSlot *ExecAppend(AppendState *node);
 extern void ExecEndAppend(AppendState *node);
 extern void ExecReScanAppend(AppendState *node);
+extern int ExecFindMatchingSubPlans(PartitionPruneInfo *pinfo,
+						 List *exprstates, ExprContext *econtext,
+						 bool *valid);
 
 #endif   /* NODEAPPEND_H */
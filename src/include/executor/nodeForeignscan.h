@@ -20,5 +20,7 @@ extern ForeignScanState *ExecInitForeignScan(ForeignScan *node, EState *estate,
 extern TupleTableSlot *ExecForeignScan(ForeignScanState *node);
 extern void ExecEndForeignScan(ForeignScanState *node);
 extern void ExecReScanForeignScan(ForeignScanState *node);
+extern bool ExecForeignScanStartAsync(ForeignScanState *node);
+extern pgsocket ExecForeignScanPollAsync(ForeignScanState *node);
 
 #endif   /* NODEFOREIGNSCAN_H */
@@ -49,5 +49,7 @@ extern void ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 						int *numbatches,
 						int *num_skew_mcvs);
 extern int	ExecHashGetSkewBucket(HashJoinTable hashtable, uint32 hashvalue);
+extern void ExecHashBloomInit(HashJoinTable hashtable, double ntuples);
+extern bool ExecHashBloomMayMatch(HashJoinTable hashtable, uint32 hashvalue);
 
 #endif   /* NODEHASH_H */
@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * tqueue.h
+ *	  Use shm_mq to send & receive tuples between parallel backends
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/tqueue.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef TQUEUE_H
+#define TQUEUE_H
+
+#include "access/htup.h"
+#include "storage/shm_mq.h"
+#include "tcop/dest.h"
+
+
+/* Use this to send tuples to a shm_mq. */
+extern DestReceiver *CreateTupleQueueDestReceiver(void);
+
+extern void SetTupleQueueDestReceiverParams(DestReceiver *self,
+								shm_mq_handle *handle);
+
+/* Use this to receive tuples from a shm_mq. */
+extern HeapTuple TupleQueueReadTuple(shm_mq_handle *handle, bool nowait,
+					bool *done);
+
+#endif   /* TQUEUE_H */
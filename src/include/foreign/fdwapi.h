@@ -20,7 +20,8 @@ struct ExplainState;
 
 
 /*
- * FdwPlan is the information returned to the planner by PlanForeignScan.
+ * FdwPlan is the information returned to the planner by PlanForeignScan,
+ * PlanForeignJoin and PlanForeignGrouping.
  */
 typedef struct FdwPlan
 {
@@ -45,6 +46,25 @@ typedef struct FdwPlan
 	 * that can be dumped usefully by nodeToString().
 	 */
 	List	   *fdw_private;
+
+	/*
+	 * Restriction clauses that the FDW guarantees to enforce remotely, so
+	 * that they need not be checked again locally.  These are bare clauses,
+	 * taken (by pointer) from the RestrictInfos the FDW was given; all other
+	 * clauses are still checked by the ForeignScan node.  For a join, any
+	 * join clause of an outer join (one whose RestrictInfo is not
+	 * is_pushed_down) must be enforced remotely.
+	 */
+	List	   *remote_conds;
+
+	/*
+	 * The sort ordering of the scan's output, as a List of PathKeys, if the
+	 * FDW has the remote server return the rows sorted; NIL if unordered.
+	 * root->query_pathkeys is the ordering that would be most useful.
+	 *
+	 * Neither remote_conds nor pathkeys is kept in the finished plan.
+	 */
+	List	   *pathkeys;
 } FdwPlan;
 
 
@@ -56,6 +76,19 @@ typedef FdwPlan *(*PlanForeignScan_function) (Oid foreigntableid,
 														  PlannerInfo *root,
 														RelOptInfo *baserel);
 
+typedef FdwPlan *(*PlanForeignJoin_function) (PlannerInfo *root,
+														  RelOptInfo *joinrel,
+														 RelOptInfo *outerrel,
+														 RelOptInfo *innerrel,
+														   JoinType jointype,
+													   SpecialJoinInfo *sjinfo,
+														List *restrictlist);
+
+typedef FdwPlan *(*PlanForeignGrouping_function) (PlannerInfo *root,
+															  RelOptInfo *rel,
+																 List *tlist,
+														   double num_groups);
+
 typedef void (*ExplainForeignScan_function) (ForeignScanState *node,
 													struct ExplainState *es);
 
@@ -68,15 +101,46 @@ typedef void (*ReScanForeignScan_function) (ForeignScanState *node);
 
 typedef void (*EndForeignScan_function) (ForeignScanState *node);
 
+typedef bool (*StartAsyncForeignScan_function) (ForeignScanState *node);
+
+typedef pgsocket (*PollAsyncForeignScan_function) (ForeignScanState *node);
+
+typedef int (*AcquireSampleRowsFunc) (Relation relation, int elevel,
+									   HeapTuple *rows, int targrows,
+									   double *totalrows,
+									   double *totaldeadrows);
+
+typedef bool (*AnalyzeForeignTable_function) (Relation relation,
+											  AcquireSampleRowsFunc *func,
+											  BlockNumber *totalpages);
+
 
 /*
  * FdwRoutine is the struct returned by a foreign-data wrapper's handler
  * function.  It provides pointers to the callback functions needed by the
  * planner and executor.
  *
- * Currently, all functions must be supplied.  Later there may be optional
- * additions.  It's recommended that the handler initialize the struct with
- * makeNode(FdwRoutine) so that all fields are set to zero.
+ * The functions up to EndForeignScan must be supplied.  The others are
+ * optional: a wrapper that can't perform joins or grouping remotely, run
+ * scans asynchronously or collect statistics, leaves them NULL.  It's recommended that the handler
+ * initialize the struct with makeNode(FdwRoutine) so that all fields are set
+ * to zero.
+ *
+ * StartAsyncForeignScan and PollAsyncForeignScan let an Append node run
+ * several foreign scans at once.  StartAsyncForeignScan is called before the
+ * first IterateForeignScan (and again after each rescan) to have the remote
+ * side start producing rows without waiting for them; it returns false if
+ * the scan can't run asynchronously, in which case it's executed normally.
+ * Once it has returned true, IterateForeignScan is only called when
+ * PollAsyncForeignScan returns PGINVALID_SOCKET, meaning that the next call
+ * won't block; otherwise it returns the socket to wait on for readability.
+ * Both must be supplied, or neither.
+ *
+ * AnalyzeForeignTable is called by ANALYZE on a foreign table.  It returns
+ * false if statistics can't be collected for the table; otherwise it sets
+ * *func to a function that returns a random sample of the table's rows, in
+ * the manner of the one ANALYZE uses for plain tables, and *totalpages to
+ * the table's size in pages, which is what is stored in relpages.
  */
 typedef struct FdwRoutine
 {
@@ -88,11 +152,17 @@ typedef struct FdwRoutine
 	IterateForeignScan_function IterateForeignScan;
 	ReScanForeignScan_function ReScanForeignScan;
 	EndForeignScan_function EndForeignScan;
+	PlanForeignJoin_function PlanForeignJoin;
+	PlanForeignGrouping_function PlanForeignGrouping;
+	StartAsyncForeignScan_function StartAsyncForeignScan;
+	PollAsyncForeignScan_function PollAsyncForeignScan;
+	AnalyzeForeignTable_function AnalyzeForeignTable;
 } FdwRoutine;
 
 
 /* Functions in foreign/foreign.c */
 extern FdwRoutine *GetFdwRoutine(Oid fdwhandler);
+extern FdwRoutine *GetFdwRoutineByServerId(Oid serverid);
 extern FdwRoutine *GetFdwRoutineByRelId(Oid relid);
 
 #endif   /* FDWAPI_H */
@@ -0,0 +1,636 @@
+/*-------------------------------------------------------------------------
+ *
+ * simplehash.h
+ *	  An open-addressing hash table that is compiled for one element type
+ *	  and hash and comparison function, so that those can be inlined.
+ *
+ * dynahash.c chains the entries of each bucket together, and calls its
+ * hash and match functions through pointers.  For tables that are looked
+ * up once per input row, the cache misses walking the chains and the
+ * indirect calls dominate.  This table instead keeps the elements
+ * themselves in one array, and resolves collisions by linear probing,
+ * using "Robin Hood" insertion: an element being inserted takes the place
+ * of any element it meets that is nearer to its own optimal bucket, so all
+ * probe sequences stay short even at a high fill factor.  Deletion shifts
+ * the following elements of a run back, rather than leaving tombstones.
+ *
+ * Including this file after defining the macros below generates a hash
+ * table type and the functions working on it:
+ *
+ *	 SH_PREFIX - prefix of all the names generated, e.g. foo gives foo_hash
+ *		for the table type and foo_insert etc for the functions
+ *	 SH_ELEMENT_TYPE - the type of the elements; it must have a member
+ *		"status" of an integral type, which the table manages, and which is
+ *		zero in an unused element
+ *	 SH_KEY_TYPE - the type of the key
+ *	 SH_KEY - the name of the element member holding the key
+ *	 SH_HASH_KEY(tb, key) - an expression computing the uint32 hash of a key
+ *	 SH_EQUAL(tb, a, b) - an expression testing whether key a, from an
+ *		element of the table, equals key b, being looked up
+ *	 SH_SCOPE - the storage class of the functions, e.g. "static inline"
+ *	 SH_DECLARE - define to declare the type and functions
+ *	 SH_DEFINE - define to define the functions
+ *
+ * and optionally
+ *
+ *	 SH_STORE_HASH - define if the element keeps the hash value of its key,
+ *		to save recomputing it when the table is grown and to skip most
+ *		calls to SH_EQUAL
+ *	 SH_GET_HASH(tb, a) - the member of element a holding the hash, as an
+ *		lvalue; required with SH_STORE_HASH
+ *
+ * The generated table has a member private_data, for the caller's use in
+ * SH_HASH_KEY and SH_EQUAL.  Inserting into or deleting from a table moves
+ * its elements about, so pointers to elements are good only until the next
+ * insertion or deletion.  While the table is being iterated over, the
+ * element last returned may be deleted; other changes may make the scan
+ * miss elements or return some twice.  Callers that need stable storage for their entries should
+ * keep a pointer to it in the element.
+ *
+ * The table array is allocated with palloc in the context given at
+ * creation, so it is limited to MaxAllocSize.  All the macros are
+ * undefined again at the end, so the file can be included several times
+ * in one module.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/lib/simplehash.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "utils/memutils.h"
+
+/* helpers */
+#define SH_MAKE_NAME(name) SH_MAKE_NAME_(SH_PREFIX, name)
+#define SH_MAKE_NAME_(a,b) SH_MAKE_NAME__(a,b)
+#define SH_MAKE_NAME__(a,b) a##_##b
+
+/* name macros for: */
+
+/* type declarations */
+#define SH_TYPE SH_MAKE_NAME(hash)
+#define SH_STATUS SH_MAKE_NAME(status)
+#define SH_STATUS_EMPTY SH_MAKE_NAME(SH_EMPTY)
+#define SH_STATUS_IN_USE SH_MAKE_NAME(SH_IN_USE)
+#define SH_ITERATOR SH_MAKE_NAME(iterator)
+
+/* function declarations */
+#define SH_CREATE SH_MAKE_NAME(create)
+#define SH_DESTROY SH_MAKE_NAME(destroy)
+#define SH_RESET SH_MAKE_NAME(reset)
+#define SH_INSERT SH_MAKE_NAME(insert)
+#define SH_DELETE SH_MAKE_NAME(delete)
+#define SH_LOOKUP SH_MAKE_NAME(lookup)
+#define SH_GROW SH_MAKE_NAME(grow)
+#define SH_START_ITERATE SH_MAKE_NAME(start_iterate)
+#define SH_ITERATE SH_MAKE_NAME(iterate)
+
+/* internal helper functions */
+#define SH_COMPUTE_PARAMETERS SH_MAKE_NAME(compute_parameters)
+#define SH_NEXT SH_MAKE_NAME(next)
+#define SH_PREV SH_MAKE_NAME(prev)
+#define SH_DISTANCE_FROM_OPTIMAL SH_MAKE_NAME(distance)
+#define SH_INITIAL_BUCKET SH_MAKE_NAME(initial_bucket)
+#define SH_ENTRY_HASH SH_MAKE_NAME(entry_hash)
+
+/* generate forward declarations necessary to use the hash table */
+#ifdef SH_DECLARE
+
+/* the table itself */
+typedef struct SH_TYPE
+{
+	uint32		size;			/* number of buckets, a power of 2 */
+	uint32		sizemask;		/* size - 1 */
+	uint32		members;		/* number of elements in use */
+	uint32		grow_threshold; /* grow when members reach this */
+	SH_ELEMENT_TYPE *data;		/* the buckets */
+	MemoryContext ctx;			/* where data is allocated */
+	void	   *private_data;	/* for the caller's callbacks */
+} SH_TYPE;
+
+typedef enum SH_STATUS
+{
+	SH_STATUS_EMPTY = 0x00,
+	SH_STATUS_IN_USE = 0x01
+} SH_STATUS;
+
+typedef struct SH_ITERATOR
+{
+	uint32		cur;			/* next bucket to look at */
+	uint32		end;			/* bucket the scan started at */
+	bool		done;			/* have all buckets been looked at? */
+} SH_ITERATOR;
+
+SH_SCOPE SH_TYPE *SH_CREATE(MemoryContext ctx, uint32 nelements,
+		  void *private_data);
+SH_SCOPE void SH_DESTROY(SH_TYPE *tb);
+SH_SCOPE void SH_RESET(SH_TYPE *tb);
+SH_SCOPE void SH_GROW(SH_TYPE *tb, uint32 newsize);
+SH_SCOPE SH_ELEMENT_TYPE *SH_INSERT(SH_TYPE *tb, SH_KEY_TYPE key,
+		  bool *found);
+SH_SCOPE SH_ELEMENT_TYPE *SH_LOOKUP(SH_TYPE *tb, SH_KEY_TYPE key);
+SH_SCOPE bool SH_DELETE(SH_TYPE *tb, SH_KEY_TYPE key);
+SH_SCOPE void SH_START_ITERATE(SH_TYPE *tb, SH_ITERATOR *iter);
+SH_SCOPE SH_ELEMENT_TYPE *SH_ITERATE(SH_TYPE *tb, SH_ITERATOR *iter);
+
+#endif   /* SH_DECLARE */
+
+
+/* generate implementation of the hash table */
+#ifdef SH_DEFINE
+
+/* normal fill factor, and the one used once the table is as big as it gets */
+#define SH_FILLFACTOR (0.9)
+#define SH_MAX_FILLFACTOR (0.98)
+
+/*
+ * If an insertion has to probe, or to move, more elements than this, the
+ * keys are clustering badly (for instance because they arrive in the order
+ * of their hash values), and the table is grown early, unless it's still
+ * nearly empty.
+ */
+#define SH_GROW_MAX_DIB 25
+#define SH_GROW_MAX_MOVE 150
+#define SH_GROW_MIN_FILLFACTOR 0.1
+#define SH_CAN_GROW_EARLY(tb) \
+	(((double) (tb)->members / (tb)->size) >= SH_GROW_MIN_FILLFACTOR && \
+	 (uint64) (tb)->size * 2 <= MaxAllocSize / sizeof(SH_ELEMENT_TYPE))
+
+#ifdef SH_STORE_HASH
+#define SH_COMPARE_KEYS(tb, ahash, akey, b) \
+	(ahash == SH_GET_HASH(tb, b) && SH_EQUAL(tb, b->SH_KEY, akey))
+#else
+#define SH_COMPARE_KEYS(tb, ahash, akey, b) (SH_EQUAL(tb, b->SH_KEY, akey))
+#endif
+
+/*
+ * Set up the size-dependent fields for a table of newsize buckets.
+ */
+static inline void
+SH_COMPUTE_PARAMETERS(SH_TYPE *tb, uint32 newsize)
+{
+	uint64		maxsize = MaxAllocSize / sizeof(SH_ELEMENT_TYPE);
+
+	if (newsize == 0 || newsize > maxsize)
+		elog(ERROR, "hash table size exceeded");
+
+	tb->size = newsize;
+	tb->sizemask = newsize - 1;
+
+	/* there has to be an empty bucket, to end lookups of missing keys */
+	if ((uint64) newsize * 2 > maxsize)
+		tb->grow_threshold = (uint32) (newsize * SH_MAX_FILLFACTOR);
+	else
+		tb->grow_threshold = (uint32) (newsize * SH_FILLFACTOR);
+	if (tb->grow_threshold >= newsize)
+		tb->grow_threshold = newsize - 1;
+}
+
+/* the bucket a hash value would ideally go in */
+static inline uint32
+SH_INITIAL_BUCKET(SH_TYPE *tb, uint32 hash)
+{
+	return hash & tb->sizemask;
+}
+
+static inline uint32
+SH_NEXT(SH_TYPE *tb, uint32 curelem)
+{
+	return (curelem + 1) & tb->sizemask;
+}
+
+static inline uint32
+SH_PREV(SH_TYPE *tb, uint32 curelem)
+{
+	return (curelem - 1) & tb->sizemask;
+}
+
+/* how far an element in bucket is from its optimal bucket */
+static inline uint32
+SH_DISTANCE_FROM_OPTIMAL(SH_TYPE *tb, uint32 optimal, uint32 bucket)
+{
+	if (optimal <= bucket)
+		return bucket - optimal;
+	else
+		return (tb->size + bucket) - optimal;
+}
+
+static inline uint32
+SH_ENTRY_HASH(SH_TYPE *tb, SH_ELEMENT_TYPE *entry)
+{
+#ifdef SH_STORE_HASH
+	return SH_GET_HASH(tb, entry);
+#else
+	return SH_HASH_KEY(tb, entry->SH_KEY);
+#endif
+}
+
+/*
+ * Create a hash table with enough buckets for nelements elements, in
+ * memory context ctx.
+ */
+SH_SCOPE SH_TYPE *
+SH_CREATE(MemoryContext ctx, uint32 nelements, void *private_data)
+{
+	SH_TYPE    *tb;
+	uint64		maxsize = MaxAllocSize / sizeof(SH_ELEMENT_TYPE);
+	uint64		want = (uint64) (nelements / SH_FILLFACTOR);
+	uint64		size = 2;
+
+	tb = MemoryContextAllocZero(ctx, sizeof(SH_TYPE));
+	tb->ctx = ctx;
+	tb->private_data = private_data;
+
+	/* round up to a power of 2, but no further than we can allocate */
+	while (size < want && size * 2 <= maxsize)
+		size <<= 1;
+
+	SH_COMPUTE_PARAMETERS(tb, (uint32) size);
+	tb->data = MemoryContextAllocZero(ctx, sizeof(SH_ELEMENT_TYPE) * tb->size);
+
+	return tb;
+}
+
+/* destroy a previously created hash table */
+SH_SCOPE void
+SH_DESTROY(SH_TYPE *tb)
+{
+	pfree(tb->data);
+	pfree(tb);
+}
+
+/* remove all the elements, keeping the current size */
+SH_SCOPE void
+SH_RESET(SH_TYPE *tb)
+{
+	memset(tb->data, 0, sizeof(SH_ELEMENT_TYPE) * tb->size);
+	tb->members = 0;
+}
+
+/*
+ * Move the elements into a new array of newsize buckets, which must be a
+ * power of 2.
+ *
+ * Inserting the elements in the order of their old buckets, starting at the
+ * beginning of a run, puts each one at or after the place of any element
+ * wanting an earlier bucket, so plain linear probing keeps the Robin Hood
+ * ordering.
+ */
+SH_SCOPE void
+SH_GROW(SH_TYPE *tb, uint32 newsize)
+{
+	uint32		oldsize = tb->size;
+	uint32		oldmask = tb->sizemask;
+	SH_ELEMENT_TYPE *olddata = tb->data;
+	SH_ELEMENT_TYPE *newdata;
+	uint32		i;
+	uint32		startelem = 0;
+	uint32		copyelem;
+
+	Assert((newsize & (newsize - 1)) == 0);
+
+	SH_COMPUTE_PARAMETERS(tb, newsize);
+	tb->data = MemoryContextAllocZero(tb->ctx,
+									  sizeof(SH_ELEMENT_TYPE) * tb->size);
+	newdata = tb->data;
+
+	/*
+	 * Find an element that is empty or in its optimal bucket; the elements
+	 * after it can then be copied in order.  There is always one, since the
+	 * table is never full.
+	 */
+	for (i = 0; i < oldsize; i++)
+	{
+		SH_ELEMENT_TYPE *oldentry = &olddata[i];
+
+		if (oldentry->status != SH_STATUS_IN_USE ||
+			(SH_ENTRY_HASH(tb, oldentry) & oldmask) == i)
+		{
+			startelem = i;
+			break;
+		}
+	}
+
+	copyelem = startelem;
+	for (i = 0; i < oldsize; i++)
+	{
+		SH_ELEMENT_TYPE *oldentry = &olddata[copyelem];
+
+		if (oldentry->status == SH_STATUS_IN_USE)
+		{
+			uint32		curelem;
+
+			curelem = SH_INITIAL_BUCKET(tb, SH_ENTRY_HASH(tb, oldentry));
+			while (newdata[curelem].status == SH_STATUS_IN_USE)
+				curelem = SH_NEXT(tb, curelem);
+
+			memcpy(&newdata[curelem], oldentry, sizeof(SH_ELEMENT_TYPE));
+		}
+
+		copyelem = (copyelem + 1) & oldmask;
+	}
+
+	pfree(olddata);
+}
+
+/*
+ * Find the element for key, creating it if there is none.  *found is set
+ * to whether it existed already.  In a new element only the key (and the
+ * hash, with SH_STORE_HASH) are set; the caller must fill in the rest.
+ */
+SH_SCOPE SH_ELEMENT_TYPE *
+SH_INSERT(SH_TYPE *tb, SH_KEY_TYPE key, bool *found)
+{
+	uint32		hash = SH_HASH_KEY(tb, key);
+	uint32		startelem;
+	uint32		curelem;
+	SH_ELEMENT_TYPE *data;
+	uint32		insertdist;
+
+restart:
+	insertdist = 0;
+
+	/* grow first, so the element we return stays where it is */
+	if (tb->members >= tb->grow_threshold)
+		SH_GROW(tb, tb->size * 2);
+
+	data = tb->data;
+	startelem = SH_INITIAL_BUCKET(tb, hash);
+	curelem = startelem;
+	for (;;)
+	{
+		SH_ELEMENT_TYPE *entry = &data[curelem];
+		uint32		curoptimal;
+		uint32		curdist;
+
+		/* an empty bucket: the key isn't there, so it goes here */
+		if (entry->status == SH_STATUS_EMPTY)
+		{
+			tb->members++;
+			entry->SH_KEY = key;
+#ifdef SH_STORE_HASH
+			SH_GET_HASH(tb, entry) = hash;
+#endif
+			entry->status = SH_STATUS_IN_USE;
+			*found = false;
+			return entry;
+		}
+
+		if (SH_COMPARE_KEYS(tb, hash, key, entry))
+		{
+			Assert(entry->status == SH_STATUS_IN_USE);
+			*found = true;
+			return entry;
+		}
+
+		curoptimal = SH_INITIAL_BUCKET(tb, SH_ENTRY_HASH(tb, entry));
+		curdist = SH_DISTANCE_FROM_OPTIMAL(tb, curoptimal, curelem);
+
+		/*
+		 * If this element is nearer its optimal bucket than the new key is to
+		 * its own, the key can't be further along (the Robin Hood ordering
+		 * would have put it here), so the new element takes this bucket, and
+		 * the rest of the run moves along by one.
+		 */
+		if (insertdist > curdist)
+		{
+			SH_ELEMENT_TYPE *lastentry;
+			uint32		emptyelem = curelem;
+			uint32		moveelem;
+			uint32		emptydist = 0;
+
+			/* find the empty bucket at the end of the run */
+			for (;;)
+			{
+				emptyelem = SH_NEXT(tb, emptyelem);
+				if (data[emptyelem].status == SH_STATUS_EMPTY)
+					break;
+
+				if (++emptydist > SH_GROW_MAX_MOVE && SH_CAN_GROW_EARLY(tb))
+				{
+					tb->grow_threshold = 0;
+					goto restart;
+				}
+			}
+
+			/* shift the run forward, starting from its end */
+			lastentry = &data[emptyelem];
+			moveelem = emptyelem;
+			while (moveelem != curelem)
+			{
+				SH_ELEMENT_TYPE *moveentry;
+
+				moveelem = SH_PREV(tb, moveelem);
+				moveentry = &data[moveelem];
+				memcpy(lastentry, moveentry, sizeof(SH_ELEMENT_TYPE));
+				lastentry = moveentry;
+			}
+
+			tb->members++;
+			entry->SH_KEY = key;
+#ifdef SH_STORE_HASH
+			SH_GET_HASH(tb, entry) = hash;
+#endif
+			entry->status = SH_STATUS_IN_USE;
+			*found = false;
+			return entry;
+		}
+
+		curelem = SH_NEXT(tb, curelem);
+		insertdist++;
+
+		if (insertdist > SH_GROW_MAX_DIB && SH_CAN_GROW_EARLY(tb))
+		{
+			tb->grow_threshold = 0;
+			goto restart;
+		}
+	}
+}
+
+/*
+ * Find the element for key, or return NULL if there is none.
+ */
+SH_SCOPE SH_ELEMENT_TYPE *
+SH_LOOKUP(SH_TYPE *tb, SH_KEY_TYPE key)
+{
+	uint32		hash = SH_HASH_KEY(tb, key);
+	uint32		curelem = SH_INITIAL_BUCKET(tb, hash);
+
+	for (;;)
+	{
+		SH_ELEMENT_TYPE *entry = &tb->data[curelem];
+
+		if (entry->status == SH_STATUS_EMPTY)
+			return NULL;
+
+		if (SH_COMPARE_KEYS(tb, hash, key, entry))
+			return entry;
+
+		curelem = SH_NEXT(tb, curelem);
+	}
+}
+
+/*
+ * Delete the element for key, returning whether there was one.
+ */
+SH_SCOPE bool
+SH_DELETE(SH_TYPE *tb, SH_KEY_TYPE key)
+{
+	uint32		hash = SH_HASH_KEY(tb, key);
+	uint32		curelem = SH_INITIAL_BUCKET(tb, hash);
+
+	for (;;)
+	{
+		SH_ELEMENT_TYPE *entry = &tb->data[curelem];
+
+		if (entry->status == SH_STATUS_EMPTY)
+			return false;
+
+		if (SH_COMPARE_KEYS(tb, hash, key, entry))
+		{
+			SH_ELEMENT_TYPE *lastentry = entry;
+
+			tb->members--;
+
+			/*
+			 * Move back the following elements of the run, up to one that is
+			 * in its optimal bucket already, so no lookup will stop short at
+			 * the hole.
+			 */
+			for (;;)
+			{
+				SH_ELEMENT_TYPE *curentry;
+				uint32		curoptimal;
+
+				curelem = SH_NEXT(tb, curelem);
+				curentry = &tb->data[curelem];
+
+				if (curentry->status != SH_STATUS_IN_USE)
+					break;
+
+				curoptimal = SH_INITIAL_BUCKET(tb, SH_ENTRY_HASH(tb, curentry));
+				if (curoptimal == curelem)
+					break;
+
+				memcpy(lastentry, curentry, sizeof(SH_ELEMENT_TYPE));
+				lastentry = curentry;
+			}
+			lastentry->status = SH_STATUS_EMPTY;
+
+			return true;
+		}
+
+		curelem = SH_NEXT(tb, curelem);
+	}
+}
+
+/*
+ * Begin a scan over all the elements of the table, in no particular order.
+ *
+ * The scan runs backwards through the array, starting from an empty
+ * bucket.  Deleting the element last returned shifts only elements from
+ * later buckets of its run back by one, and all of those have been
+ * returned already; starting at an empty bucket, which ends a run, makes
+ * that hold also for the run that wraps around the end of the array.
+ */
+SH_SCOPE void
+SH_START_ITERATE(SH_TYPE *tb, SH_ITERATOR *iter)
+{
+	uint32		i;
+	uint32		startelem = 0;
+
+	for (i = 0; i < tb->size; i++)
+	{
+		if (tb->data[i].status != SH_STATUS_IN_USE)
+		{
+			startelem = i;
+			break;
+		}
+	}
+
+	/* the fill factor leaves at least one bucket empty */
+	Assert(i < tb->size);
+
+	iter->cur = startelem;
+	iter->end = startelem;
+	iter->done = false;
+}
+
+/*
+ * Return the next element of the scan, or NULL when there are no more.
+ */
+SH_SCOPE SH_ELEMENT_TYPE *
+SH_ITERATE(SH_TYPE *tb, SH_ITERATOR *iter)
+{
+	while (!iter->done)
+	{
+		SH_ELEMENT_TYPE *elem = &tb->data[iter->cur];
+
+		iter->cur = (iter->cur - 1) & tb->sizemask;
+		if (iter->cur == iter->end)
+			iter->done = true;
+
+		if (elem->status == SH_STATUS_IN_USE)
+			return elem;
+	}
+
+	return NULL;
+}
+
+#undef SH_FILLFACTOR
+#undef SH_MAX_FILLFACTOR
+#undef SH_GROW_MAX_DIB
+#undef SH_GROW_MAX_MOVE
+#undef SH_GROW_MIN_FILLFACTOR
+#undef SH_CAN_GROW_EARLY
+#undef SH_COMPARE_KEYS
+
+#endif   /* SH_DEFINE */
+
+
+/* undefine external parameters, so next hash table can be defined */
+#undef SH_PREFIX
+#undef SH_KEY_TYPE
+#undef SH_KEY
+#undef SH_ELEMENT_TYPE
+#undef SH_HASH_KEY
+#undef SH_SCOPE
+#undef SH_DECLARE
+#undef SH_DEFINE
+#undef SH_GET_HASH
+#undef SH_STORE_HASH
+#undef SH_EQUAL
+
+/* undefine locally declared macros */
+#undef SH_MAKE_NAME
+#undef SH_MAKE_NAME_
+#undef SH_MAKE_NAME__
+
+/* types */
+#undef SH_TYPE
+#undef SH_STATUS
+#undef SH_STATUS_EMPTY
+#undef SH_STATUS_IN_USE
+#undef SH_ITERATOR
+
+/* external function names */
+#undef SH_CREATE
+#undef SH_DESTROY
+#undef SH_RESET
+#undef SH_INSERT
+#undef SH_DELETE
+#undef SH_LOOKUP
+#undef SH_GROW
+#undef SH_START_ITERATE
+#undef SH_ITERATE
+
+/* internal function names */
+#undef SH_COMPUTE_PARAMETERS
+#undef SH_NEXT
+#undef SH_PREV
+#undef SH_DISTANCE_FROM_OPTIMAL
+#undef SH_INITIAL_BUCKET
+#undef SH_ENTRY_HASH
@@ -0,0 +1,182 @@
+/*-------------------------------------------------------------------------
+ *
+ * sort_template.h
+ *	  A quicksort that is compiled for one element type and comparison
+ *	  function, so that the comparison can be inlined.
+ *
+ * qsort_arg() calls its comparator through a pointer for every comparison,
+ * which for cheap comparisons (of integers, say) costs more than the
+ * comparison itself.  Including this file after defining the macros below
+ * generates a sort function specialized for one comparison:
+ *
+ *	 ST_SORT - the name of the function to generate
+ *	 ST_ELEMENT_TYPE - the type of the array elements
+ *	 ST_COMPARE(a, b, arg) - an expression comparing the elements that a and
+ *		b point to, with the usual <0, 0, >0 result; arg is the caller's
+ *		passthrough argument
+ *	 ST_COMPARE_ARG_TYPE - the type that arg points to
+ *
+ * The generated function is declared
+ *
+ *	 static void ST_SORT(ST_ELEMENT_TYPE *a, size_t n, ST_COMPARE_ARG_TYPE *arg)
+ *
+ * The macros are undefined again at the end, so the file can be included
+ * several times in one module.
+ *
+ * The algorithm is the same as qsort_arg()'s (see src/port/qsort_arg.c),
+ * including its check for presorted input, but moves whole elements rather
+ * than bytes.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/lib/sort_template.h
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#define ST_MAKE_NAME(a,b) ST_MAKE_NAME_(a,b)
+#define ST_MAKE_NAME_(a,b) a##b
+
+#define ST_MED3 ST_MAKE_NAME(ST_SORT, _med3)
+#define ST_SWAP ST_MAKE_NAME(ST_SORT, _swap)
+#define ST_VECSWAP ST_MAKE_NAME(ST_SORT, _vecswap)
+
+#define DO_COMPARE(a, b) ST_COMPARE(a, b, arg)
+#define DO_SWAP(a, b) ST_SWAP(a, b)
+
+static inline void
+ST_SWAP(ST_ELEMENT_TYPE *a, ST_ELEMENT_TYPE *b)
+{
+	ST_ELEMENT_TYPE tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+static inline void
+ST_VECSWAP(ST_ELEMENT_TYPE *a, ST_ELEMENT_TYPE *b, size_t n)
+{
+	size_t		i;
+
+	for (i = 0; i < n; i++)
+		ST_SWAP(&a[i], &b[i]);
+}
+
+static inline ST_ELEMENT_TYPE *
+ST_MED3(ST_ELEMENT_TYPE *a, ST_ELEMENT_TYPE *b, ST_ELEMENT_TYPE *c,
+		ST_COMPARE_ARG_TYPE *arg)
+{
+	return DO_COMPARE(a, b) < 0 ?
+		(DO_COMPARE(b, c) < 0 ? b : (DO_COMPARE(a, c) < 0 ? c : a))
+		: (DO_COMPARE(b, c) > 0 ? b : (DO_COMPARE(a, c) < 0 ? a : c));
+}
+
+static void
+ST_SORT(ST_ELEMENT_TYPE *a, size_t n, ST_COMPARE_ARG_TYPE *arg)
+{
+	ST_ELEMENT_TYPE *pa,
+			   *pb,
+			   *pc,
+			   *pd,
+			   *pl,
+			   *pm,
+			   *pn;
+	size_t		d,
+				d1,
+				d2;
+	int			r,
+				presorted;
+
+loop:
+	if (n < 7)
+	{
+		for (pm = a + 1; pm < a + n; pm++)
+			for (pl = pm; pl > a && DO_COMPARE(pl - 1, pl) > 0; pl--)
+				DO_SWAP(pl, pl - 1);
+		return;
+	}
+	presorted = 1;
+	for (pm = a + 1; pm < a + n; pm++)
+	{
+		if (DO_COMPARE(pm - 1, pm) > 0)
+		{
+			presorted = 0;
+			break;
+		}
+	}
+	if (presorted)
+		return;
+	pm = a + (n / 2);
+	if (n > 7)
+	{
+		pl = a;
+		pn = a + (n - 1);
+		if (n > 40)
+		{
+			d = n / 8;
+			pl = ST_MED3(pl, pl + d, pl + 2 * d, arg);
+			pm = ST_MED3(pm - d, pm, pm + d, arg);
+			pn = ST_MED3(pn - 2 * d, pn - d, pn, arg);
+		}
+		pm = ST_MED3(pl, pm, pn, arg);
+	}
+	DO_SWAP(a, pm);
+	pa = pb = a + 1;
+	pc = pd = a + (n - 1);
+	for (;;)
+	{
+		while (pb <= pc && (r = DO_COMPARE(pb, a)) <= 0)
+		{
+			if (r == 0)
+			{
+				DO_SWAP(pa, pb);
+				pa++;
+			}
+			pb++;
+		}
+		while (pb <= pc && (r = DO_COMPARE(pc, a)) >= 0)
+		{
+			if (r == 0)
+			{
+				DO_SWAP(pc, pd);
+				pd--;
+			}
+			pc--;
+		}
+		if (pb > pc)
+			break;
+		DO_SWAP(pb, pc);
+		pb++;
+		pc--;
+	}
+	pn = a + n;
+	d1 = Min(pa - a, pb - pa);
+	ST_VECSWAP(a, pb - d1, d1);
+	d1 = Min(pd - pc, pn - pd - 1);
+	ST_VECSWAP(pb, pn - d1, d1);
+	d1 = pb - pa;
+	d2 = pd - pc;
+	if (d1 > 1)
+		ST_SORT(a, d1, arg);
+	if (d2 > 1)
+	{
+		/* Iterate rather than recurse to save stack space */
+		a = pn - d2;
+		n = d2;
+		goto loop;
+	}
+}
+
+#undef DO_COMPARE
+#undef DO_SWAP
+#undef ST_COMPARE
+#undef ST_COMPARE_ARG_TYPE
+#undef ST_ELEMENT_TYPE
+#undef ST_MAKE_NAME
+#undef ST_MAKE_NAME_
+#undef ST_MED3
+#undef ST_SORT
+#undef ST_SWAP
+#undef ST_VECSWAP
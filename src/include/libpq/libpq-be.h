@@ -129,6 +129,7 @@ typedef struct Port
 	char	   *user_name;
 	char	   *cmdline_options;
 	List	   *guc_options;
+	int			compression;	/* zlib level for the session, or 0 */
 
 	/*
 	 * Information that needs to be held during the authentication cycle.
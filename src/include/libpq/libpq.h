@@ -41,6 +41,10 @@ typedef struct
  * External functions.
  */
 
+/* GUC options */
+extern int	client_send_buffer_size;
+extern int	max_compression_level;
+
 /*
  * prototypes for functions in pqcomm.c
  */
@@ -53,15 +57,18 @@ extern void TouchSocketFile(void);
 extern void pq_init(void);
 extern void pq_comm_reset(void);
 extern int	pq_getbytes(char *s, size_t len);
+extern int	pq_discardbytes(size_t len);
 extern int	pq_getstring(StringInfo s);
 extern int	pq_getmessage(StringInfo s, int maxlen);
 extern int	pq_getbyte(void);
 extern int	pq_peekbyte(void);
 extern int	pq_getbyte_if_available(unsigned char *c);
+extern int	pq_peekbufferedinput(const char **s);
 extern int	pq_putbytes(const char *s, size_t len);
 extern int	pq_flush(void);
 extern int	pq_flush_if_writable(void);
 extern bool pq_is_send_pending(void);
+extern void pq_startcompression(int level);
 extern int	pq_putmessage(char msgtype, const char *s, size_t len);
 extern void pq_putmessage_noblock(char msgtype, const char *s, size_t len);
 extern void pq_startcopyout(void);
@@ -31,8 +31,10 @@
  *		entries for a particular index.  Used for both index_build and
  *		retail creation of index entries.
  *
- *		NumIndexAttrs		number of columns in this index
- *		KeyAttrNumbers		underlying-rel attribute numbers used as keys
+ *		NumIndexAttrs		total number of columns in this index
+ *		NumIndexKeyAttrs	number of key columns in index; the rest, if
+ *							any, are non-key columns added with INCLUDE
+ *		KeyAttrNumbers		underlying-rel attribute numbers of all columns
  *							(zeroes indicate expressions)
  *		Expressions			expr trees for expression entries, or NIL if none
  *		ExpressionsState	exec state for expressions, or NIL if none
@@ -54,6 +56,7 @@ typedef struct IndexInfo
 {
 	NodeTag		type;
 	int			ii_NumIndexAttrs;
+	int			ii_NumIndexKeyAttrs;
 	AttrNumber	ii_KeyAttrNumbers[INDEX_MAX_KEYS];
 	List	   *ii_Expressions; /* list of Expr */
 	List	   *ii_ExpressionsState;	/* list of ExprState */
@@ -466,23 +469,39 @@ typedef struct ExecAuxRowMark
 typedef struct TupleHashEntryData *TupleHashEntry;
 typedef struct TupleHashTableData *TupleHashTable;
 
+/*
+ * A hash table entry.  The entries live in the open-addressing table of
+ * lib/simplehash.h, which moves them around as it grows and as entries are
+ * removed, so a caller must not keep a pointer to an entry across other
+ * insertions or removals.  Per-group data of the caller's is kept in the
+ * separately allocated "additional" space, which doesn't move.
+ */
 typedef struct TupleHashEntryData
 {
-	/* firstTuple must be the first field in this struct! */
 	MinimalTuple firstTuple;	/* copy of first tuple in this group */
-	/* there may be additional data beyond the end of this struct */
-} TupleHashEntryData;			/* VARIABLE LENGTH STRUCT */
+	void	   *additional;		/* caller's per-entry data, if any */
+	uint32		status;			/* hash status, managed by simplehash.h */
+	uint32		hash;			/* hash value of the group's key */
+} TupleHashEntryData;
+
+/* define parameters necessary to generate the tuple hash table interface */
+#define SH_PREFIX tuplehash
+#define SH_ELEMENT_TYPE TupleHashEntryData
+#define SH_KEY_TYPE MinimalTuple
+#define SH_SCOPE extern
+#define SH_DECLARE
+#include "lib/simplehash.h"
 
 typedef struct TupleHashTableData
 {
-	HTAB	   *hashtab;		/* underlying dynahash table */
+	tuplehash_hash *hashtab;	/* underlying hash table */
 	int			numCols;		/* number of columns in lookup key */
 	AttrNumber *keyColIdx;		/* attr numbers of key columns */
 	FmgrInfo   *tab_hash_funcs; /* hash functions for table datatype(s) */
 	FmgrInfo   *tab_eq_funcs;	/* equality functions for table datatype(s) */
 	MemoryContext tablecxt;		/* memory context containing table */
 	MemoryContext tempcxt;		/* context for function evaluations */
-	Size		entrysize;		/* actual size to make each hash entry */
+	Size		additionalsize; /* size of each entry's additional data */
 	TupleTableSlot *tableslot;	/* slot for referencing table entries */
 	/* The following fields are set transiently for each table search: */
 	TupleTableSlot *inputslot;	/* current input tuple's slot */
@@ -490,24 +509,21 @@ typedef struct TupleHashTableData
 	FmgrInfo   *cur_eq_funcs;	/* equality functions for input vs. table */
 }	TupleHashTableData;
 
-typedef HASH_SEQ_STATUS TupleHashIterator;
+typedef tuplehash_iterator TupleHashIterator;
 
 /*
- * Use InitTupleHashIterator/TermTupleHashIterator for a read/write scan.
- * Use ResetTupleHashIterator if the table can be frozen (in this case no
- * explicit scan termination is needed).
+ * The table must not be changed while a scan is in progress.  There is no
+ * need to terminate a scan; TermTupleHashIterator and ResetTupleHashIterator
+ * remain for the callers' sake.
  */
 #define InitTupleHashIterator(htable, iter) \
-	hash_seq_init(iter, (htable)->hashtab)
+	tuplehash_start_iterate((htable)->hashtab, iter)
 #define TermTupleHashIterator(iter) \
-	hash_seq_term(iter)
+	((void) 0)
 #define ResetTupleHashIterator(htable, iter) \
-	do { \
-		hash_freeze((htable)->hashtab); \
-		hash_seq_init(iter, (htable)->hashtab); \
-	} while (0)
-#define ScanTupleHashTable(iter) \
-	((TupleHashEntry) hash_seq_search(iter))
+	InitTupleHashIterator(htable, iter)
+#define ScanTupleHashTable(htable, iter) \
+	tuplehash_iterate((htable)->hashtab, iter)
 
 
 /* ----------------------------------------------------------------
@@ -687,6 +703,10 @@ typedef struct ScalarArrayOpExprState
 	int16		typlen;
 	bool		typbyval;
 	char		typalign;
+	/* For a large constant array, a hash table of its elements is probed */
+	Oid			hash_funcid;	/* element hash function, or InvalidOid */
+	Oid			hash_eqfuncid;	/* equality function to probe with */
+	struct SAOPHashTable *hashtab;	/* built on first use */
 } ScalarArrayOpExprState;
 
 /* ----------------
@@ -1066,6 +1086,12 @@ typedef struct ModifyTableState
 	List	  **mt_arowmarks;	/* per-subplan ExecAuxRowMark lists */
 	EPQState	mt_epqstate;	/* for evaluating EvalPlanQual rechecks */
 	bool		fireBSTriggers; /* do we need to fire stmt triggers? */
+	HeapTuple  *mt_bufferedTuples;	/* INSERT rows awaiting multi-insert,
+									 * or NULL if not batching */
+	int			mt_nBufferedTuples;		/* number of rows buffered */
+	Size		mt_bufferedTuplesSize;	/* total size of buffered rows */
+	MemoryContext mt_batchcxt;	/* memory holding the buffered rows */
+	TupleTableSlot *mt_batchslot;	/* slot for indexing buffered rows */
 } ModifyTableState;
 
 /* ----------------
@@ -1073,6 +1099,11 @@ typedef struct ModifyTableState
  *
  *		nplans			how many plans are in the array
  *		whichplan		which plan is being executed (0 .. n-1)
+ *		nremoved		how many plans run-time pruning left out at startup
+ *		valid			which plans survived pruning on PARAM_EXEC values,
+ *						or NULL if all are to be run
+ *		async			which plans are foreign scans running asynchronously;
+ *						they are read, as their rows arrive, after the others
  * ----------------
  */
 typedef struct AppendState
@@ -1081,6 +1112,18 @@ typedef struct AppendState
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
+	int			as_nremoved;	/* number of subplans pruned at startup */
+	List	   *as_prune_exprs; /* ExprStates for run-time pruning, or NIL */
+	bool		as_prune_pending;	/* must redo run-time pruning? */
+	bool	   *as_valid;		/* subplans that survived it, or NULL */
+	bool	   *as_async;		/* subplans run asynchronously, or NULL if
+								 * none can be */
+	int		   *as_asyncplans;	/* indexes of those not finished yet */
+	int			as_nasyncplans;	/* number of them */
+	int			as_nextasync;	/* as_asyncplans entry to try first */
+	bool		as_async_started;	/* have we started them for this scan? */
+	bool		as_syncdone;	/* have the other subplans all finished? */
+	pgsocket   *as_asyncsocks;	/* workspace for waiting on them */
 } AppendState;
 
 /* ----------------
@@ -1094,6 +1137,7 @@ typedef struct AppendState
  *		heap_size		number of active heap entries
  *		initialized		true if we have fetched first tuple from each subplan
  *		last_slot		last subplan fetched from (which must be re-called)
+ *		nremoved, valid	as in AppendState
  * ----------------
  */
 typedef struct MergeAppendState
@@ -1108,6 +1152,10 @@ typedef struct MergeAppendState
 	int			ms_heap_size;	/* current active length of ms_heap[] */
 	bool		ms_initialized; /* are subplans started? */
 	int			ms_last_slot;	/* last subplan slot we returned from */
+	int			ms_nremoved;	/* number of subplans pruned at startup */
+	List	   *ms_prune_exprs; /* ExprStates for run-time pruning, or NIL */
+	bool		ms_prune_pending;	/* must redo run-time pruning? */
+	bool	   *ms_valid;		/* subplans that survived it, or NULL */
 } MergeAppendState;
 
 /* ----------------
@@ -1185,11 +1233,21 @@ typedef struct ScanState
 	TupleTableSlot *ss_ScanTupleSlot;
 } ScanState;
 
-/*
- * SeqScan uses a bare ScanState as its state node, since it needs
- * no additional fields.
+/* ----------------
+ *	 SeqScanState information
+ *
+ *		SeqScan reads the relation through its table access method, so it
+ *		leaves ss_currentScanDesc NULL and keeps its own scan descriptor.
+ *
+ *		tablescan		   scan descriptor of the table access method
+ * ----------------
  */
-typedef ScanState SeqScanState;
+typedef struct SeqScanState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	/* use "struct" here to avoid needing to include tableam.h: */
+	struct TableScanDescData *tablescan;
+} SeqScanState;
 
 /*
  * These structs store information about index quals that don't have simple
@@ -1353,7 +1411,6 @@ typedef struct TidScanState
 	int			tss_TidPtr;
 	int			tss_MarkTidPtr;
 	ItemPointerData *tss_TidList;
-	HeapTupleData tss_htup;
 } TidScanState;
 
 /* ----------------
@@ -1484,6 +1541,8 @@ typedef struct JoinState
 {
 	PlanState	ps;
 	JoinType	jointype;
+	bool		single_match;	/* True if we should skip to next outer tuple
+								 * after finding one inner match */
 	List	   *joinqual;		/* JOIN quals (in addition to ps.qual) */
 } JoinState;
 
@@ -1614,14 +1673,26 @@ typedef struct HashJoinState
  *		of a subplan into a temporary file.
  *
  *		ss.ss_ScanTupleSlot refers to output of underlying plan.
+ *
+ *		A Material that caches results per nestloop parameter values
+ *		keeps its cache in private state (see nodeMaterial.c) and doesn't
+ *		use the tuplestore; the counters are for EXPLAIN ANALYZE.
  * ----------------
  */
+typedef struct MaterialCacheData *MaterialCache;
+
 typedef struct MaterialState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	int			eflags;			/* capability flags to pass to tuplestore */
 	bool		eof_underlying; /* reached end of underlying plan? */
 	Tuplestorestate *tuplestorestate;
+	MaterialCache cache;		/* NULL if not caching */
+	long		cache_hits;		/* scans answered from the cache */
+	long		cache_misses;	/* scans that had to run the subplan */
+	long		cache_evictions;	/* entries dropped to make room */
+	long		cache_overflows;	/* scans too big to cache at all */
+	Size		cache_peakmem;	/* peak memory used by the cache */
 } MaterialState;
 
 /* ----------------
@@ -1638,6 +1709,13 @@ typedef struct SortState
 	bool		bounded_Done;	/* value of bounded we did the sort with */
 	int64		bound_Done;		/* value of bound we did the sort with */
 	void	   *tuplesortstate; /* private state of tuplesort.c */
+	/* these fields are used only for an incremental sort: */
+	bool		incremental;	/* sorting one presorted group at a time? */
+	bool		outerDone;		/* outer plan exhausted? */
+	int64		incr_returned;	/* tuples returned so far, for the bound */
+	FmgrInfo   *presortedEq;	/* equality fns for the presorted columns */
+	TupleTableSlot *groupPivot; /* first tuple of the next group */
+	MemoryContext groupCxt;		/* short-term context for comparisons */
 } SortState;
 
 /* ---------------------
@@ -1687,6 +1765,14 @@ typedef struct AggState
 	List	   *hash_needed;	/* list of columns needed in hash table */
 	bool		table_filled;	/* hash table filled yet? */
 	TupleHashIterator hashiter; /* for iterating through hash table */
+	long		hash_max_groups;	/* max groups to keep in hash table */
+	long		hash_ngroups;	/* number of groups now in hash table */
+	bool		hash_spilled;	/* any input spilled during this scan? */
+	int			hash_depth;		/* spill depth of the current input */
+	Tuplestorestate *hash_input;	/* spilled input being read, or NULL */
+	Tuplestorestate **hash_spill;	/* spill partitions being written */
+	List	   *hash_batches;	/* spilled batches not yet processed */
+	TupleTableSlot *hash_spillslot; /* slot for reading spilled tuples */
 } AggState;
 
 /* ----------------
@@ -1719,6 +1805,8 @@ typedef struct WindowAggState
 	/* use struct pointer to avoid including windowapi.h here */
 	struct WindowObjectData *agg_winobj;		/* winobj for aggregate
 												 * fetches */
+	struct WindowObjectData *agg_base_winobj;	/* winobj for rows leaving
+												 * the frame, or NULL */
 	int64		aggregatedbase; /* start row for current aggregates */
 	int64		aggregatedupto; /* rows before this one are aggregated */
 
@@ -37,6 +37,8 @@ typedef struct PlannedStmt
 
 	CmdType		commandType;	/* select|insert|update|delete */
 
+	uint32		queryId;		/* query identifier (copied from Query) */
+
 	bool		hasReturning;	/* is it insert|update|delete RETURNING? */
 
 	bool		hasModifyingCTE;	/* has insert|update|delete in WITH? */
@@ -175,6 +177,7 @@ typedef struct ModifyTable
 	List	   *returningLists; /* per-target-table RETURNING tlists */
 	List	   *rowMarks;		/* PlanRowMarks (non-locking only) */
 	int			epqParam;		/* ID of Param for EvalPlanQual re-eval */
+	bool		batchInserts;	/* INSERT may buffer rows for multi-insert */
 } ModifyTable;
 
 /* ----------------
@@ -186,6 +189,8 @@ typedef struct Append
 {
 	Plan		plan;
 	List	   *appendplans;
+	struct PartitionPruneInfo *part_prune_info; /* for run-time pruning, or
+												 * NULL */
 } Append;
 
 /* ----------------
@@ -197,6 +202,8 @@ typedef struct MergeAppend
 {
 	Plan		plan;
 	List	   *mergeplans;
+	struct PartitionPruneInfo *part_prune_info; /* for run-time pruning, or
+												 * NULL */
 	/* remaining fields are just like the sort-key info in struct Sort */
 	int			numCols;		/* number of sort-key columns */
 	AttrNumber *sortColIdx;		/* their indexes in the target list */
@@ -462,11 +469,20 @@ typedef struct WorkTableScan
 
 /* ----------------
  *		ForeignScan node
+ *
+ * A ForeignScan normally scans a single foreign table.  With scanrelid 0,
+ * it instead returns a join of foreign tables, or the grouped result of one,
+ * computed by the remote server; fs_relids gives the base relations
+ * involved.  The scan tuples are then described by fdw_scan_tlist, and Vars
+ * in the node's targetlist and qual refer to them with varno INDEX_VAR.
  * ----------------
  */
 typedef struct ForeignScan
 {
 	Scan		scan;
+	Oid			fs_server;		/* OID of foreign server */
+	List	   *fdw_scan_tlist; /* scan tuple description, if scanrelid 0 */
+	Bitmapset  *fs_relids;		/* RTIs of the base relations scanned */
 	bool		fsSystemCol;	/* true if any "system column" is needed */
 	/* use struct pointer to avoid including fdwapi.h here */
 	struct FdwPlan *fdwplan;
@@ -499,6 +515,8 @@ typedef struct Join
 {
 	Plan		plan;
 	JoinType	jointype;
+	bool		inner_unique;	/* each outer tuple can match at most one
+								 * inner tuple */
 	List	   *joinqual;		/* JOIN quals (in addition to plan.qual) */
 } Join;
 
@@ -560,11 +578,25 @@ typedef struct HashJoin
 
 /* ----------------
  *		materialization node
+ *
+ * As the inner side of a parameterized nestloop, a Material node can keep
+ * the results of its subplan for each distinct set of values of the
+ * nestloop's parameters, and replay them instead of rescanning the subplan
+ * when the same values come round again.  cacheKeys are then the PARAM_EXEC
+ * Params concerned, and cacheEqOperators the hashable equality operators
+ * to compare them with.  numCacheEntries is the planner's estimate of the
+ * number of distinct keys; the planner sets it before the keys themselves
+ * are known, and if none turn out to be usable numCacheKeys stays zero and
+ * the node is just a plain Material.
  * ----------------
  */
 typedef struct Material
 {
 	Plan		plan;
+	int			numCacheKeys;	/* 0 if not caching */
+	List	   *cacheKeys;		/* list of Params keying the cache */
+	Oid		   *cacheEqOperators;	/* equality operators, per key */
+	long		numCacheEntries;	/* estimated number of distinct keys */
 } Material;
 
 /* ----------------
@@ -579,6 +611,8 @@ typedef struct Sort
 	Oid		   *sortOperators;	/* OIDs of operators to sort them by */
 	Oid		   *collations;		/* OIDs of collations */
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
+	int			numPresortedCols;	/* leading columns the input is already
+									 * sorted by; 0 for a full sort */
 } Sort;
 
 /* ---------------
@@ -824,4 +858,29 @@ typedef struct PlanInvalItem
 	uint32		hashValue;		/* hash value of object's cache lookup key */
 } PlanInvalItem;
 
+
+/*
+ * Run-time partition pruning info for an Append or MergeAppend
+ *
+ * When the subplans of an Append scan the children of an inheritance parent
+ * that has a partition descriptor (see catalog/partition.h), and the quals
+ * compare the partition key to expressions whose values are known only at
+ * execution time, the executor can skip the children whose ranges those
+ * values rule out.  Each of 'exprs' is the non-key side of one such qual,
+ * and the corresponding member of 'strategies' is the btree strategy of its
+ * operator, commuted if need be so that the key is on the left.  If any of
+ * the expressions use PARAM_EXEC Params, pruning is redone whenever those
+ * change; otherwise it's done just once, at executor startup, and the
+ * pruned subplans aren't even initialized.
+ */
+typedef struct PartitionPruneInfo
+{
+	NodeTag		type;
+	Oid			relid;			/* OID of the inheritance parent */
+	List	   *subplan_oids;	/* OID of the rel each subplan scans */
+	List	   *exprs;			/* values the key is compared to */
+	List	   *strategies;		/* integer list of btree strategies */
+	Bitmapset  *execparams;		/* PARAM_EXEC Params used in exprs */
+} PartitionPruneInfo;
+
 #endif   /* PLANNODES_H */
@@ -80,7 +80,12 @@ typedef struct RangeVar
 } RangeVar;
 
 /*
- * IntoClause - target information for SELECT INTO and CREATE TABLE AS
+ * IntoClause - target information for SELECT INTO, CREATE TABLE AS and
+ * CREATE MATERIALIZED VIEW
+ *
+ * For a materialized view, parse analysis fills in viewQuery with a copy of
+ * the analyzed (but not rewritten) SELECT, which is stored as the view's
+ * ON SELECT rule so that REFRESH can run it again.
  */
 typedef struct IntoClause
 {
@@ -92,6 +97,8 @@ typedef struct IntoClause
 	OnCommitAction onCommit;	/* what do we do at COMMIT? */
 	char	   *tableSpaceName; /* table space to use, or NULL */
 	bool		skipData;		/* true for WITH NO DATA */
+	char		relkind;		/* RELKIND_RELATION or RELKIND_MATVIEW */
+	Node	   *viewQuery;		/* materialized view's SELECT query */
 } IntoClause;
 
 
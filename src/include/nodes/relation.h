@@ -194,6 +194,8 @@ typedef struct PlannerInfo
 
 	List	   *placeholder_list;		/* list of PlaceHolderInfos */
 
+	List	   *scanjoin_tlist; /* tlist passed to query_planner() */
+
 	List	   *query_pathkeys; /* desired pathkeys for query_planner(), and
 								 * actual pathkeys afterwards */
 
@@ -317,6 +319,8 @@ typedef struct PlannerInfo
  *					  zero means not computed yet
  *		indexlist - list of IndexOptInfo nodes for relation's indexes
  *					(always NIL if it's not a table)
+ *		extstats - list of ExtStatistics for the table's column groups
+ *				   (see pg_statistic_ext; always NIL if it's not a table)
  *		pages - number of disk pages in relation (zero if not a table)
  *		tuples - number of tuples in relation (not considering restrictions)
  *		allvisfrac - fraction of disk pages that are marked all-visible
@@ -330,6 +334,13 @@ typedef struct PlannerInfo
  *		For otherrels that are appendrel members, these fields are filled
  *		in just as for a baserel.
  *
+ * If the relation is a foreign table, or a join of foreign tables that all
+ * belong to the same foreign server, these fields are set too:
+ *		serverid - OID of the foreign server
+ *		fdwroutine - function pointers of the server's foreign-data wrapper
+ *		fdw_private - for the wrapper's use (it's NULL to start with)
+ * For other relations, serverid is InvalidOid and fdwroutine is NULL.
+ *
  * The presence of the remaining fields depends on the restrictions
  * and joins that the relation participates in:
  *
@@ -403,12 +414,19 @@ typedef struct RelOptInfo
 	Relids	   *attr_needed;	/* array indexed [min_attr .. max_attr] */
 	int32	   *attr_widths;	/* array indexed [min_attr .. max_attr] */
 	List	   *indexlist;		/* list of IndexOptInfo */
+	List	   *extstats;		/* list of ExtStatistics */
 	BlockNumber pages;			/* size estimates derived from pg_class */
 	double		tuples;
 	double		allvisfrac;
 	struct Plan *subplan;		/* if subquery */
 	PlannerInfo *subroot;		/* if subquery */
 
+	/* set for foreign tables, and joins of foreign tables of one server: */
+	Oid			serverid;		/* foreign server */
+	/* use struct pointer to avoid including fdwapi.h here */
+	struct FdwRoutine *fdwroutine;	/* callbacks of the server's FDW */
+	void	   *fdw_private;	/* private state of the FDW */
+
 	/* used by various scans and joins: */
 	List	   *baserestrictinfo;		/* RestrictInfo structures (if base
 										 * rel) */
@@ -435,11 +453,14 @@ typedef struct RelOptInfo
  *		Per-index information for planning/optimization
  *
  *		indexkeys[], indexcollations[], opfamily[], and opcintype[]
- *		each have ncolumns entries.
+ *		each have ncolumns entries.  Only the first nkeycolumns of them are
+ *		key columns, which can be matched to quals and sort orders; the rest
+ *		are INCLUDE columns, only useful for index-only scans, and have zero
+ *		collation, opfamily and opcintype.
  *
- *		sortopfamily[], reverse_sort[], and nulls_first[] likewise have
- *		ncolumns entries, if the index is ordered; but if it is unordered,
- *		those pointers are NULL.
+ *		sortopfamily[], reverse_sort[], and nulls_first[] have nkeycolumns
+ *		entries, if the index is ordered; but if it is unordered, those
+ *		pointers are NULL.
  *
  *		Zeroes in the indexkeys[] array indicate index columns that are
  *		expressions; there is one element in indexprs for each such column.
@@ -470,6 +491,7 @@ typedef struct IndexOptInfo
 
 	/* index descriptor information */
 	int			ncolumns;		/* number of columns in index */
+	int			nkeycolumns;	/* number of key columns in index */
 	int		   *indexkeys;		/* column numbers of index's keys, or 0 */
 	Oid		   *indexcollations;	/* OIDs of collations of index columns */
 	Oid		   *opfamily;		/* OIDs of operator families for columns */
@@ -795,13 +817,16 @@ typedef struct TidPath
 } TidPath;
 
 /*
- * ForeignPath represents a scan of a foreign table
+ * ForeignPath represents a scan of a foreign table, or of a join of foreign
+ * tables performed by the remote server.  In the latter case,
+ * joinrestrictinfo holds the RestrictInfos of the join clauses.
  */
 typedef struct ForeignPath
 {
 	Path		path;
 	/* use struct pointer to avoid including fdwapi.h here */
 	struct FdwPlan *fdwplan;
+	List	   *joinrestrictinfo;		/* RestrictInfos to apply to join */
 } ForeignPath;
 
 /*
@@ -851,11 +876,21 @@ typedef struct ResultPath
  * the output of its subpath.  This is used when the subpath is expensive
  * and needs to be scanned repeatedly, or when we need mark/restore ability
  * and the subpath doesn't have it.
+ *
+ * If cache_keys isn't NIL, the subpath is a nestloop inner indexscan, and
+ * the Material keeps the results of its scans for each distinct set of
+ * values of cache_keys (the outer-relation expressions the index scan uses),
+ * so that outer rows with the same values needn't repeat the scan.
+ * cache_calls and cache_ndistinct are the estimated number of scans and of
+ * distinct key values among them.
  */
 typedef struct MaterialPath
 {
 	Path		path;
 	Path	   *subpath;
+	List	   *cache_keys;
+	double		cache_calls;
+	double		cache_ndistinct;
 } MaterialPath;
 
 /*
@@ -898,6 +933,9 @@ typedef struct JoinPath
 
 	JoinType	jointype;
 
+	bool		inner_unique;	/* each outer tuple provably matches no more
+								 * than one inner tuple */
+
 	Path	   *outerjoinpath;	/* path for the outer side of the join */
 	Path	   *innerjoinpath;	/* path for the inner side of the join */
 
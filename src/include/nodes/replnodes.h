@@ -29,12 +29,25 @@ typedef struct IdentifySystemCmd
 
 
 /* ----------------------
- *		BASE_BACKUP command
+ *		BASE_BACKUP, START_BACKUP, SEND_FILES and STOP_BACKUP commands
+ *
+ * BASE_BACKUP does a whole backup in one go.  The other three split it up,
+ * so that the files can be fetched over several connections in parallel
+ * while one connection holds the backup open.
  * ----------------------
  */
+typedef enum BaseBackupKind
+{
+	BASE_BACKUP_FULL,			/* BASE_BACKUP */
+	BASE_BACKUP_START,			/* START_BACKUP */
+	BASE_BACKUP_SEND_FILES,		/* SEND_FILES */
+	BASE_BACKUP_STOP			/* STOP_BACKUP */
+} BaseBackupKind;
+
 typedef struct BaseBackupCmd
 {
 	NodeTag		type;
+	BaseBackupKind kind;
 	List	   *options;
 } BaseBackupCmd;
 
@@ -47,6 +60,7 @@ typedef struct StartReplicationCmd
 {
 	NodeTag		type;
 	XLogRecPtr	startpoint;
+	bool		compress;		/* send pglz-compressed WAL data messages */
 } StartReplicationCmd;
 
 #endif   /* REPLNODES_H */
@@ -14,6 +14,7 @@
 #ifndef CLAUSES_H
 #define CLAUSES_H
 
+#include "access/htup.h"
 #include "nodes/relation.h"
 
 
@@ -27,6 +28,20 @@ typedef struct
 	List	  **windowFuncs;	/* lists of WindowFuncs for each winref */
 } WindowFuncLists;
 
+/*
+ * Hook for procedural languages to offer bodies of their functions for
+ * inlining.  It is given the function's pg_proc tuple and a FuncExpr for
+ * the call, and may return the function body in the form a SQL-language
+ * function body would be parsed into: a single analyzed Query in which
+ * references to the function's arguments are PARAM_EXTERN Params numbered
+ * by argument position.  The usual checks for inlinability are then applied
+ * to the Query.  Return NULL if the function is not one the hook knows
+ * about, or cannot be expressed that way.
+ */
+typedef Query *(*inline_function_body_hook_type) (HeapTuple func_tuple,
+															FuncExpr *fexpr);
+extern PGDLLIMPORT inline_function_body_hook_type inline_function_body_hook;
+
 
 extern Expr *make_opclause(Oid opno, Oid opresulttype, bool opretset,
 			  Expr *leftop, Expr *rightop,
@@ -60,6 +75,8 @@ extern bool contain_subplans(Node *clause);
 
 extern bool contain_mutable_functions(Node *clause);
 extern bool contain_volatile_functions(Node *clause);
+extern bool contain_volatile_functions_in_query(Query *query,
+									bool ignore_nextval);
 extern bool contain_nonstrict_functions(Node *clause);
 extern Relids find_nonnullable_rels(Node *clause);
 extern List *find_nonnullable_vars(Node *clause);
@@ -40,6 +40,9 @@ extern Plan *optimize_minmax_aggregates(PlannerInfo *root, List *tlist,
  * prototypes for plan/createplan.c
  */
 extern Plan *create_plan(PlannerInfo *root, Path *best_path);
+extern ForeignScan *create_foreigngrouping_plan(PlannerInfo *root,
+							RelOptInfo *rel, List *tlist,
+							struct FdwPlan *fdwplan, double num_groups);
 extern SubqueryScan *make_subqueryscan(List *qptlist, List *qpqual,
 				  Index scanrelid, Plan *subplan);
 extern Append *make_append(List *appendplans, List *tlist);
@@ -48,6 +51,9 @@ extern RecursiveUnion *make_recursive_union(List *tlist,
 					 List *distinctList, long numGroups);
 extern Sort *make_sort_from_pathkeys(PlannerInfo *root, Plan *lefttree,
 						List *pathkeys, double limit_tuples);
+extern Sort *make_incremental_sort_from_pathkeys(PlannerInfo *root,
+									Plan *lefttree, List *pathkeys,
+									int presorted_keys, double limit_tuples);
 extern Sort *make_sort_from_sortclauses(PlannerInfo *root, List *sortcls,
 						   Plan *lefttree);
 extern Sort *make_sort_from_groupcols(PlannerInfo *root, List *groupcls,
@@ -79,7 +85,7 @@ extern Result *make_result(PlannerInfo *root, List *tlist,
 			Node *resconstantqual, Plan *subplan);
 extern ModifyTable *make_modifytable(CmdType operation, bool canSetTag,
 				 List *resultRelations, List *subplans, List *returningLists,
-				 List *rowMarks, int epqParam);
+				 List *rowMarks, int epqParam, bool batchInserts);
 extern bool is_projection_capable_plan(Plan *plan);
 
 /*
@@ -113,6 +119,9 @@ extern RestrictInfo *build_implied_join_equality(Oid opno,
  * prototypes for plan/analyzejoins.c
  */
 extern List *remove_useless_joins(PlannerInfo *root, List *joinlist);
+extern bool innerrel_is_unique(PlannerInfo *root, RelOptInfo *outerrel,
+				   RelOptInfo *innerrel, JoinType jointype,
+				   List *restrictlist);
 
 /*
  * prototypes for plan/setrefs.c
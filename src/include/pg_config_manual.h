@@ -103,6 +103,14 @@
  */
 #define ALIGNOF_BUFFER	32
 
+/*
+ * Alignment required of buffers, file offsets and transfer sizes for
+ * direct I/O (see the direct_io GUC).  The real requirement depends on the
+ * OS, filesystem and device, but the memory page size is enough for all
+ * common ones.
+ */
+#define PG_IO_ALIGN_SIZE	4096
+
 /*
  * Disable UNIX sockets for certain operating systems.
  */
@@ -199,6 +207,16 @@
 #define USE_PPC_LWSYNC
 #endif
 
+/*
+ * Define this to let sorts of text in the database's default collation
+ * abbreviate the strings to the leading bytes of their strxfrm() images.
+ * That is only correct if strxfrm() images compare as strcoll() does the
+ * strings, which POSIX requires but some C libraries, glibc among them, fail
+ * to deliver for some locales; the sort order, and indexes built from it,
+ * would then be wrong.  Sorts in the C collation abbreviate regardless.
+ */
+/* #define TRUST_STRXFRM */
+
 /*
  *------------------------------------------------------------------------
  * The following symbols are for enabling debugging code, not for
@@ -1,7 +1,7 @@
 /* ----------
  *	pgstat.h
  *
- *	Definitions for the PostgreSQL statistics collector daemon.
+ *	Definitions for the PostgreSQL statistics subsystem.
  *
  *	Copyright (c) 2001-2012, PostgreSQL Global Development Group
  *
@@ -15,6 +15,7 @@
 #include "fmgr.h"
 #include "libpq/pqcomm.h"
 #include "portability/instr_time.h"
+#include "storage/proc.h"
 #include "utils/hsearch.h"
 #include "utils/relcache.h"
 
@@ -28,13 +29,12 @@ typedef enum TrackFunctionsLevel
 }	TrackFunctionsLevel;
 
 /* ----------
- * The types of backend -> collector messages
+ * The types of statistics messages.  A message is a batch of counter updates
+ * that is applied to the shared statistics store in one go.
  * ----------
  */
 typedef enum StatMsgType
 {
-	PGSTAT_MTYPE_DUMMY,
-	PGSTAT_MTYPE_INQUIRY,
 	PGSTAT_MTYPE_TABSTAT,
 	PGSTAT_MTYPE_TABPURGE,
 	PGSTAT_MTYPE_DROPDB,
@@ -47,7 +47,8 @@ typedef enum StatMsgType
 	PGSTAT_MTYPE_BGWRITER,
 	PGSTAT_MTYPE_FUNCSTAT,
 	PGSTAT_MTYPE_FUNCPURGE,
-	PGSTAT_MTYPE_RECOVERYCONFLICT
+	PGSTAT_MTYPE_RECOVERYCONFLICT,
+	PGSTAT_MTYPE_TEMPFILE
 } StatMsgType;
 
 /* ----------
@@ -174,37 +175,14 @@ typedef struct PgStat_MsgHdr
 } PgStat_MsgHdr;
 
 /* ----------
- * Space available in a message.  This will keep the UDP packets below 1K,
- * which should fit unfragmented into the MTU of the lo interface on most
- * platforms. Does anybody care for platforms where it doesn't?
+ * Space available in a message.  Messages are built on the stack, and the
+ * entries of one message are applied to the shared hashtables in a single
+ * pass, so keep them modestly sized.
  * ----------
  */
 #define PGSTAT_MSG_PAYLOAD	(1000 - sizeof(PgStat_MsgHdr))
 
 
-/* ----------
- * PgStat_MsgDummy				A dummy message, ignored by the collector
- * ----------
- */
-typedef struct PgStat_MsgDummy
-{
-	PgStat_MsgHdr m_hdr;
-} PgStat_MsgDummy;
-
-
-/* ----------
- * PgStat_MsgInquiry			Sent by a backend to ask the collector
- *								to write the stats file.
- * ----------
- */
-
-typedef struct PgStat_MsgInquiry
-{
-	PgStat_MsgHdr m_hdr;
-	TimestampTz inquiry_time;	/* minimum acceptable file timestamp */
-} PgStat_MsgInquiry;
-
-
 /* ----------
  * PgStat_TableEntry			Per-table info in a MsgTabstat
  * ----------
@@ -221,7 +199,7 @@ typedef struct PgStat_TableEntry
  * ----------
  */
 #define PGSTAT_NUM_TABENTRIES  \
-	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - 3 * sizeof(int))  \
+	((PGSTAT_MSG_PAYLOAD - sizeof(Oid) - 5 * sizeof(int) - 2 * sizeof(PgStat_Counter))	\
 	 / sizeof(PgStat_TableEntry))
 
 typedef struct PgStat_MsgTabstat
@@ -231,12 +209,16 @@ typedef struct PgStat_MsgTabstat
 	int			m_nentries;
 	int			m_xact_commit;
 	int			m_xact_rollback;
+	PgStat_Counter m_block_read_time;	/* times in microseconds */
+	PgStat_Counter m_block_write_time;
+	int			m_ssl_handshakes;
+	int			m_ssl_resumptions;
 	PgStat_TableEntry m_entry[PGSTAT_NUM_TABENTRIES];
 } PgStat_MsgTabstat;
 
 
 /* ----------
- * PgStat_MsgTabpurge			Sent by the backend to tell the collector
+ * PgStat_MsgTabpurge			Sent by the backend to tell the stats store
  *								about dead tables.
  * ----------
  */
@@ -254,7 +236,7 @@ typedef struct PgStat_MsgTabpurge
 
 
 /* ----------
- * PgStat_MsgDropdb				Sent by the backend to tell the collector
+ * PgStat_MsgDropdb				Sent by the backend to tell the stats store
  *								about a dropped database
  * ----------
  */
@@ -266,7 +248,7 @@ typedef struct PgStat_MsgDropdb
 
 
 /* ----------
- * PgStat_MsgResetcounter		Sent by the backend to tell the collector
+ * PgStat_MsgResetcounter		Sent by the backend to tell the stats store
  *								to reset counters
  * ----------
  */
@@ -277,7 +259,7 @@ typedef struct PgStat_MsgResetcounter
 } PgStat_MsgResetcounter;
 
 /* ----------
- * PgStat_MsgResetsharedcounter Sent by the backend to tell the collector
+ * PgStat_MsgResetsharedcounter Sent by the backend to tell the stats store
  *								to reset a shared counter
  * ----------
  */
@@ -288,7 +270,7 @@ typedef struct PgStat_MsgResetsharedcounter
 } PgStat_MsgResetsharedcounter;
 
 /* ----------
- * PgStat_MsgResetsinglecounter Sent by the backend to tell the collector
+ * PgStat_MsgResetsinglecounter Sent by the backend to tell the stats store
  *								to reset a single counter
  * ----------
  */
@@ -376,6 +358,18 @@ typedef struct PgStat_MsgRecoveryConflict
 	int			m_reason;
 } PgStat_MsgRecoveryConflict;
 
+/* ----------
+ * PgStat_MsgTempFile	Sent by the backend upon creating a temp file
+ * ----------
+ */
+typedef struct PgStat_MsgTempFile
+{
+	PgStat_MsgHdr m_hdr;
+
+	Oid			m_databaseid;
+	size_t		m_filesize;
+} PgStat_MsgTempFile;
+
 /* ----------
  * PgStat_FunctionCounts	The actual per-function counts kept by a backend
  *
@@ -383,7 +377,7 @@ typedef struct PgStat_MsgRecoveryConflict
  * it against zeroes to detect whether there are any counts to transmit.
  *
  * Note that the time counters are in instr_time format here.  We convert to
- * microseconds in PgStat_Counter format when transmitting to the collector.
+ * microseconds in PgStat_Counter format when flushing to shared memory.
  * ----------
  */
 typedef struct PgStat_FunctionCounts
@@ -433,7 +427,7 @@ typedef struct PgStat_MsgFuncstat
 } PgStat_MsgFuncstat;
 
 /* ----------
- * PgStat_MsgFuncpurge			Sent by the backend to tell the collector
+ * PgStat_MsgFuncpurge			Sent by the backend to tell the stats store
  *								about dead functions.
  * ----------
  */
@@ -457,8 +451,6 @@ typedef struct PgStat_MsgFuncpurge
 typedef union PgStat_Msg
 {
 	PgStat_MsgHdr msg_hdr;
-	PgStat_MsgDummy msg_dummy;
-	PgStat_MsgInquiry msg_inquiry;
 	PgStat_MsgTabstat msg_tabstat;
 	PgStat_MsgTabpurge msg_tabpurge;
 	PgStat_MsgDropdb msg_dropdb;
@@ -472,21 +464,22 @@ typedef union PgStat_Msg
 	PgStat_MsgFuncstat msg_funcstat;
 	PgStat_MsgFuncpurge msg_funcpurge;
 	PgStat_MsgRecoveryConflict msg_recoveryconflict;
+	PgStat_MsgTempFile msg_tempfile;
 } PgStat_Msg;
 
 
 /* ------------------------------------------------------------
- * Statistic collector data structures follow
+ * Statistics store data structures follow
  *
  * PGSTAT_FILE_FORMAT_ID should be changed whenever any of these
  * data structures change.
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BC99
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9E
 
 /* ----------
- * PgStat_StatDBEntry			The collector's data per database
+ * PgStat_StatDBEntry			The accumulated data per database
  * ----------
  */
 typedef struct PgStat_StatDBEntry
@@ -507,12 +500,19 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter n_conflict_snapshot;
 	PgStat_Counter n_conflict_bufferpin;
 	PgStat_Counter n_conflict_startup_deadlock;
+	PgStat_Counter n_temp_files;
+	PgStat_Counter n_temp_bytes;
+	PgStat_Counter n_block_read_time;	/* times in microseconds */
+	PgStat_Counter n_block_write_time;
+	PgStat_Counter n_ssl_handshakes;
+	PgStat_Counter n_ssl_resumptions;
 	TimestampTz stat_reset_timestamp;
 
 
 	/*
 	 * tables and functions must be last in the struct, because we don't write
-	 * the pointers out to the stats file.
+	 * the pointers out to the stats file.  They are only set in a backend's
+	 * local snapshot; the shared entry leaves them NULL.
 	 */
 	HTAB	   *tables;
 	HTAB	   *functions;
@@ -520,7 +520,7 @@ typedef struct PgStat_StatDBEntry
 
 
 /* ----------
- * PgStat_StatTabEntry			The collector's data per table (or index)
+ * PgStat_StatTabEntry			The accumulated data per table (or index)
  * ----------
  */
 typedef struct PgStat_StatTabEntry
@@ -540,6 +540,7 @@ typedef struct PgStat_StatTabEntry
 	PgStat_Counter n_live_tuples;
 	PgStat_Counter n_dead_tuples;
 	PgStat_Counter changes_since_analyze;
+	PgStat_Counter inserts_since_vacuum;
 
 	PgStat_Counter blocks_fetched;
 	PgStat_Counter blocks_hit;
@@ -556,7 +557,7 @@ typedef struct PgStat_StatTabEntry
 
 
 /* ----------
- * PgStat_StatFuncEntry			The collector's data per function
+ * PgStat_StatFuncEntry			The accumulated data per function
  * ----------
  */
 typedef struct PgStat_StatFuncEntry
@@ -571,11 +572,11 @@ typedef struct PgStat_StatFuncEntry
 
 
 /*
- * Global statistics kept in the stats collector
+ * Cluster-wide statistics kept in shared memory
  */
 typedef struct PgStat_GlobalStats
 {
-	TimestampTz stats_timestamp;	/* time of stats file update */
+	TimestampTz stats_timestamp;	/* time of stats file write */
 	PgStat_Counter timed_checkpoints;
 	PgStat_Counter requested_checkpoints;
 	PgStat_Counter buf_written_checkpoints;
@@ -593,13 +594,31 @@ typedef struct PgStat_GlobalStats
  * ----------
  */
 
+/* ----------
+ * Progress reporting
+ *
+ * A backend running a long maintenance command advertises which command it
+ * is and on which relation, plus an array of counters whose meaning depends
+ * on the command (see commands/progress.h).
+ * ----------
+ */
+typedef enum ProgressCommandType
+{
+	PROGRESS_COMMAND_INVALID,
+	PROGRESS_COMMAND_VACUUM,
+	PROGRESS_COMMAND_CLUSTER,
+	PROGRESS_COMMAND_CREATE_INDEX
+} ProgressCommandType;
+
+#define PGSTAT_NUM_PROGRESS_PARAM	16
+
 /* ----------
  * PgBackendStatus
  *
  * Each live backend maintains a PgBackendStatus struct in shared memory
  * showing its current activity.  (The structs are allocated according to
- * BackendId, but that is not critical.)  Note that the collector process
- * has no involvement in, or even access to, these structs.
+ * BackendId, but that is not critical.)  These are separate from the
+ * shared hashtables holding the accumulated counters.
  * ----------
  */
 typedef struct PgBackendStatus
@@ -637,8 +656,56 @@ typedef struct PgBackendStatus
 
 	/* current command string; MUST be null-terminated */
 	char	   *st_activity;
+
+	/*
+	 * Progress of the maintenance command being run, if any.  The counters
+	 * are only meaningful while st_progress_command isn't
+	 * PROGRESS_COMMAND_INVALID.
+	 */
+	ProgressCommandType st_progress_command;
+	Oid			st_progress_command_target;
+	int64		st_progress_param[PGSTAT_NUM_PROGRESS_PARAM];
 } PgBackendStatus;
 
+/* ----------
+ * Wait events
+ *
+ * While a backend waits, it advertises what for in its PGPROC's
+ * wait_event_info, which pg_stat_activity shows.  The high byte is the class
+ * of wait; the rest says which lock, I/O operation etc.  For LWLocks that's
+ * the lock's id (see LWLockWaitEventId), for heavyweight locks the type of
+ * the lock tag.
+ * ----------
+ */
+#define PG_WAIT_CLASS_MASK	0xFF000000U
+#define PG_WAIT_ID_MASK		0x00FFFFFFU
+
+#define PG_WAIT_LWLOCK		0x01000000U
+#define PG_WAIT_LOCK		0x02000000U
+#define PG_WAIT_IO			0x03000000U
+#define PG_WAIT_CLIENT		0x04000000U
+#define PG_WAIT_LATCH		0x05000000U
+
+/* NB: pgstat_get_wait_event must know the names of these */
+typedef enum WaitEventIO
+{
+	WAIT_EVENT_DATA_FILE_READ = PG_WAIT_IO,
+	WAIT_EVENT_DATA_FILE_WRITE,
+	WAIT_EVENT_DATA_FILE_EXTEND,
+	WAIT_EVENT_DATA_FILE_SYNC,
+	WAIT_EVENT_WAL_READ,
+	WAIT_EVENT_WAL_WRITE,
+	WAIT_EVENT_WAL_SYNC
+} WaitEventIO;
+
+typedef enum WaitEventClient
+{
+	WAIT_EVENT_CLIENT_READ = PG_WAIT_CLIENT,
+	WAIT_EVENT_CLIENT_WRITE
+} WaitEventClient;
+
+#define WAIT_EVENT_LATCH	PG_WAIT_LATCH
+
 /*
  * Working state needed to accumulate per-function-call timing statistics.
  */
@@ -664,37 +731,47 @@ extern bool pgstat_track_activities;
 extern bool pgstat_track_counts;
 extern int	pgstat_track_functions;
 extern PGDLLIMPORT int pgstat_track_activity_query_size;
-extern char *pgstat_stat_tmpname;
-extern char *pgstat_stat_filename;
+extern int	pgstat_max_objects;
 
 /*
  * BgWriter statistics counters are updated directly by bgwriter and bufmgr
  */
 extern PgStat_MsgBgWriter BgWriterStats;
 
+/*
+ * Updated by pgstat_count_buffer_*_time macros
+ */
+extern PgStat_Counter pgStatBlockReadTime;
+extern PgStat_Counter pgStatBlockWriteTime;
+
+/*
+ * Updated by pgstat_count_ssl_handshake macro
+ */
+extern int	pgStatSSLHandshakes;
+extern int	pgStatSSLResumptions;
+
 /* ----------
  * Functions called from postmaster
  * ----------
  */
 extern Size BackendStatusShmemSize(void);
 extern void CreateSharedBackendStatus(void);
+extern Size StatsShmemSize(void);
+extern void CreateSharedStats(void);
 
-extern void pgstat_init(void);
-extern int	pgstat_start(void);
+/* ----------
+ * Functions called at startup and shutdown
+ * ----------
+ */
 extern void pgstat_reset_all(void);
-extern void allow_immediate_pgstat_restart(void);
-
-#ifdef EXEC_BACKEND
-extern void PgstatCollectorMain(int argc, char *argv[]);
-#endif
+extern void pgstat_read_statsfile(void);
+extern void pgstat_write_statsfile(void);
 
 
 /* ----------
  * Functions called from backends
  * ----------
  */
-extern void pgstat_ping(void);
-
 extern void pgstat_report_stat(bool force);
 extern void pgstat_vacuum_stat(void);
 extern void pgstat_drop_database(Oid databaseid);
@@ -711,6 +788,7 @@ extern void pgstat_report_analyze(Relation rel,
 					  PgStat_Counter livetuples, PgStat_Counter deadtuples);
 
 extern void pgstat_report_recovery_conflict(int reason);
+extern void pgstat_report_tempfile(size_t filesize);
 
 extern void pgstat_initialize(void);
 extern void pgstat_bestart(void);
@@ -719,6 +797,15 @@ extern void pgstat_report_activity(const char *cmd_str);
 extern void pgstat_report_appname(const char *appname);
 extern void pgstat_report_xact_timestamp(TimestampTz tstamp);
 extern void pgstat_report_waiting(bool waiting);
+extern void pgstat_progress_start_command(ProgressCommandType cmdtype,
+							  Oid relid);
+extern void pgstat_progress_update_param(int index, int64 val);
+extern void pgstat_progress_update_multi_param(int nparam, const int *index,
+								   const int64 *val);
+extern void pgstat_progress_incr_param(int index, int64 incr);
+extern void pgstat_progress_end_command(void);
+extern const char *pgstat_get_wait_event_type(uint32 wait_event_info);
+extern const char *pgstat_get_wait_event(uint32 wait_event_info);
 extern const char *pgstat_get_backend_current_activity(int pid, bool checkUser);
 extern const char *pgstat_get_crashed_backend_activity(int pid, char *buffer,
 									int buflen);
@@ -765,6 +852,16 @@ extern void pgstat_initstats(Relation rel);
 		if ((rel)->pgstat_info != NULL)								\
 			(rel)->pgstat_info->t_counts.t_blocks_hit++;			\
 	} while (0)
+#define pgstat_count_buffer_read_time(n)							\
+	(pgStatBlockReadTime += (n))
+#define pgstat_count_buffer_write_time(n)							\
+	(pgStatBlockWriteTime += (n))
+#define pgstat_count_ssl_handshake(resumed)							\
+	do {															\
+		pgStatSSLHandshakes++;										\
+		if (resumed)												\
+			pgStatSSLResumptions++;									\
+	} while (0)
 
 extern void pgstat_count_heap_insert(Relation rel, int n);
 extern void pgstat_count_heap_update(Relation rel, bool hot);
@@ -789,6 +886,43 @@ extern void pgstat_twophase_postabort(TransactionId xid, uint16 info,
 
 extern void pgstat_send_bgwriter(void);
 
+/* ----------
+ * pgstat_report_wait_start() -
+ *
+ *	Called before a backend starts to wait, to advertise what it's waiting
+ *	for.  Since only this process ever writes the field, and a 4-byte store
+ *	is atomic, there's no locking.  The only waits that nest are LWLock
+ *	waits, and LWLockSleep puts the outer wait event back itself.
+ * ----------
+ */
+static inline void
+pgstat_report_wait_start(uint32 wait_event_info)
+{
+	volatile PGPROC *proc = MyProc;
+
+	if (!pgstat_track_activities || proc == NULL)
+		return;
+
+	proc->wait_event_info = wait_event_info;
+}
+
+/* ----------
+ * pgstat_report_wait_end() -
+ *
+ *	Called once the wait is over.
+ * ----------
+ */
+static inline void
+pgstat_report_wait_end(void)
+{
+	volatile PGPROC *proc = MyProc;
+
+	if (!pgstat_track_activities || proc == NULL)
+		return;
+
+	proc->wait_event_info = 0;
+}
+
 /* ----------
  * Support functions for the SQL-callable functions to
  * generate the pgstat* views.
@@ -796,6 +930,8 @@ extern void pgstat_send_bgwriter(void);
  */
 extern PgStat_StatDBEntry *pgstat_fetch_stat_dbentry(Oid dbid);
 extern PgStat_StatTabEntry *pgstat_fetch_stat_tabentry(Oid relid);
+extern PgStat_StatTabEntry *pgstat_fetch_current_tabentry(Oid relid,
+							  bool isshared, PgStat_StatTabEntry *tabentry);
 extern PgBackendStatus *pgstat_fetch_stat_beentry(int beid);
 extern PgStat_StatFuncEntry *pgstat_fetch_stat_funcentry(Oid funcid);
 extern int	pgstat_fetch_stat_numbackends(void);
@@ -0,0 +1,128 @@
+/*--------------------------------------------------------------------
+ * bgworker.h
+ *		POSTGRES pluggable background workers interface
+ *
+ * A background worker is a process that the postmaster starts and watches
+ * over on behalf of a loadable module, and that runs a function of that
+ * module.  It may attach to shared memory and connect to a database, in
+ * which case it can run transactions like any backend.
+ *
+ * Workers are registered either at server start, by a module listed in
+ * shared_preload_libraries calling RegisterBackgroundWorker from its
+ * _PG_init, or at any later time by a backend calling
+ * RegisterDynamicBackgroundWorker.  Either way the worker is started once
+ * the server reaches the state given by bgw_start_time.
+ *
+ * A worker that exits with status 0 is done, and is forgotten.  A worker
+ * that exits with status 1 (which is what ereport(FATAL) does) is started
+ * again bgw_restart_time seconds later, unless that is BGW_NEVER_RESTART.
+ * Any other exit status of a worker attached to shared memory is a crash,
+ * and makes the postmaster reinitialize shared memory as for a backend.
+ * All workers are terminated on shutdown.
+ *
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/postmaster/bgworker.h
+ *--------------------------------------------------------------------
+ */
+#ifndef BGWORKER_H
+#define BGWORKER_H
+
+/*---------------------------------------------------------------------
+ * External module API.
+ *---------------------------------------------------------------------
+ */
+
+/*
+ * Pass this flag to have your worker be able to connect to shared memory.
+ */
+#define BGWORKER_SHMEM_ACCESS						0x0001
+
+/*
+ * This flag means the bgworker requires a database connection.  The connection
+ * is not established automatically; the worker must establish it later.
+ * It requires that BGWORKER_SHMEM_ACCESS was passed too.
+ */
+#define BGWORKER_BACKEND_DATABASE_CONNECTION		0x0002
+
+typedef void (*bgworker_main_type) (Datum main_arg);
+
+/*
+ * Points in time at which a bgworker can request to be started
+ */
+typedef enum
+{
+	BgWorkerStart_PostmasterStart,
+	BgWorkerStart_ConsistentState,
+	BgWorkerStart_RecoveryFinished
+} BgWorkerStartTime;
+
+#define BGW_DEFAULT_RESTART_INTERVAL	60
+#define BGW_NEVER_RESTART				-1
+#define BGW_MAXLEN						64
+
+/*
+ * The worker's main function is looked up by name in the given library
+ * when the worker starts, so that registering a worker doesn't depend on
+ * where the library happens to be loaded in the registering process.
+ *
+ * If bgw_notify_pid is the PID of a backend, that backend is sent SIGUSR1
+ * (which sets its latch) when the worker is started and when it exits; only
+ * dynamically registered workers can ask for this.
+ */
+typedef struct BackgroundWorker
+{
+	char		bgw_name[BGW_MAXLEN];
+	int			bgw_flags;
+	BgWorkerStartTime bgw_start_time;
+	int			bgw_restart_time;		/* in seconds, or BGW_NEVER_RESTART */
+	char		bgw_library_name[BGW_MAXLEN];
+	char		bgw_function_name[BGW_MAXLEN];
+	Datum		bgw_main_arg;
+	pid_t		bgw_notify_pid;
+} BackgroundWorker;
+
+typedef enum BgwHandleStatus
+{
+	BGWH_STARTED,				/* worker is running */
+	BGWH_NOT_YET_STARTED,		/* worker hasn't been started yet */
+	BGWH_STOPPED,				/* worker has exited */
+	BGWH_POSTMASTER_DIED		/* postmaster died; worker status unclear */
+} BgwHandleStatus;
+
+/* Opaque; identifies one dynamically registered worker */
+typedef struct BackgroundWorkerHandle BackgroundWorkerHandle;
+
+/* Register a new bgworker during shared_preload_libraries */
+extern void RegisterBackgroundWorker(BackgroundWorker *worker);
+
+/* Register a new bgworker from a regular backend */
+extern bool RegisterDynamicBackgroundWorker(BackgroundWorker *worker,
+								BackgroundWorkerHandle **handle);
+
+/* Query the status of a dynamically registered bgworker */
+extern BgwHandleStatus GetBackgroundWorkerPid(BackgroundWorkerHandle *handle,
+					   pid_t *pidp);
+extern BgwHandleStatus WaitForBackgroundWorkerStartup(BackgroundWorkerHandle *
+							   handle, pid_t *pidp);
+
+/* Terminate a dynamically registered bgworker */
+extern void TerminateBackgroundWorker(BackgroundWorkerHandle *handle);
+
+/* This is valid in a running worker */
+extern BackgroundWorker *MyBgworkerEntry;
+
+/*
+ * Connect to the specified database, as the specified user.  Only a worker
+ * that passed BGWORKER_BACKEND_DATABASE_CONNECTION during registration may
+ * call this.  If username is NULL, bootstrapping superuser is used.
+ */
+extern void BackgroundWorkerInitializeConnection(char *dbname, char *username);
+
+/* Block/unblock signals in a background worker process */
+extern void BackgroundWorkerBlockSignals(void);
+extern void BackgroundWorkerUnblockSignals(void);
+
+#endif   /* BGWORKER_H */
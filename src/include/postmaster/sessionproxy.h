@@ -0,0 +1,36 @@
+/*-------------------------------------------------------------------------
+ *
+ * sessionproxy.h
+ *	  Exports from postmaster/sessionproxy.c.
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/postmaster/sessionproxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _SESSIONPROXY_H
+#define _SESSIONPROXY_H
+
+/*
+ * Sockets are passed between processes with SCM_RIGHTS messages, and the
+ * proxy must be able to wait on many more sockets than select() allows.
+ */
+#if defined(HAVE_UNIX_SOCKETS) && defined(HAVE_POLL) && !defined(EXEC_BACKEND)
+#define HAVE_SESSION_PROXY 1
+#endif
+
+/* GUC options */
+extern int	SessionPoolSize;
+extern bool SessionPooling;
+
+/* Functions called from postmaster */
+extern void SessionProxyInit(void);
+extern int	StartSessionProxy(void);
+
+/* Functions called from backends */
+extern bool SessionIsPoolable(void);
+extern bool SessionProxyHandoff(void);
+
+#endif   /* _SESSIONPROXY_H */
@@ -14,6 +14,25 @@
 
 #include "nodes/replnodes.h"
 
+/*
+ * In an incremental backup, a relation file is sent as a tar member named
+ * "<file>.incr" holding only the blocks changed since the given LSN.  The
+ * member starts with this header, followed by nchanged block numbers
+ * (uint32 each, ascending) and then the nchanged blocks themselves, BLCKSZ
+ * bytes each.  To apply it, write each block at its position in the file
+ * from the earlier backup and truncate the file to nblocks blocks.  All
+ * fields are in the server's byte order.
+ */
+#define INCREMENTAL_FILE_SUFFIX		".incr"
+#define INCREMENTAL_FILE_MAGIC		0x52434E49	/* "INCR" */
+
+typedef struct IncrementalFileHeader
+{
+	uint32		magic;
+	uint32		nblocks;		/* length of the file, in blocks */
+	uint32		nchanged;		/* number of blocks included */
+} IncrementalFileHeader;
+
 extern void SendBaseBackup(BaseBackupCmd *cmd);
 
 #endif   /* _BASEBACKUP_H */
@@ -0,0 +1,95 @@
+/*-------------------------------------------------------------------------
+ *
+ * logical.h
+ *	  Logical decoding of WAL into row changes, and the output plugin
+ *	  interface.
+ *
+ * Portions Copyright (c) 2012, PostgreSQL Global Development Group
+ *
+ * src/include/replication/logical.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LOGICAL_H
+#define _LOGICAL_H
+
+#include "access/htup.h"
+#include "access/xlogdefs.h"
+#include "datatype/timestamp.h"
+#include "fmgr.h"
+#include "lib/stringinfo.h"
+#include "utils/relcache.h"
+
+
+/*
+ * A decoded row change, as handed to an output plugin.
+ *
+ * oldtuple is set for UPDATE and DELETE, newtuple for INSERT and UPDATE.
+ * Out-of-line values that were written by the same transaction are
+ * reassembled in place; any others (for example a TOASTed column that an
+ * UPDATE didn't change) are left as external TOAST pointers, which a plugin
+ * must not try to detoast --- check VARATT_IS_EXTERNAL first.
+ */
+typedef enum LogicalChangeAction
+{
+	LOGICAL_CHANGE_INSERT,
+	LOGICAL_CHANGE_UPDATE,
+	LOGICAL_CHANGE_DELETE
+} LogicalChangeAction;
+
+typedef struct LogicalChange
+{
+	LogicalChangeAction action;
+	XLogRecPtr	lsn;			/* location of the change in WAL */
+	HeapTuple	oldtuple;
+	HeapTuple	newtuple;
+} LogicalChange;
+
+/*
+ * State shared between the decoding machinery and an output plugin.
+ *
+ * Each callback appends what it wants to emit to 'out'; whatever it leaves
+ * there becomes one row of output, and 'out' is reset before the next
+ * callback.  Callbacks run in a memory context that is reset after each
+ * change, so they needn't bother freeing things.
+ */
+typedef struct LogicalDecodingContext
+{
+	StringInfo	out;
+	void	   *output_plugin_private;
+} LogicalDecodingContext;
+
+typedef void (*LogicalDecodeStartupCB) (LogicalDecodingContext *ctx);
+typedef void (*LogicalDecodeBeginCB) (LogicalDecodingContext *ctx,
+									  TransactionId xid,
+									  TimestampTz commit_time);
+typedef void (*LogicalDecodeChangeCB) (LogicalDecodingContext *ctx,
+									   Relation relation,
+									   LogicalChange *change);
+typedef void (*LogicalDecodeCommitCB) (LogicalDecodingContext *ctx,
+									   TransactionId xid,
+									   XLogRecPtr commit_lsn,
+									   TimestampTz commit_time);
+typedef void (*LogicalDecodeShutdownCB) (LogicalDecodingContext *ctx);
+
+/*
+ * Output plugin callbacks.  A plugin is a loadable module exporting
+ *		void _PG_output_plugin_init(OutputPluginCallbacks *cb)
+ * which fills in the callbacks.  Only change_cb is required.
+ */
+typedef struct OutputPluginCallbacks
+{
+	LogicalDecodeStartupCB startup_cb;
+	LogicalDecodeBeginCB begin_cb;
+	LogicalDecodeChangeCB change_cb;
+	LogicalDecodeCommitCB commit_cb;
+	LogicalDecodeShutdownCB shutdown_cb;
+} OutputPluginCallbacks;
+
+typedef void (*LogicalOutputPluginInit) (OutputPluginCallbacks *cb);
+
+/* SQL-callable functions in logical.c */
+extern Datum pg_logical_start_point(PG_FUNCTION_ARGS);
+extern Datum pg_logical_changes(PG_FUNCTION_ARGS);
+
+#endif   /* _LOGICAL_H */
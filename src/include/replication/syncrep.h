@@ -20,8 +20,27 @@
 #define SYNC_REP_WAITING			1
 #define SYNC_REP_WAIT_COMPLETE		2
 
+/* syncrep_method of SyncRepConfigData */
+#define SYNC_REP_PRIORITY			0
+#define SYNC_REP_QUORUM				1
+
+/*
+ * Parsed form of synchronous_standby_names.  This is the GUC's "extra"
+ * data, so it must be a single malloc'd chunk: the member names follow the
+ * struct as consecutive null-terminated strings.
+ */
+typedef struct SyncRepConfigData
+{
+	int			config_size;	/* total size of this struct, in bytes */
+	int			num_sync;		/* number of standbys to wait for */
+	uint8		syncrep_method;	/* SYNC_REP_PRIORITY or SYNC_REP_QUORUM */
+	int			nmembers;		/* number of member names */
+	char		member_names[1];	/* VARIABLE LENGTH ARRAY */
+} SyncRepConfigData;
+
 /* user-settable parameters for synchronous replication */
 extern char *SyncRepStandbyNames;
+extern SyncRepConfigData *SyncRepConfig;
 
 /* called by user backend */
 extern void SyncRepWaitForLSN(XLogRecPtr XactCommitLSN);
@@ -38,7 +57,9 @@ extern void SyncRepUpdateSyncStandbysDefined(void);
 
 /* called by various procs */
 extern int	SyncRepWakeQueue(bool all);
+extern int	SyncRepGetSyncStandbys(int *standbys);
 
 extern bool check_synchronous_standby_names(char **newval, void **extra, GucSource source);
+extern void assign_synchronous_standby_names(const char *newval, void *extra);
 
 #endif   /* _SYNCREP_H */
@@ -53,6 +53,18 @@ typedef struct
 	TimestampTz sendTime;
 } WalDataMessageHeader;
 
+/*
+ * Compressed WAL data message (message type 'z').  Sent instead of 'w' only
+ * when the receiver asked for it with START_REPLICATION ... COMPRESS, and
+ * only for slices that pglz actually manages to shrink.
+ *
+ * The message carries the same WalDataMessageHeader as 'w', followed by the
+ * WAL data in pg_lzcompress format (a PGLZ_Header giving the compressed and
+ * raw lengths, then the compressed bytes).  The raw length never exceeds
+ * MAX_SEND_SIZE, and the same rule about not splitting WAL records across
+ * messages applies to the decompressed data.
+ */
+
 /*
  * Keepalive message from primary (message type 'k'). (lowercase k)
  * This is wrapped within a CopyData message at the FE/BE protocol level.
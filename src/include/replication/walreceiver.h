@@ -20,6 +20,7 @@
 extern bool am_walreceiver;
 extern int	wal_receiver_status_interval;
 extern bool hot_standby_feedback;
+extern bool wal_receiver_compression;
 
 /*
  * MAXCONNINFO: maximum size of a connection string.
@@ -41,6 +41,28 @@ typedef enum
 	RBM_ZERO_ON_ERROR			/* Read, but return an all-zeros page on error */
 } ReadBufferMode;
 
+/*
+ * Read-ahead state for a scan that knows which blocks it will read next.
+ * The scan queues upcoming block numbers in the order it will read them,
+ * and tells the stream as it reads each one; the stream keeps up to
+ * "distance" of the queued blocks prefetched ahead of the scan.
+ */
+typedef struct ReadStream
+{
+	Relation	rel;			/* relation being read */
+	ForkNumber	forkNum;		/* fork being read */
+	int			distance;		/* max # of prefetched blocks not yet read */
+	int			size;			/* allocated length of queue[] */
+	int			head;			/* position of next block to be read */
+	int			nqueued;		/* # of entries in queue[] */
+	int			nprefetched;	/* # of those, from head, already prefetched */
+	BufferAccessStrategy strategy;	/* for read-ahead under direct I/O */
+	BlockNumber queue[1];		/* VARIABLE LENGTH ARRAY, used circularly */
+} ReadStream;
+
+/* Maximum number of blocks ReadBufferAhead reads in a single call */
+#define MAX_BUFFER_READAHEAD	16
+
 /* in globals.c ... this duplicates miscadmin.h */
 extern PGDLLIMPORT int NBuffers;
 
@@ -48,6 +70,8 @@ extern PGDLLIMPORT int NBuffers;
 extern bool zero_damaged_pages;
 extern int	bgwriter_lru_maxpages;
 extern double bgwriter_lru_multiplier;
+extern bool track_io_timing;
+extern bool defer_hint_bit_writes;
 extern int	target_prefetch_pages;
 
 /* in buf_init.c */
@@ -160,6 +184,17 @@ extern PGDLLIMPORT int32 *LocalRefCount;
  */
 extern void PrefetchBuffer(Relation reln, ForkNumber forkNum,
 			   BlockNumber blockNum);
+extern void PrefetchBufferWithoutRelcache(RelFileNode rnode,
+							  ForkNumber forkNum, BlockNumber blockNum);
+extern ReadStream *ReadStreamCreate(Relation reln, ForkNumber forkNum,
+				 int size, int distance);
+extern bool ReadStreamQueue(ReadStream *stream, BlockNumber blockNum);
+extern void ReadStreamConsume(ReadStream *stream, BlockNumber blockNum);
+extern void ReadStreamReset(ReadStream *stream);
+extern void ReadStreamFree(ReadStream *stream);
+extern void ReadBufferAhead(Relation reln, ForkNumber forkNum,
+				BlockNumber blockNum, int nblocks,
+				BufferAccessStrategy strategy);
 extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
 extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 				   BlockNumber blockNum, ReadBufferMode mode,
@@ -186,7 +221,10 @@ extern BlockNumber RelationGetNumberOfBlocksInFork(Relation relation,
 extern void FlushRelationBuffers(Relation rel);
 extern void FlushDatabaseBuffers(Oid dbid);
 extern void DropRelFileNodeBuffers(RelFileNodeBackend rnode,
-					   ForkNumber forkNum, BlockNumber firstDelBlock);
+					   ForkNumber forkNum, BlockNumber nForkBlock,
+					   BlockNumber firstDelBlock);
+extern void DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes,
+						   BlockNumber *nblocks, int nnodes);
 extern void DropDatabaseBuffers(Oid dbid);
 
 #define RelationGetNumberOfBlocks(reln) \
@@ -208,12 +246,13 @@ extern void LockBuffer(Buffer buffer, int mode);
 extern bool ConditionalLockBuffer(Buffer buffer);
 extern void LockBufferForCleanup(Buffer buffer);
 extern bool ConditionalLockBufferForCleanup(Buffer buffer);
+extern bool IsBufferCleanupOK(Buffer buffer);
 extern bool HoldingBufferPinThatDelaysRecovery(void);
 
 extern void AbortBufferIO(void);
 
 extern void BufmgrCommit(void);
-extern void BgBufferSync(void);
+extern bool BgBufferSync(void);
 
 extern void AtProcExit_LocalBuffers(void);
 
@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * dsm.h
+ *	  manage dynamic shared memory segments
+ *
+ * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/dsm.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DSM_H
+#define DSM_H
+
+/* A handle that any process can use to attach to a segment */
+typedef uint32 dsm_handle;
+
+/* A segment as mapped into this process; opaque to callers */
+typedef struct dsm_segment dsm_segment;
+
+typedef void (*on_dsm_detach_callback) (dsm_segment *seg, Datum arg);
+
+/* Startup and shutdown functions */
+extern Size DsmShmemSize(void);
+extern void DsmShmemInit(void);
+
+/* Functions that create, attach to and detach from segments */
+extern dsm_segment *dsm_create(Size size);
+extern dsm_segment *dsm_attach(dsm_handle h);
+extern void dsm_detach(dsm_segment *seg);
+
+/* Accessor functions */
+extern void *dsm_segment_address(dsm_segment *seg);
+extern Size dsm_segment_map_length(dsm_segment *seg);
+extern dsm_handle dsm_segment_handle(dsm_segment *seg);
+
+/* Cleanup hook, run when this process detaches from the segment */
+extern void on_dsm_detach(dsm_segment *seg,
+			  on_dsm_detach_callback function, Datum arg);
+
+#endif   /* DSM_H */
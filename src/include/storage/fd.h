@@ -39,6 +39,10 @@
 #define FD_H
 
 #include <dirent.h>
+#include <limits.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
 
 
 /*
@@ -49,9 +53,37 @@ typedef char *FileName;
 
 typedef int File;
 
+#ifdef WIN32
+/* Windows has no readv/writev; fd.c emulates them with this struct */
+struct iovec
+{
+	void	   *iov_base;
+	size_t		iov_len;
+};
+#endif
 
-/* GUC parameter */
+/*
+ * Maximum number of iovec entries passed to FileReadV/FileWriteV in a single
+ * call.  Callers doing multi-block I/O split larger requests into chunks of
+ * at most this many blocks.
+ */
+#if defined(IOV_MAX) && IOV_MAX < 32
+#define PG_IOV_MAX	IOV_MAX
+#else
+#define PG_IOV_MAX	32
+#endif
+
+
+/* GUC parameters */
 extern int	max_files_per_process;
+extern int	direct_io;
+
+/*
+ * Bits in direct_io: which kinds of files are opened with O_DIRECT.  Buffers
+ * used for direct I/O must be aligned to PG_IO_ALIGN_SIZE.
+ */
+#define DIRECT_IO_DATA		0x01	/* relation data files */
+#define DIRECT_IO_WAL		0x02	/* WAL segments */
 
 
 /*
@@ -66,6 +98,8 @@ extern void FileClose(File file);
 extern int	FilePrefetch(File file, off_t offset, int amount);
 extern int	FileRead(File file, char *buffer, int amount);
 extern int	FileWrite(File file, char *buffer, int amount);
+extern int	FileReadV(File file, const struct iovec *iov, int iovcnt);
+extern int	FileWriteV(File file, const struct iovec *iov, int iovcnt);
 extern int	FileSync(File file);
 extern off_t FileSeek(File file, off_t offset, int whence);
 extern int	FileTruncate(File file, off_t offset);
@@ -86,6 +120,7 @@ extern int	BasicOpenFile(FileName fileName, int fileFlags, int fileMode);
 /* Miscellaneous support routines */
 extern void InitFileAccess(void);
 extern void set_max_safe_fds(void);
+extern void GetVfdCacheStats(int64 *evictions, int64 *reopens);
 extern void closeAllVfds(void);
 extern void SetTempTablespaces(Oid *tableSpaces, int numSpaces);
 extern bool TempTablespacesAreSet(void);
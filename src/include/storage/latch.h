@@ -99,6 +99,9 @@ typedef struct
 #define WL_TIMEOUT           (1 << 3)
 #define WL_POSTMASTER_DEATH  (1 << 4)
 
+/* Maximum number of sockets WaitLatchOrSockets() can wait on at once */
+#define MAX_WAIT_SOCKETS	60
+
 /*
  * prototypes for functions in latch.c
  */
@@ -109,6 +112,8 @@ extern void DisownLatch(volatile Latch *latch);
 extern int WaitLatch(volatile Latch *latch, int wakeEvents, long timeout);
 extern int WaitLatchOrSocket(volatile Latch *latch, int wakeEvents,
 				  pgsocket sock, long timeout);
+extern int WaitLatchOrSockets(volatile Latch *latch, int wakeEvents,
+				   const pgsocket *socks, int nsocks, long timeout);
 extern void SetLatch(volatile Latch *latch);
 extern void ResetLatch(volatile Latch *latch);
 
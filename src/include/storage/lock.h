@@ -31,6 +31,8 @@ typedef struct PROC_QUEUE
 /* GUC variables */
 extern int	max_locks_per_xact;
 
+extern void assign_max_locks_per_xact(int newval, void *extra);
+
 #ifdef LOCK_DEBUG
 extern int	Trace_lock_oidmin;
 extern bool Trace_locks;
@@ -192,6 +194,8 @@ typedef enum LockTagType
 
 #define LOCKTAG_LAST_TYPE	LOCKTAG_ADVISORY
 
+extern const char *const LockTagTypeNames[];
+
 /*
  * The LOCKTAG struct is defined with malice aforethought to fit into 16
  * bytes with no padding.  Note that this would need adjustment if we were
@@ -466,10 +470,13 @@ typedef enum
  * The lockmgr's shared hash tables are partitioned to reduce contention.
  * To determine which partition a given locktag belongs to, compute the tag's
  * hash code with LockTagHashCode(), then apply one of these macros.
- * NB: NUM_LOCK_PARTITIONS must be a power of 2!
+ * NumLockPartitions is a power of 2 no larger than MAX_LOCK_PARTITIONS,
+ * chosen at startup.
  */
+extern PGDLLIMPORT int NumLockPartitions;
+
 #define LockHashPartition(hashcode) \
-	((hashcode) % NUM_LOCK_PARTITIONS)
+	((hashcode) & (NumLockPartitions - 1))
 #define LockHashPartitionLock(hashcode) \
 	((LWLockId) (FirstLockMgrLock + LockHashPartition(hashcode)))
 
@@ -497,6 +504,7 @@ extern void LockReleaseCurrentOwner(void);
 extern void LockReassignCurrentOwner(void);
 extern VirtualTransactionId *GetLockConflicts(const LOCKTAG *locktag,
 				 LOCKMODE lockmode);
+extern int	LockWaiterCount(const LOCKTAG *locktag);
 extern void AtPrepare_Locks(void);
 extern void PostPrepare_Locks(TransactionId xid);
 extern int LockCheckConflicts(LockMethod lockMethodTable,
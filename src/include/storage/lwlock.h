@@ -15,22 +15,46 @@
 #define LWLOCK_H
 
 /*
- * It's a bit odd to declare NUM_BUFFER_PARTITIONS and NUM_LOCK_PARTITIONS
+ * It's a bit odd to declare MAX_BUFFER_PARTITIONS and MAX_LOCK_PARTITIONS
  * here, but we need them to set up enum LWLockId correctly, and having
  * this file include lock.h or bufmgr.h would be backwards.
  */
 
-/* Number of partitions of the shared buffer mapping hashtable */
-#define NUM_BUFFER_PARTITIONS  16
+/*
+ * Maximum number of partitions of the shared buffer mapping hashtable.  The
+ * number actually used is chosen at startup, see NumBufferPartitions.
+ */
+#define LOG2_MAX_BUFFER_PARTITIONS  7
+#define MAX_BUFFER_PARTITIONS  (1 << LOG2_MAX_BUFFER_PARTITIONS)
 
-/* Number of partitions the shared lock tables are divided into */
-#define LOG2_NUM_LOCK_PARTITIONS  4
-#define NUM_LOCK_PARTITIONS  (1 << LOG2_NUM_LOCK_PARTITIONS)
+/*
+ * Maximum number of partitions the shared lock tables are divided into.  The
+ * number actually used is chosen at startup, see NumLockPartitions.  All of
+ * them are held at once by the deadlock detector, so this must stay well
+ * below MAX_SIMUL_LWLOCKS.
+ */
+#define LOG2_MAX_LOCK_PARTITIONS  6
+#define MAX_LOCK_PARTITIONS  (1 << LOG2_MAX_LOCK_PARTITIONS)
 
-/* Number of partitions the shared predicate lock tables are divided into */
-#define LOG2_NUM_PREDICATELOCK_PARTITIONS  4
+/*
+ * Number of partitions the shared predicate lock tables are divided into.
+ * Like the regular lock partitions, these are all held at once by a few
+ * operations (TRUNCATE and DROP of a table, lock status display).
+ */
+#define LOG2_NUM_PREDICATELOCK_PARTITIONS  6
 #define NUM_PREDICATELOCK_PARTITIONS  (1 << LOG2_NUM_PREDICATELOCK_PARTITIONS)
 
+/* Number of WAL insertion locks (see xlog.c) */
+#define NUM_XLOGINSERT_LOCKS  8
+
+/* Number of partitions the shared statistics hashtables are divided into */
+#define LOG2_NUM_PGSTAT_PARTITIONS  4
+#define NUM_PGSTAT_PARTITIONS  (1 << LOG2_NUM_PGSTAT_PARTITIONS)
+
+/* Number of partitions of the shared catalog cache */
+#define LOG2_NUM_SHARED_CATCACHE_PARTITIONS  4
+#define NUM_SHARED_CATCACHE_PARTITIONS  (1 << LOG2_NUM_SHARED_CATCACHE_PARTITIONS)
+
 /*
  * We have a number of predefined LWLocks, plus a bunch of LWLocks that are
  * dynamically assigned (e.g., for shared buffers).  The LWLock structures
@@ -46,14 +70,20 @@
  */
 typedef enum LWLockId
 {
-	BufFreelistLock,
+	/*
+	 * Formerly BufFreelistLock, which the buffer strategy code no longer
+	 * needs.  The slot is kept so that the other locks keep their numbers,
+	 * as explained above, and because LWLOCK_STATS builds still take lock 0
+	 * to keep backends' reports from interleaving.
+	 */
+	BufFreelistLockPlaceholder,
 	ShmemIndexLock,
 	OidGenLock,
 	XidGenLock,
 	ProcArrayLock,
 	SInvalReadLock,
 	SInvalWriteLock,
-	WALInsertLock,
+	WALBufMappingLock,
 	WALWriteLock,
 	ControlFileLock,
 	CheckpointLock,
@@ -79,13 +109,20 @@ typedef enum LWLockId
 	SerializablePredicateLockListLock,
 	OldSerXidLock,
 	SyncRepLock,
+	PgStatDBLock,
+	PlanCacheStatsLock,
+	BackgroundWorkerLock,
+	DynamicSharedMemoryControlLock,
 	/* Individual lock IDs end here */
 	FirstBufMappingLock,
-	FirstLockMgrLock = FirstBufMappingLock + NUM_BUFFER_PARTITIONS,
-	FirstPredicateLockMgrLock = FirstLockMgrLock + NUM_LOCK_PARTITIONS,
+	FirstLockMgrLock = FirstBufMappingLock + MAX_BUFFER_PARTITIONS,
+	FirstPredicateLockMgrLock = FirstLockMgrLock + MAX_LOCK_PARTITIONS,
+	FirstWALInsertLock = FirstPredicateLockMgrLock + NUM_PREDICATELOCK_PARTITIONS,
+	FirstPgStatLock = FirstWALInsertLock + NUM_XLOGINSERT_LOCKS,
+	FirstSharedCatCacheLock = FirstPgStatLock + NUM_PGSTAT_PARTITIONS,
 
 	/* must be last except for MaxDynamicLWLock: */
-	NumFixedLWLocks = FirstPredicateLockMgrLock + NUM_PREDICATELOCK_PARTITIONS,
+	NumFixedLWLocks = FirstSharedCatCacheLock + NUM_SHARED_CATCACHE_PARTITIONS,
 
 	MaxDynamicLWLock = 1000000000
 } LWLockId;
@@ -94,7 +131,10 @@ typedef enum LWLockId
 typedef enum LWLockMode
 {
 	LW_EXCLUSIVE,
-	LW_SHARED
+	LW_SHARED,
+	LW_WAIT_UNTIL_FREE			/* A special mode used in PGPROC->lwWaitMode,
+								 * when waiting for lock to become free. Not
+								 * to be used as LWLockAcquire argument */
 } LWLockMode;
 
 
@@ -105,14 +145,24 @@ extern bool Trace_lwlocks;
 extern LWLockId LWLockAssign(void);
 extern void LWLockAcquire(LWLockId lockid, LWLockMode mode);
 extern bool LWLockConditionalAcquire(LWLockId lockid, LWLockMode mode);
+extern bool LWLockAcquireOrWait(LWLockId lockid, LWLockMode mode);
+extern bool LWLockAcquireWithVar(LWLockId lockid, uint64 *valptr, uint64 val);
 extern void LWLockRelease(LWLockId lockid);
 extern void LWLockReleaseAll(void);
 extern bool LWLockHeldByMe(LWLockId lockid);
 
+extern bool LWLockWaitForVar(LWLockId lockid, uint64 *valptr,
+				 uint64 oldval, uint64 *newval);
+extern void LWLockUpdateVar(LWLockId lockid, uint64 *valptr, uint64 value);
+
 extern int	NumLWLocks(void);
 extern Size LWLockShmemSize(void);
 extern void CreateLWLocks(void);
 
 extern void RequestAddinLWLocks(int n);
 
+extern const char *GetLWLockIdentifier(LWLockId lockid);
+extern void LWLockFlushStats(void);
+extern void LWLockResetStats(void);
+
 #endif   /* LWLOCK_H */
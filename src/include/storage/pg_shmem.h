@@ -38,6 +38,19 @@ typedef struct PGShmemHeader	/* standard header for all Postgres shmem */
 #endif
 } PGShmemHeader;
 
+/* Possible values for huge_pages */
+typedef enum
+{
+	HUGE_PAGES_OFF,
+	HUGE_PAGES_ON,
+	HUGE_PAGES_TRY
+} HugePagesType;
+
+/* GUC variables */
+extern int	huge_pages;
+extern int	huge_page_size;
+extern bool numa_interleave;
+
 
 #ifdef EXEC_BACKEND
 #ifndef WIN32
@@ -30,6 +30,7 @@ typedef enum
 	PMSIGNAL_START_AUTOVAC_WORKER,		/* start an autovacuum worker */
 	PMSIGNAL_START_WALRECEIVER, /* start a walreceiver */
 	PMSIGNAL_ADVANCE_STATE_MACHINE,		/* advance postmaster's state machine */
+	PMSIGNAL_BACKGROUND_WORKER_CHANGE,	/* background worker state change */
 
 	NUM_PMSIGNALS				/* Must be last value of enum! */
 } PMSignalReason;
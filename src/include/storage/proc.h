@@ -19,6 +19,7 @@
 #include "storage/latch.h"
 #include "storage/lock.h"
 #include "storage/pg_sema.h"
+#include "storage/spin.h"
 
 /*
  * Each backend advertises up to PGPROC_MAX_CACHED_SUBXIDS TransactionIds
@@ -48,12 +49,26 @@ struct XidCache
 #define		PROC_VACUUM_STATE_MASK (0x0E)
 
 /*
- * We allow a small number of "weak" relation locks (AccesShareLock,
- * RowShareLock, RowExclusiveLock) to be recorded in the PGPROC structure
+ * We allow a number of "weak" relation locks (AccesShareLock,
+ * RowShareLock, RowExclusiveLock) to be recorded in per-backend arrays
  * rather than the main lock table.  This eases contention on the lock
  * manager LWLocks.  See storage/lmgr/README for additional details.
+ *
+ * The slots are divided into groups of FP_LOCK_SLOTS_PER_GROUP, and each
+ * relation can only use the slots of the group its OID hashes to, so that
+ * lookups never need to scan more than one group.  The number of groups is
+ * derived from max_locks_per_transaction at startup.
  */
-#define		FP_LOCK_SLOTS_PER_BACKEND 16
+#define		FP_LOCK_SLOTS_PER_GROUP		16
+#define		FP_LOCK_GROUPS_PER_BACKEND_MAX	1024
+
+extern int	FastPathLockGroupsPerBackend;
+
+#define		FastPathLockSlotsPerBackend() \
+	(FP_LOCK_SLOTS_PER_GROUP * FastPathLockGroupsPerBackend)
+#define		FastPathLockShmemSizePerProc() \
+	(MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64)) + \
+	 MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid)))
 
 /*
  * Each backend has a PGPROC struct in shared memory.  There is also a list of
@@ -101,9 +116,12 @@ struct PGPROC
 
 	/* Info about LWLock the process is currently waiting for, if any. */
 	bool		lwWaiting;		/* true if waiting for an LW lock */
-	bool		lwExclusive;	/* true if waiting for exclusive access */
+	uint8		lwWaitMode;		/* lwlock mode being waited for */
 	struct PGPROC *lwWaitLink;	/* next waiter for same LW lock */
 
+	/* What the process is waiting for, if anything; see pgstat.h */
+	uint32		wait_event_info;
+
 	/* Info about lock the process is currently waiting for, if any. */
 	/* waitLock and waitProcLock are NULL if not currently waiting. */
 	LOCK	   *waitLock;		/* Lock object we're sleeping on ... */
@@ -122,12 +140,25 @@ struct PGPROC
 	int			syncRepState;	/* wait state for sync rep */
 	SHM_QUEUE	syncRepLinks;	/* list link if process is in syncrep queue */
 
+	/*
+	 * Info to allow a group leader to set the clog status of our transaction
+	 * for us; see TransactionGroupUpdateXidStatus in clog.c.  These are set
+	 * before we join the group and not touched again until we're woken.
+	 */
+	bool		clogGroupMember;	/* true while a member of a clog group */
+	int			clogGroupNext;	/* pgprocno of next group member, or
+								 * INVALID_PGPROCNO */
+	TransactionId clogGroupMemberXid;	/* top-level xid to set */
+	int			clogGroupMemberXidStatus;	/* XidStatus to set it to */
+	int			clogGroupMemberPage;	/* clog page the xid is on */
+	XLogRecPtr	clogGroupMemberLsn; /* commit record LSN, for async commit */
+
 	/*
 	 * All PROCLOCK objects for locks held or awaited by this backend are
 	 * linked into one of these lists, according to the partition number of
 	 * their lock.
 	 */
-	SHM_QUEUE	myProcLocks[NUM_LOCK_PARTITIONS];
+	SHM_QUEUE	myProcLocks[MAX_LOCK_PARTITIONS];
 
 	struct XidCache subxids;	/* cache for subtransaction XIDs */
 
@@ -135,14 +166,18 @@ struct PGPROC
 	LWLockId	backendLock;	/* protects the fields below */
 
 	/* Lock manager data, recording fast-path locks taken by this backend. */
-	uint64		fpLockBits;		/* lock modes held for each fast-path slot */
-	Oid			fpRelId[FP_LOCK_SLOTS_PER_BACKEND]; /* slots for rel oids */
+	uint64	   *fpLockBits;		/* lock modes held for each fast-path slot,
+								 * one word per group */
+	Oid		   *fpRelId;		/* slots for rel oids */
 	bool		fpVXIDLock;		/* are we holding a fast-path VXID lock? */
 	LocalTransactionId fpLocalTransactionId;	/* lxid for fast-path VXID lock */
 };
 
 /* NOTE: "typedef struct PGPROC PGPROC" appears in storage/lock.h. */
 
+/* pgprocno that identifies no PGPROC */
+#define INVALID_PGPROCNO		(-1)
+
 
 extern PGDLLIMPORT PGPROC *MyProc;
 extern PGDLLIMPORT struct PGXACT *MyPgXact;
@@ -188,6 +223,8 @@ typedef struct PROC_HDR
 	PGPROC	   *freeProcs;
 	/* Head of list of autovacuum's free PGPROC structures */
 	PGPROC	   *autovacFreeProcs;
+	/* Head of list of background workers' free PGPROC structures */
+	PGPROC	   *bgworkerFreeProcs;
 	/* Current shared estimate of appropriate spins_per_delay value */
 	int			spins_per_delay;
 	/* The proc of the Startup process, since not in ProcArray */
@@ -195,6 +232,9 @@ typedef struct PROC_HDR
 	int			startupProcPid;
 	/* Buffer id of the buffer that Startup process waits for pin on, or -1 */
 	int			startupBufferPinWaitBufId;
+	/* First pgproc waiting for group clog update, protected by the lock */
+	slock_t		clogGroupLock;
+	int			clogGroupFirst;
 } PROC_HDR;
 
 extern PROC_HDR *ProcGlobal;
@@ -93,7 +93,9 @@ typedef enum
 	DestTuplestore,				/* results sent to Tuplestore */
 	DestIntoRel,				/* results sent to relation (SELECT INTO) */
 	DestCopyOut,				/* results sent to COPY TO code */
-	DestSQLFunction				/* results sent to SQL-language func mgr */
+	DestSQLFunction,			/* results sent to SQL-language func mgr */
+	DestTupleQueue,				/* results sent to a shm_mq tuple queue */
+	DestTransientRel			/* results sent to transient relation */
 } CommandDest;
 
 /* ----------------
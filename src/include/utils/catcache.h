@@ -83,6 +83,13 @@ typedef struct catctup
 	 */
 	Dlelem		cache_elem;		/* list member of per-bucket list */
 
+	/*
+	 * All the tuples of all the caches are also members of one Dllist in
+	 * LRU order, most recently used first, from which entries are evicted
+	 * when max_catcache_entries is exceeded.
+	 */
+	Dlelem		lru_elem;		/* list member of global LRU list */
+
 	/*
 	 * The tuple may also be a member of at most one CatCList.	(If a single
 	 * catcache is list-searched with varying numbers of keys, we may have to
@@ -155,12 +162,20 @@ typedef struct catcacheheader
 {
 	CatCache   *ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	Dllist		ch_lrulist;		/* CatCTups of all caches, in LRU order */
+	int64		ch_hits;		/* # of searches satisfied from the caches */
+	int64		ch_misses;		/* # of searches that read the catalogs */
+	int64		ch_evictions;	/* # of entries evicted by the size limit */
 } CatCacheHeader;
 
 
 /* this extern duplicates utils/memutils.h... */
 extern PGDLLIMPORT MemoryContext CacheMemoryContext;
 
+/* GUC parameter */
+extern int	max_catcache_entries;
+extern int	shared_catcache_entries;
+
 extern void CreateCacheMemoryContext(void);
 extern void AtEOXact_CatCache(bool isCommit);
 
@@ -179,6 +194,9 @@ extern CatCList *SearchCatCacheList(CatCache *cache, int nkeys,
 				   Datum v3, Datum v4);
 extern void ReleaseCatCacheList(CatCList *list);
 
+extern void CatalogCacheGetStats(int64 *entries, int64 *hits, int64 *misses,
+					 int64 *evictions);
+
 extern void ResetCatalogCaches(void);
 extern void CatalogCacheFlushCatalog(Oid catId);
 extern void CatalogCacheIdInvalidate(int cacheId, uint32 hashValue);
@@ -187,6 +205,17 @@ extern void PrepareToInvalidateCacheTuple(Relation relation,
 							  HeapTuple newtuple,
 							  void (*function) (int, uint32, Oid));
 
+/* in sharedcatcache.c */
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+extern bool SharedCatCacheUsable(CatCache *cache);
+extern HeapTuple SharedCatCacheLookup(CatCache *cache, uint32 hashValue,
+					 ScanKey cur_skey, uint32 *generation);
+extern void SharedCatCacheInsert(CatCache *cache, uint32 hashValue,
+					 HeapTuple tuple, uint32 generation);
+extern void SharedCatCacheInvalidate(Oid dbId, int cacheId, uint32 hashValue);
+extern void SharedCatCacheFlush(void);
+
 extern void PrintCatCacheLeakWarning(HeapTuple tuple);
 extern void PrintCatCacheListLeakWarning(CatCList *list);
 
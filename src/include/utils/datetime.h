@@ -280,6 +280,8 @@ extern int DecodeTimeOnly(char **field, int *ftype,
 			   struct pg_tm * tm, fsec_t *fsec, int *tzp);
 extern int DecodeInterval(char **field, int *ftype, int nf, int range,
 			   int *dtype, struct pg_tm * tm, fsec_t *fsec);
+extern bool DecodeISODateTime(const char *str, struct pg_tm * tm,
+				  fsec_t *fsec, int *tzp);
 extern int DecodeISO8601Interval(char *str,
 					  int *dtype, struct pg_tm * tm, fsec_t *fsec);
 
@@ -0,0 +1,31 @@
+/*
+ * Utilities for working with hash values.
+ *
+ * Portions Copyright (c) 2012, PostgreSQL Global Development Group
+ *
+ * src/include/utils/hashutils.h
+ */
+
+#ifndef HASHUTILS_H
+#define HASHUTILS_H
+
+/*
+ * Simple inline murmur hash implementation hashing a 32 bit integer, for
+ * performance.  This is the murmur3 finalizer, which mixes every input
+ * bit into every output bit; it is also useful on its own to scramble a
+ * hash value whose low bits may be poorly distributed.
+ */
+static inline uint32
+murmurhash32(uint32 data)
+{
+	uint32		h = data;
+
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+#endif   /* HASHUTILS_H */
@@ -31,6 +31,7 @@ extern void AtSubStart_Inval(void);
 extern void AtEOXact_Inval(bool isCommit);
 
 extern void AtEOSubXact_Inval(bool isCommit);
+extern bool TransactionHasPendingInvalidations(void);
 
 extern void AtPrepare_Inval(void);
 
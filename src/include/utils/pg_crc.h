@@ -57,6 +57,33 @@ do { \
 extern CRCDLLIMPORT const uint32 pg_crc32_table[];
 
 
+/*
+ * CRC-32C, that is CRC-32 using the Castagnoli polynomial, is used for WAL
+ * records, the control file and other files that no index or datatype ever
+ * stored a CRC in, so it could be switched to without compatibility issues.
+ * Unlike the CRC above it is a proper reflected CRC, the kind that recent
+ * x86 (SSE 4.2) and ARMv8 processors can compute in hardware.  The
+ * pg_comp_crc32c function pointer is set to the fastest implementation
+ * available on the running CPU when it is first called.
+ */
+
+/* Initialize a CRC-32C accumulator */
+#define INIT_CRC32C(crc) ((crc) = 0xFFFFFFFF)
+
+/* Finish a CRC-32C calculation */
+#define FIN_CRC32C(crc)	((crc) ^= 0xFFFFFFFF)
+
+/* Accumulate some (more) bytes into a CRC-32C */
+#define COMP_CRC32C(crc, data, len) \
+	((crc) = pg_comp_crc32c((crc), (data), (len)))
+
+/* Check for equality of two CRC-32Cs */
+#define EQ_CRC32C(c1,c2)  ((c1) == (c2))
+
+extern CRCDLLIMPORT pg_crc32 (*pg_comp_crc32c) (pg_crc32 crc,
+												 const void *data, size_t len);
+
+
 #ifdef PROVIDE_64BIT_CRC
 
 /*
@@ -108,5 +108,9 @@ extern const PGLZ_Strategy *const PGLZ_strategy_always;
 extern bool pglz_compress(const char *source, int32 slen, PGLZ_Header *dest,
 			  const PGLZ_Strategy *strategy);
 extern void pglz_decompress(const PGLZ_Header *source, char *dest);
+extern void pglz_decompress_prefix(const PGLZ_Header *source, char *dest,
+					   int32 rawlen);
+extern int32 pglz_maximum_compressed_size(int32 rawlen,
+							 int32 total_compressed_size);
 
 #endif   /* _PG_LZCOMPRESS_H_ */
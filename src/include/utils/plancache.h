@@ -98,6 +98,7 @@ typedef struct CachedPlanSource
 	double		generic_cost;	/* cost of generic plan, or -1 if not known */
 	double		total_custom_cost;	/* total cost of custom plans so far */
 	int			num_custom_plans;	/* number of plans included in total */
+	bool		shared_stats_checked;	/* looked for other backends' state? */
 } CachedPlanSource;
 
 /*
@@ -123,6 +124,12 @@ typedef struct CachedPlan
 } CachedPlan;
 
 
+/* GUC parameter */
+extern int	plan_cache_shared_stats;
+
+extern Size PlanCacheShmemSize(void);
+extern void PlanCacheShmemInit(void);
+
 extern void InitPlanCache(void);
 extern void ResetPlanCache(void);
 
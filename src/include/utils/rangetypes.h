@@ -173,5 +173,6 @@ extern Datum range_gist_union(PG_FUNCTION_ARGS);
 extern Datum range_gist_penalty(PG_FUNCTION_ARGS);
 extern Datum range_gist_picksplit(PG_FUNCTION_ARGS);
 extern Datum range_gist_same(PG_FUNCTION_ARGS);
+extern Datum range_gist_sortsupport(PG_FUNCTION_ARGS);
 
 #endif   /* RANGETYPES_H */
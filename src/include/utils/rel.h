@@ -18,7 +18,9 @@
 #include "catalog/pg_am.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_index.h"
+#include "catalog/pg_statistic_ext.h"
 #include "fmgr.h"
+#include "lib/dllist.h"
 #include "nodes/bitmapset.h"
 #include "rewrite/prs2lock.h"
 #include "storage/block.h"
@@ -70,6 +72,21 @@ typedef struct RelationAmInfo
 } RelationAmInfo;
 
 
+/*
+ * Statistics for one group of a table's columns, as loaded from its
+ * pg_statistic_ext row.  dependencies[] uses the catalog's layout, a
+ * square matrix of nkeys rows.
+ */
+typedef struct ExtStatistics
+{
+	int			nkeys;			/* number of columns in the group */
+	AttrNumber	keys[STATISTIC_EXT_MAX_COLUMNS];	/* in ascending order */
+	double		ndistinct;		/* as stadistinct; 0 if never analyzed */
+	bool		has_dependencies;		/* is dependencies[] filled in? */
+	float4		dependencies[STATISTIC_EXT_MAX_COLUMNS * STATISTIC_EXT_MAX_COLUMNS];
+} ExtStatistics;
+
+
 /*
  * Here are the contents of a relation cache entry.
  */
@@ -80,6 +97,7 @@ typedef struct RelationData
 	/* use "struct" here to avoid needing to include smgr.h: */
 	struct SMgrRelationData *rd_smgr;	/* cached file handle, or NULL */
 	int			rd_refcnt;		/* reference count */
+	Dlelem		rd_lruelem;		/* member of relcache's LRU list */
 	BackendId	rd_backend;		/* owning backend id, if temporary relation */
 	bool		rd_isnailed;	/* rel is nailed in cache */
 	bool		rd_isvalid;		/* relcache entry is valid */
@@ -105,10 +123,20 @@ typedef struct RelationData
 	List	   *rd_indexlist;	/* list of OIDs of indexes on relation */
 	Bitmapset  *rd_indexattr;	/* identifies columns used in indexes */
 	Oid			rd_oidindex;	/* OID of unique index on OID, if any */
+	bool		rd_extstatvalid;	/* is rd_extstats valid? */
+	List	   *rd_extstats;	/* list of ExtStatistics for column groups */
+	bool		rd_partdescvalid;	/* is rd_partdesc valid? */
+	/* use "struct" here to avoid needing to include partition.h: */
+	struct PartitionDescData *rd_partdesc;		/* children's key ranges, or
+												 * NULL */
+	MemoryContext rd_partcxt;	/* private memory cxt for rd_partdesc, if any */
 	LockInfoData rd_lockInfo;	/* lock mgr's info for locking relation */
 	RuleLock   *rd_rules;		/* rewrite rules */
 	MemoryContext rd_rulescxt;	/* private memory cxt for rd_rules, if any */
 	TriggerDesc *trigdesc;		/* Trigger info, or NULL if rel has none */
+	/* use "struct" here to avoid needing to include tableam.h: */
+	const struct TableAmRoutine *rd_tableam;	/* table access method, or
+												 * NULL if not looked up yet */
 
 	/*
 	 * rd_options is set whenever rd_rel is loaded into the relcache entry.
@@ -180,6 +208,7 @@ typedef struct AutoVacOpts
 {
 	bool		enabled;
 	int			vacuum_threshold;
+	int			vacuum_ins_threshold;
 	int			analyze_threshold;
 	int			vacuum_cost_delay;
 	int			vacuum_cost_limit;
@@ -187,6 +216,7 @@ typedef struct AutoVacOpts
 	int			freeze_max_age;
 	int			freeze_table_age;
 	float8		vacuum_scale_factor;
+	float8		vacuum_ins_scale_factor;
 	float8		analyze_scale_factor;
 } AutoVacOpts;
 
@@ -270,6 +300,14 @@ typedef struct StdRdOptions
  */
 #define RelationGetNumberOfAttributes(relation) ((relation)->rd_rel->relnatts)
 
+/*
+ * IndexRelationGetNumberOfKeyAttributes
+ *		Returns the number of key attributes in an index, leaving out
+ *		the non-key columns added with INCLUDE.
+ */
+#define IndexRelationGetNumberOfKeyAttributes(relation) \
+	((relation)->rd_index->indnkeyatts)
+
 /*
  * RelationGetDescr
  *		Returns tuple descriptor for a relation.
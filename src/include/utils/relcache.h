@@ -42,6 +42,8 @@ extern Oid	RelationGetOidIndex(Relation relation);
 extern List *RelationGetIndexExpressions(Relation relation);
 extern List *RelationGetIndexPredicate(Relation relation);
 extern Bitmapset *RelationGetIndexAttrBitmap(Relation relation);
+extern List *RelationGetExtStatistics(Relation relation);
+extern struct PartitionDescData *RelationGetPartitionDesc(Relation relation);
 extern void RelationGetExclusionInfo(Relation indexRelation,
 						 Oid **operators,
 						 Oid **procs,
@@ -89,6 +91,9 @@ extern void RelationCacheInvalidate(void);
 
 extern void RelationCloseSmgrByOid(Oid relationId);
 
+extern void RelationCacheGetStats(int64 *entries, int64 *hits, int64 *misses,
+					  int64 *evictions);
+
 extern void AtEOXact_RelationCache(bool isCommit);
 extern void AtEOSubXact_RelationCache(bool isCommit, SubTransactionId mySubid,
 						  SubTransactionId parentSubid);
@@ -107,4 +112,7 @@ extern bool criticalRelcachesBuilt;
 /* should be used only by relcache.c and postinit.c */
 extern bool criticalSharedRelcachesBuilt;
 
+/* GUC parameter */
+extern int	max_relcache_entries;
+
 #endif   /* RELCACHE_H */
@@ -62,6 +62,12 @@ typedef struct SnapshotData
 	CommandId	curcid;			/* in my xact, CID < curcid are visible */
 	uint32		active_count;	/* refcount on ActiveSnapshot stack */
 	uint32		regd_count;		/* refcount on RegisteredSnapshotList */
+
+	/*
+	 * ShmemVariableCache->xactCompletionCount when the XID arrays were last
+	 * computed, or 0 if they can't be reused by GetSnapshotData.
+	 */
+	uint64		snapXactCompletionCount;
 } SnapshotData;
 
 /*
@@ -36,6 +36,20 @@
  * comparison.  This could sensibly be used to provide a fast comparator
  * function for such cases, but probably not any other acceleration method.
  *
+ * Abbreviated keys: if the caller sets "abbreviate" before calling the
+ * BTSORTSUPPORT function, the opclass may offer to convert each value to a
+ * pass-by-value "abbreviated key" that sorts the same way, or at least not
+ * in the opposite way, as the value itself: x < y must imply abbrev(x) <=
+ * abbrev(y).  It does so by setting abbrev_converter and abbrev_abort, and
+ * moving its real comparator to abbrev_full_comparator, leaving comparator
+ * to compare abbreviated keys.  The caller then sorts by the abbreviated
+ * keys, and breaks ties between them with abbrev_full_comparator applied
+ * to the original values.  Since the conversion can cost more than it
+ * saves if the abbreviated keys don't tell the values apart well, the
+ * caller should now and then (eg, after 10000, 20000, 40000... values)
+ * ask abbrev_abort whether to give up; if it says yes, the caller goes back
+ * to comparing the original values with abbrev_full_comparator.
+ *
  *
  * Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -48,6 +62,7 @@
 #define SORTSUPPORT_H
 
 #include "access/attnum.h"
+#include "utils/relcache.h"
 
 typedef struct SortSupportData *SortSupport;
 
@@ -96,8 +111,22 @@ typedef struct SortSupportData
 	int			(*comparator) (Datum x, Datum y, SortSupport ssup);
 
 	/*
-	 * Additional sort-acceleration functions might be added here later.
+	 * Set by the caller before calling the BTSORTSUPPORT function if it can
+	 * use abbreviated keys for this column (see above); not changed after.
 	 */
+	bool		abbreviate;
+
+	/*
+	 * Abbreviated key support, set by the BTSORTSUPPORT function if it
+	 * accepts "abbreviate".  abbrev_converter computes the abbreviated key
+	 * of a non-null value.  abbrev_abort is told how many values have been
+	 * converted so far, and returns true if the caller should stop using
+	 * abbreviated keys.  abbrev_full_comparator is the comparator for the
+	 * original values.
+	 */
+	Datum		(*abbrev_converter) (Datum original, SortSupport ssup);
+	bool		(*abbrev_abort) (int memtupcount, SortSupport ssup);
+	int			(*abbrev_full_comparator) (Datum x, Datum y, SortSupport ssup);
 } SortSupportData;
 
 
@@ -141,16 +170,68 @@ ApplySortComparator(Datum datum1, bool isNull1,
 	return compare;
 }
 
+/*
+ * Like ApplySortComparator, but for comparing the original values when the
+ * abbreviated keys are equal.
+ */
+static inline int
+ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup)
+{
+	int			compare;
+
+	if (isNull1)
+	{
+		if (isNull2)
+			compare = 0;		/* NULL "=" NULL */
+		else if (ssup->ssup_nulls_first)
+			compare = -1;		/* NULL "<" NOT_NULL */
+		else
+			compare = 1;		/* NULL ">" NOT_NULL */
+	}
+	else if (isNull2)
+	{
+		if (ssup->ssup_nulls_first)
+			compare = 1;		/* NOT_NULL ">" NULL */
+		else
+			compare = -1;		/* NOT_NULL "<" NULL */
+	}
+	else
+	{
+		compare = (*ssup->abbrev_full_comparator) (datum1, datum2, ssup);
+		if (ssup->ssup_reverse)
+			compare = -compare;
+	}
+
+	return compare;
+}
+
 #else
 
 extern int	ApplySortComparator(Datum datum1, bool isNull1,
 					Datum datum2, bool isNull2,
 					SortSupport ssup);
+extern int	ApplySortAbbrevFullComparator(Datum datum1, bool isNull1,
+							  Datum datum2, bool isNull2,
+							  SortSupport ssup);
 
 #endif   /* USE_INLINE */
 
 /* Other functions in utils/sort/sortsupport.c */
 extern void PrepareSortSupportComparisonShim(Oid cmpFunc, SortSupport ssup);
 extern void PrepareSortSupportFromOrderingOp(Oid orderingOp, SortSupport ssup);
+extern void PrepareSortSupportFromGistIndexRel(Relation indexRel,
+								   SortSupport ssup);
+
+/*
+ * Comparators for common pass-by-value representations.  Opclasses should
+ * use these where they fit rather than equivalent comparators of their own,
+ * since tuplesort.c recognizes them and uses sort routines with the
+ * comparison inlined.
+ */
+extern int	ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup);
+extern int	ssup_datum_int64_cmp(Datum x, Datum y, SortSupport ssup);
+extern int	ssup_datum_float8_cmp(Datum x, Datum y, SortSupport ssup);
 
 #endif   /* SORTSUPPORT_H */
@@ -31,6 +31,9 @@
  */
 typedef struct Tuplesortstate Tuplesortstate;
 
+/* this struct is declared in access/gin_private.h: */
+struct GinState;
+
 /*
  * We provide multiple interfaces to what is essentially the same code,
  * since different callers have different data to be sorted and want to
@@ -69,9 +72,17 @@ extern Tuplesortstate *tuplesort_begin_cluster(TupleDesc tupDesc,
 extern Tuplesortstate *tuplesort_begin_index_btree(Relation indexRel,
 							bool enforceUnique,
 							int workMem, bool randomAccess);
+extern Tuplesortstate *tuplesort_begin_index_merge(Relation indexRel,
+							bool enforceUnique,
+							Tuplesortstate **inputs, int ninputs);
+extern Tuplesortstate *tuplesort_begin_index_gist(Relation indexRel,
+						   int workMem, bool randomAccess);
 extern Tuplesortstate *tuplesort_begin_index_hash(Relation indexRel,
 						   uint32 hash_mask,
 						   int workMem, bool randomAccess);
+extern Tuplesortstate *tuplesort_begin_index_gin(Relation indexRel,
+						  struct GinState *ginstate,
+						  int workMem, bool randomAccess);
 extern Tuplesortstate *tuplesort_begin_datum(Oid datumType,
 					  Oid sortOperator, Oid sortCollation,
 					  bool nullsFirstFlag,
@@ -259,6 +259,9 @@ static const PQconninfoOption PQconninfoOptions[] = {
 	{"replication", NULL, NULL, NULL,
 	"Replication", "D", 5},
 
+	{"compression", "PGCOMPRESSION", "0", NULL,
+	"Compression-Level", "", 1},
+
 	/* Terminating entry --- MUST BE LAST */
 	{NULL, NULL, NULL, NULL,
 	NULL, NULL, 0}
@@ -656,6 +659,8 @@ fillPGconn(PGconn *conn, PQconninfoOption *connOptions)
 #endif
 	tmp = conninfo_getval(connOptions, "replication");
 	conn->replication = tmp ? strdup(tmp) : NULL;
+	tmp = conninfo_getval(connOptions, "compression");
+	conn->compression = tmp ? strdup(tmp) : NULL;
 }
 
 /*
@@ -790,6 +795,34 @@ connectOptions2(PGconn *conn)
 	else
 		conn->sslmode = strdup(DefaultSSLMode);
 
+	/*
+	 * validate compression option
+	 */
+	if (conn->compression)
+	{
+		if (conn->compression[0] < '0' || conn->compression[0] > '9' ||
+			conn->compression[1] != '\0')
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+						libpq_gettext("invalid compression value: \"%s\"\n"),
+							  conn->compression);
+			return false;
+		}
+#ifndef HAVE_LIBZ
+		if (conn->compression[0] != '0')
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("compression value \"%s\" invalid when zlib support is not compiled in\n"),
+							  conn->compression);
+			return false;
+		}
+#endif
+	}
+	else
+		conn->compression = strdup("0");
+
 	/*
 	 * Resolve special "auto" client_encoding from the locale
 	 */
@@ -1580,6 +1613,9 @@ keep_going:						/* We will come back to here until there is
 						   addr_cur->ai_addrlen);
 					conn->raddr.salen = addr_cur->ai_addrlen;
 
+					/* Forget compression state of any previous attempt */
+					pqEndCompression(conn);
+
 					/* Open a socket */
 					conn->sock = socket(addr_cur->ai_family, SOCK_STREAM, 0);
 					if (conn->sock < 0)
@@ -2144,10 +2180,13 @@ keep_going:						/* We will come back to here until there is
 
 				/*
 				 * Validate message type: we expect only an authentication
-				 * request or an error here.  Anything else probably means
-				 * it's not Postgres on the other end at all.
+				 * request or an error here, or an acknowledgement that the
+				 * server will compress if we asked for that.  Anything else
+				 * probably means it's not Postgres on the other end at all.
 				 */
-				if (!(beresp == 'R' || beresp == 'E'))
+				if (!(beresp == 'R' || beresp == 'E' ||
+					  (beresp == 'z' && conn->compression[0] != '0' &&
+					   PG_PROTOCOL_MAJOR(conn->pversion) >= 3)))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext(
@@ -2172,6 +2211,40 @@ keep_going:						/* We will come back to here until there is
 					msgLength = 8;
 				}
 
+				/*
+				 * Handle a CompressionAck: all that the server sends after
+				 * it is compressed, and all that we send must be too.
+				 */
+				if (beresp == 'z')
+				{
+					if (msgLength < 5 || msgLength > 100)
+					{
+						appendPQExpBuffer(&conn->errorMessage,
+										  libpq_gettext(
+									  "expected authentication request from "
+													"server, but received %c\n"),
+										  beresp);
+						goto error_return;
+					}
+					if (pqGets(&conn->workBuffer, conn))
+					{
+						/* We'll come back when there is more data */
+						return PGRES_POLLING_READING;
+					}
+					if (strcmp(conn->workBuffer.data, "zlib") != 0)
+					{
+						appendPQExpBuffer(&conn->errorMessage,
+										  libpq_gettext("server selected unsupported compression method \"%s\"\n"),
+										  conn->workBuffer.data);
+						goto error_return;
+					}
+					/* OK, we read the message; mark data consumed */
+					conn->inStart = conn->inCursor;
+					if (pqStartCompression(conn, atoi(conn->compression)))
+						goto error_return;
+					goto keep_going;
+				}
+
 				/*
 				 * Try to validate message length before using it.
 				 * Authentication requests can't be very large, although GSS
@@ -2677,6 +2750,7 @@ makeEmptyPGconn(void)
 	conn->noticeHooks.noticeProc = defaultNoticeProcessor;
 	conn->status = CONNECTION_BAD;
 	conn->asyncStatus = PGASYNC_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	conn->xactStatus = PQTRANS_IDLE;
 	conn->options_valid = false;
 	conn->nonblocking = false;
@@ -2773,6 +2847,8 @@ freePGconn(PGconn *conn)
 		free(conn->dbName);
 	if (conn->replication)
 		free(conn->replication);
+	if (conn->compression)
+		free(conn->compression);
 	if (conn->pguser)
 		free(conn->pguser);
 	if (conn->pgpass)
@@ -2808,6 +2884,8 @@ freePGconn(PGconn *conn)
 	/* Note that conn->Pfdebug is not ours to close or free */
 	if (conn->last_query)
 		free(conn->last_query);
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	pqFreeCommandQueue(conn->cmd_queue_recycle);
 	if (conn->inBuffer)
 		free(conn->inBuffer);
 	if (conn->outBuffer)
@@ -2871,7 +2949,10 @@ closePGconn(PGconn *conn)
 	conn->status = CONNECTION_BAD;		/* Well, not really _bad_ - just
 										 * absent */
 	conn->asyncStatus = PGASYNC_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	pqClearAsyncResult(conn);	/* deallocate result and curTuple */
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	conn->cmd_queue_head = conn->cmd_queue_tail = NULL;
 	pg_freeaddrinfo_all(conn->addrlist_family, conn->addrlist);
 	conn->addrlist = NULL;
 	conn->addr_cur = NULL;
@@ -2898,6 +2979,7 @@ closePGconn(PGconn *conn)
 	conn->lobjfuncs = NULL;
 	conn->inStart = conn->inCursor = conn->inEnd = 0;
 	conn->outCount = 0;
+	pqEndCompression(conn);
 #ifdef ENABLE_GSS
 	{
 		OM_uint32	min_s;
@@ -38,7 +38,11 @@ char	   *const pgresStatus[] = {
 	"PGRES_BAD_RESPONSE",
 	"PGRES_NONFATAL_ERROR",
 	"PGRES_FATAL_ERROR",
-	"PGRES_COPY_BOTH"
+	"PGRES_COPY_BOTH",
+	"PGRES_PIPELINE_SYNC",
+	"PGRES_PIPELINE_ABORTED",
+	"PGRES_SINGLE_TUPLE",
+	"PGRES_TUPLES_CHUNK"
 };
 
 /*
@@ -51,6 +55,13 @@ static bool static_std_strings = false;
 
 static PGEvent *dupEvents(PGEvent *events, int count);
 static bool PQsendQueryStart(PGconn *conn);
+static PGcmdQueueEntry *pqAllocCmdQueueEntry(PGconn *conn);
+static void pqAppendCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry);
+static void pqRecycleCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry);
+static void pqCommandQueueAdvance(PGconn *conn);
+static void pqPipelineProcessQueue(PGconn *conn);
+static int pqLaunchCommand(PGconn *conn, PGcmdQueueEntry *entry,
+				PGQueryClass queryclass, const char *query);
 static int PQsendQueryGuts(PGconn *conn,
 				const char *command,
 				const char *stmtName,
@@ -176,6 +187,10 @@ PQmakeEmptyPGresult(PGconn *conn, ExecStatusType status)
 			case PGRES_COPY_OUT:
 			case PGRES_COPY_IN:
 			case PGRES_COPY_BOTH:
+			case PGRES_PIPELINE_SYNC:
+			case PGRES_PIPELINE_ABORTED:
+			case PGRES_SINGLE_TUPLE:
+			case PGRES_TUPLES_CHUNK:
 				/* non-error cases */
 				break;
 			default:
@@ -702,6 +717,36 @@ pqClearAsyncResult(PGconn *conn)
 		PQclear(conn->result);
 	conn->result = NULL;
 	conn->curTuple = NULL;
+	if (conn->saved_result)
+		PQclear(conn->saved_result);
+	conn->saved_result = NULL;
+}
+
+/*
+ * pqSaveRowDescription
+ *		In partial-result mode, set up to hand out the rows of the result
+ *		whose row description was just read into conn->result
+ *
+ * The row description is kept in conn->saved_result, and conn->result is
+ * replaced by an empty copy of it, to collect the first rows.  Returns 0
+ * if OK, EOF if out of memory (conn->result is then left alone).
+ */
+int
+pqSaveRowDescription(PGconn *conn)
+{
+	PGresult   *res;
+
+	res = PQcopyResult(conn->result,
+					   PG_COPYRES_ATTRS | PG_COPYRES_EVENTS |
+					   PG_COPYRES_NOTICEHOOKS);
+	if (!res)
+		return EOF;
+
+	if (conn->saved_result)
+		PQclear(conn->saved_result);
+	conn->saved_result = conn->result;
+	conn->result = res;
+	return 0;
 }
 
 /*
@@ -991,6 +1036,14 @@ PQsendQuery(PGconn *conn, const char *query)
 	if (!PQsendQueryStart(conn))
 		return 0;
 
+	/* The simple Query protocol implies a Sync, so it can't be pipelined */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+				 libpq_gettext("PQsendQuery not allowed in pipeline mode\n"));
+		return 0;
+	}
+
 	if (!query)
 	{
 		printfPQExpBuffer(&conn->errorMessage,
@@ -1078,6 +1131,8 @@ PQsendPrepare(PGconn *conn,
 			  const char *stmtName, const char *query,
 			  int nParams, const Oid *paramTypes)
 {
+	PGcmdQueueEntry *entry = NULL;
+
 	if (!PQsendQueryStart(conn))
 		return 0;
 
@@ -1103,6 +1158,14 @@ PQsendPrepare(PGconn *conn,
 		return 0;
 	}
 
+	/* in pipeline mode, make sure we'll be able to queue the command */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		entry = pqAllocCmdQueueEntry(conn);
+		if (entry == NULL)
+			return 0;			/* error msg already set */
+	}
+
 	/* construct the Parse message */
 	if (pqPutMsgStart('P', false, conn) < 0 ||
 		pqPuts(stmtName, conn) < 0 ||
@@ -1129,32 +1192,20 @@ PQsendPrepare(PGconn *conn,
 	if (pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless pipelining */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are doing just a Parse */
-	conn->queryclass = PGQUERY_PREPARE;
-
-	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	conn->last_query = strdup(query);
-
-	/*
-	 * Give the data a push.  In nonblock mode, don't complain if we're unable
-	 * to send it all; PQgetResult() will do any additional flushing needed.
-	 */
-	if (pqFlush(conn) < 0)
+	/* remember we are doing just a Parse, and send it off */
+	if (!pqLaunchCommand(conn, entry, PGQUERY_PREPARE, query))
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	pqHandleSendFailure(conn);
 	return 0;
 }
@@ -1213,22 +1264,271 @@ PQsendQueryStart(PGconn *conn)
 						  libpq_gettext("no connection to the server\n"));
 		return false;
 	}
-	/* Can't send while already busy, either. */
-	if (conn->asyncStatus != PGASYNC_IDLE)
+	/* Can't send while already busy, either, unless pipelining. */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
 	{
-		printfPQExpBuffer(&conn->errorMessage,
+		if (conn->asyncStatus != PGASYNC_IDLE)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
 				  libpq_gettext("another command is already in progress\n"));
-		return false;
-	}
+			return false;
+		}
 
-	/* initialize async result-accumulation state */
-	conn->result = NULL;
-	conn->curTuple = NULL;
+		/* initialize async result-accumulation state */
+		conn->result = NULL;
+		conn->curTuple = NULL;
+		conn->partialResMode = false;
+		conn->singleRowMode = false;
+		conn->maxChunkSize = 0;
+	}
+	else
+	{
+		/*
+		 * In pipeline mode the new command is queued behind the ones whose
+		 * results are still being collected, so the async result state must
+		 * be left alone.  Commands can't be queued while in COPY, though.
+		 */
+		if (conn->asyncStatus == PGASYNC_COPY_IN ||
+			conn->asyncStatus == PGASYNC_COPY_OUT ||
+			conn->asyncStatus == PGASYNC_COPY_BOTH)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+					   libpq_gettext("cannot queue commands during COPY\n"));
+			return false;
+		}
+	}
 
 	/* ready to send command message */
 	return true;
 }
 
+/*
+ * pqAllocCmdQueueEntry
+ *		Get a pending-command queue entry, for use in pipeline mode
+ *
+ * The entry is not linked into the queue yet; that's done by
+ * pqAppendCmdQueueEntry once the command has been sent.  Returns NULL,
+ * with conn->errorMessage set, if out of memory.
+ */
+static PGcmdQueueEntry *
+pqAllocCmdQueueEntry(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (conn->cmd_queue_recycle == NULL)
+	{
+		entry = (PGcmdQueueEntry *) malloc(sizeof(PGcmdQueueEntry));
+		if (entry == NULL)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+			return NULL;
+		}
+	}
+	else
+	{
+		entry = conn->cmd_queue_recycle;
+		conn->cmd_queue_recycle = entry->next;
+	}
+	entry->next = NULL;
+	entry->query = NULL;
+
+	return entry;
+}
+
+/*
+ * pqAppendCmdQueueEntry
+ *		Add a sent command to the tail of the pending-command queue
+ *
+ * If nothing was being processed, the command becomes the current one.
+ */
+static void
+pqAppendCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry)
+{
+	entry->next = NULL;
+	if (conn->cmd_queue_head == NULL)
+		conn->cmd_queue_head = entry;
+	else
+		conn->cmd_queue_tail->next = entry;
+	conn->cmd_queue_tail = entry;
+
+	if (conn->asyncStatus == PGASYNC_IDLE)
+		pqPipelineProcessQueue(conn);
+}
+
+/*
+ * pqRecycleCmdQueueEntry
+ *		Put an unlinked queue entry on the recycle list; NULL is ignored
+ */
+static void
+pqRecycleCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry)
+{
+	if (entry == NULL)
+		return;
+
+	if (entry->query)
+	{
+		free(entry->query);
+		entry->query = NULL;
+	}
+	entry->next = conn->cmd_queue_recycle;
+	conn->cmd_queue_recycle = entry;
+}
+
+/*
+ * pqFreeCommandQueue
+ *		Free all the entries of a command queue list
+ */
+void
+pqFreeCommandQueue(PGcmdQueueEntry *queue)
+{
+	while (queue != NULL)
+	{
+		PGcmdQueueEntry *cur = queue;
+
+		queue = cur->next;
+		if (cur->query)
+			free(cur->query);
+		free(cur);
+	}
+}
+
+/*
+ * pqCommandQueueAdvance
+ *		Remove the current command from the pending-command queue, once all
+ *		its results have been handed out
+ */
+static void
+pqCommandQueueAdvance(PGconn *conn)
+{
+	PGcmdQueueEntry *prevquery;
+
+	if (conn->cmd_queue_head == NULL)
+		return;
+
+	prevquery = conn->cmd_queue_head;
+	conn->cmd_queue_head = prevquery->next;
+	if (conn->cmd_queue_head == NULL)
+		conn->cmd_queue_tail = NULL;
+
+	prevquery->next = NULL;
+	pqRecycleCmdQueueEntry(conn, prevquery);
+}
+
+/*
+ * pqPipelineProcessQueue
+ *		In pipeline mode, start processing the next queued command, if the
+ *		previous one is done with
+ *
+ * The command at the head of the queue becomes the current one: its query
+ * class and text are set up for the protocol code, and parsing of the
+ * server's messages may resume.  If the pipeline is aborted, the server
+ * will skip every command up to the next Sync without responding, so we
+ * just produce a PGRES_PIPELINE_ABORTED result for the command.  With an
+ * empty queue, we become fully idle.
+ */
+static void
+pqPipelineProcessQueue(PGconn *conn)
+{
+	switch (conn->asyncStatus)
+	{
+		case PGASYNC_COPY_IN:
+		case PGASYNC_COPY_OUT:
+		case PGASYNC_COPY_BOTH:
+		case PGASYNC_READY:
+		case PGASYNC_READY_MORE:
+		case PGASYNC_BUSY:
+			/* the current command isn't done yet */
+			return;
+		case PGASYNC_IDLE:
+		case PGASYNC_PIPELINE_IDLE:
+			break;
+	}
+
+	if (conn->cmd_queue_head == NULL)
+	{
+		conn->asyncStatus = PGASYNC_IDLE;
+		return;
+	}
+
+	/* initialize async result-accumulation state */
+	pqClearAsyncResult(conn);
+	conn->partialResMode = false;
+	conn->singleRowMode = false;
+	conn->maxChunkSize = 0;
+
+	/* make the command current; its query text moves to last_query */
+	conn->queryclass = conn->cmd_queue_head->queryclass;
+	if (conn->last_query)
+		free(conn->last_query);
+	conn->last_query = conn->cmd_queue_head->query;
+	conn->cmd_queue_head->query = NULL;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_ABORTED &&
+		conn->queryclass != PGQUERY_SYNC)
+	{
+		conn->result = PQmakeEmptyPGresult(conn, PGRES_PIPELINE_ABORTED);
+		if (conn->result == NULL)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+			pqSaveErrorResult(conn);
+		}
+		conn->asyncStatus = PGASYNC_READY;
+		return;
+	}
+
+	/* allow parsing of the command's results to proceed */
+	conn->asyncStatus = PGASYNC_BUSY;
+}
+
+/*
+ * pqLaunchCommand
+ *		Common code to finish sending an extended-protocol command, once
+ *		its messages (including the Sync, if any) are in the output buffer
+ *
+ * Outside pipeline mode, remember the query class and text, push the data
+ * out, and wait for results.  In pipeline mode, entry (which the caller got
+ * from pqAllocCmdQueueEntry before emitting any message) is filled in and
+ * queued, and we don't flush: pqPutMsgEnd already sends full blocks as they
+ * pile up, and the rest goes out with PQpipelineSync, PQsendFlushRequest,
+ * PQflush or PQgetResult.
+ *
+ * Returns 1 on success, 0 if the data couldn't be sent.
+ */
+static int
+pqLaunchCommand(PGconn *conn, PGcmdQueueEntry *entry,
+				PGQueryClass queryclass, const char *query)
+{
+	if (entry != NULL)
+	{
+		entry->queryclass = queryclass;
+		/* if insufficient memory, query just winds up NULL */
+		entry->query = query ? strdup(query) : NULL;
+		pqAppendCmdQueueEntry(conn, entry);
+		return 1;
+	}
+
+	conn->queryclass = queryclass;
+
+	/* remember the query text too, if possible */
+	/* if insufficient memory, last_query just winds up NULL */
+	if (conn->last_query)
+		free(conn->last_query);
+	conn->last_query = query ? strdup(query) : NULL;
+
+	/*
+	 * Give the data a push.  In nonblock mode, don't complain if we're unable
+	 * to send it all; PQgetResult() will do any additional flushing needed.
+	 */
+	if (pqFlush(conn) < 0)
+		return 0;
+
+	/* OK, it's launched! */
+	conn->asyncStatus = PGASYNC_BUSY;
+	return 1;
+}
+
 /*
  * PQsendQueryGuts
  *		Common code for protocol-3.0 query sending
@@ -1248,6 +1548,7 @@ PQsendQueryGuts(PGconn *conn,
 				int resultFormat)
 {
 	int			i;
+	PGcmdQueueEntry *entry = NULL;
 
 	/* This isn't gonna work on a 2.0 server */
 	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
@@ -1257,9 +1558,18 @@ PQsendQueryGuts(PGconn *conn,
 		return 0;
 	}
 
+	/* in pipeline mode, make sure we'll be able to queue the command */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		entry = pqAllocCmdQueueEntry(conn);
+		if (entry == NULL)
+			return 0;			/* error msg already set */
+	}
+
 	/*
 	 * We will send Parse (if needed), Bind, Describe Portal, Execute, Sync,
-	 * using specified statement name and the unnamed portal.
+	 * using specified statement name and the unnamed portal.  In pipeline
+	 * mode the Sync is left out; PQpipelineSync sends it.
 	 */
 
 	if (command)
@@ -1369,35 +1679,20 @@ PQsendQueryGuts(PGconn *conn,
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless pipelining */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are using extended query protocol */
-	conn->queryclass = PGQUERY_EXTENDED;
-
-	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	if (command)
-		conn->last_query = strdup(command);
-	else
-		conn->last_query = NULL;
-
-	/*
-	 * Give the data a push.  In nonblock mode, don't complain if we're unable
-	 * to send it all; PQgetResult() will do any additional flushing needed.
-	 */
-	if (pqFlush(conn) < 0)
+	/* remember we are using extended query protocol, and send it off */
+	if (!pqLaunchCommand(conn, entry, PGQUERY_EXTENDED, command))
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	pqHandleSendFailure(conn);
 	return 0;
 }
@@ -1557,11 +1852,60 @@ PQgetResult(PGconn *conn)
 		case PGASYNC_IDLE:
 			res = NULL;			/* query is complete */
 			break;
-		case PGASYNC_READY:
+		case PGASYNC_PIPELINE_IDLE:
+
+			/*
+			 * This NULL terminates the results of the previous command in a
+			 * pipeline; get ready to return those of the next one.
+			 */
+			pqPipelineProcessQueue(conn);
+			res = NULL;
+			break;
+		case PGASYNC_READY_MORE:
 			res = pqPrepareAsyncResult(conn);
+
+			/* Start collecting the following rows in a fresh result */
+			conn->result = PQcopyResult(conn->saved_result,
+										PG_COPYRES_ATTRS | PG_COPYRES_EVENTS |
+										PG_COPYRES_NOTICEHOOKS);
+			if (!conn->result)
+			{
+				/* the remaining rows will be discarded */
+				printfPQExpBuffer(&conn->errorMessage,
+							libpq_gettext("out of memory for query result\n"));
+				pqSaveErrorResult(conn);
+			}
 			/* Set the state back to BUSY, allowing parsing to proceed. */
 			conn->asyncStatus = PGASYNC_BUSY;
 			break;
+		case PGASYNC_READY:
+			res = pqPrepareAsyncResult(conn);
+			/* The row description isn't needed anymore */
+			if (conn->saved_result)
+			{
+				PQclear(conn->saved_result);
+				conn->saved_result = NULL;
+			}
+			if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+			{
+				/*
+				 * In pipeline mode a command has a single result, so that
+				 * command is done with.  Its results are terminated by a NULL
+				 * as usual, except after a pipeline sync result, which has no
+				 * terminating NULL: for that one, move on to the next command
+				 * at once.
+				 */
+				pqCommandQueueAdvance(conn);
+				conn->asyncStatus = PGASYNC_PIPELINE_IDLE;
+				if (res && res->resultStatus == PGRES_PIPELINE_SYNC)
+					pqPipelineProcessQueue(conn);
+			}
+			else
+			{
+				/* Set the state back to BUSY, allowing parsing to proceed. */
+				conn->asyncStatus = PGASYNC_BUSY;
+			}
+			break;
 		case PGASYNC_COPY_IN:
 			if (conn->result && conn->result->resultStatus == PGRES_COPY_IN)
 				res = pqPrepareAsyncResult(conn);
@@ -1616,6 +1960,68 @@ PQgetResult(PGconn *conn)
 }
 
 
+/*
+ * PQsetSingleRowMode
+ *	  Set the current command to return its rows one at a time
+ *
+ * This must be called just after a successful PQsendQuery or sibling,
+ * before any result of the command has been received; in pipeline mode,
+ * it applies to the command whose results are to be read next.  Each row
+ * is then returned by PQgetResult as a separate PGresult of status
+ * PGRES_SINGLE_TUPLE, and the end of the row set is signaled by a
+ * zero-row PGRES_TUPLES_OK result, so that client memory stays bounded
+ * however big the result set is.
+ *
+ * Returns 1 on success, 0 if the mode can't be selected now.
+ */
+int
+PQsetSingleRowMode(PGconn *conn)
+{
+	if (!PQsetChunkedRowsMode(conn, 1))
+		return 0;
+	conn->singleRowMode = true;
+	return 1;
+}
+
+/*
+ * PQsetChunkedRowsMode
+ *	  Set the current command to return its rows in chunks
+ *
+ * Like PQsetSingleRowMode, except that up to chunkSize rows are returned
+ * in each PGresult, which then has status PGRES_TUPLES_CHUNK.  That saves
+ * most of the per-result overhead of single-row mode.
+ *
+ * Returns 1 on success, 0 if the mode can't be selected now.
+ */
+int
+PQsetChunkedRowsMode(PGconn *conn, int chunkSize)
+{
+	/*
+	 * Only allow setting the mode when we have launched a query and not yet
+	 * received any results.
+	 */
+	if (!conn)
+		return 0;
+	if (chunkSize <= 0)
+		return 0;
+	/* The row handling this requires is only done for protocol 3.0 */
+	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
+		return 0;
+	if (conn->asyncStatus != PGASYNC_BUSY)
+		return 0;
+	if (conn->queryclass != PGQUERY_SIMPLE &&
+		conn->queryclass != PGQUERY_EXTENDED)
+		return 0;
+	if (conn->result)
+		return 0;
+
+	/* OK, set mode */
+	conn->partialResMode = true;
+	conn->singleRowMode = false;
+	conn->maxChunkSize = chunkSize;
+	return 1;
+}
+
 /*
  * PQexec
  *	  send a query to the backend and package up the result in a PGresult
@@ -1717,6 +2123,13 @@ PQexecStart(PGconn *conn)
 	if (!conn)
 		return false;
 
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("synchronous command execution functions are not allowed in pipeline mode\n"));
+		return false;
+	}
+
 	/*
 	 * Silently discard any prior query result that application didn't eat.
 	 * This is probably poor design, but it's here for backward compatibility.
@@ -1911,6 +2324,8 @@ PQsendDescribePortal(PGconn *conn, const char *portal)
 static int
 PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 {
+	PGcmdQueueEntry *entry = NULL;
+
 	/* Treat null desc_target as empty string */
 	if (!desc_target)
 		desc_target = "";
@@ -1926,6 +2341,14 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		return 0;
 	}
 
+	/* in pipeline mode, make sure we'll be able to queue the command */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		entry = pqAllocCmdQueueEntry(conn);
+		if (entry == NULL)
+			return 0;			/* error msg already set */
+	}
+
 	/* construct the Describe message */
 	if (pqPutMsgStart('D', false, conn) < 0 ||
 		pqPutc(desc_type, conn) < 0 ||
@@ -1933,21 +2356,205 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless pipelining */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are doing a Describe */
-	conn->queryclass = PGQUERY_DESCRIBE;
+	/* remember we are doing a Describe (last-query string isn't relevant) */
+	if (!pqLaunchCommand(conn, entry, PGQUERY_DESCRIBE, NULL))
+		goto sendFailed;
 
-	/* reset last-query string (not relevant now) */
-	if (conn->last_query)
+	return 1;
+
+sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
+	pqHandleSendFailure(conn);
+	return 0;
+}
+
+/*
+ * PQenterPipelineMode
+ *		Put an idle connection in pipeline mode.
+ *
+ * Returns 1 on success.  On failure, errorMessage is set and 0 is returned.
+ *
+ * Commands submitted after this can be pipelined on the connection;
+ * there's no requirement to wait for one to finish before the next is
+ * dispatched.
+ *
+ * Queuing of a new query or syncing during COPY is not allowed.
+ *
+ * A set of commands is terminated by a PQpipelineSync.  Multiple sync
+ * points can be established while in pipeline mode.  Pipeline mode can
+ * be exited by calling PQexitPipelineMode() once all results are processed.
+ *
+ * This doesn't actually send anything on the wire, it just puts libpq
+ * into a state where it can pipeline work.
+ */
+int
+PQenterPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	/* succeed with no action if already in pipeline mode */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+		return 1;
+
+	/* Pipelining requires the extended query protocol */
+	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
 	{
-		free(conn->last_query);
-		conn->last_query = NULL;
+		printfPQExpBuffer(&conn->errorMessage,
+		 libpq_gettext("function requires at least protocol version 3.0\n"));
+		return 0;
+	}
+
+	if (conn->asyncStatus != PGASYNC_IDLE)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot enter pipeline mode, connection not idle\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_ON;
+
+	return 1;
+}
+
+/*
+ * PQexitPipelineMode
+ *		End pipeline mode and return to normal command mode.
+ *
+ * Returns 1 in success (pipeline mode successfully ended, or not in pipeline
+ * mode).
+ *
+ * Returns 0 if in pipeline mode and cannot be ended yet.  Error message will
+ * be set.
+ */
+int
+PQexitPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+		return 1;
+
+	switch (conn->asyncStatus)
+	{
+		case PGASYNC_READY:
+		case PGASYNC_READY_MORE:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot exit pipeline mode with uncollected results\n"));
+			return 0;
+
+		case PGASYNC_BUSY:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot exit pipeline mode while busy\n"));
+			return 0;
+
+		case PGASYNC_COPY_IN:
+		case PGASYNC_COPY_OUT:
+		case PGASYNC_COPY_BOTH:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot exit pipeline mode while in COPY\n"));
+			return 0;
+
+		case PGASYNC_IDLE:
+		case PGASYNC_PIPELINE_IDLE:
+			/* OK */
+			break;
+	}
+
+	/* still work to process */
+	if (conn->cmd_queue_head != NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot exit pipeline mode with uncollected results\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
+	conn->asyncStatus = PGASYNC_IDLE;
+
+	/* Flush any pending data in out buffer */
+	if (pqFlush(conn) < 0)
+		return 0;				/* error message is setup already */
+	return 1;
+}
+
+/*
+ * PQpipelineStatus
+ *		Report the pipeline mode status of the connection.
+ */
+PGpipelineStatus
+PQpipelineStatus(const PGconn *conn)
+{
+	if (!conn)
+		return PQ_PIPELINE_OFF;
+
+	return conn->pipelineStatus;
+}
+
+/*
+ * PQpipelineSync
+ *		Send a Sync message as part of a pipeline, and flush to server
+ *
+ * It's legal to start submitting more commands in the pipeline immediately,
+ * without waiting for the results of the current pipeline.  There's no need
+ * to end pipeline mode and start it again.
+ *
+ * If a command in a pipeline fails, every subsequent command up to and
+ * including the result to the Sync message sent by PQpipelineSync gets set
+ * to PGRES_PIPELINE_ABORTED state.  If the whole pipeline is processed
+ * without error, a PGresult with PGRES_PIPELINE_SYNC is produced.
+ *
+ * Queries can already have been sent before PQpipelineSync is called, but
+ * PQpipelineSync needs to be called before retrieving command results.
+ *
+ * The connection will remain in pipeline mode and unavailable for new
+ * synchronous command execution functions until all results from the
+ * pipeline are processed by the client.
+ */
+int
+PQpipelineSync(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot send pipeline when not in pipeline mode\n"));
+		return 0;
+	}
+
+	switch (conn->asyncStatus)
+	{
+		case PGASYNC_COPY_IN:
+		case PGASYNC_COPY_OUT:
+		case PGASYNC_COPY_BOTH:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot send pipeline while in COPY\n"));
+			return 0;
+		default:
+			/* OK to send sync */
+			break;
 	}
 
+	entry = pqAllocCmdQueueEntry(conn);
+	if (entry == NULL)
+		return 0;				/* error msg already set */
+
+	/* construct the Sync message */
+	if (pqPutMsgStart('S', false, conn) < 0 ||
+		pqPutMsgEnd(conn) < 0)
+		goto sendFailed;
+
 	/*
 	 * Give the data a push.  In nonblock mode, don't complain if we're unable
 	 * to send it all; PQgetResult() will do any additional flushing needed.
@@ -1955,15 +2562,67 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 	if (pqFlush(conn) < 0)
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	entry->queryclass = PGQUERY_SYNC;
+	pqAppendCmdQueueEntry(conn, entry);
+
 	return 1;
 
 sendFailed:
-	pqHandleSendFailure(conn);
+	pqRecycleCmdQueueEntry(conn, entry);
+	/* error message should be set up already */
 	return 0;
 }
 
+/*
+ * PQsendFlushRequest
+ *		Send a Flush message, asking the server to send out the results it
+ *		has accumulated so far, without establishing a sync point
+ *
+ * Returns 1 on success and 0 on failure.
+ */
+int
+PQsendFlushRequest(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	/* Don't try to send if we know there's no live connection. */
+	if (conn->status != CONNECTION_OK)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("no connection to the server\n"));
+		return 0;
+	}
+
+	/* Can't send while in COPY */
+	if (conn->asyncStatus == PGASYNC_COPY_IN ||
+		conn->asyncStatus == PGASYNC_COPY_OUT ||
+		conn->asyncStatus == PGASYNC_COPY_BOTH)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot send flush request while in COPY\n"));
+		return 0;
+	}
+
+	/* This isn't gonna work on a 2.0 server */
+	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+		 libpq_gettext("function requires at least protocol version 3.0\n"));
+		return 0;
+	}
+
+	if (pqPutMsgStart('H', false, conn) < 0 ||
+		pqPutMsgEnd(conn) < 0)
+		return 0;
+
+	/* Give the data a push, as for PQpipelineSync */
+	if (pqFlush(conn) < 0)
+		return 0;
+
+	return 1;
+}
+
 /*
  * PQnotifies
  *	  returns a PGnotify* structure of the latest async notification
@@ -2360,6 +3019,13 @@ PQfn(PGconn *conn,
 		return NULL;
 	}
 
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+				  libpq_gettext("PQfn not allowed in pipeline mode\n"));
+		return NULL;
+	}
+
 	if (PG_PROTOCOL_MAJOR(conn->pversion) >= 3)
 		return pqFunctionCall3(conn, fnid,
 							   result_buf, actual_result_len,
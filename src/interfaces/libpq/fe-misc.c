@@ -60,8 +60,15 @@
 #include "pg_config_paths.h"
 
 
+/* size of the buffers for compressed data */
+#define PQ_ZBUFFER_SIZE 16384
+
 static int	pqPutMsgBytes(const void *buf, size_t len, PGconn *conn);
 static int	pqSendSome(PGconn *conn, int len);
+static int	pqRecvSome(PGconn *conn, char *ptr, int len);
+static int	pqSendBytes(PGconn *conn, const char *ptr, int len);
+static bool pqCompressedInputPending(PGconn *conn);
+static bool pqCompressedOutputPending(PGconn *conn);
 static int pqSocketCheck(PGconn *conn, int forRead, int forWrite,
 			  time_t end_time);
 static int	pqSocketPoll(int sock, int forRead, int forWrite, time_t end_time);
@@ -626,8 +633,8 @@ pqReadData(PGconn *conn)
 
 	/* OK, try to read some data */
 retry3:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqRecvSome(conn, conn->inBuffer + conn->inEnd,
+					   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -671,6 +678,19 @@ retry3:
 			someread = 1;
 			goto retry3;
 		}
+
+		/*
+		 * Don't leave compressed data behind: nobody waiting for the socket
+		 * to become readable would know it is there.
+		 */
+		if (pqCompressedInputPending(conn))
+		{
+			if (conn->inBufSize - conn->inEnd < 8192 &&
+				pqCheckInBufferSpace(conn->inEnd + (size_t) 8192, conn))
+				return -1;		/* errorMessage already set */
+			someread = 1;
+			goto retry3;
+		}
 		return 1;
 	}
 
@@ -719,8 +739,8 @@ retry3:
 	 * arrived.
 	 */
 retry4:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqRecvSome(conn, conn->inBuffer + conn->inEnd,
+					   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -745,6 +765,14 @@ retry4:
 	if (nread > 0)
 	{
 		conn->inEnd += nread;
+		if (pqCompressedInputPending(conn))
+		{
+			if (conn->inBufSize - conn->inEnd < 8192 &&
+				pqCheckInBufferSpace(conn->inEnd + (size_t) 8192, conn))
+				return -1;		/* errorMessage already set */
+			someread = 1;
+			goto retry3;
+		}
 		return 1;
 	}
 
@@ -786,12 +814,12 @@ pqSendSome(PGconn *conn, int len)
 	}
 
 	/* while there's still data to send */
-	while (len > 0)
+	while (len > 0 || pqCompressedOutputPending(conn))
 	{
 		int			sent;
 
 #ifndef WIN32
-		sent = pqsecure_write(conn, ptr, len);
+		sent = pqSendBytes(conn, ptr, len);
 #else
 
 		/*
@@ -799,7 +827,7 @@ pqSendSome(PGconn *conn, int len)
 		 * failure-point appears to be different in different versions of
 		 * Windows, but 64k should always be safe.
 		 */
-		sent = pqsecure_write(conn, ptr, Min(len, 65536));
+		sent = pqSendBytes(conn, ptr, Min(len, 65536));
 #endif
 
 		if (sent < 0)
@@ -840,7 +868,7 @@ pqSendSome(PGconn *conn, int len)
 			remaining -= sent;
 		}
 
-		if (len > 0)
+		if (len > 0 || pqCompressedOutputPending(conn))
 		{
 			/*
 			 * We didn't send it all, wait till we can send more.
@@ -900,13 +928,227 @@ pqFlush(PGconn *conn)
 	if (conn->Pfdebug)
 		fflush(conn->Pfdebug);
 
-	if (conn->outCount > 0)
+	if (conn->outCount > 0 || pqCompressedOutputPending(conn))
 		return pqSendSome(conn, conn->outCount);
 
 	return 0;
 }
 
 
+/*
+ * pqRecvSome: read data from the server into ptr, inflating it if the
+ * connection is compressed.
+ *
+ * Returns the number of bytes stored, 0 on EOF, or -1 with errno set; like
+ * pqsecure_read, it sets errorMessage for any error but EAGAIN, EWOULDBLOCK
+ * and EINTR.
+ */
+static int
+pqRecvSome(PGconn *conn, char *ptr, int len)
+{
+#ifdef HAVE_LIBZ
+	if (conn->zin != NULL)
+	{
+		z_stream   *zs = conn->zin;
+
+		for (;;)
+		{
+			int			rc;
+			int			nread;
+
+			/*
+			 * Inflate whatever is buffered, even if that is nothing: zlib may
+			 * still hold output that did not fit last time.
+			 */
+			zs->next_in = (Bytef *) (conn->zinBuffer + conn->zinStart);
+			zs->avail_in = conn->zinEnd - conn->zinStart;
+			zs->next_out = (Bytef *) ptr;
+			zs->avail_out = len;
+			rc = inflate(zs, Z_SYNC_FLUSH);
+			conn->zinStart = conn->zinEnd - zs->avail_in;
+			conn->zinFull = (zs->avail_out == 0);
+			if (rc != Z_OK && rc != Z_BUF_ERROR)
+			{
+				printfPQExpBuffer(&conn->errorMessage,
+					libpq_gettext("could not decompress data from server: %s\n"),
+								  zs->msg ? zs->msg : "unexpected end of stream");
+				SOCK_ERRNO_SET(0);
+				return -1;
+			}
+			if (zs->avail_out < (uInt) len)
+				return len - zs->avail_out;
+
+			/* No output means all the input was used up; read some more */
+			nread = pqsecure_read(conn, conn->zinBuffer, conn->zinBufSize);
+			if (nread <= 0)
+				return nread;
+			conn->zinStart = 0;
+			conn->zinEnd = nread;
+		}
+	}
+#endif
+	return pqsecure_read(conn, ptr, len);
+}
+
+/*
+ * pqSendBytes: send len bytes at ptr to the server, deflating them if the
+ * connection is compressed.
+ *
+ * Returns the number of bytes consumed, or -1 with errno set; like
+ * pqsecure_write, it sets errorMessage for any error but EAGAIN, EWOULDBLOCK
+ * and EINTR.  On a compressed connection the bytes consumed may still be
+ * waiting to go out; pqCompressedOutputPending() tells whether any are.
+ */
+static int
+pqSendBytes(PGconn *conn, const char *ptr, int len)
+{
+#ifdef HAVE_LIBZ
+	if (conn->zout != NULL)
+	{
+		z_stream   *zs = conn->zout;
+		int			consumed = 0;
+
+		/* Compress as much as there is room for */
+		if (conn->zoutEnd < PQ_ZBUFFER_SIZE && (len > 0 || !conn->zoutFlushed))
+		{
+			zs->next_in = (Bytef *) ptr;
+			zs->avail_in = len;
+			zs->next_out = (Bytef *) (conn->zoutBuffer + conn->zoutEnd);
+			zs->avail_out = PQ_ZBUFFER_SIZE - conn->zoutEnd;
+			(void) deflate(zs, Z_SYNC_FLUSH);
+			consumed = len - zs->avail_in;
+			conn->zoutEnd = PQ_ZBUFFER_SIZE - zs->avail_out;
+
+			/* If the output space ran out, deflate() must be called again */
+			conn->zoutFlushed = (zs->avail_in == 0 && zs->avail_out > 0);
+		}
+
+		if (conn->zoutStart < conn->zoutEnd)
+		{
+			int			sent;
+
+			sent = pqsecure_write(conn, conn->zoutBuffer + conn->zoutStart,
+								  conn->zoutEnd - conn->zoutStart);
+			if (sent < 0)
+				return consumed > 0 ? consumed : -1;
+			conn->zoutStart += sent;
+			if (conn->zoutStart == conn->zoutEnd)
+				conn->zoutStart = conn->zoutEnd = 0;
+		}
+
+		return consumed;
+	}
+#endif
+	return pqsecure_write(conn, ptr, len);
+}
+
+/*
+ * Is there received data that has been read from the socket but not yet
+ * inflated?
+ */
+static bool
+pqCompressedInputPending(PGconn *conn)
+{
+#ifdef HAVE_LIBZ
+	if (conn->zin != NULL)
+		return conn->zinStart < conn->zinEnd || conn->zinFull;
+#endif
+	return false;
+}
+
+/*
+ * Is there data that has been taken from outBuffer but not yet sent?
+ */
+static bool
+pqCompressedOutputPending(PGconn *conn)
+{
+#ifdef HAVE_LIBZ
+	if (conn->zout != NULL)
+		return conn->zoutStart < conn->zoutEnd || !conn->zoutFlushed;
+#endif
+	return false;
+}
+
+/*
+ * pqStartCompression: compress everything exchanged with the server from
+ * now on, at the given zlib level.
+ *
+ * Called when the server has accepted compression.  Anything already in
+ * inBuffer past inStart was sent after that, so it is compressed too.
+ * Returns 0 if OK, EOF (with errorMessage set) if trouble.
+ */
+int
+pqStartCompression(PGconn *conn, int level)
+{
+#ifdef HAVE_LIBZ
+	int			leftover = conn->inEnd - conn->inStart;
+
+	if (conn->zin != NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("server acknowledged compression twice\n"));
+		return EOF;
+	}
+
+	conn->zin = (z_stream *) calloc(1, sizeof(z_stream));
+	conn->zout = (z_stream *) calloc(1, sizeof(z_stream));
+	conn->zinBufSize = Max(PQ_ZBUFFER_SIZE, leftover);
+	conn->zinBuffer = (char *) malloc(conn->zinBufSize);
+	conn->zoutBuffer = (char *) malloc(PQ_ZBUFFER_SIZE);
+	if (conn->zin == NULL || conn->zout == NULL ||
+		conn->zinBuffer == NULL || conn->zoutBuffer == NULL ||
+		inflateInit(conn->zin) != Z_OK ||
+		deflateInit(conn->zout, level) != Z_OK)
+	{
+		pqEndCompression(conn);
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("out of memory\n"));
+		return EOF;
+	}
+
+	memcpy(conn->zinBuffer, conn->inBuffer + conn->inStart, leftover);
+	conn->zinStart = 0;
+	conn->zinEnd = leftover;
+	conn->zinFull = false;
+	conn->inStart = conn->inCursor = conn->inEnd = 0;
+	conn->zoutStart = conn->zoutEnd = 0;
+	conn->zoutFlushed = true;
+	return 0;
+#else
+	printfPQExpBuffer(&conn->errorMessage,
+					  libpq_gettext("compression is not supported by this build\n"));
+	return EOF;
+#endif
+}
+
+/*
+ * pqEndCompression: release the compression state, if any.
+ */
+void
+pqEndCompression(PGconn *conn)
+{
+#ifdef HAVE_LIBZ
+	/* these are harmless on a stream that was never initialized */
+	if (conn->zin)
+	{
+		inflateEnd(conn->zin);
+		free(conn->zin);
+	}
+	if (conn->zout)
+	{
+		deflateEnd(conn->zout);
+		free(conn->zout);
+	}
+	if (conn->zinBuffer)
+		free(conn->zinBuffer);
+	if (conn->zoutBuffer)
+		free(conn->zoutBuffer);
+	conn->zin = conn->zout = NULL;
+	conn->zinBuffer = conn->zoutBuffer = NULL;
+#endif
+}
+
+
 /*
  * pqWait: wait until we can read or write the connection socket
  *
@@ -1003,6 +1245,10 @@ pqSocketCheck(PGconn *conn, int forRead, int forWrite, time_t end_time)
 	}
 #endif
 
+	/* Likewise for received data not yet decompressed */
+	if (forRead && pqCompressedInputPending(conn))
+		return 1;
+
 	/* We will retry as long as we get EINTR */
 	do
 		result = pqSocketPoll(conn->sock, forRead, forWrite, end_time);
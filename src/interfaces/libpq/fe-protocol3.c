@@ -197,6 +197,22 @@ pqParseInput3(PGconn *conn)
 			switch (id)
 			{
 				case 'C':		/* command complete */
+
+					/*
+					 * In partial-result mode, hand out any rows collected so
+					 * far before completing the command; this message will
+					 * be processed again afterwards.
+					 */
+					if (conn->partialResMode && conn->saved_result &&
+						conn->result != NULL &&
+						conn->result->resultStatus == PGRES_TUPLES_OK &&
+						conn->result->ntups > 0)
+					{
+						conn->result->resultStatus = conn->singleRowMode ?
+							PGRES_SINGLE_TUPLE : PGRES_TUPLES_CHUNK;
+						conn->asyncStatus = PGASYNC_READY_MORE;
+						return;
+					}
 					if (pqGets(&conn->workBuffer, conn))
 						return;
 					if (conn->result == NULL)
@@ -213,12 +229,33 @@ pqParseInput3(PGconn *conn)
 				case 'E':		/* error return */
 					if (pqGetErrorNotice3(conn, true))
 						return;
+
+					/*
+					 * In pipeline mode, the server now skips all commands
+					 * until the next Sync.
+					 */
+					if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+						conn->pipelineStatus = PQ_PIPELINE_ABORTED;
 					conn->asyncStatus = PGASYNC_READY;
 					break;
 				case 'Z':		/* backend is ready for new query */
 					if (getReadyForQuery(conn))
 						return;
-					conn->asyncStatus = PGASYNC_IDLE;
+					if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+					{
+						/*
+						 * In pipeline mode, this ends the commands up to a
+						 * Sync; report that as a result of its own.
+						 */
+						conn->result = PQmakeEmptyPGresult(conn,
+													   PGRES_PIPELINE_SYNC);
+						if (!conn->result)
+							return;
+						conn->pipelineStatus = PQ_PIPELINE_ON;
+						conn->asyncStatus = PGASYNC_READY;
+					}
+					else
+						conn->asyncStatus = PGASYNC_IDLE;
 					break;
 				case 'I':		/* empty query */
 					if (conn->result == NULL)
@@ -538,6 +575,15 @@ getRowDescriptions(PGconn *conn)
 
 	/* Success! */
 	conn->result = result;
+
+	/*
+	 * In partial-result mode, keep the row description aside so that the
+	 * rows can be handed out in separate results.  If we can't, just go on
+	 * collecting them all in this result.
+	 */
+	if (conn->partialResMode && conn->queryclass != PGQUERY_DESCRIBE)
+		(void) pqSaveRowDescription(conn);
+
 	return 0;
 
 failure:
@@ -694,6 +740,18 @@ getAnotherTuple(PGconn *conn, int msgLength)
 	/* and reset for a new message */
 	conn->curTuple = NULL;
 
+	/*
+	 * In partial-result mode, hand out the rows once we have a full chunk.
+	 * Parsing stops until the application collects them.
+	 */
+	if (conn->partialResMode && conn->saved_result &&
+		result->ntups >= conn->maxChunkSize)
+	{
+		result->resultStatus = conn->singleRowMode ?
+			PGRES_SINGLE_TUPLE : PGRES_TUPLES_CHUNK;
+		conn->asyncStatus = PGASYNC_READY_MORE;
+	}
+
 	return 0;
 
 outOfMemory:
@@ -1923,6 +1981,8 @@ build_startup_packet(const PGconn *conn, char *packet,
 		ADD_STARTUP_OPTION("database", conn->dbName);
 	if (conn->replication && conn->replication[0])
 		ADD_STARTUP_OPTION("replication", conn->replication);
+	if (conn->compression && conn->compression[0] != '0')
+		ADD_STARTUP_OPTION("compression", conn->compression);
 	if (conn->pgoptions && conn->pgoptions[0])
 		ADD_STARTUP_OPTION("options", conn->pgoptions);
 	if (conn->send_appname)
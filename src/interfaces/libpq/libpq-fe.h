@@ -89,7 +89,12 @@ typedef enum
 								 * backend */
 	PGRES_NONFATAL_ERROR,		/* notice or warning message */
 	PGRES_FATAL_ERROR,			/* query failed */
-	PGRES_COPY_BOTH				/* Copy In/Out data transfer in progress */
+	PGRES_COPY_BOTH,			/* Copy In/Out data transfer in progress */
+	PGRES_PIPELINE_SYNC,		/* pipeline synchronization point */
+	PGRES_PIPELINE_ABORTED,		/* command didn't run because of an abort
+								 * earlier in a pipeline */
+	PGRES_SINGLE_TUPLE,			/* single tuple from larger resultset */
+	PGRES_TUPLES_CHUNK			/* chunk of tuples from larger resultset */
 } ExecStatusType;
 
 typedef enum
@@ -116,6 +121,15 @@ typedef enum
 	PQPING_NO_ATTEMPT			/* connection not attempted (bad params) */
 } PGPing;
 
+typedef enum
+{
+	PQ_PIPELINE_OFF,			/* not in pipeline mode */
+	PQ_PIPELINE_ON,				/* in pipeline mode */
+	PQ_PIPELINE_ABORTED			/* in pipeline mode, an error has occurred
+								 * and commands are skipped until the next
+								 * synchronization point */
+} PGpipelineStatus;
+
 /* PGconn encapsulates a connection to the backend.
  * The contents of this struct are not supposed to be known to applications.
  */
@@ -388,6 +402,8 @@ extern int PQsendQueryPrepared(PGconn *conn,
 					const int *paramFormats,
 					int resultFormat);
 extern PGresult *PQgetResult(PGconn *conn);
+extern int	PQsetSingleRowMode(PGconn *conn);
+extern int	PQsetChunkedRowsMode(PGconn *conn, int chunkSize);
 
 /* Routines for managing an asynchronous query */
 extern int	PQisBusy(PGconn *conn);
@@ -419,6 +435,13 @@ extern PGPing PQpingParams(const char *const * keywords,
 /* Force the write buffer to be written (or at least try) */
 extern int	PQflush(PGconn *conn);
 
+/* Routines for pipeline mode management */
+extern int	PQenterPipelineMode(PGconn *conn);
+extern int	PQexitPipelineMode(PGconn *conn);
+extern PGpipelineStatus PQpipelineStatus(const PGconn *conn);
+extern int	PQpipelineSync(PGconn *conn);
+extern int	PQsendFlushRequest(PGconn *conn);
+
 /*
  * "Fast path" interface --- not really recommended for application
  * use
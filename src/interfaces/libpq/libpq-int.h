@@ -82,6 +82,10 @@ typedef struct
 #endif
 #endif   /* USE_SSL */
 
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
 /*
  * POSTGRES backend dependent Constants.
  */
@@ -217,9 +221,12 @@ typedef enum
 	PGASYNC_IDLE,				/* nothing's happening, dude */
 	PGASYNC_BUSY,				/* query in progress */
 	PGASYNC_READY,				/* result ready for PQgetResult */
+	PGASYNC_READY_MORE,			/* partial result ready for PQgetResult, more
+								 * rows of the same result to come */
 	PGASYNC_COPY_IN,			/* Copy In data transfer in progress */
 	PGASYNC_COPY_OUT,			/* Copy Out data transfer in progress */
-	PGASYNC_COPY_BOTH			/* Copy In/Out data transfer in progress */
+	PGASYNC_COPY_BOTH,			/* Copy In/Out data transfer in progress */
+	PGASYNC_PIPELINE_IDLE		/* "Idle" between commands in pipeline mode */
 } PGAsyncStatusType;
 
 /* PGQueryClass tracks which query protocol we are now executing */
@@ -228,9 +235,22 @@ typedef enum
 	PGQUERY_SIMPLE,				/* simple Query protocol (PQexec) */
 	PGQUERY_EXTENDED,			/* full Extended protocol (PQexecParams) */
 	PGQUERY_PREPARE,			/* Parse only (PQprepare) */
-	PGQUERY_DESCRIBE			/* Describe Statement or Portal */
+	PGQUERY_DESCRIBE,			/* Describe Statement or Portal */
+	PGQUERY_SYNC				/* Sync (at end of a pipeline) */
 } PGQueryClass;
 
+/*
+ * An entry in the pending command queue, used in pipeline mode to remember
+ * the commands that have been sent but whose results haven't been fully
+ * collected yet.  Entries are kept in order of sending.
+ */
+typedef struct PGcmdQueueEntry
+{
+	PGQueryClass queryclass;	/* query type */
+	char	   *query;			/* SQL command, or NULL if none/unknown */
+	struct PGcmdQueueEntry *next;	/* list link */
+} PGcmdQueueEntry;
+
 /* PGSetenvStatusType defines the state of the PQSetenv state machine */
 /* (this is used only for 2.0-protocol connections) */
 typedef enum
@@ -301,6 +321,7 @@ struct pg_conn
 	char	   *fbappname;		/* fallback application name */
 	char	   *dbName;			/* database name */
 	char	   *replication;	/* connect as the replication standby? */
+	char	   *compression;	/* zlib level to ask for, or "0" */
 	char	   *pguser;			/* Postgres username and password, if any */
 	char	   *pgpass;
 	char	   *keepalives;		/* use TCP keepalives? */
@@ -338,6 +359,7 @@ struct pg_conn
 	PGTransactionStatusType xactStatus; /* never changes to ACTIVE */
 	PGQueryClass queryclass;
 	char	   *last_query;		/* last SQL command, or NULL if unknown */
+	PGpipelineStatus pipelineStatus;	/* status of pipeline mode */
 	char		last_sqlstate[6];		/* last reported SQLSTATE */
 	bool		options_valid;	/* true if OK to attempt connection */
 	bool		nonblocking;	/* whether this connection is using nonblock
@@ -396,10 +418,50 @@ struct pg_conn
 								 * msg has no length word */
 	int			outMsgEnd;		/* offset to msg end (so far) */
 
+#ifdef HAVE_LIBZ
+
+	/*
+	 * Once the server has accepted compression, inBuffer and outBuffer hold
+	 * uncompressed data, and these hold it compressed, on its way from or to
+	 * the socket.
+	 */
+	z_stream   *zin;			/* inflates received data, or NULL */
+	z_stream   *zout;			/* deflates data to send, or NULL */
+	char	   *zinBuffer;		/* compressed data not yet inflated */
+	int			zinBufSize;		/* allocated size of zinBuffer */
+	int			zinStart;		/* offset to first uninflated byte */
+	int			zinEnd;			/* offset to first position after data */
+	bool		zinFull;		/* did the last inflate() fill its output? */
+	char	   *zoutBuffer;		/* compressed data not yet sent */
+	int			zoutStart;		/* offset to first unsent byte */
+	int			zoutEnd;		/* offset to first position after data */
+	bool		zoutFlushed;	/* is all of outBuffer sent so far in it? */
+#endif
+
 	/* Status for asynchronous result construction */
 	PGresult   *result;			/* result being constructed */
 	PGresAttValue *curTuple;	/* tuple currently being read */
 
+	/*
+	 * In partial-result mode, rows are handed out in results of at most
+	 * maxChunkSize rows (with status PGRES_SINGLE_TUPLE if singleRowMode,
+	 * else PGRES_TUPLES_CHUNK), and saved_result holds the row description
+	 * from which each such result is started.
+	 */
+	bool		partialResMode; /* return rows as they arrive? */
+	bool		singleRowMode;	/* return rows one at a time? */
+	int			maxChunkSize;	/* maximum number of rows per result */
+	PGresult   *saved_result;	/* empty result with the row description */
+
+	/*
+	 * Commands sent in pipeline mode whose results are still to come, oldest
+	 * first; the head is the command now being processed.  Freed entries are
+	 * kept on a recycle list to save malloc's.
+	 */
+	PGcmdQueueEntry *cmd_queue_head;
+	PGcmdQueueEntry *cmd_queue_tail;
+	PGcmdQueueEntry *cmd_queue_recycle;
+
 #ifdef USE_SSL
 	bool		allow_ssl_try;	/* Allowed to try SSL negotiation */
 	bool		wait_ssl_try;	/* Delay SSL negotiation until after
@@ -501,6 +563,7 @@ extern void pqCatenateResultError(PGresult *res, const char *msg);
 extern void *pqResultAlloc(PGresult *res, size_t nBytes, bool isBinary);
 extern char *pqResultStrdup(PGresult *res, const char *str);
 extern void pqClearAsyncResult(PGconn *conn);
+extern int	pqSaveRowDescription(PGconn *conn);
 extern void pqSaveErrorResult(PGconn *conn);
 extern PGresult *pqPrepareAsyncResult(PGconn *conn);
 extern void
@@ -513,6 +576,7 @@ extern void pqSaveMessageField(PGresult *res, char code,
 extern void pqSaveParameterStatus(PGconn *conn, const char *name,
 					  const char *value);
 extern void pqHandleSendFailure(PGconn *conn);
+extern void pqFreeCommandQueue(PGcmdQueueEntry *queue);
 
 /* === in fe-protocol2.c === */
 
@@ -572,6 +636,8 @@ extern int pqWaitTimed(int forRead, int forWrite, PGconn *conn,
 			time_t finish_time);
 extern int	pqReadReady(PGconn *conn);
 extern int	pqWriteReady(PGconn *conn);
+extern int	pqStartCompression(PGconn *conn, int level);
+extern void pqEndCompression(PGconn *conn);
 
 /* === in fe-secure.c === */
 
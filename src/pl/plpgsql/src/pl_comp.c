@@ -18,12 +18,17 @@
 #include <ctype.h>
 
 #include "catalog/namespace.h"
+#include "catalog/pg_language.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_proc_fn.h"
 #include "catalog/pg_type.h"
+#include "commands/proclang.h"
 #include "funcapi.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/analyze.h"
 #include "parser/parse_type.h"
+#include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
@@ -81,6 +86,16 @@ static const ExceptionLabelMap exception_label_map[] = {
 	{NULL, 0}
 };
 
+/* ----------
+ * Working state for inline_param_mutator
+ * ----------
+ */
+typedef struct
+{
+	PLpgSQL_function *function;
+	bool		failed;
+} inline_param_context;
+
 
 /* ----------
  * static prototypes
@@ -94,6 +109,9 @@ static PLpgSQL_function *do_compile(FunctionCallInfo fcinfo,
 static void plpgsql_compile_error_callback(void *arg);
 static void add_parameter_name(int itemtype, int itemno, const char *name);
 static void add_dummy_return(PLpgSQL_function *function);
+static void plpgsql_finish_datums(PLpgSQL_function *function);
+
+static Node *inline_param_mutator(Node *node, inline_param_context *context);
 static Node *plpgsql_pre_column_ref(ParseState *pstate, ColumnRef *cref);
 static Node *plpgsql_post_column_ref(ParseState *pstate, ColumnRef *cref, Node *var);
 static Node *plpgsql_param_ref(ParseState *pstate, ParamRef *pref);
@@ -717,10 +735,7 @@ do_compile(FunctionCallInfo fcinfo,
 	function->fn_nargs = procStruct->pronargs;
 	for (i = 0; i < function->fn_nargs; i++)
 		function->fn_argvarnos[i] = in_arg_varnos[i];
-	function->ndatums = plpgsql_nDatums;
-	function->datums = palloc(sizeof(PLpgSQL_datum *) * plpgsql_nDatums);
-	for (i = 0; i < plpgsql_nDatums; i++)
-		function->datums[i] = plpgsql_Datums[i];
+	plpgsql_finish_datums(function);
 
 	/* Debug dump for completed functions */
 	if (plpgsql_DumpExecTree)
@@ -764,7 +779,6 @@ plpgsql_compile_inline(char *proc_source)
 	PLpgSQL_variable *var;
 	int			parse_rc;
 	MemoryContext func_cxt;
-	int			i;
 
 	/*
 	 * Setup the scanner input and error info.	We assume that this function
@@ -865,10 +879,7 @@ plpgsql_compile_inline(char *proc_source)
 	 * Complete the function's info
 	 */
 	function->fn_nargs = 0;
-	function->ndatums = plpgsql_nDatums;
-	function->datums = palloc(sizeof(PLpgSQL_datum *) * plpgsql_nDatums);
-	for (i = 0; i < plpgsql_nDatums; i++)
-		function->datums[i] = plpgsql_Datums[i];
+	plpgsql_finish_datums(function);
 
 	/*
 	 * Pop the error context stack
@@ -974,6 +985,211 @@ add_dummy_return(PLpgSQL_function *function)
 }
 
 
+/*
+ * plpgsql_inline_function_body		Offer a function body for inlining
+ *
+ * This is installed as the planner's inline_function_body_hook.  An
+ * immutable function whose body consists of nothing but "RETURN expression",
+ * where the expression refers to no variables other than the function's
+ * scalar arguments and already has the function's result type, behaves
+ * exactly like the SQL function "SELECT expression", so we hand the planner
+ * that query to inline.  Anything more complicated is left alone.
+ */
+Query *
+plpgsql_inline_function_body(HeapTuple func_tuple, FuncExpr *fexpr)
+{
+	Form_pg_proc procStruct = (Form_pg_proc) GETSTRUCT(func_tuple);
+	FunctionCallInfoData fake_fcinfo;
+	FmgrInfo	flinfo;
+	PLpgSQL_function *function;
+	PLpgSQL_execstate estate;
+	PLpgSQL_execstate *save_cur_estate;
+	PLpgSQL_stmt_block *block;
+	PLpgSQL_stmt_return *stmt;
+	PLpgSQL_expr *expr;
+	List	   *raw_parsetree_list;
+	ParseState *pstate;
+	Query	   *querytree;
+	TargetEntry *tle;
+	inline_param_context context;
+
+	/* Cheap tests first; we are called for every non-SQL function */
+	if (procStruct->prolang == INTERNALlanguageId ||
+		procStruct->prolang == ClanguageId ||
+		procStruct->provolatile != PROVOLATILE_IMMUTABLE ||
+		procStruct->prolang != get_language_oid("plpgsql", true))
+		return NULL;
+
+	/* Find or compile the function, as plpgsql_call_handler would */
+	MemSet(&fake_fcinfo, 0, sizeof(fake_fcinfo));
+	MemSet(&flinfo, 0, sizeof(flinfo));
+	fake_fcinfo.flinfo = &flinfo;
+	fake_fcinfo.nargs = list_length(fexpr->args);
+	fake_fcinfo.fncollation = fexpr->inputcollid;
+	flinfo.fn_oid = fexpr->funcid;
+	flinfo.fn_expr = (Node *) fexpr;
+	flinfo.fn_mcxt = CurrentMemoryContext;
+
+	function = plpgsql_compile(&fake_fcinfo, false);
+
+	if (function->fn_retset ||
+		function->fn_retistuple ||
+		function->out_param_varno >= 0)
+		return NULL;
+
+	block = function->action;
+	if (block->exceptions != NULL ||
+		block->n_initvars != 0 ||
+		list_length(block->body) != 1)
+		return NULL;
+
+	stmt = (PLpgSQL_stmt_return *) linitial(block->body);
+	if (stmt->cmd_type != PLPGSQL_STMT_RETURN ||
+		stmt->expr == NULL ||
+		stmt->retvarno >= 0)
+		return NULL;
+	expr = stmt->expr;
+
+	/* exec_prepare_plan would set this too */
+	expr->func = function;
+
+	/* Parse the expression's query with the usual variable hooks */
+	raw_parsetree_list = pg_parse_query(expr->query);
+	if (list_length(raw_parsetree_list) != 1)
+		return NULL;
+
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = expr->query;
+	plpgsql_parser_setup(pstate, expr);
+
+	/*
+	 * The variable hooks look up datum types through the function's current
+	 * execution state, but we aren't executing it, so lend them one that
+	 * exposes the compiled datums.  As in plpgsql_call_handler, mark the
+	 * function busy and restore cur_estate on the way out.
+	 */
+	MemSet(&estate, 0, sizeof(estate));
+	estate.func = function;
+	estate.ndatums = function->ndatums;
+	estate.datums = function->datums;
+
+	save_cur_estate = function->cur_estate;
+	function->cur_estate = &estate;
+	function->use_count++;
+
+	PG_TRY();
+	{
+		querytree = transformStmt(pstate, linitial(raw_parsetree_list));
+	}
+	PG_CATCH();
+	{
+		function->use_count--;
+		function->cur_estate = save_cur_estate;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	function->use_count--;
+	function->cur_estate = save_cur_estate;
+
+	free_parsestate(pstate);
+
+	/*
+	 * The planner checks the shape of the query, but a result of another
+	 * type would be converted by PL/pgSQL at run time rather than rejected,
+	 * so insist on an exact match here.
+	 */
+	if (!IsA(querytree, Query) ||
+		querytree->commandType != CMD_SELECT ||
+		list_length(querytree->targetList) != 1)
+		return NULL;
+	tle = (TargetEntry *) linitial(querytree->targetList);
+	if (exprType((Node *) tle->expr) != function->fn_rettype)
+		return NULL;
+
+	/* Renumber the variable references as argument references */
+	context.function = function;
+	context.failed = false;
+	tle->expr = (Expr *) inline_param_mutator((Node *) tle->expr, &context);
+	if (context.failed)
+		return NULL;
+
+	return querytree;
+}
+
+/*
+ * Replace Params referencing the function's argument variables with Params
+ * numbered by argument position, as in a SQL-function body.  Sets
+ * context->failed if any other variable is referenced.
+ */
+static Node *
+inline_param_mutator(Node *node, inline_param_context *context)
+{
+	if (node == NULL)
+		return NULL;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+		PLpgSQL_function *function = context->function;
+		int			dno = param->paramid - 1;
+		int			i;
+
+		if (param->paramkind == PARAM_EXTERN &&
+			dno >= 0 && dno < function->ndatums &&
+			function->datums[dno]->dtype == PLPGSQL_DTYPE_VAR)
+		{
+			for (i = 0; i < function->fn_nargs; i++)
+			{
+				if (function->fn_argvarnos[i] == dno)
+				{
+					param = (Param *) copyObject(param);
+					param->paramid = i + 1;
+					return (Node *) param;
+				}
+			}
+		}
+		context->failed = true;
+		return node;
+	}
+	return expression_tree_mutator(node, inline_param_mutator,
+								   (void *) context);
+}
+
+
+/*
+ * Copy the datums collected during compilation into the function, and
+ * compute how much space plpgsql_exec_function will need for its local
+ * copies of them.
+ */
+static void
+plpgsql_finish_datums(PLpgSQL_function *function)
+{
+	Size		copiable_size = 0;
+	int			i;
+
+	function->ndatums = plpgsql_nDatums;
+	function->datums = palloc(sizeof(PLpgSQL_datum *) * plpgsql_nDatums);
+	for (i = 0; i < plpgsql_nDatums; i++)
+	{
+		function->datums[i] = plpgsql_Datums[i];
+
+		/* This must agree with copy_plpgsql_datums on what is copiable */
+		switch (function->datums[i]->dtype)
+		{
+			case PLPGSQL_DTYPE_VAR:
+				copiable_size += MAXALIGN(sizeof(PLpgSQL_var));
+				break;
+			case PLPGSQL_DTYPE_REC:
+				copiable_size += MAXALIGN(sizeof(PLpgSQL_rec));
+				break;
+			default:
+				break;
+		}
+	}
+	function->copiable_size = copiable_size;
+}
+
+
 /*
  * plpgsql_parser_setup		set up parser hooks for dynamic parameters
  *
@@ -19,12 +19,14 @@
 
 #include "access/transam.h"
 #include "access/tupconvert.h"
+#include "catalog/pg_language.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "executor/spi_priv.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "parser/scansup.h"
 #include "storage/proc.h"
 #include "tcop/tcopprot.h"
@@ -35,6 +37,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
+#include "utils/syscache.h"
 #include "utils/typcache.h"
 
 
@@ -80,7 +83,8 @@ static SimpleEcontextStackEntry *simple_econtext_stack = NULL;
  * Local function forward declarations
  ************************************************************/
 static void plpgsql_exec_error_callback(void *arg);
-static PLpgSQL_datum *copy_plpgsql_datum(PLpgSQL_datum *datum);
+static void copy_plpgsql_datums(PLpgSQL_execstate *estate,
+					PLpgSQL_function *func);
 
 static int exec_stmt_block(PLpgSQL_execstate *estate,
 				PLpgSQL_stmt_block *block);
@@ -143,6 +147,11 @@ static void exec_prepare_plan(PLpgSQL_execstate *estate,
 static bool exec_simple_check_node(Node *node);
 static void exec_simple_check_plan(PLpgSQL_expr *expr);
 static void exec_simple_recheck_plan(PLpgSQL_expr *expr, CachedPlan *cplan);
+static void exec_simple_check_fast(PLpgSQL_expr *expr);
+static void exec_eval_fast_expr(PLpgSQL_execstate *estate,
+					PLpgSQL_expr *expr,
+					Datum *result,
+					bool *isNull);
 static bool exec_eval_simple_expr(PLpgSQL_execstate *estate,
 					  PLpgSQL_expr *expr,
 					  Datum *result,
@@ -242,8 +251,7 @@ plpgsql_exec_function(PLpgSQL_function *func, FunctionCallInfo fcinfo)
 	 * Make local execution copies of all the datums
 	 */
 	estate.err_text = gettext_noop("during initialization of execution state");
-	for (i = 0; i < estate.ndatums; i++)
-		estate.datums[i] = copy_plpgsql_datum(func->datums[i]);
+	copy_plpgsql_datums(&estate, func);
 
 	/*
 	 * Store the actual call argument values into the appropriate variables
@@ -513,8 +521,7 @@ plpgsql_exec_trigger(PLpgSQL_function *func,
 	 * Make local execution copies of all the datums
 	 */
 	estate.err_text = gettext_noop("during initialization of execution state");
-	for (i = 0; i < estate.ndatums; i++)
-		estate.datums[i] = copy_plpgsql_datum(func->datums[i]);
+	copy_plpgsql_datums(&estate, func);
 
 	/*
 	 * Put the OLD and NEW tuples into record variables
@@ -832,61 +839,89 @@ plpgsql_exec_error_callback(void *arg)
  * Support function for initializing local execution variables
  * ----------
  */
-static PLpgSQL_datum *
-copy_plpgsql_datum(PLpgSQL_datum *datum)
+/*
+ * Make local execution copies of all the function's datums
+ *
+ * The copies of all the VAR and REC datums are carved out of a single
+ * allocation, whose size plpgsql_finish_datums computed when the function
+ * was compiled, so that each call costs one palloc instead of one per
+ * variable.
+ */
+static void
+copy_plpgsql_datums(PLpgSQL_execstate *estate,
+					PLpgSQL_function *func)
 {
-	PLpgSQL_datum *result;
+	int			ndatums = estate->ndatums;
+	PLpgSQL_datum **indatums = func->datums;
+	PLpgSQL_datum **outdatums = estate->datums;
+	char	   *workspace;
+	char	   *ws_next;
+	int			i;
 
-	switch (datum->dtype)
+	workspace = palloc(func->copiable_size);
+	ws_next = workspace;
+
+	for (i = 0; i < ndatums; i++)
 	{
-		case PLPGSQL_DTYPE_VAR:
-			{
-				PLpgSQL_var *new = palloc(sizeof(PLpgSQL_var));
+		PLpgSQL_datum *indatum = indatums[i];
+		PLpgSQL_datum *outdatum;
 
-				memcpy(new, datum, sizeof(PLpgSQL_var));
-				/* Ensure the value is null (possibly not needed?) */
-				new->value = 0;
-				new->isnull = true;
-				new->freeval = false;
+		/* This must agree with plpgsql_finish_datums on what is copiable */
+		switch (indatum->dtype)
+		{
+			case PLPGSQL_DTYPE_VAR:
+				{
+					PLpgSQL_var *new = (PLpgSQL_var *) ws_next;
 
-				result = (PLpgSQL_datum *) new;
-			}
-			break;
+					memcpy(new, indatum, sizeof(PLpgSQL_var));
+					/* Ensure the value is null (possibly not needed?) */
+					new->value = 0;
+					new->isnull = true;
+					new->freeval = false;
 
-		case PLPGSQL_DTYPE_REC:
-			{
-				PLpgSQL_rec *new = palloc(sizeof(PLpgSQL_rec));
+					outdatum = (PLpgSQL_datum *) new;
+					ws_next += MAXALIGN(sizeof(PLpgSQL_var));
+				}
+				break;
 
-				memcpy(new, datum, sizeof(PLpgSQL_rec));
-				/* Ensure the value is null (possibly not needed?) */
-				new->tup = NULL;
-				new->tupdesc = NULL;
-				new->freetup = false;
-				new->freetupdesc = false;
+			case PLPGSQL_DTYPE_REC:
+				{
+					PLpgSQL_rec *new = (PLpgSQL_rec *) ws_next;
 
-				result = (PLpgSQL_datum *) new;
-			}
-			break;
+					memcpy(new, indatum, sizeof(PLpgSQL_rec));
+					/* Ensure the value is null (possibly not needed?) */
+					new->tup = NULL;
+					new->tupdesc = NULL;
+					new->freetup = false;
+					new->freetupdesc = false;
 
-		case PLPGSQL_DTYPE_ROW:
-		case PLPGSQL_DTYPE_RECFIELD:
-		case PLPGSQL_DTYPE_ARRAYELEM:
+					outdatum = (PLpgSQL_datum *) new;
+					ws_next += MAXALIGN(sizeof(PLpgSQL_rec));
+				}
+				break;
 
-			/*
-			 * These datum records are read-only at runtime, so no need to
-			 * copy them (well, ARRAYELEM contains some cached type data,
-			 * but we'd just as soon centralize the caching anyway)
-			 */
-			result = datum;
-			break;
+			case PLPGSQL_DTYPE_ROW:
+			case PLPGSQL_DTYPE_RECFIELD:
+			case PLPGSQL_DTYPE_ARRAYELEM:
 
-		default:
-			elog(ERROR, "unrecognized dtype: %d", datum->dtype);
-			result = NULL;		/* keep compiler quiet */
-			break;
+				/*
+				 * These datum records are read-only at runtime, so no need to
+				 * copy them (well, ARRAYELEM contains some cached type data,
+				 * but we'd just as soon centralize the caching anyway)
+				 */
+				outdatum = indatum;
+				break;
+
+			default:
+				elog(ERROR, "unrecognized dtype: %d", indatum->dtype);
+				outdatum = NULL;	/* keep compiler quiet */
+				break;
+		}
+
+		outdatums[i] = outdatum;
 	}
 
-	return result;
+	Assert(ws_next == workspace + func->copiable_size);
 }
 
 
@@ -4165,12 +4200,32 @@ exec_assign_value(PLpgSQL_execstate *estate,
 					pfree(DatumGetPointer(coerced_value));
 
 				/*
-				 * Assign the new array to the base variable.  It's never NULL
-				 * at this point.  Note that if the target is a domain,
-				 * coercing the base array type back up to the domain will
-				 * happen within exec_assign_value.
+				 * If the base variable is a plain variable of exactly the
+				 * array type, no coercion is needed and the freshly built
+				 * array can become the variable's value as is, saving
+				 * exec_assign_value from copying it only for us to free the
+				 * original.
 				 */
 				*isNull = false;
+				if (target->dtype == PLPGSQL_DTYPE_VAR &&
+					parenttypoid == arrayelem->arraytypoid &&
+					((PLpgSQL_var *) target)->datatype->atttypmod == -1)
+				{
+					PLpgSQL_var *var = (PLpgSQL_var *) target;
+
+					free_var(var);
+					var->value = PointerGetDatum(newarrayval);
+					var->isnull = false;
+					var->freeval = true;
+					break;
+				}
+
+				/*
+				 * Otherwise assign the new array to the base variable.  It's
+				 * never NULL at this point.  Note that if the target is a
+				 * domain, coercing the base array type back up to the domain
+				 * will happen within exec_assign_value.
+				 */
 				exec_assign_value(estate, target,
 								  PointerGetDatum(newarrayval),
 								  arrayelem->arraytypoid, isNull);
@@ -4927,6 +4982,17 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 	 */
 	*rettype = expr->expr_simple_type;
 
+	/*
+	 * If the expression is just a call of a simple built-in function, call
+	 * it directly; none of the setup below is needed for that.
+	 */
+	if (expr->expr_fast)
+	{
+		exec_eval_fast_expr(estate, expr, result, isNull);
+		ReleaseCachedPlan(cplan, true);
+		return true;
+	}
+
 	/*
 	 * Prepare the expression for execution, if it's not been done already in
 	 * the current transaction.  (This will be forced to happen if we called
@@ -4945,12 +5011,14 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 	 * We have to do some of the things SPI_execute_plan would do, in
 	 * particular advance the snapshot if we are in a non-read-only function.
 	 * Without this, stable functions within the expression would fail to see
-	 * updates made so far by our own function.
+	 * updates made so far by our own function.  An expression containing
+	 * only immutable functions can't care, so skip that expensive step for
+	 * it.
 	 */
 	SPI_push();
 
 	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
-	if (!estate->readonly_func)
+	if (!estate->readonly_func && expr->expr_simple_mutable)
 	{
 		CommandCounterIncrement();
 		PushActiveSnapshot(GetTransactionSnapshot());
@@ -4987,7 +5055,7 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 
 	estate->cur_expr = save_cur_expr;
 
-	if (!estate->readonly_func)
+	if (!estate->readonly_func && expr->expr_simple_mutable)
 		PopActiveSnapshot();
 
 	MemoryContextSwitchTo(oldcontext);
@@ -5005,6 +5073,57 @@ exec_eval_simple_expr(PLpgSQL_execstate *estate,
 	return true;
 }
 
+/* ----------
+ * exec_eval_fast_expr		Evaluate a simple expression marked by
+ *							exec_simple_check_fast
+ *
+ * The function is strict, so a null variable yields a null result without
+ * calling it.  The result is pass-by-value, so there is nothing to clean up
+ * afterwards; we still run the function in the eval_econtext's temporary
+ * memory context in case it pallocs anything internally.
+ * ----------
+ */
+static void
+exec_eval_fast_expr(PLpgSQL_execstate *estate,
+					PLpgSQL_expr *expr,
+					Datum *result,
+					bool *isNull)
+{
+	FunctionCallInfoData fcinfo;
+	MemoryContext oldcontext;
+	int			i;
+
+	InitFunctionCallInfoData(fcinfo, &expr->expr_fast_finfo,
+							 expr->expr_fast_nargs,
+							 expr->expr_fast_collation, NULL, NULL);
+
+	for (i = 0; i < expr->expr_fast_nargs; i++)
+	{
+		int			dno = expr->expr_fast_argdno[i];
+
+		if (dno >= 0)
+		{
+			PLpgSQL_var *var = (PLpgSQL_var *) estate->datums[dno];
+
+			if (var->isnull)
+			{
+				*result = (Datum) 0;
+				*isNull = true;
+				return;
+			}
+			fcinfo.arg[i] = var->value;
+		}
+		else
+			fcinfo.arg[i] = expr->expr_fast_argval[i];
+		fcinfo.argnull[i] = false;
+	}
+
+	oldcontext = MemoryContextSwitchTo(estate->eval_econtext->ecxt_per_tuple_memory);
+	*result = FunctionCallInvoke(&fcinfo);
+	MemoryContextSwitchTo(oldcontext);
+	*isNull = fcinfo.isnull;
+}
+
 
 /*
  * Create a ParamListInfo to pass to SPI
@@ -5704,6 +5823,7 @@ exec_simple_check_plan(PLpgSQL_expr *expr)
 	 */
 	expr->expr_simple_expr = NULL;
 	expr->expr_simple_generation = 0;
+	expr->expr_fast = false;
 
 	/*
 	 * We can only test queries that resulted in exactly one CachedPlanSource
@@ -5794,6 +5914,7 @@ exec_simple_recheck_plan(PLpgSQL_expr *expr, CachedPlan *cplan)
 	 */
 	expr->expr_simple_expr = NULL;
 	expr->expr_simple_generation = cplan->generation;
+	expr->expr_fast = false;
 
 	/*
 	 * 1. There must be one single plantree
@@ -5847,6 +5968,130 @@ exec_simple_recheck_plan(PLpgSQL_expr *expr, CachedPlan *cplan)
 	expr->expr_simple_lxid = InvalidLocalTransactionId;
 	/* Also stash away the expression result type */
 	expr->expr_simple_type = exprType((Node *) tle->expr);
+
+	/*
+	 * Remember whether the expression could possibly care about updates made
+	 * so far by our own function; if not, exec_eval_simple_expr can skip
+	 * advancing the snapshot.
+	 */
+	expr->expr_simple_mutable =
+		contain_mutable_functions((Node *) tle->expr);
+
+	/* And see whether it can bypass the executor altogether */
+	exec_simple_check_fast(expr);
+}
+
+/*
+ * exec_simple_check_fast --- check whether a simple expression can be
+ *		evaluated by calling its function directly
+ *
+ * This covers the very common cases like "i + 1" or "a < b" on integer
+ * variables, for which setting up a parameter list and going through
+ * ExecEvalExpr costs far more than the operator itself.  We insist on a
+ * strict, immutable, non-set-returning built-in function (so it cannot run
+ * SPI queries or care about the snapshot),
+ * pass-by-value argument and result types, and arguments that are either
+ * non-null constants or plain variables of exactly the parameter's type.
+ */
+static void
+exec_simple_check_fast(PLpgSQL_expr *expr)
+{
+	Node	   *node = (Node *) expr->expr_simple_expr;
+	Oid			funcid;
+	Oid			collation;
+	List	   *args;
+	ListCell   *lc;
+	HeapTuple	procTup;
+	Form_pg_proc procStruct;
+	bool		ok;
+	int			nargs;
+
+	expr->expr_fast = false;
+
+	if (IsA(node, OpExpr))
+	{
+		OpExpr	   *opexpr = (OpExpr *) node;
+
+		funcid = opexpr->opfuncid;
+		collation = opexpr->inputcollid;
+		args = opexpr->args;
+		if (opexpr->opretset)
+			return;
+	}
+	else if (IsA(node, FuncExpr))
+	{
+		FuncExpr   *funcexpr = (FuncExpr *) node;
+
+		funcid = funcexpr->funcid;
+		collation = funcexpr->inputcollid;
+		args = funcexpr->args;
+		if (funcexpr->funcretset)
+			return;
+	}
+	else
+		return;
+
+	nargs = list_length(args);
+	if (nargs < 1 || nargs > 2)
+		return;
+	if (!get_typbyval(exprType(node)))
+		return;
+
+	nargs = 0;
+	foreach(lc, args)
+	{
+		Node	   *arg = (Node *) lfirst(lc);
+
+		if (!get_typbyval(exprType(arg)))
+			return;
+
+		if (IsA(arg, Const))
+		{
+			Const	   *con = (Const *) arg;
+
+			if (con->constisnull)
+				return;
+			expr->expr_fast_argdno[nargs] = -1;
+			expr->expr_fast_argval[nargs] = con->constvalue;
+		}
+		else if (IsA(arg, Param))
+		{
+			Param	   *param = (Param *) arg;
+			int			dno = param->paramid - 1;
+			PLpgSQL_var *var;
+
+			if (param->paramkind != PARAM_EXTERN ||
+				dno < 0 || dno >= expr->func->ndatums)
+				return;
+			var = (PLpgSQL_var *) expr->func->datums[dno];
+			if (var->dtype != PLPGSQL_DTYPE_VAR ||
+				var->datatype->typoid != param->paramtype)
+				return;
+			expr->expr_fast_argdno[nargs] = dno;
+			expr->expr_fast_argval[nargs] = (Datum) 0;
+		}
+		else
+			return;
+		nargs++;
+	}
+
+	procTup = SearchSysCache1(PROCOID, ObjectIdGetDatum(funcid));
+	if (!HeapTupleIsValid(procTup))
+		elog(ERROR, "cache lookup failed for function %u", funcid);
+	procStruct = (Form_pg_proc) GETSTRUCT(procTup);
+	ok = (procStruct->proisstrict &&
+		  procStruct->provolatile == PROVOLATILE_IMMUTABLE &&
+		  !procStruct->proretset &&
+		  procStruct->prolang == INTERNALlanguageId);
+	ReleaseSysCache(procTup);
+	if (!ok)
+		return;
+
+	/* The FmgrInfo must live as long as the expression itself */
+	fmgr_info_cxt(funcid, &expr->expr_fast_finfo, expr->func->fn_cxt);
+	expr->expr_fast_collation = collation;
+	expr->expr_fast_nargs = nargs;
+	expr->expr_fast = true;
 }
 
 /* ----------
@@ -214,6 +214,23 @@ typedef struct PLpgSQL_expr
 	Expr	   *expr_simple_expr;		/* NULL means not a simple expr */
 	int			expr_simple_generation; /* plancache generation we checked */
 	Oid			expr_simple_type;		/* result type Oid, if simple */
+	bool		expr_simple_mutable;	/* true if may contain mutable funcs */
+
+	/*
+	 * If a simple expression is just a call of a strict, immutable, built-in
+	 * function whose arguments and result are pass-by-value and whose
+	 * arguments are constants or plain variables, it can be evaluated by
+	 * calling the function directly, without going through the executor.
+	 * expr_fast is false if that is not possible.  For each argument,
+	 * expr_fast_argdno is the dno of the variable, or -1 for a constant
+	 * whose value is in expr_fast_argval.
+	 */
+	bool		expr_fast;
+	FmgrInfo	expr_fast_finfo;
+	Oid			expr_fast_collation;
+	int			expr_fast_nargs;
+	int			expr_fast_argdno[2];
+	Datum		expr_fast_argval[2];
 
 	/*
 	 * if expr is simple AND prepared in current transaction,
@@ -717,6 +734,7 @@ typedef struct PLpgSQL_function
 
 	int			ndatums;
 	PLpgSQL_datum **datums;
+	Size		copiable_size;	/* space for locally instantiated datums */
 	PLpgSQL_stmt_block *action;
 
 	/* these fields change when the function is used */
@@ -879,6 +897,8 @@ extern PLpgSQL_function *plpgsql_compile(FunctionCallInfo fcinfo,
 extern PLpgSQL_function *plpgsql_compile_inline(char *proc_source);
 extern void plpgsql_parser_setup(struct ParseState *pstate,
 					 PLpgSQL_expr *expr);
+extern Query *plpgsql_inline_function_body(HeapTuple func_tuple,
+							 FuncExpr *fexpr);
 extern bool plpgsql_parse_word(char *word1, const char *yytxt,
 				   PLwdatum *wdatum, PLword *word);
 extern bool plpgsql_parse_dblword(char *word1, char *word2,
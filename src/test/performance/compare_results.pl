@@ -0,0 +1,92 @@
+#! /usr/bin/perl -w
+#-------------------------------------------------------------------------
+#
+# compare_results.pl
+#    Compare two result files written by run_benchmarks.pl
+#
+# For each benchmark present in both files, prints the median latencies
+# and their ratio, and flags the benchmark if it got slower or faster by
+# more than the threshold.  Exits with status 1 if any benchmark got
+# slower, so the comparison can fail a build.
+#
+# Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+# Portions Copyright (c) 1994, Regents of the University of California
+#
+#
+# IDENTIFICATION
+#    src/test/performance/compare_results.pl
+#
+#-------------------------------------------------------------------------
+
+use strict;
+use warnings;
+
+use Getopt::Long;
+
+my $threshold = 10;
+
+GetOptions('threshold=f' => \$threshold)
+  or die "Usage: $0 [--threshold=PERCENT] OLDFILE NEWFILE\n";
+die "Usage: $0 [--threshold=PERCENT] OLDFILE NEWFILE\n" unless @ARGV == 2;
+
+my ($oldfile, $newfile) = @ARGV;
+my ($oldres, undef) = read_results($oldfile);
+my ($newres, $order) = read_results($newfile);
+my $regressions = 0;
+
+printf "%-24s %12s %12s %8s\n", 'benchmark', 'old ms', 'new ms', 'ratio';
+foreach my $name (@$order)
+{
+	unless (exists $oldres->{$name})
+	{
+		printf "%-24s %12s %12.3f %8s\n", $name, '-', $newres->{$name}, '';
+		next;
+	}
+
+	my $old   = $oldres->{$name};
+	my $new   = $newres->{$name};
+	my $ratio = $old > 0 ? $new / $old : 1;
+	my $flag  = '';
+
+	if ($ratio > 1 + $threshold / 100)
+	{
+		$flag = '  SLOWER';
+		$regressions++;
+	}
+	elsif ($ratio < 1 - $threshold / 100)
+	{
+		$flag = '  faster';
+	}
+
+	printf "%-24s %12.3f %12.3f %8.3f%s\n", $name, $old, $new, $ratio, $flag;
+}
+
+if ($regressions)
+{
+	printf "%d benchmark(s) got more than %g%% slower\n", $regressions,
+	  $threshold;
+	exit 1;
+}
+exit 0;
+
+
+# Return a hash of the median latency of each benchmark in the file, and
+# an array of the benchmark names in file order.
+sub read_results
+{
+	my $file = shift;
+	my (%result, @order);
+
+	open(my $fh, '<', $file) or die "could not open \"$file\": $!\n";
+	while (<$fh>)
+	{
+		next if /^#/;
+		chomp;
+		my @f = split /\t/;
+		die "$file:$.: invalid results line\n" unless @f == 7;
+		push @order, $f[0] unless exists $result{ $f[0] };
+		$result{ $f[0] } = $f[3];
+	}
+	close($fh);
+	return (\%result, \@order);
+}
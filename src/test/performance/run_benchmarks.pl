@@ -0,0 +1,236 @@
+#! /usr/bin/perl -w
+#-------------------------------------------------------------------------
+#
+# run_benchmarks.pl
+#    Run the performance benchmark suite against a running server
+#
+# The schedule file lists, in order, the steps to run:
+#
+#    setup <file>       run sql/<file> with psql; not timed
+#    init <scale>       initialize the pgbench tables; not timed
+#    bench <name> <script> <clients> <transactions>
+#                       time bench/<script> with pgbench, or one of the
+#                       built-in pgbench workloads if <script> is
+#                       builtin:tpcb, builtin:simple-update or
+#                       builtin:select
+#
+# Each benchmark is run once to warm up and then --repeat times, and the
+# median, minimum and maximum transaction latency and the median rate are
+# written as one tab-separated line to the output file.  Lines starting
+# with "#" describe the run.  compare_results.pl compares two such files.
+#
+# Setup files and benchmark scripts can refer to the psql or pgbench
+# variable "datadir", an absolute path to a scratch directory, for files
+# that the server reads or writes with COPY.
+#
+# Portions Copyright (c) 1996-2012, PostgreSQL Global Development Group
+# Portions Copyright (c) 1994, Regents of the University of California
+#
+#
+# IDENTIFICATION
+#    src/test/performance/run_benchmarks.pl
+#
+#-------------------------------------------------------------------------
+
+use strict;
+use warnings;
+
+use File::Path qw(mkpath);
+use File::Spec;
+use Getopt::Long;
+use POSIX qw(strftime);
+
+my $bindir   = '';
+my $inputdir = '.';
+my $schedule;
+my $outfile = 'perf_results.out';
+my $dbname  = 'perftest';
+my $repeat  = 3;
+my $only;
+
+GetOptions(
+	'bindir=s'   => \$bindir,
+	'inputdir=s' => \$inputdir,
+	'schedule=s' => \$schedule,
+	'outfile=s'  => \$outfile,
+	'dbname=s'   => \$dbname,
+	'repeat=i'   => \$repeat,
+	'only=s'     => \$only) or usage();
+
+usage() if @ARGV || $repeat < 1;
+$schedule = "$inputdir/perf_schedule" unless defined $schedule;
+
+my $psql    = $bindir ne '' ? "$bindir/psql"    : 'psql';
+my $pgbench = $bindir ne '' ? "$bindir/pgbench" : 'pgbench';
+
+# scratch directory for data files; the server must be able to reach it
+my $datadir = File::Spec->rel2abs('perf_data');
+mkpath($datadir);
+
+my %builtin = (
+	'builtin:tpcb'          => [],
+	'builtin:simple-update' => ['-N'],
+	'builtin:select'        => ['-S']);
+
+my @steps = read_schedule($schedule);
+
+# start from an empty database, so earlier runs can't skew this one
+psql('postgres', '-c', "DROP DATABASE IF EXISTS $dbname");
+psql('postgres', '-c', "CREATE DATABASE $dbname TEMPLATE template0");
+
+open(my $out, '>', $outfile) or die "could not open \"$outfile\": $!\n";
+printf $out "# started %s\n", strftime('%Y-%m-%d %H:%M:%S', localtime);
+printf $out "# server %s\n",
+  scalar psql($dbname, '-A', '-t', '-c', 'SELECT version()');
+print $out "# repeat $repeat\n";
+print $out join("\t",
+	'# benchmark',          'clients',
+	'transactions',         'latency_ms_median',
+	'latency_ms_min',       'latency_ms_max',
+	'tps_median'), "\n";
+
+foreach my $step (@steps)
+{
+	my ($cmd, @args) = @$step;
+
+	if ($cmd eq 'setup')
+	{
+		print "setup $args[0]\n";
+		psql($dbname, '-f', "$inputdir/sql/$args[0]");
+	}
+	elsif ($cmd eq 'init')
+	{
+		print "init scale $args[0]\n";
+		run_pgbench('-i', '-s', $args[0]);
+	}
+	else
+	{
+		my ($name, $script, $clients, $xacts) = @args;
+		my (@latency, @tps);
+
+		next if defined $only && $name !~ /$only/;
+
+		my @cmd = ('-n', '-c', $clients, '-j', $clients, '-t', $xacts);
+		if (exists $builtin{$script})
+		{
+			push @cmd, @{ $builtin{$script} };
+		}
+		else
+		{
+			push @cmd, '-f', "$inputdir/bench/$script", '-D',
+			  "datadir=$datadir";
+		}
+
+		print "bench $name ...";
+		for (my $i = 0; $i <= $repeat; $i++)
+		{
+			my $output = run_pgbench(@cmd);
+
+			$output =~ /^latency average: ([0-9.]+) ms$/m
+			  or die "\ncould not find latency in pgbench output:\n$output";
+			my $lat = $1;
+			$output =~ /^tps = ([0-9.]+) \(excluding/m
+			  or die "\ncould not find tps in pgbench output:\n$output";
+			my $tps = $1;
+
+			# the first run only warms up caches
+			next if $i == 0;
+			push @latency, $lat;
+			push @tps,     $tps;
+		}
+
+		@latency = sort { $a <=> $b } @latency;
+		printf " %.3f ms\n", median(@latency);
+		printf $out "%s\t%d\t%d\t%.3f\t%.3f\t%.3f\t%.1f\n",
+		  $name, $clients, $xacts, median(@latency), $latency[0],
+		  $latency[-1], median(sort { $a <=> $b } @tps);
+	}
+}
+
+printf $out "# finished %s\n", strftime('%Y-%m-%d %H:%M:%S', localtime);
+close($out);
+
+print "results written to $outfile\n";
+exit 0;
+
+
+sub usage
+{
+	die <<EOF;
+Usage: $0 [OPTION]...
+  --bindir=DIR        directory of psql and pgbench (default: PATH)
+  --inputdir=DIR      directory holding the schedule, sql/ and bench/
+  --schedule=FILE     schedule to run (default: INPUTDIR/perf_schedule)
+  --outfile=FILE      results file (default: perf_results.out)
+  --dbname=NAME       database to run in; it is recreated (default: perftest)
+  --repeat=N          timed runs of each benchmark (default: 3)
+  --only=REGEX        run only the benchmarks whose names match
+Connection settings are taken from the PGHOST, PGPORT and PGUSER
+environment variables.  The user must be a superuser.
+EOF
+}
+
+sub read_schedule
+{
+	my $file = shift;
+	my @result;
+
+	open(my $fh, '<', $file) or die "could not open \"$file\": $!\n";
+	while (<$fh>)
+	{
+		s/#.*//;
+		my @f = split;
+		next unless @f;
+
+		if (   ($f[0] eq 'setup' && @f == 2)
+			|| ($f[0] eq 'init'  && @f == 2)
+			|| ($f[0] eq 'bench' && @f == 5))
+		{
+			push @result, [@f];
+		}
+		else
+		{
+			die "$file:$.: invalid schedule line\n";
+		}
+	}
+	close($fh);
+	return @result;
+}
+
+# Run psql with the given database and arguments, and return its output.
+sub psql
+{
+	my ($db, @args) = @_;
+	my @cmd = (
+		$psql, '-X', '-q', '-v', 'ON_ERROR_STOP=1', '-v',
+		"datadir=$datadir", '-d', $db, @args);
+	return run_command(@cmd);
+}
+
+# Run pgbench against the benchmark database, and return its output.
+sub run_pgbench
+{
+	return run_command($pgbench, @_, $dbname);
+}
+
+sub run_command
+{
+	my @cmd = @_;
+	my $output = '';
+
+	open(my $fh, '-|', @cmd) or die "could not run \"$cmd[0]\": $!\n";
+	$output .= $_ while <$fh>;
+	close($fh);
+	die "command failed: @cmd\n$output" if $?;
+	chomp $output;
+	return $output;
+}
+
+sub median
+{
+	my @sorted = @_;
+	my $n      = scalar @sorted;
+
+	return $sorted[ $n / 2 ] if $n % 2;
+	return ($sorted[ $n / 2 - 1 ] + $sorted[ $n / 2 ]) / 2;
+}
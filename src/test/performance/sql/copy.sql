@@ -0,0 +1,16 @@
+--
+-- Table and data files for the COPY parsing benchmarks.  The files are
+-- written by the server into the scratch directory.
+--
+CREATE TABLE perf_copy (id int4, t text, d timestamptz, n numeric, f float8);
+
+\set copyfile :datadir '/perf_copy.data'
+\set csvfile :datadir '/perf_copy.csv'
+
+COPY (SELECT g, md5(g::text), timestamptz '2012-01-01' + g * interval '1 second',
+		   g / 7.0, g * 1.5
+	  FROM generate_series(1, 200000) g) TO :'copyfile';
+
+COPY (SELECT g, md5(g::text), timestamptz '2012-01-01' + g * interval '1 second',
+		   g / 7.0, g * 1.5
+	  FROM generate_series(1, 200000) g) TO :'csvfile' WITH CSV;
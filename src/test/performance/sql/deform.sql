@@ -0,0 +1,63 @@
+--
+-- Tables for the tuple deforming benchmarks (heap_deform_tuple and
+-- slot_getattr).  Each row has sixteen fixed-width columns followed by a
+-- mix of text and integer columns, and the benchmarks read the last
+-- column, so every column is deformed.  perf_wide_nulls has a null in an
+-- early column of every other row.
+--
+CREATE TABLE perf_wide AS
+	SELECT g AS c1,
+		   g::int8 AS c2,
+		   g::float8 * 0.5 AS c3,
+		   g AS c4,
+		   g::int8 AS c5,
+		   g::float8 * 0.5 AS c6,
+		   g AS c7,
+		   g::int8 AS c8,
+		   g::float8 * 0.5 AS c9,
+		   g AS c10,
+		   g::int8 AS c11,
+		   g::float8 * 0.5 AS c12,
+		   g AS c13,
+		   g::int8 AS c14,
+		   g::float8 * 0.5 AS c15,
+		   g AS c16,
+		   md5(g::text) AS c17,
+		   g AS c18,
+		   md5(g::text) AS c19,
+		   g AS c20,
+		   md5(g::text) AS c21,
+		   g AS c22,
+		   md5(g::text) AS c23,
+		   g AS c24
+	FROM generate_series(1, 500000) g;
+
+CREATE TABLE perf_wide_nulls AS
+	SELECT g AS c1,
+		   CASE WHEN g % 2 = 0 THEN NULL ELSE g::int8 END AS c2,
+		   g::float8 * 0.5 AS c3,
+		   g AS c4,
+		   g::int8 AS c5,
+		   g::float8 * 0.5 AS c6,
+		   g AS c7,
+		   g::int8 AS c8,
+		   g::float8 * 0.5 AS c9,
+		   g AS c10,
+		   g::int8 AS c11,
+		   g::float8 * 0.5 AS c12,
+		   g AS c13,
+		   g::int8 AS c14,
+		   g::float8 * 0.5 AS c15,
+		   g AS c16,
+		   md5(g::text) AS c17,
+		   g AS c18,
+		   md5(g::text) AS c19,
+		   g AS c20,
+		   md5(g::text) AS c21,
+		   g AS c22,
+		   md5(g::text) AS c23,
+		   g AS c24
+	FROM generate_series(1, 500000) g;
+
+VACUUM ANALYZE perf_wide;
+VACUUM ANALYZE perf_wide_nulls;
@@ -0,0 +1,8 @@
+--
+-- Table for the hash table benchmarks (LookupTupleHashEntry)
+--
+CREATE TABLE perf_hash AS
+	SELECT g % 100000 AS k, g AS v
+	FROM generate_series(1, 2000000) g;
+
+VACUUM ANALYZE perf_hash;
@@ -0,0 +1,10 @@
+--
+-- Tables for the tuplesort benchmarks.  The values are a fixed
+-- permutation rather than random(), so every run sorts the same input.
+--
+CREATE TABLE perf_sort AS
+	SELECT ((g::int8 * 1103515245 + 12345) % 2147483648)::int4 AS i,
+		   md5(g::text) AS t
+	FROM generate_series(1, 1000000) g;
+
+VACUUM ANALYZE perf_sort;
@@ -0,0 +1,6 @@
+--
+-- Tables for the WAL insertion benchmarks (XLogInsert)
+--
+CREATE TABLE perf_wal (id int4, val text);
+
+CREATE TABLE perf_wal_commit (id int4, val text);
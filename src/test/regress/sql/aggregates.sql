@@ -19,6 +19,12 @@ SELECT sum(a) AS sum_198 FROM aggtest;
 SELECT sum(b) AS avg_431_773 FROM aggtest;
 SELECT sum(gpa) AS avg_6_8 FROM ONLY student;
 
+-- numeric and int8 sums mixing the fast path with full numeric arithmetic
+SELECT sum(x) AS sum_mixed FROM (VALUES (1.5), (1e20), (-0.00001), (NULL)) v(x);
+SELECT sum(x) AS sum_int8_overflow
+  FROM (VALUES (9223372036854775807::int8), (9223372036854775807::int8), (-1::int8)) v(x);
+SELECT x, sum(x) OVER (ORDER BY x) FROM (VALUES (0.25), (1.5), (2)) v(x);
+
 SELECT max(four) AS max_3 FROM onek;
 SELECT max(a) AS max_100 FROM aggtest;
 SELECT max(aggtest.b) AS max_324_78 FROM aggtest;
@@ -431,3 +437,13 @@ insert into bytea_test_table values(decode('aa','hex'));
 select bytea_agg(v) from bytea_test_table;
 
 drop table bytea_test_table;
+
+-- hashed aggregation with more groups than fit in work_mem
+set work_mem = '64kB';
+set enable_sort = off;
+select cnt, count(*), sum(s) from
+  (select g % 3000 as k, count(*) as cnt, sum(g::numeric) as s
+   from generate_series(1, 10000) g group by g % 3000) ss
+group by cnt order by cnt;
+reset enable_sort;
+reset work_mem;
@@ -1463,3 +1463,32 @@ ALTER TABLE ONLY test_drop_constr_parent DROP CONSTRAINT "test_drop_constr_paren
 -- should fail
 INSERT INTO test_drop_constr_child (c) VALUES (NULL);
 DROP TABLE test_drop_constr_parent CASCADE;
+
+-- adding a column with a non-volatile default doesn't rewrite the table
+CREATE TABLE test_add_default (a int);
+INSERT INTO test_add_default VALUES (1), (2);
+CREATE TEMP TABLE test_add_default_node AS
+  SELECT relfilenode FROM pg_class WHERE oid = 'test_add_default'::regclass;
+ALTER TABLE test_add_default ADD COLUMN b int NOT NULL DEFAULT 10,
+  ADD COLUMN c text DEFAULT 'x' || 'y';
+SELECT c.relfilenode = n.relfilenode AS same_file
+  FROM pg_class c, test_add_default_node n
+  WHERE c.oid = 'test_add_default'::regclass;
+SELECT attname, atthasmissing, attmissingval FROM pg_attribute
+  WHERE attrelid = 'test_add_default'::regclass AND attnum > 0
+  ORDER BY attnum;
+INSERT INTO test_add_default (a) VALUES (3);
+UPDATE test_add_default SET c = 'z' WHERE a = 2;
+SELECT * FROM test_add_default ORDER BY a;
+SELECT count(*) FROM test_add_default WHERE b IS NULL OR c IS NULL;
+-- rewriting the table stores the values in the rows
+VACUUM FULL test_add_default;
+SELECT attname, atthasmissing FROM pg_attribute
+  WHERE attrelid = 'test_add_default'::regclass AND attnum > 0
+  ORDER BY attnum;
+SELECT * FROM test_add_default ORDER BY a;
+-- a volatile default is computed for each row
+ALTER TABLE test_add_default ADD COLUMN d float8 DEFAULT random();
+SELECT count(DISTINCT d) FROM test_add_default;
+DROP TABLE test_add_default;
+DROP TABLE test_add_default_node;
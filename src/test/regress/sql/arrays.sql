@@ -255,6 +255,17 @@ select 33 = all (null::int[]);
 select null::int = all ('{1,2,3}');
 select 33 = all ('{1,null,3}');
 select 33 = all ('{33,null,33}');
+-- large constant arrays are looked up in a hash table
+select 33 = any ('{1,2,3,4,5,6,7,8,9,33}');
+select 34 = any ('{1,2,3,4,5,6,7,8,9,33}');
+select 34 = any ('{1,2,3,4,5,6,7,8,9,null}');
+select 9 = any ('{1,2,3,4,5,6,7,8,9,null}');
+select null::int = any ('{1,2,3,4,5,6,7,8,9,33}');
+select 33 <> all ('{1,2,3,4,5,6,7,8,9,33}');
+select 34 <> all ('{1,2,3,4,5,6,7,8,9,33}');
+select 34 <> all ('{1,2,3,4,5,6,7,8,9,null}');
+select 'j'::text in ('a','b','c','d','e','f','g','h','i','j');
+select 'k'::text in ('a','b','c','d','e','f','g','h','i','j');
 
 -- test indexes on arrays
 create temp table arr_tbl (f1 int[] unique);
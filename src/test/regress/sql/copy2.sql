@@ -110,6 +110,11 @@ INSERT INTO no_oids (a, b) VALUES (20, 30);
 -- should fail
 COPY no_oids FROM stdin WITH OIDS;
 COPY no_oids TO stdout WITH OIDS;
+-- columnar format takes its own option, for output only
+COPY no_oids FROM stdin (FORMAT columnar, ROW_GROUP_SIZE 10);
+COPY no_oids TO stdout (FORMAT columnar, OIDS);
+COPY no_oids TO stdout (ROW_GROUP_SIZE 10);
+COPY no_oids TO stdout (FORMAT columnar, ROW_GROUP_SIZE 0);
 
 -- check copy out
 COPY x TO stdout;
@@ -164,6 +169,20 @@ c\.d
 
 COPY testeoc TO stdout CSV;
 
+-- test fields and lines longer than the bulk scanning block size
+CREATE TEMP TABLE testlong (a text, b text);
+
+COPY testlong FROM stdin;
+abcdefghijklmnopqrstuvwxyz0123456789	ABCDEFGHIJKLMNOPQRSTUVWXYZ\t0123456789
+0123456789012345678901234567890\\x	\N
+\.
+
+COPY testlong FROM stdin CSV;
+"a quoted field that is longer than sixteen bytes, with a ""quote""",unquoted field longer than sixteen bytes
+\.
+
+COPY testlong TO stdout;
+
 DROP TABLE x, y;
 DROP FUNCTION fn_x_before();
 DROP FUNCTION fn_x_after();
@@ -71,3 +71,38 @@ create aggregate aggfns(integer,integer,text) (
    sfunc = aggfns_trans, stype = aggtype[],
    initcond = '{}'
 );
+
+-- aggregate with a combine function
+create aggregate newavg_comb (
+   sfunc = int4_avg_accum, basetype = int4, stype = _int8,
+   finalfunc = int8_avg, combinefunc = int4_avg_combine,
+   initcond = '{0,0}'
+);
+
+select aggcombinefn from pg_aggregate
+where aggfnoid = 'newavg_comb'::regproc;
+
+-- merging two partial states must give the same answer as one pass
+select int8_avg(int4_avg_combine('{2,10}', '{3,20}'));
+
+-- combine function must take and return the transition type
+create aggregate newavg_badcomb (
+   sfunc = int4_avg_accum, basetype = int4, stype = _int8,
+   finalfunc = int8_avg, combinefunc = int4pl,
+   initcond = '{0,0}'
+);
+
+-- aggregate with an inverse transition function
+create aggregate newsum_inv (
+   sfunc = int4_sum, basetype = int4, stype = int8,
+   invfunc = int4_sum_inv
+);
+
+select agginvtransfn from pg_aggregate
+where aggfnoid = 'newsum_inv'::regproc;
+
+-- inverse transition function must take the transition function's arguments
+create aggregate newsum_badinv (
+   sfunc = int4_sum, basetype = int4, stype = int8,
+   invfunc = int4_avg_accum_inv
+);
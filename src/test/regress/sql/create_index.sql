@@ -186,6 +186,8 @@ SELECT count(*) FROM quad_point_tbl WHERE p >^ '(5000, 4000)';
 
 SELECT count(*) FROM quad_point_tbl WHERE p ~= '(4585, 365)';
 
+SELECT p FROM quad_point_tbl WHERE p <@ box '(200,200,1000,1000)' ORDER BY p <-> '(500,500)' LIMIT 5;
+
 SELECT count(*) FROM suffix_text_tbl WHERE t = 'P0123456789abcdef';
 
 SELECT count(*) FROM suffix_text_tbl WHERE t = 'P0123456789abcde';
@@ -361,6 +363,14 @@ EXPLAIN (COSTS OFF)
 SELECT count(*) FROM kd_point_tbl WHERE p ~= '(4585, 365)';
 SELECT count(*) FROM kd_point_tbl WHERE p ~= '(4585, 365)';
 
+EXPLAIN (COSTS OFF)
+SELECT p FROM quad_point_tbl WHERE p <@ box '(200,200,1000,1000)' ORDER BY p <-> '(500,500)' LIMIT 5;
+SELECT p FROM quad_point_tbl WHERE p <@ box '(200,200,1000,1000)' ORDER BY p <-> '(500,500)' LIMIT 5;
+
+EXPLAIN (COSTS OFF)
+SELECT p FROM kd_point_tbl WHERE p <@ box '(200,200,1000,1000)' ORDER BY p <-> '(500,500)' LIMIT 5;
+SELECT p FROM kd_point_tbl WHERE p <@ box '(200,200,1000,1000)' ORDER BY p <-> '(500,500)' LIMIT 5;
+
 EXPLAIN (COSTS OFF)
 SELECT count(*) FROM suffix_text_tbl WHERE t = 'P0123456789abcdef';
 SELECT count(*) FROM suffix_text_tbl WHERE t = 'P0123456789abcdef';
@@ -534,6 +544,31 @@ RESET enable_seqscan;
 RESET enable_indexscan;
 RESET enable_bitmapscan;
 
+--
+-- GiST index over enough points to need several levels, which is built
+-- by sorting the keys.  point_ops can return the points from the index, so
+-- index-only scans are possible.
+--
+CREATE TABLE gist_point_tbl AS
+    SELECT point(i % 100, i / 100) AS p FROM generate_series(0, 9999) i;
+CREATE INDEX gist_point_idx ON gist_point_tbl USING gist (p);
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM gist_point_tbl WHERE p <@ box(point(10,10), point(19,29));
+SELECT count(*) FROM gist_point_tbl WHERE p <@ box(point(10,10), point(19,29));
+
+EXPLAIN (COSTS OFF)
+SELECT p FROM gist_point_tbl ORDER BY p <-> point(50.2, 50.1) LIMIT 3;
+SELECT p FROM gist_point_tbl ORDER BY p <-> point(50.2, 50.1) LIMIT 3;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE gist_point_tbl;
+
 --
 -- GIN over int[] and text[]
 --
@@ -689,6 +724,18 @@ BEGIN;
 CREATE INDEX std_index on concur_heap(f2);
 COMMIT;
 
+-- Rebuild the indexes concurrently; invalid ones can't be
+REINDEX TABLE CONCURRENTLY concur_heap;
+REINDEX INDEX CONCURRENTLY concur_index3;
+REINDEX INDEX CONCURRENTLY concur_index2;
+-- the rebuilt unique index is still enforced
+INSERT INTO concur_heap VALUES ('b','x');
+-- not in a transaction, and not on system catalogs
+BEGIN;
+REINDEX TABLE CONCURRENTLY concur_heap;
+COMMIT;
+REINDEX TABLE CONCURRENTLY pg_class;
+
 -- check to make sure that the failed indexes were cleaned up properly and the
 -- successful indexes are created properly. Notably that they do NOT have the
 -- "invalid" flag set.
@@ -819,3 +866,244 @@ EXPLAIN (COSTS OFF)
     WHERE f1 > 'LX' and id < 1000 and f1 ~<~ 'YX';
 SELECT count(*) FROM dupindexcols
   WHERE f1 > 'LX' and id < 1000 and f1 ~<~ 'YX';
+
+--
+-- Check skip scans over a low-cardinality leading column
+--
+
+CREATE TABLE skipscan AS
+  SELECT unique1 % 4 AS a, unique1 AS b FROM tenk1;
+INSERT INTO skipscan VALUES (NULL, 5);
+CREATE INDEX skipscan_a_b ON skipscan (a, b);
+VACUUM ANALYZE skipscan;
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+SELECT a, b FROM skipscan WHERE b = 4321;
+SELECT a, b FROM skipscan WHERE b = 5 ORDER BY a;
+SELECT a, b FROM skipscan WHERE b < 3 ORDER BY a, b;
+SELECT a, b FROM skipscan WHERE b < 3 ORDER BY a DESC, b DESC;
+
+SET enable_indexscan = OFF;
+SET enable_bitmapscan = ON;
+
+SELECT count(*) FROM skipscan WHERE b BETWEEN 100 AND 199;
+
+RESET enable_seqscan;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+
+DROP TABLE skipscan;
+
+--
+-- Test BRIN indexes
+--
+
+CREATE TABLE brin_test (a int4, b timestamp);
+INSERT INTO brin_test
+  SELECT i, CASE WHEN i % 7 <> 0 THEN '2000-01-01'::timestamp + i * interval '1 minute' END
+  FROM generate_series(1, 10000) i;
+CREATE INDEX brin_test_a_idx ON brin_test USING brin (a) WITH (pages_per_range = 2);
+CREATE INDEX brin_test_b_idx ON brin_test USING brin (b);
+
+SET enable_seqscan = OFF;
+
+EXPLAIN (COSTS OFF)
+SELECT count(*) FROM brin_test WHERE a BETWEEN 100 AND 200;
+SELECT count(*) FROM brin_test WHERE a BETWEEN 100 AND 200;
+SELECT count(*) FROM brin_test WHERE a = 5000;
+SELECT count(*) FROM brin_test WHERE b < '2000-01-01 01:00';
+
+-- summaries must be widened by later insertions
+INSERT INTO brin_test VALUES (20000, NULL), (-1, '1999-12-31');
+SELECT count(*) FROM brin_test WHERE a > 15000;
+SELECT count(*) FROM brin_test WHERE a < 1;
+SELECT count(*) FROM brin_test WHERE b < '2000-01-01';
+
+RESET enable_seqscan;
+
+DROP TABLE brin_test;
+
+--
+-- Test deduplication of B-tree entries into posting lists
+--
+
+CREATE TABLE dedup_test (id int4, status int4);
+INSERT INTO dedup_test SELECT i, i % 4 FROM generate_series(1, 10000) i;
+CREATE INDEX dedup_test_id_idx ON dedup_test (id);
+CREATE INDEX dedup_test_status_idx ON dedup_test (status);
+
+-- the index on the low-cardinality column should be much the smaller
+SELECT pg_relation_size('dedup_test_status_idx') <
+       pg_relation_size('dedup_test_id_idx') / 2 AS smaller;
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+SELECT count(*) FROM dedup_test WHERE status = 1;
+SELECT min(id), max(id) FROM dedup_test WHERE status = 2;
+
+-- insertions into full pages merge duplicates before splitting
+INSERT INTO dedup_test SELECT i, 3 FROM generate_series(10001, 12000) i;
+SELECT count(*) FROM dedup_test WHERE status = 3;
+
+-- vacuum must remove individual TIDs from posting lists
+DELETE FROM dedup_test WHERE id % 10 = 0;
+VACUUM dedup_test;
+SELECT count(*) FROM dedup_test WHERE status = 0;
+SELECT count(*) FROM dedup_test WHERE status = 3;
+SELECT id FROM dedup_test WHERE status BETWEEN 1 AND 2
+  ORDER BY status DESC LIMIT 3;
+
+DELETE FROM dedup_test WHERE status = 1;
+VACUUM dedup_test;
+SELECT count(*) FROM dedup_test WHERE status = 1;
+SELECT count(*) FROM dedup_test WHERE status >= 0;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE dedup_test;
+
+--
+-- Test B-tree suffix truncation on a wide composite key
+--
+CREATE TABLE trunc_test (a int, b text);
+CREATE INDEX trunc_test_idx ON trunc_test (a, b);
+
+-- the index is built by insertions, which truncate at leaf splits
+INSERT INTO trunc_test
+  SELECT i / 10, repeat('x', 500) || i FROM generate_series(1, 2000) i;
+
+-- a unique index built by the sort path
+CREATE UNIQUE INDEX trunc_test_uidx ON trunc_test (a, b);
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+SELECT count(*) FROM trunc_test WHERE a = 50;
+SELECT count(*) FROM trunc_test WHERE a BETWEEN 10 AND 19;
+SELECT a, right(b, 4) FROM trunc_test
+  WHERE a = 100 AND b > repeat('x', 500) || '1005' ORDER BY a, b;
+SELECT a, right(b, 4) FROM trunc_test ORDER BY a DESC, b DESC LIMIT 3;
+
+-- keys equal on the leading column must still be found on either side
+INSERT INTO trunc_test
+  SELECT 100, repeat('x', 500) || 'z' || i FROM generate_series(1, 50) i;
+SELECT count(*) FROM trunc_test WHERE a = 100;
+SELECT count(*) FROM trunc_test WHERE a = 101;
+SELECT count(*) FROM trunc_test WHERE a = 100 AND b >= (repeat('x', 500) || 'z');
+
+-- uniqueness checks must not be fooled by truncated high keys
+INSERT INTO trunc_test VALUES (50, repeat('x', 500) || '500');
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE trunc_test;
+
+--
+-- Test B-tree builds that sort the table in several parts
+--
+CREATE TABLE part_build (id int, val int);
+INSERT INTO part_build SELECT i, i % 100 FROM generate_series(1, 5000) i;
+
+SET btree_build_partitions = 4;
+CREATE INDEX part_build_val_idx ON part_build (val);
+CREATE UNIQUE INDEX part_build_id_idx ON part_build (id);
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+SELECT count(*) FROM part_build WHERE val = 42;
+SELECT count(*) FROM part_build WHERE val >= 90;
+SELECT id FROM part_build WHERE val = 7 ORDER BY val LIMIT 3;
+SELECT id FROM part_build ORDER BY id DESC LIMIT 3;
+
+-- duplicates in different parts must be detected
+DROP INDEX part_build_id_idx;
+INSERT INTO part_build VALUES (1, 0);
+CREATE UNIQUE INDEX part_build_id_idx ON part_build (id);
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET btree_build_partitions;
+
+DROP TABLE part_build;
+
+--
+-- Test the fast path for insertions into the rightmost leaf page
+--
+CREATE TABLE fastpath_test (k text PRIMARY KEY);
+INSERT INTO fastpath_test
+  SELECT lpad(i::text, 4, '0') || repeat('x', 500) FROM generate_series(1, 1000) i;
+INSERT INTO fastpath_test
+  SELECT lpad(i::text, 4, '0') || repeat('x', 500) FROM generate_series(1001, 1200) i;
+
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+
+SELECT count(*) FROM fastpath_test WHERE k > '1000';
+SELECT left(k, 4) FROM fastpath_test ORDER BY k DESC LIMIT 2;
+-- a duplicate of the last key must still be caught
+INSERT INTO fastpath_test VALUES ('1200' || repeat('x', 500));
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE fastpath_test;
+
+--
+-- Test non-key INCLUDE columns
+--
+CREATE TABLE tbl_include (c1 int, c2 int, c3 int, c4 box);
+INSERT INTO tbl_include SELECT x, 2*x, 3*x, box('4,4,4,4') FROM generate_series(1,10) AS x;
+-- included columns need no operator class, so box is fine here
+CREATE UNIQUE INDEX tbl_include_unique ON tbl_include (c1, c2) INCLUDE (c3, c4);
+SELECT pg_get_indexdef('tbl_include_unique'::regclass);
+SELECT pg_get_indexdef('tbl_include_unique'::regclass, 3, true);
+SELECT indnatts, indnkeyatts, indclass, indoption FROM pg_index
+  WHERE indexrelid = 'tbl_include_unique'::regclass;
+
+-- uniqueness is checked on the key columns only
+INSERT INTO tbl_include VALUES (1, 2, 99, NULL);
+INSERT INTO tbl_include VALUES (1, 3, 3, NULL);
+
+-- an index-only scan can return the included columns
+VACUUM ANALYZE tbl_include;
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+EXPLAIN (costs off)
+SELECT c1, c2, c3 FROM tbl_include WHERE c1 = 5;
+SELECT c1, c2, c3 FROM tbl_include WHERE c1 = 5;
+-- but they are not searched on, and give no ordering
+EXPLAIN (costs off)
+SELECT c1, c3 FROM tbl_include WHERE c3 = 6;
+EXPLAIN (costs off)
+SELECT c1, c2, c3 FROM tbl_include ORDER BY c1, c2, c3;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+-- included columns can't have an operator class, ordering or collation
+CREATE INDEX tbl_include_bad ON tbl_include (c1) INCLUDE (c3 int4_ops);
+CREATE INDEX tbl_include_bad ON tbl_include (c1) INCLUDE (c3 ASC);
+CREATE INDEX tbl_include_bad ON tbl_include (c1) INCLUDE (c3 DESC);
+CREATE INDEX tbl_include_bad ON tbl_include (c1) INCLUDE (c3 NULLS FIRST);
+CREATE INDEX tbl_include_bad ON tbl_include (c1) INCLUDE (c3 COLLATE "C");
+CREATE INDEX tbl_include_bad ON tbl_include (c1) INCLUDE ((c3 + 1));
+CREATE INDEX tbl_include_bad ON tbl_include USING hash (c1) INCLUDE (c3);
+
+-- included columns stay out of the internal pages of a bigger index
+CREATE TABLE tbl_include_big (k int, payload text);
+CREATE UNIQUE INDEX tbl_include_big_idx ON tbl_include_big (k) INCLUDE (payload);
+INSERT INTO tbl_include_big SELECT x, repeat('x', 200) FROM generate_series(1, 5000) x;
+INSERT INTO tbl_include_big VALUES (2500, 'dup');
+VACUUM ANALYZE tbl_include_big;
+SET enable_seqscan = OFF;
+SET enable_bitmapscan = OFF;
+SELECT count(*), sum(length(payload)) FROM tbl_include_big WHERE k BETWEEN 1000 AND 3999;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE tbl_include, tbl_include_big;
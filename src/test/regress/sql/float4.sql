@@ -81,3 +81,27 @@ UPDATE FLOAT4_TBL
    WHERE FLOAT4_TBL.f1 > '0.0';
 
 SELECT '' AS five, * FROM FLOAT4_TBL;
+
+-- shortest exact output, used when extra_float_digits is positive
+SET extra_float_digits = 3;
+
+SELECT '' AS five, * FROM FLOAT4_TBL;
+
+SELECT f1 AS input, f1::float4 AS output
+  FROM (VALUES ('0'), ('-0'), ('0.1'), ('-0.1'), ('100'), ('1e6'), ('1e7'),
+               ('1e-4'), ('1e-5'), ('16777217'), ('3.4028235e+38'),
+               ('1.17549435e-38'), ('1e-45'), ('1.4e-45'),
+               ('Infinity'), ('-Infinity'), ('NaN')) AS v(f1);
+
+SELECT '-0'::float4 = '0'::float4 AS eq, '0.1'::float4::float8 AS widened;
+
+-- float4 input goes through the same fast path as float8
+SELECT fast, fast::float4 AS output, fast::float4 = slow::float4 AS same
+  FROM (VALUES ('1.1754944e-38', '1.17549440000000000000e-38'),
+               ('123456789012345', '123456789012345.000000'),
+               ('1234567890123456', '1234567890123456.000000'),
+               ('1e22', '1.00000000000000000000e22'),
+               ('1e23', '1.00000000000000000000e23'),
+               ('3.14159', '3.14159000000000000000')) AS v(fast, slow);
+
+RESET extra_float_digits;
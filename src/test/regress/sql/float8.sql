@@ -167,3 +167,43 @@ INSERT INTO FLOAT8_TBL(f1) VALUES ('-1.2345678901234e+200');
 INSERT INTO FLOAT8_TBL(f1) VALUES ('-1.2345678901234e-200');
 
 SELECT '' AS five, * FROM FLOAT8_TBL;
+
+-- shortest exact output, used when extra_float_digits is positive
+SET extra_float_digits = 3;
+
+SELECT '' AS five, * FROM FLOAT8_TBL;
+
+SELECT f1 AS input, f1::float8 AS output
+  FROM (VALUES ('0'), ('-0'), ('0.1'), ('-0.1'), ('0.3'), ('100'),
+               ('1e15'), ('1e16'), ('1e17'), ('1e-4'), ('1e-5'),
+               ('123456789012345678'), ('9007199254740993'),
+               ('0.30000000000000004'), ('2.2250738585072014e-308'),
+               ('1.7976931348623157e+308'), ('-1.2345678901234e+200'),
+               ('Infinity'), ('-Infinity'), ('NaN')) AS v(f1);
+
+SELECT '0.1'::float8 + '0.2'::float8 AS sum, '1'::float8 / '3'::float8 AS third;
+
+-- zeroes of both signs compare equal but are printed differently
+SELECT '-0'::float8 = '0'::float8 AS eq, '-0'::float8, - '0'::float8;
+
+-- denormals can't be typed in, but arithmetic can reach them
+SELECT '2.2250738585072014e-308'::float8 / '2'::float8 AS half_min,
+       '2.2250738585072014e-308'::float8 / '4503599627370496'::float8 AS smallest,
+       '1e-300'::float8 * '1e-20'::float8 AS small;
+
+-- the fast input path takes up to 15 significant digits and a power of ten
+-- of magnitude up to 22; check both sides of those limits against inputs
+-- that go through strtod()
+SELECT fast, fast::float8 AS output, fast::float8 = slow::float8 AS same
+  FROM (VALUES ('123456789012345', '123456789012345.000000'),
+               ('1234567890123456', '1234567890123456.000000'),
+               ('0.000123456789012345', '1.23456789012345000000e-4'),
+               ('1e22', '1.00000000000000000000e22'),
+               ('1e23', '1.00000000000000000000e23'),
+               ('1e-22', '1.00000000000000000000e-22'),
+               ('1e-23', '1.00000000000000000000e-23'),
+               ('123456789012345e22', '1.23456789012345000000e36'),
+               ('-4.35e-7', '-4.35000000000000000000e-7'),
+               ('1.5', '1.50000000000000000000')) AS v(fast, slow);
+
+RESET extra_float_digits;
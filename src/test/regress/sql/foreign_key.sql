@@ -943,3 +943,43 @@ begin;
     update selfref set a = 456 where a = 123;
     select a, b from selfref;
 commit;
+
+--
+-- Repeated keys are verified only once per subtransaction
+--
+create temp table pktable_dedup (id int primary key);
+create temp table fktable_dedup (id int references pktable_dedup);
+insert into pktable_dedup values (1), (2);
+insert into fktable_dedup select 1 from generate_series(1, 10);
+insert into fktable_dedup select 1 from generate_series(1, 10) union all select 3;
+begin;
+    savepoint sp;
+    insert into fktable_dedup values (2);
+    rollback to sp;
+    delete from pktable_dedup where id = 2;
+    insert into fktable_dedup values (2);
+rollback;
+select id, count(*) from fktable_dedup group by id;
+-- a PK row deleted after its key was verified must be looked up again
+begin;
+    insert into fktable_dedup values (1);
+    delete from fktable_dedup;
+    delete from pktable_dedup where id = 1;
+    insert into fktable_dedup values (1);
+rollback;
+create temp table fktable_dedup_cascade
+    (id int references pktable_dedup on delete cascade);
+begin;
+    insert into fktable_dedup_cascade values (2);
+    delete from pktable_dedup where id = 2;
+    select count(*) from fktable_dedup_cascade;
+    insert into fktable_dedup_cascade values (2);
+rollback;
+-- likewise after TRUNCATE
+begin;
+    insert into fktable_dedup_cascade values (2);
+    truncate pktable_dedup cascade;
+    insert into fktable_dedup_cascade values (2);
+rollback;
+select id, count(*) from fktable_dedup_cascade group by id;
+drop table fktable_dedup_cascade, fktable_dedup, pktable_dedup;
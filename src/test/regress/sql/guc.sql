@@ -251,3 +251,16 @@ set work_mem = '1MB';
 select myfunc(0);
 select current_setting('work_mem');
 select myfunc(1), current_setting('work_mem');
+
+--
+-- Test the limits on the catalog and relation caches
+--
+set max_catcache_entries = 100;
+set max_relcache_entries = 50;
+select count(*) > 1000 as ok from (select oid::regprocedure::text from pg_proc) s;
+select count(pg_relation_size(oid)) > 50 as ok from pg_class
+  where relnamespace = (select oid from pg_namespace where nspname = 'pg_catalog')
+    and relkind in ('r', 'i');
+select cache, evictions > 0 as evicted from pg_stat_get_catalog_caches() order by cache;
+reset max_catcache_entries;
+reset max_relcache_entries;
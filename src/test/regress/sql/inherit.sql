@@ -354,3 +354,115 @@ ORDER BY thousand, tenthous;
 reset enable_seqscan;
 reset enable_indexscan;
 reset enable_bitmapscan;
+
+--
+-- Range partitions are looked up through the parent's partition descriptor,
+-- without locking the partitions that can't match
+--
+create table prange (k int, v text);
+create table prange_1 (check (k >= 0 and k < 10)) inherits (prange);
+create table prange_2 (check (k >= 10 and k < 20)) inherits (prange);
+create table prange_3 (check (k >= 20 and k < 30)) inherits (prange);
+create table prange_x () inherits (prange);
+insert into prange_1 values (1, 'a'), (5, 'b');
+insert into prange_2 values (15, 'c');
+insert into prange_3 values (25, 'd');
+insert into prange_x values (35, 'x'), (null, 'n');
+
+create view plocks as
+  select c.relname from pg_locks l join pg_class c on c.oid = l.relation
+  where l.pid = pg_backend_pid() and c.relname like 'prange%'
+  order by 1;
+
+explain (costs off) select count(*) from prange where k = 15;
+explain (costs off) select count(*) from prange where 15 = k;
+explain (costs off) select count(*) from prange where k >= 5 and k < 12;
+explain (costs off) select count(*) from prange where k > 100;
+select * from prange where k = 5 order by v;
+select * from prange where k between 10 and 35 order by k;
+
+begin;
+select count(*) from prange where k = 15;
+select * from plocks;
+commit;
+
+-- a new partition constraint, or a partition leaving, must be noticed
+alter table prange_x add constraint prange_x_k check (k >= 30);
+begin;
+select count(*) from prange where k = 15;
+select * from plocks;
+commit;
+alter table prange_2 no inherit prange;
+select count(*) from prange where k = 15;
+alter table prange_2 inherit prange;
+select count(*) from prange where k = 15;
+
+-- values known only at run time prune partitions when the query runs
+explain (costs off) select count(*) from prange
+  where k = current_setting('geqo_threshold')::int;
+select o.k, (select count(*) from prange p where p.k = o.k) as n
+  from (values (1), (15), (25), (35), (null::int)) o(k) order by 1;
+prepare prange_q(int, int) as
+  select string_agg(v, '' order by k) from prange where k >= $1 and k < $2;
+execute prange_q(0, 10);
+execute prange_q(0, 16);
+execute prange_q(12, 26);
+execute prange_q(30, 40);
+execute prange_q(25, 35);
+execute prange_q(5, 6);
+execute prange_q(0, 100);
+deallocate prange_q;
+
+-- overlapping ranges can't be looked up, so every partition is locked
+alter table prange_x drop constraint prange_x_k;
+alter table prange_x add constraint prange_x_k check (k >= 25);
+begin;
+select count(*) from prange where k = 15;
+select * from plocks;
+commit;
+
+drop view plocks;
+drop table prange_1, prange_2, prange_3, prange_x;
+drop table prange;
+
+-- Joins between identically partitioned tables can be done partition by
+-- partition, provided the parents can hold no rows themselves
+create table pjoin_a (k int, a text);
+alter table only pjoin_a add constraint pjoin_a_empty check (false);
+create table pjoin_a_1 (check (k >= 0 and k < 10)) inherits (pjoin_a);
+create table pjoin_a_2 (check (k >= 10 and k < 20)) inherits (pjoin_a);
+create table pjoin_a_3 (check (k >= 20 and k < 30)) inherits (pjoin_a);
+create table pjoin_b (k int, b text);
+alter table only pjoin_b add constraint pjoin_b_empty check (false);
+create table pjoin_b_1 (check (k >= 0 and k < 10)) inherits (pjoin_b);
+create table pjoin_b_2 (check (k >= 10 and k < 20)) inherits (pjoin_b);
+create table pjoin_b_3 (check (k >= 20 and k < 30)) inherits (pjoin_b);
+insert into pjoin_a_1 select i % 10, 'a' || i from generate_series(1, 100) i;
+insert into pjoin_a_2 select i % 10 + 10, 'a' || i from generate_series(1, 100) i;
+insert into pjoin_a_3 select i % 10 + 20, 'a' || i from generate_series(1, 100) i;
+insert into pjoin_b_1 values (5, 'b5');
+insert into pjoin_b_2 values (19, 'b19');
+insert into pjoin_b_3 values (25, 'b25');
+analyze pjoin_a_1;
+analyze pjoin_a_2;
+analyze pjoin_a_3;
+analyze pjoin_b_1;
+analyze pjoin_b_2;
+analyze pjoin_b_3;
+insert into pjoin_a values (1, 'x');  -- fail
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+explain (costs off)
+select * from pjoin_a a join pjoin_b b on a.k = b.k;
+select b.k, count(*) from pjoin_a a join pjoin_b b on a.k = b.k
+  group by b.k order by b.k;
+select b.k, count(a.k) from pjoin_b b left join pjoin_a a on a.k = b.k
+  group by b.k order by b.k;
+set enable_partitionwise_join = off;
+select b.k, count(a.k) from pjoin_b b left join pjoin_a a on a.k = b.k
+  group by b.k order by b.k;
+reset enable_partitionwise_join;
+reset enable_hashjoin;
+reset enable_mergejoin;
+drop table pjoin_a_1, pjoin_a_2, pjoin_a_3, pjoin_b_1, pjoin_b_2, pjoin_b_3;
+drop table pjoin_a, pjoin_b;
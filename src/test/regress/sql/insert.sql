@@ -36,3 +36,26 @@ insert into inserttest values(30, 50, repeat('x', 10000));
 select col1, col2, char_length(col3) from inserttest;
 
 drop table inserttest;
+
+--
+-- INSERT ... SELECT writes its rows in batches; check that indexes,
+-- triggers and volatile functions still see what they should
+--
+create table insertbatch (a int primary key, b text);
+insert into insertbatch select g, repeat('x', g % 100) from generate_series(1, 2500) g;
+select count(*), count(distinct b), sum(a) from insertbatch;
+insert into insertbatch select g from generate_series(2400, 2600) g;
+create table insertbatch_log (n int);
+create function insertbatch_trig() returns trigger language plpgsql as
+$$ begin insert into insertbatch_log values (new.a); return null; end $$;
+create trigger insertbatch_after after insert on insertbatch
+    for each row execute procedure insertbatch_trig();
+insert into insertbatch select g, 'y' from generate_series(2501, 3000) g;
+select count(*), min(n), max(n) from insertbatch_log;
+create function insertbatch_rows() returns bigint language sql volatile as
+'select count(*) from insertbatch';
+insert into insertbatch select 3000 + g, insertbatch_rows() from generate_series(1, 3) g;
+select * from insertbatch where a > 3000 order by a;
+drop table insertbatch, insertbatch_log;
+drop function insertbatch_trig();
+drop function insertbatch_rows();
@@ -759,3 +759,50 @@ SELECT * FROM
   ON true;
 
 rollback;
+
+--
+-- searching join orders a few relations at a time
+--
+set join_search_limit = 2;
+
+select count(*) from tenk1 a, tenk1 b, tenk1 c, onek d
+  where a.unique1 = b.unique2 and b.unique1 = c.thousand
+    and c.unique1 = d.unique1;
+
+reset join_search_limit;
+
+--
+-- caching the results of inner index scans for repeated outer values
+--
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+
+explain (costs off)
+select count(*) from onek o join tenk1 t on t.unique1 = o.twenty;
+select count(*) from onek o join tenk1 t on t.unique1 = o.twenty;
+select count(*), count(t.unique1)
+  from onek o left join tenk1 t on t.unique1 = o.twenty * 1000;
+
+set enable_memoize = off;
+select count(*), count(t.unique1)
+  from onek o left join tenk1 t on t.unique1 = o.twenty * 1000;
+
+reset enable_memoize;
+reset enable_hashjoin;
+reset enable_mergejoin;
+
+--
+-- a join to a unique inner side stops at the first match
+--
+create table uj_pk (k int primary key, v int);
+create table uj_fk (k int, v int);
+set enable_mergejoin = off;
+
+explain (verbose, costs off)
+select f.v, p.v from uj_fk f left join uj_pk p on f.k = p.k;
+-- but not when joining on a non-unique column
+explain (verbose, costs off)
+select f.v, p.v from uj_fk f left join uj_pk p on f.k = p.v;
+
+reset enable_mergejoin;
+drop table uj_pk, uj_fk;
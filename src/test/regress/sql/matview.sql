@@ -0,0 +1,117 @@
+--
+-- MATVIEW
+--
+
+-- create a table to use as a basis for materialized views
+CREATE TABLE mvtest_t (id int NOT NULL PRIMARY KEY, type text NOT NULL, amt numeric NOT NULL);
+INSERT INTO mvtest_t VALUES
+  (1, 'x', 2),
+  (2, 'x', 3),
+  (3, 'y', 5),
+  (4, 'y', 7),
+  (5, 'z', 11);
+
+-- create a materialized view with no data, and confirm correct behavior
+CREATE MATERIALIZED VIEW mvtest_tm AS SELECT type, sum(amt) AS totamt FROM mvtest_t GROUP BY type WITH NO DATA;
+SELECT relkind FROM pg_class WHERE oid = 'mvtest_tm'::regclass;
+SELECT * FROM mvtest_tm;
+SELECT count(*) FROM mvtest_tm WHERE type = 'x';
+REFRESH MATERIALIZED VIEW mvtest_tm;
+CREATE UNIQUE INDEX mvtest_tm_type ON mvtest_tm (type);
+SELECT * FROM mvtest_tm ORDER BY type;
+
+-- create various views
+CREATE MATERIALIZED VIEW mvtest_tvm AS SELECT * FROM mvtest_t WHERE type <> 'z';
+SELECT * FROM mvtest_tvm ORDER BY id;
+CREATE MATERIALIZED VIEW mvtest_tmm AS SELECT sum(totamt) AS grandtot FROM mvtest_tm;
+
+-- the data can be queried and indexed like a table's
+CREATE INDEX mvtest_tvm_amt ON mvtest_tvm (amt);
+SET enable_seqscan = off;
+EXPLAIN (costs off)
+  SELECT id FROM mvtest_tvm WHERE amt = 5;
+SELECT id FROM mvtest_tvm WHERE amt = 5;
+RESET enable_seqscan;
+
+-- modify the underlying table data; the materialized views don't change
+INSERT INTO mvtest_t VALUES (6, 'z', 13);
+SELECT * FROM mvtest_tm ORDER BY type;
+SELECT * FROM mvtest_tmm;
+
+-- a refresh brings them up to date, in dependency order
+REFRESH MATERIALIZED VIEW mvtest_tm;
+SELECT * FROM mvtest_tm ORDER BY type;
+REFRESH MATERIALIZED VIEW mvtest_tmm;
+SELECT * FROM mvtest_tmm;
+
+-- WITH NO DATA empties a populated materialized view
+REFRESH MATERIALIZED VIEW mvtest_tvm WITH NO DATA;
+SELECT * FROM mvtest_tvm;
+SET enable_seqscan = off;
+SELECT * FROM mvtest_tvm WHERE amt = 5;
+RESET enable_seqscan;
+REFRESH MATERIALIZED VIEW mvtest_tvm;
+SELECT * FROM mvtest_tvm ORDER BY id;
+
+-- materialized views can't be changed directly
+INSERT INTO mvtest_tm VALUES ('w', 1);
+UPDATE mvtest_tm SET totamt = 0;
+DELETE FROM mvtest_tm;
+TRUNCATE mvtest_tm;
+SELECT * FROM mvtest_tm ORDER BY type;
+
+-- a concurrent refresh changes only the rows that differ
+SELECT ctid, * FROM mvtest_tm ORDER BY type;
+UPDATE mvtest_t SET amt = 4 WHERE id = 4;
+DELETE FROM mvtest_t WHERE id = 1;
+INSERT INTO mvtest_t VALUES (7, 'w', 17);
+REFRESH MATERIALIZED VIEW CONCURRENTLY mvtest_tm;
+SELECT ctid, * FROM mvtest_tm ORDER BY type;
+
+-- an unchanged result leaves every row in place
+REFRESH MATERIALIZED VIEW CONCURRENTLY mvtest_tm;
+SELECT ctid, * FROM mvtest_tm ORDER BY type;
+
+-- CONCURRENTLY can't be combined with WITH NO DATA
+REFRESH MATERIALIZED VIEW CONCURRENTLY mvtest_tm WITH NO DATA;
+
+-- the concurrent refresh can be used in a transaction block
+BEGIN;
+DELETE FROM mvtest_t WHERE type = 'w';
+REFRESH MATERIALIZED VIEW CONCURRENTLY mvtest_tm;
+SELECT * FROM mvtest_tm ORDER BY type;
+ROLLBACK;
+SELECT * FROM mvtest_tm ORDER BY type;
+
+-- duplicate rows and nulls are matched one to one, with no unique index
+CREATE TABLE mvtest_dup (a int, b text);
+INSERT INTO mvtest_dup VALUES (1, 'one'), (1, 'one'), (1, 'one'), (2, NULL), (2, NULL), (NULL, NULL);
+CREATE MATERIALIZED VIEW mvtest_dupm AS SELECT * FROM mvtest_dup;
+DELETE FROM mvtest_dup WHERE ctid = (SELECT min(ctid) FROM mvtest_dup WHERE a = 1);
+INSERT INTO mvtest_dup VALUES (2, NULL), (NULL, NULL);
+REFRESH MATERIALIZED VIEW CONCURRENTLY mvtest_dupm;
+SELECT a, b, count(*) FROM mvtest_dupm GROUP BY a, b ORDER BY a, b;
+
+-- values that are equal but not identical are replaced
+CREATE TABLE mvtest_num (n numeric);
+INSERT INTO mvtest_num VALUES (1.0), (2.0);
+CREATE MATERIALIZED VIEW mvtest_numm AS SELECT * FROM mvtest_num;
+UPDATE mvtest_num SET n = 1.00 WHERE n = 1;
+REFRESH MATERIALIZED VIEW CONCURRENTLY mvtest_numm;
+SELECT * FROM mvtest_numm ORDER BY n;
+SELECT ROW(1.0::numeric, 'a') = ROW(1.00::numeric, 'a') AS eq,
+       ROW(1.0::numeric, 'a')::record *= ROW(1.00::numeric, 'a')::record AS identical,
+       ROW(1.0::numeric, NULL::text)::record *= ROW(1.0::numeric, NULL::text)::record AS identical_nulls;
+
+-- a concurrent refresh needs an ordering on every column
+CREATE MATERIALIZED VIEW mvtest_pointm AS SELECT point(1, 2) AS p;
+REFRESH MATERIALIZED VIEW CONCURRENTLY mvtest_pointm;
+REFRESH MATERIALIZED VIEW mvtest_pointm;
+
+-- the dependencies are tracked
+DROP TABLE mvtest_t;
+DROP TABLE mvtest_t CASCADE;
+SELECT relname FROM pg_class WHERE relname LIKE 'mvtest%' ORDER BY relname;
+
+DROP TABLE mvtest_dup, mvtest_num CASCADE;
+DROP MATERIALIZED VIEW mvtest_pointm;
@@ -13,6 +13,14 @@ SELECT	ctid, aggfinalfn
 FROM	pg_catalog.pg_aggregate fk
 WHERE	aggfinalfn != 0 AND
 	NOT EXISTS(SELECT 1 FROM pg_catalog.pg_proc pk WHERE pk.oid = fk.aggfinalfn);
+SELECT	ctid, aggcombinefn
+FROM	pg_catalog.pg_aggregate fk
+WHERE	aggcombinefn != 0 AND
+	NOT EXISTS(SELECT 1 FROM pg_catalog.pg_proc pk WHERE pk.oid = fk.aggcombinefn);
+SELECT	ctid, agginvtransfn
+FROM	pg_catalog.pg_aggregate fk
+WHERE	agginvtransfn != 0 AND
+	NOT EXISTS(SELECT 1 FROM pg_catalog.pg_proc pk WHERE pk.oid = fk.agginvtransfn);
 SELECT	ctid, aggsortop
 FROM	pg_catalog.pg_aggregate fk
 WHERE	aggsortop != 0 AND
@@ -614,6 +614,32 @@ WHERE a.aggfnoid = p.oid AND
      OR pfn.pronargs != 1
      OR NOT binary_coercible(a.aggtranstype, pfn.proargtypes[0]));
 
+-- Cross-check combinefn (if present) against its entry in pg_proc.
+-- It must take two transition values and return a transition value.
+
+SELECT a.aggfnoid::oid, p.proname, pcf.oid, pcf.proname
+FROM pg_aggregate AS a, pg_proc AS p, pg_proc AS pcf
+WHERE a.aggfnoid = p.oid AND
+    a.aggcombinefn = pcf.oid AND
+    (pcf.proretset
+     OR pcf.pronargs != 2
+     OR NOT physically_coercible(pcf.prorettype, a.aggtranstype)
+     OR NOT physically_coercible(a.aggtranstype, pcf.proargtypes[0])
+     OR NOT physically_coercible(a.aggtranstype, pcf.proargtypes[1]));
+
+-- Cross-check invtransfn (if present) against its entry in pg_proc.
+-- It must take the same arguments as the transfn and return a transition
+-- value.
+
+SELECT a.aggfnoid::oid, p.proname, pit.oid, pit.proname
+FROM pg_aggregate AS a, pg_proc AS p, pg_proc AS ptr, pg_proc AS pit
+WHERE a.aggfnoid = p.oid AND
+    a.aggtransfn = ptr.oid AND
+    a.agginvtransfn = pit.oid AND
+    (pit.proretset
+     OR NOT physically_coercible(pit.prorettype, a.aggtranstype)
+     OR pit.proargtypes != ptr.proargtypes);
+
 -- If transfn is strict then either initval should be non-NULL, or
 -- input type should match transtype so that the first non-null input
 -- can be assigned as the state value.
@@ -939,7 +965,7 @@ WHERE p1.amprocfamily = p3.oid AND p3.opfmethod = p2.oid AND
 
 -- Detect missing pg_amproc entries: should have as many support functions
 -- as AM expects for each datatype combination supported by the opfamily.
--- btree/GiST/GIN each allow one optional support function, though.
+-- btree and GIN each allow one optional support function, and GiST three.
 
 SELECT p1.amname, p2.opfname, p3.amproclefttype, p3.amprocrighttype
 FROM pg_am AS p1, pg_opfamily AS p2, pg_amproc AS p3
@@ -949,7 +975,8 @@ WHERE p2.opfmethod = p1.oid AND p3.amprocfamily = p2.oid AND
            p4.amproclefttype = p3.amproclefttype AND
            p4.amprocrighttype = p3.amprocrighttype)
     NOT BETWEEN
-      (CASE WHEN p1.amname IN ('btree', 'gist', 'gin') THEN p1.amsupport - 1
+      (CASE WHEN p1.amname IN ('btree', 'gin') THEN p1.amsupport - 1
+            WHEN p1.amname = 'gist' THEN p1.amsupport - 3
             ELSE p1.amsupport END)
       AND p1.amsupport;
 
@@ -971,7 +998,8 @@ FROM pg_am am JOIN pg_opclass op ON opcmethod = am.oid
          amproclefttype = amprocrighttype AND amproclefttype = opcintype
 WHERE am.amname = 'btree' OR am.amname = 'gist' OR am.amname = 'gin'
 GROUP BY amname, amsupport, opcname, amprocfamily
-HAVING (count(*) != amsupport AND count(*) != amsupport - 1)
+HAVING (count(*) != amsupport AND count(*) != amsupport - 1 AND
+        (amname <> 'gist' OR count(*) NOT BETWEEN amsupport - 3 AND amsupport - 2))
     OR amprocfamily IS NULL;
 
 -- Unfortunately, we can't check the amproc link very well because the
@@ -3708,3 +3708,47 @@ select testoa(1,2,1); -- fail at update
 
 drop function arrayassign1();
 drop function testoa(x1 int, x2 int, x3 int);
+
+--
+-- Test simple expressions that are evaluated by calling their function
+-- directly, and in-place array element assignment
+--
+create function fastexprs(n int) returns text language plpgsql as $$
+declare
+  i int := 0;
+  s int8 := 0;
+  z int;
+  a int[];
+begin
+  while i < n loop
+    i := i + 1;
+    s := s + i;
+    a[i] := i * i;
+  end loop;
+  z := z + 1;  -- null input gives null result
+  return s || ' ' || array_to_string(a, ',') || ' ' || coalesce(z::text, 'null');
+end$$;
+select fastexprs(5);
+select fastexprs(5); -- try again to exercise internal caching
+
+drop function fastexprs(int);
+
+--
+-- Test inlining of trivial immutable functions by the planner
+--
+create function inlinable_add(a int, b int) returns int language plpgsql
+immutable as $$
+begin
+  return a + b;
+end$$;
+create function notinlinable_add(a int) returns int language plpgsql
+immutable as $$
+declare b int := 1;
+begin
+  return a + b;
+end$$;
+explain (verbose, costs off) select inlinable_add(f1, 1) from int4_tbl;
+explain (verbose, costs off) select notinlinable_add(f1) from int4_tbl;
+
+drop function inlinable_add(int, int);
+drop function notinlinable_add(int);
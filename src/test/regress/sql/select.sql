@@ -207,3 +207,13 @@ drop function sillysrf(int);
 -- (see bug #5084)
 select * from (values (2),(null),(1)) v(k) where k = k order by k;
 select * from (values (2),(null),(1)) v(k) where k = k;
+
+-- Sorting input that is already ordered by a prefix of the sort keys
+select * from
+  (select hundred, unique1 from tenk1
+   where hundred < 2 and unique1 < 300 order by hundred offset 0) ss
+order by hundred, unique1 desc;
+select * from
+  (select hundred, unique1 from tenk1 where hundred < 3
+   order by hundred offset 0) ss
+order by hundred, unique1 limit 5;
@@ -178,3 +178,35 @@ SELECT * FROM information_schema.sequences WHERE sequence_name IN
 
 DROP USER seq_user;
 DROP SEQUENCE seq;
+
+--
+-- max_sequence_cache: each refill of the session's cache fetches twice as
+-- many values as the one before, up to the setting.  The sequence's
+-- last_value shows how far the last refill went.
+--
+CREATE SEQUENCE seq_adaptive;
+SET max_sequence_cache = 8;
+SELECT nextval('seq_adaptive'),
+       (SELECT last_value FROM seq_adaptive WHERE g > 0) AS fetched_to
+  FROM generate_series(1, 24) g;
+
+-- setval() starts over with small refills
+SELECT setval('seq_adaptive', 100);
+SELECT nextval('seq_adaptive'),
+       (SELECT last_value FROM seq_adaptive WHERE g > 0) AS fetched_to
+  FROM generate_series(1, 4) g;
+
+-- and so does ALTER SEQUENCE ... RESTART
+ALTER SEQUENCE seq_adaptive RESTART WITH 1000;
+SELECT nextval('seq_adaptive'),
+       (SELECT last_value FROM seq_adaptive WHERE g > 0) AS fetched_to
+  FROM generate_series(1, 4) g;
+
+-- the sequence's own CACHE is the smallest refill
+ALTER SEQUENCE seq_adaptive CACHE 4 RESTART WITH 1;
+SELECT nextval('seq_adaptive'),
+       (SELECT last_value FROM seq_adaptive WHERE g > 0) AS fetched_to
+  FROM generate_series(1, 16) g;
+
+RESET max_sequence_cache;
+DROP SEQUENCE seq_adaptive;
@@ -81,4 +81,8 @@ SELECT st.heap_blks_read + st.heap_blks_hit >= pr.heap_blks + cl.relpages,
   FROM pg_statio_user_tables AS st, pg_class AS cl, prevstats AS pr
  WHERE st.relname='tenk2' AND cl.relname='tenk2';
 
+-- SLRU statistics; by now the transaction status log has been consulted
+SELECT name, buffers >= 4 AS buffers FROM pg_stat_get_slru() ORDER BY name;
+SELECT hits + reads > 0 AS used FROM pg_stat_get_slru() WHERE name = 'pg_clog';
+
 -- End of Stats Test
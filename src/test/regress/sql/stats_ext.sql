@@ -0,0 +1,48 @@
+--
+-- Statistics on groups of columns (ALTER TABLE ... ADD STATISTICS)
+--
+
+-- b is determined by a; c is unrelated to either
+CREATE TABLE stats_ext_t (a int, b int, c int);
+INSERT INTO stats_ext_t
+  SELECT i % 1000, (i % 1000) / 10, i % 7 FROM generate_series(1, 10000) i;
+
+-- bad definitions
+ALTER TABLE stats_ext_t ADD STATISTICS (a);
+ALTER TABLE stats_ext_t ADD STATISTICS (a, a);
+ALTER TABLE stats_ext_t ADD STATISTICS (a, nosuchcol);
+ALTER TABLE stats_ext_t ADD STATISTICS (a, ctid);
+ALTER TABLE stats_ext_t DROP STATISTICS (a, b);
+
+-- column order doesn't matter
+ALTER TABLE stats_ext_t ADD STATISTICS (b, a);
+ALTER TABLE stats_ext_t ADD STATISTICS (a, b);
+ALTER TABLE stats_ext_t ADD STATISTICS (a, c);
+
+SELECT stakeys, stadistinct, stadependencies FROM pg_statistic_ext
+  WHERE starelid = 'stats_ext_t'::regclass ORDER BY stakeys::text;
+
+-- the table is small enough for ANALYZE to read all of it
+ANALYZE stats_ext_t;
+
+SELECT stakeys, stadistinct, stadependencies FROM pg_statistic_ext
+  WHERE starelid = 'stats_ext_t'::regclass ORDER BY stakeys::text;
+
+-- the statistics mustn't change query results
+SELECT count(*) FROM stats_ext_t WHERE a = 1 AND b = 0;
+SELECT count(*) FROM stats_ext_t WHERE a = 1 AND b = 0 AND c = 1;
+SELECT count(*) FROM (SELECT a, b FROM stats_ext_t GROUP BY a, b) s;
+
+-- dropping a column drops the groups that include it
+ALTER TABLE stats_ext_t DROP COLUMN c;
+SELECT stakeys FROM pg_statistic_ext
+  WHERE starelid = 'stats_ext_t'::regclass ORDER BY stakeys::text;
+
+ALTER TABLE stats_ext_t DROP STATISTICS (a, b);
+SELECT stakeys FROM pg_statistic_ext
+  WHERE starelid = 'stats_ext_t'::regclass ORDER BY stakeys::text;
+
+ALTER TABLE stats_ext_t ADD STATISTICS (a, b);
+DROP TABLE stats_ext_t;
+SELECT count(*) FROM pg_statistic_ext
+  WHERE starelid NOT IN (SELECT oid FROM pg_class);
@@ -282,6 +282,32 @@ SELECT 'be_r' NOT LIKE 'b_e__r' ESCAPE '_' AS "false";
 SELECT 'be_r' LIKE '__e__r' ESCAPE '_' AS "false";
 SELECT 'be_r' NOT LIKE '__e__r' ESCAPE '_' AS "true";
 
+--
+-- test LIKE and regex patterns containing required literal strings, which
+-- are checked for before doing the full match
+--
+SELECT 'foo-bar-baz' LIKE '%bar%baz' AS "true";
+SELECT 'foo-bar-baz' NOT LIKE '%bar%baz' AS "false";
+
+SELECT 'foo-bar-baz' LIKE '%bar%qux%' AS "false";
+SELECT 'foo-bar-baz' NOT LIKE '%bar%qux%' AS "true";
+
+SELECT 'foo%bar' LIKE '%o#%b%' ESCAPE '#' AS "true";
+SELECT 'foo%bar' NOT LIKE '%o#%b%' ESCAPE '#' AS "false";
+
+SELECT 'foo-bar' LIKE '%o#%b%' ESCAPE '#' AS "false";
+SELECT 'foo-bar' NOT LIKE '%o#%b%' ESCAPE '#' AS "true";
+
+SELECT 'foo-bar-baz' ~ 'o+-ba[rz]-baz' AS "true";
+SELECT 'foo-bar-baz' ~ 'fox?o-bar' AS "true";
+SELECT 'foo-bar-baz' ~ 'fo{2}-(bar|qux)' AS "true";
+SELECT 'foo-bar-baz' ~ 'qux|baz' AS "true";
+SELECT 'foo-bar-baz' ~ '(?i)FOO-BAR' AS "true";
+SELECT 'foo-bar-baz' ~ 'bar\-baz' AS "true";
+SELECT 'foo-bar-baz' ~ 'qux.*baz' AS "false";
+SELECT 'foo-bar-baz' ~ '***=o-b' AS "true";
+SELECT 'foo-bar-baz' ~ '***=o.b' AS "false";
+
 
 --
 -- test ILIKE (case-insensitive LIKE)
@@ -361,6 +387,25 @@ SELECT substr(f1, 99995, 10) from toasttest;
 
 DROP TABLE toasttest;
 
+--
+-- test substr with a compressed out-of-line value, of which only the needed
+-- prefix is fetched and decompressed
+--
+CREATE TABLE toasttest(f1 text);
+
+insert into toasttest
+  select repeat(string_agg(md5(i::text), '' ORDER BY i), 200) from generate_series(1, 50) i;
+
+SELECT pg_column_size(f1) < 20000 AS compressed, length(f1) FROM toasttest;
+
+SELECT substr(f1, 1, 32) = md5('1') AS first,
+       substr(f1, 1601, 64) = md5('1') || md5('2') AS later,
+       substr(f1, 319969) = md5('50') AS last,
+       length(substr(f1, 319990, 100)) AS truncated
+FROM toasttest;
+
+DROP TABLE toasttest;
+
 --
 -- test substr with toasted bytea values
 --
@@ -350,3 +350,22 @@ where a.thousand = b.thousand
   and exists ( select 1 from tenk1 c where b.hundred = c.hundred
                    and not exists ( select 1 from tenk1 d
                                     where a.thousand = d.thousand ) );
+
+--
+-- NOT IN can be an anti-join when no NULLs are involved
+--
+create temp table notin_a (id int not null, n int);
+create temp table notin_b (id int not null, n int);
+insert into notin_a values (1, 1), (2, null), (3, 3), (4, 4);
+insert into notin_b values (1, 1), (3, null);
+explain (costs off)
+select id from notin_a where id not in (select id from notin_b);
+select id from notin_a where id not in (select id from notin_b) order by id;
+-- a NULL output of the subquery makes the result unknown
+select id from notin_a where id not in (select n from notin_b) order by id;
+select id from notin_a where id not in (select n from notin_b where n > 0) order by id;
+-- so does a NULL on the left
+select id from notin_a where n not in (select id from notin_b) order by id;
+select id from notin_a where n > 0 and n not in (select id from notin_b) order by id;
+select a.id from notin_a a left join notin_b b on a.id = b.id
+where b.id not in (select id from notin_a where n = 3) order by a.id;
@@ -151,3 +151,13 @@ select whoami();
 select pg_temp.whoami();
 
 drop table public.whereami;
+
+-- temp_buffers can be raised, but not lowered, once temp tables are in use
+begin;
+set local temp_buffers = 2000;
+create temp table tempbufs as select generate_series(1, 1000) as a;
+truncate tempbufs;
+insert into tempbufs select generate_series(1, 10);
+select count(*) from tempbufs;
+set local temp_buffers = 100;
+rollback;
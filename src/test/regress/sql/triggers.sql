@@ -961,3 +961,72 @@ SELECT * FROM city_view;
 
 DROP TABLE city_table CASCADE;
 DROP TABLE country_table;
+
+--
+-- Statement-level triggers with transition tables
+--
+CREATE TABLE transition_table_base (id int, val text);
+CREATE TABLE transition_table_log (op text, old_id int, new_id int, new_val text);
+
+CREATE FUNCTION transition_table_log_func() RETURNS trigger
+LANGUAGE plpgsql AS $$
+BEGIN
+  IF TG_OP = 'INSERT' THEN
+    INSERT INTO transition_table_log
+      SELECT TG_OP, NULL, n.id, n.val
+        FROM pg_transition_table('newtab', NULL::transition_table_base) n;
+  ELSIF TG_OP = 'UPDATE' THEN
+    INSERT INTO transition_table_log
+      SELECT TG_OP, o.id, n.id, n.val
+        FROM pg_transition_table('oldtab', NULL::transition_table_base) o
+        JOIN pg_transition_table('newtab', NULL::transition_table_base) n
+          ON o.id = n.id;
+  ELSE
+    INSERT INTO transition_table_log
+      SELECT TG_OP, o.id, NULL, NULL
+        FROM pg_transition_table('oldtab', NULL::transition_table_base) o;
+  END IF;
+  RETURN NULL;
+END$$;
+
+CREATE TRIGGER transition_ins AFTER INSERT ON transition_table_base
+  REFERENCING NEW TABLE AS newtab
+  FOR EACH STATEMENT EXECUTE PROCEDURE transition_table_log_func();
+CREATE TRIGGER transition_upd AFTER UPDATE ON transition_table_base
+  REFERENCING OLD TABLE AS oldtab NEW TABLE AS newtab
+  FOR EACH STATEMENT EXECUTE PROCEDURE transition_table_log_func();
+CREATE TRIGGER transition_del AFTER DELETE ON transition_table_base
+  REFERENCING OLD TABLE oldtab
+  FOR EACH STATEMENT EXECUTE PROCEDURE transition_table_log_func();
+
+SELECT pg_get_triggerdef(oid) FROM pg_trigger WHERE tgname = 'transition_upd';
+
+INSERT INTO transition_table_base VALUES (1, 'one'), (2, 'two'), (3, 'three');
+UPDATE transition_table_base SET val = val || '!' WHERE id >= 2;
+UPDATE transition_table_base SET val = 'none' WHERE false;
+DELETE FROM transition_table_base WHERE id <> 2;
+SELECT * FROM transition_table_log ORDER BY op, old_id, new_id;
+
+-- transition tables are only visible to the trigger declaring them
+SELECT * FROM pg_transition_table('newtab', NULL::transition_table_base);
+
+-- invalid REFERENCING clauses
+CREATE TRIGGER transition_bad BEFORE INSERT ON transition_table_base
+  REFERENCING NEW TABLE AS newtab
+  FOR EACH STATEMENT EXECUTE PROCEDURE transition_table_log_func();
+CREATE TRIGGER transition_bad AFTER INSERT ON transition_table_base
+  REFERENCING NEW TABLE AS newtab
+  FOR EACH ROW EXECUTE PROCEDURE transition_table_log_func();
+CREATE TRIGGER transition_bad AFTER INSERT ON transition_table_base
+  REFERENCING OLD TABLE AS oldtab
+  FOR EACH STATEMENT EXECUTE PROCEDURE transition_table_log_func();
+CREATE TRIGGER transition_bad AFTER UPDATE ON transition_table_base
+  REFERENCING OLD TABLE AS tab NEW TABLE AS tab
+  FOR EACH STATEMENT EXECUTE PROCEDURE transition_table_log_func();
+CREATE TRIGGER transition_bad AFTER UPDATE ON transition_table_base
+  REFERENCING NEW ROW AS newrow
+  FOR EACH STATEMENT EXECUTE PROCEDURE transition_table_log_func();
+
+DROP TABLE transition_table_base;
+DROP TABLE transition_table_log;
+DROP FUNCTION transition_table_log_func();
@@ -165,6 +165,18 @@ Water, water, every where,
 S. T. Coleridge (1772-1834)
 '), to_tsquery('english', 'ocean'));
 
+-- ranking keeps per-query state across calls; check it follows query changes
+SELECT count(*) FROM test_tsvector t,
+  (VALUES (1, 'wr & qh'::tsquery), (2, 'eq | yt'), (3, 'w:* | q:*'), (4, 'wr & qh')) AS q(n, q)
+WHERE ts_rank(t.a, q.q) <> CASE q.n WHEN 1 THEN ts_rank(t.a, 'wr & qh')
+                                    WHEN 2 THEN ts_rank(t.a, 'eq | yt')
+                                    WHEN 3 THEN ts_rank(t.a, 'w:* | q:*')
+                                    ELSE ts_rank(t.a, 'wr & qh') END
+   OR ts_rank_cd(t.a, q.q) <> CASE q.n WHEN 1 THEN ts_rank_cd(t.a, 'wr & qh')
+                                       WHEN 2 THEN ts_rank_cd(t.a, 'eq | yt')
+                                       WHEN 3 THEN ts_rank_cd(t.a, 'w:* | q:*')
+                                       ELSE ts_rank_cd(t.a, 'wr & qh') END;
+
 --headline tests
 SELECT ts_headline('english', '
 Day after day, day after day,
@@ -53,5 +53,26 @@ VACUUM FULL pg_database;
 VACUUM FULL vaccluster;
 VACUUM FULL vactst;
 
+INSERT INTO vaccluster SELECT generate_series(1, 1000);
+DELETE FROM vaccluster WHERE i <= 900;
+VACUUM (COMPACT) vaccluster;
+SELECT count(*), sum(i) FROM vaccluster;
+SELECT * FROM vaccluster WHERE i = 950;
+VACUUM (FULL, COMPACT) vaccluster;
+
+-- rows are only ever moved to lower pages, so the table never grows, even
+-- when there's room for only a few of them
+CREATE TABLE vaccompact (i INT, t TEXT);
+INSERT INTO vaccompact SELECT i, repeat('x', 100) FROM generate_series(1, 700) i;
+DELETE FROM vaccompact WHERE i <= 5;
+CREATE TABLE vaccompact_size AS
+  SELECT pg_relation_size('vaccompact') AS before;
+VACUUM (COMPACT) vaccompact;
+SELECT pg_relation_size('vaccompact') <= before AS not_grown
+  FROM vaccompact_size;
+SELECT count(*), sum(i) FROM vaccompact;
+DROP TABLE vaccompact_size;
+DROP TABLE vaccompact;
+
 DROP TABLE vaccluster;
 DROP TABLE vactst;
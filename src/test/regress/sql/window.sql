@@ -224,6 +224,21 @@ SELECT * FROM v_window;
 
 SELECT pg_get_viewdef('v_window');
 
+-- moving aggregates: rows that leave the frame are removed with the inverse
+-- transition functions, unless the aggregates have to start over
+SELECT i, sum(v) OVER w, count(v) OVER w, count(*) OVER w, avg(v) OVER w
+FROM (VALUES (1,2),(2,4),(3,NULL),(4,6),(5,NULL),(6,NULL),(7,8)) t(i,v)
+WINDOW w AS (ORDER BY i ROWS BETWEEN 1 PRECEDING AND CURRENT ROW);
+
+-- the numeric result scale must follow the rows in the frame
+SELECT i, sum(v) OVER w, sum(i::int8) OVER w
+FROM (VALUES (1,1.25),(2,2.5),(3,3),(4,4),(5,5.00),(6,6)) t(i,v)
+WINDOW w AS (ORDER BY i ROWS BETWEEN 1 PRECEDING AND CURRENT ROW);
+
+SELECT i, count(*) OVER w, sum(i) OVER w
+FROM generate_series(1, 4) i
+WINDOW w AS (ORDER BY i ROWS BETWEEN CURRENT ROW AND UNBOUNDED FOLLOWING);
+
 -- with UNION
 SELECT count(*) OVER (PARTITION BY four) FROM (SELECT * FROM tenk1 UNION ALL SELECT * FROM tenk2)s LIMIT 0;
 
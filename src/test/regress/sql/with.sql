@@ -789,3 +789,28 @@ WITH t AS (
 )
 VALUES(FALSE);
 DROP RULE y_rule ON y;
+
+--
+-- Inlining of non-recursive CTEs
+--
+
+-- a singly-referenced, side-effect-free CTE is folded into the query,
+-- so the outer qual can use an index
+explain (costs off)
+with x as (select * from tenk1)
+select * from x where unique1 = 1;
+-- but not if it is marked MATERIALIZED
+explain (costs off)
+with x as materialized (select * from tenk1)
+select * from x where unique1 = 1;
+-- or if it contains volatile functions
+explain (costs off)
+with x as (select *, random() as r from tenk1)
+select unique1 from x where unique1 = 1;
+-- the options are kept in view definitions
+create temp view cte_materialize_view as
+  with x as materialized (select 1 as a), y as not materialized (select 2 as b)
+  select * from x, y;
+select pg_get_viewdef('cte_materialize_view'::regclass);
+select * from cte_materialize_view;
+drop view cte_materialize_view;
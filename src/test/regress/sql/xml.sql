@@ -58,6 +58,10 @@ SELECT xmlelement(name foo, xmlattributes(true as bar));
 SELECT xmlelement(name foo, xmlattributes('2009-04-09 00:24:37'::timestamp as bar));
 SELECT xmlelement(name foo, xmlattributes('infinity'::timestamp as bar));
 SELECT xmlelement(name foo, xmlattributes('<>&"''' as funny, xml 'b<a/>r' as funnier));
+-- values of binary-compatible casts are shown as the cast's type
+SELECT xmlelement(name foo, xmlattributes(reltype::regtype as t), reltype::regtype)
+  FROM pg_class WHERE relname = 'pg_class';
+SELECT xmlforest(reltype::regtype as t) FROM pg_class WHERE relname = 'pg_class';
 
 
 SELECT xmlparse(content 'abc');